@@ -294,23 +294,58 @@ fail:
 	return -ENOMSG;
 }
 
+/*
+ * Consume VSC responses by polling until at most @limit panic requests are
+ * outstanding. Responses to the regular read/write request are dropped, it
+ * is not going to be waited for anymore.
+ */
+static bool vblk_oops_panic_poll(struct vblk_dev *vblkdev, uint32_t limit)
+{
+	struct vs_request req_out;
+	uint32_t waited = 0;
+
+	while (vblkdev->panic_inflight > limit) {
+		if (tegra_hv_ivc_can_read(vblkdev->ivck)) {
+			if (tegra_hv_ivc_read(vblkdev->ivck, &req_out,
+					sizeof(struct vs_request)) <= 0)
+				return false;
+			if (req_out.req_id >= VSC_REQ_PANIC)
+				vblkdev->panic_inflight--;
+			waited = 0;
+			continue;
+		}
+
+		if (waited >= VSC_PANIC_TIMEOUT_US)
+			return false;
+		udelay(VSC_PANIC_POLL_US);
+		waited += VSC_PANIC_POLL_US;
+	}
+
+	return true;
+}
+
 /*
  * panic_write is going to mirror what regular write is going to do with some
  * differences:
  * - this is best effort service that can have no assumptions on system state
  * - avoid locks since nobody is executing concurrently .and. system is going
  *   to stop running soon
- * - use VSC_REQ that is reserved for panic
- * - no need to check for VSC response.  Send request and assume it is all good
- *   since the caller is not going to do anything meaningful if we report error
+ * - use the VSC_REQs reserved for panic, their requests are formatted at
+ *   setup and only the block range is filled in here
+ * - a record larger than one IO is split over the panic requests and sent
+ *   without waiting for each response, responses are polled for only to
+ *   reuse a request and once at the end so the record lands before the VM
+ *   goes down. Errors are not reported since the caller is not going to do
+ *   anything meaningful with them
  */
 static ssize_t vblk_oops_panic_write(const char *buf, size_t bytes,
 		loff_t pos)
 {
 	struct vsc_request *vsc_req;
-	struct vs_request req_in = {0};
-	uint32_t blocks, block_pos;
+	struct vs_request *vs_req;
 	uint32_t block_size = vblkdev_oops->config.blk_config.hardblk_size;
+	size_t done = 0;
+	size_t chunk;
 
 	dev_dbg(vblkdev_oops->device, "%s> pos:%lld, bytes:%lu\n", __func__,
 		pos, bytes);
@@ -324,27 +359,6 @@ static ssize_t vblk_oops_panic_write(const char *buf, size_t bytes,
 	if (!bytes)
 		return -ENOMSG;
 
-	vsc_req = &vblkdev_oops->reqs[VSC_REQ_PANIC];
-
-	block_pos = pos/block_size;
-	blocks = bytes/block_size;
-
-	/*
-	 * only need for unaligned size is when metadata is updated during
-	 * pstore erase operation.  It is OK in this case to round up size to
-	 * block boundary.
-	 *
-	 * For panic_write, however, we expect full records to be written which
-	 * means start offset and size are both block aligned.
-	 */
-	if (bytes & (block_size-1))
-		blocks += 1;
-
-	POPULATE_BLK_REQ(req_in, VS_DATA_REQ, VS_BLK_WRITE, block_pos, blocks,
-			vsc_req->mempool_offset);
-
-	memcpy(vsc_req->mempool_virt, buf, bytes);
-
 	/*
 	 * We are avoiding ivc_lock usage in this path since the assumption is
 	 * that in panic flow there is only a single thread/CPU executing which
@@ -359,22 +373,56 @@ static ssize_t vblk_oops_panic_write(const char *buf, size_t bytes,
 	 * could potentially deadlock since vblk_oops_read()/vblk_oops_write()
 	 * won't be able to run to release the acquired ivc_lock.
 	 */
-	if (!tegra_hv_ivc_write(vblkdev_oops->ivck, &req_in,
-				sizeof(struct vs_request))) {
-		dev_err(vblkdev_oops->device,
-			"Request IVC write failed!\n");
-		return 0;
+	while (done < bytes) {
+		/* Wait for the oldest panic request if all of them are in use */
+		if (!vblk_oops_panic_poll(vblkdev_oops,
+					  vblkdev_oops->panic_reqs - 1)) {
+			dev_err(vblkdev_oops->device,
+				"No response from virtual storage!\n");
+			return 0;
+		}
+
+		vsc_req = &vblkdev_oops->reqs[VSC_REQ_PANIC +
+			(vblkdev_oops->panic_next % vblkdev_oops->panic_reqs)];
+		vs_req = &vsc_req->vs_req;
+		chunk = min_t(size_t, bytes - done, vsc_req->mempool_len);
+
+		/*
+		 * only need for unaligned size is when metadata is updated
+		 * during pstore erase operation.  It is OK in this case to
+		 * round up size to block boundary.
+		 *
+		 * For panic_write, however, we expect full records to be
+		 * written which means start offset and size are both block
+		 * aligned.
+		 */
+		vs_req->blkdev_req.blk_req.blk_offset = (pos + done) / block_size;
+		vs_req->blkdev_req.blk_req.num_blks = DIV_ROUND_UP(chunk, block_size);
+
+		memcpy(vsc_req->mempool_virt, buf + done, chunk);
+
+		if (!tegra_hv_ivc_write(vblkdev_oops->ivck, vs_req,
+					sizeof(struct vs_request))) {
+			dev_err(vblkdev_oops->device,
+				"Request IVC write failed!\n");
+			return 0;
+		}
+
+		vblkdev_oops->panic_next++;
+		vblkdev_oops->panic_inflight++;
+		done += chunk;
 	}
 
 	/*
-	 * VSC will respond at some point but we don't care about the response
-	 * since we cannot do anything new to recover/retry (if there is some
-	 * error). So we are not going to wait and check the response.
-	 *
-	 * Also, after panic_write is invoked,the VM is going to stop executing
+	 * After panic_write is invoked, the VM is going to stop executing
 	 * and the only recovery out of this is a VM (or) tegra reboots.
-	 * In both the cases we reset IVC to get it to a clean state.
+	 * In both the cases we reset IVC to get it to a clean state, so only
+	 * make sure the server has written the record before returning.
 	 */
+	if (!vblk_oops_panic_poll(vblkdev_oops, 0))
+		dev_err(vblkdev_oops->device,
+			"Panic record not acknowledged by virtual storage!\n");
+
 	return bytes;
 }
 
@@ -412,10 +460,10 @@ static void setup_device(struct vblk_dev *vblkdev)
 
 	max_requests = ((vblkdev->ivmk->size) / max_io_bytes);
 
-	if (max_requests < MAX_OOPS_VSC_REQS) {
+	if (max_requests < VSC_REQ_PANIC + 1) {
 		dev_err(vblkdev->device,
 			"Device needs to support %d concurrent requests\n",
-			MAX_OOPS_VSC_REQS);
+			VSC_REQ_PANIC + 1);
 		return;
 	} else if (max_requests > MAX_OOPS_VSC_REQS) {
 		dev_warn(vblkdev->device,
@@ -447,6 +495,10 @@ static void setup_device(struct vblk_dev *vblkdev)
 	 *
 	 *  In short, the optimal setting is when both of these are equal
 	 */
+	/* Extra panic requests are only an optimization, fit them in the IVC */
+	max_requests = min_t(uint32_t, max_requests,
+			     max_t(uint32_t, vblkdev->ivck->nframes, VSC_REQ_PANIC + 1));
+
 	if (vblkdev->ivck->nframes < max_requests) {
 		/* Error if the virtual storage device supports
 		 * read, write and ioctl operations
@@ -465,6 +517,13 @@ static void setup_device(struct vblk_dev *vblkdev)
 		req->mempool_len = max_io_bytes;
 		req->id = req_id;
 		req->vblkdev = vblkdev;
+
+		/* Format panic requests now, panic_write only sets the range */
+		if (req_id >= VSC_REQ_PANIC) {
+			POPULATE_BLK_REQ(req->vs_req, VS_DATA_REQ, VS_BLK_WRITE,
+					0, 0, req->mempool_offset);
+			req->vs_req.req_id = req_id;
+		}
 	}
 
 	if (max_requests == 0) {
@@ -474,6 +533,7 @@ static void setup_device(struct vblk_dev *vblkdev)
 	}
 
 	vblkdev->max_requests = max_requests;
+	vblkdev->panic_reqs = max_requests - VSC_REQ_PANIC;
 
 	if (!(vblkdev->config.blk_config.req_ops_supported &
 				VS_BLK_READ_ONLY_MASK)) {
@@ -20,14 +20,19 @@
 #define IVC_RESET_RETRIES	30
 #define VSC_RESPONSE_RETRIES	10
 
-/* one IVC for regular IO and one for panic write */
+/* one IVC for regular IO and the rest for pipelined panic writes */
 #define VSC_REQ_RW 0
 #define VSC_REQ_PANIC (VSC_REQ_RW+1)
-#define MAX_OOPS_VSC_REQS (VSC_REQ_PANIC+1)
+#define MAX_PANIC_VSC_REQS 8
+#define MAX_OOPS_VSC_REQS (VSC_REQ_PANIC+MAX_PANIC_VSC_REQS)
 
 /* wait time for response from VSC */
 #define VSC_RESPONSE_WAIT_MS 1
 
+/* polled wait for a VSC response in panic, interrupts are off */
+#define VSC_PANIC_POLL_US	10
+#define VSC_PANIC_TIMEOUT_US	(100 * USEC_PER_MSEC)
+
 /* PSTORE defaults */
 #define PSTORE_KMSG_RECORD_SIZE (64*1024)
 
@@ -65,6 +70,9 @@ struct vblk_dev {
 	DECLARE_BITMAP(pending_reqs, MAX_OOPS_VSC_REQS);
 	uint32_t inflight_reqs;
 	uint32_t max_requests;
+	uint32_t panic_reqs;		/* requests reserved for panic_write */
+	uint32_t panic_next;		/* next panic request to use */
+	uint32_t panic_inflight;	/* panic requests not answered yet */
 	struct mutex ivc_lock;
 	int pstore_max_reason;		/* pstore max_reason */
 	uint32_t pstore_kmsg_size;	/* pstore kmsg record size */
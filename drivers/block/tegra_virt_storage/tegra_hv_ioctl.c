@@ -34,6 +34,7 @@ int vblk_complete_ioctl_req(struct vblk_dev *vblkdev,
 
 	ioctl_req->status = status;
 	memcpy(ioctl_req->ioctl_buf, vsc_req->mempool_virt,
+			ioctl_req->copy_out_len ? ioctl_req->copy_out_len :
 			ioctl_req->ioctl_len);
 comp_exit:
 	return ret;
@@ -68,6 +69,7 @@ int vblk_prep_ioctl_req(struct vblk_dev *vblkdev,
 	vs_req = &vsc_req->vs_req;
 	vs_req->blkdev_req.req_op = VS_BLK_IOCTL;
 	memcpy(vsc_req->mempool_virt, ioctl_req->ioctl_buf,
+			ioctl_req->copy_in_len ? ioctl_req->copy_in_len :
 			ioctl_req->ioctl_len);
 	vs_req->blkdev_req.ioctl_req.ioctl_id = ioctl_req->ioctl_id;
 	vs_req->blkdev_req.ioctl_req.data_offset = vsc_req->mempool_offset;
@@ -124,7 +126,8 @@ int vblk_submit_ioctl_req(struct block_device *bdev,
 	if (err)
 		goto free_ioctl_req;
 
-	rq = blk_mq_alloc_request(vblkdev->queue, REQ_OP_DRV_IN, BLK_MQ_REQ_NOWAIT);
+	/* Wait for a tag, the worker keeps up to max_ioctl_requests in flight */
+	rq = blk_mq_alloc_request(vblkdev->queue, REQ_OP_DRV_IN, 0);
 	if (IS_ERR_OR_NULL(rq)) {
 		dev_err(vblkdev->device,
 			"Failed to get handle to a request!\n");
@@ -176,9 +179,11 @@ int vblk_ioctl(struct block_device *bdev, fmode_t mode,
 	unsigned int cmd, unsigned long arg)
 {
 	int ret;
-	struct vblk_dev *vblkdev = bdev->bd_disk->private_data;
 
-	mutex_lock(&vblkdev->ioctl_lock);
+	/*
+	 * Not serialized, every command has its own buffers and mempool slot
+	 * so passthrough commands from several callers are queued together.
+	 */
 	switch (cmd) {
 	case MMC_IOC_MULTI_CMD:
 	case MMC_IOC_CMD:
@@ -191,7 +196,6 @@ int vblk_ioctl(struct block_device *bdev, fmode_t mode,
 		ret = -ENOTTY;
 		break;
 	}
-	mutex_unlock(&vblkdev->ioctl_lock);
 
 	return ret;
 }
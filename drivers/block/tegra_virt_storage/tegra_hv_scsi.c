@@ -7,6 +7,7 @@
 #include <linux/moduleparam.h>
 #include <linux/kernel.h> /* printk() */
 #include <linux/slab.h>   /* kmalloc() */
+#include <linux/mm.h>     /* kvmalloc() */
 #include <linux/fs.h>   /* everything... */
 #include <linux/errno.h> /* error codes */
 #include <linux/fcntl.h> /* O_ACCMODE */
@@ -94,7 +95,8 @@ int vblk_prep_sg_io(struct vblk_dev *vblkdev,
 		goto free_hp;
 	}
 
-	ioctl_buf = kmalloc(ioctl_len, GFP_KERNEL);
+	/* Large transfers must not depend on high order allocations */
+	ioctl_buf = kvmalloc(ioctl_len, GFP_KERNEL);
 	if (ioctl_buf == NULL) {
 		err = -ENOMEM;
 		goto free_hp;
@@ -155,9 +157,17 @@ int vblk_prep_sg_io(struct vblk_dev *vblkdev,
 	ioctl_req->ioctl_buf = ioctl_buf;
 	ioctl_req->ioctl_len = ioctl_len;
 
+	/* Only move the data buffer through the mempool in its direction */
+	if ((vblk_hp->data_direction == SCSI_DATA_NONE) ||
+		(vblk_hp->data_direction == SCSI_FROM_DEVICE))
+		ioctl_req->copy_in_len = data_buf_offset_aligned;
+	if ((vblk_hp->data_direction == SCSI_DATA_NONE) ||
+		(vblk_hp->data_direction == SCSI_TO_DEVICE))
+		ioctl_req->copy_out_len = data_buf_offset_aligned;
+
 free_ioctl_buf:
 	if (err && ioctl_buf)
-		kfree(ioctl_buf);
+		kvfree(ioctl_buf);
 
 free_hp:
 	if (hp)
@@ -180,7 +190,7 @@ int vblk_complete_sg_io(struct vblk_dev *vblkdev,
 	if (ioctl_req->status) {
 		err = ioctl_req->status;
 		if (ioctl_req->ioctl_buf)
-			kfree(ioctl_req->ioctl_buf);
+			kvfree(ioctl_req->ioctl_buf);
 		goto exit;
 	}
 
@@ -232,7 +242,7 @@ int vblk_complete_sg_io(struct vblk_dev *vblkdev,
 
 free_hp:
 	if (ioctl_req->ioctl_buf)
-		kfree(ioctl_req->ioctl_buf);
+		kvfree(ioctl_req->ioctl_buf);
 
 	if (hp)
 		kfree(hp);
@@ -50,6 +50,28 @@ static uint32_t total_instance_id;
 
 static int vblk_major;
 
+static unsigned int max_sectors_kb;
+module_param(max_sectors_kb, uint, 0444);
+MODULE_PARM_DESC(max_sectors_kb,
+	"Largest I/O sent in one request in KiB, 0 uses the storage server limit");
+
+static unsigned int iova_max_segments;
+module_param(iova_max_segments, uint, 0444);
+MODULE_PARM_DESC(iova_max_segments,
+	"Scatter-gather segments per request in IOVA mode, 0 covers the largest I/O");
+
+static unsigned int complete_budget = 32;
+module_param(complete_budget, uint, 0644);
+MODULE_PARM_DESC(complete_budget,
+	"IVC responses completed per worker run before it yields");
+
+#if defined(NV_BLK_MQ_OPS_STRUCT_POLL_HAS_IO_COMP_BATCH_ARG) /* Linux v5.16 */
+static unsigned int poll_queues;
+module_param(poll_queues, uint, 0444);
+MODULE_PARM_DESC(poll_queues,
+	"Number of hw queues for polled I/O, completed without the IVC interrupt");
+#endif
+
 static inline uint64_t _arch_counter_get_cntvct(void)
 {
 	uint64_t cval;
@@ -136,6 +158,10 @@ static void vblk_put_req(struct vsc_request *req)
 			req->id);
 	} else {
 		clear_bit(req->id, vblkdev->pending_reqs);
+		if (req->ioctl_slot >= 0) {
+			clear_bit(req->ioctl_slot, vblkdev->ioctl_slots);
+			req->ioctl_slot = -1;
+		}
 		memset(&req->vs_req, 0, sizeof(struct vs_request));
 		req->req = NULL;
 		memset(&req->iter, 0, sizeof(struct req_iterator));
@@ -225,6 +251,24 @@ static int vblk_get_configinfo(struct vblk_dev *vblkdev)
 	return 0;
 }
 
+static void vblk_complete_rq(struct request *rq)
+{
+	struct req_entry *entry = blk_mq_rq_to_pdu(rq);
+
+	blk_mq_end_request(rq, entry->status);
+}
+
+/**
+ * vblk_end_request: Complete a block request on the CPU that submitted it.
+ */
+static void vblk_end_request(struct request *rq, blk_status_t status)
+{
+	struct req_entry *entry = blk_mq_rq_to_pdu(rq);
+
+	entry->status = status;
+	blk_mq_complete_request(rq);
+}
+
 static void req_error_handler(struct vblk_dev *vblkdev, struct request *breq)
 {
 	dev_err(vblkdev->device,
@@ -233,7 +277,39 @@ static void req_error_handler(struct vblk_dev *vblkdev, struct request *breq)
 		(uint64_t)req_op(breq),
 		blk_rq_bytes(breq));
 
-	blk_mq_end_request(breq, BLK_STS_IOERR);
+	vblk_end_request(breq, BLK_STS_IOERR);
+}
+
+static bool vblk_is_erase_op(struct request *rq)
+{
+	return (req_op(rq) == REQ_OP_DISCARD) ||
+		(req_op(rq) == REQ_OP_SECURE_ERASE);
+}
+
+/**
+ * vblk_end_merged: Complete the requests coalesced into a vsc request.
+ */
+static void vblk_end_merged(struct vsc_request *vsc_req, blk_status_t status)
+{
+	struct req_entry *entry, *tmp;
+
+	list_for_each_entry_safe(entry, tmp, &vsc_req->merged, list_entry) {
+		list_del_init(&entry->list_entry);
+		vblk_end_request(entry->req, status);
+	}
+	vsc_req->nr_merged = 0;
+}
+
+static void vblk_account_discard(struct vblk_dev *vblkdev,
+		struct vsc_request *vsc_req)
+{
+	struct vblk_discard_stats *stats = &vblkdev->discard_stats;
+
+	stats->cmds++;
+	stats->reqs += 1U + vsc_req->nr_merged;
+	stats->bytes += (uint64_t)vsc_req->vs_req.blkdev_req.blk_req.num_blks *
+		vblkdev->config.blk_config.hardblk_size;
+	stats->nsecs += ktime_get_ns() - vsc_req->start_ns;
 }
 
 static void handle_non_ioctl_resp(struct vblk_dev *vblkdev,
@@ -299,17 +375,20 @@ end:
 			dma_unmap_sg(vblkdev->device,
 				vsc_req->sg_lst,
 				vsc_req->sg_num_ents,
-				DMA_BIDIRECTIONAL);
-			devm_kfree(vblkdev->device, vsc_req->sg_lst);
+				rq_dma_dir(bio_req));
 		}
 	}
 
+	if (vblk_is_erase_op(bio_req))
+		vblk_account_discard(vblkdev, vsc_req);
+
 	if (!invoke_req_err_hand) {
-			blk_mq_end_request(bio_req, BLK_STS_OK);
+			vblk_end_request(bio_req, BLK_STS_OK);
 	} else {
 
 		req_error_handler(vblkdev, bio_req);
 	}
+	vblk_end_merged(vsc_req, invoke_req_err_hand ? BLK_STS_IOERR : BLK_STS_OK);
 }
 
 /**
@@ -369,7 +448,7 @@ static bool complete_bio_req(struct vblk_dev *vblkdev)
 					req_resp.blkdev_resp.
 					ioctl_resp.status);
 			vblkdev->inflight_ioctl_reqs--;
-			blk_mq_end_request(bio_req, BLK_STS_OK);
+			vblk_end_request(bio_req, BLK_STS_OK);
 		}  else if (req_op(bio_req) != REQ_OP_DRV_IN) {
 			handle_non_ioctl_resp(vblkdev, vsc_req,
 				&(req_resp.blkdev_resp.blk_resp));
@@ -381,16 +460,13 @@ static bool complete_bio_req(struct vblk_dev *vblkdev)
 		if (!(vblkdev->config.blk_config.req_ops_supported & VS_BLK_IOCTL_OP_F)
 			&& req_op(bio_req) == REQ_OP_DRV_IN) {
 			dev_info(vblkdev->device, "ioctl(pass through) command not supported\n");
-		} else {
-			if ((vblkdev->config.blk_config.req_ops_supported & VS_BLK_IOCTL_OP_F)
-				&& (req_op(bio_req) == REQ_OP_DRV_IN))
-				vblkdev->inflight_ioctl_reqs--;
-			req_error_handler(vblkdev, bio_req);
+		} else if (req_op(bio_req) == REQ_OP_DRV_IN) {
+			vblkdev->inflight_ioctl_reqs--;
 		}
 
-		if (req_op(bio_req) == REQ_OP_DRV_IN)
-			vblkdev->inflight_ioctl_reqs--;
+		/* A request can only be completed once */
 		req_error_handler(vblkdev, bio_req);
+		vblk_end_merged(vsc_req, BLK_STS_IOERR);
 	} else {
 		dev_err(vblkdev->device,
 			"VSC request %d has null bio request!\n",
@@ -470,6 +546,113 @@ static enum blk_cmd_op cleanup_op_supported(struct vblk_dev *vblkdev, uint32_t o
 	return cleanup_op;
 }
 
+/**
+ * vblk_sg_contiguous: Check that a mapped sg list is one IOVA range.
+ *
+ * The storage server only takes a single IOVA per request. The virt
+ * boundary of the queue makes the IOMMU lay the segments out back to back,
+ * this catches a device that is not behind an IOMMU.
+ */
+static bool vblk_sg_contiguous(struct scatterlist *sgl, int nents)
+{
+	struct scatterlist *sg;
+	dma_addr_t next = sg_dma_address(sgl);
+	int i;
+
+	for_each_sg(sgl, sg, nents, i) {
+		if (sg_dma_address(sg) != next)
+			return false;
+		next += sg_dma_len(sg);
+	}
+
+	return true;
+}
+
+/**
+ * vblk_get_ioctl_slot: Give an ioctl request its own part of the mempool.
+ *
+ * In IOVA mode only ioctls go through the mempool, which is split in
+ * max_ioctl_requests slots. The worker never has more ioctls in flight,
+ * so a slot is always free and concurrent commands do not share one.
+ */
+static int vblk_get_ioctl_slot(struct vblk_dev *vblkdev,
+			       struct vsc_request *vsc_req)
+{
+	unsigned long slot;
+
+	slot = find_first_zero_bit(vblkdev->ioctl_slots,
+				   vblkdev->max_ioctl_requests);
+	if (slot >= vblkdev->max_ioctl_requests)
+		return -EBUSY;
+
+	set_bit(slot, vblkdev->ioctl_slots);
+	vsc_req->ioctl_slot = slot;
+	vsc_req->mempool_offset = slot * UFS_IOCTL_MAX_SIZE_SUPPORTED;
+	vsc_req->mempool_virt = (void *)((uintptr_t)vblkdev->shared_buffer +
+					 vsc_req->mempool_offset);
+	vsc_req->mempool_len = UFS_IOCTL_MAX_SIZE_SUPPORTED;
+
+	return 0;
+}
+
+/**
+ * vblk_fetch_reqs: Move the requests queued by vblk_request() to the
+ * worker owned request list, keeping the submission order.
+ */
+static void vblk_fetch_reqs(struct vblk_dev *vblkdev)
+{
+	struct llist_node *node;
+	struct req_entry *entry, *tmp;
+
+	node = llist_reverse_order(llist_del_all(&vblkdev->req_llist));
+	llist_for_each_entry_safe(entry, tmp, node, llnode)
+		list_add_tail(&entry->list_entry, &vblkdev->req_list);
+}
+
+/**
+ * vblk_merge_discards: Coalesce the queued erase class requests that
+ * continue the range of @vsc_req into the same VSC command.
+ *
+ * The block layer does not merge requests of different hw queues, nor
+ * the ones that were already dispatched, fstrim keeps the list full of
+ * adjacent ranges.
+ */
+static void vblk_merge_discards(struct vblk_dev *vblkdev,
+		struct vsc_request *vsc_req)
+{
+	struct vs_blk_request *blk_req = &vsc_req->vs_req.blkdev_req.blk_req;
+	uint32_t hardblk_size = vblkdev->config.blk_config.hardblk_size;
+	struct request *bio_req = vsc_req->req;
+	sector_t next_pos = blk_rq_pos(bio_req) + blk_rq_sectors(bio_req);
+	struct req_entry *entry;
+	uint32_t num_blks;
+
+	if (list_empty(&vblkdev->req_list))
+		vblk_fetch_reqs(vblkdev);
+
+	while (!list_empty(&vblkdev->req_list)) {
+		entry = list_first_entry(&vblkdev->req_list, struct req_entry,
+						list_entry);
+		if ((req_op(entry->req) != req_op(bio_req)) ||
+				(blk_rq_pos(entry->req) != next_pos))
+			break;
+
+		num_blks = ((blk_rq_sectors(entry->req) * SECTOR_SIZE) /
+				hardblk_size);
+		if ((blk_req->num_blks + num_blks) >
+				vblkdev->config.blk_config.max_erase_blks_per_io)
+			break;
+
+		if (!bio_req_sanity_check(vblkdev, entry->req, vsc_req))
+			break;
+
+		list_move_tail(&entry->list_entry, &vsc_req->merged);
+		vsc_req->nr_merged++;
+		blk_req->num_blks += num_blks;
+		next_pos += blk_rq_sectors(entry->req);
+	}
+}
+
 /**
  * submit_bio_req: Fetch a bio request and submit it to
  * server for processing.
@@ -484,8 +667,9 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 	size_t total_size = 0;
 	void *buffer;
 	struct req_entry *entry = NULL;
-	size_t sz;
-	uint32_t sg_cnt;
+	int sg_cnt;
+	bool sg_mapped = false;
+	bool ioctl_prepped = false;
 	uint32_t ops_supported = vblkdev->config.blk_config.req_ops_supported;
 	dma_addr_t  sg_dma_addr = 0;
 
@@ -500,22 +684,22 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 	if (vsc_req == NULL)
 		goto bio_exit;
 
-	spin_lock(&vblkdev->queue_lock);
-	if(!list_empty(&vblkdev->req_list)) {
+	/* req_list is only touched by the worker, under ivc_lock */
+	if (list_empty(&vblkdev->req_list))
+		vblk_fetch_reqs(vblkdev);
+
+	if (!list_empty(&vblkdev->req_list)) {
 		entry = list_first_entry(&vblkdev->req_list, struct req_entry,
 						list_entry);
 		if ((vblkdev->config.blk_config.req_ops_supported & VS_BLK_IOCTL_OP_F) &&
 				(req_op(entry->req) == REQ_OP_DRV_IN) &&
 				(vblkdev->config.blk_config.use_vm_address) &&
 				(vblkdev->inflight_ioctl_reqs >= vblkdev->max_ioctl_requests)) {
-			spin_unlock(&vblkdev->queue_lock);
 			goto bio_exit;
 		}
-		list_del(&entry->list_entry);
+		list_del_init(&entry->list_entry);
 		bio_req = entry->req;
-		kfree(entry);
 	}
-	spin_unlock(&vblkdev->queue_lock);
 
 	if (bio_req == NULL)
 		goto bio_exit;
@@ -523,25 +707,24 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 	if ((vblkdev->config.blk_config.use_vm_address) &&
 		((req_op(bio_req) == REQ_OP_READ) ||
 		(req_op(bio_req) == REQ_OP_WRITE))) {
-		sz = (sizeof(struct scatterlist)
-			* bio_req->nr_phys_segments);
-		vsc_req->sg_lst =  devm_kzalloc(vblkdev->device, sz,
-					GFP_KERNEL);
-		if (vsc_req->sg_lst == NULL) {
-			dev_err(vblkdev->device,
-				"SG mem allocation failed\n");
-			goto bio_exit;
-		}
-		sg_init_table(vsc_req->sg_lst,
-			bio_req->nr_phys_segments);
-		sg_cnt = blk_rq_map_sg(vblkdev->queue, bio_req,
+		/* Zero copy, the server accesses the pages through its IOMMU */
+		sg_init_table(vsc_req->sg_lst, vblkdev->max_segments);
+		vsc_req->sg_num_ents = blk_rq_map_sg(vblkdev->queue, bio_req,
 				vsc_req->sg_lst);
-		vsc_req->sg_num_ents = sg_nents(vsc_req->sg_lst);
-		if (dma_map_sg(vblkdev->device, vsc_req->sg_lst,
-			vsc_req->sg_num_ents, DMA_BIDIRECTIONAL) == 0) {
+		sg_cnt = dma_map_sg(vblkdev->device, vsc_req->sg_lst,
+			vsc_req->sg_num_ents, rq_dma_dir(bio_req));
+		if (sg_cnt == 0) {
 			dev_err(vblkdev->device, "dma_map_sg failed\n");
 			goto bio_exit;
 		}
+		sg_mapped = true;
+
+		if (!vblk_sg_contiguous(vsc_req->sg_lst, sg_cnt)) {
+			dev_err(vblkdev->device,
+				"Request %d does not map to one IOVA range!\n",
+				vsc_req->id);
+			goto bio_exit;
+		}
 		sg_dma_addr = sg_dma_address(vsc_req->sg_lst);
 	}
 
@@ -597,6 +780,11 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 				SECTOR_SIZE) /
 				vblkdev->config.blk_config.hardblk_size);
 
+			if (vblk_is_erase_op(bio_req)) {
+				vsc_req->start_ns = ktime_get_ns();
+				vblk_merge_discards(vblkdev, vsc_req);
+			}
+
 			if (!vblkdev->config.blk_config.use_vm_address) {
 				vs_req->blkdev_req.blk_req.data_offset =
 							vsc_req->mempool_offset;
@@ -640,6 +828,13 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 			}
 		}
 	} else {
+		if ((vblkdev->config.blk_config.req_ops_supported & VS_BLK_IOCTL_OP_F) &&
+			(vblkdev->config.blk_config.use_vm_address) &&
+			vblk_get_ioctl_slot(vblkdev, vsc_req)) {
+			dev_err(vblkdev->device, "No mempool slot for ioctl!\n");
+			goto bio_exit;
+		}
+
 		if (vblkdev->config.blk_config.req_ops_supported & VS_BLK_IOCTL_OP_F
 			&& !vblk_prep_ioctl_req(vblkdev,
 #if defined(NV_REQUEST_STRUCT_HAS_COMPLETION_DATA_ARG) /* Removed in Linux v6.5 */
@@ -649,6 +844,7 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 #endif
 			vsc_req)) {
 			vblkdev->inflight_ioctl_reqs++;
+			ioctl_prepped = true;
 		} else if (!(vblkdev->config.blk_config.req_ops_supported & VS_BLK_IOCTL_OP_F)) {
 			dev_info(vblkdev->device, "ioctl(pass through) command not supported\n");
 			goto bio_exit;
@@ -671,6 +867,17 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 	return true;
 
 bio_exit:
+	if (vsc_req != NULL)
+		vblk_end_merged(vsc_req, BLK_STS_IOERR);
+
+	if (sg_mapped) {
+		dma_unmap_sg(vblkdev->device, vsc_req->sg_lst,
+			vsc_req->sg_num_ents, rq_dma_dir(bio_req));
+	}
+
+	if (ioctl_prepped)
+		vblkdev->inflight_ioctl_reqs--;
+
 	if (vsc_req != NULL) {
 		vblk_put_req(vsc_req);
 	}
@@ -683,57 +890,141 @@ bio_exit:
 	return false;
 }
 
+/**
+ * vblk_unmask_irq: Re-enable the IVC interrupt masked by ivc_irq_handler().
+ */
+static void vblk_unmask_irq(struct vblk_dev *vblkdev)
+{
+	if (atomic_cmpxchg(&vblkdev->irq_masked, 1, 0) == 1)
+		enable_irq(vblkdev->ivck->irq);
+}
+
 static void vblk_request_work(struct work_struct *ws)
 {
 	struct vblk_dev *vblkdev =
 		container_of(ws, struct vblk_dev, work);
+	unsigned int budget = max(READ_ONCE(complete_budget), 1U);
+	unsigned int completed = 0;
 	bool req_submitted, req_completed;
+	bool pending;
 
 	/* Taking ivc lock before performing IVC read/write */
 	mutex_lock(&vblkdev->ivc_lock);
 	if (tegra_hv_ivc_channel_notified(vblkdev->ivck) != 0) {
 		mutex_unlock(&vblkdev->ivc_lock);
+		vblk_unmask_irq(vblkdev);
 		return;
 	}
 
+	/* the server need not ring the doorbell while we are draining */
+	tegra_hv_ivc_notify_suppress(vblkdev->ivck);
+
 	req_submitted = true;
 	req_completed = true;
 	while (req_submitted || req_completed) {
-		req_completed = complete_bio_req(vblkdev);
+		req_completed = false;
+		if (completed < budget) {
+			req_completed = complete_bio_req(vblkdev);
+			if (req_completed)
+				completed++;
+		}
 
 		req_submitted = submit_bio_req(vblkdev);
 	}
+	pending = tegra_hv_ivc_can_read(vblkdev->ivck) ||
+		  tegra_hv_ivc_notify_enable(vblkdev->ivck);
 	mutex_unlock(&vblkdev->ivc_lock);
+
+	/*
+	 * Out of budget, let other work run and come back with the interrupt
+	 * still masked. A notification raised while it is masked is replayed
+	 * when it gets enabled again.
+	 */
+	if (pending)
+		queue_work_on(WORK_CPU_UNBOUND, vblkdev->wq, &vblkdev->work);
+	else
+		vblk_unmask_irq(vblkdev);
+}
+
+#if defined(NV_BLK_MQ_OPS_STRUCT_POLL_HAS_IO_COMP_BATCH_ARG) /* Linux v5.16 */
+/**
+ * vblk_poll: Drain IVC responses for polled I/O.
+ *
+ * All hw queues share the IVC channel, so this completes whatever response
+ * is there, not only the ones of @hctx.
+ */
+static int vblk_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
+{
+	struct vblk_dev *vblkdev = hctx->queue->queuedata;
+	unsigned int budget = max(READ_ONCE(complete_budget), 1U);
+	unsigned int found = 0;
+
+	/* The worker is at it already */
+	if (!mutex_trylock(&vblkdev->ivc_lock))
+		return 0;
+
+	if (tegra_hv_ivc_channel_notified(vblkdev->ivck) == 0) {
+		while ((found < budget) && complete_bio_req(vblkdev))
+			found++;
+
+		/* Use the vsc requests that were just freed */
+		while (submit_bio_req(vblkdev))
+			;
+	}
+	mutex_unlock(&vblkdev->ivc_lock);
+
+	return found;
 }
 
+#if defined(NV_BLK_MQ_OPS_STRUCT_MAP_QUEUES_HAS_INT_RETURN_TYPE) /* Removed in Linux v6.1 */
+static int vblk_map_queues(struct blk_mq_tag_set *set)
+#else
+static void vblk_map_queues(struct blk_mq_tag_set *set)
+#endif
+{
+	struct vblk_dev *vblkdev = set->driver_data;
+	struct blk_mq_queue_map *map;
+
+	map = &set->map[HCTX_TYPE_DEFAULT];
+	map->nr_queues = set->nr_hw_queues - vblkdev->poll_queues;
+	map->queue_offset = 0;
+	blk_mq_map_queues(map);
+
+	if (vblkdev->poll_queues != 0U) {
+		map = &set->map[HCTX_TYPE_POLL];
+		map->nr_queues = vblkdev->poll_queues;
+		map->queue_offset = set->map[HCTX_TYPE_DEFAULT].nr_queues;
+		blk_mq_map_queues(map);
+	}
+
+#if defined(NV_BLK_MQ_OPS_STRUCT_MAP_QUEUES_HAS_INT_RETURN_TYPE)
+	return 0;
+#endif
+}
+#endif
+
 /* The simple form of the request function. */
 static blk_status_t vblk_request(struct blk_mq_hw_ctx *hctx,
 			const struct blk_mq_queue_data *bd)
 {
-	struct req_entry *entry;
 	struct request *req = bd->rq;
+	struct req_entry *entry = blk_mq_rq_to_pdu(req);
 	struct vblk_dev *vblkdev = hctx->queue->queuedata;
 
 	blk_mq_start_request(req);
 
-	/* malloc for req list entry */
-	entry = kmalloc(sizeof(struct req_entry), GFP_ATOMIC);
-	if (entry == NULL) {
-		dev_err(vblkdev->device, "Failed to allocate memory\n");
-		return BLK_STS_IOERR;
-	}
-
 	/* Initialise the entry */
 	entry->req = req;
+	entry->status = BLK_STS_OK;
 	INIT_LIST_HEAD(&entry->list_entry);
 
-	/* Insert the req to list */
-	spin_lock(&vblkdev->queue_lock);
-	list_add_tail(&entry->list_entry, &vblkdev->req_list);
-	spin_unlock(&vblkdev->queue_lock);
-
-	/* Now invoke the queue to handle data inserted in queue */
-	queue_work_on(WORK_CPU_UNBOUND, vblkdev->wq, &vblkdev->work);
+	/*
+	 * Hand the req to the IVC worker. Only the hw queue that finds the
+	 * list empty has to kick the worker, as the later ones are picked up
+	 * by the same run.
+	 */
+	if (llist_add(&entry->llnode, &vblkdev->req_llist))
+		queue_work_on(WORK_CPU_UNBOUND, vblkdev->wq, &vblkdev->work);
 
 	return BLK_STS_OK;
 }
@@ -874,6 +1165,23 @@ vblk_speed_mode_show(struct device *dev, struct device_attribute *attr,
 	return snprintf(buf, 32, "%s\n", vblk->config.speed_mode);
 }
 
+/* commands, requests, bytes, busy nsecs of discard and erase commands */
+static ssize_t
+vblk_discard_stats_show(struct device *dev, struct device_attribute *attr,
+			 char *buf)
+{
+	struct gendisk *disk = dev_to_disk(dev);
+	struct vblk_dev *vblk = disk->private_data;
+	struct vblk_discard_stats stats;
+
+	mutex_lock(&vblk->ivc_lock);
+	stats = vblk->discard_stats;
+	mutex_unlock(&vblk->ivc_lock);
+
+	return snprintf(buf, PAGE_SIZE, "%llu %llu %llu %llu\n",
+			stats.cmds, stats.reqs, stats.bytes, stats.nsecs);
+}
+
 static const struct device_attribute dev_attr_phys_dev_ro =
 	__ATTR(phys_dev, 0444,
 	       vblk_phys_dev_show, NULL);
@@ -890,8 +1198,17 @@ static const struct device_attribute dev_attr_speed_mode_ro =
 	__ATTR(speed_mode, 0444,
 	       vblk_speed_mode_show, NULL);
 
+static const struct device_attribute dev_attr_discard_stats_ro =
+	__ATTR(discard_stats, 0444,
+	       vblk_discard_stats_show, NULL);
+
 static const struct blk_mq_ops vblk_mq_ops = {
 	.queue_rq	= vblk_request,
+	.complete	= vblk_complete_rq,
+#if defined(NV_BLK_MQ_OPS_STRUCT_POLL_HAS_IO_COMP_BATCH_ARG) /* Linux v5.16 */
+	.poll		= vblk_poll,
+	.map_queues	= vblk_map_queues,
+#endif
 };
 
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
@@ -972,9 +1289,13 @@ static void setup_device(struct vblk_dev *vblkdev)
 	uint32_t req_id;
 	uint32_t max_requests;
 	uint32_t max_ioctl_requests = 0U;
+	uint32_t max_segments = BLK_MAX_SEGMENTS;
 	struct vsc_request *req;
 	int ret;
 	struct tegra_hv_ivm_cookie *ivmk;
+#if defined(NV_BLK_MQ_ALLOC_QUEUE_PRESENT)
+	struct queue_limits lim = { };
+#endif
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
 	int err;
 #endif
@@ -983,40 +1304,6 @@ static void setup_device(struct vblk_dev *vblkdev)
 		vblkdev->config.blk_config.num_blks *
 			vblkdev->config.blk_config.hardblk_size;
 
-	memset(&vblkdev->tag_set, 0, sizeof(vblkdev->tag_set));
-	vblkdev->tag_set.ops = &vblk_mq_ops;
-	vblkdev->tag_set.nr_hw_queues = 1;
-	vblkdev->tag_set.nr_maps = 1;
-	vblkdev->tag_set.queue_depth = 16;
-	vblkdev->tag_set.numa_node = NUMA_NO_NODE;
-	vblkdev->tag_set.flags = BLK_MQ_F_SHOULD_MERGE;
-
-	ret = blk_mq_alloc_tag_set(&vblkdev->tag_set);
-	if (ret)
-		return;
-
-#if defined(NV_BLK_MQ_ALLOC_QUEUE_PRESENT)
-	vblkdev->queue = blk_mq_alloc_queue(&vblkdev->tag_set, NULL, NULL);
-#else
-	vblkdev->queue = blk_mq_init_queue(&vblkdev->tag_set);
-#endif
-	if (IS_ERR(vblkdev->queue)) {
-		dev_err(vblkdev->device, "failed to init blk queue\n");
-		blk_mq_free_tag_set(&vblkdev->tag_set);
-		return;
-	}
-
-	vblkdev->queue->queuedata = vblkdev;
-
-	blk_queue_logical_block_size(vblkdev->queue,
-		vblkdev->config.blk_config.hardblk_size);
-	blk_queue_physical_block_size(vblkdev->queue,
-		vblkdev->config.blk_config.hardblk_size);
-
-	if (vblkdev->config.blk_config.req_ops_supported & VS_BLK_FLUSH_OP_F) {
-		blk_queue_write_cache(vblkdev->queue, true, false);
-	}
-
 	if (vblkdev->config.blk_config.max_read_blks_per_io !=
 		vblkdev->config.blk_config.max_write_blks_per_io) {
 		dev_err(vblkdev->device,
@@ -1033,6 +1320,23 @@ static void setup_device(struct vblk_dev *vblkdev)
 		return;
 	}
 
+	if ((max_sectors_kb != 0U) && ((max_io_bytes / SZ_1K) > max_sectors_kb)) {
+		max_io_bytes = rounddown(max_sectors_kb * SZ_1K,
+				vblkdev->config.blk_config.hardblk_size);
+		if (max_io_bytes == 0)
+			max_io_bytes = vblkdev->config.blk_config.hardblk_size;
+	}
+
+	/*
+	 * In IOVA mode the pages of a request are handed to the server as is,
+	 * page aligned segments cover max_io_bytes plus an unaligned head.
+	 */
+	if (vblkdev->config.blk_config.use_vm_address == 1U) {
+		max_segments = DIV_ROUND_UP(max_io_bytes, PAGE_SIZE) + 1U;
+		if ((iova_max_segments != 0U) && (iova_max_segments < max_segments))
+			max_segments = iova_max_segments;
+	}
+
 	/* reserve mempool for eMMC device and for ufs device
 	 * with pass through support
 	 */
@@ -1078,6 +1382,10 @@ static void setup_device(struct vblk_dev *vblkdev)
 		}
 	} else {
 		max_requests = ((vblkdev->ivmk->size) / max_io_bytes);
+		/* smaller I/Os must not outnumber the IVC frames */
+		if (max_sectors_kb != 0U)
+			max_requests = min_t(uint32_t, max_requests,
+					     vblkdev->ivck->nframes);
 		max_ioctl_requests = max_requests;
 	}
 
@@ -1144,16 +1452,22 @@ static void setup_device(struct vblk_dev *vblkdev)
 			req->mempool_virt = (void *)((uintptr_t)vblkdev->shared_buffer +
 				(uintptr_t)(req_id * max_io_bytes));
 			req->mempool_offset = (req_id * max_io_bytes);
-		} else {
-			if (vblkdev->config.blk_config.req_ops_supported & VS_BLK_IOCTL_OP_F) {
-				req->mempool_virt = (void *)((uintptr_t)vblkdev->shared_buffer +
-				(uintptr_t)((req_id % max_ioctl_requests) * UFS_IOCTL_MAX_SIZE_SUPPORTED));
-				req->mempool_offset = (req_id % max_ioctl_requests) * UFS_IOCTL_MAX_SIZE_SUPPORTED;
-			}
+			req->mempool_len = max_io_bytes;
 		}
-		req->mempool_len = max_io_bytes;
+		/* IOVA mode ioctls get a mempool slot in vblk_get_ioctl_slot() */
+		req->ioctl_slot = -1;
 		req->id = req_id;
 		req->vblkdev = vblkdev;
+		INIT_LIST_HEAD(&req->merged);
+
+		if (vblkdev->config.blk_config.use_vm_address == 1U) {
+			req->sg_lst = devm_kcalloc(vblkdev->device, max_segments,
+					sizeof(struct scatterlist), GFP_KERNEL);
+			if (req->sg_lst == NULL) {
+				dev_err(vblkdev->device, "SG mem allocation failed\n");
+				return;
+			}
+		}
 	}
 
 	if (max_requests == 0) {
@@ -1164,8 +1478,69 @@ static void setup_device(struct vblk_dev *vblkdev)
 
 	vblkdev->max_requests = max_requests;
 	vblkdev->max_ioctl_requests = max_ioctl_requests;
+	vblkdev->max_segments = max_segments;
+
+	/*
+	 * Every hw queue feeds the same IVC channel, so there is no point in
+	 * having more of them than requests the server can take. The depth
+	 * matches the number of vsc requests, which is what the IVC frames
+	 * and the mempool can hold in flight.
+	 */
+	memset(&vblkdev->tag_set, 0, sizeof(vblkdev->tag_set));
+	vblkdev->tag_set.ops = &vblk_mq_ops;
+	vblkdev->tag_set.nr_hw_queues = min_t(unsigned int, num_online_cpus(),
+					      max_requests);
+	vblkdev->tag_set.nr_maps = 1;
+#if defined(NV_BLK_MQ_OPS_STRUCT_POLL_HAS_IO_COMP_BATCH_ARG) /* Linux v5.16 */
+	vblkdev->poll_queues = min(poll_queues, num_online_cpus());
+	if (vblkdev->poll_queues != 0U) {
+		vblkdev->tag_set.nr_hw_queues += vblkdev->poll_queues;
+		vblkdev->tag_set.nr_maps = HCTX_MAX_TYPES;
+	}
+#endif
+	vblkdev->tag_set.driver_data = vblkdev;
+	vblkdev->tag_set.queue_depth = max_requests;
+	vblkdev->tag_set.cmd_size = sizeof(struct req_entry);
+	vblkdev->tag_set.numa_node = NUMA_NO_NODE;
+	vblkdev->tag_set.flags = BLK_MQ_F_SHOULD_MERGE;
+
+	ret = blk_mq_alloc_tag_set(&vblkdev->tag_set);
+	if (ret)
+		return;
+
+#if defined(NV_BLK_MQ_ALLOC_QUEUE_PRESENT)
+	lim.max_hw_sectors = max_io_bytes / SECTOR_SIZE;
+	lim.max_segments = max_segments;
+	if (vblkdev->config.blk_config.use_vm_address == 1U)
+		lim.virt_boundary_mask = PAGE_SIZE - 1;
+	vblkdev->queue = blk_mq_alloc_queue(&vblkdev->tag_set, &lim, NULL);
+#else
+	vblkdev->queue = blk_mq_init_queue(&vblkdev->tag_set);
+#endif
+	if (IS_ERR(vblkdev->queue)) {
+		dev_err(vblkdev->device, "failed to init blk queue\n");
+		vblkdev->queue = NULL;
+		blk_mq_free_tag_set(&vblkdev->tag_set);
+		return;
+	}
+
+	vblkdev->queue->queuedata = vblkdev;
+
+	blk_queue_logical_block_size(vblkdev->queue,
+		vblkdev->config.blk_config.hardblk_size);
+	blk_queue_physical_block_size(vblkdev->queue,
+		vblkdev->config.blk_config.hardblk_size);
+
+	if (vblkdev->config.blk_config.req_ops_supported & VS_BLK_FLUSH_OP_F) {
+		blk_queue_write_cache(vblkdev->queue, true, false);
+	}
+
 #if defined(NV_BLK_QUEUE_MAX_HW_SECTORS_PRESENT) /* Removed in Linux v6.10 */
 	blk_queue_max_hw_sectors(vblkdev->queue, max_io_bytes / SECTOR_SIZE);
+	/* Removed along with blk_queue_max_hw_sectors() */
+	blk_queue_max_segments(vblkdev->queue, max_segments);
+	if (vblkdev->config.blk_config.use_vm_address == 1U)
+		blk_queue_virt_boundary(vblkdev->queue, PAGE_SIZE - 1);
 #endif
 	blk_queue_flag_set(QUEUE_FLAG_NONROT, vblkdev->queue);
 
@@ -1188,8 +1563,11 @@ static void setup_device(struct vblk_dev *vblkdev)
 		 */
 		blk_queue_flag_set(QUEUE_FLAG_DISCARD, vblkdev->queue);
 #endif
+		/* max_erase_blks_per_io is in hardblk_size units */
 		blk_queue_max_discard_sectors(vblkdev->queue,
-			vblkdev->config.blk_config.max_erase_blks_per_io);
+			min_t(uint64_t, UINT_MAX,
+			      ((uint64_t)vblkdev->config.blk_config.max_erase_blks_per_io *
+			       vblkdev->config.blk_config.hardblk_size) / SECTOR_SIZE));
 		vblkdev->queue->limits.discard_granularity =
 			vblkdev->config.blk_config.hardblk_size;
 	}
@@ -1280,6 +1658,12 @@ static void setup_device(struct vblk_dev *vblkdev)
 		return;
 	}
 
+	if (device_create_file(disk_to_dev(vblkdev->gd),
+		&dev_attr_discard_stats_ro)) {
+		dev_warn(vblkdev->device, "Error adding discard_stats file!\n");
+		return;
+	}
+
 
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
 	if (vblkdev->config.phys_dev == VSC_DEV_EMMC) {
@@ -1327,9 +1711,15 @@ static irqreturn_t ivc_irq_handler(int irq, void *data)
 {
 	struct vblk_dev *vblkdev = (struct vblk_dev *)data;
 
-	if (vblkdev->initialized)
+	if (vblkdev->initialized) {
+		/*
+		 * Like NAPI, no more interrupts until the worker has drained
+		 * the IVC, it picks up everything that arrives meanwhile.
+		 */
+		if (atomic_cmpxchg(&vblkdev->irq_masked, 0, 1) == 0)
+			disable_irq_nosync(irq);
 		queue_work_on(WORK_CPU_UNBOUND, vblkdev->wq, &vblkdev->work);
-	else
+	} else
 		schedule_work(&vblkdev->init);
 
 	return IRQ_HANDLED;
@@ -1425,13 +1815,12 @@ static int tegra_hv_vblk_probe(struct platform_device *pdev)
 	vblkdev->queue_state = VBLK_QUEUE_ACTIVE;
 
 	spin_lock_init(&vblkdev->lock);
-	spin_lock_init(&vblkdev->queue_lock);
-	mutex_init(&vblkdev->ioctl_lock);
 	mutex_init(&vblkdev->ivc_lock);
 
 	INIT_WORK(&vblkdev->init, vblk_init_device);
 	INIT_WORK(&vblkdev->work, vblk_request_work);
 	/* creating and initializing the an internal request list */
+	init_llist_head(&vblkdev->req_llist);
 	INIT_LIST_HEAD(&vblkdev->req_list);
 
 	/* Create timers for each request going to storage server*/
@@ -9,6 +9,7 @@
 #include <linux/blkdev.h>
 #include <linux/blk-mq.h>
 #include <linux/bio.h>
+#include <linux/llist.h>
 #include <soc/tegra/ivc-priv.h>
 #include <soc/tegra/ivc_ext.h>
 #include <soc/tegra/virt/hv-ivc.h>
@@ -32,12 +33,18 @@ struct vblk_ioctl_req {
 	uint32_t ioctl_id;
 	void *ioctl_buf;
 	uint32_t ioctl_len;
+	/* Head of ioctl_buf sent to / read back from the server, 0 is all */
+	uint32_t copy_in_len;
+	uint32_t copy_out_len;
 	int32_t status;
 };
 
+/* blk-mq per request data */
 struct req_entry {
+	struct llist_node llnode;
 	struct list_head list_entry;
 	struct request *req;
+	blk_status_t status;
 };
 
 struct vsc_request {
@@ -53,9 +60,22 @@ struct vsc_request {
 	/* Scatter list for maping IOVA address */
 	struct scatterlist *sg_lst;
 	int sg_num_ents;
+	/* Mempool slot of an ioctl in IOVA mode, -1 if none */
+	int ioctl_slot;
 	/* Timer to track bio request completion*/
 	struct timer_list timer;
 	uint64_t time;
+	/* Adjacent erase class requests sent in the same command */
+	struct list_head merged;
+	uint32_t nr_merged;
+	u64 start_ns;
+};
+
+struct vblk_discard_stats {
+	u64 cmds;
+	u64 reqs;
+	u64 bytes;
+	u64 nsecs;
 };
 
 enum vblk_queue_state {
@@ -76,7 +96,8 @@ struct vblk_dev {
 	struct request_queue *queue;     /* The device request queue */
 	struct gendisk *gd;              /* The gendisk structure */
 	struct blk_mq_tag_set tag_set;
-	struct list_head req_list;	/* List containing req */
+	struct llist_head req_llist;	/* Requests queued by queue_rq */
+	struct list_head req_list;	/* Requests owned by the IVC worker */
 	uint32_t ivc_id;
 	uint32_t ivm_id;
 	struct tegra_hv_ivc_cookie *ivck;
@@ -88,14 +109,17 @@ struct vblk_dev {
 	struct workqueue_struct *wq;
 	struct device *device;
 	void *shared_buffer;
-	struct mutex ioctl_lock;
-	spinlock_t queue_lock;
 	struct vsc_request reqs[MAX_VSC_REQS];
 	DECLARE_BITMAP(pending_reqs, MAX_VSC_REQS);
+	DECLARE_BITMAP(ioctl_slots, MAX_VSC_REQS);	/* under ivc_lock */
 	uint32_t inflight_reqs;
 	uint32_t inflight_ioctl_reqs;
 	uint32_t max_requests;
 	uint32_t max_ioctl_requests;
+	uint32_t max_segments;		/* sg_lst entries of a vsc request */
+	uint32_t poll_queues;		/* hw queues of HCTX_TYPE_POLL */
+	atomic_t irq_masked;		/* IVC irq off while the worker drains */
+	struct vblk_discard_stats discard_stats;	/* under ivc_lock */
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
 	uint32_t epl_id;
 	uint32_t epl_reporter_id;
@@ -1917,6 +1917,7 @@ static void __exit btusb_exit(void)
 {
 	RTKBT_DBG("rtk_btusb: btusb_exit");
 	usb_deregister(&btusb_driver);
+	rtk_fw_cache_free();
 
 #ifdef BTCOEX
 	rtk_btcoex_exit();
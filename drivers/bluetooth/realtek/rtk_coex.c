@@ -70,6 +70,71 @@ static void count_a2dp_packet_timeout(struct work_struct *work);
 static void count_pan_packet_timeout(struct work_struct *work);
 static void count_hogp_packet_timeout(struct work_struct *work);
 
+/* Profile connect and busy/idle changes reported to the firmware */
+static unsigned int profile_updates[profile_max];
+
+static const char * const profile_names[profile_max] = {
+	[profile_sco] = "sco",
+	[profile_hid] = "hid",
+	[profile_a2dp] = "a2dp",
+	[profile_pan] = "pan",
+	[profile_hid_interval] = "hid_interval",
+	[profile_hogp] = "hogp",
+	[profile_voice] = "voice",
+	[profile_sink] = "sink",
+};
+
+static int profile_updates_get(char *buffer, const struct kernel_param *kp)
+{
+	int len = 0;
+	int i;
+
+	for (i = 0; i < profile_max; i++)
+		len += scnprintf(buffer + len, PAGE_SIZE - len, "%s %u\n",
+				 profile_names[i], READ_ONCE(profile_updates[i]));
+
+	return len;
+}
+
+static const struct kernel_param_ops profile_updates_ops = {
+	.get = profile_updates_get,
+};
+module_param_cb(profile_updates, &profile_updates_ops, NULL, 0444);
+MODULE_PARM_DESC(profile_updates, "Coex updates sent per profile");
+
+#define COUNT_PERIOD	round_jiffies_relative(msecs_to_jiffies(1000))
+
+/*
+ * The packet count works stop once their profile went idle and restart
+ * with the next packet or busy report, so an idle link does not wake the
+ * CPU every second.
+ */
+static void rtk_count_work_kick(rtk_conn_prof *phci_conn, uint8_t profile_index)
+{
+	struct delayed_work *work;
+
+	switch (profile_index) {
+	case profile_a2dp:
+		work = &phci_conn->a2dp_count_work;
+		break;
+	case profile_pan:
+		work = &phci_conn->pan_count_work;
+		break;
+	case profile_hogp:
+	case profile_voice:
+		work = &phci_conn->hogp_count_work;
+		break;
+	default:
+		return;
+	}
+
+	if (!(phci_conn->profile_bitmap & BIT(profile_index)))
+		return;
+
+	/* no-op while it is pending */
+	queue_delayed_work(btrtl_coex.timer_wq, work, COUNT_PERIOD);
+}
+
 static int rtl_alloc_buff(struct rtl_coex_struct *coex)
 {
 	struct rtl_hci_ev *ev;
@@ -275,7 +340,7 @@ static rtk_prof_info *find_by_psm(u16 handle, u16 psm)
 
 static void rtk_check_setup_timer(rtk_conn_prof * phci_conn, uint8_t profile_index)
 {
-	int delay = msecs_to_jiffies(1000);
+	int delay = COUNT_PERIOD;
 	if (profile_index == profile_a2dp) {
 		phci_conn->a2dp_packet_count = 0;
 		queue_delayed_work(btrtl_coex.timer_wq, &phci_conn->a2dp_count_work, delay);
@@ -708,6 +773,9 @@ static void update_profile_state(rtk_conn_prof * phci_conn,
 				__func__, btrtl_coex.profile_bitmap);
 		RTKBT_DBG("%s: btrtl_coex.profile_status 0x%02x,  phci_conn->profile_status 0x%02x",
 			 	__func__, btrtl_coex.profile_status, phci_conn->profile_status);
+		profile_updates[profile_index]++;
+		if (is_busy)
+			rtk_count_work_kick(phci_conn, profile_index);
 		rtk_notify_profileinfo_to_fw();
 	}
 }
@@ -783,8 +851,10 @@ static void update_profile_connection(rtk_conn_prof * phci_conn,
 				__func__, kk,
 				btrtl_coex.profile_refcount[kk]);
 
-	if (need_update)
+	if (need_update) {
+		profile_updates[profile_index]++;
 		rtk_notify_profileinfo_to_fw();
+	}
 }
 
 static void update_hid_active_state(uint16_t handle, uint16_t interval)
@@ -1049,8 +1119,11 @@ static void packets_count(uint16_t handle, uint16_t scid, uint16_t length,
 			hci_conn->a2dp_packet_count++;
 		}
 
-		if (prof_info->profile_index == profile_pan)
-			hci_conn->pan_packet_count++;
+		if (prof_info->profile_index == profile_pan) {
+			/* the count work decides when pan turns busy */
+			if (!hci_conn->pan_packet_count++)
+				rtk_count_work_kick(hci_conn, profile_pan);
+		}
 	}
 }
 
@@ -1071,7 +1144,9 @@ static void count_a2dp_packet_timeout(struct work_struct *work)
 	}
 	hci_conn->a2dp_packet_count = 0;
 
-	queue_delayed_work(btrtl_coex.timer_wq, &hci_conn->a2dp_count_work, msecs_to_jiffies(1000));
+	if (is_profile_busy(hci_conn, profile_a2dp))
+		queue_delayed_work(btrtl_coex.timer_wq,
+				   &hci_conn->a2dp_count_work, COUNT_PERIOD);
 }
 
 static void count_pan_packet_timeout(struct work_struct *work)
@@ -1092,8 +1167,11 @@ static void count_pan_packet_timeout(struct work_struct *work)
 			update_profile_state(hci_conn, profile_pan, TRUE);
 		}
 	}
+	/* an idle pan with no traffic is restarted by packets_count() */
+	if (hci_conn->pan_packet_count || is_profile_busy(hci_conn, profile_pan))
+		queue_delayed_work(btrtl_coex.timer_wq,
+				   &hci_conn->pan_count_work, COUNT_PERIOD);
 	hci_conn->pan_packet_count = 0;
-	queue_delayed_work(btrtl_coex.timer_wq, &hci_conn->pan_count_work, msecs_to_jiffies(1000));
 }
 
 static void count_hogp_packet_timeout(struct work_struct *work)
@@ -1121,7 +1199,11 @@ static void count_hogp_packet_timeout(struct work_struct *work)
 		}
 	}
 	hci_conn->voice_packet_count = 0;
-	queue_delayed_work(btrtl_coex.timer_wq, &hci_conn->hogp_count_work, msecs_to_jiffies(1000));
+
+	if (is_profile_busy(hci_conn, profile_hogp) ||
+	    is_profile_busy(hci_conn, profile_voice))
+		queue_delayed_work(btrtl_coex.timer_wq,
+				   &hci_conn->hogp_count_work, COUNT_PERIOD);
 }
 
 #ifdef RTB_SOFTWARE_MAILBOX
@@ -2698,13 +2780,15 @@ static void polling_bt_info(unsigned long data)
 {
 	uint8_t temp_cmd[1];
 	RTKBT_DBG("polling timer");
-	if (btrtl_coex.polling_enable) {
+	/* without a link there is nothing new to report to wifi */
+	if (btrtl_coex.polling_enable && !list_empty(&btrtl_coex.conn_hash)) {
 		//temp_cmd[0] = HCI_VENDOR_SUB_CMD_BT_REPORT_CONN_SCO_INQ_INFO;
 		temp_cmd[0] = HCI_VENDOR_SUB_CMD_BT_AUTO_REPORT_STATUS_INFO;
 		rtk_vendor_cmd_to_fw(HCI_VENDOR_MAILBOX_CMD, 1, temp_cmd);
 	}
 	mod_timer(&btrtl_coex.polling_timer,
-		  jiffies + msecs_to_jiffies(1000 * btrtl_coex.polling_interval));
+		  round_jiffies(jiffies +
+				msecs_to_jiffies(1000 * btrtl_coex.polling_interval)));
 }
 
 static void rtk_handle_bt_info_control(uint8_t *p)
@@ -47,6 +47,8 @@
 
 #include <linux/file.h>
 #include <linux/ctype.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
 #define BDADDR_STRING_LEN	17
 #define BDADDR_FILE		"/opt/bdaddr"
 
@@ -66,6 +68,8 @@ static struct list_head list_extracfgs;
 #define PKT_LEN			    300
 #define MSG_TO			    1000	//us
 #define PATCH_SEG_MAX	    252
+/* Upper bound on download segments outstanding at the controller */
+#define PATCH_SEG_INFLIGHT_MAX	    4
 #define DATA_END		    0x80
 #define DOWNLOAD_OPCODE	    0xfc20
 /* This command is used only for TV patch
@@ -234,6 +238,7 @@ typedef struct {
 	struct usb_interface *intf;
 	struct usb_device *udev;
 	patch_info *patch_entry;
+	int fw_key_id;
 } dev_data;
 
 typedef struct {
@@ -277,6 +282,23 @@ struct rtk_bt_vendor_config {
 static uint8_t gEVersion = 0xFF;
 static uint8_t g_key_id = 0;
 
+/* Patch images (patch + config) already built, reused on later downloads */
+struct rtk_fw_cache_entry {
+	struct list_head list;
+	patch_info *patch_entry;
+	uint8_t eversion;
+	int key_id;
+	uint8_t *data;
+	int len;
+};
+
+static LIST_HEAD(fw_cache_list);
+static DEFINE_MUTEX(fw_cache_lock);
+
+static bool fw_cache = true;
+module_param(fw_cache, bool, 0644);
+MODULE_PARM_DESC(fw_cache, "Reuse the built firmware patch across downloads");
+
 static dev_data *dev_data_find(struct usb_interface *intf);
 static patch_info *get_patch_entry(struct usb_device *udev);
 static int load_firmware(dev_data * dev_entry, uint8_t ** buff);
@@ -709,6 +731,87 @@ void patch_remove(struct usb_interface *intf)
 	kfree(dev_entry);
 }
 
+/* Returns a copy of the cached image for this controller, or 0 if none */
+static int rtk_fw_cache_get(dev_data *dev_entry, uint8_t **buff)
+{
+	struct rtk_fw_cache_entry *entry;
+	uint8_t eversion = 0xFF;
+	int len = 0;
+
+	if (!fw_cache)
+		return 0;
+
+	if (dev_entry->patch_entry->lmp_sub != ROM_LMP_8723a) {
+		eversion = rtk_get_eversion(dev_entry);
+		if (eversion == 0xFE)
+			return 0;
+		gEVersion = eversion;
+	}
+
+	mutex_lock(&fw_cache_lock);
+	list_for_each_entry(entry, &fw_cache_list, list) {
+		if (entry->patch_entry != dev_entry->patch_entry ||
+		    entry->eversion != eversion)
+			continue;
+
+		/* The image of a signed patch depends on the chip key */
+		if (entry->key_id >= 0 &&
+		    rtk_vendor_read(dev_entry, READ_SEC_PROJ) != entry->key_id)
+			continue;
+
+		*buff = kmemdup(entry->data, entry->len, GFP_KERNEL);
+		if (*buff)
+			len = entry->len;
+		break;
+	}
+	mutex_unlock(&fw_cache_lock);
+
+	return len;
+}
+
+static void rtk_fw_cache_put(dev_data *dev_entry, uint8_t *buf, int len)
+{
+	struct rtk_fw_cache_entry *entry;
+	uint8_t eversion = 0xFF;
+
+	if (!fw_cache)
+		return;
+
+	if (dev_entry->patch_entry->lmp_sub != ROM_LMP_8723a)
+		eversion = gEVersion;
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return;
+
+	entry->data = kmemdup(buf, len, GFP_KERNEL);
+	if (!entry->data) {
+		kfree(entry);
+		return;
+	}
+	entry->patch_entry = dev_entry->patch_entry;
+	entry->eversion = eversion;
+	entry->key_id = dev_entry->fw_key_id;
+	entry->len = len;
+
+	mutex_lock(&fw_cache_lock);
+	list_add(&entry->list, &fw_cache_list);
+	mutex_unlock(&fw_cache_lock);
+}
+
+void rtk_fw_cache_free(void)
+{
+	struct rtk_fw_cache_entry *entry, *tmp;
+
+	mutex_lock(&fw_cache_lock);
+	list_for_each_entry_safe(entry, tmp, &fw_cache_list, list) {
+		list_del(&entry->list);
+		kfree(entry->data);
+		kfree(entry);
+	}
+	mutex_unlock(&fw_cache_lock);
+}
+
 static int send_reset_command(xchange_data *xdata)
 {
 	int ret_val;
@@ -814,8 +917,11 @@ int download_patch(struct usb_interface *intf)
 	uint8_t *fw_buf;
 	int ret_val;
 	int max_patch_size = 0;
+	bool cached = false;
+	ktime_t start, dl_start;
 
 	RTKBT_DBG("download_patch start");
+	start = ktime_get();
 	dev_entry = dev_data_find(intf);
 	if (NULL == dev_entry) {
 		ret_val = -1;
@@ -836,11 +942,16 @@ int download_patch(struct usb_interface *intf)
 	if (ret_val != 0 )
 		goto patch_end;
 
-	xdata->fw_len = load_firmware(dev_entry, &xdata->fw_data);
-	if (xdata->fw_len <= 0) {
-		RTKBT_ERR("load firmware failed!");
-		ret_val = -1;
-		goto patch_end;
+	xdata->fw_len = rtk_fw_cache_get(dev_entry, &xdata->fw_data);
+	if (xdata->fw_len > 0) {
+		cached = true;
+	} else {
+		xdata->fw_len = load_firmware(dev_entry, &xdata->fw_data);
+		if (xdata->fw_len <= 0) {
+			RTKBT_ERR("load firmware failed!");
+			ret_val = -1;
+			goto patch_end;
+		}
 	}
 
 	fw_buf = xdata->fw_data;
@@ -859,11 +970,17 @@ int download_patch(struct usb_interface *intf)
 		goto patch_fail;
 	}
 
+	dl_start = ktime_get();
 	ret_val = download_data(xdata);
 	if (ret_val < 0) {
 		RTKBT_ERR("download_data failed, err %d", ret_val);
 		goto patch_fail;
 	}
+	RTKBT_INFO("%s: %d bytes downloaded in %lld ms, %lld ms total%s",
+		   __func__, xdata->fw_len,
+		   ktime_to_ms(ktime_sub(ktime_get(), dl_start)),
+		   ktime_to_ms(ktime_sub(ktime_get(), start)),
+		   cached ? " (cached image)" : "");
 
 	ret_val = check_fw_version(xdata);
 	if (ret_val <= 0) {
@@ -873,6 +990,9 @@ int download_patch(struct usb_interface *intf)
 		goto patch_fail;
 	}
 
+	if (!cached)
+		rtk_fw_cache_put(dev_entry, fw_buf, xdata->fw_len);
+
 	ret_val = 0;
 patch_fail:
 	kfree(fw_buf);
@@ -1841,6 +1961,7 @@ int load_firmware(dev_data * dev_entry, uint8_t ** buff)
 	struct patch_node patch_node_hdr;
 
 	RTKBT_DBG("load_firmware start");
+	dev_entry->fw_key_id = -1;
 	udev = dev_entry->udev;
 	patch_entry = dev_entry->patch_entry;
 	lmp_version = patch_entry->lmp_sub;
@@ -1930,6 +2051,7 @@ int load_firmware(dev_data * dev_entry, uint8_t ** buff)
 						fw_len = 0;
 						goto alloc_fail;
 					}
+					dev_entry->fw_key_id = key_id;
 					rtb_get_patch_header(&buf_len, &patch_node_hdr, epatch_buf, key_id);
 					if(buf_len == 0)
 						goto alloc_fail;
@@ -2148,7 +2270,8 @@ int download_data(xchange_data * xdata)
 	download_rp *evt_para;
 	uint8_t *pcur;
 	int pkt_len, frag_num, frag_len;
-	int i, ret_val;
+	int sent, done, inflight, credits;
+	int ret_val;
 	int j;
 
 	RTKBT_DBG("download_data start");
@@ -2156,30 +2279,46 @@ int download_data(xchange_data * xdata)
 	cmd_para = (download_cp *) xdata->req_para;
 	evt_para = (download_rp *) xdata->rsp_para;
 	pcur = xdata->fw_data;
-	pkt_len = CMD_HDR_LEN + sizeof(download_cp);
 	frag_num = xdata->fw_len / PATCH_SEG_MAX + 1;
-	frag_len = PATCH_SEG_MAX;
 
-	for (i = 0; i < frag_num; i++) {
-		if (i > 0x7f)
-			j = (i & 0x7f) + 1;
-		else
-			j = i;
+	/* Keep sending segments while the controller has command credits
+	 * left, instead of waiting for each completion before sending the
+	 * next one. Every command complete hands back a new credit count. */
+	sent = 0;
+	done = 0;
+	inflight = 0;
+	credits = 1;
+
+	while (done < frag_num) {
+		while (sent < frag_num && credits > 0 &&
+		       inflight < PATCH_SEG_INFLIGHT_MAX) {
+			if (sent > 0x7f)
+				j = (sent & 0x7f) + 1;
+			else
+				j = sent;
+
+			cmd_para->index = j;
+			frag_len = PATCH_SEG_MAX;
+			if (sent == (frag_num - 1)) {
+				cmd_para->index |= DATA_END;
+				frag_len = xdata->fw_len % PATCH_SEG_MAX;
+			}
+			pkt_len = CMD_HDR_LEN + sizeof(uint8_t) + frag_len;
 
-		cmd_para->index = j;
-		if (i == (frag_num - 1)) {
-			cmd_para->index |= DATA_END;
-			frag_len = xdata->fw_len % PATCH_SEG_MAX;
-			pkt_len -= (PATCH_SEG_MAX - frag_len);
-		}
-		xdata->cmd_hdr->opcode = cpu_to_le16(DOWNLOAD_OPCODE);
-		xdata->cmd_hdr->plen = sizeof(uint8_t) + frag_len;
-		xdata->pkt_len = pkt_len;
-		memcpy(cmd_para->data, pcur, frag_len);
+			xdata->cmd_hdr->opcode = cpu_to_le16(DOWNLOAD_OPCODE);
+			xdata->cmd_hdr->plen = sizeof(uint8_t) + frag_len;
+			xdata->pkt_len = pkt_len;
+			memcpy(cmd_para->data, pcur, frag_len);
 
-		ret_val = send_hci_cmd(xdata);
-		if (ret_val < 0) {
-			return ret_val;
+			ret_val = send_hci_cmd(xdata);
+			if (ret_val < 0) {
+				return ret_val;
+			}
+
+			pcur += PATCH_SEG_MAX;
+			sent++;
+			inflight++;
+			credits--;
 		}
 
 		ret_val = rcv_hci_evt(xdata);
@@ -2188,10 +2327,18 @@ int download_data(xchange_data * xdata)
 		}
 
 		if (0 != evt_para->status) {
+			RTKBT_ERR("%s: segment %d failed, status 0x%02x",
+				  __func__, done, evt_para->status);
 			return -1;
 		}
 
-		pcur += PATCH_SEG_MAX;
+		done++;
+		inflight--;
+
+		credits = xdata->cmd_cmp->ncmd;
+		/* Never stall with nothing outstanding */
+		if (!credits && !inflight)
+			credits = 1;
 	}
 
 	RTKBT_DBG("download_data done");
@@ -66,6 +66,7 @@
 extern int patch_add(struct usb_interface *intf);
 extern void patch_remove(struct usb_interface *intf);
 extern int download_patch(struct usb_interface *intf);
+extern void rtk_fw_cache_free(void);
 extern void print_event(struct sk_buff *skb);
 extern void print_command(struct sk_buff *skb);
 extern void print_acl(struct sk_buff *skb, int dataOut);
@@ -28,6 +28,7 @@
 #include <linux/of_gpio.h>
 #include <linux/of.h>
 #include <linux/bitops.h>
+#include <linux/math64.h>
 #include <linux/hte.h>
 #include "bmi_iio.h"
 
@@ -47,14 +48,20 @@
 #define BMI_REG_SENSORTIME_2		(0x1A)
 #define BMI_REG_ACC_INT_STAT_1		(0x1D)
 #define BMI_REG_TEMP_MSB		(0x22)
+#define BMI_REG_ACC_FIFO_LENGTH_0	(0x24)
+#define BMI_REG_ACC_FIFO_LENGTH_MSK	(0x3FFF)
 #define BMI_REG_FIFO_DATA		(0x26)
 #define BMI_REG_ACC_CONF		(0x40)
 #define BMI_REG_ACC_CONF_BWP_POR	(0xA0)
 #define BMI_REG_ACC_CONF_BWP_MSK	(0xF0)
 #define BMI_REG_ACC_RANGE		(0x41)
 #define BMI_REG_FIFO_DOWNS		(0x45)
+#define BMI_REG_ACC_FIFO_WTM_0		(0x46)
 #define BMI_REG_ACC_FIFO_CFG_0		(0x48)
+#define BMI_REG_ACC_FIFO_CFG_0_STREAM	(0x02)
 #define BMI_REG_ACC_FIFO_CFG_1		(0x49)
+#define BMI_REG_ACC_FIFO_CFG_1_POR	(0x10)
+#define BMI_REG_ACC_FIFO_CFG_1_ACC_EN	(0x50)
 #define BMI_REG_INT1_IO_CTRL		(0x53)
 #define BMI_REG_INT2_IO_CTRL		(0x54)
 #define BMI_REG_ACCEL_INIT_CTRL		(0x59)
@@ -62,7 +69,10 @@
 #define BMI_REG_INTX_IO_CTRL_ACTV_HI	(0x02)
 #define BMI_REG_INT_MAP_DATA		(0x58)
 #define BMI_INT1_OUT_ACTIVE_HIGH	(0x0A)
+#define BMI_INT1_FWM			(0x02)
 #define BMI_INT1_DTRDY			(0x04)
+#define BMI_INT2_FWM			(0x20)
+#define BMI_INT2_DTRDY			(0x40)
 #define BMI_REG_ACC_PWR_CONF		(0x7C)
 #define BMI_REG_ACC_PWR_CONF_ACTV	(0x00)
 #define BMI_REG_ACC_PWR_CONF_SUSP	(0x03)
@@ -78,6 +88,8 @@
 #define BMI_REG_GYR_DATA		(0x02)
 #define BMI_REG_GYR_INT_STAT_1		(0x0A)
 #define BMI_REG_FIFO_STATUS		(0x0E)
+#define BMI_REG_FIFO_STATUS_CNT_MSK	(0x7F)
+#define BMI_REG_FIFO_STATUS_OVR		(0x80)
 #define BMI_REG_GYR_RANGE		(0x0F)
 #define BMI_REG_GYR_BW			(0x10)
 #define BMI_REG_GYR_LPM1		(0x11)
@@ -89,19 +101,43 @@
 #define BMI_REG_GYR_INT_CTRL		(0x15)
 #define BMI_REG_GYR_INT_CTRL_DIS	(0x00)
 #define BMI_REG_GYR_INT_CTRL_DATA_EN	(0x80)
+#define BMI_REG_GYR_INT_CTRL_FIFO_EN	(0x40)
 #define BMI_REG_INT_3_4_IO_CONF		(0x16)
 #define BMI_REG_INT_3_4_IO_CONF_3_HI	(0x01)
 #define BMI_REG_INT_3_4_IO_CONF_4_HI	(0x04)
 #define BMI_REG_INT_3_4_IO_MAP		(0x18)
 #define BMI_REG_INT_3_4_IO_MAP_INT3	(0x01)
+#define BMI_REG_INT_3_4_IO_MAP_FIFO3	(0x04)
+#define BMI_REG_INT_3_4_IO_MAP_FIFO4	(0x20)
+#define BMI_REG_INT_3_4_IO_MAP_INT4	(0x80)
 #define BMI_REG_INT_3_ACTIVE_HIGH	(0x01)
+#define BMI_REG_GYR_FIFO_WM_EN		(0x1E)
+#define BMI_REG_GYR_FIFO_WM_EN_ON	(0x88)
+#define BMI_REG_GYR_FIFO_WM_EN_OFF	(0x08)
 #define BMI_REG_FIFO_EXT_INT_S		(0x34)
 #define BMI_REG_GYR_SELF_TEST		(0x3C)
+#define BMI_REG_GYR_FIFO_CFG_0		(0x3D)
 #define BMI_REG_GYR_FIFO_CFG_1		(0x3E)
+#define BMI_REG_GYR_FIFO_CFG_1_STREAM	(0x80)
+#define BMI_REG_GYR_FIFO_DATA		(0x3F)
 
 #define BMI_AXIS_N			(3)
 #define BMI_IMU_DATA			(6)
 
+/* hardware FIFOs */
+#define BMI_GYR_FIFO_FRAMES		(100)
+#define BMI_ACC_FIFO_SZ			(1024)
+#define BMI_ACC_FIFO_FRAME		(BMI_IMU_DATA + 1)
+#define BMI_ACC_FIFO_FRAMES		(BMI_ACC_FIFO_SZ / BMI_ACC_FIFO_FRAME)
+#define BMI_ACC_FIFO_HDR_MSK		(0xFC)
+#define BMI_ACC_FIFO_HDR_ACC		(0x84)
+#define BMI_ACC_FIFO_HDR_SKIP		(0x40)
+#define BMI_ACC_FIFO_HDR_TIME		(0x44)
+#define BMI_ACC_FIFO_HDR_CFG		(0x48)
+#define BMI_ACC_FIFO_HDR_DROP		(0x50)
+/* measured sample period may differ from nominal ODR by 1/2^n */
+#define BMI_FIFO_PERIOD_TOL_SHIFT	(4)
+
 /* hardware devices */
 #define BMI_HW_ACC			(0)
 #define BMI_HW_GYR			(1)
@@ -357,24 +393,31 @@ static int bmi_acc_batch(struct bmi_state *st, unsigned int period_us,
 static int bmi_acc_softreset(struct bmi_state *st, unsigned int hw);
 static int bmi_acc_pm(struct bmi_state *st, unsigned int hw, int able);
 static unsigned long bmi_acc_irqflags(struct bmi_state *st);
+static int bmi_acc_fifo(struct bmi_state *st, unsigned int wm);
+static int bmi_acc_fifo_rd(struct bmi_state *st, bool *ovr);
 static int bmi_gyr_able(struct bmi_state *st, int en, bool fast);
 static int bmi_gyr_batch(struct bmi_state *st, unsigned int period_us,
 			 bool range);
 static int bmi_gyr_softreset(struct bmi_state *st, unsigned int hw);
 static int bmi_gyr_pm(struct bmi_state *st, unsigned int hw, int able);
 static unsigned long bmi_gyr_irqflags(struct bmi_state *st);
+static int bmi_gyr_fifo(struct bmi_state *st, unsigned int wm);
+static int bmi_gyr_fifo_rd(struct bmi_state *st, bool *ovr);
 
 struct bmi_hw {
 	struct bmi_reg_rd *reg_rds;
 	struct bmi_rrs *rrs;
 	unsigned int reg_rds_n;
 	unsigned int rrs_0n;
+	unsigned int fifo_frames;
 	int (*fn_able)(struct bmi_state *st, int en, bool fast);
 	int (*fn_batch)(struct bmi_state *st, unsigned int period_us,
 			bool range);
 	int (*fn_softreset)(struct bmi_state *st, unsigned int hw);
 	int (*fn_pm)(struct bmi_state *st, unsigned int hw, int able);
 	unsigned long (*fn_irqflags)(struct bmi_state *st);
+	int (*fn_fifo)(struct bmi_state *st, unsigned int wm);
+	int (*fn_fifo_rd)(struct bmi_state *st, bool *ovr);
 };
 
 static struct bmi_hw bmi_hws[] = {
@@ -383,22 +426,28 @@ static struct bmi_hw bmi_hws[] = {
 		.rrs			= bmi_rrs_acc,
 		.reg_rds_n		= ARRAY_SIZE(bmi_reg_rds_acc),
 		.rrs_0n			= ARRAY_SIZE(bmi_rrs_acc) - 1,
+		.fifo_frames		= BMI_ACC_FIFO_FRAMES,
 		.fn_able		= &bmi_acc_able,
 		.fn_batch		= &bmi_acc_batch,
 		.fn_softreset		= &bmi_acc_softreset,
 		.fn_pm			= &bmi_acc_pm,
 		.fn_irqflags		= &bmi_acc_irqflags,
+		.fn_fifo		= &bmi_acc_fifo,
+		.fn_fifo_rd		= &bmi_acc_fifo_rd,
 	},
 	{
 		.reg_rds		= bmi_reg_rds_gyr,
 		.rrs			= bmi_rrs_gyr,
 		.reg_rds_n		= ARRAY_SIZE(bmi_reg_rds_gyr),
 		.rrs_0n			= ARRAY_SIZE(bmi_rrs_gyr) - 1,
+		.fifo_frames		= BMI_GYR_FIFO_FRAMES,
 		.fn_able		= &bmi_gyr_able,
 		.fn_batch		= &bmi_gyr_batch,
 		.fn_softreset		= &bmi_gyr_softreset,
 		.fn_pm			= &bmi_gyr_pm,
 		.fn_irqflags		= &bmi_gyr_irqflags,
+		.fn_fifo		= &bmi_gyr_fifo,
+		.fn_fifo_rd		= &bmi_gyr_fifo_rd,
 	},
 };
 
@@ -414,6 +463,11 @@ struct bmi_snsr {
 	struct completion hte_ts_cmpl;
 	struct bmi_gpio_irq gis;
 	struct bmi_state *st;
+	/* FIFO watermark in samples, 1 = data ready interrupt per sample */
+	unsigned int fifo_wm;
+	/* samples read at the previous watermark, 0 = no reference */
+	unsigned int fifo_n;
+	u8 fifo_buf[BMI_ACC_FIFO_SZ];
 };
 
 struct bmi_state {
@@ -537,6 +591,11 @@ static int bmi_i2c_wr(struct bmi_state *st, unsigned int hw, u8 reg, u8 val)
 	return ret;
 }
 
+static inline bool bmi_fifo_on(struct bmi_state *st, unsigned int hw)
+{
+	return st->snsrs[hw].fifo_wm > 1;
+}
+
 static int bmi_setup_gpio(struct device *dev, struct bmi_state *st,
 			  unsigned int n)
 {
@@ -674,6 +733,7 @@ static int bmi_acc_batch(struct bmi_state *st, unsigned int period_us,
 static int bmi_acc_able(struct bmi_state *st, int en, bool fast)
 {
 	int ret = 0;
+	u8 map = st->ra_0x58;
 
 	if (!en)
 		return bmi_i2c_wr(st, BMI_HW_ACC, BMI_REG_INT_MAP_DATA, 0x0);
@@ -685,7 +745,16 @@ static int bmi_acc_able(struct bmi_state *st, int en, bool fast)
 				  st->ra_0x54);
 	}
 
-	ret |= bmi_i2c_wr(st, BMI_HW_ACC, BMI_REG_INT_MAP_DATA, st->ra_0x58);
+	/* watermark interrupt goes on the pin data ready is mapped to */
+	if (bmi_fifo_on(st, BMI_HW_ACC)) {
+		map = 0;
+		if (st->ra_0x58 & BMI_INT1_DTRDY)
+			map |= BMI_INT1_FWM;
+		if (st->ra_0x58 & BMI_INT2_DTRDY)
+			map |= BMI_INT2_FWM;
+	}
+
+	ret |= bmi_i2c_wr(st, BMI_HW_ACC, BMI_REG_INT_MAP_DATA, map);
 
 	return ret;
 }
@@ -755,6 +824,96 @@ static unsigned long bmi_acc_irqflags(struct bmi_state *st)
 	return irqflags;
 }
 
+static int bmi_acc_fifo(struct bmi_state *st, unsigned int wm)
+{
+	u8 buf[3];
+	u16 wtm;
+	int ret;
+
+	st->snsrs[BMI_HW_ACC].fifo_n = 0;
+
+	if (wm <= 1)
+		return bmi_i2c_wr(st, BMI_HW_ACC, BMI_REG_ACC_FIFO_CFG_1,
+				  BMI_REG_ACC_FIFO_CFG_1_POR);
+
+	/* watermark is in bytes, every sample comes with a frame header */
+	wtm = wm * BMI_ACC_FIFO_FRAME;
+	buf[0] = BMI_REG_ACC_FIFO_WTM_0;
+	buf[1] = wtm & 0xFF;
+	buf[2] = wtm >> 8;
+	ret = bmi_i2c_w(st, BMI_HW_ACC, sizeof(buf), buf);
+	ret |= bmi_i2c_wr(st, BMI_HW_ACC, BMI_REG_ACC_FIFO_CFG_0,
+			  BMI_REG_ACC_FIFO_CFG_0_STREAM);
+	ret |= bmi_i2c_wr(st, BMI_HW_ACC, BMI_REG_ACC_FIFO_CFG_1,
+			  BMI_REG_ACC_FIFO_CFG_1_ACC_EN);
+	ret |= bmi_i2c_wr(st, BMI_HW_ACC, BMI_REG_ACC_SOFTRESET,
+			  BMI_REG_ACC_SOFTRESET_FIFO);
+
+	return ret;
+}
+
+/*
+ * Reads the whole FIFO in one burst and packs the accelerometer frames into
+ * fifo_buf as plain samples. Returns the number of samples.
+ */
+static int bmi_acc_fifo_rd(struct bmi_state *st, bool *ovr)
+{
+	struct bmi_snsr *snsr = &st->snsrs[BMI_HW_ACC];
+	u8 *buf = snsr->fifo_buf;
+	unsigned int len;
+	unsigned int i;
+	unsigned int n = 0;
+	__le16 fifo_len;
+	int ret;
+
+	ret = bmi_i2c_rd(st, BMI_HW_ACC, BMI_REG_ACC_FIFO_LENGTH_0,
+			 sizeof(fifo_len), &fifo_len);
+	if (ret)
+		return ret;
+
+	len = le16_to_cpu(fifo_len) & BMI_REG_ACC_FIFO_LENGTH_MSK;
+	if (len > BMI_ACC_FIFO_SZ)
+		len = BMI_ACC_FIFO_SZ;
+	/* no room for another frame: samples may have been overwritten */
+	*ovr = (len > BMI_ACC_FIFO_SZ - BMI_ACC_FIFO_FRAME);
+	if (!len)
+		return 0;
+
+	ret = bmi_i2c_rd(st, BMI_HW_ACC, BMI_REG_FIFO_DATA, len, buf);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < len;) {
+		switch (buf[i] & BMI_ACC_FIFO_HDR_MSK) {
+		case BMI_ACC_FIFO_HDR_ACC:
+			if (i + BMI_ACC_FIFO_FRAME > len)
+				return n;
+
+			memmove(&buf[n * BMI_IMU_DATA], &buf[i + 1],
+				BMI_IMU_DATA);
+			n++;
+			i += BMI_ACC_FIFO_FRAME;
+			break;
+		case BMI_ACC_FIFO_HDR_SKIP:
+			*ovr = true;
+			i += 2;
+			break;
+		case BMI_ACC_FIFO_HDR_TIME:
+			i += 4;
+			break;
+		case BMI_ACC_FIFO_HDR_CFG:
+		case BMI_ACC_FIFO_HDR_DROP:
+			i += 2;
+			break;
+		default:
+			/* over read or unknown frame */
+			return n;
+		}
+	}
+
+	return n;
+}
+
 static struct bmi_odr bmi_odrs_gyr[] = {
 	{ 10000, 0x05, 100, 0 },
 	{ 5000,  0x04, 200, 0 },
@@ -789,20 +948,30 @@ static int bmi_gyr_batch(struct bmi_state *st, unsigned int period_us,
 static int bmi_gyr_able(struct bmi_state *st, int en, bool fast)
 {
 	int ret = 0;
+	u8 map = st->rg_0x18;
+	u8 ctrl = BMI_REG_GYR_INT_CTRL_DATA_EN;
 
 	if (!en)
 		return bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_GYR_INT_CTRL,
 				  BMI_REG_GYR_INT_CTRL_DIS);
 
+	if (bmi_fifo_on(st, BMI_HW_GYR)) {
+		map = 0;
+		if (st->rg_0x18 & BMI_REG_INT_3_4_IO_MAP_INT3)
+			map |= BMI_REG_INT_3_4_IO_MAP_FIFO3;
+		if (st->rg_0x18 & BMI_REG_INT_3_4_IO_MAP_INT4)
+			map |= BMI_REG_INT_3_4_IO_MAP_FIFO4;
+		ctrl = BMI_REG_GYR_INT_CTRL_FIFO_EN;
+	}
+
 	if (!fast) {
 		ret = bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_INT_3_4_IO_CONF,
 				 st->rg_0x16);
 		ret |= bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_INT_3_4_IO_MAP,
-				  st->rg_0x18);
+				  map);
 	}
 
-	ret |= bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_GYR_INT_CTRL,
-			  BMI_REG_GYR_INT_CTRL_DATA_EN);
+	ret |= bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_GYR_INT_CTRL, ctrl);
 
 	return ret;
 }
@@ -862,6 +1031,90 @@ static unsigned long bmi_gyr_irqflags(struct bmi_state *st)
 	return irqflags;
 }
 
+static int bmi_gyr_fifo(struct bmi_state *st, unsigned int wm)
+{
+	int ret;
+
+	st->snsrs[BMI_HW_GYR].fifo_n = 0;
+
+	if (wm <= 1)
+		return bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_GYR_FIFO_WM_EN,
+				  BMI_REG_GYR_FIFO_WM_EN_OFF);
+
+	ret = bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_GYR_FIFO_CFG_0, wm);
+	ret |= bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_GYR_FIFO_WM_EN,
+			  BMI_REG_GYR_FIFO_WM_EN_ON);
+	/* also clears the FIFO and the overrun flag */
+	ret |= bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_GYR_FIFO_CFG_1,
+			  BMI_REG_GYR_FIFO_CFG_1_STREAM);
+
+	return ret;
+}
+
+static int bmi_gyr_fifo_rd(struct bmi_state *st, bool *ovr)
+{
+	struct bmi_snsr *snsr = &st->snsrs[BMI_HW_GYR];
+	unsigned int n;
+	u8 sts;
+	int ret;
+
+	ret = bmi_i2c_rd(st, BMI_HW_GYR, BMI_REG_FIFO_STATUS, 1, &sts);
+	if (ret)
+		return ret;
+
+	n = sts & BMI_REG_FIFO_STATUS_CNT_MSK;
+	if (n > BMI_GYR_FIFO_FRAMES)
+		n = BMI_GYR_FIFO_FRAMES;
+	*ovr = !!(sts & BMI_REG_FIFO_STATUS_OVR);
+	if (n) {
+		ret = bmi_i2c_rd(st, BMI_HW_GYR, BMI_REG_GYR_FIFO_DATA,
+				 n * BMI_IMU_DATA, snsr->fifo_buf);
+		if (ret)
+			return ret;
+	}
+
+	if (*ovr)
+		bmi_i2c_wr(st, BMI_HW_GYR, BMI_REG_GYR_FIFO_CFG_1,
+			   BMI_REG_GYR_FIFO_CFG_1_STREAM);
+
+	return n;
+}
+
+/*
+ * The HTE timestamp of a watermark interrupt belongs to the sample that
+ * filled the FIFO up to the watermark, i.e. sample fifo_wm - 1 of this
+ * burst. The others are placed one sample period apart around it. The
+ * period is the nominal ODR, refined by the time between two watermarks
+ * when no samples were lost in between.
+ */
+static void bmi_fifo_push(struct bmi_state *st, unsigned int hw,
+			  unsigned int n, bool ovr)
+{
+	struct bmi_snsr *sensor = &st->snsrs[hw];
+	u64 period_ns = (u64)sensor->period_us * NSEC_PER_USEC;
+	u64 period_tol = period_ns >> BMI_FIFO_PERIOD_TOL_SHIFT;
+	u64 measured;
+	u64 ts;
+	unsigned int anchor;
+
+	if (sensor->fifo_n && sensor->irq_ts > sensor->irq_ts_old) {
+		measured = div_u64(sensor->irq_ts - sensor->irq_ts_old,
+				   sensor->fifo_n);
+		if (measured + period_tol >= period_ns &&
+		    measured <= period_ns + period_tol)
+			period_ns = measured;
+	}
+
+	anchor = min(n, sensor->fifo_wm) - 1;
+	ts = sensor->irq_ts - anchor * period_ns;
+	bmi_iio_push_bufs(sensor->bmi_iio, sensor->fifo_buf, n, ts, period_ns);
+	dev_dbg(&st->i2c->dev, "%d, n=%u ts=%lld period=%lld%s\n",
+		hw, n, sensor->irq_ts, period_ns, ovr ? " overrun" : "");
+
+	sensor->irq_ts_old = sensor->irq_ts;
+	sensor->fifo_n = ovr ? 0 : n;
+}
+
 static enum hte_return process_hw_ts(struct hte_ts_data *ts, void *p)
 {
 	struct bmi_snsr *sensor = (struct bmi_snsr *)p;
@@ -884,6 +1137,7 @@ static irqreturn_t bmi_irq_thread(int irq, void *dev_id)
 	struct bmi_state *st = sensor->st;
 	unsigned int hw;
 	int ret;
+	bool ovr;
 	u8 reg;
 	u8 sample[BMI_IMU_DATA];
 
@@ -913,6 +1167,16 @@ static irqreturn_t bmi_irq_thread(int irq, void *dev_id)
 
 	mutex_lock(BMI_MUTEX(st->snsrs[hw].bmi_iio));
 
+	if (bmi_fifo_on(st, hw)) {
+		ret = bmi_hws[hw].fn_fifo_rd(st, &ovr);
+		if (ret > 0)
+			bmi_fifo_push(st, hw, ret, ovr);
+		else if (ret < 0)
+			sensor->fifo_n = 0;
+
+		goto unlock;
+	}
+
 	ret = bmi_i2c_rd(st, hw, reg, sizeof(sample), sample);
 
 	if (!ret) {
@@ -924,6 +1188,7 @@ static irqreturn_t bmi_irq_thread(int irq, void *dev_id)
 		sensor->irq_ts_old = sensor->irq_ts;
 	}
 
+unlock:
 	mutex_unlock(BMI_MUTEX(st->snsrs[hw].bmi_iio));
 
 	/* Enable data ready interrupt */
@@ -938,6 +1203,9 @@ static int bmi_period(struct bmi_state *st, int snsr_id, bool range)
 	if (snsr_id >= st->hw_n)
 		return -ENODEV;
 
+	/* samples at the old rate are no reference for the new one */
+	st->snsrs[snsr_id].fifo_n = 0;
+
 	return bmi_hws[snsr_id].fn_batch(st, st->snsrs[snsr_id].period_us,
 					 range);
 }
@@ -960,6 +1228,8 @@ static int bmi_enable(void *client, int snsr_id, int enable)
 			return ret;
 
 		ret = bmi_period(st, snsr_id, true);
+		ret |= bmi_hws[snsr_id].fn_fifo(st,
+					st->snsrs[snsr_id].fifo_wm);
 		ret |= bmi_hws[snsr_id].fn_able(st, 1, false);
 		if (!ret) {
 			st->enabled = enable;
@@ -968,6 +1238,8 @@ static int bmi_enable(void *client, int snsr_id, int enable)
 	}
 
 	ret = bmi_hws[snsr_id].fn_able(st, 0, false);
+	if (bmi_fifo_on(st, snsr_id))
+		ret |= bmi_hws[snsr_id].fn_fifo(st, 0);
 	ret |= bmi_pm(st, snsr_id, false);
 
 	return ret;
@@ -1148,6 +1420,26 @@ static int bmi_scale_write(void *client, int snsr_id, int val, int val2)
 	return ret;
 }
 
+static int bmi_fifo_wm(void *client, int snsr_id, unsigned int wm)
+{
+	struct bmi_state *st = (struct bmi_state *)client;
+
+	if (snsr_id >= st->hw_n)
+		return -ENODEV;
+
+	if (st->enabled & (1 << snsr_id))
+		/* takes effect on the next enable */
+		return -EBUSY;
+
+	if (!wm)
+		wm = 1;
+	if (wm > bmi_hws[snsr_id].fifo_frames)
+		wm = bmi_hws[snsr_id].fifo_frames;
+	st->snsrs[snsr_id].fifo_wm = wm;
+
+	return 0;
+}
+
 static int bmi_read_err(void *client, int snsr_id, char *buf)
 {
 	ssize_t t = 0;
@@ -1222,6 +1514,7 @@ static struct iio_fn_dev bmi_fn_dev = {
 	.freq_read = bmi_freq_read,
 	.freq_write = bmi_freq_write,
 	.scale_write = bmi_scale_write,
+	.fifo_wm = bmi_fifo_wm,
 	.read_err = bmi_read_err,
 	.get_data = bmi_get_data,
 };
@@ -1491,8 +1784,10 @@ static int bmi_init(struct bmi_state *st, const struct i2c_device_id *id)
 	 * default rate to slowest speed, this gets reflected in register
 	 * during buffer enable time.
 	 */
-	for (i = 0; i < st->hw_n; i++)
+	for (i = 0; i < st->hw_n; i++) {
 		st->snsrs[i].period_us = st->snsrs[i].cfg.delay_us_max;
+		st->snsrs[i].fifo_wm = 1;
+	}
 
 	return ret;
 }
@@ -197,6 +197,29 @@ int bmi_iio_push_buf(struct iio_dev *indio_dev, unsigned char *data, u64 ts)
 }
 EXPORT_SYMBOL_GPL(bmi_iio_push_buf);
 
+/* Pushes n samples read in one burst, ts is the time of the first one */
+int bmi_iio_push_bufs(struct iio_dev *indio_dev, unsigned char *data,
+		      unsigned int n, u64 ts, u64 period_ns)
+{
+	unsigned int i;
+	int ret = 0;
+
+	if (!data)
+		return -EINVAL;
+
+	for (i = 0; i < n; i++) {
+		ret = bmi_iio_push_buf(indio_dev, data, ts);
+		if (ret)
+			break;
+
+		data += NUM_CHANNELS * sizeof(__le16);
+		ts += period_ns;
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(bmi_iio_push_bufs);
+
 static int bmi_iio_enable(struct iio_dev *indio_dev, bool en)
 {
 	struct bmi_iio_state *st = iio_priv(indio_dev);
@@ -457,6 +480,17 @@ out:
 	return ret;
 }
 
+static int bmi_iio_hwfifo_set_watermark(struct iio_dev *indio_dev,
+					unsigned int val)
+{
+	struct bmi_iio_state *st = iio_priv(indio_dev);
+
+	if (!st->fn_dev->fifo_wm)
+		return -EINVAL;
+
+	return st->fn_dev->fifo_wm(st->client, st->cfg->snsr_id, val);
+}
+
 static int bmi_iio_buffer_preenable(struct iio_dev *indio_dev)
 {
 	struct bmi_iio_state *st = iio_priv(indio_dev);
@@ -517,6 +551,7 @@ static int __bmi_08x_iio_init(struct iio_dev *indio_dev,
 	st->info.attrs = &st->attr_group;
 	st->info.read_raw = &bmi_iio_read_raw;
 	st->info.write_raw = &bmi_iio_write_raw;
+	st->info.hwfifo_set_watermark = &bmi_iio_hwfifo_set_watermark;
 	indio_dev->info = &st->info;
 	indio_dev->setup_ops = &bmi_iio_buffer_setup_ops;
 	buffer = iio_kfifo_allocate();
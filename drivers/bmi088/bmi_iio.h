@@ -43,6 +43,7 @@ struct iio_fn_dev {
 	int (*freq_read)(void *client, int snsr_id, int *val, int *val2);
 	int (*freq_write)(void *client, int snsr_id, int val, int val2);
 	int (*scale_write)(void *client, int snsr_id, int val, int val2);
+	int (*fifo_wm)(void *client, int snsr_id, unsigned int wm);
 	int (*regs)(void *client, int snsr_id, char *buf);
 	int (*read_err)(void *client, int snsr_id, char *buf);
 	int (*get_data)(void *client, int snsr_id, int axis, int *val);
@@ -50,6 +51,8 @@ struct iio_fn_dev {
 
 void bmi_iio_remove(struct iio_dev *indio_dev);
 int bmi_iio_push_buf(struct iio_dev *indio_dev, unsigned char *data, u64 ts);
+int bmi_iio_push_bufs(struct iio_dev *indio_dev, unsigned char *data,
+		      unsigned int n, u64 ts, u64 period_ns);
 int bmi_08x_iio_init(struct iio_dev **handle, void *dev_client,
 		     struct device *dev, struct iio_fn_dev *fn_dev,
 		     struct sensor_cfg *snsr_cfg);
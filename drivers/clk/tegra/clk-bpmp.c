@@ -5,6 +5,7 @@
 #include <linux/device.h>
 #include <linux/seq_buf.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include <soc/tegra/bpmp.h>
 #include <soc/tegra/bpmp-abi.h>
@@ -31,6 +32,10 @@ struct tegra_bpmp_clk {
 
 	unsigned int num_parents;
 	unsigned int *parents;
+
+	/* root clock without rate control, rate read once from BPMP */
+	bool fixed_rate;
+	unsigned long rate;
 };
 
 static inline struct tegra_bpmp_clk *to_tegra_bpmp_clk(struct clk_hw *hw)
@@ -147,6 +152,9 @@ static unsigned long tegra_bpmp_clk_recalc_rate(struct clk_hw *hw,
 	struct tegra_bpmp_clk_message msg;
 	int err;
 
+	if (clk->fixed_rate && READ_ONCE(clk->rate))
+		return READ_ONCE(clk->rate);
+
 	memset(&msg, 0, sizeof(msg));
 	msg.cmd = CMD_CLK_GET_RATE;
 	msg.id = clk->id;
@@ -159,6 +167,9 @@ static unsigned long tegra_bpmp_clk_recalc_rate(struct clk_hw *hw,
 	if (err < 0)
 		return 0;
 
+	if (clk->fixed_rate)
+		WRITE_ONCE(clk->rate, response.rate);
+
 	return response.rate;
 }
 
@@ -415,9 +426,72 @@ static void tegra_bpmp_clk_info_dump(struct tegra_bpmp *bpmp,
 		dev_printk(level, bpmp->dev, "    %03u\n", info->parents[i]);
 }
 
+/*
+ * Clock information is queried for every ID at boot. The queries are
+ * independent, so keep one in flight on each threaded BPMP channel
+ * instead of waiting for each round trip in turn.
+ */
+struct tegra_bpmp_clk_probe {
+	struct tegra_bpmp *bpmp;
+	struct tegra_bpmp_clk_info *clocks;	/* indexed by clock ID */
+	int *errors;
+	unsigned int max_id;
+	atomic_t next_id;
+};
+
+struct tegra_bpmp_clk_probe_work {
+	struct work_struct work;
+	struct tegra_bpmp_clk_probe *probe;
+};
+
+static void tegra_bpmp_clk_probe_one(struct tegra_bpmp_clk_probe *probe)
+{
+	unsigned int id;
+
+	while ((id = atomic_inc_return(&probe->next_id) - 1) <= probe->max_id)
+		probe->errors[id] = tegra_bpmp_clk_get_info(probe->bpmp, id,
+							    &probe->clocks[id]);
+}
+
+static void tegra_bpmp_clk_probe_work(struct work_struct *work)
+{
+	struct tegra_bpmp_clk_probe_work *w =
+		container_of(work, struct tegra_bpmp_clk_probe_work, work);
+
+	tegra_bpmp_clk_probe_one(w->probe);
+}
+
+static void tegra_bpmp_clk_get_all_info(struct tegra_bpmp_clk_probe *probe)
+{
+	struct tegra_bpmp_clk_probe_work *works;
+	unsigned int i, num_works;
+
+	num_works = min_t(unsigned int, probe->bpmp->threaded.count,
+			  probe->max_id + 1);
+
+	works = num_works > 1 ? kcalloc(num_works, sizeof(*works), GFP_KERNEL)
+			      : NULL;
+	if (!works) {
+		tegra_bpmp_clk_probe_one(probe);
+		return;
+	}
+
+	for (i = 0; i < num_works; i++) {
+		works[i].probe = probe;
+		INIT_WORK(&works[i].work, tegra_bpmp_clk_probe_work);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	for (i = 0; i < num_works; i++)
+		flush_work(&works[i].work);
+
+	kfree(works);
+}
+
 static int tegra_bpmp_probe_clocks(struct tegra_bpmp *bpmp,
 				   struct tegra_bpmp_clk_info **clocksp)
 {
+	struct tegra_bpmp_clk_probe probe;
 	struct tegra_bpmp_clk_info *clocks;
 	unsigned int max_id, id, count = 0;
 	unsigned int holes = 0;
@@ -435,13 +509,29 @@ static int tegra_bpmp_probe_clocks(struct tegra_bpmp *bpmp,
 	if (!clocks)
 		return -ENOMEM;
 
+	probe.errors = kcalloc(max_id + 1, sizeof(*probe.errors), GFP_KERNEL);
+	if (!probe.errors) {
+		kfree(clocks);
+		return -ENOMEM;
+	}
+
+	probe.bpmp = bpmp;
+	probe.clocks = clocks;
+	probe.max_id = max_id;
+	atomic_set(&probe.next_id, 0);
+
+	tegra_bpmp_clk_get_all_info(&probe);
+
+	/* compact the valid entries, count never exceeds id */
 	for (id = 0; id <= max_id; id++) {
 		struct tegra_bpmp_clk_info *info = &clocks[count];
 
-		err = tegra_bpmp_clk_get_info(bpmp, id, info);
-		if (err < 0)
+		if (probe.errors[id] < 0)
 			continue;
 
+		if (count != id)
+			*info = clocks[id];
+
 		if (info->num_parents >= U8_MAX) {
 			dev_err(bpmp->dev,
 				"clock %u has too many parents (%u, max: %u)\n",
@@ -462,6 +552,8 @@ static int tegra_bpmp_probe_clocks(struct tegra_bpmp *bpmp,
 			tegra_bpmp_clk_info_dump(bpmp, KERN_DEBUG, info);
 	}
 
+	kfree(probe.errors);
+
 	dev_dbg(bpmp->dev, "holes: %u\n", holes);
 	*clocksp = clocks;
 
@@ -513,6 +605,8 @@ tegra_bpmp_clk_register(struct tegra_bpmp *bpmp,
 
 	clk->id = info->id;
 	clk->bpmp = bpmp;
+	clk->fixed_rate = (info->flags & TEGRA_BPMP_CLK_IS_ROOT) &&
+			  !(info->flags & TEGRA_BPMP_CLK_HAS_SET_RATE);
 
 	clk->parents = devm_kcalloc(bpmp->dev, info->num_parents,
 				    sizeof(*clk->parents), GFP_KERNEL);
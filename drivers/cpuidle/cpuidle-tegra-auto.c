@@ -3,6 +3,7 @@
 
 #include <linux/cpu_cooling.h>
 #include <linux/cpuidle.h>
+#include <linux/debugfs.h>
 #include <linux/cpumask.h>
 #include <linux/cpu_pm.h>
 #include <linux/kernel.h>
@@ -15,6 +16,8 @@
 #include <linux/delay.h>
 #include <linux/sched.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/version.h>
 #include <asm/cpuidle.h>
 #include <linux/suspend.h>
 #include <linux/wait.h>
@@ -27,9 +30,79 @@ enum {
 	CPUIDLE_TEGRA_AUTO_SC7_RESUME_START,
 };
 
+#define TEGRA_AUTO_IDLE_STATES		2
+
+/* log2 histogram buckets, the first one holds up to 256 ns */
+#define TEGRA_AUTO_IDLE_HIST_BUCKETS	16
+#define TEGRA_AUTO_IDLE_HIST_SHIFT	8
+
+/* minimum samples of a state before its measured latency is used */
+#define TEGRA_AUTO_IDLE_MIN_SAMPLES	100
+
+/*
+ * Idle telemetry of a CPU. Exit latency is measured on timer wakeups, as the
+ * time from the programmed expiry of the next hrtimer to the CPU running
+ * again. It only covers the idle periods that the governor stopped the tick
+ * for, as only then cpuidle records the next timer.
+ */
+struct tegra_auto_idle_stats {
+	u64 residency_hist[TEGRA_AUTO_IDLE_STATES][TEGRA_AUTO_IDLE_HIST_BUCKETS];
+	u64 exit_hist[TEGRA_AUTO_IDLE_STATES][TEGRA_AUTO_IDLE_HIST_BUCKETS];
+	u64 exit_max_ns[TEGRA_AUTO_IDLE_STATES];
+};
+
 static struct cpumask cpumask;
 static bool s2idle_sc7_state;
 static DEFINE_PER_CPU(struct cpuidle_driver *, tegra_auto_cpuidle_drivers);
+static DEFINE_PER_CPU(struct tegra_auto_idle_stats, tegra_auto_idle_stats);
+static struct dentry *tegra_auto_idle_debugfs;
+
+/* CPUs that only use WFI by default, e.g. the ones running RT work */
+static char *shallow_cpus;
+module_param(shallow_cpus, charp, 0444);
+MODULE_PARM_DESC(shallow_cpus,
+	"cpulist of CPUs whose deeper idle states start disabled, change at runtime through cpuidle stateN/disable");
+
+static unsigned int tegra_auto_idle_bucket(u64 ns)
+{
+	unsigned int bucket = 0;
+
+	ns >>= TEGRA_AUTO_IDLE_HIST_SHIFT;
+	if (ns)
+		bucket = ilog2(ns) + 1;
+
+	return min_t(unsigned int, bucket, TEGRA_AUTO_IDLE_HIST_BUCKETS - 1);
+}
+
+static u64 tegra_auto_idle_bucket_limit_ns(unsigned int bucket)
+{
+	return 1ULL << (TEGRA_AUTO_IDLE_HIST_SHIFT + bucket);
+}
+
+static void tegra_auto_idle_account(struct cpuidle_device *dev, int idx,
+				    ktime_t start, ktime_t end)
+{
+	struct tegra_auto_idle_stats *stats = this_cpu_ptr(&tegra_auto_idle_stats);
+	u64 exit_ns;
+
+	if (idx >= TEGRA_AUTO_IDLE_STATES)
+		return;
+
+	stats->residency_hist[idx][tegra_auto_idle_bucket(ktime_to_ns(ktime_sub(end, start)))]++;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
+	/* woken up late after the expiry of the timer, i.e. by the timer */
+	if (dev->next_hrtimer && ktime_before(start, dev->next_hrtimer) &&
+	    !ktime_before(end, dev->next_hrtimer)) {
+		exit_ns = ktime_to_ns(ktime_sub(end, dev->next_hrtimer));
+		if (exit_ns < NSEC_PER_MSEC) {
+			stats->exit_hist[idx][tegra_auto_idle_bucket(exit_ns)]++;
+			if (exit_ns > stats->exit_max_ns[idx])
+				stats->exit_max_ns[idx] = exit_ns;
+		}
+	}
+#endif
+}
 
 static bool tegra_auto_cpuidle_s2idle_exit(int cpu_number)
 {
@@ -67,8 +140,12 @@ static struct notifier_block suspend_notifier = {
 static int tegra_auto_enter_idle_state(struct cpuidle_device *dev,
 				       struct cpuidle_driver *drv, int idx)
 {
+	ktime_t start = ktime_get();
+
 	asm volatile("wfi\n");
 
+	tegra_auto_idle_account(dev, idx, start, ktime_get());
+
 	return 0;
 }
 
@@ -144,12 +221,153 @@ static struct cpuidle_driver tegra_auto_idle_driver __initdata = {
 	},
 };
 
+static u64 tegra_auto_idle_hist_percentile(const u64 *hist, unsigned int pct,
+					    u64 *samples)
+{
+	u64 total = 0, sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < TEGRA_AUTO_IDLE_HIST_BUCKETS; i++)
+		total += hist[i];
+
+	*samples = total;
+	if (!total)
+		return 0;
+
+	for (i = 0; i < TEGRA_AUTO_IDLE_HIST_BUCKETS; i++) {
+		sum += hist[i];
+		if (sum * 100 >= total * pct)
+			break;
+	}
+
+	return tegra_auto_idle_bucket_limit_ns(min_t(unsigned int, i,
+					TEGRA_AUTO_IDLE_HIST_BUCKETS - 1));
+}
+
+static int tegra_auto_idle_stats_show(struct seq_file *s, void *data)
+{
+	unsigned int cpu = (unsigned long)s->private;
+	struct tegra_auto_idle_stats *stats = per_cpu_ptr(&tegra_auto_idle_stats, cpu);
+	struct cpuidle_driver *drv = per_cpu(tegra_auto_cpuidle_drivers, cpu);
+	unsigned int i, b;
+	u64 p99, samples;
+
+	if (!drv)
+		return -ENODEV;
+
+	for (i = 0; i < TEGRA_AUTO_IDLE_STATES && i < drv->state_count; i++) {
+		p99 = tegra_auto_idle_hist_percentile(stats->exit_hist[i], 99, &samples);
+		seq_printf(s, "%s: exit_latency_ns %llu, measured p99 <= %llu max %llu (%llu samples)\n",
+			   drv->states[i].name, drv->states[i].exit_latency_ns,
+			   p99, stats->exit_max_ns[i], samples);
+
+		seq_puts(s, "  bucket_ns    residency         exit\n");
+		for (b = 0; b < TEGRA_AUTO_IDLE_HIST_BUCKETS; b++)
+			seq_printf(s, "  <%-9llu %12llu %12llu\n",
+				   tegra_auto_idle_bucket_limit_ns(b),
+				   stats->residency_hist[i][b],
+				   stats->exit_hist[i][b]);
+	}
+
+	return 0;
+}
+
+static int tegra_auto_idle_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tegra_auto_idle_stats_show, inode->i_private);
+}
+
+/* any write clears the telemetry of the CPU */
+static ssize_t tegra_auto_idle_stats_write(struct file *file,
+					   const char __user *buf,
+					   size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	unsigned int cpu = (unsigned long)s->private;
+
+	memset(per_cpu_ptr(&tegra_auto_idle_stats, cpu), 0,
+	       sizeof(struct tegra_auto_idle_stats));
+
+	return count;
+}
+
+static const struct file_operations tegra_auto_idle_stats_fops = {
+	.open		= tegra_auto_idle_stats_open,
+	.read		= seq_read,
+	.write		= tegra_auto_idle_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * Replace the declared exit latency of each state with the measured 99th
+ * percentile, so that the governors and the PM QoS resume latency limits
+ * of the CPUs work with the latencies this system really has.
+ */
+static int tegra_auto_idle_apply_latency(void *data, u64 val)
+{
+	struct tegra_auto_idle_stats *stats;
+	struct cpuidle_driver *drv;
+	struct cpuidle_state *state;
+	unsigned int cpu, i;
+	u64 p99, samples;
+
+	if (!val)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		drv = per_cpu(tegra_auto_cpuidle_drivers, cpu);
+		if (!drv)
+			continue;
+
+		stats = per_cpu_ptr(&tegra_auto_idle_stats, cpu);
+		for (i = 0; i < TEGRA_AUTO_IDLE_STATES && i < drv->state_count; i++) {
+			p99 = tegra_auto_idle_hist_percentile(stats->exit_hist[i],
+							      99, &samples);
+			if (samples < TEGRA_AUTO_IDLE_MIN_SAMPLES)
+				continue;
+
+			state = &drv->states[i];
+			WRITE_ONCE(state->exit_latency_ns, p99);
+			WRITE_ONCE(state->exit_latency, DIV_ROUND_UP_ULL(p99, NSEC_PER_USEC));
+			if (state->target_residency_ns < p99) {
+				WRITE_ONCE(state->target_residency_ns, p99);
+				WRITE_ONCE(state->target_residency,
+					   DIV_ROUND_UP_ULL(p99, NSEC_PER_USEC));
+			}
+		}
+	}
+
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(tegra_auto_idle_apply_fops, NULL,
+			tegra_auto_idle_apply_latency, "%llu\n");
+
+static void tegra_auto_idle_debugfs_init(void)
+{
+	char name[16];
+	unsigned long cpu;
+
+	tegra_auto_idle_debugfs = debugfs_create_dir("tegra_auto_idle", NULL);
+	if (IS_ERR_OR_NULL(tegra_auto_idle_debugfs))
+		return;
+
+	for_each_possible_cpu(cpu) {
+		snprintf(name, sizeof(name), "cpu%lu", cpu);
+		debugfs_create_file(name, 0600, tegra_auto_idle_debugfs,
+				    (void *)cpu, &tegra_auto_idle_stats_fops);
+	}
+
+	debugfs_create_file("apply_measured_latency", 0200, tegra_auto_idle_debugfs,
+			    NULL, &tegra_auto_idle_apply_fops);
+}
+
 /*
  * tegra_auto_idle_init_cpu
  *
  * Registers the tegra_auto specific cpuidle driver with the cpuidle framework.
  */
-static int __init tegra_auto_idle_init_cpu(int cpu)
+static int __init tegra_auto_idle_init_cpu(int cpu, const struct cpumask *shallow)
 {
 	int ret = 0;
 	struct cpuidle_driver *drv;
@@ -160,6 +378,14 @@ static int __init tegra_auto_idle_init_cpu(int cpu)
 
 	drv->cpumask = (struct cpumask *)cpumask_of(cpu);
 
+	/* keep only WFI enabled on shallow CPUs until user space says otherwise */
+	if (shallow && cpumask_test_cpu(cpu, shallow)) {
+		int i;
+
+		for (i = 1; i < drv->state_count; i++)
+			drv->states[i].flags |= CPUIDLE_FLAG_OFF;
+	}
+
 	ret = cpuidle_register(drv, NULL);
 	if (ret) {
 		pr_err("cpu register failed\n");
@@ -185,17 +411,27 @@ static int __init tegra_auto_cpuidle_probe(struct platform_device *pdev)
 {
 	int cpu, ret;
 	struct cpuidle_driver *drv;
+	cpumask_var_t shallow;
+
+	if (!zalloc_cpumask_var(&shallow, GFP_KERNEL))
+		return -ENOMEM;
+
+	if (shallow_cpus && cpulist_parse(shallow_cpus, shallow))
+		dev_warn(&pdev->dev, "invalid shallow_cpus \"%s\"\n", shallow_cpus);
 
 	for_each_possible_cpu(cpu) {
-		ret = tegra_auto_idle_init_cpu(cpu);
+		ret = tegra_auto_idle_init_cpu(cpu, shallow);
 		if (ret)
 			goto out_fail;
 	}
+	free_cpumask_var(shallow);
 	register_pm_notifier(&suspend_notifier);
+	tegra_auto_idle_debugfs_init();
 
 	return 0;
 
 out_fail:
+	free_cpumask_var(shallow);
 	while (--cpu >= 0) {
 		drv = per_cpu(tegra_auto_cpuidle_drivers, cpu);
 		cpuidle_unregister(drv);
@@ -211,6 +447,9 @@ static int tegra_auto_cpuidle_remove(struct platform_device *pdev)
 	int cpu;
 	struct cpuidle_driver *drv;
 
+	debugfs_remove_recursive(tegra_auto_idle_debugfs);
+	unregister_pm_notifier(&suspend_notifier);
+
 	for_each_possible_cpu(cpu) {
 		drv = per_cpu(tegra_auto_cpuidle_drivers, cpu);
 		cpuidle_unregister(drv);
@@ -36,6 +36,10 @@
 #include <linux/completion.h>
 #include <linux/interrupt.h>
 #include <linux/kthread.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <linux/host1x.h>
 #include <linux/version.h>
 
@@ -289,6 +293,35 @@ static struct crypto_dev_to_ivc_map g_crypto_to_ivc_map[MAX_NUMBER_MISC_DEVICES]
 static bool gcm_supports_dma;
 static struct device *gpcdma_dev;
 
+static unsigned int rng_pool_size = 4096;
+module_param(rng_pool_size, uint, 0444);
+MODULE_PARM_DESC(rng_pool_size,
+	"Random bytes read ahead per RNG channel, 0 asks the server on every read");
+
+static unsigned int rng_pool_watermark = 1024;
+module_param(rng_pool_watermark, uint, 0644);
+MODULE_PARM_DESC(rng_pool_watermark,
+	"Refill the random pool when fewer bytes than this are left");
+
+/* random bytes fetched by the refill worker per pool lock round */
+#define TEGRA_VSE_RNG_REFILL_CHUNK	256U
+
+/* Random numbers of one RNG channel, refilled by a worker */
+struct tegra_vse_rng_pool {
+	/* context of the worker, readers use their own DMA buffer */
+	struct tegra_virtual_se_rng_context ctx;
+	struct mutex lock;
+	struct work_struct refill;
+	u8 *buf;
+	unsigned int size;
+	unsigned int avail;
+};
+
+static unsigned int max_async_reqs = 8;
+module_param(max_async_reqs, uint, 0644);
+MODULE_PARM_DESC(max_async_reqs,
+	"AES requests kept in flight per channel, 0 waits for each request");
+
 /* Security Engine Linked List */
 struct tegra_virtual_se_ll {
 	dma_addr_t addr; /* DMA buffer address */
@@ -357,8 +390,12 @@ struct tegra_vse_priv_data {
 	uint32_t syncpt_id;
 	uint32_t syncpt_threshold;
 	uint32_t syncpt_id_valid;
+	/* completed by the kthread through the crypto request callback */
+	bool async;
 };
 
+static void tegra_hv_vse_safety_aes_complete(struct tegra_vse_priv_data *priv);
+
 struct tegra_virtual_se_addr {
 	u32 lo;
 	u32 hi;
@@ -529,6 +566,33 @@ struct sha_zero_length_vector {
 	char *digest;
 };
 
+static unsigned int req_ctx_max = 16;
+module_param(req_ctx_max, uint, 0444);
+MODULE_PARM_DESC(req_ctx_max,
+	"Request contexts preallocated per channel, limited by CPUs and IVC frames");
+
+struct tegra_vse_req_pool;
+
+/* Message and private data of one synchronous request */
+struct tegra_vse_req_ctx {
+	struct tegra_virtual_se_ivc_msg_t msg;
+	struct tegra_vse_priv_data priv;
+	/* NULL when allocated because the pool was exhausted */
+	struct tegra_vse_req_pool *pool;
+	unsigned int index;
+	u64 uses;
+};
+
+/* Request contexts of one channel, a bit in busy per context in use */
+struct tegra_vse_req_pool {
+	struct tegra_vse_req_ctx *ctx;
+	unsigned long *busy;
+	unsigned int nr;
+	atomic64_t fallbacks;
+};
+
+static struct dentry *tegra_vse_debugfs;
+
 /* Tegra Virtual Security Engine operation modes */
 enum tegra_virtual_se_op_mode {
 	/* Secure Hash Algorithm-1 (SHA1) mode */
@@ -571,14 +635,6 @@ struct tegra_virtual_se_aes_req_context {
 	u8 engine_id;
 };
 
-enum se_engine_id {
-	VIRTUAL_SE_AES0,
-	VIRTUAL_SE_AES1,
-	VIRTUAL_SE_SHA = 2,
-	VIRTUAL_SE_TSEC = 6,
-	VIRTUAL_MAX_SE_ENGINE_NUM = 7
-};
-
 enum tegra_virtual_se_aes_iv_type {
 	AES_ORIGINAL_IV,
 	AES_UPDATED_IV,
@@ -621,6 +677,101 @@ static int32_t validate_header(
 	return ret;
 }
 
+/*
+ * Take a zeroed request context of a channel. The search starts at the
+ * context of the current CPU so parallel submitters rarely meet on the same
+ * bit, and falls back to an allocation when every context is in use.
+ */
+static struct tegra_vse_req_ctx *tegra_hv_vse_safety_get_req(uint32_t node_id)
+{
+	struct tegra_vse_req_pool *pool = g_crypto_to_ivc_map[node_id].req_pool;
+	struct tegra_vse_req_ctx *rctx;
+	unsigned int start, i, idx;
+
+	if (pool) {
+		start = raw_smp_processor_id() % pool->nr;
+		for (i = 0; i < pool->nr; i++) {
+			idx = (start + i) % pool->nr;
+			if (test_and_set_bit_lock(idx, pool->busy))
+				continue;
+
+			rctx = &pool->ctx[idx];
+			memset(&rctx->msg, 0, sizeof(rctx->msg));
+			memset(&rctx->priv, 0, sizeof(rctx->priv));
+			rctx->uses++;
+			return rctx;
+		}
+		atomic64_inc(&pool->fallbacks);
+	}
+
+	return kzalloc(sizeof(*rctx), GFP_KERNEL);
+}
+
+static void tegra_hv_vse_safety_put_req(struct tegra_vse_req_ctx *rctx)
+{
+	if (rctx->pool)
+		clear_bit_unlock(rctx->index, rctx->pool->busy);
+	else
+		kfree(rctx);
+}
+
+static int tegra_hv_vse_safety_req_pool_init(struct tegra_virtual_se_dev *se_dev,
+	struct crypto_dev_to_ivc_map *crypto_dev)
+{
+	struct tegra_vse_req_pool *pool;
+	unsigned int nr, i;
+
+	/* one context per CPU, never more than requests the channel holds */
+	nr = min3(req_ctx_max, (unsigned int)nr_cpu_ids,
+		   (unsigned int)crypto_dev->ivck->nframes);
+	if (nr == 0)
+		return 0;
+
+	pool = devm_kzalloc(se_dev->dev, sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return -ENOMEM;
+
+	pool->ctx = devm_kcalloc(se_dev->dev, nr, sizeof(*pool->ctx), GFP_KERNEL);
+	pool->busy = devm_kcalloc(se_dev->dev, BITS_TO_LONGS(nr),
+			sizeof(*pool->busy), GFP_KERNEL);
+	if (!pool->ctx || !pool->busy)
+		return -ENOMEM;
+
+	for (i = 0; i < nr; i++) {
+		pool->ctx[i].pool = pool;
+		pool->ctx[i].index = i;
+	}
+	pool->nr = nr;
+	atomic64_set(&pool->fallbacks, 0);
+	crypto_dev->req_pool = pool;
+
+	return 0;
+}
+
+static int tegra_hv_vse_safety_req_ctx_show(struct seq_file *s, void *unused)
+{
+	struct tegra_vse_req_pool *pool;
+	uint32_t cnt;
+	unsigned int i;
+
+	for (cnt = 0; cnt < MAX_NUMBER_MISC_DEVICES; cnt++) {
+		pool = g_crypto_to_ivc_map[cnt].req_pool;
+		if (!pool)
+			continue;
+
+		seq_printf(s, "node %u: engine %u contexts %u fallbacks %lld\n",
+			   cnt, g_crypto_to_ivc_map[cnt].se_engine, pool->nr,
+			   (long long)atomic64_read(&pool->fallbacks));
+		for (i = 0; i < pool->nr; i++)
+			seq_printf(s, "  ctx %u: uses %llu%s\n", i,
+				   READ_ONCE(pool->ctx[i].uses),
+				   test_bit(i, pool->busy) ? " busy" : "");
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tegra_hv_vse_safety_req_ctx);
+
 static int read_and_validate_dummy_msg(
 	struct tegra_virtual_se_dev *se_dev,
 	struct tegra_hv_ivc_cookie *pivck,
@@ -648,56 +799,21 @@ static int read_and_validate_dummy_msg(
 	return err;
 }
 
-static int read_and_validate_valid_msg(
+/* hands a valid response over to the request named by its tag */
+static void tegra_hv_vse_safety_handle_resp(
 	struct tegra_virtual_se_dev *se_dev,
-	struct tegra_hv_ivc_cookie *pivck,
-	uint32_t node_id, bool *is_dummy, bool waited)
+	struct tegra_virtual_se_ivc_msg_t *ivc_msg, bool waited)
 {
 	struct tegra_vse_tag *p_dat;
 	struct tegra_vse_priv_data *priv;
-	struct tegra_virtual_se_ivc_msg_t *ivc_msg;
-	struct tegra_virtual_se_ivc_hdr_t *ivc_hdr;
 	struct tegra_virtual_se_aes_req_context *req_ctx;
 	struct tegra_virtual_se_ivc_resp_msg_t *ivc_rx;
-	enum ivc_irq_state *irq_state;
-
-	int read_size = -1, err = 0;
-	size_t size_ivc_msg = sizeof(struct tegra_virtual_se_ivc_msg_t);
-
-	mutex_lock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-	irq_state = &(g_crypto_to_ivc_map[node_id].wait_interrupt);
-	mutex_unlock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
 
-	if (!tegra_hv_ivc_can_read(pivck)) {
-		mutex_lock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-		*irq_state = INTERMEDIATE_REQ_INTERRUPT;
-		mutex_unlock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-		dev_info(se_dev->dev, "%s(): no valid message, await interrupt.\n", __func__);
-		return -EAGAIN;
-	}
-
-	ivc_msg = devm_kzalloc(se_dev->dev, size_ivc_msg, GFP_KERNEL);
-	if (!ivc_msg)
-		return -ENOMEM;
-
-	read_size = tegra_hv_ivc_read(pivck, ivc_msg, size_ivc_msg);
-	if (read_size > 0 && read_size < size_ivc_msg) {
-		dev_err(se_dev->dev, "Wrong read msg len %d\n", read_size);
-		return -EINVAL;
-	}
-	ivc_hdr = &(ivc_msg->ivc_hdr);
-	err = validate_header(se_dev, ivc_hdr, is_dummy);
-	if (err != 0)
-		goto deinit;
-	if (*is_dummy) {
-		dev_err(se_dev->dev, "%s(): Wrong response sequence\n", __func__);
-		goto deinit;
-	}
 	p_dat = (struct tegra_vse_tag *)ivc_msg->ivc_hdr.tag;
 	priv = (struct tegra_vse_priv_data *)p_dat->priv_data;
 	if (!priv) {
 		pr_err("%s no call back info\n", __func__);
-		goto deinit;
+		return;
 	}
 	priv->syncpt_id = ivc_msg->rx[0].syncpt_id;
 	priv->syncpt_threshold = ivc_msg->rx[0].syncpt_threshold;
@@ -741,10 +857,57 @@ static int read_and_validate_valid_msg(
 		break;
 	default:
 		dev_err(se_dev->dev, "Unknown command\n");
-		waited = false;
+		return;
 	}
-	if (waited)
+
+	if (priv->async)
+		tegra_hv_vse_safety_aes_complete(priv);
+	else if (waited)
 		complete(&priv->alg_complete);
+}
+
+static int read_and_validate_valid_msg(
+	struct tegra_virtual_se_dev *se_dev,
+	struct tegra_hv_ivc_cookie *pivck,
+	uint32_t node_id, bool *is_dummy, bool waited)
+{
+	struct tegra_virtual_se_ivc_msg_t *ivc_msg;
+	struct tegra_virtual_se_ivc_hdr_t *ivc_hdr;
+	enum ivc_irq_state *irq_state;
+
+	int read_size = -1, err = 0;
+	size_t size_ivc_msg = sizeof(struct tegra_virtual_se_ivc_msg_t);
+
+	mutex_lock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
+	irq_state = &(g_crypto_to_ivc_map[node_id].wait_interrupt);
+	mutex_unlock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
+
+	if (!tegra_hv_ivc_can_read(pivck)) {
+		mutex_lock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
+		*irq_state = INTERMEDIATE_REQ_INTERRUPT;
+		mutex_unlock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
+		dev_info(se_dev->dev, "%s(): no valid message, await interrupt.\n", __func__);
+		return -EAGAIN;
+	}
+
+	ivc_msg = devm_kzalloc(se_dev->dev, size_ivc_msg, GFP_KERNEL);
+	if (!ivc_msg)
+		return -ENOMEM;
+
+	read_size = tegra_hv_ivc_read(pivck, ivc_msg, size_ivc_msg);
+	if (read_size > 0 && read_size < size_ivc_msg) {
+		dev_err(se_dev->dev, "Wrong read msg len %d\n", read_size);
+		return -EINVAL;
+	}
+	ivc_hdr = &(ivc_msg->ivc_hdr);
+	err = validate_header(se_dev, ivc_hdr, is_dummy);
+	if (err != 0)
+		goto deinit;
+	if (*is_dummy) {
+		dev_err(se_dev->dev, "%s(): Wrong response sequence\n", __func__);
+		goto deinit;
+	}
+	tegra_hv_vse_safety_handle_resp(se_dev, ivc_msg, waited);
 
 deinit:
 	devm_kfree(se_dev->dev, ivc_msg);
@@ -795,13 +958,89 @@ static int tegra_hv_vse_safety_send_ivc(
 	return 0;
 }
 
+/* If this is not last request then wait using nvhost API */
+static int tegra_hv_vse_safety_wait_syncpt(struct tegra_virtual_se_dev *se_dev,
+	struct tegra_vse_priv_data *priv)
+{
+	struct host1x *host1x = platform_get_drvdata(se_dev->host1x_pdev);
+	struct host1x_syncpt *sp;
+	int err;
+
+	if (!priv->syncpt_id_valid)
+		return 0;
+
+	sp = host1x_syncpt_get_by_id_noref(host1x, priv->syncpt_id);
+	if (!sp) {
+		dev_err(se_dev->dev, "No syncpt for syncpt id %d\n", priv->syncpt_id);
+		return -ENODATA;
+	}
+
+	err = host1x_syncpt_wait(sp, priv->syncpt_threshold, (u32)SE_MAX_SCHEDULE_TIMEOUT, NULL);
+	if (err) {
+		dev_err(se_dev->dev, "timed out for syncpt %u threshold %u err %d\n",
+					 priv->syncpt_id, priv->syncpt_threshold, err);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+/*
+ * Send a request without waiting for its response. The response is read by
+ * tegra_vse_kthread, which completes the request.
+ */
+static int tegra_hv_vse_safety_send_ivc_async(
+	struct tegra_virtual_se_dev *se_dev,
+	struct tegra_hv_ivc_cookie *pivck,
+	void *pbuf, int length, uint32_t node_id)
+{
+	struct crypto_dev_to_ivc_map *ivc_map = &g_crypto_to_ivc_map[node_id];
+	unsigned int max_reqs = max(READ_ONCE(max_async_reqs), 1U);
+	int err;
+
+	mutex_lock(&ivc_map->se_ivc_lock);
+
+	if (!se_dev->host1x_pdev || !platform_get_drvdata(se_dev->host1x_pdev)) {
+		dev_err(se_dev->dev, "host1x pdev not initialized\n");
+		err = -ENODATA;
+		goto exit;
+	}
+
+	/* Return error if engine is in suspended state */
+	if (atomic_read(&se_dev->se_suspended)) {
+		err = -ENODEV;
+		goto exit;
+	}
+
+	if (!wait_event_timeout(ivc_map->async_wq,
+			atomic_read(&ivc_map->async_inflight) < max_reqs,
+			TEGRA_HV_VSE_TIMEOUT)) {
+		dev_err(se_dev->dev, "%s timeout\n", __func__);
+		err = -ETIMEDOUT;
+		goto exit;
+	}
+
+	/* counted first, the kthread may read the response at once */
+	atomic_inc(&ivc_map->async_inflight);
+	err = tegra_hv_vse_safety_send_ivc(se_dev, pivck, pbuf, length);
+	if (err) {
+		dev_err(se_dev->dev,
+			"\n %s send ivc failed %d\n", __func__, err);
+		atomic_dec(&ivc_map->async_inflight);
+		wake_up(&ivc_map->async_wq);
+	}
+
+exit:
+	mutex_unlock(&ivc_map->se_ivc_lock);
+	return err;
+}
+
 static int tegra_hv_vse_safety_send_ivc_wait(
 	struct tegra_virtual_se_dev *se_dev,
 	struct tegra_hv_ivc_cookie *pivck,
 	struct tegra_vse_priv_data *priv,
 	void *pbuf, int length, uint32_t node_id)
 {
-	struct host1x_syncpt *sp;
 	struct host1x *host1x;
 	int err;
 	bool is_dummy = false;
@@ -828,6 +1067,16 @@ static int tegra_hv_vse_safety_send_ivc_wait(
 		err = -ENODEV;
 		goto exit;
 	}
+
+	/* responses of asynchronous requests are never read here */
+	if (!wait_event_timeout(g_crypto_to_ivc_map[node_id].async_wq,
+			atomic_read(&g_crypto_to_ivc_map[node_id].async_inflight) == 0,
+			TEGRA_HV_VSE_TIMEOUT)) {
+		dev_err(se_dev->dev, "%s async requests timeout\n", __func__);
+		err = -ETIMEDOUT;
+		goto exit;
+	}
+
 	err = tegra_hv_vse_safety_send_ivc(se_dev, pivck, pbuf, length);
 	if (err) {
 		dev_err(se_dev->dev,
@@ -878,23 +1127,7 @@ static int tegra_hv_vse_safety_send_ivc_wait(
 		}
 	}
 
-	/* If this is not last request then wait using nvhost API*/
-	if (priv->syncpt_id_valid) {
-		sp = host1x_syncpt_get_by_id_noref(host1x, priv->syncpt_id);
-		if (!sp) {
-			dev_err(se_dev->dev, "No syncpt for syncpt id %d\n", priv->syncpt_id);
-			err = -ENODATA;
-			goto exit;
-		}
-
-		err = host1x_syncpt_wait(sp, priv->syncpt_threshold, (u32)SE_MAX_SCHEDULE_TIMEOUT, NULL);
-		if (err) {
-			dev_err(se_dev->dev, "timed out for syncpt %u threshold %u err %d\n",
-						 priv->syncpt_id, priv->syncpt_threshold, err);
-			err = -ETIMEDOUT;
-			goto exit;
-		}
-	}
+	err = tegra_hv_vse_safety_wait_syncpt(se_dev, priv);
 
 exit:
 	mutex_unlock(&g_crypto_to_ivc_map[node_id].se_ivc_lock);
@@ -987,9 +1220,10 @@ static int tegra_hv_vse_safety_count_sgs(struct scatterlist *sl, u32 nbytes)
 
 static int tegra_hv_vse_safety_send_sha_data(struct tegra_virtual_se_dev *se_dev,
 				struct ahash_request *req,
-				struct tegra_virtual_se_ivc_msg_t *ivc_req_msg,
+				struct tegra_vse_req_ctx *rctx,
 				u32 count, bool islast)
 {
+	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg = &rctx->msg;
 	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx = NULL;
 	struct tegra_virtual_se_ivc_hdr_t *ivc_hdr = NULL;
 	struct tegra_virtual_se_sha_context *sha_ctx;
@@ -1009,15 +1243,8 @@ static int tegra_hv_vse_safety_send_sha_data(struct tegra_virtual_se_dev *se_dev
 	sha_ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
 	pivck = g_crypto_to_ivc_map[sha_ctx->node_id].ivck;
 
-	if (!ivc_req_msg) {
-		dev_err(se_dev->dev,
-			"%s Invalid ivc_req_msg\n", __func__);
-		return -EINVAL;
-	}
-
-	priv = devm_kzalloc(se_dev->dev, sizeof(*priv), GFP_KERNEL);
-	if (!priv)
-		return -ENOMEM;
+	priv = &rctx->priv;
+	memset(priv, 0, sizeof(*priv));
 
 	req_ctx = ahash_request_ctx(req);
 	total_count = req_ctx->total_count;
@@ -1072,13 +1299,8 @@ static int tegra_hv_vse_safety_send_sha_data(struct tegra_virtual_se_dev *se_dev
 
 	err = tegra_hv_vse_safety_send_ivc_wait(se_dev, pivck, priv, ivc_req_msg,
 			sizeof(struct tegra_virtual_se_ivc_msg_t), sha_ctx->node_id);
-	if (err) {
+	if (err)
 		dev_err(se_dev->dev, "failed to send data over ivc err %d\n", err);
-		goto exit;
-	}
-
-exit:
-	devm_kfree(se_dev->dev, priv);
 
 	return err;
 }
@@ -1090,12 +1312,15 @@ static int tegra_hv_vse_safety_sha_send_one(struct ahash_request *req,
 	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg;
 	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx = NULL;
 	struct tegra_virtual_se_req_context *req_ctx = ahash_request_ctx(req);
+	struct tegra_virtual_se_sha_context *sha_ctx =
+			crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct tegra_vse_req_ctx *rctx;
 	int err = 0;
 
-	ivc_req_msg = devm_kzalloc(se_dev->dev, sizeof(*ivc_req_msg),
-			GFP_KERNEL);
-	if (!ivc_req_msg)
+	rctx = tegra_hv_vse_safety_get_req(sha_ctx->node_id);
+	if (!rctx)
 		return -ENOMEM;
+	ivc_req_msg = &rctx->msg;
 
 	if (islast == true &&
 			(req_ctx->mode == VIRTUAL_SE_OP_MODE_SHAKE128 ||
@@ -1112,14 +1337,106 @@ static int tegra_hv_vse_safety_sha_send_one(struct ahash_request *req,
 	ivc_tx->sha.op_hash.dst = (u64)req_ctx->hash_result_addr;
 	memcpy(ivc_tx->sha.op_hash.hash, req_ctx->hash_result,
 		req_ctx->intermediate_digest_size);
-	err = tegra_hv_vse_safety_send_sha_data(se_dev, req, ivc_req_msg,
+	err = tegra_hv_vse_safety_send_sha_data(se_dev, req, rctx,
 				nbytes, islast);
-	if (err) {
+	if (err)
 		dev_err(se_dev->dev, "%s error %d\n", __func__, err);
-		goto exit;
+
+	tegra_hv_vse_safety_put_req(rctx);
+	return err;
+}
+
+/*
+ * The engine hashes an SG list in place when every entry but the last one
+ * holds whole blocks, whatever the number of entries.
+ */
+static bool tegra_hv_vse_safety_sha_sg_aligned(struct scatterlist *sl,
+					u32 blk_size)
+{
+	struct scatterlist *sg;
+
+	for (sg = sl; sg && sg_next(sg); sg = sg_next(sg)) {
+		if (sg->length % blk_size)
+			return false;
 	}
-exit:
-	devm_kfree(se_dev->dev, ivc_req_msg);
+
+	return true;
+}
+
+/*
+ * Hash the first nbytes of req->src without copying them. The whole list is
+ * mapped before the first command, entries merged by the IOMMU are hashed as
+ * one, and segments too long for the engine are split in whole blocks. Each
+ * command continues the hash of the previous one, so they run in order.
+ */
+static int tegra_hv_vse_safety_sha_send_sg(struct tegra_virtual_se_dev *se_dev,
+					struct ahash_request *req, u32 nbytes)
+{
+	struct tegra_virtual_se_req_context *req_ctx = ahash_request_ctx(req);
+	struct tegra_virtual_se_sha_context *sha_ctx =
+			crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg;
+	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx;
+	struct tegra_vse_req_ctx *rctx;
+	u32 max_chunk = rounddown(TEGRA_VIRTUAL_SE_MAX_BUFFER_SIZE - 1,
+				req_ctx->blk_size);
+	int nents = sg_nents(req->src);
+	struct scatterlist *sg;
+	dma_addr_t addr;
+	u32 len, chunk;
+	int mapped, i;
+	int err = 0;
+
+	rctx = tegra_hv_vse_safety_get_req(sha_ctx->node_id);
+	if (!rctx)
+		return -ENOMEM;
+	ivc_req_msg = &rctx->msg;
+
+	mapped = dma_map_sg(se_dev->dev, req->src, nents, DMA_TO_DEVICE);
+	if (!mapped) {
+		dev_err(se_dev->dev, "dma_map_sg() error\n");
+		err = -EINVAL;
+		goto free;
+	}
+
+	for_each_sg(req->src, sg, mapped, i) {
+		addr = sg_dma_address(sg);
+		len = min_t(u32, sg_dma_len(sg), nbytes);
+		nbytes -= len;
+
+		while (len) {
+			chunk = min(len, max_chunk);
+
+			memset(ivc_req_msg, 0, sizeof(*ivc_req_msg));
+			ivc_tx = &ivc_req_msg->tx[0];
+			ivc_tx->sha.op_hash.src_addr.lo = addr;
+			ivc_tx->sha.op_hash.src_addr.hi = chunk;
+			ivc_tx->sha.op_hash.dst = (u64)req_ctx->hash_result_addr;
+			memcpy(ivc_tx->sha.op_hash.hash, req_ctx->hash_result,
+				req_ctx->intermediate_digest_size);
+
+			req_ctx->total_count += chunk;
+			err = tegra_hv_vse_safety_send_sha_data(se_dev, req,
+					rctx, chunk, false);
+			if (err) {
+				dev_err(se_dev->dev, "%s error %d\n",
+					__func__, err);
+				goto unmap;
+			}
+
+			addr += chunk;
+			len -= chunk;
+		}
+
+		if (!nbytes)
+			break;
+	}
+
+unmap:
+	dma_unmap_sg(se_dev->dev, req->src, nents, DMA_TO_DEVICE);
+free:
+	tegra_hv_vse_safety_put_req(rctx);
+
 	return err;
 }
 
@@ -1127,14 +1444,8 @@ static int tegra_hv_vse_safety_sha_fast_path(struct ahash_request *req,
 					bool is_last, bool process_cur_req)
 {
 	struct tegra_virtual_se_dev *se_dev = g_virtual_se_dev[VIRTUAL_SE_SHA];
-	u32 bytes_process_in_req = 0, num_blks;
-	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg;
-	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx = NULL;
-	struct tegra_virtual_se_addr *src_addr = NULL;
+	u32 bytes_process_in_req = 0, num_blks;
 	struct tegra_virtual_se_req_context *req_ctx = ahash_request_ctx(req);
-	u32 num_mapped_sgs = 0;
-	u32 num_lists = 0;
-	struct scatterlist *sg;
 	int err = 0;
 	u32 nbytes_in_req = req->nbytes;
 
@@ -1188,57 +1499,17 @@ static int tegra_hv_vse_safety_sha_fast_path(struct ahash_request *req,
 			__func__, req_ctx->residual_bytes);
 
 		if (num_blks > 0) {
-			ivc_req_msg = devm_kzalloc(se_dev->dev,
-				sizeof(*ivc_req_msg), GFP_KERNEL);
-			if (!ivc_req_msg)
-				return -ENOMEM;
-
-			ivc_tx = &ivc_req_msg->tx[0];
-			src_addr = &ivc_tx->sha.op_hash.src_addr;
-
 			bytes_process_in_req = num_blks * req_ctx->blk_size;
 			dev_dbg(se_dev->dev, "%s: bytes_process_in_req %u\n",
 				__func__, bytes_process_in_req);
 
-			err = tegra_hv_vse_safety_prepare_ivc_linked_list(se_dev,
-					req->src, bytes_process_in_req,
-					(TEGRA_HV_VSE_SHA_MAX_LL_NUM_1 -
-						num_lists),
-					req_ctx->blk_size,
-					src_addr,
-					&num_lists,
-					DMA_TO_DEVICE, &num_mapped_sgs);
-			if (err) {
-				dev_err(se_dev->dev, "%s: ll error %d\n",
-					__func__, err);
-				goto unmap;
-			}
-
-			dev_dbg(se_dev->dev, "%s: num_lists %u\n",
-				__func__, num_lists);
-
-			ivc_tx->sha.op_hash.dst
-				= (u64)req_ctx->hash_result_addr;
-			memcpy(ivc_tx->sha.op_hash.hash,
-				req_ctx->hash_result,
-				req_ctx->intermediate_digest_size);
-
-			req_ctx->total_count += bytes_process_in_req;
-
-			err = tegra_hv_vse_safety_send_sha_data(se_dev, req,
-				ivc_req_msg, bytes_process_in_req, false);
+			err = tegra_hv_vse_safety_sha_send_sg(se_dev, req,
+					bytes_process_in_req);
 			if (err) {
 				dev_err(se_dev->dev, "%s error %d\n",
 					__func__, err);
-				goto unmap;
-			}
-unmap:
-			sg = req->src;
-			while (sg && num_mapped_sgs--) {
-				dma_unmap_sg(se_dev->dev, sg, 1, DMA_TO_DEVICE);
-				sg = sg_next(sg);
+				return err;
 			}
-			devm_kfree(se_dev->dev, ivc_req_msg);
 		}
 
 		if (req_ctx->residual_bytes > 0 &&
@@ -1538,7 +1809,7 @@ static int tegra_hv_vse_safety_sha_op(struct ahash_request *req, bool is_last,
 
 	num_blks = req->nbytes / req_ctx->blk_size;
 
-	if (sg_nents(req->src) > 1)
+	if (!tegra_hv_vse_safety_sha_sg_aligned(req->src, req_ctx->blk_size))
 		req_ctx->force_align = true;
 
 	if (req_ctx->force_align == false && num_blks > 0)
@@ -1927,6 +2198,57 @@ static int tegra_hv_vse_safety_aes_gen_random_iv(
 	return err;
 }
 
+/* Copy the result of an answered request to its destination */
+static int tegra_hv_vse_safety_aes_finish(struct tegra_vse_priv_data *priv)
+{
+	struct skcipher_request *req = priv->req;
+	struct tegra_virtual_se_aes_req_context *req_ctx = skcipher_request_ctx(req);
+	struct tegra_virtual_se_aes_context *aes_ctx =
+		crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+	int num_sgs;
+
+	if (priv->rx_status == 0U) {
+		dma_sync_single_for_cpu(priv->se_dev->dev, priv->buf_addr,
+			req->cryptlen, DMA_BIDIRECTIONAL);
+
+		num_sgs = tegra_hv_vse_safety_count_sgs(req->dst, req->cryptlen);
+		if (num_sgs == 1)
+			memcpy(sg_virt(req->dst), priv->buf, req->cryptlen);
+		else
+			sg_copy_from_buffer(req->dst, num_sgs,
+					priv->buf, req->cryptlen);
+
+		if (((req_ctx->op_mode == AES_CBC)
+				|| (req_ctx->op_mode == AES_CTR))
+				&& req_ctx->encrypt == true && aes_ctx->user_nonce == 0U)
+			memcpy(req->iv, priv->iv, TEGRA_VIRTUAL_SE_AES_IV_SIZE);
+	} else {
+		dev_err(priv->se_dev->dev,
+				"%s: SE server returned error %u\n",
+				__func__, priv->rx_status);
+	}
+
+	return status_to_errno(priv->rx_status);
+}
+
+/* Called by tegra_vse_kthread with the response of an asynchronous request */
+static void tegra_hv_vse_safety_aes_complete(struct tegra_vse_priv_data *priv)
+{
+	struct tegra_virtual_se_dev *se_dev = priv->se_dev;
+	struct skcipher_request *req = priv->req;
+	int err;
+
+	err = tegra_hv_vse_safety_wait_syncpt(se_dev, priv);
+	if (!err)
+		err = tegra_hv_vse_safety_aes_finish(priv);
+
+	dma_unmap_sg(se_dev->dev, &priv->sg, 1, DMA_BIDIRECTIONAL);
+	kfree(priv->buf);
+	devm_kfree(se_dev->dev, priv);
+
+	skcipher_request_complete(req, err);
+}
+
 static int tegra_hv_vse_safety_process_aes_req(struct tegra_virtual_se_dev *se_dev,
 		struct skcipher_request *req)
 {
@@ -2028,6 +2350,20 @@ static int tegra_hv_vse_safety_process_aes_req(struct tegra_virtual_se_dev *se_d
 	aes->op.dst_addr.lo = priv->buf_addr;
 	aes->op.dst_addr.hi = req->cryptlen;
 
+	if (READ_ONCE(max_async_reqs) != 0U) {
+		priv->async = true;
+		err = tegra_hv_vse_safety_send_ivc_async(se_dev, pivck, ivc_req_msg,
+				sizeof(struct tegra_virtual_se_ivc_msg_t), aes_ctx->node_id);
+		if (err) {
+			dev_err(se_dev->dev, "failed to send data over ivc err %d\n", err);
+			goto exit;
+		}
+
+		/* priv and its buffer are released when the response arrives */
+		devm_kfree(se_dev->dev, ivc_req_msg);
+		return -EINPROGRESS;
+	}
+
 	init_completion(&priv->alg_complete);
 
 	err = tegra_hv_vse_safety_send_ivc_wait(se_dev, pivck, priv, ivc_req_msg,
@@ -2037,28 +2373,7 @@ static int tegra_hv_vse_safety_process_aes_req(struct tegra_virtual_se_dev *se_d
 		goto exit;
 	}
 
-	if (priv->rx_status == 0U) {
-		dma_sync_single_for_cpu(priv->se_dev->dev, priv->buf_addr,
-			req->cryptlen, DMA_BIDIRECTIONAL);
-
-		num_sgs = tegra_hv_vse_safety_count_sgs(req->dst, req->cryptlen);
-		if (num_sgs == 1)
-			memcpy(sg_virt(req->dst), priv->buf, req->cryptlen);
-		else
-			sg_copy_from_buffer(req->dst, num_sgs,
-					priv->buf, req->cryptlen);
-
-		if (((req_ctx->op_mode == AES_CBC)
-				|| (req_ctx->op_mode == AES_CTR))
-				&& req_ctx->encrypt == true && aes_ctx->user_nonce == 0U)
-			memcpy(req->iv, priv->iv, TEGRA_VIRTUAL_SE_AES_IV_SIZE);
-	} else {
-		dev_err(se_dev->dev,
-				"%s: SE server returned error %u\n",
-				__func__, priv->rx_status);
-	}
-
-	err = status_to_errno(priv->rx_status);
+	err = tegra_hv_vse_safety_aes_finish(priv);
 
 exit:
 	if (dma_ents > 0)
@@ -2114,7 +2429,7 @@ static int tegra_hv_vse_safety_aes_cbc_encrypt(struct skcipher_request *req)
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
+	if (err && err != -EINPROGRESS)
 		dev_err(req_ctx->se_dev->dev,
 				"%s failed with error %d\n", __func__, err);
 	return err;
@@ -2138,7 +2453,7 @@ static int tegra_hv_vse_safety_aes_cbc_decrypt(struct skcipher_request *req)
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
+	if (err && err != -EINPROGRESS)
 		dev_err(req_ctx->se_dev->dev,
 				"%s failed with error %d\n", __func__, err);
 	return err;
@@ -2162,7 +2477,7 @@ static int tegra_hv_vse_safety_aes_ecb_encrypt(struct skcipher_request *req)
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
+	if (err && err != -EINPROGRESS)
 		dev_err(req_ctx->se_dev->dev,
 				"%s failed with error %d\n", __func__, err);
 	return err;
@@ -2186,7 +2501,7 @@ static int tegra_hv_vse_safety_aes_ecb_decrypt(struct skcipher_request *req)
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
+	if (err && err != -EINPROGRESS)
 		dev_err(req_ctx->se_dev->dev,
 				"%s failed with error %d\n", __func__, err);
 	return err;
@@ -2217,7 +2532,7 @@ static int tegra_hv_vse_safety_aes_ctr_encrypt(struct skcipher_request *req)
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
+	if (err && err != -EINPROGRESS)
 		dev_err(req_ctx->se_dev->dev,
 				"%s failed with error %d\n", __func__, err);
 	return err;
@@ -2241,7 +2556,7 @@ static int tegra_hv_vse_safety_aes_ctr_decrypt(struct skcipher_request *req)
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
+	if (err && err != -EINPROGRESS)
 		dev_err(req_ctx->se_dev->dev,
 				"%s failed with error %d\n", __func__, err);
 	return err;
@@ -2268,6 +2583,7 @@ static int tegra_hv_vse_safety_cmac_op(struct ahash_request *req, bool is_last)
 	int err = 0;
 	int num_lists = 0;
 	struct tegra_vse_priv_data *priv = NULL;
+	struct tegra_vse_req_ctx *rctx = NULL;
 	struct tegra_vse_tag *priv_data_ptr;
 	unsigned int num_mapped_sgs = 0;
 
@@ -2288,16 +2604,11 @@ static int tegra_hv_vse_safety_cmac_op(struct ahash_request *req, bool is_last)
 		last_block_bytes = 0;
 	}
 
-	ivc_req_msg = devm_kzalloc(se_dev->dev,
-		sizeof(*ivc_req_msg), GFP_KERNEL);
-	if (!ivc_req_msg)
-		return -ENOMEM;
-
-	priv = devm_kzalloc(se_dev->dev, sizeof(*priv), GFP_KERNEL);
-	if (!priv) {
-		devm_kfree(se_dev->dev, ivc_req_msg);
+	rctx = tegra_hv_vse_safety_get_req(cmac_ctx->node_id);
+	if (!rctx)
 		return -ENOMEM;
-	}
+	ivc_req_msg = &rctx->msg;
+	priv = &rctx->priv;
 
 	ivc_tx = &ivc_req_msg->tx[0];
 	ivc_hdr = &ivc_req_msg->ivc_hdr;
@@ -2411,8 +2722,7 @@ unmap_exit:
 		src_sg = sg_next(src_sg);
 	}
 free_mem:
-	devm_kfree(se_dev->dev, priv);
-	devm_kfree(se_dev->dev, ivc_req_msg);
+	tegra_hv_vse_safety_put_req(rctx);
 
 	return err;
 
@@ -2431,6 +2741,7 @@ static int tegra_hv_vse_safety_tsec_sv_op(struct ahash_request *req)
 	struct tegra_hv_ivc_cookie *pivck = g_crypto_to_ivc_map[cmac_ctx->node_id].ivck;
 	int err = 0;
 	struct tegra_vse_priv_data *priv = NULL;
+	struct tegra_vse_req_ctx *rctx = NULL;
 	struct tegra_vse_tag *priv_data_ptr;
 	dma_addr_t src_buf_addr;
 	void *src_buf = NULL;
@@ -2440,16 +2751,11 @@ static int tegra_hv_vse_safety_tsec_sv_op(struct ahash_request *req)
 		return -EINVAL;
 	}
 
-	ivc_req_msg = devm_kzalloc(se_dev->dev,
-		sizeof(*ivc_req_msg), GFP_KERNEL);
-	if (!ivc_req_msg)
-		return -ENOMEM;
-
-	priv = devm_kzalloc(se_dev->dev, sizeof(*priv), GFP_KERNEL);
-	if (!priv) {
-		devm_kfree(se_dev->dev, ivc_req_msg);
+	rctx = tegra_hv_vse_safety_get_req(cmac_ctx->node_id);
+	if (!rctx)
 		return -ENOMEM;
-	}
+	ivc_req_msg = &rctx->msg;
+	priv = &rctx->priv;
 
 	cmac_req_data = (struct tegra_vse_cmac_req_data *) req->priv;
 
@@ -2551,8 +2857,7 @@ unmap_exit:
 		dma_free_coherent(se_dev->dev, req->nbytes, src_buf, src_buf_addr);
 
 free_mem:
-	devm_kfree(se_dev->dev, priv);
-	devm_kfree(se_dev->dev, ivc_req_msg);
+	tegra_hv_vse_safety_put_req(rctx);
 
 	return err;
 }
@@ -2575,6 +2880,7 @@ static int tegra_hv_vse_safety_cmac_sv_op(struct ahash_request *req, bool is_las
 	int err = 0;
 	int num_lists = 0;
 	struct tegra_vse_priv_data *priv = NULL;
+	struct tegra_vse_req_ctx *rctx = NULL;
 	struct tegra_vse_tag *priv_data_ptr;
 	unsigned int num_mapped_sgs = 0;
 
@@ -2596,16 +2902,11 @@ static int tegra_hv_vse_safety_cmac_sv_op(struct ahash_request *req, bool is_las
 		last_block_bytes = TEGRA_VIRTUAL_SE_AES_BLOCK_SIZE;
 	}
 
-	ivc_req_msg = devm_kzalloc(se_dev->dev,
-		sizeof(*ivc_req_msg), GFP_KERNEL);
-	if (!ivc_req_msg)
-		return -ENOMEM;
-
-	priv = devm_kzalloc(se_dev->dev, sizeof(*priv), GFP_KERNEL);
-	if (!priv) {
-		devm_kfree(se_dev->dev, ivc_req_msg);
+	rctx = tegra_hv_vse_safety_get_req(cmac_ctx->node_id);
+	if (!rctx)
 		return -ENOMEM;
-	}
+	ivc_req_msg = &rctx->msg;
+	priv = &rctx->priv;
 
 	cmac_req_data = (struct tegra_vse_cmac_req_data *) req->priv;
 
@@ -2737,8 +3038,7 @@ unmap_exit:
 		src_sg = sg_next(src_sg);
 	}
 free_mem:
-	devm_kfree(se_dev->dev, priv);
-	devm_kfree(se_dev->dev, ivc_req_msg);
+	tegra_hv_vse_safety_put_req(rctx);
 
 	return err;
 
@@ -3208,7 +3508,7 @@ static void tegra_hv_vse_safety_rng_drbg_exit(struct crypto_tfm *tfm)
 	rng_ctx->se_dev = NULL;
 }
 
-static int tegra_hv_vse_safety_get_random(struct tegra_virtual_se_rng_context *rng_ctx,
+static int tegra_hv_vse_safety_rng_ivc(struct tegra_virtual_se_rng_context *rng_ctx,
 	u8 *rdata, unsigned int dlen)
 {
 	struct tegra_virtual_se_dev *se_dev = rng_ctx->se_dev;
@@ -3219,6 +3519,7 @@ static int tegra_hv_vse_safety_get_random(struct tegra_virtual_se_rng_context *r
 	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg;
 	struct tegra_virtual_se_ivc_hdr_t *ivc_hdr = NULL;
 	struct tegra_vse_priv_data *priv = NULL;
+	struct tegra_vse_req_ctx *rctx = NULL;
 	struct tegra_vse_tag *priv_data_ptr;
 
 	if (dlen == 0) {
@@ -3230,18 +3531,11 @@ static int tegra_hv_vse_safety_get_random(struct tegra_virtual_se_rng_context *r
 	if (data_len == 0)
 		num_blocks = num_blocks - 1;
 
-	ivc_req_msg = devm_kzalloc(se_dev->dev,
-				sizeof(*ivc_req_msg),
-				GFP_KERNEL);
-	if (!ivc_req_msg)
+	rctx = tegra_hv_vse_safety_get_req(rng_ctx->node_id);
+	if (!rctx)
 		return -ENOMEM;
-
-	priv = devm_kzalloc(se_dev->dev, sizeof(*priv), GFP_KERNEL);
-	if (!priv) {
-		dev_err(se_dev->dev, "Priv Data allocation failed\n");
-		devm_kfree(se_dev->dev, ivc_req_msg);
-		return 0;
-	}
+	ivc_req_msg = &rctx->msg;
+	priv = &rctx->priv;
 
 	ivc_tx = &ivc_req_msg->tx[0];
 	ivc_hdr = &ivc_req_msg->ivc_hdr;
@@ -3283,8 +3577,76 @@ static int tegra_hv_vse_safety_get_random(struct tegra_virtual_se_rng_context *r
 		}
 	}
 exit:
-	devm_kfree(se_dev->dev, priv);
-	devm_kfree(se_dev->dev, ivc_req_msg);
+	tegra_hv_vse_safety_put_req(rctx);
+	return err;
+}
+
+static void tegra_hv_vse_safety_rng_refill(struct work_struct *work)
+{
+	struct tegra_vse_rng_pool *pool =
+		container_of(work, struct tegra_vse_rng_pool, refill);
+	u8 chunk[TEGRA_VSE_RNG_REFILL_CHUNK];
+	unsigned int room;
+
+	while (!atomic_read(&pool->ctx.se_dev->se_suspended)) {
+		mutex_lock(&pool->lock);
+		room = pool->size - pool->avail;
+		mutex_unlock(&pool->lock);
+		if (room == 0)
+			break;
+
+		/* the server is asked without the pool lock, readers go on */
+		room = min_t(unsigned int, room, sizeof(chunk));
+		if (tegra_hv_vse_safety_rng_ivc(&pool->ctx, chunk, room))
+			break;
+
+		mutex_lock(&pool->lock);
+		room = min(room, pool->size - pool->avail);
+		memcpy(pool->buf + pool->avail, chunk, room);
+		pool->avail += room;
+		mutex_unlock(&pool->lock);
+	}
+
+	memzero_explicit(chunk, sizeof(chunk));
+}
+
+/* bytes served from the end of the pool, the rest is left to the caller */
+static unsigned int tegra_hv_vse_safety_rng_pool_take(struct tegra_vse_rng_pool *pool,
+	u8 *rdata, unsigned int dlen)
+{
+	unsigned int n;
+
+	mutex_lock(&pool->lock);
+	n = min(dlen, pool->avail);
+	pool->avail -= n;
+	memcpy(rdata, pool->buf + pool->avail, n);
+	memzero_explicit(pool->buf + pool->avail, n);
+	if (pool->avail < min(rng_pool_watermark, pool->size))
+		schedule_work(&pool->refill);
+	mutex_unlock(&pool->lock);
+
+	return n;
+}
+
+static int tegra_hv_vse_safety_get_random(struct tegra_virtual_se_rng_context *rng_ctx,
+	u8 *rdata, unsigned int dlen)
+{
+	struct tegra_vse_rng_pool *pool = g_crypto_to_ivc_map[rng_ctx->node_id].rng_pool;
+	unsigned int n = 0;
+	int err;
+
+	if (dlen == 0)
+		return -EINVAL;
+
+	if (pool)
+		n = tegra_hv_vse_safety_rng_pool_take(pool, rdata, dlen);
+
+	if (n < dlen) {
+		err = tegra_hv_vse_safety_rng_ivc(rng_ctx, rdata + n, dlen - n);
+		if (err)
+			return err;
+	}
+
 	return dlen;
 }
 
@@ -3426,6 +3788,7 @@ static int tegra_vse_aes_gcm_enc_dec(struct aead_request *req, bool encrypt)
 	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx;
 	struct tegra_hv_ivc_cookie *pivck = g_crypto_to_ivc_map[aes_ctx->node_id].ivck;
 	struct tegra_vse_priv_data *priv = NULL;
+	struct tegra_vse_req_ctx *rctx = NULL;
 	struct tegra_vse_tag *priv_data_ptr;
 	int err = 0;
 	uint32_t cryptlen = 0;
@@ -3501,19 +3864,13 @@ static int tegra_vse_aes_gcm_enc_dec(struct aead_request *req, bool encrypt)
 		}
 	}
 
-	priv = devm_kzalloc(se_dev->dev, sizeof(*priv), GFP_KERNEL);
-
-	if (!priv) {
-		err = -ENOMEM;
-		goto free_exit;
-	}
-
-	ivc_req_msg = devm_kzalloc(se_dev->dev, sizeof(*ivc_req_msg),
-						GFP_KERNEL);
-	if (!ivc_req_msg) {
+	rctx = tegra_hv_vse_safety_get_req(aes_ctx->node_id);
+	if (!rctx) {
 		err = -ENOMEM;
 		goto free_exit;
 	}
+	ivc_req_msg = &rctx->msg;
+	priv = &rctx->priv;
 
 	ivc_tx = &ivc_req_msg->tx[0];
 	ivc_hdr = &ivc_req_msg->ivc_hdr;
@@ -3651,11 +4008,8 @@ static int tegra_vse_aes_gcm_enc_dec(struct aead_request *req, bool encrypt)
 		src_buf, cryptlen, req->assoclen);
 
 free_exit:
-	if (ivc_req_msg)
-		devm_kfree(se_dev->dev, ivc_req_msg);
-
-	if (priv)
-		devm_kfree(se_dev->dev, priv);
+	if (rctx)
+		tegra_hv_vse_safety_put_req(rctx);
 
 	if (tag_buf)
 		dma_free_coherent(se_dev->dev, aes_ctx->authsize, tag_buf,
@@ -3803,6 +4157,7 @@ static int tegra_hv_vse_aes_gmac_sv_init(struct ahash_request *req)
 	struct tegra_hv_ivc_cookie *pivck;
 	struct tegra_vse_tag *priv_data_ptr = NULL;
 	struct tegra_vse_priv_data *priv = NULL;
+	struct tegra_vse_req_ctx *rctx = NULL;
 	int err = 0;
 
 	if (!req) {
@@ -3851,18 +4206,13 @@ static int tegra_hv_vse_aes_gmac_sv_init(struct ahash_request *req)
 		goto exit;
 	}
 
-	priv = devm_kzalloc(se_dev->dev, sizeof(*priv), GFP_KERNEL);
-	if (!priv) {
+	rctx = tegra_hv_vse_safety_get_req(gmac_ctx->node_id);
+	if (!rctx) {
 		err = -ENOMEM;
 		goto exit;
 	}
-
-	ivc_req_msg = devm_kzalloc(se_dev->dev, sizeof(*ivc_req_msg),
-						GFP_KERNEL);
-	if (!ivc_req_msg) {
-		err = -ENOMEM;
-		goto free_exit;
-	}
+	ivc_req_msg = &rctx->msg;
+	priv = &rctx->priv;
 
 	ivc_tx = &ivc_req_msg->tx[0];
 	ivc_hdr = &ivc_req_msg->ivc_hdr;
@@ -3919,11 +4269,8 @@ static int tegra_hv_vse_aes_gmac_sv_init(struct ahash_request *req)
 	memcpy(gmac_req_data->iv, priv->iv, TEGRA_VIRTUAL_SE_AES_GCM_IV_SIZE);
 
 free_exit:
-	if (ivc_req_msg)
-		devm_kfree(se_dev->dev, ivc_req_msg);
-
-	if (priv)
-		devm_kfree(se_dev->dev, priv);
+	if (rctx)
+		tegra_hv_vse_safety_put_req(rctx);
 
 exit:
 	return err;
@@ -3965,6 +4312,7 @@ static int tegra_hv_vse_aes_gmac_sv_op(struct ahash_request *req, bool is_last)
 	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx;
 	struct tegra_hv_ivc_cookie *pivck;
 	struct tegra_vse_priv_data *priv = NULL;
+	struct tegra_vse_req_ctx *rctx = NULL;
 	struct tegra_vse_tag *priv_data_ptr;
 	void *aad_buf = NULL;
 	void *tag_buf = NULL;
@@ -4006,18 +4354,13 @@ static int tegra_hv_vse_aes_gmac_sv_op(struct ahash_request *req, bool is_last)
 		}
 	}
 
-	priv = devm_kzalloc(se_dev->dev, sizeof(*priv), GFP_KERNEL);
-	if (!priv) {
-		err = -ENOMEM;
-		goto free_exit;
-	}
-
-	ivc_req_msg = devm_kzalloc(se_dev->dev, sizeof(*ivc_req_msg),
-						GFP_KERNEL);
-	if (!ivc_req_msg) {
+	rctx = tegra_hv_vse_safety_get_req(gmac_ctx->node_id);
+	if (!rctx) {
 		err = -ENOMEM;
 		goto free_exit;
 	}
+	ivc_req_msg = &rctx->msg;
+	priv = &rctx->priv;
 
 	ivc_tx = &ivc_req_msg->tx[0];
 	ivc_hdr = &ivc_req_msg->ivc_hdr;
@@ -4105,11 +4448,8 @@ static int tegra_hv_vse_aes_gmac_sv_op(struct ahash_request *req, bool is_last)
 	}
 
 free_exit:
-	if (ivc_req_msg)
-		devm_kfree(se_dev->dev, ivc_req_msg);
-
-	if (priv)
-		devm_kfree(se_dev->dev, priv);
+	if (rctx)
+		tegra_hv_vse_safety_put_req(rctx);
 
 	if (tag_buf)
 		dma_free_coherent(se_dev->dev, gmac_ctx->authsize, tag_buf, tag_buf_addr);
@@ -4633,6 +4973,45 @@ static irqreturn_t tegra_vse_irq_handler(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+/*
+ * Only asynchronous requests are outstanding while async_inflight is set, so
+ * fillers are skipped and every valid response completes the request named
+ * by its tag, in whatever order the server answers.
+ */
+static void tegra_vse_read_async_resps(struct tegra_virtual_se_dev *se_dev,
+	struct tegra_hv_ivc_cookie *pivck, uint32_t node_id,
+	struct tegra_virtual_se_ivc_msg_t *ivc_msg)
+{
+	struct crypto_dev_to_ivc_map *ivc_map = &g_crypto_to_ivc_map[node_id];
+	size_t size_ivc_msg = sizeof(struct tegra_virtual_se_ivc_msg_t);
+	bool is_dummy = false;
+	int read_size;
+
+	while (atomic_read(&ivc_map->async_inflight) != 0 &&
+			tegra_hv_ivc_can_read(pivck)) {
+		read_size = tegra_hv_ivc_read(pivck, ivc_msg, size_ivc_msg);
+		if (read_size < 0 || read_size < size_ivc_msg) {
+			dev_err(se_dev->dev, "Wrong read msg len %d\n", read_size);
+			break;
+		}
+
+		if (validate_header(se_dev, &ivc_msg->ivc_hdr, &is_dummy) != 0 ||
+				is_dummy)
+			continue;
+
+		tegra_hv_vse_safety_handle_resp(se_dev, ivc_msg, false);
+
+		/* the next synchronous request starts from a clean sequence */
+		if (atomic_read(&ivc_map->async_inflight) == 1) {
+			mutex_lock(&ivc_map->irq_state_lock);
+			ivc_map->wait_interrupt = NO_INTERRUPT;
+			mutex_unlock(&ivc_map->irq_state_lock);
+		}
+		atomic_dec(&ivc_map->async_inflight);
+		wake_up(&ivc_map->async_wq);
+	}
+}
+
 static int tegra_vse_kthread(void *data)
 {
 	uint32_t node_id = *((uint32_t *)data);
@@ -4685,6 +5064,11 @@ static int tegra_vse_kthread(void *data)
 			continue;
 		}
 
+		if (atomic_read(&g_crypto_to_ivc_map[node_id].async_inflight) != 0) {
+			tegra_vse_read_async_resps(se_dev, pivck, node_id, ivc_msg);
+			continue;
+		}
+
 		mutex_lock(&(se_dev->crypto_to_ivc_map[node_id].irq_state_lock));
 		irq_state = &(se_dev->crypto_to_ivc_map[node_id].wait_interrupt);
 		local_irq_state = *irq_state;
@@ -4741,6 +5125,57 @@ static int tegra_vse_kthread(void *data)
 	return 0;
 }
 
+static int tegra_hv_vse_safety_rng_pool_init(struct tegra_virtual_se_dev *se_dev,
+	struct crypto_dev_to_ivc_map *crypto_dev)
+{
+	struct tegra_vse_rng_pool *pool;
+
+	if (rng_pool_size == 0)
+		return 0;
+
+	pool = devm_kzalloc(se_dev->dev, sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return -ENOMEM;
+
+	pool->buf = devm_kzalloc(se_dev->dev, rng_pool_size, GFP_KERNEL);
+	if (!pool->buf)
+		return -ENOMEM;
+
+	pool->ctx.rng_buf = dmam_alloc_coherent(se_dev->dev,
+			TEGRA_VIRTUAL_SE_RNG_DT_SIZE, &pool->ctx.rng_buf_adr,
+			GFP_KERNEL);
+	if (!pool->ctx.rng_buf)
+		return -ENOMEM;
+
+	pool->ctx.se_dev = se_dev;
+	pool->ctx.node_id = crypto_dev->node_id;
+	pool->size = rng_pool_size;
+	mutex_init(&pool->lock);
+	INIT_WORK(&pool->refill, tegra_hv_vse_safety_rng_refill);
+	crypto_dev->rng_pool = pool;
+
+	return 0;
+}
+
+/* start or stop the refill of all RNG pools of an engine */
+static void tegra_hv_vse_safety_rng_pools_run(struct tegra_virtual_se_dev *se_dev,
+	bool run)
+{
+	uint32_t cnt;
+
+	for (cnt = 0; cnt < MAX_NUMBER_MISC_DEVICES; cnt++) {
+		struct tegra_vse_rng_pool *pool = g_crypto_to_ivc_map[cnt].rng_pool;
+
+		if (!pool || pool->ctx.se_dev != se_dev)
+			continue;
+
+		if (run)
+			schedule_work(&pool->refill);
+		else
+			cancel_work_sync(&pool->refill);
+	}
+}
+
 #if defined(CONFIG_HW_RANDOM)
 static int tegra_hv_vse_safety_hwrng_read(struct hwrng *rng, void *buf, size_t size, bool wait)
 {
@@ -5019,6 +5454,8 @@ static int tegra_hv_vse_safety_probe(struct platform_device *pdev)
 		init_completion(&crypto_dev->tegra_vse_complete);
 		mutex_init(&crypto_dev->se_ivc_lock);
 		mutex_init(&crypto_dev->irq_state_lock);
+		atomic_set(&crypto_dev->async_inflight, 0);
+		init_waitqueue_head(&crypto_dev->async_wq);
 
 		crypto_dev->tegra_vse_task = kthread_run(tegra_vse_kthread, &crypto_dev->node_id,
 								"tegra_vse_kthread-%u", node_id);
@@ -5037,6 +5474,22 @@ static int tegra_hv_vse_safety_probe(struct platform_device *pdev)
 			goto exit;
 		}
 		crypto_dev->wait_interrupt = FIRST_REQ_INTERRUPT;
+
+		err = tegra_hv_vse_safety_req_pool_init(se_dev, crypto_dev);
+		if (err) {
+			dev_err(se_dev->dev,
+				"Failed to allocate request contexts for node id %u\n", node_id);
+			goto exit;
+		}
+
+		if (engine_id == VIRTUAL_SE_AES0) {
+			err = tegra_hv_vse_safety_rng_pool_init(se_dev, crypto_dev);
+			if (err) {
+				dev_err(se_dev->dev,
+					"Failed to allocate rng pool for node id %u\n", node_id);
+				goto exit;
+			}
+		}
 	}
 
 	if (pdev->dev.of_node) {
@@ -5128,6 +5581,7 @@ static int tegra_hv_vse_safety_probe(struct platform_device *pdev)
 	/* Set Engine suspended state to false*/
 	atomic_set(&se_dev->se_suspended, 0);
 	platform_set_drvdata(pdev, se_dev);
+	tegra_hv_vse_safety_rng_pools_run(se_dev, true);
 
 	return 0;
 
@@ -5150,13 +5604,15 @@ static void tegra_hv_vse_safety_shutdown(struct platform_device *pdev)
 
 	/* Set engine to suspend state */
 	atomic_set(&se_dev->se_suspended, 1);
+	tegra_hv_vse_safety_rng_pools_run(se_dev, false);
 
 	for (cnt = 0; cnt < MAX_NUMBER_MISC_DEVICES; cnt++) {
 		if (g_crypto_to_ivc_map[cnt].se_engine == se_dev->engine_id
 				&& g_crypto_to_ivc_map[cnt].ivck != NULL) {
 			/* Wait for  SE server to be free*/
 			while (mutex_is_locked(&g_crypto_to_ivc_map[cnt].se_ivc_lock)
-				|| mutex_is_locked(&g_crypto_to_ivc_map[cnt].irq_state_lock))
+				|| mutex_is_locked(&g_crypto_to_ivc_map[cnt].irq_state_lock)
+				|| atomic_read(&g_crypto_to_ivc_map[cnt].async_inflight))
 				usleep_range(8, 10);
 		}
 	}
@@ -5164,9 +5620,19 @@ static void tegra_hv_vse_safety_shutdown(struct platform_device *pdev)
 
 static int tegra_hv_vse_safety_remove(struct platform_device *pdev)
 {
+	struct tegra_virtual_se_dev *se_dev = platform_get_drvdata(pdev);
+	uint32_t cnt;
 	int i;
 
-	tegra_hv_vse_safety_unregister_hwrng(platform_get_drvdata(pdev));
+	tegra_hv_vse_safety_unregister_hwrng(se_dev);
+	tegra_hv_vse_safety_rng_pools_run(se_dev, false);
+
+	/* the contexts are device managed, hide them from debugfs */
+	for (cnt = 0; cnt < MAX_NUMBER_MISC_DEVICES; cnt++) {
+		if (g_crypto_to_ivc_map[cnt].req_pool &&
+		    g_virtual_se_dev[g_crypto_to_ivc_map[cnt].se_engine] == se_dev)
+			g_crypto_to_ivc_map[cnt].req_pool = NULL;
+	}
 
 	for (i = 0; i < ARRAY_SIZE(sha_algs); i++)
 		crypto_unregister_ahash(&sha_algs[i]);
@@ -5199,6 +5665,7 @@ static int tegra_hv_vse_safety_resume(struct device *dev)
 
 	/* Set engine to suspend state to 1 to make it as false */
 	atomic_set(&se_dev->se_suspended, 0);
+	tegra_hv_vse_safety_rng_pools_run(se_dev, true);
 
 	return 0;
 }
@@ -5225,11 +5692,22 @@ static struct platform_driver tegra_hv_vse_safety_driver = {
 
 static int __init tegra_hv_vse_safety_module_init(void)
 {
-	return platform_driver_register(&tegra_hv_vse_safety_driver);
+	int err;
+
+	err = platform_driver_register(&tegra_hv_vse_safety_driver);
+	if (err)
+		return err;
+
+	tegra_vse_debugfs = debugfs_create_dir("tegra_hv_vse_safety", NULL);
+	debugfs_create_file("req_contexts", 0444, tegra_vse_debugfs, NULL,
+			    &tegra_hv_vse_safety_req_ctx_fops);
+
+	return 0;
 }
 
 static void __exit tegra_hv_vse_safety_module_exit(void)
 {
+	debugfs_remove_recursive(tegra_vse_debugfs);
 	platform_driver_unregister(&tegra_hv_vse_safety_driver);
 }
 
@@ -14,6 +14,14 @@ struct tegra_vse_soc_info {
 	bool gcm_decrypt_supported;
 };
 
+enum se_engine_id {
+	VIRTUAL_SE_AES0,
+	VIRTUAL_SE_AES1,
+	VIRTUAL_SE_SHA = 2,
+	VIRTUAL_SE_TSEC = 6,
+	VIRTUAL_MAX_SE_ENGINE_NUM = 7
+};
+
 /* GCM Operation Supported Flag */
 enum tegra_gcm_dec_supported {
 	GCM_DEC_OP_NOT_SUPPORTED,
@@ -26,6 +34,9 @@ enum ivc_irq_state {
 	INTERMEDIATE_REQ_INTERRUPT = 2u,
 };
 
+struct tegra_vse_rng_pool;
+struct tegra_vse_req_pool;
+
 struct crypto_dev_to_ivc_map {
 	uint32_t ivc_id;
 	uint32_t se_engine;
@@ -47,6 +58,17 @@ struct crypto_dev_to_ivc_map {
 	 */
 	enum ivc_irq_state wait_interrupt;
 	struct mutex irq_state_lock;
+	/*
+	 * AES requests sent without waiting and not answered yet. Their
+	 * responses are only read by the kthread, synchronous requests wait
+	 * on async_wq until none is left.
+	 */
+	atomic_t async_inflight;
+	wait_queue_head_t async_wq;
+	/* Random numbers read ahead on RNG nodes, NULL elsewhere */
+	struct tegra_vse_rng_pool *rng_pool;
+	/* Preallocated contexts of synchronous requests */
+	struct tegra_vse_req_pool *req_pool;
 };
 
 struct tegra_virtual_se_dev {
@@ -146,6 +146,25 @@ struct tnvvse_cmac_req_data {
 	uint8_t result;
 };
 
+/* Transform of a batch, keyed with the keyslot of the last operation */
+struct tnvvse_batch_tfm {
+	struct crypto_ahash		*tfm;
+	struct ahash_request		*req;
+	uint8_t				key_slot[KEYSLOT_SIZE_BYTES];
+	uint8_t				key_length;
+	bool				keyed;
+};
+
+/* State shared by the operations of one NVVSE_IOCTL_CMDID_BATCH call */
+struct tnvvse_batch {
+	struct tnvvse_batch_tfm		cmac;
+	struct tnvvse_batch_tfm		gmac;
+	struct tnvvse_crypto_completion	complete;
+	struct scatterlist		sg;
+	uint8_t				*buf;
+	uint8_t				*result;
+};
+
 #if (KERNEL_VERSION(6, 3, 0) <= LINUX_VERSION_CODE)
 static void tnvvse_crypto_complete(void *data, int err)
 {
@@ -1777,6 +1796,231 @@ out:
 	return ret;
 }
 
+static int tnvvse_crypto_batch_setup(struct tnvvse_crypto_ctx *ctx,
+		struct tnvvse_batch *batch, struct tnvvse_batch_tfm *bt,
+		bool is_cmac, const struct tegra_nvvse_batch_op *op)
+{
+	const char *alg = is_cmac ? "cmac-vse(aes)" : "gmac-vse(aes)";
+	char key_as_keyslot[AES_KEYSLOT_NAME_SIZE] = {0,};
+	struct tegra_virtual_se_aes_cmac_context *cmac_ctx;
+	struct tegra_virtual_se_aes_gmac_context *gmac_ctx;
+	int ret;
+
+	if (!bt->tfm) {
+		bt->tfm = crypto_alloc_ahash(alg, 0, 0);
+		if (IS_ERR(bt->tfm)) {
+			ret = PTR_ERR(bt->tfm);
+			bt->tfm = NULL;
+			pr_err("%s(): Failed to allocate ahash for %s: %d\n", __func__, alg, ret);
+			return ret;
+		}
+
+		if (is_cmac) {
+			cmac_ctx = crypto_ahash_ctx(bt->tfm);
+			cmac_ctx->node_id = ctx->node_id;
+		} else {
+			gmac_ctx = crypto_ahash_ctx(bt->tfm);
+			gmac_ctx->node_id = ctx->node_id;
+		}
+
+		bt->req = ahash_request_alloc(bt->tfm, GFP_KERNEL);
+		if (!bt->req) {
+			pr_err("%s(): Failed to allocate request for %s\n", __func__, alg);
+			crypto_free_ahash(bt->tfm);
+			bt->tfm = NULL;
+			return -ENOMEM;
+		}
+
+		ahash_request_set_callback(bt->req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   tnvvse_crypto_complete, &batch->complete);
+	}
+
+	/* consecutive operations with one key do not load it again */
+	if (bt->keyed && bt->key_length == op->key_length &&
+			!memcmp(bt->key_slot, op->key_slot, KEYSLOT_SIZE_BYTES))
+		return 0;
+
+	bt->keyed = false;
+	ret = snprintf(key_as_keyslot, AES_KEYSLOT_NAME_SIZE, "NVSEAES ");
+	memcpy(key_as_keyslot + KEYSLOT_OFFSET_BYTES, op->key_slot, KEYSLOT_SIZE_BYTES);
+	ret = crypto_ahash_setkey(bt->tfm, key_as_keyslot, op->key_length);
+	if (ret) {
+		pr_err("%s(): Failed to set keys for %s: %d\n", __func__, alg, ret);
+		return ret;
+	}
+
+	memcpy(bt->key_slot, op->key_slot, KEYSLOT_SIZE_BYTES);
+	bt->key_length = op->key_length;
+	bt->keyed = true;
+
+	return 0;
+}
+
+static int tnvvse_crypto_batch_op(struct tnvvse_crypto_ctx *ctx,
+		struct tnvvse_batch *batch, struct tegra_nvvse_batch_op *op)
+{
+	bool is_cmac = (op->op == TEGRA_NVVSE_BATCH_OP_CMAC_SIGN ||
+			op->op == TEGRA_NVVSE_BATCH_OP_CMAC_VERIFY);
+	bool verify = (op->op == TEGRA_NVVSE_BATCH_OP_CMAC_VERIFY ||
+			op->op == TEGRA_NVVSE_BATCH_OP_GMAC_VERIFY);
+	struct tnvvse_batch_tfm *bt = is_cmac ? &batch->cmac : &batch->gmac;
+	struct tnvvse_cmac_req_data cmac_data;
+	struct tnvvse_gmac_req_data gmac_data;
+	uint8_t iv[TEGRA_NVVSE_AES_GCM_IV_LEN];
+	int ret;
+
+	if (op->op > TEGRA_NVVSE_BATCH_OP_GMAC_VERIFY) {
+		pr_err("%s(): invalid batch op %u\n", __func__, op->op);
+		return -EINVAL;
+	}
+
+	if (op->data_length == 0 || op->data_length > TEGRA_NVVSE_BATCH_MAX_DATA_LEN) {
+		pr_err("%s(): Input size is (data = %d) is not supported\n",
+					__func__, op->data_length);
+		return -EINVAL;
+	}
+
+	ret = tnvvse_crypto_batch_setup(ctx, batch, bt, is_cmac, op);
+	if (ret)
+		return ret;
+
+	if (copy_from_user(batch->buf, (void __user *)op->src_buffer, op->data_length))
+		return -EFAULT;
+
+	memset(batch->result, 0, TEGRA_NVVSE_AES_CMAC_LEN);
+	if (verify && copy_from_user(batch->result, (void __user *)op->tag_buffer,
+				TEGRA_NVVSE_AES_CMAC_LEN))
+		return -EFAULT;
+
+	if (is_cmac) {
+		cmac_data.request_type = verify ? CMAC_VERIFY : CMAC_SIGN;
+		cmac_data.result = 0;
+		bt->req->priv = &cmac_data;
+	} else {
+		gmac_data.request_type = verify ? GMAC_VERIFY : GMAC_SIGN;
+		gmac_data.iv = NULL;
+		gmac_data.is_first = 1;
+		gmac_data.result = 0;
+		bt->req->priv = &gmac_data;
+	}
+
+	ret = wait_async_op(&batch->complete, crypto_ahash_init(bt->req));
+	if (ret) {
+		pr_err("%s(): Failed to initialize ahash: %d\n", __func__, ret);
+		return ret;
+	}
+
+	if (!is_cmac && verify) {
+		memcpy(iv, op->initial_vector, TEGRA_NVVSE_AES_GCM_IV_LEN);
+		gmac_data.iv = iv;
+	}
+
+	sg_init_one(&batch->sg, batch->buf, op->data_length);
+	ahash_request_set_crypt(bt->req, &batch->sg, batch->result, op->data_length);
+
+	ret = wait_async_op(&batch->complete, crypto_ahash_finup(bt->req));
+	if (ret) {
+		pr_err("%s(): Failed to ahash_finup: %d\n", __func__, ret);
+		return ret;
+	}
+
+	if (verify) {
+		op->result = is_cmac ? cmac_data.result : gmac_data.result;
+	} else if (copy_to_user((void __user *)op->tag_buffer, batch->result,
+				TEGRA_NVVSE_AES_CMAC_LEN)) {
+		pr_err("%s(): Failed to copy_to_user\n", __func__);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static void tnvvse_crypto_batch_free_tfm(struct tnvvse_batch_tfm *bt)
+{
+	if (bt->req)
+		ahash_request_free(bt->req);
+	if (bt->tfm)
+		crypto_free_ahash(bt->tfm);
+}
+
+/*
+ * Run many small single part CMAC/GMAC operations with one call. The
+ * descriptors are copied in and out once, and the transforms, requests and
+ * buffers are shared by all operations of the batch.
+ */
+static int tnvvse_crypto_batch(struct tnvvse_crypto_ctx *ctx,
+		struct tegra_nvvse_batch_ctl __user *arg)
+{
+	struct tegra_nvvse_batch_ctl batch_ctl;
+	struct tegra_nvvse_batch_op *ops;
+	struct tnvvse_batch *batch;
+	uint32_t i;
+	int ret;
+
+	if (copy_from_user(&batch_ctl, arg, sizeof(batch_ctl))) {
+		pr_err("%s(): Failed to copy_from_user batch_ctl\n", __func__);
+		return -EFAULT;
+	}
+
+	if (batch_ctl.num_ops == 0 || batch_ctl.num_ops > TEGRA_NVVSE_BATCH_MAX_OPS) {
+		pr_err("%s(): invalid number of operations %u\n", __func__, batch_ctl.num_ops);
+		return -EINVAL;
+	}
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+	ops = kcalloc(batch_ctl.num_ops, sizeof(*ops), GFP_KERNEL);
+	if (!batch || !ops) {
+		ret = -ENOMEM;
+		goto free;
+	}
+
+	batch->buf = kmalloc(TEGRA_NVVSE_BATCH_MAX_DATA_LEN, GFP_KERNEL);
+	batch->result = kzalloc(64, GFP_KERNEL);
+	if (!batch->buf || !batch->result) {
+		ret = -ENOMEM;
+		goto free;
+	}
+
+	if (copy_from_user(ops, (void __user *)batch_ctl.ops,
+				batch_ctl.num_ops * sizeof(*ops))) {
+		pr_err("%s(): Failed to copy_from_user batch ops\n", __func__);
+		ret = -EFAULT;
+		goto free;
+	}
+
+	init_completion(&batch->complete.restart);
+	batch_ctl.num_done = 0;
+
+	for (i = 0; i < batch_ctl.num_ops; i++) {
+		batch->complete.req_err = 0;
+		ops[i].result = 0;
+		ops[i].status = tnvvse_crypto_batch_op(ctx, batch, &ops[i]);
+		if (ops[i].status == 0)
+			batch_ctl.num_done++;
+	}
+
+	ret = 0;
+	if (copy_to_user((void __user *)batch_ctl.ops, ops,
+				batch_ctl.num_ops * sizeof(*ops)) ||
+			copy_to_user(&arg->num_done, &batch_ctl.num_done,
+				sizeof(batch_ctl.num_done))) {
+		pr_err("%s(): Failed to copy_to_user batch results\n", __func__);
+		ret = -EFAULT;
+	}
+
+free:
+	if (batch) {
+		tnvvse_crypto_batch_free_tfm(&batch->cmac);
+		tnvvse_crypto_batch_free_tfm(&batch->gmac);
+		kfree(batch->result);
+		kfree(batch->buf);
+	}
+	kfree(batch);
+	kfree(ops);
+
+	return ret;
+}
+
 static int tnvvse_crypto_get_ivc_db(struct tegra_nvvse_get_ivc_db *get_ivc_db)
 {
 	struct crypto_dev_to_ivc_map *hv_vse_db;
@@ -2193,6 +2437,10 @@ static long tnvvse_crypto_dev_ioctl(struct file *filp,
 		kfree(tsec_keyload_status);
 		break;
 
+	case NVVSE_IOCTL_CMDID_BATCH:
+		ret = tnvvse_crypto_batch(ctx, (void __user *)arg);
+		break;
+
 	default:
 		pr_err("%s(): invalid ioctl code(%d[0x%08x])", __func__, ioctl_num, ioctl_num);
 		ret = -EINVAL;
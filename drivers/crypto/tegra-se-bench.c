@@ -0,0 +1,791 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * tegra-se-bench - throughput and latency of the Tegra SE crypto algorithms
+ *
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Runs AES-CBC, AES-CTR, AES-GCM, SHA-256/384/512, CMAC and GMAC through the
+ * crypto API, on the native SE driver (tegra-se, host1x) or on nodes of the
+ * virtual one (tegra-hv-vse-safety, IVC), for each request size and queue
+ * depth. The native engine is keyed with a random key, the virtual one with
+ * the id of a keyslot the SE server has loaded. Virtual nodes only run the
+ * algorithms of their engine.
+ *
+ *   modprobe tegra-se-bench engine=vse nodes=0,2,4 keyslot=1
+ *   echo 1 > /sys/kernel/debug/tegra-se-bench/run
+ *   cat /sys/kernel/debug/tegra-se-bench/results
+ */
+
+#include <linux/completion.h>
+#include <linux/debugfs.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/random.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/version.h>
+#include <linux/wait.h>
+#include <crypto/aead.h>
+#include <crypto/algapi.h>
+#include <crypto/hash.h>
+#include <crypto/sha2.h>
+#include <crypto/skcipher.h>
+#include <uapi/misc/tegra-nvvse-cryptodev.h>
+
+#include "tegra-hv-vse.h"
+
+#define TSB_MAX_NODES		16
+#define TSB_MAX_POINTS		16
+#define TSB_MAX_DEPTH		64U
+#define TSB_MAX_SIZE		SZ_4M
+#define TSB_KEY_SIZE		16U
+#define TSB_IV_SIZE		16U
+#define TSB_TAG_SIZE		16U
+#define TSB_KEYSLOT_NAME_SIZE	32U
+
+static char *engine = "se";
+module_param(engine, charp, 0644);
+MODULE_PARM_DESC(engine, "Engine to run on: se (native) or vse (virtual)");
+
+static unsigned int nodes[TSB_MAX_NODES];
+static int nr_nodes;
+module_param_array(nodes, uint, &nr_nodes, 0644);
+MODULE_PARM_DESC(nodes, "Virtual engine nodes to run on");
+
+static unsigned int keyslot;
+module_param(keyslot, uint, 0644);
+MODULE_PARM_DESC(keyslot, "Keyslot id of the virtual engine AES key");
+
+static unsigned int sizes[TSB_MAX_POINTS] = {
+	16, 256, SZ_4K, SZ_64K, SZ_1M,
+};
+static int nr_sizes = 5;
+module_param_array(sizes, uint, &nr_sizes, 0644);
+MODULE_PARM_DESC(sizes, "Request sizes in bytes");
+
+static unsigned int depths[TSB_MAX_POINTS] = { 1, 4, 16 };
+static int nr_depths = 3;
+module_param_array(depths, uint, &nr_depths, 0644);
+MODULE_PARM_DESC(depths, "Requests kept in flight, at most 64");
+
+static unsigned int iters = 256;
+module_param(iters, uint, 0644);
+MODULE_PARM_DESC(iters, "Requests of each size and depth");
+
+enum tsb_type {
+	TSB_SKCIPHER,
+	TSB_AEAD,
+	TSB_AHASH,
+};
+
+/* transform context of the virtual engine, which carries the node id */
+enum tsb_vse_ctx {
+	TSB_VSE_AES,
+	TSB_VSE_SHA,
+	TSB_VSE_CMAC,
+	TSB_VSE_GMAC,
+};
+
+struct tsb_alg {
+	const char *name;
+	enum tsb_type type;
+	/* driver of the native engine, NULL if it has none */
+	const char *se;
+	/* algorithm of the virtual engine and the engine serving it */
+	const char *vse;
+	enum se_engine_id vse_engine;
+	enum tsb_vse_ctx vse_ctx;
+	bool keyed;
+};
+
+static const struct tsb_alg tsb_algs[] = {
+	{ "cbc(aes)", TSB_SKCIPHER, "cbc-aes-tegra", "cbc-vse(aes)",
+	  VIRTUAL_SE_AES1, TSB_VSE_AES, true },
+	{ "ctr(aes)", TSB_SKCIPHER, "ctr-aes-tegra", "ctr-vse(aes)",
+	  VIRTUAL_SE_AES1, TSB_VSE_AES, true },
+	{ "gcm(aes)", TSB_AEAD, "gcm-aes-tegra", "gcm-vse(aes)",
+	  VIRTUAL_SE_AES1, TSB_VSE_AES, true },
+	{ "sha256", TSB_AHASH, "tegra-se-sha256", "sha256-vse",
+	  VIRTUAL_SE_SHA, TSB_VSE_SHA, false },
+	{ "sha384", TSB_AHASH, "tegra-se-sha384", "sha384-vse",
+	  VIRTUAL_SE_SHA, TSB_VSE_SHA, false },
+	{ "sha512", TSB_AHASH, "tegra-se-sha512", "sha512-vse",
+	  VIRTUAL_SE_SHA, TSB_VSE_SHA, false },
+	{ "cmac(aes)", TSB_AHASH, "tegra-se-cmac", "cmac-vse(aes)",
+	  VIRTUAL_SE_AES0, TSB_VSE_CMAC, true },
+	{ "gmac(aes)", TSB_AHASH, NULL, "gmac-vse(aes)",
+	  VIRTUAL_SE_AES0, TSB_VSE_GMAC, true },
+};
+
+/* request data of the virtual CMAC and GMAC, as tegra-hv-vse-safety reads it */
+enum tsb_cmac_request_type {
+	TSB_CMAC_SIGN = 0U,
+};
+
+struct tsb_cmac_req_data {
+	enum tsb_cmac_request_type request_type;
+	uint8_t result;
+};
+
+enum tsb_gmac_request_type {
+	TSB_GMAC_INIT = 0U,
+	TSB_GMAC_SIGN,
+};
+
+struct tsb_gmac_req_data {
+	enum tsb_gmac_request_type request_type;
+	char *iv;
+	uint8_t is_first;
+	uint8_t result;
+};
+
+struct tsb_tfm;
+
+/* one request in flight */
+struct tsb_slot {
+	struct tsb_tfm *t;
+	union {
+		struct skcipher_request *sk;
+		struct aead_request *aead;
+		struct ahash_request *hash;
+	};
+	struct scatterlist src;
+	struct scatterlist dst;
+	void *dst_buf;
+	u8 iv[TSB_IV_SIZE];
+	u8 digest[SHA512_DIGEST_SIZE];
+	union {
+		struct tsb_cmac_req_data cmac;
+		struct tsb_gmac_req_data gmac;
+	} vse;
+	struct completion done;
+	ktime_t start;
+	u64 ns;
+	int err;
+	bool busy;
+};
+
+struct tsb_tfm {
+	const struct tsb_alg *alg;
+	bool vse;
+	union {
+		struct crypto_skcipher *sk;
+		struct crypto_aead *aead;
+		struct crypto_ahash *hash;
+	};
+	struct crypto_tfm *base;
+	void *src_buf;
+	size_t buf_size;
+	unsigned int nslots;
+	struct tsb_slot slots[TSB_MAX_DEPTH];
+};
+
+struct tsb_result {
+	const struct tsb_alg *alg;
+	char driver[CRYPTO_MAX_ALG_NAME];
+	/* virtual engine node, -1 on the native engine */
+	int node;
+	unsigned int size;
+	unsigned int depth;
+	int status;
+	u64 ops;
+	u64 ns;
+	u64 p50_ns;
+	u64 p99_ns;
+};
+
+static struct {
+	struct mutex lock;
+	struct dentry *debugfs;
+	int status;
+	bool vse;
+	unsigned int iters;
+	struct tsb_result *results;
+	unsigned int nresults;
+} tsb;
+
+static void tsb_slot_done(struct tsb_slot *slot, int err)
+{
+	slot->ns = ktime_to_ns(ktime_sub(ktime_get(), slot->start));
+	slot->err = err;
+	complete(&slot->done);
+}
+
+#if (KERNEL_VERSION(6, 3, 0) <= LINUX_VERSION_CODE)
+static void tsb_complete(void *data, int err)
+{
+	struct tsb_slot *slot = data;
+#else
+static void tsb_complete(struct crypto_async_request *req, int err)
+{
+	struct tsb_slot *slot = req->data;
+#endif
+
+	/* a backlogged request was queued, the result comes later */
+	if (err == -EINPROGRESS)
+		return;
+
+	tsb_slot_done(slot, err);
+}
+
+static int tsb_start(struct tsb_slot *slot, unsigned int size)
+{
+	struct tsb_tfm *t = slot->t;
+	int ret;
+
+	sg_init_one(&slot->src, t->src_buf, size);
+
+	switch (t->alg->type) {
+	case TSB_SKCIPHER:
+		sg_init_one(&slot->dst, slot->dst_buf, size);
+		skcipher_request_set_crypt(slot->sk, &slot->src, &slot->dst,
+					   size, slot->iv);
+		return crypto_skcipher_encrypt(slot->sk);
+	case TSB_AEAD:
+		sg_init_one(&slot->dst, slot->dst_buf, size + TSB_TAG_SIZE);
+		aead_request_set_ad(slot->aead, 0);
+		aead_request_set_crypt(slot->aead, &slot->src, &slot->dst,
+				       size, slot->iv);
+		return crypto_aead_encrypt(slot->aead);
+	default:
+		ahash_request_set_crypt(slot->hash, &slot->src, slot->digest,
+					size);
+		if (!t->vse || t->alg->vse_ctx != TSB_VSE_GMAC)
+			return crypto_ahash_digest(slot->hash);
+
+		/* the virtual GMAC has no digest, sign in one finup */
+		slot->vse.gmac.request_type = TSB_GMAC_SIGN;
+		slot->vse.gmac.iv = NULL;
+		slot->vse.gmac.is_first = 1;
+		ret = crypto_ahash_init(slot->hash);
+		if (ret == -EINPROGRESS || ret == -EBUSY) {
+			wait_for_completion(&slot->done);
+			reinit_completion(&slot->done);
+			ret = slot->err;
+		}
+
+		return ret ?: crypto_ahash_finup(slot->hash);
+	}
+}
+
+static void tsb_submit(struct tsb_slot *slot, unsigned int size)
+{
+	int ret;
+
+	reinit_completion(&slot->done);
+	slot->busy = true;
+	slot->start = ktime_get();
+
+	ret = tsb_start(slot, size);
+	if (ret != -EINPROGRESS && ret != -EBUSY)
+		tsb_slot_done(slot, ret);
+}
+
+static int tsb_wait(struct tsb_slot *slot)
+{
+	wait_for_completion(&slot->done);
+	slot->busy = false;
+
+	return slot->err;
+}
+
+static int tsb_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int tsb_run_point(struct tsb_tfm *t, struct tsb_result *res, u64 *lat)
+{
+	unsigned int n = min(res->depth, tsb.iters);
+	unsigned int submitted, done = 0, i;
+	ktime_t start;
+	int ret = 0;
+
+	start = ktime_get();
+
+	for (submitted = 0; submitted < n; submitted++)
+		tsb_submit(&t->slots[submitted], res->size);
+
+	/* slots are refilled in submission order, the next one is the oldest */
+	for (i = 0; done < tsb.iters; i = (i + 1) % n) {
+		struct tsb_slot *slot = &t->slots[i];
+
+		ret = tsb_wait(slot);
+		if (ret)
+			break;
+
+		lat[done++] = slot->ns;
+		if (submitted < tsb.iters) {
+			tsb_submit(slot, res->size);
+			submitted++;
+		}
+	}
+
+	res->ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	for (i = 0; i < n; i++) {
+		if (t->slots[i].busy)
+			tsb_wait(&t->slots[i]);
+	}
+
+	if (ret)
+		return ret;
+
+	sort(lat, done, sizeof(*lat), tsb_cmp_u64, NULL);
+	res->ops = done;
+	res->p50_ns = lat[done / 2];
+	res->p99_ns = lat[min_t(u64, done - 1, div_u64((u64)done * 99, 100))];
+
+	return 0;
+}
+
+static void tsb_vse_set_node(struct tsb_tfm *t, u32 node)
+{
+	void *ctx = crypto_tfm_ctx(t->base);
+
+	switch (t->alg->vse_ctx) {
+	case TSB_VSE_AES: {
+		struct tegra_virtual_se_aes_context *aes_ctx = ctx;
+
+		aes_ctx->node_id = node;
+		aes_ctx->user_nonce = 0;
+		aes_ctx->b_is_first = 1;
+		break;
+	}
+	case TSB_VSE_SHA:
+		((struct tegra_virtual_se_sha_context *)ctx)->node_id = node;
+		break;
+	case TSB_VSE_CMAC:
+		((struct tegra_virtual_se_aes_cmac_context *)ctx)->node_id = node;
+		break;
+	case TSB_VSE_GMAC:
+		((struct tegra_virtual_se_aes_gmac_context *)ctx)->node_id = node;
+		break;
+	}
+}
+
+static int tsb_setkey(struct tsb_tfm *t)
+{
+	u8 key[TSB_KEYSLOT_NAME_SIZE] = { 0 };
+	int ret;
+
+	if (!t->alg->keyed)
+		return 0;
+
+	if (t->vse) {
+		/* the virtual engine is keyed with a keyslot of the SE server */
+		memcpy(key, "NVSEAES ", KEYSLOT_OFFSET_BYTES);
+		memcpy(key + KEYSLOT_OFFSET_BYTES, &keyslot, sizeof(keyslot));
+	} else {
+		get_random_bytes(key, TSB_KEY_SIZE);
+	}
+
+	switch (t->alg->type) {
+	case TSB_SKCIPHER:
+		ret = crypto_skcipher_setkey(t->sk, key, TSB_KEY_SIZE);
+		break;
+	case TSB_AEAD:
+		ret = crypto_aead_setkey(t->aead, key, TSB_KEY_SIZE) ?:
+		      crypto_aead_setauthsize(t->aead, TSB_TAG_SIZE);
+		break;
+	default:
+		ret = crypto_ahash_setkey(t->hash, key, TSB_KEY_SIZE);
+		break;
+	}
+
+	memzero_explicit(key, sizeof(key));
+
+	return ret;
+}
+
+static int tsb_alloc_tfm(struct tsb_tfm *t, const char *name)
+{
+	switch (t->alg->type) {
+	case TSB_SKCIPHER:
+		t->sk = crypto_alloc_skcipher(name, 0, 0);
+		if (IS_ERR(t->sk))
+			return PTR_ERR(t->sk);
+		t->base = crypto_skcipher_tfm(t->sk);
+		break;
+	case TSB_AEAD:
+		t->aead = crypto_alloc_aead(name, 0, 0);
+		if (IS_ERR(t->aead))
+			return PTR_ERR(t->aead);
+		t->base = crypto_aead_tfm(t->aead);
+		break;
+	default:
+		t->hash = crypto_alloc_ahash(name, 0, 0);
+		if (IS_ERR(t->hash))
+			return PTR_ERR(t->hash);
+		t->base = crypto_ahash_tfm(t->hash);
+		break;
+	}
+
+	return 0;
+}
+
+static int tsb_alloc_req(struct tsb_tfm *t, struct tsb_slot *slot)
+{
+	switch (t->alg->type) {
+	case TSB_SKCIPHER:
+		slot->sk = skcipher_request_alloc(t->sk, GFP_KERNEL);
+		if (!slot->sk)
+			return -ENOMEM;
+		skcipher_request_set_callback(slot->sk, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					      tsb_complete, slot);
+		break;
+	case TSB_AEAD:
+		slot->aead = aead_request_alloc(t->aead, GFP_KERNEL);
+		if (!slot->aead)
+			return -ENOMEM;
+		aead_request_set_callback(slot->aead, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					  tsb_complete, slot);
+		break;
+	default:
+		slot->hash = ahash_request_alloc(t->hash, GFP_KERNEL);
+		if (!slot->hash)
+			return -ENOMEM;
+		ahash_request_set_callback(slot->hash, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   tsb_complete, slot);
+		if (t->vse) {
+			slot->vse.cmac.request_type = TSB_CMAC_SIGN;
+			slot->hash->priv = &slot->vse;
+		}
+		return 0;
+	}
+
+	slot->dst_buf = alloc_pages_exact(t->buf_size, GFP_KERNEL);
+	if (!slot->dst_buf)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void tsb_free(struct tsb_tfm *t)
+{
+	unsigned int i;
+
+	for (i = 0; i < t->nslots; i++) {
+		struct tsb_slot *slot = &t->slots[i];
+
+		if (slot->dst_buf)
+			free_pages_exact(slot->dst_buf, t->buf_size);
+
+		switch (t->alg->type) {
+		case TSB_SKCIPHER:
+			skcipher_request_free(slot->sk);
+			break;
+		case TSB_AEAD:
+			aead_request_free(slot->aead);
+			break;
+		default:
+			ahash_request_free(slot->hash);
+			break;
+		}
+	}
+
+	if (t->src_buf)
+		free_pages_exact(t->src_buf, t->buf_size);
+
+	if (t->base) {
+		switch (t->alg->type) {
+		case TSB_SKCIPHER:
+			crypto_free_skcipher(t->sk);
+			break;
+		case TSB_AEAD:
+			crypto_free_aead(t->aead);
+			break;
+		default:
+			crypto_free_ahash(t->hash);
+			break;
+		}
+	}
+
+	kfree(t);
+}
+
+static struct tsb_tfm *tsb_alloc(const struct tsb_alg *alg, int node,
+				 unsigned int nslots, size_t max_size)
+{
+	struct tsb_tfm *t;
+	unsigned int i;
+	int ret;
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return ERR_PTR(-ENOMEM);
+
+	t->alg = alg;
+	t->vse = node >= 0;
+	t->buf_size = max_size + TSB_TAG_SIZE;
+
+	ret = tsb_alloc_tfm(t, t->vse ? alg->vse : alg->se);
+	if (ret)
+		goto err;
+
+	if (t->vse)
+		tsb_vse_set_node(t, node);
+
+	ret = tsb_setkey(t);
+	if (ret)
+		goto err;
+
+	t->src_buf = alloc_pages_exact(t->buf_size, GFP_KERNEL | __GFP_ZERO);
+	if (!t->src_buf) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	for (i = 0; i < nslots; i++) {
+		struct tsb_slot *slot = &t->slots[i];
+
+		slot->t = t;
+		init_completion(&slot->done);
+		get_random_bytes(slot->iv, sizeof(slot->iv));
+		t->nslots++;
+
+		ret = tsb_alloc_req(t, slot);
+		if (ret)
+			goto err;
+	}
+
+	return t;
+
+err:
+	tsb_free(t);
+	return ERR_PTR(ret);
+}
+
+static unsigned int tsb_max(const unsigned int *v, int n)
+{
+	unsigned int m = 0;
+	int i;
+
+	for (i = 0; i < n; i++)
+		m = max(m, v[i]);
+
+	return m;
+}
+
+static int tsb_run_alg(const struct tsb_alg *alg, int node,
+		       struct tsb_result *res, u64 *lat)
+{
+	unsigned int max_size = tsb_max(sizes, nr_sizes);
+	unsigned int max_depth = tsb_max(depths, nr_depths);
+	struct tsb_tfm *t;
+	int s, d, n = 0;
+
+	t = tsb_alloc(alg, node, min(max_depth, tsb.iters), max_size);
+
+	for (s = 0; s < nr_sizes; s++) {
+		for (d = 0; d < nr_depths; d++, n++) {
+			res[n].alg = alg;
+			res[n].node = node;
+			res[n].size = sizes[s];
+			res[n].depth = depths[d];
+
+			if (IS_ERR(t)) {
+				res[n].status = PTR_ERR(t);
+				continue;
+			}
+
+			strscpy(res[n].driver, crypto_tfm_alg_driver_name(t->base),
+				sizeof(res[n].driver));
+			res[n].status = tsb_run_point(t, &res[n], lat);
+		}
+	}
+
+	if (!IS_ERR(t))
+		tsb_free(t);
+
+	return n;
+}
+
+static int tsb_run(void)
+{
+	struct crypto_dev_to_ivc_map *db = NULL;
+	unsigned int nnodes, points, i, a;
+	u64 *lat;
+	int ret = 0, s;
+
+	kfree(tsb.results);
+	tsb.results = NULL;
+	tsb.nresults = 0;
+
+	if (sysfs_streq(engine, "vse"))
+		tsb.vse = true;
+	else if (sysfs_streq(engine, "se"))
+		tsb.vse = false;
+	else
+		return -EINVAL;
+
+	tsb.iters = iters;
+	nnodes = tsb.vse ? nr_nodes : 1;
+	if (tsb.iters == 0 || nnodes == 0 || nr_sizes == 0 || nr_depths == 0)
+		return -EINVAL;
+
+	for (s = 0; s < nr_sizes; s++) {
+		if (sizes[s] == 0 || sizes[s] > TSB_MAX_SIZE)
+			return -EINVAL;
+	}
+
+	for (s = 0; s < nr_depths; s++) {
+		if (depths[s] == 0 || depths[s] > TSB_MAX_DEPTH)
+			return -EINVAL;
+	}
+
+	for (i = 0; tsb.vse && i < nnodes; i++) {
+		if (nodes[i] >= MAX_NUMBER_MISC_DEVICES)
+			return -EINVAL;
+	}
+
+	if (tsb.vse) {
+		/* only look up the virtual engine when it is asked for */
+		struct crypto_dev_to_ivc_map *(*get_db)(void) =
+			symbol_get(tegra_hv_vse_get_db);
+
+		if (!get_db)
+			return -ENODEV;
+
+		db = get_db();
+	}
+
+	points = nnodes * ARRAY_SIZE(tsb_algs) * nr_sizes * nr_depths;
+	tsb.results = kcalloc(points, sizeof(*tsb.results), GFP_KERNEL);
+	lat = kvmalloc_array(tsb.iters, sizeof(*lat), GFP_KERNEL);
+	if (!tsb.results || !lat) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < nnodes; i++) {
+		for (a = 0; a < ARRAY_SIZE(tsb_algs); a++) {
+			const struct tsb_alg *alg = &tsb_algs[a];
+			int node = -1;
+
+			if (tsb.vse) {
+				node = nodes[i];
+				if (!db[node].ivck || db[node].se_engine != alg->vse_engine)
+					continue;
+			} else if (!alg->se) {
+				continue;
+			}
+
+			tsb.nresults += tsb_run_alg(alg, node,
+						    &tsb.results[tsb.nresults], lat);
+		}
+	}
+
+out:
+	kvfree(lat);
+	if (db)
+		symbol_put(tegra_hv_vse_get_db);
+
+	return ret;
+}
+
+static ssize_t tsb_run_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	bool run;
+	int err;
+
+	err = kstrtobool_from_user(buf, count, &run);
+	if (err)
+		return err;
+
+	if (!run)
+		return count;
+
+	mutex_lock(&tsb.lock);
+	err = tsb_run();
+	tsb.status = err;
+	mutex_unlock(&tsb.lock);
+
+	return err ? err : count;
+}
+
+static const struct file_operations tsb_run_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = tsb_run_write,
+	.llseek = noop_llseek,
+};
+
+static int tsb_results_show(struct seq_file *s, void *unused)
+{
+	unsigned int i;
+
+	mutex_lock(&tsb.lock);
+
+	if (!tsb.results) {
+		seq_printf(s, "no results, status: %d\n", tsb.status);
+		goto out;
+	}
+
+	seq_puts(s, "node alg       driver                           size depth     ops/s      MB/s   p50_ns   p99_ns\n");
+
+	for (i = 0; i < tsb.nresults; i++) {
+		const struct tsb_result *res = &tsb.results[i];
+
+		if (res->node < 0)
+			seq_puts(s, "se   ");
+		else
+			seq_printf(s, "%-4d ", res->node);
+
+		seq_printf(s, "%-9s %-30s %7u %5u", res->alg->name,
+			   res->driver[0] ? res->driver :
+			   (tsb.vse ? res->alg->vse : res->alg->se),
+			   res->size, res->depth);
+
+		if (res->status) {
+			seq_printf(s, " error %d\n", res->status);
+			continue;
+		}
+
+		seq_printf(s, " %9llu %9llu %8llu %8llu\n",
+			   res->ns ? div64_u64(res->ops * NSEC_PER_SEC, res->ns) : 0,
+			   res->ns ? div64_u64(res->ops * res->size * 1000, res->ns) : 0,
+			   res->p50_ns, res->p99_ns);
+	}
+
+out:
+	mutex_unlock(&tsb.lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tsb_results);
+
+static int __init tsb_init(void)
+{
+	mutex_init(&tsb.lock);
+
+	tsb.debugfs = debugfs_create_dir("tegra-se-bench", NULL);
+	debugfs_create_file("run", 0200, tsb.debugfs, NULL, &tsb_run_fops);
+	debugfs_create_file("results", 0444, tsb.debugfs, NULL,
+			    &tsb_results_fops);
+
+	return 0;
+}
+
+static void __exit tsb_exit(void)
+{
+	debugfs_remove_recursive(tsb.debugfs);
+	kfree(tsb.results);
+	mutex_destroy(&tsb.lock);
+}
+
+module_init(tsb_init);
+module_exit(tsb_exit);
+
+MODULE_DESCRIPTION("Tegra SE and virtual SE crypto benchmark");
+MODULE_LICENSE("GPL v2");
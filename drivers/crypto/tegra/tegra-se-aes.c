@@ -24,6 +24,11 @@
 
 #include "tegra-se.h"
 
+static unsigned int aes_batch = 16;
+module_param(aes_batch, uint, 0644);
+MODULE_PARM_DESC(aes_batch,
+	"AES requests submitted in one host1x command buffer, 0 or 1 disables batching");
+
 struct tegra_aes_ctx {
 #ifndef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
 	struct crypto_engine_ctx enginectx;
@@ -31,8 +36,8 @@ struct tegra_aes_ctx {
 	struct tegra_se *se;
 	u32 alg;
 	u32 ivsize;
-	u32 key1_id;
-	u32 key2_id;
+	struct tegra_se_key key1;
+	struct tegra_se_key key2;
 };
 
 struct tegra_aes_reqctx {
@@ -40,6 +45,8 @@ struct tegra_aes_reqctx {
 	bool encrypt;
 	u32 config;
 	u32 crypto_config;
+	u32 key1_id;
+	u32 key2_id;
 	u32 len;
 	u32 *iv;
 };
@@ -53,6 +60,7 @@ struct tegra_aead_ctx {
 	u32 alg;
 	u32 keylen;
 	u32 key_id;
+	struct tegra_se_key key;
 };
 
 struct tegra_aead_reqctx {
@@ -78,6 +86,7 @@ struct tegra_cmac_ctx {
 	struct tegra_se *se;
 	unsigned int alg;
 	u32 key_id;
+	struct tegra_se_key key;
 	struct crypto_shash *fallback_tfm;
 };
 
@@ -210,10 +219,11 @@ static int tegra234_aes_cfg(u32 alg, bool encrypt)
 	return -EINVAL;
 }
 
-static unsigned int tegra_aes_prep_cmd(struct tegra_se *se, struct tegra_aes_reqctx *rctx)
+/* at most SE_AES_BATCH_CMD_WORDS, the syncpt increment is added by the batch */
+static unsigned int tegra_aes_prep_cmd(struct tegra_se *se, struct tegra_aes_reqctx *rctx,
+				       u32 *cpuvaddr)
 {
 	unsigned int data_count, res_bits, i = 0, j;
-	u32 *cpuvaddr = se->cmdbuf->addr;
 	dma_addr_t addr = rctx->datbuf.addr;
 
 	data_count = rctx->len / AES_BLOCK_SIZE;
@@ -254,13 +264,61 @@ static unsigned int tegra_aes_prep_cmd(struct tegra_se *se, struct tegra_aes_req
 	cpuvaddr[i++] = SE_AES_OP_WRSTALL | SE_AES_OP_LASTBUF |
 			SE_AES_OP_START;
 
+	dev_dbg(se->dev, "cfg %#x crypto cfg %#x\n", rctx->config, rctx->crypto_config);
+
+	return i;
+}
+
+static void tegra_aes_finish_req(struct skcipher_request *req, int ret)
+{
+	struct tegra_aes_ctx *ctx = crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+	struct tegra_aes_reqctx *rctx = skcipher_request_ctx(req);
+	struct tegra_se *se = ctx->se;
+
+	/* Copy the result */
+	tegra_aes_update_iv(req, ctx);
+	scatterwalk_map_and_copy(rctx->datbuf.buf, req->dst, 0, req->cryptlen, 1);
+
+	/* Free the buffer */
+	dma_free_coherent(se->dev, rctx->datbuf.size,
+			  rctx->datbuf.buf, rctx->datbuf.addr);
+
+	tegra_key_put(rctx->key1_id);
+	tegra_key_put(rctx->key2_id);
+
+	crypto_finalize_skcipher_request(se->engine, req, ret);
+}
+
+static void tegra_aes_batch_flush(struct tegra_se *se)
+{
+	struct tegra_se_batch *batch = &se->batch;
+	u32 *cpuvaddr = batch->cmdbuf->addr;
+	unsigned int i = batch->words, n;
+	int ret;
+
+	/* WRSTALL orders the operations, one increment after the last one */
 	cpuvaddr[i++] = se_host1x_opcode_nonincr(host1x_uclass_incr_syncpt_r(), 1);
 	cpuvaddr[i++] = host1x_uclass_incr_syncpt_cond_f(1) |
 			host1x_uclass_incr_syncpt_indx_f(se->syncpt_id);
 
-	dev_dbg(se->dev, "cfg %#x crypto cfg %#x\n", rctx->config, rctx->crypto_config);
+	ret = tegra_se_host1x_submit_cmdbuf(se, batch->cmdbuf, i);
 
-	return i;
+	for (n = 0; n < batch->nreqs; n++)
+		tegra_aes_finish_req(batch->reqs[n], ret);
+
+	batch->nreqs = 0;
+	batch->words = 0;
+}
+
+/* Called by the crypto engine whenever its queue runs empty */
+int tegra_aes_do_batch(struct crypto_engine *engine)
+{
+	struct tegra_se *se = dev_get_drvdata(engine->dev);
+
+	if (se->batch.nreqs)
+		tegra_aes_batch_flush(se);
+
+	return 0;
 }
 
 static int tegra_aes_do_one_req(struct crypto_engine *engine, void *areq)
@@ -269,15 +327,34 @@ static int tegra_aes_do_one_req(struct crypto_engine *engine, void *areq)
 	struct tegra_aes_ctx *ctx = crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
 	struct tegra_aes_reqctx *rctx = skcipher_request_ctx(req);
 	struct tegra_se *se = ctx->se;
-	unsigned int cmdlen;
+	struct tegra_se_batch *batch = &se->batch;
 	int ret;
 
+	BUILD_BUG_ON(SE_AES_BATCH_MAX * SE_AES_BATCH_CMD_WORDS + 2 > SZ_4K / 4);
+
+	rctx->key2_id = 0;
+	ret = tegra_key_get(se, &ctx->key1, &rctx->key1_id);
+	if (ret)
+		return ret;
+
+	if (ctx->key2.keylen) {
+		ret = tegra_key_get(se, &ctx->key2, &rctx->key2_id);
+		if (ret)
+			goto key_put;
+	}
+
+	rctx->crypto_config |= SE_AES_KEY_INDEX(rctx->key1_id);
+	if (rctx->key2_id)
+		rctx->crypto_config |= SE_AES_KEY2_INDEX(rctx->key2_id);
+
 	/* Set buffer size as a multiple of AES_BLOCK_SIZE*/
 	rctx->datbuf.size = ((req->cryptlen / AES_BLOCK_SIZE) + 1) * AES_BLOCK_SIZE;
 	rctx->datbuf.buf = dma_alloc_coherent(se->dev, rctx->datbuf.size,
 					      &rctx->datbuf.addr, GFP_KERNEL);
-	if (!rctx->datbuf.buf)
-		return -ENOMEM;
+	if (!rctx->datbuf.buf) {
+		ret = -ENOMEM;
+		goto key_put;
+	}
 
 	rctx->iv = (u32 *)req->iv;
 	rctx->len = req->cryptlen;
@@ -290,21 +367,23 @@ static int tegra_aes_do_one_req(struct crypto_engine *engine, void *areq)
 
 	scatterwalk_map_and_copy(rctx->datbuf.buf, req->src, 0, req->cryptlen, 0);
 
-	/* Prepare the command and submit for execution */
-	cmdlen = tegra_aes_prep_cmd(se, rctx);
-	ret = tegra_se_host1x_submit(se, cmdlen);
+	/*
+	 * Append the command to the batch. It is submitted once it is full,
+	 * or from tegra_aes_do_batch() when no more requests are queued.
+	 */
+	batch->words += tegra_aes_prep_cmd(se, rctx, batch->cmdbuf->addr + batch->words);
+	batch->reqs[batch->nreqs++] = req;
 
-	/* Copy the result */
-	tegra_aes_update_iv(req, ctx);
-	scatterwalk_map_and_copy(rctx->datbuf.buf, req->dst, 0, req->cryptlen, 1);
+	if (batch->nreqs >= clamp(aes_batch, 1U, SE_AES_BATCH_MAX))
+		tegra_aes_batch_flush(se);
 
-	/* Free the buffer */
-	dma_free_coherent(ctx->se->dev, rctx->datbuf.size,
-			  rctx->datbuf.buf, rctx->datbuf.addr);
+	return 0;
 
-	crypto_finalize_skcipher_request(se->engine, req, ret);
+key_put:
+	tegra_key_put(rctx->key2_id);
+	tegra_key_put(rctx->key1_id);
 
-	return 0;
+	return ret;
 }
 
 static int tegra_aes_cra_init(struct crypto_skcipher *tfm)
@@ -325,8 +404,6 @@ static int tegra_aes_cra_init(struct crypto_skcipher *tfm)
 
 	ctx->ivsize = crypto_skcipher_ivsize(tfm);
 	ctx->se = se_alg->se_dev;
-	ctx->key1_id = 0;
-	ctx->key2_id = 0;
 
 	algname = crypto_tfm_alg_name(&tfm->base);
 	ret = se_algname_to_algid(algname);
@@ -350,11 +427,8 @@ static void tegra_aes_cra_exit(struct crypto_skcipher *tfm)
 {
 	struct tegra_aes_ctx *ctx = crypto_tfm_ctx(&tfm->base);
 
-	if (ctx->key1_id)
-		tegra_key_invalidate(ctx->se, ctx->key1_id, ctx->alg);
-
-	if (ctx->key2_id)
-		tegra_key_invalidate(ctx->se, ctx->key2_id, ctx->alg);
+	tegra_key_invalidate(ctx->se, &ctx->key1);
+	tegra_key_invalidate(ctx->se, &ctx->key2);
 }
 
 static int tegra_aes_setkey(struct crypto_skcipher *tfm,
@@ -367,7 +441,9 @@ static int tegra_aes_setkey(struct crypto_skcipher *tfm,
 		return -EINVAL;
 	}
 
-	return tegra_key_submit(ctx->se, key, keylen, ctx->alg, &ctx->key1_id);
+	tegra_key_set(ctx->se, &ctx->key1, key, keylen, ctx->alg);
+
+	return 0;
 }
 
 static int tegra_xts_setkey(struct crypto_skcipher *tfm,
@@ -383,13 +459,8 @@ static int tegra_xts_setkey(struct crypto_skcipher *tfm,
 		return -EINVAL;
 	}
 
-	ret = tegra_key_submit(ctx->se, key, len,
-			       ctx->alg, &ctx->key1_id);
-	if (ret)
-		return ret;
-
-	return tegra_key_submit(ctx->se, key + len, len,
-			       ctx->alg, &ctx->key2_id);
+	tegra_key_set(ctx->se, &ctx->key1, key, len, ctx->alg);
+	tegra_key_set(ctx->se, &ctx->key2, key + len, len, ctx->alg);
 
 	return 0;
 }
@@ -462,10 +533,6 @@ static int tegra_aes_crypt(struct skcipher_request *req, bool encrypt)
 	rctx->encrypt = encrypt;
 	rctx->config = tegra234_aes_cfg(ctx->alg, encrypt);
 	rctx->crypto_config = tegra234_aes_crypto_cfg(ctx->alg, encrypt);
-	rctx->crypto_config |= SE_AES_KEY_INDEX(ctx->key1_id);
-
-	if (ctx->key2_id)
-		rctx->crypto_config |= SE_AES_KEY2_INDEX(ctx->key2_id);
 
 	return crypto_transfer_skcipher_request_to_engine(ctx->se->engine, req);
 }
@@ -594,11 +661,23 @@ static struct tegra_se_alg tegra_aes_algs[] = {
 	},
 };
 
-static unsigned int tegra_gmac_prep_cmd(struct tegra_se *se, struct tegra_aead_reqctx *rctx)
+/* one syncpt increment after the last stage of an AEAD command stream */
+static int tegra_aead_submit(struct tegra_se *se, unsigned int i)
 {
-	unsigned int data_count, res_bits, i = 0;
 	u32 *cpuvaddr = se->cmdbuf->addr;
 
+	cpuvaddr[i++] = se_host1x_opcode_nonincr(host1x_uclass_incr_syncpt_r(), 1);
+	cpuvaddr[i++] = host1x_uclass_incr_syncpt_cond_f(1) |
+			host1x_uclass_incr_syncpt_indx_f(se->syncpt_id);
+
+	return tegra_se_host1x_submit(se, i);
+}
+
+static unsigned int tegra_gmac_prep_cmd(struct tegra_se *se, u32 *cpuvaddr,
+					struct tegra_aead_reqctx *rctx)
+{
+	unsigned int data_count, res_bits, i = 0;
+
 	data_count = (rctx->assoclen / AES_BLOCK_SIZE);
 	res_bits = (rctx->assoclen % AES_BLOCK_SIZE) * 8;
 
@@ -625,17 +704,15 @@ static unsigned int tegra_gmac_prep_cmd(struct tegra_se *se, struct tegra_aead_r
 			SE_AES_OP_INIT | SE_AES_OP_LASTBUF |
 			SE_AES_OP_START;
 
-	cpuvaddr[i++] = se_host1x_opcode_nonincr(host1x_uclass_incr_syncpt_r(), 1);
-	cpuvaddr[i++] = host1x_uclass_incr_syncpt_cond_f(1) |
-			host1x_uclass_incr_syncpt_indx_f(se->syncpt_id);
-
 	return i;
 }
 
-static unsigned int tegra_gcm_crypt_prep_cmd(struct tegra_se *se, struct tegra_aead_reqctx *rctx)
+static unsigned int tegra_gcm_crypt_prep_cmd(struct tegra_se *se, u32 *cpuvaddr,
+					     struct tegra_aead_reqctx *rctx)
 {
 	unsigned int data_count, res_bits, i = 0, j;
-	u32 *cpuvaddr = se->cmdbuf->addr, op;
+	dma_addr_t src = rctx->inbuf.addr + rctx->assoclen;
+	u32 op;
 
 	data_count = (rctx->cryptlen / AES_BLOCK_SIZE);
 	res_bits = (rctx->cryptlen % AES_BLOCK_SIZE) * 8;
@@ -670,8 +747,8 @@ static unsigned int tegra_gcm_crypt_prep_cmd(struct tegra_se *se, struct tegra_a
 	cpuvaddr[i++] = rctx->crypto_config;
 
 	/* Source Address */
-	cpuvaddr[i++] = lower_32_bits(rctx->inbuf.addr);
-	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(rctx->inbuf.addr)) |
+	cpuvaddr[i++] = lower_32_bits(src);
+	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(src)) |
 			SE_ADDR_HI_SZ(rctx->cryptlen);
 
 	/* Destination Address */
@@ -682,16 +759,12 @@ static unsigned int tegra_gcm_crypt_prep_cmd(struct tegra_se *se, struct tegra_a
 	cpuvaddr[i++] = se_host1x_opcode_nonincr(se->hw->regs->op, 1);
 	cpuvaddr[i++] = op;
 
-	cpuvaddr[i++] = se_host1x_opcode_nonincr(host1x_uclass_incr_syncpt_r(), 1);
-	cpuvaddr[i++] = host1x_uclass_incr_syncpt_cond_f(1) |
-			host1x_uclass_incr_syncpt_indx_f(se->syncpt_id);
-
 	dev_dbg(se->dev, "cfg %#x crypto cfg %#x\n", rctx->config, rctx->crypto_config);
 	return i;
 }
 
 static int tegra_gcm_prep_final_cmd(struct tegra_se *se, u32 *cpuvaddr,
-				    struct tegra_aead_reqctx *rctx)
+				    struct tegra_aead_reqctx *rctx, dma_addr_t dst)
 {
 	unsigned int i = 0, j;
 	u32 op;
@@ -725,54 +798,60 @@ static int tegra_gcm_prep_final_cmd(struct tegra_se *se, u32 *cpuvaddr,
 	cpuvaddr[i++] = 0;
 
 	/* Destination Address */
-	cpuvaddr[i++] = lower_32_bits(rctx->outbuf.addr);
-	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(rctx->outbuf.addr)) |
+	cpuvaddr[i++] = lower_32_bits(dst);
+	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(dst)) |
 			SE_ADDR_HI_SZ(0x10); /* HW always generates 128-bit tag */
 
 	cpuvaddr[i++] = se_host1x_opcode_nonincr(se->hw->regs->op, 1);
 	cpuvaddr[i++] = op;
 
-	cpuvaddr[i++] = se_host1x_opcode_nonincr(host1x_uclass_incr_syncpt_r(), 1);
-	cpuvaddr[i++] = host1x_uclass_incr_syncpt_cond_f(1) |
-			host1x_uclass_incr_syncpt_indx_f(se->syncpt_id);
-
 	dev_dbg(se->dev, "cfg %#x crypto cfg %#x\n", rctx->config, rctx->crypto_config);
 
 	return i;
 }
 
-static int tegra_gcm_do_gmac(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
+/*
+ * GMAC, GCM and GCM_FINAL in one command stream. The GHASH state stays in the
+ * engine between the stages and WRSTALL orders them, so the request takes a
+ * single submit and syncpt wait. The input buffer holds the assoc data
+ * followed by the text, the output buffer the text and, at the next block
+ * boundary, the tag.
+ */
+static int tegra_gcm_do_crypt(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
 {
 	struct tegra_se *se = ctx->se;
-	unsigned int cmdlen;
-
-	scatterwalk_map_and_copy(rctx->inbuf.buf,
-				 rctx->src_sg, 0, rctx->assoclen, 0);
-
-	rctx->config = tegra234_aes_cfg(SE_ALG_GMAC, rctx->encrypt);
-	rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_GMAC, rctx->encrypt) |
-			      SE_AES_KEY_INDEX(ctx->key_id);
-
-	cmdlen = tegra_gmac_prep_cmd(se, rctx);
+	u32 *cpuvaddr = se->cmdbuf->addr;
+	unsigned int i = 0, tag_offset;
+	int ret;
 
-	return tegra_se_host1x_submit(se, cmdlen);
-}
+	scatterwalk_map_and_copy(rctx->inbuf.buf, rctx->src_sg, 0,
+				 rctx->assoclen + rctx->cryptlen, 0);
 
-static int tegra_gcm_do_crypt(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
-{
-	struct tegra_se *se = ctx->se;
-	int cmdlen, ret;
+	/* If there is associated data perform GMAC operation */
+	if (rctx->assoclen) {
+		rctx->config = tegra234_aes_cfg(SE_ALG_GMAC, rctx->encrypt);
+		rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_GMAC, rctx->encrypt) |
+				      SE_AES_KEY_INDEX(ctx->key_id);
+		i += tegra_gmac_prep_cmd(se, &cpuvaddr[i], rctx);
+	}
 
-	scatterwalk_map_and_copy(rctx->inbuf.buf, rctx->src_sg,
-				 rctx->assoclen, rctx->cryptlen, 0);
+	/* GCM Encryption/Decryption operation */
+	if (rctx->cryptlen) {
+		rctx->config = tegra234_aes_cfg(SE_ALG_GCM, rctx->encrypt);
+		rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_GCM, rctx->encrypt) |
+				      SE_AES_KEY_INDEX(ctx->key_id);
+		i += tegra_gcm_crypt_prep_cmd(se, &cpuvaddr[i], rctx);
+	}
 
-	rctx->config = tegra234_aes_cfg(SE_ALG_GCM, rctx->encrypt);
-	rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_GCM, rctx->encrypt) |
+	/* GCM_FINAL operation */
+	tag_offset = ALIGN(rctx->cryptlen, AES_BLOCK_SIZE);
+	rctx->config = tegra234_aes_cfg(SE_ALG_GCM_FINAL, rctx->encrypt);
+	rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_GCM_FINAL, rctx->encrypt) |
 			      SE_AES_KEY_INDEX(ctx->key_id);
+	i += tegra_gcm_prep_final_cmd(se, &cpuvaddr[i], rctx,
+				      rctx->outbuf.addr + tag_offset);
 
-	/* Prepare command and submit */
-	cmdlen = tegra_gcm_crypt_prep_cmd(se, rctx);
-	ret = tegra_se_host1x_submit(se, cmdlen);
+	ret = tegra_aead_submit(se, i);
 	if (ret)
 		return ret;
 
@@ -780,31 +859,10 @@ static int tegra_gcm_do_crypt(struct tegra_aead_ctx *ctx, struct tegra_aead_reqc
 	scatterwalk_map_and_copy(rctx->outbuf.buf, rctx->dst_sg,
 				 rctx->assoclen, rctx->cryptlen, 1);
 
-	return 0;
-}
-
-static int tegra_gcm_do_final(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
-{
-	struct tegra_se *se = ctx->se;
-	u32 *cpuvaddr = se->cmdbuf->addr;
-	int cmdlen, ret, offset;
-
-	rctx->config = tegra234_aes_cfg(SE_ALG_GCM_FINAL, rctx->encrypt);
-	rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_GCM_FINAL, rctx->encrypt) |
-			      SE_AES_KEY_INDEX(ctx->key_id);
-
-	/* Prepare command and submit */
-	cmdlen = tegra_gcm_prep_final_cmd(se, cpuvaddr, rctx);
-	ret = tegra_se_host1x_submit(se, cmdlen);
-	if (ret)
-		return ret;
-
-	if (rctx->encrypt) {
-		/* Copy the result */
-		offset = rctx->assoclen + rctx->cryptlen;
-		scatterwalk_map_and_copy(rctx->outbuf.buf, rctx->dst_sg,
-					 offset, rctx->authsize, 1);
-	}
+	if (rctx->encrypt)
+		scatterwalk_map_and_copy(rctx->outbuf.buf + tag_offset, rctx->dst_sg,
+					 rctx->assoclen + rctx->cryptlen,
+					 rctx->authsize, 1);
 
 	return 0;
 }
@@ -817,7 +875,8 @@ static int tegra_gcm_do_verify(struct tegra_se *se, struct tegra_aead_reqctx *rc
 	offset = rctx->assoclen + rctx->cryptlen;
 	scatterwalk_map_and_copy(mac, rctx->src_sg, offset, rctx->authsize, 0);
 
-	if (crypto_memneq(rctx->outbuf.buf, mac, rctx->authsize))
+	if (crypto_memneq(rctx->outbuf.buf + ALIGN(rctx->cryptlen, AES_BLOCK_SIZE),
+			  mac, rctx->authsize))
 		return -EBADMSG;
 
 	return 0;
@@ -837,10 +896,12 @@ static inline int tegra_ccm_check_iv(const u8 *iv)
 	return 0;
 }
 
-static unsigned int tegra_cbcmac_prep_cmd(struct tegra_se *se, struct tegra_aead_reqctx *rctx)
+static unsigned int tegra_cbcmac_prep_cmd(struct tegra_se *se, u32 *cpuvaddr,
+					  struct tegra_aead_reqctx *rctx)
 {
+	dma_addr_t dst = rctx->outbuf.addr + AES_BLOCK_SIZE +
+			 ALIGN(rctx->cryptlen, AES_BLOCK_SIZE);
 	unsigned int data_count, i = 0;
-	u32 *cpuvaddr = se->cmdbuf->addr;
 
 	data_count = (rctx->inbuf.size / AES_BLOCK_SIZE) - 1;
 
@@ -855,75 +916,67 @@ static unsigned int tegra_cbcmac_prep_cmd(struct tegra_se *se, struct tegra_aead
 	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(rctx->inbuf.addr)) |
 			SE_ADDR_HI_SZ(rctx->inbuf.size);
 
-	cpuvaddr[i++] = lower_32_bits(rctx->outbuf.addr);
-	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(rctx->outbuf.addr)) |
+	/* behind the CTR blocks of the same stream */
+	cpuvaddr[i++] = lower_32_bits(dst);
+	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(dst)) |
 			SE_ADDR_HI_SZ(0x10); /* HW always generates 128 bit tag */
 
 	cpuvaddr[i++] = se_host1x_opcode_nonincr(se->hw->regs->op, 1);
 	cpuvaddr[i++] = SE_AES_OP_WRSTALL |
 			SE_AES_OP_LASTBUF | SE_AES_OP_START;
 
-	cpuvaddr[i++] = se_host1x_opcode_nonincr(host1x_uclass_incr_syncpt_r(), 1);
-	cpuvaddr[i++] = host1x_uclass_incr_syncpt_cond_f(1) |
-			host1x_uclass_incr_syncpt_indx_f(se->syncpt_id);
-
 	return i;
 }
 
-static unsigned int tegra_ctr_prep_cmd(struct tegra_se *se, struct tegra_aead_reqctx *rctx)
+/* CTR over size bytes, a multiple of the block size, from counter ctr */
+static unsigned int tegra_ctr_prep_cmd(struct tegra_se *se, u32 *cpuvaddr,
+				       struct tegra_aead_reqctx *rctx, const u32 *ctr,
+				       dma_addr_t src, dma_addr_t dst, unsigned int size)
 {
 	unsigned int i = 0, j;
-	u32 *cpuvaddr = se->cmdbuf->addr;
 
 	cpuvaddr[i++] = host1x_opcode_setpayload(SE_CRYPTO_CTR_REG_COUNT);
 	cpuvaddr[i++] = se_host1x_opcode_incr_w(se->hw->regs->linear_ctr);
 	for (j = 0; j < SE_CRYPTO_CTR_REG_COUNT; j++)
-		cpuvaddr[i++] = rctx->iv[j];
+		cpuvaddr[i++] = ctr[j];
 
 	cpuvaddr[i++] = se_host1x_opcode_nonincr(se->hw->regs->last_blk, 1);
-	cpuvaddr[i++] = (rctx->inbuf.size / AES_BLOCK_SIZE) - 1;
+	cpuvaddr[i++] = (size / AES_BLOCK_SIZE) - 1;
 	cpuvaddr[i++] = se_host1x_opcode_incr(se->hw->regs->config, 6);
 	cpuvaddr[i++] = rctx->config;
 	cpuvaddr[i++] = rctx->crypto_config;
 
 	/* Source address setting */
-	cpuvaddr[i++] = lower_32_bits(rctx->inbuf.addr);
-	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(rctx->inbuf.addr)) |
-			SE_ADDR_HI_SZ(rctx->inbuf.size);
+	cpuvaddr[i++] = lower_32_bits(src);
+	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(src)) | SE_ADDR_HI_SZ(size);
 
 	/* Destination address setting */
-	cpuvaddr[i++] = lower_32_bits(rctx->outbuf.addr);
-	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(rctx->outbuf.addr)) |
-			SE_ADDR_HI_SZ(rctx->inbuf.size);
+	cpuvaddr[i++] = lower_32_bits(dst);
+	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(dst)) | SE_ADDR_HI_SZ(size);
 
 	cpuvaddr[i++] = se_host1x_opcode_nonincr(se->hw->regs->op, 1);
 	cpuvaddr[i++] = SE_AES_OP_WRSTALL | SE_AES_OP_LASTBUF |
 			SE_AES_OP_START;
 
-	cpuvaddr[i++] = se_host1x_opcode_nonincr(host1x_uclass_incr_syncpt_r(), 1);
-	cpuvaddr[i++] = host1x_uclass_incr_syncpt_cond_f(1) |
-			host1x_uclass_incr_syncpt_indx_f(se->syncpt_id);
-
 	dev_dbg(se->dev, "cfg %#x crypto cfg %#x\n",
 		rctx->config, rctx->crypto_config);
 
 	return i;
 }
 
-static int tegra_ccm_do_cbcmac(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
+static void tegra_ccm_cbcmac_cfg(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
 {
-	struct tegra_se *se = ctx->se;
-	int cmdlen;
-
 	rctx->config = tegra234_aes_cfg(SE_ALG_CBC_MAC, rctx->encrypt);
 	rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_CBC_MAC,
 						      rctx->encrypt) |
 						      SE_AES_KEY_INDEX(ctx->key_id);
+}
 
-	/* Prepare command and submit */
-	cmdlen = tegra_cbcmac_prep_cmd(se, rctx);
-
-	return tegra_se_host1x_submit(se, cmdlen);
+static void tegra_ccm_ctr_cfg(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
+{
+	rctx->config = tegra234_aes_cfg(SE_ALG_CTR, rctx->encrypt);
+	rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_CTR, rctx->encrypt) |
+			      SE_AES_KEY_INDEX(ctx->key_id);
 }
 
 static int tegra_ccm_set_msg_len(u8 *block, unsigned int msglen, int csize)
@@ -1029,9 +1082,11 @@ static int tegra_ccm_format_blocks(struct tegra_aead_reqctx *rctx)
 	return offset;
 }
 
+/* compare or return the tag, S0 is the key stream of counter 0 in outbuf */
 static int tegra_ccm_mac_result(struct tegra_se *se, struct tegra_aead_reqctx *rctx)
 {
 	u32 result[16];
+	u8 *tag = (u8 *)result, *s0 = rctx->outbuf.buf;
 	int i, ret;
 
 	/* Read and clear Result */
@@ -1041,125 +1096,132 @@ static int tegra_ccm_mac_result(struct tegra_se *se, struct tegra_aead_reqctx *r
 	for (i = 0; i < CMAC_RESULT_REG_COUNT; i++)
 		writel(0, se->base + se->hw->regs->result + (i * 4));
 
+	crypto_xor(tag, s0, rctx->authsize);
+
 	if (rctx->encrypt) {
-		memcpy(rctx->authdata, result, rctx->authsize);
+		scatterwalk_map_and_copy(tag, rctx->dst_sg,
+					 rctx->assoclen + rctx->cryptlen,
+					 rctx->authsize, 1);
+		ret = 0;
 	} else {
-		ret = crypto_memneq(rctx->authdata, result, rctx->authsize);
-		if (ret)
-			return -EBADMSG;
+		ret = crypto_memneq(rctx->authdata, tag, rctx->authsize) ?
+		      -EBADMSG : 0;
 	}
 
-	return 0;
-}
-
-static int tegra_ccm_ctr_result(struct tegra_se *se, struct tegra_aead_reqctx *rctx)
-{
-	/* Copy result */
-	scatterwalk_map_and_copy(rctx->outbuf.buf + 16, rctx->dst_sg,
-				 rctx->assoclen, rctx->cryptlen, 1);
-
-	if (rctx->encrypt)
-		scatterwalk_map_and_copy(rctx->outbuf.buf, rctx->dst_sg,
-					 rctx->assoclen + rctx->cryptlen,
-					 rctx->authsize, 1);
-	else
-		memcpy(rctx->authdata, rctx->outbuf.buf, rctx->authsize);
+	memzero_explicit(result, sizeof(result));
 
-	return 0;
+	return ret;
 }
 
-static int tegra_ccm_compute_auth(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
+/*
+ * CBC-MAC of the formatted blocks followed by CTR over a zero block and the
+ * plain text, in one command stream. The zero block yields S0, which the CPU
+ * applies to the MAC, so neither stage waits for the result of the other.
+ */
+static int tegra_ccm_do_encrypt(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
 {
 	struct tegra_se *se = ctx->se;
-	struct scatterlist *sg;
+	u32 *cpuvaddr = se->cmdbuf->addr;
+	unsigned int i = 0, ctrlen;
 	int offset, ret;
 
 	offset = tegra_ccm_format_blocks(rctx);
 	if (offset < 0)
 		return -EINVAL;
 
-	/* Copy plain text to the buffer */
-	sg = rctx->encrypt ? rctx->src_sg : rctx->dst_sg;
-
-	scatterwalk_map_and_copy(rctx->inbuf.buf + offset,
-				 sg, rctx->assoclen,
-				 rctx->cryptlen, 0);
+	scatterwalk_map_and_copy(rctx->inbuf.buf + offset, rctx->src_sg,
+				 rctx->assoclen, rctx->cryptlen, 0);
 	offset += rctx->cryptlen;
 	offset += tegra_ccm_add_padding(rctx->inbuf.buf + offset, rctx->cryptlen);
-
 	rctx->inbuf.size = offset;
 
-	ret = tegra_ccm_do_cbcmac(ctx, rctx);
+	ctrlen = AES_BLOCK_SIZE + ALIGN(rctx->cryptlen, AES_BLOCK_SIZE);
+	memset(rctx->outbuf.buf, 0, ctrlen);
+	scatterwalk_map_and_copy(rctx->outbuf.buf + AES_BLOCK_SIZE, rctx->src_sg,
+				 rctx->assoclen, rctx->cryptlen, 0);
+
+	tegra_ccm_cbcmac_cfg(ctx, rctx);
+	i += tegra_cbcmac_prep_cmd(se, &cpuvaddr[i], rctx);
+
+	tegra_ccm_ctr_cfg(ctx, rctx);
+	i += tegra_ctr_prep_cmd(se, &cpuvaddr[i], rctx, rctx->iv,
+				rctx->outbuf.addr, rctx->outbuf.addr, ctrlen);
+
+	ret = tegra_aead_submit(se, i);
 	if (ret)
 		return ret;
 
+	scatterwalk_map_and_copy(rctx->outbuf.buf + AES_BLOCK_SIZE, rctx->dst_sg,
+				 rctx->assoclen, rctx->cryptlen, 1);
+
 	return tegra_ccm_mac_result(se, rctx);
 }
 
-static int tegra_ccm_do_ctr(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
+/*
+ * S0, then the cipher text decrypted from counter 1 straight behind the
+ * formatted blocks, then the CBC-MAC over them. The engine writes whole
+ * blocks, so a partial last block is cleared by the CPU before the MAC,
+ * which then needs a second submit.
+ */
+static int tegra_ccm_do_decrypt(struct tegra_aead_ctx *ctx, struct tegra_aead_reqctx *rctx)
 {
 	struct tegra_se *se = ctx->se;
-	unsigned int cmdlen, offset = 0;
-	struct scatterlist *sg = rctx->src_sg;
-	int ret;
+	u32 *cpuvaddr = se->cmdbuf->addr;
+	unsigned int i = 0, padded;
+	u32 ctr1[SE_CRYPTO_CTR_REG_COUNT];
+	int offset, ret;
 
-	rctx->config = tegra234_aes_cfg(SE_ALG_CTR, rctx->encrypt);
-	rctx->crypto_config = tegra234_aes_crypto_cfg(SE_ALG_CTR, rctx->encrypt) |
-			      SE_AES_KEY_INDEX(ctx->key_id);
+	scatterwalk_map_and_copy(rctx->authdata, rctx->src_sg,
+				 rctx->assoclen + rctx->cryptlen,
+				 rctx->authsize, 0);
 
-	/* Copy authdata in the top of buffer for encryption/decryption */
-	if (rctx->encrypt)
-		memcpy(rctx->inbuf.buf, rctx->authdata, rctx->authsize);
-	else
-		scatterwalk_map_and_copy(rctx->inbuf.buf, sg,
-					 rctx->assoclen + rctx->cryptlen,
-					 rctx->authsize, 0);
+	offset = tegra_ccm_format_blocks(rctx);
+	if (offset < 0)
+		return -EINVAL;
 
-	offset += rctx->authsize;
-	offset += tegra_ccm_add_padding(rctx->inbuf.buf + offset, rctx->authsize);
+	padded = ALIGN(rctx->cryptlen, AES_BLOCK_SIZE);
+	rctx->inbuf.size = offset + padded;
 
-	/* If there is no cryptlen, proceed to submit the task */
-	if (rctx->cryptlen) {
-		scatterwalk_map_and_copy(rctx->inbuf.buf + offset, sg,
-					 rctx->assoclen, rctx->cryptlen, 0);
-		offset += rctx->cryptlen;
-		offset += tegra_ccm_add_padding(rctx->inbuf.buf + offset, rctx->cryptlen);
-	}
+	memset(rctx->outbuf.buf, 0, AES_BLOCK_SIZE + padded);
+	scatterwalk_map_and_copy(rctx->outbuf.buf + AES_BLOCK_SIZE, rctx->src_sg,
+				 rctx->assoclen, rctx->cryptlen, 0);
 
-	rctx->inbuf.size = offset;
+	tegra_ccm_ctr_cfg(ctx, rctx);
+	i += tegra_ctr_prep_cmd(se, &cpuvaddr[i], rctx, rctx->iv,
+				rctx->outbuf.addr, rctx->outbuf.addr,
+				AES_BLOCK_SIZE);
 
-	/* Prepare command and submit */
-	cmdlen = tegra_ctr_prep_cmd(se, rctx);
-	ret = tegra_se_host1x_submit(se, cmdlen);
-	if (ret)
-		return ret;
+	if (rctx->cryptlen) {
+		/* counter 0 has its counter bytes cleared, counter 1 ends in 1 */
+		memcpy(ctr1, rctx->iv, sizeof(ctr1));
+		((u8 *)ctr1)[AES_BLOCK_SIZE - 1] = 1;
 
-	return tegra_ccm_ctr_result(se, rctx);
-}
+		i += tegra_ctr_prep_cmd(se, &cpuvaddr[i], rctx, ctr1,
+					rctx->outbuf.addr + AES_BLOCK_SIZE,
+					rctx->inbuf.addr + offset, padded);
+	}
 
-static int tegra_ccm_crypt_init(struct aead_request *req, struct tegra_se *se,
-				struct tegra_aead_reqctx *rctx)
-{
-	u8 *iv = (u8 *)rctx->iv;
-	int ret, i;
+	if (!IS_ALIGNED(rctx->cryptlen, AES_BLOCK_SIZE)) {
+		ret = tegra_aead_submit(se, i);
+		if (ret)
+			return ret;
 
-	memcpy(iv, req->iv, 16);
+		memset(rctx->inbuf.buf + offset + rctx->cryptlen, 0,
+		       padded - rctx->cryptlen);
+		i = 0;
+	}
 
-	ret = tegra_ccm_check_iv(iv);
+	tegra_ccm_cbcmac_cfg(ctx, rctx);
+	i += tegra_cbcmac_prep_cmd(se, &cpuvaddr[i], rctx);
+
+	ret = tegra_aead_submit(se, i);
 	if (ret)
 		return ret;
 
-	/* Note: rfc 3610 and NIST 800-38C require counter (ctr_0) of
-	 * zero to encrypt auth tag.
-	 * req->iv has the formatted ctr_0 (i.e. Flags || N || 0).
-	 */
-	memset(iv + 15 - iv[0], 0, iv[0] + 1);
-
-	/* Clear any previous result */
-	for (i = 0; i < CMAC_RESULT_REG_COUNT; i++)
-		writel(0, se->base + se->hw->regs->result + (i * 4));
+	scatterwalk_map_and_copy(rctx->inbuf.buf + offset, rctx->dst_sg,
+				 rctx->assoclen, rctx->cryptlen, 1);
 
-	return 0;
+	return tegra_ccm_mac_result(se, rctx);
 }
 
 static int tegra_ccm_do_one_req(struct crypto_engine *engine, void *areq)
@@ -1171,6 +1233,10 @@ static int tegra_ccm_do_one_req(struct crypto_engine *engine, void *areq)
 	struct tegra_se *se = ctx->se;
 	int ret;
 
+	ret = tegra_key_get(se, &ctx->key, &ctx->key_id);
+	if (ret)
+		return ret;
+
 	rctx->src_sg = req->src;
 	rctx->dst_sg = req->dst;
 	rctx->assoclen = req->assoclen;
@@ -1185,8 +1251,10 @@ static int tegra_ccm_do_one_req(struct crypto_engine *engine, void *areq)
 	/* Allocate buffers required */
 	rctx->inbuf.buf = dma_alloc_coherent(ctx->se->dev, rctx->inbuf.size,
 					     &rctx->inbuf.addr, GFP_KERNEL);
-	if (!rctx->inbuf.buf)
+	if (!rctx->inbuf.buf) {
+		tegra_key_put(ctx->key_id);
 		return -ENOMEM;
+	}
 
 	rctx->outbuf.size = rctx->assoclen + rctx->authsize + rctx->cryptlen + 100;
 	rctx->outbuf.buf = dma_alloc_coherent(ctx->se->dev, rctx->outbuf.size,
@@ -1200,28 +1268,10 @@ static int tegra_ccm_do_one_req(struct crypto_engine *engine, void *areq)
 	if (ret)
 		goto out;
 
-	if (rctx->encrypt) {
-
-		/* CBC MAC Operation */
-		ret = tegra_ccm_compute_auth(ctx, rctx);
-		if (ret)
-			goto out;
-
-		/* CTR operation */
-		ret = tegra_ccm_do_ctr(ctx, rctx);
-		if (ret)
-			goto out;
-	} else {
-		/* CTR operation */
-		ret = tegra_ccm_do_ctr(ctx, rctx);
-		if (ret)
-			goto out;
-
-		/* CBC MAC Operation */
-		ret = tegra_ccm_compute_auth(ctx, rctx);
-		if (ret)
-			goto out;
-	}
+	if (rctx->encrypt)
+		ret = tegra_ccm_do_encrypt(ctx, rctx);
+	else
+		ret = tegra_ccm_do_decrypt(ctx, rctx);
 
 out:
 	dma_free_coherent(ctx->se->dev, rctx->outbuf.size,
@@ -1231,6 +1281,8 @@ outbuf_err:
 	dma_free_coherent(ctx->se->dev, rctx->inbuf.size,
 			  rctx->inbuf.buf, rctx->inbuf.addr);
 
+	tegra_key_put(ctx->key_id);
+
 	crypto_finalize_aead_request(ctx->se->engine, req, ret);
 
 	return 0;
@@ -1244,6 +1296,10 @@ static int tegra_gcm_do_one_req(struct crypto_engine *engine, void *areq)
 	struct tegra_aead_reqctx *rctx = aead_request_ctx(req);
 	int ret;
 
+	ret = tegra_key_get(ctx->se, &ctx->key, &ctx->key_id);
+	if (ret)
+		return ret;
+
 	rctx->src_sg = req->src;
 	rctx->dst_sg = req->dst;
 	rctx->assoclen = req->assoclen;
@@ -1258,11 +1314,14 @@ static int tegra_gcm_do_one_req(struct crypto_engine *engine, void *areq)
 	rctx->inbuf.size = rctx->assoclen + rctx->authsize + rctx->cryptlen;
 	rctx->inbuf.buf = dma_alloc_coherent(ctx->se->dev, rctx->inbuf.size,
 					     &rctx->inbuf.addr, GFP_KERNEL);
-	if (!rctx->inbuf.buf)
+	if (!rctx->inbuf.buf) {
+		tegra_key_put(ctx->key_id);
 		return -ENOMEM;
+	}
 
 
-	rctx->outbuf.size = rctx->assoclen + rctx->authsize + rctx->cryptlen;
+	/* text, then the 128 bit tag at the next block boundary */
+	rctx->outbuf.size = ALIGN(rctx->cryptlen, AES_BLOCK_SIZE) + AES_BLOCK_SIZE;
 	rctx->outbuf.buf = dma_alloc_coherent(ctx->se->dev, rctx->outbuf.size,
 					      &rctx->outbuf.addr, GFP_KERNEL);
 	if (!rctx->outbuf.buf) {
@@ -1273,22 +1332,7 @@ static int tegra_gcm_do_one_req(struct crypto_engine *engine, void *areq)
 	memcpy(rctx->iv, req->iv, GCM_AES_IV_SIZE);
 	rctx->iv[3] = (1 << 24);
 
-	/* If there is associated data perform GMAC operation */
-	if (rctx->assoclen) {
-		ret = tegra_gcm_do_gmac(ctx, rctx);
-		if (ret)
-			goto out;
-	}
-
-	/* GCM Encryption/Decryption operation */
-	if (rctx->cryptlen) {
-		ret = tegra_gcm_do_crypt(ctx, rctx);
-		if (ret)
-			goto out;
-	}
-
-	/* GCM_FINAL operation */
-	ret = tegra_gcm_do_final(ctx, rctx);
+	ret = tegra_gcm_do_crypt(ctx, rctx);
 	if (ret)
 		goto out;
 
@@ -1303,12 +1347,13 @@ outbuf_err:
 	dma_free_coherent(ctx->se->dev, rctx->inbuf.size,
 			  rctx->inbuf.buf, rctx->inbuf.addr);
 
+	tegra_key_put(ctx->key_id);
+
 	/* Finalize the request if there are no errors */
 	crypto_finalize_aead_request(ctx->se->engine, req, ret);
 
 	return 0;
 }
-
 static int tegra_ccm_cra_init(struct crypto_aead *tfm)
 {
 	struct tegra_aead_ctx *ctx = crypto_aead_ctx(tfm);
@@ -1424,8 +1469,7 @@ static void tegra_aead_cra_exit(struct crypto_aead *tfm)
 {
 	struct tegra_aead_ctx *ctx = crypto_tfm_ctx(&tfm->base);
 
-	if (ctx->key_id)
-		tegra_key_invalidate(ctx->se, ctx->key_id, ctx->alg);
+	tegra_key_invalidate(ctx->se, &ctx->key);
 }
 
 static int tegra_aead_crypt(struct aead_request *req, bool encrypt)
@@ -1459,7 +1503,9 @@ static int tegra_aead_setkey(struct crypto_aead *tfm,
 		return -EINVAL;
 	}
 
-	return tegra_key_submit(ctx->se, key, keylen, ctx->alg, &ctx->key_id);
+	tegra_key_set(ctx->se, &ctx->key, key, keylen, ctx->alg);
+
+	return 0;
 }
 
 static unsigned int tegra_cmac_prep_cmd(struct tegra_se *se, struct tegra_cmac_reqctx *rctx)
@@ -1656,6 +1702,10 @@ static int tegra_cmac_do_one_req(struct crypto_engine *engine, void *areq)
 	struct tegra_se *se = ctx->se;
 	int ret;
 
+	ret = tegra_key_get(se, &ctx->key, &ctx->key_id);
+	if (ret)
+		return ret;
+
 	if (rctx->task & SHA_UPDATE) {
 		ret = tegra_cmac_do_update(req);
 		rctx->task &= ~SHA_UPDATE;
@@ -1666,6 +1716,8 @@ static int tegra_cmac_do_one_req(struct crypto_engine *engine, void *areq)
 		rctx->task &= ~SHA_FINAL;
 	}
 
+	tegra_key_put(ctx->key_id);
+
 	crypto_finalize_hash_request(se->engine, req, ret);
 
 	return 0;
@@ -1737,7 +1789,7 @@ static void tegra_cmac_cra_exit(struct crypto_tfm *tfm)
 	if (ctx->fallback_tfm)
 		crypto_free_shash(ctx->fallback_tfm);
 
-	tegra_key_invalidate(ctx->se, ctx->key_id, ctx->alg);
+	tegra_key_invalidate(ctx->se, &ctx->key);
 }
 
 static int tegra_cmac_init(struct ahash_request *req)
@@ -1794,7 +1846,9 @@ static int tegra_cmac_setkey(struct crypto_ahash *tfm, const u8 *key,
 	if (ctx->fallback_tfm)
 		crypto_shash_setkey(ctx->fallback_tfm, key, keylen);
 
-	return tegra_key_submit(ctx->se, key, keylen, ctx->alg, &ctx->key_id);
+	tegra_key_set(ctx->se, &ctx->key, key, keylen, ctx->alg);
+
+	return 0;
 }
 
 static int tegra_cmac_update(struct ahash_request *req)
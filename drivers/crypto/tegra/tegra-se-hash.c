@@ -6,10 +6,14 @@
 
 #include <nvidia/conftest.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 
 #include <crypto/aes.h>
 #include <crypto/sha1.h>
@@ -29,7 +33,7 @@ struct tegra_sha_ctx {
 	struct tegra_se *se;
 	unsigned int alg;
 	bool fallback;
-	u32 key_id;
+	struct tegra_se_key key;
 	struct crypto_ahash *fallback_tfm;
 };
 
@@ -44,10 +48,14 @@ struct tegra_sha_reqctx {
 	unsigned int blk_size;
 	unsigned int task;
 	u32 key_id;
+	u64 state_seq;
 	u32 result[HASH_RESULT_REG_COUNT];
 	struct ahash_request fallback_req;
 };
 
+/* Identifies the intermediate results left in the result registers */
+static atomic64_t tegra_sha_state_seq = ATOMIC64_INIT(0);
+
 static int tegra_sha_get_config(u32 alg)
 {
 	int cfg = 0;
@@ -216,13 +224,14 @@ static int tegra_sha_fallback_export(struct ahash_request *req, void *out)
 }
 
 static int tegra_sha_prep_cmd(struct tegra_se *se, u32 *cpuvaddr,
-			      struct tegra_sha_reqctx *rctx)
+			      struct tegra_sha_reqctx *rctx,
+			      struct tegra_se_datbuf *datbuf)
 {
 	u64 msg_len, msg_left;
 	int i = 0;
 
 	msg_len = rctx->total_len * 8;
-	msg_left = rctx->datbuf.size * 8;
+	msg_left = datbuf->size * 8;
 
 	/*
 	 * If IN_ADDR_HI_0.SZ > SHA_MSG_LEFT_[0-3] to the HASH engine,
@@ -256,9 +265,9 @@ static int tegra_sha_prep_cmd(struct tegra_se *se, u32 *cpuvaddr,
 		cpuvaddr[i++] = 0;
 	}
 
-	cpuvaddr[i++] = rctx->datbuf.addr;
-	cpuvaddr[i++] = (u32)(SE_ADDR_HI_MSB(upper_32_bits(rctx->datbuf.addr)) |
-				SE_ADDR_HI_SZ(rctx->datbuf.size));
+	cpuvaddr[i++] = datbuf->addr;
+	cpuvaddr[i++] = (u32)(SE_ADDR_HI_MSB(upper_32_bits(datbuf->addr)) |
+				SE_ADDR_HI_SZ(datbuf->size));
 	cpuvaddr[i++] = rctx->digest.addr;
 	cpuvaddr[i++] = (u32)(SE_ADDR_HI_MSB(upper_32_bits(rctx->digest.addr)) |
 				SE_ADDR_HI_SZ(rctx->digest.size));
@@ -300,12 +309,85 @@ static void tegra_sha_paste_hash_result(struct tegra_se *se, struct tegra_sha_re
 		       se->base + se->hw->regs->result + (i * 4));
 }
 
+/*
+ * Hash @len bytes, the residue of the previous update followed by the start
+ * of the request, in chunks of whole blocks. The intermediate results stay in
+ * the result registers from one chunk to the next, so the command of a chunk
+ * is queued while the previous one is still being hashed and the CPU copies
+ * the next chunk into the other buffer meanwhile.
+ */
+static int tegra_sha_hash_chunks(struct ahash_request *req, unsigned int len)
+{
+	struct tegra_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct tegra_sha_reqctx *rctx = ahash_request_ctx(req);
+	struct tegra_se *se = ctx->se;
+	struct host1x_job *job[2] = { NULL, NULL };
+	unsigned int max = rounddown(SE_SHA_BUFLEN, rctx->blk_size);
+	unsigned int chunk, pos, off = 0, n = 0, b;
+	struct tegra_se_datbuf *buf;
+	u32 *cpuvaddr;
+	int size, ret = 0, err;
+
+	for (; len; len -= chunk, n++) {
+		b = n & 1;
+		buf = &se->hash.buf[b];
+		cpuvaddr = se->cmdbuf->addr + b * (SZ_2K / 4);
+
+		/* The buffer and command of chunk n - 2 are free again */
+		if (job[b]) {
+			ret = tegra_se_host1x_wait(se, job[b]);
+			job[b] = NULL;
+			if (ret)
+				break;
+		}
+
+		chunk = min(len, max);
+		pos = 0;
+
+		if (!n && rctx->residue.size) {
+			memcpy(buf->buf, rctx->residue.buf, rctx->residue.size);
+			pos = rctx->residue.size;
+		}
+
+		scatterwalk_map_and_copy(buf->buf + pos, rctx->src_sg, off,
+					 chunk - pos, 0);
+		off += chunk - pos;
+
+		buf->size = chunk;
+		rctx->total_len += chunk;
+
+		size = tegra_sha_prep_cmd(se, cpuvaddr, rctx, buf);
+
+		job[b] = tegra_se_host1x_submit_async(se, se->cmdbuf,
+						      b * SZ_2K, size);
+		if (IS_ERR(job[b])) {
+			ret = PTR_ERR(job[b]);
+			job[b] = NULL;
+			break;
+		}
+	}
+
+	/* Chunk n - 2 first, it was queued before chunk n - 1 */
+	for (b = 0; b < 2; b++, n++) {
+		if (!job[n & 1])
+			continue;
+
+		err = tegra_se_host1x_wait(se, job[n & 1]);
+		if (!ret)
+			ret = err;
+	}
+
+	return ret;
+}
+
 static int tegra_sha_do_update(struct ahash_request *req)
 {
 	struct tegra_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
 	struct tegra_sha_reqctx *rctx = ahash_request_ctx(req);
-	unsigned int nblks, nresidue, size, ret;
-	u32 *cpuvaddr = ctx->se->cmdbuf->addr;
+	struct tegra_se *se = ctx->se;
+	unsigned int nblks, nresidue, len;
+	ktime_t start;
+	int ret;
 
 	nresidue = (req->nbytes + rctx->residue.size) % rctx->blk_size;
 	nblks = (req->nbytes + rctx->residue.size) / rctx->blk_size;
@@ -320,8 +402,7 @@ static int tegra_sha_do_update(struct ahash_request *req)
 	}
 
 	rctx->src_sg = req->src;
-	rctx->datbuf.size = (req->nbytes + rctx->residue.size) - nresidue;
-	rctx->total_len += rctx->datbuf.size;
+	len = (req->nbytes + rctx->residue.size) - nresidue;
 
 	/*
 	 * If nbytes are less than a block size, copy it residue and
@@ -335,33 +416,40 @@ static int tegra_sha_do_update(struct ahash_request *req)
 		return 0;
 	}
 
-	/* Copy the previous residue first */
-	if (rctx->residue.size)
-		memcpy(rctx->datbuf.buf, rctx->residue.buf, rctx->residue.size);
-
-	scatterwalk_map_and_copy(rctx->datbuf.buf + rctx->residue.size,
-				 rctx->src_sg, 0, req->nbytes - nresidue, 0);
-
-	scatterwalk_map_and_copy(rctx->residue.buf, rctx->src_sg,
-				 req->nbytes - nresidue, nresidue, 0);
-
-	/* Update residue value with the residue after current block */
-	rctx->residue.size = nresidue;
-
 	rctx->config = tegra_sha_get_config(rctx->alg) |
 			SE_SHA_DST_HASH_REG;
 
 	/*
 	 * If this is not the first 'update' call, paste the previous copied
 	 * intermediate results to the registers so that it gets picked up.
-	 * This is to support the import/export functionality.
+	 * This is to support the import/export functionality. Registers that
+	 * still hold the results of this request since its last update are
+	 * left alone.
 	 */
-	if (!(rctx->task & SHA_FIRST))
-		tegra_sha_paste_hash_result(ctx->se, rctx);
+	if (!(rctx->task & SHA_FIRST)) {
+		if (rctx->state_seq && rctx->state_seq == se->hash.loaded_seq)
+			se->hash.paste_skipped++;
+		else
+			tegra_sha_paste_hash_result(se, rctx);
+	}
 
-	size = tegra_sha_prep_cmd(ctx->se, cpuvaddr, rctx);
+	start = ktime_get();
+	ret = tegra_sha_hash_chunks(req, len);
 
-	ret = tegra_se_host1x_submit(ctx->se, size);
+	se->hash.updates++;
+	se->hash.bytes += len;
+	se->hash.busy_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	/* The residue is not touched by the engine, keep it after the data */
+	scatterwalk_map_and_copy(rctx->residue.buf, rctx->src_sg,
+				 req->nbytes - nresidue, nresidue, 0);
+
+	/* Update residue value with the residue after current block */
+	rctx->residue.size = nresidue;
+
+	se->hash.loaded_seq = 0;
+	if (ret)
+		return ret;
 
 	/*
 	 * If this is not the final update, copy the intermediate results
@@ -369,9 +457,12 @@ static int tegra_sha_do_update(struct ahash_request *req)
 	 * call. This is to support the import/export functionality.
 	 */
 	if (!(rctx->task & SHA_FINAL))
-		tegra_sha_copy_hash_result(ctx->se, rctx);
+		tegra_sha_copy_hash_result(se, rctx);
 
-	return ret;
+	rctx->state_seq = atomic64_inc_return(&tegra_sha_state_seq);
+	se->hash.loaded_seq = rctx->state_seq;
+
+	return 0;
 }
 
 static int tegra_sha_do_final(struct ahash_request *req)
@@ -390,7 +481,15 @@ static int tegra_sha_do_final(struct ahash_request *req)
 	rctx->config = tegra_sha_get_config(rctx->alg) |
 		       SE_SHA_DST_MEMORY;
 
-	size = tegra_sha_prep_cmd(se, cpuvaddr, rctx);
+	/* Another request may have used the registers since the last update */
+	if (!(rctx->task & SHA_FIRST) &&
+	    (!rctx->state_seq || rctx->state_seq != se->hash.loaded_seq))
+		tegra_sha_paste_hash_result(se, rctx);
+
+	/* The final operation changes the result registers */
+	se->hash.loaded_seq = 0;
+
+	size = tegra_sha_prep_cmd(se, cpuvaddr, rctx, &rctx->datbuf);
 
 	ret = tegra_se_host1x_submit(se, size);
 	if (ret)
@@ -418,6 +517,14 @@ static int tegra_sha_do_one_req(struct crypto_engine *engine, void *areq)
 	struct tegra_se *se = ctx->se;
 	int ret = 0;
 
+	/* Only HMAC transforms have a key */
+	rctx->key_id = 0;
+	if (ctx->key.keylen) {
+		ret = tegra_key_get(se, &ctx->key, &rctx->key_id);
+		if (ret)
+			return ret;
+	}
+
 	if (rctx->task & SHA_UPDATE) {
 		ret = tegra_sha_do_update(req);
 		rctx->task &= ~SHA_UPDATE;
@@ -428,6 +535,8 @@ static int tegra_sha_do_one_req(struct crypto_engine *engine, void *areq)
 		rctx->task &= ~SHA_FINAL;
 	}
 
+	tegra_key_put(rctx->key_id);
+
 	crypto_finalize_hash_request(se->engine, req, ret);
 
 	return 0;
@@ -479,7 +588,6 @@ static int tegra_sha_cra_init(struct crypto_tfm *tfm)
 
 	ctx->se = se_alg->se_dev;
 	ctx->fallback = false;
-	ctx->key_id = 0;
 
 	ret = se_algname_to_algid(algname);
 	if (ret < 0) {
@@ -508,7 +616,7 @@ static void tegra_sha_cra_exit(struct crypto_tfm *tfm)
 	if (ctx->fallback_tfm)
 		crypto_free_ahash(ctx->fallback_tfm);
 
-	tegra_key_invalidate(ctx->se, ctx->key_id, ctx->alg);
+	tegra_key_invalidate(ctx->se, &ctx->key);
 }
 
 static int tegra_sha_init(struct ahash_request *req)
@@ -524,7 +632,7 @@ static int tegra_sha_init(struct ahash_request *req)
 	rctx->total_len = 0;
 	rctx->datbuf.size = 0;
 	rctx->residue.size = 0;
-	rctx->key_id = ctx->key_id;
+	rctx->state_seq = 0;
 	rctx->task = SHA_FIRST;
 	rctx->alg = ctx->alg;
 	rctx->blk_size = crypto_ahash_blocksize(tfm);
@@ -579,7 +687,9 @@ static int tegra_hmac_setkey(struct crypto_ahash *tfm, const u8 *key,
 
 	ctx->fallback = false;
 
-	return tegra_key_submit(ctx->se, key, keylen, ctx->alg, &ctx->key_id);
+	tegra_key_set(ctx->se, &ctx->key, key, keylen, ctx->alg);
+
+	return 0;
 }
 
 static int tegra_sha_update(struct ahash_request *req)
@@ -1115,6 +1225,34 @@ static int tegra_hash_kac_manifest(u32 user, u32 alg, u32 keylen)
 	return manifest;
 }
 
+static int tegra_sha_stats_show(struct seq_file *s, void *data)
+{
+	struct tegra_se *se = s->private;
+	u64 busy_us = div_u64(se->hash.busy_ns, NSEC_PER_USEC);
+
+	seq_printf(s, "updates: %llu\n", se->hash.updates);
+	seq_printf(s, "bytes: %llu\n", se->hash.bytes);
+	seq_printf(s, "busy_us: %llu\n", busy_us);
+	seq_printf(s, "mb_per_s: %llu\n",
+		   busy_us ? div64_u64(se->hash.bytes, busy_us) : 0);
+	seq_printf(s, "paste_skipped: %llu\n", se->hash.paste_skipped);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tegra_sha_stats);
+
+static void tegra_sha_free_bufs(struct tegra_se *se)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(se->hash.buf); i++) {
+		if (se->hash.buf[i].buf)
+			dma_free_coherent(se->dev, SE_SHA_BUFLEN, se->hash.buf[i].buf,
+					  se->hash.buf[i].addr);
+		se->hash.buf[i].buf = NULL;
+	}
+}
+
 int tegra_init_hash(struct tegra_se *se)
 {
 #ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
@@ -1126,6 +1264,18 @@ int tegra_init_hash(struct tegra_se *se)
 
 	se->manifest = tegra_hash_kac_manifest;
 
+	for (i = 0; i < ARRAY_SIZE(se->hash.buf); i++) {
+		se->hash.buf[i].buf = dma_alloc_coherent(se->dev, SE_SHA_BUFLEN,
+							 &se->hash.buf[i].addr,
+							 GFP_KERNEL);
+		if (!se->hash.buf[i].buf) {
+			tegra_sha_free_bufs(se);
+			return -ENOMEM;
+		}
+	}
+
+	debugfs_create_file("hash", 0444, se->debugfs, se, &tegra_sha_stats_fops);
+
 	for (i = 0; i < ARRAY_SIZE(tegra_hash_algs); i++) {
 		tegra_hash_algs[i].se_dev = se;
 		alg = &tegra_hash_algs[i].alg.ahash;
@@ -1149,6 +1299,8 @@ sha_err:
 	for (--i; i >= 0; i--)
 		CRYPTO_UNREGISTER(ahash, &tegra_hash_algs[i].alg.ahash);
 
+	tegra_sha_free_bufs(se);
+
 	return ret;
 }
 
@@ -1158,4 +1310,6 @@ void tegra_deinit_hash(struct tegra_se *se)
 
 	for (i = 0; i < ARRAY_SIZE(tegra_hash_algs); i++)
 		CRYPTO_UNREGISTER(ahash, &tegra_hash_algs[i].alg.ahash);
+
+	tegra_sha_free_bufs(se);
 }
@@ -5,8 +5,12 @@
  */
 
 #include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/jhash.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 #include <crypto/aes.h>
+#include <crypto/algapi.h>
 
 #include "tegra-se.h"
 
@@ -16,36 +20,54 @@
 #define SE_KEY_RSVD_MASK		(BIT(0) | BIT(14) | BIT(15))
 #define SE_KEY_VALID_MASK		(SE_KEY_FULL_MASK & ~SE_KEY_RSVD_MASK)
 
+/* Key loaded into a keyslot */
+struct tegra_keyslot {
+	u8 key[AES_MAX_KEY_SIZE];
+	u32 keylen;
+	u32 hash;
+	u32 manifest;
+	unsigned int pins;
+	u64 last_used;
+};
+
 /* Mutex lock to guard keyslots */
 static DEFINE_MUTEX(kslt_lock);
 
 /* Keyslot bitmask (0 = available, 1 = in use/not available) */
 static u16 tegra_se_keyslots = SE_KEY_RSVD_MASK;
 
+static struct tegra_keyslot tegra_keyslot_cache[SE_MAX_KEYSLOT + 1];
+static u64 tegra_keyslot_clock;
+
+static struct {
+	u64 hits;
+	u64 misses;
+	u64 evictions;
+	u64 busy;
+} tegra_key_stats;
+
 static u16 tegra_keyslot_alloc(void)
 {
 	u16 keyid;
 
-	mutex_lock(&kslt_lock);
+	lockdep_assert_held(&kslt_lock);
+
 	/* Check if all key slots are full */
-	if (tegra_se_keyslots == GENMASK(SE_MAX_KEYSLOT, 0)) {
-		mutex_unlock(&kslt_lock);
+	if (tegra_se_keyslots == GENMASK(SE_MAX_KEYSLOT, 0))
 		return 0;
-	}
 
 	keyid = ffz(tegra_se_keyslots);
 	tegra_se_keyslots |= BIT(keyid);
 
-	mutex_unlock(&kslt_lock);
-
 	return keyid;
 }
 
 static void tegra_keyslot_free(u16 slot)
 {
-	mutex_lock(&kslt_lock);
+	lockdep_assert_held(&kslt_lock);
+
 	tegra_se_keyslots &= ~(BIT(slot));
-	mutex_unlock(&kslt_lock);
+	memzero_explicit(&tegra_keyslot_cache[slot], sizeof(tegra_keyslot_cache[slot]));
 }
 
 static unsigned int tegra_key_prep_ins_cmd(struct tegra_se *se, u32 *cpuvaddr,
@@ -96,19 +118,50 @@ static unsigned int tegra_key_prep_ins_cmd(struct tegra_se *se, u32 *cpuvaddr,
 	return i;
 }
 
-static bool tegra_key_in_kslt(u32 keyid)
+static bool tegra_keyslot_match(u16 slot, const struct tegra_se_key *key, u32 manifest)
 {
-	bool ret;
+	struct tegra_keyslot *ks = &tegra_keyslot_cache[slot];
 
-	if (keyid > SE_MAX_KEYSLOT)
+	if (!(BIT(slot) & SE_KEY_VALID_MASK & tegra_se_keyslots))
 		return false;
 
-	mutex_lock(&kslt_lock);
-	ret = ((BIT(keyid) & SE_KEY_VALID_MASK) &&
-		(BIT(keyid) & tegra_se_keyslots));
-	mutex_unlock(&kslt_lock);
+	return ks->hash == key->hash && ks->keylen == key->keylen &&
+	       ks->manifest == manifest &&
+	       !crypto_memneq(ks->key, key->key, key->keylen);
+}
+
+/* Keyslot holding the key, the one it was last loaded into is tried first */
+static u16 tegra_keyslot_lookup(const struct tegra_se_key *key, u32 manifest)
+{
+	u16 slot;
+
+	if (key->slot && tegra_keyslot_match(key->slot, key, manifest))
+		return key->slot;
 
-	return ret;
+	for (slot = 1; slot <= SE_MAX_KEYSLOT; slot++) {
+		if (tegra_keyslot_match(slot, key, manifest))
+			return slot;
+	}
+
+	return 0;
+}
+
+/* Least recently used keyslot not referenced by a request in progress */
+static u16 tegra_keyslot_lru(void)
+{
+	u16 slot, lru = 0;
+
+	for (slot = 1; slot <= SE_MAX_KEYSLOT; slot++) {
+		if (!(BIT(slot) & SE_KEY_VALID_MASK & tegra_se_keyslots) ||
+		    tegra_keyslot_cache[slot].pins)
+			continue;
+
+		if (!lru || tegra_keyslot_cache[slot].last_used <
+				tegra_keyslot_cache[lru].last_used)
+			lru = slot;
+	}
+
+	return lru;
 }
 
 static int tegra_key_insert(struct tegra_se *se, const u8 *key,
@@ -122,35 +175,134 @@ static int tegra_key_insert(struct tegra_se *se, const u8 *key,
 	return tegra_se_host1x_submit(se, size);
 }
 
-void tegra_key_invalidate(struct tegra_se *se, u32 keyid, u32 alg)
+/*
+ * Drop the key from the keyslots. A keyslot shared with another transform
+ * holding the same key is cleared too, that transform loads it again.
+ */
+void tegra_key_invalidate(struct tegra_se *se, struct tegra_se_key *key)
 {
 	u8 zkey[AES_MAX_KEY_SIZE] = {0};
+	u16 slot;
 
-	if (!keyid)
+	if (!key->keylen)
 		return;
 
-	/* Overwrite the key with 0s */
-	tegra_key_insert(se, zkey, AES_MAX_KEY_SIZE, keyid, alg);
+	mutex_lock(&kslt_lock);
+
+	slot = tegra_keyslot_lookup(key, se->manifest(se->owner, key->alg, key->keylen));
+	if (slot && !tegra_keyslot_cache[slot].pins) {
+		/* Overwrite the key with 0s */
+		tegra_key_insert(se, zkey, AES_MAX_KEY_SIZE, slot, key->alg);
+		tegra_keyslot_free(slot);
+	}
+
+	mutex_unlock(&kslt_lock);
 
-	tegra_keyslot_free(keyid);
+	memzero_explicit(key, sizeof(*key));
 }
 
-int tegra_key_submit(struct tegra_se *se, const u8 *key, u32 keylen, u32 alg, u32 *keyid)
+/* Keys are only copied here, they are loaded by tegra_key_get() */
+void tegra_key_set(struct tegra_se *se, struct tegra_se_key *key,
+		   const u8 *keydata, u32 keylen, u32 alg)
 {
+	tegra_key_invalidate(se, key);
+
+	memcpy(key->key, keydata, keylen);
+	key->keylen = keylen;
+	key->alg = alg;
+	key->hash = jhash(keydata, keylen, alg);
+	key->slot = 0;
+}
+
+/*
+ * Return a keyslot holding the key in @keyid, loading it into a free or the
+ * least recently used keyslot on a miss. The keyslot is not evicted until
+ * tegra_key_put(). -ENOSPC means all keyslots are in use by requests in
+ * progress, the crypto engine queues the request again in that case.
+ */
+int tegra_key_get(struct tegra_se *se, struct tegra_se_key *key, u32 *keyid)
+{
+	u32 manifest = se->manifest(se->owner, key->alg, key->keylen);
+	struct tegra_keyslot *ks;
+	u16 slot;
 	int ret;
 
-	/* Use the existing slot if it is already allocated */
-	if (!tegra_key_in_kslt(*keyid)) {
-		*keyid = tegra_keyslot_alloc();
-		if (!(*keyid)) {
-			dev_err(se->dev, "failed to allocate key slot\n");
-			return -ENOMEM;
+	if (!key->keylen)
+		return -ENOKEY;
+
+	mutex_lock(&kslt_lock);
+
+	slot = tegra_keyslot_lookup(key, manifest);
+	if (slot) {
+		tegra_key_stats.hits++;
+		goto found;
+	}
+
+	slot = tegra_keyslot_alloc();
+	if (!slot) {
+		slot = tegra_keyslot_lru();
+		if (!slot) {
+			tegra_key_stats.busy++;
+			mutex_unlock(&kslt_lock);
+			return -ENOSPC;
 		}
+		tegra_key_stats.evictions++;
 	}
+	tegra_key_stats.misses++;
 
-	ret = tegra_key_insert(se, key, keylen, *keyid, alg);
-	if (ret)
+	ret = tegra_key_insert(se, key->key, key->keylen, slot, key->alg);
+	if (ret) {
+		tegra_keyslot_free(slot);
+		mutex_unlock(&kslt_lock);
 		return ret;
+	}
+
+	ks = &tegra_keyslot_cache[slot];
+	memcpy(ks->key, key->key, key->keylen);
+	ks->keylen = key->keylen;
+	ks->hash = key->hash;
+	ks->manifest = manifest;
+
+found:
+	ks = &tegra_keyslot_cache[slot];
+	ks->pins++;
+	ks->last_used = ++tegra_keyslot_clock;
+	key->slot = slot;
+	*keyid = slot;
+
+	mutex_unlock(&kslt_lock);
 
 	return 0;
 }
+
+void tegra_key_put(u32 keyid)
+{
+	if (!keyid || keyid > SE_MAX_KEYSLOT)
+		return;
+
+	mutex_lock(&kslt_lock);
+	if (tegra_keyslot_cache[keyid].pins)
+		tegra_keyslot_cache[keyid].pins--;
+	mutex_unlock(&kslt_lock);
+}
+
+static int tegra_key_stats_show(struct seq_file *s, void *data)
+{
+	mutex_lock(&kslt_lock);
+	seq_printf(s, "hits: %llu\n", tegra_key_stats.hits);
+	seq_printf(s, "misses: %llu\n", tegra_key_stats.misses);
+	seq_printf(s, "evictions: %llu\n", tegra_key_stats.evictions);
+	seq_printf(s, "busy: %llu\n", tegra_key_stats.busy);
+	seq_printf(s, "slots_used: %u/%u\n",
+		   hweight16(tegra_se_keyslots & SE_KEY_VALID_MASK),
+		   hweight16(SE_KEY_VALID_MASK));
+	mutex_unlock(&kslt_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tegra_key_stats);
+
+void tegra_key_debugfs_init(struct dentry *root)
+{
+	debugfs_create_file("keyslots", 0444, root, NULL, &tegra_key_stats_fops);
+}
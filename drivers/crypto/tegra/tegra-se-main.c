@@ -5,6 +5,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
@@ -14,6 +15,8 @@
 
 #include "tegra-se.h"
 
+static struct dentry *tegra_se_debugfs;
+
 static struct host1x_bo *tegra_se_cmdbuf_get(struct host1x_bo *host_bo)
 {
 	struct tegra_se_cmdbuf *cmdbuf = container_of(host_bo, struct tegra_se_cmdbuf, bo);
@@ -141,7 +144,14 @@ static struct tegra_se_cmdbuf *tegra_se_host1x_bo_alloc(struct tegra_se *se, ssi
 	return cmdbuf;
 }
 
-int tegra_se_host1x_submit(struct tegra_se *se, u32 size)
+/*
+ * Queue the @size words at byte @offset of @cmdbuf on the channel and return
+ * without waiting. Jobs run in submission order, each one ends with a syncpt
+ * increment that tegra_se_host1x_wait() waits for.
+ */
+struct host1x_job *tegra_se_host1x_submit_async(struct tegra_se *se,
+						struct tegra_se_cmdbuf *cmdbuf,
+						u32 offset, u32 size)
 {
 	struct host1x_job *job;
 	int ret;
@@ -149,7 +159,7 @@ int tegra_se_host1x_submit(struct tegra_se *se, u32 size)
 	job = host1x_job_alloc(se->channel, 1, 0, true);
 	if (!job) {
 		dev_err(se->dev, "failed to allocate host1x job\n");
-		return -ENOMEM;
+		return ERR_PTR(-ENOMEM);
 	}
 
 	job->syncpt = host1x_syncpt_get(se->syncpt);
@@ -160,9 +170,10 @@ int tegra_se_host1x_submit(struct tegra_se *se, u32 size)
 	job->engine_fallback_streamid = se->stream_id;
 	job->engine_streamid_offset = SE_STREAM_ID;
 
-	se->cmdbuf->words = size;
+	/* the mapping of the buffer has to cover the gather */
+	cmdbuf->words = offset / 4 + size;
 
-	host1x_job_add_gather(job, &se->cmdbuf->bo, size, 0);
+	host1x_job_add_gather(job, &cmdbuf->bo, size, offset);
 
 	ret = host1x_job_pin(job, se->dev);
 	if (ret) {
@@ -176,6 +187,20 @@ int tegra_se_host1x_submit(struct tegra_se *se, u32 size)
 		goto job_unpin;
 	}
 
+	return job;
+
+job_unpin:
+	host1x_job_unpin(job);
+job_put:
+	host1x_job_put(job);
+
+	return ERR_PTR(ret);
+}
+
+int tegra_se_host1x_wait(struct tegra_se *se, struct host1x_job *job)
+{
+	int ret;
+
 	ret = host1x_syncpt_wait(job->syncpt, job->syncpt_end,
 				 MAX_SCHEDULE_TIMEOUT, NULL);
 	if (ret) {
@@ -185,13 +210,23 @@ int tegra_se_host1x_submit(struct tegra_se *se, u32 size)
 
 	host1x_job_put(job);
 	return 0;
+}
 
-job_unpin:
-	host1x_job_unpin(job);
-job_put:
-	host1x_job_put(job);
+int tegra_se_host1x_submit_cmdbuf(struct tegra_se *se,
+				  struct tegra_se_cmdbuf *cmdbuf, u32 size)
+{
+	struct host1x_job *job;
 
-	return ret;
+	job = tegra_se_host1x_submit_async(se, cmdbuf, 0, size);
+	if (IS_ERR(job))
+		return PTR_ERR(job);
+
+	return tegra_se_host1x_wait(se, job);
+}
+
+int tegra_se_host1x_submit(struct tegra_se *se, u32 size)
+{
+	return tegra_se_host1x_submit_cmdbuf(se, se->cmdbuf, size);
 }
 
 static int tegra_se_client_init(struct host1x_client *client)
@@ -220,14 +255,25 @@ static int tegra_se_client_init(struct host1x_client *client)
 		goto syncpt_put;
 	}
 
+	se->batch.cmdbuf = tegra_se_host1x_bo_alloc(se, SZ_4K);
+	if (!se->batch.cmdbuf) {
+		ret = -ENOMEM;
+		goto cmdbuf_put;
+	}
+
+	se->debugfs = debugfs_create_dir(dev_name(se->dev), tegra_se_debugfs);
+
 	ret = se->hw->init_alg(se);
 	if (ret) {
 		dev_err(se->dev, "failed to register algorithms\n");
-		goto cmdbuf_put;
+		goto batch_put;
 	}
 
 	return 0;
 
+batch_put:
+	debugfs_remove_recursive(se->debugfs);
+	tegra_se_cmdbuf_put(&se->batch.cmdbuf->bo);
 cmdbuf_put:
 	tegra_se_cmdbuf_put(&se->cmdbuf->bo);
 syncpt_put:
@@ -243,6 +289,8 @@ static int tegra_se_client_deinit(struct host1x_client *client)
 	struct tegra_se *se = container_of(client, struct tegra_se, client);
 
 	se->hw->deinit_alg(se);
+	debugfs_remove_recursive(se->debugfs);
+	tegra_se_cmdbuf_put(&se->batch.cmdbuf->bo);
 	tegra_se_cmdbuf_put(&se->cmdbuf->bo);
 	host1x_syncpt_put(se->syncpt);
 	host1x_channel_put(se->channel);
@@ -300,7 +348,13 @@ static int tegra_se_probe(struct platform_device *pdev)
 
 	writel(se->stream_id, se->base + SE_STREAM_ID);
 
-	se->engine = crypto_engine_alloc_init(dev, 0);
+	/*
+	 * With retry support the engine hands over all queued requests
+	 * back to back and calls tegra_aes_do_batch() once the queue is
+	 * empty, which submits the AES requests collected meanwhile.
+	 */
+	se->engine = crypto_engine_alloc_init_and_set(dev, true, tegra_aes_do_batch,
+						      false, CRYPTO_ENGINE_MAX_QLEN);
 	if (!se->engine)
 		return dev_err_probe(dev, -ENOMEM, "failed to init crypto engine\n");
 
@@ -418,17 +472,31 @@ static int __init tegra_se_module_init(void)
 {
 	int ret;
 
+	tegra_se_debugfs = debugfs_create_dir("tegra-se", NULL);
+	tegra_key_debugfs_init(tegra_se_debugfs);
+
 	ret = host1x_driver_register(&tegra_se_host1x_driver);
 	if (ret)
-		return ret;
+		goto debugfs_remove;
 
-	return platform_driver_register(&tegra_se_driver);
+	ret = platform_driver_register(&tegra_se_driver);
+	if (ret) {
+		host1x_driver_unregister(&tegra_se_host1x_driver);
+		goto debugfs_remove;
+	}
+
+	return 0;
+
+debugfs_remove:
+	debugfs_remove_recursive(tegra_se_debugfs);
+	return ret;
 }
 
 static void __exit tegra_se_module_exit(void)
 {
 	host1x_driver_unregister(&tegra_se_host1x_driver);
 	platform_driver_unregister(&tegra_se_driver);
+	debugfs_remove_recursive(tegra_se_debugfs);
 }
 
 module_init(tegra_se_module_init);
@@ -13,7 +13,11 @@
 #include <linux/iommu.h>
 #include <linux/host1x-next.h>
 #include <crypto/aead.h>
+#include <crypto/aes.h>
 #include <crypto/engine.h>
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+#include <crypto/internal/engine.h>
+#endif
 #include <crypto/hash.h>
 #include <crypto/sha1.h>
 #include <crypto/sha3.h>
@@ -344,6 +348,10 @@
 #define SE_MAX_MEM_ALLOC			SZ_4M
 #define SE_SHA_BUFLEN				0x2000
 
+/* AES requests per batch and command buffer words of one request */
+#define SE_AES_BATCH_MAX			32U
+#define SE_AES_BATCH_CMD_WORDS			17
+
 #define SHA_FIRST	BIT(0)
 #define SHA_UPDATE	BIT(1)
 #define SHA_FINAL	BIT(2)
@@ -437,13 +445,34 @@ struct tegra_se_hw {
 	u32 kac_ver;
 };
 
+/* AES requests encoded into one command buffer, completed on one syncpt wait */
+struct tegra_se_batch {
+	struct tegra_se_cmdbuf *cmdbuf;
+	struct skcipher_request *reqs[SE_AES_BATCH_MAX];
+	unsigned int nreqs;
+	u32 words;
+};
+
+/* Update buffers of the HASH engine and the owner of its result registers */
+struct tegra_se_hash_state {
+	struct tegra_se_datbuf buf[2];
+	u64 loaded_seq;
+	u64 updates;
+	u64 bytes;
+	u64 busy_ns;
+	u64 paste_skipped;
+};
+
 struct tegra_se {
 	int (*manifest)(u32 user, u32 alg, u32 keylen);
 	const struct tegra_se_hw *hw;
 	struct host1x_client client;
 	struct host1x_channel *channel;
 	struct tegra_se_cmdbuf *cmdbuf;
+	struct tegra_se_batch batch;
+	struct tegra_se_hash_state hash;
 	struct crypto_engine *engine;
+	struct dentry *debugfs;
 	struct host1x_syncpt *syncpt;
 	struct device *dev;
 	struct clk *clk;
@@ -470,6 +499,15 @@ struct tegra_se_datbuf {
 	ssize_t size;
 };
 
+/* Key of a transform, loaded into a keyslot by the requests that use it */
+struct tegra_se_key {
+	u8 key[AES_MAX_KEY_SIZE];
+	u32 keylen;
+	u32 alg;
+	u32 hash;
+	u16 slot;
+};
+
 static inline int se_algname_to_algid(const char *name)
 {
 	if (!strcmp(name, "cbc(aes)"))
@@ -522,10 +560,20 @@ int tegra_init_aes(struct tegra_se *se);
 int tegra_init_hash(struct tegra_se *se);
 void tegra_deinit_aes(struct tegra_se *se);
 void tegra_deinit_hash(struct tegra_se *se);
-int tegra_key_submit(struct tegra_se *se, const u8 *key,
-		     u32 keylen, u32 alg, u32 *keyid);
-void tegra_key_invalidate(struct tegra_se *se, u32 keyid, u32 alg);
+void tegra_key_set(struct tegra_se *se, struct tegra_se_key *key,
+		   const u8 *keydata, u32 keylen, u32 alg);
+int tegra_key_get(struct tegra_se *se, struct tegra_se_key *key, u32 *keyid);
+void tegra_key_put(u32 keyid);
+void tegra_key_invalidate(struct tegra_se *se, struct tegra_se_key *key);
+void tegra_key_debugfs_init(struct dentry *root);
 int tegra_se_host1x_submit(struct tegra_se *se, u32 size);
+int tegra_se_host1x_submit_cmdbuf(struct tegra_se *se,
+				  struct tegra_se_cmdbuf *cmdbuf, u32 size);
+struct host1x_job *tegra_se_host1x_submit_async(struct tegra_se *se,
+						struct tegra_se_cmdbuf *cmdbuf,
+						u32 offset, u32 size);
+int tegra_se_host1x_wait(struct tegra_se *se, struct host1x_job *job);
+int tegra_aes_do_batch(struct crypto_engine *engine);
 
 /* HOST1x OPCODES */
 static inline u32 host1x_opcode_setpayload(unsigned int payload)
@@ -17,6 +17,7 @@
 #include <linux/clk/tegra.h>
 #include <linux/debugfs.h>
 #include <linux/devfreq.h>
+#include <linux/devfreq/nvhost_podgov.h>
 #include <linux/export.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
@@ -24,6 +25,7 @@
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 #define CREATE_TRACE_POINTS
 #include <trace/events/nvhost_podgov.h>
 
@@ -43,6 +45,9 @@ static void podgov_set_user_ctl(struct devfreq *df, int enable);
 
 static struct devfreq_governor nvhost_podgov;
 
+/* protects df->data against governor stop for submit notifications */
+static DEFINE_SPINLOCK(podgov_submit_lock);
+
 /*******************************************************************************
  * podgov_info_rec - gr3d scaling governor specific parameters
  ******************************************************************************/
@@ -62,6 +67,9 @@ struct podgov_info_rec {
 	int			p_bias;
 	unsigned int		p_user;
 	unsigned int		p_freq_request;
+	unsigned int		p_load_alpha;
+	unsigned int		p_boost_steps;
+	unsigned int		p_boost_hold_ms;
 
 	unsigned long		cycles_norm;
 	unsigned long		cycles_avg;
@@ -73,6 +81,12 @@ struct podgov_info_rec {
 	unsigned long		recent_high;
 
 	unsigned long		rt_load;
+	unsigned long		load_ewma;
+	unsigned long		load_pred;
+
+	unsigned long		boost_freq;
+	ktime_t			boost_until;
+	struct work_struct	boost_work;
 
 	int			adjustment_type;
 	unsigned long		adjustment_frequency;
@@ -318,7 +332,7 @@ static unsigned long scaling_state_check(struct devfreq *df, ktime_t time)
 {
 	struct podgov_info_rec *pg = df->data;
 	struct devfreq_dev_status *ds = &df->last_status;
-	unsigned long dt, busyness, rt_load = pg->rt_load;
+	unsigned long dt, busyness, rt_load = max(pg->rt_load, pg->load_pred);
 	long max_boost, damp, freq, boost, res;
 	unsigned long max_freq_hz = 0;
 
@@ -395,6 +409,80 @@ static int freqlist_up(struct podgov_info_rec *podgov, unsigned long target,
 	return podgov->freqlist[pos];
 }
 
+/*******************************************************************************
+ * podgov_boost_work(work)
+ *
+ * Submit boost. The first submit after an idle period steps the frequency up
+ * by p_boost_steps right away, instead of waiting for the load samples of
+ * the burst. The raised frequency is kept as a floor for p_boost_hold_ms
+ * after the last submit and then left to decay through the regular load
+ * based scaling.
+ ******************************************************************************/
+
+static void podgov_boost_work(struct work_struct *work)
+{
+	struct podgov_info_rec *pg = container_of(work, struct podgov_info_rec,
+						  boost_work);
+	struct devfreq *df = pg->power_manager;
+	struct device *dev = df->dev.parent;
+	ktime_t now = ktime_get();
+	bool boosted;
+
+	/* the submitter holds the device powered, do not power it on */
+	if (pm_runtime_get_if_in_use(dev) <= 0)
+		return;
+
+	mutex_lock(&pg->lock);
+	mutex_lock(&df->lock);
+
+	if (!pg->enable || pg->p_user || pg->suspended || !pg->p_boost_steps)
+		goto out;
+
+	boosted = ktime_before(now, pg->boost_until);
+	pg->boost_until = ktime_add_ms(now, pg->p_boost_hold_ms);
+	if (boosted)
+		goto out;
+
+	pg->boost_freq = freqlist_up(pg, df->previous_freq, pg->p_boost_steps);
+	scaling_limit(df, &pg->boost_freq);
+	if (pg->boost_freq <= df->previous_freq)
+		goto out;
+
+	trace_podgov_decision(dev, df->previous_freq, pg->boost_freq,
+			      pg->rt_load, pg->load_pred, true);
+
+	pg->adjustment_frequency = pg->boost_freq;
+	pg->adjustment_type = ADJUSTMENT_LOCAL;
+	update_devfreq(df);
+
+out:
+	mutex_unlock(&df->lock);
+	mutex_unlock(&pg->lock);
+	pm_runtime_put(dev);
+}
+
+/*******************************************************************************
+ * nvhost_podgov_notify_submit(df)
+ *
+ * Called by the device driver when work is submitted to the engine. Can be
+ * called from atomic context.
+ ******************************************************************************/
+
+void nvhost_podgov_notify_submit(struct devfreq *df)
+{
+	struct podgov_info_rec *pg;
+	unsigned long flags;
+
+	spin_lock_irqsave(&podgov_submit_lock, flags);
+	if (df->governor == &nvhost_podgov) {
+		pg = df->data;
+		if (pg && pg->p_boost_steps)
+			queue_work(system_highpri_wq, &pg->boost_work);
+	}
+	spin_unlock_irqrestore(&podgov_submit_lock, flags);
+}
+EXPORT_SYMBOL(nvhost_podgov_notify_submit);
+
 /*******************************************************************************
  * debugfs interface for controlling 3d clock scaling on the fly
  ******************************************************************************/
@@ -432,13 +520,14 @@ static void nvhost_scale_emc_debug_init(struct devfreq *df)
 	CREATE_PODGOV_FILE(bias);
 	CREATE_PODGOV_FILE(damp);
 	CREATE_PODGOV_FILE(smooth);
+	CREATE_PODGOV_FILE(load_alpha);
+	CREATE_PODGOV_FILE(boost_steps);
+	CREATE_PODGOV_FILE(boost_hold_ms);
 #undef CREATE_PODGOV_FILE
 }
 
-static void nvhost_scale_emc_debug_deinit(struct devfreq *df)
+static void nvhost_scale_emc_debug_deinit(struct podgov_info_rec *podgov)
 {
-	struct podgov_info_rec *podgov = df->data;
-
 	debugfs_remove_recursive(podgov->debugdir);
 }
 
@@ -448,9 +537,9 @@ static void nvhost_scale_emc_debug_init(struct devfreq *df)
 	(void)df;
 }
 
-static void nvhost_scale_emc_debug_deinit(struct devfreq *df)
+static void nvhost_scale_emc_debug_deinit(struct podgov_info_rec *podgov)
 {
-	(void)df;
+	(void)podgov;
 }
 #endif
 
@@ -596,6 +685,9 @@ static int nvhost_pod_estimate_freq(struct devfreq *df,
 		pg->history_next = 0;
 		pg->recent_high = 0;
 		pg->freq_avg = 0;
+		pg->load_ewma = 0;
+		pg->load_pred = 0;
+		pg->boost_until = 0;
 		return 0;
 	}
 
@@ -651,6 +743,21 @@ static int nvhost_pod_estimate_freq(struct devfreq *df,
 		(pg->p_smooth + 1);
 	pg->rt_load = 1000ULL * ds->busy_time / ds->total_time;
 
+	/* Predict the next load from its average and rising trend */
+	if (pg->p_load_alpha) {
+		unsigned int alpha = min(pg->p_load_alpha, 100U);
+		unsigned long prev = pg->load_ewma;
+
+		pg->load_ewma = (alpha * pg->rt_load +
+				 (100 - alpha) * pg->load_ewma) / 100;
+		pg->load_pred = pg->load_ewma;
+		if (pg->load_ewma > prev)
+			pg->load_pred += pg->load_ewma - prev;
+		pg->load_pred = min(pg->load_pred, 1000UL);
+	} else {
+		pg->load_pred = pg->rt_load;
+	}
+
 	/* Update history of normalized cycle counts and recent highest count */
 	if (buf_size) {
 		if (buf_count == buf_size) {
@@ -676,12 +783,18 @@ static int nvhost_pod_estimate_freq(struct devfreq *df,
 		return 0;
 	}
 
+	/* Do not drop below the submit boost while it is held */
+	if (ktime_before(now, pg->boost_until) && *freq < pg->boost_freq)
+		*freq = pg->boost_freq;
+
 	if ((*freq = freqlist_up(pg, *freq, 0)) == ds->current_frequency)
 		return 0;
 
 	pg->last_scale = now;
 
 	trace_podgov_estimate_freq(df->dev.parent, df->previous_freq, *freq);
+	trace_podgov_decision(df->dev.parent, df->previous_freq, *freq,
+			      pg->rt_load, pg->load_pred, false);
 
 
 	return 0;
@@ -717,7 +830,11 @@ static int nvhost_pod_init(struct devfreq *df)
 	podgov->history_next = 0;
 	podgov->recent_high = 0;
 
+	INIT_WORK(&podgov->boost_work, podgov_boost_work);
+
+	spin_lock_irq(&podgov_submit_lock);
 	df->data = (void *)podgov;
+	spin_unlock_irq(&podgov_submit_lock);
 
 	/* Set scaling parameter defaults */
 	podgov->enable = 1;
@@ -729,6 +846,9 @@ static int nvhost_pod_init(struct devfreq *df)
 	podgov->p_smooth = 10;
 	podgov->p_damp = 7;
 	podgov->p_block_window = 50000;
+	podgov->p_load_alpha = 50;
+	podgov->p_boost_steps = 2;
+	podgov->p_boost_hold_ms = 50;
 
 	podgov->adjustment_type = ADJUSTMENT_DEVICE_REQ;
 	podgov->p_user = 0;
@@ -793,6 +913,9 @@ err_create_request_sysfs_entry:
 			  &podgov->enable_3d_scaling_attr.attr);
 err_create_enable_sysfs_entry:
 	dev_err(&d->dev, "failed to create sysfs attributes");
+	spin_lock_irq(&podgov_submit_lock);
+	df->data = NULL;
+	spin_unlock_irq(&podgov_submit_lock);
 	kfree(podgov->cycles_history_buf);
 err_alloc_history_buffer:
 	kfree(podgov);
@@ -810,6 +933,11 @@ static void nvhost_pod_exit(struct devfreq *df)
 {
 	struct podgov_info_rec *podgov = df->data;
 
+	spin_lock_irq(&podgov_submit_lock);
+	df->data = NULL;
+	spin_unlock_irq(&podgov_submit_lock);
+	cancel_work_sync(&podgov->boost_work);
+
 	devfreq_monitor_stop(df);
 
 	sysfs_remove_file(&df->dev.parent->kobj, &podgov->user_attr.attr);
@@ -818,7 +946,7 @@ static void nvhost_pod_exit(struct devfreq *df)
 	sysfs_remove_file(&df->dev.parent->kobj,
 			  &podgov->enable_3d_scaling_attr.attr);
 
-	nvhost_scale_emc_debug_deinit(df);
+	nvhost_scale_emc_debug_deinit(podgov);
 	kfree(podgov->cycles_history_buf);
 	kfree(podgov);
 }
@@ -836,6 +964,7 @@ static void nvhost_pod_suspend(struct devfreq *df)
 	struct podgov_info_rec *pg = df->data;
 
 	pg->suspended = 1;
+	cancel_work_sync(&pg->boost_work);
 
 	// Update frequency for the final time before going into suspension.
 	mutex_lock(&df->lock);
@@ -7,7 +7,10 @@
 #include <linux/devfreq/tegra_wmark.h>
 #include <linux/device.h>
 #include <linux/errno.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/pm_opp.h>
 #include <linux/pm_qos.h>
 #include <linux/slab.h>
@@ -49,6 +52,8 @@
  * @down_freq_margin:	Number of frequency steps for scaling down the frequency
  *			when consecutive lower watermark interrupt get triggered.
  * @curr_freq_index:		Index value of current frequency in the frequency table.
+ * @floor_update:	Re-evaluation was triggered by a bandwidth request change,
+ *			keep the current frequency unless the floor needs more.
  * @df:			The devfreq instance of own device.
  * @nb:			Notifier block for DEVFREQ_TRANSITION_NOTIFIER list.
  */
@@ -59,10 +64,176 @@ struct tegra_wmark_data {
 	unsigned int up_freq_margin;
 	unsigned int down_freq_margin;
 	int curr_freq_index;
+	bool floor_update;
 	struct devfreq *df;
 	struct notifier_block nb;
 };
 
+static struct devfreq_governor devfreq_tegra_wmark;
+
+/*
+ * Bandwidth requests of all devices. They are kept outside of the governor
+ * data so that they survive governor changes of the device.
+ */
+static LIST_HEAD(wmark_requests);
+static DEFINE_MUTEX(wmark_requests_lock);
+
+static void wmark_request_set_owner(struct devfreq_tegra_wmark_request *req,
+				    bool owner, ktime_t now)
+{
+	if (req->floor_owner == owner)
+		return;
+
+	if (owner)
+		req->owner_since = now;
+	else
+		req->floor_ns += ktime_to_ns(ktime_sub(now, req->owner_since));
+	req->floor_owner = owner;
+}
+
+/* Frequency floor from the bandwidth requests of df, 0 without requests */
+static unsigned long wmark_request_floor(struct devfreq *df)
+{
+	struct devfreq_tegra_wmark_data *drvdata = df->data;
+	struct devfreq_tegra_wmark_request *req;
+	u64 kbps = 0;
+
+	mutex_lock(&wmark_requests_lock);
+	list_for_each_entry(req, &wmark_requests, node) {
+		if (req->df == df)
+			kbps += req->kbps;
+	}
+	mutex_unlock(&wmark_requests_lock);
+
+	if (!kbps || !drvdata->bw_to_freq)
+		return 0;
+
+	return drvdata->bw_to_freq(df, min_t(u64, kbps, U32_MAX));
+}
+
+/*
+ * Attribute the time the floor sets the frequency of df to its largest
+ * request. With active false, ownership of the floor ends.
+ */
+static void wmark_request_update_owner(struct devfreq *df, bool active)
+{
+	struct devfreq_tegra_wmark_request *req, *owner = NULL;
+	ktime_t now = ktime_get();
+
+	mutex_lock(&wmark_requests_lock);
+
+	if (active) {
+		list_for_each_entry(req, &wmark_requests, node) {
+			if (req->df == df && req->kbps &&
+			    (!owner || req->kbps > owner->kbps))
+				owner = req;
+		}
+	}
+
+	list_for_each_entry(req, &wmark_requests, node) {
+		if (req->df == df)
+			wmark_request_set_owner(req, req == owner, now);
+	}
+
+	mutex_unlock(&wmark_requests_lock);
+}
+
+/* Re-evaluate the frequency of df after its bandwidth requests changed */
+static void wmark_request_apply(struct devfreq *df)
+{
+	struct tegra_wmark_data *govdata;
+
+	mutex_lock(&df->lock);
+	if (df->governor == &devfreq_tegra_wmark && df->governor_data) {
+		govdata = df->governor_data;
+		govdata->floor_update = true;
+		update_devfreq(df);
+		govdata->floor_update = false;
+	}
+	mutex_unlock(&df->lock);
+}
+
+/**
+ * devfreq_tegra_wmark_add_request() - add a bandwidth request for a device
+ * @df:		devfreq device using tegra_wmark data
+ * @req:	request to add, starts at 0 kBps
+ * @name:	client name, shown in the bw_requests attribute
+ *
+ * The request applies whenever df is scaled by the tegra_wmark governor,
+ * also when the governor is selected later on.
+ */
+int devfreq_tegra_wmark_add_request(struct devfreq *df,
+				    struct devfreq_tegra_wmark_request *req,
+				    const char *name)
+{
+	struct devfreq_tegra_wmark_data *drvdata;
+
+	if (IS_ERR_OR_NULL(df) || !req || !name)
+		return -EINVAL;
+
+	drvdata = df->data;
+	if (!drvdata || !drvdata->bw_to_freq)
+		return -EOPNOTSUPP;
+
+	req->df = df;
+	req->name = name;
+	req->kbps = 0;
+	req->floor_owner = false;
+	req->floor_ns = 0;
+
+	mutex_lock(&wmark_requests_lock);
+	list_add_tail(&req->node, &wmark_requests);
+	mutex_unlock(&wmark_requests_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(devfreq_tegra_wmark_add_request);
+
+/**
+ * devfreq_tegra_wmark_update_request() - change the requested bandwidth
+ * @req:	request added with devfreq_tegra_wmark_add_request()
+ * @kbps:	expected bandwidth in kBps, 0 to drop the request
+ *
+ * Raising the request takes effect right away, lowering it lets the
+ * watermarks scale the device down on their own.
+ */
+int devfreq_tegra_wmark_update_request(struct devfreq_tegra_wmark_request *req,
+				       u32 kbps)
+{
+	bool raise;
+
+	if (!req || !req->df)
+		return -EINVAL;
+
+	mutex_lock(&wmark_requests_lock);
+	raise = kbps > req->kbps;
+	req->kbps = kbps;
+	mutex_unlock(&wmark_requests_lock);
+
+	if (raise)
+		wmark_request_apply(req->df);
+
+	return 0;
+}
+EXPORT_SYMBOL(devfreq_tegra_wmark_update_request);
+
+/**
+ * devfreq_tegra_wmark_remove_request() - remove a bandwidth request
+ * @req:	request added with devfreq_tegra_wmark_add_request()
+ */
+void devfreq_tegra_wmark_remove_request(struct devfreq_tegra_wmark_request *req)
+{
+	if (!req || !req->df)
+		return;
+
+	mutex_lock(&wmark_requests_lock);
+	list_del(&req->node);
+	mutex_unlock(&wmark_requests_lock);
+
+	req->df = NULL;
+}
+EXPORT_SYMBOL(devfreq_tegra_wmark_remove_request);
+
 static int devfreq_get_freq_index(struct devfreq *df, unsigned long freq)
 {
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 19, 0)
@@ -93,8 +264,14 @@ static int devfreq_tegra_wmark_target_freq(struct devfreq *df, unsigned long *fr
 	unsigned long *freq_table = df->freq_table;
 	unsigned int max_state = df->max_state;
 #endif
+	unsigned long floor;
 	int target_index = 0;
 
+	if (govdata->floor_update) {
+		target_index = govdata->curr_freq_index;
+		goto apply_floor;
+	}
+
 	switch (drvdata->event) {
 	case DEVFREQ_TEGRA_AVG_WMARK_BELOW:
 		target_index = max_t(int, 0, govdata->curr_freq_index-1);
@@ -114,6 +291,17 @@ static int devfreq_tegra_wmark_target_freq(struct devfreq *df, unsigned long *fr
 		break;
 	}
 
+apply_floor:
+	/* Never scale below the bandwidth requested by clients */
+	floor = wmark_request_floor(df);
+	if (floor && freq_table[target_index] < floor) {
+		target_index = min_t(int, max_state - 1,
+				     devfreq_get_freq_index(df, floor));
+		wmark_request_update_owner(df, true);
+	} else {
+		wmark_request_update_owner(df, false);
+	}
+
 	*freq = freq_table[target_index];
 
 	return 0;
@@ -433,12 +621,53 @@ static ssize_t load_target_show(struct device *dev,
 }
 static DEVICE_ATTR_RW(load_target);
 
+static ssize_t bw_floor_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+
+	return sprintf(buf, "%lu\n", wmark_request_floor(df));
+}
+static DEVICE_ATTR_RO(bw_floor);
+
+/*
+ * One line per request: client, requested kBps and the time in ms it set the
+ * frequency as largest request while the watermarks alone would have picked
+ * a lower one. Time in each frequency is in the devfreq trans_stat.
+ */
+static ssize_t bw_requests_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct devfreq_tegra_wmark_request *req;
+	ktime_t now = ktime_get();
+	ssize_t len = 0;
+	u64 floor_ns;
+
+	mutex_lock(&wmark_requests_lock);
+	list_for_each_entry(req, &wmark_requests, node) {
+		if (req->df != df)
+			continue;
+		floor_ns = req->floor_ns;
+		if (req->floor_owner)
+			floor_ns += ktime_to_ns(ktime_sub(now, req->owner_since));
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s %u %llu\n",
+				 req->name, req->kbps, floor_ns / NSEC_PER_MSEC);
+	}
+	mutex_unlock(&wmark_requests_lock);
+
+	return len;
+}
+static DEVICE_ATTR_RO(bw_requests);
+
 static struct attribute *dev_entries[] = {
 	&dev_attr_load_target.attr,
 	&dev_attr_up_wmark_margin.attr,
 	&dev_attr_down_wmark_margin.attr,
 	&dev_attr_up_freq_margin.attr,
 	&dev_attr_down_freq_margin.attr,
+	&dev_attr_bw_floor.attr,
+	&dev_attr_bw_requests.attr,
 	NULL,
 };
 
@@ -539,12 +768,14 @@ static int devfreq_tegra_wmark_event_handler(struct devfreq *df,
 		devfreq_update_wmark_threshold(df);
 		break;
 	case DEVFREQ_GOV_STOP:
+		wmark_request_update_owner(df, false);
 		wmark_config.upper_wmark_enabled = 0;
 		wmark_config.lower_wmark_enabled = 0;
 		drvdata->update_wmark_threshold(df, &wmark_config);
 		tegra_wmark_exit(df);
 		break;
 	case DEVFREQ_GOV_SUSPEND:
+		wmark_request_update_owner(df, false);
 		wmark_config.upper_wmark_enabled = 0;
 		wmark_config.lower_wmark_enabled = 0;
 		drvdata->update_wmark_threshold(df, &wmark_config);
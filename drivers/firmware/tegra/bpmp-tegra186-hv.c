@@ -15,6 +15,9 @@
 #include <linux/dma-mapping.h>
 #include <linux/interrupt.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <soc/tegra/virt/hv-ivc.h>
 #include <soc/tegra/bpmp.h>
 #include <soc/tegra/fuse.h>
@@ -22,13 +25,37 @@
 
 #include "bpmp-tegra186-hv.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/bpmp_hv.h>
+
 #define MSG_RING	BIT(1)
 #define TAG_SZ		32
 #define MAX_POSSIBLE_RX_CHANNEL 1
 #define TX_CHANNEL_EXACT_COUNT  1
+/* MRQs above this are accounted in a single bucket */
+#define MAX_TRACKED_MRQ		127
+
+/* request in flight on one outgoing channel */
+struct tegra186_hv_bpmp_xfer {
+	ktime_t start;
+	unsigned int mrq;
+	bool pending;
+};
+
+struct tegra186_hv_bpmp_mrq_stats {
+	u64 count;
+	u64 errors;
+	u64 total_ns;
+	u64 max_ns;
+};
 
 static struct tegra186_hv_bpmp {
 	struct tegra_bpmp *parent;
+	/* one per threaded channel, followed by the one of the tx channel */
+	struct tegra186_hv_bpmp_xfer *xfers;
+	spinlock_t stats_lock;
+	struct tegra186_hv_bpmp_mrq_stats stats[MAX_TRACKED_MRQ + 2];
+	struct dentry *debugfs;
 } tegra186_hv_bpmp;
 
 /* utilizing the struct tegra_ivc *ivc in struct tegra_bpmp_channel
@@ -267,6 +294,146 @@ static int tegra186_hv_bpmp_post_message(struct tegra_bpmp_channel *channel)
 	return tegra_hv_ivc_write_advance(hv_ivc);
 }
 
+/* index of the in-flight slot of an outgoing channel, -1 for rx */
+static int tegra186_hv_bpmp_xfer_index(struct tegra_bpmp_channel *channel)
+{
+	struct tegra_bpmp *bpmp = channel->bpmp;
+
+	if (channel == bpmp->tx_channel)
+		return bpmp->threaded.count;
+
+	if (channel >= bpmp->threaded_channels &&
+	    channel < bpmp->threaded_channels + bpmp->threaded.count)
+		return channel - bpmp->threaded_channels;
+
+	return -1;
+}
+
+static int tegra186_hv_bpmp_post_request(struct tegra_bpmp_channel *channel)
+{
+	struct tegra186_hv_bpmp *priv = channel->bpmp->priv;
+	int idx = tegra186_hv_bpmp_xfer_index(channel);
+
+	if (idx >= 0) {
+		struct tegra186_hv_bpmp_xfer *xfer = &priv->xfers[idx];
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+		xfer->mrq = tegra_bpmp_mb_read_field(&channel->ob, code);
+#else
+		xfer->mrq = channel->ob->code;
+#endif
+		xfer->start = ktime_get();
+		xfer->pending = true;
+	}
+
+	return tegra186_hv_bpmp_post_message(channel);
+}
+
+static void tegra186_hv_bpmp_account(struct tegra186_hv_bpmp *priv,
+				     unsigned int idx,
+				     struct tegra186_hv_bpmp_xfer *xfer,
+				     int ret)
+{
+	struct tegra186_hv_bpmp_mrq_stats *stats;
+	unsigned long flags;
+	u64 delta;
+
+	delta = ktime_to_ns(ktime_sub(ktime_get(), xfer->start));
+	xfer->pending = false;
+
+	trace_bpmp_hv_mrq_done(idx, xfer->mrq, ret, delta);
+
+	stats = &priv->stats[min_t(unsigned int, xfer->mrq,
+				   MAX_TRACKED_MRQ + 1)];
+
+	spin_lock_irqsave(&priv->stats_lock, flags);
+	stats->count++;
+	if (ret < 0)
+		stats->errors++;
+	stats->total_ns += delta;
+	if (delta > stats->max_ns)
+		stats->max_ns = delta;
+	spin_unlock_irqrestore(&priv->stats_lock, flags);
+}
+
+static int tegra186_hv_bpmp_ack_response(struct tegra_bpmp_channel *channel)
+{
+	struct tegra186_hv_bpmp *priv = channel->bpmp->priv;
+	int idx = tegra186_hv_bpmp_xfer_index(channel);
+
+	if (idx >= 0 && priv->xfers[idx].pending) {
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+		int ret = tegra_bpmp_mb_read_field(&channel->ib, code);
+#else
+		int ret = channel->ib->code;
+#endif
+
+		tegra186_hv_bpmp_account(priv, idx, &priv->xfers[idx], ret);
+	}
+
+	return tegra186_bpmp_hv_ack_message(channel);
+}
+
+static int tegra186_hv_bpmp_stats_show(struct seq_file *s, void *data)
+{
+	struct tegra186_hv_bpmp *priv = s->private;
+	struct tegra186_hv_bpmp_mrq_stats stats;
+	unsigned long flags;
+	unsigned int mrq;
+
+	seq_puts(s, "mrq      count   errors   avg_us   max_us\n");
+
+	for (mrq = 0; mrq <= MAX_TRACKED_MRQ + 1; mrq++) {
+		spin_lock_irqsave(&priv->stats_lock, flags);
+		stats = priv->stats[mrq];
+		spin_unlock_irqrestore(&priv->stats_lock, flags);
+
+		if (!stats.count)
+			continue;
+
+		if (mrq > MAX_TRACKED_MRQ)
+			seq_puts(s, "other");
+		else
+			seq_printf(s, "%-5u", mrq);
+
+		seq_printf(s, " %9llu %8llu %8llu %8llu\n",
+			   stats.count, stats.errors,
+			   div64_u64(stats.total_ns, stats.count) / NSEC_PER_USEC,
+			   stats.max_ns / NSEC_PER_USEC);
+	}
+
+	return 0;
+}
+
+static int tegra186_hv_bpmp_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tegra186_hv_bpmp_stats_show, inode->i_private);
+}
+
+/* any write clears the statistics */
+static ssize_t tegra186_hv_bpmp_stats_write(struct file *file,
+					    const char __user *buf,
+					    size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct tegra186_hv_bpmp *priv = s->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->stats_lock, flags);
+	memset(priv->stats, 0, sizeof(priv->stats));
+	spin_unlock_irqrestore(&priv->stats_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations tegra186_hv_bpmp_stats_fops = {
+	.open = tegra186_hv_bpmp_stats_open,
+	.read = seq_read,
+	.write = tegra186_hv_bpmp_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static void tegra186_hv_bpmp_channel_reset(struct tegra_bpmp_channel *channel)
 {
 	struct tegra_hv_ivc_cookie *hv_ivc = to_hv_ivc(channel->ivc);
@@ -319,6 +486,13 @@ static int tegra186_hv_bpmp_init(struct tegra_bpmp *bpmp)
 	if (!priv)
 		return -ENOMEM;
 
+	priv->xfers = devm_kcalloc(bpmp->dev, bpmp->threaded.count + 1,
+				   sizeof(*priv->xfers), GFP_KERNEL);
+	if (!priv->xfers)
+		return -ENOMEM;
+
+	spin_lock_init(&priv->stats_lock);
+
 	bpmp->priv = priv;
 	priv->parent = bpmp;
 	tegra186_hv_bpmp.parent = bpmp;
@@ -403,6 +577,10 @@ static int tegra186_hv_bpmp_init(struct tegra_bpmp *bpmp)
 	tegra186_hv_bpmp_resume(bpmp);
 	of_node_put(hv_of_node);
 
+	priv->debugfs = debugfs_create_dir("bpmp_hv", NULL);
+	debugfs_create_file("mrq_stats", 0644, priv->debugfs, priv,
+			    &tegra186_hv_bpmp_stats_fops);
+
 	return 0;
 
 cleanup:
@@ -430,8 +608,11 @@ static void tegra186_hv_bpmp_channel_cleanup(struct tegra_bpmp_channel *channel)
 
 static void tegra186_hv_bpmp_deinit(struct tegra_bpmp *bpmp)
 {
+	struct tegra186_hv_bpmp *priv = bpmp->priv;
 	unsigned int i;
 
+	debugfs_remove_recursive(priv->debugfs);
+
 	tegra186_hv_bpmp_channel_cleanup(bpmp->tx_channel);
 
 	if (bpmp->soc->channels.cpu_rx.count == MAX_POSSIBLE_RX_CHANNEL)
@@ -447,12 +628,12 @@ const struct tegra_bpmp_ops tegra186_bpmp_hv_ops = {
 	.deinit = tegra186_hv_bpmp_deinit,
 	.is_response_ready = tegra186_bpmp_hv_is_message_ready,
 	.is_request_ready = tegra186_bpmp_hv_is_message_ready,
-	.ack_response = tegra186_bpmp_hv_ack_message,
+	.ack_response = tegra186_hv_bpmp_ack_response,
 	.ack_request = tegra186_bpmp_hv_ack_message,
 	.is_response_channel_free = tegra186_hv_bpmp_is_channel_free,
 	.is_request_channel_free = tegra186_hv_bpmp_is_channel_free,
 	.post_response = tegra186_hv_bpmp_post_message,
-	.post_request = tegra186_hv_bpmp_post_message,
+	.post_request = tegra186_hv_bpmp_post_request,
 	.ring_doorbell = tegra186_hv_ivc_notify,
 	.resume = tegra186_hv_bpmp_resume,
 };
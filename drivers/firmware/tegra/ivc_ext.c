@@ -10,6 +10,13 @@
 
 #define TEGRA_IVC_ALIGN 64
 
+/*
+ * Value of rx.notify while the receiving end drains the channel and wants no
+ * notifications. Zero, the value of ends that do not know about the field,
+ * asks for all notifications, as does any other value.
+ */
+#define TEGRA_IVC_NOTIFY_SUPPRESS 0x4e4f4e54U
+
 /*
  * IVC channel reset protocol.
  *
@@ -65,8 +72,12 @@ struct tegra_ivc_header {
 	} tx;
 
 	union {
-		/* fields owned by the receiving end */
-		u32 count;
+		struct {
+			/* fields owned by the receiving end */
+			u32 count;
+			u32 notify;
+		};
+
 		u8 pad[TEGRA_IVC_ALIGN];
 	} rx;
 };
@@ -77,8 +88,12 @@ int tegra_ivc_channel_notified(struct tegra_ivc *ivc)
 }
 EXPORT_SYMBOL(tegra_ivc_channel_notified);
 
+static void tegra_ivc_set_notify(struct tegra_ivc *ivc, u32 value);
+
 void tegra_ivc_channel_reset(struct tegra_ivc *ivc)
 {
+	/* a suppression from before the reset must not outlive it */
+	tegra_ivc_set_notify(ivc, 0);
 	tegra_ivc_reset(ivc);
 }
 EXPORT_SYMBOL(tegra_ivc_channel_reset);
@@ -197,7 +212,7 @@ static inline int tegra_ivc_check_read(struct tegra_ivc *ivc)
 	tegra_ivc_invalidate(ivc, ivc->rx.phys + offset);
 
 #if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
-	if (!tegra_ivc_empty(ivc, &ivc->rx.map))
+	if (tegra_ivc_empty(ivc, &ivc->rx.map))
 #else
 	if (tegra_ivc_empty(ivc, ivc->rx.channel))
 #endif
@@ -229,7 +244,7 @@ static inline int tegra_ivc_check_write(struct tegra_ivc *ivc)
 	tegra_ivc_invalidate(ivc, ivc->tx.phys + offset);
 
 #if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
-	if (!tegra_ivc_full(ivc, &ivc->tx.map))
+	if (tegra_ivc_full(ivc, &ivc->tx.map))
 #else
 	if (tegra_ivc_full(ivc, ivc->tx.channel))
 #endif
@@ -450,6 +465,276 @@ uint32_t tegra_ivc_frames_available(struct tegra_ivc *ivc, struct tegra_ivc_head
 #endif
 EXPORT_SYMBOL(tegra_ivc_frames_available);
 
+static inline void tegra_ivc_flush(struct tegra_ivc *ivc, dma_addr_t phys)
+{
+	if (!ivc->peer)
+		return;
+
+	dma_sync_single_for_device(ivc->peer, phys, TEGRA_IVC_ALIGN,
+				   DMA_TO_DEVICE);
+}
+
+static inline size_t tegra_ivc_frame_offset(struct tegra_ivc *ivc,
+					    unsigned int frame)
+{
+	return sizeof(struct tegra_ivc_header) + ivc->frame_size * frame;
+}
+
+/* copy @size bytes into tx frame @frame and make them visible to the peer */
+static void tegra_ivc_fill_frame(struct tegra_ivc *ivc, unsigned int frame,
+				 const void *buf, size_t size)
+{
+	size_t offset = tegra_ivc_frame_offset(ivc, frame);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	struct iosys_map map = IOSYS_MAP_INIT_OFFSET(&ivc->tx.map, offset);
+
+	iosys_map_memcpy_to(&map, 0, buf, size);
+#else
+	memcpy((void *)ivc->tx.channel + offset, buf, size);
+#endif
+
+	if (ivc->peer)
+		dma_sync_single_for_device(ivc->peer, ivc->tx.phys + offset,
+					   size, DMA_TO_DEVICE);
+}
+
+/* copy @size bytes out of rx frame @frame */
+static void tegra_ivc_drain_frame(struct tegra_ivc *ivc, unsigned int frame,
+				  void *buf, size_t size)
+{
+	size_t offset = tegra_ivc_frame_offset(ivc, frame);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	struct iosys_map map = IOSYS_MAP_INIT_OFFSET(&ivc->rx.map, offset);
+#endif
+
+	if (ivc->peer)
+		dma_sync_single_for_cpu(ivc->peer, ivc->rx.phys + offset,
+					size, DMA_FROM_DEVICE);
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	iosys_map_memcpy_from(buf, &map, 0, size);
+#else
+	memcpy(buf, (void *)ivc->rx.channel + offset, size);
+#endif
+}
+
+static inline unsigned int tegra_ivc_next_position(struct tegra_ivc *ivc,
+						   unsigned int position,
+						   unsigned int count)
+{
+	return (position + count) % ivc->num_frames;
+}
+
+int tegra_ivc_write_batch(struct tegra_ivc *ivc, const void *buf, size_t size,
+			  unsigned int count)
+{
+	unsigned int tx_offset = offsetof(struct tegra_ivc_header, tx.count);
+	unsigned int rx_offset = offsetof(struct tegra_ivc_header, rx.count);
+	unsigned int i, n;
+	u32 used;
+	int err;
+
+	if (size > ivc->frame_size)
+		return -E2BIG;
+
+	err = tegra_ivc_check_write(ivc);
+	if (err)
+		return err;
+
+	/* reserve whatever the peer has released until now */
+	tegra_ivc_invalidate(ivc, ivc->tx.phys + rx_offset);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	used = tegra_ivc_available(ivc, &ivc->tx.map);
+#else
+	used = tegra_ivc_available(ivc, ivc->tx.channel);
+#endif
+	if (used >= ivc->num_frames)
+		return -ENOSPC;
+
+	n = min(count, ivc->num_frames - used);
+	for (i = 0; i < n; i++)
+		tegra_ivc_fill_frame(ivc,
+			tegra_ivc_next_position(ivc, ivc->tx.position, i),
+			buf + i * size, size);
+
+	/*
+	 * Order the stores to all frames before the counter update that
+	 * publishes them.
+	 */
+	smp_wmb();
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	tegra_ivc_header_write_field(&ivc->tx.map, tx.count,
+		tegra_ivc_header_read_field(&ivc->tx.map, tx.count) + n);
+#else
+	WRITE_ONCE(ivc->tx.channel->tx.count,
+		   READ_ONCE(ivc->tx.channel->tx.count) + n);
+#endif
+	ivc->tx.position = tegra_ivc_next_position(ivc, ivc->tx.position, n);
+	tegra_ivc_flush(ivc, ivc->tx.phys + tx_offset);
+
+	/*
+	 * Ensure our write to tx.count occurs before our read from rx.count.
+	 */
+	smp_mb();
+
+	/*
+	 * Notify only when the channel held nothing but this batch, i.e. on
+	 * the transition from empty to non-empty. The peer can only consume
+	 * frames meanwhile, in which case it is awake already.
+	 */
+	tegra_ivc_invalidate(ivc, ivc->tx.phys + rx_offset);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	if (tegra_ivc_available(ivc, &ivc->tx.map) == n)
+#else
+	if (tegra_ivc_available(ivc, ivc->tx.channel) == n)
+#endif
+		ivc->notify(ivc, ivc->notify_data);
+
+	return n;
+}
+EXPORT_SYMBOL(tegra_ivc_write_batch);
+
+int tegra_ivc_read_batch(struct tegra_ivc *ivc, void *buf, size_t size,
+			 unsigned int count)
+{
+	unsigned int tx_offset = offsetof(struct tegra_ivc_header, tx.count);
+	unsigned int rx_offset = offsetof(struct tegra_ivc_header, rx.count);
+	unsigned int i, n;
+	u32 avail;
+	int err;
+
+	if (size > ivc->frame_size)
+		return -E2BIG;
+
+	err = tegra_ivc_check_read(ivc);
+	if (err)
+		return err;
+
+	tegra_ivc_invalidate(ivc, ivc->rx.phys + tx_offset);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	avail = tegra_ivc_available(ivc, &ivc->rx.map);
+#else
+	avail = tegra_ivc_available(ivc, ivc->rx.channel);
+#endif
+	/* an over-full channel is treated as empty, see tegra_ivc_empty() */
+	if (avail > ivc->num_frames)
+		return -ENOSPC;
+
+	/*
+	 * Order observation of tx.count indicating new data before the data
+	 * reads.
+	 */
+	smp_rmb();
+
+	n = min(count, avail);
+	for (i = 0; i < n; i++)
+		tegra_ivc_drain_frame(ivc,
+			tegra_ivc_next_position(ivc, ivc->rx.position, i),
+			buf + i * size, size);
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	tegra_ivc_header_write_field(&ivc->rx.map, rx.count,
+		tegra_ivc_header_read_field(&ivc->rx.map, rx.count) + n);
+#else
+	WRITE_ONCE(ivc->rx.channel->rx.count,
+		   READ_ONCE(ivc->rx.channel->rx.count) + n);
+#endif
+	ivc->rx.position = tegra_ivc_next_position(ivc, ivc->rx.position, n);
+	tegra_ivc_flush(ivc, ivc->rx.phys + rx_offset);
+
+	/*
+	 * Ensure our write to rx.count occurs before our read from tx.count.
+	 */
+	smp_mb();
+
+	/*
+	 * Notify only upon transition from full to non-full, when the writer
+	 * has not refilled any of the frames released by this batch.
+	 */
+	tegra_ivc_invalidate(ivc, ivc->rx.phys + tx_offset);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	if (tegra_ivc_available(ivc, &ivc->rx.map) == ivc->num_frames - n)
+#else
+	if (tegra_ivc_available(ivc, ivc->rx.channel) == ivc->num_frames - n)
+#endif
+		ivc->notify(ivc, ivc->notify_data);
+
+	return n;
+}
+EXPORT_SYMBOL(tegra_ivc_read_batch);
+
+static void tegra_ivc_set_notify(struct tegra_ivc *ivc, u32 value)
+{
+	unsigned int offset = offsetof(struct tegra_ivc_header, rx.notify);
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	tegra_ivc_header_write_field(&ivc->rx.map, rx.notify, value);
+#else
+	WRITE_ONCE(ivc->rx.channel->rx.notify, value);
+#endif
+	tegra_ivc_flush(ivc, ivc->rx.phys + offset);
+}
+
+void tegra_ivc_notify_suppress(struct tegra_ivc *ivc)
+{
+	tegra_ivc_set_notify(ivc, TEGRA_IVC_NOTIFY_SUPPRESS);
+}
+EXPORT_SYMBOL(tegra_ivc_notify_suppress);
+
+bool tegra_ivc_notify_enable(struct tegra_ivc *ivc)
+{
+	unsigned int offset = offsetof(struct tegra_ivc_header, tx.count);
+
+	tegra_ivc_set_notify(ivc, 0);
+
+	/*
+	 * Order the store to rx.notify before the load of tx.count, the peer
+	 * orders its tx.count update before it looks at rx.notify. Either it
+	 * sees us waiting for notifications or we see its frames.
+	 */
+	smp_mb();
+
+	tegra_ivc_invalidate(ivc, ivc->rx.phys + offset);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	return !tegra_ivc_empty(ivc, &ivc->rx.map);
+#else
+	return !tegra_ivc_empty(ivc, ivc->rx.channel);
+#endif
+}
+EXPORT_SYMBOL(tegra_ivc_notify_enable);
+
+bool tegra_ivc_peer_wants_notify(struct tegra_ivc *ivc)
+{
+	unsigned int offset = offsetof(struct tegra_ivc_header, rx.notify);
+	u32 state, notify;
+
+	/*
+	 * Reset handshakes always notify. The peer of an established channel
+	 * has gone through one, so its rx.notify is not stale.
+	 */
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	state = tegra_ivc_header_read_field(&ivc->tx.map, tx.state);
+#else
+	state = READ_ONCE(ivc->tx.channel->tx.state);
+#endif
+	if (state != TEGRA_IVC_STATE_ESTABLISHED)
+		return true;
+
+	/* the caller has published its counter update before notifying */
+	smp_mb();
+
+	tegra_ivc_invalidate(ivc, ivc->tx.phys + offset);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	notify = tegra_ivc_header_read_field(&ivc->tx.map, rx.notify);
+#else
+	notify = READ_ONCE(ivc->tx.channel->rx.notify);
+#endif
+
+	return notify != TEGRA_IVC_NOTIFY_SUPPRESS;
+}
+EXPORT_SYMBOL(tegra_ivc_peer_wants_notify);
+
 /* Inserting this driver as module to export
  * extended IVC driver APIs
  */
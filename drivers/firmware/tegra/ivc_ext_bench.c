@@ -0,0 +1,334 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * ivc_ext_bench - frame rate of the single frame and batched IVC APIs
+ *
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Connects two IVC endpoints back to back in normal memory and moves frames
+ * from one to the other, once a frame at a time with tegra_ivc_write() and
+ * tegra_ivc_read(), and once with tegra_ivc_write_batch() and
+ * tegra_ivc_read_batch(). There is no peer device, so the numbers cover the
+ * ring protocol, barriers and notifications, not the cache maintenance.
+ *
+ *   modprobe ivc_ext_bench frames=1000000 batch=16
+ *   echo 1 > /sys/kernel/debug/ivc_ext_bench/run
+ *   cat /sys/kernel/debug/ivc_ext_bench/results
+ */
+
+#include <nvidia/conftest.h>
+
+#include <linux/debugfs.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <soc/tegra/ivc_ext.h>
+
+#define IEB_FRAME_ALIGN		64U
+#define IEB_RESET_RETRIES	16U
+
+static unsigned int nframes = 64;
+module_param(nframes, uint, 0644);
+MODULE_PARM_DESC(nframes, "Frames of each IVC queue");
+
+static unsigned int frame_size = 128;
+module_param(frame_size, uint, 0644);
+MODULE_PARM_DESC(frame_size, "IVC frame size in bytes, a multiple of 64");
+
+static unsigned int batch = 16;
+module_param(batch, uint, 0644);
+MODULE_PARM_DESC(batch, "Frames written and read per burst");
+
+static unsigned int frames = 1000000;
+module_param(frames, uint, 0644);
+MODULE_PARM_DESC(frames, "Frames moved in one run of each mode");
+
+struct ieb_end {
+	struct tegra_ivc ivc;
+	u64 notifies;
+};
+
+struct ieb_result {
+	u64 frames;
+	u64 ns;
+	u64 notifies;
+};
+
+static struct {
+	struct mutex lock;
+	struct dentry *debugfs;
+	bool valid;
+	int status;
+	unsigned int nframes;
+	unsigned int frame_size;
+	unsigned int batch;
+	struct ieb_result single;
+	struct ieb_result batched;
+} ieb;
+
+static void ieb_notify(struct tegra_ivc *ivc, void *data)
+{
+	struct ieb_end *end = data;
+
+	end->notifies++;
+}
+
+static int ieb_init_end(struct ieb_end *end, void *rx, void *tx,
+			unsigned int num_frames, size_t size)
+{
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	struct iosys_map rx_map = IOSYS_MAP_INIT_VADDR(rx);
+	struct iosys_map tx_map = IOSYS_MAP_INIT_VADDR(tx);
+
+	return tegra_ivc_init(&end->ivc, NULL, &rx_map, 0, &tx_map, 0,
+			      num_frames, size, ieb_notify, end);
+#else
+	return tegra_ivc_init(&end->ivc, NULL, rx, 0, tx, 0,
+			      num_frames, size, ieb_notify, end);
+#endif
+}
+
+static int ieb_connect(struct ieb_end *a, struct ieb_end *b)
+{
+	unsigned int i;
+
+	tegra_ivc_channel_reset(&a->ivc);
+	tegra_ivc_channel_reset(&b->ivc);
+
+	for (i = 0; i < IEB_RESET_RETRIES; i++) {
+		int ea = tegra_ivc_channel_notified(&a->ivc);
+		int eb = tegra_ivc_channel_notified(&b->ivc);
+
+		if ((ea == 0) && (eb == 0))
+			return 0;
+	}
+
+	return -ETIMEDOUT;
+}
+
+/* a burst at a time through the single frame API */
+static int ieb_run_single(struct ieb_end *tx, struct ieb_end *rx, void *buf,
+			  struct ieb_result *res)
+{
+	unsigned int burst = min(ieb.batch, ieb.nframes);
+	u64 moved = 0;
+	ktime_t start;
+	unsigned int i;
+	int ret;
+
+	tx->notifies = 0;
+	rx->notifies = 0;
+	start = ktime_get();
+
+	while (moved < frames) {
+		for (i = 0; i < burst; i++) {
+			ret = tegra_ivc_write(&tx->ivc, NULL, buf + i * ieb.frame_size,
+					      ieb.frame_size);
+			if (ret < 0)
+				return ret;
+		}
+
+		for (i = 0; i < burst; i++) {
+			ret = tegra_ivc_read(&rx->ivc, NULL, buf + i * ieb.frame_size,
+					     ieb.frame_size);
+			if (ret < 0)
+				return ret;
+		}
+
+		moved += burst;
+	}
+
+	res->ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	res->frames = moved;
+	res->notifies = tx->notifies + rx->notifies;
+
+	return 0;
+}
+
+static int ieb_run_batched(struct ieb_end *tx, struct ieb_end *rx, void *buf,
+			   struct ieb_result *res)
+{
+	unsigned int burst = min(ieb.batch, ieb.nframes);
+	u64 moved = 0;
+	ktime_t start;
+	int ret;
+
+	tx->notifies = 0;
+	rx->notifies = 0;
+	start = ktime_get();
+
+	while (moved < frames) {
+		ret = tegra_ivc_write_batch(&tx->ivc, buf, ieb.frame_size, burst);
+		if (ret < 0)
+			return ret;
+		if (ret != burst)
+			return -EIO;
+
+		ret = tegra_ivc_read_batch(&rx->ivc, buf, ieb.frame_size, burst);
+		if (ret < 0)
+			return ret;
+		if (ret != burst)
+			return -EIO;
+
+		moved += burst;
+	}
+
+	res->ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	res->frames = moved;
+	res->notifies = tx->notifies + rx->notifies;
+
+	return 0;
+}
+
+static int ieb_run(void)
+{
+	struct ieb_end *a, *b;
+	size_t queue_size;
+	void *q0, *q1, *buf;
+	int ret;
+
+	ieb.valid = false;
+	ieb.nframes = nframes;
+	ieb.frame_size = frame_size;
+	ieb.batch = max(batch, 1U);
+
+	if ((ieb.nframes == 0U) || (ieb.frame_size == 0U) ||
+	    (ieb.frame_size % IEB_FRAME_ALIGN) != 0U)
+		return -EINVAL;
+
+	queue_size = tegra_ivc_total_queue_size(ieb.nframes * ieb.frame_size);
+	if (queue_size == 0)
+		return -EINVAL;
+
+	a = kzalloc(sizeof(*a), GFP_KERNEL);
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	/* the channel headers need IVC alignment */
+	q0 = alloc_pages_exact(queue_size, GFP_KERNEL | __GFP_ZERO);
+	q1 = alloc_pages_exact(queue_size, GFP_KERNEL | __GFP_ZERO);
+	buf = kcalloc(ieb.batch, ieb.frame_size, GFP_KERNEL);
+	if (!a || !b || !q0 || !q1 || !buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = ieb_init_end(a, q0, q1, ieb.nframes, ieb.frame_size);
+	if (ret)
+		goto out;
+
+	ret = ieb_init_end(b, q1, q0, ieb.nframes, ieb.frame_size);
+	if (ret)
+		goto out;
+
+	ret = ieb_connect(a, b);
+	if (ret)
+		goto out;
+
+	ret = ieb_run_single(a, b, buf, &ieb.single);
+	if (ret)
+		goto out;
+
+	ret = ieb_run_batched(a, b, buf, &ieb.batched);
+	if (ret)
+		goto out;
+
+	ieb.valid = true;
+
+out:
+	ieb.status = ret;
+	kfree(buf);
+	if (q1)
+		free_pages_exact(q1, queue_size);
+	if (q0)
+		free_pages_exact(q0, queue_size);
+	kfree(b);
+	kfree(a);
+
+	return ret;
+}
+
+static ssize_t ieb_run_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	bool run;
+	int err;
+
+	err = kstrtobool_from_user(buf, count, &run);
+	if (err)
+		return err;
+
+	if (!run)
+		return count;
+
+	mutex_lock(&ieb.lock);
+	err = ieb_run();
+	mutex_unlock(&ieb.lock);
+
+	return err ? err : count;
+}
+
+static const struct file_operations ieb_run_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = ieb_run_write,
+	.llseek = noop_llseek,
+};
+
+static void ieb_show_result(struct seq_file *s, const char *name,
+			    const struct ieb_result *res)
+{
+	seq_printf(s, "%s:\n", name);
+	seq_printf(s, "  frames: %llu\n", res->frames);
+	seq_printf(s, "  wall_us: %llu\n", div_u64(res->ns, NSEC_PER_USEC));
+	seq_printf(s, "  frames_per_sec: %llu\n", res->ns ?
+		   div64_u64(res->frames * NSEC_PER_SEC, res->ns) : 0);
+	seq_printf(s, "  notifies: %llu\n", res->notifies);
+}
+
+static int ieb_results_show(struct seq_file *s, void *unused)
+{
+	mutex_lock(&ieb.lock);
+
+	if (!ieb.valid) {
+		seq_printf(s, "no results, status: %d\n", ieb.status);
+		goto out;
+	}
+
+	seq_printf(s, "nframes: %u\n", ieb.nframes);
+	seq_printf(s, "frame_size: %u\n", ieb.frame_size);
+	seq_printf(s, "batch: %u\n", min(ieb.batch, ieb.nframes));
+	ieb_show_result(s, "single", &ieb.single);
+	ieb_show_result(s, "batched", &ieb.batched);
+
+out:
+	mutex_unlock(&ieb.lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ieb_results);
+
+static int __init ieb_init(void)
+{
+	mutex_init(&ieb.lock);
+
+	ieb.debugfs = debugfs_create_dir("ivc_ext_bench", NULL);
+	debugfs_create_file("run", 0200, ieb.debugfs, NULL, &ieb_run_fops);
+	debugfs_create_file("results", 0444, ieb.debugfs, NULL,
+			    &ieb_results_fops);
+
+	return 0;
+}
+
+static void __exit ieb_exit(void)
+{
+	debugfs_remove_recursive(ieb.debugfs);
+	mutex_destroy(&ieb.lock);
+}
+
+module_init(ieb_init);
+module_exit(ieb_exit);
+
+MODULE_DESCRIPTION("IVC single frame and batched API benchmark");
+MODULE_LICENSE("GPL v2");
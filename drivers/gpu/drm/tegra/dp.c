@@ -6,6 +6,9 @@
 
 #include <nvidia/conftest.h>
 
+#include <linux/crc32.h>
+#include <linux/ktime.h>
+
 #if defined(NV_DRM_DISPLAY_DRM_DP_HELPER_H_PRESENT) /* Linux v5.19 */
 #include <drm/display/drm_dp_helper.h>
 #elif defined(NV_DRM_DP_DRM_DP_HELPER_H_PRESENT) /* Linux v5.18 */
@@ -187,6 +190,7 @@ int drm_dp_link_probe(struct drm_dp_aux *aux, struct drm_dp_link *link)
 	if (err < 0)
 		return err;
 
+	link->dpcd = crc32_le(~0, dpcd, sizeof(dpcd));
 	link->revision = dpcd[DP_DPCD_REV];
 	link->max_rate = drm_dp_max_link_rate(dpcd);
 	link->max_lanes = drm_dp_max_lane_count(dpcd);
@@ -466,9 +470,25 @@ void drm_dp_link_train_init(struct drm_dp_link_train *train)
 	train->channel_equalized = false;
 }
 
-static bool drm_dp_link_train_valid(const struct drm_dp_link_train *train)
+/*
+ * Cached settings are only used for the sink, rate and lane count they were
+ * obtained with. Fixed panels and serializers always match after the first
+ * modeset.
+ */
+static bool drm_dp_link_train_cache_valid(const struct drm_dp_link *link)
+{
+	const struct drm_dp_link_train_cache *cache = &link->cache;
+
+	return cache->valid && cache->dpcd == link->dpcd && cache->sink == link->sink &&
+	       cache->rate == link->rate && cache->lanes == link->lanes;
+}
+
+static void drm_dp_link_train_cache_load(struct drm_dp_link *link)
 {
-	return train->clock_recovered && train->channel_equalized;
+	drm_dp_link_train_init(&link->train);
+
+	link->rate = link->cache.trained_rate;
+	link->train.request = link->cache.set;
 }
 
 static int drm_dp_link_apply_training(struct drm_dp_link *link)
@@ -858,36 +878,74 @@ out:
  * is expected that drivers will call drm_dp_link_probe() to obtain the link
  * capabilities before performing link training.
  *
- * If the sink supports fast link training (no AUX CH handshake) and valid
- * training settings are available, this function will try to perform fast
- * link training and fall back to full link training on failure.
+ * The settings of a successful training are cached in the link object. If
+ * the same sink is trained again with the same rate and lane count, the
+ * cached settings are tried first: with fast link training if the sink
+ * supports it (no AUX CH handshake), otherwise as the starting point of a
+ * full link training, which then usually passes on the first iteration.
+ * Full link training from the lowest settings is the final fallback.
  *
  * Returns: 0 on success or a negative error code on failure.
  */
 int drm_dp_link_train(struct drm_dp_link *link)
 {
+	struct drm_dp_link_train_cache *cache = &link->cache;
+	unsigned int rate = link->rate, lanes = link->lanes;
+	ktime_t start = ktime_get();
 	int err;
 
-	drm_dp_link_train_init(&link->train);
+	if (drm_dp_link_train_cache_valid(link)) {
+		if (link->caps.fast_training) {
+			drm_dp_link_train_cache_load(link);
 
-	if (link->caps.fast_training) {
-		if (drm_dp_link_train_valid(&link->train)) {
 			err = drm_dp_link_train_fast(link);
-			if (err < 0)
-				DRM_ERROR("fast link training failed: %d\n",
-					  err);
-			else
-				return 0;
+			if (err == 0) {
+				link->stats.fast++;
+				goto done;
+			}
+
+			DRM_ERROR("fast link training failed: %d\n", err);
 		} else {
-			DRM_DEBUG_KMS("training parameters not available\n");
+			DRM_DEBUG_KMS("fast link training not supported\n");
 		}
+
+		drm_dp_link_train_cache_load(link);
+
+		err = drm_dp_link_train_full(link);
+		if (err == 0) {
+			link->stats.cached++;
+			goto done;
+		}
+
+		DRM_DEBUG_KMS("link training with cached settings failed: %d\n", err);
+		link->rate = rate;
 	} else {
-		DRM_DEBUG_KMS("fast link training not supported\n");
+		DRM_DEBUG_KMS("training parameters not available\n");
 	}
 
+	drm_dp_link_train_init(&link->train);
+
 	err = drm_dp_link_train_full(link);
-	if (err < 0)
+	if (err < 0) {
 		DRM_ERROR("full link training failed: %d\n", err);
+		link->stats.failed++;
+		cache->valid = false;
+		goto out;
+	}
+
+	link->stats.full++;
+
+done:
+	cache->valid = true;
+	cache->dpcd = link->dpcd;
+	cache->sink = link->sink;
+	cache->rate = rate;
+	cache->lanes = lanes;
+	cache->trained_rate = link->rate;
+	cache->set = link->train.request;
+
+out:
+	link->stats.last_us = ktime_us_delta(ktime_get(), start);
 
 	return err;
 }
@@ -106,6 +106,43 @@ struct drm_dp_link_train {
 	bool channel_equalized;
 };
 
+/**
+ * struct drm_dp_link_train_cache - result of the last successful training
+ * @valid: flag to track if the cache holds usable settings
+ * @dpcd: checksum of the receiver capabilities of the sink
+ * @sink: driver-provided identity of the sink (see &drm_dp_link.sink)
+ * @rate: link rate chosen for the mode that was trained
+ * @lanes: number of lanes chosen for the mode that was trained
+ * @trained_rate: link rate that training settled on (lower than @rate if
+ *   the link had to be downgraded)
+ * @set: settings that passed channel equalization
+ */
+struct drm_dp_link_train_cache {
+	bool valid;
+	u32 dpcd;
+	u32 sink;
+	unsigned int rate;
+	unsigned int lanes;
+	unsigned int trained_rate;
+	struct drm_dp_link_train_set set;
+};
+
+/**
+ * struct drm_dp_link_train_stats - link training statistics
+ * @fast: number of fast link trainings with cached settings
+ * @cached: number of full link trainings starting from cached settings
+ * @full: number of full link trainings starting from the lowest settings
+ * @failed: number of failed link trainings
+ * @last_us: duration of the last link training in microseconds
+ */
+struct drm_dp_link_train_stats {
+	unsigned int fast;
+	unsigned int cached;
+	unsigned int full;
+	unsigned int failed;
+	unsigned int last_us;
+};
+
 /**
  * struct drm_dp_link - DP link capabilities and configuration
  * @revision: DP specification revision supported on the link
@@ -118,6 +155,9 @@ struct drm_dp_link_train {
  * @lanes: currently configured number of lanes
  * @rates: additional supported link rates in kHz (eDP 1.4)
  * @num_rates: number of additional supported link rates (eDP 1.4)
+ * @dpcd: checksum of the receiver capabilities read by drm_dp_link_probe()
+ * @sink: identity of the sink, such as an EDID checksum, set by the driver
+ *   before training to tell sinks with identical capabilities apart
  */
 struct drm_dp_link {
 	unsigned char revision;
@@ -143,6 +183,9 @@ struct drm_dp_link {
 	unsigned long rates[DP_MAX_SUPPORTED_RATES];
 	unsigned int num_rates;
 
+	u32 dpcd;
+	u32 sink;
+
 	/**
 	 * @ops: DP link operations
 	 */
@@ -157,6 +200,17 @@ struct drm_dp_link {
 	 * @train: DP link training state
 	 */
 	struct drm_dp_link_train train;
+
+	/**
+	 * @cache: settings of the last successful link training, kept across
+	 * drm_dp_link_probe()
+	 */
+	struct drm_dp_link_train_cache cache;
+
+	/**
+	 * @stats: link training statistics
+	 */
+	struct drm_dp_link_train_stats stats;
 };
 
 int drm_dp_link_add_rate(struct drm_dp_link *link, unsigned long rate);
@@ -14,6 +14,7 @@
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/sizes.h>
 #include <linux/version.h>
 
 #include <drm/drm_aperture.h>
@@ -47,6 +48,19 @@
 #define CARVEOUT_SZ SZ_64M
 #define CDMA_GATHER_FETCHES_MAX_NB 16383
 
+static bool tegra_atomic_async_flip(struct drm_atomic_state *state)
+{
+	struct drm_crtc_state *crtc_state;
+	struct drm_crtc *crtc;
+	unsigned int i;
+
+	for_each_new_crtc_in_state(state, crtc, crtc_state, i)
+		if (crtc_state->async_flip)
+			return true;
+
+	return false;
+}
+
 static int tegra_atomic_check(struct drm_device *drm,
 			      struct drm_atomic_state *state)
 {
@@ -56,6 +70,16 @@ static int tegra_atomic_check(struct drm_device *drm,
 	if (err < 0)
 		return err;
 
+	/*
+	 * Route DRM_MODE_PAGE_FLIP_ASYNC flips that only change the window
+	 * address through the planes' ->atomic_async_update() so that they
+	 * take effect immediately instead of waiting for vblank. Anything
+	 * else falls back to a regular, vblank-synchronized commit.
+	 */
+	if (!state->async_update && tegra_atomic_async_flip(state) &&
+	    drm_atomic_helper_async_check(drm, state) == 0)
+		state->async_update = true;
+
 	return tegra_display_hub_atomic_check(drm, state);
 }
 
@@ -760,12 +784,22 @@ static const struct drm_ioctl_desc tegra_drm_ioctls[] = {
 			  DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(TEGRA_CHANNEL_SUBMIT, tegra_drm_ioctl_channel_submit,
 			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_CHANNEL_SUBMIT_BATCH, tegra_drm_ioctl_channel_submit_batch,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_CHANNEL_CREATE_TEMPLATE, tegra_drm_ioctl_channel_create_template,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_CHANNEL_SUBMIT_TEMPLATE, tegra_drm_ioctl_channel_submit_template,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_CHANNEL_DESTROY_TEMPLATE, tegra_drm_ioctl_channel_destroy_template,
+			  DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(TEGRA_SYNCPOINT_ALLOCATE, tegra_drm_ioctl_syncpoint_allocate,
 			  DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(TEGRA_SYNCPOINT_FREE, tegra_drm_ioctl_syncpoint_free,
 			  DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(TEGRA_SYNCPOINT_WAIT, tegra_drm_ioctl_syncpoint_wait,
 			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_SYNCPOINT_SHADOW, tegra_drm_ioctl_syncpoint_shadow,
+			  DRM_RENDER_ALLOW),
 
 	DRM_IOCTL_DEF_DRV(TEGRA_GEM_CREATE, tegra_gem_create, DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(TEGRA_GEM_MMAP, tegra_gem_mmap, DRM_RENDER_ALLOW),
@@ -868,9 +902,93 @@ static int tegra_debugfs_iova(struct seq_file *s, void *data)
 	return 0;
 }
 
+static int tegra_debugfs_bo_orders(struct seq_file *s, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *)s->private;
+	struct drm_device *drm = node->minor->dev;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct tegra_bo *bo;
+	unsigned int i;
+
+	if (!tegra->domain)
+		return 0;
+
+	mutex_lock(&tegra->mm_lock);
+
+	list_for_each_entry(bo, &tegra->bos, list) {
+		seq_printf(s, "%pad: size %zu, %s", &bo->iova, bo->gem.size,
+			   bo->gem.import_attach ? "imported" :
+			   bo->chunked ? "chunked" : "shmem");
+
+		for (i = 0; i < TEGRA_BO_NUM_ORDERS; i++)
+			seq_printf(s, ", %luK: %lu",
+				   (PAGE_SIZE << tegra_bo_orders[i]) / SZ_1K,
+				   bo->chunks[i]);
+
+		seq_puts(s, "\n");
+	}
+
+	mutex_unlock(&tegra->mm_lock);
+
+	return 0;
+}
+
+static void tegra_debugfs_pm_hist(struct seq_file *s, const char *title,
+				  const u64 *hist)
+{
+	unsigned int i;
+
+	seq_printf(s, "  %s:\n", title);
+
+	for (i = 0; i < TEGRA_DRM_PM_HIST_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+
+		if (i == TEGRA_DRM_PM_HIST_BUCKETS - 1)
+			seq_printf(s, "    %6llu+       %llu\n",
+				   (1ULL << i) - 1, hist[i]);
+		else
+			seq_printf(s, "    %6llu-%-6llu %llu\n",
+				   (1ULL << i) - 1,
+				   tegra_drm_pm_bucket_limit(i), hist[i]);
+	}
+}
+
+static int tegra_debugfs_engine_pm(struct seq_file *s, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *)s->private;
+	struct drm_device *drm = node->minor->dev;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct tegra_drm_client *client;
+
+	mutex_lock(&tegra->clients_lock);
+
+	list_for_each_entry(client, &tegra->clients, list) {
+		struct tegra_drm_client_pm *pm = &client->pm;
+
+		mutex_lock(&pm->lock);
+
+		seq_printf(s, "%s: autosuspend %d ms (default %d ms), %llu resumes\n",
+			   dev_name(client->base.dev), pm->delay_ms,
+			   pm->default_delay_ms, pm->resumes);
+		tegra_debugfs_pm_hist(s, "resume latency (us)",
+				      pm->resume_hist);
+		tegra_debugfs_pm_hist(s, "time to next job (ms)",
+				      pm->gap_hist);
+
+		mutex_unlock(&pm->lock);
+	}
+
+	mutex_unlock(&tegra->clients_lock);
+
+	return 0;
+}
+
 static struct drm_info_list tegra_debugfs_list[] = {
 	{ "framebuffers", tegra_debugfs_framebuffers, 0 },
 	{ "iova", tegra_debugfs_iova, 0 },
+	{ "bo_orders", tegra_debugfs_bo_orders, 0 },
+	{ "engine_pm", tegra_debugfs_engine_pm, 0 },
 };
 
 static void tegra_debugfs_init(struct drm_minor *minor)
@@ -914,6 +1032,119 @@ static const struct drm_driver tegra_drm_driver = {
 	.patchlevel = DRIVER_PATCHLEVEL,
 };
 
+static bool adaptive_autosuspend = true;
+module_param(adaptive_autosuspend, bool, 0644);
+MODULE_PARM_DESC(adaptive_autosuspend,
+		 "Derive engine autosuspend delays from job arrival gaps");
+
+#define TEGRA_DRM_PM_MIN_DELAY_MS	20
+#define TEGRA_DRM_PM_MAX_DELAY_MS	2000
+#define TEGRA_DRM_PM_MIN_SAMPLES	8
+#define TEGRA_DRM_PM_DECAY_SAMPLES	64
+
+static unsigned int tegra_drm_pm_bucket(u64 value)
+{
+	return min_t(unsigned int, ilog2(value + 1),
+		     TEGRA_DRM_PM_HIST_BUCKETS - 1);
+}
+
+/* largest value falling into a histogram bucket */
+static u64 tegra_drm_pm_bucket_limit(unsigned int bucket)
+{
+	return (2ULL << bucket) - 2;
+}
+
+/*
+ * Stay powered for as long as 90% of the recent idle gaps last, so that
+ * bursts are served warm. When even that is longer than it is worth
+ * keeping the engine up for, power down quickly instead.
+ */
+static int tegra_drm_pm_learn_delay(struct tegra_drm_client_pm *pm)
+{
+	u32 target = pm->num_gaps - pm->num_gaps / 10;
+	u32 seen = 0;
+	unsigned int i;
+	u64 limit;
+
+	if (pm->num_gaps < TEGRA_DRM_PM_MIN_SAMPLES)
+		return pm->default_delay_ms;
+
+	for (i = 0; i < TEGRA_DRM_PM_HIST_BUCKETS - 1; i++) {
+		seen += pm->gaps[i];
+		if (seen >= target)
+			break;
+	}
+
+	limit = tegra_drm_pm_bucket_limit(i);
+	if (limit > TEGRA_DRM_PM_MAX_DELAY_MS)
+		return TEGRA_DRM_PM_MIN_DELAY_MS;
+
+	return max_t(int, limit, TEGRA_DRM_PM_MIN_DELAY_MS);
+}
+
+static void tegra_drm_pm_add_gap(struct tegra_drm_client_pm *pm, u64 gap_ms)
+{
+	unsigned int bucket = tegra_drm_pm_bucket(gap_ms), i;
+
+	pm->gap_hist[bucket]++;
+	pm->gaps[bucket]++;
+	pm->num_gaps++;
+
+	if (++pm->samples < TEGRA_DRM_PM_DECAY_SAMPLES)
+		return;
+
+	/* halve the history so that the delay follows workload changes */
+	pm->samples = 0;
+	pm->num_gaps = 0;
+
+	for (i = 0; i < TEGRA_DRM_PM_HIST_BUCKETS; i++) {
+		pm->gaps[i] /= 2;
+		pm->num_gaps += pm->gaps[i];
+	}
+}
+
+/*
+ * Called when a job is submitted, with the runtime PM reference for it
+ * held. resume_us is the time it took to power up the engine, or
+ * negative if it was already running.
+ */
+void tegra_drm_client_job_begin(struct tegra_drm_client *client,
+				s64 resume_us)
+{
+	struct tegra_drm_client_pm *pm = &client->pm;
+	int delay;
+
+	mutex_lock(&pm->lock);
+
+	if (resume_us >= 0) {
+		pm->resume_hist[tegra_drm_pm_bucket(resume_us)]++;
+		pm->resumes++;
+	}
+
+	if (atomic_inc_return(&pm->inflight) == 1 && READ_ONCE(pm->last_idle))
+		tegra_drm_pm_add_gap(pm, ktime_ms_delta(ktime_get(),
+							READ_ONCE(pm->last_idle)));
+
+	if (adaptive_autosuspend)
+		delay = tegra_drm_pm_learn_delay(pm);
+	else
+		delay = pm->default_delay_ms;
+
+	if (delay != pm->delay_ms) {
+		pm->delay_ms = delay;
+		pm_runtime_set_autosuspend_delay(client->base.dev, delay);
+	}
+
+	mutex_unlock(&pm->lock);
+}
+
+/* Called when a job is released, before its runtime PM reference is put */
+void tegra_drm_client_job_end(struct tegra_drm_client *client)
+{
+	if (atomic_dec_and_test(&client->pm.inflight))
+		WRITE_ONCE(client->pm.last_idle, ktime_get());
+}
+
 int tegra_drm_register_client(struct tegra_drm *tegra,
 			      struct tegra_drm_client *client)
 {
@@ -925,6 +1156,11 @@ int tegra_drm_register_client(struct tegra_drm *tegra,
 	if (!client->shared_channel)
 		return -EBUSY;
 
+	mutex_init(&client->pm.lock);
+	atomic_set(&client->pm.inflight, 0);
+	client->pm.default_delay_ms = client->base.dev->power.autosuspend_delay;
+	client->pm.delay_ms = client->pm.default_delay_ms;
+
 	mutex_lock(&tegra->clients_lock);
 	list_add_tail(&client->list, &tegra->clients);
 	client->drm = tegra;
@@ -1269,6 +1505,7 @@ static int host1x_drm_probe(struct host1x_device *dev)
 
 		drm_mm_init(&tegra->mm, gem_start, gem_end - gem_start + 1);
 		mutex_init(&tegra->mm_lock);
+		INIT_LIST_HEAD(&tegra->bos);
 
 		DRM_DEBUG_DRIVER("IOMMU apertures:\n");
 		DRM_DEBUG_DRIVER("  GEM: %#llx-%#llx\n", gem_start, gem_end);
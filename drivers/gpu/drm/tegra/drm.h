@@ -43,6 +43,7 @@ struct tegra_drm {
 	bool use_explicit_iommu;
 	struct mutex mm_lock;
 	struct drm_mm mm;
+	struct list_head bos;
 
 	struct {
 		struct iova_domain domain;
@@ -80,6 +81,7 @@ struct tegra_drm_context {
 
 	/* Only used by new UAPI. */
 	struct xarray mappings;
+	struct xarray templates;
 	struct host1x_memory_context *memory_context;
 };
 
@@ -109,11 +111,38 @@ tegra_drm_get_streamid_offset_thi(struct tegra_drm_client *client, u32 *offset)
 	return 0;
 }
 
+#define TEGRA_DRM_PM_HIST_BUCKETS 16
+
+/*
+ * Runtime PM behaviour of an engine. Idle gaps are the time between the
+ * engine running out of jobs and the next job being submitted; the
+ * autosuspend delay is derived from a decaying histogram of them.
+ */
+struct tegra_drm_client_pm {
+	struct mutex lock;
+	atomic_t inflight;
+	ktime_t last_idle;
+
+	int default_delay_ms;
+	int delay_ms;
+
+	/* decaying, log2 of the gap in ms */
+	u32 gaps[TEGRA_DRM_PM_HIST_BUCKETS];
+	u32 num_gaps;
+	u32 samples;
+
+	/* lifetime, log2 of ms and us respectively */
+	u64 gap_hist[TEGRA_DRM_PM_HIST_BUCKETS];
+	u64 resume_hist[TEGRA_DRM_PM_HIST_BUCKETS];
+	u64 resumes;
+};
+
 struct tegra_drm_client {
 	struct host1x_client base;
 	struct list_head list;
 	struct tegra_drm *drm;
 	struct host1x_channel *shared_channel;
+	struct tegra_drm_client_pm pm;
 
 	/* Set by driver */
 	unsigned int version;
@@ -139,6 +168,9 @@ int tegra_drm_register_client(struct tegra_drm *tegra,
 			      struct tegra_drm_client *client);
 int tegra_drm_unregister_client(struct tegra_drm *tegra,
 				struct tegra_drm_client *client);
+void tegra_drm_client_job_begin(struct tegra_drm_client *client,
+				s64 resume_us);
+void tegra_drm_client_job_end(struct tegra_drm_client *client);
 int host1x_client_iommu_attach(struct host1x_client *client);
 void host1x_client_iommu_detach(struct host1x_client *client);
 
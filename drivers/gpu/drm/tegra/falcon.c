@@ -8,10 +8,37 @@
 #include <linux/firmware.h>
 #include <linux/pci_ids.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include <trace/events/trace.h>
 
 #include "falcon.h"
 #include "drm.h"
 
+/*
+ * Firmware image in the shared Tegra DRM IOMMU domain. Every instance of
+ * an engine type (NVDEC0/NVDEC1, ...) boots from the same copy, and the
+ * copy lives until the last of them exits, so runtime PM cycles and
+ * additional instances never read, copy or map the firmware again.
+ */
+struct falcon_shared_firmware {
+	struct list_head list;
+	struct kref kref;
+	struct tegra_drm *tegra;
+	const char *name;
+	/* device the image was DMA-mapped for, used for cache maintenance */
+	struct device *dev;
+	struct falcon_firmware image;
+};
+
+static LIST_HEAD(falcon_shared_firmwares);
+static DEFINE_MUTEX(falcon_shared_lock);
+
 enum falcon_memory {
 	FALCON_MEMORY_IMEM,
 	FALCON_MEMORY_DATA,
@@ -109,15 +136,61 @@ static int falcon_parse_firmware_image(struct falcon *falcon)
 	return 0;
 }
 
-int falcon_read_firmware(struct falcon *falcon, const char *name)
+static void falcon_firmware_requested(const struct firmware *firmware,
+				      void *context)
+{
+	struct falcon *falcon = context;
+
+	/* NULL if the request failed, falcon_read_firmware() retries */
+	falcon->firmware.firmware = firmware;
+	complete(&falcon->firmware_requested);
+}
+
+/*
+ * Start reading the firmware file at probe, so that engines fetch their
+ * firmware in parallel rather than one after another on first use.
+ */
+int falcon_request_firmware(struct falcon *falcon, const char *name)
 {
 	int err;
 
-	/* request_firmware prints error if it fails */
-	err = request_firmware(&falcon->firmware.firmware, name, falcon->dev);
+	if (falcon->firmware_pending || falcon->firmware.virt)
+		return 0;
+
+	err = request_firmware_nowait(THIS_MODULE, true, name, falcon->dev,
+				      GFP_KERNEL, falcon,
+				      falcon_firmware_requested);
 	if (err < 0)
 		return err;
 
+	falcon->firmware_pending = true;
+
+	return 0;
+}
+
+static void falcon_wait_firmware_request(struct falcon *falcon)
+{
+	if (!falcon->firmware_pending)
+		return;
+
+	wait_for_completion(&falcon->firmware_requested);
+	falcon->firmware_pending = false;
+}
+
+int falcon_read_firmware(struct falcon *falcon, const char *name)
+{
+	int err;
+
+	falcon_wait_firmware_request(falcon);
+
+	if (!falcon->firmware.firmware) {
+		/* request_firmware prints error if it fails */
+		err = request_firmware(&falcon->firmware.firmware, name,
+				       falcon->dev);
+		if (err < 0)
+			return err;
+	}
+
 	falcon->firmware.size = falcon->firmware.firmware->size;
 
 	return 0;
@@ -144,15 +217,143 @@ int falcon_load_firmware(struct falcon *falcon)
 	return 0;
 }
 
+int falcon_get_shared_firmware(struct falcon *falcon, struct tegra_drm *tegra,
+			       const char *name)
+{
+	struct falcon_shared_firmware *fw;
+	dma_addr_t iova, phys;
+	size_t size;
+	void *virt;
+	int err;
+
+	mutex_lock(&falcon_shared_lock);
+
+	list_for_each_entry(fw, &falcon_shared_firmwares, list) {
+		if (fw->tegra == tegra && !strcmp(fw->name, name)) {
+			kref_get(&fw->kref);
+			mutex_unlock(&falcon_shared_lock);
+
+			/* the file read at probe is not needed after all */
+			falcon_wait_firmware_request(falcon);
+			if (falcon->firmware.firmware)
+				release_firmware(falcon->firmware.firmware);
+
+			falcon->firmware = fw->image;
+
+			return 0;
+		}
+	}
+
+	fw = kzalloc(sizeof(*fw), GFP_KERNEL);
+	if (!fw) {
+		err = -ENOMEM;
+		goto unlock;
+	}
+
+	fw->name = kstrdup_const(name, GFP_KERNEL);
+	if (!fw->name) {
+		err = -ENOMEM;
+		goto free;
+	}
+
+	err = falcon_read_firmware(falcon, name);
+	if (err < 0)
+		goto free;
+
+	size = falcon->firmware.size;
+
+	virt = tegra_drm_alloc(tegra, size, &iova);
+	if (IS_ERR(virt)) {
+		err = PTR_ERR(virt);
+		goto free;
+	}
+
+	falcon->firmware.virt = virt;
+	falcon->firmware.iova = iova;
+
+	err = falcon_load_firmware(falcon);
+	if (err < 0)
+		goto free_image;
+
+	/*
+	 * The IOVA is from the shared domain, so we need to make sure to get
+	 * the physical address so that the DMA API knows what memory pages
+	 * to flush the cache for.
+	 */
+	phys = dma_map_single(falcon->dev, virt, size, DMA_TO_DEVICE);
+
+	err = dma_mapping_error(falcon->dev, phys);
+	if (err < 0)
+		goto free_image;
+
+	falcon->firmware.phys = phys;
+	falcon->firmware.shared = fw;
+
+	kref_init(&fw->kref);
+	fw->tegra = tegra;
+	fw->dev = get_device(falcon->dev);
+	fw->image = falcon->firmware;
+	list_add(&fw->list, &falcon_shared_firmwares);
+
+	mutex_unlock(&falcon_shared_lock);
+
+	return 0;
+
+free_image:
+	tegra_drm_free(tegra, size, virt, iova);
+	falcon->firmware.virt = NULL;
+free:
+	kfree_const(fw->name);
+	kfree(fw);
+unlock:
+	mutex_unlock(&falcon_shared_lock);
+	return err;
+}
+
+static void falcon_shared_firmware_release(struct kref *kref)
+{
+	struct falcon_shared_firmware *fw =
+		container_of(kref, struct falcon_shared_firmware, kref);
+
+	list_del(&fw->list);
+
+	dma_unmap_single(fw->dev, fw->image.phys, fw->image.size,
+			 DMA_TO_DEVICE);
+	tegra_drm_free(fw->tegra, fw->image.size, fw->image.virt,
+		       fw->image.iova);
+
+	put_device(fw->dev);
+	kfree_const(fw->name);
+	kfree(fw);
+}
+
+void falcon_put_shared_firmware(struct falcon *falcon)
+{
+	struct falcon_shared_firmware *fw = falcon->firmware.shared;
+
+	if (!fw)
+		return;
+
+	mutex_lock(&falcon_shared_lock);
+	kref_put(&fw->kref, falcon_shared_firmware_release);
+	mutex_unlock(&falcon_shared_lock);
+
+	falcon->firmware.shared = NULL;
+	falcon->firmware.virt = NULL;
+}
+
 int falcon_init(struct falcon *falcon)
 {
 	falcon->firmware.virt = NULL;
+	init_completion(&falcon->firmware_requested);
 
 	return 0;
 }
 
 void falcon_exit(struct falcon *falcon)
 {
+	falcon_wait_firmware_request(falcon);
+
 	if (falcon->firmware.firmware)
 		release_firmware(falcon->firmware.firmware);
 }
@@ -160,12 +361,15 @@ void falcon_exit(struct falcon *falcon)
 int falcon_boot(struct falcon *falcon)
 {
 	unsigned long offset;
+	ktime_t start;
 	u32 value;
 	int err;
 
 	if (!falcon->firmware.virt)
 		return -EINVAL;
 
+	start = ktime_get();
+
 	err = readl_poll_timeout(falcon->regs + FALCON_DMACTL, value,
 				 (value & (FALCON_DMACTL_IMEM_SCRUBBING |
 					   FALCON_DMACTL_DMEM_SCRUBBING)) == 0,
@@ -221,6 +425,11 @@ int falcon_boot(struct falcon *falcon)
 		return err;
 	}
 
+	falcon->boot_time_us = ktime_us_delta(ktime_get(), start);
+	trace_falcon_boot(falcon->dev, falcon->boot_time_us,
+			  falcon->firmware.shared != NULL);
+	dev_dbg(falcon->dev, "booted in %llu us\n", falcon->boot_time_us);
+
 	return 0;
 }
 
@@ -6,6 +6,7 @@
 #ifndef _FALCON_H_
 #define _FALCON_H_
 
+#include <linux/completion.h>
 #include <linux/types.h>
 
 #define FALCON_UCLASS_METHOD_OFFSET		0x00000040
@@ -75,6 +76,9 @@ struct falcon_fw_os_header_v1 {
 	u32 data_size;
 };
 
+struct tegra_drm;
+struct falcon_shared_firmware;
+
 struct falcon_firmware_section {
 	unsigned long offset;
 	size_t size;
@@ -94,6 +98,9 @@ struct falcon_firmware {
 	struct falcon_firmware_section bin_data;
 	struct falcon_firmware_section data;
 	struct falcon_firmware_section code;
+
+	/* Set if the image is shared with other engines of the same type */
+	struct falcon_shared_firmware *shared;
 };
 
 struct falcon {
@@ -102,12 +109,23 @@ struct falcon {
 	void __iomem *regs;
 
 	struct falcon_firmware firmware;
+
+	/* Firmware file requested ahead of the first boot */
+	struct completion firmware_requested;
+	bool firmware_pending;
+
+	/* Duration of the last boot */
+	u64 boot_time_us;
 };
 
 int falcon_init(struct falcon *falcon);
 void falcon_exit(struct falcon *falcon);
+int falcon_request_firmware(struct falcon *falcon, const char *firmware_name);
 int falcon_read_firmware(struct falcon *falcon, const char *firmware_name);
 int falcon_load_firmware(struct falcon *falcon);
+int falcon_get_shared_firmware(struct falcon *falcon, struct tegra_drm *tegra,
+			       const char *firmware_name);
+void falcon_put_shared_firmware(struct falcon *falcon);
 int falcon_boot(struct falcon *falcon);
 void falcon_execute_method(struct falcon *falcon, u32 method, u32 data);
 int falcon_wait_idle(struct falcon *falcon);
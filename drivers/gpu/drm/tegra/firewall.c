@@ -48,6 +48,9 @@ static int fw_check_reg(struct tegra_drm_firewall *fw, u32 offset)
 	if (err)
 		return err;
 
+	if (fw->submit->reg_words)
+		__set_bit(fw->pos - 1, fw->submit->reg_words);
+
 	if (!fw->client->ops->is_addr_reg)
 		return 0;
 
@@ -14,7 +14,10 @@
 
 #include <linux/dma-buf.h>
 #include <linux/iommu.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/sizes.h>
 #include <linux/vmalloc.h>
 
 #include <drm/drm_drv.h>
@@ -23,9 +26,20 @@
 
 #include "drm.h"
 #include "gem.h"
+#include "uapi.h"
 
 MODULE_IMPORT_NS(DMA_BUF);
 
+static bool huge_pages = true;
+module_param(huge_pages, bool, 0644);
+MODULE_PARM_DESC(huge_pages, "Back large buffer objects with high-order pages");
+
+const unsigned int tegra_bo_orders[TEGRA_BO_NUM_ORDERS] = {
+	ilog2(SZ_2M) - PAGE_SHIFT,
+	ilog2(SZ_64K) - PAGE_SHIFT,
+	0,
+};
+
 static unsigned int sg_dma_count_chunks(struct scatterlist *sgl, unsigned int nents)
 {
 	dma_addr_t next = ~(dma_addr_t)0;
@@ -231,9 +245,36 @@ static const struct host1x_bo_ops tegra_bo_ops = {
 	.munmap = tegra_bo_munmap,
 };
 
+/*
+ * Pick an I/O virtual address alignment that allows the largest chunk of the
+ * buffer object to be mapped with the largest IOMMU page size that fits it.
+ * Chunks are laid out largest first, so every chunk then ends up naturally
+ * aligned in I/O virtual address space as well.
+ */
+static u64 tegra_bo_iova_align(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	unsigned long pgsizes = tegra->domain->pgsize_bitmap;
+	unsigned long max = PAGE_SIZE;
+	unsigned int i;
+
+	for (i = 0; i < TEGRA_BO_NUM_ORDERS; i++) {
+		if (bo->chunks[i]) {
+			max = PAGE_SIZE << tegra_bo_orders[i];
+			break;
+		}
+	}
+
+	pgsizes &= GENMASK(__fls(max), 0);
+	if (!pgsizes)
+		return PAGE_SIZE;
+
+	return max_t(unsigned long, BIT(__fls(pgsizes)), PAGE_SIZE);
+}
+
 static int tegra_bo_iommu_map(struct tegra_drm *tegra, struct tegra_bo *bo)
 {
 	int prot = IOMMU_READ | IOMMU_WRITE;
+	u64 align;
 	int err;
 
 	if (bo->mm)
@@ -243,10 +284,12 @@ static int tegra_bo_iommu_map(struct tegra_drm *tegra, struct tegra_bo *bo)
 	if (!bo->mm)
 		return -ENOMEM;
 
+	align = tegra_bo_iova_align(tegra, bo);
+
 	mutex_lock(&tegra->mm_lock);
 
 	err = drm_mm_insert_node_generic(&tegra->mm,
-					 bo->mm, bo->gem.size, PAGE_SIZE, 0, 0);
+					 bo->mm, bo->gem.size, align, 0, 0);
 	if (err < 0) {
 		dev_err(tegra->drm->dev, "out of I/O virtual memory: %d\n",
 			err);
@@ -262,6 +305,7 @@ static int tegra_bo_iommu_map(struct tegra_drm *tegra, struct tegra_bo *bo)
 		goto remove;
 	}
 
+	list_add_tail(&bo->list, &tegra->bos);
 	mutex_unlock(&tegra->mm_lock);
 
 	return 0;
@@ -280,6 +324,7 @@ static int tegra_bo_iommu_unmap(struct tegra_drm *tegra, struct tegra_bo *bo)
 		return 0;
 
 	mutex_lock(&tegra->mm_lock);
+	list_del(&bo->list);
 	iommu_unmap(tegra->domain, bo->iova, bo->size);
 	drm_mm_remove_node(bo->mm);
 	mutex_unlock(&tegra->mm_lock);
@@ -306,6 +351,7 @@ static struct tegra_bo *tegra_bo_alloc_object(struct drm_device *drm,
 		return ERR_PTR(-ENOMEM);
 
 	bo->gem.funcs = &tegra_gem_object_funcs;
+	INIT_LIST_HEAD(&bo->list);
 
 	host1x_bo_init(&bo->base, &tegra_bo_ops);
 	size = round_up(size, PAGE_SIZE);
@@ -327,11 +373,27 @@ free:
 	return ERR_PTR(err);
 }
 
+static void tegra_bo_put_chunked_pages(struct tegra_bo *bo)
+{
+	unsigned long i;
+
+	for (i = 0; i < bo->num_pages; i++)
+		__free_page(bo->pages[i]);
+
+	kvfree(bo->pages);
+	bo->pages = NULL;
+}
+
 static void tegra_bo_free(struct drm_device *drm, struct tegra_bo *bo)
 {
 	if (bo->pages) {
 		dma_unmap_sgtable(drm->dev, bo->sgt, DMA_FROM_DEVICE, 0);
-		drm_gem_put_pages(&bo->gem, bo->pages, true, true);
+
+		if (bo->chunked)
+			tegra_bo_put_chunked_pages(bo);
+		else
+			drm_gem_put_pages(&bo->gem, bo->pages, true, true);
+
 		sg_free_table(bo->sgt);
 		kfree(bo->sgt);
 	} else if (bo->vaddr) {
@@ -339,16 +401,84 @@ static void tegra_bo_free(struct drm_device *drm, struct tegra_bo *bo)
 	}
 }
 
+/*
+ * Back the buffer object with pages taken directly from the page allocator,
+ * trying 2 MiB chunks first and stepping down to 64 KiB chunks and finally
+ * single pages once a larger order can no longer be satisfied. High-order
+ * chunks are split so that each page can be individually refcounted, which
+ * keeps the CPU mapping and vmap() paths identical to shmem-backed objects.
+ */
+static int tegra_bo_get_chunked_pages(struct tegra_bo *bo)
+{
+	unsigned long num_pages = bo->gem.size >> PAGE_SHIFT;
+	unsigned long i = 0, j;
+	unsigned int k = 0;
+
+	bo->pages = kvmalloc_array(num_pages, sizeof(*bo->pages), GFP_KERNEL);
+	if (!bo->pages)
+		return -ENOMEM;
+
+	bo->num_pages = 0;
+
+	while (i < num_pages) {
+		unsigned int order = tegra_bo_orders[k];
+		gfp_t gfp = GFP_HIGHUSER | __GFP_ZERO;
+		struct page *page;
+
+		if ((1UL << order) > num_pages - i) {
+			k++;
+			continue;
+		}
+
+		if (order > 0)
+			gfp |= __GFP_NORETRY | __GFP_NOWARN | __GFP_NOMEMALLOC;
+
+		page = alloc_pages(gfp, order);
+		if (!page) {
+			if (order == 0)
+				goto free;
+
+			k++;
+			continue;
+		}
+
+		if (order > 0)
+			split_page(page, order);
+
+		for (j = 0; j < (1UL << order); j++)
+			bo->pages[i + j] = page + j;
+
+		i += 1UL << order;
+		bo->num_pages = i;
+		bo->chunks[k]++;
+	}
+
+	bo->chunked = true;
+
+	return 0;
+
+free:
+	tegra_bo_put_chunked_pages(bo);
+	memset(bo->chunks, 0, sizeof(bo->chunks));
+	return -ENOMEM;
+}
+
 static int tegra_bo_get_pages(struct drm_device *drm, struct tegra_bo *bo)
 {
 	int err;
 
+	if (huge_pages && bo->gem.size >= SZ_64K &&
+	    tegra_bo_get_chunked_pages(bo) == 0)
+		goto map;
+
 	bo->pages = drm_gem_get_pages(&bo->gem);
 	if (IS_ERR(bo->pages))
 		return PTR_ERR(bo->pages);
 
 	bo->num_pages = bo->gem.size >> PAGE_SHIFT;
+	bo->chunks[TEGRA_BO_NUM_ORDERS - 1] = bo->num_pages;
 
+map:
 	bo->sgt = drm_prime_pages_to_sg(bo->gem.dev, bo->pages, bo->num_pages);
 	if (IS_ERR(bo->sgt)) {
 		err = PTR_ERR(bo->sgt);
@@ -365,7 +495,10 @@ free_sgt:
 	sg_free_table(bo->sgt);
 	kfree(bo->sgt);
 put_pages:
-	drm_gem_put_pages(&bo->gem, bo->pages, false, false);
+	if (bo->chunked)
+		tegra_bo_put_chunked_pages(bo);
+	else
+		drm_gem_put_pages(&bo->gem, bo->pages, false, false);
 	return err;
 }
 
@@ -621,6 +754,13 @@ int tegra_drm_mmap(struct file *file, struct vm_area_struct *vma)
 	struct drm_gem_object *gem;
 	int err;
 
+	if (vma->vm_pgoff == TEGRA_DRM_SYNCPT_SHADOW_PGOFF) {
+		struct drm_file *priv = file->private_data;
+		struct tegra_drm *tegra = priv->minor->dev->dev_private;
+
+		return host1x_syncpt_shadow_mmap(tegra_drm_to_host1x(tegra), vma);
+	}
+
 	err = drm_gem_mmap(file, vma);
 	if (err < 0)
 		return err;
@@ -15,6 +15,12 @@
 
 #define TEGRA_BO_BOTTOM_UP (1 << 0)
 
+/*
+ * Page allocation orders tried, largest first, when backing a buffer object
+ * with high-order pages: 2 MiB, 64 KiB and finally single pages.
+ */
+#define TEGRA_BO_NUM_ORDERS 3
+
 enum tegra_bo_tiling_mode {
 	TEGRA_BO_TILING_MODE_PITCH,
 	TEGRA_BO_TILING_MODE_TILED,
@@ -43,8 +49,14 @@ struct tegra_bo {
 	struct drm_mm_node *mm;
 	unsigned long num_pages;
 	struct page **pages;
+	/* pages come from the page allocator rather than shmem */
+	bool chunked;
+	/* number of chunks allocated at each of tegra_bo_orders[] */
+	unsigned long chunks[TEGRA_BO_NUM_ORDERS];
 	/* size of IOMMU mapping */
 	size_t size;
+	/* entry in tegra_drm.bos, protected by tegra_drm.mm_lock */
+	struct list_head list;
 
 	struct tegra_bo_tiling tiling;
 };
@@ -70,6 +82,7 @@ void tegra_bo_free_object(struct drm_gem_object *gem);
 int tegra_bo_dumb_create(struct drm_file *file, struct drm_device *drm,
 			 struct drm_mode_create_dumb *args);
 
+extern const unsigned int tegra_bo_orders[TEGRA_BO_NUM_ORDERS];
 extern const struct vm_operations_struct tegra_bo_vm_ops;
 
 int __tegra_gem_mmap(struct drm_gem_object *gem, struct vm_area_struct *vma);
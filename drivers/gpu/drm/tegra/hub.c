@@ -531,6 +531,50 @@ static inline u32 compute_phase_incr(fixed20_12 in, unsigned int out)
 	return lower_32_bits(tmp1);
 }
 
+static void tegra_shared_plane_set_address(struct tegra_plane *p,
+					   struct drm_plane_state *state)
+{
+	struct tegra_plane_state *tegra_plane_state = to_tegra_plane_state(state);
+	struct drm_framebuffer *fb = state->fb;
+	dma_addr_t base, addr_flag = 0;
+	unsigned int bpc, planes;
+	bool yuv;
+
+#ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
+	/*
+	 * Physical address bit 39 in Tegra194 is used as a switch for special
+	 * logic that swizzles the memory using either the legacy Tegra or the
+	 * dGPU sector layout.
+	 */
+	if (tegra_plane_state->tiling.sector_layout == TEGRA_BO_SECTOR_LAYOUT_GPU)
+		addr_flag = BIT_ULL(39);
+#endif
+
+	yuv = tegra_plane_format_is_yuv(tegra_plane_state->format, &planes, &bpc);
+
+	base = tegra_plane_state->iova[0] + fb->offsets[0];
+	base |= addr_flag;
+
+	tegra_plane_writel(p, upper_32_bits(base), DC_WINBUF_START_ADDR_HI);
+	tegra_plane_writel(p, lower_32_bits(base), DC_WINBUF_START_ADDR);
+
+	if (yuv && planes > 1) {
+		base = tegra_plane_state->iova[1] + fb->offsets[1];
+		base |= addr_flag;
+
+		tegra_plane_writel(p, upper_32_bits(base), DC_WINBUF_START_ADDR_HI_U);
+		tegra_plane_writel(p, lower_32_bits(base), DC_WINBUF_START_ADDR_U);
+
+		if (planes > 2) {
+			base = tegra_plane_state->iova[2] + fb->offsets[2];
+			base |= addr_flag;
+
+			tegra_plane_writel(p, upper_32_bits(base), DC_WINBUF_START_ADDR_HI_V);
+			tegra_plane_writel(p, lower_32_bits(base), DC_WINBUF_START_ADDR_V);
+		}
+	}
+}
+
 static void tegra_shared_plane_atomic_update(struct drm_plane *plane,
 					     struct drm_atomic_state *state)
 {
@@ -540,9 +584,10 @@ static void tegra_shared_plane_atomic_update(struct drm_plane *plane,
 	struct tegra_dc *dc = to_tegra_dc(new_state->crtc);
 	unsigned int zpos = new_state->normalized_zpos;
 	struct drm_framebuffer *fb = new_state->fb;
+	struct drm_plane_state *old_state = drm_atomic_get_old_plane_state(state,
+									   plane);
 	struct tegra_plane *p = to_tegra_plane(plane);
 	u32 value, min_width, bypass = 0;
-	dma_addr_t base, addr_flag = 0;
 	unsigned int bpc, planes;
 	bool yuv;
 	int err;
@@ -562,6 +607,19 @@ static void tegra_shared_plane_atomic_update(struct drm_plane *plane,
 		return;
 	}
 
+	/*
+	 * If the window is already scanning out from this head with the same
+	 * geometry, only the framebuffer address changes. Skip reprogramming
+	 * ownership, blending, scaling and the rest of the window setup.
+	 */
+	if (p->dc == dc && tegra_dc_owns_shared_plane(dc, p) &&
+	    tegra_plane_geometry_unchanged(old_state, new_state)) {
+		tegra_plane_writel(p, VCOUNTER, DC_WIN_CORE_ACT_CONTROL);
+		tegra_shared_plane_set_address(p, new_state);
+		host1x_client_suspend(&dc->client);
+		return;
+	}
+
 	yuv = tegra_plane_format_is_yuv(tegra_plane_state->format, &planes, &bpc);
 
 	tegra_dc_assign_shared_plane(dc, p);
@@ -628,19 +686,6 @@ static void tegra_shared_plane_atomic_update(struct drm_plane *plane,
 	/* disable compression */
 	tegra_plane_writel(p, 0, DC_WINBUF_CDE_CONTROL);
 
-#ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
-	/*
-	 * Physical address bit 39 in Tegra194 is used as a switch for special
-	 * logic that swizzles the memory using either the legacy Tegra or the
-	 * dGPU sector layout.
-	 */
-	if (tegra_plane_state->tiling.sector_layout == TEGRA_BO_SECTOR_LAYOUT_GPU)
-		addr_flag = BIT_ULL(39);
-#endif
-
-	base = tegra_plane_state->iova[0] + fb->offsets[0];
-	base |= addr_flag;
-
 	tegra_plane_writel(p, tegra_plane_state->format, DC_WIN_COLOR_DEPTH);
 	tegra_plane_writel(p, 0, DC_WIN_PRECOMP_WGRP_PARAMS);
 
@@ -657,27 +702,12 @@ static void tegra_shared_plane_atomic_update(struct drm_plane *plane,
 	value = V_SIZE(new_state->src_h >> 16) | H_SIZE(new_state->src_w >> 16);
 	tegra_plane_writel(p, value, DC_WIN_CROPPED_SIZE);
 
-	tegra_plane_writel(p, upper_32_bits(base), DC_WINBUF_START_ADDR_HI);
-	tegra_plane_writel(p, lower_32_bits(base), DC_WINBUF_START_ADDR);
+	tegra_shared_plane_set_address(p, new_state);
 
 	value = PITCH(fb->pitches[0]);
 	tegra_plane_writel(p, value, DC_WIN_PLANAR_STORAGE);
 
 	if (yuv && planes > 1) {
-		base = tegra_plane_state->iova[1] + fb->offsets[1];
-		base |= addr_flag;
-
-		tegra_plane_writel(p, upper_32_bits(base), DC_WINBUF_START_ADDR_HI_U);
-		tegra_plane_writel(p, lower_32_bits(base), DC_WINBUF_START_ADDR_U);
-
-		if (planes > 2) {
-			base = tegra_plane_state->iova[2] + fb->offsets[2];
-			base |= addr_flag;
-
-			tegra_plane_writel(p, upper_32_bits(base), DC_WINBUF_START_ADDR_HI_V);
-			tegra_plane_writel(p, lower_32_bits(base), DC_WINBUF_START_ADDR_V);
-		}
-
 		value = PITCH_U(fb->pitches[1]);
 
 		if (planes > 2)
@@ -745,12 +775,96 @@ static void tegra_shared_plane_atomic_update(struct drm_plane *plane,
 	host1x_client_suspend(&dc->client);
 }
 
+static int tegra_shared_plane_atomic_async_check(struct drm_plane *plane,
+						 struct drm_atomic_state *state)
+{
+	struct drm_plane_state *new_state = drm_atomic_get_new_plane_state(state, plane);
+	struct tegra_plane *p = to_tegra_plane(plane);
+	struct drm_crtc_state *crtc_state;
+
+	crtc_state = drm_atomic_get_existing_crtc_state(state, new_state->crtc);
+	if (WARN_ON(!crtc_state))
+		return -EINVAL;
+
+	if (!crtc_state->active || !new_state->visible)
+		return -EINVAL;
+
+	if (p->dc != to_tegra_dc(new_state->crtc))
+		return -EINVAL;
+
+	if (!tegra_plane_geometry_unchanged(plane->state, new_state))
+		return -EINVAL;
+
+	return 0;
+}
+
+static void tegra_shared_plane_atomic_async_update(struct drm_plane *plane,
+						   struct drm_atomic_state *state)
+{
+	struct drm_plane_state *new_state = drm_atomic_get_new_plane_state(state, plane);
+	struct tegra_plane_state *new = to_tegra_plane_state(new_state);
+	struct tegra_plane_state *cur = to_tegra_plane_state(plane->state);
+	struct tegra_dc *dc = to_tegra_dc(new_state->crtc);
+	struct tegra_plane *p = to_tegra_plane(plane);
+	struct drm_crtc_state *crtc_state;
+	unsigned long flags;
+	unsigned int i;
+	u32 value;
+	int err;
+
+	/*
+	 * Swap the framebuffer and its pinned mappings into the current state
+	 * so that the old framebuffer is released when the new state is
+	 * cleaned up.
+	 */
+	swap(plane->state->fb, new_state->fb);
+
+	for (i = 0; i < 3; i++) {
+		swap(cur->map[i], new->map[i]);
+		swap(cur->iova[i], new->iova[i]);
+	}
+
+	err = host1x_client_resume(&dc->client);
+	if (err < 0) {
+		dev_err(dc->dev, "failed to resume: %d\n", err);
+		return;
+	}
+
+	/* latch the new address on the next line rather than at vblank */
+	tegra_plane_writel(p, HCOUNTER, DC_WIN_CORE_ACT_CONTROL);
+	tegra_shared_plane_set_address(p, plane->state);
+
+	value = (WIN_A_ACT_REQ << p->index) << 8 | GENERAL_UPDATE;
+	tegra_dc_writel(dc, value, DC_CMD_STATE_CONTROL);
+	(void)tegra_dc_readl(dc, DC_CMD_STATE_CONTROL);
+
+	value = (WIN_A_ACT_REQ << p->index) | GENERAL_ACT_REQ;
+	tegra_dc_writel(dc, value, DC_CMD_STATE_CONTROL);
+	(void)tegra_dc_readl(dc, DC_CMD_STATE_CONTROL);
+
+	host1x_client_suspend(&dc->client);
+
+	/*
+	 * Asynchronous commits don't go through the CRTC, so complete any
+	 * pending page-flip event here since the flip is already visible.
+	 */
+	crtc_state = drm_atomic_get_new_crtc_state(state, new_state->crtc);
+	if (crtc_state && crtc_state->event) {
+		spin_lock_irqsave(&dc->base.dev->event_lock, flags);
+		drm_crtc_send_vblank_event(&dc->base, crtc_state->event);
+		spin_unlock_irqrestore(&dc->base.dev->event_lock, flags);
+		crtc_state->event = NULL;
+	}
+}
+
 static const struct drm_plane_helper_funcs tegra_shared_plane_helper_funcs = {
 	.prepare_fb = tegra_plane_prepare_fb,
 	.cleanup_fb = tegra_plane_cleanup_fb,
 	.atomic_check = tegra_shared_plane_atomic_check,
 	.atomic_update = tegra_shared_plane_atomic_update,
 	.atomic_disable = tegra_shared_plane_atomic_disable,
+	.atomic_async_check = tegra_shared_plane_atomic_async_check,
+	.atomic_async_update = tegra_shared_plane_atomic_async_update,
 };
 
 struct drm_plane *tegra_shared_plane_create(struct drm_device *drm,
@@ -952,6 +1066,9 @@ static int tegra_display_hub_init(struct host1x_client *client)
 
 	tegra->hub = hub;
 
+	/* windows support address-only flips, see ->atomic_async_update() */
+	drm->mode_config.async_page_flip = true;
+
 	return 0;
 }
 
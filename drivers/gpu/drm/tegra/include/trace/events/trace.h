@@ -126,6 +126,23 @@ TRACE_EVENT(job_timestamps,
 	)
 );
 
+TRACE_EVENT(falcon_boot,
+	TP_PROTO(struct device *dev, u64 duration_us, bool shared),
+	TP_ARGS(dev, duration_us, shared),
+	TP_STRUCT__entry(
+		__field(struct device *, dev)
+		__field(u64, duration_us)
+		__field(bool, shared)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->duration_us = duration_us;
+		__entry->shared = shared;
+	),
+	TP_printk("%s duration_us=%llu shared=%d", dev_name(__entry->dev),
+		  __entry->duration_us, __entry->shared)
+);
+
 #endif /* DRM_TEGRA_TRACE_H */
 
 /* This part must be outside protection */
@@ -1007,6 +1007,229 @@ struct drm_tegra_channel_submit {
 	__u32 secondary_syncpt_id;
 };
 
+#define DRM_TEGRA_SUBMIT_BATCH_CHAIN		(1<<0)
+
+#define DRM_TEGRA_SUBMIT_BATCH_MAX_JOBS		64
+
+struct drm_tegra_channel_submit_batch {
+	/**
+	 * @context: [in]
+	 *
+	 * Identifier of the channel to submit the jobs to. The context field
+	 * of every job in the batch must match.
+	 */
+	__u32 context;
+
+	/**
+	 * @num_jobs: [in]
+	 *
+	 * Number of jobs in the batch, at most DRM_TEGRA_SUBMIT_BATCH_MAX_JOBS.
+	 */
+	__u32 num_jobs;
+
+	/**
+	 * @jobs_ptr: [in]
+	 *
+	 * Pointer to an array of num_jobs drm_tegra_channel_submit structures.
+	 * The syncpt.value field of each submitted job is written back.
+	 */
+	__u64 jobs_ptr;
+
+	/**
+	 * @flags: [in]
+	 *
+	 * DRM_TEGRA_SUBMIT_BATCH_CHAIN: make each job wait in hardware for
+	 *   the syncpoint threshold of the previous job in the batch.
+	 */
+	__u32 flags;
+
+	/**
+	 * @num_submitted: [out]
+	 *
+	 * Number of jobs that were submitted. Jobs are submitted in order, so
+	 * on error the jobs from this index on were not.
+	 */
+	__u32 num_submitted;
+
+	__u64 reserved;
+};
+
+#define DRM_TEGRA_SUBMIT_TEMPLATE_MAX_RELOCS	256
+
+struct drm_tegra_channel_create_template {
+	/**
+	 * @context: [in]
+	 *
+	 * Identifier of the channel the template is created for.
+	 */
+	__u32 context;
+
+	/**
+	 * @num_bufs: [in]
+	 *
+	 * Number of relocations in the template, at most
+	 * DRM_TEGRA_SUBMIT_TEMPLATE_MAX_RELOCS.
+	 */
+	__u32 num_bufs;
+
+	/**
+	 * @num_cmds: [in]
+	 *
+	 * Number of commands in the template.
+	 */
+	__u32 num_cmds;
+
+	/**
+	 * @gather_data_words: [in]
+	 *
+	 * Number of 32-bit words in the gather data.
+	 */
+	__u32 gather_data_words;
+
+	/**
+	 * @bufs_ptr: [in]
+	 *
+	 * Pointer to an array of drm_tegra_submit_buf structures, as for
+	 * DRM_IOCTL_TEGRA_CHANNEL_SUBMIT. The mappings given here are used to
+	 * validate the template and are kept referenced until it is destroyed.
+	 * Each relocation must point at a word that is written to a register.
+	 */
+	__u64 bufs_ptr;
+
+	/**
+	 * @cmds_ptr: [in]
+	 *
+	 * Pointer to an array of drm_tegra_submit_cmd structures.
+	 */
+	__u64 cmds_ptr;
+
+	/**
+	 * @gather_data_ptr: [in]
+	 *
+	 * Pointer to an array of Host1x opcodes to be used by GATHER_UPTR
+	 * commands.
+	 */
+	__u64 gather_data_ptr;
+
+	/**
+	 * @id: [out]
+	 *
+	 * Identifier of the template, valid until it is destroyed or the
+	 * channel is closed.
+	 */
+	__u32 id;
+
+	__u32 padding;
+};
+
+struct drm_tegra_submit_template_reloc {
+	/**
+	 * @mapping: [in]
+	 *
+	 * Identifier of the mapping to use for the relocation.
+	 */
+	__u32 mapping;
+
+	__u32 padding;
+
+	/**
+	 * @target_offset: [in]
+	 *
+	 * Offset from the start of the mapping of the data whose
+	 * address is written into the gather data.
+	 */
+	__u64 target_offset;
+};
+
+struct drm_tegra_channel_submit_template {
+	/**
+	 * @context: [in]
+	 *
+	 * Identifier of the channel to submit the job to.
+	 */
+	__u32 context;
+
+	/**
+	 * @id: [in]
+	 *
+	 * Identifier of the template to submit.
+	 */
+	__u32 id;
+
+	/**
+	 * @num_relocs: [in]
+	 *
+	 * Number of entries in the relocs array, must match the num_bufs
+	 * value the template was created with.
+	 */
+	__u32 num_relocs;
+
+	/**
+	 * @syncobj_in: [in]
+	 *
+	 * Handle for DRM syncobj that will be waited before submission.
+	 * Ignored if zero.
+	 */
+	__u32 syncobj_in;
+
+	/**
+	 * @relocs_ptr: [in]
+	 *
+	 * Pointer to an array of drm_tegra_submit_template_reloc structures,
+	 * one per relocation of the template and in the same order. Only the
+	 * surface addresses change; gather offsets, shifts and flags are the
+	 * ones the template was created with.
+	 */
+	__u64 relocs_ptr;
+
+	/**
+	 * @syncobj_out: [in]
+	 *
+	 * Handle for DRM syncobj that will have its fence replaced with
+	 * the job's completion fence. Ignored if zero.
+	 */
+	__u32 syncobj_out;
+
+	/**
+	 * @flags: [in]
+	 *
+	 * Same as the flags of DRM_IOCTL_TEGRA_CHANNEL_SUBMIT.
+	 */
+	__u32 flags;
+
+	/**
+	 * @syncpt: [in,out]
+	 *
+	 * Information about the syncpoint the job will increment.
+	 */
+	struct drm_tegra_submit_syncpt syncpt;
+
+	/**
+	 * @secondary_syncpt_id: [in]
+	 *
+	 * Secondary syncpoint the job may increment, not used for job tracking.
+	 */
+	__u32 secondary_syncpt_id;
+
+	__u32 padding;
+};
+
+struct drm_tegra_channel_destroy_template {
+	/**
+	 * @context: [in]
+	 *
+	 * Identifier of the channel the template was created for.
+	 */
+	__u32 context;
+
+	/**
+	 * @id: [in]
+	 *
+	 * Identifier of the template to destroy.
+	 */
+	__u32 id;
+};
+
 struct drm_tegra_syncpoint_allocate {
 	/**
 	 * @id: [out]
@@ -1066,15 +1289,50 @@ struct drm_tegra_syncpoint_wait {
 	__u64 timestamp;
 };
 
+struct drm_tegra_syncpoint_shadow {
+	/**
+	 * @offset: [out]
+	 *
+	 * Offset to pass to mmap() on the DRM device file to map the
+	 * syncpoint shadow table. The mapping must be read-only.
+	 */
+	__u64 offset;
+
+	/**
+	 * @size: [out]
+	 *
+	 * Size of the shadow table in bytes.
+	 */
+	__u32 size;
+
+	/**
+	 * @num_syncpts: [out]
+	 *
+	 * Number of 32-bit entries in the table, indexed by syncpoint ID.
+	 *
+	 * An entry is updated whenever the kernel reads the syncpoint, which
+	 * includes every fence interrupt, so it never exceeds the hardware
+	 * value and is current once a job or wait on the syncpoint completed.
+	 * A threshold found reached in the table is therefore reached; if it
+	 * is not, fall back to DRM_IOCTL_TEGRA_SYNCPOINT_WAIT.
+	 */
+	__u32 num_syncpts;
+};
+
 #define DRM_IOCTL_TEGRA_CHANNEL_OPEN DRM_IOWR(DRM_COMMAND_BASE + 0x10, struct drm_tegra_channel_open)
 #define DRM_IOCTL_TEGRA_CHANNEL_CLOSE DRM_IOWR(DRM_COMMAND_BASE + 0x11, struct drm_tegra_channel_close)
 #define DRM_IOCTL_TEGRA_CHANNEL_MAP DRM_IOWR(DRM_COMMAND_BASE + 0x12, struct drm_tegra_channel_map)
 #define DRM_IOCTL_TEGRA_CHANNEL_UNMAP DRM_IOWR(DRM_COMMAND_BASE + 0x13, struct drm_tegra_channel_unmap)
 #define DRM_IOCTL_TEGRA_CHANNEL_SUBMIT DRM_IOWR(DRM_COMMAND_BASE + 0x14, struct drm_tegra_channel_submit)
+#define DRM_IOCTL_TEGRA_CHANNEL_SUBMIT_BATCH DRM_IOWR(DRM_COMMAND_BASE + 0x15, struct drm_tegra_channel_submit_batch)
+#define DRM_IOCTL_TEGRA_CHANNEL_CREATE_TEMPLATE DRM_IOWR(DRM_COMMAND_BASE + 0x16, struct drm_tegra_channel_create_template)
+#define DRM_IOCTL_TEGRA_CHANNEL_SUBMIT_TEMPLATE DRM_IOWR(DRM_COMMAND_BASE + 0x17, struct drm_tegra_channel_submit_template)
+#define DRM_IOCTL_TEGRA_CHANNEL_DESTROY_TEMPLATE DRM_IOWR(DRM_COMMAND_BASE + 0x18, struct drm_tegra_channel_destroy_template)
 
 #define DRM_IOCTL_TEGRA_SYNCPOINT_ALLOCATE DRM_IOWR(DRM_COMMAND_BASE + 0x20, struct drm_tegra_syncpoint_allocate)
 #define DRM_IOCTL_TEGRA_SYNCPOINT_FREE DRM_IOWR(DRM_COMMAND_BASE + 0x21, struct drm_tegra_syncpoint_free)
 #define DRM_IOCTL_TEGRA_SYNCPOINT_WAIT DRM_IOWR(DRM_COMMAND_BASE + 0x22, struct drm_tegra_syncpoint_wait)
+#define DRM_IOCTL_TEGRA_SYNCPOINT_SHADOW DRM_IOR(DRM_COMMAND_BASE + 0x23, struct drm_tegra_syncpoint_shadow)
 
 #if defined(__cplusplus)
 }
@@ -226,6 +226,12 @@ release_reset:
 	return err;
 }
 
+/* inverse of the EMC bandwidth estimate in nvdec_set_rate() */
+static unsigned long nvdec_devfreq_bw_to_freq(struct devfreq *devfreq, u32 kbps)
+{
+	return div_u64((u64)kbps * 1024, NVDEC_AXI_RW_BANDWIDTH);
+}
+
 static void nvdec_devfreq_update_wmark_threshold(struct devfreq *devfreq,
 						 struct devfreq_tegra_wmark_config *cfg)
 {
@@ -305,6 +311,7 @@ static int nvdec_devfreq_init(struct nvdec *nvdec)
 
 	data->event = DEVFREQ_TEGRA_AVG_WMARK_BELOW;
 	data->update_wmark_threshold = nvdec_devfreq_update_wmark_threshold;
+	data->bw_to_freq = nvdec_devfreq_bw_to_freq;
 
 	devfreq_profile = devm_kzalloc(nvdec->dev, sizeof(*devfreq_profile), GFP_KERNEL);
 	if (!devfreq_profile)
@@ -373,6 +380,10 @@ static int nvdec_init(struct host1x_client *client)
 	 */
 	client->dev->dma_parms = client->host->dma_parms;
 
+	/* fetch the firmware in the background, it is loaded on first resume */
+	if (!nvdec->config->has_riscv)
+		falcon_request_firmware(&nvdec->falcon, nvdec->config->firmware);
+
 	return 0;
 
 free_syncpt:
@@ -410,11 +421,7 @@ static int nvdec_exit(struct host1x_client *client)
 	nvdec->channel = NULL;
 
 	if (client->group) {
-		dma_unmap_single(nvdec->dev, nvdec->falcon.firmware.phys,
-				 nvdec->falcon.firmware.size, DMA_TO_DEVICE);
-		tegra_drm_free(tegra, nvdec->falcon.firmware.size,
-			       nvdec->falcon.firmware.virt,
-			       nvdec->falcon.firmware.iova);
+		falcon_put_shared_firmware(&nvdec->falcon);
 	} else {
 		dma_free_coherent(nvdec->dev, nvdec->falcon.firmware.size,
 				  nvdec->falcon.firmware.virt,
@@ -486,21 +493,22 @@ static int nvdec_load_falcon_firmware(struct nvdec *nvdec)
 	if (nvdec->falcon.firmware.virt)
 		return 0;
 
+	/* all instances boot from one copy in the shared domain */
+	if (client->group)
+		return falcon_get_shared_firmware(&nvdec->falcon, tegra,
+						  nvdec->config->firmware);
+
 	err = falcon_read_firmware(&nvdec->falcon, nvdec->config->firmware);
 	if (err < 0)
 		return err;
 
 	size = nvdec->falcon.firmware.size;
 
-	if (!client->group) {
-		virt = dma_alloc_coherent(nvdec->dev, size, &iova, GFP_KERNEL);
+	virt = dma_alloc_coherent(nvdec->dev, size, &iova, GFP_KERNEL);
 
-		err = dma_mapping_error(nvdec->dev, iova);
-		if (err < 0)
-			return err;
-	} else {
-		virt = tegra_drm_alloc(tegra, size, &iova);
-	}
+	err = dma_mapping_error(nvdec->dev, iova);
+	if (err < 0)
+		return err;
 
 	nvdec->falcon.firmware.virt = virt;
 	nvdec->falcon.firmware.iova = iova;
@@ -509,30 +517,10 @@ static int nvdec_load_falcon_firmware(struct nvdec *nvdec)
 	if (err < 0)
 		goto cleanup;
 
-	/*
-	 * In this case we have received an IOVA from the shared domain, so we
-	 * need to make sure to get the physical address so that the DMA API
-	 * knows what memory pages to flush the cache for.
-	 */
-	if (client->group) {
-		dma_addr_t phys;
-
-		phys = dma_map_single(nvdec->dev, virt, size, DMA_TO_DEVICE);
-
-		err = dma_mapping_error(nvdec->dev, phys);
-		if (err < 0)
-			goto cleanup;
-
-		nvdec->falcon.firmware.phys = phys;
-	}
-
 	return 0;
 
 cleanup:
-	if (!client->group)
-		dma_free_coherent(nvdec->dev, size, virt, iova);
-	else
-		tegra_drm_free(tegra, size, virt, iova);
+	dma_free_coherent(nvdec->dev, size, virt, iova);
 
 	return err;
 }
@@ -119,6 +119,12 @@ static int nvenc_boot(struct nvenc *nvenc)
 	return 0;
 }
 
+/* inverse of the EMC bandwidth estimate in nvenc_set_rate() */
+static unsigned long nvenc_devfreq_bw_to_freq(struct devfreq *devfreq, u32 kbps)
+{
+	return div_u64((u64)kbps * 1024, NVENC_AXI_RW_BANDWIDTH);
+}
+
 static void nvenc_devfreq_update_wmark_threshold(struct devfreq *devfreq,
 						 struct devfreq_tegra_wmark_config *cfg)
 {
@@ -197,6 +203,7 @@ static int nvenc_devfreq_init(struct nvenc *nvenc)
 
 	data->event = DEVFREQ_TEGRA_AVG_WMARK_BELOW;
 	data->update_wmark_threshold = nvenc_devfreq_update_wmark_threshold;
+	data->bw_to_freq = nvenc_devfreq_bw_to_freq;
 
 	devfreq_profile = devm_kzalloc(nvenc->dev, sizeof(*devfreq_profile), GFP_KERNEL);
 	if (!devfreq_profile)
@@ -265,6 +272,9 @@ static int nvenc_init(struct host1x_client *client)
 	 */
 	client->dev->dma_parms = client->host->dma_parms;
 
+	/* fetch the firmware in the background, it is loaded on first resume */
+	falcon_request_firmware(&nvenc->falcon, nvenc->config->firmware);
+
 	return 0;
 
 free_syncpt:
@@ -302,11 +312,7 @@ static int nvenc_exit(struct host1x_client *client)
 	nvenc->channel = NULL;
 
 	if (client->group) {
-		dma_unmap_single(nvenc->dev, nvenc->falcon.firmware.phys,
-				 nvenc->falcon.firmware.size, DMA_TO_DEVICE);
-		tegra_drm_free(tegra, nvenc->falcon.firmware.size,
-			       nvenc->falcon.firmware.virt,
-			       nvenc->falcon.firmware.iova);
+		falcon_put_shared_firmware(&nvenc->falcon);
 	} else {
 		dma_free_coherent(nvenc->dev, nvenc->falcon.firmware.size,
 				  nvenc->falcon.firmware.virt,
@@ -378,21 +384,22 @@ static int nvenc_load_firmware(struct nvenc *nvenc)
 	if (nvenc->falcon.firmware.virt)
 		return 0;
 
+	/* all instances boot from one copy in the shared domain */
+	if (client->group)
+		return falcon_get_shared_firmware(&nvenc->falcon, tegra,
+						  nvenc->config->firmware);
+
 	err = falcon_read_firmware(&nvenc->falcon, nvenc->config->firmware);
 	if (err < 0)
 		return err;
 
 	size = nvenc->falcon.firmware.size;
 
-	if (!client->group) {
-		virt = dma_alloc_coherent(nvenc->dev, size, &iova, GFP_KERNEL);
+	virt = dma_alloc_coherent(nvenc->dev, size, &iova, GFP_KERNEL);
 
-		err = dma_mapping_error(nvenc->dev, iova);
-		if (err < 0)
-			return err;
-	} else {
-		virt = tegra_drm_alloc(tegra, size, &iova);
-	}
+	err = dma_mapping_error(nvenc->dev, iova);
+	if (err < 0)
+		return err;
 
 	nvenc->falcon.firmware.virt = virt;
 	nvenc->falcon.firmware.iova = iova;
@@ -401,30 +408,10 @@ static int nvenc_load_firmware(struct nvenc *nvenc)
 	if (err < 0)
 		goto cleanup;
 
-	/*
-	 * In this case we have received an IOVA from the shared domain, so we
-	 * need to make sure to get the physical address so that the DMA API
-	 * knows what memory pages to flush the cache for.
-	 */
-	if (client->group) {
-		dma_addr_t phys;
-
-		phys = dma_map_single(nvenc->dev, virt, size, DMA_TO_DEVICE);
-
-		err = dma_mapping_error(nvenc->dev, phys);
-		if (err < 0)
-			goto cleanup;
-
-		nvenc->falcon.firmware.phys = phys;
-	}
-
 	return 0;
 
 cleanup:
-	if (!client->group)
-		dma_free_coherent(nvenc->dev, size, virt, iova);
-	else
-		tegra_drm_free(tegra, size, virt, iova);
+	dma_free_coherent(nvenc->dev, size, virt, iova);
 
 	return err;
 }
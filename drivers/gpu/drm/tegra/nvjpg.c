@@ -116,6 +116,12 @@ static int nvjpg_boot(struct nvjpg *nvjpg)
 	return 0;
 }
 
+/* inverse of the EMC bandwidth estimate in nvjpg_set_rate() */
+static unsigned long nvjpg_devfreq_bw_to_freq(struct devfreq *devfreq, u32 kbps)
+{
+	return div_u64((u64)kbps * 1024, NVJPG_AXI_RW_BANDWIDTH);
+}
+
 static void nvjpg_devfreq_update_wmark_threshold(struct devfreq *devfreq,
 						 struct devfreq_tegra_wmark_config *cfg)
 {
@@ -194,6 +200,7 @@ static int nvjpg_devfreq_init(struct nvjpg *nvjpg)
 
 	data->event = DEVFREQ_TEGRA_AVG_WMARK_BELOW;
 	data->update_wmark_threshold = nvjpg_devfreq_update_wmark_threshold;
+	data->bw_to_freq = nvjpg_devfreq_bw_to_freq;
 
 	devfreq_profile = devm_kzalloc(nvjpg->dev, sizeof(*devfreq_profile), GFP_KERNEL);
 	if (!devfreq_profile)
@@ -262,6 +269,9 @@ static int nvjpg_init(struct host1x_client *client)
 	 */
 	client->dev->dma_parms = client->host->dma_parms;
 
+	/* fetch the firmware in the background, it is loaded on first resume */
+	falcon_request_firmware(&nvjpg->falcon, nvjpg->config->firmware);
+
 	return 0;
 
 free_syncpt:
@@ -299,11 +309,7 @@ static int nvjpg_exit(struct host1x_client *client)
 	nvjpg->channel = NULL;
 
 	if (client->group) {
-		dma_unmap_single(nvjpg->dev, nvjpg->falcon.firmware.phys,
-				 nvjpg->falcon.firmware.size, DMA_TO_DEVICE);
-		tegra_drm_free(tegra, nvjpg->falcon.firmware.size,
-			       nvjpg->falcon.firmware.virt,
-			       nvjpg->falcon.firmware.iova);
+		falcon_put_shared_firmware(&nvjpg->falcon);
 	} else {
 		dma_free_coherent(nvjpg->dev, nvjpg->falcon.firmware.size,
 				  nvjpg->falcon.firmware.virt,
@@ -375,21 +381,22 @@ static int nvjpg_load_firmware(struct nvjpg *nvjpg)
 	if (nvjpg->falcon.firmware.virt)
 		return 0;
 
+	/* all instances boot from one copy in the shared domain */
+	if (client->group)
+		return falcon_get_shared_firmware(&nvjpg->falcon, tegra,
+						  nvjpg->config->firmware);
+
 	err = falcon_read_firmware(&nvjpg->falcon, nvjpg->config->firmware);
 	if (err < 0)
 		return err;
 
 	size = nvjpg->falcon.firmware.size;
 
-	if (!client->group) {
-		virt = dma_alloc_coherent(nvjpg->dev, size, &iova, GFP_KERNEL);
+	virt = dma_alloc_coherent(nvjpg->dev, size, &iova, GFP_KERNEL);
 
-		err = dma_mapping_error(nvjpg->dev, iova);
-		if (err < 0)
-			return err;
-	} else {
-		virt = tegra_drm_alloc(tegra, size, &iova);
-	}
+	err = dma_mapping_error(nvjpg->dev, iova);
+	if (err < 0)
+		return err;
 
 	nvjpg->falcon.firmware.virt = virt;
 	nvjpg->falcon.firmware.iova = iova;
@@ -398,30 +405,10 @@ static int nvjpg_load_firmware(struct nvjpg *nvjpg)
 	if (err < 0)
 		goto cleanup;
 
-	/*
-	 * In this case we have received an IOVA from the shared domain, so we
-	 * need to make sure to get the physical address so that the DMA API
-	 * knows what memory pages to flush the cache for.
-	 */
-	if (client->group) {
-		dma_addr_t phys;
-
-		phys = dma_map_single(nvjpg->dev, virt, size, DMA_TO_DEVICE);
-
-		err = dma_mapping_error(nvjpg->dev, phys);
-		if (err < 0)
-			goto cleanup;
-
-		nvjpg->falcon.firmware.phys = phys;
-	}
-
 	return 0;
 
 cleanup:
-	if (!client->group)
-		dma_free_coherent(nvjpg->dev, size, virt, iova);
-	else
-		tegra_drm_free(tegra, size, virt, iova);
+	dma_free_coherent(nvjpg->dev, size, virt, iova);
 
 	return err;
 }
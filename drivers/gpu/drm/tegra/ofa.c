@@ -237,6 +237,9 @@ static int ofa_init(struct host1x_client *client)
 	 */
 	client->dev->dma_parms = client->host->dma_parms;
 
+	/* fetch the firmware in the background, it is loaded on first resume */
+	falcon_request_firmware(&ofa->falcon, ofa->config->firmware);
+
 	return 0;
 
 free_syncpt:
@@ -300,9 +300,49 @@ static int tegra_plane_calculate_memory_bandwidth(struct drm_plane_state *state)
 	return 0;
 }
 
+/*
+ * Returns true if the only difference between the two plane states is the
+ * framebuffer memory being scanned out, i.e. the new state can be applied by
+ * reprogramming the window address registers alone.
+ */
+bool tegra_plane_geometry_unchanged(const struct drm_plane_state *old,
+				    const struct drm_plane_state *new)
+{
+	const struct tegra_plane_state *old_state = to_const_tegra_plane_state(old);
+	const struct tegra_plane_state *new_state = to_const_tegra_plane_state(new);
+	unsigned int i;
+
+	if (!old || !old->crtc || !old->fb || !new->fb)
+		return false;
+
+	if (old->crtc != new->crtc || old->visible != new->visible)
+		return false;
+
+	if (old->fb->format != new->fb->format ||
+	    old->fb->modifier != new->fb->modifier)
+		return false;
+
+	if (old->src_x != new->src_x || old->src_y != new->src_y ||
+	    old->src_w != new->src_w || old->src_h != new->src_h ||
+	    old->crtc_x != new->crtc_x || old->crtc_y != new->crtc_y ||
+	    old->crtc_w != new->crtc_w || old->crtc_h != new->crtc_h ||
+	    old->rotation != new->rotation ||
+	    old->normalized_zpos != new->normalized_zpos)
+		return false;
+
+	for (i = 0; i < new->fb->format->num_planes; i++)
+		if (old->fb->pitches[i] != new->fb->pitches[i] ||
+		    old->fb->offsets[i] != new->fb->offsets[i])
+			return false;
+
+	return memcmp(&old_state->tiling, &new_state->tiling,
+		      sizeof(new_state->tiling)) == 0;
+}
+
 int tegra_plane_state_add(struct tegra_plane *plane,
 			  struct drm_plane_state *state)
 {
+	struct drm_plane_state *old_state;
 	struct drm_crtc_state *crtc_state;
 	struct tegra_dc_state *tegra;
 	int err;
@@ -318,9 +358,19 @@ int tegra_plane_state_add(struct tegra_plane *plane,
 	if (err < 0)
 		return err;
 
-	err = tegra_plane_calculate_memory_bandwidth(state);
-	if (err < 0)
-		return err;
+	/*
+	 * The memory bandwidth only depends on the plane geometry, format and
+	 * display mode. Flipping to a new framebuffer with the same layout can
+	 * keep the values carried over by ->atomic_duplicate_state().
+	 */
+	old_state = drm_atomic_get_old_plane_state(state->state, &plane->base);
+
+	if (drm_atomic_crtc_needs_modeset(crtc_state) ||
+	    !tegra_plane_geometry_unchanged(old_state, state)) {
+		err = tegra_plane_calculate_memory_bandwidth(state);
+		if (err < 0)
+			return err;
+	}
 
 	tegra = to_dc_state(crtc_state);
 
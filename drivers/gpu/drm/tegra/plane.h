@@ -85,6 +85,8 @@ int tegra_plane_prepare_fb(struct drm_plane *plane,
 void tegra_plane_cleanup_fb(struct drm_plane *plane,
 			    struct drm_plane_state *state);
 
+bool tegra_plane_geometry_unchanged(const struct drm_plane_state *old,
+				    const struct drm_plane_state *new);
 int tegra_plane_state_add(struct tegra_plane *plane,
 			  struct drm_plane_state *state);
 
@@ -7,8 +7,10 @@
 
 #include <linux/clk.h>
 #include <linux/clk-provider.h>
+#include <linux/crc32.h>
 #include <linux/debugfs.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
@@ -439,6 +441,11 @@ struct tegra_sor {
 	struct drm_dp_link link;
 	struct drm_dp_aux *aux;
 
+	/* time-to-display of the last DP enable, and of the first after resume */
+	ktime_t resume_time;
+	unsigned int enable_us;
+	unsigned int resume_us;
+
 	struct drm_info_list *debugfs_files;
 
 	const struct tegra_sor_ops *ops;
@@ -1689,9 +1696,33 @@ unlock:
 	return err;
 }
 
+static int tegra_sor_show_link(struct seq_file *s, void *data)
+{
+	struct drm_info_node *node = s->private;
+	struct tegra_sor *sor = node->info_ent->data;
+	struct drm_device *drm = node->minor->dev;
+	struct drm_dp_link *link = &sor->link;
+
+	drm_modeset_lock_all(drm);
+
+	seq_printf(s, "rate: %u kHz, lanes: %u\n", link->rate, link->lanes);
+	seq_printf(s, "cache: %s\n", link->cache.valid ? "valid" : "empty");
+	seq_printf(s, "training: fast %u, cached %u, full %u, failed %u\n",
+		   link->stats.fast, link->stats.cached, link->stats.full,
+		   link->stats.failed);
+	seq_printf(s, "last training: %u us\n", link->stats.last_us);
+	seq_printf(s, "last enable: %u us\n", sor->enable_us);
+	seq_printf(s, "resume to display: %u us\n", sor->resume_us);
+
+	drm_modeset_unlock_all(drm);
+
+	return 0;
+}
+
 static const struct drm_info_list debugfs_files[] = {
 	{ "crc", tegra_sor_show_crc, 0, NULL },
 	{ "regs", tegra_sor_show_regs, 0, NULL },
+	{ "link", tegra_sor_show_link, 0, NULL },
 };
 
 static int tegra_sor_late_register(struct drm_connector *connector)
@@ -2751,6 +2782,20 @@ static void tegra_sor_dp_disable(struct drm_encoder *encoder)
 	host1x_client_suspend(&sor->client);
 }
 
+/*
+ * Link training settings are cached per sink, tell sinks with identical DPCD
+ * capabilities apart by their EDID.
+ */
+static u32 tegra_sor_dp_sink_id(struct tegra_sor *sor)
+{
+	struct drm_property_blob *edid = sor->output.connector.edid_blob_ptr;
+
+	if (!edid)
+		return 0;
+
+	return crc32_le(~0, edid->data, edid->length);
+}
+
 static void tegra_sor_dp_enable(struct drm_encoder *encoder)
 {
 	struct tegra_output *output = encoder_to_output(encoder);
@@ -2760,6 +2805,7 @@ static void tegra_sor_dp_enable(struct drm_encoder *encoder)
 	struct tegra_sor_state *state;
 	struct drm_display_mode *mode;
 	struct drm_display_info *info;
+	ktime_t start = ktime_get();
 	unsigned int i;
 	u32 value;
 	int err;
@@ -2913,6 +2959,8 @@ static void tegra_sor_dp_enable(struct drm_encoder *encoder)
 
 	tegra_sor_dp_term_calibrate(sor);
 
+	sor->link.sink = tegra_sor_dp_sink_id(sor);
+
 	err = drm_dp_link_train(&sor->link);
 	if (err < 0)
 		dev_err(sor->dev, "link training failed: %d\n", err);
@@ -2969,6 +3017,16 @@ static void tegra_sor_dp_enable(struct drm_encoder *encoder)
 
 	if (output->panel)
 		drm_panel_enable(output->panel);
+
+	sor->enable_us = ktime_us_delta(ktime_get(), start);
+
+	if (sor->resume_time) {
+		sor->resume_us = ktime_us_delta(ktime_get(), sor->resume_time);
+		sor->resume_time = 0;
+
+		dev_dbg(sor->dev, "display up %u us after resume (link training %u us)\n",
+			sor->resume_us, sor->link.stats.last_us);
+	}
 }
 
 static const struct drm_encoder_helper_funcs tegra_sor_dp_helpers = {
@@ -4075,6 +4133,8 @@ static int __maybe_unused tegra_sor_resume(struct device *dev)
 		return err;
 	}
 
+	sor->resume_time = ktime_get();
+
 	return 0;
 }
 
@@ -3,6 +3,7 @@
  * Copyright (c) 2020-2023, NVIDIA CORPORATION & AFFILIATES. All Rights Reserved.
  */
 
+#include <linux/bitmap.h>
 #include <linux/dma-fence-array.h>
 #include <linux/dma-mapping.h>
 #include <linux/file.h>
@@ -28,6 +29,7 @@
 #include "uapi.h"
 
 #include <trace/events/trace.h>
+#include <trace/events/tegra_frame.h>
 
 #define SUBMIT_ERR(context, fmt, ...) \
 	dev_err_ratelimited(context->client->base.dev, \
@@ -45,6 +47,25 @@ struct gather_bo {
 	size_t gather_data_words;
 };
 
+/*
+ * A job that was copied in and validated once and can be submitted again
+ * with only the relocation targets changed. Templates are only used with
+ * the file's lock held.
+ */
+struct tegra_drm_submit_template {
+	struct gather_bo *bo;
+
+	struct drm_tegra_submit_buf *bufs;
+	u32 num_bufs;
+
+	struct drm_tegra_submit_cmd *cmds;
+	u32 num_cmds;
+
+	/* mappings the template was validated against */
+	struct tegra_drm_used_mapping *mappings;
+	u32 num_mappings;
+};
+
 static struct host1x_bo *gather_bo_get(struct host1x_bo *host_bo)
 {
 	struct gather_bo *bo = container_of(host_bo, struct gather_bo, base);
@@ -153,13 +174,17 @@ tegra_drm_mapping_get(struct tegra_drm_context *context, u32 id)
 {
 	struct tegra_drm_mapping *mapping;
 
-	xa_lock(&context->mappings);
+	/*
+	 * Mappings are freed after an RCU grace period, so a lookup only needs
+	 * to make sure that the mapping isn't already on its way out.
+	 */
+	rcu_read_lock();
 
 	mapping = xa_load(&context->mappings, id);
-	if (mapping)
-		kref_get(&mapping->ref);
+	if (mapping && !kref_get_unless_zero(&mapping->ref))
+		mapping = NULL;
 
-	xa_unlock(&context->mappings);
+	rcu_read_unlock();
 
 	return mapping;
 }
@@ -187,9 +212,13 @@ static void *alloc_copy_user_array(void __user *from, size_t count, size_t size)
 	return data;
 }
 
+/*
+ * Allocate a gather BO and fill it from userspace, or from @src if that is
+ * given.
+ */
 static int submit_copy_gather_data(struct gather_bo **pbo, struct device *dev,
 				   struct tegra_drm_context *context,
-				   struct drm_tegra_channel_submit *args)
+				   struct drm_tegra_channel_submit *args, const u32 *src)
 {
 	struct gather_bo *bo;
 	size_t copy_len;
@@ -222,7 +251,10 @@ static int submit_copy_gather_data(struct gather_bo **pbo, struct device *dev,
 		return -ENOMEM;
 	}
 
-	if (copy_from_user(bo->gather_data, u64_to_user_ptr(args->gather_data_ptr), copy_len)) {
+	if (src) {
+		memcpy(bo->gather_data, src, copy_len);
+	} else if (copy_from_user(bo->gather_data, u64_to_user_ptr(args->gather_data_ptr),
+				  copy_len)) {
 		SUBMIT_ERR(context, "failed to copy gather data from userspace");
 		dma_free_attrs(dev, copy_len, bo->gather_data, bo->gather_data_dma, 0);
 		kfree(bo);
@@ -265,30 +297,21 @@ static int submit_write_reloc(struct tegra_drm_context *context, struct gather_b
 	return 0;
 }
 
-static int submit_process_bufs(struct tegra_drm_context *context, struct gather_bo *bo,
-			       struct drm_tegra_channel_submit *args,
-			       struct tegra_drm_submit_data *job_data)
+static int submit_apply_bufs(struct tegra_drm_context *context, struct gather_bo *bo,
+			     struct drm_tegra_submit_buf *bufs, u32 num_bufs,
+			     struct tegra_drm_submit_data *job_data)
 {
 	struct tegra_drm_used_mapping *mappings;
-	struct drm_tegra_submit_buf *bufs;
 	int err;
 	u32 i;
 
-	bufs = alloc_copy_user_array(u64_to_user_ptr(args->bufs_ptr), args->num_bufs,
-				     sizeof(*bufs));
-	if (IS_ERR(bufs)) {
-		SUBMIT_ERR(context, "failed to copy bufs array from userspace");
-		return PTR_ERR(bufs);
-	}
-
-	mappings = kcalloc(args->num_bufs, sizeof(*mappings), GFP_KERNEL);
+	mappings = kcalloc(num_bufs, sizeof(*mappings), GFP_KERNEL);
 	if (!mappings) {
 		SUBMIT_ERR(context, "failed to allocate memory for mapping info");
-		err = -ENOMEM;
-		goto done;
+		return -ENOMEM;
 	}
 
-	for (i = 0; i < args->num_bufs; i++) {
+	for (i = 0; i < num_bufs; i++) {
 		struct drm_tegra_submit_buf *buf = &bufs[i];
 		struct tegra_drm_mapping *mapping;
 
@@ -298,7 +321,14 @@ static int submit_process_bufs(struct tegra_drm_context *context, struct gather_
 			goto drop_refs;
 		}
 
-		mapping = tegra_drm_mapping_get(context, buf->mapping);
+		/* relocations into the same buffer are usually adjacent */
+		if (i > 0 && bufs[i - 1].mapping == buf->mapping) {
+			mapping = mappings[i - 1].mapping;
+			kref_get(&mapping->ref);
+		} else {
+			mapping = tegra_drm_mapping_get(context, buf->mapping);
+		}
+
 		if (!mapping) {
 			SUBMIT_ERR(context, "invalid mapping ID '%u' for buffer", buf->mapping);
 			err = -EINVAL;
@@ -318,9 +348,7 @@ static int submit_process_bufs(struct tegra_drm_context *context, struct gather_
 	job_data->used_mappings = mappings;
 	job_data->num_used_mappings = i;
 
-	err = 0;
-
-	goto done;
+	return 0;
 
 drop_refs:
 	while (i--)
@@ -329,7 +357,25 @@ drop_refs:
 	kfree(mappings);
 	job_data->used_mappings = NULL;
 
-done:
+	return err;
+}
+
+static int submit_process_bufs(struct tegra_drm_context *context, struct gather_bo *bo,
+			       struct drm_tegra_channel_submit *args,
+			       struct tegra_drm_submit_data *job_data)
+{
+	struct drm_tegra_submit_buf *bufs;
+	int err;
+
+	bufs = alloc_copy_user_array(u64_to_user_ptr(args->bufs_ptr), args->num_bufs,
+				     sizeof(*bufs));
+	if (IS_ERR(bufs)) {
+		SUBMIT_ERR(context, "failed to copy bufs array from userspace");
+		return PTR_ERR(bufs);
+	}
+
+	err = submit_apply_bufs(context, bo, bufs, args->num_bufs, job_data);
+
 	kvfree(bufs);
 
 	return err;
@@ -368,14 +414,10 @@ static int submit_get_syncpt(struct tegra_drm_context *context, struct host1x_jo
 	return 0;
 }
 
-static int submit_job_add_gather(struct host1x_job *job, struct tegra_drm_context *context,
-				 struct drm_tegra_submit_cmd_gather_uptr *cmd,
-				 struct gather_bo *bo, u32 *offset,
-				 struct tegra_drm_submit_data *job_data,
-				 u32 *class)
+static int submit_check_gather(struct tegra_drm_context *context,
+			       struct drm_tegra_submit_cmd_gather_uptr *cmd,
+			       struct gather_bo *bo, u32 offset, u32 *next_offset)
 {
-	u32 next_offset;
-
 	if (cmd->reserved[0] || cmd->reserved[1] || cmd->reserved[2]) {
 		SUBMIT_ERR(context, "non-zero reserved field in GATHER_UPTR command");
 		return -EINVAL;
@@ -387,20 +429,49 @@ static int submit_job_add_gather(struct host1x_job *job, struct tegra_drm_contex
 		return -EINVAL;
 	}
 
-	if (check_add_overflow(*offset, cmd->words, &next_offset)) {
+	if (check_add_overflow(offset, cmd->words, next_offset)) {
 		SUBMIT_ERR(context, "too many total words in job");
 		return -EINVAL;
 	}
 
-	if (next_offset > bo->gather_data_words) {
+	if (*next_offset > bo->gather_data_words) {
 		SUBMIT_ERR(context, "GATHER_UPTR command overflows gather data");
 		return -EINVAL;
 	}
 
-	if (tegra_drm_fw_validate(context->client, bo->gather_data, *offset,
-				  cmd->words, job_data, class)) {
-		SUBMIT_ERR(context, "job was rejected by firewall");
-		return -EINVAL;
+	return 0;
+}
+
+/*
+ * Add a GATHER_UPTR command to the job. The firewall is skipped if @validate
+ * is false, which is only the case for gathers of a template, which were
+ * validated when the template was created.
+ */
+static int submit_job_add_gather(struct host1x_job *job, struct tegra_drm_context *context,
+				 struct drm_tegra_submit_cmd_gather_uptr *cmd,
+				 struct gather_bo *bo, u32 *offset,
+				 struct tegra_drm_submit_data *job_data,
+				 u32 *class, bool validate)
+{
+	u32 next_offset;
+	ktime_t start;
+	int err;
+
+	err = submit_check_gather(context, cmd, bo, *offset, &next_offset);
+	if (err)
+		return err;
+
+	if (validate) {
+		start = ktime_get();
+
+		if (tegra_drm_fw_validate(context->client, bo->gather_data, *offset,
+					  cmd->words, job_data, class)) {
+			SUBMIT_ERR(context, "job was rejected by firewall");
+			return -EINVAL;
+		}
+
+		host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_VALIDATE,
+					  ktime_to_ns(ktime_sub(ktime_get(), start)));
 	}
 
 	host1x_job_add_gather(job, &bo->base, cmd->words, *offset * 4);
@@ -413,7 +484,8 @@ static int submit_job_add_gather(struct host1x_job *job, struct tegra_drm_contex
 static struct host1x_job *
 submit_create_job(struct tegra_drm_context *context, struct gather_bo *bo,
 		  struct drm_tegra_channel_submit *args, struct tegra_drm_submit_data *job_data,
-		  struct xarray *syncpoints, struct drm_tegra_submit_cmd *cmds)
+		  struct xarray *syncpoints, struct drm_tegra_submit_cmd *cmds,
+		  const struct drm_tegra_submit_syncpt *chain, bool validate)
 {
 	u32 i, gather_offset = 0, class;
 	bool first_gather = true;
@@ -425,6 +497,16 @@ submit_create_job(struct tegra_drm_context *context, struct gather_bo *bo,
 	class = context->client->base.class;
 
 	needed_cmds = args->num_cmds;
+	if (chain) {
+		/* Space for the wait on the previous job of a batch */
+		err = check_add_overflow(needed_cmds, (u32)1U, &needed_cmds);
+		if (err) {
+			SUBMIT_ERR(context, "num_cmds too high");
+			job = ERR_PTR(-EINVAL);
+			goto done;
+		}
+	}
+
 	if (job_data->timestamps.virt) {
 		/* Space for TSP method commands */
 		err = check_add_overflow(needed_cmds, (u32)2U, &needed_cmds);
@@ -450,6 +532,9 @@ submit_create_job(struct tegra_drm_context *context, struct gather_bo *bo,
 	job->class = context->client->base.class;
 	job->serialize = true;
 
+	if (chain)
+		host1x_job_add_wait(job, chain->id, chain->value, false, class);
+
 	for (i = 0; i < args->num_cmds; i++) {
 		struct drm_tegra_submit_cmd *cmd = &cmds[i];
 
@@ -470,7 +555,7 @@ submit_create_job(struct tegra_drm_context *context, struct gather_bo *bo,
 			}
 
 			err = submit_job_add_gather(job, context, &cmd->gather_uptr, bo,
-						    &gather_offset, job_data, &class);
+						    &gather_offset, job_data, &class, validate);
 			if (err)
 				goto free_job;
 		} else if (cmd->type == DRM_TEGRA_SUBMIT_CMD_WAIT_SYNCPT) {
@@ -532,8 +617,15 @@ static void release_job(struct host1x_job *job)
 	if (IS_ENABLED(CONFIG_TRACING) && job_data->timestamps.virt) {
 		u64 *timestamps = job_data->timestamps.virt;
 
-		if (timestamps[0] != 0)
+		if (timestamps[0] != 0) {
 			trace_job_timestamps(job_data->id, timestamps[0] >> 5, timestamps[1] >> 5);
+			trace_tegra_frame_start(TEGRA_FRAME_ENGINE_HOST1X, client->base.class, 0,
+						job_data->id, host1x_syncpt_id(job->syncpt),
+						job->syncpt_end, timestamps[0]);
+			trace_tegra_frame_done(TEGRA_FRAME_ENGINE_HOST1X, client->base.class, 0,
+					       job_data->id, host1x_syncpt_id(job->syncpt),
+					       job->syncpt_end, timestamps[1]);
+		}
 
 		dma_free_coherent(job_data->timestamps.dev, 256, job_data->timestamps.virt,
 				  job_data->timestamps.iova);
@@ -546,11 +638,41 @@ static void release_job(struct host1x_job *job)
 	kfree(job_data);
 
 	if (pm_runtime_enabled(client->base.dev)) {
+		tegra_drm_client_job_end(client);
 		pm_runtime_mark_last_busy(client->base.dev);
 		pm_runtime_put_autosuspend(client->base.dev);
 	}
 }
 
+static void submit_trace_frame(struct tegra_drm_context *context, struct host1x_job *job,
+			       u32 job_id, u64 timestamp)
+{
+	struct tegra_drm_submit_data *job_data = job->user_data;
+	struct tegra_drm_mapping *prev = NULL;
+	u32 i;
+
+	for (i = 0; i < job_data->num_used_mappings; i++) {
+		struct tegra_drm_mapping *mapping = job_data->used_mappings[i].mapping;
+		struct tegra_bo *bo;
+		struct dma_buf *dmabuf;
+
+		/* relocations into the same buffer are usually adjacent */
+		if (mapping == prev)
+			continue;
+
+		prev = mapping;
+		bo = host1x_to_tegra_bo(mapping->bo);
+		dmabuf = bo->gem.import_attach ? bo->gem.import_attach->dmabuf : bo->gem.dma_buf;
+		if (!dmabuf)
+			continue;
+
+		trace_tegra_frame_submit(TEGRA_FRAME_ENGINE_HOST1X, context->client->base.class,
+					 tegra_frame_dmabuf_id(dmabuf), job_id,
+					 host1x_syncpt_id(job->syncpt), job->syncpt_end,
+					 tegra_frame_tsc_to_ns(timestamp));
+	}
+}
+
 static int submit_init_profiling(struct tegra_drm_context *context,
 				 struct tegra_drm_submit_data *job_data)
 {
@@ -578,31 +700,32 @@ static int submit_init_profiling(struct tegra_drm_context *context,
 	return 0;
 }
 
-int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
-				   struct drm_file *file)
+/*
+ * Submit a single job to a channel context. If @chain is given, the job waits
+ * in hardware for that syncpoint threshold before executing. If @tmpl is
+ * given, gather data and commands come from the template and @bufs holds its
+ * relocations with the targets for this job. Must be called with the file's
+ * lock held.
+ */
+static int submit_job_locked(struct drm_device *drm, struct drm_file *file,
+			     struct tegra_drm_context *context,
+			     struct drm_tegra_channel_submit *args,
+			     const struct drm_tegra_submit_syncpt *chain,
+			     const struct tegra_drm_submit_template *tmpl,
+			     struct drm_tegra_submit_buf *bufs)
 {
 	struct tegra_drm_file *fpriv = file->driver_priv;
-	struct drm_tegra_channel_submit *args = data;
 	static atomic_t next_job_id = ATOMIC_INIT(1);
 	struct tegra_drm_submit_data *job_data;
 	struct drm_tegra_submit_cmd *cmds;
 	struct drm_syncobj *syncobj = NULL;
-	struct tegra_drm_context *context;
 	struct host1x_job *job;
 	struct gather_bo *bo;
+	ktime_t start;
 	u64 timestamp;
+	u64 copy_ns;
 	u32 i, job_id;
-	int err;
-
-	mutex_lock(&fpriv->lock);
-
-	context = xa_load(&fpriv->contexts, args->context);
-	if (!context) {
-		mutex_unlock(&fpriv->lock);
-		pr_err_ratelimited("%s: %s: invalid channel context '%#x'", __func__,
-				   current->comm, args->context);
-		return -EINVAL;
-	}
+	int err = -EINVAL;
 
 	if (args->flags & ~(DRM_TEGRA_SUBMIT_SECONDARY_SYNCPT)) {
 		SUBMIT_ERR(context, "invalid flags '%#x'", args->flags);
@@ -636,10 +759,15 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 	}
 
 	/* Allocate gather BO and copy gather words in. */
-	err = submit_copy_gather_data(&bo, drm->dev, context, args);
+	start = ktime_get();
+
+	err = submit_copy_gather_data(&bo, drm->dev, context, args,
+				      tmpl ? tmpl->bo->gather_data : NULL);
 	if (err)
 		goto unlock;
 
+	copy_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
 	job_data = kzalloc(sizeof(*job_data), GFP_KERNEL);
 	if (!job_data) {
 		SUBMIT_ERR(context, "failed to allocate memory for job data");
@@ -658,26 +786,40 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 	}
 
 	/* Get data buffer mappings and do relocation patching. */
-	err = submit_process_bufs(context, bo, args, job_data);
+	if (tmpl)
+		err = submit_apply_bufs(context, bo, bufs, args->num_bufs, job_data);
+	else
+		err = submit_process_bufs(context, bo, args, job_data);
 	if (err)
 		goto free_job_data;
 
 	/* Copy submit commands from userspace. */
-	cmds = alloc_copy_user_array(u64_to_user_ptr(args->cmds_ptr), args->num_cmds,
-				     sizeof(*cmds));
-	if (IS_ERR(cmds)) {
-		SUBMIT_ERR(context, "failed to copy cmds array from userspace");
-		err = PTR_ERR(cmds);
-		goto free_job_data;
+	if (tmpl) {
+		cmds = tmpl->cmds;
+	} else {
+		start = ktime_get();
+
+		cmds = alloc_copy_user_array(u64_to_user_ptr(args->cmds_ptr), args->num_cmds,
+					     sizeof(*cmds));
+		if (IS_ERR(cmds)) {
+			SUBMIT_ERR(context, "failed to copy cmds array from userspace");
+			err = PTR_ERR(cmds);
+			goto free_job_data;
+		}
+
+		copy_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
 	}
 
 	/* Allocate host1x_job and add gathers and waits to it. */
-	job = submit_create_job(context, bo, args, job_data, &fpriv->syncpoints, cmds);
+	job = submit_create_job(context, bo, args, job_data, &fpriv->syncpoints, cmds,
+				chain, !tmpl);
 	if (IS_ERR(job)) {
 		err = PTR_ERR(job);
 		goto free_cmds;
 	}
 
+	host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_COPY, copy_ns);
+
 	/* Map gather data for Host1x. */
 	err = host1x_job_pin(job, context->client->base.dev);
 	if (err) {
@@ -727,11 +869,17 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 
 	/* Boot engine, if necessary. */
 	if (pm_runtime_enabled(context->client->base.dev)) {
+		bool suspended = pm_runtime_suspended(context->client->base.dev);
+		ktime_t start = ktime_get();
+
 		err = pm_runtime_resume_and_get(context->client->base.dev);
 		if (err < 0) {
 			SUBMIT_ERR(context, "could not power up engine: %d", err);
 			goto put_memory_context;
 		}
+
+		tegra_drm_client_job_begin(context->client,
+					   suspended ? ktime_us_delta(ktime_get(), start) : -1);
 	}
 
 	job->user_data = job_data;
@@ -792,6 +940,9 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 		}
 
 		trace_job_postfence(job_id, host1x_syncpt_id(job->syncpt), job->syncpt_end);
+
+		if (trace_tegra_frame_submit_enabled())
+			submit_trace_frame(context, job, job_id, timestamp);
 	}
 
 	goto put_job;
@@ -804,7 +955,8 @@ unpin_job:
 put_job:
 	host1x_job_put(job);
 free_cmds:
-	kvfree(cmds);
+	if (!tmpl)
+		kvfree(cmds);
 free_job_data:
 	if (job_data) {
 		if (job_data->timestamps.virt)
@@ -826,6 +978,396 @@ unlock:
 	if (syncobj)
 		drm_syncobj_put(syncobj);
 
+	return err;
+}
+
+int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
+				   struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct drm_tegra_channel_submit *args = data;
+	struct tegra_drm_context *context;
+	int err;
+
+	mutex_lock(&fpriv->lock);
+
+	context = xa_load(&fpriv->contexts, args->context);
+	if (!context) {
+		mutex_unlock(&fpriv->lock);
+		pr_err_ratelimited("%s: %s: invalid channel context '%#x'", __func__,
+				   current->comm, args->context);
+		return -EINVAL;
+	}
+
+	err = submit_job_locked(drm, file, context, args, NULL, NULL, NULL);
+
 	mutex_unlock(&fpriv->lock);
+
 	return err;
 }
+
+int tegra_drm_ioctl_channel_submit_batch(struct drm_device *drm, void *data,
+					 struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct drm_tegra_channel_submit_batch *args = data;
+	struct drm_tegra_channel_submit __user *user_jobs;
+	const struct drm_tegra_submit_syncpt *chain = NULL;
+	struct drm_tegra_channel_submit *jobs;
+	struct tegra_drm_context *context;
+	int err = 0;
+	u32 i;
+
+	if (args->flags & ~DRM_TEGRA_SUBMIT_BATCH_CHAIN || args->reserved)
+		return -EINVAL;
+
+	if (args->num_jobs == 0 || args->num_jobs > DRM_TEGRA_SUBMIT_BATCH_MAX_JOBS)
+		return -EINVAL;
+
+	args->num_submitted = 0;
+
+	user_jobs = u64_to_user_ptr(args->jobs_ptr);
+
+	jobs = alloc_copy_user_array(user_jobs, args->num_jobs, sizeof(*jobs));
+	if (IS_ERR(jobs))
+		return PTR_ERR(jobs);
+
+	/* look up the context and take the lock once for the whole batch */
+	mutex_lock(&fpriv->lock);
+
+	context = xa_load(&fpriv->contexts, args->context);
+	if (!context) {
+		mutex_unlock(&fpriv->lock);
+		pr_err_ratelimited("%s: %s: invalid channel context '%#x'", __func__,
+				   current->comm, args->context);
+		err = -EINVAL;
+		goto free;
+	}
+
+	for (i = 0; i < args->num_jobs; i++) {
+		if (jobs[i].context != args->context) {
+			SUBMIT_ERR(context, "job %u is for a different context", i);
+			err = -EINVAL;
+			break;
+		}
+
+		err = submit_job_locked(drm, file, context, &jobs[i], chain, NULL, NULL);
+		if (err)
+			break;
+
+		if (copy_to_user(&user_jobs[i].syncpt.value, &jobs[i].syncpt.value,
+				 sizeof(jobs[i].syncpt.value))) {
+			/* the job is already queued, so count it anyway */
+			args->num_submitted++;
+			err = -EFAULT;
+			break;
+		}
+
+		args->num_submitted++;
+
+		if (args->flags & DRM_TEGRA_SUBMIT_BATCH_CHAIN)
+			chain = &jobs[i].syncpt;
+	}
+
+	mutex_unlock(&fpriv->lock);
+
+free:
+	kvfree(jobs);
+	return err;
+}
+
+void tegra_drm_submit_template_free(struct tegra_drm_submit_template *tmpl)
+{
+	u32 i;
+
+	for (i = 0; i < tmpl->num_mappings; i++)
+		tegra_drm_mapping_put(tmpl->mappings[i].mapping);
+
+	kfree(tmpl->mappings);
+	kvfree(tmpl->cmds);
+	kvfree(tmpl->bufs);
+	gather_bo_put(&tmpl->bo->base);
+	kfree(tmpl);
+}
+
+/*
+ * Run the firewall over all gathers of a template. Relocations must patch
+ * words that the firewall saw as register data, anything else could turn
+ * into an unchecked opcode once the template is submitted with different
+ * targets.
+ */
+static int submit_template_validate(struct tegra_drm_context *context,
+				    struct tegra_drm_submit_template *tmpl,
+				    struct tegra_drm_submit_data *job_data)
+{
+	u32 i, offset = 0, next_offset, class;
+	int err = 0;
+
+	job_data->reg_words = bitmap_zalloc(tmpl->bo->gather_data_words, GFP_KERNEL);
+	if (!job_data->reg_words)
+		return -ENOMEM;
+
+	class = context->client->base.class;
+
+	for (i = 0; i < tmpl->num_cmds; i++) {
+		struct drm_tegra_submit_cmd *cmd = &tmpl->cmds[i];
+
+		if (cmd->flags) {
+			SUBMIT_ERR(context, "unknown flags given for cmd");
+			err = -EINVAL;
+			goto free;
+		}
+
+		if (cmd->type == DRM_TEGRA_SUBMIT_CMD_GATHER_UPTR) {
+			err = submit_check_gather(context, &cmd->gather_uptr, tmpl->bo, offset,
+						  &next_offset);
+			if (err)
+				goto free;
+
+			if (tegra_drm_fw_validate(context->client, tmpl->bo->gather_data, offset,
+						  cmd->gather_uptr.words, job_data, &class)) {
+				SUBMIT_ERR(context, "template was rejected by firewall");
+				err = -EINVAL;
+				goto free;
+			}
+
+			offset = next_offset;
+		} else if (cmd->type != DRM_TEGRA_SUBMIT_CMD_WAIT_SYNCPT &&
+			   cmd->type != DRM_TEGRA_SUBMIT_CMD_WAIT_SYNCPT_RELATIVE) {
+			SUBMIT_ERR(context, "unknown cmd type");
+			err = -EINVAL;
+			goto free;
+		}
+	}
+
+	if (offset == 0) {
+		SUBMIT_ERR(context, "job must have at least one gather");
+		err = -EINVAL;
+		goto free;
+	}
+
+	for (i = 0; i < tmpl->num_bufs; i++) {
+		if (!test_bit(tmpl->bufs[i].reloc.gather_offset_words, job_data->reg_words)) {
+			SUBMIT_ERR(context, "relocation %u does not patch register data", i);
+			err = -EINVAL;
+			goto free;
+		}
+	}
+
+free:
+	bitmap_free(job_data->reg_words);
+	job_data->reg_words = NULL;
+
+	return err;
+}
+
+int tegra_drm_ioctl_channel_create_template(struct drm_device *drm, void *data,
+					    struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct drm_tegra_channel_create_template *args = data;
+	struct drm_tegra_channel_submit submit = {
+		.num_bufs = args->num_bufs,
+		.num_cmds = args->num_cmds,
+		.gather_data_words = args->gather_data_words,
+		.bufs_ptr = args->bufs_ptr,
+		.cmds_ptr = args->cmds_ptr,
+		.gather_data_ptr = args->gather_data_ptr,
+	};
+	struct tegra_drm_submit_data job_data = {};
+	struct tegra_drm_submit_template *tmpl;
+	struct tegra_drm_context *context;
+	int err;
+
+	if (args->padding || args->num_bufs > DRM_TEGRA_SUBMIT_TEMPLATE_MAX_RELOCS)
+		return -EINVAL;
+
+	mutex_lock(&fpriv->lock);
+
+	context = xa_load(&fpriv->contexts, args->context);
+	if (!context) {
+		mutex_unlock(&fpriv->lock);
+		pr_err_ratelimited("%s: %s: invalid channel context '%#x'", __func__,
+				   current->comm, args->context);
+		return -EINVAL;
+	}
+
+	tmpl = kzalloc(sizeof(*tmpl), GFP_KERNEL);
+	if (!tmpl) {
+		err = -ENOMEM;
+		goto unlock;
+	}
+
+	err = submit_copy_gather_data(&tmpl->bo, drm->dev, context, &submit, NULL);
+	if (err)
+		goto free;
+
+	tmpl->bufs = alloc_copy_user_array(u64_to_user_ptr(args->bufs_ptr), args->num_bufs,
+					   sizeof(*tmpl->bufs));
+	if (IS_ERR(tmpl->bufs)) {
+		SUBMIT_ERR(context, "failed to copy bufs array from userspace");
+		err = PTR_ERR(tmpl->bufs);
+		tmpl->bufs = NULL;
+		goto put_bo;
+	}
+
+	tmpl->num_bufs = args->num_bufs;
+
+	tmpl->cmds = alloc_copy_user_array(u64_to_user_ptr(args->cmds_ptr), args->num_cmds,
+					   sizeof(*tmpl->cmds));
+	if (IS_ERR(tmpl->cmds)) {
+		SUBMIT_ERR(context, "failed to copy cmds array from userspace");
+		err = PTR_ERR(tmpl->cmds);
+		tmpl->cmds = NULL;
+		goto put_bo;
+	}
+
+	tmpl->num_cmds = args->num_cmds;
+
+	err = submit_apply_bufs(context, tmpl->bo, tmpl->bufs, tmpl->num_bufs, &job_data);
+	if (err)
+		goto put_bo;
+
+	tmpl->mappings = job_data.used_mappings;
+	tmpl->num_mappings = job_data.num_used_mappings;
+
+	err = submit_template_validate(context, tmpl, &job_data);
+	if (err)
+		goto destroy;
+
+	err = xa_alloc(&context->templates, &args->id, tmpl, XA_LIMIT(1, U32_MAX),
+		       GFP_KERNEL);
+	if (err < 0)
+		goto destroy;
+
+	mutex_unlock(&fpriv->lock);
+
+	return 0;
+
+destroy:
+	tegra_drm_submit_template_free(tmpl);
+	goto unlock;
+put_bo:
+	kvfree(tmpl->cmds);
+	kvfree(tmpl->bufs);
+	gather_bo_put(&tmpl->bo->base);
+free:
+	kfree(tmpl);
+unlock:
+	mutex_unlock(&fpriv->lock);
+
+	return err;
+}
+
+int tegra_drm_ioctl_channel_submit_template(struct drm_device *drm, void *data,
+					    struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct drm_tegra_channel_submit_template *args = data;
+	struct drm_tegra_submit_template_reloc *relocs;
+	struct tegra_drm_submit_template *tmpl;
+	struct drm_tegra_channel_submit submit;
+	struct tegra_drm_context *context;
+	struct drm_tegra_submit_buf *bufs;
+	int err;
+	u32 i;
+
+	if (args->padding || args->num_relocs > DRM_TEGRA_SUBMIT_TEMPLATE_MAX_RELOCS)
+		return -EINVAL;
+
+	relocs = alloc_copy_user_array(u64_to_user_ptr(args->relocs_ptr), args->num_relocs,
+				       sizeof(*relocs));
+	if (IS_ERR(relocs))
+		return PTR_ERR(relocs);
+
+	mutex_lock(&fpriv->lock);
+
+	context = xa_load(&fpriv->contexts, args->context);
+	if (!context) {
+		pr_err_ratelimited("%s: %s: invalid channel context '%#x'", __func__,
+				   current->comm, args->context);
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	tmpl = xa_load(&context->templates, args->id);
+	if (!tmpl) {
+		SUBMIT_ERR(context, "invalid template ID '%u'", args->id);
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	if (args->num_relocs != tmpl->num_bufs) {
+		SUBMIT_ERR(context, "template has %u relocations, got %u", tmpl->num_bufs,
+			   args->num_relocs);
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	bufs = kmalloc_array(tmpl->num_bufs, sizeof(*bufs), GFP_KERNEL);
+	if (!bufs) {
+		err = -ENOMEM;
+		goto unlock;
+	}
+
+	memcpy(bufs, tmpl->bufs, tmpl->num_bufs * sizeof(*bufs));
+
+	for (i = 0; i < tmpl->num_bufs; i++) {
+		if (relocs[i].padding) {
+			SUBMIT_ERR(context, "non-zero padding in relocation %u", i);
+			err = -EINVAL;
+			goto free_bufs;
+		}
+
+		bufs[i].mapping = relocs[i].mapping;
+		bufs[i].reloc.target_offset = relocs[i].target_offset;
+	}
+
+	submit = (struct drm_tegra_channel_submit) {
+		.context = args->context,
+		.num_bufs = tmpl->num_bufs,
+		.num_cmds = tmpl->num_cmds,
+		.gather_data_words = tmpl->bo->gather_data_words,
+		.syncobj_in = args->syncobj_in,
+		.syncobj_out = args->syncobj_out,
+		.syncpt = args->syncpt,
+		.flags = args->flags,
+		.secondary_syncpt_id = args->secondary_syncpt_id,
+	};
+
+	err = submit_job_locked(drm, file, context, &submit, NULL, tmpl, bufs);
+	if (!err)
+		args->syncpt.value = submit.syncpt.value;
+
+free_bufs:
+	kfree(bufs);
+unlock:
+	mutex_unlock(&fpriv->lock);
+	kvfree(relocs);
+
+	return err;
+}
+
+int tegra_drm_ioctl_channel_destroy_template(struct drm_device *drm, void *data,
+					     struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct drm_tegra_channel_destroy_template *args = data;
+	struct tegra_drm_submit_template *tmpl = NULL;
+	struct tegra_drm_context *context;
+
+	mutex_lock(&fpriv->lock);
+
+	context = xa_load(&fpriv->contexts, args->context);
+	if (context)
+		tmpl = xa_erase(&context->templates, args->id);
+
+	mutex_unlock(&fpriv->lock);
+
+	if (!tmpl)
+		return -EINVAL;
+
+	tegra_drm_submit_template_free(tmpl);
+
+	return 0;
+}
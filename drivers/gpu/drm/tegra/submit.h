@@ -14,6 +14,9 @@ struct tegra_drm_submit_data {
 	u32 num_used_mappings;
 	u32 id;
 
+	/* if set, the firewall marks each word it checks as register data */
+	unsigned long *reg_words;
+
 	struct {
 		struct device *dev;
 		dma_addr_t iova;
@@ -20,7 +20,7 @@ static void tegra_drm_mapping_release(struct kref *ref)
 	host1x_bo_unpin(mapping->map);
 	host1x_bo_put(mapping->bo);
 
-	kfree(mapping);
+	kfree_rcu(mapping, rcu);
 }
 
 void tegra_drm_mapping_put(struct tegra_drm_mapping *mapping)
@@ -30,12 +30,19 @@ void tegra_drm_mapping_put(struct tegra_drm_mapping *mapping)
 
 static void tegra_drm_channel_context_close(struct tegra_drm_context *context)
 {
+	struct tegra_drm_submit_template *tmpl;
 	struct tegra_drm_mapping *mapping;
 	unsigned long id;
 
 	if (context->memory_context)
 		host1x_memory_context_put(context->memory_context);
 
+	/* templates hold mapping references, so drop them first */
+	xa_for_each(&context->templates, id, tmpl)
+		tegra_drm_submit_template_free(tmpl);
+
+	xa_destroy(&context->templates);
+
 	xa_for_each(&context->mappings, id, mapping)
 		tegra_drm_mapping_put(mapping);
 
@@ -139,6 +146,7 @@ int tegra_drm_ioctl_channel_open(struct drm_device *drm, void *data, struct drm_
 
 	context->client = client;
 	xa_init_flags(&context->mappings, XA_FLAGS_ALLOC1);
+	xa_init_flags(&context->templates, XA_FLAGS_ALLOC1);
 
 	args->version = client->version;
 	args->capabilities = 0;
@@ -360,3 +368,15 @@ int tegra_drm_ioctl_syncpoint_wait(struct drm_device *drm, void *data, struct dr
 
 	return 0;
 }
+
+int tegra_drm_ioctl_syncpoint_shadow(struct drm_device *drm, void *data, struct drm_file *file)
+{
+	struct host1x *host1x = tegra_drm_to_host1x(drm->dev_private);
+	struct drm_tegra_syncpoint_shadow *args = data;
+
+	args->offset = (u64)TEGRA_DRM_SYNCPT_SHADOW_PGOFF << PAGE_SHIFT;
+	args->size = host1x_syncpt_shadow_size(host1x);
+	args->num_syncpts = args->size / sizeof(u32);
+
+	return 0;
+}
@@ -7,12 +7,14 @@
 #include <linux/dma-mapping.h>
 #include <linux/idr.h>
 #include <linux/kref.h>
+#include <linux/rcupdate.h>
 #include <linux/xarray.h>
 
 #include <drm/drm.h>
 
 struct drm_file;
 struct drm_device;
+struct tegra_drm_submit_template;
 
 struct tegra_drm_file {
 	/* Legacy UAPI state */
@@ -26,6 +28,7 @@ struct tegra_drm_file {
 
 struct tegra_drm_mapping {
 	struct kref ref;
+	struct rcu_head rcu;	/* lookups in submit don't take the xarray lock */
 
 	struct host1x_bo_mapping *map;
 	struct host1x_bo *bo;
@@ -34,6 +37,9 @@ struct tegra_drm_mapping {
 	dma_addr_t iova_end;
 };
 
+/* mmap() page offset of the syncpoint shadow table, below any GEM offset */
+#define TEGRA_DRM_SYNCPT_SHADOW_PGOFF 1
+
 int tegra_drm_ioctl_channel_open(struct drm_device *drm, void *data,
 				 struct drm_file *file);
 int tegra_drm_ioctl_channel_close(struct drm_device *drm, void *data,
@@ -44,14 +50,25 @@ int tegra_drm_ioctl_channel_unmap(struct drm_device *drm, void *data,
 				  struct drm_file *file);
 int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 				   struct drm_file *file);
+int tegra_drm_ioctl_channel_submit_batch(struct drm_device *drm, void *data,
+					 struct drm_file *file);
+int tegra_drm_ioctl_channel_create_template(struct drm_device *drm, void *data,
+					    struct drm_file *file);
+int tegra_drm_ioctl_channel_submit_template(struct drm_device *drm, void *data,
+					    struct drm_file *file);
+int tegra_drm_ioctl_channel_destroy_template(struct drm_device *drm, void *data,
+					     struct drm_file *file);
 int tegra_drm_ioctl_syncpoint_allocate(struct drm_device *drm, void *data,
 				       struct drm_file *file);
 int tegra_drm_ioctl_syncpoint_free(struct drm_device *drm, void *data,
 				   struct drm_file *file);
 int tegra_drm_ioctl_syncpoint_wait(struct drm_device *drm, void *data,
 				   struct drm_file *file);
+int tegra_drm_ioctl_syncpoint_shadow(struct drm_device *drm, void *data,
+				     struct drm_file *file);
 
 void tegra_drm_uapi_close_file(struct tegra_drm_file *file);
 void tegra_drm_mapping_put(struct tegra_drm_mapping *mapping);
+void tegra_drm_submit_template_free(struct tegra_drm_submit_template *tmpl);
 
 #endif
@@ -137,6 +137,12 @@ static int vic_set_rate(struct vic *vic, unsigned long rate)
 	return 0;
 }
 
+/* inverse of the EMC bandwidth estimate in vic_set_rate() */
+static unsigned long vic_devfreq_bw_to_freq(struct devfreq *devfreq, u32 kbps)
+{
+	return div_u64((u64)kbps * 1024, VIC_AXI_RW_BANDWIDTH);
+}
+
 static void vic_devfreq_update_wmark_threshold(struct devfreq *devfreq,
 					       struct devfreq_tegra_wmark_config *cfg)
 {
@@ -215,6 +221,7 @@ static int vic_devfreq_init(struct vic *vic)
 
 	data->event = DEVFREQ_TEGRA_AVG_WMARK_BELOW;
 	data->update_wmark_threshold = vic_devfreq_update_wmark_threshold;
+	data->bw_to_freq = vic_devfreq_bw_to_freq;
 
 	devfreq_profile = devm_kzalloc(vic->dev, sizeof(*devfreq_profile), GFP_KERNEL);
 	if (!devfreq_profile)
@@ -283,6 +290,9 @@ static int vic_init(struct host1x_client *client)
 	 */
 	client->dev->dma_parms = client->host->dma_parms;
 
+	/* fetch the firmware in the background, it is loaded on first resume */
+	falcon_request_firmware(&vic->falcon, vic->config->firmware);
+
 	return 0;
 
 free_syncpt:
@@ -320,11 +330,7 @@ static int vic_exit(struct host1x_client *client)
 	vic->channel = NULL;
 
 	if (client->group) {
-		dma_unmap_single(vic->dev, vic->falcon.firmware.phys,
-				 vic->falcon.firmware.size, DMA_TO_DEVICE);
-		tegra_drm_free(tegra, vic->falcon.firmware.size,
-			       vic->falcon.firmware.virt,
-			       vic->falcon.firmware.iova);
+		falcon_put_shared_firmware(&vic->falcon);
 	} else {
 		dma_free_coherent(vic->dev, vic->falcon.firmware.size,
 				  vic->falcon.firmware.virt,
@@ -402,48 +408,33 @@ static int vic_load_firmware(struct vic *vic)
 		goto unlock;
 	}
 
-	err = falcon_read_firmware(&vic->falcon, vic->config->firmware);
-	if (err < 0)
-		goto unlock;
+	if (client->group) {
+		/* all instances boot from one copy in the shared domain */
+		err = falcon_get_shared_firmware(&vic->falcon, tegra,
+						 vic->config->firmware);
+		if (err < 0)
+			goto unlock;
+
+		virt = vic->falcon.firmware.virt;
+	} else {
+		err = falcon_read_firmware(&vic->falcon, vic->config->firmware);
+		if (err < 0)
+			goto unlock;
 
-	size = vic->falcon.firmware.size;
+		size = vic->falcon.firmware.size;
 
-	if (!client->group) {
 		virt = dma_alloc_coherent(vic->dev, size, &iova, GFP_KERNEL);
 		if (!virt) {
 			err = -ENOMEM;
 			goto unlock;
 		}
-	} else {
-		virt = tegra_drm_alloc(tegra, size, &iova);
-		if (IS_ERR(virt)) {
-			err = PTR_ERR(virt);
-			goto unlock;
-		}
-	}
-
-	vic->falcon.firmware.virt = virt;
-	vic->falcon.firmware.iova = iova;
-
-	err = falcon_load_firmware(&vic->falcon);
-	if (err < 0)
-		goto cleanup;
-
-	/*
-	 * In this case we have received an IOVA from the shared domain, so we
-	 * need to make sure to get the physical address so that the DMA API
-	 * knows what memory pages to flush the cache for.
-	 */
-	if (client->group) {
-		dma_addr_t phys;
 
-		phys = dma_map_single(vic->dev, virt, size, DMA_TO_DEVICE);
+		vic->falcon.firmware.virt = virt;
+		vic->falcon.firmware.iova = iova;
 
-		err = dma_mapping_error(vic->dev, phys);
+		err = falcon_load_firmware(&vic->falcon);
 		if (err < 0)
 			goto cleanup;
-
-		vic->falcon.firmware.phys = phys;
 	}
 
 	/*
@@ -470,10 +461,7 @@ unlock:
 	return err;
 
 cleanup:
-	if (!client->group)
-		dma_free_coherent(vic->dev, size, virt, iova);
-	else
-		tegra_drm_free(tegra, size, virt, iova);
+	dma_free_coherent(vic->dev, size, virt, iova);
 
 	mutex_unlock(&lock);
 	return err;
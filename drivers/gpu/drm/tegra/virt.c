@@ -6,6 +6,9 @@
 #include <linux/clk.h>
 #include <linux/debugfs.h>
 #include <linux/host1x-next.h>
+#include <linux/interrupt.h>
+#include <linux/jiffies.h>
+#include <linux/list.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
@@ -13,7 +16,10 @@
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/version.h>
+#include <linux/wait.h>
 
 #include <soc/tegra/virt/hv-ivc.h>
 
@@ -41,19 +47,58 @@ struct tegra_vhost_cmd_msg {
 	struct tegra_vhost_connect_params connect;
 };
 
+/*
+ * A server IVC queue, shared by all engines that use the same queue. The
+ * server answers the messages of a queue in order, so instead of one
+ * request at a time, any number of requests are sent and the replies are
+ * matched to the senders in the order they were written.
+ */
+struct virt_ivc {
+	struct list_head list;
+	struct kref ref;
+
+	struct device_node *hv;
+	u32 instance;
+	struct tegra_hv_ivc_cookie *cookie;
+
+	/* serializes writes to the queue and protects pending */
+	spinlock_t lock;
+	struct list_head pending;
+	wait_queue_head_t tx_wq;
+};
+
+struct virt_ivc_request {
+	struct list_head list;
+	void *data;
+	u32 size;
+	int err;
+	struct completion done;
+};
+
 struct virt_engine {
 	struct device *dev;
 	int connection_id;
 
 	struct tegra_drm_client client;
+	struct virt_ivc *ivc;
 
 	struct dentry *actmon_debugfs_dir;
 	struct clk *clk;
+
+	/* last actmon usage, actmon_usage_lock protects it */
+	struct mutex actmon_usage_lock;
+	unsigned long actmon_usage_updated;
+	bool actmon_usage_valid;
+	int actmon_usage;
 };
 
-static DEFINE_MUTEX(ivc_cookie_lock);
-static struct tegra_hv_ivc_cookie *ivc_cookie;
-static struct kref ivc_ref;
+static unsigned int actmon_usage_cache_ms = 10;
+module_param(actmon_usage_cache_ms, uint, 0644);
+MODULE_PARM_DESC(actmon_usage_cache_ms,
+		 "How long a virtual engine actmon usage reading is reused (0 = never)");
+
+static DEFINE_MUTEX(virt_ivc_list_lock);
+static LIST_HEAD(virt_ivc_list);
 
 static inline struct virt_engine *to_virt_engine(struct tegra_drm_client *client)
 {
@@ -145,92 +190,197 @@ static const struct tegra_drm_client_ops virt_engine_ops = {
 	.has_job_timestamping = virt_engine_has_job_timestamping,
 };
 
-static int virt_engine_setup_ivc(struct virt_engine *virt)
+static irqreturn_t virt_ivc_irq(int irq, void *data)
 {
-	struct device_node *host1x_dn = virt->dev->parent->of_node;
-	struct device_node *hv;
-	u32 ivc_instance;
+	struct virt_ivc *ivc = data;
+	struct virt_ivc_request *req;
+	struct tegra_vhost_cmd_msg stale;
+	unsigned long flags;
 	int err;
 
-	mutex_lock(&ivc_cookie_lock);
+	if (tegra_hv_ivc_channel_notified(ivc->cookie))
+		return IRQ_HANDLED;
 
-	if (ivc_cookie) {
-		err = PTR_ERR_OR_ZERO(ivc_cookie);
-		if (!err)
-			kref_get(&ivc_ref);
-		mutex_unlock(&ivc_cookie_lock);
-		return err;
+	spin_lock_irqsave(&ivc->lock, flags);
+
+	while (tegra_hv_ivc_can_read(ivc->cookie)) {
+		req = list_first_entry_or_null(&ivc->pending,
+					       struct virt_ivc_request, list);
+		if (!req) {
+			/* nobody asked for this, drop it to keep the order */
+			tegra_hv_ivc_read(ivc->cookie, &stale, sizeof(stale));
+			pr_warn_ratelimited("tegra-virt-engine: unexpected IVC reply\n");
+			continue;
+		}
+
+		err = tegra_hv_ivc_read(ivc->cookie, req->data, req->size);
+		req->err = err == req->size ? 0 : -EIO;
+		list_del(&req->list);
+		complete(&req->done);
 	}
 
-	hv = of_parse_phandle(host1x_dn, "nvidia,server-ivc", 0);
-	if (!hv) {
-		dev_err(virt->dev, "nvidia,server-ivc not configured\n");
-		return -EINVAL;
+	spin_unlock_irqrestore(&ivc->lock, flags);
+
+	if (tegra_hv_ivc_can_write(ivc->cookie))
+		wake_up(&ivc->tx_wq);
+
+	return IRQ_HANDLED;
+}
+
+static struct virt_ivc *virt_ivc_get(struct device *dev, struct device_node *hv,
+				     u32 instance)
+{
+	struct virt_ivc *ivc;
+	int err;
+
+	mutex_lock(&virt_ivc_list_lock);
+
+	list_for_each_entry(ivc, &virt_ivc_list, list) {
+		if (ivc->hv == hv && ivc->instance == instance) {
+			kref_get(&ivc->ref);
+			mutex_unlock(&virt_ivc_list_lock);
+			of_node_put(hv);
+			return ivc;
+		}
 	}
 
-	err = of_property_read_u32_index(host1x_dn, "nvidia,server-ivc", 1, &ivc_instance);
-	if (err) {
-		dev_err(virt->dev, "nvidia,server-ivc not configured\n");
-		return -EINVAL;
+	ivc = kzalloc(sizeof(*ivc), GFP_KERNEL);
+	if (!ivc) {
+		err = -ENOMEM;
+		goto unlock;
 	}
 
-	ivc_cookie = tegra_hv_ivc_reserve(hv, ivc_instance, NULL);
-	if (IS_ERR(ivc_cookie)) {
-		dev_err(virt->dev, "IVC channel reservation failed: %ld\n", PTR_ERR(ivc_cookie));
-		return PTR_ERR(ivc_cookie);
+	kref_init(&ivc->ref);
+	spin_lock_init(&ivc->lock);
+	INIT_LIST_HEAD(&ivc->pending);
+	init_waitqueue_head(&ivc->tx_wq);
+	ivc->hv = hv;
+	ivc->instance = instance;
+
+	ivc->cookie = tegra_hv_ivc_reserve(hv, instance, NULL);
+	if (IS_ERR(ivc->cookie)) {
+		err = PTR_ERR(ivc->cookie);
+		dev_err(dev, "IVC channel reservation failed: %d\n", err);
+		goto free;
 	}
 
-	tegra_hv_ivc_channel_reset(ivc_cookie);
+	tegra_hv_ivc_channel_reset(ivc->cookie);
 
-	while (tegra_hv_ivc_channel_notified(ivc_cookie))
+	while (tegra_hv_ivc_channel_notified(ivc->cookie))
 		;
 
-	kref_init(&ivc_ref);
+	err = request_irq(ivc->cookie->irq, virt_ivc_irq, 0,
+			  "tegra-virt-engine", ivc);
+	if (err < 0) {
+		dev_err(dev, "failed to request IVC irq: %d\n", err);
+		goto unreserve;
+	}
 
-	mutex_unlock(&ivc_cookie_lock);
+	list_add_tail(&ivc->list, &virt_ivc_list);
+	mutex_unlock(&virt_ivc_list_lock);
 
-	return 0;
+	return ivc;
+
+unreserve:
+	tegra_hv_ivc_unreserve(ivc->cookie);
+free:
+	kfree(ivc);
+unlock:
+	mutex_unlock(&virt_ivc_list_lock);
+	of_node_put(hv);
+
+	return ERR_PTR(err);
 }
 
-static void release_ivc_cookie(struct kref *ref)
+static void virt_ivc_release(struct kref *ref)
+{
+	struct virt_ivc *ivc = container_of(ref, struct virt_ivc, ref);
+
+	list_del(&ivc->list);
+	mutex_unlock(&virt_ivc_list_lock);
+
+	free_irq(ivc->cookie->irq, ivc);
+	tegra_hv_ivc_unreserve(ivc->cookie);
+	of_node_put(ivc->hv);
+	kfree(ivc);
+}
+
+/*
+ * The queue is taken from the engine node if it has its own, so engines on
+ * separate queues do not wait for each other, and from host1x otherwise.
+ */
+static int virt_engine_setup_ivc(struct virt_engine *virt)
 {
-	(void)ref;
+	struct device_node *np = virt->dev->of_node;
+	struct device_node *hv;
+	u32 ivc_instance;
+	int err;
+
+	if (!of_find_property(np, "nvidia,server-ivc", NULL))
+		np = virt->dev->parent->of_node;
 
-	tegra_hv_ivc_unreserve(ivc_cookie);
-	mutex_unlock(&ivc_cookie_lock);
+	hv = of_parse_phandle(np, "nvidia,server-ivc", 0);
+	if (!hv) {
+		dev_err(virt->dev, "nvidia,server-ivc not configured\n");
+		return -EINVAL;
+	}
+
+	err = of_property_read_u32_index(np, "nvidia,server-ivc", 1, &ivc_instance);
+	if (err) {
+		dev_err(virt->dev, "nvidia,server-ivc not configured\n");
+		of_node_put(hv);
+		return -EINVAL;
+	}
+
+	virt->ivc = virt_ivc_get(virt->dev, hv, ivc_instance);
+	if (IS_ERR(virt->ivc))
+		return PTR_ERR(virt->ivc);
+
+	return 0;
 }
 
-static void virt_engine_cleanup(void)
+static void virt_engine_cleanup(struct virt_engine *virt)
 {
-	kref_put_mutex(&ivc_ref, release_ivc_cookie, &ivc_cookie_lock);
+	kref_put_mutex(&virt->ivc->ref, virt_ivc_release, &virt_ivc_list_lock);
 }
 
-static int virt_engine_transfer(void *data, u32 size)
+/*
+ * Send a message and sleep until its reply was copied back into data. Other
+ * senders on the queue can send their messages in the meantime.
+ */
+static int virt_engine_transfer(struct virt_engine *virt, void *data, u32 size)
 {
+	struct virt_ivc *ivc = virt->ivc;
+	struct virt_ivc_request req = {
+		.data = data,
+		.size = size,
+	};
+	unsigned long flags;
 	int err;
 
-	mutex_lock(&ivc_cookie_lock);
+	init_completion(&req.done);
 
-	while (!tegra_hv_ivc_can_write(ivc_cookie))
-		;
+	for (;;) {
+		spin_lock_irqsave(&ivc->lock, flags);
+		if (tegra_hv_ivc_can_write(ivc->cookie))
+			break;
+		spin_unlock_irqrestore(&ivc->lock, flags);
 
-	err = tegra_hv_ivc_write(ivc_cookie, data, size);
-	if (err != size) {
-		mutex_unlock(&ivc_cookie_lock);
-		return -ENOMEM;
+		wait_event(ivc->tx_wq, tegra_hv_ivc_can_write(ivc->cookie));
 	}
 
-	while (!tegra_hv_ivc_can_read(ivc_cookie))
-		;
+	err = tegra_hv_ivc_write(ivc->cookie, data, size);
+	if (err == size)
+		list_add_tail(&req.list, &ivc->pending);
 
-	err = tegra_hv_ivc_read(ivc_cookie, data, size);
-	if (err != size) {
-		mutex_unlock(&ivc_cookie_lock);
-		return -EIO;
-	}
+	spin_unlock_irqrestore(&ivc->lock, flags);
 
-	mutex_unlock(&ivc_cookie_lock);
-	return 0;
+	if (err != size)
+		return -ENOMEM;
+
+	wait_for_completion(&req.done);
+
+	return req.err;
 }
 
 static int virt_engine_connect(struct virt_engine *virt, u32 module_id)
@@ -241,7 +391,7 @@ static int virt_engine_connect(struct virt_engine *virt, u32 module_id)
 	msg.cmd = TEGRA_VHOST_CMD_CONNECT;
 	msg.connect.module = module_id;
 
-	err = virt_engine_transfer(&msg, sizeof(msg));
+	err = virt_engine_transfer(virt, &msg, sizeof(msg));
 	if (err < 0)
 		return err;
 
@@ -256,7 +406,7 @@ static int virt_engine_suspend(struct device *dev)
 	msg.cmd = TEGRA_VHOST_CMD_SUSPEND;
 	msg.connection_id = virt->connection_id;
 
-	return virt_engine_transfer(&msg, sizeof(msg));
+	return virt_engine_transfer(virt, &msg, sizeof(msg));
 }
 
 static int virt_engine_resume(struct device *dev)
@@ -267,21 +417,18 @@ static int virt_engine_resume(struct device *dev)
 	msg.cmd = TEGRA_VHOST_CMD_RESUME;
 	msg.connection_id = virt->connection_id;
 
-	return virt_engine_transfer(&msg, sizeof(msg));
+	return virt_engine_transfer(virt, &msg, sizeof(msg));
 }
 
-static int actmon_debugfs_usage_show(struct seq_file *s, void *unused)
+static int virt_engine_read_actmon_usage(struct virt_engine *virt)
 {
-	struct virt_engine *virt = s->private;
 	unsigned long rate;
 	int cycles_per_actmon_sample;
 	int count;
 
 	rate = clk_get_rate(virt->clk);
-	if (rate == 0) {
-		seq_printf(s, "0\n");
+	if (rate == 0)
 		return 0;
-	}
 
 	count = host1x_actmon_read_avg_count(&virt->client.base);
 	if (count < 0)
@@ -291,8 +438,45 @@ static int actmon_debugfs_usage_show(struct seq_file *s, void *unused)
 #define ACTMON_SAMPLE_PERIOD_US		100
 	/* Rate in MHz cancels out microseconds */
 	cycles_per_actmon_sample = (rate / 1000000) * ACTMON_SAMPLE_PERIOD_US;
+	if (cycles_per_actmon_sample == 0)
+		return 0;
+
+	return (count * 1000) / cycles_per_actmon_sample;
+}
+
+/*
+ * The clock rate may take a trip to the server, and the actmon average only
+ * moves slowly anyway, so readers polling usage share one reading for
+ * actmon_usage_cache_ms.
+ */
+static int actmon_debugfs_usage_show(struct seq_file *s, void *unused)
+{
+	struct virt_engine *virt = s->private;
+	unsigned int cache_ms = READ_ONCE(actmon_usage_cache_ms);
+	int usage;
+
+	mutex_lock(&virt->actmon_usage_lock);
+
+	if (!virt->actmon_usage_valid || !cache_ms ||
+	    time_after(jiffies, virt->actmon_usage_updated +
+		       msecs_to_jiffies(cache_ms))) {
+		usage = virt_engine_read_actmon_usage(virt);
+		if (usage < 0) {
+			virt->actmon_usage_valid = false;
+			mutex_unlock(&virt->actmon_usage_lock);
+			return usage;
+		}
+
+		virt->actmon_usage = usage;
+		virt->actmon_usage_updated = jiffies;
+		virt->actmon_usage_valid = true;
+	}
+
+	usage = virt->actmon_usage;
+
+	mutex_unlock(&virt->actmon_usage_lock);
 
-	seq_printf(s, "%d\n", (count * 1000) / cycles_per_actmon_sample);
+	seq_printf(s, "%d\n", usage);
 
 	return 0;
 }
@@ -461,6 +645,7 @@ static int virt_engine_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	platform_set_drvdata(pdev, virt);
+	mutex_init(&virt->actmon_usage_lock);
 
 	virt->clk = devm_clk_get_optional(&pdev->dev, NULL);
 	if (IS_ERR(virt->clk)) {
@@ -521,7 +706,7 @@ static int virt_engine_probe(struct platform_device *pdev)
 	return 0;
 
 cleanup_ivc:
-	virt_engine_cleanup();
+	virt_engine_cleanup(virt);
 unregister_client:
 	host1x_client_unregister(&virt->client.base);
 
@@ -548,7 +733,7 @@ static int virt_engine_remove(struct platform_device *pdev)
 	}
 #endif
 	virt_engine_cleanup_actmon_debugfs(virt_engine);
-	virt_engine_cleanup();
+	virt_engine_cleanup(virt_engine);
 
 	host1x_client_unregister(&virt_engine->client.base);
 
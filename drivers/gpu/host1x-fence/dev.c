@@ -4,10 +4,13 @@
 #include <nvidia/conftest.h>
 
 #include <linux/anon_inodes.h>
+#include <linux/atomic.h>
+#include <linux/bitops.h>
 #include <linux/cdev.h>
 #include <linux/file.h>
 #include <linux/fs.h>
 #include <linux/host1x-next.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
@@ -15,6 +18,7 @@
 #include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/sync_file.h>
+#include <linux/vmalloc.h>
 
 #include "include/uapi/linux/host1x-fence.h"
 
@@ -110,26 +114,119 @@ static int dev_file_ioctl_create_fence(struct host1x *host1x, void __user *data)
 	return 0;
 }
 
-static int dev_file_ioctl_fence_extract(struct host1x *host1x, void __user *data)
+static int dev_file_ioctl_create_fences(struct host1x *host1x, void __user *data)
 {
-	struct host1x_fence_extract_fence __user *fences_user_ptr;
-	struct dma_fence *fence, **fences;
-	struct host1x_fence_extract args;
-	struct dma_fence_array *array;
-	unsigned int num_fences, i, j;
+	struct host1x_create_fence *fences;
+	struct host1x_create_fences args;
+	struct host1x_syncpt *syncpt;
+	struct sync_file **files;
 	unsigned long copy_err;
+	struct dma_fence *f;
+	unsigned int i;
 	int err;
 
 	copy_err = copy_from_user(&args, data, sizeof(args));
 	if (copy_err)
 		return -EFAULT;
 
-	fences_user_ptr = u64_to_user_ptr(args.fences_ptr);
-
-	if (args.reserved[0] || args.reserved[1])
+	if (args.reserved || args.num_fences > HOST1X_FENCE_MAX_BATCH)
 		return -EINVAL;
 
-	fence = sync_file_get_fence(args.fence_fd);
+	if (!args.num_fences)
+		return 0;
+
+	fences = kvmalloc_array(args.num_fences, sizeof(*fences), GFP_KERNEL);
+	files = kvcalloc(args.num_fences, sizeof(*files), GFP_KERNEL);
+	if (!fences || !files) {
+		err = -ENOMEM;
+		goto free;
+	}
+
+	copy_err = copy_from_user(fences, u64_to_user_ptr(args.fences_ptr),
+				  args.num_fences * sizeof(*fences));
+	if (copy_err) {
+		err = -EFAULT;
+		goto free;
+	}
+
+	/*
+	 * Reserve the fds and build all sync_files first and install them
+	 * only once nothing can fail anymore, so a failing batch leaves no
+	 * fds behind in the process.
+	 */
+	for (i = 0; i < args.num_fences; i++) {
+		if (fences[i].reserved[0]) {
+			err = -EINVAL;
+			goto unwind;
+		}
+
+		syncpt = host1x_syncpt_get_by_id_noref(host1x, fences[i].id);
+		if (!syncpt) {
+			err = -EINVAL;
+			goto unwind;
+		}
+
+		f = host1x_fence_create(syncpt, fences[i].threshold, true);
+		if (IS_ERR(f)) {
+			err = PTR_ERR(f);
+			goto unwind;
+		}
+
+		files[i] = sync_file_create(f);
+		dma_fence_put(f);
+		if (!files[i]) {
+			err = -ENOMEM;
+			goto unwind;
+		}
+
+		fences[i].fence_fd = get_unused_fd_flags(O_CLOEXEC);
+		if (fences[i].fence_fd < 0) {
+			err = fences[i].fence_fd;
+			fput(files[i]->file);
+			goto unwind;
+		}
+	}
+
+	copy_err = copy_to_user(u64_to_user_ptr(args.fences_ptr), fences,
+				args.num_fences * sizeof(*fences));
+	if (copy_err) {
+		err = -EFAULT;
+		goto unwind;
+	}
+
+	for (i = 0; i < args.num_fences; i++)
+		fd_install(fences[i].fence_fd, files[i]->file);
+
+	err = 0;
+	goto free;
+
+unwind:
+	while (i--) {
+		put_unused_fd(fences[i].fence_fd);
+		fput(files[i]->file);
+	}
+free:
+	kvfree(files);
+	kvfree(fences);
+
+	return err;
+}
+
+/*
+ * Store the host1x fences of sync_file fence_fd into the first capacity
+ * elements of fences_user_ptr, *count receives how many there are.
+ */
+static int host1x_fence_extract_fd(int fence_fd,
+				   struct host1x_fence_extract_fence __user *fences_user_ptr,
+				   u32 capacity, u32 *count)
+{
+	struct dma_fence *fence, **fences;
+	struct dma_fence_array *array;
+	unsigned int num_fences, i, j;
+	unsigned long copy_err;
+	int err = 0;
+
+	fence = sync_file_get_fence(fence_fd);
 	if (!fence)
 		return -EINVAL;
 
@@ -148,12 +245,13 @@ static int dev_file_ioctl_fence_extract(struct host1x *host1x, void __user *data
 		err = host1x_fence_extract(fences[i], &f.id, &f.threshold);
 		if (err == -EINVAL && dma_fence_is_signaled(fences[i])) {
 			/* Likely stub fence */
+			err = 0;
 			continue;
 		} else if (err) {
 			goto put_fence;
 		}
 
-		if (j < args.num_fences) {
+		if (j < capacity) {
 			copy_err = copy_to_user(fences_user_ptr + j, &f, sizeof(f));
 			if (copy_err) {
 				err = -EFAULT;
@@ -164,20 +262,89 @@ static int dev_file_ioctl_fence_extract(struct host1x *host1x, void __user *data
 		j++;
 	}
 
-	args.num_fences = j;
+	*count = j;
+
+put_fence:
+	dma_fence_put(fence);
+
+	return err;
+}
+
+static int dev_file_ioctl_fence_extract(struct host1x *host1x, void __user *data)
+{
+	struct host1x_fence_extract args;
+	unsigned long copy_err;
+	u32 count;
+	int err;
+
+	copy_err = copy_from_user(&args, data, sizeof(args));
+	if (copy_err)
+		return -EFAULT;
+
+	if (args.reserved[0] || args.reserved[1])
+		return -EINVAL;
+
+	err = host1x_fence_extract_fd(args.fence_fd, u64_to_user_ptr(args.fences_ptr),
+				      args.num_fences, &count);
+	if (err)
+		return err;
+
+	args.num_fences = count;
 
 	copy_err = copy_to_user(data, &args, sizeof(args));
-	if (copy_err) {
-		err = -EFAULT;
-		goto put_fence;
-	}
+	if (copy_err)
+		return -EFAULT;
 
 	return 0;
+}
 
-put_fence:
-	dma_fence_put(fence);
+static int dev_file_ioctl_fence_extract_multi(struct host1x *host1x, void __user *data)
+{
+	struct host1x_fence_extract_fence __user *fences_user_ptr;
+	struct host1x_fence_extract_multi args;
+	s32 __user *fds_user_ptr;
+	u32 __user *counts_user_ptr;
+	unsigned long copy_err;
+	u32 total = 0, count;
+	unsigned int i;
+	s32 fd;
+	int err;
 
-	return err;
+	copy_err = copy_from_user(&args, data, sizeof(args));
+	if (copy_err)
+		return -EFAULT;
+
+	if (args.num_fds > HOST1X_FENCE_MAX_BATCH)
+		return -EINVAL;
+
+	fds_user_ptr = u64_to_user_ptr(args.fds_ptr);
+	fences_user_ptr = u64_to_user_ptr(args.fences_ptr);
+	counts_user_ptr = u64_to_user_ptr(args.counts_ptr);
+
+	for (i = 0; i < args.num_fds; i++) {
+		if (get_user(fd, fds_user_ptr + i))
+			return -EFAULT;
+
+		err = host1x_fence_extract_fd(fd, fences_user_ptr + total,
+					      total < args.num_fences ?
+						args.num_fences - total : 0,
+					      &count);
+		if (err)
+			return err;
+
+		if (counts_user_ptr && put_user(count, counts_user_ptr + i))
+			return -EFAULT;
+
+		total += count;
+	}
+
+	args.num_fences = total;
+
+	copy_err = copy_to_user(data, &args, sizeof(args));
+	if (copy_err)
+		return -EFAULT;
+
+	return 0;
 }
 
 struct host1x_pollfd_fence {
@@ -324,45 +491,23 @@ static void host1x_pollfd_callback(struct dma_fence *fence, struct dma_fence_cb
 	wake_up_all(pfd_fence->wq);
 }
 
-static int dev_file_ioctl_trigger_pollfd(struct host1x *host1x, void __user *data)
+static int host1x_pollfd_add_fence(struct host1x *host1x, struct host1x_pollfd *pollfd,
+				   u32 id, u32 threshold)
 {
 	struct host1x_pollfd_fence *pfd_fence;
-	struct host1x_trigger_pollfd args;
 	struct host1x_syncpt *syncpt;
-	struct host1x_pollfd *pollfd;
 	struct dma_fence *fence;
-	unsigned long copy_err;
-	struct file *file;
 	int err;
 
-	copy_err = copy_from_user(&args, data, sizeof(args));
-	if (copy_err)
-		return -EFAULT;
-
-	file = fget(args.fd);
-	if (!file)
+	syncpt = host1x_syncpt_get_by_id_noref(host1x, id);
+	if (!syncpt)
 		return -EINVAL;
 
-	if (file->f_op != &host1x_pollfd_ops) {
-		err = -EINVAL;
-		goto put_file;
-	}
-
-	pollfd = file->private_data;
-
-	syncpt = host1x_syncpt_get_by_id_noref(host1x, args.id);
-	if (!syncpt) {
-		err = -EINVAL;
-		goto put_file;
-	}
-
 	pfd_fence = kzalloc(sizeof(*pfd_fence), GFP_KERNEL);
-	if (!pfd_fence) {
-		err = -ENOMEM;
-		goto put_file;
-	}
+	if (!pfd_fence)
+		return -ENOMEM;
 
-	fence = host1x_fence_create(syncpt, args.threshold, false);
+	fence = host1x_fence_create(syncpt, threshold, false);
 	if (IS_ERR(fence)) {
 		err = PTR_ERR(fence);
 		goto free_pfd_fence;
@@ -398,12 +543,334 @@ remove_fence:
 	dma_fence_put(fence);
 free_pfd_fence:
 	kfree(pfd_fence);
-put_file:
+
+	return err;
+}
+
+static struct file *host1x_pollfd_fget(int fd)
+{
+	struct file *file;
+
+	file = fget(fd);
+	if (!file)
+		return NULL;
+
+	if (file->f_op != &host1x_pollfd_ops) {
+		fput(file);
+		return NULL;
+	}
+
+	return file;
+}
+
+static int dev_file_ioctl_trigger_pollfd(struct host1x *host1x, void __user *data)
+{
+	struct host1x_trigger_pollfd args;
+	unsigned long copy_err;
+	struct file *file;
+	int err;
+
+	copy_err = copy_from_user(&args, data, sizeof(args));
+	if (copy_err)
+		return -EFAULT;
+
+	file = host1x_pollfd_fget(args.fd);
+	if (!file)
+		return -EINVAL;
+
+	err = host1x_pollfd_add_fence(host1x, file->private_data, args.id, args.threshold);
+
 	fput(file);
 
 	return err;
 }
 
+static int dev_file_ioctl_trigger_pollfd_multi(struct host1x *host1x, void __user *data)
+{
+	struct host1x_fence_extract_fence __user *fences_user_ptr;
+	struct host1x_trigger_pollfd_multi args;
+	struct host1x_fence_extract_fence f;
+	unsigned long copy_err;
+	struct file *file;
+	unsigned int i;
+	int err = 0;
+
+	copy_err = copy_from_user(&args, data, sizeof(args));
+	if (copy_err)
+		return -EFAULT;
+
+	if (args.num_fences > HOST1X_FENCE_MAX_BATCH)
+		return -EINVAL;
+
+	file = host1x_pollfd_fget(args.fd);
+	if (!file)
+		return -EINVAL;
+
+	fences_user_ptr = u64_to_user_ptr(args.fences_ptr);
+
+	for (i = 0; i < args.num_fences; i++) {
+		copy_err = copy_from_user(&f, fences_user_ptr + i, sizeof(f));
+		if (copy_err) {
+			err = -EFAULT;
+			break;
+		}
+
+		err = host1x_pollfd_add_fence(host1x, file->private_data, f.id, f.threshold);
+		if (err)
+			break;
+	}
+
+	fput(file);
+
+	return err;
+}
+
+/*
+ * Pollfd waiting for a fixed set of fences. Completion of each fence is
+ * recorded in a bitmap that userspace reads or maps, so a whole frame
+ * worth of fences is waited for and checked with a single poll.
+ */
+struct host1x_wait_pollfd_fence {
+	struct host1x_wait_pollfd *pollfd;
+	unsigned int index;
+
+	struct dma_fence *fence;
+	struct dma_fence_cb callback;
+	bool callback_set;
+};
+
+struct host1x_wait_pollfd {
+	wait_queue_head_t wq;
+	bool wait_all;
+
+	unsigned int num_fences;
+	atomic_t pending;
+
+	/* vmalloc_user(), page aligned for mmap */
+	unsigned long *bitmap;
+	size_t bitmap_size;
+
+	struct host1x_wait_pollfd_fence fences[];
+};
+
+static void host1x_wait_pollfd_complete(struct host1x_wait_pollfd *pollfd,
+					unsigned int index)
+{
+	set_bit(index, pollfd->bitmap);
+
+	if (atomic_dec_and_test(&pollfd->pending) || !pollfd->wait_all)
+		wake_up_all(&pollfd->wq);
+}
+
+static void host1x_wait_pollfd_callback(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct host1x_wait_pollfd_fence *wfd_fence =
+		container_of(cb, struct host1x_wait_pollfd_fence, callback);
+
+	host1x_wait_pollfd_complete(wfd_fence->pollfd, wfd_fence->index);
+}
+
+static void host1x_wait_pollfd_free(struct host1x_wait_pollfd *pollfd)
+{
+	struct host1x_wait_pollfd_fence *wfd_fence;
+	unsigned int i;
+
+	for (i = 0; i < pollfd->num_fences; i++) {
+		wfd_fence = &pollfd->fences[i];
+
+		if (!wfd_fence->fence)
+			continue;
+
+		if (wfd_fence->callback_set) {
+			if (dma_fence_remove_callback(wfd_fence->fence, &wfd_fence->callback))
+				host1x_fence_cancel(wfd_fence->fence);
+			wfd_fence->callback_set = false;
+		}
+		/*The lock/unlock just ensures that the callback execution has finished*/
+		spin_lock(wfd_fence->fence->lock);
+		spin_unlock(wfd_fence->fence->lock);
+
+		dma_fence_put(wfd_fence->fence);
+	}
+
+	vfree(pollfd->bitmap);
+	kvfree(pollfd);
+}
+
+static int host1x_wait_pollfd_release(struct inode *inode, struct file *file)
+{
+	host1x_wait_pollfd_free(file->private_data);
+
+	return 0;
+}
+
+static unsigned int host1x_wait_pollfd_poll(struct file *file, poll_table *wait)
+{
+	struct host1x_wait_pollfd *pollfd = file->private_data;
+	unsigned int pending;
+
+	poll_wait(file, &pollfd->wq, wait);
+
+	pending = atomic_read(&pollfd->pending);
+
+	if (pending == 0 || (!pollfd->wait_all && pending < pollfd->num_fences))
+		return POLLPRI | POLLIN;
+
+	return 0;
+}
+
+static ssize_t host1x_wait_pollfd_read(struct file *file, char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	struct host1x_wait_pollfd *pollfd = file->private_data;
+	loff_t pos = 0;
+
+	/* Always the whole bitmap from its start, the file offset is ignored */
+	return simple_read_from_buffer(buf, count, &pos, pollfd->bitmap,
+				       BITS_TO_LONGS(pollfd->num_fences) * sizeof(long));
+}
+
+static int host1x_wait_pollfd_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct host1x_wait_pollfd *pollfd = file->private_data;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	return remap_vmalloc_range(vma, pollfd->bitmap, 0);
+}
+
+static const struct file_operations host1x_wait_pollfd_ops = {
+	.release = host1x_wait_pollfd_release,
+	.poll = host1x_wait_pollfd_poll,
+	.read = host1x_wait_pollfd_read,
+	.mmap = host1x_wait_pollfd_mmap,
+	.llseek = noop_llseek,
+};
+
+static int dev_file_ioctl_create_wait_pollfd(struct host1x *host1x, void __user *data)
+{
+	struct host1x_fence_extract_fence __user *fences_user_ptr;
+	struct host1x_wait_pollfd_fence *wfd_fence;
+	struct host1x_create_wait_pollfd args;
+	struct host1x_fence_extract_fence f;
+	struct host1x_wait_pollfd *pollfd;
+	struct host1x_syncpt *syncpt;
+	unsigned long copy_err;
+	struct file *file;
+	unsigned int i;
+	int fd, err;
+
+	copy_err = copy_from_user(&args, data, sizeof(args));
+	if (copy_err)
+		return -EFAULT;
+
+	if (args.reserved || args.flags & ~HOST1X_WAIT_POLLFD_FLAGS_WAIT_ALL)
+		return -EINVAL;
+
+	if (!args.num_fences || args.num_fences > HOST1X_FENCE_MAX_BATCH)
+		return -EINVAL;
+
+	pollfd = kvzalloc(struct_size(pollfd, fences, args.num_fences), GFP_KERNEL);
+	if (!pollfd)
+		return -ENOMEM;
+
+	init_waitqueue_head(&pollfd->wq);
+	pollfd->wait_all = args.flags & HOST1X_WAIT_POLLFD_FLAGS_WAIT_ALL;
+	pollfd->num_fences = args.num_fences;
+	atomic_set(&pollfd->pending, args.num_fences);
+
+	pollfd->bitmap = vmalloc_user(BITS_TO_LONGS(args.num_fences) * sizeof(long));
+	if (!pollfd->bitmap) {
+		kvfree(pollfd);
+		return -ENOMEM;
+	}
+
+	fences_user_ptr = u64_to_user_ptr(args.fences_ptr);
+
+	for (i = 0; i < args.num_fences; i++) {
+		wfd_fence = &pollfd->fences[i];
+
+		copy_err = copy_from_user(&f, fences_user_ptr + i, sizeof(f));
+		if (copy_err) {
+			err = -EFAULT;
+			goto free_pollfd;
+		}
+
+		syncpt = host1x_syncpt_get_by_id_noref(host1x, f.id);
+		if (!syncpt) {
+			err = -EINVAL;
+			goto free_pollfd;
+		}
+
+		wfd_fence->fence = host1x_fence_create(syncpt, f.threshold, false);
+		if (IS_ERR(wfd_fence->fence)) {
+			err = PTR_ERR(wfd_fence->fence);
+			wfd_fence->fence = NULL;
+			goto free_pollfd;
+		}
+
+		wfd_fence->pollfd = pollfd;
+		wfd_fence->index = i;
+	}
+
+	/*
+	 * Arm the callbacks only once all fences exist, the bitmap and the
+	 * pending count are not touched on the error paths above.
+	 */
+	for (i = 0; i < args.num_fences; i++) {
+		wfd_fence = &pollfd->fences[i];
+
+		err = dma_fence_add_callback(wfd_fence->fence, &wfd_fence->callback,
+					     host1x_wait_pollfd_callback);
+		if (err == -ENOENT) {
+			host1x_wait_pollfd_complete(pollfd, i);
+			continue;
+		} else if (err != 0) {
+			goto free_pollfd;
+		}
+		wfd_fence->callback_set = true;
+	}
+
+	file = anon_inode_getfile("host1x_wait_pollfd", &host1x_wait_pollfd_ops,
+				  pollfd, O_RDONLY);
+	if (IS_ERR(file)) {
+		err = PTR_ERR(file);
+		goto free_pollfd;
+	}
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		/* Release frees the pollfd */
+		fput(file);
+		return fd;
+	}
+
+	args.fd = fd;
+
+	copy_err = copy_to_user(data, &args, sizeof(args));
+	if (copy_err) {
+		put_unused_fd(fd);
+		fput(file);
+		return -EFAULT;
+	}
+
+	fd_install(fd, file);
+
+	return 0;
+
+free_pollfd:
+	host1x_wait_pollfd_free(pollfd);
+
+	return err;
+}
+
 static long dev_file_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
@@ -415,6 +882,10 @@ static long dev_file_ioctl(struct file *file, unsigned int cmd,
 		err = dev_file_ioctl_create_fence(file->private_data, data);
 		break;
 
+	case HOST1X_IOCTL_CREATE_FENCES:
+		err = dev_file_ioctl_create_fences(file->private_data, data);
+		break;
+
 	case HOST1X_IOCTL_CREATE_POLLFD:
 		err = dev_file_ioctl_create_pollfd(file->private_data, data);
 		break;
@@ -423,10 +894,22 @@ static long dev_file_ioctl(struct file *file, unsigned int cmd,
 		err = dev_file_ioctl_trigger_pollfd(file->private_data, data);
 		break;
 
+	case HOST1X_IOCTL_TRIGGER_POLLFD_MULTI:
+		err = dev_file_ioctl_trigger_pollfd_multi(file->private_data, data);
+		break;
+
+	case HOST1X_IOCTL_CREATE_WAIT_POLLFD:
+		err = dev_file_ioctl_create_wait_pollfd(file->private_data, data);
+		break;
+
 	case HOST1X_IOCTL_FENCE_EXTRACT:
 		err = dev_file_ioctl_fence_extract(file->private_data, data);
 		break;
 
+	case HOST1X_IOCTL_FENCE_EXTRACT_MULTI:
+		err = dev_file_ioctl_fence_extract_multi(file->private_data, data);
+		break;
+
 	default:
 		err = -ENOTTY;
 	}
@@ -41,6 +41,30 @@ struct host1x_create_fence {
 	__u32 reserved[1];
 };
 
+/* Upper bound of the array length of the batched ioctls */
+#define HOST1X_FENCE_MAX_BATCH	4096
+
+struct host1x_create_fences {
+	/**
+	 * @num_fences: [in]
+	 *
+	 * Number of elements in the `fences_ptr` array, at most
+	 * HOST1X_FENCE_MAX_BATCH.
+	 */
+	__u32 num_fences;
+
+	__u32 reserved;
+
+	/**
+	 * @fences_ptr: [in]
+	 *
+	 * Pointer to array of `struct host1x_create_fence`. For every
+	 * element `id` and `threshold` are read and `fence_fd` is written
+	 * back. Either all fences are created or none.
+	 */
+	__u64 fences_ptr;
+};
+
 struct host1x_fence_extract_fence {
 	__u32 id;
 	__u32 threshold;
@@ -72,6 +96,48 @@ struct host1x_fence_extract {
 	__u32 reserved[2];
 };
 
+struct host1x_fence_extract_multi {
+	/**
+	 * @num_fds: [in]
+	 *
+	 * Number of sync_file file descriptors in `fds_ptr`, at most
+	 * HOST1X_FENCE_MAX_BATCH.
+	 */
+	__u32 num_fds;
+
+	/**
+	 * @num_fences: [in,out]
+	 *
+	 * In: size of the `fences_ptr` array counted in elements.
+	 * Out: required size of the `fences_ptr` array counted in elements.
+	 */
+	__u32 num_fences;
+
+	/**
+	 * @fds_ptr: [in]
+	 *
+	 * Pointer to array of __s32 sync_file file descriptors.
+	 */
+	__u64 fds_ptr;
+
+	/**
+	 * @fences_ptr: [in]
+	 *
+	 * Pointer to array of `struct host1x_fence_extract_fence`. The
+	 * fences of all sync_files are stored back to back in `fds_ptr`
+	 * order.
+	 */
+	__u64 fences_ptr;
+
+	/**
+	 * @counts_ptr: [in]
+	 *
+	 * Optional pointer to array of `num_fds` __u32, receives the number
+	 * of fences of each sync_file.
+	 */
+	__u64 counts_ptr;
+};
+
 struct host1x_create_pollfd {
 	__s32 fd;
 	__u32 reserved;
@@ -84,10 +150,82 @@ struct host1x_trigger_pollfd {
 	__u32 reserved;
 };
 
+struct host1x_trigger_pollfd_multi {
+	/**
+	 * @fd: [in]
+	 *
+	 * Pollfd created with HOST1X_IOCTL_CREATE_POLLFD.
+	 */
+	__s32 fd;
+
+	/**
+	 * @num_fences: [in]
+	 *
+	 * Number of elements in the `fences_ptr` array, at most
+	 * HOST1X_FENCE_MAX_BATCH.
+	 */
+	__u32 num_fences;
+
+	/**
+	 * @fences_ptr: [in]
+	 *
+	 * Pointer to array of `struct host1x_fence_extract_fence`, each one
+	 * is added to the pollfd as with HOST1X_IOCTL_TRIGGER_POLLFD. On
+	 * error the elements before the failing one stay added.
+	 */
+	__u64 fences_ptr;
+};
+
+/* Readable once all fences have completed, instead of any of them */
+#define HOST1X_WAIT_POLLFD_FLAGS_WAIT_ALL	(1 << 0)
+
+struct host1x_create_wait_pollfd {
+	/**
+	 * @num_fences: [in]
+	 *
+	 * Number of elements in the `fences_ptr` array, at most
+	 * HOST1X_FENCE_MAX_BATCH.
+	 */
+	__u32 num_fences;
+
+	/**
+	 * @flags: [in]
+	 *
+	 * HOST1X_WAIT_POLLFD_FLAGS_*
+	 */
+	__u32 flags;
+
+	/**
+	 * @fences_ptr: [in]
+	 *
+	 * Pointer to array of `struct host1x_fence_extract_fence` to wait
+	 * for.
+	 */
+	__u64 fences_ptr;
+
+	/**
+	 * @fd: [out]
+	 *
+	 * New pollfd. It polls readable once any (or with WAIT_ALL every)
+	 * fence has completed. Which fences have completed is reported as a
+	 * bitmap of __u64 words, bit N of word N / 64 standing for element
+	 * N of `fences_ptr`. The bitmap is returned by read(), always from
+	 * its start, and can be mmap()ed read-only to follow it without
+	 * syscalls.
+	 */
+	__s32 fd;
+
+	__u32 reserved;
+};
+
 #define HOST1X_IOCTL_CREATE_FENCE        _IOWR('X', 0x02, struct host1x_create_fence)
+#define HOST1X_IOCTL_CREATE_FENCES       _IOWR('X', 0x03, struct host1x_create_fences)
 #define HOST1X_IOCTL_FENCE_EXTRACT       _IOWR('X', 0x05, struct host1x_fence_extract)
+#define HOST1X_IOCTL_FENCE_EXTRACT_MULTI _IOWR('X', 0x06, struct host1x_fence_extract_multi)
 #define HOST1X_IOCTL_CREATE_POLLFD       _IOWR('X', 0x10, struct host1x_create_pollfd)
 #define HOST1X_IOCTL_TRIGGER_POLLFD      _IOWR('X', 0x11, struct host1x_trigger_pollfd)
+#define HOST1X_IOCTL_TRIGGER_POLLFD_MULTI _IOWR('X', 0x12, struct host1x_trigger_pollfd_multi)
+#define HOST1X_IOCTL_CREATE_WAIT_POLLFD  _IOWR('X', 0x13, struct host1x_create_wait_pollfd)
 
 #if defined(__cplusplus)
 }
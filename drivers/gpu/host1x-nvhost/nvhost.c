@@ -290,6 +290,19 @@ bool nvhost_syncpt_is_valid_pt_ext(struct platform_device *pdev, u32 id)
 }
 EXPORT_SYMBOL(nvhost_syncpt_is_valid_pt_ext);
 
+/*
+ * The cached minimum only moves forward and is refreshed on every syncpoint
+ * interrupt, so a threshold it has passed is expired without reading the
+ * register.
+ */
+static bool nvhost_syncpt_expired(struct host1x_syncpt *sp, u32 thresh)
+{
+	if ((s32)(host1x_syncpt_read_min(sp) - thresh) >= 0)
+		return true;
+
+	return (s32)(host1x_syncpt_read(sp) - thresh) >= 0;
+}
+
 int nvhost_syncpt_is_expired_ext(struct platform_device *pdev, u32 id,
 				 u32 thresh)
 {
@@ -300,27 +313,32 @@ int nvhost_syncpt_is_expired_ext(struct platform_device *pdev, u32 id,
 	if (WARN_ON(!sp))
 		return true;
 
-	if (host1x_syncpt_wait(sp, thresh, 0, NULL))
-		return false;
-
-	return true;
+	return nvhost_syncpt_expired(sp, thresh);
 }
 EXPORT_SYMBOL(nvhost_syncpt_is_expired_ext);
 
+static void nvhost_syncpt_incr_to(struct host1x_syncpt *sp, u32 val)
+{
+	u32 cur = host1x_syncpt_read(sp);
+
+	/* never wrap a syncpoint that is already past val */
+	while ((s32)(val - cur) > 0) {
+		if (host1x_syncpt_incr(sp))
+			break;
+		cur++;
+	}
+}
+
 void nvhost_syncpt_set_minval(struct platform_device *pdev, u32 id, u32 val)
 {
 	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
 	struct host1x_syncpt *sp;
-	u32 cur;
 
 	sp = host1x_syncpt_get_by_id_noref(pdata->host1x, id);
 	if (WARN_ON(!sp))
 		return;
 
-	cur = host1x_syncpt_read(sp);
-
-	while (cur++ != val)
-		host1x_syncpt_incr(sp);
+	nvhost_syncpt_incr_to(sp, val);
 }
 EXPORT_SYMBOL(nvhost_syncpt_set_minval);
 
@@ -328,16 +346,12 @@ void nvhost_syncpt_set_min_update(struct platform_device *pdev, u32 id, u32 val)
 {
 	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
 	struct host1x_syncpt *sp;
-	u32 cur;
 
 	sp = host1x_syncpt_get_by_id_noref(pdata->host1x, id);
 	if (WARN_ON(!sp))
 		return;
 
-	cur = host1x_syncpt_read(sp);
-
-	while (cur++ != val)
-		host1x_syncpt_incr(sp);
+	nvhost_syncpt_incr_to(sp, val);
 
 	host1x_syncpt_read(sp);
 }
@@ -357,6 +371,29 @@ int nvhost_syncpt_read_ext_check(struct platform_device *pdev, u32 id, u32 *val)
 }
 EXPORT_SYMBOL(nvhost_syncpt_read_ext_check);
 
+/*
+ * Read @num syncpoints of one client with a single device lookup. Stops at
+ * the first invalid ID.
+ */
+int nvhost_syncpt_read_ext_batch(struct platform_device *pdev, const u32 *ids,
+				 u32 *vals, unsigned int num)
+{
+	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
+	struct host1x_syncpt *sp;
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		sp = host1x_syncpt_get_by_id_noref(pdata->host1x, ids[i]);
+		if (!sp)
+			return -EINVAL;
+
+		vals[i] = host1x_syncpt_read(sp);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(nvhost_syncpt_read_ext_batch);
+
 u32 nvhost_syncpt_read_maxval(struct platform_device *pdev, u32 id)
 {
 	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
@@ -725,25 +762,35 @@ int nvhost_intr_register_notifier(struct platform_device *pdev,
 	if (!sp)
 		return -EINVAL;
 
-	fence = host1x_fence_create(sp, thresh, true);
-	if (IS_ERR(fence)) {
-		pr_err("error %d during construction of fence!",
-			(int)PTR_ERR(fence));
-		return PTR_ERR(fence);
-	}
-
 	cb = kzalloc(sizeof(*cb), GFP_KERNEL);
-	if (!cb) {
-		dma_fence_put(fence);
+	if (!cb)
 		return -ENOMEM;
-	}
 
 	INIT_WORK(&cb->work, nvhost_intr_do_work);
 	cb->notifier = callback;
 	cb->notifier_data = private_data;
 
+	/* no fence for a threshold that has already been reached */
+	if (nvhost_syncpt_expired(sp, thresh)) {
+		schedule_work(&cb->work);
+		return 0;
+	}
+
+	fence = host1x_fence_create(sp, thresh, true);
+	if (IS_ERR(fence)) {
+		pr_err("error %d during construction of fence!",
+			(int)PTR_ERR(fence));
+		kfree(cb);
+		return PTR_ERR(fence);
+	}
+
 	err = dma_fence_add_callback(fence, &cb->cb, nvhost_host1x_cb_func);
-	if (err < 0) {
+	if (err == -ENOENT) {
+		/* expired since the check above */
+		dma_fence_put(fence);
+		schedule_work(&cb->work);
+		return 0;
+	} else if (err < 0) {
 		dma_fence_put(fence);
 		kfree(cb);
 	}
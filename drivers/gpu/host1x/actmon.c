@@ -10,11 +10,17 @@
 #include <linux/errno.h>
 #include <linux/fs.h>
 #include <linux/host1x-next.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 
 #include "dev.h"
 #include "actmon.h"
 #include "hw/actmon.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/host1x_actmon.h>
+#undef CREATE_TRACE_POINTS
+
 static void actmon_writel(struct host1x_actmon *actmon, u32 val, u32 offset)
 {
 	writel(val, actmon->regs+offset);
@@ -82,6 +88,64 @@ DEFINE_SIMPLE_ATTRIBUTE(host1x_actmon_sample_period_fops,
 		host1x_actmon_sample_period_set,
 		"%lld\n");
 
+static int host1x_actmon_sampler_period_get(void *data, u64 *val)
+{
+	struct host1x_actmon *actmon = (struct host1x_actmon *)data;
+
+	*val = (u64) actmon->sampler_period_ms;
+
+	return 0;
+}
+
+static int host1x_actmon_sampler_period_set(void *data, u64 val)
+{
+	struct host1x_actmon *actmon = (struct host1x_actmon *)data;
+
+	mutex_lock(&actmon->sampler_lock);
+
+	actmon->sampler_period_ms = (u32)val;
+
+	/* Restart at the new period, a zero period stops at the next run */
+	if (actmon->enabled && actmon->sampler_period_ms)
+		mod_delayed_work(system_freezable_power_efficient_wq,
+				 &actmon->sampler, 0);
+
+	mutex_unlock(&actmon->sampler_lock);
+
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(host1x_actmon_sampler_period_fops,
+		host1x_actmon_sampler_period_get,
+		host1x_actmon_sampler_period_set,
+		"%lld\n");
+
+static int host1x_actmon_samples_show(struct seq_file *s, void *unused)
+{
+	struct host1x_actmon *actmon = s->private;
+	struct host1x_actmon_sample *sample;
+	unsigned int i, idx;
+
+	mutex_lock(&actmon->sampler_lock);
+
+	seq_puts(s, "timestamp_ns active_count load rate\n");
+
+	/* Oldest sample first */
+	idx = (actmon->sample_head + HOST1X_ACTMON_SAMPLES - actmon->num_samples) %
+	      HOST1X_ACTMON_SAMPLES;
+	for (i = 0; i < actmon->num_samples; i++) {
+		sample = &actmon->samples[(idx + i) % HOST1X_ACTMON_SAMPLES];
+		seq_printf(s, "%llu %u %u %lu\n", sample->timestamp_ns,
+			   sample->active_count, sample->load, sample->rate);
+	}
+
+	mutex_unlock(&actmon->sampler_lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(host1x_actmon_samples);
+
 static void host1x_actmon_debug_init(struct host1x_actmon *actmon, const char *name)
 {
 	struct host1x *host = dev_get_drvdata(actmon->client->host->parent);
@@ -95,6 +159,12 @@ static void host1x_actmon_debug_init(struct host1x_actmon *actmon, const char *n
 	/* R/W files */
 	debugfs_create_file("sample_period", 0644, actmon->debugfs, actmon,
 			&host1x_actmon_sample_period_fops);
+	debugfs_create_file("sampler_period_ms", 0644, actmon->debugfs, actmon,
+			&host1x_actmon_sampler_period_fops);
+
+	/* R files */
+	debugfs_create_file("samples", 0444, actmon->debugfs, actmon,
+			&host1x_actmon_samples_fops);
 }
 
 static int host1x_actmon_module_k_get(void *data, u64 *val)
@@ -184,23 +254,32 @@ DEFINE_SIMPLE_ATTRIBUTE(host1x_actmon_module_consec_lower_num_fops,
 		host1x_actmon_module_consec_lower_num_set,
 		"%lld\n");
 
+static u32 host1x_actmon_norm(struct host1x_actmon *actmon, u32 active_clks,
+			      unsigned long client_freq)
+{
+	u32 client_clks;
+
+	client_clks = ((client_freq / 1000) * actmon->usecs_per_sample) / 1000;
+	if (!client_clks)
+		return 0;
+
+	return (u32) div_u64((u64) active_clks * 1000, client_clks);
+}
+
 static int host1x_actmon_module_avg_norm_get(void *data, u64 *val)
 {
 	struct host1x_actmon_module *module = (struct host1x_actmon_module *)data;
 	struct host1x_actmon *actmon = module->actmon;
 	struct host1x_client *client = actmon->client;
-	unsigned long client_freq;
-	u32 active_clks, client_clks;
+	u32 active_clks;
 
 	if (!client->ops->get_rate)
 		return -ENOTSUPP;
 
 	active_clks = actmon_module_readl(module, HOST1X_ACTMON_MODULE_AVG_COUNT_REG);
 
-	client_freq = client->ops->get_rate(client);
-	client_clks = ((client_freq / 1000) * actmon->usecs_per_sample) / 1000;
-
-	*val = (u64) (active_clks * 1000) / client_clks;
+	*val = (u64) host1x_actmon_norm(actmon, active_clks,
+					client->ops->get_rate(client));
 
 	return 0;
 }
@@ -293,6 +372,45 @@ static void host1x_actmon_module_deinit(struct host1x_actmon_module *module)
 	actmon_module_writel(module, 0, HOST1X_ACTMON_MODULE_COUNT_WEIGHT_REG);
 }
 
+static void host1x_actmon_sampler_work(struct work_struct *work)
+{
+	struct host1x_actmon *actmon = container_of(to_delayed_work(work),
+						    struct host1x_actmon, sampler);
+	struct host1x_actmon_module *module = &actmon->modules[HOST1X_ACTMON_MODULE_ACTIVE];
+	struct host1x_client *client = actmon->client;
+	struct host1x_actmon_load_listener *listener;
+	struct host1x_actmon_sample *sample;
+
+	mutex_lock(&actmon->sampler_lock);
+
+	if (!actmon->enabled || !actmon->sampler_period_ms)
+		goto unlock;
+
+	sample = &actmon->samples[actmon->sample_head];
+	sample->timestamp_ns = ktime_get_ns();
+	sample->active_count = actmon_module_readl(module,
+						   HOST1X_ACTMON_MODULE_AVG_COUNT_REG);
+	sample->rate = client->ops->get_rate ? client->ops->get_rate(client) : 0;
+	sample->load = host1x_actmon_norm(actmon, sample->active_count,
+					  sample->rate);
+
+	actmon->sample_head = (actmon->sample_head + 1) % HOST1X_ACTMON_SAMPLES;
+	if (actmon->num_samples < HOST1X_ACTMON_SAMPLES)
+		actmon->num_samples++;
+
+	trace_host1x_actmon_sample(client->class, sample->active_count,
+				   sample->load, sample->rate);
+
+	list_for_each_entry(listener, &actmon->listeners, list)
+		listener->sample(listener, client, sample);
+
+	queue_delayed_work(system_freezable_power_efficient_wq, &actmon->sampler,
+			   msecs_to_jiffies(actmon->sampler_period_ms));
+
+unlock:
+	mutex_unlock(&actmon->sampler_lock);
+}
+
 void host1x_actmon_handle_interrupt(struct host1x *host, int classid)
 {
 	unsigned long actmon_status, module_status;
@@ -364,6 +482,11 @@ int host1x_actmon_register(struct host1x_client *client)
 	actmon->num_modules = entry->num_modules;
 	actmon->usecs_per_sample = 1500;
 
+	mutex_init(&actmon->sampler_lock);
+	INIT_DELAYED_WORK(&actmon->sampler, host1x_actmon_sampler_work);
+	INIT_LIST_HEAD(&actmon->listeners);
+	actmon->sampler_period_ms = 10;
+
 	/* Configure actmon registers */
 	host1x_actmon_init(actmon);
 
@@ -406,6 +529,11 @@ void host1x_actmon_unregister(struct host1x_client *client)
 	if (!actmon)
 		return;
 
+	mutex_lock(&actmon->sampler_lock);
+	actmon->enabled = false;
+	mutex_unlock(&actmon->sampler_lock);
+	cancel_delayed_work_sync(&actmon->sampler);
+
 	for (i = 0; i < actmon->num_modules; i++) {
 		module = &actmon->modules[i];
 		host1x_actmon_module_deinit(module);
@@ -438,6 +566,17 @@ void host1x_actmon_enable(struct host1x_client *client)
 			HOST1X_ACTMON_MODULE_CTRL_ACTMON_ENB(1),
 			HOST1X_ACTMON_MODULE_CTRL_REG);
 	}
+
+	if (!actmon->num_modules)
+		return;
+
+	mutex_lock(&actmon->sampler_lock);
+	actmon->enabled = true;
+	if (actmon->sampler_period_ms)
+		queue_delayed_work(system_freezable_power_efficient_wq,
+				   &actmon->sampler,
+				   msecs_to_jiffies(actmon->sampler_period_ms));
+	mutex_unlock(&actmon->sampler_lock);
 }
 EXPORT_SYMBOL(host1x_actmon_enable);
 
@@ -450,6 +589,11 @@ void host1x_actmon_disable(struct host1x_client *client)
 	if (!actmon)
 		return;
 
+	mutex_lock(&actmon->sampler_lock);
+	actmon->enabled = false;
+	mutex_unlock(&actmon->sampler_lock);
+	cancel_delayed_work_sync(&actmon->sampler);
+
 	for (i = 0; i < actmon->num_modules; i++) {
 		module = &actmon->modules[i];
 		actmon_module_writel(module,
@@ -503,6 +647,74 @@ void host1x_actmon_read_active_norm(struct host1x_client *client, unsigned long
 }
 EXPORT_SYMBOL(host1x_actmon_read_active_norm);
 
+int host1x_actmon_register_load_listener(struct host1x_client *client,
+					 struct host1x_actmon_load_listener *listener)
+{
+	struct host1x_actmon *actmon = client->actmon;
+
+	if (!actmon || !actmon->num_modules)
+		return -ENODEV;
+
+	mutex_lock(&actmon->sampler_lock);
+	list_add_tail(&listener->list, &actmon->listeners);
+	mutex_unlock(&actmon->sampler_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(host1x_actmon_register_load_listener);
+
+void host1x_actmon_unregister_load_listener(struct host1x_client *client,
+					    struct host1x_actmon_load_listener *listener)
+{
+	struct host1x_actmon *actmon = client->actmon;
+
+	if (!actmon || !actmon->num_modules)
+		return;
+
+	/* The sampler calls listeners with the lock held */
+	mutex_lock(&actmon->sampler_lock);
+	list_del(&listener->list);
+	mutex_unlock(&actmon->sampler_lock);
+}
+EXPORT_SYMBOL(host1x_actmon_unregister_load_listener);
+
+int host1x_actmon_read_avg_load(struct host1x_client *client,
+				unsigned int window_ms, unsigned long *load)
+{
+	struct host1x_actmon *actmon = client->actmon;
+	struct host1x_actmon_sample *sample;
+	u64 now, sum = 0;
+	unsigned int i, n = 0;
+
+	if (!actmon || !actmon->num_modules)
+		return -ENODEV;
+
+	mutex_lock(&actmon->sampler_lock);
+
+	now = ktime_get_ns();
+
+	/* Newest sample first, stop at the first one outside the window */
+	for (i = 0; i < actmon->num_samples; i++) {
+		sample = &actmon->samples[(actmon->sample_head + HOST1X_ACTMON_SAMPLES - 1 - i) %
+					  HOST1X_ACTMON_SAMPLES];
+		if (now - sample->timestamp_ns > (u64) window_ms * NSEC_PER_MSEC)
+			break;
+
+		sum += sample->load;
+		n++;
+	}
+
+	mutex_unlock(&actmon->sampler_lock);
+
+	if (!n)
+		return -ENODATA;
+
+	*load = (unsigned long) div_u64(sum, n);
+
+	return 0;
+}
+EXPORT_SYMBOL(host1x_actmon_read_avg_load);
+
 int host1x_actmon_read_avg_count(struct host1x_client *client)
 {
 	struct host1x *host = dev_get_drvdata(client->host->parent);
@@ -9,7 +9,12 @@
 #define HOST1X_ACTMON_H
 
 #include <linux/device.h>
+#include <linux/host1x-next.h>
+#include <linux/mutex.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
+
+#define HOST1X_ACTMON_SAMPLES	256
 
 enum host1x_actmon_module_type {
 	HOST1X_ACTMON_MODULE_ACTIVE,
@@ -40,6 +45,19 @@ struct host1x_actmon {
 	struct host1x_actmon_module modules[8];
 	struct dentry *debugfs;
 	struct list_head list;
+
+	/*
+	 * Periodic load sampler, runs while the engine is enabled. The lock
+	 * protects the ring, the listener list and the enabled state.
+	 */
+	struct mutex sampler_lock;
+	struct delayed_work sampler;
+	u32 sampler_period_ms;
+	bool enabled;
+	struct list_head listeners;
+	unsigned int num_samples;
+	unsigned int sample_head;
+	struct host1x_actmon_sample samples[HOST1X_ACTMON_SAMPLES];
 };
 
 struct host1x;
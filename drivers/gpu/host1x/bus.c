@@ -916,6 +916,47 @@ unlock:
 }
 EXPORT_SYMBOL(host1x_client_resume);
 
+static void __host1x_bo_unpin(struct kref *ref)
+{
+	struct host1x_bo_mapping *mapping = to_host1x_bo_mapping(ref);
+
+	/*
+	 * When the last reference of the mapping goes away, make sure to remove the mapping from
+	 * the cache.
+	 */
+	if (mapping->cache) {
+		list_del(&mapping->entry);
+		mapping->cache->size--;
+	}
+
+	spin_lock(&mapping->bo->lock);
+	list_del(&mapping->list);
+	spin_unlock(&mapping->bo->lock);
+
+	mapping->bo->ops->unpin(mapping);
+}
+
+/*
+ * Release the least recently used mappings that are only referenced by the cache until the
+ * cache is back within its limit. Mappings still in use by a job are skipped. Must be called
+ * with the cache lock held.
+ */
+static void host1x_bo_cache_evict(struct host1x_bo_cache *cache)
+{
+	struct host1x_bo_mapping *mapping, *tmp;
+
+	list_for_each_entry_safe(mapping, tmp, &cache->mappings, entry) {
+		if (cache->size <= cache->max)
+			break;
+
+		if (kref_read(&mapping->ref) != 1)
+			continue;
+
+		kref_put(&mapping->ref, __host1x_bo_unpin);
+		cache->evictions++;
+	}
+}
+
 struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo,
 					enum dma_data_direction dir,
 					struct host1x_bo_cache *cache)
@@ -926,11 +967,20 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 		mutex_lock(&cache->lock);
 
 		list_for_each_entry(mapping, &cache->mappings, entry) {
-			if (mapping->bo == bo && mapping->direction == dir) {
+			if (mapping->bo == bo && mapping->direction == dir &&
+			    mapping->dev == dev) {
 				kref_get(&mapping->ref);
+
+				/* keep the list in least recently used order */
+				if (cache->max)
+					list_move_tail(&mapping->entry, &cache->mappings);
+
+				cache->hits++;
 				goto unlock;
 			}
 		}
+
+		cache->misses++;
 	}
 
 	mapping = bo->ops->pin(dev, bo, dir);
@@ -946,9 +996,13 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 		mapping->cache = cache;
 
 		list_add_tail(&mapping->entry, &cache->mappings);
+		cache->size++;
 
 		/* bump reference count to track the copy in the cache */
 		kref_get(&mapping->ref);
+
+		if (cache->max && cache->size > cache->max)
+			host1x_bo_cache_evict(cache);
 	}
 
 unlock:
@@ -959,24 +1013,6 @@ unlock:
 }
 EXPORT_SYMBOL(host1x_bo_pin);
 
-static void __host1x_bo_unpin(struct kref *ref)
-{
-	struct host1x_bo_mapping *mapping = to_host1x_bo_mapping(ref);
-
-	/*
-	 * When the last reference of the mapping goes away, make sure to remove the mapping from
-	 * the cache.
-	 */
-	if (mapping->cache)
-		list_del(&mapping->entry);
-
-	spin_lock(&mapping->bo->lock);
-	list_del(&mapping->list);
-	spin_unlock(&mapping->bo->lock);
-
-	mapping->bo->ops->unpin(mapping);
-}
-
 void host1x_bo_unpin(struct host1x_bo_mapping *mapping)
 {
 	struct host1x_bo_cache *cache = mapping->cache;
@@ -990,3 +1026,29 @@ void host1x_bo_unpin(struct host1x_bo_mapping *mapping)
 		mutex_unlock(&cache->lock);
 }
 EXPORT_SYMBOL(host1x_bo_unpin);
+
+/**
+ * host1x_bo_cache_flush() - drop the cache's reference to all mappings
+ * @cache: buffer object cache
+ *
+ * Mappings that are not in use anywhere else are unpinned immediately, the remaining ones
+ * are unpinned when their last user unpins them.
+ */
+void host1x_bo_cache_flush(struct host1x_bo_cache *cache)
+{
+	struct host1x_bo_mapping *mapping, *tmp;
+
+	mutex_lock(&cache->lock);
+
+	list_for_each_entry_safe(mapping, tmp, &cache->mappings, entry) {
+		/* detach from the cache so that a later unpin won't touch it */
+		list_del_init(&mapping->entry);
+		mapping->cache = NULL;
+		cache->size--;
+
+		kref_put(&mapping->ref, __host1x_bo_unpin);
+	}
+
+	mutex_unlock(&cache->lock);
+}
+EXPORT_SYMBOL(host1x_bo_cache_flush);
@@ -14,6 +14,7 @@
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/kfifo.h>
+#include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/version.h>
 #include <trace/events/host1x.h>
@@ -44,6 +45,18 @@
  */
 #define HOST1X_PUSHBUFFER_SLOTS	1023
 
+/*
+ * Bounds for the configurable slot count. The upper bound keeps the push
+ * buffer offsets well within what the RESTART_W opcode can encode.
+ */
+#define HOST1X_PUSHBUFFER_MIN_SLOTS	255
+#define HOST1X_PUSHBUFFER_MAX_SLOTS	65535
+
+static unsigned int pushbuffer_slots = HOST1X_PUSHBUFFER_SLOTS;
+module_param(pushbuffer_slots, uint, 0444);
+MODULE_PARM_DESC(pushbuffer_slots,
+		 "Default number of two-word slots in each channel's push buffer");
+
 /*
  * Clean up push buffer resources
  */
@@ -73,13 +86,21 @@ static int host1x_pushbuffer_init(struct push_buffer *pb)
 {
 	struct host1x_cdma *cdma = pb_to_cdma(pb);
 	struct host1x *host1x = cdma_to_host1x(cdma);
+	struct host1x_client *client = cdma_to_channel(cdma)->client;
+	unsigned int slots = pushbuffer_slots;
 	struct iova *alloc;
 	u32 size;
 	int err;
 
+	if (client && client->pushbuffer_slots)
+		slots = client->pushbuffer_slots;
+
+	slots = clamp_t(unsigned int, slots, HOST1X_PUSHBUFFER_MIN_SLOTS,
+			HOST1X_PUSHBUFFER_MAX_SLOTS);
+
 	pb->mapped = NULL;
 	pb->phys = 0;
-	pb->size = HOST1X_PUSHBUFFER_SLOTS * 8;
+	pb->size = slots * 8;
 
 	size = pb->size + 4;
 
@@ -180,6 +201,28 @@ static u32 host1x_pushbuffer_space(struct push_buffer *pb)
 	return (fence - pb->pos) / 8;
 }
 
+/*
+ * Account the time a submitter spent sleeping on a CDMA event.
+ * Must be called with the cdma lock held.
+ */
+static void host1x_cdma_account_wait(struct host1x_cdma *cdma,
+				     enum cdma_event event, ktime_t start)
+{
+	struct cdma_wait_stats *stats = &cdma->waits[event];
+	u64 delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stats->count++;
+	stats->total_ns += delta;
+	stats->max_ns = max(stats->max_ns, delta);
+}
+
+void host1x_cdma_reset_wait_stats(struct host1x_cdma *cdma)
+{
+	mutex_lock(&cdma->lock);
+	memset(cdma->waits, 0, sizeof(cdma->waits));
+	mutex_unlock(&cdma->lock);
+}
+
 /*
  * Sleep (if necessary) until the requested event happens
  *   - CDMA_EVENT_SYNC_QUEUE_EMPTY : sync queue is completely empty.
@@ -191,6 +234,8 @@ static u32 host1x_pushbuffer_space(struct push_buffer *pb)
 unsigned int host1x_cdma_wait_locked(struct host1x_cdma *cdma,
 				     enum cdma_event event)
 {
+	ktime_t start = 0;
+
 	for (;;) {
 		struct push_buffer *pb = &cdma->push_buffer;
 		unsigned int space;
@@ -209,8 +254,15 @@ unsigned int host1x_cdma_wait_locked(struct host1x_cdma *cdma,
 			return -EINVAL;
 		}
 
-		if (space)
+		if (space) {
+			if (start)
+				host1x_cdma_account_wait(cdma, event, start);
+
 			return space;
+		}
+
+		if (!start)
+			start = ktime_get();
 
 		trace_host1x_wait_cdma(dev_name(cdma_to_channel(cdma)->dev),
 				       event);
@@ -242,6 +294,8 @@ static int host1x_cdma_wait_pushbuffer_space(struct host1x *host1x,
 					     struct host1x_cdma *cdma,
 					     unsigned int needed)
 {
+	ktime_t start = 0;
+
 	while (true) {
 		struct push_buffer *pb = &cdma->push_buffer;
 		unsigned int space;
@@ -250,6 +304,9 @@ static int host1x_cdma_wait_pushbuffer_space(struct host1x *host1x,
 		if (space >= needed)
 			break;
 
+		if (!start)
+			start = ktime_get();
+
 		trace_host1x_wait_cdma(dev_name(cdma_to_channel(cdma)->dev),
 				       CDMA_EVENT_PUSH_BUFFER_SPACE);
 
@@ -270,8 +327,12 @@ static int host1x_cdma_wait_pushbuffer_space(struct host1x *host1x,
 		mutex_lock(&cdma->lock);
 	}
 
+	if (start)
+		host1x_cdma_account_wait(cdma, CDMA_EVENT_PUSH_BUFFER_SPACE, start);
+
 	return 0;
 }
+
 /*
  * Start timer that tracks the time spent by the job.
  * Must be called with the cdma lock held.
@@ -313,10 +374,35 @@ static void stop_cdma_timer_locked(struct host1x_cdma *cdma)
  * called manually if necessary.
  * Must be called with the cdma lock held.
  */
+/*
+ * Split the time between pushing a job and seeing it complete into the time
+ * it was queued behind earlier jobs and the time the hardware spent on it.
+ * Jobs on a channel execute in order, so the hardware can't have started a
+ * job before the previous one completed.
+ */
+static void host1x_cdma_job_completed(struct host1x_cdma *cdma,
+				      struct host1x_job *job, ktime_t *done)
+{
+	ktime_t start = job->pushed;
+
+	*done = ktime_get();
+
+	if (ktime_after(cdma->last_complete, start))
+		start = cdma->last_complete;
+
+	host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_QUEUE,
+				  ktime_to_ns(ktime_sub(start, job->pushed)));
+	host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_EXECUTE,
+				  ktime_to_ns(ktime_sub(*done, start)));
+
+	cdma->last_complete = *done;
+}
+
 static void update_cdma_locked(struct host1x_cdma *cdma)
 {
 	bool signal = false;
 	struct host1x_job *job, *n;
+	ktime_t done = 0;
 
 	/*
 	 * Walk the sync queue, reading the sync point registers as necessary,
@@ -339,6 +425,9 @@ static void update_cdma_locked(struct host1x_cdma *cdma)
 		if (cdma->timeout.client)
 			stop_cdma_timer_locked(cdma);
 
+		if (!job->cancelled)
+			host1x_cdma_job_completed(cdma, job, &done);
+
 		/* Unpin the memory */
 		host1x_job_unpin(job);
 
@@ -353,6 +442,18 @@ static void update_cdma_locked(struct host1x_cdma *cdma)
 		}
 
 		list_del(&job->list);
+
+		if (!job->cancelled) {
+			ktime_t now = ktime_get();
+
+			host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_CLEANUP,
+						  ktime_to_ns(ktime_sub(now, done)));
+			host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_TOTAL,
+						  ktime_to_ns(ktime_sub(now, job->created)) +
+						  job->stage_ns[HOST1X_JOB_STAGE_COPY]);
+			host1x_channel_record_job_latency(cdma_to_channel(cdma), job);
+		}
+
 		host1x_job_put(job);
 	}
 
@@ -455,7 +556,7 @@ syncpt_incr:
 
 			for (i = 0; i < job->num_slots; i++) {
 				unsigned int slot = (job->first_get/8 + i) %
-						    HOST1X_PUSHBUFFER_SLOTS;
+						    (cdma->push_buffer.size / 8);
 				u32 *mapped = cdma->push_buffer.mapped;
 
 				/*
@@ -474,7 +575,7 @@ syncpt_incr:
 				 */
 				if (i == 0 && host1x->info->has_wide_gather) {
 					unsigned int next_job = (job->first_get/8 + job->num_slots)
-						% HOST1X_PUSHBUFFER_SLOTS;
+						% (cdma->push_buffer.size / 8);
 					mapped[2*slot+0] = (0xd << 28) | (next_job * 2);
 					mapped[2*slot+1] = 0x0;
 				} else {
@@ -521,6 +622,8 @@ int host1x_cdma_init(struct host1x_cdma *cdma)
 	cdma->event = CDMA_EVENT_NONE;
 	cdma->running = false;
 	cdma->torndown = false;
+	memset(cdma->waits, 0, sizeof(cdma->waits));
+	cdma->last_complete = 0;
 
 	err = host1x_pushbuffer_init(&cdma->push_buffer);
 	if (err)
@@ -555,6 +658,8 @@ int host1x_cdma_begin(struct host1x_cdma *cdma, struct host1x_job *job)
 {
 	struct host1x *host1x = cdma_to_host1x(cdma);
 
+	job->push_start = ktime_get();
+
 	mutex_lock(&cdma->lock);
 
 	/*
@@ -675,6 +780,10 @@ void host1x_cdma_end(struct host1x_cdma *cdma,
 	struct host1x *host1x = cdma_to_host1x(cdma);
 	bool idle = list_empty(&cdma->sync_queue);
 
+	job->pushed = ktime_get();
+	host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_PUSH,
+				  ktime_to_ns(ktime_sub(job->pushed, job->push_start)));
+
 	host1x_hw_cdma_flush(host1x, cdma);
 
 	job->first_get = cdma->first_get;
@@ -54,7 +54,14 @@ struct buffer_timeout {
 enum cdma_event {
 	CDMA_EVENT_NONE,		/* not waiting for any event */
 	CDMA_EVENT_SYNC_QUEUE_EMPTY,	/* wait for empty sync queue */
-	CDMA_EVENT_PUSH_BUFFER_SPACE	/* wait for space in push buffer */
+	CDMA_EVENT_PUSH_BUFFER_SPACE,	/* wait for space in push buffer */
+	CDMA_EVENT_COUNT
+};
+
+struct cdma_wait_stats {
+	u64 count;			/* number of waits that slept */
+	u64 total_ns;			/* total time spent sleeping */
+	u64 max_ns;			/* longest single wait */
 };
 
 struct host1x_cdma {
@@ -71,6 +78,8 @@ struct host1x_cdma {
 	bool running;
 	bool torndown;
 	struct work_struct update_work;
+	struct cdma_wait_stats waits[CDMA_EVENT_COUNT]; /* protected by lock */
+	ktime_t last_complete;		/* when the last job was seen done */
 };
 
 #define cdma_to_channel(cdma) container_of(cdma, struct host1x_channel, cdma)
@@ -91,4 +100,5 @@ unsigned int host1x_cdma_wait_locked(struct host1x_cdma *cdma,
 				     enum cdma_event event);
 void host1x_cdma_update_sync_queue(struct host1x_cdma *cdma,
 				   struct device *dev);
+void host1x_cdma_reset_wait_stats(struct host1x_cdma *cdma);
 #endif
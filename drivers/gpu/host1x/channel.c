@@ -5,6 +5,7 @@
  * Copyright (c) 2010-2023, NVIDIA Corporation.
  */
 
+#include <linux/math64.h>
 #include <linux/slab.h>
 #include <linux/module.h>
 
@@ -12,6 +13,11 @@
 #include "dev.h"
 #include "job.h"
 
+static unsigned int mapping_cache_size = 64;
+module_param(mapping_cache_size, uint, 0644);
+MODULE_PARM_DESC(mapping_cache_size,
+		 "Number of idle buffer mappings kept per channel (0 disables the cache)");
+
 /* Constructor for the host1x device list */
 int host1x_channel_list_init(struct host1x_channel_list *chlist,
 			     unsigned int num_channels)
@@ -89,6 +95,9 @@ static void release_channel(struct kref *kref)
 	host1x_hw_cdma_stop(host, &channel->cdma);
 	host1x_cdma_deinit(&channel->cdma);
 
+	host1x_bo_cache_flush(&channel->cache);
+	host1x_bo_cache_destroy(&channel->cache);
+
 	clear_bit(channel->id, chlist->allocated_channels);
 }
 
@@ -117,6 +126,77 @@ static struct host1x_channel *acquire_unused_channel(struct host1x *host)
 	return &chlist->channels[index];
 }
 
+static unsigned int host1x_job_latency_bucket(u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+
+	if (!us)
+		return 0;
+
+	return min_t(unsigned int, fls64(us), HOST1X_JOB_LATENCY_BUCKETS - 1);
+}
+
+/*
+ * Fold the stage times of a completed job into the channel's histograms.
+ * Only stages that were actually measured for the job are counted.
+ */
+void host1x_channel_record_job_latency(struct host1x_channel *channel,
+				       struct host1x_job *job)
+{
+	struct host1x_job_latency *lat = &channel->latency;
+	unsigned long flags;
+	unsigned int stage;
+
+	spin_lock_irqsave(&lat->lock, flags);
+
+	for_each_set_bit(stage, &job->stage_mask, HOST1X_JOB_STAGE_COUNT) {
+		lat->buckets[stage][host1x_job_latency_bucket(job->stage_ns[stage])]++;
+		lat->count[stage]++;
+	}
+
+	spin_unlock_irqrestore(&lat->lock, flags);
+}
+
+/*
+ * Return the upper bound, in microseconds, of the histogram bucket that
+ * contains the given percentile of a stage, and the number of samples.
+ */
+u64 host1x_channel_job_latency_percentile(struct host1x_channel *channel,
+					  enum host1x_job_stage stage,
+					  unsigned int percent, u64 *count)
+{
+	struct host1x_job_latency *lat = &channel->latency;
+	u64 target, seen = 0;
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&lat->lock, flags);
+
+	*count = lat->count[stage];
+	target = div_u64(*count * percent + 99, 100);
+
+	for (i = 0; i < HOST1X_JOB_LATENCY_BUCKETS - 1; i++) {
+		seen += lat->buckets[stage][i];
+		if (seen >= target)
+			break;
+	}
+
+	spin_unlock_irqrestore(&lat->lock, flags);
+
+	return *count ? 1ull << i : 0;
+}
+
+void host1x_channel_reset_job_latency(struct host1x_channel *channel)
+{
+	struct host1x_job_latency *lat = &channel->latency;
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	memset(lat->buckets, 0, sizeof(lat->buckets));
+	memset(lat->count, 0, sizeof(lat->count));
+	spin_unlock_irqrestore(&lat->lock, flags);
+}
+
 /**
  * host1x_channel_list_stop() - disable cdma on allocated channels
  * @chlist: list of host1x channels
@@ -157,6 +237,15 @@ struct host1x_channel *host1x_channel_request(struct host1x_client *client)
 	channel->client = client;
 	channel->dev = client->dev;
 
+	host1x_bo_cache_init(&channel->cache);
+	channel->cache.max = mapping_cache_size;
+
+	atomic64_set(&channel->gather_bytes_direct, 0);
+	atomic64_set(&channel->gather_bytes_copied, 0);
+
+	spin_lock_init(&channel->latency.lock);
+	host1x_channel_reset_job_latency(channel);
+
 	err = host1x_hw_channel_init(host, channel, channel->id);
 	if (err < 0)
 		goto fail;
@@ -168,6 +257,7 @@ struct host1x_channel *host1x_channel_request(struct host1x_client *client)
 	return channel;
 
 fail:
+	host1x_bo_cache_destroy(&channel->cache);
 	clear_bit(channel->id, chlist->allocated_channels);
 
 	dev_err(client->dev, "failed to initialize channel\n");
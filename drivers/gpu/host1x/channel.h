@@ -8,6 +8,7 @@
 #ifndef __HOST1X_CHANNEL_H
 #define __HOST1X_CHANNEL_H
 
+#include <linux/host1x-next.h>
 #include <linux/io.h>
 #include <linux/kref.h>
 
@@ -21,6 +22,15 @@ struct host1x_channel_list {
 	unsigned long *allocated_channels;
 };
 
+/* log2 buckets of 1 us and up, the last one catching everything longer */
+#define HOST1X_JOB_LATENCY_BUCKETS 24
+
+struct host1x_job_latency {
+	spinlock_t lock;
+	u32 buckets[HOST1X_JOB_STAGE_COUNT][HOST1X_JOB_LATENCY_BUCKETS];
+	u64 count[HOST1X_JOB_STAGE_COUNT];
+};
+
 struct host1x_channel {
 	struct kref refcount;
 	unsigned int id;
@@ -29,6 +39,16 @@ struct host1x_channel {
 	struct host1x_client *client;
 	struct device *dev;
 	struct host1x_cdma cdma;
+
+	/* mappings of buffers referenced by jobs submitted to this channel */
+	struct host1x_bo_cache cache;
+
+	/* gather bytes fetched from the pinned BOs vs. copied for the firewall */
+	atomic64_t gather_bytes_direct;
+	atomic64_t gather_bytes_copied;
+
+	/* per stage latency of completed jobs */
+	struct host1x_job_latency latency;
 };
 
 /* channel list operations */
@@ -39,4 +59,11 @@ struct host1x_channel *host1x_channel_get_index(struct host1x *host,
 						unsigned int index);
 void host1x_channel_list_stop(struct host1x_channel_list *chlist);
 
+void host1x_channel_record_job_latency(struct host1x_channel *channel,
+				       struct host1x_job *job);
+u64 host1x_channel_job_latency_percentile(struct host1x_channel *channel,
+					  enum host1x_job_stage stage,
+					  unsigned int percent, u64 *count);
+void host1x_channel_reset_job_latency(struct host1x_channel *channel);
+
 #endif
@@ -8,6 +8,7 @@
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/pid.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 
 #include "context.h"
@@ -23,6 +24,8 @@ int host1x_memory_context_list_init(struct host1x *host1x)
 
 	cdl->devs = NULL;
 	cdl->len = 0;
+	cdl->clock = 0;
+	memset(&cdl->stats, 0, sizeof(cdl->stats));
 	mutex_init(&cdl->lock);
 
 	err = of_property_count_u32_elems(node, "iommu-map");
@@ -96,19 +99,61 @@ void host1x_memory_context_list_free(struct host1x_memory_context_list *cdl)
 {
 	unsigned int i;
 
-	for (i = 0; i < cdl->len; i++)
+	for (i = 0; i < cdl->len; i++) {
+		put_pid(cdl->devs[i].last_owner);
 		device_del(&cdl->devs[i].dev);
+	}
 
 	kfree(cdl->devs);
 	cdl->len = 0;
 }
 
+void host1x_memory_context_list_show(struct host1x_memory_context_list *cdl,
+				     struct seq_file *s)
+{
+	struct host1x_memory_context_stats *st = &cdl->stats;
+	unsigned int i;
+
+	mutex_lock(&cdl->lock);
+
+	seq_printf(s, "allocs %llu shared %llu sticky %llu cold %llu reassigned %llu busy %llu\n",
+		   st->allocs, st->shared, st->sticky, st->cold, st->reassigned,
+		   st->busy);
+	seq_printf(s, "%-16s %-24s %6s %8s %8s %12s\n", "context", "iommu",
+		   "sid", "owner", "last", "reassigned");
+
+	for (i = 0; i < cdl->len; i++) {
+		struct host1x_memory_context *cd = &cdl->devs[i];
+
+		seq_printf(s, "%-16s %-24s %6x %8d %8d %12lu\n",
+			   dev_name(&cd->dev), dev_name(cd->dev.iommu->iommu_dev->dev),
+			   cd->stream_id, pid_nr(cd->owner), pid_nr(cd->last_owner),
+			   cd->reassignments);
+	}
+
+	mutex_unlock(&cdl->lock);
+}
+
+void host1x_memory_context_list_reset_stats(struct host1x_memory_context_list *cdl)
+{
+	unsigned int i;
+
+	mutex_lock(&cdl->lock);
+
+	memset(&cdl->stats, 0, sizeof(cdl->stats));
+	for (i = 0; i < cdl->len; i++)
+		cdl->devs[i].reassignments = 0;
+
+	mutex_unlock(&cdl->lock);
+}
+
 struct host1x_memory_context *host1x_memory_context_alloc(struct host1x *host1x,
 							  struct device *dev,
 							  struct pid *pid)
 {
 	struct host1x_memory_context_list *cdl = &host1x->context_list;
-	struct host1x_memory_context *free = NULL;
+	struct host1x_memory_context *sticky = NULL, *cold = NULL, *lru = NULL;
+	struct host1x_memory_context *free;
 	int i;
 
 	if (!cdl->len)
@@ -116,6 +161,13 @@ struct host1x_memory_context *host1x_memory_context_alloc(struct host1x *host1x,
 
 	mutex_lock(&cdl->lock);
 
+	/*
+	 * The pool of a client is the set of contexts behind its IOMMU. Pick a
+	 * free context in order of preference: the one this process released
+	 * last, one that was never used, and only then the least recently
+	 * released context of another process, so that processes alternating
+	 * on an engine keep their own stream IDs.
+	 */
 	for (i = 0; i < cdl->len; i++) {
 		struct host1x_memory_context *cd = &cdl->devs[i];
 
@@ -124,20 +176,44 @@ struct host1x_memory_context *host1x_memory_context_alloc(struct host1x *host1x,
 
 		if (cd->owner == pid) {
 			refcount_inc(&cd->ref);
+			cdl->stats.allocs++;
+			cdl->stats.shared++;
 			mutex_unlock(&cdl->lock);
 			return cd;
-		} else if (!cd->owner && !free) {
-			free = cd;
 		}
+
+		if (cd->owner)
+			continue;
+
+		if (cd->last_owner == pid)
+			sticky = cd;
+		else if (!cd->last_owner && !cold)
+			cold = cd;
+		else if (cd->last_owner && (!lru || cd->last_used < lru->last_used))
+			lru = cd;
 	}
 
+	free = sticky ?: cold ?: lru;
 	if (!free) {
+		cdl->stats.busy++;
 		mutex_unlock(&cdl->lock);
 		return ERR_PTR(-EBUSY);
 	}
 
+	cdl->stats.allocs++;
+	if (free == sticky) {
+		cdl->stats.sticky++;
+	} else if (free == cold) {
+		cdl->stats.cold++;
+	} else {
+		cdl->stats.reassigned++;
+		free->reassignments++;
+	}
+
 	refcount_set(&free->ref, 1);
 	free->owner = get_pid(pid);
+	put_pid(free->last_owner);
+	free->last_owner = NULL;
 
 	mutex_unlock(&cdl->lock);
 
@@ -156,8 +232,10 @@ void host1x_memory_context_put(struct host1x_memory_context *cd)
 	struct host1x_memory_context_list *cdl = &cd->host->context_list;
 
 	if (refcount_dec_and_mutex_lock(&cd->ref, &cdl->lock)) {
-		put_pid(cd->owner);
+		/* the owner reference moves to last_owner for sticky reuse */
+		cd->last_owner = cd->owner;
 		cd->owner = NULL;
+		cd->last_used = ++cdl->clock;
 		mutex_unlock(&cdl->lock);
 	}
 }
@@ -15,15 +15,38 @@ struct host1x;
 
 extern struct bus_type host1x_context_device_bus_type;
 
+struct seq_file;
+
+struct host1x_memory_context_stats {
+	/* successful allocations */
+	u64 allocs;
+	/* process already owned a context */
+	u64 shared;
+	/* process got back the free context it last owned */
+	u64 sticky;
+	/* context was never used before */
+	u64 cold;
+	/* context last owned by another process was taken over */
+	u64 reassigned;
+	/* no free context in the pool */
+	u64 busy;
+};
+
 struct host1x_memory_context_list {
 	struct mutex lock;
 	struct host1x_memory_context *devs;
 	unsigned int len;
+	/* release counter, source of host1x_memory_context::last_used */
+	u64 clock;
+	struct host1x_memory_context_stats stats;
 };
 
 #ifdef CONFIG_IOMMU_API
 int host1x_memory_context_list_init(struct host1x *host1x);
 void host1x_memory_context_list_free(struct host1x_memory_context_list *cdl);
+void host1x_memory_context_list_show(struct host1x_memory_context_list *cdl,
+				     struct seq_file *s);
+void host1x_memory_context_list_reset_stats(struct host1x_memory_context_list *cdl);
 #else
 static inline int host1x_memory_context_list_init(struct host1x *host1x)
 {
@@ -33,6 +56,15 @@ static inline int host1x_memory_context_list_init(struct host1x *host1x)
 static inline void host1x_memory_context_list_free(struct host1x_memory_context_list *cdl)
 {
 }
+
+static inline void host1x_memory_context_list_show(struct host1x_memory_context_list *cdl,
+						   struct seq_file *s)
+{
+}
+
+static inline void host1x_memory_context_list_reset_stats(struct host1x_memory_context_list *cdl)
+{
+}
 #endif
 
 #endif
@@ -7,6 +7,7 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/math64.h>
 #include <linux/pm_runtime.h>
 #include <linux/seq_file.h>
 #include <linux/uaccess.h>
@@ -16,6 +17,7 @@
 #include "dev.h"
 #include "debug.h"
 #include "channel.h"
+#include "context.h"
 
 static DEFINE_MUTEX(debug_lock);
 
@@ -49,6 +51,30 @@ void host1x_debug_cont(struct output *o, const char *fmt, ...)
 	o->fn(o->ctx, o->buf, len, true);
 }
 
+static void show_channel_cache(struct host1x_channel *ch, struct output *o)
+{
+	struct host1x_bo_cache *cache = &ch->cache;
+	unsigned long hits, misses, evictions, total;
+	unsigned int size, max;
+
+	mutex_lock(&cache->lock);
+	hits = cache->hits;
+	misses = cache->misses;
+	evictions = cache->evictions;
+	size = cache->size;
+	max = cache->max;
+	mutex_unlock(&cache->lock);
+
+	if (!max && !hits && !misses)
+		return;
+
+	total = hits + misses;
+
+	host1x_debug_output(o, "mapping cache: %u/%u entries, %lu hits, %lu misses (%lu%% hit rate), %lu evictions\n",
+			    size, max, hits, misses, total ? hits * 100 / total : 0,
+			    evictions);
+}
+
 static int show_channel(struct host1x_channel *ch, void *data, bool show_fifo)
 {
 	struct host1x *m = dev_get_drvdata(ch->dev->parent);
@@ -67,6 +93,12 @@ static int show_channel(struct host1x_channel *ch, void *data, bool show_fifo)
 
 	host1x_hw_show_channel_cdma(m, ch, o);
 
+	show_channel_cache(ch, o);
+
+	host1x_debug_output(o, "gathers: %lld bytes direct, %lld bytes copied\n",
+			    (long long)atomic64_read(&ch->gather_bytes_direct),
+			    (long long)atomic64_read(&ch->gather_bytes_copied));
+
 	mutex_unlock(&debug_lock);
 	mutex_unlock(&ch->cdma.lock);
 
@@ -78,7 +110,6 @@ static int show_channel(struct host1x_channel *ch, void *data, bool show_fifo)
 static void show_syncpts(struct host1x *m, struct output *o, bool show_all)
 {
 	unsigned long irqflags;
-	struct list_head *pos;
 	unsigned int i;
 	int err;
 
@@ -94,8 +125,7 @@ static void show_syncpts(struct host1x *m, struct output *o, bool show_all)
 		unsigned int waiters = 0;
 
 		spin_lock_irqsave(&m->syncpt[i].fences.lock, irqflags);
-		list_for_each(pos, &m->syncpt[i].fences.list)
-			waiters++;
+		waiters = m->syncpt[i].fences.count;
 		spin_unlock_irqrestore(&m->syncpt[i].fences.lock, irqflags);
 
 		if (!kref_read(&m->syncpt[i].ref))
@@ -189,6 +219,193 @@ static const struct file_operations host1x_debug_fops = {
 	.release = single_release,
 };
 
+static int host1x_debug_cdma_waits_show(struct seq_file *s, void *unused)
+{
+	static const char * const events[CDMA_EVENT_COUNT] = {
+		[CDMA_EVENT_SYNC_QUEUE_EMPTY] = "sync_queue_empty",
+		[CDMA_EVENT_PUSH_BUFFER_SPACE] = "push_buffer_space",
+	};
+	struct host1x *m = s->private;
+	unsigned int i, j;
+
+	seq_puts(s, "channel device             slots event               waits     total_us    max_us\n");
+
+	for (i = 0; i < m->info->nb_channels; i++) {
+		struct host1x_channel *ch = host1x_channel_get_index(m, i);
+		struct cdma_wait_stats waits[CDMA_EVENT_COUNT];
+		struct host1x_cdma *cdma;
+
+		if (!ch)
+			continue;
+
+		cdma = &ch->cdma;
+
+		mutex_lock(&cdma->lock);
+		memcpy(waits, cdma->waits, sizeof(waits));
+		mutex_unlock(&cdma->lock);
+
+		for (j = CDMA_EVENT_SYNC_QUEUE_EMPTY; j < CDMA_EVENT_COUNT; j++)
+			seq_printf(s, "%7u %-18s %5u %-18s %7llu %12llu %9llu\n",
+				   ch->id, dev_name(ch->dev),
+				   cdma->push_buffer.size / 8, events[j],
+				   waits[j].count,
+				   div_u64(waits[j].total_ns, NSEC_PER_USEC),
+				   div_u64(waits[j].max_ns, NSEC_PER_USEC));
+
+		host1x_channel_put(ch);
+	}
+
+	return 0;
+}
+
+static int host1x_debug_cdma_waits_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, host1x_debug_cdma_waits_show, inode->i_private);
+}
+
+static ssize_t host1x_debug_cdma_waits_write(struct file *file,
+					     const char __user *buf,
+					     size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct host1x *m = s->private;
+	unsigned int i;
+
+	/* any write resets the counters */
+	for (i = 0; i < m->info->nb_channels; i++) {
+		struct host1x_channel *ch = host1x_channel_get_index(m, i);
+
+		if (!ch)
+			continue;
+
+		host1x_cdma_reset_wait_stats(&ch->cdma);
+		host1x_channel_put(ch);
+	}
+
+	return count;
+}
+
+static const struct file_operations host1x_debug_cdma_waits_fops = {
+	.open = host1x_debug_cdma_waits_open,
+	.read = seq_read,
+	.write = host1x_debug_cdma_waits_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int host1x_debug_job_latency_show(struct seq_file *s, void *unused)
+{
+	static const char * const stages[HOST1X_JOB_STAGE_COUNT] = {
+		[HOST1X_JOB_STAGE_COPY] = "copy",
+		[HOST1X_JOB_STAGE_PIN] = "pin",
+		[HOST1X_JOB_STAGE_VALIDATE] = "validate",
+		[HOST1X_JOB_STAGE_PUSH] = "push",
+		[HOST1X_JOB_STAGE_QUEUE] = "queue",
+		[HOST1X_JOB_STAGE_EXECUTE] = "execute",
+		[HOST1X_JOB_STAGE_CLEANUP] = "cleanup",
+		[HOST1X_JOB_STAGE_TOTAL] = "total",
+	};
+	struct host1x *m = s->private;
+	unsigned int i, j;
+
+	seq_puts(s, "channel device             stage      samples    p50_us    p99_us\n");
+
+	for (i = 0; i < m->info->nb_channels; i++) {
+		struct host1x_channel *ch = host1x_channel_get_index(m, i);
+
+		if (!ch)
+			continue;
+
+		for (j = 0; j < HOST1X_JOB_STAGE_COUNT; j++) {
+			u64 count, p50, p99;
+
+			p50 = host1x_channel_job_latency_percentile(ch, j, 50, &count);
+			p99 = host1x_channel_job_latency_percentile(ch, j, 99, &count);
+
+			if (!count)
+				continue;
+
+			seq_printf(s, "%7u %-18s %-8s %9llu %9llu %9llu\n",
+				   ch->id, dev_name(ch->dev), stages[j], count,
+				   p50, p99);
+		}
+
+		host1x_channel_put(ch);
+	}
+
+	return 0;
+}
+
+static int host1x_debug_job_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, host1x_debug_job_latency_show, inode->i_private);
+}
+
+static ssize_t host1x_debug_job_latency_write(struct file *file,
+					      const char __user *buf,
+					      size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct host1x *m = s->private;
+	unsigned int i;
+
+	/* any write resets the histograms */
+	for (i = 0; i < m->info->nb_channels; i++) {
+		struct host1x_channel *ch = host1x_channel_get_index(m, i);
+
+		if (!ch)
+			continue;
+
+		host1x_channel_reset_job_latency(ch);
+		host1x_channel_put(ch);
+	}
+
+	return count;
+}
+
+static const struct file_operations host1x_debug_job_latency_fops = {
+	.open = host1x_debug_job_latency_open,
+	.read = seq_read,
+	.write = host1x_debug_job_latency_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int host1x_debug_memory_contexts_show(struct seq_file *s, void *unused)
+{
+	struct host1x *m = s->private;
+
+	host1x_memory_context_list_show(&m->context_list, s);
+
+	return 0;
+}
+
+static int host1x_debug_memory_contexts_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, host1x_debug_memory_contexts_show, inode->i_private);
+}
+
+static ssize_t host1x_debug_memory_contexts_write(struct file *file,
+						  const char __user *buf,
+						  size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct host1x *m = s->private;
+
+	/* any write resets the counters */
+	host1x_memory_context_list_reset_stats(&m->context_list);
+
+	return count;
+}
+
+static const struct file_operations host1x_debug_memory_contexts_fops = {
+	.open = host1x_debug_memory_contexts_open,
+	.read = seq_read,
+	.write = host1x_debug_memory_contexts_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static void host1x_debugfs_init(struct host1x *host1x)
 {
 	struct dentry *de = debugfs_create_dir("tegra-host1x", NULL);
@@ -201,6 +418,12 @@ static void host1x_debugfs_init(struct host1x *host1x)
 	debugfs_create_file("status", S_IRUGO, de, host1x, &host1x_debug_fops);
 	debugfs_create_file("status_all", S_IRUGO, de, host1x,
 			    &host1x_debug_all_fops);
+	debugfs_create_file("cdma_waits", S_IRUGO|S_IWUSR, de, host1x,
+			    &host1x_debug_cdma_waits_fops);
+	debugfs_create_file("job_latency", S_IRUGO|S_IWUSR, de, host1x,
+			    &host1x_debug_job_latency_fops);
+	debugfs_create_file("memory_contexts", S_IRUGO|S_IWUSR, de, host1x,
+			    &host1x_debug_memory_contexts_fops);
 
 	debugfs_create_u32("trace_cmdbuf", S_IRUGO|S_IWUSR, de,
 			   &host1x_debug_trace_cmdbuf);
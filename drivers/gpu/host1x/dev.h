@@ -153,6 +153,7 @@ struct host1x {
 	int general_irq;
 	struct host1x_syncpt *syncpt;
 	struct host1x_syncpt_base *bases;
+	u32 *syncpt_shadow; /* read-only copy of syncpoint values for userspace */
 	struct device *dev;
 	struct clk *clk;
 	struct clk *actmon_clk;
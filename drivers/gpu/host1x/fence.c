@@ -15,6 +15,14 @@
 #include "intr.h"
 #include "syncpt.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_frame.h>
+#undef CREATE_TRACE_POINTS
+
+EXPORT_TRACEPOINT_SYMBOL_GPL(tegra_frame_submit);
+EXPORT_TRACEPOINT_SYMBOL_GPL(tegra_frame_start);
+EXPORT_TRACEPOINT_SYMBOL_GPL(tegra_frame_done);
+
 static const char *host1x_syncpt_fence_get_driver_name(struct dma_fence *f)
 {
 	return "host1x";
@@ -99,6 +107,11 @@ void host1x_fence_signal(struct host1x_syncpt_fence *f, ktime_t ts)
 		dma_fence_put(&f->base);
 	}
 
+	if (trace_tegra_frame_done_enabled())
+		trace_tegra_frame_done(TEGRA_FRAME_ENGINE_SYNCPT, 0, 0, 0,
+				       f->sp->id, f->threshold,
+				       tegra_frame_ts_ns());
+
 	dma_fence_signal_timestamp_locked(&f->base, ts);
 	dma_fence_put(&f->base);
 }
@@ -147,6 +160,7 @@ struct dma_fence *host1x_fence_create(struct host1x_syncpt *sp, u32 threshold,
 		       dma_fence_context_alloc(1), 0);
 
 	INIT_DELAYED_WORK(&fence->timeout_work, do_fence_timeout);
+	RB_CLEAR_NODE(&fence->node);
 
 	return &fence->base;
 }
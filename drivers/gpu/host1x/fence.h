@@ -6,6 +6,8 @@
 #ifndef HOST1X_FENCE_H
 #define HOST1X_FENCE_H
 
+#include <linux/rbtree.h>
+
 struct host1x_syncpt_fence {
 	struct dma_fence base;
 
@@ -17,12 +19,18 @@ struct host1x_syncpt_fence {
 
 	struct delayed_work timeout_work;
 
+	/* node in the syncpoint's threshold-ordered tree of pending fences */
+	struct rb_node node;
+	/* link in the batch of fences signalled by one interrupt */
 	struct list_head list;
+	/* time at which the fence was queued, for latency tracing */
+	ktime_t queued;
 };
 
 struct host1x_fence_list {
 	spinlock_t lock;
-	struct list_head list;
+	struct rb_root_cached root;
+	unsigned int count;
 };
 
 void host1x_fence_signal(struct host1x_syncpt_fence *fence, ktime_t ts);
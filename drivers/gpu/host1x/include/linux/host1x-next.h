@@ -43,23 +43,42 @@ u64 host1x_get_dma_mask(struct host1x *host1x);
 
 /**
  * struct host1x_bo_cache - host1x buffer object cache
- * @mappings: list of mappings
+ * @mappings: list of mappings, least recently used first
  * @lock: synchronizes accesses to the list of mappings
+ * @size: number of mappings in the cache
+ * @max: maximum number of mappings to keep, or 0 for no limit
+ * @hits: number of lookups that were satisfied by a cached mapping
+ * @misses: number of lookups that required a new mapping
+ * @evictions: number of idle mappings released to honour @max
  *
- * Note that entries are not periodically evicted from this cache and instead need to be
- * explicitly released. This is used primarily for DRM/KMS where the cache's reference is
- * released when the last reference to a buffer object represented by a mapping in this
- * cache is dropped.
+ * If @max is 0, entries are not evicted from this cache and instead need to be explicitly
+ * released. This is used primarily for DRM/KMS where the cache's reference is released when
+ * the last reference to a buffer object represented by a mapping in this cache is dropped.
+ *
+ * Otherwise, the least recently used mappings which are not referenced by anyone but the
+ * cache are unpinned as soon as the cache grows beyond @max entries.
  */
 struct host1x_bo_cache {
 	struct list_head mappings;
 	struct mutex lock;
+
+	unsigned int size;
+	unsigned int max;
+
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
 };
 
 static inline void host1x_bo_cache_init(struct host1x_bo_cache *cache)
 {
 	INIT_LIST_HEAD(&cache->mappings);
 	mutex_init(&cache->lock);
+	cache->size = 0;
+	cache->max = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
 }
 
 static inline void host1x_bo_cache_destroy(struct host1x_bo_cache *cache)
@@ -109,6 +128,8 @@ struct host1x_actmon;
  * @lock: mutex for mutually exclusive concurrency
  * @cache: host1x buffer object cache
  * @actmon: unit actmon for this client
+ * @pushbuffer_slots: number of push buffer slots to allocate for channels
+ *   requested by this client, or 0 for the host1x default
  */
 struct host1x_client {
 	struct list_head list;
@@ -131,6 +152,8 @@ struct host1x_client {
 	struct host1x_bo_cache cache;
 
 	struct host1x_actmon *actmon;
+
+	unsigned int pushbuffer_slots;
 };
 
 /*
@@ -199,6 +222,7 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 					enum dma_data_direction dir,
 					struct host1x_bo_cache *cache);
 void host1x_bo_unpin(struct host1x_bo_mapping *map);
+void host1x_bo_cache_flush(struct host1x_bo_cache *cache);
 
 static inline void *host1x_bo_mmap(struct host1x_bo *bo)
 {
@@ -221,6 +245,7 @@ static inline void host1x_bo_munmap(struct host1x_bo *bo, void *addr)
 struct host1x_syncpt_base;
 struct host1x_syncpt;
 struct host1x;
+struct vm_area_struct;
 
 struct host1x_syncpt *host1x_syncpt_get_by_id(struct host1x *host, u32 id);
 struct host1x_syncpt *host1x_syncpt_get_by_id_noref(struct host1x *host, u32 id);
@@ -238,6 +263,9 @@ int host1x_syncpt_wait(struct host1x_syncpt *sp, u32 thresh, long timeout,
 struct host1x_syncpt *host1x_syncpt_request(struct host1x_client *client,
 					    unsigned long flags);
 void host1x_syncpt_put(struct host1x_syncpt *sp);
+size_t host1x_syncpt_shadow_size(struct host1x *host);
+int host1x_syncpt_shadow_mmap(struct host1x *host, struct vm_area_struct *vma);
+
 struct host1x_syncpt *host1x_syncpt_alloc(struct host1x *host,
 					  unsigned long flags,
 					  const char *name);
@@ -273,6 +301,25 @@ int host1x_job_submit(struct host1x_job *job);
 #define HOST1X_RELOC_READ	(1 << 0)
 #define HOST1X_RELOC_WRITE	(1 << 1)
 
+/*
+ * Stages of a job's life that are timed for latency tracing. COPY and
+ * VALIDATE are reported by the submitting driver, the others by host1x.
+ * QUEUE and EXECUTE are split at the estimated hardware start, i.e. when the
+ * job was pushed or when the channel's previous job completed, whichever
+ * was later.
+ */
+enum host1x_job_stage {
+	HOST1X_JOB_STAGE_COPY,		/* copying the submission from userspace */
+	HOST1X_JOB_STAGE_PIN,		/* host1x_job_pin(), minus validation */
+	HOST1X_JOB_STAGE_VALIDATE,	/* firewall validation */
+	HOST1X_JOB_STAGE_PUSH,		/* writing the push buffer */
+	HOST1X_JOB_STAGE_QUEUE,		/* pushed until the hardware started it */
+	HOST1X_JOB_STAGE_EXECUTE,	/* hardware start until completion was seen */
+	HOST1X_JOB_STAGE_CLEANUP,	/* unpinning after completion */
+	HOST1X_JOB_STAGE_TOTAL,		/* submission until cleanup finished */
+	HOST1X_JOB_STAGE_COUNT
+};
+
 struct host1x_reloc {
 	struct {
 		struct host1x_bo *bo;
@@ -370,6 +417,13 @@ struct host1x_job {
 	u32 engine_fallback_streamid;
 	/* Engine offset to program stream ID to */
 	u32 engine_streamid_offset;
+
+	/* Per stage latency, see enum host1x_job_stage */
+	u64 stage_ns[HOST1X_JOB_STAGE_COUNT];
+	unsigned long stage_mask;
+	ktime_t created;
+	ktime_t push_start;
+	ktime_t pushed;
 };
 
 struct host1x_job *host1x_job_alloc(struct host1x_channel *ch,
@@ -384,6 +438,8 @@ struct host1x_job *host1x_job_get(struct host1x_job *job);
 void host1x_job_put(struct host1x_job *job);
 int host1x_job_pin(struct host1x_job *job, struct device *dev);
 void host1x_job_unpin(struct host1x_job *job);
+void host1x_job_add_stage_time(struct host1x_job *job, enum host1x_job_stage stage,
+			       u64 ns);
 
 /*
  * subdevice probe infrastructure
@@ -498,6 +554,17 @@ struct host1x_memory_context {
 	refcount_t ref;
 	struct pid *owner;
 
+	/*
+	 * Process that owned the context before it was released. The context
+	 * stays bound to it while free, so the process gets it back with its
+	 * IOMMU state still warm.
+	 */
+	struct pid *last_owner;
+	/* Release order, the least recently used free context is taken first */
+	u64 last_used;
+	/* Number of times the context moved to a different process */
+	unsigned long reassignments;
+
 	struct device dev;
 	u64 dma_mask;
 	u32 stream_id;
@@ -542,4 +609,37 @@ void host1x_actmon_update_active_wmark(struct host1x_client *client,
 				       bool upper_wmark_enabled,
 				       bool lower_wmark_enabled);
 
+/* host1x actmon load sampling */
+
+struct host1x_actmon_sample {
+	/* CLOCK_MONOTONIC time of the sample */
+	u64 timestamp_ns;
+	/* moving average of active engine cycles per actmon sample period */
+	u32 active_count;
+	/* active cycles normalised to the client clock, 0..1000 */
+	u32 load;
+	/* client clock rate when the sample was taken */
+	unsigned long rate;
+};
+
+/**
+ * struct host1x_actmon_load_listener - receiver of periodic load samples
+ * @list: entry in the actmon listener list, owned by host1x
+ * @sample: called from process context after each sample, must not call
+ *          back into the host1x_actmon_*_load_listener() functions
+ */
+struct host1x_actmon_load_listener {
+	struct list_head list;
+	void (*sample)(struct host1x_actmon_load_listener *listener,
+		       struct host1x_client *client,
+		       const struct host1x_actmon_sample *sample);
+};
+
+int host1x_actmon_register_load_listener(struct host1x_client *client,
+					 struct host1x_actmon_load_listener *listener);
+void host1x_actmon_unregister_load_listener(struct host1x_client *client,
+					    struct host1x_actmon_load_listener *listener);
+int host1x_actmon_read_avg_load(struct host1x_client *client,
+				unsigned int window_ms, unsigned long *load);
+
 #endif
@@ -11,29 +11,54 @@
 #include "fence.h"
 #include "intr.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/host1x_fence.h>
+#undef CREATE_TRACE_POINTS
+
 static void host1x_intr_add_fence_to_list(struct host1x_fence_list *list,
 					  struct host1x_syncpt_fence *fence)
 {
-	struct host1x_syncpt_fence *fence_in_list;
-
-	list_for_each_entry_reverse(fence_in_list, &list->list, list) {
-		if ((s32)(fence_in_list->threshold - fence->threshold) <= 0) {
-			/* Fence in list is before us, we can insert here */
-			list_add(&fence->list, &fence_in_list->list);
-			return;
+	struct rb_node **link = &list->root.rb_root.rb_node, *parent = NULL;
+	bool leftmost = true;
+
+	while (*link) {
+		struct host1x_syncpt_fence *entry;
+
+		parent = *link;
+		entry = rb_entry(parent, struct host1x_syncpt_fence, node);
+
+		/*
+		 * Compare with wrapping, keeping fences with equal thresholds in
+		 * the order in which they were added.
+		 */
+		if ((s32)(fence->threshold - entry->threshold) < 0) {
+			link = &parent->rb_left;
+		} else {
+			link = &parent->rb_right;
+			leftmost = false;
 		}
 	}
 
-	/* Add as first in list */
-	list_add(&fence->list, &list->list);
+	rb_link_node(&fence->node, parent, link);
+	rb_insert_color_cached(&fence->node, &list->root, leftmost);
+	list->count++;
+}
+
+static void host1x_intr_remove_fence_from_list(struct host1x_fence_list *list,
+					       struct host1x_syncpt_fence *fence)
+{
+	rb_erase_cached(&fence->node, &list->root);
+	RB_CLEAR_NODE(&fence->node);
+	list->count--;
 }
 
 static void host1x_intr_update_hw_state(struct host1x *host, struct host1x_syncpt *sp)
 {
+	struct rb_node *first = rb_first_cached(&sp->fences.root);
 	struct host1x_syncpt_fence *fence;
 
-	if (!list_empty(&sp->fences.list)) {
-		fence = list_first_entry(&sp->fences.list, struct host1x_syncpt_fence, list);
+	if (first) {
+		fence = rb_entry(first, struct host1x_syncpt_fence, node);
 
 		host1x_hw_intr_set_syncpt_threshold(host, sp->id, fence->threshold);
 		host1x_hw_intr_enable_syncpt_intr(host, sp->id);
@@ -46,26 +71,34 @@ void host1x_intr_add_fence_locked(struct host1x *host, struct host1x_syncpt_fenc
 {
 	struct host1x_fence_list *fence_list = &fence->sp->fences;
 
-	INIT_LIST_HEAD(&fence->list);
+	fence->queued = ktime_get();
 
 	host1x_intr_add_fence_to_list(fence_list, fence);
-	host1x_intr_update_hw_state(host, fence->sp);
+
+	/* only a new earliest fence changes the threshold to program */
+	if (rb_first_cached(&fence_list->root) == &fence->node)
+		host1x_intr_update_hw_state(host, fence->sp);
 }
 
 bool host1x_intr_remove_fence(struct host1x *host, struct host1x_syncpt_fence *fence)
 {
 	struct host1x_fence_list *fence_list = &fence->sp->fences;
 	unsigned long irqflags;
+	bool first;
 
 	spin_lock_irqsave(&fence_list->lock, irqflags);
 
-	if (list_empty(&fence->list)) {
+	if (RB_EMPTY_NODE(&fence->node)) {
 		spin_unlock_irqrestore(&fence_list->lock, irqflags);
 		return false;
 	}
 
-	list_del_init(&fence->list);
-	host1x_intr_update_hw_state(host, fence->sp);
+	first = rb_first_cached(&fence_list->root) == &fence->node;
+
+	host1x_intr_remove_fence_from_list(fence_list, fence);
+
+	if (first)
+		host1x_intr_update_hw_state(host, fence->sp);
 
 	spin_unlock_irqrestore(&fence_list->lock, irqflags);
 
@@ -76,26 +109,45 @@ void host1x_intr_handle_interrupt(struct host1x *host, unsigned int id, ktime_t
 {
 	struct host1x_syncpt *sp = &host->syncpt[id];
 	struct host1x_syncpt_fence *fence, *tmp;
+	struct rb_node *node;
+	unsigned int count = 0;
 	unsigned int value;
+	LIST_HEAD(expired);
 
 	value = host1x_syncpt_load(sp);
 
 	spin_lock(&sp->fences.lock);
 
-	list_for_each_entry_safe(fence, tmp, &sp->fences.list, list) {
+	while ((node = rb_first_cached(&sp->fences.root))) {
+		fence = rb_entry(node, struct host1x_syncpt_fence, node);
+
 		if (((value - fence->threshold) & 0x80000000U) != 0U) {
 			/* Fence is not yet expired, we are done */
 			break;
 		}
 
-		list_del_init(&fence->list);
-		host1x_fence_signal(fence, ts);
+		host1x_intr_remove_fence_from_list(&sp->fences, fence);
+		list_add_tail(&fence->list, &expired);
 	}
 
-	/* Re-enable interrupt if necessary */
+	/*
+	 * Re-arm the interrupt for the next pending fence before signalling, so
+	 * that the hardware is not left idle while the batch is processed.
+	 */
 	host1x_intr_update_hw_state(host, sp);
 
+	list_for_each_entry_safe(fence, tmp, &expired, list) {
+		trace_host1x_fence_signal(id, fence->threshold, value,
+					  ktime_to_ns(ktime_sub(ts, fence->queued)));
+		host1x_fence_signal(fence, ts);
+		count++;
+	}
+
 	spin_unlock(&sp->fences.lock);
+
+	if (count && trace_host1x_fence_signal_batch_enabled())
+		trace_host1x_fence_signal_batch(id, value, count,
+						ktime_to_ns(ktime_sub(ktime_get(), ts)));
 }
 
 int host1x_intr_init(struct host1x *host)
@@ -108,7 +160,8 @@ int host1x_intr_init(struct host1x *host)
 		struct host1x_syncpt *syncpt = &host->syncpt[id];
 
 		spin_lock_init(&syncpt->fences.lock);
-		INIT_LIST_HEAD(&syncpt->fences.list);
+		syncpt->fences.root = RB_ROOT_CACHED;
+		syncpt->fences.count = 0;
 	}
 
 	return 0;
@@ -21,6 +21,10 @@
 #include "job.h"
 #include "syncpt.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/host1x_job.h>
+#undef CREATE_TRACE_POINTS
+
 #define HOST1X_WAIT_SYNCPT_OFFSET 0x8
 
 struct host1x_job *host1x_job_alloc(struct host1x_channel *ch,
@@ -57,6 +61,7 @@ struct host1x_job *host1x_job_alloc(struct host1x_channel *ch,
 	kref_init(&job->ref);
 	init_completion(&job->fence_cb_done);
 	job->channel = ch;
+	job->created = ktime_get();
 
 	/* Redistribute memory to the structs  */
 	mem += sizeof(struct host1x_job);
@@ -158,6 +163,7 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 {
 	unsigned long mask = HOST1X_RELOC_READ | HOST1X_RELOC_WRITE;
 	struct host1x_client *client = job->client;
+	struct host1x_bo_cache *cache = NULL;
 	struct device *dev = client->dev;
 	struct host1x_job_gather *g;
 	unsigned int i;
@@ -165,6 +171,13 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 
 	job->num_unpins = 0;
 
+	/*
+	 * Relocation targets are typically reused by many consecutive jobs, so keep their
+	 * mappings around in the channel's cache rather than remapping them every time.
+	 */
+	if (job->channel->cache.max)
+		cache = &job->channel->cache;
+
 	for (i = 0; i < job->num_relocs; i++) {
 		struct host1x_reloc *reloc = &job->relocs[i];
 		enum dma_data_direction direction;
@@ -197,7 +210,7 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 			goto unpin;
 		}
 
-		map = host1x_bo_pin(dev, bo, direction, NULL);
+		map = host1x_bo_pin(dev, bo, direction, cache);
 		if (IS_ERR(map)) {
 			err = PTR_ERR(map);
 			goto unpin;
@@ -244,6 +257,10 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 			goto unpin;
 		}
 
+		/*
+		 * Gather mappings are modified below to point into the host1x domain, so they
+		 * can't be shared through the cache.
+		 */
 		map = host1x_bo_pin(host->dev, g->bo, DMA_TO_DEVICE, NULL);
 		if (IS_ERR(map)) {
 			err = PTR_ERR(map);
@@ -611,11 +628,34 @@ static inline int copy_gathers(struct device *host, struct host1x_job *job,
 	return 0;
 }
 
+/**
+ * host1x_job_add_stage_time() - account time spent in a stage of a job
+ * @job: job
+ * @stage: stage the time was spent in
+ * @ns: time in nanoseconds
+ *
+ * Time added here is reported by the host1x_job_stage tracepoint right away
+ * and accumulated into the channel's latency histograms once the job has
+ * completed. May be called multiple times for the same stage.
+ */
+void host1x_job_add_stage_time(struct host1x_job *job, enum host1x_job_stage stage,
+			       u64 ns)
+{
+	job->stage_ns[stage] += ns;
+	__set_bit(stage, &job->stage_mask);
+
+	trace_host1x_job_stage(dev_name(job->channel->dev),
+			       job->syncpt ? job->syncpt->id : 0, job->syncpt_end,
+			       stage, ns);
+}
+EXPORT_SYMBOL(host1x_job_add_stage_time);
+
 int host1x_job_pin(struct host1x_job *job, struct device *dev)
 {
 	int err;
 	unsigned int i, j;
 	struct host1x *host = dev_get_drvdata(dev->parent);
+	ktime_t start = ktime_get();
 
 	/* pin memory */
 	err = pin_job(host, job);
@@ -623,9 +663,18 @@ int host1x_job_pin(struct host1x_job *job, struct device *dev)
 		goto out;
 
 	if (job->enable_firewall) {
+		ktime_t validate = ktime_get();
+
+		host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_PIN,
+					  ktime_to_ns(ktime_sub(validate, start)));
+
 		err = copy_gathers(host->dev, job, dev);
 		if (err)
 			goto out;
+
+		start = ktime_get();
+		host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_VALIDATE,
+					  ktime_to_ns(ktime_sub(start, validate)));
 	}
 
 	/* patch gathers */
@@ -636,6 +685,10 @@ int host1x_job_pin(struct host1x_job *job, struct device *dev)
 			continue;
 		g = &job->cmds[i].gather;
 
+		atomic64_add(g->words * sizeof(u32), job->enable_firewall ?
+			     &job->channel->gather_bytes_copied :
+			     &job->channel->gather_bytes_direct);
+
 		/* process each gather mem only once */
 		if (g->handled)
 			continue;
@@ -657,6 +710,10 @@ int host1x_job_pin(struct host1x_job *job, struct device *dev)
 			break;
 	}
 
+	if (!err)
+		host1x_job_add_stage_time(job, HOST1X_JOB_STAGE_PIN,
+					  ktime_to_ns(ktime_sub(ktime_get(), start)));
+
 out:
 	if (err)
 		host1x_job_unpin(job);
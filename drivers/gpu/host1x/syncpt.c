@@ -5,12 +5,16 @@
  * Copyright (c) 2010-2015, NVIDIA Corporation.
  */
 
+#include <nvidia/conftest.h>
+
 #include <linux/module.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/dma-fence.h>
+#include <linux/mm.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
+#include <linux/vmalloc.h>
 
 #include <trace/events/host1x.h>
 
@@ -206,6 +210,9 @@ u32 host1x_syncpt_load(struct host1x_syncpt *sp)
 	val = host1x_hw_syncpt_load(sp->host, sp);
 	trace_host1x_syncpt_load_min(sp->id, val);
 
+	if (sp->host->syncpt_shadow)
+		WRITE_ONCE(sp->host->syncpt_shadow[sp->id], val);
+
 	return val;
 }
 
@@ -357,6 +364,10 @@ int host1x_syncpt_init(struct host1x *host)
 	for (i = 0; i < host->info->nb_bases; i++)
 		bases[i].id = i;
 
+	host->syncpt_shadow = vmalloc_user(PAGE_ALIGN(host1x_syncpt_shadow_size(host)));
+	if (!host->syncpt_shadow)
+		return -ENOMEM;
+
 	for (i = 0; i < host->num_pools; i++) {
 		struct host1x_syncpt_pool *pool = &host->pools[i];
 		unsigned int j;
@@ -449,7 +460,56 @@ void host1x_syncpt_deinit(struct host1x *host)
 
 	for (i = 0; i < host->info->nb_pts; i++, sp++)
 		kfree(sp->name);
+
+	vfree(host->syncpt_shadow);
+	host->syncpt_shadow = NULL;
+}
+
+/**
+ * host1x_syncpt_shadow_size() - size of the syncpoint shadow table
+ * @host: host1x instance
+ *
+ * Returns the size in bytes of the table that host1x_syncpt_shadow_mmap()
+ * maps, one 32-bit entry per syncpoint. The mapping itself may extend to the
+ * end of the last page.
+ */
+size_t host1x_syncpt_shadow_size(struct host1x *host)
+{
+	return host->info->nb_pts * sizeof(u32);
+}
+EXPORT_SYMBOL(host1x_syncpt_shadow_size);
+
+/**
+ * host1x_syncpt_shadow_mmap() - map the syncpoint shadow table into userspace
+ * @host: host1x instance
+ * @vma: virtual memory area to map the table into
+ *
+ * The table holds one 32-bit value per syncpoint, indexed by syncpoint ID.
+ * An entry is refreshed each time the kernel reads the syncpoint from
+ * hardware, which includes every fence interrupt. It is therefore a lower
+ * bound on the current value that is exact once any fence on the syncpoint
+ * has signalled. The mapping is read-only.
+ */
+int host1x_syncpt_shadow_mmap(struct host1x *host, struct vm_area_struct *vma)
+{
+	if (!host->syncpt_shadow)
+		return -ENODEV;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (vma->vm_end - vma->vm_start > PAGE_ALIGN(host1x_syncpt_shadow_size(host)))
+		return -EINVAL;
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	return remap_vmalloc_range(vma, host->syncpt_shadow, 0);
 }
+EXPORT_SYMBOL(host1x_syncpt_shadow_mmap);
 
 /**
  * host1x_syncpt_read_max() - read maximum syncpoint value
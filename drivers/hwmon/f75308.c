@@ -37,6 +37,15 @@
 
 #define F75308_BIT_PAIR_SHIFT(index) ((index) % 4 * 2)
 
+/* Cached bank 0 windows: voltages and temperatures, fan counts and duties */
+#define F75308_SENSORS_LO F75308_REG_VOLT(0)
+#define F75308_SENSORS_LO_LEN 0x20
+#define F75308_SENSORS_HI F75308_REG_FAN_READ(0)
+#define F75308_SENSORS_HI_LEN 0x30
+
+#define F75308_DEFAULT_UPDATE_INTERVAL_MS 1000
+#define F75308_MAX_UPDATE_INTERVAL_MS 60000
+
 enum chip {
 	f75308a_28,
 	f75308b_48,
@@ -48,6 +57,12 @@ struct f75308_priv {
 	struct i2c_client *client;
 	struct device *hwmon_dev;
 	enum chip chip_id;
+
+	/* bank 0 registers, indexed by register, all under locker */
+	u8 sensors[F75308_SENSORS_HI + F75308_SENSORS_HI_LEN];
+	bool sensors_valid;
+	unsigned long sensors_updated;
+	unsigned int update_interval_ms;
 };
 
 static inline int temp_from_s16(s16 val)
@@ -90,6 +105,42 @@ static int f75308_read16(struct i2c_client *client, u8 reg)
 	return hi << 8 | lo;
 }
 
+/*
+ * Read consecutive registers, with I2C block reads where the adapter has
+ * them. It is assumed that client->locker is held.
+ */
+static int f75308_read_block(struct i2c_client *client, u8 reg, int len,
+			     u8 *buf)
+{
+	int status, chunk, i;
+
+	if (!i2c_check_functionality(client->adapter,
+				     I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+		for (i = 0; i < len; i++) {
+			status = f75308_read8(client, reg + i);
+			if (status < 0)
+				return status;
+			buf[i] = status;
+		}
+		return 0;
+	}
+
+	while (len > 0) {
+		chunk = min(len, I2C_SMBUS_BLOCK_MAX);
+		status = i2c_smbus_read_i2c_block_data(client, reg, chunk, buf);
+		if (status < 0)
+			return status;
+		if (status != chunk)
+			return -EIO;
+
+		reg += chunk;
+		buf += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
 /*
  * It is assumed that client->locker is held (unless we are in detection or
  * initialization steps).
@@ -129,25 +180,59 @@ static bool f75308_manual_duty_enabled(struct i2c_client *client, int index)
 	return data == 0x03;
 }
 
+/*
+ * Bring the cache of the bank 0 sensor registers up to date. It is
+ * assumed that client->locker is held.
+ */
+static int f75308_update_sensors(struct f75308_priv *priv)
+{
+	struct i2c_client *client = priv->client;
+	int status;
+
+	if (priv->sensors_valid &&
+	    time_before(jiffies, priv->sensors_updated +
+			msecs_to_jiffies(priv->update_interval_ms)))
+		return 0;
+
+	status = f75308_write8(client, F75308_REG_BANK, 0);
+	if (status)
+		goto invalidate;
+
+	status = f75308_read_block(client, F75308_SENSORS_LO,
+				   F75308_SENSORS_LO_LEN,
+				   &priv->sensors[F75308_SENSORS_LO]);
+	if (status)
+		goto invalidate;
+
+	status = f75308_read_block(client, F75308_SENSORS_HI,
+				   F75308_SENSORS_HI_LEN,
+				   &priv->sensors[F75308_SENSORS_HI]);
+	if (status)
+		goto invalidate;
+
+	priv->sensors_valid = true;
+	priv->sensors_updated = jiffies;
+	return 0;
+
+invalidate:
+	priv->sensors_valid = false;
+	return status;
+}
+
 static ssize_t f75308_in_input_show(struct device *dev,
 				    struct device_attribute *attr, char *buf)
 {
 	struct f75308_priv *priv = dev_get_drvdata(dev);
-	struct i2c_client *client = priv->client;
 	int index = to_sensor_dev_attr(attr)->index;
 	int status, data;
 
 	mutex_lock(&priv->locker);
 
-	status = f75308_write8(client, F75308_REG_BANK, 0);
+	status = f75308_update_sensors(priv);
 	if (status)
 		goto release_lock;
 
-	data = f75308_read8(client, F75308_REG_VOLT(index));
-	if (data < 0) {
-		status = data;
-		goto release_lock;
-	}
+	data = priv->sensors[F75308_REG_VOLT(index)];
 
 	mutex_unlock(&priv->locker);
 
@@ -165,21 +250,17 @@ static ssize_t f75308_temp_input_show(struct device *dev,
 				      struct device_attribute *attr, char *buf)
 {
 	struct f75308_priv *priv = dev_get_drvdata(dev);
-	struct i2c_client *client = priv->client;
 	int index = to_sensor_dev_attr(attr)->index;
 	int status, data;
 
 	mutex_lock(&priv->locker);
 
-	status = f75308_write8(client, F75308_REG_BANK, 0);
+	status = f75308_update_sensors(priv);
 	if (status)
 		goto release_lock;
 
-	data = f75308_read16(client, F75308_REG_TEMP_READ(index));
-	if (data < 0) {
-		status = data;
-		goto release_lock;
-	}
+	data = priv->sensors[F75308_REG_TEMP_READ(index)] << 8 |
+	       priv->sensors[F75308_REG_TEMP_READ(index) + 1];
 
 	mutex_unlock(&priv->locker);
 
@@ -196,27 +277,17 @@ static ssize_t f75308_fan_input_show(struct device *dev,
 				     struct device_attribute *attr, char *buf)
 {
 	struct f75308_priv *priv = dev_get_drvdata(dev);
-	struct i2c_client *client = priv->client;
 	int index = to_sensor_dev_attr(attr)->index;
 	int status, lsb, msb, data;
 
 	mutex_lock(&priv->locker);
 
-	status = f75308_write8(client, F75308_REG_BANK, 0);
+	status = f75308_update_sensors(priv);
 	if (status)
 		goto release_lock;
 
-	msb = f75308_read8(client, F75308_REG_FAN_READ(index) + 0);
-	if (msb < 0) {
-		status = msb;
-		goto release_lock;
-	}
-
-	lsb = f75308_read8(client, F75308_REG_FAN_READ(index) + 1);
-	if (lsb < 0) {
-		status = lsb;
-		goto release_lock;
-	}
+	msb = priv->sensors[F75308_REG_FAN_READ(index) + 0];
+	lsb = priv->sensors[F75308_REG_FAN_READ(index) + 1];
 
 	mutex_unlock(&priv->locker);
 
@@ -241,21 +312,16 @@ static ssize_t f75308_pwm_show(struct device *dev,
 			       struct device_attribute *attr, char *buf)
 {
 	struct f75308_priv *priv = dev_get_drvdata(dev);
-	struct i2c_client *client = priv->client;
 	int index = to_sensor_dev_attr(attr)->index;
 	int status, data;
 
 	mutex_lock(&priv->locker);
 
-	status = f75308_write8(client, F75308_REG_BANK, 0);
+	status = f75308_update_sensors(priv);
 	if (status)
 		goto release_lock;
 
-	data = f75308_read8(client, F75308_REG_FAN_DUTY_READ(index));
-	if (data < 0) {
-		status = data;
-		goto release_lock;
-	}
+	data = priv->sensors[F75308_REG_FAN_DUTY_READ(index)];
 
 	mutex_unlock(&priv->locker);
 
@@ -267,6 +333,36 @@ release_lock:
 	return status;
 }
 
+static ssize_t update_interval_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct f75308_priv *priv = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", READ_ONCE(priv->update_interval_ms));
+}
+
+/* 0 reads the chip on every access */
+static ssize_t update_interval_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct f75308_priv *priv = dev_get_drvdata(dev);
+	unsigned int val;
+	int status;
+
+	status = kstrtouint(buf, 0, &val);
+	if (status)
+		return status;
+
+	mutex_lock(&priv->locker);
+	priv->update_interval_ms = min_t(unsigned int, val,
+					 F75308_MAX_UPDATE_INTERVAL_MS);
+	priv->sensors_valid = false;
+	mutex_unlock(&priv->locker);
+
+	return count;
+}
+
 static ssize_t f75308_pwm_store(struct device *dev,
 				struct device_attribute *attr, const char *buf,
 				size_t count)
@@ -297,6 +393,9 @@ static ssize_t f75308_pwm_store(struct device *dev,
 
 	status = f75308_write8(client, F75308_REG_FAN_DUTY_WRITE(index), pwm);
 
+	/* Let the next read see the new duty */
+	priv->sensors_valid = false;
+
 release_lock:
 	mutex_unlock(&priv->locker);
 	return status ? status : count;
@@ -651,6 +750,8 @@ release_lock:
 	return status ? status : count;
 }
 
+static DEVICE_ATTR_RW(update_interval);
+
 static SENSOR_DEVICE_ATTR_RO(in0_input, f75308_in_input, 0);
 static SENSOR_DEVICE_ATTR_RO(in1_input, f75308_in_input, 1);
 static SENSOR_DEVICE_ATTR_RO(in2_input, f75308_in_input, 2);
@@ -751,6 +852,7 @@ static SENSOR_DEVICE_ATTR_RW(fan10_map, f75308_fan_map, 9);
 static SENSOR_DEVICE_ATTR_RW(fan11_map, f75308_fan_map, 10);
 
 static struct attribute *f75308a_28_attributes[] = {
+	&dev_attr_update_interval.attr,
 	&sensor_dev_attr_temp0_input.dev_attr.attr,
 	&sensor_dev_attr_temp1_input.dev_attr.attr,
 	&sensor_dev_attr_temp2_input.dev_attr.attr,
@@ -797,6 +899,7 @@ static struct attribute *f75308a_28_attributes[] = {
 };
 
 static struct attribute *f75308b_48_attributes[] = {
+	&dev_attr_update_interval.attr,
 	&sensor_dev_attr_temp0_input.dev_attr.attr,
 	&sensor_dev_attr_temp1_input.dev_attr.attr,
 	&sensor_dev_attr_temp2_input.dev_attr.attr,
@@ -870,6 +973,7 @@ static struct attribute *f75308b_48_attributes[] = {
 };
 
 static struct attribute *f75308c_64_attributes[] = {
+	&dev_attr_update_interval.attr,
 	&sensor_dev_attr_temp0_input.dev_attr.attr,
 	&sensor_dev_attr_temp1_input.dev_attr.attr,
 	&sensor_dev_attr_temp2_input.dev_attr.attr,
@@ -1187,6 +1291,7 @@ static int f75308_probe(struct i2c_client *client)
 
 	mutex_init(&priv->locker);
 	priv->client = client;
+	priv->update_interval_ms = F75308_DEFAULT_UPDATE_INTERVAL_MS;
 	dev_set_drvdata(dev, priv);
 
 	status = f75308_get_devid(client, &priv->chip_id);
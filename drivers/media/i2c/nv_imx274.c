@@ -181,7 +181,8 @@ static int imx274_write_reg(struct camera_common_data *s_data, u16 addr, u8 val)
 static int imx274_write_table(struct imx274 *priv,
 				const imx274_reg table[])
 {
-	return regmap_util_write_table_8(priv->s_data->regmap,
+	return regmap_util_write_table_8_cached(priv->s_data->regmap,
+					 &priv->s_data->table_cache,
 					 table,
 					 NULL, 0,
 					 IMX274_TABLE_WAIT_MS,
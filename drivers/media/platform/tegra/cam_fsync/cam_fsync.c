@@ -12,18 +12,27 @@
 #include <linux/device.h>
 #include <linux/debugfs.h>
 #include <linux/err.h>
+#include <linux/gcd.h>
+#include <linux/gpio/consumer.h>
+#include <linux/hte.h>
 #include <linux/io.h>
 #include <linux/lcm.h>
 #include <linux/list.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
+#include <linux/platform/tegra/ptp-notifier.h>
 #include <linux/pm.h>
 #include <linux/cdev.h>
 #include <linux/fs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 #include <uapi/media/cam_fsync.h>
 
@@ -31,6 +40,7 @@
 #define TSC_TICKS_PER_HZ			(31250000ULL)
 #define TSC_NS_PER_TICK				(32)
 #define NS_PER_MS				(1000000U)
+#define NS_PER_SEC				(1000000000ULL)
 
 #define TSC_MTSCCNTCV0				(0x10)
 #define TSC_MTSCCNTCV0_CV			GENMASK(31, 0)
@@ -80,6 +90,11 @@
 #define CAM_FSYNC_CLASS_NAME	"cam-fsync-groups"
 #define CAM_FSYNC_GROUPS_NODE	"fsync-groups"
 
+static unsigned int telemetry_interval_ms = 1000;
+module_param(telemetry_interval_ms, uint, 0644);
+MODULE_PARM_DESC(telemetry_interval_ms,
+	"Interval (ms) between frame-sync telemetry samples, 0 disables");
+
 /**
  * struct cam_fsync_controller_features: TSC signal controller SW feature support.
  * @rational_locking:
@@ -106,6 +121,12 @@ struct cam_fsync_controller_features {
  *   @freq_hz: Frequency (hz) of the generator.
  *   @duty_cycle: Duty cycle (%) of the generator.
  *   @offset_ms: Offset (ms) to shift the signal by.
+ * @ticks_in_period: Programmed period of the generator in TSC ticks.
+ * @edge:
+ *   @gpio: Optional loopback input of the generator output.
+ *   @desc: GTE line descriptor of @gpio.
+ *   @tsc_ns: TSC time (ns) of the last captured rising edge.
+ *   @enabled: Rising edges are captured by the GTE.
  * @debugfs:
  *   @regset_ro: Debug FS read-only register set.
  * @list: List node
@@ -118,6 +139,13 @@ struct cam_fsync_generator {
 		u32 duty_cycle;
 		u32 offset_ms;
 	} config;
+	u32 ticks_in_period;
+	struct {
+		struct gpio_desc *gpio;
+		struct hte_ts_desc desc;
+		u64 tsc_ns;
+		bool enabled;
+	} edge;
 	struct {
 		struct debugfs_regset32 regset_ro;
 	} debugfs;
@@ -131,6 +159,16 @@ struct cam_fsync_generator {
  * @features: Feature support for the group.
  * @abs_start_ticks: Start time in TSC ticks to start all generators in group
  * @active: Is group active
+ * @lock: Serializes generator programming and telemetry
+ * @telemetry_work: Periodic telemetry sampling work
+ * @telemetry: Last telemetry sample, see struct cam_fsync_telemetry
+ * @estimator:
+ *   @last_phase_err_ns: Mean phase error of the previous sample.
+ *   @last_ptp_ns: PTP time of the previous sample.
+ *   @valid: The previous sample may be used for drift estimation.
+ * @correction:
+ *   @ptp_phase_ns: PTP phase of the group's first edge within a second.
+ *   @threshold_ns: Filtered phase error that triggers a correction.
  * @generators: Linked list of child generators
  * @list: List node
  */
@@ -140,6 +178,18 @@ struct fsync_generator_group {
 	const struct cam_fsync_controller_features *features;
 	uint64_t abs_start_ticks;
 	bool active;
+	struct mutex lock;
+	struct delayed_work telemetry_work;
+	struct cam_fsync_telemetry telemetry;
+	struct {
+		s64 last_phase_err_ns;
+		u64 last_ptp_ns;
+		bool valid;
+	} estimator;
+	struct {
+		u64 ptp_phase_ns;
+		u32 threshold_ns;
+	} correction;
 	struct list_head generators;
 	struct list_head list;
 };
@@ -246,6 +296,79 @@ cam_fsync_is_generator_in_group(struct cam_fsync_controller *controller,
 	return false;
 }
 
+/**
+ * @brief GTE callback for a generator rising edge
+ *
+ * @param[in]	ts	hardware timestamp of the edge (non-null)
+ * @param[in]	p	pointer to struct cam_fsync_generator (non-null)
+ *
+ * @returns	HTE_CB_HANDLED
+ */
+static enum hte_return cam_fsync_generator_edge_ts(struct hte_ts_data *ts, void *p)
+{
+	struct cam_fsync_generator *generator = p;
+
+	WRITE_ONCE(generator->edge.tsc_ns, ts->tsc);
+
+	return HTE_CB_HANDLED;
+}
+
+/**
+ * @brief Set up GTE capture of the generator output
+ * The generator output may be looped back to a GPIO described by the optional
+ * "timestamp-gpios" property of the generator node, with "nvidia,hte-index"
+ * selecting its entry in the controller's "timestamps" property. Edge capture
+ * is optional; without it the telemetry falls back to the programmed schedule.
+ *
+ * @param[in]	group	pointer to struct fsync_generator_group (non-null)
+ * @param[in]	generator	pointer to struct cam_fsync_generator (non-null)
+ */
+static void cam_fsync_generator_edge_setup(struct fsync_generator_group *group,
+					struct cam_fsync_generator *generator)
+{
+	struct device_node *np = generator->of;
+	u32 index;
+	int err;
+
+	generator->edge.gpio = devm_fwnode_gpiod_get(group->dev, of_fwnode_handle(np),
+		"timestamp", GPIOD_IN, np->name);
+	if (IS_ERR(generator->edge.gpio)) {
+		if (PTR_ERR(generator->edge.gpio) != -ENOENT)
+			dev_warn(group->dev, "Failed to get timestamp gpio of %s: %ld\n",
+				np->full_name, PTR_ERR(generator->edge.gpio));
+		generator->edge.gpio = NULL;
+		return;
+	}
+
+	err = of_property_read_u32(np, "nvidia,hte-index", &index);
+	if (err != 0) {
+		dev_warn(group->dev, "No GTE line for %s\n", np->full_name);
+		return;
+	}
+
+	err = hte_init_line_attr(&generator->edge.desc, 0, HTE_RISING_EDGE_TS, NULL,
+		generator->edge.gpio);
+	if (err < 0) {
+		dev_warn(group->dev, "hte_init_line_attr failed: %d\n", err);
+		return;
+	}
+
+	err = hte_ts_get(group->dev, &generator->edge.desc, index);
+	if (err < 0) {
+		dev_warn(group->dev, "hte_ts_get failed: %d\n", err);
+		return;
+	}
+
+	err = devm_hte_request_ts_ns(group->dev, &generator->edge.desc,
+		cam_fsync_generator_edge_ts, NULL, generator);
+	if (err < 0) {
+		dev_warn(group->dev, "devm_hte_request_ts_ns failed: %d\n", err);
+		return;
+	}
+
+	generator->edge.enabled = true;
+}
+
 /**
  * @brief Add generators to fsync generator group struct
  * Allocate memory for generator, read and program details from DT
@@ -310,6 +433,9 @@ static int cam_fsync_add_generator(struct fsync_generator_group *group, struct d
 			return err;
 		}
 	}
+
+	cam_fsync_generator_edge_setup(group, generator);
+
 	list_add_tail(&generator->list, &group->generators);
 	return err;
 }
@@ -351,6 +477,7 @@ static int cam_fsync_program_group_generator_edges(struct fsync_generator_group
 				generator->config.freq_hz);
 		}
 
+		generator->ticks_in_period = ticks_in_period;
 		ticks_active = mult_frac(ticks_in_period, generator->config.duty_cycle, 100);
 		ticks_inactive = ticks_in_period - ticks_active;
 
@@ -367,6 +494,26 @@ static int cam_fsync_program_group_generator_edges(struct fsync_generator_group
 	return 0;
 }
 
+/**
+ * @brief Get the start time of a generator in TSC ticks
+ *
+ * @param[in]	group	pointer to struct fsync_generator_group (non-null)
+ * @param[in]	generator	pointer to struct cam_fsync_generator (non-null)
+ *
+ * @returns	Group start time shifted by the generator offset
+ */
+static u64 cam_fsync_generator_start_ticks(struct fsync_generator_group *group,
+					struct cam_fsync_generator *generator)
+{
+	u64 abs_start_tsc_ticks = group->abs_start_ticks;
+
+	if (group->features->offset.enabled && (generator->config.offset_ms != 0))
+		abs_start_tsc_ticks += mult_frac(generator->config.offset_ms,
+			NS_PER_MS, TSC_NS_PER_TICK);
+
+	return abs_start_tsc_ticks;
+}
+
 /**
  * @brief Program start value to the generator
  *
@@ -378,10 +525,7 @@ static void cam_fsync_program_group_generator_start_values(struct fsync_generato
 	uint64_t abs_start_tsc_ticks = 0;
 
 	list_for_each_entry(generator, &group->generators, list) {
-		abs_start_tsc_ticks = group->abs_start_ticks;
-		if (group->features->offset.enabled && (generator->config.offset_ms != 0))
-			abs_start_tsc_ticks += mult_frac(generator->config.offset_ms,
-				NS_PER_MS, TSC_NS_PER_TICK);
+		abs_start_tsc_ticks = cam_fsync_generator_start_ticks(group, generator);
 
 		cam_fsync_generator_writel(generator, TSC_GENX_START0,
 			FIELD_PREP(TSC_GENX_START0_LSB_VAL, lower_32_bits(abs_start_tsc_ticks)));
@@ -533,6 +677,297 @@ static int cam_fsync_stop_group_generators(struct fsync_generator_group *group)
 	return 0;
 }
 
+/**
+ * @brief Get the TSC time of the last rising edge of a generator
+ * Uses the GTE timestamp when one was captured within the last two periods,
+ * otherwise the last edge predicted by the programmed schedule.
+ *
+ * @param[in]	group	pointer to struct fsync_generator_group (non-null)
+ * @param[in]	generator	pointer to struct cam_fsync_generator (non-null)
+ * @param[in]	now_tsc_ns	current TSC time (ns)
+ * @param[out]	measured	set if the edge was captured by the GTE (non-null)
+ *
+ * @returns	TSC time (ns) of the edge
+ */
+static u64 cam_fsync_generator_edge_tsc_ns(struct fsync_generator_group *group,
+					struct cam_fsync_generator *generator,
+					u64 now_tsc_ns, bool *measured)
+{
+	const u64 period_ns = (u64)generator->ticks_in_period * TSC_NS_PER_TICK;
+	const u64 start_ns = cam_fsync_generator_start_ticks(group, generator) * TSC_NS_PER_TICK;
+	u64 edge_ns;
+
+	if (generator->edge.enabled) {
+		edge_ns = READ_ONCE(generator->edge.tsc_ns);
+		if ((edge_ns != 0) && (edge_ns <= now_tsc_ns) &&
+		    (now_tsc_ns - edge_ns < 2 * period_ns)) {
+			*measured = true;
+			return edge_ns;
+		}
+	}
+
+	*measured = false;
+
+	if ((period_ns == 0) || (now_tsc_ns < start_ns))
+		return start_ns;
+
+	return start_ns + div64_u64(now_tsc_ns - start_ns, period_ns) * period_ns;
+}
+
+/**
+ * @brief Get the phase error of a generator edge against the PTP grid
+ * The grid places edges at the configured PTP phase plus the generator offset,
+ * repeating every 1 / freq_hz seconds.
+ *
+ * @param[in]	group	pointer to struct fsync_generator_group (non-null)
+ * @param[in]	generator	pointer to struct cam_fsync_generator (non-null)
+ * @param[in]	edge_ptp_ns	PTP time (ns) of the edge
+ *
+ * @returns	Phase error (ns), wrapped to +/- half a period
+ */
+static s64 cam_fsync_generator_phase_err(struct fsync_generator_group *group,
+					struct cam_fsync_generator *generator,
+					u64 edge_ptp_ns)
+{
+	const u32 freq_hz = generator->config.freq_hz;
+	u64 base_ns = group->correction.ptp_phase_ns;
+	u64 rem_ns;
+	s64 err_ns;
+
+	if (group->features->offset.enabled)
+		base_ns += (u64)generator->config.offset_ms * NS_PER_MS;
+
+	div64_u64_rem(base_ns, NS_PER_SEC, &base_ns);
+	div64_u64_rem(edge_ptp_ns + NS_PER_SEC - base_ns, NS_PER_SEC, &rem_ns);
+
+	/* Position within the period, scaled by freq_hz to stay in integers */
+	div64_u64_rem(rem_ns * freq_hz, NS_PER_SEC, &rem_ns);
+
+	err_ns = rem_ns;
+	if (rem_ns > NS_PER_SEC / 2)
+		err_ns -= NS_PER_SEC;
+
+	return div_s64(err_ns, freq_hz);
+}
+
+/**
+ * @brief Take a telemetry sample of a group
+ * Called with group->lock held.
+ *
+ * @param[in]	group	pointer to struct fsync_generator_group (non-null)
+ * @param[out]	ts	PTP/TSC time pair of the sample (non-null)
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+static int cam_fsync_group_sample(struct fsync_generator_group *group, struct ptp_tsc_data *ts)
+{
+	struct cam_fsync_telemetry *telemetry = &group->telemetry;
+	struct cam_fsync_generator *generator;
+	s64 min_err_ns = S64_MAX;
+	s64 max_err_ns = S64_MIN;
+	s64 sum_err_ns = 0;
+	s64 mean_err_ns;
+	bool all_measured = true;
+	unsigned int count = 0;
+	int err;
+
+	telemetry->flags &= ~(CAM_FSYNC_TELEMETRY_PTP_VALID | CAM_FSYNC_TELEMETRY_MEASURED);
+
+	err = tegra_get_hwtime(NULL, ts, PTP_TSC_HWTIME);
+	if (err != 0) {
+		group->estimator.valid = false;
+		return err;
+	}
+
+	list_for_each_entry(generator, &group->generators, list) {
+		bool measured;
+		u64 edge_ns = cam_fsync_generator_edge_tsc_ns(group, generator,
+			ts->tsc_ts, &measured);
+		s64 err_ns = cam_fsync_generator_phase_err(group, generator,
+			edge_ns + ts->ptp_ts - ts->tsc_ts);
+
+		sum_err_ns += err_ns;
+		min_err_ns = min(min_err_ns, err_ns);
+		max_err_ns = max(max_err_ns, err_ns);
+		all_measured &= measured;
+		count++;
+	}
+
+	if (count == 0)
+		return -ENODEV;
+
+	mean_err_ns = div_s64(sum_err_ns, count);
+
+	telemetry->ptp_ns = ts->ptp_ts;
+	telemetry->tsc_ns = ts->tsc_ts;
+	telemetry->phase_err_ns = mean_err_ns;
+	telemetry->skew_ns = max_err_ns - min_err_ns;
+	telemetry->flags |= CAM_FSYNC_TELEMETRY_PTP_VALID;
+	if (all_measured)
+		telemetry->flags |= CAM_FSYNC_TELEMETRY_MEASURED;
+
+	if (!group->estimator.valid) {
+		telemetry->filtered_phase_err_ns = mean_err_ns;
+	} else {
+		u64 elapsed_ns = ts->ptp_ts - group->estimator.last_ptp_ns;
+
+		telemetry->filtered_phase_err_ns +=
+			div_s64(mean_err_ns - telemetry->filtered_phase_err_ns, 4);
+
+		if ((ts->ptp_ts > group->estimator.last_ptp_ns) && (elapsed_ns != 0)) {
+			s64 drift_ppb = div64_s64((mean_err_ns - group->estimator.last_phase_err_ns) *
+				(s64)NS_PER_SEC, elapsed_ns);
+
+			telemetry->drift_ppb += div_s64(drift_ppb - telemetry->drift_ppb, 8);
+		}
+	}
+
+	telemetry->max_abs_phase_err_ns = max_t(s64, telemetry->max_abs_phase_err_ns,
+		abs(mean_err_ns));
+	telemetry->samples++;
+
+	group->estimator.last_phase_err_ns = mean_err_ns;
+	group->estimator.last_ptp_ns = ts->ptp_ts;
+	group->estimator.valid = true;
+
+	return 0;
+}
+
+/**
+ * @brief Restart a group on the PTP grid
+ * The generators are stopped and restarted at the next grid point common to
+ * all of them that is at least TSC_GENX_START_OFFSET_MS ahead, which costs one
+ * short gap in the output. Called with group->lock held.
+ *
+ * @param[in]	group	pointer to struct fsync_generator_group (non-null)
+ * @param[in]	ts	current PTP/TSC time pair (non-null)
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+static int cam_fsync_group_correct_phase(struct fsync_generator_group *group,
+					const struct ptp_tsc_data *ts)
+{
+	struct cam_fsync_generator *generator;
+	u64 phase_ns, from_ns, rem_ns, sec, k, start_ptp_ns;
+	u32 grid_hz = 0;
+	int err;
+
+	list_for_each_entry(generator, &group->generators, list) {
+		grid_hz = gcd(generator->config.freq_hz, grid_hz);
+	}
+
+	if (grid_hz == 0)
+		return -ENODEV;
+
+	div64_u64_rem(group->correction.ptp_phase_ns, NS_PER_SEC, &phase_ns);
+	from_ns = ts->ptp_ts + (u64)TSC_GENX_START_OFFSET_MS * NS_PER_MS - phase_ns;
+	sec = div64_u64_rem(from_ns, NS_PER_SEC, &rem_ns);
+	k = DIV_ROUND_UP_ULL(rem_ns * grid_hz, NS_PER_SEC);
+	start_ptp_ns = phase_ns + sec * NS_PER_SEC + DIV_ROUND_CLOSEST_ULL(k * NS_PER_SEC, grid_hz);
+
+	err = cam_fsync_stop_group_generators(group);
+	if (err != 0)
+		return err;
+
+	group->abs_start_ticks = div_u64(start_ptp_ns - (ts->ptp_ts - ts->tsc_ts),
+		TSC_NS_PER_TICK);
+
+	err = cam_fsync_start_group_generators(group);
+	if (err != 0)
+		return err;
+
+	group->telemetry.corrections++;
+	group->estimator.valid = false;
+
+	return 0;
+}
+
+/**
+ * @brief Periodic telemetry and phase correction of a group
+ *
+ * @param[in]	work	pointer to struct work_struct (non-null)
+ */
+static void cam_fsync_telemetry_work(struct work_struct *work)
+{
+	struct fsync_generator_group *group = container_of(to_delayed_work(work),
+		struct fsync_generator_group, telemetry_work);
+	unsigned int interval_ms;
+	struct ptp_tsc_data ts;
+	int err;
+
+	mutex_lock(&group->lock);
+
+	if (group->active && (cam_fsync_group_sample(group, &ts) == 0) &&
+	    (group->correction.threshold_ns != 0) &&
+	    (abs(group->telemetry.filtered_phase_err_ns) > group->correction.threshold_ns)) {
+		err = cam_fsync_group_correct_phase(group, &ts);
+		if (err != 0)
+			dev_err(group->dev, "Failed to correct phase of group %u: %d\n",
+				group->id, err);
+	}
+
+	mutex_unlock(&group->lock);
+
+	interval_ms = READ_ONCE(telemetry_interval_ms);
+	if (interval_ms != 0)
+		schedule_delayed_work(&group->telemetry_work, msecs_to_jiffies(interval_ms));
+}
+
+/**
+ * @brief Start periodic telemetry of a group
+ *
+ * @param[in]	group	pointer to struct fsync_generator_group (non-null)
+ */
+static void cam_fsync_telemetry_start(struct fsync_generator_group *group)
+{
+	const unsigned int interval_ms = READ_ONCE(telemetry_interval_ms);
+
+	if (interval_ms != 0)
+		schedule_delayed_work(&group->telemetry_work, msecs_to_jiffies(interval_ms));
+}
+
+/**
+ * @brief Show the telemetry of a group in debugfs
+ *
+ * @param[in]	s	pointer to struct seq_file (non-null)
+ * @param[in]	data	unused
+ *
+ * @returns	0 (success)
+ */
+static int cam_fsync_telemetry_show(struct seq_file *s, void *data)
+{
+	struct fsync_generator_group *group = s->private;
+	struct cam_fsync_telemetry telemetry;
+	struct cam_fsync_generator *generator;
+
+	mutex_lock(&group->lock);
+	telemetry = group->telemetry;
+	mutex_unlock(&group->lock);
+
+	seq_printf(s, "ptp_ns: %llu\n", telemetry.ptp_ns);
+	seq_printf(s, "tsc_ns: %llu\n", telemetry.tsc_ns);
+	seq_printf(s, "phase_err_ns: %lld\n", telemetry.phase_err_ns);
+	seq_printf(s, "filtered_phase_err_ns: %lld\n", telemetry.filtered_phase_err_ns);
+	seq_printf(s, "drift_ppb: %lld\n", telemetry.drift_ppb);
+	seq_printf(s, "max_abs_phase_err_ns: %lld\n", telemetry.max_abs_phase_err_ns);
+	seq_printf(s, "skew_ns: %lld\n", telemetry.skew_ns);
+	seq_printf(s, "samples: %llu\n", telemetry.samples);
+	seq_printf(s, "corrections: %u\n", telemetry.corrections);
+	seq_printf(s, "ptp_valid: %d\n",
+		!!(telemetry.flags & CAM_FSYNC_TELEMETRY_PTP_VALID));
+	seq_printf(s, "measured: %d\n",
+		!!(telemetry.flags & CAM_FSYNC_TELEMETRY_MEASURED));
+	seq_printf(s, "correction_threshold_ns: %u\n", group->correction.threshold_ns);
+
+	list_for_each_entry(generator, &group->generators, list) {
+		seq_printf(s, "%s: gte %s\n", generator->of->full_name,
+			generator->edge.enabled ? "enabled" : "disabled");
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cam_fsync_telemetry);
+
 /**
  * @brief Init debugfs
  *
@@ -551,6 +986,12 @@ static int cam_fsync_debugfs_init(struct cam_fsync_controller *controller)
 		return PTR_ERR(controller->debugfs.d);
 
 	list_for_each_entry(group, &controller->groups, list) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "group%u_telemetry", group->id);
+		debugfs_create_file(name, 0400, controller->debugfs.d, group,
+			&cam_fsync_telemetry_fops);
+
 		list_for_each_entry(generator, &group->generators, list) {
 			generator->debugfs.regset_ro.regs = cam_fsync_generator_debugfs_regset;
 			generator->debugfs.regset_ro.nregs = TSC_SIG_GEN_DEBUGFS_REGSET_SIZE;
@@ -668,29 +1109,64 @@ cam_fsync_validate_start_time(struct cam_fsync_controller *controller, u64 start
  * This is the a ioctl file operation handler for a cam fsync group.
  *
  * @param[in]	file	cam fsync group character device file struct (non-null)
- * @param[in]	cmd	cam fsync group IOCTL command (CAM_FSYNC_GRP_ABS_START_VAL)
- * @param[in]	startTimeInTSCTicks	numerical value start time
- *					(current_ticks < value > MAX_UINT64)
+ * @param[in]	cmd	cam fsync group IOCTL command (CAM_FSYNC_GRP_*)
+ * @param[in]	arg	user pointer to the IOCTL payload:
+ *			CAM_FSYNC_GRP_ABS_START_VAL: start time in TSC ticks
+ *				(current_ticks < value > MAX_UINT64)
+ *			CAM_FSYNC_GRP_GET_TELEMETRY: struct cam_fsync_telemetry
+ *			CAM_FSYNC_GRP_SET_PHASE_CORRECTION: struct cam_fsync_phase_correction
  *
  * @returns	0 (success), neg. errno (failure)
  */
-static long cam_fsync_ioctl(struct file *file, unsigned int cmd, unsigned long startTimeInTSCTicks)
+static long cam_fsync_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct fsync_generator_group *group = file->private_data;
 	struct cam_fsync_controller *controller = dev_get_drvdata(group->dev);
+	struct cam_fsync_phase_correction correction;
+	struct cam_fsync_telemetry telemetry;
+	u64 start_ticks;
 	long err = 0;
 
 	switch (cmd) {
 	case CAM_FSYNC_GRP_ABS_START_VAL:
-			if (copy_from_user(&group->abs_start_ticks, (u64 *)startTimeInTSCTicks,
-				sizeof(group->abs_start_ticks)))
+			if (copy_from_user(&start_ticks, (u64 __user *)arg, sizeof(start_ticks))) {
 				dev_err(group->dev, "Unable to read start value\n");
-			err = cam_fsync_validate_start_time(controller, group->abs_start_ticks);
+				return -EFAULT;
+			}
+			err = cam_fsync_validate_start_time(controller, start_ticks);
 			if (err != 0) {
 				dev_err(group->dev, "Invalid start value\n");
 				return err;
 			}
+			mutex_lock(&group->lock);
+			group->abs_start_ticks = start_ticks;
 			err = cam_fsync_start_group_generators(group);
+			group->estimator.valid = false;
+			mutex_unlock(&group->lock);
+			if (err == 0)
+				cam_fsync_telemetry_start(group);
+			break;
+	case CAM_FSYNC_GRP_GET_TELEMETRY:
+			mutex_lock(&group->lock);
+			telemetry = group->telemetry;
+			mutex_unlock(&group->lock);
+			if (copy_to_user((void __user *)arg, &telemetry, sizeof(telemetry)))
+				err = -EFAULT;
+			break;
+	case CAM_FSYNC_GRP_SET_PHASE_CORRECTION:
+			if (copy_from_user(&correction, (void __user *)arg, sizeof(correction)))
+				return -EFAULT;
+			if (correction.reserved != 0)
+				return -EINVAL;
+			mutex_lock(&group->lock);
+			group->correction.ptp_phase_ns = correction.ptp_phase_ns;
+			group->correction.threshold_ns = correction.threshold_ns;
+			if (correction.threshold_ns != 0)
+				group->telemetry.flags |= CAM_FSYNC_TELEMETRY_CORRECTING;
+			else
+				group->telemetry.flags &= ~CAM_FSYNC_TELEMETRY_CORRECTING;
+			group->estimator.valid = false;
+			mutex_unlock(&group->lock);
 			break;
 	default:
 			dev_err(group->dev, "Invalid command\n");
@@ -777,6 +1253,8 @@ static struct fsync_generator_group *cam_fsync_group_init(
 
 	INIT_LIST_HEAD(&group->generators);
 	INIT_LIST_HEAD(&group->list);
+	mutex_init(&group->lock);
+	INIT_DELAYED_WORK(&group->telemetry_work, cam_fsync_telemetry_work);
 	group->id = group_id;
 	group->dev = controller->dev;
 	group->features = controller->features;
@@ -964,7 +1442,11 @@ static int cam_fsync_default(struct cam_fsync_controller *controller)
 
 	group = cam_fsync_get_group_by_id(controller, TSC_DEFAULT_GROUP_ID);
 	group->abs_start_ticks = cam_fsync_get_default_start_ticks(controller);
-	return cam_fsync_start_group_generators(group);
+	err = cam_fsync_start_group_generators(group);
+	if (err == 0)
+		cam_fsync_telemetry_start(group);
+
+	return err;
 }
 
 /**
@@ -1056,6 +1538,7 @@ static int cam_fsync_remove(struct platform_device *pdev)
 	cam_fsync_chrdev_deinit(controller);
 
 	list_for_each_entry(group, &controller->groups, list) {
+		cancel_delayed_work_sync(&group->telemetry_work);
 		if (group->active) {
 			err = cam_fsync_stop_group_generators(group);
 			if (err != 0)
@@ -1082,8 +1565,11 @@ static int __maybe_unused cam_fsync_suspend(struct device *dev)
 	int err = 0;
 
 	list_for_each_entry(group, &controller->groups, list) {
+		cancel_delayed_work_sync(&group->telemetry_work);
 		if (group->active) {
+			mutex_lock(&group->lock);
 			err = cam_fsync_stop_group_generators(group);
+			mutex_unlock(&group->lock);
 			if (err != 0)
 				return err;
 		}
@@ -1108,9 +1594,13 @@ static int __maybe_unused cam_fsync_resume(struct device *dev)
 
 	list_for_each_entry(group, &controller->groups, list) {
 		if (group->active) {
+			mutex_lock(&group->lock);
 			err = cam_fsync_start_group_generators(group);
+			group->estimator.valid = false;
+			mutex_unlock(&group->lock);
 			if (err != 0)
 				return err;
+			cam_fsync_telemetry_start(group);
 		}
 	}
 
@@ -410,6 +410,33 @@ static const struct file_operations camera_common_debugfs_fops = {
 	.release	= single_release,
 };
 
+static int camera_common_timing_show(struct seq_file *s, void *unused)
+{
+	struct camera_common_data *s_data = s->private;
+	struct camera_common_timing *timing = &s_data->timing;
+	struct regmap_util_table_cache *cache = &s_data->table_cache;
+
+	seq_printf(s, "mode_switch_ns: %llu\n", timing->mode_switch_ns);
+	seq_printf(s, "mode_switch_max_ns: %llu\n", timing->mode_switch_max_ns);
+	seq_printf(s, "stream_start_ns: %llu\n", timing->stream_start_ns);
+	seq_printf(s, "stream_start_max_ns: %llu\n", timing->stream_start_max_ns);
+	seq_printf(s, "stream_starts: %llu\n", timing->stream_starts);
+	seq_printf(s, "tables: %llu\n", cache->tables);
+	seq_printf(s, "bursts: %llu\n", cache->bursts);
+	seq_printf(s, "regs_written: %llu\n", cache->regs_written);
+	seq_printf(s, "regs_skipped: %llu\n", cache->regs_skipped);
+
+	if (s_data->tegracam_ctrl_hdl) {
+		seq_printf(s, "ctrl_batches: %llu\n",
+			   s_data->tegracam_ctrl_hdl->batch.applied);
+		seq_printf(s, "ctrl_batch_errors: %llu\n",
+			   s_data->tegracam_ctrl_hdl->batch.errors);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(camera_common_timing);
+
 void camera_common_remove_debugfs(
 		struct camera_common_data *s_data)
 {
@@ -443,6 +470,9 @@ void camera_common_create_debugfs(
 	if (!err)
 		goto remove_debugfs;
 
+	debugfs_create_file("timing", S_IRUGO, s_data->debugdir, s_data,
+			    &camera_common_timing_fops);
+
 	return;
 remove_debugfs:
 	dev_err(dev, "couldn't create debugfs\n");
@@ -951,6 +981,8 @@ int camera_common_s_power(struct v4l2_subdev *sd, int on)
 		camera_common_dpd_enable(s_data);
 		camera_common_mclk_disable(s_data);
 		call_s_op(s_data, power_off);
+		/* registers are back to their reset values */
+		regmap_util_table_cache_invalidate(&s_data->table_cache);
 	}
 
 	return err;
@@ -1048,6 +1080,7 @@ int camera_common_initialize(struct camera_common_data *s_data,
 
 	dev_dbg(s_data->dev, "%s_probe: name %s\n", dev_name, debugfs_name);
 
+	regmap_util_table_cache_init(&s_data->table_cache);
 	camera_common_create_debugfs(s_data, debugfs_name);
 
 	return 0;
@@ -1057,6 +1090,7 @@ EXPORT_SYMBOL_GPL(camera_common_initialize);
 void camera_common_cleanup(struct camera_common_data *s_data)
 {
 	camera_common_remove_debugfs(s_data);
+	regmap_util_table_cache_invalidate(&s_data->table_cache);
 }
 EXPORT_SYMBOL_GPL(camera_common_cleanup);
 
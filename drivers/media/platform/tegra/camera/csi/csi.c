@@ -361,6 +361,7 @@ static void deskew_setup(struct tegra_csi_channel *chan,
 		deskew_ctx->deskew_lanes = 0;
 		for (i = 0; i < csi_lanes; ++i)
 			deskew_ctx->deskew_lanes |= csi_lane_start << i;
+		deskew_ctx->data_rate = pix_clk_hz;
 		nvcsi_deskew_setup(deskew_ctx);
 	}
 
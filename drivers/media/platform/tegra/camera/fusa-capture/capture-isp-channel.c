@@ -196,6 +196,48 @@ struct isp_channel_drv {
 #define ISP_CAPTURE_BUFFER_REQUEST \
 	_IOW('I', 11, struct isp_buffer_req)
 
+/**
+ * @brief Enqueue several process requests to RCE in one call; this is
+ * equivalent to calling @ref ISP_CAPTURE_REQUEST for each request in order,
+ * but the surface buffers of all requests are pinned together and the requests
+ * are written to the capture IVC channel back-to-back.
+ *
+ * On return, @a num_submitted holds the number of requests, from the start of
+ * the array, that were sent to RCE.
+ *
+ * @param[in,out]	ptr	Pointer to a struct @ref isp_capture_req_batch
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+#define ISP_CAPTURE_REQUEST_BATCH \
+	_IOWR('I', 12, struct isp_capture_req_batch)
+
+/**
+ * @brief Pin the pushbuffer of a program descriptor once and keep it pinned
+ * until @ref ISP_CAPTURE_PROGRAM_RELEASE, so that the program can be
+ * referenced by @ref ISP_CAPTURE_PROGRAM_REQUEST and
+ * @ref ISP_CAPTURE_REQUEST_EX every frame without being pinned again.
+ *
+ * A channel reset or release drops all retained programs.
+ *
+ * @param[in]	ptr	Pointer to a struct @ref isp_program_req
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+#define ISP_CAPTURE_PROGRAM_RETAIN \
+	_IOW('I', 13, struct isp_program_req)
+
+/**
+ * @brief Release a program retained by @ref ISP_CAPTURE_PROGRAM_RETAIN; it is
+ * unpinned when the last request using it has completed.
+ *
+ * @param[in]	ptr	Pointer to the program descriptor index (__u32)
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+#define ISP_CAPTURE_PROGRAM_RELEASE \
+	_IOW('I', 14, __u32)
+
 /** @} */
 
 /**
@@ -446,6 +488,46 @@ static long isp_channel_ioctl(
 		break;
 	}
 
+	case _IOC_NR(ISP_CAPTURE_REQUEST_BATCH): {
+		struct isp_capture_req_batch batch;
+		struct isp_capture_req *reqs;
+
+		if (copy_from_user(&batch, ptr, sizeof(batch)))
+			break;
+
+		if (batch.num_reqs == 0U ||
+				batch.num_reqs > ISP_CAPTURE_MAX_BATCH) {
+			err = -EINVAL;
+			break;
+		}
+
+		reqs = kcalloc(batch.num_reqs, sizeof(*reqs), GFP_KERNEL);
+		if (reqs == NULL) {
+			err = -ENOMEM;
+			break;
+		}
+
+		if (copy_from_user(reqs, u64_to_user_ptr(batch.reqs),
+				batch.num_reqs * sizeof(*reqs))) {
+			kfree(reqs);
+			break;
+		}
+
+		err = isp_capture_request_batch(chan, reqs, batch.num_reqs);
+		kfree(reqs);
+
+		batch.num_submitted = err > 0 ? err : 0;
+		err = err < 0 ? err :
+			(batch.num_submitted < batch.num_reqs ? -EIO : 0);
+		if (err)
+			dev_err(chan->isp_dev,
+				"isp process capture batch submit failed\n");
+
+		if (copy_to_user(ptr, &batch, sizeof(batch)))
+			err = -EFAULT;
+		break;
+	}
+
 	case _IOC_NR(ISP_CAPTURE_STATUS): {
 		uint32_t timeout;
 
@@ -479,6 +561,30 @@ static long isp_channel_ioctl(
 		break;
 	}
 
+	case _IOC_NR(ISP_CAPTURE_PROGRAM_RETAIN): {
+		struct isp_program_req program_req;
+
+		if (copy_from_user(&program_req, ptr, sizeof(program_req)))
+			break;
+		err = isp_capture_program_retain(chan, &program_req);
+		if (err)
+			dev_err(chan->isp_dev,
+				"isp program retain failed\n");
+		break;
+	}
+
+	case _IOC_NR(ISP_CAPTURE_PROGRAM_RELEASE): {
+		uint32_t buffer_index;
+
+		if (copy_from_user(&buffer_index, ptr, sizeof(buffer_index)))
+			break;
+		err = isp_capture_program_release(chan, buffer_index);
+		if (err)
+			dev_err(chan->isp_dev,
+				"isp program release failed\n");
+		break;
+	}
+
 	case _IOC_NR(ISP_CAPTURE_REQUEST_EX): {
 		struct isp_capture_req_ex req;
 
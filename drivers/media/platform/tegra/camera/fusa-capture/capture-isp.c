@@ -14,6 +14,7 @@
 #include <linux/nvhost.h>
 #include <linux/of_platform.h>
 #include <linux/printk.h>
+#include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/tegra-capture-ivc.h>
 #include <asm/arch_timer.h>
@@ -28,6 +29,7 @@
 #include <media/fusa-capture/capture-common.h>
 #include <media/fusa-capture/capture-isp.h>
 #include <linux/arm64-barrier.h>
+#include <trace/events/tegra_frame.h>
 
 /**
  * @brief Invalid ISP channel ID; the channel is not initialized.
@@ -56,6 +58,20 @@ struct isp_desc_rec {
 		/**< List of process request buffer unpins */
 };
 
+/**
+ * @brief Retained ISP program slot, protected by the program descriptor
+ * queue's @em unpins_list_lock.
+ *
+ * A retained slot keeps its pushbuffer pinned in @em unpins_list across
+ * program requests; requests for the slot then only take a reference.
+ */
+struct isp_program_slot {
+	uint64_t pb1_mem;
+		/**< Pushbuffer 1 handle and offset pinned for the slot */
+	uint32_t users; /**< No. of submissions of the slot not yet retired */
+	bool retained; /**< Whether the slot is held by the client */
+};
+
 /**
  * @brief ISP channel capture context.
  */
@@ -70,6 +86,8 @@ struct isp_capture {
 		/**< Capture process descriptor queue context */
 	struct isp_desc_rec program_desc_ctx;
 		/**< Program process descriptor queue context */
+	struct isp_program_slot *program_slots;
+		/**< Retained program state, one per program descriptor */
 
 	struct capture_common_status_notifier progress_status_notifier;
 		/**< Process progress status notifier context */
@@ -514,35 +532,155 @@ static void isp_capture_request_unpin(
 }
 
 /**
- * @brief Unpin and free the list of pinned capture_mapping's associated with an
- * ISP program request.
+ * @brief Unpin the program descriptor's mappings, with the program
+ * descriptor queue's @em unpins_list_lock held.
  *
- * @param[in]	chan		ISP channel context
+ * @param[in]	capture		ISP channel capture context
  * @param[in]	buffer_index	Program descriptor queue index
  */
-static void isp_capture_program_request_unpin(
-	struct tegra_isp_channel *chan,
+static void isp_capture_program_unpin_locked(
+	struct isp_capture *capture,
 	uint32_t buffer_index)
 {
-	struct isp_capture *capture = chan->capture_data;
 	struct capture_common_unpins *unpins;
 	int i = 0;
 
-	mutex_lock(&capture->program_desc_ctx.unpins_list_lock);
 	unpins = &capture->program_desc_ctx.unpins_list[buffer_index];
 	if (unpins->num_unpins != 0U) {
 		for (i = 0; i < unpins->num_unpins; i++)
 			put_mapping(capture->buffer_ctx, unpins->data[i]);
 		(void)memset(unpins, 0U, sizeof(*unpins));
 	}
+}
+
+/**
+ * @brief Unpin and free the list of pinned capture_mapping's associated with an
+ * ISP program request.
+ *
+ * For a retained program slot this only drops the reference taken by the
+ * request; the mappings are kept until the slot is released and its last
+ * request has retired.
+ *
+ * @param[in]	chan		ISP channel context
+ * @param[in]	buffer_index	Program descriptor queue index
+ */
+static void isp_capture_program_request_unpin(
+	struct tegra_isp_channel *chan,
+	uint32_t buffer_index)
+{
+	struct isp_capture *capture = chan->capture_data;
+	struct isp_program_slot *slot;
+
+	mutex_lock(&capture->program_desc_ctx.unpins_list_lock);
+	slot = &capture->program_slots[buffer_index];
+	if (slot->users != 0U)
+		slot->users--;
+	if (!slot->retained && slot->users == 0U)
+		isp_capture_program_unpin_locked(capture, buffer_index);
 	mutex_unlock(&capture->program_desc_ctx.unpins_list_lock);
 }
 
+/**
+ * @brief Forget all retained program slots, so that the following unpin
+ * of every program descriptor releases their mappings too.
+ *
+ * @param[in]	capture		ISP channel capture context
+ */
+static void isp_capture_program_slots_drop(
+	struct isp_capture *capture)
+{
+	mutex_lock(&capture->program_desc_ctx.unpins_list_lock);
+	(void)memset(capture->program_slots, 0U,
+		capture->program_desc_ctx.queue_depth *
+			sizeof(*capture->program_slots));
+	mutex_unlock(&capture->program_desc_ctx.unpins_list_lock);
+}
+
+/**
+ * @brief Pin the pushbuffer of a program descriptor and fill in its memory
+ * info, with the program descriptor queue's @em unpins_list_lock held.
+ *
+ * @param[in]	chan		ISP channel context
+ * @param[in]	buffer_index	Program descriptor queue index
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+static int isp_capture_program_pin_locked(
+	struct tegra_isp_channel *chan,
+	uint32_t buffer_index)
+{
+	struct isp_capture *capture = chan->capture_data;
+	struct memoryinfo_surface *meminfo;
+	struct isp_program_descriptor *desc;
+	uint32_t request_offset;
+
+	meminfo = &((struct memoryinfo_surface *)
+			capture->program_desc_ctx.requests_memoryinfo)
+				[buffer_index];
+
+	desc = (struct isp_program_descriptor *)
+		(capture->program_desc_ctx.requests.va + buffer_index *
+				capture->program_desc_ctx.request_size);
+
+	/* Pushbuffer 1 is located after program desc in same ringbuffer */
+	request_offset = buffer_index *
+			capture->program_desc_ctx.request_size;
+
+	return capture_common_pin_and_get_iova(capture->buffer_ctx,
+		(uint32_t)(desc->isp_pb1_mem >> 32U), /* mem handle */
+		((uint32_t)desc->isp_pb1_mem) + request_offset, /* offset */
+		&meminfo->base_address,
+		&meminfo->size,
+		&capture->program_desc_ctx.unpins_list[buffer_index]);
+}
+
+/**
+ * @brief Validate a program descriptor index for the channel.
+ *
+ * @param[in]	chan		ISP channel context
+ * @param[in]	buffer_index	Program descriptor queue index
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+static int isp_capture_program_check(
+	struct tegra_isp_channel *chan,
+	uint32_t buffer_index)
+{
+	struct isp_capture *capture = chan->capture_data;
+
+	if (capture == NULL) {
+		dev_err(chan->isp_dev,
+			"%s: isp capture uninitialized\n", __func__);
+		return -ENODEV;
+	}
+
+	if (capture->channel_id == CAPTURE_CHANNEL_ISP_INVALID_ID) {
+		dev_err(chan->isp_dev,
+			"%s: setup channel first\n", __func__);
+		return -ENODEV;
+	}
+
+	if (capture->program_desc_ctx.unpins_list == NULL) {
+		dev_err(chan->isp_dev, "Channel setup incomplete\n");
+		return -EINVAL;
+	}
+
+	if (buffer_index >= capture->program_desc_ctx.queue_depth) {
+		dev_err(chan->isp_dev, "buffer index is out of bound\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 /**
  * @brief Prepare and submit a pin and relocation request for a program
  * descriptor, the resultant mappings are added to the channel program
  * descriptor queue's @em unpins_list.
  *
+ * A retained program slot is already pinned, the request only takes a
+ * reference on it.
+ *
  * @param[in]	chan	ISP channel context
  * @param[in]	req	ISP program request
  *
@@ -553,10 +691,9 @@ static int isp_capture_program_prepare(
 	struct isp_program_req *req)
 {
 	struct isp_capture *capture = chan->capture_data;
-	int err = 0;
-	struct memoryinfo_surface *meminfo;
 	struct isp_program_descriptor *desc;
-	uint32_t request_offset;
+	struct isp_program_slot *slot;
+	int err = 0;
 
 	if (capture == NULL) {
 		dev_err(chan->isp_dev,
@@ -599,6 +736,24 @@ static int isp_capture_program_prepare(
 
 	mutex_lock(&capture->program_desc_ctx.unpins_list_lock);
 
+	slot = &capture->program_slots[req->buffer_index];
+	if (slot->retained) {
+		desc = (struct isp_program_descriptor *)
+			(capture->program_desc_ctx.requests.va +
+				req->buffer_index *
+				capture->program_desc_ctx.request_size);
+		if (desc->isp_pb1_mem != slot->pb1_mem) {
+			dev_err(chan->isp_dev,
+				"%s: program %u is retained with another pushbuffer\n",
+				__func__, req->buffer_index);
+			err = -EINVAL;
+		} else {
+			slot->users++;
+		}
+		mutex_unlock(&capture->program_desc_ctx.unpins_list_lock);
+		return err;
+	}
+
 	if (capture->program_desc_ctx.unpins_list[req->buffer_index].num_unpins != 0) {
 		dev_err(chan->isp_dev,
 			"%s: program request is still in use by rtcpu\n",
@@ -607,24 +762,7 @@ static int isp_capture_program_prepare(
 		return -EBUSY;
 	}
 
-	meminfo = &((struct memoryinfo_surface *)
-			capture->program_desc_ctx.requests_memoryinfo)
-				[req->buffer_index];
-
-	desc = (struct isp_program_descriptor *)
-		(capture->program_desc_ctx.requests.va + req->buffer_index *
-				capture->program_desc_ctx.request_size);
-
-	/* Pushbuffer 1 is located after program desc in same ringbuffer */
-	request_offset = req->buffer_index *
-			capture->program_desc_ctx.request_size;
-
-	err = capture_common_pin_and_get_iova(chan->capture_data->buffer_ctx,
-		(uint32_t)(desc->isp_pb1_mem >> 32U), /* mem handle */
-		((uint32_t)desc->isp_pb1_mem) + request_offset, /* offset */
-		&meminfo->base_address,
-		&meminfo->size,
-		&capture->program_desc_ctx.unpins_list[req->buffer_index]);
+	err = isp_capture_program_pin_locked(chan, req->buffer_index);
 
 	mutex_unlock(&capture->program_desc_ctx.unpins_list_lock);
 
@@ -765,6 +903,10 @@ static void isp_capture_ivc_status_callback(
 		buffer_index = status_msg->capture_isp_status_ind.buffer_index;
 		isp_capture_ivc_capture_cleanup(capture, buffer_index);
 		isp_capture_ivc_capture_signal(capture, buffer_index);
+		if (trace_tegra_frame_done_enabled())
+			trace_tegra_frame_done(TEGRA_FRAME_ENGINE_ISP,
+				capture->channel_id, 0, buffer_index, 0, 0,
+				tegra_frame_ts_ns());
 		dev_dbg(chan->isp_dev, "%s: status chan_id %u msg_id %u\n",
 			__func__, status_msg->header.channel_id,
 			status_msg->header.msg_id);
@@ -788,6 +930,10 @@ static void isp_capture_ivc_status_callback(
 			.program_buffer_index);
 		isp_capture_ivc_capture_cleanup(capture, buffer_index);
 		isp_capture_ivc_capture_signal(capture, buffer_index);
+		if (trace_tegra_frame_done_enabled())
+			trace_tegra_frame_done(TEGRA_FRAME_ENGINE_ISP,
+				capture->channel_id, 0, buffer_index, 0, 0,
+				tegra_frame_ts_ns());
 
 		dev_dbg(chan->isp_dev,
 			"%s: isp extended status chan_id %u msg_id %u\n",
@@ -1100,6 +1246,16 @@ int isp_capture_setup(
 		goto prog_unpins_list_fail;
 	}
 
+	capture->program_slots = vzalloc(
+			capture->program_desc_ctx.queue_depth *
+				sizeof(*capture->program_slots));
+	if (unlikely(capture->program_slots == NULL)) {
+		dev_err(chan->isp_dev,
+			"failed to allocate isp program slots\n");
+		err = -ENOMEM;
+		goto prog_slots_fail;
+	}
+
 	/* Allocate memory info ring buffer for program descriptors */
 	capture->program_desc_ctx.requests_memoryinfo =
 		dma_alloc_coherent(capture->rtcpu_dev,
@@ -1215,6 +1371,9 @@ syncpt_fail:
 		capture->program_desc_ctx.requests_memoryinfo,
 		capture->program_desc_ctx.requests_memoryinfo_iova);
 program_meminfo_alloc_fail:
+	vfree(capture->program_slots);
+	capture->program_slots = NULL;
+prog_slots_fail:
 	vfree(capture->program_desc_ctx.unpins_list);
 prog_unpins_list_fail:
 	capture_common_unpin_memory(&capture->program_desc_ctx.requests);
@@ -1291,6 +1450,7 @@ int isp_capture_release(
 		goto error;
 	}
 
+	isp_capture_program_slots_drop(capture);
 	for (i = 0; i < capture->program_desc_ctx.queue_depth; i++) {
 		complete(&capture->capture_program_resp);
 		isp_capture_program_request_unpin(chan, i);
@@ -1309,6 +1469,8 @@ int isp_capture_release(
 
 	capture_common_unpin_memory(&capture->capture_desc_ctx.requests);
 
+	vfree(capture->program_slots);
+	capture->program_slots = NULL;
 	vfree(capture->program_desc_ctx.unpins_list);
 	capture->program_desc_ctx.unpins_list = NULL;
 	vfree(capture->capture_desc_ctx.unpins_list);
@@ -1412,6 +1574,7 @@ int isp_capture_reset(
 		goto error;
 	}
 
+	isp_capture_program_slots_drop(capture);
 	for (i = 0; i < capture->program_desc_ctx.queue_depth; i++) {
 		isp_capture_program_request_unpin(chan, i);
 		complete(&capture->capture_program_resp);
@@ -1601,6 +1764,47 @@ fail:
 	return err;
 }
 
+/**
+ * @brief Log the input and output surfaces of a submitted ISP capture
+ * request to the tegra_frame trace.
+ *
+ * @param[in]	chan		ISP channel context
+ * @param[in]	buffer_index	Process descriptor queue index
+ */
+static void isp_capture_trace_submit(
+	struct tegra_isp_channel *chan,
+	uint32_t buffer_index)
+{
+	struct isp_capture *capture = chan->capture_data;
+	struct isp_desc_rec *capture_desc_ctx = &capture->capture_desc_ctx;
+	struct isp_capture_descriptor *desc = (struct isp_capture_descriptor *)
+		(capture_desc_ctx->requests.va +
+			buffer_index * capture_desc_ctx->request_size);
+	u64 ts = tegra_frame_ts_ns();
+	u64 buf_id;
+	int i;
+
+	for (i = 0; i < ISP_MAX_INPUT_SURFACES; i++) {
+		buf_id = tegra_frame_fd_id(desc->input_mr_surfaces[i].offset_hi);
+		if (buf_id == 0)
+			continue;
+
+		trace_tegra_frame_submit(TEGRA_FRAME_ENGINE_ISP,
+			capture->channel_id, buf_id, buffer_index,
+			capture->progress_sp.id, capture->progress_sp.threshold, ts);
+	}
+
+	for (i = 0; i < ISP_MAX_OUTPUTS; i++) {
+		buf_id = tegra_frame_fd_id(desc->outputs_mw[i].surfaces[0].offset_hi);
+		if (buf_id == 0)
+			continue;
+
+		trace_tegra_frame_submit(TEGRA_FRAME_ENGINE_ISP,
+			capture->channel_id, buf_id, buffer_index,
+			capture->progress_sp.id, capture->progress_sp.threshold, ts);
+	}
+}
+
 int isp_capture_request(
 	struct tegra_isp_channel *chan,
 	struct isp_capture_req *req)
@@ -1697,6 +1901,10 @@ int isp_capture_request(
 			capture_msg.header.channel_id,
 			__arch_counter_get_cntvct());
 
+	/* Logged ahead of the submit, so that it precedes the status */
+	if (trace_tegra_frame_submit_enabled())
+		isp_capture_trace_submit(chan, req->buffer_index);
+
 	dev_dbg(chan->isp_dev, "%s: sending chan_id %u msg_id %u buf:%u\n",
 			__func__, capture_msg.header.channel_id,
 			capture_msg.header.msg_id, req->buffer_index);
@@ -1716,6 +1924,151 @@ fail:
 	return err;
 }
 
+int isp_capture_request_batch(
+	struct tegra_isp_channel *chan,
+	struct isp_capture_req *reqs,
+	unsigned int count)
+{
+	struct isp_capture *capture = chan->capture_data;
+	struct capture_common_unpins *request_unpins;
+	struct CAPTURE_MSG *msgs;
+	unsigned int i, pinned = 0, submitted = 0;
+	uint32_t request_offset;
+	int err = 0;
+
+	if (capture == NULL) {
+		dev_err(chan->isp_dev,
+			"%s: isp capture uninitialized\n", __func__);
+		return -ENODEV;
+	}
+
+	if (capture->channel_id == CAPTURE_CHANNEL_ISP_INVALID_ID) {
+		dev_err(chan->isp_dev,
+			"%s: setup channel first\n", __func__);
+		return -ENODEV;
+	}
+
+	if (reqs == NULL || count == 0U || count > ISP_CAPTURE_MAX_BATCH) {
+		dev_err(chan->isp_dev,
+			"%s: Invalid req batch\n", __func__);
+		return -EINVAL;
+	}
+
+	if (capture->capture_desc_ctx.unpins_list == NULL) {
+		dev_err(chan->isp_dev, "Channel setup incomplete\n");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].buffer_index >=
+				capture->capture_desc_ctx.queue_depth) {
+			dev_err(chan->isp_dev, "buffer index is out of bound\n");
+			return -EINVAL;
+		}
+	}
+
+	spec_bar();
+
+	msgs = kcalloc(count, sizeof(*msgs), GFP_KERNEL);
+	if (msgs == NULL)
+		return -ENOMEM;
+
+	mutex_lock(&capture->reset_lock);
+	if (capture->reset_capture_flag) {
+		/* consume any pending completions when coming out of reset */
+		while (try_wait_for_completion(&capture->capture_resp))
+			; /* do nothing */
+	}
+	capture->reset_capture_flag = false;
+	mutex_unlock(&capture->reset_lock);
+
+	for (i = 0; i < count; i++) {
+		msgs[i].header.msg_id = CAPTURE_ISP_REQUEST_REQ;
+		msgs[i].header.channel_id = capture->channel_id;
+		msgs[i].capture_isp_request_req.buffer_index =
+				reqs[i].buffer_index;
+
+		request_offset = reqs[i].buffer_index *
+				capture->capture_desc_ctx.request_size;
+
+		err = isp_capture_setup_inputfences(chan, &reqs[i],
+				request_offset);
+		if (err < 0) {
+			dev_err(chan->isp_dev, "failed to setup inputfences\n");
+			goto free;
+		}
+
+		err = isp_capture_setup_prefences(chan, &reqs[i],
+				request_offset);
+		if (err < 0) {
+			dev_err(chan->isp_dev, "failed to setup prefences\n");
+			goto free;
+		}
+	}
+
+	mutex_lock(&capture->capture_desc_ctx.unpins_list_lock);
+
+	for (i = 0; i < count; i++) {
+		request_unpins =
+			&capture->capture_desc_ctx.unpins_list[reqs[i].buffer_index];
+
+		if (request_unpins->num_unpins != 0U) {
+			dev_err(chan->isp_dev,
+				"%s: descriptor is still in use by rtcpu\n",
+				__func__);
+			err = -EBUSY;
+			break;
+		}
+
+		/* partially pinned requests are unpinned below as well */
+		pinned = i + 1;
+
+		err = pin_isp_capture_request_buffers_locked(chan, &reqs[i],
+				request_unpins);
+		if (err < 0) {
+			dev_err(chan->isp_dev,
+				"%s failed to pin request buffers\n", __func__);
+			break;
+		}
+	}
+
+	mutex_unlock(&capture->capture_desc_ctx.unpins_list_lock);
+
+	if (err < 0)
+		goto unpin;
+
+	nv_camera_log_isp_submit(
+			chan->ndev,
+			capture->progress_sp.id,
+			capture->progress_sp.threshold,
+			capture->channel_id,
+			__arch_counter_get_cntvct());
+
+	if (trace_tegra_frame_submit_enabled()) {
+		for (i = 0; i < count; i++)
+			isp_capture_trace_submit(chan, reqs[i].buffer_index);
+	}
+
+	dev_dbg(chan->isp_dev, "%s: sending chan_id %u, %u requests\n",
+			__func__, capture->channel_id, count);
+
+	err = tegra_capture_ivc_capture_submit_batch(msgs, sizeof(*msgs),
+			count);
+	if (err < 0) {
+		dev_err(chan->isp_dev, "IVC capture submit failed\n");
+		goto unpin;
+	}
+
+	submitted = err;
+
+unpin:
+	for (i = submitted; i < pinned; i++)
+		isp_capture_request_unpin(chan, reqs[i].buffer_index);
+free:
+	kfree(msgs);
+	return submitted > 0U ? (int)submitted : err;
+}
+
 int isp_capture_status(
 	struct tegra_isp_channel *chan,
 	int32_t timeout_ms)
@@ -1851,6 +2204,93 @@ int isp_capture_program_status(
 	return 0;
 }
 
+int isp_capture_program_retain(
+	struct tegra_isp_channel *chan,
+	struct isp_program_req *req)
+{
+	struct isp_capture *capture = chan->capture_data;
+	struct isp_program_descriptor *desc;
+	struct isp_program_slot *slot;
+	int err;
+
+	if (req == NULL) {
+		dev_err(chan->isp_dev,
+			"%s: Invalid program req\n", __func__);
+		return -EINVAL;
+	}
+
+	err = isp_capture_program_check(chan, req->buffer_index);
+	if (err < 0)
+		return err;
+
+	spec_bar();
+
+	mutex_lock(&capture->program_desc_ctx.unpins_list_lock);
+
+	slot = &capture->program_slots[req->buffer_index];
+	if (slot->retained ||
+		capture->program_desc_ctx.unpins_list[req->buffer_index].num_unpins != 0) {
+		dev_err(chan->isp_dev,
+			"%s: program %u is still in use\n",
+			__func__, req->buffer_index);
+		err = -EBUSY;
+		goto unlock;
+	}
+
+	err = isp_capture_program_pin_locked(chan, req->buffer_index);
+	if (err < 0) {
+		isp_capture_program_unpin_locked(capture, req->buffer_index);
+		goto unlock;
+	}
+
+	desc = (struct isp_program_descriptor *)
+		(capture->program_desc_ctx.requests.va + req->buffer_index *
+				capture->program_desc_ctx.request_size);
+
+	slot->pb1_mem = desc->isp_pb1_mem;
+	slot->users = 0U;
+	slot->retained = true;
+
+unlock:
+	mutex_unlock(&capture->program_desc_ctx.unpins_list_lock);
+	return err;
+}
+
+int isp_capture_program_release(
+	struct tegra_isp_channel *chan,
+	uint32_t buffer_index)
+{
+	struct isp_capture *capture = chan->capture_data;
+	struct isp_program_slot *slot;
+	int err;
+
+	err = isp_capture_program_check(chan, buffer_index);
+	if (err < 0)
+		return err;
+
+	spec_bar();
+
+	mutex_lock(&capture->program_desc_ctx.unpins_list_lock);
+
+	slot = &capture->program_slots[buffer_index];
+	if (!slot->retained) {
+		dev_err(chan->isp_dev,
+			"%s: program %u is not retained\n",
+			__func__, buffer_index);
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	/* in-flight requests keep the mappings until they retire */
+	slot->retained = false;
+	if (slot->users == 0U)
+		isp_capture_program_unpin_locked(capture, buffer_index);
+
+unlock:
+	mutex_unlock(&capture->program_desc_ctx.unpins_list_lock);
+	return err;
+}
+
 int isp_capture_request_ex(
 	struct tegra_isp_channel *chan,
 	struct isp_capture_req_ex *req)
@@ -17,6 +17,7 @@
 #include <linux/of_platform.h>
 #include <linux/nvhost.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/uaccess.h>
 #include <linux/dma-buf.h>
@@ -153,6 +154,22 @@
 #define VI_CAPTURE_BUFFER_REQUEST \
 	_IOW('I', 10, struct vi_buffer_req)
 
+/**
+ * @brief Enqueue several capture requests to RCE in one call. The surface
+ * buffers of all requests are pinned and patched together, and the requests
+ * are written to the capture IVC channel back-to-back.
+ *
+ * On return, @a num_submitted holds the number of requests, from the start of
+ * the array, that were sent to RCE; the buffers of any remaining requests have
+ * been unpinned.
+ *
+ * @param[in,out]	ptr	Pointer to a struct @ref vi_capture_req_batch
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+#define VI_CAPTURE_REQUEST_BATCH \
+	_IOWR('I', 11, struct vi_capture_req_batch)
+
 /** @} */
 
 void vi_capture_request_unpin(
@@ -353,6 +370,104 @@ fail:
 	return err;
 }
 
+/**
+ * Pin the buffers of all requests in a batch under a single hold of the
+ * unpins list lock, then submit them to RCE together.
+ */
+static int vi_channel_request_batch(struct tegra_vi_channel *chan,
+		struct vi_capture_req_batch *batch)
+{
+	struct vi_capture *capture = chan->capture_data;
+	struct capture_common_unpins *request_unpins;
+	unsigned int i, pinned = 0, submitted = 0;
+	struct vi_capture_req *reqs;
+	int err = 0;
+
+	batch->num_submitted = 0;
+
+	if (batch->num_reqs == 0 || batch->num_reqs > VI_CAPTURE_MAX_BATCH) {
+		dev_err(chan->dev, "invalid number of batched requests\n");
+		return -EINVAL;
+	}
+
+	if (capture->unpins_list == NULL) {
+		dev_err(chan->dev, "Channel setup incomplete\n");
+		return -EINVAL;
+	}
+
+	reqs = kcalloc(batch->num_reqs, sizeof(*reqs), GFP_KERNEL);
+	if (reqs == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(reqs, u64_to_user_ptr(batch->reqs),
+			batch->num_reqs * sizeof(*reqs))) {
+		err = -EFAULT;
+		goto free;
+	}
+
+	for (i = 0; i < batch->num_reqs; i++) {
+		if (reqs[i].num_relocs == 0) {
+			dev_err(chan->dev, "request must have non-zero relocs\n");
+			err = -EINVAL;
+			goto free;
+		}
+
+		if (reqs[i].buffer_index >= capture->queue_depth) {
+			dev_err(chan->dev, "buffer index is out of bound\n");
+			err = -EINVAL;
+			goto free;
+		}
+	}
+
+	/* Don't let to speculate with invalid buffer_index value */
+	spec_bar();
+
+	mutex_lock(&capture->unpins_list_lock);
+
+	for (i = 0; i < batch->num_reqs; i++) {
+		request_unpins = &capture->unpins_list[reqs[i].buffer_index];
+
+		if (request_unpins->num_unpins != 0U) {
+			dev_err(chan->dev, "Descriptor is still in use by rtcpu\n");
+			err = -EBUSY;
+			break;
+		}
+
+		/* partially pinned requests are unpinned below as well */
+		pinned = i + 1;
+
+		err = pin_vi_capture_request_buffers_locked(chan, &reqs[i],
+				request_unpins);
+		if (err < 0) {
+			dev_err(chan->dev, "pin request failed\n");
+			break;
+		}
+	}
+
+	mutex_unlock(&capture->unpins_list_lock);
+
+	if (err < 0)
+		goto unpin;
+
+	err = vi_capture_request_batch(chan, reqs, batch->num_reqs);
+	if (err < 0) {
+		dev_err(chan->dev, "vi capture request submit failed\n");
+		goto unpin;
+	}
+
+	submitted = err;
+	err = submitted < batch->num_reqs ? -EIO : 0;
+
+unpin:
+	for (i = submitted; i < pinned; i++)
+		vi_capture_request_unpin(chan, reqs[i].buffer_index);
+
+	batch->num_submitted = submitted;
+free:
+	kfree(reqs);
+	return err;
+}
+
 /**
  * @brief Process an IOCTL call on a VI channel character device.
  *
@@ -568,6 +683,19 @@ static long vi_channel_ioctl(
 		break;
 	}
 
+	case _IOC_NR(VI_CAPTURE_REQUEST_BATCH): {
+		struct vi_capture_req_batch batch;
+
+		if (copy_from_user(&batch, ptr, sizeof(batch)))
+			break;
+
+		err = vi_channel_request_batch(chan, &batch);
+
+		if (copy_to_user(ptr, &batch, sizeof(batch)))
+			err = -EFAULT;
+		break;
+	}
+
 	case _IOC_NR(VI_CAPTURE_STATUS): {
 		uint32_t timeout_ms;
 
@@ -24,6 +24,7 @@
 #include <linux/nvhost.h>
 #include <linux/of_platform.h>
 #include <linux/printk.h>
+#include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/tegra-capture-ivc.h>
 #include <linux/tegra-camera-rtcpu.h>
@@ -287,6 +288,7 @@ static void vi_capture_ivc_status_callback(
 	struct CAPTURE_MSG *status_msg = (struct CAPTURE_MSG *)ivc_resp;
 	struct vi_capture *capture = (struct vi_capture *)pcontext;
 	struct tegra_vi_channel *chan = capture->vi_channel;
+	void (*notify)(void *data);
 	uint32_t buffer_index;
 
 	if (unlikely(capture == NULL)) {
@@ -322,6 +324,14 @@ static void vi_capture_ivc_status_callback(
 			 */
 			complete(&capture->capture_resp);
 		}
+
+		notify = READ_ONCE(capture->status_notify);
+		if (notify) {
+			/* pairs with smp_wmb() in vi_capture_set_status_notify() */
+			smp_rmb();
+			notify(READ_ONCE(capture->status_notify_data));
+		}
+
 		dev_dbg(chan->dev, "%s: status chan_id %u msg_id %u\n",
 				__func__, status_msg->header.channel_id,
 				status_msg->header.msg_id);
@@ -1422,6 +1432,75 @@ int vi_capture_request(
 }
 EXPORT_SYMBOL_GPL(vi_capture_request);
 
+int vi_capture_request_batch(
+	struct tegra_vi_channel *chan,
+	const struct vi_capture_req *reqs,
+	unsigned int count)
+{
+	struct vi_capture *capture = chan->capture_data;
+	struct CAPTURE_MSG *msgs;
+	unsigned int i;
+	int err;
+
+	if (capture == NULL) {
+		dev_err(chan->dev,
+			"%s: vi capture uninitialized\n", __func__);
+		return -ENODEV;
+	}
+
+	if (capture->channel_id == CAPTURE_CHANNEL_INVALID_ID) {
+		dev_err(chan->dev,
+			"%s: setup channel first\n", __func__);
+		return -ENODEV;
+	}
+
+	if (reqs == NULL || count == 0 || count > VI_CAPTURE_MAX_BATCH) {
+		dev_err(chan->dev,
+			"%s: Invalid reqs\n", __func__);
+		return -EINVAL;
+	}
+
+	msgs = kcalloc(count, sizeof(*msgs), GFP_KERNEL);
+	if (msgs == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		nv_camera_log(chan->ndev,
+			__arch_counter_get_cntvct(),
+			NVHOST_CAMERA_VI_CAPTURE_REQUEST);
+
+		msgs[i].header.msg_id = CAPTURE_REQUEST_REQ;
+		msgs[i].header.channel_id = capture->channel_id;
+		msgs[i].capture_request_req.buffer_index = reqs[i].buffer_index;
+	}
+
+	mutex_lock(&capture->reset_lock);
+
+	nv_camera_log_vi_submit(
+			chan->ndev,
+			capture->progress_sp.id,
+			capture->progress_sp.threshold,
+			capture->channel_id,
+			__arch_counter_get_cntvct());
+
+	dev_dbg(chan->dev, "%s: sending chan_id %u msg_id %u count:%u\n",
+			__func__, capture->channel_id, CAPTURE_REQUEST_REQ,
+			count);
+
+	err = tegra_capture_ivc_capture_submit_batch(msgs, sizeof(*msgs),
+			count);
+
+	mutex_unlock(&capture->reset_lock);
+
+	if (err < 0)
+		dev_err(chan->dev, "IVC capture batch submit failed\n");
+
+	kfree(msgs);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(vi_capture_request_batch);
+
 int vi_capture_status(
 	struct tegra_vi_channel *chan,
 	int32_t timeout_ms)
@@ -1477,6 +1556,45 @@ int vi_capture_status(
 }
 EXPORT_SYMBOL_GPL(vi_capture_status);
 
+bool vi_capture_status_ready(
+	struct tegra_vi_channel *chan)
+{
+	struct vi_capture *capture = chan->capture_data;
+
+	if (capture == NULL)
+		return false;
+
+	return completion_done(&capture->capture_resp);
+}
+EXPORT_SYMBOL_GPL(vi_capture_status_ready);
+
+int vi_capture_set_status_notify(
+	struct tegra_vi_channel *chan,
+	void (*notify)(void *data),
+	void *data)
+{
+	struct vi_capture *capture = chan->capture_data;
+
+	if (capture == NULL) {
+		dev_err(chan->dev,
+			"%s: vi capture uninitialized\n", __func__);
+		return -ENODEV;
+	}
+
+	/*
+	 * The data pointer is published first so the callback never sees a
+	 * new function with stale data.
+	 */
+	WRITE_ONCE(capture->status_notify, NULL);
+	smp_wmb();
+	WRITE_ONCE(capture->status_notify_data, data);
+	smp_wmb();
+	WRITE_ONCE(capture->status_notify, notify);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(vi_capture_set_status_notify);
+
 int vi_capture_set_progress_status_notifier(
 	struct tegra_vi_channel *chan,
 	struct vi_capture_progress_status_req *req)
@@ -7,6 +7,7 @@
 
 #include <linux/regmap.h>
 #include <linux/module.h>
+#include <linux/xarray.h>
 #include <media/camera_common.h>
 
 int
@@ -165,5 +166,146 @@ regmap_util_write_table_16_as_8(struct regmap *regmap,
 }
 
 EXPORT_SYMBOL_GPL(regmap_util_write_table_16_as_8);
+
+/*
+ * Bursts are not limited by the legacy VI I2C FIFO here; long bursts let
+ * the I2C controller move the payload by DMA, and regmap splits them when
+ * the adapter has a smaller write limit.
+ */
+#define REGMAP_UTIL_MAX_BURST	128
+
+void regmap_util_table_cache_init(struct regmap_util_table_cache *cache)
+{
+	xa_init(&cache->vals);
+}
+EXPORT_SYMBOL_GPL(regmap_util_table_cache_init);
+
+void regmap_util_table_cache_invalidate(struct regmap_util_table_cache *cache)
+{
+	xa_destroy(&cache->vals);
+}
+EXPORT_SYMBOL_GPL(regmap_util_table_cache_invalidate);
+
+static int
+regmap_util_flush_range(struct regmap *regmap,
+			struct regmap_util_table_cache *cache,
+			unsigned int range_start, const u8 *range_vals,
+			unsigned int range_count)
+{
+	unsigned int i;
+	int err;
+
+	if (range_count == 0)
+		return 0;
+
+	if (range_count == 1)
+		err = regmap_write(regmap, range_start, range_vals[0]);
+	else
+		err = regmap_bulk_write(regmap, range_start, range_vals,
+					range_count);
+	if (err)
+		return err;
+
+	if (!cache)
+		return 0;
+
+	cache->bursts++;
+	cache->regs_written += range_count;
+
+	for (i = 0; i < range_count; i++) {
+		/* a stale entry must not survive a failed update */
+		if (xa_is_err(xa_store(&cache->vals, range_start + i,
+				       xa_mk_value(range_vals[i]), GFP_KERNEL)))
+			xa_erase(&cache->vals, range_start + i);
+	}
+
+	return 0;
+}
+
+/*
+ * regmap_util_write_table_8_cached - write a register table in bursts
+ *
+ * Like regmap_util_write_table_8(), but consecutive addresses are merged into
+ * bursts of up to REGMAP_UTIL_MAX_BURST registers, and when @cache is given,
+ * a register that opens a burst is skipped if the cache shows the table
+ * value was already written. Registers inside an open burst are always
+ * written, splitting the burst would cost more than the byte saved.
+ */
+int
+regmap_util_write_table_8_cached(struct regmap *regmap,
+				 struct regmap_util_table_cache *cache,
+				 const struct reg_8 table[],
+				 const struct reg_8 override_list[],
+				 int num_override_regs,
+				 u16 wait_ms_addr, u16 end_addr)
+{
+	int err = 0;
+	const struct reg_8 *next;
+	int i;
+	u8 val;
+
+	int range_start = -1;
+	unsigned int range_count = 0;
+	u8 range_vals[REGMAP_UTIL_MAX_BURST];
+
+	if (cache)
+		cache->tables++;
+
+	for (next = table;; next++) {
+		if  ((next->addr != range_start + range_count) ||
+		     (next->addr == end_addr) ||
+		     (next->addr == wait_ms_addr) ||
+		     (range_count == ARRAY_SIZE(range_vals))) {
+
+			err = regmap_util_flush_range(regmap, cache,
+						      range_start, range_vals,
+						      range_count);
+			if (err) {
+				pr_err("%s:regmap_util_write_table:%d",
+				       __func__, err);
+				/* the device state is unknown after a failure */
+				if (cache)
+					regmap_util_table_cache_invalidate(cache);
+				return err;
+			}
+
+			range_start = -1;
+			range_count = 0;
+
+			if (next->addr == end_addr)
+				break;
+
+			if (next->addr == wait_ms_addr) {
+				msleep_range(next->val);
+				continue;
+			}
+		}
+
+		val = next->val;
+
+		if (override_list) {
+			for (i = 0; i < num_override_regs; i++) {
+				if (next->addr == override_list[i].addr) {
+					val = override_list[i].val;
+					break;
+				}
+			}
+		}
+
+		if (range_start == -1) {
+			if (cache && xa_load(&cache->vals, next->addr) ==
+					xa_mk_value(val)) {
+				cache->regs_skipped++;
+				continue;
+			}
+			range_start = next->addr;
+		}
+
+		range_vals[range_count++] = val;
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL_GPL(regmap_util_write_table_8_cached);
 MODULE_LICENSE("GPL");
 
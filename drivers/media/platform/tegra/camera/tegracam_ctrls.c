@@ -27,6 +27,11 @@
 
 #define TEGRACAM_DEF_CTRLS 1
 
+static bool ctrl_batching = true;
+module_param(ctrl_batching, bool, 0644);
+MODULE_PARM_DESC(ctrl_batching,
+	"Apply gain/exposure/frame rate of a streaming sensor in one group hold");
+
 static int tegracam_s_ctrl(struct v4l2_ctrl *ctrl);
 static const struct v4l2_ctrl_ops tegracam_ctrl_ops = {
 	.s_ctrl = tegracam_s_ctrl,
@@ -291,6 +296,101 @@ static int tegracam_setup_compound_ctrls(struct tegracam_device *tc_dev,
 	return 0;
 }
 
+/*
+ * While streaming, gain, exposure and frame rate are not written from the
+ * ioctl path. They are collected under the control handler lock and applied
+ * by a worker inside a single group hold, so the sensor latches them together
+ * on its next frame boundary. Group hold requests from userspace are dropped
+ * as the worker brackets the batch itself.
+ */
+static bool tegracam_ctrl_batching(struct tegracam_ctrl_handler *handler)
+{
+	return READ_ONCE(ctrl_batching) && handler->tc_dev->is_streaming &&
+		handler->ctrl_ops->set_group_hold != NULL;
+}
+
+static int tegracam_ctrl_batch_add(struct tegracam_ctrl_handler *handler,
+			enum tegracam_ctrl_batch_idx idx, s64 val)
+{
+	struct tegracam_ctrl_batch *batch = &handler->batch;
+
+	batch->vals[idx] = val;
+	__set_bit(idx, &batch->pending);
+	queue_work(system_highpri_wq, &batch->work);
+
+	return 0;
+}
+
+static int tegracam_ctrl_batch_apply(struct tegracam_ctrl_handler *handler,
+			enum tegracam_ctrl_batch_idx idx, s64 val)
+{
+	const struct tegracam_ctrl_ops *ops = handler->ctrl_ops;
+	struct tegracam_device *tc_dev = handler->tc_dev;
+
+	switch (idx) {
+	case TEGRACAM_CTRL_BATCH_FRAME_RATE:
+		return ops->set_frame_rate(tc_dev, val);
+	case TEGRACAM_CTRL_BATCH_EXPOSURE:
+		return ops->set_exposure(tc_dev, val);
+	case TEGRACAM_CTRL_BATCH_EXPOSURE_SHORT:
+		return ops->set_exposure_short(tc_dev, val);
+	case TEGRACAM_CTRL_BATCH_GAIN:
+		return ops->set_gain(tc_dev, val);
+	default:
+		return -EINVAL;
+	}
+}
+
+static void tegracam_ctrl_batch_work(struct work_struct *work)
+{
+	struct tegracam_ctrl_batch *batch =
+		container_of(work, struct tegracam_ctrl_batch, work);
+	struct tegracam_ctrl_handler *handler =
+		container_of(batch, struct tegracam_ctrl_handler, batch);
+	const struct tegracam_ctrl_ops *ops = handler->ctrl_ops;
+	struct tegracam_device *tc_dev = handler->tc_dev;
+	unsigned long pending;
+	int err, i;
+
+	/* waits for a VIDIOC_S_EXT_CTRLS in progress to finish its batch */
+	mutex_lock(handler->ctrl_handler.lock);
+
+	pending = batch->pending;
+	batch->pending = 0;
+
+	if (pending == 0 || !tc_dev->is_streaming)
+		goto unlock;
+
+	err = ops->set_group_hold(tc_dev, true);
+	for_each_set_bit(i, &pending, TEGRACAM_CTRL_BATCH_NUM) {
+		if (err)
+			break;
+		err = tegracam_ctrl_batch_apply(handler, i, batch->vals[i]);
+	}
+	err |= ops->set_group_hold(tc_dev, false);
+
+	if (err) {
+		batch->errors++;
+		dev_err(tc_dev->dev, "%s: failed to apply controls: %d\n",
+			__func__, err);
+	} else {
+		batch->applied++;
+	}
+
+unlock:
+	mutex_unlock(handler->ctrl_handler.lock);
+}
+
+/*
+ * Wait for the batch in flight to be written, called before the sensor
+ * stops streaming.
+ */
+void tegracam_ctrl_batch_flush(struct tegracam_ctrl_handler *handler)
+{
+	flush_work(&handler->batch.work);
+}
+EXPORT_SYMBOL_GPL(tegracam_ctrl_batch_flush);
+
 static int tegracam_set_ctrls(struct tegracam_ctrl_handler *handler,
 			struct v4l2_ctrl *ctrl)
 {
@@ -328,20 +428,34 @@ static int tegracam_set_ctrls(struct tegracam_ctrl_handler *handler,
 	case TEGRA_CAMERA_CID_GAIN:
 		if (*ctrl->p_new.p_s64 == ctrlprops->max_gain_val + 1)
 			return 0;
+		if (tegracam_ctrl_batching(handler))
+			return tegracam_ctrl_batch_add(handler,
+				TEGRACAM_CTRL_BATCH_GAIN, *ctrl->p_new.p_s64);
 		err = ops->set_gain(tc_dev, *ctrl->p_new.p_s64);
 		break;
 	case TEGRA_CAMERA_CID_FRAME_RATE:
+		if (tegracam_ctrl_batching(handler))
+			return tegracam_ctrl_batch_add(handler,
+				TEGRACAM_CTRL_BATCH_FRAME_RATE, *ctrl->p_new.p_s64);
 		err = ops->set_frame_rate(tc_dev, *ctrl->p_new.p_s64);
 		break;
 	case TEGRA_CAMERA_CID_EXPOSURE:
 		if (*ctrl->p_new.p_s64 == ctrlprops->max_exp_time.val + 1)
 			return 0;
+		if (tegracam_ctrl_batching(handler))
+			return tegracam_ctrl_batch_add(handler,
+				TEGRACAM_CTRL_BATCH_EXPOSURE, *ctrl->p_new.p_s64);
 		err = ops->set_exposure(tc_dev, *ctrl->p_new.p_s64);
 		break;
 	case TEGRA_CAMERA_CID_EXPOSURE_SHORT:
+		if (tegracam_ctrl_batching(handler))
+			return tegracam_ctrl_batch_add(handler,
+				TEGRACAM_CTRL_BATCH_EXPOSURE_SHORT, *ctrl->p_new.p_s64);
 		err = ops->set_exposure_short(tc_dev, *ctrl->p_new.p_s64);
 		break;
 	case TEGRA_CAMERA_CID_GROUP_HOLD:
+		if (tegracam_ctrl_batching(handler))
+			return 0;
 		err = ops->set_group_hold(tc_dev, ctrl->val);
 		break;
 	case TEGRA_CAMERA_CID_ALTERNATING_EXPOSURE:
@@ -1030,6 +1144,8 @@ int tegracam_ctrl_handler_init(struct tegracam_ctrl_handler *handler)
 	int i, j;
 	int err = 0;
 
+	INIT_WORK(&handler->batch.work, tegracam_ctrl_batch_work);
+
 	if (ops != NULL) {
 		cids = ops->ctrl_cid_list;
 
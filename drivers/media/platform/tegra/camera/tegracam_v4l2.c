@@ -4,6 +4,7 @@
  *
  * Copyright (c) 2018-2022, NVIDIA CORPORATION.  All rights reserved.
  */
+#include <linux/ktime.h>
 #include <linux/types.h>
 #include <media/tegra-v4l2-camera.h>
 #include <media/tegracam_core.h>
@@ -18,6 +19,7 @@ static int v4l2sd_stream(struct v4l2_subdev *sd, int enable)
 	struct tegracam_sensor_data *sensor_data;
 	struct sensor_blob *ctrl_blob;
 	struct sensor_blob *mode_blob;
+	u64 start_ns, mode_ns;
 	int err = 0;
 
 	dev_dbg(&client->dev, "%s++ enable %d\n", __func__, enable);
@@ -39,12 +41,18 @@ static int v4l2sd_stream(struct v4l2_subdev *sd, int enable)
 		if (!try_module_get(s_data->owner))
 			return -ENODEV;
 
+		start_ns = ktime_get_ns();
 		err = sensor_ops->set_mode(tc_dev);
 		if (err) {
 			dev_err(&client->dev, "Error writing mode\n");
 			goto error;
 		}
 
+		mode_ns = ktime_get_ns() - start_ns;
+		s_data->timing.mode_switch_ns = mode_ns;
+		s_data->timing.mode_switch_max_ns =
+			max(s_data->timing.mode_switch_max_ns, mode_ns);
+
 		/* update control ranges based on mode settings*/
 		err = tegracam_init_ctrl_ranges_by_mode(
 			s_data->tegracam_ctrl_hdl, (u32) s_data->mode);
@@ -73,11 +81,18 @@ static int v4l2sd_stream(struct v4l2_subdev *sd, int enable)
 			goto error;
 		}
 
+		s_data->timing.stream_start_ns = ktime_get_ns() - start_ns;
+		s_data->timing.stream_start_max_ns =
+			max(s_data->timing.stream_start_max_ns,
+			    s_data->timing.stream_start_ns);
+		s_data->timing.stream_starts++;
+
 		/* add done command for blobs */
 		prepare_done_cmd(mode_blob);
 		prepare_done_cmd(ctrl_blob);
 		tc_dev->is_streaming = true;
 	} else {
+		tegracam_ctrl_batch_flush(s_data->tegracam_ctrl_hdl);
 		err = sensor_ops->stop_streaming(tc_dev);
 		if (err) {
 			dev_err(&client->dev, "Error turning off streaming\n");
@@ -251,6 +266,7 @@ void tegracam_v4l2subdev_unregister(struct tegracam_device *tc_dev)
 
 	sd = &s_data->subdev;
 
+	cancel_work_sync(&s_data->tegracam_ctrl_hdl->batch.work);
 	v4l2_ctrl_handler_free(s_data->ctrl_handler);
 #if defined(CONFIG_V4L2_ASYNC)
 	v4l2_async_unregister_subdev(sd);
@@ -0,0 +1,542 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * tegra_capture_bench - capture pipeline benchmark on the VI test pattern
+ * generator
+ *
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Streams the TPG channels of the VI media controller through VI/NVCSI
+ * from inside the kernel, so the capture path can be measured on a bench
+ * board without any sensor attached. The vb2 queues are driven directly,
+ * keeping userspace scheduling out of the numbers.
+ *
+ *   modprobe tegra_capture_bench width=1920 height=1080 fps=60 channels=4
+ *   echo 1 > /sys/kernel/debug/tegra_capture_bench/run
+ *   cat /sys/kernel/debug/tegra_capture_bench/results
+ */
+
+#include <nvidia/conftest.h>
+
+#include <linux/debugfs.h>
+#include <linux/kernel_stat.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <media/csi.h>
+#include <media/mc_common.h>
+#include <media/videobuf2-core.h>
+#include <media/videobuf2-v4l2.h>
+
+#include "utils/tegracam_log.h"
+
+#define TCB_MAX_CHANNELS		16U
+#define TCB_MIN_BUFFERS			2U
+#define TCB_FRAME_TIMEOUT_MS		1000U
+
+static unsigned int width = 1920;
+module_param(width, uint, 0644);
+MODULE_PARM_DESC(width, "TPG frame width");
+
+static unsigned int height = 1080;
+module_param(height, uint, 0644);
+MODULE_PARM_DESC(height, "TPG frame height");
+
+static unsigned int fps = 30;
+module_param(fps, uint, 0644);
+MODULE_PARM_DESC(fps, "TPG frame rate, 0 keeps the rate of the TPG mode");
+
+static unsigned int channels = 1;
+module_param(channels, uint, 0644);
+MODULE_PARM_DESC(channels, "Number of TPG channels streamed concurrently");
+
+static unsigned int frames = 600;
+module_param(frames, uint, 0644);
+MODULE_PARM_DESC(frames, "Frames captured per channel in one run");
+
+static unsigned int buffers = 4;
+module_param(buffers, uint, 0644);
+MODULE_PARM_DESC(buffers, "Capture buffers allocated per channel");
+
+struct tcb_channel {
+	struct tegra_channel *chan;
+	struct work_struct work;
+	bool owned;
+	int status;
+
+	unsigned int rate;
+	u32 *latency_us;
+	u32 target;
+	u32 frames;
+	u64 dropped;
+	u64 errors;
+	u64 first_ns;
+	u64 last_ns;
+	u64 last_sof_ns;
+
+	/* filled in once the run completes */
+	u32 fps_milli;
+	u32 p50_us;
+	u32 p90_us;
+	u32 p99_us;
+	u32 max_us;
+};
+
+static struct {
+	/* serializes runs against each other and against results reads */
+	struct mutex lock;
+	struct dentry *debugfs;
+	struct tcb_channel chans[TCB_MAX_CHANNELS];
+	unsigned int num_chans;
+	unsigned int width;
+	unsigned int height;
+	u64 wall_ns;
+	u64 cpu_ns;
+	u64 frames;
+	int status;
+	bool valid;
+} tcb;
+
+static u64 tcb_cpu_busy_ns(void)
+{
+	u64 busy = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		u64 *cpustat = kcpustat_cpu(cpu).cpustat;
+
+		busy += cpustat[CPUTIME_USER] + cpustat[CPUTIME_NICE] +
+			cpustat[CPUTIME_SYSTEM] + cpustat[CPUTIME_IRQ] +
+			cpustat[CPUTIME_SOFTIRQ];
+	}
+
+	return busy;
+}
+
+static int tcb_reqbufs(struct vb2_queue *q, unsigned int *count)
+{
+#if defined(NV_VB2_CORE_REQBUFS_HAS_FLAGS_ARG)
+	return vb2_core_reqbufs(q, VB2_MEMORY_MMAP, 0, count);
+#else
+	return vb2_core_reqbufs(q, VB2_MEMORY_MMAP, count);
+#endif
+}
+
+static int tcb_qbuf(struct vb2_queue *q, unsigned int index)
+{
+#if defined(NV_VB2_CORE_QBUF_HAS_VB2_BUFFER_ARG)
+	return vb2_core_qbuf(q, vb2_get_buffer(q, index), NULL, NULL);
+#else
+	return vb2_core_qbuf(q, index, NULL, NULL);
+#endif
+}
+
+static int tcb_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Called with chan->video_lock held */
+static int tcb_channel_configure(struct tcb_channel *bc)
+{
+	struct tegra_channel *chan = bc->chan;
+	struct tegra_csi_channel *csi_chan = to_csi_chan(chan->subdev_on_csi);
+	struct v4l2_pix_format pix = chan->format;
+	unsigned int count = max(buffers, TCB_MIN_BUFFERS);
+	unsigned int i;
+	int err;
+
+	pix.width = tcb.width;
+	pix.height = tcb.height;
+	err = tegra_channel_set_pix_format(chan, &pix);
+	if (err)
+		return err;
+
+	/* the TPG only generates the sizes of its mode table */
+	if (pix.width != tcb.width || pix.height != tcb.height)
+		return -EINVAL;
+
+	/* the set format loaded the TPG mode rate, override it */
+	mutex_lock(&csi_chan->format_lock);
+	if (fps != 0) {
+		for (i = 0; i < chan->valid_ports; i++)
+			csi_chan->ports[i].framerate = fps;
+	}
+	bc->rate = csi_chan->ports[0].framerate;
+	mutex_unlock(&csi_chan->format_lock);
+
+	err = tcb_reqbufs(&chan->queue, &count);
+	if (err)
+		return err;
+
+	for (i = 0; i < count; i++) {
+		err = tcb_qbuf(&chan->queue, i);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static int tcb_channel_setup(struct tcb_channel *bc)
+{
+	struct tegra_channel *chan = bc->chan;
+	struct vb2_queue *q = &chan->queue;
+	int err;
+
+	bc->target = frames;
+	bc->latency_us = kvcalloc(bc->target, sizeof(*bc->latency_us),
+				  GFP_KERNEL);
+	if (bc->latency_us == NULL)
+		return -ENOMEM;
+
+	mutex_lock(&chan->video_lock);
+
+	if (vb2_is_busy(q) || q->owner != NULL) {
+		mutex_unlock(&chan->video_lock);
+		return -EBUSY;
+	}
+
+	/* keep userspace off the queue for the duration of the run */
+	q->owner = &tcb;
+	bc->owned = true;
+
+	err = tcb_channel_configure(bc);
+	mutex_unlock(&chan->video_lock);
+
+	return err;
+}
+
+static void tcb_channel_release(struct tcb_channel *bc)
+{
+	struct tegra_channel *chan = bc->chan;
+	struct vb2_queue *q = &chan->queue;
+	unsigned int count = 0;
+
+	if (bc->owned) {
+		mutex_lock(&chan->video_lock);
+		if (vb2_is_streaming(q))
+			vb2_core_streamoff(q, q->type);
+		tcb_reqbufs(q, &count);
+		q->owner = NULL;
+		mutex_unlock(&chan->video_lock);
+		bc->owned = false;
+	}
+
+	kvfree(bc->latency_us);
+	bc->latency_us = NULL;
+}
+
+static void tcb_channel_record(struct tcb_channel *bc,
+			const struct v4l2_buffer *vbuf, u64 now)
+{
+	u64 sof_ns = v4l2_timeval_to_ns(&vbuf->timestamp);
+	u64 period_ns;
+
+	if (vbuf->flags & V4L2_BUF_FLAG_ERROR) {
+		bc->errors++;
+		return;
+	}
+
+	/*
+	 * The VI only captures into queued buffers, so a frame the TPG sent
+	 * while no buffer was available shows up as a gap in the SOF times
+	 * rather than in the buffer sequence.
+	 */
+	if (bc->last_sof_ns != 0 && bc->rate != 0 && sof_ns > bc->last_sof_ns) {
+		period_ns = div_u64(NSEC_PER_SEC, bc->rate);
+		bc->dropped += div64_u64(sof_ns - bc->last_sof_ns +
+					 period_ns / 2, period_ns) - 1;
+	}
+	bc->last_sof_ns = sof_ns;
+
+	if (bc->frames == 0)
+		bc->first_ns = now;
+	bc->last_ns = now;
+
+	bc->latency_us[bc->frames++] =
+		now > sof_ns ? div_u64(now - sof_ns, NSEC_PER_USEC) : 0;
+}
+
+static void tcb_channel_work(struct work_struct *work)
+{
+	struct tcb_channel *bc = container_of(work, struct tcb_channel, work);
+	struct tegra_channel *chan = bc->chan;
+	struct vb2_queue *q = &chan->queue;
+	struct v4l2_buffer vbuf;
+	unsigned int index;
+	int err = 0;
+	u64 now;
+
+	/* error frames count against the target so a failing run ends */
+	while (bc->frames + bc->errors < bc->target) {
+		if (!wait_event_timeout(q->done_wq,
+				!list_empty(&q->done_list) ||
+				!q->streaming || q->error,
+				msecs_to_jiffies(TCB_FRAME_TIMEOUT_MS))) {
+			err = -ETIMEDOUT;
+			break;
+		}
+
+		mutex_lock(&chan->video_lock);
+
+		memset(&vbuf, 0, sizeof(vbuf));
+		vbuf.type = q->type;
+		vbuf.memory = V4L2_MEMORY_MMAP;
+		err = vb2_core_dqbuf(q, &index, &vbuf, true);
+		if (err == -EAGAIN) {
+			mutex_unlock(&chan->video_lock);
+			err = 0;
+			continue;
+		}
+		if (err) {
+			mutex_unlock(&chan->video_lock);
+			break;
+		}
+
+		now = ktime_get_ns();
+		tcb_channel_record(bc, &vbuf, now);
+
+		err = tcb_qbuf(q, index);
+		mutex_unlock(&chan->video_lock);
+		if (err)
+			break;
+	}
+
+	bc->status = err;
+}
+
+static void tcb_channel_summarize(struct tcb_channel *bc)
+{
+	u32 n = bc->frames;
+
+	if (n == 0)
+		return;
+
+	if (n > 1 && bc->last_ns > bc->first_ns)
+		bc->fps_milli = div64_u64((u64)(n - 1) * NSEC_PER_SEC * 1000,
+					  bc->last_ns - bc->first_ns);
+
+	sort(bc->latency_us, n, sizeof(*bc->latency_us), tcb_cmp_u32, NULL);
+	bc->p50_us = bc->latency_us[n * 50 / 100];
+	bc->p90_us = bc->latency_us[n * 90 / 100];
+	bc->p99_us = bc->latency_us[n * 99 / 100];
+	bc->max_us = bc->latency_us[n - 1];
+}
+
+static int tcb_select_channels(void)
+{
+	struct tegra_mc_vi *vi = tegra_get_mc_vi();
+	struct tegra_channel *chan;
+	unsigned int n = 0;
+
+	if (vi == NULL)
+		return -ENODEV;
+
+	list_for_each_entry(chan, &vi->vi_chans, list) {
+		if (n == channels || n == TCB_MAX_CHANNELS)
+			break;
+		if (chan->pg_mode == TEGRA_VI_PG_DISABLED ||
+		    chan->video == NULL || !video_is_registered(chan->video) ||
+		    chan->subdev_on_csi == NULL)
+			continue;
+
+		memset(&tcb.chans[n], 0, sizeof(tcb.chans[n]));
+		tcb.chans[n].chan = chan;
+		INIT_WORK(&tcb.chans[n].work, tcb_channel_work);
+		n++;
+	}
+
+	if (n < channels)
+		return -ENODEV;
+
+	tcb.num_chans = n;
+
+	return 0;
+}
+
+static int tcb_run(void)
+{
+	struct tcb_channel *bc;
+	u64 start_ns, start_cpu;
+	unsigned int i;
+	int err;
+
+	if (channels == 0 || frames == 0)
+		return -EINVAL;
+
+	tcb.valid = false;
+	tcb.num_chans = 0;
+	tcb.width = width;
+	tcb.height = height;
+	tcb.frames = 0;
+
+	err = tcb_select_channels();
+	if (err)
+		return err;
+
+	for (i = 0; i < tcb.num_chans; i++) {
+		err = tcb_channel_setup(&tcb.chans[i]);
+		if (err)
+			goto release;
+	}
+
+	start_ns = ktime_get_ns();
+	start_cpu = tcb_cpu_busy_ns();
+
+	for (i = 0; i < tcb.num_chans; i++) {
+		bc = &tcb.chans[i];
+
+		mutex_lock(&bc->chan->video_lock);
+		err = vb2_core_streamon(&bc->chan->queue, bc->chan->queue.type);
+		mutex_unlock(&bc->chan->video_lock);
+		if (err)
+			break;
+
+		queue_work(system_unbound_wq, &bc->work);
+	}
+
+	for (i = 0; i < tcb.num_chans; i++)
+		flush_work(&tcb.chans[i].work);
+
+	tcb.wall_ns = ktime_get_ns() - start_ns;
+	tcb.cpu_ns = tcb_cpu_busy_ns() - start_cpu;
+
+	for (i = 0; i < tcb.num_chans; i++) {
+		bc = &tcb.chans[i];
+		tcb_channel_summarize(bc);
+		tcb.frames += bc->frames;
+		if (!err)
+			err = bc->status;
+	}
+
+	tcb.status = err;
+	tcb.valid = true;
+
+release:
+	for (i = 0; i < tcb.num_chans; i++)
+		tcb_channel_release(&tcb.chans[i]);
+
+	return err;
+}
+
+static void tcb_log_summary(void)
+{
+	u64 cpu_us_per_frame = tcb.frames ?
+		div64_u64(tcb.cpu_ns, tcb.frames * NSEC_PER_USEC) : 0;
+	unsigned int i;
+
+	camtest_log(KERN_INFO "capture bench: %ux%u, %u channels, status %d, cpu/frame %llu us\n",
+		tcb.width, tcb.height, tcb.num_chans, tcb.status,
+		cpu_us_per_frame);
+
+	for (i = 0; i < tcb.num_chans; i++) {
+		struct tcb_channel *bc = &tcb.chans[i];
+
+		camtest_log(KERN_INFO "capture bench: %s: %u.%03u fps, %u frames, %llu dropped, %llu errors, p50 %u us, p99 %u us\n",
+			bc->chan->video->name,
+			bc->fps_milli / 1000, bc->fps_milli % 1000,
+			bc->frames, bc->dropped, bc->errors,
+			bc->p50_us, bc->p99_us);
+	}
+}
+
+static ssize_t tcb_run_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	bool run;
+	int err;
+
+	err = kstrtobool_from_user(buf, count, &run);
+	if (err)
+		return err;
+
+	if (!run)
+		return count;
+
+	mutex_lock(&tcb.lock);
+	err = tcb_run();
+	if (tcb.valid)
+		tcb_log_summary();
+	mutex_unlock(&tcb.lock);
+
+	return err ? err : count;
+}
+
+static const struct file_operations tcb_run_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = tcb_run_write,
+	.llseek = noop_llseek,
+};
+
+static int tcb_results_show(struct seq_file *s, void *unused)
+{
+	unsigned int i;
+
+	mutex_lock(&tcb.lock);
+
+	if (!tcb.valid) {
+		seq_puts(s, "no results\n");
+		goto out;
+	}
+
+	seq_printf(s, "resolution: %ux%u\n", tcb.width, tcb.height);
+	seq_printf(s, "channels: %u\n", tcb.num_chans);
+	seq_printf(s, "status: %d\n", tcb.status);
+	seq_printf(s, "wall_us: %llu\n", div_u64(tcb.wall_ns, NSEC_PER_USEC));
+	seq_printf(s, "cpu_us: %llu\n", div_u64(tcb.cpu_ns, NSEC_PER_USEC));
+	seq_printf(s, "cpu_us_per_frame: %llu\n", tcb.frames ?
+		   div64_u64(tcb.cpu_ns, tcb.frames * NSEC_PER_USEC) : 0);
+
+	for (i = 0; i < tcb.num_chans; i++) {
+		struct tcb_channel *bc = &tcb.chans[i];
+
+		seq_printf(s, "\n%s:\n", bc->chan->video->name);
+		seq_printf(s, "  status: %d\n", bc->status);
+		seq_printf(s, "  tpg_rate: %u\n", bc->rate);
+		seq_printf(s, "  fps: %u.%03u\n",
+			   bc->fps_milli / 1000, bc->fps_milli % 1000);
+		seq_printf(s, "  frames: %u\n", bc->frames);
+		seq_printf(s, "  dropped: %llu\n", bc->dropped);
+		seq_printf(s, "  errors: %llu\n", bc->errors);
+		seq_printf(s, "  latency_us: p50 %u p90 %u p99 %u max %u\n",
+			   bc->p50_us, bc->p90_us, bc->p99_us, bc->max_us);
+	}
+
+out:
+	mutex_unlock(&tcb.lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tcb_results);
+
+static int __init tcb_init(void)
+{
+	mutex_init(&tcb.lock);
+
+	tcb.debugfs = debugfs_create_dir("tegra_capture_bench", NULL);
+	debugfs_create_file("run", 0200, tcb.debugfs, NULL, &tcb_run_fops);
+	debugfs_create_file("results", 0444, tcb.debugfs, NULL,
+			    &tcb_results_fops);
+
+	return 0;
+}
+
+static void __exit tcb_exit(void)
+{
+	/* waits for a run in progress, which holds the lock until done */
+	debugfs_remove_recursive(tcb.debugfs);
+	mutex_destroy(&tcb.lock);
+}
+
+module_init(tcb_init);
+module_exit(tcb_exit);
+MODULE_DESCRIPTION("Tegra capture pipeline benchmark on the VI TPG");
+MODULE_LICENSE("GPL v2");
@@ -0,0 +1,354 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+/*
+ * Tegra VI capture groups
+ *
+ * Channels that are triggered by the same cam_fsync group join a capture
+ * group; their frame completions are collected into frame sets and userspace
+ * gets one event per set on the group file descriptor, instead of waiting on
+ * every member's vb2 queue.
+ */
+
+#include <nvidia/conftest.h>
+
+#include <linux/anon_inodes.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <media/mc_common.h>
+#include <uapi/media/tegra_capture_group.h>
+
+/* completed frame sets kept for the reader */
+#define TEGRA_CAPTURE_GROUP_QUEUE_DEPTH	8U
+
+struct tegra_capture_group {
+	struct kref kref;
+	struct list_head list;
+	struct tegra_mc_vi *vi;
+	u32 id;
+
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	struct tegra_channel *members[TEGRA_CAPTURE_GROUP_MAX_MEMBERS];
+	u32 member_mask;
+	u64 skew_threshold_ns;
+
+	/* frame set being collected */
+	struct tegra_capture_group_event pending;
+
+	/* completed frame sets */
+	struct tegra_capture_group_event events[TEGRA_CAPTURE_GROUP_QUEUE_DEPTH];
+	unsigned int head;
+	unsigned int count;
+	u64 sequence;
+	u32 dropped;
+};
+
+/* Called with vi->capture_groups_lock held, drops it */
+static void tegra_capture_group_release(struct kref *kref)
+{
+	struct tegra_capture_group *group =
+		container_of(kref, struct tegra_capture_group, kref);
+
+	list_del(&group->list);
+	mutex_unlock(&group->vi->capture_groups_lock);
+
+	kfree(group);
+}
+
+static void tegra_capture_group_put(struct tegra_capture_group *group)
+{
+	kref_put_mutex(&group->kref, tegra_capture_group_release,
+			&group->vi->capture_groups_lock);
+}
+
+/* Move the pending frame set to the event queue. Called with lock held. */
+static void tegra_capture_group_complete_locked(
+	struct tegra_capture_group *group)
+{
+	struct tegra_capture_group_event *pending = &group->pending;
+	struct tegra_capture_group_event *event;
+	u64 min_ns = U64_MAX, max_ns = 0;
+	unsigned long mask = pending->member_mask;
+	unsigned int i;
+
+	for_each_set_bit(i, &mask, TEGRA_CAPTURE_GROUP_MAX_MEMBERS) {
+		min_ns = min(min_ns, pending->sof_ns[i]);
+		max_ns = max(max_ns, pending->sof_ns[i]);
+	}
+
+	pending->skew_ns = max_ns - min_ns;
+	if (group->skew_threshold_ns != 0 &&
+	    pending->skew_ns > group->skew_threshold_ns)
+		pending->flags |= TEGRA_CAPTURE_GROUP_EVENT_SKEW;
+	if (pending->member_mask != group->member_mask)
+		pending->flags |= TEGRA_CAPTURE_GROUP_EVENT_INCOMPLETE;
+	if (pending->error_mask != 0)
+		pending->flags |= TEGRA_CAPTURE_GROUP_EVENT_ERROR;
+
+	pending->sequence = group->sequence++;
+
+	/* reader fell behind, drop the oldest set */
+	if (group->count == TEGRA_CAPTURE_GROUP_QUEUE_DEPTH) {
+		group->count--;
+		group->dropped++;
+	}
+
+	pending->dropped = group->dropped;
+	group->dropped = 0;
+
+	event = &group->events[(group->head + group->count) %
+			TEGRA_CAPTURE_GROUP_QUEUE_DEPTH];
+	*event = *pending;
+	group->count++;
+
+	memset(pending, 0, sizeof(*pending));
+}
+
+/**
+ * tegra_capture_group_frame - report a member frame completion
+ * @chan: VI channel
+ * @frame_id: frame id from the capture descriptor
+ * @sof_ns: start-of-frame timestamp
+ * @error: the frame completed with an error
+ *
+ * Called from the frame completion path of a streaming channel; a frame set
+ * completes once every member has reported a frame for it. A member that
+ * reports a second frame before the set is complete closes the set as
+ * incomplete, since the missing members dropped that trigger.
+ */
+void tegra_capture_group_frame(struct tegra_channel *chan, u32 frame_id,
+			u64 sof_ns, bool error)
+{
+	struct tegra_capture_group *group = chan->capture_group;
+	struct tegra_capture_group_event *pending;
+	unsigned int member;
+	bool completed = false;
+	unsigned long flags;
+	u32 bit;
+
+	if (group == NULL)
+		return;
+
+	member = chan->capture_group_member;
+	bit = BIT(member);
+
+	spin_lock_irqsave(&group->lock, flags);
+
+	pending = &group->pending;
+	if (pending->member_mask & bit) {
+		tegra_capture_group_complete_locked(group);
+		completed = true;
+	}
+
+	pending->member_mask |= bit;
+	if (error)
+		pending->error_mask |= bit;
+	pending->sof_ns[member] = sof_ns;
+	pending->frame_id[member] = frame_id;
+
+	if (pending->member_mask == group->member_mask) {
+		tegra_capture_group_complete_locked(group);
+		completed = true;
+	}
+
+	spin_unlock_irqrestore(&group->lock, flags);
+
+	if (completed)
+		wake_up_interruptible(&group->wait);
+}
+EXPORT_SYMBOL(tegra_capture_group_frame);
+
+static ssize_t tegra_capture_group_read(struct file *file, char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	struct tegra_capture_group *group = file->private_data;
+	struct tegra_capture_group_event event;
+	ssize_t copied = 0;
+	int err;
+
+	if (count < sizeof(event))
+		return -EINVAL;
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		err = wait_event_interruptible(group->wait,
+				READ_ONCE(group->count) != 0);
+		if (err)
+			return err;
+	}
+
+	while (count - copied >= sizeof(event)) {
+		spin_lock_irq(&group->lock);
+		if (group->count == 0) {
+			spin_unlock_irq(&group->lock);
+			break;
+		}
+		event = group->events[group->head];
+		group->head = (group->head + 1) %
+				TEGRA_CAPTURE_GROUP_QUEUE_DEPTH;
+		group->count--;
+		spin_unlock_irq(&group->lock);
+
+		if (copy_to_user(buf + copied, &event, sizeof(event)))
+			return copied ? copied : -EFAULT;
+
+		copied += sizeof(event);
+	}
+
+	return copied ? copied : -EAGAIN;
+}
+
+static __poll_t tegra_capture_group_poll(struct file *file, poll_table *wait)
+{
+	struct tegra_capture_group *group = file->private_data;
+
+	poll_wait(file, &group->wait, wait);
+
+	if (READ_ONCE(group->count) != 0)
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
+static int tegra_capture_group_file_release(struct inode *inode,
+			struct file *file)
+{
+	tegra_capture_group_put(file->private_data);
+
+	return 0;
+}
+
+static const struct file_operations tegra_capture_group_fops = {
+	.owner = THIS_MODULE,
+	.read = tegra_capture_group_read,
+	.poll = tegra_capture_group_poll,
+	.release = tegra_capture_group_file_release,
+	.llseek = noop_llseek,
+};
+
+/* Called with vi->capture_groups_lock held */
+static struct tegra_capture_group *tegra_capture_group_get(
+			struct tegra_mc_vi *vi, u32 id)
+{
+	struct tegra_capture_group *group;
+
+	list_for_each_entry(group, &vi->capture_groups, list) {
+		if (group->id == id) {
+			kref_get(&group->kref);
+			return group;
+		}
+	}
+
+	group = kzalloc(sizeof(*group), GFP_KERNEL);
+	if (group == NULL)
+		return NULL;
+
+	kref_init(&group->kref);
+	group->vi = vi;
+	group->id = id;
+	spin_lock_init(&group->lock);
+	init_waitqueue_head(&group->wait);
+	list_add_tail(&group->list, &vi->capture_groups);
+
+	return group;
+}
+
+/**
+ * tegra_capture_group_join - add a channel to the capture group of its
+ * cam_fsync group
+ * @chan: VI channel, not streaming
+ * @args: join arguments, see struct tegra_capture_group_join
+ */
+int tegra_capture_group_join(struct tegra_channel *chan,
+			struct tegra_capture_group_join *args)
+{
+	struct tegra_mc_vi *vi = chan->vi;
+	struct tegra_capture_group *group;
+	unsigned int member;
+	int fd;
+
+	if (args->flags != 0)
+		return -EINVAL;
+
+	/* membership is only changed while the frame path is quiet */
+	if (vb2_is_busy(&chan->queue) || chan->capture_group != NULL)
+		return -EBUSY;
+
+	mutex_lock(&vi->capture_groups_lock);
+
+	group = tegra_capture_group_get(vi, args->group_id);
+	if (group == NULL) {
+		mutex_unlock(&vi->capture_groups_lock);
+		return -ENOMEM;
+	}
+
+	member = ffz(group->member_mask);
+	if (member >= TEGRA_CAPTURE_GROUP_MAX_MEMBERS) {
+		mutex_unlock(&vi->capture_groups_lock);
+		tegra_capture_group_put(group);
+		return -ENOSPC;
+	}
+
+	spin_lock_irq(&group->lock);
+	if (args->skew_threshold_ns != 0)
+		group->skew_threshold_ns = args->skew_threshold_ns;
+	group->members[member] = chan;
+	group->member_mask |= BIT(member);
+	memset(&group->pending, 0, sizeof(group->pending));
+	spin_unlock_irq(&group->lock);
+
+	chan->capture_group = group;
+	chan->capture_group_member = member;
+
+	/* the file holds its own reference */
+	kref_get(&group->kref);
+
+	mutex_unlock(&vi->capture_groups_lock);
+
+	fd = anon_inode_getfd("tegra-capture-group", &tegra_capture_group_fops,
+			group, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		tegra_capture_group_put(group);
+		tegra_capture_group_leave(chan);
+		return fd;
+	}
+
+	args->fd = fd;
+	args->member = member;
+
+	return 0;
+}
+EXPORT_SYMBOL(tegra_capture_group_join);
+
+/**
+ * tegra_capture_group_leave - remove a channel from its capture group
+ * @chan: VI channel, not streaming
+ */
+int tegra_capture_group_leave(struct tegra_channel *chan)
+{
+	struct tegra_capture_group *group = chan->capture_group;
+	unsigned int member = chan->capture_group_member;
+
+	if (group == NULL)
+		return -ENOENT;
+
+	if (vb2_is_busy(&chan->queue))
+		return -EBUSY;
+
+	spin_lock_irq(&group->lock);
+	group->members[member] = NULL;
+	group->member_mask &= ~BIT(member);
+	memset(&group->pending, 0, sizeof(group->pending));
+	spin_unlock_irq(&group->lock);
+
+	chan->capture_group = NULL;
+
+	tegra_capture_group_put(group);
+
+	return 0;
+}
+EXPORT_SYMBOL(tegra_capture_group_leave);
@@ -9,6 +9,7 @@
 #include <linux/atomic.h>
 #include <linux/bitmap.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/nvhost.h>
 #include <linux/lcm.h>
@@ -18,7 +19,9 @@
 #include <linux/of_graph.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include <linux/semaphore.h>
+#include <linux/seq_file.h>
 #include <linux/arm64-barrier.h>
 #include <media/v4l2-ctrls.h>
 #include <media/v4l2-event.h>
@@ -42,6 +45,7 @@
 #include "mipical/mipi_cal.h"
 
 #include <uapi/linux/nvhost_nvcsi_ioctl.h>
+#include <uapi/media/tegra_capture_group.h>
 #include "nvcsi/nvcsi.h"
 #include "nvcsi/deskew.h"
 
@@ -2179,22 +2183,37 @@ __tegra_channel_set_format(struct tegra_channel *chan,
 	return ret;
 }
 
-static int
-tegra_channel_set_format(struct file *file, void *fh,
-			struct v4l2_format *format)
+/**
+ * tegra_channel_set_pix_format - set the capture format of a channel
+ * @chan: VI channel, with chan->video_lock held
+ * @pix: requested format, updated to the format actually set
+ *
+ * Used by the VIDIOC_S_FMT handler and by in-kernel users of the channel.
+ */
+int tegra_channel_set_pix_format(struct tegra_channel *chan,
+			struct v4l2_pix_format *pix)
 {
-	struct tegra_channel *chan = video_drvdata(file);
 	int ret = 0;
 
 	/* get the suppod format by try_fmt */
-	ret = __tegra_channel_try_format(chan, &format->fmt.pix);
+	ret = __tegra_channel_try_format(chan, pix);
 	if (ret)
 		return ret;
 
 	if (vb2_is_busy(&chan->queue))
 		return -EBUSY;
 
-	return __tegra_channel_set_format(chan, &format->fmt.pix);
+	return __tegra_channel_set_format(chan, pix);
+}
+EXPORT_SYMBOL(tegra_channel_set_pix_format);
+
+static int
+tegra_channel_set_format(struct file *file, void *fh,
+			struct v4l2_format *format)
+{
+	struct tegra_channel *chan = video_drvdata(file);
+
+	return tegra_channel_set_pix_format(chan, &format->fmt.pix);
 }
 
 static int tegra_channel_subscribe_event(struct v4l2_fh *fh,
@@ -2275,6 +2294,13 @@ static long tegra_channel_default_ioctl(struct file *file, void *fh,
 	struct tegra_mc_vi *vi = chan->vi;
 	long ret = -ENOTTY;
 
+	switch (cmd) {
+	case VIDIOC_TEGRA_CAPTURE_GROUP_JOIN:
+		return tegra_capture_group_join(chan, arg);
+	case VIDIOC_TEGRA_CAPTURE_GROUP_LEAVE:
+		return tegra_capture_group_leave(chan);
+	}
+
 	if (vi->fops && vi->fops->vi_default_ioctl)
 		ret = vi->fops->vi_default_ioctl(file, fh, use_prio, cmd, arg);
 
@@ -2375,6 +2401,9 @@ static int tegra_channel_close(struct file *fp)
 		return ret;
 	}
 
+	/* streaming has stopped, nothing is left to report to the group */
+	tegra_capture_group_leave(chan);
+
 	if (tegra_channel_verify_focuser(chan)) {
 		ret = tegra_channel_set_power(chan, false);
 		if (ret < 0)
@@ -2626,6 +2655,7 @@ int tegra_channel_init(struct tegra_channel *chan)
 	init_waitqueue_head(&chan->dequeue_wait);
 	spin_lock_init(&chan->dequeue_lock);
 	mutex_init(&chan->stop_kthread_lock);
+	mutex_init(&chan->event_lock);
 	init_rwsem(&chan->reset_lock);
 	atomic_set(&chan->is_streaming, DISABLE);
 	spin_lock_init(&chan->capture_state_lock);
@@ -2677,6 +2707,16 @@ int tegra_channel_init(struct tegra_channel *chan)
 		goto deskew_ctx_err;
 	}
 
+	spin_lock_init(&chan->frame_stats.lock);
+
+	atomic_set(&chan->events.head, 0);
+	chan->events.ring = vmalloc_user(TEGRA_CHANNEL_EVENTS *
+			sizeof(*chan->events.ring));
+	if (!chan->events.ring)
+		dev_warn(chan->vi->dev, "channel event log disabled\n");
+
+	tegra_channel_debugfs_init(chan);
+
 	chan->init_done = true;
 
 	return 0;
@@ -2694,6 +2734,278 @@ vb2_init_error:
 }
 EXPORT_SYMBOL(tegra_channel_init);
 
+static unsigned int tegra_channel_frame_bucket(u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+
+	if (!us)
+		return 0;
+
+	return min_t(unsigned int, fls64(us), TEGRA_CHANNEL_FRAME_BUCKETS - 1);
+}
+
+/*
+ * Fold a completed frame into the channel's timing histograms. The SOF
+ * timestamp is the one reported in the capture status, in the same
+ * CLOCK_MONOTONIC time base as the vb2 buffer timestamps.
+ */
+void tegra_channel_record_frame(struct tegra_channel *chan, u64 sof_ns)
+{
+	struct tegra_channel_frame_stats *stats = &chan->frame_stats;
+	u64 now = ktime_get_ns();
+	u64 interval, jitter;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stats->lock, flags);
+
+	stats->latency[tegra_channel_frame_bucket(now > sof_ns ?
+						  now - sof_ns : 0)]++;
+	stats->frames++;
+
+	if (stats->last_sof_ns && sof_ns > stats->last_sof_ns) {
+		interval = sof_ns - stats->last_sof_ns;
+
+		if (stats->last_interval_ns) {
+			jitter = interval > stats->last_interval_ns ?
+				interval - stats->last_interval_ns :
+				stats->last_interval_ns - interval;
+			stats->jitter[tegra_channel_frame_bucket(jitter)]++;
+		}
+
+		stats->last_interval_ns = interval;
+	}
+
+	stats->last_sof_ns = sof_ns;
+
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+EXPORT_SYMBOL(tegra_channel_record_frame);
+
+/*
+ * Forget the previous frame timings, e.g. at stream start so that jitter
+ * isn't measured across a restart, and optionally clear the histograms.
+ */
+void tegra_channel_reset_frame_stats(struct tegra_channel *chan,
+	bool histograms)
+{
+	struct tegra_channel_frame_stats *stats = &chan->frame_stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stats->lock, flags);
+
+	if (histograms) {
+		memset(stats->latency, 0, sizeof(stats->latency));
+		memset(stats->jitter, 0, sizeof(stats->jitter));
+		stats->frames = 0;
+	}
+
+	stats->last_sof_ns = 0;
+	stats->last_interval_ns = 0;
+
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+EXPORT_SYMBOL(tegra_channel_reset_frame_stats);
+
+/*
+ * Lockless, always-on event log: writers claim a slot with one atomic
+ * increment and publish it by writing the sequence number last; readers
+ * skip entries whose sequence does not match the slot they expect.
+ */
+void tegra_channel_log_event(struct tegra_channel *chan, u8 type, u8 port,
+	u32 data, u64 tstamp)
+{
+	struct tegra_channel_event *ev;
+	unsigned int seq;
+
+	if (unlikely(chan->events.ring == NULL))
+		return;
+
+	seq = (unsigned int)atomic_inc_return(&chan->events.head);
+	ev = &chan->events.ring[seq & (TEGRA_CHANNEL_EVENTS - 1)];
+
+	ev->tstamp = tstamp;
+	ev->type = type;
+	ev->port = port;
+	ev->data = data;
+	smp_wmb();
+	WRITE_ONCE(ev->seq, (u16)seq);
+}
+EXPORT_SYMBOL(tegra_channel_log_event);
+
+static const char * const tegra_channel_event_names[] = {
+	[TEGRA_CHANNEL_EVENT_NONE] = "none",
+	[TEGRA_CHANNEL_EVENT_ENQUEUE] = "enqueue",
+	[TEGRA_CHANNEL_EVENT_DEQUEUE] = "dequeue",
+	[TEGRA_CHANNEL_EVENT_SOF] = "sof",
+	[TEGRA_CHANNEL_EVENT_EOF] = "eof",
+	[TEGRA_CHANNEL_EVENT_REQ_ERROR] = "req_error",
+	[TEGRA_CHANNEL_EVENT_FRAME_ERROR] = "frame_error",
+};
+
+static int tegra_channel_events_show(struct seq_file *s, void *unused)
+{
+	struct tegra_channel *chan = s->private;
+	const struct tegra_channel_event *ev;
+	struct tegra_channel_event copy;
+	unsigned int head, seq;
+	const char *name;
+
+	if (chan->events.ring == NULL)
+		return 0;
+
+	head = (unsigned int)atomic_read(&chan->events.head);
+	seq = head > TEGRA_CHANNEL_EVENTS ? head - TEGRA_CHANNEL_EVENTS + 1 : 1;
+
+	for (; seq != head + 1; seq++) {
+		ev = &chan->events.ring[seq & (TEGRA_CHANNEL_EVENTS - 1)];
+		if (READ_ONCE(ev->seq) != (u16)seq)
+			continue;
+		smp_rmb();
+		copy = *ev;
+		smp_rmb();
+		/* overwritten while copying */
+		if (READ_ONCE(ev->seq) != (u16)seq)
+			continue;
+
+		name = copy.type < ARRAY_SIZE(tegra_channel_event_names) ?
+			tegra_channel_event_names[copy.type] : "unknown";
+		seq_printf(s, "%10u %20llu %-12s port%u %d\n", seq,
+			   copy.tstamp, name, copy.port, (int)copy.data);
+	}
+
+	return 0;
+}
+
+static int tegra_channel_events_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tegra_channel_events_show, inode->i_private);
+}
+
+static const struct file_operations tegra_channel_events_fops = {
+	.open = tegra_channel_events_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * The debugfs file proxy does not forward mmap, so "events_raw" is created
+ * unproxied and pins the dentry itself while mapping.
+ */
+static int tegra_channel_events_raw_mmap(struct file *file,
+	struct vm_area_struct *vma)
+{
+	struct tegra_channel *chan = file->private_data;
+	int err;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	err = debugfs_file_get(file->f_path.dentry);
+	if (err)
+		return err;
+
+	if (chan->events.ring == NULL) {
+		err = -ENODEV;
+		goto put;
+	}
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	err = remap_vmalloc_range(vma, chan->events.ring, vma->vm_pgoff);
+put:
+	debugfs_file_put(file->f_path.dentry);
+	return err;
+}
+
+static const struct file_operations tegra_channel_events_raw_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.mmap = tegra_channel_events_raw_mmap,
+};
+
+static int tegra_channel_frame_stats_show(struct seq_file *s, void *unused)
+{
+	struct tegra_channel *chan = s->private;
+	struct tegra_channel_frame_stats *stats = &chan->frame_stats;
+	u32 latency[TEGRA_CHANNEL_FRAME_BUCKETS];
+	u32 jitter[TEGRA_CHANNEL_FRAME_BUCKETS];
+	unsigned long flags;
+	unsigned int i;
+	u64 frames;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	memcpy(latency, stats->latency, sizeof(latency));
+	memcpy(jitter, stats->jitter, sizeof(jitter));
+	frames = stats->frames;
+	spin_unlock_irqrestore(&stats->lock, flags);
+
+	seq_printf(s, "frames: %llu\n", frames);
+	seq_puts(s, "     <=us  sof_to_done       jitter\n");
+
+	for (i = 0; i < TEGRA_CHANNEL_FRAME_BUCKETS; i++) {
+		if (!latency[i] && !jitter[i])
+			continue;
+
+		if (i == TEGRA_CHANNEL_FRAME_BUCKETS - 1)
+			seq_printf(s, "%9s %12u %12u\n", "inf",
+				   latency[i], jitter[i]);
+		else
+			seq_printf(s, "%9llu %12u %12u\n",
+				   (1ULL << i) - 1, latency[i], jitter[i]);
+	}
+
+	return 0;
+}
+
+static int tegra_channel_frame_stats_open(struct inode *inode,
+	struct file *file)
+{
+	return single_open(file, tegra_channel_frame_stats_show,
+			   inode->i_private);
+}
+
+static ssize_t tegra_channel_frame_stats_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+
+	/* any write resets the histograms */
+	tegra_channel_reset_frame_stats(s->private, true);
+
+	return count;
+}
+
+static const struct file_operations tegra_channel_frame_stats_fops = {
+	.open = tegra_channel_frame_stats_open,
+	.read = seq_read,
+	.write = tegra_channel_frame_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void tegra_channel_debugfs_init(struct tegra_channel *chan)
+{
+	char name[16];
+
+	if (!chan->vi->debugfs)
+		return;
+
+	snprintf(name, sizeof(name), "ch%u", chan->id);
+	chan->debugfs = debugfs_create_dir(name, chan->vi->debugfs);
+
+	debugfs_create_file("frame_stats", 0644, chan->debugfs, chan,
+			    &tegra_channel_frame_stats_fops);
+	debugfs_create_file("events", 0444, chan->debugfs, chan,
+			    &tegra_channel_events_fops);
+	debugfs_create_file_unsafe("events_raw", 0444, chan->debugfs, chan,
+			    &tegra_channel_events_raw_fops);
+}
+
 int tegra_channel_cleanup_video(struct tegra_channel *chan)
 {
 	v4l2_ctrl_handler_free(&chan->ctrl_handler);
@@ -2728,6 +3040,12 @@ int tegra_channel_cleanup(struct tegra_channel *chan)
 
 	tegra_camera_device_unregister(chan);
 
+	debugfs_remove_recursive(chan->debugfs);
+	chan->debugfs = NULL;
+
+	vfree(chan->events.ring);
+	chan->events.ring = NULL;
+
 	return 0;
 }
 EXPORT_SYMBOL(tegra_channel_cleanup);
@@ -4,6 +4,7 @@
  * Tegra Video Input device common APIs
  */
 
+#include <linux/debugfs.h>
 #include <linux/init.h>
 #include <linux/export.h>
 #include <linux/of.h>
@@ -308,6 +309,8 @@ static int tegra_vi_media_controller_init_int(struct tegra_mc_vi *mc_vi,
 	mc_vi->dev = &pdev->dev;
 	INIT_LIST_HEAD(&mc_vi->vi_chans);
 	mutex_init(&mc_vi->mipical_lock);
+	INIT_LIST_HEAD(&mc_vi->capture_groups);
+	mutex_init(&mc_vi->capture_groups_lock);
 
 	err = vi_parse_dt(mc_vi, pdev);
 	if (err)
@@ -319,6 +322,10 @@ static int tegra_vi_media_controller_init_int(struct tegra_mc_vi *mc_vi,
 	if (err < 0)
 		goto mc_init_fail;
 
+	mc_vi->debugfs = debugfs_create_dir("tegra-vi", NULL);
+	if (IS_ERR(mc_vi->debugfs))
+		mc_vi->debugfs = NULL;
+
 	/*
 	 * if there is no vi channels listed in DT,
 	 * no need to init the channel and graph
@@ -343,6 +350,8 @@ static int tegra_vi_media_controller_init_int(struct tegra_mc_vi *mc_vi,
 graph_error:
 	tegra_vi_channels_cleanup(mc_vi);
 channels_error:
+	debugfs_remove_recursive(mc_vi->debugfs);
+	mc_vi->debugfs = NULL;
 	tegra_vi_v4l2_cleanup(mc_vi);
 mc_init_fail:
 	dev_err(&pdev->dev, "%s: failed\n", __func__);
@@ -375,6 +384,8 @@ void tegra_vi_media_controller_cleanup(struct tegra_mc_vi *mc_vi)
 	tegra_vi_channels_unregister(mc_vi);
 	tegra_vi_graph_cleanup(mc_vi);
 	tegra_vi_channels_cleanup(mc_vi);
+	debugfs_remove_recursive(mc_vi->debugfs);
+	mc_vi->debugfs = NULL;
 	tegra_vi_v4l2_cleanup(mc_vi);
 	tegra_mcvi = NULL;
 }
@@ -15,6 +15,7 @@
 #include <linux/freezer.h>
 #include <linux/fs.h>
 #include <linux/kthread.h>
+#include <linux/module.h>
 #include <linux/nvhost.h>
 #include <linux/pm_runtime.h>
 #include <linux/semaphore.h>
@@ -26,6 +27,8 @@
 #include <media/tegra_camera_platform.h>
 #include <soc/tegra/camrtc-capture.h>
 #include <trace/events/camera_common.h>
+#include <trace/events/tegra_frame.h>
+#include <asm/arch_timer.h>
 
 #include "vi5_fops.h"
 #include "vi5_formats.h"
@@ -41,6 +44,21 @@
 
 #define CAPTURE_TIMEOUT_MS	2500
 
+/* RCE reports frame timestamps in ns of the 31.25 MHz TSC */
+#define VI5_TSC_NS_PER_TICK	32
+
+static bool event_completion;
+module_param(event_completion, bool, 0644);
+MODULE_PARM_DESC(event_completion,
+	"Complete capture buffers from the capture status callback instead of a per-channel dequeue thread");
+
+static unsigned int capture_queue_depth;
+module_param(capture_queue_depth, uint, 0644);
+MODULE_PARM_DESC(capture_queue_depth,
+	"Minimum number of capture descriptors queued to RTCPU per channel (0 = number of requested buffers, max 240)");
+
+static void vi5_capture_status_notify(void *data);
+
 static const struct vi_capture_setup default_setup = {
 	.channel_flags = 0
 	| CAPTURE_CHANNEL_FLAG_VIDEO
@@ -289,6 +307,12 @@ static int vi5_channel_setup_queue(struct tegra_channel *chan,
 {
 	int ret = 0;
 
+	/*
+	 * The RTCPU descriptor ring is as deep as the buffer queue. Allow
+	 * it to be deepened beyond what userspace asked for so that brief
+	 * userspace stalls at high frame rates don't starve the capture.
+	 */
+	*nbuffers = max(*nbuffers, capture_queue_depth);
 	*nbuffers = clamp(*nbuffers, CAPTURE_MIN_BUFFERS, CAPTURE_MAX_BUFFERS);
 
 	ret = tegra_channel_alloc_buffer_queue(chan, *nbuffers);
@@ -381,6 +405,10 @@ static int tegra_channel_capture_setup(struct tegra_channel *chan, unsigned int
 		return err;
 	}
 
+	if (chan->event_completion)
+		vi_capture_set_status_notify(chan->tegra_vi_channel[vi_port],
+			vi5_capture_status_notify, chan);
+
 	return 0;
 }
 
@@ -477,10 +505,17 @@ static void vi5_capture_enqueue(struct tegra_channel *chan,
 		err = vi_capture_request(chan->tegra_vi_channel[vi_port], &request[vi_port]);
 
 		if (err) {
+			tegra_channel_log_event(chan,
+				TEGRA_CHANNEL_EVENT_REQ_ERROR, vi_port,
+				(u32)err, __arch_counter_get_cntvct());
 			dev_err(vi->dev, "uncorr_err: request dispatch err %d\n", err);
 			goto uncorr_err;
 		}
 
+		tegra_channel_log_event(chan, TEGRA_CHANNEL_EVENT_ENQUEUE,
+			vi_port, chan->capture_descr_index,
+			__arch_counter_get_cntvct());
+
 		spin_lock_irqsave(&chan->capture_state_lock, flags);
 		if (chan->capture_state != CAPTURE_ERROR) {
 			chan->capture_state = CAPTURE_GOOD;
@@ -504,6 +539,9 @@ uncorr_err:
 	spin_lock_irqsave(&chan->capture_state_lock, flags);
 	chan->capture_state = CAPTURE_ERROR;
 	spin_unlock_irqrestore(&chan->capture_state_lock, flags);
+
+	if (chan->event_completion)
+		schedule_work(&chan->error_work);
 }
 
 static void vi5_capture_dequeue(struct tegra_channel *chan,
@@ -519,6 +557,7 @@ static void vi5_capture_dequeue(struct tegra_channel *chan,
 	int timeout_ms = CAPTURE_TIMEOUT_MS;
 	struct timespec64 ts;
 	struct capture_descriptor *descr = NULL;
+	u64 buf_id;
 
 	for (vi_port = 0; vi_port < chan->valid_ports; vi_port++) {
 		descr = &chan->request[vi_port][buf->capture_descr_index[vi_port]];
@@ -530,6 +569,9 @@ static void vi5_capture_dequeue(struct tegra_channel *chan,
 		timeout_ms = chan->capture_timeout_ms;
 		err = vi_capture_status(chan->tegra_vi_channel[vi_port], timeout_ms);
 		if (err) {
+			tegra_channel_log_event(chan,
+				TEGRA_CHANNEL_EVENT_REQ_ERROR, vi_port,
+				(u32)err, __arch_counter_get_cntvct());
 			if (err == -ETIMEDOUT) {
 				if (timeout_ms < 0) {
 					spin_lock_irqsave(&chan->capture_state_lock, flags);
@@ -546,7 +588,20 @@ static void vi5_capture_dequeue(struct tegra_channel *chan,
 				dev_err(vi->dev, "uncorr_err: request err %d\n", err);
 			}
 			goto uncorr_err;
-		} else if (descr->status.status != CAPTURE_STATUS_SUCCESS) {
+		}
+
+		tegra_channel_log_event(chan, TEGRA_CHANNEL_EVENT_SOF, vi_port,
+			descr->status.frame_id,
+			descr->status.sof_timestamp / VI5_TSC_NS_PER_TICK);
+		tegra_channel_log_event(chan, TEGRA_CHANNEL_EVENT_EOF, vi_port,
+			descr->status.frame_id,
+			descr->status.eof_timestamp / VI5_TSC_NS_PER_TICK);
+
+		if (descr->status.status != CAPTURE_STATUS_SUCCESS) {
+			tegra_channel_log_event(chan,
+				TEGRA_CHANNEL_EVENT_FRAME_ERROR, vi_port,
+				descr->status.err_data,
+				__arch_counter_get_cntvct());
 			if ((descr->status.flags
 					& CAPTURE_STATUS_FLAG_CHANNEL_IN_ERROR) != 0) {
 				chan->queue_error = true;
@@ -577,19 +632,34 @@ static void vi5_capture_dequeue(struct tegra_channel *chan,
 	}
 
 	wake_up_interruptible(&chan->start_wait);
+	tegra_channel_log_event(chan, TEGRA_CHANNEL_EVENT_DEQUEUE, 0,
+		descr->status.frame_id, __arch_counter_get_cntvct());
 	/* Read SOF from capture descriptor */
 	ts = ns_to_timespec64((s64)descr->status.sof_timestamp);
 	trace_tegra_channel_capture_frame("sof", &ts);
 	vb->vb2_buf.timestamp = descr->status.sof_timestamp;
 
-	if (frame_err)
+	if (frame_err) {
 		buf->vb2_state = VB2_BUF_STATE_ERROR;
-	else
+	} else {
 		buf->vb2_state = VB2_BUF_STATE_DONE;
+		tegra_channel_record_frame(chan, descr->status.sof_timestamp);
+	}
+	tegra_capture_group_frame(chan, descr->status.frame_id,
+			descr->status.sof_timestamp, frame_err);
 	/* Read EOF from capture descriptor */
 	ts = ns_to_timespec64((s64)descr->status.eof_timestamp);
 	trace_tegra_channel_capture_frame("eof", &ts);
 
+	/* Frames enter the pipeline here, buffers of later engines follow */
+	buf_id = tegra_frame_dmabuf_id(vb->vb2_buf.planes[0].dbuf);
+	trace_tegra_frame_start(TEGRA_FRAME_ENGINE_VI, chan->vi_channel_id[0],
+		buf_id, descr->status.frame_id, 0, 0,
+		descr->status.sof_timestamp);
+	trace_tegra_frame_done(TEGRA_FRAME_ENGINE_VI, chan->vi_channel_id[0],
+		buf_id, descr->status.frame_id, 0, 0,
+		descr->status.eof_timestamp);
+
 	goto rel_buf;
 
 uncorr_err:
@@ -614,6 +684,10 @@ static int vi5_channel_error_recover(struct tegra_channel *chan,
 
 	/* stop vi channel */
 	for (vi_port = 0; vi_port < chan->valid_ports; vi_port++) {
+		if (chan->event_completion)
+			vi_capture_set_status_notify(
+				chan->tegra_vi_channel[vi_port], NULL, NULL);
+
 		err = vi_capture_release(chan->tegra_vi_channel[vi_port],
 			CAPTURE_CHANNEL_RESET_FLAG_IMMEDIATE);
 		if (err) {
@@ -777,6 +851,84 @@ static int tegra_channel_kthread_capture_dequeue(void *data)
 	return 0;
 }
 
+/*
+ * Event-driven completion: called from the capture IVC status callback of
+ * either gang port. Completes buffers at the head of the dequeue list as
+ * long as all of their ports have reported status, so a frame costs no
+ * thread wakeup between the RCE status indication and vb2_buffer_done().
+ */
+static void vi5_capture_status_notify(void *data)
+{
+	struct tegra_channel *chan = data;
+	struct tegra_channel_buffer *buf;
+	unsigned int vi_port;
+	bool error = false;
+	unsigned long flags;
+
+	mutex_lock(&chan->event_lock);
+
+	while (chan->event_completion && !chan->event_paused) {
+		spin_lock(&chan->dequeue_lock);
+		buf = list_first_entry_or_null(&chan->dequeue,
+			struct tegra_channel_buffer, queue);
+		spin_unlock(&chan->dequeue_lock);
+
+		if (!buf)
+			break;
+
+		for (vi_port = 0; vi_port < chan->valid_ports; vi_port++)
+			if (!vi_capture_status_ready(chan->tegra_vi_channel[vi_port]))
+				goto unlock;
+
+		buf = dequeue_dequeue_buffer(chan);
+		if (!buf)
+			break;
+
+		vi5_capture_dequeue(chan, buf);
+
+		spin_lock_irqsave(&chan->capture_state_lock, flags);
+		error = (chan->capture_state == CAPTURE_ERROR);
+		spin_unlock_irqrestore(&chan->capture_state_lock, flags);
+
+		if (error)
+			break;
+	}
+
+unlock:
+	mutex_unlock(&chan->event_lock);
+
+	if (error)
+		schedule_work(&chan->error_work);
+}
+
+/*
+ * Error recovery for event-driven completion. The recovery path releases
+ * and re-opens the VI channels, which needs the capture IVC callbacks to
+ * make progress, so only pause completion rather than hold event_lock.
+ */
+static void vi5_capture_error_work(struct work_struct *work)
+{
+	struct tegra_channel *chan =
+		container_of(work, struct tegra_channel, error_work);
+	int err;
+
+	mutex_lock(&chan->event_lock);
+	chan->event_paused = true;
+	mutex_unlock(&chan->event_lock);
+
+	err = tegra_channel_error_recover(chan, false);
+	if (err) {
+		dev_err(chan->vi->dev, "fatal: error recovery failed\n");
+		return;
+	}
+
+	mutex_lock(&chan->event_lock);
+	chan->event_paused = false;
+	mutex_unlock(&chan->event_lock);
+
+	wake_up_interruptible(&chan->start_wait);
+}
+
 static int vi5_channel_start_kthreads(struct tegra_channel *chan)
 {
 	int err = 0;
@@ -796,6 +948,10 @@ static int vi5_channel_start_kthreads(struct tegra_channel *chan)
 		goto done;
 	}
 
+	/* Buffers are completed from the capture status callback instead */
+	if (chan->event_completion)
+		goto done;
+
 	/* Start the kthread for capture dequeue */
 	if (chan->kthread_capture_dequeue) {
 		dev_err(chan->vi->dev, "dequeue kthread already initialized\n");
@@ -817,8 +973,24 @@ done:
 
 static void vi5_channel_stop_kthreads(struct tegra_channel *chan)
 {
+	unsigned int vi_port;
+
 	mutex_lock(&chan->stop_kthread_lock);
 
+	if (chan->event_completion) {
+		for (vi_port = 0; vi_port < chan->valid_ports; vi_port++)
+			if (chan->tegra_vi_channel[vi_port])
+				vi_capture_set_status_notify(
+					chan->tegra_vi_channel[vi_port], NULL, NULL);
+
+		cancel_work_sync(&chan->error_work);
+
+		mutex_lock(&chan->event_lock);
+		chan->event_completion = false;
+		chan->event_paused = false;
+		mutex_unlock(&chan->event_lock);
+	}
+
 	/* Stop the kthread for capture enqueue */
 	if (chan->kthread_capture_start) {
 		kthread_stop(chan->kthread_capture_start);
@@ -860,6 +1032,11 @@ static int vi5_channel_start_streaming(struct vb2_queue *vq, u32 count)
 
 	/* Skip in bypass mode */
 	if (!chan->bypass) {
+		chan->event_completion = event_completion;
+		chan->event_paused = false;
+		if (chan->event_completion)
+			INIT_WORK(&chan->error_work, vi5_capture_error_work);
+
 		for (vi_port = 0; vi_port < chan->valid_ports; vi_port++) {
 			int err = vi5_channel_open(chan, vi_port);
 
@@ -941,6 +1118,7 @@ static int vi5_channel_start_streaming(struct vb2_queue *vq, u32 count)
 		}
 		chan->sequence = 0;
 		tegra_channel_init_ring_buffer(chan);
+		tegra_channel_reset_frame_stats(chan, false);
 
 		ret = vi5_channel_start_kthreads(chan);
 		if (ret != 0)
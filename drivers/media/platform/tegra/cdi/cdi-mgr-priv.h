@@ -39,6 +39,24 @@ struct cam_gpio_config {
 	ktime_t timeout;
 };
 
+enum cdi_mgr_step {
+	CDI_MGR_STEP_PROBE = 0,
+	CDI_MGR_STEP_DEV_INS,
+	CDI_MGR_STEP_PWR_UP,
+	CDI_MGR_STEP_PWR_DN,
+	CDI_MGR_STEP_DES_PWR_ON,
+	CDI_MGR_STEP_DES_PWR_OFF,
+	CDI_MGR_STEP_COUNT
+};
+
+/* durations of the power sequencing steps, in microseconds */
+struct cdi_mgr_step_stats {
+	u64 count;
+	u64 last_us;
+	u64 max_us;
+	u64 total_us;
+};
+
 struct cam_gpio_event_queue {
 	wait_queue_head_t wait;
 	struct cdi_mgr_gpio_intr events[CDI_MGR_GPIO_EVENT_QUEUE_SIZE];
@@ -79,6 +97,7 @@ struct cdi_mgr_priv {
 	u32 cim_frsync[3]; /* FRSYNC source selection for each muxer */
 	u8 pre_suspend_tca9539_regvals[CDI_MGR_TCA9539_REGISTER_COUNT];
 	bool isP3898;
+	struct cdi_mgr_step_stats steps[CDI_MGR_STEP_COUNT];
 };
 
 int cdi_mgr_power_up(struct cdi_mgr_priv *cdi_mgr, unsigned long arg);
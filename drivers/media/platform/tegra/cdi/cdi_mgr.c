@@ -31,6 +31,8 @@
 #include <media/cdi-mgr.h>
 #include <linux/gpio/consumer.h>
 #include <linux/semaphore.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include <asm/barrier.h>
 
@@ -47,7 +49,30 @@
 
 #define TIMEOUT_US 2000000 /* 2 seconds */
 
-static struct semaphore tca9539_sem;
+/*
+ * The TCA9539 expander is shared by all the managers of a CIM, so the
+ * semaphore must exist before any of them probes.
+ */
+#if defined(NV_DEFINE_SEMAPHORE_HAS_NUMBER_ARG) /* Linux v6.4 */
+static DEFINE_SEMAPHORE(tca9539_sem, 1);
+#else
+static DEFINE_SEMAPHORE(tca9539_sem);
+#endif
+
+static void cdi_mgr_step_done(struct cdi_mgr_priv *cdi_mgr,
+	enum cdi_mgr_step step, ktime_t start)
+{
+	struct cdi_mgr_step_stats *stats = &cdi_mgr->steps[step];
+	u64 us = ktime_us_delta(ktime_get(), start);
+	unsigned long flags;
+
+	spin_lock_irqsave(&cdi_mgr->spinlock, flags);
+	stats->count++;
+	stats->last_us = us;
+	stats->max_us = max(stats->max_us, us);
+	stats->total_us += us;
+	spin_unlock_irqrestore(&cdi_mgr->spinlock, flags);
+}
 
 /* CDI Dev Debugfs functions
  *
@@ -59,6 +84,7 @@ static struct semaphore tca9539_sem;
  *    - pwr_on_set
  *    - pwr_off_get
  *    - pwr_off_set
+ *    - pwr_timing_show
  */
 static int cdi_mgr_status_show(struct seq_file *s, void *data)
 {
@@ -151,6 +177,38 @@ static int pwr_off_set(void *data, u64 val)
 
 DEFINE_SIMPLE_ATTRIBUTE(pwr_off_fops, pwr_off_get, pwr_off_set, "0x%02llx\n");
 
+static int pwr_timing_show(struct seq_file *s, void *data)
+{
+	static const char * const names[CDI_MGR_STEP_COUNT] = {
+		[CDI_MGR_STEP_PROBE] = "probe",
+		[CDI_MGR_STEP_DEV_INS] = "dev-ins",
+		[CDI_MGR_STEP_PWR_UP] = "pwr-up",
+		[CDI_MGR_STEP_PWR_DN] = "pwr-dn",
+		[CDI_MGR_STEP_DES_PWR_ON] = "des-pwr-on",
+		[CDI_MGR_STEP_DES_PWR_OFF] = "des-pwr-off",
+	};
+	struct cdi_mgr_priv *cdi_mgr = s->private;
+	struct cdi_mgr_step_stats stats[CDI_MGR_STEP_COUNT];
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&cdi_mgr->spinlock, flags);
+	memcpy(stats, cdi_mgr->steps, sizeof(stats));
+	spin_unlock_irqrestore(&cdi_mgr->spinlock, flags);
+
+	seq_printf(s, "%-12s %6s %10s %10s %10s\n",
+		"step", "count", "last_us", "max_us", "avg_us");
+	for (i = 0; i < CDI_MGR_STEP_COUNT; i++)
+		seq_printf(s, "%-12s %6llu %10llu %10llu %10llu\n", names[i],
+			stats[i].count, stats[i].last_us, stats[i].max_us,
+			stats[i].count ?
+			div64_u64(stats[i].total_us, stats[i].count) : 0);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(pwr_timing);
+
 static int tca9539_wr(
 	struct cdi_mgr_priv *info, unsigned int offset, u8 val)
 {
@@ -207,6 +265,11 @@ int cdi_mgr_debugfs_init(struct cdi_mgr_priv *cdi_mgr)
 	if (!d)
 		goto debugfs_init_err;
 
+	d = debugfs_create_file("pwr-timing", 0444, cdi_mgr->d_entry,
+		(void *)cdi_mgr, &pwr_timing_fops);
+	if (!d)
+		goto debugfs_init_err;
+
 	return 0;
 
 debugfs_init_err:
@@ -685,6 +748,7 @@ static int cdi_mgr_get_pwr_ctrl_info(struct cdi_mgr_priv *cdi_mgr,
 int cdi_mgr_power_up(struct cdi_mgr_priv *cdi_mgr, unsigned long arg)
 {
 	struct cdi_mgr_platform_data *pd = cdi_mgr->pdata;
+	ktime_t start = ktime_get();
 	int i;
 	u32 pwr_gpio;
 
@@ -704,7 +768,7 @@ int cdi_mgr_power_up(struct cdi_mgr_priv *cdi_mgr, unsigned long arg)
 		gpio_set_value(pd->pwr_gpios[pwr_gpio],
 			PW_ON(pd->pwr_flags[pwr_gpio]));
 		cdi_mgr->pwr_state |= BIT(pwr_gpio);
-		return 0;
+		goto pwr_up_done;
 	}
 
 	for (i = 0; i < pd->num_pwr_gpios; i++) {
@@ -714,11 +778,14 @@ int cdi_mgr_power_up(struct cdi_mgr_priv *cdi_mgr, unsigned long arg)
 		/* SW WAR for platform issue */
 		/* Add 5ms delay between two gpio toggles */
 		/* Bug 4125801*/
+		/* sleep so that the other managers can sequence meanwhile */
 		if (cdi_mgr->isP3898)
-			mdelay(5);
+			usleep_range(5000, 5100);
 		cdi_mgr->pwr_state |= BIT(i);
 	}
 
+pwr_up_done:
+	cdi_mgr_step_done(cdi_mgr, CDI_MGR_STEP_PWR_UP, start);
 pwr_up_end:
 	return 0;
 }
@@ -726,6 +793,7 @@ pwr_up_end:
 int cdi_mgr_power_down(struct cdi_mgr_priv *cdi_mgr, unsigned long arg)
 {
 	struct cdi_mgr_platform_data *pd = cdi_mgr->pdata;
+	ktime_t start = ktime_get();
 	int i;
 	u32 pwr_gpio;
 
@@ -746,7 +814,7 @@ int cdi_mgr_power_down(struct cdi_mgr_priv *cdi_mgr, unsigned long arg)
 		gpio_set_value(pd->pwr_gpios[pwr_gpio],
 				PW_OFF(pd->pwr_flags[pwr_gpio]));
 		cdi_mgr->pwr_state &= ~BIT(pwr_gpio);
-		return 0;
+		goto pwr_dn_done;
 	}
 
 	for (i = 0; i < pd->num_pwr_gpios; i++) {
@@ -755,8 +823,10 @@ int cdi_mgr_power_down(struct cdi_mgr_priv *cdi_mgr, unsigned long arg)
 		gpio_set_value(pd->pwr_gpios[i], PW_OFF(pd->pwr_flags[i]));
 		cdi_mgr->pwr_state &= ~BIT(i);
 	}
-	mdelay(7);
+	usleep_range(7000, 7100);
 
+pwr_dn_done:
+	cdi_mgr_step_done(cdi_mgr, CDI_MGR_STEP_PWR_DN, start);
 pwr_dn_end:
 	return 0;
 }
@@ -1027,6 +1097,7 @@ static int cdi_mgr_gpio_intr_wait_abort(struct cdi_mgr_priv *cdi_mgr)
 static int cdi_mgr_des_power(
 	struct cdi_mgr_priv *cdi_mgr, bool enable)
 {
+	ktime_t start = ktime_get();
 	u8 val;
 
 	/* if runtime_pwrctrl_off is not true, power on all here */
@@ -1067,6 +1138,9 @@ static int cdi_mgr_des_power(
 		up(&tca9539_sem);
 	}
 
+	cdi_mgr_step_done(cdi_mgr, enable ? CDI_MGR_STEP_DES_PWR_ON :
+			  CDI_MGR_STEP_DES_PWR_OFF, start);
+
 	return 0;
 }
 
@@ -1292,6 +1366,7 @@ static void cdi_mgr_dev_ins(struct work_struct *work)
 	struct device_node *subdev;
 	struct cdi_mgr_new_dev d_cfg = {.drv_name = "cdi-dev"};
 	const char *sname;
+	ktime_t start = ktime_get();
 	u32 val;
 	int err = 0;
 
@@ -1322,6 +1397,8 @@ static void cdi_mgr_dev_ins(struct work_struct *work)
 
 		__cdi_create_dev(cdi_mgr, &d_cfg);
 	}
+
+	cdi_mgr_step_done(cdi_mgr, CDI_MGR_STEP_DEV_INS, start);
 }
 
 static int cdi_mgr_of_get_grp_gpio(
@@ -1744,6 +1821,76 @@ static void cdi_mgr_get_cim_ver(struct device *dev, struct cdi_mgr_priv *cdi_mgr
 	}
 }
 
+static int cdi_mgr_tca9539_init(struct device *dev,
+	struct cdi_mgr_priv *cdi_mgr)
+{
+	int err = 0;
+
+	/* Set the init values */
+	/* TODO : read the array to initialize */
+	/* the registers in TCA9539 */
+	/* Use the IO expander to control PWDN signals */
+	if (cdi_mgr->cim_ver == 1U) { /* P3714 A01 */
+		err = tca9539_wr(cdi_mgr, 0x6, 0x0E);
+		if (err != 0) {
+			dev_err(dev,
+				"%s: ERR %d: TCA9539: Failed to select PWDN signal source\n",
+				__func__, err);
+			return err;
+		}
+		/* Output low for AGGA/B/C/D_PWRDN */
+		err = tca9539_wr(cdi_mgr, 0x2, 0x0E);
+		if (err != 0) {
+			dev_err(dev,
+				"%s: ERR %d: TCA9539: Failed to set the output level\n",
+				__func__, err);
+			return err;
+		}
+	} else if (cdi_mgr->cim_ver == 2U) { /* P3714 A02 */
+		err = tca9539_wr(cdi_mgr, 0x6, 0xC0);
+		if (err != 0) {
+			dev_err(dev,
+				"%s: ERR %d: TCA9539: Failed to select FS selection signal source\n",
+				__func__, err);
+			return err;
+		}
+		err = tca9539_wr(cdi_mgr, 0x7, 0x70);
+		if (err != 0) {
+			dev_err(dev,
+				"%s: ERR %d: TCA9539: Failed to select PWDN signal source\n",
+				__func__, err);
+			return err;
+		}
+
+		/* Configure FRSYNC logic */
+		dev_info(dev,
+			"FRSYNC source: %d %d %d\n",
+			cdi_mgr->cim_frsync[0],
+			cdi_mgr->cim_frsync[1],
+			cdi_mgr->cim_frsync[2]);
+		err = tca9539_wr(cdi_mgr, 0x2,
+			(cdi_mgr->cim_frsync[2] << 4) |
+			(cdi_mgr->cim_frsync[1] << 2) |
+			(cdi_mgr->cim_frsync[0]));
+		if (err < 0) {
+			dev_err(dev,
+				"%s: ERR %d: TCA9539: Failed to set FRSYNC control logic\n",
+				__func__, err);
+			return err;
+		}
+		/* Output low for AGGA/B/C/D_PWRDN */
+		err = tca9539_wr(cdi_mgr, 0x3, 0x00);
+		if (err != 0) {
+			dev_err(dev,
+				"%s: ERR %d: TCA9539: Failed to set the output level\n",
+				__func__, err);
+			return err;
+		}
+	}
+
+	return err;
+}
+
 static int cdi_mgr_probe(struct platform_device *pdev)
 {
 	int err = 0;
@@ -1755,6 +1902,7 @@ static int cdi_mgr_probe(struct platform_device *pdev)
 	struct device_node *child_tca9539 = NULL;
 	struct device_node *root_node = NULL;
 	const char *model;
+	ktime_t start = ktime_get();
 
 	dev_info(&pdev->dev, "%sing...\n", __func__);
 
@@ -1984,69 +2132,29 @@ static int cdi_mgr_probe(struct platform_device *pdev)
 				goto err_probe;
 			}
 
-			sema_init(&tca9539_sem, 1);
-
-			/* Set the init values */
-			/* TODO : read the array to initialize */
-			/* the registers in TCA9539 */
-			/* Use the IO expander to control PWDN signals */
-			if (cdi_mgr->cim_ver == 1U) { /* P3714 A01 */
-				if (tca9539_wr(cdi_mgr, 0x6, 0x0E) != 0) {
-					dev_err(&pdev->dev,
-							"%s: ERR %d: TCA9539: Failed to select PWDN signal source\n",
-							__func__, err);
-					goto err_probe;
-				}
-				/* Output low for AGGA/B/C/D_PWRDN */
-				if (tca9539_wr(cdi_mgr, 0x2, 0x0E) != 0) {
-					dev_err(&pdev->dev,
-							"%s: ERR %d: TCA9539: Failed to set the output level\n",
-							__func__, err);
-					goto err_probe;
-				}
-			} else if (cdi_mgr->cim_ver == 2U) { /* P3714 A02 */
-				if (tca9539_wr(cdi_mgr, 0x6, 0xC0) != 0) {
-					dev_err(&pdev->dev,
-							"%s: ERR %d: TCA9539: Failed to select FS selection signal source\n",
-							__func__, err);
-					goto err_probe;
-				}
-				if (tca9539_wr(cdi_mgr, 0x7, 0x70) != 0) {
-					dev_err(&pdev->dev,
-							"%s: ERR %d: TCA9539: Failed to select PWDN signal source\n",
-							__func__, err);
-					goto err_probe;
-				}
-
-				/* Configure FRSYNC logic */
-				dev_info(&pdev->dev,
-						"FRSYNC source: %d %d %d\n",
-						cdi_mgr->cim_frsync[0],
-						cdi_mgr->cim_frsync[1],
-						cdi_mgr->cim_frsync[2]);
-				if (tca9539_wr(cdi_mgr, 0x2,
-					(cdi_mgr->cim_frsync[2] << 4) |
-					(cdi_mgr->cim_frsync[1] << 2) |
-					(cdi_mgr->cim_frsync[0])) < 0) {
-					dev_err(&pdev->dev,
-							"%s: ERR %d: TCA9539: Failed to set FRSYNC control logic\n",
-							__func__, err);
-					goto err_probe;
-				}
-				/* Output low for AGGA/B/C/D_PWRDN */
-				if (tca9539_wr(cdi_mgr, 0x3, 0x00) != 0) {
-					dev_err(&pdev->dev,
-							"%s: ERR %d: TCA9539: Failed to set the output level\n",
-							__func__, err);
-					goto err_probe;
-				}
+			/*
+			 * Managers probe in parallel, keep the init writes
+			 * of the shared expander from interleaving.
+			 */
+			if (down_timeout(&tca9539_sem,
+				usecs_to_jiffies(TIMEOUT_US)) != 0) {
+				dev_err(&pdev->dev,
+					"%s: failed to wait for the semaphore\n",
+					__func__);
+				err = -ETIMEDOUT;
+				goto err_probe;
 			}
+			err = cdi_mgr_tca9539_init(&pdev->dev, cdi_mgr);
+			up(&tca9539_sem);
+			if (err)
+				goto err_probe;
 		}
 	}
 
 	cdi_mgr_debugfs_init(cdi_mgr);
 	INIT_WORK(&cdi_mgr->ins_work, cdi_mgr_dev_ins);
 	schedule_work(&cdi_mgr->ins_work);
+	cdi_mgr_step_done(cdi_mgr, CDI_MGR_STEP_PROBE, start);
 	return 0;
 
 err_probe:
@@ -2090,6 +2198,7 @@ static struct platform_driver cdi_mgr_driver = {
 		.owner = THIS_MODULE,
 		.of_match_table = of_match_ptr(cdi_mgr_of_match),
 		.pm = &cdi_mgr_pm_ops,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = cdi_mgr_probe,
 	.remove = cdi_mgr_remove,
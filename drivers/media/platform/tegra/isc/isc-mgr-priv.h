@@ -9,6 +9,22 @@
 #include <linux/cdev.h>
 #include <linux/version.h>
 
+enum isc_mgr_step {
+	ISC_MGR_STEP_PROBE = 0,
+	ISC_MGR_STEP_DEV_INS,
+	ISC_MGR_STEP_PWR_UP,
+	ISC_MGR_STEP_PWR_DN,
+	ISC_MGR_STEP_COUNT
+};
+
+/* durations of the power sequencing steps, in microseconds */
+struct isc_mgr_step_stats {
+	u64 count;
+	u64 last_us;
+	u64 max_us;
+	u64 total_us;
+};
+
 struct isc_mgr_priv {
 	struct device *pdev; /* parent device */
 	struct device *dev; /* this device */
@@ -33,6 +49,7 @@ struct isc_mgr_priv {
 	struct pwm_device *pwm;
 	wait_queue_head_t err_queue;
 	bool err_irq_recvd;
+	struct isc_mgr_step_stats steps[ISC_MGR_STEP_COUNT];
 };
 
 int isc_mgr_power_up(struct isc_mgr_priv *isc_mgr, unsigned long arg);
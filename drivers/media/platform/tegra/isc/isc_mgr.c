@@ -27,6 +27,8 @@
 #include <linux/debugfs.h>
 #include <linux/nospec.h>
 #include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <media/isc-dev.h>
 #include <media/isc-mgr.h>
 
@@ -40,6 +42,21 @@
 /* minor number range would be 0 to 127 */
 #define ISC_DEV_MAX	128
 
+static void isc_mgr_step_done(struct isc_mgr_priv *isc_mgr,
+	enum isc_mgr_step step, ktime_t start)
+{
+	struct isc_mgr_step_stats *stats = &isc_mgr->steps[step];
+	u64 us = ktime_us_delta(ktime_get(), start);
+	unsigned long flags;
+
+	spin_lock_irqsave(&isc_mgr->spinlock, flags);
+	stats->count++;
+	stats->last_us = us;
+	stats->max_us = max(stats->max_us, us);
+	stats->total_us += us;
+	spin_unlock_irqrestore(&isc_mgr->spinlock, flags);
+}
+
 /* ISC Dev Debugfs functions
  *
  *    - isc_mgr_debugfs_init
@@ -50,6 +67,7 @@
  *    - pwr_on_set
  *    - pwr_off_get
  *    - pwr_off_set
+ *    - pwr_timing_show
  */
 static int isc_mgr_status_show(struct seq_file *s, void *data)
 {
@@ -142,6 +160,36 @@ static int pwr_off_set(void *data, u64 val)
 
 DEFINE_SIMPLE_ATTRIBUTE(pwr_off_fops, pwr_off_get, pwr_off_set, "0x%02llx\n");
 
+static int pwr_timing_show(struct seq_file *s, void *data)
+{
+	static const char * const names[ISC_MGR_STEP_COUNT] = {
+		[ISC_MGR_STEP_PROBE] = "probe",
+		[ISC_MGR_STEP_DEV_INS] = "dev-ins",
+		[ISC_MGR_STEP_PWR_UP] = "pwr-up",
+		[ISC_MGR_STEP_PWR_DN] = "pwr-dn",
+	};
+	struct isc_mgr_priv *isc_mgr = s->private;
+	struct isc_mgr_step_stats stats[ISC_MGR_STEP_COUNT];
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&isc_mgr->spinlock, flags);
+	memcpy(stats, isc_mgr->steps, sizeof(stats));
+	spin_unlock_irqrestore(&isc_mgr->spinlock, flags);
+
+	seq_printf(s, "%-12s %6s %10s %10s %10s\n",
+		"step", "count", "last_us", "max_us", "avg_us");
+	for (i = 0; i < ISC_MGR_STEP_COUNT; i++)
+		seq_printf(s, "%-12s %6llu %10llu %10llu %10llu\n", names[i],
+			stats[i].count, stats[i].last_us, stats[i].max_us,
+			stats[i].count ?
+			div64_u64(stats[i].total_us, stats[i].count) : 0);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(pwr_timing);
+
 int isc_mgr_debugfs_init(struct isc_mgr_priv *isc_mgr)
 {
 	struct dentry *d;
@@ -169,6 +217,11 @@ int isc_mgr_debugfs_init(struct isc_mgr_priv *isc_mgr)
 	if (!d)
 		goto debugfs_init_err;
 
+	d = debugfs_create_file("pwr-timing", S_IRUGO, isc_mgr->d_entry,
+		(void *)isc_mgr, &pwr_timing_fops);
+	if (!d)
+		goto debugfs_init_err;
+
 	return 0;
 
 debugfs_init_err:
@@ -433,6 +486,7 @@ pwr_info_end:
 int isc_mgr_power_up(struct isc_mgr_priv *isc_mgr, unsigned long arg)
 {
 	struct isc_mgr_platform_data *pd = isc_mgr->pdata;
+	ktime_t start = ktime_get();
 	int i;
 	u32 pwr_gpio;
 
@@ -452,7 +506,7 @@ int isc_mgr_power_up(struct isc_mgr_priv *isc_mgr, unsigned long arg)
 		gpio_set_value(pd->pwr_gpios[pwr_gpio],
 			PW_ON(pd->pwr_flags[pwr_gpio]));
 		isc_mgr->pwr_state |= BIT(pwr_gpio);
-		return 0;
+		goto pwr_up_done;
 	}
 
 	for (i = 0; i < pd->num_pwr_gpios; i++) {
@@ -462,6 +516,8 @@ int isc_mgr_power_up(struct isc_mgr_priv *isc_mgr, unsigned long arg)
 		isc_mgr->pwr_state |= BIT(i);
 	}
 
+pwr_up_done:
+	isc_mgr_step_done(isc_mgr, ISC_MGR_STEP_PWR_UP, start);
 pwr_up_end:
 	return 0;
 }
@@ -469,6 +525,7 @@ pwr_up_end:
 int isc_mgr_power_down(struct isc_mgr_priv *isc_mgr, unsigned long arg)
 {
 	struct isc_mgr_platform_data *pd = isc_mgr->pdata;
+	ktime_t start = ktime_get();
 	int i;
 	u32 pwr_gpio;
 
@@ -489,7 +546,7 @@ int isc_mgr_power_down(struct isc_mgr_priv *isc_mgr, unsigned long arg)
 		gpio_set_value(pd->pwr_gpios[pwr_gpio],
 				PW_OFF(pd->pwr_flags[pwr_gpio]));
 		isc_mgr->pwr_state &= ~BIT(pwr_gpio);
-		return 0;
+		goto pwr_dn_done;
 	}
 
 	for (i = 0; i < pd->num_pwr_gpios; i++) {
@@ -498,8 +555,11 @@ int isc_mgr_power_down(struct isc_mgr_priv *isc_mgr, unsigned long arg)
 		gpio_set_value(pd->pwr_gpios[i], PW_OFF(pd->pwr_flags[i]));
 		isc_mgr->pwr_state &= ~BIT(i);
 	}
-	mdelay(7);
+	/* sleep so that the other managers can sequence meanwhile */
+	usleep_range(7000, 7100);
 
+pwr_dn_done:
+	isc_mgr_step_done(isc_mgr, ISC_MGR_STEP_PWR_DN, start);
 pwr_dn_end:
 	return 0;
 }
@@ -771,6 +831,7 @@ static void isc_mgr_dev_ins(struct work_struct *work)
 	struct device_node *subdev;
 	struct isc_mgr_new_dev d_cfg = {.drv_name = "isc-dev"};
 	const char *sname;
+	ktime_t start = ktime_get();
 	u32 val;
 	int err = 0;
 
@@ -807,6 +868,8 @@ static void isc_mgr_dev_ins(struct work_struct *work)
 
 		__isc_create_dev(isc_mgr, &d_cfg);
 	}
+
+	isc_mgr_step_done(isc_mgr, ISC_MGR_STEP_DEV_INS, start);
 }
 
 static int isc_mgr_of_get_grp_gpio(
@@ -1011,6 +1074,7 @@ static int isc_mgr_probe(struct platform_device *pdev)
 	struct isc_mgr_priv *isc_mgr;
 	struct isc_mgr_platform_data *pd;
 	unsigned int i;
+	ktime_t start = ktime_get();
 
 	dev_info(&pdev->dev, "%sing...\n", __func__);
 
@@ -1167,6 +1231,7 @@ static int isc_mgr_probe(struct platform_device *pdev)
 	isc_mgr_debugfs_init(isc_mgr);
 	INIT_WORK(&isc_mgr->ins_work, isc_mgr_dev_ins);
 	schedule_work(&isc_mgr->ins_work);
+	isc_mgr_step_done(isc_mgr, ISC_MGR_STEP_PROBE, start);
 	return 0;
 
 err_probe:
@@ -1210,6 +1275,7 @@ static struct platform_driver isc_mgr_driver = {
 		.owner = THIS_MODULE,
 		.of_match_table = of_match_ptr(isc_mgr_of_match),
 		.pm = &isc_mgr_pm_ops,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = isc_mgr_probe,
 	.remove = isc_mgr_remove,
@@ -74,6 +74,8 @@ struct irq_q_info {
 	u32		  tail;
 };
 
+struct mods_irq_ring;
+
 /* The driver can be opened simultaneously multiple times, from the same or from
  * different processes.  This structure tracks data specific to each open fd.
  */
@@ -89,6 +91,8 @@ struct mods_client {
 	wait_queue_head_t        interrupt_event;
 	struct irq_q_info        irq_queue;
 	spinlock_t               irq_lock;
+	struct mods_irq_ring    *irq_ring; /* guarded by irq_lock */
+	u64                      irq_dropped; /* guarded by irq_lock */
 	struct en_dev_entry     *enabled_devices;
 	struct workqueue_struct *work_queue;
 	struct mem_type          mem_type;
@@ -100,6 +104,9 @@ struct mods_client {
 	u32                      access_token;
 	atomic_t                 num_allocs;
 	atomic_t                 num_pages;
+	atomic64_t               alloc_bytes;
+	atomic64_t               alloc_time_ns;
+	atomic64_t               cache_attr_time_ns;
 #if defined(MODS_HAS_CONSOLE_LOCK)
 	atomic_t                 console_is_locked;
 #endif
@@ -152,6 +159,7 @@ struct MODS_MEM_INFO {
 	u8  cache_type : 2; /* MODS_ALLOC_* */
 	u8  dma32      : 1; /* true/false */
 	u8  force_numa : 1; /* true/false */
+	u8  huge       : 1; /* true/false, MODS_ALLOC_HUGEPAGES */
 
 	struct pci_dev     *dev;         /* (optional) pci_dev this allocation
 					  * is for.
@@ -576,6 +584,11 @@ int esc_mods_register_irq_4(struct mods_client         *client,
 			    struct MODS_REGISTER_IRQ_4 *p);
 int esc_mods_query_irq_3(struct mods_client      *client,
 			 struct MODS_QUERY_IRQ_3 *p);
+int esc_mods_create_irq_ring(struct mods_client          *client,
+			     struct MODS_CREATE_IRQ_RING *p);
+int esc_mods_query_irq_ring(struct mods_client         *client,
+			    struct MODS_QUERY_IRQ_RING *p);
+u64 mods_get_irq_dropped(struct mods_client *client);
 
 #ifdef MODS_HAS_TEGRA
 /* bpmp uphy */
@@ -3,8 +3,12 @@
 
 #include "mods_internal.h"
 
+#include <linux/anon_inodes.h>
+#include <linux/file.h>
+#include <linux/kref.h>
 #include <linux/sched.h>
 #include <linux/poll.h>
+#include <linux/vmalloc.h>
 #include <linux/interrupt.h>
 #include <linux/pci_regs.h>
 #if defined(MODS_HAS_TEGRA) && defined(CONFIG_OF) && defined(CONFIG_OF_IRQ)
@@ -251,6 +255,85 @@ static void wake_up_client(struct dev_irq_map *t)
 		wake_up_interruptible(&client->interrupt_event);
 }
 
+/* Interrupt event ring shared with user space, see MODS_ESC_CREATE_IRQ_RING.
+ * It is referenced by the client which owns it and by the ring file.
+ */
+struct mods_irq_ring {
+	struct kref                  kref;
+	wait_queue_head_t            wq;
+	struct MODS_IRQ_RING_HEADER *hdr;
+	struct mods_irq_ring_entry  *entries;
+	u32                          size;
+	u32                          num_entries;
+	u32                          head;     /* guarded by client irq_lock */
+	u64                          dropped;  /* guarded by client irq_lock */
+	bool                         detached; /* guarded by client irq_lock */
+};
+
+static void mods_irq_ring_release(struct kref *ref)
+{
+	struct mods_irq_ring *ring = container_of(ref,
+						  struct mods_irq_ring,
+						  kref);
+
+	vfree(ring->hdr);
+	kfree(ring);
+}
+
+static void mods_put_irq_ring(struct mods_irq_ring *ring)
+{
+	kref_put(&ring->kref, mods_irq_ring_release);
+}
+
+static void fill_irq_dev(struct mods_pci_dev_2 *pdev,
+			 struct pci_dev        *dev,
+			 unsigned int           irq)
+{
+#ifdef CONFIG_PCI
+	if (dev) {
+		pdev->domain   = (u16)pci_domain_nr(dev->bus);
+		pdev->bus      = dev->bus->number;
+		pdev->device   = PCI_SLOT(dev->devfn);
+		pdev->function = PCI_FUNC(dev->devfn);
+		return;
+	}
+#endif
+	pdev->domain   = 0;
+	pdev->bus      = (u16)irq;
+	pdev->device   = 0xFFU;
+	pdev->function = 0xFFU;
+}
+
+/* Called with client irq_lock held.  Every occurrence of an interrupt is
+ * recorded, the consumer is expected to keep up or lose events.
+ */
+static int rec_irq_ring(struct mods_irq_ring *ring, struct dev_irq_map *t)
+{
+	struct MODS_IRQ_RING_HEADER *hdr  = ring->hdr;
+	const u32                    tail = READ_ONCE(hdr->tail);
+	struct mods_irq_ring_entry  *e;
+
+	/* Also catches a bogus tail written by the consumer */
+	if (ring->head - tail >= ring->num_entries) {
+		WRITE_ONCE(hdr->dropped, ++ring->dropped);
+		return false;
+	}
+
+	e = &ring->entries[ring->head & (ring->num_entries - 1)];
+	fill_irq_dev(&e->dev, t->dev, t->apic_irq);
+	e->irq_index = t->entry;
+	e->irq       = t->apic_irq;
+	e->time_ns   = ktime_get_ns();
+
+	/* Publish the entry before the new head */
+	smp_wmb();
+	WRITE_ONCE(hdr->head, ++ring->head);
+
+	wake_up_interruptible(&ring->wq);
+
+	return true;
+}
+
 static int rec_irq_done(struct mods_client *client,
 			struct dev_irq_map *t,
 			unsigned int        irq_time)
@@ -258,6 +341,9 @@ static int rec_irq_done(struct mods_client *client,
 	/* Get interrupt queue */
 	struct irq_q_info *q = &client->irq_queue;
 
+	if (client->irq_ring)
+		return rec_irq_ring(client->irq_ring, t);
+
 	/* Don't do anything if the IRQ has already been recorded */
 	if (q->head != q->tail) {
 		unsigned int i;
@@ -276,6 +362,7 @@ static int rec_irq_done(struct mods_client *client,
 	/* This is deadly! */
 	if (q->tail - q->head == MODS_MAX_IRQS) {
 		mods_error_printk("IRQ queue is full\n");
+		client->irq_dropped++;
 		return false;
 	}
 
@@ -643,17 +730,63 @@ void mods_init_irq(void)
 
 POLL_TYPE mods_irq_event_check(u8 client_id)
 {
-	struct irq_q_info *q;
+	struct mods_client   *client;
+	struct irq_q_info    *q;
+	struct mods_irq_ring *ring;
+	POLL_TYPE             mask = 0;
+	unsigned long         flags;
 
 	if (!mods_is_client_enabled(client_id))
 		return POLLERR; /* client has quit */
 
-	q = &mods_client_from_id(client_id)->irq_queue;
+	client = mods_client_from_id(client_id);
+	q = &client->irq_queue;
 
 	if (q->head != q->tail)
 		return POLLIN; /* irq generated */
 
-	return 0;
+	spin_lock_irqsave(&client->irq_lock, flags);
+	ring = client->irq_ring;
+	if (ring && ring->head != READ_ONCE(ring->hdr->tail))
+		mask = POLLIN;
+	spin_unlock_irqrestore(&client->irq_lock, flags);
+
+	return mask;
+}
+
+u64 mods_get_irq_dropped(struct mods_client *client)
+{
+	unsigned long flags;
+	u64           dropped;
+
+	spin_lock_irqsave(&client->irq_lock, flags);
+	dropped = client->irq_dropped;
+	if (client->irq_ring)
+		dropped += client->irq_ring->dropped;
+	spin_unlock_irqrestore(&client->irq_lock, flags);
+
+	return dropped;
+}
+
+static void mods_detach_irq_ring(struct mods_client *client)
+{
+	struct mods_irq_ring *ring;
+	unsigned long         flags;
+
+	spin_lock_irqsave(&client->irq_lock, flags);
+	ring = client->irq_ring;
+	client->irq_ring = NULL;
+	if (ring) {
+		ring->detached = true;
+		client->irq_dropped += ring->dropped;
+	}
+	spin_unlock_irqrestore(&client->irq_lock, flags);
+
+	if (ring) {
+		/* Report POLLHUP to anyone waiting on the ring */
+		wake_up_interruptible(&ring->wq);
+		mods_put_irq_ring(ring);
+	}
 }
 
 static int mods_free_irqs(struct mods_client *client,
@@ -761,6 +894,9 @@ void mods_free_client_interrupts(struct mods_client *client)
 		dpriv = dpriv->next;
 	}
 
+	/* No more interrupts can be recorded at this point */
+	mods_detach_irq_ring(client);
+
 	LOG_EXT();
 }
 
@@ -1396,6 +1532,197 @@ error:
 	return err;
 }
 
+static int mods_irq_ring_file_release(struct inode *inode, struct file *fp)
+{
+	mods_put_irq_ring(fp->private_data);
+	return OK;
+}
+
+static POLL_TYPE mods_irq_ring_file_poll(struct file *fp, poll_table *wait)
+{
+	struct mods_irq_ring *ring = fp->private_data;
+	POLL_TYPE             mask = 0;
+
+	poll_wait(fp, &ring->wq, wait);
+
+	if (READ_ONCE(ring->hdr->head) != READ_ONCE(ring->hdr->tail))
+		mask |= POLLIN | POLLRDNORM;
+	if (READ_ONCE(ring->detached))
+		mask |= POLLHUP;
+
+	return mask;
+}
+
+static int mods_irq_ring_file_mmap(struct file *fp, struct vm_area_struct *vma)
+{
+	struct mods_irq_ring *ring = fp->private_data;
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > ring->size)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring->hdr, 0);
+}
+
+static const struct file_operations mods_irq_ring_fops = {
+	.owner   = THIS_MODULE,
+	.release = mods_irq_ring_file_release,
+	.poll    = mods_irq_ring_file_poll,
+	.mmap    = mods_irq_ring_file_mmap,
+	.llseek  = noop_llseek,
+};
+
+int esc_mods_create_irq_ring(struct mods_client          *client,
+			     struct MODS_CREATE_IRQ_RING *p)
+{
+	struct mods_irq_ring *ring;
+	struct file          *file;
+	u32                   num_entries = p->num_entries;
+	u32                   size;
+	unsigned long         flags;
+	int                   fd;
+	int                   err = OK;
+
+	LOG_ENT();
+
+	if (!num_entries)
+		num_entries = MODS_IRQ_RING_DEFAULT_ENTRIES;
+
+	if (!is_power_of_2(num_entries) ||
+	    num_entries < MODS_IRQ_RING_MIN_ENTRIES ||
+	    num_entries > MODS_IRQ_RING_MAX_ENTRIES) {
+		cl_error("invalid number of IRQ ring entries %u\n",
+			 p->num_entries);
+		LOG_EXT();
+		return -EINVAL;
+	}
+
+	size = PAGE_ALIGN(sizeof(struct MODS_IRQ_RING_HEADER) +
+			  num_entries * sizeof(struct mods_irq_ring_entry));
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL | __GFP_NORETRY);
+	if (unlikely(!ring)) {
+		LOG_EXT();
+		return -ENOMEM;
+	}
+
+	ring->hdr = vmalloc_user(size);
+	if (unlikely(!ring->hdr)) {
+		kfree(ring);
+		LOG_EXT();
+		return -ENOMEM;
+	}
+
+	kref_init(&ring->kref);
+	init_waitqueue_head(&ring->wq);
+	ring->size        = size;
+	ring->num_entries = num_entries;
+	ring->entries     = (struct mods_irq_ring_entry *)(ring->hdr + 1);
+
+	ring->hdr->magic          = MODS_IRQ_RING_MAGIC;
+	ring->hdr->num_entries    = num_entries;
+	ring->hdr->entry_size     = sizeof(struct mods_irq_ring_entry);
+	ring->hdr->entries_offset = sizeof(struct MODS_IRQ_RING_HEADER);
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		mods_put_irq_ring(ring);
+		LOG_EXT();
+		return fd;
+	}
+
+	/* Reference held by the ring file */
+	kref_get(&ring->kref);
+
+	file = anon_inode_getfile("mods-irq-ring", &mods_irq_ring_fops, ring,
+				  O_RDWR);
+	if (IS_ERR(file)) {
+		cl_error("failed to create IRQ ring file\n");
+		put_unused_fd(fd);
+		mods_put_irq_ring(ring);
+		mods_put_irq_ring(ring);
+		LOG_EXT();
+		return PTR_ERR(file);
+	}
+
+	spin_lock_irqsave(&client->irq_lock, flags);
+	if (client->irq_ring) {
+		err = -EBUSY;
+	} else {
+		/* Interrupts still in the queue can be retrieved with
+		 * MODS_ESC_QUERY_IRQ_3, new ones go to the ring.
+		 */
+		client->irq_ring = ring;
+	}
+	spin_unlock_irqrestore(&client->irq_lock, flags);
+
+	if (err) {
+		cl_error("IRQ ring already exists\n");
+		fput(file);
+		put_unused_fd(fd);
+		mods_put_irq_ring(ring);
+		LOG_EXT();
+		return err;
+	}
+
+	fd_install(fd, file);
+
+	p->fd   = fd;
+	p->size = size;
+
+	cl_debug(DEBUG_ISR, "created IRQ ring with %u entries, fd %d\n",
+		 num_entries, fd);
+
+	LOG_EXT();
+	return OK;
+}
+
+int esc_mods_query_irq_ring(struct mods_client         *client,
+			    struct MODS_QUERY_IRQ_RING *p)
+{
+	struct mods_irq_ring *ring;
+	unsigned long         flags;
+	u32                   tail;
+	u32                   avail;
+	u32                   i;
+	int                   err = OK;
+
+	LOG_ENT();
+
+	spin_lock_irqsave(&client->irq_lock, flags);
+
+	ring = client->irq_ring;
+	if (!ring) {
+		cl_error("IRQ ring has not been created\n");
+		err = -EINVAL;
+		goto error;
+	}
+
+	tail  = READ_ONCE(ring->hdr->tail);
+	avail = ring->head - tail;
+	if (avail > ring->num_entries) {
+		cl_error("invalid IRQ ring tail %u, head %u\n",
+			 tail, ring->head);
+		err = -EINVAL;
+		goto error;
+	}
+
+	for (i = 0; i < avail && i < MODS_IRQ_RING_BATCH; i++, tail++)
+		p->irq_list[i] = ring->entries[tail & (ring->num_entries - 1)];
+
+	WRITE_ONCE(ring->hdr->tail, tail);
+
+	p->num_irqs = i;
+	p->more     = avail > i;
+	p->dropped  = ring->dropped;
+
+error:
+	spin_unlock_irqrestore(&client->irq_lock, flags);
+
+	LOG_EXT();
+	return err;
+}
+
 int esc_mods_query_irq_2(struct mods_client      *client,
 			 struct MODS_QUERY_IRQ_2 *p)
 {
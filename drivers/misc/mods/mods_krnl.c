@@ -1998,6 +1998,10 @@ static int esc_mods_get_driver_stats(struct mods_client *client,
 	p->version    = MODS_DRIVER_STATS_VERSION;
 	p->num_allocs = (num_allocs < 0) ? ~0U : num_allocs;
 	p->num_pages  = (num_pages  < 0) ? ~0U : num_pages;
+	p->alloc_bytes        = atomic64_read(&client->alloc_bytes);
+	p->alloc_time_ns      = atomic64_read(&client->alloc_time_ns);
+	p->cache_attr_time_ns = atomic64_read(&client->cache_attr_time_ns);
+	p->irq_dropped        = mods_get_irq_dropped(client);
 
 	LOG_EXT();
 	return 0;
@@ -2832,6 +2836,16 @@ static long mods_krnl_ioctl(struct file  *fp,
 			   esc_mods_query_irq_3, MODS_QUERY_IRQ_3);
 		break;
 
+	case MODS_ESC_CREATE_IRQ_RING:
+		MODS_IOCTL(MODS_ESC_CREATE_IRQ_RING,
+			   esc_mods_create_irq_ring, MODS_CREATE_IRQ_RING);
+		break;
+
+	case MODS_ESC_QUERY_IRQ_RING:
+		MODS_IOCTL(MODS_ESC_QUERY_IRQ_RING,
+			   esc_mods_query_irq_ring, MODS_QUERY_IRQ_RING);
+		break;
+
 #if defined(CONFIG_PCI) && defined(MODS_HAS_SRIOV)
 	case MODS_ESC_SET_NUM_VF:
 		MODS_IOCTL_NORETVAL(MODS_ESC_SET_NUM_VF,
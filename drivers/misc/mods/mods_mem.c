@@ -4,8 +4,11 @@
 #include "mods_internal.h"
 
 #include <linux/bitops.h>
+#include <linux/highmem.h>
+#include <linux/ktime.h>
 #include <linux/pagemap.h>
 #include <linux/sched.h>
+#include <linux/sizes.h>
 
 #if defined(MODS_HAS_SET_DMA_MASK)
 #include <linux/dma-mapping.h>
@@ -16,6 +19,9 @@
 #include <linux/cache.h>
 #endif
 
+/* Smallest chunk used by MODS_ALLOC_HUGEPAGES allocations */
+#define MODS_HUGE_ORDER get_order(SZ_2M)
+
 static struct MODS_MEM_INFO *get_mem_handle(struct mods_client *client,
 					    u64                 handle)
 {
@@ -399,6 +405,25 @@ static void clear_contiguous_cache(struct mods_client *client,
 				   u32                 size);
 #endif
 
+/* Change cache attributes of pages mapped contiguously at ptr */
+static int set_cache_attr_range(struct mods_client   *client,
+				struct MODS_MEM_INFO *p_mem_info,
+				void                 *ptr,
+				u32                   num_pages)
+{
+#ifdef CONFIG_ARM64
+	clear_contiguous_cache(client,
+			       (u64)(size_t)ptr,
+			       num_pages << PAGE_SHIFT);
+	return 0;
+#else
+	if (p_mem_info->cache_type == MODS_ALLOC_WRITECOMBINE)
+		return MODS_SET_MEMORY_WC((unsigned long)ptr, num_pages);
+	else
+		return MODS_SET_MEMORY_UC((unsigned long)ptr, num_pages);
+#endif
+}
+
 static int setup_cache_attr(struct mods_client   *client,
 			    struct MODS_MEM_INFO *p_mem_info,
 			    u32                   ichunk)
@@ -407,9 +432,32 @@ static int setup_cache_attr(struct mods_client   *client,
 	int        err = 0;
 
 	if (need_wc && !is_chunk_wc(p_mem_info, ichunk)) {
-		struct scatterlist *sg = &p_mem_info->alloc_sg[ichunk];
+		struct scatterlist *sg         = &p_mem_info->alloc_sg[ichunk];
+		const ktime_t       start_time = ktime_get();
 		unsigned int        offs;
 
+		/* Chunks in lowmem are contiguous in the kernel linear
+		 * mapping, so the whole chunk is changed with one call.
+		 * Chunks are not merged with their neighbours, because
+		 * cache attributes must be restored on the same ranges
+		 * they were set on.
+		 */
+		if (!PageHighMem(sg_page(sg))) {
+			err = set_cache_attr_range(client,
+						   p_mem_info,
+						   page_address(sg_page(sg)),
+						   sg->length >> PAGE_SHIFT);
+			if (unlikely(err))
+				cl_error("set cache type failed\n");
+			else
+				mark_chunk_wc(p_mem_info, ichunk);
+
+			atomic64_add(ktime_to_ns(ktime_sub(ktime_get(),
+							   start_time)),
+				     &client->cache_attr_time_ns);
+			return err;
+		}
+
 		for (offs = 0; offs < sg->length; offs += PAGE_SIZE) {
 			void *ptr;
 
@@ -418,16 +466,7 @@ static int setup_cache_attr(struct mods_client   *client,
 				cl_error("kmap failed\n");
 				return -ENOMEM;
 			}
-#ifdef CONFIG_ARM64
-			clear_contiguous_cache(client,
-					       (u64)(size_t)ptr,
-					       PAGE_SIZE);
-#else
-			if (p_mem_info->cache_type == MODS_ALLOC_WRITECOMBINE)
-				err = MODS_SET_MEMORY_WC((unsigned long)ptr, 1);
-			else
-				err = MODS_SET_MEMORY_UC((unsigned long)ptr, 1);
-#endif
+			err = set_cache_attr_range(client, p_mem_info, ptr, 1);
 			MODS_KUNMAP(ptr);
 			if (unlikely(err)) {
 				cl_error("set cache type failed\n");
@@ -444,6 +483,9 @@ static int setup_cache_attr(struct mods_client   *client,
 			/* Avoid superficial lockups */
 			cond_resched();
 		}
+
+		atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start_time)),
+			     &client->cache_attr_time_ns);
 	}
 
 	return err;
@@ -540,6 +582,17 @@ static int restore_cache_one_chunk(struct page *p_page, u8 order)
 	u32 num_pages = 1U << order;
 	u32 i;
 
+	/* Restore the lowmem chunk with one call, see setup_cache_attr() */
+	if (!PageHighMem(p_page)) {
+		final_err = MODS_SET_MEMORY_WB(
+				(unsigned long)page_address(p_page), num_pages);
+
+		/* Avoid superficial lockups */
+		cond_resched();
+
+		return final_err;
+	}
+
 	for (i = 0; i < num_pages; i++) {
 		void *ptr = MODS_KMAP(p_page + i);
 		int   err = -ENOMEM;
@@ -679,7 +732,15 @@ static void release_chunks(struct mods_client   *client,
 
 static gfp_t get_alloc_flags(struct MODS_MEM_INFO *p_mem_info, u32 order)
 {
-	gfp_t flags = GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN;
+	gfp_t flags = GFP_KERNEL | __GFP_NOWARN;
+
+	/* Hugepage chunks are worth compacting memory for, but they
+	 * must not trigger the OOM killer.
+	 */
+	if (p_mem_info->huge)
+		flags |= __GFP_RETRY_MAYFAIL;
+	else
+		flags |= __GFP_NORETRY;
 
 	if (p_mem_info->force_numa)
 		flags |= __GFP_THISNODE;
@@ -779,6 +840,9 @@ static int alloc_contig_sys_pages(struct mods_client   *client,
 	while ((1U << order) < p_mem_info->num_pages)
 		order++;
 
+	if (p_mem_info->huge && order < MODS_HUGE_ORDER)
+		order = MODS_HUGE_ORDER;
+
 	p_page = alloc_chunk(client, p_mem_info, order, &is_wb);
 
 	if (unlikely(!p_page))
@@ -832,9 +896,10 @@ static int alloc_noncontig_sys_pages(struct mods_client   *client,
 {
 	const unsigned long req_bytes = (unsigned long)p_mem_info->num_pages
 					<< PAGE_SHIFT;
-	u32 pages_needed = p_mem_info->num_pages;
-	u32 num_chunks   = 0;
-	int err;
+	const u32 min_order    = p_mem_info->huge ? MODS_HUGE_ORDER : 0;
+	u32       pages_needed = p_mem_info->num_pages;
+	u32       num_chunks   = 0;
+	int       err;
 
 	LOG_ENT();
 
@@ -843,7 +908,9 @@ static int alloc_noncontig_sys_pages(struct mods_client   *client,
 	for (; pages_needed > 0; ++num_chunks) {
 		struct scatterlist *sg = &p_mem_info->alloc_sg[num_chunks];
 		u64 phys_addr       = 0;
-		u32 order           = get_max_order_needed(pages_needed);
+		u32 order           = max_t(u32,
+					    get_max_order_needed(pages_needed),
+					    min_order);
 		u32 allocated_pages = 0;
 		int is_wb           = 1;
 
@@ -864,7 +931,7 @@ static int alloc_noncontig_sys_pages(struct mods_client   *client,
 				allocated_pages = 1u << order;
 				break;
 			}
-			if (order == 0)
+			if (order == min_order)
 				break;
 			--order;
 		}
@@ -1307,6 +1374,7 @@ int esc_mods_alloc_pages_2(struct mods_client        *client,
 			   struct MODS_ALLOC_PAGES_2 *p)
 {
 	struct MODS_MEM_INFO *p_mem_info = NULL;
+	const ktime_t         start_time = ktime_get();
 	u32                   num_pages;
 	u32                   alloc_size;
 	u32                   num_chunks;
@@ -1318,7 +1386,7 @@ int esc_mods_alloc_pages_2(struct mods_client        *client,
 	p->memory_handle = 0;
 
 	cl_debug(DEBUG_MEM_DETAILED,
-		 "alloc 0x%llx bytes flags=0x%x (%s %s%s%s%s%s) node=%d on dev %04x:%02x:%02x.%x\n",
+		 "alloc 0x%llx bytes flags=0x%x (%s %s%s%s%s%s%s) node=%d on dev %04x:%02x:%02x.%x\n",
 		 (unsigned long long)p->num_bytes,
 		 p->flags,
 		 mods_get_prot_str(p->flags & MODS_ALLOC_CACHE_MASK),
@@ -1328,6 +1396,7 @@ int esc_mods_alloc_pages_2(struct mods_client        *client,
 		 (p->flags & MODS_ALLOC_USE_NUMA) ? " usenuma" : "",
 		 (p->flags & MODS_ALLOC_FORCE_NUMA) ? " forcenuma" : "",
 		 (p->flags & MODS_ALLOC_MAP_DEV) ? " dmamap" : "",
+		 (p->flags & MODS_ALLOC_HUGEPAGES) ? " hugepages" : "",
 		 p->numa_node,
 		 p->pci_device.domain,
 		 p->pci_device.bus,
@@ -1340,6 +1409,8 @@ int esc_mods_alloc_pages_2(struct mods_client        *client,
 	}
 
 	num_pages = (u32)((p->num_bytes + PAGE_SIZE - 1) >> PAGE_SHIFT);
+	if (p->flags & MODS_ALLOC_HUGEPAGES)
+		num_pages = ALIGN(num_pages, 1U << MODS_HUGE_ORDER);
 	if (p->flags & MODS_ALLOC_CONTIGUOUS)
 		num_chunks = 1;
 	else
@@ -1388,6 +1459,8 @@ int esc_mods_alloc_pages_2(struct mods_client        *client,
 	p_mem_info->dma32      = (p->flags & MODS_ALLOC_DMA32) ? true : false;
 	p_mem_info->force_numa = (p->flags & MODS_ALLOC_FORCE_NUMA)
 				 ? true : false;
+	p_mem_info->huge       = (p->flags & MODS_ALLOC_HUGEPAGES)
+				 ? true : false;
 #ifdef MODS_HASNT_NUMA_NO_NODE
 	p_mem_info->numa_node  = numa_node_id();
 #else
@@ -1467,6 +1540,24 @@ int esc_mods_alloc_pages_2(struct mods_client        *client,
 	cl_debug(DEBUG_MEM_DETAILED, "alloc %p: %u chunks, %u pages\n",
 		 p_mem_info, p_mem_info->num_chunks, p_mem_info->num_pages);
 
+	{
+		const u64 bytes = (u64)p_mem_info->num_pages << PAGE_SHIFT;
+		const u64 ns    = ktime_to_ns(ktime_sub(ktime_get(),
+							start_time));
+
+		atomic64_add(bytes, &client->alloc_bytes);
+		atomic64_add(ns, &client->alloc_time_ns);
+
+		cl_debug(DEBUG_MEM,
+			 "alloc %p: 0x%llx bytes in %u chunks took %llu us, %llu MB/s\n",
+			 p_mem_info,
+			 (unsigned long long)bytes,
+			 p_mem_info->num_chunks,
+			 (unsigned long long)div_u64(ns, NSEC_PER_USEC),
+			 (unsigned long long)(ns ? div64_u64(bytes * 1000, ns)
+						 : 0));
+	}
+
 failed:
 	if (unlikely(err && p_mem_info)) {
 		dma_unmap_all(client, p_mem_info, NULL);
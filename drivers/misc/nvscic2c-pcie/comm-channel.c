@@ -12,6 +12,8 @@
 #include <linux/iommu.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/types.h>
@@ -26,6 +28,11 @@
 
 #define CACHE_ALIGN		(64)
 
+static unsigned int comm_busy_poll_us;
+module_param(comm_busy_poll_us, uint, 0644);
+MODULE_PARM_DESC(comm_busy_poll_us,
+		 "Time in us the comm-channel receiver spins for the next message, 0 disables");
+
 /* Fifo size */
 /*
  * This is wrong, but to have private communication channel functional at the
@@ -284,9 +291,35 @@ comm_channel_msg_send(void *comm_channel_h, struct comm_msg *msg)
 	return send_msg(comm_ctx, msg);
 }
 
+/*
+ * Spin on the fifo for the next message from peer, for control messages in
+ * quick succession to be received without waiting for their notification.
+ */
+static bool
+recv_busy_poll(struct comm_channel_ctx_t *comm_ctx)
+{
+	int ret = 0;
+	ktime_t end;
+	u32 spin_us = READ_ONCE(comm_busy_poll_us);
+
+	if (!spin_us)
+		return false;
+
+	end = ktime_add_us(ktime_get(), spin_us);
+	do {
+		if (can_recv(&comm_ctx->fifo, &ret))
+			return true;
+		cpu_relax();
+	} while (ktime_before(ktime_get(), end) &&
+		 !need_resched() && !comm_ctx->r_task.shutdown);
+
+	return false;
+}
+
 static int
 recv_taskfn(void *arg)
 {
+	bool busy = false;
 	int ret = 0;
 	struct comm_channel_ctx_t *comm_ctx = NULL;
 	struct comm_msg *msg = NULL;
@@ -299,16 +332,21 @@ recv_taskfn(void *arg)
 	fifo = &comm_ctx->fifo;
 
 	while (!task->shutdown) {
-		/* wait for notification from peer or shutdown. */
-		wait_event_interruptible(task->waitq,
-					 (atomic_read(&comm_ctx->recv_count) ||
-					  task->shutdown));
+		/*
+		 * wait for notification from peer or shutdown, unless
+		 * busy-poll found the next message already.
+		 */
+		if (!busy)
+			wait_event_interruptible
+				(task->waitq,
+				 (atomic_read(&comm_ctx->recv_count) ||
+				  task->shutdown));
 		/* task is exiting.*/
 		if (task->shutdown)
 			continue;
 
 		/* read all on single notify.*/
-		atomic_dec(&comm_ctx->recv_count);
+		atomic_dec_if_positive(&comm_ctx->recv_count);
 		while (can_recv(fifo, &ret)) {
 			msg = (struct comm_msg *)
 				(fifo->recv + (fifo->rd_pos * fifo->frame_sz));
@@ -337,7 +375,7 @@ recv_taskfn(void *arg)
 		}
 
 		/* if nothing (left) to read, go back waiting. */
-		continue;
+		busy = recv_busy_poll(comm_ctx);
 	}
 
 	/* we do not use kthread_stop(), but wait on this.*/
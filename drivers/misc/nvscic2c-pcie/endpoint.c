@@ -12,10 +12,14 @@
 #include <linux/host1x-next.h>
 #include <linux/iommu.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
 #include <linux/platform_device.h>
 #include <linux/poll.h>
 #include <linux/printk.h>
+#include <linux/sched/signal.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
 #include <linux/wait.h>
 
@@ -29,6 +33,11 @@
 
 #define PCIE_STATUS_CHANGE_ACK_TIMEOUT (2000)
 
+static unsigned int busy_poll_max_us = 1000;
+module_param(busy_poll_max_us, uint, 0644);
+MODULE_PARM_DESC(busy_poll_max_us,
+		 "Maximum busy-poll budget of an endpoint poll() in us");
+
 /*
  * Masked offsets to return to user, allowing them to mmap
  * different memory segments of endpoints in user-space.
@@ -124,6 +133,20 @@ struct endpoint_t {
 
 	u32 linkevent_id;
 
+	/*
+	 * peer notifications are delivered once, either by busy-poll or by
+	 * the syncpoint fence callback, whichever finds them first.
+	 */
+	spinlock_t notify_lock;
+	/* syncpoint value up to which peer notifications were delivered.*/
+	u32 notify_seen;
+	/* NOTIFY_REMOTE awaiting the peer notification, for round-trips.*/
+	ktime_t rtt_start;
+	struct nvscic2c_pcie_notify_stats_args notify_stats;
+
+	/* busy-poll budget of poll(), 0 when disabled.*/
+	u32 busy_poll_us;
+
 	/* propagate events when endpoint was initialized.*/
 	atomic_t event_handling;
 
@@ -194,6 +217,20 @@ static int
 ioctl_get_info_impl(struct endpoint_t *endpoint,
 		    struct nvscic2c_pcie_endpoint_info *get_info);
 
+/* prototype. */
+static int
+ioctl_set_busy_poll_impl(struct endpoint_t *endpoint,
+			 struct nvscic2c_pcie_busy_poll_args *args);
+
+/* prototype. */
+static int
+ioctl_get_notify_stats_impl(struct endpoint_t *endpoint,
+			    struct nvscic2c_pcie_notify_stats_args *args);
+
+/* prototype. */
+static bool
+deliver_notification(struct endpoint_t *endpoint, u32 value, bool busy_poll);
+
 /*
  * open() syscall backing for nvscic2c-pcie endpoint devices.
  *
@@ -361,6 +398,30 @@ exit:
 	return ret;
 }
 
+/*
+ * Spin up to spin_us on the syncpoint the peer increments for notifications.
+ * Stops early on any event delivered by the interrupt path, on a signal or
+ * when the cpu is needed elsewhere.
+ */
+static bool
+endpoint_busy_poll(struct endpoint_t *endpoint, u32 spin_us)
+{
+	struct syncpt_t *syncpt = &endpoint->syncpt;
+	ktime_t end = ktime_add_us(ktime_get(), spin_us);
+
+	do {
+		if (deliver_notification(endpoint,
+					 host1x_syncpt_read(syncpt->sp), true))
+			return true;
+		if (atomic_read(&endpoint->event_count))
+			break;
+		cpu_relax();
+	} while (ktime_before(ktime_get(), end) &&
+		 !need_resched() && !signal_pending(current));
+
+	return false;
+}
+
 /*
  * poll() syscall backing for nvscic2c-pcie endpoint devices.
  *
@@ -370,11 +431,16 @@ exit:
  * If we are able to read(), write() or there is a pending state change event
  * to be serviced, we return letting application call get_event(), otherwise
  * kernel f/w will wait for poll_waitq activity to occur.
+ *
+ * With busy-poll enabled on the endpoint, a poll() which would wait spins on
+ * the notification syncpoint first, delivering peer notifications without
+ * the syncpoint fence callback and work hops in between.
  */
 static __poll_t
 endpoint_fops_poll(struct file *filp, poll_table *wait)
 {
 	__poll_t mask = 0;
+	u32 busy_poll_us = 0;
 	struct endpoint_t *endpoint = filp->private_data;
 
 	if (WARN_ON(!endpoint))
@@ -396,10 +462,16 @@ endpoint_fops_poll(struct file *filp, poll_table *wait)
 	if (atomic_read(&endpoint->event_count)) {
 		atomic_dec(&endpoint->event_count);
 		mask = (__force __poll_t)(POLLPRI | POLLIN | POLLOUT);
+	} else if (!poll_does_not_wait(wait)) {
+		busy_poll_us = endpoint->busy_poll_us;
 	}
 
 	mutex_unlock(&endpoint->fops_lock);
 
+	/* do not hold fops_lock while spinning, NOTIFY_REMOTE may need it.*/
+	if (busy_poll_us && endpoint_busy_poll(endpoint, busy_poll_us))
+		mask = (__force __poll_t)(POLLPRI | POLLIN | POLLOUT);
+
 	return mask;
 }
 
@@ -441,6 +513,14 @@ endpoint_fops_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case NVSCIC2C_PCIE_IOCTL_NOTIFY_REMOTE:
 		ret = ioctl_notify_remote_impl(endpoint);
 		break;
+	case NVSCIC2C_PCIE_IOCTL_SET_BUSY_POLL:
+		ret = ioctl_set_busy_poll_impl
+			(endpoint, (struct nvscic2c_pcie_busy_poll_args *)buf);
+		break;
+	case NVSCIC2C_PCIE_IOCTL_GET_NOTIFY_STATS:
+		ret = ioctl_get_notify_stats_impl
+			(endpoint, (struct nvscic2c_pcie_notify_stats_args *)buf);
+		break;
 	default:
 		ret = stream_extension_ioctl(endpoint->stream_ext_h, cmd, buf);
 		break;
@@ -500,6 +580,12 @@ ioctl_notify_remote_impl(struct endpoint_t *endpoint)
 	if (link != NVSCIC2C_PCIE_LINK_UP)
 		return -ENOLINK;
 
+	/* round-trip starts with the first notify awaiting the peer's.*/
+	spin_lock(&endpoint->notify_lock);
+	if (!endpoint->rtt_start)
+		endpoint->rtt_start = ktime_get();
+	spin_unlock(&endpoint->notify_lock);
+
 	if (peer_cpu == NVCPU_X86_64) {
 #if defined(PCI_EPC_IRQ_TYPE_ENUM_PRESENT) /* Dropped from Linux 6.8 */
 		ret = pci_client_raise_irq(endpoint->pci_client_h, PCI_EPC_IRQ_MSI,
@@ -530,6 +616,74 @@ ioctl_notify_remote_impl(struct endpoint_t *endpoint)
 	return ret;
 }
 
+/*
+ * implement NVSCIC2C_PCIE_IOCTL_SET_BUSY_POLL ioctl call.
+ */
+static int
+ioctl_set_busy_poll_impl(struct endpoint_t *endpoint,
+			 struct nvscic2c_pcie_busy_poll_args *args)
+{
+	if (args->reserved)
+		return -EINVAL;
+
+	endpoint->busy_poll_us = min_t(u32, args->spin_us,
+				       READ_ONCE(busy_poll_max_us));
+
+	return 0;
+}
+
+/*
+ * implement NVSCIC2C_PCIE_IOCTL_GET_NOTIFY_STATS ioctl call.
+ */
+static int
+ioctl_get_notify_stats_impl(struct endpoint_t *endpoint,
+			    struct nvscic2c_pcie_notify_stats_args *args)
+{
+	spin_lock(&endpoint->notify_lock);
+	*args = endpoint->notify_stats;
+	spin_unlock(&endpoint->notify_lock);
+
+	return 0;
+}
+
+/*
+ * Deliver the peer notification found at syncpoint value, unless it was
+ * already delivered by busy-poll or the fence callback. Notifications are
+ * delivered one at a time, in syncpoint order.
+ */
+static bool
+deliver_notification(struct endpoint_t *endpoint, u32 value, bool busy_poll)
+{
+	struct nvscic2c_pcie_notify_stats_args *stats = &endpoint->notify_stats;
+	bool deliver = false;
+	u32 bucket = 0;
+	s64 rtt_us = 0;
+
+	spin_lock(&endpoint->notify_lock);
+	if ((s32)(value - endpoint->notify_seen) > 0) {
+		endpoint->notify_seen++;
+		deliver = true;
+
+		if (busy_poll)
+			stats->busy_poll_notifications++;
+		else
+			stats->irq_notifications++;
+
+		if (endpoint->rtt_start) {
+			rtt_us = ktime_us_delta(ktime_get(),
+						endpoint->rtt_start);
+			if (rtt_us > 0)
+				bucket = min_t(u32, fls64(rtt_us),
+					       NVSCIC2C_PCIE_RTT_HIST_BUCKETS - 1);
+			stats->rtt_hist[bucket]++;
+			endpoint->rtt_start = 0;
+		}
+	}
+	spin_unlock(&endpoint->notify_lock);
+
+	return deliver;
+}
+
 static void
 enable_event_handling(struct endpoint_t *endpoint)
 {
@@ -538,6 +692,14 @@ enable_event_handling(struct endpoint_t *endpoint)
 	 * is opened and not the stale ones.
 	 */
 	atomic_set(&endpoint->event_count, 0);
+
+	spin_lock(&endpoint->notify_lock);
+	endpoint->notify_seen = host1x_syncpt_read(endpoint->syncpt.sp);
+	endpoint->rtt_start = 0;
+	memset(&endpoint->notify_stats, 0, sizeof(endpoint->notify_stats));
+	spin_unlock(&endpoint->notify_lock);
+	endpoint->busy_poll_us = 0;
+
 	atomic_set(&endpoint->event_handling, 1);
 }
 
@@ -649,8 +811,15 @@ fence_do_work(struct work_struct *work)
 static void
 syncpt_callback(void *data)
 {
+	struct endpoint_t *endpoint = (struct endpoint_t *)(data);
+
 	/* Skip args ceck, trusting host1x. */
 
+	/* the fence expired at threshold, unless busy-poll got there first.*/
+	if (!atomic_read(&endpoint->event_handling) ||
+	    !deliver_notification(endpoint, endpoint->syncpt.threshold, false))
+		return;
+
 	event_callback(NULL, data);
 }
 
@@ -963,6 +1132,7 @@ create_endpoint_device(struct endpoint_drv_ctx_t *eps_ctx,
 	atomic_set(&endpoint->in_use, 0);
 	atomic_set(&endpoint->shutdown, 0);
 	init_waitqueue_head(&endpoint->poll_waitq);
+	spin_lock_init(&endpoint->notify_lock);
 	init_waitqueue_head(&endpoint->close_waitq);
 
 	/* create the nvscic2c endpoint char device.*/
@@ -1,11 +1,15 @@
 // SPDX-License-Identifier: GPL-2.0-only
-// Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// Copyright (c) 2022-2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
 
 #define pr_fmt(fmt)	"nvscic2c-pcie: iova-mgr: " fmt
 
+#include <linux/debugfs.h>
 #include <linux/errno.h>
+#include <linux/math64.h>
 #include <linux/mutex.h>
 #include <linux/printk.h>
+#include <linux/rbtree.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 
@@ -18,13 +22,18 @@
  *
  * IOVA manager chunks entire IOVA space into these blocks/chunks.
  *
- * The chunk/block is also a node for linking to previous and next
- * nodes of a circular doubly linked list - free or reserved.
+ * A reserved chunk/block is a node of the reserved list. A free chunk/block
+ * is a node of the two free trees: one ordered by address, one ordered by
+ * size then address.
  */
 struct block_t {
-	/* for management of this chunk in either avail or reserve lists.*/
+	/* for management of this chunk in reserved list.*/
 	struct list_head node;
 
+	/* for management of this chunk in the free trees.*/
+	struct rb_node addr_node;
+	struct rb_node size_node;
+
 	/* block address.*/
 	u64 address;
 
@@ -35,11 +44,12 @@ struct block_t {
 /*
  * INTERNAL datastructure for IOVA space manager.
  *
- * IOVA space manager would fragment and manage the IOVA region
- * using two circular doubly linked lists - reserved list and
- * free list. These lists contain blocks/chunks reserved
- * or free for use by clients (callers) from the overall
- * IOVA region the IOVA manager was configured with.
+ * IOVA space manager would fragment and manage the IOVA region using
+ * a reserved list and two free trees. The reserved list contains the
+ * blocks/chunks reserved for use by clients (callers). The free trees
+ * contain the free blocks/chunks of the overall IOVA region the IOVA
+ * manager was configured with, such that both the best fit on reserve
+ * and the neighbours to merge with on release are found in O(log n).
  */
 struct mngr_ctx_t {
 	/*
@@ -50,26 +60,100 @@ struct mngr_ctx_t {
 	char name[NAME_MAX];
 
 	/*
-	 * Circular doubly linked list of blocks indicating
-	 * available/free IOVA space(s). When IOVA manager is
-	 * initialised all of the IOVA space is marked as available
-	 * to begin with.
+	 * Free IOVA space(s) ordered by address, for merging released
+	 * blocks with their neighbours. When IOVA manager is initialised
+	 * all of the IOVA space is marked as available to begin with.
 	 */
-	struct list_head *free_list;
+	struct rb_root free_by_addr;
 
 	/*
-	 * Book-keeping of the user IOVA blocks in a circular double
-	 * linked list.
+	 * The same free IOVA space(s) ordered by size, then address, for
+	 * finding the best free block to reserve.
 	 */
-	struct list_head *reserved_list;
+	struct rb_root free_by_size;
+
+	/* Book-keeping of the user IOVA blocks in a doubly linked list.*/
+	struct list_head reserved_list;
 
 	/* Ensuring reserve, free and the list operations are serialized.*/
 	struct mutex lock;
 
 	/* base address memory manager is configured with. */
 	u64 base_address;
+	size_t size;
+
+	/* statistics, for debugfs.*/
+	size_t free_size;
+	u64 num_free;
+	u64 num_reserved;
+	u64 reserve_failures;
 };
 
+static void
+free_block_insert_size(struct mngr_ctx_t *ctx, struct block_t *block)
+{
+	struct rb_node **link = &ctx->free_by_size.rb_node;
+	struct rb_node *parent = NULL;
+	struct block_t *curr = NULL;
+
+	while (*link) {
+		parent = *link;
+		curr = rb_entry(parent, struct block_t, size_node);
+		if (block->size < curr->size ||
+		    (block->size == curr->size &&
+		     block->address < curr->address))
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&block->size_node, parent, link);
+	rb_insert_color(&block->size_node, &ctx->free_by_size);
+}
+
+static void
+free_block_insert_addr(struct mngr_ctx_t *ctx, struct block_t *block)
+{
+	struct rb_node **link = &ctx->free_by_addr.rb_node;
+	struct rb_node *parent = NULL;
+	struct block_t *curr = NULL;
+
+	while (*link) {
+		parent = *link;
+		curr = rb_entry(parent, struct block_t, addr_node);
+		if (block->address < curr->address)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&block->addr_node, parent, link);
+	rb_insert_color(&block->addr_node, &ctx->free_by_addr);
+}
+
+/*
+ * The smallest free block of at least size, the lowest addressed of
+ * them if there are several of the same size.
+ */
+static struct block_t *
+free_block_best_fit(struct mngr_ctx_t *ctx, size_t size)
+{
+	struct rb_node *node = ctx->free_by_size.rb_node;
+	struct block_t *curr = NULL, *best = NULL;
+
+	while (node) {
+		curr = rb_entry(node, struct block_t, size_node);
+		if (curr->size >= size) {
+			best = curr;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	return best;
+}
+
 /*
  * Reserves a block from the free IOVA regions. Once reserved, the block
  * is marked reserved and appended in the reserved list (no ordering
@@ -81,7 +165,7 @@ iova_mngr_block_reserve(void *mngr_handle, size_t size,
 			void **block_handle)
 {
 	struct mngr_ctx_t *ctx = (struct mngr_ctx_t *)(mngr_handle);
-	struct block_t *reserve = NULL, *curr = NULL, *best = NULL;
+	struct block_t *reserve = NULL, *best = NULL, *found = NULL;
 	int ret = 0;
 
 	if (WARN_ON(!ctx || *block_handle || !size))
@@ -89,59 +173,51 @@ iova_mngr_block_reserve(void *mngr_handle, size_t size,
 
 	mutex_lock(&ctx->lock);
 
-	/* if there are no free blocks to reserve. */
-	if (list_empty(ctx->free_list)) {
-		ret = -ENOMEM;
-		pr_err("(%s): No memory available to reserve block of size:(%lu)\n",
-		       ctx->name, size);
-		goto err;
-	}
-
 	/* find the best of all free bocks to reserve.*/
-	list_for_each_entry(curr, ctx->free_list, node) {
-		if (curr->size >= size) {
-			if (!best)
-				best = curr;
-			else if (curr->size < best->size)
-				best = curr;
-		}
-	}
+	best = free_block_best_fit(ctx, size);
 
 	/* if there isn't any free block of requested size. */
 	if (!best) {
 		ret = -ENOMEM;
+		ctx->reserve_failures++;
 		pr_err("(%s): No enough mem available to reserve block sz:(%lu)\n",
 		       ctx->name, size);
 		goto err;
-	} else {
-		struct block_t *found = NULL;
+	}
 
+	if (best->size == size) {
 		/* perfect fit.*/
-		if (best->size == size) {
-			list_del(&best->node);
-			list_add_tail(&best->node, ctx->reserved_list);
-			found = best;
-		} else {
-			/* chunk out a new block, adjust the free block.*/
-			reserve = kzalloc(sizeof(*reserve), GFP_KERNEL);
-			if (WARN_ON(!reserve)) {
-				ret = -ENOMEM;
-				goto err;
-			}
-			reserve->address = best->address;
-			reserve->size = size;
-			best->address += size;
-			best->size -= size;
-			list_add_tail(&reserve->node, ctx->reserved_list);
-			found = reserve;
+		rb_erase(&best->addr_node, &ctx->free_by_addr);
+		rb_erase(&best->size_node, &ctx->free_by_size);
+		ctx->num_free--;
+		found = best;
+	} else {
+		/*
+		 * chunk out a new block, adjust the free block. It keeps its
+		 * place in address order but not in size order.
+		 */
+		reserve = kzalloc(sizeof(*reserve), GFP_KERNEL);
+		if (WARN_ON(!reserve)) {
+			ret = -ENOMEM;
+			goto err;
 		}
-		*block_handle = (void *)(found);
-
-		if (address)
-			*address = found->address;
-		if (offset)
-			*offset = (found->address - ctx->base_address);
+		reserve->address = best->address;
+		reserve->size = size;
+		rb_erase(&best->size_node, &ctx->free_by_size);
+		best->address += size;
+		best->size -= size;
+		free_block_insert_size(ctx, best);
+		found = reserve;
 	}
+	list_add_tail(&found->node, &ctx->reserved_list);
+	ctx->free_size -= size;
+	ctx->num_reserved++;
+	*block_handle = (void *)(found);
+
+	if (address)
+		*address = found->address;
+	if (offset)
+		*offset = (found->address - ctx->base_address);
 err:
 	mutex_unlock(&ctx->lock);
 	return ret;
@@ -149,15 +225,15 @@ err:
 
 /*
  * Release an already reserved IOVA block/chunk by the caller back to
- * free list.
+ * free trees.
  */
 int
 iova_mngr_block_release(void *mngr_handle, void **block_handle)
 {
 	struct mngr_ctx_t *ctx = (struct mngr_ctx_t *)(mngr_handle);
 	struct block_t *release = (struct block_t *)(*block_handle);
-	struct block_t *curr = NULL, *prev = NULL;
-	bool done = false;
+	struct block_t *prev = NULL, *next = NULL;
+	struct rb_node *node = NULL;
 	int ret = 0;
 
 	if (!ctx || !release)
@@ -165,77 +241,41 @@ iova_mngr_block_release(void *mngr_handle, void **block_handle)
 
 	mutex_lock(&ctx->lock);
 
-	list_for_each_entry(curr, ctx->free_list, node) {
-		if (release->address < curr->address) {
-			/* if the immediate next node is available for merge.*/
-			if (curr->address == release->address + release->size) {
-				curr->address = release->address;
-				curr->size += release->size;
-				list_del(&release->node);
-				kfree(release);
-				/*
-				 * if the immediate previous node is also
-				 * available for merge.
-				 */
-				if ((prev) &&
-				    ((prev->address + prev->size)
-				      == curr->address)) {
-					prev->size += curr->size;
-					list_del(&curr->node);
-					kfree(curr);
-				}
-			} else if ((prev) &&
-				   ((prev->address + prev->size)
-				    == release->address)) {
-				/*
-				 * if only the immediate prev node is available
-				 */
-				prev->size += release->size;
-				list_del(&release->node);
-				kfree(release);
-			} else {
-				/*
-				 * cannot be merged with either the immediate
-				 * prev or the immediate next node. Add it in the
-				 * free list before the current node.
-				 */
-				list_del(&release->node);
-				list_add_tail(&release->node, &curr->node);
-			}
-			done = true;
-			break;
+	list_del(&release->node);
+	ctx->free_size += release->size;
+	ctx->num_reserved--;
+
+	free_block_insert_addr(ctx, release);
+	ctx->num_free++;
+
+	/* if the immediate previous node is available for merge.*/
+	node = rb_prev(&release->addr_node);
+	if (node) {
+		prev = rb_entry(node, struct block_t, addr_node);
+		if ((prev->address + prev->size) == release->address) {
+			rb_erase(&release->addr_node, &ctx->free_by_addr);
+			rb_erase(&prev->size_node, &ctx->free_by_size);
+			prev->size += release->size;
+			kfree(release);
+			ctx->num_free--;
+			release = prev;
 		}
-		prev = curr;
 	}
 
-	/*
-	 * Even if after traversing each entry in list, we could not
-	 * add the block to be released back in free list, because:
-	 */
-	if (!done) {
-		if (!list_empty(ctx->free_list)) {
-			/*
-			 * The block to be freed has the highest order
-			 * address of all the existing blocks in free list.
-			 */
-			struct block_t *last =
-			list_last_entry(ctx->free_list, struct block_t, node);
-			if ((last->address + last->size) == release->address) {
-				/* can be merged with last node of list.*/
-				last->size += release->size;
-				list_del(&release->node);
-				kfree(release);
-			} else {
-				/* cannot be merged, add as the last node.*/
-				list_del(&release->node);
-				list_add_tail(&release->node, ctx->free_list);
-			}
-		} else {
-			/* free list was empty.*/
-			list_del(&release->node);
-			list_add_tail(&release->node, ctx->free_list);
+	/* if the immediate next node is also available for merge.*/
+	node = rb_next(&release->addr_node);
+	if (node) {
+		next = rb_entry(node, struct block_t, addr_node);
+		if (next->address == (release->address + release->size)) {
+			rb_erase(&next->addr_node, &ctx->free_by_addr);
+			rb_erase(&next->size_node, &ctx->free_by_size);
+			release->size += next->size;
+			kfree(next);
+			ctx->num_free--;
 		}
 	}
+
+	free_block_insert_size(ctx, release);
 	*block_handle = NULL;
 
 	mutex_unlock(&ctx->lock);
@@ -255,16 +295,19 @@ iova_mngr_print(void *mngr_handle)
 {
 	struct mngr_ctx_t *ctx = (struct mngr_ctx_t *)(mngr_handle);
 	struct block_t *block = NULL;
+	struct rb_node *node = NULL;
 
 	if (ctx) {
 		mutex_lock(&ctx->lock);
 		pr_debug("(%s): Reserved\n", ctx->name);
-		list_for_each_entry(block, ctx->reserved_list, node) {
+		list_for_each_entry(block, &ctx->reserved_list, node) {
 			pr_debug("\t\t (%s): address = 0x%pa[p], size = 0x%lx\n",
 				 ctx->name, &block->address, block->size);
 		}
 		pr_debug("(%s): Free\n", ctx->name);
-		list_for_each_entry(block, ctx->free_list, node) {
+		for (node = rb_first(&ctx->free_by_addr); node;
+		     node = rb_next(node)) {
+			block = rb_entry(node, struct block_t, addr_node);
 			pr_debug("\t\t (%s): address = 0x%pa[p], size = 0x%lx\n",
 				 ctx->name, &block->address, block->size);
 		}
@@ -272,10 +315,64 @@ iova_mngr_print(void *mngr_handle)
 	}
 }
 
+static int
+iova_mngr_stats_show(struct seq_file *s, void *data)
+{
+	struct mngr_ctx_t *ctx = s->private;
+	struct block_t *largest = NULL;
+	struct rb_node *node = NULL;
+	size_t largest_size = 0;
+	u64 fragmentation = 0;
+
+	mutex_lock(&ctx->lock);
+	node = rb_last(&ctx->free_by_size);
+	if (node) {
+		largest = rb_entry(node, struct block_t, size_node);
+		largest_size = largest->size;
+	}
+
+	/* share of free space not usable by the largest reserve, in 0.1%.*/
+	if (ctx->free_size)
+		fragmentation = div64_u64((u64)(ctx->free_size - largest_size) *
+					  1000, ctx->free_size);
+
+	seq_printf(s, "size: 0x%zx\n", ctx->size);
+	seq_printf(s, "reserved_blocks: %llu\n", ctx->num_reserved);
+	seq_printf(s, "reserved_size: 0x%zx\n", ctx->size - ctx->free_size);
+	seq_printf(s, "free_blocks: %llu\n", ctx->num_free);
+	seq_printf(s, "free_size: 0x%zx\n", ctx->free_size);
+	seq_printf(s, "largest_free_block: 0x%zx\n", largest_size);
+	seq_printf(s, "fragmentation: %llu.%llu%%\n",
+		   fragmentation / 10, fragmentation % 10);
+	seq_printf(s, "reserve_failures: %llu\n", ctx->reserve_failures);
+	mutex_unlock(&ctx->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(iova_mngr_stats);
+
+/*
+ * iova_mngr_debugfs_init
+ *
+ * Creates a debugfs file named after the IOVA space manager in parent,
+ * reporting the reserved and free space and their fragmentation.
+ */
+void
+iova_mngr_debugfs_init(void *mngr_handle, struct dentry *parent)
+{
+	struct mngr_ctx_t *ctx = (struct mngr_ctx_t *)(mngr_handle);
+
+	if (!ctx)
+		return;
+
+	debugfs_create_file(ctx->name, 0444, parent, ctx,
+			    &iova_mngr_stats_fops);
+}
+
 /*
  * Initialises the IOVA space manager with the base address + size
- * provided. IOVA manager would use two lists for book-keeping reserved
- * memory blocks and free memory blocks.
+ * provided. IOVA manager would use a list for book-keeping reserved
+ * memory blocks and two trees for free memory blocks.
  *
  * When initialised all of the IOVA region: base_address + size is free.
  */
@@ -296,17 +393,10 @@ iova_mngr_init(char *name, u64 base_address, size_t size, void **mngr_handle)
 		goto err;
 	}
 
-	ctx->free_list = kzalloc(sizeof(*ctx->free_list), GFP_KERNEL);
-	if (WARN_ON(!ctx->free_list)) {
-		ret = -ENOMEM;
-		goto err;
-	}
-
-	ctx->reserved_list = kzalloc(sizeof(*ctx->reserved_list), GFP_KERNEL);
-	if (WARN_ON(!ctx->reserved_list)) {
-		ret = -ENOMEM;
-		goto err;
-	}
+	ctx->free_by_addr = RB_ROOT;
+	ctx->free_by_size = RB_ROOT;
+	INIT_LIST_HEAD(&ctx->reserved_list);
+	mutex_init(&ctx->lock);
 
 	if (strlen(name) > (NAME_MAX - 1)) {
 		ret = -EINVAL;
@@ -314,10 +404,8 @@ iova_mngr_init(char *name, u64 base_address, size_t size, void **mngr_handle)
 		goto err;
 	}
 	strcpy(ctx->name, name);
-	INIT_LIST_HEAD(ctx->reserved_list);
-	INIT_LIST_HEAD(ctx->free_list);
-	mutex_init(&ctx->lock);
 	ctx->base_address = base_address;
+	ctx->size = size;
 
 	/* add the base_addrss+size as one whole free block.*/
 	block = kzalloc(sizeof(*block), GFP_KERNEL);
@@ -327,7 +415,10 @@ iova_mngr_init(char *name, u64 base_address, size_t size, void **mngr_handle)
 	}
 	block->address = base_address;
 	block->size = size;
-	list_add(&block->node, ctx->free_list);
+	free_block_insert_addr(ctx, block);
+	free_block_insert_size(ctx, block);
+	ctx->free_size = size;
+	ctx->num_free = 1;
 
 	*mngr_handle = ctx;
 	return ret;
@@ -345,8 +436,7 @@ err:
 void
 iova_mngr_deinit(void **mngr_handle)
 {
-	struct block_t *block = NULL;
-	struct list_head *curr = NULL, *next = NULL;
+	struct block_t *block = NULL, *next = NULL;
 	struct mngr_ctx_t *ctx = (struct mngr_ctx_t *)(*mngr_handle);
 
 	if (ctx) {
@@ -354,24 +444,17 @@ iova_mngr_deinit(void **mngr_handle)
 		iova_mngr_print(*mngr_handle);
 
 		/* ideally, all blocks should have returned before this.*/
-		if (!list_empty(ctx->reserved_list)) {
-			list_for_each_safe(curr, next, ctx->reserved_list) {
-				block = list_entry(curr, struct block_t, node);
-				iova_mngr_block_release(*mngr_handle,
-							(void **)(&block));
-			}
-		}
+		list_for_each_entry_safe(block, next, &ctx->reserved_list, node)
+			iova_mngr_block_release(*mngr_handle,
+						(void **)(&block));
 
 		/* ideally, just one whole free block should remain as free.*/
-		list_for_each_safe(curr, next, ctx->free_list) {
-			block = list_entry(curr, struct block_t, node);
-			list_del(&block->node);
+		rbtree_postorder_for_each_entry_safe(block, next,
+						     &ctx->free_by_addr,
+						     addr_node)
 			kfree(block);
-		}
 
 		mutex_destroy(&ctx->lock);
-		kfree(ctx->reserved_list);
-		kfree(ctx->free_list);
 		kfree(ctx);
 		*mngr_handle = NULL;
 	}
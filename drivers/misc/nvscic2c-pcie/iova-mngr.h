@@ -1,17 +1,20 @@
 /* SPDX-License-Identifier: GPL-2.0-only */
-/* Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved. */
+/* Copyright (c) 2022-2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved. */
 
 #ifndef __IOVA_MNGR_H__
 #define __IOVA_MNGR_H__
 
 #include <linux/types.h>
 
+struct dentry;
+
 /*
  * iova_mngr_block_reserve
  *
- * Reserves a block from the free IOVA regions. Once reserved, the block
- * is marked reserved and appended in the reserved list. Use
- * iova_mngr_block_get_address to fetch the address of the block reserved.
+ * Reserves the best fitting block from the free IOVA regions in O(log n).
+ * Once reserved, the block is marked reserved and appended in the reserved
+ * list. Use iova_mngr_block_get_address to fetch the address of the block
+ * reserved.
  */
 int
 iova_mngr_block_reserve(void *mngr_handle, size_t size,
@@ -22,7 +25,7 @@ iova_mngr_block_reserve(void *mngr_handle, size_t size,
  * iova_mngr_block_release
  *
  * Release an already reserved IOVA block/chunk by the caller back to
- * free list.
+ * free trees, merging it with its free neighbours in O(log n).
  */
 int
 iova_mngr_block_release(void *mngr_handle, void **block_handle);
@@ -37,12 +40,21 @@ iova_mngr_block_release(void *mngr_handle, void **block_handle);
  */
 void iova_mngr_print(void *handle);
 
+/*
+ * iova_mngr_debugfs_init
+ *
+ * Creates a debugfs file named after the IOVA space manager in parent,
+ * reporting the reserved and free space and their fragmentation.
+ */
+void
+iova_mngr_debugfs_init(void *mngr_handle, struct dentry *parent);
+
 /*
  * iova_mngr_init
  *
  * Initialises the IOVA space manager with the base address + size
- * provided. IOVA manager would use two lists for book-keeping reserved
- * memory blocks and free memory blocks.
+ * provided. IOVA manager would use a list for book-keeping reserved
+ * memory blocks and two trees for free memory blocks.
  *
  * When initialised all of the IOVA region: base_address + size is free.
  */
@@ -5,6 +5,7 @@
 
 #include <nvidia/conftest.h>
 
+#include <linux/debugfs.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-map-ops.h>
 #include <linux/errno.h>
@@ -86,6 +87,9 @@ struct pci_client_t {
 	 */
 	void *mem_mngr_h;
 
+	/* debugfs directory of this pci client, for iova-mngr statistics. */
+	struct dentry *debugfs;
+
 	/* eDMA error memory for each endpoint. */
 	struct cpu_buff_t ep_edma_err_mem[MAX_LINK_EVENT_USERS];
 	/*
@@ -279,6 +283,7 @@ pci_client_init(struct pci_client_params *params, void **pci_client_h)
 {
 	u32 i = 0;
 	int ret = 0;
+	char name[NAME_MAX] = {0};
 	struct pci_client_t *ctx = NULL;
 
 	/* should not be an already instantiated pci client context. */
@@ -337,6 +342,10 @@ pci_client_init(struct pci_client_params *params, void **pci_client_h)
 		goto err;
 	}
 
+	snprintf(name, sizeof(name), "nvscic2c-pcie-%s", dev_name(ctx->dev));
+	ctx->debugfs = debugfs_create_dir(name, NULL);
+	iova_mngr_debugfs_init(ctx->mem_mngr_h, ctx->debugfs);
+
 	/*
 	 * Skip reserved iova for any use. This area in BAR0 is reserved for
 	 * GIC SPI interrupt mechanism. As the allocation, fragmentration
@@ -369,6 +378,9 @@ pci_client_deinit(void **pci_client_h)
 
 	free_edma_rx_desc_iova(ctx);
 
+	debugfs_remove_recursive(ctx->debugfs);
+	ctx->debugfs = NULL;
+
 	if (ctx->mem_mngr_h) {
 		iova_mngr_deinit(&ctx->mem_mngr_h);
 		ctx->mem_mngr_h = NULL;
@@ -12,10 +12,14 @@
 #include <linux/file.h>
 #include <linux/fs.h>
 #include <linux/host1x-next.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/syscalls.h>
 #include <linux/tegra-pcie-edma.h>
 
@@ -36,6 +40,25 @@ MODULE_IMPORT_NS(VFS_internal_I_am_really_a_filesystem_and_am_NOT_a_driver);
 /* forward declaration.*/
 struct stream_ext_ctx_t;
 struct stream_ext_obj;
+struct copy_request;
+
+/*
+ * Copy requests of at least edma_stripe_min_size are split in stripes over
+ * edma_stripe_channels eDMA write channels. Smaller copy requests are
+ * distributed over the same channels whole.
+ */
+static unsigned int edma_stripe_channels = 1;
+module_param(edma_stripe_channels, uint, 0644);
+MODULE_PARM_DESC(edma_stripe_channels,
+		 "eDMA write channels copy requests are spread on (1-4)");
+
+static unsigned int edma_stripe_min_size = SZ_1M;
+module_param(edma_stripe_min_size, uint, 0644);
+MODULE_PARM_DESC(edma_stripe_min_size,
+		 "Minimum copy request size in bytes split over eDMA channels");
+
+/* stripe boundaries, in multiples of the largest page size. */
+#define EDMA_STRIPE_ALIGN	(SZ_64K)
 
 /* limits as set for copy requests.*/
 struct copy_req_limits {
@@ -60,6 +83,16 @@ struct copy_req_params {
 	struct nvscic2c_pcie_flush_range *flush_ranges;
 };
 
+/* part of one copy request submitted to one eDMA write channel.*/
+struct copy_stripe {
+	/* back-reference to copy_request, used in eDMA callback.*/
+	struct copy_request *cr;
+	u32 channel;
+	u32 num_desc;
+	struct tegra_pcie_edma_desc *desc;
+	u64 size;
+};
+
 /* one copy request.*/
 struct copy_request {
 	/* book-keeping for copy completion.*/
@@ -127,6 +160,34 @@ struct copy_request {
 	 */
 	u64 *remote_post_fence_values;
 	enum peer_cpu_t peer_cpu;
+
+	/*
+	 * eDMA descriptors of edma_desc, split at the stripe boundaries.
+	 * space considering worst-case allocation:
+	 * (max_flush_ranges + DMA_WR_CHNL_NUM - 1).
+	 */
+	struct tegra_pcie_edma_desc *stripe_desc;
+	u32 num_stripes;
+	struct copy_stripe stripes[DMA_WR_CHNL_NUM];
+
+	/*
+	 * stripes yet to complete, plus one held by the submitter. The post
+	 * fences are signalled once all the stripes completed and all the
+	 * copy requests submitted before are done.
+	 */
+	atomic_t stripes_pending;
+	edma_xfer_status_t status;
+	bool done;
+};
+
+/* usage of one eDMA write channel by the endpoint.*/
+struct edma_chan_stats {
+	u32 outstanding;
+	ktime_t busy_start;
+	u64 busy_ns;
+	u64 bytes;
+	u64 xfers;
+	u64 errors;
 };
 
 struct stream_ext_obj {
@@ -205,13 +266,24 @@ struct stream_ext_ctx_t {
 
 	/* Async copy: book-keeping copy-requests: free and in-progress.*/
 	struct list_head free_list;
-	/* guard free_list.*/
+	/* in-progress copy-requests, in the order they were submitted.*/
+	struct list_head inflight_list;
+	/* guard free_list and inflight_list.*/
 	struct mutex free_lock;
 	atomic_t transfer_count;
 	wait_queue_head_t transfer_waitq;
 
 	/* allocated stream obj list for book-keeping.*/
 	struct list_head obj_list;
+
+	/* eDMA write channel for the next copy-request not striped.*/
+	u32 next_channel;
+
+	/* eDMA write channel usage since the endpoint was opened.*/
+	spinlock_t stats_lock;
+	ktime_t stats_start;
+	u64 striped_requests;
+	struct edma_chan_stats chan_stats[DMA_WR_CHNL_NUM];
 };
 
 static int
@@ -230,9 +302,15 @@ static int
 prepare_edma_desc(enum drv_mode_t drv_mode, struct copy_req_params *params,
 		  struct tegra_pcie_edma_desc *desc, u64 *num_desc);
 
+static void
+stripe_edma_desc(struct stream_ext_ctx_t *ctx, struct copy_request *cr);
+
 static edma_xfer_status_t
-schedule_edma_xfer(void *edma_h, void *priv, u64 num_desc,
-		   struct tegra_pcie_edma_desc *desc);
+schedule_edma_xfer(struct stream_ext_ctx_t *ctx, struct copy_stripe *stripe);
+static void
+complete_copy_request(struct copy_request *cr);
+static u32
+retire_copy_requests(struct stream_ext_ctx_t *ctx);
 static void
 callback_edma_xfer(void *priv, edma_xfer_status_t status,
 		   struct tegra_pcie_edma_desc *desc);
@@ -244,6 +322,10 @@ allocate_handle(struct stream_ext_ctx_t *ctx,
 		enum nvscic2c_pcie_obj_type type,
 		void *ioctl_args);
 static int
+append_args_from_user(struct stream_ext_ctx_t *ctx,
+		      struct nvscic2c_pcie_submit_copy_args *args,
+		      struct copy_req_params *params);
+static int
 copy_args_from_user(struct stream_ext_ctx_t *ctx,
 		    struct nvscic2c_pcie_submit_copy_args *args,
 		    struct copy_req_params *params);
@@ -549,29 +631,18 @@ ioctl_map_obj(struct stream_ext_ctx_t *ctx,
 	return ret;
 }
 
-/* implement NVSCIC2C_PCIE_IOCTL_SUBMIT_COPY_REQUEST ioctl call. */
+/*
+ * Submit the copied and validated submit-copy params as one copy-request:
+ * one eDMA descriptor list and one signal of the post-fences on completion.
+ */
 static int
-ioctl_submit_copy_request(struct stream_ext_ctx_t *ctx,
-			  struct nvscic2c_pcie_submit_copy_args *args)
+submit_copy_req_params(struct stream_ext_ctx_t *ctx,
+		       struct copy_req_params *params)
 {
 	int ret = 0;
+	u32 i = 0, retired = 0;
 	struct copy_request *cr = NULL;
 	edma_xfer_status_t edma_status = EDMA_XFER_FAIL_INVAL_INPUTS;
-	enum nvscic2c_pcie_link link = NVSCIC2C_PCIE_LINK_DOWN;
-
-	link = pci_client_query_link_status(ctx->pci_client_h);
-	if (link != NVSCIC2C_PCIE_LINK_UP)
-		return -ENOLINK;
-
-	/* copy user-supplied submit-copy args.*/
-	ret = copy_args_from_user(ctx, args, &ctx->cr_params);
-	if (ret)
-		return ret;
-
-	/* validate the user-supplied handles in flush_range and post-fence.*/
-	ret = validate_copy_req_params(ctx, &ctx->cr_params);
-	if (ret)
-		return ret;
 
 	/* get one copy-request from the free list.*/
 	mutex_lock(&ctx->free_lock);
@@ -595,30 +666,60 @@ ioctl_submit_copy_request(struct stream_ext_ctx_t *ctx,
 	 * for the same set of handles, the handles would be marked for deletion
 	 * but doesn't actually get deleted.
 	 */
-	ret = cache_copy_request_handles(&ctx->cr_params, cr);
+	ret = cache_copy_request_handles(params, cr);
 	if (ret)
 		goto reclaim_cr;
 
 	cr->peer_cpu = pci_client_get_peer_cpu(ctx->pci_client_h);
 	/* generate eDMA descriptors from flush_ranges.*/
-	ret = prepare_edma_desc(ctx->drv_mode, &ctx->cr_params, cr->edma_desc,
+	ret = prepare_edma_desc(ctx->drv_mode, params, cr->edma_desc,
 				&cr->num_edma_desc);
 	if (ret) {
 		release_copy_request_handles(cr);
 		goto reclaim_cr;
 	}
 
+	/* split large copy-requests over the eDMA write channels.*/
+	stripe_edma_desc(ctx, cr);
+	cr->status = EDMA_XFER_SUCCESS;
+	cr->done = false;
+	atomic_set(&cr->stripes_pending, cr->num_stripes + 1);
+
+	mutex_lock(&ctx->free_lock);
+	list_add_tail(&cr->node, &ctx->inflight_list);
+	mutex_unlock(&ctx->free_lock);
+
 	/* schedule asynchronous eDMA.*/
 	atomic_inc(&ctx->transfer_count);
-	edma_status = schedule_edma_xfer(ctx->edma_h, (void *)cr,
-					 cr->num_edma_desc, cr->edma_desc);
-	if (edma_status != EDMA_XFER_SUCCESS) {
+	for (i = 0; i < cr->num_stripes; i++) {
+		edma_status = schedule_edma_xfer(ctx, &cr->stripes[i]);
+		if (edma_status != EDMA_XFER_SUCCESS)
+			break;
+	}
+
+	if (i == 0) {
+		/* nothing in flight, copy-request can be taken back.*/
+		mutex_lock(&ctx->free_lock);
+		list_del(&cr->node);
+		retired = retire_copy_requests(ctx);
+		mutex_unlock(&ctx->free_lock);
+		if (atomic_sub_and_test(retired + 1, &ctx->transfer_count))
+			wake_up_all(&ctx->transfer_waitq);
 		ret = -EIO;
-		atomic_dec(&ctx->transfer_count);
 		release_copy_request_handles(cr);
 		goto reclaim_cr;
 	}
 
+	if (i != cr->num_stripes) {
+		/* stripes in flight fail the copy-request on completion.*/
+		ret = -EIO;
+		WRITE_ONCE(cr->status, edma_status);
+	}
+
+	/* drop the stripes not submitted and the submitter reference.*/
+	if (atomic_sub_and_test(cr->num_stripes - i + 1, &cr->stripes_pending))
+		complete_copy_request(cr);
+
 	return ret;
 
 reclaim_cr:
@@ -628,6 +729,85 @@ reclaim_cr:
 	return ret;
 }
 
+/* implement NVSCIC2C_PCIE_IOCTL_SUBMIT_COPY_REQUEST ioctl call. */
+static int
+ioctl_submit_copy_request(struct stream_ext_ctx_t *ctx,
+			  struct nvscic2c_pcie_submit_copy_args *args)
+{
+	int ret = 0;
+	enum nvscic2c_pcie_link link = NVSCIC2C_PCIE_LINK_DOWN;
+
+	link = pci_client_query_link_status(ctx->pci_client_h);
+	if (link != NVSCIC2C_PCIE_LINK_UP)
+		return -ENOLINK;
+
+	/* copy user-supplied submit-copy args.*/
+	ret = copy_args_from_user(ctx, args, &ctx->cr_params);
+	if (ret)
+		return ret;
+
+	/* validate the user-supplied handles in flush_range and post-fence.*/
+	ret = validate_copy_req_params(ctx, &ctx->cr_params);
+	if (ret)
+		return ret;
+
+	return submit_copy_req_params(ctx, &ctx->cr_params);
+}
+
+/*
+ * implement NVSCIC2C_PCIE_IOCTL_SUBMIT_COPY_BATCH ioctl call.
+ *
+ * The submit-copy args of the batch are gathered in one copy-request, so
+ * the total flush-ranges and post-fences of the batch are bound by the
+ * limits of one copy-request.
+ */
+static int
+ioctl_submit_copy_batch(struct stream_ext_ctx_t *ctx,
+			struct nvscic2c_pcie_submit_copy_batch_args *args)
+{
+	u64 i = 0;
+	int ret = 0;
+	struct nvscic2c_pcie_submit_copy_args cr_args = {0};
+	struct nvscic2c_pcie_submit_copy_args __user *user_args = NULL;
+	struct copy_req_params *params = &ctx->cr_params;
+	enum nvscic2c_pcie_link link = NVSCIC2C_PCIE_LINK_DOWN;
+
+	link = pci_client_query_link_status(ctx->pci_client_h);
+	if (link != NVSCIC2C_PCIE_LINK_UP)
+		return -ENOLINK;
+
+	if (!args->num_copy_requests ||
+	    args->num_copy_requests > ctx->cr_limits.max_copy_requests)
+		return -EINVAL;
+
+	/* copy and gather user-supplied submit-copy args of the batch.*/
+	params->num_local_post_fences = 0;
+	params->num_remote_post_fences = 0;
+	params->num_flush_ranges = 0;
+	user_args = (void __user *)args->copy_requests;
+	for (i = 0; i < args->num_copy_requests; i++) {
+		if (copy_from_user(&cr_args, &user_args[i], sizeof(cr_args)))
+			return -EFAULT;
+
+		ret = append_args_from_user(ctx, &cr_args, params);
+		if (ret)
+			return ret;
+	}
+
+	/* post-fences may be on any of the batch, at least one of each.*/
+	if (!params->num_local_post_fences ||
+	    !params->num_remote_post_fences ||
+	    !params->num_flush_ranges)
+		return -EINVAL;
+
+	/* validate the user-supplied handles in flush_range and post-fence.*/
+	ret = validate_copy_req_params(ctx, params);
+	if (ret)
+		return ret;
+
+	return submit_copy_req_params(ctx, params);
+}
+
 /* implement NVSCIC2C_PCIE_IOCTL_MAX_COPY_REQUESTS ioctl call. */
 static int
 ioctl_set_max_copy_requests(struct stream_ext_ctx_t *ctx,
@@ -690,6 +870,35 @@ clean_up:
 	return ret;
 }
 
+/* implement NVSCIC2C_PCIE_IOCTL_GET_EDMA_STATS ioctl call. */
+static int
+ioctl_get_edma_stats(struct stream_ext_ctx_t *ctx,
+		     struct nvscic2c_pcie_edma_stats_args *args)
+{
+	u32 i = 0;
+	ktime_t now = ktime_get();
+	struct edma_chan_stats *stats = NULL;
+
+	BUILD_BUG_ON(NVSCIC2C_PCIE_EDMA_WR_CHANNELS != DMA_WR_CHNL_NUM);
+
+	spin_lock(&ctx->stats_lock);
+	args->elapsed_ns = ktime_to_ns(ktime_sub(now, ctx->stats_start));
+	args->striped_requests = ctx->striped_requests;
+	for (i = 0; i < DMA_WR_CHNL_NUM; i++) {
+		stats = &ctx->chan_stats[i];
+		args->chan[i].busy_ns = stats->busy_ns;
+		if (stats->outstanding)
+			args->chan[i].busy_ns +=
+				ktime_to_ns(ktime_sub(now, stats->busy_start));
+		args->chan[i].bytes = stats->bytes;
+		args->chan[i].xfers = stats->xfers;
+		args->chan[i].errors = stats->errors;
+	}
+	spin_unlock(&ctx->stats_lock);
+
+	return 0;
+}
+
 int
 stream_extension_ioctl(void *stream_ext_h, unsigned int cmd, void *args)
 {
@@ -731,6 +940,16 @@ stream_extension_ioctl(void *stream_ext_h, unsigned int cmd, void *args)
 			((struct stream_ext_ctx_t *)ctx,
 			 (struct nvscic2c_pcie_max_copy_args *)args);
 		break;
+	case NVSCIC2C_PCIE_IOCTL_SUBMIT_COPY_BATCH:
+		ret = ioctl_submit_copy_batch
+			((struct stream_ext_ctx_t *)ctx,
+			 (struct nvscic2c_pcie_submit_copy_batch_args *)args);
+		break;
+	case NVSCIC2C_PCIE_IOCTL_GET_EDMA_STATS:
+		ret = ioctl_get_edma_stats
+			((struct stream_ext_ctx_t *)ctx,
+			 (struct nvscic2c_pcie_edma_stats_args *)args);
+		break;
 	default:
 		pr_err("(%s): unrecognised nvscic2c-pcie ioclt cmd: 0x%x\n",
 		       ctx->ep_name, cmd);
@@ -774,8 +993,11 @@ stream_extension_init(struct stream_ext_params *params, void **stream_ext_h)
 	/* copy operations.*/
 	mutex_init(&ctx->free_lock);
 	INIT_LIST_HEAD(&ctx->free_list);
+	INIT_LIST_HEAD(&ctx->inflight_list);
 	atomic_set(&ctx->transfer_count, 0);
 	init_waitqueue_head(&ctx->transfer_waitq);
+	spin_lock_init(&ctx->stats_lock);
+	ctx->stats_start = ktime_get();
 
 	/* bookkeeping of stream objs. */
 	INIT_LIST_HEAD(&ctx->obj_list);
@@ -935,23 +1157,178 @@ allocate_handle(struct stream_ext_ctx_t *ctx, enum nvscic2c_pcie_obj_type type,
 	return handle;
 }
 
+/*
+ * Split the eDMA descriptors of the copy-request in up to
+ * edma_stripe_channels stripes of equal size, one per eDMA write channel.
+ */
+static void
+stripe_edma_desc(struct stream_ext_ctx_t *ctx, struct copy_request *cr)
+{
+	u32 i = 0;
+	u64 off = 0, cut = 0, total = 0, stripe_sz = 0;
+	u32 nr_chan = clamp_t(u32, edma_stripe_channels, 1, DMA_WR_CHNL_NUM);
+	struct tegra_pcie_edma_desc *src = NULL;
+	struct tegra_pcie_edma_desc *dst = cr->stripe_desc;
+	struct copy_stripe *stripe = &cr->stripes[0];
+
+	for (i = 0; i < cr->num_edma_desc; i++)
+		total += cr->edma_desc[i].sz;
+
+	if (nr_chan == 1 || total < edma_stripe_min_size) {
+		stripe->cr = cr;
+		stripe->channel = ctx->next_channel % nr_chan;
+		stripe->desc = cr->edma_desc;
+		stripe->num_desc = cr->num_edma_desc;
+		stripe->size = total;
+		cr->num_stripes = 1;
+		ctx->next_channel = (stripe->channel + 1) % nr_chan;
+		return;
+	}
+
+	/* nr_chan stripes of stripe_sz cover the copy-request.*/
+	stripe_sz = ALIGN(DIV_ROUND_UP_ULL(total, nr_chan), EDMA_STRIPE_ALIGN);
+
+	cr->num_stripes = 1;
+	stripe->cr = cr;
+	stripe->channel = 0;
+	stripe->desc = dst;
+	stripe->num_desc = 0;
+	stripe->size = 0;
+	for (i = 0; i < cr->num_edma_desc; i++) {
+		src = &cr->edma_desc[i];
+		for (off = 0; off < src->sz; off += cut) {
+			if (stripe->size == stripe_sz) {
+				stripe = &cr->stripes[cr->num_stripes];
+				stripe->cr = cr;
+				stripe->channel = cr->num_stripes;
+				stripe->desc = dst;
+				stripe->num_desc = 0;
+				stripe->size = 0;
+				cr->num_stripes++;
+			}
+			cut = min_t(u64, src->sz - off, stripe_sz - stripe->size);
+			dst->src = src->src + off;
+			dst->dst = src->dst + off;
+			dst->sz = (u32)cut;
+			dst++;
+			stripe->num_desc++;
+			stripe->size += cut;
+		}
+	}
+
+	spin_lock(&ctx->stats_lock);
+	ctx->striped_requests++;
+	spin_unlock(&ctx->stats_lock);
+}
+
+static void
+edma_chan_stats_start(struct stream_ext_ctx_t *ctx, u32 channel)
+{
+	struct edma_chan_stats *stats = &ctx->chan_stats[channel];
+
+	spin_lock(&ctx->stats_lock);
+	if (stats->outstanding++ == 0)
+		stats->busy_start = ktime_get();
+	spin_unlock(&ctx->stats_lock);
+}
+
+static void
+edma_chan_stats_end(struct stream_ext_ctx_t *ctx, struct copy_stripe *stripe,
+		    edma_xfer_status_t status)
+{
+	struct edma_chan_stats *stats = &ctx->chan_stats[stripe->channel];
+
+	spin_lock(&ctx->stats_lock);
+	if (--stats->outstanding == 0)
+		stats->busy_ns += ktime_to_ns(ktime_sub(ktime_get(),
+							stats->busy_start));
+	if (status == EDMA_XFER_SUCCESS) {
+		stats->bytes += stripe->size;
+		stats->xfers++;
+	} else {
+		stats->errors++;
+	}
+	spin_unlock(&ctx->stats_lock);
+}
+
 static edma_xfer_status_t
-schedule_edma_xfer(void *edma_h, void *priv, u64 num_desc,
-		   struct tegra_pcie_edma_desc *desc)
+schedule_edma_xfer(struct stream_ext_ctx_t *ctx, struct copy_stripe *stripe)
 {
+	edma_xfer_status_t status = EDMA_XFER_SUCCESS;
 	struct tegra_pcie_edma_xfer_info info = {0};
 
-	if (WARN_ON(!num_desc || !desc))
-		return -EINVAL;
+	if (WARN_ON(!stripe->num_desc || !stripe->desc))
+		return EDMA_XFER_FAIL_INVAL_INPUTS;
 
 	info.type = EDMA_XFER_WRITE;
-	info.channel_num = 0; // no use-case to use all WR channels yet.
-	info.desc = desc;
-	info.nents = num_desc;
+	info.channel_num = stripe->channel;
+	info.desc = stripe->desc;
+	info.nents = stripe->num_desc;
 	info.complete = callback_edma_xfer;
-	info.priv = priv;
+	info.priv = stripe;
+
+	edma_chan_stats_start(ctx, stripe->channel);
+	status = tegra_pcie_edma_submit_xfer(ctx->edma_h, &info);
+	if (status != EDMA_XFER_SUCCESS)
+		edma_chan_stats_end(ctx, stripe, status);
 
-	return tegra_pcie_edma_submit_xfer(edma_h, &info);
+	return status;
+}
+
+/*
+ * Signal the post fences of the done copy-requests at the head of the
+ * in-progress list, so that fences are signalled in submission order even
+ * when a later copy-request on another eDMA channel completes first.
+ * Returns the number of copy-requests reclaimed, must hold free_lock.
+ */
+static u32
+retire_copy_requests(struct stream_ext_ctx_t *ctx)
+{
+	u32 retired = 0;
+	struct copy_request *cr = NULL;
+
+	while (!list_empty(&ctx->inflight_list)) {
+		cr = list_first_entry(&ctx->inflight_list, struct copy_request,
+				      node);
+		if (!cr->done)
+			break;
+
+		/* increment post fences: local and remote.*/
+		if (cr->status == EDMA_XFER_SUCCESS) {
+			signal_remote_post_fences(cr);
+			signal_local_post_fences(cr);
+		} else {
+			/* eDMA xfer failed, Update eDMA error and notify user. */
+			(void)pci_client_set_edma_error(ctx->pci_client_h,
+							ctx->ep_id,
+							NVSCIC2C_PCIE_EDMA_XFER_ERROR);
+		}
+
+		/* releases the references of the cubmit-copy handles.*/
+		release_copy_request_handles(cr);
+
+		/* reclaim the copy_request for reuse.*/
+		list_move_tail(&cr->node, &ctx->free_list);
+		retired++;
+	}
+
+	return retired;
+}
+
+/* all the stripes of the copy-request completed.*/
+static void
+complete_copy_request(struct copy_request *cr)
+{
+	u32 retired = 0;
+	struct stream_ext_ctx_t *ctx = cr->ctx;
+
+	mutex_lock(&ctx->free_lock);
+	cr->done = true;
+	retired = retire_copy_requests(ctx);
+	mutex_unlock(&ctx->free_lock);
+
+	if (retired && atomic_sub_and_test(retired, &ctx->transfer_count))
+		wake_up_all(&ctx->transfer_waitq);
 }
 
 /* Callback with each async eDMA submit xfer.*/
@@ -959,29 +1336,16 @@ static void
 callback_edma_xfer(void *priv, edma_xfer_status_t status,
 		   struct tegra_pcie_edma_desc *desc)
 {
-	struct copy_request *cr = (struct copy_request *)priv;
-
-	mutex_lock(&cr->ctx->free_lock);
-	/* increment post fences: local and remote.*/
-	if (status == EDMA_XFER_SUCCESS) {
-		signal_remote_post_fences(cr);
-		signal_local_post_fences(cr);
-	} else {
-		/* eDMA xfer failed, Update eDMA error and notify user. */
-		(void)pci_client_set_edma_error(cr->ctx->pci_client_h,
-						cr->ctx->ep_id,
-						NVSCIC2C_PCIE_EDMA_XFER_ERROR);
-	}
+	struct copy_stripe *stripe = (struct copy_stripe *)priv;
+	struct copy_request *cr = stripe->cr;
 
-	/* releases the references of the cubmit-copy handles.*/
-	release_copy_request_handles(cr);
+	edma_chan_stats_end(cr->ctx, stripe, status);
 
-	/* reclaim the copy_request for reuse.*/
-	list_add_tail(&cr->node, &cr->ctx->free_list);
-	mutex_unlock(&cr->ctx->free_lock);
+	if (status != EDMA_XFER_SUCCESS)
+		WRITE_ONCE(cr->status, status);
 
-	if (atomic_dec_and_test(&cr->ctx->transfer_count))
-		wake_up_all(&cr->ctx->transfer_waitq);
+	if (atomic_dec_and_test(&cr->stripes_pending))
+		complete_copy_request(cr);
 }
 
 static int
@@ -1303,56 +1667,72 @@ validate_copy_req_params(struct stream_ext_ctx_t *ctx,
 	return ret;
 }
 
+/* append one user-supplied submit-copy args to the ones in params.*/
 static int
-copy_args_from_user(struct stream_ext_ctx_t *ctx,
-		    struct nvscic2c_pcie_submit_copy_args *args,
-		    struct copy_req_params *params)
+append_args_from_user(struct stream_ext_ctx_t *ctx,
+		      struct nvscic2c_pcie_submit_copy_args *args,
+		      struct copy_req_params *params)
 {
-	int ret = 0;
+	u64 max_post_fences = ctx->cr_limits.max_post_fences;
 
-	if (WARN_ON(!args->num_local_post_fences ||
-		    !args->num_flush_ranges ||
-		    !args->num_remote_post_fences))
+	if (args->num_local_post_fences > max_post_fences ||
+	    args->num_remote_post_fences > max_post_fences ||
+	    (params->num_local_post_fences + params->num_remote_post_fences +
+	     args->num_local_post_fences + args->num_remote_post_fences) >
+	    max_post_fences)
 		return -EINVAL;
-
-	if ((args->num_local_post_fences + args->num_remote_post_fences) >
-	    ctx->cr_limits.max_post_fences)
-		return -EINVAL;
-	if (args->num_flush_ranges > ctx->cr_limits.max_flush_ranges)
+	if (args->num_flush_ranges >
+	    ctx->cr_limits.max_flush_ranges - params->num_flush_ranges)
 		return -EINVAL;
 
-	params->num_local_post_fences = args->num_local_post_fences;
-	params->num_remote_post_fences = args->num_remote_post_fences;
-	params->num_flush_ranges = args->num_flush_ranges;
-
-	ret = copy_from_user(params->local_post_fences,
-			     (void __user *)args->local_post_fences,
-			     (params->num_local_post_fences * sizeof(s32)));
-	if (ret < 0)
+	if (copy_from_user(&params->local_post_fences
+				[params->num_local_post_fences],
+			   (void __user *)args->local_post_fences,
+			   (args->num_local_post_fences * sizeof(s32))))
 		return -EFAULT;
 
-	ret = copy_from_user(params->remote_post_fences,
-			     (void __user *)args->remote_post_fences,
-			     (params->num_remote_post_fences * sizeof(s32)));
-	if (ret < 0)
+	if (copy_from_user(&params->remote_post_fences
+				[params->num_remote_post_fences],
+			   (void __user *)args->remote_post_fences,
+			   (args->num_remote_post_fences * sizeof(s32))))
 		return -EFAULT;
 
-	ret = copy_from_user(params->remote_post_fence_values,
-			     (void __user *)args->remote_post_fence_values,
-			     (params->num_remote_post_fences * sizeof(u64)));
-	if (ret < 0)
+	if (copy_from_user(&params->remote_post_fence_values
+				[params->num_remote_post_fences],
+			   (void __user *)args->remote_post_fence_values,
+			   (args->num_remote_post_fences * sizeof(u64))))
 		return -EFAULT;
 
-	ret = copy_from_user(params->flush_ranges,
-			     (void __user *)args->flush_ranges,
-			     (params->num_flush_ranges *
-			      sizeof(struct nvscic2c_pcie_flush_range)));
-	if (ret < 0)
+	if (copy_from_user(&params->flush_ranges[params->num_flush_ranges],
+			   (void __user *)args->flush_ranges,
+			   (args->num_flush_ranges *
+			    sizeof(struct nvscic2c_pcie_flush_range))))
 		return -EFAULT;
 
+	params->num_local_post_fences += args->num_local_post_fences;
+	params->num_remote_post_fences += args->num_remote_post_fences;
+	params->num_flush_ranges += args->num_flush_ranges;
+
 	return 0;
 }
 
+static int
+copy_args_from_user(struct stream_ext_ctx_t *ctx,
+		    struct nvscic2c_pcie_submit_copy_args *args,
+		    struct copy_req_params *params)
+{
+	if (WARN_ON(!args->num_local_post_fences ||
+		    !args->num_flush_ranges ||
+		    !args->num_remote_post_fences))
+		return -EINVAL;
+
+	params->num_local_post_fences = 0;
+	params->num_remote_post_fences = 0;
+	params->num_flush_ranges = 0;
+
+	return append_args_from_user(ctx, args, params);
+}
+
 static void
 free_copy_request(struct copy_request **copy_request)
 {
@@ -1365,6 +1745,7 @@ free_copy_request(struct copy_request **copy_request)
 	kfree(cr->remote_post_fences);
 	kfree(cr->remote_buf_objs);
 	kfree(cr->remote_post_fence_values);
+	kfree(cr->stripe_desc);
 	kfree(cr->edma_desc);
 	kfree(cr->handles);
 	kfree(cr);
@@ -1407,6 +1788,16 @@ allocate_copy_request(struct stream_ext_ctx_t *ctx,
 		goto err;
 	}
 
+	/* each stripe boundary may split one more edma_desc.*/
+	cr->stripe_desc = kzalloc((sizeof(*cr->stripe_desc) *
+				  (ctx->cr_limits.max_flush_ranges +
+				   DMA_WR_CHNL_NUM - 1)),
+				  GFP_KERNEL);
+	if (WARN_ON(!cr->stripe_desc)) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
 	/* OR all max_post_fences could be local_post_fence. */
 	cr->local_post_fences = kzalloc((sizeof(*cr->local_post_fences) *
 					ctx->cr_limits.max_post_fences),
@@ -5,6 +5,7 @@
 #define __VMAP_INTERNAL_H__
 
 #include <linux/dma-buf.h>
+#include <linux/hashtable.h>
 #include <linux/pci.h>
 
 #include "common.h"
@@ -13,6 +14,9 @@
 /* forward declaration. */
 struct vmap_ctx_t;
 
+/* buckets of the pin cache, by dma_buf or syncpoint id.*/
+#define PIN_CACHE_HASH_BITS	(6)
+
 struct memobj_pin_t {
 	/* Input param fd -> dma_buf to be mapped.*/
 	struct dma_buf *dmabuf;
@@ -106,6 +110,21 @@ struct importobj_map_ref {
 	struct vmap_ctx_t *vmap_ctx;
 };
 
+/*
+ * pin of an unmapped Mem or Sync obj, kept in the pin cache for mapping
+ * the same dma_buf or syncpoint again without pinning it again.
+ */
+struct pin_cache_entry {
+	struct hlist_node node;
+	struct list_head lru;
+	enum vmap_obj_type type;
+	size_t size;
+	union {
+		struct memobj_pin_t mem;
+		struct syncobj_pin_t sync;
+	} pin;
+};
+
 /* vmap subunit/abstraction context. */
 struct vmap_ctx_t {
 	/* pci-client abstraction handle.*/
@@ -145,6 +164,17 @@ struct vmap_ctx_t {
 	struct mutex sync_idr_lock;
 	/* exclusive access to import idr.*/
 	struct mutex import_idr_lock;
+
+	/*
+	 * Pins of unmapped Mem and Sync objs, hashed by dma_buf or syncpoint
+	 * id and least recently unmapped first in lru. Taken after the idr
+	 * lock when both are held.
+	 */
+	DECLARE_HASHTABLE(pin_cache, PIN_CACHE_HASH_BITS);
+	struct list_head pin_cache_lru;
+	u32 pin_cache_objs;
+	size_t pin_cache_bytes;
+	struct mutex pin_cache_lock;
 };
 
 void
@@ -174,5 +204,7 @@ syncobj_unpin(struct vmap_ctx_t *vmap_ctx,
 int
 syncobj_pin(struct vmap_ctx_t *vmap_ctx,
 	    struct syncobj_pin_t *pin);
+bool
+syncobj_pin_match(struct syncobj_pin_t *pin, s32 fd);
 
 #endif //__VMAP_INTERNAL_H__
@@ -380,4 +380,24 @@ err:
 	return ret;
 }
 
+/*
+ * Check the syncpoint of an existing pin is the one syncobj_pin() would get
+ * for fd, before the pin is handed out again.
+ */
+bool
+syncobj_pin_match(struct syncobj_pin_t *pin, s32 fd)
+{
+	struct host1x_syncpt *sp = NULL;
+	bool match = false;
+
+	sp = tegra_drm_get_syncpt(fd, pin->syncpt_id);
+	if (IS_ERR_OR_NULL(sp))
+		return false;
+
+	match = (sp == pin->sp);
+	host1x_syncpt_put(sp);
+
+	return match;
+}
+
 MODULE_IMPORT_NS(DMA_BUF);
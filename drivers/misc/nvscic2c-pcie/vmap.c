@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: GPL-2.0-only
-// Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// Copyright (c) 2022-2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
 
 #define pr_fmt(fmt)	"nvscic2c-pcie: vmap: " fmt
 
@@ -13,11 +13,15 @@
 
 #include <linux/device.h>
 #include <linux/errno.h>
+#include <linux/file.h>
+#include <linux/hashtable.h>
 #include <linux/kernel.h>
+#include <linux/moduleparam.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/printk.h>
+#include <linux/sizes.h>
 #include <linux/types.h>
 
 /*
@@ -30,6 +34,201 @@
 #define SYNCOBJ_END	(MAX_STREAM_SYNCOBJS)
 #define IMPORTOBJ_END	(MAX_STREAM_MEMOBJS + MAX_STREAM_SYNCOBJS)
 
+/*
+ * Unmapped Mem and Sync objs keep their pin in the pin cache, for the
+ * producers re-using the same buffers after a reconnect to map them again
+ * without the PCIe mapping setup. The cache is bounded by both limits below
+ * and is dropped whenever pinning runs out of iova.
+ */
+static unsigned int pin_cache_max_objs = 256;
+module_param(pin_cache_max_objs, uint, 0644);
+MODULE_PARM_DESC(pin_cache_max_objs,
+		 "Pins of unmapped Mem and Sync objs kept for re-use, 0 disables the pin cache");
+
+static unsigned int pin_cache_max_mb = 256;
+module_param(pin_cache_max_mb, uint, 0644);
+MODULE_PARM_DESC(pin_cache_max_mb,
+		 "Size in MB of the pins of unmapped objs kept for re-use");
+
+static void
+pin_cache_release(struct vmap_ctx_t *vmap_ctx, struct list_head *evict)
+{
+	struct pin_cache_entry *entry = NULL, *temp = NULL;
+
+	list_for_each_entry_safe(entry, temp, evict, lru) {
+		list_del(&entry->lru);
+		if (entry->type == VMAP_OBJ_TYPE_MEM)
+			memobj_unpin(vmap_ctx, &entry->pin.mem);
+		else
+			syncobj_unpin(vmap_ctx, &entry->pin.sync);
+		kfree(entry);
+	}
+}
+
+/*
+ * A Mem obj pin no one else holds the dma_buf of can never be mapped again.
+ */
+static bool
+pin_cache_entry_dead(struct pin_cache_entry *entry)
+{
+	return (entry->type == VMAP_OBJ_TYPE_MEM &&
+		file_count(entry->pin.mem.dmabuf->file) == 1);
+}
+
+/*
+ * must be called with pin_cache_lock held. Moves the least recently
+ * unmapped entries beyond the limits and the dead ones to evict.
+ */
+static void
+pin_cache_trim(struct vmap_ctx_t *vmap_ctx, u32 max_objs, size_t max_bytes,
+	       struct list_head *evict)
+{
+	struct pin_cache_entry *entry = NULL, *temp = NULL;
+
+	list_for_each_entry_safe(entry, temp, &vmap_ctx->pin_cache_lru, lru) {
+		if (vmap_ctx->pin_cache_objs <= max_objs &&
+		    vmap_ctx->pin_cache_bytes <= max_bytes &&
+		    !pin_cache_entry_dead(entry))
+			continue;
+
+		hash_del(&entry->node);
+		list_move_tail(&entry->lru, evict);
+		vmap_ctx->pin_cache_objs--;
+		vmap_ctx->pin_cache_bytes -= entry->size;
+	}
+}
+
+/* Unpin all of the pin cache. Returns false if it was empty.*/
+static bool
+pin_cache_flush(struct vmap_ctx_t *vmap_ctx)
+{
+	LIST_HEAD(evict);
+
+	mutex_lock(&vmap_ctx->pin_cache_lock);
+	pin_cache_trim(vmap_ctx, 0, 0, &evict);
+	mutex_unlock(&vmap_ctx->pin_cache_lock);
+
+	if (list_empty(&evict))
+		return false;
+
+	pin_cache_release(vmap_ctx, &evict);
+	return true;
+}
+
+/*
+ * Keep the pin of an unmapped Mem or Sync obj in the pin cache. Returns
+ * false if it was not kept, the caller shall unpin it then.
+ */
+static bool
+pin_cache_add(struct vmap_ctx_t *vmap_ctx, enum vmap_obj_type type,
+	      void *pin)
+{
+	u32 max_objs = READ_ONCE(pin_cache_max_objs);
+	struct pin_cache_entry *entry = NULL;
+	unsigned long key = 0;
+	LIST_HEAD(evict);
+
+	if (!max_objs)
+		return false;
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return false;
+
+	entry->type = type;
+	if (type == VMAP_OBJ_TYPE_MEM) {
+		entry->pin.mem = *(struct memobj_pin_t *)pin;
+		entry->size = entry->pin.mem.attrib.size;
+		key = (unsigned long)entry->pin.mem.dmabuf;
+	} else {
+		entry->pin.sync = *(struct syncobj_pin_t *)pin;
+		entry->size = entry->pin.sync.attrib.size;
+		key = entry->pin.sync.syncpt_id;
+	}
+
+	mutex_lock(&vmap_ctx->pin_cache_lock);
+	hash_add(vmap_ctx->pin_cache, &entry->node, key);
+	list_add_tail(&entry->lru, &vmap_ctx->pin_cache_lru);
+	vmap_ctx->pin_cache_objs++;
+	vmap_ctx->pin_cache_bytes += entry->size;
+	pin_cache_trim(vmap_ctx, max_objs,
+		       (size_t)READ_ONCE(pin_cache_max_mb) * SZ_1M, &evict);
+	mutex_unlock(&vmap_ctx->pin_cache_lock);
+
+	pin_cache_release(vmap_ctx, &evict);
+	return true;
+}
+
+/* must be called with pin_cache_lock held.*/
+static void
+pin_cache_take(struct vmap_ctx_t *vmap_ctx, struct pin_cache_entry *entry)
+{
+	hash_del(&entry->node);
+	list_del(&entry->lru);
+	vmap_ctx->pin_cache_objs--;
+	vmap_ctx->pin_cache_bytes -= entry->size;
+}
+
+/* Move a cached pin of dmabuf, mapped alike, to pin. O(1).*/
+static bool
+pin_cache_get_memobj(struct vmap_ctx_t *vmap_ctx, struct dma_buf *dmabuf,
+		     struct memobj_pin_t *pin)
+{
+	struct pin_cache_entry *entry = NULL;
+	bool found = false;
+
+	mutex_lock(&vmap_ctx->pin_cache_lock);
+	hash_for_each_possible(vmap_ctx->pin_cache, entry, node,
+			       (unsigned long)dmabuf) {
+		if (entry->type == VMAP_OBJ_TYPE_MEM &&
+		    entry->pin.mem.dmabuf == dmabuf &&
+		    entry->pin.mem.mngd == pin->mngd &&
+		    entry->pin.mem.prot == pin->prot) {
+			pin_cache_take(vmap_ctx, entry);
+			found = true;
+			break;
+		}
+	}
+	mutex_unlock(&vmap_ctx->pin_cache_lock);
+
+	if (found) {
+		*pin = entry->pin.mem;
+		kfree(entry);
+	}
+	return found;
+}
+
+/* Move a cached pin of the syncpoint, mapped alike, to pin. O(1).*/
+static bool
+pin_cache_get_syncobj(struct vmap_ctx_t *vmap_ctx, struct syncobj_pin_t *pin)
+{
+	struct pin_cache_entry *entry = NULL;
+	bool found = false;
+
+	mutex_lock(&vmap_ctx->pin_cache_lock);
+	hash_for_each_possible(vmap_ctx->pin_cache, entry, node,
+			       (unsigned long)pin->syncpt_id) {
+		if (entry->type == VMAP_OBJ_TYPE_SYNC &&
+		    entry->pin.sync.syncpt_id == pin->syncpt_id &&
+		    entry->pin.sync.pin_reqd == pin->pin_reqd &&
+		    entry->pin.sync.mngd == pin->mngd &&
+		    entry->pin.sync.prot == pin->prot &&
+		    syncobj_pin_match(&entry->pin.sync, pin->fd)) {
+			pin_cache_take(vmap_ctx, entry);
+			found = true;
+			break;
+		}
+	}
+	mutex_unlock(&vmap_ctx->pin_cache_lock);
+
+	if (found) {
+		entry->pin.sync.fd = pin->fd;
+		*pin = entry->pin.sync;
+		kfree(entry);
+	}
+	return found;
+}
+
 static int
 match_dmabuf(int id, void *entry, void *data)
 {
@@ -62,7 +261,7 @@ memobj_map(struct vmap_ctx_t *vmap_ctx,
 	mutex_lock(&vmap_ctx->mem_idr_lock);
 
 	/* check if the dma_buf is already mapped ? */
-	id_exist = idr_for_each(&vmap_ctx->mem_idr, match_dmabuf, &dmabuf);
+	id_exist = idr_for_each(&vmap_ctx->mem_idr, match_dmabuf, dmabuf);
 	if (id_exist > 0)
 		map = idr_find(&vmap_ctx->mem_idr, id_exist);
 
@@ -106,7 +305,15 @@ memobj_map(struct vmap_ctx_t *vmap_ctx,
 		}
 
 		/* populates map->pin.attrib within.*/
-		ret = memobj_pin(vmap_ctx, &map->pin);
+		if (!pin_cache_get_memobj(vmap_ctx, dmabuf, &map->pin)) {
+			ret = memobj_pin(vmap_ctx, &map->pin);
+			/* the iova kept by the pin cache may be in the way.*/
+			if (ret == -ENOMEM && pin_cache_flush(vmap_ctx)) {
+				memset(&map->pin.attrib, 0,
+				       sizeof(map->pin.attrib));
+				ret = memobj_pin(vmap_ctx, &map->pin);
+			}
+		}
 		if (ret) {
 			pr_err("Failed to pin mem obj fd: (%d)\n", params->fd);
 			idr_remove(&vmap_ctx->mem_idr, map->obj_id);
@@ -137,7 +344,8 @@ memobj_free(struct kref *kref)
 
 	map = container_of(kref, struct memobj_map_ref, refcount);
 	if (map) {
-		memobj_unpin(map->vmap_ctx, &map->pin);
+		if (!pin_cache_add(map->vmap_ctx, VMAP_OBJ_TYPE_MEM, &map->pin))
+			memobj_unpin(map->vmap_ctx, &map->pin);
 		idr_remove(&map->vmap_ctx->mem_idr, map->obj_id);
 		kfree(map);
 	}
@@ -245,7 +453,12 @@ syncobj_map(struct vmap_ctx_t *vmap_ctx,
 		map->pin.pin_reqd = params->pin_reqd;
 		map->pin.prot = params->prot;
 		map->pin.mngd = params->mngd;
-		ret = syncobj_pin(vmap_ctx, &map->pin);
+		if (!pin_cache_get_syncobj(vmap_ctx, &map->pin)) {
+			ret = syncobj_pin(vmap_ctx, &map->pin);
+			/* the iova kept by the pin cache may be in the way.*/
+			if (ret == -ENOMEM && pin_cache_flush(vmap_ctx))
+				ret = syncobj_pin(vmap_ctx, &map->pin);
+		}
 		if (ret) {
 			pr_err("Failed to pin sync obj Id: (%d)\n",
 			       syncpt_id);
@@ -277,7 +490,9 @@ syncobj_free(struct kref *kref)
 
 	map = container_of(kref, struct syncobj_map_ref, refcount);
 	if (map) {
-		syncobj_unpin(map->vmap_ctx, &map->pin);
+		if (!pin_cache_add(map->vmap_ctx, VMAP_OBJ_TYPE_SYNC,
+				   &map->pin))
+			syncobj_unpin(map->vmap_ctx, &map->pin);
 		idr_remove(&map->vmap_ctx->sync_idr, map->obj_id);
 		kfree(map);
 	}
@@ -674,6 +889,9 @@ vmap_init(struct driver_ctx_t *drv_ctx, void **vmap_h)
 	mutex_init(&vmap_ctx->mem_idr_lock);
 	mutex_init(&vmap_ctx->sync_idr_lock);
 	mutex_init(&vmap_ctx->import_idr_lock);
+	hash_init(vmap_ctx->pin_cache);
+	INIT_LIST_HEAD(&vmap_ctx->pin_cache_lru);
+	mutex_init(&vmap_ctx->pin_cache_lock);
 
 	vmap_ctx->dummy_pdev = platform_device_alloc(drv_ctx->drv_name, -1);
 	if (!vmap_ctx->dummy_pdev) {
@@ -812,6 +1030,8 @@ vmap_deinit(void **vmap_h)
 	idr_destroy(&vmap_ctx->import_idr);
 	mutex_unlock(&vmap_ctx->import_idr_lock);
 
+	pin_cache_flush(vmap_ctx);
+
 	if (vmap_ctx->dummy_pdev_init) {
 		platform_device_unregister(vmap_ctx->dummy_pdev);
 		vmap_ctx->dummy_pdev_init = false;
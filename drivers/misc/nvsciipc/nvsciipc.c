@@ -24,6 +24,12 @@
 #include <linux/cred.h>
 #include <linux/of.h>
 #include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/stringhash.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
 
 #ifdef CONFIG_TEGRA_VIRTUALIZATION
 #include <soc/tegra/virt/syscalls.h>
@@ -51,6 +57,247 @@ static struct nvsciipc *ctx;
 static int32_t s_guestid = -1;
 #endif /* CONFIG_TEGRA_VIRTUALIZATION */
 
+static uint32_t nvsciipc_str_hash(const char *name, uint32_t len,
+		uint32_t bits)
+{
+	return hash_32(full_name_hash(NULL, name, len), bits);
+}
+
+static uint32_t nvsciipc_name_hash(const char *name, uint32_t bits)
+{
+	return nvsciipc_str_hash(name, strnlen(name, NVSCIIPC_MAX_EP_NAME),
+		bits);
+}
+
+static void nvsciipc_free_db_index(struct nvsciipc *ctx)
+{
+	kvfree(ctx->dev_hash);
+	kvfree(ctx->vuid_hash);
+	kvfree(ctx->name_hash);
+	kvfree(ctx->db_nodes);
+	ctx->dev_hash = NULL;
+	ctx->vuid_hash = NULL;
+	ctx->name_hash = NULL;
+	ctx->db_nodes = NULL;
+	ctx->hash_bits = 0;
+}
+
+/* Hash ctx->db by endpoint name, VUID and device node name */
+static int nvsciipc_build_db_index(struct nvsciipc *ctx)
+{
+	char node[NVSCIIPC_MAX_EP_NAME+16];
+	struct nvsciipc_db_node *db_node;
+	uint32_t bits, size;
+	int i, ret;
+
+	nvsciipc_free_db_index(ctx);
+
+	/* keep the load factor at or below 1/2 */
+	bits = ilog2(roundup_pow_of_two(ctx->num_eps)) + 1;
+	size = 1U << bits;
+
+	ctx->db_nodes = kvcalloc(ctx->num_eps, sizeof(*ctx->db_nodes),
+		GFP_KERNEL);
+	ctx->name_hash = kvcalloc(size, sizeof(struct hlist_head), GFP_KERNEL);
+	ctx->vuid_hash = kvcalloc(size, sizeof(struct hlist_head), GFP_KERNEL);
+	ctx->dev_hash = kvcalloc(size, sizeof(struct hlist_head), GFP_KERNEL);
+	if ((ctx->db_nodes == NULL) || (ctx->name_hash == NULL) ||
+	    (ctx->vuid_hash == NULL) || (ctx->dev_hash == NULL)) {
+		ERR("memory allocation for db index failed\n");
+		nvsciipc_free_db_index(ctx);
+		return -ENOMEM;
+	}
+	ctx->hash_bits = bits;
+
+	/*
+	 * Insert from the back so that the first one of duplicated entries
+	 * is found first, same as with a scan of the db.
+	 */
+	for (i = ctx->num_eps - 1; i >= 0; i--) {
+		db_node = &ctx->db_nodes[i];
+		db_node->idx = i;
+
+		hlist_add_head(&db_node->name_node,
+			&ctx->name_hash[nvsciipc_name_hash(ctx->db[i]->ep_name,
+				bits)]);
+		hlist_add_head(&db_node->vuid_node,
+			&ctx->vuid_hash[hash_64(ctx->db[i]->vuid, bits)]);
+
+		ret = snprintf(node, sizeof(node), "%s%d",
+			ctx->db[i]->dev_name, ctx->db[i]->id);
+		if ((ret < 0) || (ret >= sizeof(node)))
+			continue;
+
+		hlist_add_head(&db_node->dev_node,
+			&ctx->dev_hash[nvsciipc_str_hash(node, ret, bits)]);
+	}
+
+	return 0;
+}
+
+static void nvsciipc_snapshot_release(struct kref *ref)
+{
+	struct nvsciipc_snapshot *snap = container_of(ref,
+			struct nvsciipc_snapshot, ref);
+
+	vfree(snap->hdr);
+	kfree(snap);
+}
+
+struct nvsciipc_snapshot_name {
+	const char *name;
+	uint32_t idx;
+};
+
+static int nvsciipc_snapshot_name_cmp(const void *a, const void *b)
+{
+	const struct nvsciipc_snapshot_name *na = a;
+	const struct nvsciipc_snapshot_name *nb = b;
+	int ret;
+
+	ret = strncmp(na->name, nb->name, NVSCIIPC_MAX_EP_NAME);
+	if (ret != 0)
+		return ret;
+
+	return (na->idx < nb->idx) ? -1 : 1;
+}
+
+/* Copy ctx->db into a new snapshot and make it the one mmap hands out */
+static int nvsciipc_publish_snapshot(struct nvsciipc *ctx)
+{
+	struct nvsciipc_snapshot *snap, *old;
+	struct nvsciipc_db_snapshot_hdr *hdr;
+	struct nvsciipc_db_snapshot_entry *entry;
+	struct nvsciipc_snapshot_name *names;
+	uint32_t *name_idx;
+	size_t entry_offset, name_idx_offset;
+	int i;
+
+	entry_offset = sizeof(*hdr);
+	name_idx_offset = entry_offset + ctx->num_eps * sizeof(*entry);
+
+	snap = kzalloc(sizeof(*snap), GFP_KERNEL);
+	if (snap == NULL)
+		return -ENOMEM;
+
+	snap->size = PAGE_ALIGN(name_idx_offset +
+		ctx->num_eps * sizeof(*name_idx));
+	snap->hdr = vmalloc_user(snap->size);
+	names = kvmalloc_array(ctx->num_eps, sizeof(*names), GFP_KERNEL);
+	if ((snap->hdr == NULL) || (names == NULL)) {
+		ERR("memory allocation for db snapshot failed\n");
+		kvfree(names);
+		vfree(snap->hdr);
+		kfree(snap);
+		return -ENOMEM;
+	}
+
+	hdr = snap->hdr;
+	entry = (void *)hdr + entry_offset;
+	name_idx = (void *)hdr + name_idx_offset;
+
+	for (i = 0; i < ctx->num_eps; i++) {
+		memcpy(entry[i].ep_name, ctx->db[i]->ep_name,
+			NVSCIIPC_MAX_EP_NAME);
+		entry[i].vuid = ctx->db[i]->vuid;
+		entry[i].backend = ctx->db[i]->backend;
+		entry[i].id = ctx->db[i]->id;
+		entry[i].nframes = ctx->db[i]->nframes;
+		entry[i].frame_size = ctx->db[i]->frame_size;
+		entry[i].peer_vmid = ctx->db[i]->peer_vmid;
+		entry[i].noti_type = ctx->db[i]->noti_type;
+
+		names[i].name = ctx->db[i]->ep_name;
+		names[i].idx = i;
+	}
+
+	sort(names, ctx->num_eps, sizeof(*names),
+		nvsciipc_snapshot_name_cmp, NULL);
+	for (i = 0; i < ctx->num_eps; i++)
+		name_idx[i] = names[i].idx;
+	kvfree(names);
+
+	hdr->magic = NVSCIIPC_DB_SNAPSHOT_MAGIC;
+	hdr->version = NVSCIIPC_DB_SNAPSHOT_VERSION;
+	hdr->num_eps = ctx->num_eps;
+	hdr->entry_size = sizeof(*entry);
+	hdr->entry_offset = entry_offset;
+	hdr->name_idx_offset = name_idx_offset;
+	hdr->size = snap->size;
+	kref_init(&snap->ref);
+
+	spin_lock(&ctx->snapshot_lock);
+	hdr->generation = ++ctx->generation;
+	old = ctx->snapshot;
+	ctx->snapshot = snap;
+	if (old != NULL)
+		WRITE_ONCE(old->hdr->flags,
+			old->hdr->flags | NVSCIIPC_DB_SNAPSHOT_STALE);
+	spin_unlock(&ctx->snapshot_lock);
+
+	if (old != NULL)
+		kref_put(&old->ref, nvsciipc_snapshot_release);
+
+	return 0;
+}
+
+static int nvsciipc_find_by_name(struct nvsciipc *ctx, const char *name)
+{
+	struct nvsciipc_db_node *db_node;
+
+	hlist_for_each_entry(db_node,
+		&ctx->name_hash[nvsciipc_name_hash(name, ctx->hash_bits)],
+		name_node) {
+		if (!strncmp(name, ctx->db[db_node->idx]->ep_name,
+			NVSCIIPC_MAX_EP_NAME))
+			return db_node->idx;
+	}
+
+	return -ENOENT;
+}
+
+static int nvsciipc_find_by_vuid(struct nvsciipc *ctx, uint64_t vuid)
+{
+	struct nvsciipc_db_node *db_node;
+
+	hlist_for_each_entry(db_node,
+		&ctx->vuid_hash[hash_64(vuid, ctx->hash_bits)], vuid_node) {
+		if (ctx->db[db_node->idx]->vuid == vuid)
+			return db_node->idx;
+	}
+
+	return -ENOENT;
+}
+
+static int nvsciipc_find_by_dev(struct nvsciipc *ctx, const char *name,
+		int len)
+{
+	char node[NVSCIIPC_MAX_EP_NAME+16];
+	struct nvsciipc_db_node *db_node;
+	struct nvsciipc_config_entry *entry;
+	int ret;
+
+	hlist_for_each_entry(db_node,
+		&ctx->dev_hash[nvsciipc_str_hash(name, len, ctx->hash_bits)],
+		dev_node) {
+		entry = ctx->db[db_node->idx];
+		ret = snprintf(node, sizeof(node), "%s%d",
+			entry->dev_name, entry->id);
+
+		if ((ret < 0) || (ret != len))
+			continue;
+
+#if DEBUG_VALIDATE_TOKEN
+		INFO("node:%s, vuid:0x%llx\n", node, entry->vuid);
+#endif
+		/* compare node name itself only (w/o directory) */
+		if (!strncmp(name, node, ret))
+			return db_node->idx;
+	}
+
+	return -ENOENT;
+}
+
 NvSciError NvSciIpcEndpointGetAuthToken(NvSciIpcEndpoint handle,
 		NvSciIpcEndpointAuthToken *authToken)
 {
@@ -75,8 +322,7 @@ NvSciError NvSciIpcEndpointValidateAuthTokenLinuxCurrent(
 {
 	struct fd f;
 	struct file *filp;
-	int i, ret, devlen;
-	char node[NVSCIIPC_MAX_EP_NAME+16];
+	int i, devlen;
 
 	if ((ctx == NULL) || (ctx->set_db_f != true)) {
 		ERR("not initialized\n");
@@ -96,28 +342,14 @@ NvSciError NvSciIpcEndpointValidateAuthTokenLinuxCurrent(
 		filp->f_path.dentry->d_name.name, devlen);
 #endif
 
-	for (i = 0; i < ctx->num_eps; i++) {
-		ret = snprintf(node, sizeof(node), "%s%d",
-			ctx->db[i]->dev_name, ctx->db[i]->id);
-
-		if ((ret < 0) || (ret != devlen))
-			continue;
-
-#if DEBUG_VALIDATE_TOKEN
-		INFO("node:%s, vuid:0x%llx\n", node, ctx->db[i]->vuid);
-#endif
-		/* compare node name itself only (w/o directory) */
-		if (!strncmp(filp->f_path.dentry->d_name.name, node, ret)) {
-			*localUserVuid = ctx->db[i]->vuid;
-			break;
-		}
-	}
-
-	if (i == ctx->num_eps) {
+	i = nvsciipc_find_by_dev(ctx, filp->f_path.dentry->d_name.name,
+		devlen);
+	if (i < 0) {
 		fdput(f);
 		ERR("wrong auth token passed\n");
 		return NvSciError_BadParameter;
 	}
+	*localUserVuid = ctx->db[i]->vuid;
 
 	fdput(f);
 
@@ -143,18 +375,13 @@ NvSciError NvSciIpcEndpointMapVuid(NvSciIpcEndpointVuid localUserVuid,
 		return NvSciError_NotInitialized;
 	}
 
-	for (i = 0; i < ctx->num_eps; i++) {
-		if (ctx->db[i]->vuid == localUserVuid) {
-			backend = ctx->db[i]->backend;
-			entry = ctx->db[i];
-			break;
-		}
-	}
-
-	if (i == ctx->num_eps) {
+	i = nvsciipc_find_by_vuid(ctx, localUserVuid);
+	if (i < 0) {
 		ERR("wrong localUserVuid passed\n");
 		return NvSciError_BadParameter;
 	}
+	backend = ctx->db[i]->backend;
+	entry = ctx->db[i];
 
 	switch (backend) {
 	case NVSCIIPC_BACKEND_ITC:
@@ -209,6 +436,7 @@ static void nvsciipc_free_db(struct nvsciipc *ctx)
 		kfree(ctx->db);
 	}
 
+	nvsciipc_free_db_index(ctx);
 	ctx->num_eps = 0;
 }
 
@@ -219,6 +447,73 @@ static int nvsciipc_dev_release(struct inode *inode, struct file *filp)
 	return 0;
 }
 
+static void nvsciipc_vma_open(struct vm_area_struct *vma)
+{
+	struct nvsciipc_snapshot *snap = vma->vm_private_data;
+
+	kref_get(&snap->ref);
+}
+
+static void nvsciipc_vma_close(struct vm_area_struct *vma)
+{
+	struct nvsciipc_snapshot *snap = vma->vm_private_data;
+
+	kref_put(&snap->ref, nvsciipc_snapshot_release);
+}
+
+static const struct vm_operations_struct nvsciipc_vm_ops = {
+	.open	= nvsciipc_vma_open,
+	.close	= nvsciipc_vma_close,
+};
+
+static int nvsciipc_dev_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct nvsciipc *ctx = filp->private_data;
+	struct nvsciipc_snapshot *snap;
+	int ret;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	spin_lock(&ctx->snapshot_lock);
+	snap = ctx->snapshot;
+	if (snap != NULL)
+		kref_get(&snap->ref);
+	spin_unlock(&ctx->snapshot_lock);
+
+	if (snap == NULL) {
+		ERR("%s[%d] need to set endpoint database first\n", __func__,
+			get_current()->pid);
+		return -EPERM;
+	}
+
+	if ((vma->vm_pgoff != 0) ||
+	    (vma->vm_end - vma->vm_start > snap->size)) {
+		ret = -EINVAL;
+		goto put;
+	}
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	ret = remap_vmalloc_range(vma, snap->hdr, 0);
+	if (ret != 0)
+		goto put;
+
+	vma->vm_private_data = snap;
+	vma->vm_ops = &nvsciipc_vm_ops;
+
+	return 0;
+
+put:
+	kref_put(&snap->ref, nvsciipc_snapshot_release);
+
+	return ret;
+}
+
 #if DEBUG_AUTH_API
 static int nvsciipc_ioctl_validate_auth_token(struct nvsciipc *ctx,
 	unsigned int cmd, unsigned long arg)
@@ -315,20 +610,73 @@ static int nvsciipc_ioctl_get_db_by_name(struct nvsciipc *ctx, unsigned int cmd,
 	}
 
 	/* read operation */
-	for (i = 0; i < ctx->num_eps; i++) {
-		if (!strncmp(get_db.ep_name, ctx->db[i]->ep_name,
-			NVSCIIPC_MAX_EP_NAME)) {
+	i = nvsciipc_find_by_name(ctx, get_db.ep_name);
+	if (i < 0) {
+		INFO("%s: no entry (%s)\n", __func__, get_db.ep_name);
+		return -ENOENT;
+	}
+
+	get_db.entry = *ctx->db[i];
+	get_db.idx = i;
+	if (copy_to_user((void __user *)arg, &get_db, _IOC_SIZE(cmd))) {
+		ERR("%s : copy_to_user failed\n", __func__);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int nvsciipc_ioctl_get_db_by_names(struct nvsciipc *ctx,
+		unsigned int cmd, unsigned long arg)
+{
+	struct nvsciipc_get_db_by_names op;
+	struct nvsciipc_get_db_by_name __user *uentry;
+	struct nvsciipc_get_db_by_name get_db;
+	uint32_t n;
+	int i;
+
+	if ((ctx->num_eps == 0) || (ctx->set_db_f != true)) {
+		ERR("%s[%d] need to set endpoint database first\n", __func__,
+			get_current()->pid);
+		return -EPERM;
+	}
+
+	if (copy_from_user(&op, (void __user *)arg, _IOC_SIZE(cmd))) {
+		ERR("%s : copy_from_user failed\n", __func__);
+		return -EFAULT;
+	}
+
+	uentry = u64_to_user_ptr(op.entries);
+	op.num_found = 0;
+	memset(&get_db, 0, sizeof(get_db));
+
+	/* read operation */
+	for (n = 0; n < op.num_eps; n++, uentry++) {
+		if (copy_from_user(get_db.ep_name, uentry->ep_name,
+			sizeof(get_db.ep_name))) {
+			ERR("%s : copy_from_user failed\n", __func__);
+			return -EFAULT;
+		}
+
+		i = nvsciipc_find_by_name(ctx, get_db.ep_name);
+		if (i < 0) {
+			memset(&get_db.entry, 0, sizeof(get_db.entry));
+			get_db.idx = NVSCIIPC_DB_IDX_INVALID;
+		} else {
 			get_db.entry = *ctx->db[i];
 			get_db.idx = i;
-			break;
+			op.num_found++;
 		}
+
+		if (copy_to_user(uentry, &get_db, sizeof(get_db))) {
+			ERR("%s : copy_to_user failed\n", __func__);
+			return -EFAULT;
+		}
+
+		cond_resched();
 	}
 
-	if (i == ctx->num_eps) {
-		INFO("%s: no entry (%s)\n", __func__, get_db.ep_name);
-		return -ENOENT;
-	} else if (copy_to_user((void __user *)arg, &get_db,
-				_IOC_SIZE(cmd))) {
+	if (copy_to_user((void __user *)arg, &op, _IOC_SIZE(cmd))) {
 		ERR("%s : copy_to_user failed\n", __func__);
 		return -EFAULT;
 	}
@@ -354,19 +702,15 @@ static int nvsciipc_ioctl_get_db_by_vuid(struct nvsciipc *ctx, unsigned int cmd,
 	}
 
 	/* read operation */
-	for (i = 0; i < ctx->num_eps; i++) {
-		if (get_db.vuid == ctx->db[i]->vuid) {
-			get_db.entry = *ctx->db[i];
-			get_db.idx = i;
-			break;
-		}
-	}
-
-	if (i == ctx->num_eps) {
+	i = nvsciipc_find_by_vuid(ctx, get_db.vuid);
+	if (i < 0) {
 		INFO("%s: no entry (0x%llx)\n", __func__, get_db.vuid);
 		return -ENOENT;
-	} else if (copy_to_user((void __user *)arg, &get_db,
-				_IOC_SIZE(cmd))) {
+	}
+
+	get_db.entry = *ctx->db[i];
+	get_db.idx = i;
+	if (copy_to_user((void __user *)arg, &get_db, _IOC_SIZE(cmd))) {
 		ERR("%s : copy_to_user failed\n", __func__);
 		return -EFAULT;
 	}
@@ -392,19 +736,14 @@ static int nvsciipc_ioctl_get_vuid(struct nvsciipc *ctx, unsigned int cmd,
 	}
 
 	/* read operation */
-	for (i = 0; i < ctx->num_eps; i++) {
-		if (!strncmp(get_vuid.ep_name, ctx->db[i]->ep_name,
-			NVSCIIPC_MAX_EP_NAME)) {
-			get_vuid.vuid = ctx->db[i]->vuid;
-			break;
-		}
-	}
-
-	if (i == ctx->num_eps) {
+	i = nvsciipc_find_by_name(ctx, get_vuid.ep_name);
+	if (i < 0) {
 		INFO("%s: no entry (%s)\n", __func__, get_vuid.ep_name);
 		return -ENOENT;
-	} else if (copy_to_user((void __user *)arg, &get_vuid,
-				_IOC_SIZE(cmd))) {
+	}
+
+	get_vuid.vuid = ctx->db[i]->vuid;
+	if (copy_to_user((void __user *)arg, &get_vuid, _IOC_SIZE(cmd))) {
 		ERR("%s : copy_to_user failed\n", __func__);
 		return -EFAULT;
 	}
@@ -523,6 +862,17 @@ static int nvsciipc_ioctl_set_db(struct nvsciipc *ctx, unsigned int cmd,
 	}
 #endif /* CONFIG_TEGRA_VIRTUALIZATION */
 
+	/* after the vmid update above, which changes the vuids */
+	ret = nvsciipc_build_db_index(ctx);
+	if (ret < 0)
+		goto ptr_error;
+
+	ret = nvsciipc_publish_snapshot(ctx);
+	if (ret < 0) {
+		nvsciipc_free_db_index(ctx);
+		goto ptr_error;
+	}
+
 	kfree(entry_ptr);
 
 	ctx->set_db_f = true;
@@ -607,6 +957,9 @@ static long nvsciipc_dev_ioctl(struct file *filp, unsigned int cmd,
 	case NVSCIIPC_IOCTL_GET_DB_BY_NAME:
 		ret = nvsciipc_ioctl_get_db_by_name(ctx, cmd, arg);
 		break;
+	case NVSCIIPC_IOCTL_GET_DB_BY_NAMES:
+		ret = nvsciipc_ioctl_get_db_by_names(ctx, cmd, arg);
+		break;
 	case NVSCIIPC_IOCTL_GET_DB_BY_VUID:
 		ret = nvsciipc_ioctl_get_db_by_vuid(ctx, cmd, arg);
 		break;
@@ -679,6 +1032,7 @@ static const struct file_operations nvsciipc_fops = {
 	.release		= nvsciipc_dev_release,
 	.unlocked_ioctl	= nvsciipc_dev_ioctl,
 	.llseek		= no_llseek,
+	.mmap		= nvsciipc_dev_mmap,
 	.read		= nvsciipc_dbg_read,
 };
 
@@ -699,6 +1053,7 @@ static int nvsciipc_probe(struct platform_device *pdev)
 		goto error;
 	}
 	ctx->set_db_f = false;
+	spin_lock_init(&ctx->snapshot_lock);
 
 	ctx->dev = &(pdev->dev);
 	platform_set_drvdata(pdev, ctx);
@@ -777,6 +1132,11 @@ static void nvsciipc_cleanup(struct nvsciipc *ctx)
 
 	nvsciipc_free_db(ctx);
 
+	if (ctx->snapshot != NULL) {
+		kref_put(&ctx->snapshot->ref, nvsciipc_snapshot_release);
+		ctx->snapshot = NULL;
+	}
+
 	if (ctx->nvsciipc_class && ctx->dev_t)
 		device_destroy(ctx->nvsciipc_class, ctx->dev_t);
 
@@ -6,6 +6,8 @@
 #ifndef __NVSCIIPC_KERNEL_H__
 #define __NVSCIIPC_KERNEL_H__
 
+#include <linux/kref.h>
+#include <linux/spinlock.h>
 #include <linux/nvscierror.h>
 #include <linux/nvsciipc_interface.h>
 #include <uapi/linux/nvsciipc_ioctl.h>
@@ -24,6 +26,22 @@
 #define NVSCIIPC_BACKEND_C2C_NPM	4U
 #define NVSCIIPC_BACKEND_UNKNOWN	0xFFFFFFFFU
 
+/* Hash table links of one db entry */
+struct nvsciipc_db_node {
+	struct hlist_node name_node;
+	struct hlist_node vuid_node;
+	/* keyed by the device node name used as auth token */
+	struct hlist_node dev_node;
+	uint32_t idx;
+};
+
+/* One immutable copy of the db for mmap, see struct nvsciipc_db_snapshot_hdr */
+struct nvsciipc_snapshot {
+	struct kref ref;
+	struct nvsciipc_db_snapshot_hdr *hdr;
+	size_t size;
+};
+
 struct nvsciipc {
 	struct device *dev;
 
@@ -36,6 +54,18 @@ struct nvsciipc {
 	int num_eps;
 	struct nvsciipc_config_entry **db;
 	volatile bool set_db_f;
+
+	/* indices of db, built by set_db */
+	struct nvsciipc_db_node *db_nodes;
+	struct hlist_head *name_hash;
+	struct hlist_head *vuid_hash;
+	struct hlist_head *dev_hash;
+	uint32_t hash_bits;
+
+	/* latest snapshot, replaced by set_db */
+	spinlock_t snapshot_lock;
+	struct nvsciipc_snapshot *snapshot;
+	uint64_t generation;
 };
 
 struct vuid_bitfield_64 {
@@ -59,6 +89,7 @@ static void nvsciipc_cleanup(struct nvsciipc *ctx);
 
 static int nvsciipc_dev_open(struct inode *inode, struct file *filp);
 static int nvsciipc_dev_release(struct inode *inode, struct file *filp);
+static int nvsciipc_dev_mmap(struct file *filp, struct vm_area_struct *vma);
 static long nvsciipc_dev_ioctl(struct file *filp, unsigned int cmd,
 			unsigned long arg);
 static int nvsciipc_ioctl_get_vuid(struct nvsciipc *ctx, unsigned int cmd,
@@ -19,6 +19,9 @@
 #include <linux/mutex.h>
 #include <linux/mtd/mtd.h>
 #include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 #include <linux/mtd/partitions.h>
 #include <soc/tegra/ivc-priv.h>
 #include <soc/tegra/ivc_ext.h>
@@ -37,6 +40,37 @@
 static uint32_t total_instance_id;
 #endif
 
+/* most commands kept in flight over the IVC by one transfer */
+#define VMTD_MAX_INFLIGHT	8
+
+static unsigned int readahead_kb = 64;
+module_param(readahead_kb, uint, 0444);
+MODULE_PARM_DESC(readahead_kb,
+	"Size of the read-ahead window for small reads in KB, 0 disables it");
+
+/* a slot of the mempool owned by one command in flight */
+struct vmtd_slot {
+	u_char *buf;			/* caller buffer of the chunk */
+	loff_t offset;
+	uint32_t size;
+	bool busy;
+};
+
+struct vmtd_op_stats {
+	uint64_t cmds;
+	uint64_t bytes;
+	uint64_t nsecs;
+};
+
+struct vmtd_stats {
+	struct vmtd_op_stats read;
+	struct vmtd_op_stats write;
+	struct vmtd_op_stats erase;
+	uint64_t ra_hits;
+	uint64_t ra_misses;
+	uint32_t max_inflight;
+};
+
 struct vmtd_dev {
 	struct vs_config_info config;
 	uint64_t size;                   /* Device size in bytes */
@@ -51,6 +85,23 @@ struct vmtd_dev {
 	void *cmd_frame;
 	struct mtd_info mtd;
 	bool is_setup;
+
+	/* the mempool is split in slots, one per command in flight */
+	struct vmtd_slot *slots;
+	uint32_t nslots;
+	uint32_t slot_size;
+
+	/*
+	 * Page aligned window of the device kept after a small read, dropped
+	 * by writes and erases overlapping it. ra_len is 0 while it is empty.
+	 */
+	u_char *ra_buf;
+	size_t ra_size;
+	loff_t ra_start;
+	size_t ra_len;
+
+	/* protected by lock */
+	struct vmtd_stats stats;
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
 	uint32_t epl_id;
 	uint32_t epl_reporter_id;
@@ -202,6 +253,157 @@ static int vmtd_get_configinfo(struct vmtd_dev *vmtddev,
 	return 0;
 }
 
+static int vmtd_send_chunk(struct vmtd_dev *vmtddev, enum mtd_cmd_op op,
+		uint32_t slot_idx)
+{
+	struct vmtd_slot *slot = &vmtddev->slots[slot_idx];
+	struct vs_request *vs_req = (struct vs_request *)vmtddev->cmd_frame;
+	uint32_t data_offset = slot_idx * vmtddev->slot_size;
+
+	if (op == VS_MTD_WRITE)
+		memcpy(vmtddev->shared_buffer + data_offset, slot->buf,
+			slot->size);
+
+	vs_req->type = VS_DATA_REQ;
+	vs_req->mtddev_req.req_op = op;
+	vs_req->mtddev_req.mtd_req.offset = slot->offset;
+	vs_req->mtddev_req.mtd_req.size = slot->size;
+	vs_req->mtddev_req.mtd_req.data_offset = data_offset;
+	vs_req->req_id = slot_idx;
+
+	return vmtd_send_cmd(vmtddev, vs_req);
+}
+
+static int vmtd_complete_chunk(struct vmtd_dev *vmtddev, enum mtd_cmd_op op)
+{
+	struct vs_request *vs_req = (struct vs_request *)vmtddev->cmd_frame;
+	struct vmtd_slot *slot;
+	int ret;
+
+	ret = vmtd_get_resp(vmtddev, vs_req);
+	if (ret != 0)
+		return ret;
+
+	if ((vs_req->req_id >= vmtddev->nslots) ||
+		!vmtddev->slots[vs_req->req_id].busy) {
+		dev_err(vmtddev->device, "response for unknown request %u!\n",
+			vs_req->req_id);
+		return -EIO;
+	}
+
+	slot = &vmtddev->slots[vs_req->req_id];
+	slot->busy = false;
+
+	if ((vs_req->status != 0) ||
+		(vs_req->mtddev_resp.mtd_resp.status != 0)) {
+		dev_err(vmtddev->device,
+			"Response status for offset %llx size %x failed!\n",
+			slot->offset, slot->size);
+		return -EIO;
+	}
+
+	if (vs_req->mtddev_resp.mtd_resp.size != slot->size) {
+		dev_err(vmtddev->device,
+			"size mismatch for offset %llx size %x returned %x!\n",
+			slot->offset, slot->size,
+			vs_req->mtddev_resp.mtd_resp.size);
+		return -EIO;
+	}
+
+	if (op == VS_MTD_READ)
+		memcpy(slot->buf, vmtddev->shared_buffer +
+			(vs_req->req_id * vmtddev->slot_size), slot->size);
+
+	return 0;
+}
+
+/*
+ * Transfer a range in chunks of at most max_bytes, with up to nslots
+ * commands in flight so the server always has the next chunk queued.
+ * Called with the lock held.
+ */
+static int vmtd_xfer(struct vmtd_dev *vmtddev, enum mtd_cmd_op op,
+		loff_t offset, size_t len, u_char *buf, size_t max_bytes)
+{
+	struct vmtd_op_stats *op_stats = (op == VS_MTD_READ) ?
+		&vmtddev->stats.read : &vmtddev->stats.write;
+	struct vmtd_slot *slot;
+	ktime_t start = ktime_get();
+	size_t total = len;
+	uint32_t inflight = 0;
+	int ret = 0, err;
+	uint32_t i;
+
+	while ((inflight != 0) || ((len != 0) && (ret == 0))) {
+		if ((len != 0) && (ret == 0) && (inflight < vmtddev->nslots)) {
+			for (i = 0; vmtddev->slots[i].busy; i++)
+				;
+
+			slot = &vmtddev->slots[i];
+			slot->buf = buf;
+			slot->offset = offset;
+			slot->size = min(len, max_bytes);
+			slot->busy = true;
+
+			ret = vmtd_send_chunk(vmtddev, op, i);
+			if (ret != 0) {
+				slot->busy = false;
+				dev_err(vmtddev->device,
+					"%s for offset %llx size %x failed!\n",
+					(op == VS_MTD_READ) ? "Read" : "write",
+					offset, slot->size);
+				continue;
+			}
+
+			buf += slot->size;
+			offset += slot->size;
+			len -= slot->size;
+			op_stats->cmds++;
+			inflight++;
+			vmtddev->stats.max_inflight =
+				max(vmtddev->stats.max_inflight, inflight);
+			continue;
+		}
+
+		/* all sent commands are drained, even after an error */
+		err = vmtd_complete_chunk(vmtddev, op);
+		if ((err != 0) && (ret == 0))
+			ret = err;
+		inflight--;
+	}
+
+	if (ret == 0) {
+		op_stats->bytes += total;
+	} else {
+		for (i = 0; i < vmtddev->nslots; i++)
+			vmtddev->slots[i].busy = false;
+	}
+	op_stats->nsecs += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ret;
+}
+
+static void vmtd_ra_invalidate(struct vmtd_dev *vmtddev, loff_t offset,
+		uint64_t len)
+{
+	if ((vmtddev->ra_len != 0) &&
+		(offset < vmtddev->ra_start + vmtddev->ra_len) &&
+		(vmtddev->ra_start < offset + len))
+		vmtddev->ra_len = 0;
+}
+
+static bool vmtd_ra_read(struct vmtd_dev *vmtddev, loff_t offset,
+		size_t len, u_char *buf)
+{
+	if ((vmtddev->ra_len == 0) || (offset < vmtddev->ra_start) ||
+		(offset + len > vmtddev->ra_start + vmtddev->ra_len))
+		return false;
+
+	memcpy(buf, vmtddev->ra_buf + (offset - vmtddev->ra_start), len);
+
+	return true;
+}
+
 /*
  * Read an address range from the flash chip.  The address range
  * may be any size provided it is within the physical boundaries.
@@ -210,49 +412,57 @@ static int vmtd_read(struct mtd_info *mtd, loff_t from, size_t len,
 		size_t *retlen, u_char *buf)
 {
 	struct vmtd_dev *vmtddev = mtd_to_vmtd(mtd);
-	struct vs_request *vs_req;
-	size_t remaining_size = len;
-	size_t read_size;
-	u_char *buf_addr = buf;
-	loff_t offset = from;
+	size_t max_bytes;
+	loff_t ra_start;
 	int32_t ret = 0;
 
 	dev_dbg(vmtddev->device, "%s from 0x%llx, len %zd\n",
-		__func__, offset, remaining_size);
+		__func__, from, len);
 
-	if (((offset + remaining_size) < offset) ||
-			((offset + remaining_size) > vmtddev->mtd.size)) {
+	if (((from + len) < from) ||
+			((from + len) > vmtddev->mtd.size)) {
 		dev_err(vmtddev->device,
-			"from %llx len %lx out of range!\n", offset,
-			remaining_size);
+			"from %llx len %lx out of range!\n", from, len);
 		return -EPERM;
 	}
 
+	max_bytes = vmtddev->config.mtd_config.max_read_bytes_per_io;
+
 	mutex_lock(&vmtddev->lock);
-	while (remaining_size) {
-		read_size = min_t(size_t, (size_t)vmtddev->config.mtd_config.max_read_bytes_per_io,
-				remaining_size);
-		vs_req = (struct vs_request *)vmtddev->cmd_frame;
-		vs_req->type = VS_DATA_REQ;
-		vs_req->mtddev_req.req_op = VS_MTD_READ;
-		vs_req->mtddev_req.mtd_req.offset = offset;
-		vs_req->mtddev_req.mtd_req.size = read_size;
-		vs_req->mtddev_req.mtd_req.data_offset = 0;
-		vs_req->req_id = 0;
-
-		ret = vmtd_process_request(vmtddev, vs_req);
-		if (ret != 0) {
-			dev_err(vmtddev->device,
-				"Read for offset %llx size %lx failed!\n",
-				offset, read_size);
+	if (vmtd_ra_read(vmtddev, from, len, buf)) {
+		vmtddev->stats.ra_hits++;
+		goto done;
+	}
+
+	/*
+	 * Small reads, like the config blobs read at boot, tend to be
+	 * followed by the next few pages: fetch the whole window at once.
+	 */
+	ra_start = round_down(from, PAGE_SIZE);
+	if ((vmtddev->ra_size != 0) &&
+		((from - ra_start) + len <= vmtddev->ra_size)) {
+		vmtddev->stats.ra_misses++;
+		vmtddev->ra_len = 0;
+
+		ret = vmtd_xfer(vmtddev, VS_MTD_READ, ra_start,
+			min_t(uint64_t, vmtddev->ra_size,
+				vmtddev->mtd.size - ra_start),
+			vmtddev->ra_buf, max_bytes);
+		if (ret != 0)
 			goto fail;
-		}
 
-		memcpy(buf_addr, vmtddev->shared_buffer, read_size);
-		buf_addr += read_size;
-		offset += read_size;
-		remaining_size -= read_size;
+		vmtddev->ra_start = ra_start;
+		vmtddev->ra_len = min_t(uint64_t, vmtddev->ra_size,
+				vmtddev->mtd.size - ra_start);
+		vmtd_ra_read(vmtddev, from, len, buf);
+		goto done;
 	}
+
+	ret = vmtd_xfer(vmtddev, VS_MTD_READ, from, len, buf, max_bytes);
+	if (ret != 0)
+		goto fail;
+
+done:
 	*retlen = len;
 
 fail:
@@ -268,53 +478,27 @@ static int vmtd_write(struct mtd_info *mtd, loff_t to, size_t len,
 		size_t *retlen, const u_char *buf)
 {
 	struct vmtd_dev *vmtddev = mtd_to_vmtd(mtd);
-	struct vs_request *vs_req;
-	size_t remaining_size = len;
-	size_t write_size;
-	const u_char *buf_addr = buf;
-	loff_t offset = to;
 	int32_t ret = 0;
 
 	dev_dbg(vmtddev->device, "%s from 0x%08x, len %zd\n",
-		__func__, (u32)offset, remaining_size);
+		__func__, (u32)to, len);
 
-	if (((offset + remaining_size) < offset) ||
-		((offset + remaining_size) > vmtddev->mtd.size)) {
+	if (((to + len) < to) ||
+		((to + len) > vmtddev->mtd.size)) {
 		dev_err(vmtddev->device, "to %llx len %lx out of range!\n",
-			offset, remaining_size);
+			to, len);
 		return -EPERM;
 	}
 
 	mutex_lock(&vmtddev->lock);
-	while (remaining_size) {
-		write_size = min_t(size_t,
-			(size_t)vmtddev->config.mtd_config.max_write_bytes_per_io,
-				remaining_size);
-		vs_req = (struct vs_request *)vmtddev->cmd_frame;
-		vs_req->type = VS_DATA_REQ;
-		vs_req->mtddev_req.req_op = VS_MTD_WRITE;
-		vs_req->mtddev_req.mtd_req.offset = offset;
-		vs_req->mtddev_req.mtd_req.size = write_size;
-		vs_req->mtddev_req.mtd_req.data_offset = 0;
-		vs_req->req_id = 0;
-
-		memcpy(vmtddev->shared_buffer, buf_addr, write_size);
-
-		ret = vmtd_process_request(vmtddev, vs_req);
-		if (ret != 0) {
-			dev_err(vmtddev->device,
-				"write for offset %llx size %lx failed!\n",
-				offset, write_size);
-			goto fail;
-		}
+	vmtd_ra_invalidate(vmtddev, to, len);
 
-		buf_addr += write_size;
-		offset += write_size;
-		remaining_size -= write_size;
-	}
-	*retlen = len;
+	/* write chunks only read from buf */
+	ret = vmtd_xfer(vmtddev, VS_MTD_WRITE, to, len, (u_char *)buf,
+		vmtddev->config.mtd_config.max_write_bytes_per_io);
+	if (ret == 0)
+		*retlen = len;
 
-fail:
 	mutex_unlock(&vmtddev->lock);
 	return ret;
 }
@@ -327,6 +511,7 @@ static int vmtd_erase(struct mtd_info *mtd, struct erase_info *instr)
 {
 	struct vmtd_dev *vmtddev = mtd_to_vmtd(mtd);
 	struct vs_request *vs_req;
+	ktime_t start;
 	int32_t ret = 0;
 
 	dev_dbg(vmtddev->device, "%s from 0x%08x, len %llx\n",
@@ -340,6 +525,9 @@ static int vmtd_erase(struct mtd_info *mtd, struct erase_info *instr)
 	}
 
 	mutex_lock(&vmtddev->lock);
+	vmtd_ra_invalidate(vmtddev, instr->addr, instr->len);
+	start = ktime_get();
+
 	vs_req = (struct vs_request *)vmtddev->cmd_frame;
 
 	vs_req->type = VS_DATA_REQ;
@@ -350,6 +538,8 @@ static int vmtd_erase(struct mtd_info *mtd, struct erase_info *instr)
 	vs_req->req_id = 0;
 
 	ret = vmtd_process_request(vmtddev, vs_req);
+	vmtddev->stats.erase.cmds++;
+	vmtddev->stats.erase.nsecs += ktime_to_ns(ktime_sub(ktime_get(), start));
 	if (ret != 0) {
 		dev_err(vmtddev->device,
 			"Erase for offset %llx size %llx failed!\n",
@@ -357,6 +547,7 @@ static int vmtd_erase(struct mtd_info *mtd, struct erase_info *instr)
 		mutex_unlock(&vmtddev->lock);
 		goto fail;
 	}
+	vmtddev->stats.erase.bytes += instr->len;
 	mutex_unlock(&vmtddev->lock);
 
 fail:
@@ -371,6 +562,8 @@ static int tegra_virt_mtd_suspend(struct device *dev)
 	if (vmtddev->is_setup) {
 		mutex_lock(&vmtddev->lock);
 		disable_irq(vmtddev->ivck->irq);
+		/* the flash may change while we are suspended */
+		vmtddev->ra_len = 0;
 		/* Reset the channel */
 		tegra_hv_ivc_channel_reset(vmtddev->ivck);
 	}
@@ -438,6 +631,32 @@ static int vmtd_setup_device(struct vmtd_dev *vmtddev)
 			vmtddev->ivmk->size;
 	}
 
+	/* one mempool slot per command in flight, at most one per frame */
+	vmtddev->slot_size = max(vmtddev->config.mtd_config.max_read_bytes_per_io,
+			vmtddev->config.mtd_config.max_write_bytes_per_io);
+	vmtddev->nslots = clamp_t(uint32_t,
+			vmtddev->ivmk->size / vmtddev->slot_size,
+			1, VMTD_MAX_INFLIGHT);
+	vmtddev->nslots = min_t(uint32_t, vmtddev->nslots,
+			vmtddev->ivck->nframes);
+	vmtddev->slots = devm_kcalloc(vmtddev->device, vmtddev->nslots,
+			sizeof(*vmtddev->slots), GFP_KERNEL);
+	if (vmtddev->slots == NULL)
+		return -ENOMEM;
+
+	vmtddev->ra_size = PAGE_ALIGN((size_t)readahead_kb * SZ_1K);
+	if (vmtddev->ra_size != 0) {
+		vmtddev->ra_buf = devm_kmalloc(vmtddev->device,
+				vmtddev->ra_size, GFP_KERNEL);
+		if (vmtddev->ra_buf == NULL) {
+			dev_warn(vmtddev->device, "no read-ahead cache\n");
+			vmtddev->ra_size = 0;
+		}
+	}
+
+	dev_info(vmtddev->device, "%u commands in flight, read-ahead %zu\n",
+		vmtddev->nslots, vmtddev->ra_size);
+
 	vmtddev->mtd.dev.parent = vmtddev->device;
 	vmtddev->mtd.writebufsize = 1;
 
@@ -468,9 +687,45 @@ static ssize_t vmtd_phys_base_show(struct device *dev,
 }
 static DEVICE_ATTR(phys_base, 0444, vmtd_phys_base_show, NULL);
 
+static void vmtd_show_op_stats(const char *name,
+		const struct vmtd_op_stats *op, char *buf, int *len)
+{
+	*len += sysfs_emit_at(buf, *len, "%s_cmds %llu\n", name, op->cmds);
+	*len += sysfs_emit_at(buf, *len, "%s_bytes %llu\n", name, op->bytes);
+	*len += sysfs_emit_at(buf, *len, "%s_usecs %llu\n", name,
+			div_u64(op->nsecs, NSEC_PER_USEC));
+	*len += sysfs_emit_at(buf, *len, "%s_kbps %llu\n", name,
+			op->nsecs ? div64_u64(op->bytes * (NSEC_PER_SEC / SZ_1K),
+				op->nsecs) : 0);
+}
+
+static ssize_t vmtd_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct vmtd_dev *vmtddev = dev_get_drvdata(dev);
+	struct vmtd_stats stats;
+	int len = 0;
+
+	mutex_lock(&vmtddev->lock);
+	stats = vmtddev->stats;
+	mutex_unlock(&vmtddev->lock);
+
+	vmtd_show_op_stats("read", &stats.read, buf, &len);
+	vmtd_show_op_stats("write", &stats.write, buf, &len);
+	vmtd_show_op_stats("erase", &stats.erase, buf, &len);
+	len += sysfs_emit_at(buf, len, "ra_hits %llu\n", stats.ra_hits);
+	len += sysfs_emit_at(buf, len, "ra_misses %llu\n", stats.ra_misses);
+	len += sysfs_emit_at(buf, len, "max_inflight %u\n",
+			stats.max_inflight);
+
+	return len;
+}
+static DEVICE_ATTR(stats, 0444, vmtd_stats_show, NULL);
+
 static const struct attribute *vmtd_storage_attrs[] = {
 	&dev_attr_phys_dev.attr,
 	&dev_attr_phys_base.attr,
+	&dev_attr_stats.attr,
 	NULL
 };
 
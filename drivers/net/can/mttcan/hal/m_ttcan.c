@@ -696,97 +696,113 @@ unsigned int ttcan_read_txevt_fifo(struct ttcan_controller *ttcan)
 
 /* Rx FIFO section */
 
-unsigned int ttcan_read_rx_fifo0(struct ttcan_controller *ttcan)
+static void ttcan_rx_batch_account(struct ttcan_rx_batch_stats *stats,
+				   unsigned int n)
+{
+	unsigned int bucket;
+
+	if (!n)
+		return;
+
+	bucket = min_t(unsigned int, fls(n) - 1, TTCAN_RX_BATCH_HIST - 1);
+	stats->batches++;
+	stats->frames += n;
+	stats->hist[bucket]++;
+	if (n > stats->max)
+		stats->max = n;
+}
+
+/*
+ * Drain every element the fill level reported in one pass. The status
+ * register is read once per batch and the FIFO is acknowledged once with
+ * the index of the last element consumed, which releases all elements up
+ * to and including it. Elements already delivered through the high
+ * priority path are skipped but still released by the same acknowledge.
+ */
+static unsigned int ttcan_read_rx_fifo_bulk(struct ttcan_controller *ttcan,
+					    enum ttcan_rx_type rxtype)
 {
-	u32 rxf0s_reg;
 	struct ttcanfd_frame ttcanfd = {0};
-	u32 read_addr;
-	int q_read = 0;
+	struct ttcan_rx_batch_stats *stats;
+	struct list_head *rx_q;
+	u64 *bmsk;
+	u32 status_reg, ack_reg, elem_size, base;
+	u32 rxfs, fill, get_idx, num, i;
+	int last_idx = -1;
 	unsigned int msgs_read = 0;
 
-	rxf0s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF0S);
-
-	if (!(rxf0s_reg & MTT_RXF0S_F0FL_MASK)) {
-		return msgs_read;
+	if (rxtype == FIFO_0) {
+		status_reg = ADR_MTTCAN_RXF0S;
+		ack_reg = ADR_MTTCAN_RXF0A;
+		base = ttcan->mram_cfg[MRAM_RXF0].off;
+		num = ttcan->mram_cfg[MRAM_RXF0].num;
+		elem_size = ttcan->e_size.rx_fifo0;
+		bmsk = &ttcan->rx_config.rxq0_bmsk;
+		rx_q = &ttcan->rx_q0;
+		stats = &ttcan->rx_batch[0];
+	} else {
+		status_reg = ADR_MTTCAN_RXF1S;
+		ack_reg = ADR_MTTCAN_RXF1A;
+		base = ttcan->mram_cfg[MRAM_RXF1].off;
+		num = ttcan->mram_cfg[MRAM_RXF1].num;
+		elem_size = ttcan->e_size.rx_fifo1;
+		bmsk = &ttcan->rx_config.rxq1_bmsk;
+		rx_q = &ttcan->rx_q1;
+		stats = &ttcan->rx_batch[1];
 	}
 
+	if (!num)
+		return 0;
+
+	/* F0S and F1S share the same field layout */
+	rxfs = ttcan_read32(ttcan, status_reg);
+	fill = (rxfs & MTT_RXF0S_F0FL_MASK) >> MTT_RXF0S_F0FL_SHIFT;
+	get_idx = (rxfs & MTT_RXF0S_F0GI_MASK) >> MTT_RXF0S_F0GI_SHIFT;
+
 	/* Read at max queue size in one attempt */
-	q_read = ttcan->mram_cfg[MRAM_RXF0].num;
+	fill = min(fill, num);
+
+	for (i = 0; i < fill; i++) {
+		u32 idx = (get_idx + i) % num;
+		u32 read_addr;
 
-	while ((rxf0s_reg & MTT_RXF0S_F0FL_MASK) && q_read--) {
-		u32 get_idx = (rxf0s_reg & MTT_RXF0S_F0GI_MASK) >>
-		    MTT_RXF0S_F0GI_SHIFT;
-		if (ttcan->rx_config.rxq0_bmsk & (1 << get_idx)) {
+		if (*bmsk & (1ULL << idx)) {
 			/* All ready process on High priority */
-			ttcan_write32(ttcan, ADR_MTTCAN_RXF0A, get_idx);
-			ttcan->rx_config.rxq0_bmsk &= ~(1U << get_idx);
-			rxf0s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF0S);
+			*bmsk &= ~(1ULL << idx);
+			last_idx = idx;
 			continue;
 		}
 
-		read_addr = ttcan->mram_cfg[MRAM_RXF0].off +
-		    (get_idx * ttcan->e_size.rx_fifo0);
+		read_addr = base + (idx * elem_size);
 
-		pr_debug("%s:fifo0: read_addr %x FOGI %x\n", __func__,
-			 read_addr, get_idx);
+		pr_debug("%s:fifo%d: read_addr %x GI %x\n", __func__,
+			 rxtype == FIFO_0 ? 0 : 1, read_addr, idx);
 
 		ttcan_read_rx_msg_ram(ttcan, read_addr, &ttcanfd);
-		if (add_msg_controller_list(ttcan, &ttcanfd,
-					    &ttcan->rx_q0, FIFO_0) < 0) {
+		if (add_msg_controller_list(ttcan, &ttcanfd, rx_q, rxtype) < 0) {
 			pr_err("%s: failed to add to list\n", __func__);
-			return msgs_read;
+			break;
 		}
-		ttcan_write32(ttcan, ADR_MTTCAN_RXF0A, get_idx);
-		rxf0s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF0S);
+		last_idx = idx;
 		msgs_read++;
 	}
-	return msgs_read;
-}
 
-unsigned int ttcan_read_rx_fifo1(struct ttcan_controller *ttcan)
-{
-	u32 rxf1s_reg;
-	struct ttcanfd_frame ttcanfd = {0};
-	u32 read_addr;
-	int q_read = 0;
-	int msgs_read = 0;
+	if (last_idx >= 0)
+		ttcan_write32(ttcan, ack_reg, last_idx);
 
-	rxf1s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF1S);
-
-	if (!(rxf1s_reg & MTT_RXF1S_F1FL_MASK)) {
-		return msgs_read;
-	}
+	ttcan_rx_batch_account(stats, msgs_read);
 
-	/* Read at max queue size in one attempt */
-	q_read = ttcan->mram_cfg[MRAM_RXF1].num;
-
-	while ((rxf1s_reg & MTT_RXF1S_F1FL_MASK) && q_read--) {
-		u32 get_idx = (rxf1s_reg & MTT_RXF1S_F1GI_MASK) >>
-		    MTT_RXF1S_F1GI_SHIFT;
-		if (ttcan->rx_config.rxq1_bmsk & (1 << get_idx)) {
-			/* All ready process on High priority */
-			ttcan_write32(ttcan, ADR_MTTCAN_RXF1A, get_idx);
-			ttcan->rx_config.rxq1_bmsk &= ~(1U << get_idx);
-			rxf1s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF1S);
-			continue;
-		}
-		read_addr = ttcan->mram_cfg[MRAM_RXF1].off +
-		    (get_idx * ttcan->e_size.rx_fifo1);
+	return msgs_read;
+}
 
-		pr_debug("%s:fifo1: read_addr %x FOGI %x\n", __func__,
-			 read_addr, get_idx);
+unsigned int ttcan_read_rx_fifo0(struct ttcan_controller *ttcan)
+{
+	return ttcan_read_rx_fifo_bulk(ttcan, FIFO_0);
+}
 
-		ttcan_read_rx_msg_ram(ttcan, read_addr, &ttcanfd);
-		if (add_msg_controller_list(ttcan, &ttcanfd,
-					    &ttcan->rx_q1, FIFO_1) < 0) {
-			pr_err("%s: failed to add to list\n", __func__);
-			return msgs_read;
-		}
-		ttcan_write32(ttcan, ADR_MTTCAN_RXF1A, get_idx);
-		rxf1s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF1S);
-		msgs_read++;
-	}
-	return msgs_read;
+unsigned int ttcan_read_rx_fifo1(struct ttcan_controller *ttcan)
+{
+	return ttcan_read_rx_fifo_bulk(ttcan, FIFO_1);
 }
 
 /* Returns message read else return 0 */
@@ -260,6 +260,16 @@ struct ttcan_rxbuff_config {
 	u64 rxb_bmsk;
 };
 
+/* RX batch sizes in power of two buckets: 1, 2-3, 4-7, ... 64 */
+#define TTCAN_RX_BATCH_HIST	7
+
+struct ttcan_rx_batch_stats {
+	u64 batches;
+	u64 frames;
+	u32 max;
+	u32 hist[TTCAN_RX_BATCH_HIST];
+};
+
 struct ttcan_filter_config {
 	u32 std_fltr_size;
 	u32 xtd_fltr_size;
@@ -287,6 +297,7 @@ struct ttcan_controller {
 	struct list_head rx_q1;
 	struct list_head rx_b;
 	struct list_head tx_evt;
+	struct ttcan_rx_batch_stats rx_batch[2]; /* RX FIFO 0 and 1 */
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
 	struct tegra_prod *prod_list;
 #else
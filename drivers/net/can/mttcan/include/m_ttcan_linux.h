@@ -56,12 +56,27 @@
 #define MTT_MAX_TX_CONF		4
 #define MTT_MAX_RX_CONF		3
 
+/*
+ * TX queue 0 feeds the dedicated TX buffers and carries frames selected by
+ * skb->priority, by CAN ID or by an mqprio mapping. TX queue 1 feeds the
+ * TX FIFO/queue with the remaining bulk traffic.
+ */
+#define MTTCAN_TXQ_PRIO		0
+#define MTTCAN_TXQ_BULK		1
+#define MTTCAN_NUM_TXQ		2
+#define MTTCAN_TX_PRIO_IDS	8
+#define MTTCAN_TX_PRIO_OFF	U32_MAX
+
 #define MTTCAN_POLL_TIME	50
 #define MTTCAN_HWTS_ROLLOVER	250
 /* block period in ms */
 #define TX_BLOCK_PERIOD		200
 #define TSC_REF_CLK_RATE	31250000
 
+/* hwts_rx_mask bits, the RX paths use their enum ttcan_rx_type value */
+#define MTTCAN_HWTS_RX_HPM	0x10U
+#define MTTCAN_HWTS_RX_ALL	(0x7U | MTTCAN_HWTS_RX_HPM)
+
 #define MTTCAN_TSC_SIZE		16U
 #define MTTCAN_TSC_MASK		0xFFFFULL
 #define TSC_REF_CLK_SHIFT	9U
@@ -78,6 +93,17 @@ struct can_gpio {
 	int active_low;
 };
 
+struct mttcan_tx_prio_id {
+	u32 id;
+	u32 mask;
+};
+
+struct mttcan_txq_stats {
+	u64 frames;
+	u64 lat_sum_ns;
+	u64 lat_max_ns;
+};
+
 struct mttcan_priv {
 	struct can_priv can;
 	struct ttcan_controller *ttcan;
@@ -119,6 +145,13 @@ struct mttcan_priv {
 	u32 rx_conf[MTT_MAX_RX_CONF]; /*<rxb_dsize, rxq0_dsize, rxq1_dsize>*/
 	bool poll;
 	bool hwts_rx_en;
+	u32 hwts_rx_mask; /* RX paths that get a hardware timestamp */
+	u32 tx_prio_min; /* lowest skb->priority sent on MTTCAN_TXQ_PRIO */
+	u32 num_tx_prio_ids;
+	struct mttcan_tx_prio_id tx_prio_ids[MTTCAN_TX_PRIO_IDS];
+	u8 tx_msg_queue[MTT_CAN_TX_OBJ_NUM];
+	u64 tx_msg_start[MTT_CAN_TX_OBJ_NUM];
+	struct mttcan_txq_stats tx_stats[MTTCAN_NUM_TXQ]; /* under tx_lock */
 	u32 resp;
 };
 
@@ -360,7 +360,7 @@ static int mttcan_hpm_do_receive(struct net_device *dev,
 		stats->rx_bytes += frame->can_dlc;
 	}
 
-	if (priv->hwts_rx_en)
+	if (priv->hwts_rx_en && (priv->hwts_rx_mask & MTTCAN_HWTS_RX_HPM))
 		mttcan_rx_hwtstamp(priv, skb, msg);
 
 	netif_receive_skb(skb);
@@ -379,12 +379,15 @@ static int mttcan_read_rcv_list(struct net_device *dev,
 	struct mttcan_priv *priv = netdev_priv(dev);
 	struct ttcan_rx_msg_list *rx;
 	struct net_device_stats *stats = &dev->stats;
-	struct list_head *cur, *next, rx_q;
+	struct list_head *cur, *next, rx_q, skbs;
+	bool hwts;
 
 	if (list_empty(rcv))
 		return 0;
 
 	INIT_LIST_HEAD(&rx_q);
+	INIT_LIST_HEAD(&skbs);
+	hwts = priv->hwts_rx_en && (priv->hwts_rx_mask & rx_type);
 
 	spin_lock_irqsave(&priv->ttcan->lock, flags);
 	switch (rx_type) {
@@ -419,6 +422,7 @@ static int mttcan_read_rcv_list(struct net_device *dev,
 			skb = alloc_canfd_skb(dev, &fd_frame);
 			if (!skb) {
 				stats->rx_dropped += pushed;
+				netif_receive_skb_list(&skbs);
 				return 0;
 			}
 			memcpy(fd_frame, &rx->msg, sizeof(struct canfd_frame));
@@ -427,6 +431,7 @@ static int mttcan_read_rcv_list(struct net_device *dev,
 			skb = alloc_can_skb(dev, &frame);
 			if (!skb) {
 				stats->rx_dropped += pushed;
+				netif_receive_skb_list(&skbs);
 				return 0;
 			}
 			frame->can_id =  rx->msg.can_id;
@@ -441,13 +446,17 @@ static int mttcan_read_rcv_list(struct net_device *dev,
 			stats->rx_bytes += frame->can_dlc;
 		}
 
-		if (priv->hwts_rx_en)
+		if (hwts)
 			mttcan_rx_hwtstamp(priv, skb, &rx->msg);
 		kfree(rx);
-		netif_receive_skb(skb);
+		list_add_tail(&skb->list, &skbs);
 		stats->rx_packets++;
 		pushed--;
 	}
+
+	/* Hand the whole batch to the stack in one go */
+	netif_receive_skb_list(&skbs);
+
 	return rec_msgs - pushed;
 }
 
@@ -506,7 +515,7 @@ static int mttcan_state_change(struct net_device *dev,
 		ttcan_set_intrpts(priv->ttcan, 0);
 		priv->can.can_stats.bus_off++;
 		priv->ttcan->tx_object = 0;
-		netif_stop_queue(dev);
+		netif_tx_stop_all_queues(dev);
 		netif_carrier_off(dev);
 
 		if (priv->can.restart_ms)
@@ -629,6 +638,18 @@ static void mttcan_tx_event(struct net_device *dev)
 	}
 }
 
+/* Called with tx_lock held for every completed TX buffer */
+static void mttcan_tx_account(struct mttcan_priv *priv, u32 msg_no, u64 now)
+{
+	struct mttcan_txq_stats *txq = &priv->tx_stats[priv->tx_msg_queue[msg_no]];
+	u64 lat = now - priv->tx_msg_start[msg_no];
+
+	txq->frames++;
+	txq->lat_sum_ns += lat;
+	if (lat > txq->lat_max_ns)
+		txq->lat_max_ns = lat;
+}
+
 static void mttcan_tx_complete(struct net_device *dev)
 {
 	struct mttcan_priv *priv = netdev_priv(dev);
@@ -636,6 +657,7 @@ static void mttcan_tx_complete(struct net_device *dev)
 	struct net_device_stats *stats = &dev->stats;
 	u32 msg_no;
 	u32 completed_tx;
+	u64 now = ktime_get_ns();
 
 	spin_lock(&priv->tx_lock);
 	completed_tx = ttcan_read_tx_complete_reg(ttcan);
@@ -649,13 +671,13 @@ static void mttcan_tx_complete(struct net_device *dev)
 		can_led_event(dev, CAN_LED_EVENT_TX);
 #endif
 		clear_bit(msg_no, &ttcan->tx_object);
+		mttcan_tx_account(priv, msg_no, now);
 		stats->tx_packets++;
 		stats->tx_bytes += can_get_echo_skb(dev, msg_no, NULL);
 		completed_tx &= ~(1U << msg_no);
 	}
 
-	if (netif_queue_stopped(dev))
-		netif_wake_queue(dev);
+	netif_tx_wake_all_queues(dev);
 	spin_unlock(&priv->tx_lock);
 }
 
@@ -674,8 +696,8 @@ static void mttcan_tx_cancelled(struct net_device *dev)
 		~(ttcan->tx_obj_cancelled);
 	ttcan->tx_obj_cancelled = cancelled_reg;
 
-	if (cancelled_msg && netif_queue_stopped(dev))
-		netif_wake_queue(dev);
+	if (cancelled_msg)
+		netif_tx_wake_all_queues(dev);
 
 	while (cancelled_msg) {
 		msg_no = ffs(cancelled_msg) - 1;
@@ -1183,7 +1205,7 @@ static int mttcan_set_mode(struct net_device *dev, enum can_mode mode)
 	switch (mode) {
 	case CAN_MODE_START:
 		mttcan_start(dev);
-		netif_wake_queue(dev);
+		netif_tx_wake_all_queues(dev);
 		break;
 	default:
 		return -EOPNOTSUPP;
@@ -1196,7 +1218,8 @@ static struct net_device *alloc_mttcan_dev(void)
 	struct net_device *dev;
 	struct mttcan_priv *priv;
 
-	dev = alloc_candev(sizeof(struct mttcan_priv), MTT_CAN_TX_OBJ_NUM);
+	dev = alloc_candev_mqs(sizeof(struct mttcan_priv), MTT_CAN_TX_OBJ_NUM,
+			       MTTCAN_NUM_TXQ, 1);
 	if (!dev)
 		return NULL;
 
@@ -1206,6 +1229,7 @@ static struct net_device *alloc_mttcan_dev(void)
 	priv = netdev_priv(dev);
 
 	priv->dev = dev;
+	priv->tx_prio_min = MTTCAN_TX_PRIO_OFF;
 	priv->can.bittiming_const = &mttcan_normal_bittiming_const;
 	priv->can.data_bittiming_const = &mttcan_data_bittiming_const;
 	priv->can.do_set_bittiming = mttcan_do_set_bittiming;
@@ -1358,7 +1382,7 @@ static int mttcan_close(struct net_device *dev)
 {
 	struct mttcan_priv *priv = netdev_priv(dev);
 
-	netif_stop_queue(dev);
+	netif_tx_stop_all_queues(dev);
 	napi_disable(&priv->napi);
 	mttcan_stop(priv);
 	free_irq(dev->irq, dev);
@@ -1380,12 +1404,70 @@ static int mttcan_close(struct net_device *dev)
 	return 0;
 }
 
+static bool mttcan_tx_prio_enabled(struct mttcan_priv *priv)
+{
+	return netdev_get_num_tc(priv->dev) ||
+		READ_ONCE(priv->tx_prio_min) != MTTCAN_TX_PRIO_OFF ||
+		READ_ONCE(priv->num_tx_prio_ids);
+}
+
+static u16 mttcan_select_queue(struct net_device *dev, struct sk_buff *skb,
+			       struct net_device *sb_dev)
+{
+	struct mttcan_priv *priv = netdev_priv(dev);
+	struct canfd_frame *frame = (struct canfd_frame *)skb->data;
+	u32 i, num_ids;
+
+	/* An mqprio qdisc owns the priority to queue mapping */
+	if (netdev_get_num_tc(dev))
+		return netdev_pick_tx(dev, skb, sb_dev);
+
+	if (skb->priority >= READ_ONCE(priv->tx_prio_min))
+		return MTTCAN_TXQ_PRIO;
+
+	num_ids = smp_load_acquire(&priv->num_tx_prio_ids);
+	for (i = 0; i < num_ids; i++) {
+		if (!((frame->can_id ^ priv->tx_prio_ids[i].id) &
+		      priv->tx_prio_ids[i].mask))
+			return MTTCAN_TXQ_PRIO;
+	}
+
+	return MTTCAN_TXQ_BULK;
+}
+
+/*
+ * Priority frames go to the dedicated buffers first, where the controller
+ * arbitrates them by CAN ID ahead of the FIFO. Bulk frames stay in the
+ * FIFO so they can never occupy a dedicated buffer, unless no priority
+ * mapping is configured at all or there is no FIFO.
+ */
+static int mttcan_tx_write(struct mttcan_priv *priv, u16 txq,
+			   struct ttcanfd_frame *frame)
+{
+	struct ttcan_controller *ttcan = priv->ttcan;
+	int msg_no = -ENOMEM;
+
+	if (txq == MTTCAN_TXQ_PRIO || !ttcan->tx_config.fifo_q_num) {
+		msg_no = ttcan_tx_msg_buffer_write(ttcan, frame);
+		if (msg_no < 0 && ttcan->tx_config.fifo_q_num)
+			msg_no = ttcan_tx_fifo_queue_msg(ttcan, frame);
+		return msg_no;
+	}
+
+	msg_no = ttcan_tx_fifo_queue_msg(ttcan, frame);
+	if (msg_no < 0 && !mttcan_tx_prio_enabled(priv))
+		msg_no = ttcan_tx_msg_buffer_write(ttcan, frame);
+
+	return msg_no;
+}
+
 static netdev_tx_t mttcan_start_xmit(struct sk_buff *skb,
 				     struct net_device *dev)
 {
 	int msg_no = -1;
 	struct mttcan_priv *priv = netdev_priv(dev);
 	struct canfd_frame *frame = (struct canfd_frame *)skb->data;
+	u16 txq = skb_get_queue_mapping(skb);
 
 	if (can_dropped_invalid_skb(dev, skb))
 		return NETDEV_TX_OK;
@@ -1393,21 +1475,22 @@ static netdev_tx_t mttcan_start_xmit(struct sk_buff *skb,
 	if (can_is_canfd_skb(skb))
 		frame->flags |= CAN_FD_FLAG;
 
+	/* mqprio may map a class to any queue, everything past 0 is bulk */
+	if (txq != MTTCAN_TXQ_PRIO)
+		txq = MTTCAN_TXQ_BULK;
+
 	spin_lock_bh(&priv->tx_lock);
 
 	/* Write Tx message to controller */
-	msg_no = ttcan_tx_msg_buffer_write(priv->ttcan,
-			(struct ttcanfd_frame *)frame);
-	if (msg_no < 0)
-		msg_no = ttcan_tx_fifo_queue_msg(priv->ttcan,
-				(struct ttcanfd_frame *)frame);
-
+	msg_no = mttcan_tx_write(priv, txq, (struct ttcanfd_frame *)frame);
 	if (msg_no < 0) {
-		netif_stop_queue(dev);
+		netif_stop_subqueue(dev, skb_get_queue_mapping(skb));
 		spin_unlock_bh(&priv->tx_lock);
 		return NETDEV_TX_BUSY;
 	}
 	can_put_echo_skb(skb, dev, msg_no, 0);
+	priv->tx_msg_queue[msg_no] = txq;
+	priv->tx_msg_start[msg_no] = ktime_get_ns();
 
 	/* Set go bit for non-TTCAN messages */
 	if (!priv->tt_param[0])
@@ -1565,6 +1648,7 @@ static const struct net_device_ops mttcan_netdev_ops = {
 	.ndo_open = mttcan_open,
 	.ndo_stop = mttcan_close,
 	.ndo_start_xmit = mttcan_start_xmit,
+	.ndo_select_queue = mttcan_select_queue,
 	.ndo_change_mtu = mttcan_change_mtu,
 #if KERNEL_VERSION(5, 15, 0) <= LINUX_VERSION_CODE
 	.ndo_eth_ioctl = mttcan_ioctl,
@@ -1861,6 +1945,7 @@ static int mttcan_probe(struct platform_device *pdev)
 	INIT_LIST_HEAD(&priv->ttcan->rx_q1);
 	INIT_LIST_HEAD(&priv->ttcan->rx_b);
 	INIT_LIST_HEAD(&priv->ttcan->tx_evt);
+	priv->hwts_rx_mask = MTTCAN_HWTS_RX_ALL;
 
 	platform_set_drvdata(pdev, dev);
 	SET_NETDEV_DEV(dev, &pdev->dev);
@@ -1954,7 +2039,7 @@ static int mttcan_suspend(struct platform_device *pdev, pm_message_t state)
 	int timeout = CAN_MSG_FLUSH_TIMEOUT;
 
 	if (netif_running(ndev)) {
-		netif_stop_queue(ndev);
+		netif_tx_stop_all_queues(ndev);
 		netif_device_detach(ndev);
 	}
 
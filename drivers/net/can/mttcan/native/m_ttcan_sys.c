@@ -688,6 +688,189 @@ static ssize_t store_tdc_offset(struct device *dev,
 	return count;
 }
 
+static ssize_t show_hwts_rx_mask(struct device *dev,
+				 struct device_attribute *devattr, char *buf)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+
+	return sprintf(buf, "0x%x (rxb=0x%x rxq0=0x%x rxq1=0x%x hpm=0x%x)\n",
+		priv->hwts_rx_mask, BUFFER, FIFO_0, FIFO_1,
+		MTTCAN_HWTS_RX_HPM);
+}
+
+static ssize_t store_hwts_rx_mask(struct device *dev,
+				  struct device_attribute *devattr,
+				  const char *buf, size_t count)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+	unsigned int mask = 0;
+
+	if ((sscanf(buf, "%X", &mask) != 1) || (mask & ~MTTCAN_HWTS_RX_ALL)) {
+		dev_err(dev, "wrong hwts_rx_mask\n");
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(priv->hwts_rx_mask, mask);
+
+	return count;
+}
+
+static ssize_t show_rx_batch_stats(struct device *dev,
+				   struct device_attribute *devattr, char *buf)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+	struct ttcan_rx_batch_stats *stats;
+	ssize_t total = 0;
+	int q, i;
+
+	for (q = 0; q < ARRAY_SIZE(priv->ttcan->rx_batch); q++) {
+		stats = &priv->ttcan->rx_batch[q];
+		total += scnprintf(buf + total, PAGE_SIZE - total,
+			"rxq%d: batches=%llu frames=%llu max=%u hist=", q,
+			stats->batches, stats->frames, stats->max);
+		for (i = 0; i < TTCAN_RX_BATCH_HIST; i++)
+			total += scnprintf(buf + total, PAGE_SIZE - total,
+				"%s%u", i ? "," : "", stats->hist[i]);
+		total += scnprintf(buf + total, PAGE_SIZE - total, "\n");
+	}
+
+	return total;
+}
+
+static ssize_t store_rx_batch_stats(struct device *dev,
+				    struct device_attribute *devattr,
+				    const char *buf, size_t count)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+
+	/* Any write clears the counters, a racing poll only skews them */
+	memset(priv->ttcan->rx_batch, 0, sizeof(priv->ttcan->rx_batch));
+
+	return count;
+}
+
+static ssize_t show_tx_prio(struct device *dev,
+			    struct device_attribute *devattr, char *buf)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+
+	if (priv->tx_prio_min == MTTCAN_TX_PRIO_OFF)
+		return sprintf(buf, "off\n");
+
+	return sprintf(buf, "%u\n", priv->tx_prio_min);
+}
+
+static ssize_t store_tx_prio(struct device *dev,
+			     struct device_attribute *devattr,
+			     const char *buf, size_t count)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+	unsigned int prio = 0;
+
+	if (sysfs_streq(buf, "off")) {
+		WRITE_ONCE(priv->tx_prio_min, MTTCAN_TX_PRIO_OFF);
+		return count;
+	}
+
+	if ((kstrtouint(buf, 0, &prio) != 0) || prio == MTTCAN_TX_PRIO_OFF) {
+		dev_err(dev, "wrong tx_prio\n");
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(priv->tx_prio_min, prio);
+
+	return count;
+}
+
+static ssize_t show_tx_prio_ids(struct device *dev,
+				struct device_attribute *devattr, char *buf)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+	ssize_t total = 0;
+	u32 i;
+
+	for (i = 0; i < priv->num_tx_prio_ids; i++)
+		total += scnprintf(buf + total, PAGE_SIZE - total,
+			"%u. id 0x%x mask 0x%x\n", i,
+			priv->tx_prio_ids[i].id, priv->tx_prio_ids[i].mask);
+
+	return total;
+}
+
+/* "<id> <mask>" in hex adds an entry, "clear" removes all of them */
+static ssize_t store_tx_prio_ids(struct device *dev,
+				 struct device_attribute *devattr,
+				 const char *buf, size_t count)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+	unsigned int id = 0, mask = 0;
+	u32 num = priv->num_tx_prio_ids;
+
+	if (sysfs_streq(buf, "clear")) {
+		WRITE_ONCE(priv->num_tx_prio_ids, 0);
+		return count;
+	}
+
+	if (sscanf(buf, "%X %X", &id, &mask) != 2) {
+		dev_err(dev, "wrong tx_prio_ids entry\n");
+		return -EINVAL;
+	}
+
+	if (num >= MTTCAN_TX_PRIO_IDS) {
+		dev_err(dev, "tx_prio_ids is full\n");
+		return -ENOSPC;
+	}
+
+	mask &= CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_EFF_MASK;
+	priv->tx_prio_ids[num].id = id & mask;
+	priv->tx_prio_ids[num].mask = mask;
+	/* publish the entry before the select path can see it */
+	smp_store_release(&priv->num_tx_prio_ids, num + 1);
+
+	return count;
+}
+
+static ssize_t show_tx_latency(struct device *dev,
+			       struct device_attribute *devattr, char *buf)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+	struct mttcan_txq_stats stats[MTTCAN_NUM_TXQ];
+	static const char * const names[MTTCAN_NUM_TXQ] = {
+		[MTTCAN_TXQ_PRIO] = "prio",
+		[MTTCAN_TXQ_BULK] = "bulk",
+	};
+	ssize_t total = 0;
+	int q;
+
+	spin_lock_bh(&priv->tx_lock);
+	memcpy(stats, priv->tx_stats, sizeof(stats));
+	spin_unlock_bh(&priv->tx_lock);
+
+	for (q = 0; q < MTTCAN_NUM_TXQ; q++)
+		total += scnprintf(buf + total, PAGE_SIZE - total,
+			"%s: frames=%llu avg_ns=%llu max_ns=%llu\n", names[q],
+			stats[q].frames,
+			stats[q].frames ?
+				div64_u64(stats[q].lat_sum_ns, stats[q].frames) : 0,
+			stats[q].lat_max_ns);
+
+	return total;
+}
+
+static ssize_t store_tx_latency(struct device *dev,
+				struct device_attribute *devattr,
+				const char *buf, size_t count)
+{
+	struct mttcan_priv *priv = netdev_priv(to_net_dev(dev));
+
+	/* Any write clears the counters */
+	spin_lock_bh(&priv->tx_lock);
+	memset(priv->tx_stats, 0, sizeof(priv->tx_stats));
+	spin_unlock_bh(&priv->tx_lock);
+
+	return count;
+}
+
 static DEVICE_ATTR(std_filter, S_IRUGO | S_IWUSR, show_std_fltr,
 	store_std_fltr);
 static DEVICE_ATTR(xtd_filter, S_IRUGO | S_IWUSR, show_xtd_fltr,
@@ -708,6 +891,15 @@ static DEVICE_ATTR(trigger_mem, S_IRUGO | S_IWUSR, show_trigger_mem,
 		store_trigger_mem);
 static DEVICE_ATTR(tdc_offset, S_IRUGO | S_IWUSR, show_tdc_offset,
 		store_tdc_offset);
+static DEVICE_ATTR(hwts_rx_mask, S_IRUGO | S_IWUSR, show_hwts_rx_mask,
+		store_hwts_rx_mask);
+static DEVICE_ATTR(rx_batch_stats, S_IRUGO | S_IWUSR, show_rx_batch_stats,
+		store_rx_batch_stats);
+static DEVICE_ATTR(tx_prio, S_IRUGO | S_IWUSR, show_tx_prio, store_tx_prio);
+static DEVICE_ATTR(tx_prio_ids, S_IRUGO | S_IWUSR, show_tx_prio_ids,
+		store_tx_prio_ids);
+static DEVICE_ATTR(tx_latency, S_IRUGO | S_IWUSR, show_tx_latency,
+		store_tx_latency);
 
 static struct attribute *mttcan_attr[] = {
 	&dev_attr_std_filter.attr,
@@ -723,6 +915,11 @@ static struct attribute *mttcan_attr[] = {
 	&dev_attr_cccr_init_txbar.attr,
 	&dev_attr_trigger_mem.attr,
 	&dev_attr_tdc_offset.attr,
+	&dev_attr_hwts_rx_mask.attr,
+	&dev_attr_rx_batch_stats.attr,
+	&dev_attr_tx_prio.attr,
+	&dev_attr_tx_prio_ids.attr,
+	&dev_attr_tx_latency.attr,
 	NULL
 };
 
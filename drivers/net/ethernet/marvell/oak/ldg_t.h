@@ -27,6 +27,7 @@ typedef struct ldg_tstruct {
 	u32 irq_first;
 	u32 irq_count;
 	u32 msi_grp;
+	u32 cpu;		/* CPU the vector is affine to */
 	char msiname[32];
 } ldg_t;
 
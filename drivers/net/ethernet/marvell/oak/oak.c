@@ -91,6 +91,7 @@ int rto = 100;
 int mhdr;
 u32 port_speed = 10;
 int napi_wt = NAPI_POLL_WEIGHT;
+int rxsteer;
 
 /* software level defination */
 #define SOFTWARE_INIT 10
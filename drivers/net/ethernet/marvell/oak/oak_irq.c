@@ -62,12 +62,27 @@ static void oak_irq_reset_gicu_ldg(struct oak_tstruct *np)
 	}
 }
 
+/* Name        : oak_irq_ring_grp
+ * Returns     : u32
+ * Parameters  : struct oak_tstruct *np, u32 ring
+ * Description : This function returns the group serving a tx/rx ring pair.
+ * TX ring n and RX ring n share a group so that one MSI-X vector, and so one
+ * NAPI context and one CPU, handles both directions of netdev queue n.
+ */
+static u32 oak_irq_ring_grp(struct oak_tstruct *np, u32 ring)
+{
+	if (np->gicu.num_ldg > 0)
+		ring %= np->gicu.num_ldg;
+
+	return ring;
+}
+
 /* Name        : oak_irq_set_tx_rx_dma_bit
- * Returns     : int
- * Parameters  : struct oak_tstruct *np, int grp
+ * Returns     : void
+ * Parameters  : struct oak_tstruct *np
  * Description : This function sets the tx and rx bit of a dma channel
  */
-static u32 oak_irq_set_tx_rx_dma_bit(struct oak_tstruct *np, u32 grp)
+static void oak_irq_set_tx_rx_dma_bit(struct oak_tstruct *np)
 {
 	u32 i = 0;
 	u64 val;
@@ -75,11 +90,8 @@ static u32 oak_irq_set_tx_rx_dma_bit(struct oak_tstruct *np, u32 grp)
 	val = (1UL << TX_DMA_BIT);
 	/* Set tx DMA bit for all the tx channels */
 	while (i < np->num_tx_chan) {
-		if (np->gicu.num_ldg > 0)
-			grp = (grp % np->gicu.num_ldg);
-		np->gicu.ldg[grp].msi_tx |= val;
+		np->gicu.ldg[oak_irq_ring_grp(np, i)].msi_tx |= val;
 		val <<= 4ULL;
-		++grp;
 		++i;
 	}
 
@@ -87,22 +99,18 @@ static u32 oak_irq_set_tx_rx_dma_bit(struct oak_tstruct *np, u32 grp)
 	val = (1UL << RX_DMA_BIT);
 	/* Set rx DMA bit for all the rx channels */
 	while (i < np->num_rx_chan) {
-		if (np->gicu.num_ldg > 0)
-			grp = (grp % np->gicu.num_ldg);
-		np->gicu.ldg[grp].msi_rx |= val;
+		np->gicu.ldg[oak_irq_ring_grp(np, i)].msi_rx |= val;
 		val <<= 4UL;
-		++grp;
 		++i;
 	}
-	return grp;
 }
 
 /* Name        : oak_irq_set_tx_rx_err_bit
  * Returns     : void
- * Parameters  : struct oak_tstruct *np, int grp
+ * Parameters  : struct oak_tstruct *np
  * Description : This function sets the tx and rx err bit of a dma channel
  */
-static void oak_irq_set_tx_rx_err_bit(struct oak_tstruct *np, u32 grp)
+static void oak_irq_set_tx_rx_err_bit(struct oak_tstruct *np)
 {
 	u32 i = 0;
 	u64 val;
@@ -110,11 +118,8 @@ static void oak_irq_set_tx_rx_err_bit(struct oak_tstruct *np, u32 grp)
 	val = (1UL << TX_ERR_BIT);
 	/* Set tx error bit for all the tx channels */
 	while (i < np->num_tx_chan) {
-		if (np->gicu.num_ldg > 0)
-			grp = (grp % np->gicu.num_ldg);
-		np->gicu.ldg[grp].msi_te |= val;
+		np->gicu.ldg[oak_irq_ring_grp(np, i)].msi_te |= val;
 		val <<= 4ULL;
-		++grp;
 		++i;
 	}
 
@@ -122,11 +127,8 @@ static void oak_irq_set_tx_rx_err_bit(struct oak_tstruct *np, u32 grp)
 	val = (1UL << RX_ERR_BIT);
 	/* Set rx error bit for all the rx channels */
 	while (i < np->num_rx_chan) {
-		if (np->gicu.num_ldg > 0)
-			grp = (grp % np->gicu.num_ldg);
-		np->gicu.ldg[grp].msi_re |= val;
+		np->gicu.ldg[oak_irq_ring_grp(np, i)].msi_re |= val;
 		val <<= 4ULL;
-		++grp;
 		++i;
 	}
 }
@@ -248,15 +250,16 @@ static int oak_irq_request_single_ivec(struct oak_tstruct *np, ldg_t *ldg,
  */
 static int oak_irq_allocate_ivec(struct oak_tstruct *np)
 {
+	int node = dev_to_node(&np->pdev->dev);
 	u32 i = 0;
-	u32 cpu;
 	int err = 0;
 
-	cpu = cpumask_first(cpu_online_mask);
-	/* In a loop we need to check for all the available online CPU and then
-	 * request and map IRQ line from linux kernel. The function call
-	 * oak_irq_request_single_ivec finally endup calling request_irq and
-	 * irq_set_affinity_hint linux kernel functions.
+	/* Request and map an IRQ line from linux kernel for every group. The
+	 * function call oak_irq_request_single_ivec finally endup calling
+	 * request_irq and irq_set_affinity_hint linux kernel functions. Each
+	 * group gets its own CPU, taken from the CPUs local to the device
+	 * first, so the ring pairs are spread out instead of all landing on
+	 * the CPU that happens to take the interrupts.
 	 */
 	while ((i < np->gicu.num_ldg) && (err == 0)) {
 		u64 val;
@@ -265,10 +268,9 @@ static int oak_irq_allocate_ivec(struct oak_tstruct *np)
 		val = (p->msi_tx | p->msi_rx | p->msi_te | p->msi_re
 				| p->msi_ge);
 		if (val != 0) {
-			err = oak_irq_request_single_ivec(np, p, val, i, cpu);
-			cpu = cpumask_next(cpu, cpu_online_mask);
-			if (cpu >= nr_cpu_ids)
-				cpu = cpumask_first(cpu_online_mask);
+			p->cpu = cpumask_local_spread(i, node);
+			err = oak_irq_request_single_ivec(np, p, val, i,
+							  p->cpu);
 			if (err != 0) {
 				/* Reset ldg MSI structure members */
 				p->msi_tx = 0;
@@ -290,7 +292,6 @@ static int oak_irq_allocate_ivec(struct oak_tstruct *np)
  */
 int oak_irq_request_ivec(struct oak_tstruct *np)
 {
-	u32 grp = 0;
 	u32 num_chan_req;
 	int err = 0;
 
@@ -304,8 +305,8 @@ int oak_irq_request_ivec(struct oak_tstruct *np)
 
 	if (num_chan_req <= MAX_NUM_OF_CHANNELS) {
 		oak_irq_reset_gicu_ldg(np);
-		grp = oak_irq_set_tx_rx_dma_bit(np, grp);
-		oak_irq_set_tx_rx_err_bit(np, grp);
+		oak_irq_set_tx_rx_dma_bit(np);
+		oak_irq_set_tx_rx_err_bit(np);
 	} else {
 		err = -ENOMEM;
 	}
@@ -46,4 +46,7 @@ MODULE_PARM_DESC(mhdr, "Unimac 11 Port speed");
 module_param(napi_wt, int, 0);
 MODULE_PARM_DESC(napi_wt, "NAPI Poll weight/budget");
 
+module_param(rxsteer, int, 0);
+MODULE_PARM_DESC(rxsteer, "Steer RX by switch source port (port n to ring n)");
+
 MODULE_LICENSE("GPL");
@@ -45,6 +45,10 @@ static u32 oak_net_process_channel(ldg_t *ldg, u32 ring, u32 reason,
 static int oak_net_poll(struct napi_struct *napi, int budget);
 static int oak_net_poll_core(oak_t *np, ldg_t *ldg, int budget);
 static netdev_tx_t oak_net_stop_tx_queue(oak_t *np, u32 nfrags, u16 txq);
+static struct page *oak_net_map_page(oak_t *np, struct page *page,
+				     dma_addr_t *dma,
+				     enum dma_data_direction dir);
+static u32 oak_net_alloc_page_bulk(struct page **pages, u32 num);
 
 /* Name      : esu_ena_mrvl_hdr
  * Returns   : void
@@ -293,6 +297,9 @@ int oak_net_rbr_refill(oak_t *np, u32 ring)
 	int num;
 	u32 sum = 0;
 	struct page *page;
+	struct page *pages[OAK_RX_REFILL_BULK];
+	u32 nr_pages = 0;
+	u32 pg_idx = 0;
 	dma_addr_t dma;
 	dma_addr_t offs;
 	oak_rx_chan_t *rxc = &np->rx_channel[ring];
@@ -320,8 +327,23 @@ int oak_net_rbr_refill(oak_t *np, u32 ring)
 		 * upper layer in linux kernel.
 		 */
 		while ((count > 0) && (rc == 0)) {
-			/* Allocate a page */
-			page = oak_net_alloc_page(np, &dma, DMA_FROM_DEVICE);
+			/* Take the pages from the allocator in batches rather
+			 * than one call per page, a full ring refill then
+			 * costs a handful of trips into the page allocator.
+			 */
+			if (pg_idx == nr_pages) {
+				nr_pages = DIV_ROUND_UP(count, rxc->rbr_bpage);
+				nr_pages = min_t(u32, nr_pages,
+						 OAK_RX_REFILL_BULK);
+				nr_pages = oak_net_alloc_page_bulk(pages,
+								   nr_pages);
+				pg_idx = 0;
+			}
+			if (pg_idx < nr_pages)
+				page = oak_net_map_page(np, pages[pg_idx++],
+							&dma, DMA_FROM_DEVICE);
+			else
+				page = NULL;
 			if (page) {
 				offs = dma;
 				loop_cnt = 0;
@@ -368,6 +390,9 @@ int oak_net_rbr_refill(oak_t *np, u32 ring)
 				++rxc->stat.rx_alloc_error;
 			}
 		}
+		/* Give back what the last batch had left over */
+		while (pg_idx < nr_pages)
+			__free_page(pages[pg_idx++]);
 		/* Add integer to atomic variable */
 		atomic_add(num, &rxc->rbr_pend);
 		oakdbg(debug, PKTDATA,
@@ -381,6 +406,45 @@ int oak_net_rbr_refill(oak_t *np, u32 ring)
 	return rc;
 }
 
+/* Name        : oak_net_set_xps
+ * Returns     : void
+ * Parameters  : oak_t *np
+ * Description : This function points XPS for every tx ring at the CPU its
+ * interrupt vector is affine to, so a CPU transmits on the ring it also
+ * completes and receives on.
+ */
+static void oak_net_set_xps(oak_t *np)
+{
+	u32 i = 0;
+	int err;
+
+	while (i < np->num_tx_chan && np->gicu.num_ldg > 0) {
+		ldg_t *ldg = &np->gicu.ldg[i % np->gicu.num_ldg];
+
+		err = netif_set_xps_queue(np->netdev, cpumask_of(ldg->cpu),
+					  (u16)i);
+		oakdbg(debug, IFUP, "txq=%d cpu=%d err=%d", i, ldg->cpu, err);
+		++i;
+	}
+}
+
+/* Name        : oak_net_set_rx_steer
+ * Returns     : void
+ * Parameters  : oak_t *np
+ * Description : This function steers the frames of switch source port n to
+ * rx ring n. The source port is taken from the Marvell header of the
+ * frame, ring 0 keeps the frames of the other ports.
+ */
+static void oak_net_set_rx_steer(oak_t *np)
+{
+	u32 i = 1;
+
+	while (i < np->num_rx_chan) {
+		oak_unimac_set_rx_8021Q_spid(np, i, i, 1);
+		++i;
+	}
+}
+
 /*
  * Name        : oak_net_enable_irq
  * Returns     : int
@@ -418,6 +482,7 @@ static int oak_net_enable_irq(struct net_device *net_dev)
 				np->level = SETUP_DONE;
 				/* Set the port speed */
 				oak_net_esu_ena_speed(port_speed, np);
+				oak_net_set_xps(np);
 				/* Set carrier, Device has detected that
 				 * carrier.
 				 */
@@ -663,6 +728,55 @@ int oak_net_set_mac_addr(struct net_device *dev, void *p_addr)
 	return rc;
 }
 
+/* Name        : oak_net_map_page
+ * Returns     : struct page *
+ * Parameters  : oak_t *np, struct page *page, dma_addr_t *dma,
+ * enum dma_data_direction dir
+ * Description : This function maps a page for DMA, the page is freed if the
+ * mapping fails
+ */
+static struct page *oak_net_map_page(oak_t *np, struct page *page,
+				     dma_addr_t *dma,
+				     enum dma_data_direction dir)
+{
+	/* 0: 4K */
+	np->page_order = 0;
+	np->page_size = (PAGE_SIZE << np->page_order);
+
+	*dma = dma_map_page(np->device, page, 0, np->page_size, dir);
+	if (dma_mapping_error(np->device, *dma) != 0) {
+		__free_page(page);
+		*dma = 0;
+		page = NULL;
+	}
+
+	return page;
+}
+
+/* Name        : oak_net_alloc_page_bulk
+ * Returns     : u32
+ * Parameters  : struct page **pages, u32 num
+ * Description : This function allocates up to num pages in one go and
+ * returns how many it got, the pages are packed at the start of the array
+ */
+static u32 oak_net_alloc_page_bulk(struct page **pages, u32 num)
+{
+	u32 got = 0;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+	memset(pages, 0, num * sizeof(*pages));
+	got = alloc_pages_bulk_array(GFP_ATOMIC, num, pages);
+#else
+	while (got < num) {
+		pages[got] = alloc_page(GFP_ATOMIC);
+		if (!pages[got])
+			break;
+		++got;
+	}
+#endif
+	return got;
+}
+
 /* Name        : oak_net_alloc_page
  * Returns     : struct page *
  * Parameters  : oak_t *np, dma_addr_t *dma, enum dma_data_direction dir
@@ -673,24 +787,13 @@ struct page *oak_net_alloc_page(oak_t *np, dma_addr_t *dma,
 {
 	struct page *page;
 
-	/* 0: 4K */
-	np->page_order = 0;
-	np->page_size = (PAGE_SIZE << np->page_order);
-
 	/* Allocate a single page and return a pointer to its page structure */
 	page = alloc_page(GFP_ATOMIC /* | __GFP_COLD */ | __GFP_COMP);
 
-	if (!page) {
+	if (!page)
 		*dma = 0;
-	} else {
-		*dma = dma_map_page(np->device, page, 0, np->page_size,
-				    dir);
-		if (dma_mapping_error(np->device, *dma) != 0) {
-			__free_page(page);
-			*dma = 0;
-			page = NULL;
-		}
-	}
+	else
+		page = oak_net_map_page(np, page, dma, dir);
 
 	return page;
 }
@@ -719,8 +822,11 @@ u16 oak_net_select_queue(struct net_device *dev, struct sk_buff *skb,
 	 */
 	rec = skb_rx_queue_recorded(skb);
 
+	/* Locally generated traffic goes through XPS, which maps the CPU to
+	 * the ring pair whose vector is affine to it, or else the flow hash.
+	 */
 	if (!rec)
-		txq = smp_processor_id();
+		txq = netdev_pick_tx(dev, skb, sb_dev);
 	else
 		txq = skb_get_rx_queue(skb);
 
@@ -847,6 +953,9 @@ int oak_net_start_all(oak_t *np)
 		++i;
 	}
 
+	if (rc == 0 && rxsteer != 0)
+		oak_net_set_rx_steer(np);
+
 	/* Start all the transmit and receive queue */
 	if (rc == 0)
 		rc = oak_unimac_start_all_txq(np, 1);
@@ -1290,7 +1399,7 @@ static void oak_net_rx_update_counters(oak_t *np, struct sk_buff *skb,
 	/* Calling skb_record_rx_queue() to set the rx queue to the queue_index
 	 * fixes the association between descriptor and rx queue.
 	 */
-	skb_record_rx_queue(skb, ldg->msi_grp);
+	skb_record_rx_queue(skb, (u16)(rxc - np->rx_channel));
 	/* GRO (Generic receive offload) of the Linux kernel network protocol
 	 * stack If the driver supported by GRO is processed in this way, read
 	 * the data packet in the callback method of NAPI, and then call the
@@ -40,6 +40,7 @@ extern int rto;
 extern int mhdr;
 extern u32 port_speed;
 extern int napi_wt;
+extern int rxsteer;
 
 /* Name      : esu_set_mtu
  * Returns   : int
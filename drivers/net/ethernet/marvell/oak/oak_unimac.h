@@ -354,6 +354,7 @@ typedef struct oak_rxa_tstruct {
 typedef struct oak_rx_chan_tstruct {
 #define OAK_RX_BUFFER_SIZE 2048
 #define OAK_RX_BUFFER_PER_PAGE (PAGE_SIZE / OAK_RX_BUFFER_SIZE)
+#define OAK_RX_REFILL_BULK 16
 #define OAK_RX_SKB_ALLOC_SIZE (128 + NET_IP_ALIGN)
 #define OAK_RX_LGEN_RX_MODE BIT(0)
 #define OAK_RX_REFILL_REQ BIT(1)
@@ -794,6 +794,21 @@ static const u32 lan743x_set2_hw_cnt_addr[] = {
 	STAT_TX_COUNTER_ROLLOVER_STATUS
 };
 
+static const char lan743x_xdp_cnt_strings[][ETH_GSTRING_LEN] = {
+	"RX XDP Pass",
+	"RX XDP Drop",
+	"RX XDP TX",
+	"RX XDP Redirect",
+	"RX XDP Aborted",
+};
+
+static const char lan743x_ptp_cnt_strings[][ETH_GSTRING_LEN] = {
+	"PTP TX Timestamps",
+	"PTP TX TS Latency P50 us",
+	"PTP TX TS Latency P99 us",
+	"PTP TX TS Latency Max us",
+};
+
 static const char lan743x_priv_flags_strings[][ETH_GSTRING_LEN] = {
 	"OTP_ACCESS",
 };
@@ -820,7 +835,19 @@ static void lan743x_ethtool_get_strings(struct net_device *netdev,
 			       sizeof(lan743x_set2_hw_cnt_strings)],
 			       lan743x_tx_queue_cnt_strings,
 			       sizeof(lan743x_tx_queue_cnt_strings));
+			data += sizeof(lan743x_tx_queue_cnt_strings);
 		}
+		memcpy(&data[sizeof(lan743x_set0_hw_cnt_strings) +
+		       sizeof(lan743x_set1_sw_cnt_strings) +
+		       sizeof(lan743x_set2_hw_cnt_strings)],
+		       lan743x_xdp_cnt_strings,
+		       sizeof(lan743x_xdp_cnt_strings));
+		data += sizeof(lan743x_xdp_cnt_strings);
+		memcpy(&data[sizeof(lan743x_set0_hw_cnt_strings) +
+		       sizeof(lan743x_set1_sw_cnt_strings) +
+		       sizeof(lan743x_set2_hw_cnt_strings)],
+		       lan743x_ptp_cnt_strings,
+		       sizeof(lan743x_ptp_cnt_strings));
 		break;
 	case ETH_SS_PRIV_FLAGS:
 		memcpy(data, lan743x_priv_flags_strings,
@@ -858,6 +885,19 @@ static void lan743x_ethtool_get_ethtool_stats(struct net_device *netdev,
 		}
 		data[data_index++] = total_queue_count;
 	}
+	memset(&data[data_index], 0, sizeof(u64) *
+	       ARRAY_SIZE(lan743x_xdp_cnt_strings));
+	for (i = 0; i < ARRAY_SIZE(adapter->rx); i++) {
+		data[data_index + 0] += adapter->rx[i].xdp_pass;
+		data[data_index + 1] += adapter->rx[i].xdp_drop;
+		data[data_index + 2] += adapter->rx[i].xdp_tx;
+		data[data_index + 3] += adapter->rx[i].xdp_redirect;
+		data[data_index + 4] += adapter->rx[i].xdp_aborted;
+	}
+	data_index += ARRAY_SIZE(lan743x_xdp_cnt_strings);
+	lan743x_ptp_tx_ts_latency(adapter, &data[data_index],
+				  &data[data_index + 1], &data[data_index + 2],
+				  &data[data_index + 3]);
 }
 
 static u32 lan743x_ethtool_get_priv_flags(struct net_device *netdev)
@@ -890,6 +930,8 @@ static int lan743x_ethtool_get_sset_count(struct net_device *netdev, int sset)
 		ret += ARRAY_SIZE(lan743x_set2_hw_cnt_strings);
 		if (adapter->is_pci11x1x)
 			ret += ARRAY_SIZE(lan743x_tx_queue_cnt_strings);
+		ret += ARRAY_SIZE(lan743x_xdp_cnt_strings);
+		ret += ARRAY_SIZE(lan743x_ptp_cnt_strings);
 		return ret;
 	}
 	case ETH_SS_PRIV_FLAGS:
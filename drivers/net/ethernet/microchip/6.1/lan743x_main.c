@@ -18,6 +18,11 @@
 #include <linux/rtnetlink.h>
 #include <linux/iopoll.h>
 #include <linux/crc16.h>
+#include <linux/if_vlan.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
+#include <net/page_pool.h>
 #include "lan743x_main.h"
 #include "lan743x_ethtool.h"
 
@@ -1816,6 +1821,11 @@ clean_up_data_descriptor:
 		buffer_info->dma_ptr = 0;
 		buffer_info->buffer_length = 0;
 	}
+	if (buffer_info->flags & TX_BUFFER_INFO_FLAG_XDP) {
+		xdp_return_frame(buffer_info->xdpf);
+		buffer_info->xdpf = NULL;
+		goto clear_active;
+	}
 	if (!buffer_info->skb)
 		goto clear_active;
 
@@ -2237,6 +2247,8 @@ static int lan743x_tx_napi_poll(struct napi_struct *napi, int weight)
 	}
 	spin_unlock_irqrestore(&tx->ring_lock, irq_flags);
 
+	lan743x_ptp_tx_ts_poll(adapter);
+
 	if (!napi_complete(napi))
 		goto done;
 
@@ -2479,78 +2491,42 @@ static void lan743x_rx_update_tail(struct lan743x_rx *rx, int index)
 				  index);
 }
 
-static int lan743x_rx_init_ring_element(struct lan743x_rx *rx, int index,
-					gfp_t gfp)
+static void lan743x_rx_reuse_ring_element(struct lan743x_rx *rx, int index)
 {
-	struct net_device *netdev = rx->adapter->netdev;
-	struct device *dev = &rx->adapter->pdev->dev;
 	struct lan743x_rx_buffer_info *buffer_info;
-	unsigned int buffer_length, used_length;
 	struct lan743x_rx_descriptor *descriptor;
-	struct sk_buff *skb;
-	dma_addr_t dma_ptr;
-
-	buffer_length = netdev->mtu + ETH_HLEN + ETH_FCS_LEN + RX_HEAD_PADDING;
 
 	descriptor = &rx->ring_cpu_ptr[index];
 	buffer_info = &rx->buffer_info[index];
-	skb = __netdev_alloc_skb(netdev, buffer_length, gfp);
-	if (!skb)
-		return -ENOMEM;
-	dma_ptr = dma_map_single(dev, skb->data, buffer_length, DMA_FROM_DEVICE);
-	if (dma_mapping_error(dev, dma_ptr)) {
-		dev_kfree_skb_any(skb);
-		return -ENOMEM;
-	}
-	if (buffer_info->dma_ptr) {
-		/* sync used area of buffer only */
-		if (le32_to_cpu(descriptor->data0) & RX_DESC_DATA0_LS_)
-			/* frame length is valid only if LS bit is set.
-			 * it's a safe upper bound for the used area in this
-			 * buffer.
-			 */
-			used_length = min(RX_DESC_DATA0_FRAME_LENGTH_GET_
-					  (le32_to_cpu(descriptor->data0)),
-					  buffer_info->buffer_length);
-		else
-			used_length = buffer_info->buffer_length;
-		dma_sync_single_for_cpu(dev, buffer_info->dma_ptr,
-					used_length,
-					DMA_FROM_DEVICE);
-		dma_unmap_single_attrs(dev, buffer_info->dma_ptr,
-				       buffer_info->buffer_length,
-				       DMA_FROM_DEVICE,
-				       DMA_ATTR_SKIP_CPU_SYNC);
-	}
 
-	buffer_info->skb = skb;
-	buffer_info->dma_ptr = dma_ptr;
-	buffer_info->buffer_length = buffer_length;
 	descriptor->data1 = cpu_to_le32(DMA_ADDR_LOW32(buffer_info->dma_ptr));
 	descriptor->data2 = cpu_to_le32(DMA_ADDR_HIGH32(buffer_info->dma_ptr));
 	descriptor->data3 = 0;
 	descriptor->data0 = cpu_to_le32((RX_DESC_DATA0_OWN_ |
-			    (buffer_length & RX_DESC_DATA0_BUF_LENGTH_MASK_)));
+			    ((buffer_info->buffer_length) &
+			    RX_DESC_DATA0_BUF_LENGTH_MASK_)));
 	lan743x_rx_update_tail(rx, index);
-
-	return 0;
 }
 
-static void lan743x_rx_reuse_ring_element(struct lan743x_rx *rx, int index)
+static int lan743x_rx_init_ring_element(struct lan743x_rx *rx, int index,
+					gfp_t gfp)
 {
 	struct lan743x_rx_buffer_info *buffer_info;
-	struct lan743x_rx_descriptor *descriptor;
+	struct page *page;
 
-	descriptor = &rx->ring_cpu_ptr[index];
 	buffer_info = &rx->buffer_info[index];
+	page = page_pool_alloc_pages(rx->page_pool, gfp | __GFP_NOWARN);
+	if (!page)
+		return -ENOMEM;
 
-	descriptor->data1 = cpu_to_le32(DMA_ADDR_LOW32(buffer_info->dma_ptr));
-	descriptor->data2 = cpu_to_le32(DMA_ADDR_HIGH32(buffer_info->dma_ptr));
-	descriptor->data3 = 0;
-	descriptor->data0 = cpu_to_le32((RX_DESC_DATA0_OWN_ |
-			    ((buffer_info->buffer_length) &
-			    RX_DESC_DATA0_BUF_LENGTH_MASK_)));
-	lan743x_rx_update_tail(rx, index);
+	/* the pool maps the page and syncs it for the device */
+	buffer_info->page = page;
+	buffer_info->dma_ptr = page_pool_get_dma_addr(page) +
+			       LAN743X_RX_HEADROOM;
+	buffer_info->buffer_length = LAN743X_RX_BUF_SIZE;
+	lan743x_rx_reuse_ring_element(rx, index);
+
+	return 0;
 }
 
 static void lan743x_rx_release_ring_element(struct lan743x_rx *rx, int index)
@@ -2563,35 +2539,145 @@ static void lan743x_rx_release_ring_element(struct lan743x_rx *rx, int index)
 
 	memset(descriptor, 0, sizeof(*descriptor));
 
-	if (buffer_info->dma_ptr) {
-		dma_unmap_single(&rx->adapter->pdev->dev,
-				 buffer_info->dma_ptr,
-				 buffer_info->buffer_length,
-				 DMA_FROM_DEVICE);
-		buffer_info->dma_ptr = 0;
+	if (buffer_info->page)
+		page_pool_put_full_page(rx->page_pool, buffer_info->page,
+					false);
+
+	memset(buffer_info, 0, sizeof(*buffer_info));
+}
+
+/* drop the frame being assembled, later buffers of it are dropped too */
+static void lan743x_rx_drop_frame(struct lan743x_rx *rx)
+{
+	if (rx->head_page) {
+		page_pool_recycle_direct(rx->page_pool, rx->head_page);
+		rx->head_page = NULL;
+	}
+	if (rx->skb_head) {
+		napi_consume_skb(rx->skb_head, 1);
+		rx->skb_head = NULL;
 	}
+}
 
-	if (buffer_info->skb) {
-		dev_kfree_skb(buffer_info->skb);
-		buffer_info->skb = NULL;
+static struct sk_buff *lan743x_rx_build_skb(struct lan743x_rx *rx,
+					    struct page *page,
+					    unsigned int headroom,
+					    unsigned int length)
+{
+	struct sk_buff *skb;
+
+	skb = napi_build_skb(page_address(page), PAGE_SIZE);
+	if (!skb) {
+		page_pool_recycle_direct(rx->page_pool, page);
+		return NULL;
 	}
+	skb_mark_for_recycle(skb);
+	skb_reserve(skb, headroom);
+	skb_put(skb, length);
 
-	memset(buffer_info, 0, sizeof(*buffer_info));
+	return skb;
 }
 
-static struct sk_buff *
-lan743x_rx_trim_skb(struct sk_buff *skb, int frame_length)
+static struct sk_buff *lan743x_rx_build_skb_xdp(struct lan743x_rx *rx,
+						struct page *page,
+						struct xdp_buff *xdp)
 {
-	if (skb_linearize(skb)) {
-		dev_kfree_skb_irq(skb);
+	unsigned int metasize = xdp->data - xdp->data_meta;
+	struct sk_buff *skb;
+
+	skb = lan743x_rx_build_skb(rx, page, xdp->data - xdp->data_hard_start,
+				   xdp->data_end - xdp->data);
+	if (skb && metasize)
+		skb_metadata_set(skb, metasize);
+
+	return skb;
+}
+
+static int lan743x_xdp_xmit_frame(struct lan743x_tx *tx,
+				  struct xdp_frame *xdpf)
+{
+	/* assuming tx->ring_lock has already been acquired */
+	struct lan743x_tx_buffer_info *buffer_info;
+
+	if (lan743x_tx_get_avail_desc(tx) < 1)
+		return -ENOSPC;
+
+	if (lan743x_tx_frame_start(tx, xdpf->data, xdpf->len, xdpf->len,
+				   false, false))
+		return -ENOMEM;
+	tx->frame_count++;
+
+	buffer_info = &tx->buffer_info[tx->frame_first];
+	buffer_info->xdpf = xdpf;
+	buffer_info->flags |= TX_BUFFER_INFO_FLAG_XDP;
+	lan743x_tx_frame_end(tx, NULL, false, false);
+
+	return 0;
+}
+
+static struct lan743x_tx *lan743x_xdp_get_tx(struct lan743x_adapter *adapter)
+{
+	return &adapter->tx[smp_processor_id() % adapter->used_tx_channels];
+}
+
+/* Returns the skb for XDP_PASS, NULL when the program consumed the frame */
+static struct sk_buff *lan743x_rx_run_xdp(struct lan743x_rx *rx,
+					  struct bpf_prog *prog,
+					  struct page *page,
+					  unsigned int length)
+{
+	struct net_device *netdev = rx->adapter->netdev;
+	struct xdp_frame *xdpf;
+	struct lan743x_tx *tx;
+	unsigned long irq_flags;
+	struct xdp_buff xdp;
+	u32 act;
+	int ret;
+
+	xdp_init_buff(&xdp, PAGE_SIZE, &rx->xdp_rxq);
+	xdp_prepare_buff(&xdp, page_address(page),
+			 LAN743X_RX_HEADROOM + RX_HEAD_PADDING, length, true);
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		rx->xdp_pass++;
+		return lan743x_rx_build_skb_xdp(rx, page, &xdp);
+	case XDP_TX:
+		xdpf = xdp_convert_buff_to_frame(&xdp);
+		if (unlikely(!xdpf))
+			goto xdp_abort;
+		tx = lan743x_xdp_get_tx(rx->adapter);
+		spin_lock_irqsave(&tx->ring_lock, irq_flags);
+		ret = lan743x_xdp_xmit_frame(tx, xdpf);
+		spin_unlock_irqrestore(&tx->ring_lock, irq_flags);
+		if (ret) {
+			xdp_return_frame_rx_napi(xdpf);
+			rx->xdp_drop++;
+			return NULL;
+		}
+		rx->xdp_tx++;
+		return NULL;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(netdev, &xdp, prog))
+			goto xdp_abort;
+		rx->xdp_redirected = true;
+		rx->xdp_redirect++;
+		return NULL;
+	default:
+		bpf_warn_invalid_xdp_action(netdev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+xdp_abort:
+		trace_xdp_exception(netdev, prog, act);
+		rx->xdp_aborted++;
+		fallthrough;
+	case XDP_DROP:
+		page_pool_recycle_direct(rx->page_pool, page);
+		if (act == XDP_DROP)
+			rx->xdp_drop++;
 		return NULL;
 	}
-	frame_length = max_t(int, 0, frame_length - ETH_FCS_LEN);
-	if (skb->len > frame_length) {
-		skb->tail -= skb->len - frame_length;
-		skb->len = frame_length;
-	}
-	return skb;
 }
 
 static int lan743x_rx_process_buffer(struct lan743x_rx *rx)
@@ -2600,12 +2686,17 @@ static int lan743x_rx_process_buffer(struct lan743x_rx *rx)
 	struct lan743x_rx_descriptor *descriptor, *desc_ext;
 	struct net_device *netdev = rx->adapter->netdev;
 	int result = RX_PROCESS_RESULT_NOTHING_TO_DO;
+	struct device *dev = &rx->adapter->pdev->dev;
 	struct lan743x_rx_buffer_info *buffer_info;
 	int frame_length, buffer_length;
 	bool is_ice, is_tce, is_icsm;
 	int extension_index = -1;
 	bool is_last, is_first;
+	struct bpf_prog *prog;
+	ktime_t hwtstamp = 0;
 	struct sk_buff *skb;
+	unsigned int sync_length;
+	struct page *page;
 
 	if (current_head_index < 0 || current_head_index >= rx->ring_size)
 		goto done;
@@ -2658,44 +2749,64 @@ static int lan743x_rx_process_buffer(struct lan743x_rx *rx)
 		   is_last  ? "last  " : "      ",
 		   frame_length, buffer_length);
 
-	/* save existing skb, allocate new skb and map to dma */
-	skb = buffer_info->skb;
-	if (lan743x_rx_init_ring_element(rx, rx->last_head,
-					 GFP_ATOMIC | GFP_DMA)) {
-		/* failed to allocate next skb.
+	/* frame length is valid only if LS bit is set, it's a safe upper
+	 * bound for the used area in this buffer
+	 */
+	sync_length = buffer_length;
+	if (is_last)
+		sync_length = min_t(unsigned int, sync_length,
+				    frame_length + RX_HEAD_PADDING);
+	dma_sync_single_for_cpu(dev, buffer_info->dma_ptr, sync_length,
+				DMA_FROM_DEVICE);
+
+	/* save existing page, allocate a new one from the pool */
+	page = buffer_info->page;
+	if (lan743x_rx_init_ring_element(rx, rx->last_head, GFP_ATOMIC)) {
+		/* failed to allocate next page.
 		 * Memory is very low.
 		 * Drop this packet and reuse buffer.
 		 */
 		lan743x_rx_reuse_ring_element(rx, rx->last_head);
 		/* drop packet that was being assembled */
-		dev_kfree_skb_irq(rx->skb_head);
-		rx->skb_head = NULL;
+		lan743x_rx_drop_frame(rx);
 		goto process_extension;
 	}
 
-	/* add buffers to skb via skb->frag_list */
+	prog = READ_ONCE(rx->adapter->xdp_prog);
+
+	/* the skb is built once the frame spans a second buffer or is
+	 * complete, so single buffer frames can go through XDP first
+	 */
 	if (is_first) {
-		skb_reserve(skb, RX_HEAD_PADDING);
-		skb_put(skb, buffer_length - RX_HEAD_PADDING);
-		if (rx->skb_head)
-			dev_kfree_skb_irq(rx->skb_head);
-		rx->skb_head = skb;
-	} else if (rx->skb_head) {
-		skb_put(skb, buffer_length);
-		if (skb_shinfo(rx->skb_head)->frag_list)
-			rx->skb_tail->next = skb;
-		else
-			skb_shinfo(rx->skb_head)->frag_list = skb;
-		rx->skb_tail = skb;
-		rx->skb_head->len += skb->len;
-		rx->skb_head->data_len += skb->len;
-		rx->skb_head->truesize += skb->truesize;
+		lan743x_rx_drop_frame(rx);
+		rx->head_page = page;
+	} else if (rx->skb_head || (rx->head_page && !prog)) {
+		if (!rx->skb_head) {
+			rx->skb_head = lan743x_rx_build_skb(rx, rx->head_page,
+							    LAN743X_RX_HEADROOM +
+							    RX_HEAD_PADDING,
+							    buffer_length -
+							    RX_HEAD_PADDING);
+			rx->head_page = NULL;
+		}
+		if (rx->skb_head &&
+		    skb_shinfo(rx->skb_head)->nr_frags < MAX_SKB_FRAGS) {
+			skb_add_rx_frag(rx->skb_head,
+					skb_shinfo(rx->skb_head)->nr_frags,
+					page, LAN743X_RX_HEADROOM,
+					buffer_length, PAGE_SIZE);
+		} else {
+			page_pool_recycle_direct(rx->page_pool, page);
+			lan743x_rx_drop_frame(rx);
+		}
 	} else {
 		/* packet to assemble has already been dropped because one or
-		 * more of its buffers could not be allocated
+		 * more of its buffers could not be allocated, or this is a
+		 * surplus buffer of a frame held for XDP, which always fits
+		 * the first buffer
 		 */
 		netdev_dbg(netdev, "drop buffer intended for dropped packet");
-		dev_kfree_skb_irq(skb);
+		page_pool_recycle_direct(rx->page_pool, page);
 	}
 
 process_extension:
@@ -2706,28 +2817,49 @@ process_extension:
 		ts_sec = le32_to_cpu(desc_ext->data1);
 		ts_nsec = (le32_to_cpu(desc_ext->data2) &
 			  RX_DESC_DATA2_TS_NS_MASK_);
-		if (rx->skb_head)
-			skb_hwtstamps(rx->skb_head)->hwtstamp =
-				ktime_set(ts_sec, ts_nsec);
+		hwtstamp = ktime_set(ts_sec, ts_nsec);
 		lan743x_rx_reuse_ring_element(rx, extension_index);
 		rx->last_head = extension_index;
 		netdev_dbg(netdev, "process extension");
 	}
 
-	if (is_last && rx->skb_head)
-		rx->skb_head = lan743x_rx_trim_skb(rx->skb_head, frame_length);
+	if (!is_last)
+		goto move_forward;
 
-	if (is_last && rx->skb_head) {
-		rx->skb_head->protocol = eth_type_trans(rx->skb_head,
-							rx->adapter->netdev);
-		if (rx->adapter->netdev->features & NETIF_F_RXCSUM) {
+	frame_length = max_t(int, 0, frame_length - ETH_FCS_LEN);
+	skb = NULL;
+	if (rx->head_page) {
+		page = rx->head_page;
+		rx->head_page = NULL;
+		if (frame_length > buffer_length - RX_HEAD_PADDING) {
+			page_pool_recycle_direct(rx->page_pool, page);
+		} else if (prog) {
+			skb = lan743x_rx_run_xdp(rx, prog, page, frame_length);
+		} else {
+			skb = lan743x_rx_build_skb(rx, page,
+						   LAN743X_RX_HEADROOM +
+						   RX_HEAD_PADDING,
+						   frame_length);
+		}
+	} else if (rx->skb_head) {
+		skb = rx->skb_head;
+		rx->skb_head = NULL;
+		if (skb->len > frame_length && pskb_trim(skb, frame_length)) {
+			napi_consume_skb(skb, 1);
+			skb = NULL;
+		}
+	}
+
+	if (skb) {
+		if (extension_index >= 0)
+			skb_hwtstamps(skb)->hwtstamp = hwtstamp;
+		skb->protocol = eth_type_trans(skb, netdev);
+		if (netdev->features & NETIF_F_RXCSUM) {
 			if (!is_ice && !is_tce && !is_icsm)
 				skb->ip_summed = CHECKSUM_UNNECESSARY;
 		}
-		netdev_dbg(netdev, "sending %d byte frame to OS",
-			   rx->skb_head->len);
-		napi_gro_receive(&rx->napi, rx->skb_head);
-		rx->skb_head = NULL;
+		netdev_dbg(netdev, "sending %d byte frame to OS", skb->len);
+		napi_gro_receive(&rx->napi, skb);
 	}
 
 move_forward:
@@ -2758,6 +2890,12 @@ static int lan743x_rx_napi_poll(struct napi_struct *napi, int weight)
 			break;
 	}
 	rx->frame_count += count;
+
+	if (rx->xdp_redirected) {
+		rx->xdp_redirected = false;
+		xdp_do_flush();
+	}
+
 	if (count == weight || result == RX_PROCESS_RESULT_BUFFER_RECEIVED)
 		return weight;
 
@@ -2790,6 +2928,14 @@ static void lan743x_rx_ring_cleanup(struct lan743x_rx *rx)
 			lan743x_rx_release_ring_element(rx, index);
 	}
 
+	if (rx->page_pool) {
+		lan743x_rx_drop_frame(rx);
+		if (xdp_rxq_info_is_reg(&rx->xdp_rxq))
+			xdp_rxq_info_unreg(&rx->xdp_rxq);
+		page_pool_destroy(rx->page_pool);
+		rx->page_pool = NULL;
+	}
+
 	if (rx->head_cpu_ptr) {
 		dma_free_coherent(&rx->adapter->pdev->dev,
 				  sizeof(*rx->head_cpu_ptr), rx->head_cpu_ptr,
@@ -2814,6 +2960,35 @@ static void lan743x_rx_ring_cleanup(struct lan743x_rx *rx)
 	rx->last_head = 0;
 }
 
+static int lan743x_rx_page_pool_init(struct lan743x_rx *rx)
+{
+	struct page_pool_params pp_params = {
+		.order = 0,
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = rx->ring_size,
+		.nid = dev_to_node(&rx->adapter->pdev->dev),
+		.dev = &rx->adapter->pdev->dev,
+		.dma_dir = DMA_FROM_DEVICE,
+		.offset = LAN743X_RX_HEADROOM,
+		.max_len = LAN743X_RX_BUF_SIZE,
+	};
+	struct page_pool *pool;
+	int ret;
+
+	pool = page_pool_create(&pp_params);
+	if (IS_ERR(pool))
+		return PTR_ERR(pool);
+	rx->page_pool = pool;
+
+	ret = xdp_rxq_info_reg(&rx->xdp_rxq, rx->adapter->netdev,
+			       rx->channel_number, 0);
+	if (ret)
+		return ret;
+
+	return xdp_rxq_info_reg_mem_model(&rx->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					  rx->page_pool);
+}
+
 static int lan743x_rx_ring_init(struct lan743x_rx *rx)
 {
 	size_t ring_allocation_size = 0;
@@ -2875,6 +3050,10 @@ static int lan743x_rx_ring_init(struct lan743x_rx *rx)
 		goto cleanup;
 	}
 
+	ret = lan743x_rx_page_pool_init(rx);
+	if (ret)
+		goto cleanup;
+
 	rx->last_head = 0;
 	for (index = 0; index < rx->ring_size; index++) {
 		ret = lan743x_rx_init_ring_element(rx, index, GFP_KERNEL);
@@ -3276,6 +3455,12 @@ static int lan743x_netdev_change_mtu(struct net_device *netdev, int new_mtu)
 	struct lan743x_adapter *adapter = netdev_priv(netdev);
 	int ret = 0;
 
+	if (adapter->xdp_prog && new_mtu > LAN743X_XDP_MAX_MTU) {
+		netdev_warn(netdev, "MTU %d too large for XDP, max %lu\n",
+			    new_mtu, (unsigned long)LAN743X_XDP_MAX_MTU);
+		return -EINVAL;
+	}
+
 	ret = lan743x_mac_set_mtu(adapter, new_mtu);
 	if (!ret)
 		netdev->mtu = new_mtu;
@@ -3345,6 +3530,64 @@ static int lan743x_netdev_set_mac_address(struct net_device *netdev,
 	return 0;
 }
 
+static int lan743x_xdp_setup(struct net_device *netdev, struct bpf_prog *prog,
+			     struct netlink_ext_ack *extack)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+	struct bpf_prog *old_prog;
+
+	/* XDP sees single buffer frames only */
+	if (prog && netdev->mtu > LAN743X_XDP_MAX_MTU) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* RX buffers always keep XDP headroom, so no ring reload is needed */
+	old_prog = xchg(&adapter->xdp_prog, prog);
+	if (old_prog) {
+		synchronize_net();
+		bpf_prog_put(old_prog);
+	}
+
+	return 0;
+}
+
+static int lan743x_netdev_bpf(struct net_device *netdev,
+			      struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return lan743x_xdp_setup(netdev, bpf->prog, bpf->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int lan743x_netdev_xdp_xmit(struct net_device *netdev, int n,
+				   struct xdp_frame **frames, u32 flags)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+	unsigned long irq_flags = 0;
+	struct lan743x_tx *tx;
+	int nxmit;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(netdev) || !netif_carrier_ok(netdev)))
+		return -ENETDOWN;
+
+	tx = lan743x_xdp_get_tx(adapter);
+	spin_lock_irqsave(&tx->ring_lock, irq_flags);
+	for (nxmit = 0; nxmit < n; nxmit++) {
+		if (lan743x_xdp_xmit_frame(tx, frames[nxmit]))
+			break;
+	}
+	spin_unlock_irqrestore(&tx->ring_lock, irq_flags);
+
+	return nxmit;
+}
+
 static const struct net_device_ops lan743x_netdev_ops = {
 	.ndo_open		= lan743x_netdev_open,
 	.ndo_stop		= lan743x_netdev_close,
@@ -3354,6 +3597,8 @@ static const struct net_device_ops lan743x_netdev_ops = {
 	.ndo_change_mtu		= lan743x_netdev_change_mtu,
 	.ndo_get_stats64	= lan743x_netdev_get_stats64,
 	.ndo_set_mac_address	= lan743x_netdev_set_mac_address,
+	.ndo_bpf		= lan743x_netdev_bpf,
+	.ndo_xdp_xmit		= lan743x_netdev_xdp_xmit,
 };
 
 static void lan743x_hardware_cleanup(struct lan743x_adapter *adapter)
@@ -8,6 +8,7 @@
 #define _LAN743X_H
 
 #include <linux/phy.h>
+#include <net/xdp.h>
 #include "lan743x_ptp.h"
 
 #define DRIVER_AUTHOR   "Bryan Whitehead <Bryan.Whitehead@microchip.com>"
@@ -993,7 +994,18 @@ struct lan743x_rx {
 
 	u32		frame_count;
 
-	struct sk_buff *skb_head, *skb_tail;
+	struct page_pool *page_pool;
+	struct xdp_rxq_info xdp_rxq;
+	/* first buffer of a frame that has no skb yet */
+	struct page	*head_page;
+	struct sk_buff *skb_head;
+	bool		xdp_redirected;
+
+	u64		xdp_pass;
+	u64		xdp_drop;
+	u64		xdp_tx;
+	u64		xdp_redirect;
+	u64		xdp_aborted;
 };
 
 /* SGMII Link Speed Duplex status */
@@ -1044,6 +1056,7 @@ struct lan743x_adapter {
 	u8			max_tx_channels;
 	u8			used_tx_channels;
 	u8			max_vector_count;
+	struct bpf_prog		*xdp_prog;
 
 #define LAN743X_ADAPTER_FLAG_OTP		BIT(0)
 	u32			flags;
@@ -1110,9 +1123,11 @@ struct lan743x_tx_descriptor {
 #define TX_BUFFER_INFO_FLAG_TIMESTAMP_REQUESTED	BIT(1)
 #define TX_BUFFER_INFO_FLAG_IGNORE_SYNC		BIT(2)
 #define TX_BUFFER_INFO_FLAG_SKB_FRAGMENT	BIT(3)
+#define TX_BUFFER_INFO_FLAG_XDP			BIT(4)
 struct lan743x_tx_buffer_info {
 	int flags;
 	struct sk_buff *skb;
+	struct xdp_frame *xdpf;
 	dma_addr_t      dma_ptr;
 	unsigned int    buffer_length;
 };
@@ -1150,7 +1165,7 @@ struct lan743x_rx_descriptor {
 #define RX_BUFFER_INFO_FLAG_ACTIVE      BIT(0)
 struct lan743x_rx_buffer_info {
 	int flags;
-	struct sk_buff *skb;
+	struct page *page;
 
 	dma_addr_t      dma_ptr;
 	unsigned int    buffer_length;
@@ -1158,6 +1173,19 @@ struct lan743x_rx_buffer_info {
 
 #define LAN743X_RX_RING_SIZE        (128)
 
+/* One page per RX buffer, with room for XDP in front and for the skb
+ * shared info behind so skbs can be built around the page.
+ */
+#define LAN743X_RX_HEADROOM	XDP_PACKET_HEADROOM
+#define LAN743X_RX_BUF_SIZE	\
+	min_t(unsigned int, RX_DESC_DATA0_BUF_LENGTH_MASK_ & ~0x3, \
+	      PAGE_SIZE - LAN743X_RX_HEADROOM - \
+	      SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+/* largest MTU whose frames always fit one RX buffer, required for XDP */
+#define LAN743X_XDP_MAX_MTU	\
+	(LAN743X_RX_BUF_SIZE - ETH_HLEN - VLAN_HLEN - ETH_FCS_LEN - \
+	 RX_HEAD_PADDING)
+
 #define RX_PROCESS_RESULT_NOTHING_TO_DO     (0)
 #define RX_PROCESS_RESULT_BUFFER_RECEIVED   (1)
 
@@ -60,6 +60,14 @@ static void lan743x_ptp_wait_till_cmd_done(struct lan743x_adapter *adapter,
 {
 	int timeout = 1000;
 	u32 data = 0;
+	int spin;
+
+	/* most commands complete within a few microseconds */
+	for (spin = 0; spin < 20; spin++) {
+		if (!(lan743x_csr_read(adapter, PTP_CMD_CTL) & bit_mask))
+			return;
+		udelay(1);
+	}
 
 	while (timeout &&
 	       (data = (lan743x_csr_read(adapter, PTP_CMD_CTL) &
@@ -100,6 +108,8 @@ static void lan743x_ptp_tx_ts_complete(struct lan743x_adapter *adapter)
 	u32 header, nseconds, seconds;
 	bool ignore_sync = false;
 	struct sk_buff *skb;
+	ktime_t now;
+	u64 lat_us;
 	int c, i;
 
 	spin_lock_bh(&ptp->tx_ts_lock);
@@ -110,6 +120,7 @@ static void lan743x_ptp_tx_ts_complete(struct lan743x_adapter *adapter)
 	if (c <= 0)
 		goto done;
 
+	now = ktime_get();
 	for (i = 0; i < c; i++) {
 		ignore_sync = ((ptp->tx_ts_ignore_sync_queue &
 				BIT(i)) != 0);
@@ -127,6 +138,12 @@ static void lan743x_ptp_tx_ts_complete(struct lan743x_adapter *adapter)
 
 		dev_kfree_skb(skb);
 
+		lat_us = ktime_us_delta(now, ptp->tx_ts_skb_time_queue[i]);
+		ptp->tx_ts_lat_hist[min_t(int, fls64(lat_us),
+					  LAN743X_PTP_TX_TS_LAT_BUCKETS - 1)]++;
+		if (lat_us > ptp->tx_ts_lat_max_us)
+			ptp->tx_ts_lat_max_us = lat_us;
+
 		ptp->tx_ts_skb_queue[i] = NULL;
 		ptp->tx_ts_seconds_queue[i] = 0;
 		ptp->tx_ts_nseconds_queue[i] = 0;
@@ -137,6 +154,8 @@ static void lan743x_ptp_tx_ts_complete(struct lan743x_adapter *adapter)
 	ptp->tx_ts_ignore_sync_queue >>= c;
 	for (i = c; i < LAN743X_PTP_NUMBER_OF_TX_TIMESTAMPS; i++) {
 		ptp->tx_ts_skb_queue[i - c] = ptp->tx_ts_skb_queue[i];
+		ptp->tx_ts_skb_time_queue[i - c] =
+			ptp->tx_ts_skb_time_queue[i];
 		ptp->tx_ts_seconds_queue[i - c] = ptp->tx_ts_seconds_queue[i];
 		ptp->tx_ts_nseconds_queue[i - c] = ptp->tx_ts_nseconds_queue[i];
 		ptp->tx_ts_header_queue[i - c] = ptp->tx_ts_header_queue[i];
@@ -153,6 +172,99 @@ done:
 	spin_unlock_bh(&ptp->tx_ts_lock);
 }
 
+/*
+ * Pop every timestamp in the TX timestamp FIFO. The status bit is cleared
+ * first, so a capture landing during the drain raises it again and is not
+ * lost. Returns the number of timestamps queued.
+ */
+static int lan743x_ptp_tx_ts_drain(struct lan743x_adapter *adapter)
+{
+	struct lan743x_ptp *ptp = &adapter->ptp;
+	u32 cause, header, nsec, seconds;
+	int count, queued = 0;
+
+	spin_lock_bh(&ptp->tx_ts_fifo_lock);
+	lan743x_csr_write(adapter, PTP_INT_STS, PTP_INT_BIT_TX_TS_);
+	count = PTP_CAP_INFO_TX_TS_CNT_GET_(lan743x_csr_read(adapter,
+							     PTP_CAP_INFO));
+	while (count-- > 0) {
+		seconds = lan743x_csr_read(adapter, PTP_TX_EGRESS_SEC);
+		nsec = lan743x_csr_read(adapter, PTP_TX_EGRESS_NS);
+		cause = (nsec & PTP_TX_EGRESS_NS_CAPTURE_CAUSE_MASK_);
+		header = lan743x_csr_read(adapter, PTP_TX_MSG_HEADER);
+
+		if (cause == PTP_TX_EGRESS_NS_CAPTURE_CAUSE_SW_) {
+			nsec &= PTP_TX_EGRESS_NS_TS_NS_MASK_;
+			lan743x_ptp_tx_ts_enqueue_ts(adapter, seconds, nsec,
+						     header);
+			queued++;
+		} else if (cause == PTP_TX_EGRESS_NS_CAPTURE_CAUSE_AUTO_) {
+			netif_err(adapter, drv, adapter->netdev,
+				  "Auto capture cause not supported\n");
+		} else {
+			netif_warn(adapter, drv, adapter->netdev,
+				   "unknown tx timestamp capture cause\n");
+		}
+	}
+	spin_unlock_bh(&ptp->tx_ts_fifo_lock);
+
+	return queued;
+}
+
+/*
+ * Called from the TX NAPI poll once the completed descriptors have been
+ * released. Timestamps of the frames just completed are usually in the
+ * FIFO by then, so they are delivered without waiting for the 1588
+ * interrupt and the PTP worker.
+ */
+void lan743x_ptp_tx_ts_poll(struct lan743x_adapter *adapter)
+{
+	struct lan743x_ptp *ptp = &adapter->ptp;
+
+	if (!READ_ONCE(ptp->tx_ts_skb_queue_size))
+		return;
+
+	if (!(lan743x_csr_read(adapter, PTP_INT_STS) & PTP_INT_BIT_TX_TS_))
+		return;
+
+	if (lan743x_ptp_tx_ts_drain(adapter))
+		lan743x_ptp_tx_ts_complete(adapter);
+}
+
+/* Percentiles are the upper bounds of the histogram buckets */
+void lan743x_ptp_tx_ts_latency(struct lan743x_adapter *adapter, u64 *count,
+			       u64 *p50_us, u64 *p99_us, u64 *max_us)
+{
+	struct lan743x_ptp *ptp = &adapter->ptp;
+	u64 hist[LAN743X_PTP_TX_TS_LAT_BUCKETS];
+	u64 total = 0, sum = 0;
+	int i;
+
+	spin_lock_bh(&ptp->tx_ts_lock);
+	memcpy(hist, ptp->tx_ts_lat_hist, sizeof(hist));
+	*max_us = ptp->tx_ts_lat_max_us;
+	spin_unlock_bh(&ptp->tx_ts_lock);
+
+	for (i = 0; i < LAN743X_PTP_TX_TS_LAT_BUCKETS; i++)
+		total += hist[i];
+
+	*count = total;
+	*p50_us = 0;
+	*p99_us = 0;
+	if (!total)
+		return;
+
+	for (i = 0; i < LAN743X_PTP_TX_TS_LAT_BUCKETS; i++) {
+		sum += hist[i];
+		if (!*p50_us && sum * 2 >= total)
+			*p50_us = 1ULL << i;
+		if (sum * 100 >= total * 99) {
+			*p99_us = 1ULL << i;
+			break;
+		}
+	}
+}
+
 static int lan743x_ptp_reserve_event_ch(struct lan743x_adapter *adapter,
 					int event_channel)
 {
@@ -332,6 +444,21 @@ static void lan743x_gpio_release(struct lan743x_adapter *adapter, int pin)
 	spin_unlock_irqrestore(&gpio->gpio_lock, irq_flags);
 }
 
+/* servos keep handing in the same rate, skip the write when it is */
+static void lan743x_ptp_set_rate_adj(struct lan743x_adapter *adapter,
+				     u32 rate_adj)
+{
+	struct lan743x_ptp *ptp = &adapter->ptp;
+
+	mutex_lock(&ptp->command_lock);
+	if (!ptp->rate_adj_valid || ptp->rate_adj != rate_adj) {
+		lan743x_csr_write(adapter, PTP_CLOCK_RATE_ADJ, rate_adj);
+		ptp->rate_adj = rate_adj;
+		ptp->rate_adj_valid = true;
+	}
+	mutex_unlock(&ptp->command_lock);
+}
+
 static int lan743x_ptpci_adjfine(struct ptp_clock_info *ptpci, long scaled_ppm)
 {
 	struct lan743x_ptp *ptp =
@@ -359,8 +486,7 @@ static int lan743x_ptpci_adjfine(struct ptp_clock_info *ptpci, long scaled_ppm)
 	if (positive)
 		lan743x_rate_adj |= PTP_CLOCK_RATE_ADJ_DIR_;
 
-	lan743x_csr_write(adapter, PTP_CLOCK_RATE_ADJ,
-			  lan743x_rate_adj);
+	lan743x_ptp_set_rate_adj(adapter, lan743x_rate_adj);
 
 	return 0;
 }
@@ -393,8 +519,7 @@ static int lan743x_ptpci_adjfreq(struct ptp_clock_info *ptpci, s32 delta_ppb)
 	if (positive)
 		lan743x_rate_adj |= PTP_CLOCK_RATE_ADJ_DIR_;
 
-	lan743x_csr_write(adapter, PTP_CLOCK_RATE_ADJ,
-			  lan743x_rate_adj);
+	lan743x_ptp_set_rate_adj(adapter, lan743x_rate_adj);
 
 	return 0;
 }
@@ -1107,7 +1232,6 @@ static long lan743x_ptpci_do_aux_work(struct ptp_clock_info *ptpci)
 		container_of(ptpci, struct lan743x_ptp, ptp_clock_info);
 	struct lan743x_adapter *adapter =
 		container_of(ptp, struct lan743x_adapter, ptp);
-	u32 cap_info, cause, header, nsec, seconds;
 	bool new_timestamp_available = false;
 	struct ptp_clock_event ptp_event;
 	struct timespec64 ts;
@@ -1120,42 +1244,9 @@ static long lan743x_ptpci_do_aux_work(struct ptp_clock_info *ptpci)
 	while ((count < 100) && ptp_int_sts) {
 		count++;
 
-		if (ptp_int_sts & PTP_INT_BIT_TX_TS_) {
-			cap_info = lan743x_csr_read(adapter, PTP_CAP_INFO);
-
-			if (PTP_CAP_INFO_TX_TS_CNT_GET_(cap_info) > 0) {
-				seconds = lan743x_csr_read(adapter,
-							   PTP_TX_EGRESS_SEC);
-				nsec = lan743x_csr_read(adapter,
-							PTP_TX_EGRESS_NS);
-				cause = (nsec &
-					 PTP_TX_EGRESS_NS_CAPTURE_CAUSE_MASK_);
-				header = lan743x_csr_read(adapter,
-							  PTP_TX_MSG_HEADER);
-
-				if (cause ==
-				    PTP_TX_EGRESS_NS_CAPTURE_CAUSE_SW_) {
-					nsec &= PTP_TX_EGRESS_NS_TS_NS_MASK_;
-					lan743x_ptp_tx_ts_enqueue_ts(adapter,
-								     seconds,
-								     nsec,
-								     header);
-					new_timestamp_available = true;
-				} else if (cause ==
-					   PTP_TX_EGRESS_NS_CAPTURE_CAUSE_AUTO_) {
-					netif_err(adapter, drv, adapter->netdev,
-						  "Auto capture cause not supported\n");
-				} else {
-					netif_warn(adapter, drv, adapter->netdev,
-						   "unknown tx timestamp capture cause\n");
-				}
-			} else {
-				netif_warn(adapter, drv, adapter->netdev,
-					   "TX TS INT but no TX TS CNT\n");
-			}
-			lan743x_csr_write(adapter, PTP_INT_STS,
-					  PTP_INT_BIT_TX_TS_);
-		}
+		if ((ptp_int_sts & PTP_INT_BIT_TX_TS_) &&
+		    lan743x_ptp_tx_ts_drain(adapter))
+			new_timestamp_available = true;
 
 		if (ptp_int_sts & PTP_INT_IO_FE_MASK_) {
 			do {
@@ -1455,6 +1546,8 @@ static void lan743x_ptp_tx_ts_enqueue_skb(struct lan743x_adapter *adapter,
 	spin_lock_bh(&ptp->tx_ts_lock);
 	if (ptp->tx_ts_skb_queue_size < LAN743X_PTP_NUMBER_OF_TX_TIMESTAMPS) {
 		ptp->tx_ts_skb_queue[ptp->tx_ts_skb_queue_size] = skb;
+		ptp->tx_ts_skb_time_queue[ptp->tx_ts_skb_queue_size] =
+			ktime_get();
 		if (ignore_sync)
 			ptp->tx_ts_ignore_sync_queue |=
 				BIT(ptp->tx_ts_skb_queue_size);
@@ -1509,6 +1602,7 @@ int lan743x_ptp_init(struct lan743x_adapter *adapter)
 
 	mutex_init(&ptp->command_lock);
 	spin_lock_init(&ptp->tx_ts_lock);
+	spin_lock_init(&ptp->tx_ts_fifo_lock);
 	ptp->used_event_ch = 0;
 
 	for (i = 0; i < LAN743X_PTP_N_EVENT_CHAN; i++) {
@@ -1721,6 +1815,7 @@ static void lan743x_ptp_reset(struct lan743x_adapter *adapter)
 
 	lan743x_csr_write(adapter, PTP_CMD_CTL, PTP_CMD_CTL_PTP_RESET_);
 	lan743x_ptp_wait_till_cmd_done(adapter, PTP_CMD_CTL_PTP_RESET_);
+	ptp->rate_adj_valid = false;
 done:
 	mutex_unlock(&ptp->command_lock);
 }
@@ -50,11 +50,17 @@ int lan743x_ptp_open(struct lan743x_adapter *adapter);
 void lan743x_ptp_close(struct lan743x_adapter *adapter);
 void lan743x_ptp_update_latency(struct lan743x_adapter *adapter,
 				u32 link_speed);
+void lan743x_ptp_tx_ts_poll(struct lan743x_adapter *adapter);
+void lan743x_ptp_tx_ts_latency(struct lan743x_adapter *adapter, u64 *count,
+			       u64 *p50_us, u64 *p99_us, u64 *max_us);
 
 int lan743x_ptp_ioctl(struct net_device *netdev, struct ifreq *ifr, int cmd);
 
 #define LAN743X_PTP_NUMBER_OF_TX_TIMESTAMPS (4)
 
+/* bucket n counts TX timestamps delivered in less than 2^n us */
+#define LAN743X_PTP_TX_TS_LAT_BUCKETS	(16)
+
 #define PTP_FLAG_PTP_CLOCK_REGISTERED		BIT(1)
 #define PTP_FLAG_ISR_ENABLED			BIT(2)
 
@@ -73,6 +79,9 @@ struct lan743x_ptp {
 
 	/* command_lock: used to prevent concurrent ptp commands */
 	struct mutex	command_lock;
+	/* last PTP_CLOCK_RATE_ADJ value written, under command_lock */
+	u32 rate_adj;
+	bool rate_adj_valid;
 
 	struct ptp_clock *ptp_clock;
 	struct ptp_clock_info ptp_clock_info;
@@ -96,6 +105,13 @@ struct lan743x_ptp {
 	u32 tx_ts_nseconds_queue[LAN743X_PTP_NUMBER_OF_TX_TIMESTAMPS];
 	u32 tx_ts_header_queue[LAN743X_PTP_NUMBER_OF_TX_TIMESTAMPS];
 	int tx_ts_queue_size;
+	/* time each skb was queued, for the latency histogram */
+	ktime_t tx_ts_skb_time_queue[LAN743X_PTP_NUMBER_OF_TX_TIMESTAMPS];
+	u64 tx_ts_lat_hist[LAN743X_PTP_TX_TS_LAT_BUCKETS];
+	u64 tx_ts_lat_max_us;
+
+	/* tx_ts_fifo_lock: serializes draining the hardware timestamp FIFO */
+	spinlock_t	tx_ts_fifo_lock;
 };
 
 #endif /* _LAN743X_PTP_H */
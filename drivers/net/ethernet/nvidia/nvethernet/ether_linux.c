@@ -14,131 +14,143 @@
 #include <soc/tegra/virt/hv-ivc.h>
 
 /**
- * @brief ether_get_free_timestamp_node - get free node for timestmap info for SKB
+ * @brief ether_tx_ts_lat_update - account Tx timestamp delivery latency
  *
  * Algorithm:
- *  - Find index of statically allocated free memory for timestamp SKB
+ *  - Find log2(usec) bucket of time elapsed since Tx completion queued
+ *  the skb and increment it in the histogram.
  *
  * @param[in] pdata: OSD private data structure.
- *
- * @retval index number
+ * @param[in] entry: Tx timestamp ring entry being delivered.
  */
-static inline unsigned int ether_get_free_timestamp_node(struct ether_priv_data *pdata)
+static inline void ether_tx_ts_lat_update(struct ether_priv_data *pdata,
+					  struct ether_tx_ts_entry *entry)
 {
-	unsigned int i;
+	s64 usec = ktime_us_delta(ktime_get(), entry->queued);
+	unsigned int idx = 0U;
 
-	for (i = 0; i < ETHER_MAX_PENDING_SKB_CNT; i++) {
-		if (pdata->timestamp_skb[i].in_use == OSI_NONE)
-			break;
+	if (usec > 0) {
+		idx = (unsigned int)fls64((u64)usec);
+	}
+
+	if (idx >= ETHER_TX_TS_LAT_BUCKETS) {
+		idx = ETHER_TX_TS_LAT_BUCKETS - 1U;
 	}
 
-	return i;
+	pdata->tx_ts_lat_hist[idx]++;
+}
+
+void ether_tx_ts_queue(struct ether_priv_data *pdata, unsigned int chan,
+		       struct sk_buff *skb, unsigned int pktid)
+{
+	struct ether_tx_ts_ring *ring = &pdata->tx_ts_ring[chan];
+	unsigned int head = ring->head;
+	struct ether_tx_ts_entry *entry;
+
+	if ((head - smp_load_acquire(&ring->tail)) >= ETHER_TX_TS_RING_SZ) {
+		dev_err_ratelimited(pdata->dev,
+				    "No free node to store pending SKB\n");
+		ring->full_n++;
+		dev_consume_skb_any(skb);
+		return;
+	}
+
+	entry = &ring->entry[head & (ETHER_TX_TS_RING_SZ - 1U)];
+	entry->skb = skb;
+	entry->pktid = pktid;
+	entry->pkt_jiffies = jiffies;
+	entry->queued = ktime_get();
+
+	dev_dbg(pdata->dev, "%s() SKB %p added for pktid = %x time=%lu\n",
+		__func__, skb, pktid, entry->pkt_jiffies);
+
+	/* Publish the entry to consumer */
+	smp_store_release(&ring->head, head + 1U);
 }
 
 int ether_get_tx_ts(struct ether_priv_data *pdata)
 {
-	struct list_head *head_node, *temp_head_node;
-	struct list_head *tstamp_head, *temp_tstamp_head;
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
 	struct skb_shared_hwtstamps shhwtstamp;
 	struct osi_ioctl ioctl_data = {};
 	unsigned long long nsec = 0x0;
-	struct ether_tx_ts_skb_list *pnode;
-	struct ether_timestamp_skb_list *tnode;
-	int ret = -1;
-	unsigned long flags;
+	struct ether_tx_ts_entry *entry;
+	struct ether_tx_ts_ring *ring;
+	unsigned int i, chan, head, tail;
 	bool pending = false;
-	unsigned int idx = 0U;
+	int ret;
 
 	if (!atomic_inc_and_test(&pdata->tx_ts_ref_cnt)) {
 		/* Tx time stamp consumption already going on either from workq or func */
 		return -1;
 	}
 
-	if (list_empty(&pdata->tx_ts_skb_head)) {
-		atomic_set(&pdata->tx_ts_ref_cnt, -1);
-		return 0;
-	}
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		ring = &pdata->tx_ts_ring[chan];
+		tail = ring->tail;
+		head = smp_load_acquire(&ring->head);
 
-	raw_spin_lock_irqsave(&pdata->txts_lock, flags);
-	list_for_each_safe(head_node, temp_head_node,
-			   &pdata->tx_ts_skb_head) {
-		pnode = list_entry(head_node,
-				   struct ether_tx_ts_skb_list,
-				   list_head);
+		while (tail != head) {
+			entry = &ring->entry[tail & (ETHER_TX_TS_RING_SZ - 1U)];
 
-		ioctl_data.cmd = OSI_CMD_GET_TX_TS;
-		ioctl_data.tx_ts.pkt_id = pnode->pktid;
-		ret = osi_handle_ioctl(pdata->osi_core, &ioctl_data);
-		if (ret == 0) {
-			/* get time stamp form ethernet server */
-			dev_dbg(pdata->dev, "%s() pktid = %x, skb = %p\n",
-				__func__, pnode->pktid, pnode->skb);
+			ioctl_data.cmd = OSI_CMD_GET_TX_TS;
+			ioctl_data.tx_ts.pkt_id = entry->pktid;
+			ret = osi_handle_ioctl(pdata->osi_core, &ioctl_data);
+			if (ret < 0) {
+				if (time_before(jiffies, entry->pkt_jiffies +
+						msecs_to_jiffies(ETHER_SECTOMSEC))) {
+					/* Timestamps of a channel are captured
+					 * in Tx order, retry from this entry.
+					 */
+					dev_dbg(pdata->dev,
+						"Unable to retrieve TS from OSI\n");
+					pending = true;
+					break;
+				}
 
-			if ((ioctl_data.tx_ts.nsec & OSI_MAC_TCR_TXTSSMIS) ==
-			    OSI_MAC_TCR_TXTSSMIS) {
+				dev_dbg(pdata->dev,
+					"%s() skb %p deleting for pktid = %x time=%lu\n",
+					__func__, entry->skb, entry->pktid,
+					entry->pkt_jiffies);
+				pdata->tx_ts_timeout_n++;
+			} else if ((ioctl_data.tx_ts.nsec & OSI_MAC_TCR_TXTSSMIS) ==
+				   OSI_MAC_TCR_TXTSSMIS) {
 				dev_warn(pdata->dev,
 					 "No valid time for skb, removed\n");
-				if (pnode->skb != NULL) {
-					 dev_consume_skb_any(pnode->skb);
-				}
-
-				goto update_skb;
-			}
-
-			nsec = ioctl_data.tx_ts.sec * ETHER_ONESEC_NENOSEC +
-			       ioctl_data.tx_ts.nsec;
-
-			if (pnode->skb != NULL) {
-				idx = ether_get_free_timestamp_node(pdata);
-				if (idx < ETHER_MAX_PENDING_SKB_CNT) {
-					pdata->timestamp_skb[idx].in_use = OSI_ENABLE;
-					tnode = &pdata->timestamp_skb[idx];
-					tnode->skb = pnode->skb;
-					tnode->nsec = nsec;
-					dev_dbg(pdata->dev, "%s() SKB %p added for timestamp ns = %llu\n",
-						__func__, pnode->skb, nsec);
-					list_add_tail(&tnode->list_h,
-						      &pdata->timestamp_skb_head);
-				} else {
-					dev_err(pdata->dev, "No free node to store timestamp for SKB\n");
-					dev_consume_skb_any(pnode->skb);
+			} else {
+				/* get time stamp form ethernet server */
+				dev_dbg(pdata->dev, "%s() pktid = %x, skb = %p\n",
+					__func__, entry->pktid, entry->skb);
+
+				nsec = ioctl_data.tx_ts.sec * ETHER_ONESEC_NENOSEC +
+				       ioctl_data.tx_ts.nsec;
+				if (skb_shinfo(entry->skb)->tx_flags &
+				    SKBTX_IN_PROGRESS) {
+					memset(&shhwtstamp, 0,
+					       sizeof(struct skb_shared_hwtstamps));
+					/* pass tstamp to stack */
+					shhwtstamp.hwtstamp = ns_to_ktime(nsec);
+					skb_tstamp_tx(entry->skb, &shhwtstamp);
 				}
+				ether_tx_ts_lat_update(pdata, entry);
+				ether_tsn_lat_update(pdata, entry->skb, nsec);
 			}
 
-update_skb:
-			list_del(head_node);
-			pnode->in_use = OSI_DISABLE;
-
-		} else {
-			dev_dbg(pdata->dev, "Unable to retrieve TS from OSI\n");
-			pending = true;
+			dev_consume_skb_any(entry->skb);
+			entry->skb = NULL;
+			tail++;
+			/* Hand the slot back to producer */
+			smp_store_release(&ring->tail, tail);
 		}
 	}
 
-	raw_spin_unlock_irqrestore(&pdata->txts_lock, flags);
-
-	list_for_each_safe(tstamp_head, temp_tstamp_head,
-			   &pdata->timestamp_skb_head) {
-		tnode = list_entry(tstamp_head,
-				   struct ether_timestamp_skb_list,
-				   list_h);
-		if (tnode->in_use == OSI_ENABLE) {
-			memset(&shhwtstamp, 0,
-			       sizeof(struct skb_shared_hwtstamps));
-			/* pass tstamp to stack */
-			shhwtstamp.hwtstamp = ns_to_ktime(tnode->nsec);
-			skb_tstamp_tx(tnode->skb, &shhwtstamp);
-			list_del(tstamp_head);
-			tnode->in_use = OSI_NONE;
-		}
-		dev_consume_skb_any(tnode->skb);
-	}
+	atomic_set(&pdata->tx_ts_ref_cnt, -1);
 
 	if (pending)
-		ret = -EAGAIN;
+		return -EAGAIN;
 
-	atomic_set(&pdata->tx_ts_ref_cnt, -1);
-	return ret;
+	return 0;
 }
 
 /**
@@ -258,11 +270,71 @@ static irqreturn_t ether_common_isr_thread(int irq, void *data)
 }
 #endif
 
+int ether_read_mmc(struct ether_priv_data *pdata)
+{
+	struct osi_ioctl ioctl_data = {};
+	unsigned long flags;
+	int ret;
+
+	ioctl_data.cmd = OSI_CMD_READ_MMC;
+
+	/* Counters are read over IVC from process context only */
+	if (pdata->osi_core->use_virtualization == OSI_ENABLE) {
+		return osi_handle_ioctl(pdata->osi_core, &ioctl_data);
+	}
+
+	spin_lock_irqsave(&pdata->mmc_lock, flags);
+	ret = osi_handle_ioctl(pdata->osi_core, &ioctl_data);
+	pdata->mmc_read_jiffies = jiffies;
+	spin_unlock_irqrestore(&pdata->mmc_lock, flags);
+
+	return ret;
+}
+
+int ether_vm_read_stats(struct ether_priv_data *pdata)
+{
+	struct osi_ioctl ioctl_data = {};
+	unsigned long interval = msecs_to_jiffies(pdata->stats_timer);
+	int ret;
+
+	if (pdata->vm_stats_valid &&
+	    time_before(jiffies, pdata->mmc_read_jiffies + interval))
+		return 0;
+
+	ret = ether_read_mmc(pdata);
+	if (ret < 0)
+		return ret;
+
+	ioctl_data.cmd = OSI_CMD_READ_STATS;
+	ret = osi_handle_ioctl(pdata->osi_core, &ioctl_data);
+	if (ret < 0)
+		return ret;
+
+	pdata->mmc_read_jiffies = jiffies;
+	pdata->vm_stats_valid = true;
+
+	return 0;
+}
+
+void ether_stats_timer_update(struct ether_priv_data *pdata)
+{
+	pdata->stats_timer = pdata->mmc_poll_ms;
+#ifdef HSI_SUPPORT
+	/* Override stats_timer to getting MCC error stats as per
+	 * hsi.err_time_threshold configuration
+	 */
+	if (pdata->osi_core->hsi.err_time_threshold < pdata->stats_timer)
+		pdata->stats_timer = pdata->osi_core->hsi.err_time_threshold;
+#endif
+}
+
 /**
  * @brief Work Queue function to call osi_read_mmc() periodically.
  *
- * Algorithm: call osi_read_mmc in periodic manner to avoid possibility of
- * overrun of 32 bit MMC hw registers.
+ * Algorithm: MMC counters are read on demand by ndo_get_stats64 and
+ * ethtool -S. This work only protects 32 bit MMC hw registers from
+ * overrun, so it reads them only if no on demand read happened within
+ * the last stats_timer msec, and reschedules relative to the last read.
  *
  * @param[in] work: work structure
  *
@@ -273,18 +345,20 @@ static inline void ether_stats_work_func(struct work_struct *work)
 	struct delayed_work *dwork = to_delayed_work(work);
 	struct ether_priv_data *pdata = container_of(dwork,
 			struct ether_priv_data, ether_stats_work);
-	struct osi_core_priv_data *osi_core = pdata->osi_core;
-	struct osi_ioctl ioctl_data = {};
+	unsigned long interval = msecs_to_jiffies(pdata->stats_timer);
+	unsigned long next = READ_ONCE(pdata->mmc_read_jiffies) + interval;
 	int ret;
 
-	ioctl_data.cmd = OSI_CMD_READ_MMC;
-	ret = osi_handle_ioctl(osi_core, &ioctl_data);
-	if (ret < 0) {
-		dev_err(pdata->dev, "failed to read MMC counters %s\n",
-			__func__);
+	if (time_after_eq(jiffies, next)) {
+		ret = ether_read_mmc(pdata);
+		if (ret < 0) {
+			dev_err(pdata->dev, "failed to read MMC counters %s\n",
+				__func__);
+		}
+		next = jiffies + interval;
 	}
-	schedule_delayed_work(&pdata->ether_stats_work,
-			      msecs_to_jiffies(pdata->stats_timer));
+
+	schedule_delayed_work(&pdata->ether_stats_work, next - jiffies);
 }
 
 #ifdef HSI_SUPPORT
@@ -1515,6 +1589,7 @@ static void ether_start_ivc(struct ether_priv_data *pdata)
 		tegra_hv_ivc_channel_reset(ictxt->ivck);
 		ictxt->ivc_state = 1;
 		raw_spin_lock_init(&ictxt->ivck_lock);
+		ictxt->batch_cpu = nr_cpu_ids;
 	}
 }
 
@@ -1709,6 +1784,192 @@ err_chan_irq:
 	return ret;
 }
 
+#ifdef ETHER_DIM
+/**
+ * @brief ether_net_dim - Feed a DIM sample.
+ *
+ * @param[in] dim: DIM instance.
+ * @param[in] event_ctr: Event counter.
+ * @param[in] pkts: Packet counter.
+ * @param[in] bytes: Byte counter.
+ */
+static inline void ether_net_dim(struct dim *dim, u16 event_ctr, u64 pkts,
+				 u64 bytes)
+{
+	struct dim_sample sample = {};
+
+	dim_update_sample(event_ctr, pkts, bytes, &sample);
+#if defined(NV_NET_DIM_HAS_DIM_SAMPLE_PTR_ARG) /* Linux v6.13 */
+	net_dim(dim, &sample);
+#else
+	net_dim(dim, sample);
+#endif
+}
+
+/**
+ * @brief ether_rx_dim_update - Update Rx DIM at end of NAPI poll.
+ *
+ * @param[in] rx_napi: Rx NAPI instance.
+ */
+static inline void ether_rx_dim_update(struct ether_rx_napi *rx_napi)
+{
+	rx_napi->dim_event_ctr++;
+	ether_net_dim(&rx_napi->rx_dim, rx_napi->dim_event_ctr,
+		      rx_napi->dim_pkts, rx_napi->dim_bytes);
+}
+
+/**
+ * @brief ether_tx_dim_update - Update Tx DIM at end of NAPI poll.
+ *
+ * @param[in] tx_napi: Tx NAPI instance.
+ */
+static inline void ether_tx_dim_update(struct ether_tx_napi *tx_napi)
+{
+	tx_napi->dim_event_ctr++;
+	ether_net_dim(&tx_napi->tx_dim, tx_napi->dim_event_ctr,
+		      tx_napi->dim_pkts, tx_napi->dim_bytes);
+}
+
+/**
+ * @brief ether_rx_dim_work - Apply Rx moderation profile chosen by DIM.
+ *
+ * Algorithm: Rx moderation is applied as a SW holdoff before Rx IRQ is
+ * re-enabled, HW RIWT from DT/ethtool stays as the lower bound.
+ *
+ * @param[in] work: DIM work.
+ */
+static void ether_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct ether_rx_napi *rx_napi = container_of(dim, struct ether_rx_napi,
+						     rx_dim);
+	struct ether_priv_data *pdata = rx_napi->pdata;
+	struct dim_cq_moder moder;
+	unsigned int min_usecs = ETHER_EQOS_MIN_RX_COALESCE_USEC;
+	unsigned int usecs;
+
+	if (pdata->osi_dma->mac == OSI_MAC_HW_MGBE) {
+		min_usecs = ETHER_MGBE_MIN_RX_COALESCE_USEC;
+	}
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	usecs = min_t(unsigned int, moder.usec, ETHER_MAX_RX_COALESCE_USEC);
+	if (usecs < min_usecs) {
+		usecs = 0U;
+	}
+
+	WRITE_ONCE(rx_napi->rx_usecs, usecs);
+	pdata->xstats.rx_dim_usecs[rx_napi->chan] = usecs;
+
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * @brief ether_tx_dim_work - Apply Tx moderation profile chosen by DIM.
+ *
+ * Algorithm: Tx moderation is applied as Tx SW timer period.
+ *
+ * @param[in] work: DIM work.
+ */
+static void ether_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct ether_tx_napi *tx_napi = container_of(dim, struct ether_tx_napi,
+						     tx_dim);
+	struct ether_priv_data *pdata = tx_napi->pdata;
+	struct dim_cq_moder moder;
+	unsigned int usecs;
+
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+	usecs = clamp_t(unsigned int, moder.usec, ETHER_MIN_TX_COALESCE_USEC,
+			ETHER_MAX_TX_COALESCE_USEC);
+
+	WRITE_ONCE(tx_napi->tx_usecs, usecs);
+	pdata->xstats.tx_dim_usecs[tx_napi->chan] = usecs;
+
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * @brief ether_rx_usecs_hrtimer - Rx SW holdoff timer callback.
+ *
+ * @param[in] data: hrtimer instance.
+ *
+ * @retval HRTIMER_NORESTART
+ */
+static enum hrtimer_restart ether_rx_usecs_hrtimer(struct hrtimer *data)
+{
+	struct ether_rx_napi *rx_napi = container_of(data, struct ether_rx_napi,
+						     rx_usecs_timer);
+
+	if (likely(napi_schedule_prep(&rx_napi->napi)))
+		__napi_schedule_irqoff(&rx_napi->napi);
+
+	return HRTIMER_NORESTART;
+}
+#endif /* ETHER_DIM */
+
+/**
+ * @brief ether_init_chan_coalesce - Initialize per channel moderation state.
+ *
+ * Algorithm: Seed per channel Tx SW timer period from global coalesce
+ * settings and reset DIM state for all enabled channels.
+ *
+ * @param[in] pdata: OSD private data structure.
+ */
+static void ether_init_chan_coalesce(struct ether_priv_data *pdata)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	unsigned int chan;
+	unsigned int i;
+
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		pdata->tx_napi[chan]->tx_usecs = osi_dma->tx_usecs;
+#ifdef ETHER_DIM
+		pdata->tx_napi[chan]->tx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		pdata->tx_napi[chan]->tx_dim.state = DIM_START_MEASURE;
+		pdata->tx_napi[chan]->tx_dim.profile_ix = 0;
+		pdata->tx_napi[chan]->dim_event_ctr = 0;
+		pdata->tx_napi[chan]->dim_pkts = 0;
+		pdata->tx_napi[chan]->dim_bytes = 0;
+		pdata->xstats.tx_dim_usecs[chan] = osi_dma->tx_usecs;
+
+		pdata->rx_napi[chan]->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		pdata->rx_napi[chan]->rx_dim.state = DIM_START_MEASURE;
+		pdata->rx_napi[chan]->rx_dim.profile_ix = 0;
+		pdata->rx_napi[chan]->rx_usecs = 0U;
+		pdata->rx_napi[chan]->dim_event_ctr = 0;
+		pdata->rx_napi[chan]->dim_pkts = 0;
+		pdata->rx_napi[chan]->dim_bytes = 0;
+		pdata->xstats.rx_dim_usecs[chan] = 0U;
+#endif /* ETHER_DIM */
+	}
+}
+
+#ifdef ETHER_DIM
+/**
+ * @brief ether_stop_chan_dim - Stop DIM works and Rx holdoff timers.
+ *
+ * @param[in] pdata: OSD private data structure.
+ *
+ * @note NAPI need to be disabled.
+ */
+static void ether_stop_chan_dim(struct ether_priv_data *pdata)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	unsigned int chan;
+	unsigned int i;
+
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		hrtimer_cancel(&pdata->rx_napi[chan]->rx_usecs_timer);
+		cancel_work_sync(&pdata->rx_napi[chan]->rx_dim.work);
+		cancel_work_sync(&pdata->tx_napi[chan]->tx_dim.work);
+	}
+}
+#endif /* ETHER_DIM */
+
 /**
  * @brief Disable NAPI.
  *
@@ -1838,6 +2099,9 @@ static void free_rx_dma_resources(struct osi_dma_priv_data *osi_dma,
 		}
 #ifdef ETHER_PAGE_POOL
 		if (chan != ETHER_INVALID_CHAN_NUM && pdata->page_pool[chan]) {
+#ifdef ETHER_XDP
+			ether_xdp_rxq_info_unreg(pdata, chan);
+#endif /* ETHER_XDP */
 			page_pool_destroy(pdata->page_pool[chan]);
 			pdata->page_pool[chan] = NULL;
 		}
@@ -1947,7 +2211,8 @@ static int ether_allocate_rx_buffers(struct ether_priv_data *pdata,
 				return -ENOMEM;
 			}
 
-			dma_addr = page_pool_get_dma_addr(page);
+			dma_addr = page_pool_get_dma_addr(page) +
+				   pdata->rx_headroom;
 			rx_swcx->buf_virt_addr = page;
 		}
 #else
@@ -1996,11 +2261,18 @@ static int ether_page_pool_create_per_chan(struct ether_priv_data *pdata,
 
 	pp_params.flags = PP_FLAG_DMA_MAP;
 	pp_params.pool_size = pool_size;
-	num_pages = DIV_ROUND_UP(osi_dma->rx_buf_len, PAGE_SIZE);
+	num_pages = DIV_ROUND_UP(osi_dma->rx_buf_len + pdata->rx_headroom,
+				 PAGE_SIZE);
 	pp_params.order = ilog2(roundup_pow_of_two(num_pages));
 	pp_params.nid = dev_to_node(pdata->dev);
 	pp_params.dev = pdata->dev;
 	pp_params.dma_dir = DMA_FROM_DEVICE;
+#ifdef ETHER_XDP
+	/* XDP_TX transmits directly from Rx pages */
+	if (pdata->xdp_prog) {
+		pp_params.dma_dir = DMA_BIDIRECTIONAL;
+	}
+#endif /* ETHER_XDP */
 
 	pdata->page_pool[chan] = page_pool_create(&pp_params);
 	if (IS_ERR(pdata->page_pool[chan])) {
@@ -2046,6 +2318,12 @@ static int ether_allocate_rx_dma_resources(struct osi_dma_priv_data *osi_dma,
 				goto exit;
 			}
 #endif
+#ifdef ETHER_XDP
+			ret = ether_xdp_rxq_info_reg(pdata, chan);
+			if (ret < 0) {
+				goto exit;
+			}
+#endif /* ETHER_XDP */
 
 			ret = allocate_rx_dma_resource(osi_dma, pdata->dev,
 						       chan);
@@ -2716,6 +2994,9 @@ static int ether_open(struct net_device *dev)
 	pdata->vlan_hash_filtering = OSI_PERFECT_FILTER_MODE;
 #endif /* ETHER_VLAN_VID_SUPPORT */
 	pdata->l2_filtering_mode = OSI_PERFECT_FILTER_MODE;
+
+	/* L3/L4 filters are cleared by MAC reset, reprogram ntuple rules */
+	ether_ntuple_restore(pdata);
 #endif /* !OSI_STRIPPED_LIB */
 
 	/* Initialize PTP */
@@ -2727,6 +3008,8 @@ static int ether_open(struct net_device *dev)
 		goto err_hw_init;
 	}
 
+	ether_init_chan_coalesce(pdata);
+
 	/* Enable napi before requesting irq to be ready to handle it */
 	ether_napi_enable(pdata);
 
@@ -2750,14 +3033,9 @@ static int ether_open(struct net_device *dev)
 	/* start network queues */
 	netif_tx_start_all_queues(pdata->ndev);
 
-	pdata->stats_timer = ETHER_STATS_TIMER;
-#ifdef HSI_SUPPORT
-	/* Override stats_timer to getting MCC error stats as per
-	 * hsi.err_time_threshold configuration
-	 */
-	if (osi_core->hsi.err_time_threshold < ETHER_STATS_TIMER)
-		pdata->stats_timer = osi_core->hsi.err_time_threshold;
-#endif
+	ether_stats_timer_update(pdata);
+	pdata->mmc_read_jiffies = jiffies;
+	pdata->vm_stats_valid = false;
 	ether_stats_work_queue_start(pdata);
 
 #ifdef HSI_SUPPORT
@@ -2895,37 +3173,37 @@ static inline void ether_delete_l2_filter(struct ether_priv_data *pdata)
 }
 
 /**
- * @brief Call to delete nodes form tx timestamp skb list
+ * @brief Call to drop pending skbs from tx timestamp rings
  *
  * Algorithm:
  * - Stop work queue
- * - Delete nodes from link list
+ * - Free skbs pending in each channel ring and reset ring indexes
  *
  * @param[in] pdata: Pointer to private data structure.
+ *
+ * @note Tx NAPI of all channels must be disabled.
  */
 static inline void ether_flush_tx_ts_skb_list(struct ether_priv_data *pdata)
 {
-	struct ether_tx_ts_skb_list *pnode;
-	struct list_head *head_node, *temp_head_node;
-	unsigned long flags;
+	struct ether_tx_ts_entry *entry;
+	struct ether_tx_ts_ring *ring;
+	unsigned int i;
 
 	/* stop workqueue */
 	cancel_delayed_work_sync(&pdata->tx_ts_work);
 
-	raw_spin_lock_irqsave(&pdata->txts_lock, flags);
-	/* Delete nodes from list and rest static memory for reuse */
-	if (!list_empty(&pdata->tx_ts_skb_head)) {
-		list_for_each_safe(head_node, temp_head_node,
-				   &pdata->tx_ts_skb_head) {
-			pnode = list_entry(head_node,
-					   struct ether_tx_ts_skb_list,
-					   list_head);
-			dev_kfree_skb(pnode->skb);
-			list_del(head_node);
-			pnode->in_use = OSI_DISABLE;
+	for (i = 0; i < OSI_MGBE_MAX_NUM_CHANS; i++) {
+		ring = &pdata->tx_ts_ring[i];
+		while (ring->tail != ring->head) {
+			entry = &ring->entry[ring->tail &
+					     (ETHER_TX_TS_RING_SZ - 1U)];
+			dev_kfree_skb(entry->skb);
+			entry->skb = NULL;
+			ring->tail++;
 		}
+		ring->head = 0U;
+		ring->tail = 0U;
 	}
-	raw_spin_unlock_irqrestore(&pdata->txts_lock, flags);
 }
 
 /**
@@ -3009,6 +3287,9 @@ static int ether_close(struct net_device *ndev)
 	osi_hw_dma_deinit(pdata->osi_dma);
 
 	ether_napi_disable(pdata);
+#ifdef ETHER_DIM
+	ether_stop_chan_dim(pdata);
+#endif /* ETHER_DIM */
 
 	/* free DMA resources after DMA stop */
 	free_dma_resources(pdata);
@@ -3209,6 +3490,12 @@ static int ether_tx_swcx_alloc(struct ether_priv_data *pdata,
 		tx_pkt_cx->flags |= OSI_PKT_CX_PTP;
 	}
 
+	if (unlikely(READ_ONCE(pdata->tsn_validation) == OSI_ENABLE)) {
+		/* Timestamp every frame to measure per TC egress latency */
+		ETHER_SKB_CB(skb)->xmit_tai = ktime_get_clocktai();
+		tx_pkt_cx->flags |= OSI_PKT_CX_PTP;
+	}
+
 	if (((tx_pkt_cx->flags & OSI_PKT_CX_VLAN) == OSI_PKT_CX_VLAN) ||
 	    ((tx_pkt_cx->flags & OSI_PKT_CX_TSO) == OSI_PKT_CX_TSO) ||
 	    (((tx_pkt_cx->flags & OSI_PKT_CX_PTP) == OSI_PKT_CX_PTP) &&
@@ -3385,12 +3672,35 @@ static unsigned short ether_select_queue(struct net_device *dev,
 	return txqueue_select;
 }
 
+/**
+ * @brief Arm Tx SW coalescing timer of a channel at the end of a burst.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] chan: Tx DMA channel number.
+ */
+static inline void ether_tx_usecs_timer_arm(struct ether_priv_data *pdata,
+					    unsigned int chan)
+{
+	struct ether_tx_napi *tx_napi = pdata->tx_napi[chan];
+
+	if (pdata->osi_dma->use_tx_usecs == OSI_ENABLE &&
+	    atomic_read(&tx_napi->tx_usecs_timer_armed) == OSI_DISABLE) {
+		atomic_set(&tx_napi->tx_usecs_timer_armed, OSI_ENABLE);
+		hrtimer_start(&tx_napi->tx_usecs_timer,
+			      tx_napi->tx_usecs * NSEC_PER_USEC,
+			      HRTIMER_MODE_REL);
+	}
+}
+
 /**
  * @brief Network layer hook for data transmission.
  *
  * Algorithm:
  * 1) Allocate software context (DMA address for the buffer) for the data.
  * 2) Invoke OSI for data transmission.
+ * 3) Defer per packet bookkeeping (Tx SW timer arming) while the stack
+ * indicates more packets are following (xmit_more), and flush it at the
+ * end of the burst or when the queue is about to stall.
  *
  * @param[in] skb: SKB data structure.
  * @param[in] ndev: Net device structure.
@@ -3410,11 +3720,17 @@ static int ether_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 #ifdef OSI_ERR_DEBUG
 	unsigned int cur_tx_idx = tx_ring->cur_tx_idx;
 #endif
+	bool xmit_more = netdev_xmit_more();
+	unsigned long val;
 	int count = 0;
 	int ret;
 
 	count = ether_tx_swcx_alloc(pdata, tx_ring, skb);
 	if (count <= 0) {
+		/* Packets queued earlier in this burst must not wait on
+		 * a Tx SW timer that was never armed.
+		 */
+		ether_tx_usecs_timer_arm(pdata, chan);
 		if (count == 0) {
 			netif_stop_subqueue(ndev, qinx);
 			netdev_err(ndev, "Tx ring[%d] is full\n", chan);
@@ -3431,24 +3747,31 @@ static int ether_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 		ether_tx_swcx_rollback(pdata, tx_ring, cur_tx_idx, count);
 		netdev_err(ndev, "%s() dropping corrupted skb\n", __func__);
 		dev_kfree_skb_any(skb);
+		ether_tx_usecs_timer_arm(pdata, chan);
 		return NETDEV_TX_OK;
 	}
 #endif
 
+	val = pdata->xstats.tx_doorbell_n[chan];
+	pdata->xstats.tx_doorbell_n[chan] =
+		osi_update_stats_counter(val, 1U);
+	if (xmit_more) {
+		val = pdata->xstats.tx_xmit_more_n[chan];
+		pdata->xstats.tx_xmit_more_n[chan] =
+			osi_update_stats_counter(val, 1U);
+	}
+
 	if (ether_avail_txdesc_cnt(osi_dma, tx_ring) <= ETHER_TX_DESC_THRESHOLD) {
 		netif_stop_subqueue(ndev, qinx);
 		netdev_dbg(ndev, "Tx ring[%d] insufficient desc.\n", chan);
+		/* Ring is about to stall, flush regardless of xmit_more */
+		xmit_more = false;
 	}
 
-	if (osi_dma->use_tx_usecs == OSI_ENABLE &&
-	    atomic_read(&pdata->tx_napi[chan]->tx_usecs_timer_armed) ==
-			OSI_DISABLE) {
-		atomic_set(&pdata->tx_napi[chan]->tx_usecs_timer_armed,
-			   OSI_ENABLE);
-		hrtimer_start(&pdata->tx_napi[chan]->tx_usecs_timer,
-			      osi_dma->tx_usecs * NSEC_PER_USEC,
-			      HRTIMER_MODE_REL);
+	if (!xmit_more) {
+		ether_tx_usecs_timer_arm(pdata, chan);
 	}
+
 	return NETDEV_TX_OK;
 }
 
@@ -3662,7 +3985,7 @@ static int ether_prepare_uc_list(struct net_device *dev,
 }
 
 /**
- * @brief This function is used to set RX mode.
+ * @brief Program the L2 filters for the RX mode.
  *
  * Algorithm: Based on Network interface flag, MAC registers are programmed to
  * set mode.
@@ -3671,7 +3994,7 @@ static int ether_prepare_uc_list(struct net_device *dev,
  *
  * @note MAC and PHY need to be initialized.
  */
-void ether_set_rx_mode(struct net_device *dev)
+static void ether_program_rx_mode(struct net_device *dev)
 {
 	struct ether_priv_data *pdata = netdev_priv(dev);
 	struct osi_core_priv_data *osi_core = pdata->osi_core;
@@ -3765,6 +4088,32 @@ void ether_set_rx_mode(struct net_device *dev)
 	return;
 }
 
+/**
+ * @brief This function is used to set RX mode.
+ *
+ * Algorithm: Program the L2 filters for the RX mode. With virtualization
+ * enabled the filter commands are sent to the Ethernet server as one IVC
+ * batch, so the server status is only known once the whole update is done.
+ *
+ * @param[in] dev - pointer to net_device structure.
+ *
+ * @note MAC and PHY need to be initialized.
+ */
+void ether_set_rx_mode(struct net_device *dev)
+{
+	struct ether_priv_data *pdata = netdev_priv(dev);
+
+	if (pdata->osi_core->use_virtualization == OSI_DISABLE) {
+		ether_program_rx_mode(dev);
+		return;
+	}
+
+	ether_ivc_batch_begin(pdata);
+	ether_program_rx_mode(dev);
+	if (ether_ivc_batch_end(pdata) < 0)
+		dev_err(pdata->dev, "L2 filter update failed\n");
+}
+
 /**
  * @brief Function to handle PHY read private IOCTL
  *
@@ -4050,6 +4399,14 @@ static int ether_change_mtu(struct net_device *ndev, int new_mtu)
 		return -EBUSY;
 	}
 
+#ifdef ETHER_XDP
+	if (pdata->xdp_prog && (new_mtu > ETHER_XDP_MAX_MTU)) {
+		netdev_err(pdata->ndev, "MTU greater than %lu not supported with XDP\n",
+			   (unsigned long)ETHER_XDP_MAX_MTU);
+		return -EINVAL;
+	}
+#endif /* ETHER_XDP */
+
 	if ((new_mtu > OSI_MTU_SIZE_9000) &&
 	    (osi_dma->num_dma_chans != 1U)) {
 		netdev_err(pdata->ndev,
@@ -4089,6 +4446,74 @@ static int ether_change_mtu(struct net_device *ndev, int new_mtu)
 	return 0;
 }
 
+/**
+ * @brief ether_get_stats64 - ndo_get_stats64 handler
+ *
+ * Algorithm:
+ * 1) Sum per channel software counters under u64_stats sync.
+ * 2) Read HW MMC counters on demand for error counters.
+ *
+ * @param[in] ndev: Network device structure.
+ * @param[out] stats: Link statistics to be filled.
+ */
+static void ether_get_stats64(struct net_device *ndev,
+			      struct rtnl_link_stats64 *stats)
+{
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct osi_core_priv_data *osi_core = pdata->osi_core;
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct ether_rx_stats *rx_stats;
+	struct ether_tx_stats *tx_stats;
+	u64 packets, bytes, dropped, errors;
+	unsigned int i, chan, start;
+
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		if (pdata->rx_napi[chan] == NULL ||
+		    pdata->tx_napi[chan] == NULL) {
+			continue;
+		}
+
+		rx_stats = &pdata->rx_napi[chan]->stats;
+		do {
+			start = u64_stats_fetch_begin(&rx_stats->syncp);
+			packets = rx_stats->packets;
+			bytes = rx_stats->bytes;
+			dropped = rx_stats->dropped;
+			errors = rx_stats->errors;
+		} while (u64_stats_fetch_retry(&rx_stats->syncp, start));
+		stats->rx_packets += packets;
+		stats->rx_bytes += bytes;
+		stats->rx_dropped += dropped;
+		stats->rx_errors += errors;
+
+		tx_stats = &pdata->tx_napi[chan]->stats;
+		do {
+			start = u64_stats_fetch_begin(&tx_stats->syncp);
+			packets = tx_stats->packets;
+			bytes = tx_stats->bytes;
+		} while (u64_stats_fetch_retry(&tx_stats->syncp, start));
+		stats->tx_packets += packets;
+		stats->tx_bytes += bytes;
+	}
+
+	/* May be called in atomic context, IVC based reads are left to
+	 * ethtool -S.
+	 */
+	if (netif_running(ndev) && pdata->hw_feat.mmc_sel == OSI_ENABLE &&
+	    osi_core->use_virtualization == OSI_DISABLE) {
+		if (ether_read_mmc(pdata) < 0) {
+			netdev_dbg(ndev, "failed to read MMC counters\n");
+		}
+	}
+
+#ifndef OSI_STRIPPED_LIB
+	stats->rx_crc_errors = osi_dma->pkt_err_stats.rx_crc_error;
+	stats->rx_frame_errors = osi_dma->pkt_err_stats.rx_frame_error;
+#endif /* !OSI_STRIPPED_LIB */
+	stats->rx_fifo_errors = osi_core->mmc.mmc_rx_fifo_overflow;
+}
+
 /**
  * @brief Change HW features for the given network device.
  *
@@ -4114,6 +4539,13 @@ static int ether_set_features(struct net_device *ndev, netdev_features_t feat)
 	netdev_features_t hw_feat_cur_state = pdata->hw_feat_cur_state;
 	struct osi_ioctl ioctl_data = {};
 
+#ifndef OSI_STRIPPED_LIB
+	if (((ndev->features & NETIF_F_NTUPLE) == NETIF_F_NTUPLE) &&
+	    ((feat & NETIF_F_NTUPLE) != NETIF_F_NTUPLE)) {
+		ether_ntuple_flush(pdata);
+	}
+#endif /* !OSI_STRIPPED_LIB */
+
 	if (pdata->hw_feat.rx_coe_sel == 0U) {
 		return ret;
 	}
@@ -4267,6 +4699,85 @@ static int ether_setup_tc(struct net_device *ndev, enum tc_setup_type type,
 	}
 }
 
+#ifdef ETHER_XDP
+/**
+ * @brief ether_xdp_setup_prog - Attach or detach XDP program
+ *
+ * Algorithm:
+ * 1) Validate MTU against single page XDP buffer layout.
+ * 2) If program is attached/detached on running interface, restart the
+ *    interface so that Rx buffers are re-created with XDP headroom and
+ *    bidirectional DMA mapping.
+ * 3) Swap the program pointer used by Rx path.
+ *
+ * @param[in] ndev: Network device structure
+ * @param[in] prog: New XDP program, NULL to detach.
+ * @param[in] extack: Netlink extended ack.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_xdp_setup_prog(struct net_device *ndev,
+				struct bpf_prog *prog,
+				struct netlink_ext_ack *extack)
+{
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	bool running = netif_running(ndev);
+	bool need_reset;
+	struct bpf_prog *old_prog;
+	int ret = 0;
+
+	if (prog && ndev->mtu > ETHER_XDP_MAX_MTU) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	need_reset = (!!pdata->xdp_prog != !!prog);
+
+	if (running && need_reset) {
+		ether_close(ndev);
+	}
+
+	old_prog = xchg(&pdata->xdp_prog, prog);
+	if (old_prog) {
+		bpf_prog_put(old_prog);
+	}
+
+	if (need_reset) {
+		pdata->rx_headroom = prog ? XDP_PACKET_HEADROOM : 0U;
+	}
+
+	if (running && need_reset) {
+		ret = ether_open(ndev);
+		if (ret < 0) {
+			dev_err(pdata->dev, "failed to restart interface for XDP\n");
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief ether_bpf - ndo_bpf handler
+ *
+ * @param[in] ndev: Network device structure
+ * @param[in] bpf: BPF command.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_bpf(struct net_device *ndev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return ether_xdp_setup_prog(ndev, bpf->prog, bpf->extack);
+	default:
+		/* AF_XDP zero-copy (XDP_SETUP_XSK_POOL) is not supported */
+		return -EOPNOTSUPP;
+	}
+}
+#endif /* ETHER_XDP */
+
 /**
  * @brief Ethernet network device operations
  */
@@ -4283,12 +4794,17 @@ static const struct net_device_ops ether_netdev_ops = {
 	.ndo_change_mtu = ether_change_mtu,
 	.ndo_select_queue = ether_select_queue,
 	.ndo_set_features = ether_set_features,
+	.ndo_get_stats64 = ether_get_stats64,
 	.ndo_set_rx_mode = ether_set_rx_mode,
 #ifdef ETHER_VLAN_VID_SUPPORT
 	.ndo_vlan_rx_add_vid = ether_vlan_rx_add_vid,
 	.ndo_vlan_rx_kill_vid = ether_vlan_rx_kill_vid,
 #endif /* ETHER_VLAN_VID_SUPPORT */
 	.ndo_setup_tc = ether_setup_tc,
+#ifdef ETHER_XDP
+	.ndo_bpf = ether_bpf,
+	.ndo_xdp_xmit = ether_xdp_xmit,
+#endif /* ETHER_XDP */
 };
 
 /**
@@ -4314,11 +4830,36 @@ static int ether_napi_poll_rx(struct napi_struct *napi, int budget)
 	unsigned int more_data_avail;
 	unsigned long flags;
 	int received = 0;
+	u64 start = 0;
+
+	if (unlikely(READ_ONCE(pdata->perf_active)))
+		start = local_clock();
 
 	received = osi_process_rx_completions(osi_dma, chan, budget,
 					      &more_data_avail);
+#ifdef ETHER_XDP
+	ether_xdp_rx_flush(rx_napi);
+#endif /* ETHER_XDP */
+	if (unlikely(start != 0U))
+		rx_napi->perf_ns += local_clock() - start;
+
 	if (received < budget) {
 		napi_complete(napi);
+#ifdef ETHER_DIM
+		if (pdata->use_rx_dim == OSI_ENABLE) {
+			rx_napi->dim_pkts += received;
+			ether_rx_dim_update(rx_napi);
+			/* Keep Rx IRQ masked and re-poll after the holdoff
+			 * while traffic is flowing.
+			 */
+			if (received > 0 && READ_ONCE(rx_napi->rx_usecs) > 0U) {
+				hrtimer_start(&rx_napi->rx_usecs_timer,
+					      rx_napi->rx_usecs * NSEC_PER_USEC,
+					      HRTIMER_MODE_REL);
+				return received;
+			}
+		}
+#endif /* ETHER_DIM */
 		raw_spin_lock_irqsave(&pdata->rlock, flags);
 		osi_handle_dma_intr(osi_dma, chan,
 				    OSI_DMA_CH_RX_INTR,
@@ -4351,8 +4892,18 @@ static int ether_napi_poll_tx(struct napi_struct *napi, int budget)
 	unsigned int chan = tx_napi->chan;
 	unsigned long flags;
 	int processed;
+	u64 start = 0;
+
+	if (unlikely(READ_ONCE(pdata->perf_active)))
+		start = local_clock();
 
 	processed = osi_process_tx_completions(osi_dma, chan, budget);
+	if (unlikely(start != 0U))
+		tx_napi->perf_ns += local_clock() - start;
+#ifdef ETHER_XDP
+	/* skb completions wake the queue, XDP frames do not carry one */
+	ether_xdp_tx_wake(pdata, chan);
+#endif /* ETHER_XDP */
 
 	/* re-arm the timer if tx ring is not empty */
 	if (!osi_txring_empty(osi_dma, chan) &&
@@ -4360,12 +4911,17 @@ static int ether_napi_poll_tx(struct napi_struct *napi, int budget)
 	    atomic_read(&tx_napi->tx_usecs_timer_armed) == OSI_DISABLE) {
 		atomic_set(&tx_napi->tx_usecs_timer_armed, OSI_ENABLE);
 		hrtimer_start(&tx_napi->tx_usecs_timer,
-			      osi_dma->tx_usecs * NSEC_PER_USEC,
+			      tx_napi->tx_usecs * NSEC_PER_USEC,
 			      HRTIMER_MODE_REL);
 	}
 
 	if (processed < budget) {
 		napi_complete(napi);
+#ifdef ETHER_DIM
+		if (pdata->use_tx_dim == OSI_ENABLE) {
+			ether_tx_dim_update(tx_napi);
+		}
+#endif /* ETHER_DIM */
 		raw_spin_lock_irqsave(&pdata->rlock, flags);
 		osi_handle_dma_intr(osi_dma, chan,
 				    OSI_DMA_CH_TX_INTR,
@@ -4429,6 +4985,7 @@ static int ether_alloc_napi(struct ether_priv_data *pdata)
 
 		pdata->tx_napi[chan]->pdata = pdata;
 		pdata->tx_napi[chan]->chan = chan;
+		u64_stats_init(&pdata->tx_napi[chan]->stats.syncp);
 #if defined(NV_NETIF_NAPI_ADD_WEIGHT_PRESENT) /* Linux v6.1 */
 		netif_napi_add_weight(ndev, &pdata->tx_napi[chan]->napi,
 			       ether_napi_poll_tx, 64);
@@ -4447,6 +5004,7 @@ static int ether_alloc_napi(struct ether_priv_data *pdata)
 
 		pdata->rx_napi[chan]->pdata = pdata;
 		pdata->rx_napi[chan]->chan = chan;
+		u64_stats_init(&pdata->rx_napi[chan]->stats.syncp);
 #if defined(NV_NETIF_NAPI_ADD_WEIGHT_PRESENT) /* Linux v6.1 */
 		netif_napi_add_weight(ndev, &pdata->rx_napi[chan]->napi,
 			       ether_napi_poll_rx, 64);
@@ -6391,6 +6949,13 @@ static void ether_set_ndev_features(struct net_device *ndev,
 		features |= NETIF_F_RXHASH;
 	}
 
+#ifndef OSI_STRIPPED_LIB
+	/* ethtool ntuple rules on L3/L4 filters */
+	if (pdata->hw_feat.l3l4_filter_num > 0U) {
+		features |= NETIF_F_NTUPLE;
+	}
+#endif /* !OSI_STRIPPED_LIB */
+
 	/* Features available in HW */
 	ndev->hw_features = features;
 	/* Features that can be changed by user */
@@ -6635,6 +7200,10 @@ static int ether_probe(struct platform_device *pdev)
 
 	ndev->netdev_ops = &ether_netdev_ops;
 	ether_set_ethtool_ops(ndev);
+#if defined(ETHER_XDP) && (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0))
+	ndev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT |
+			     NETDEV_XDP_ACT_NDO_XMIT;
+#endif
 
 	ret = ether_alloc_napi(pdata);
 	if (ret < 0) {
@@ -6651,6 +7220,16 @@ static int ether_probe(struct platform_device *pdev)
 			     CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 		pdata->tx_napi[chan]->tx_usecs_timer.function =
 			ether_tx_usecs_hrtimer;
+#ifdef ETHER_DIM
+		hrtimer_init(&pdata->rx_napi[chan]->rx_usecs_timer,
+			     CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		pdata->rx_napi[chan]->rx_usecs_timer.function =
+			ether_rx_usecs_hrtimer;
+		INIT_WORK(&pdata->rx_napi[chan]->rx_dim.work,
+			  ether_rx_dim_work);
+		INIT_WORK(&pdata->tx_napi[chan]->tx_dim.work,
+			  ether_tx_dim_work);
+#endif /* ETHER_DIM */
 	}
 
 	ret = register_netdev(ndev);
@@ -6686,7 +7265,6 @@ static int ether_probe(struct platform_device *pdev)
 
 
 	raw_spin_lock_init(&pdata->rlock);
-	raw_spin_lock_init(&pdata->txts_lock);
 	init_filter_values(pdata);
 
 	if (osi_core->mac == OSI_MAC_HW_MGBE)
@@ -6704,6 +7282,9 @@ static int ether_probe(struct platform_device *pdev)
 	}
 	/* Initialization of delayed workqueue */
 	INIT_DELAYED_WORK(&pdata->ether_stats_work, ether_stats_work_func);
+	spin_lock_init(&pdata->mmc_lock);
+	spin_lock_init(&pdata->tsn_lat_lock);
+	pdata->mmc_poll_ms = ETHER_STATS_TIMER;
 #ifdef HSI_SUPPORT
 	/* Initialization of delayed workqueue for HSI error reporting */
 	INIT_DELAYED_WORK(&pdata->ether_hsi_work, ether_hsi_work_func);
@@ -6711,8 +7292,6 @@ static int ether_probe(struct platform_device *pdev)
 	/* Initialization of set speed workqueue */
 	INIT_DELAYED_WORK(&pdata->set_speed_work, set_speed_work_func);
 	osi_core->hw_feature = &pdata->hw_feat;
-	INIT_LIST_HEAD(&pdata->tx_ts_skb_head);
-	INIT_LIST_HEAD(&pdata->timestamp_skb_head);
 	INIT_DELAYED_WORK(&pdata->tx_ts_work, ether_get_tx_ts_work);
 	pdata->rx_m_enabled = false;
 	pdata->rx_pcs_m_enabled = false;
@@ -47,6 +47,23 @@
 #endif
 #define ETHER_PAGE_POOL
 #endif
+#if defined(ETHER_PAGE_POOL) && (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0))
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <net/xdp.h>
+#define ETHER_XDP
+#endif
+#if defined(ETHER_PAGE_POOL) && (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0))
+/* Needs skb_mark_for_recycle() without page/pool arguments */
+#define ETHER_RX_HDR_SPLIT
+#endif
+#if defined(ETHER_PAGE_POOL) && IS_ENABLED(CONFIG_PAGE_POOL_STATS)
+#define ETHER_PAGE_POOL_STATS
+#endif
+#if IS_ENABLED(CONFIG_DIMLIB)
+#include <linux/dim.h>
+#define ETHER_DIM
+#endif
 #include <osi_core.h>
 #include <osi_dma.h>
 #include <mmc.h>
@@ -184,9 +201,81 @@
 /** @} */
 
 /**
- * @brief Max pending SKB count
+ * @brief Rx ring is refilled from NAPI once at least this many descriptors
+ * are consumed, so that refill and descriptor programming cost is amortized.
+ */
+#define ETHER_RX_REFILL_THRESH		16U
+
+#ifdef ETHER_PAGE_POOL
+/**
+ * @brief Max pages taken from page pool in one Rx refill batch
+ */
+#define ETHER_RX_REFILL_BULK		32U
+#endif /* ETHER_PAGE_POOL */
+
+#ifdef ETHER_RX_HDR_SPLIT
+/**
+ * @brief Rx frames up to this length are copied into skb linear area
+ * even in header split mode, so that page is recycled immediately.
  */
-#define ETHER_MAX_PENDING_SKB_CNT	(64 * OSI_MGBE_MAX_NUM_CHANS)
+#define ETHER_RX_COPYBREAK		256U
+#endif /* ETHER_RX_HDR_SPLIT */
+
+/**
+ * @brief Max ethtool ntuple rules, each one occupies a HW L3/L4 filter
+ */
+#define ETHER_MAX_NTUPLE_RULES		32U
+
+/**
+ * @addtogroup ETHER_PRIV_FLAG ethtool private flags
+ *
+ * @brief Bit positions of driver private flags
+ * @{
+ */
+#define ETHER_PRIV_FLAG_RX_HDR_SPLIT	BIT(0)
+#define ETHER_PRIV_FLAG_TSN_VALIDATION	BIT(1)
+/** @} */
+
+/**
+ * @brief Max traffic classes tracked by TSN latency validation mode,
+ * one per EST gate
+ */
+#define ETHER_TSN_MAX_TC		8U
+
+/**
+ * @brief Per channel Tx timestamp pending SKB ring size (power of 2)
+ */
+#define ETHER_TX_TS_RING_SZ		64U
+
+/**
+ * @brief Number of log2(usec) buckets of Tx timestamp delivery latency
+ * histogram. Last bucket accounts everything beyond 2^(N-2) usec.
+ */
+#define ETHER_TX_TS_LAT_BUCKETS		22U
+
+/**
+ * @brief ether_skb_cb - Driver private data carried in skb->cb on Tx
+ */
+struct ether_skb_cb {
+	/** CLOCK_TAI time at which skb was handed to driver */
+	ktime_t xmit_tai;
+};
+
+#define ETHER_SKB_CB(skb)	((struct ether_skb_cb *)((skb)->cb))
+
+/**
+ * @brief ether_tsn_lat - Per traffic class egress latency in validation mode
+ */
+struct ether_tsn_lat {
+	/** Number of frames measured */
+	u64 samples;
+	/** Best case enqueue to wire latency in nsec */
+	u64 min_ns;
+	/** Worst case enqueue to wire latency in nsec */
+	u64 max_ns;
+	/** Sum of latencies in nsec, for average */
+	u64 sum_ns;
+};
 
 /**
  * @brief Maximum buffer length per DMA descriptor (16KB).
@@ -244,6 +333,41 @@
 /** @} */
 
 #define ETHER_INVALID_CHAN_NUM		0xFFU
+
+#ifdef ETHER_XDP
+/**
+ * @addtogroup XDP defines
+ *
+ * @brief Verdicts returned by ether_xdp_run_rx() and per Rx NAPI status
+ * bits used to flush pending XDP work at the end of a NAPI poll.
+ * @{
+ */
+#define ETHER_XDP_PASS			0U
+#define ETHER_XDP_CONSUMED		OSI_BIT(0)
+#define ETHER_XDP_TX			OSI_BIT(1)
+#define ETHER_XDP_REDIRECT		OSI_BIT(2)
+/** @} */
+
+/**
+ * @addtogroup XDP Tx buffer type
+ *
+ * @brief Tag stored in the low bits of osi_tx_swcx::buf_virt_addr so that
+ * Tx completion can tell xdp_frame buffers apart from skbs.
+ * @{
+ */
+#define ETHER_TX_BUF_XDP_TX		0x1UL
+#define ETHER_TX_BUF_XDP_NDO		0x2UL
+#define ETHER_TX_BUF_XDP_MASK		0x3UL
+/** @} */
+
+/**
+ * @brief Maximum MTU supported with an XDP program attached. Frame along
+ * with XDP headroom and skb_shared_info must fit in a single page.
+ */
+#define ETHER_XDP_MAX_MTU	(PAGE_SIZE - XDP_PACKET_HEADROOM - \
+				 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) - \
+				 ETH_HLEN - VLAN_HLEN - ETH_FCS_LEN)
+#endif /* ETHER_XDP */
 /**
  * @brief Check if Tx data buffer length is within bounds.
  *
@@ -303,6 +427,13 @@ static inline int ether_avail_txdesc_cnt(struct osi_dma_priv_data *osi_dma,
  */
 #define ETHER_STATS_TIMER		3000U
 
+/**
+ * @brief Range of user configurable HW counters poll interval in msec.
+ * Values above ETHER_STATS_TIMER are wrap safe only below 10G line rate.
+ */
+#define ETHER_STATS_TIMER_MIN		100U
+#define ETHER_STATS_TIMER_MAX		36000U
+
 /**
  * @brief Timer to trigger Work queue periodically which read TX timestamp
  * for PTP packets. Timer is in milisecond.
@@ -315,6 +446,34 @@ static inline int ether_avail_txdesc_cnt(struct osi_dma_priv_data *osi_dma,
 /* MDIO clause 45 bit */
 #define MII_DEVADDR_C45_SHIFT	16
 
+/**
+ * @brief Per channel Tx software counters, updated only from Tx NAPI
+ */
+struct ether_tx_stats {
+	/** Transmitted packets */
+	u64 packets;
+	/** Transmitted bytes */
+	u64 bytes;
+	/** Sync for 64 bit counters readers on 32 bit systems */
+	struct u64_stats_sync syncp;
+};
+
+/**
+ * @brief Per channel Rx software counters, updated only from Rx NAPI
+ */
+struct ether_rx_stats {
+	/** Received packets */
+	u64 packets;
+	/** Received bytes */
+	u64 bytes;
+	/** Packets dropped due to skb allocation failure */
+	u64 dropped;
+	/** Packets received with error */
+	u64 errors;
+	/** Sync for 64 bit counters readers on 32 bit systems */
+	struct u64_stats_sync syncp;
+};
+
 /**
  * @brief DMA Transmit Channel NAPI
  */
@@ -329,6 +488,22 @@ struct ether_tx_napi {
 	struct hrtimer tx_usecs_timer;
 	/** SW timer flag associated with transmit channel */
 	atomic_t tx_usecs_timer_armed;
+	/** SW timer period in usecs, updated by DIM when enabled */
+	unsigned int tx_usecs;
+	/** Software counters of transmit channel */
+	struct ether_tx_stats stats;
+	/** CPU time spent in NAPI poll while a perf test runs [nsec] */
+	u64 perf_ns;
+#ifdef ETHER_DIM
+	/** DIM instance associated with transmit channel */
+	struct dim tx_dim;
+	/** DIM event counter */
+	u16 dim_event_ctr;
+	/** Packets completed, sampled by DIM */
+	u64 dim_pkts;
+	/** Bytes completed, sampled by DIM */
+	u64 dim_bytes;
+#endif /* ETHER_DIM */
 };
 
 /**
@@ -341,6 +516,30 @@ struct ether_rx_napi {
 	struct ether_priv_data *pdata;
 	/** NAPI instance associated with transmit channel */
 	struct napi_struct napi;
+	/** Software counters of receive channel */
+	struct ether_rx_stats stats;
+	/** CPU time spent in NAPI poll while a perf test runs [nsec] */
+	u64 perf_ns;
+#ifdef ETHER_XDP
+	/** XDP Rx queue info associated with receive channel */
+	struct xdp_rxq_info xdp_rxq;
+	/** XDP actions pending flush in current NAPI poll */
+	unsigned int xdp_status;
+#endif /* ETHER_XDP */
+#ifdef ETHER_DIM
+	/** DIM instance associated with receive channel */
+	struct dim rx_dim;
+	/** Rx interrupt holdoff in usecs selected by DIM, 0 for none */
+	unsigned int rx_usecs;
+	/** SW timer that re-polls the channel after rx_usecs holdoff */
+	struct hrtimer rx_usecs_timer;
+	/** DIM event counter */
+	u16 dim_event_ctr;
+	/** Packets received, sampled by DIM */
+	u64 dim_pkts;
+	/** Bytes received, sampled by DIM */
+	u64 dim_bytes;
+#endif /* ETHER_DIM */
 };
 
 /**
@@ -353,6 +552,51 @@ struct ether_vm_irq_data {
 	struct ether_priv_data *pdata;
 };
 
+/**
+ * @brief Loopback perf test result of one DMA channel
+ */
+struct ether_perf_chan {
+	/** DMA channel number */
+	unsigned int chan;
+	/** Packets sent */
+	u64 tx_pkts;
+	/** Packets received back */
+	u64 rx_pkts;
+	/** Frame bytes received back */
+	u64 rx_bytes;
+	/** First transmit to last receive [nsec] */
+	u64 elapsed_ns;
+	/** Round trip latency percentiles and maximum [nsec] */
+	u64 lat_p50_ns;
+	u64 lat_p99_ns;
+	u64 lat_p999_ns;
+	u64 lat_max_ns;
+	/** CPU time in transmit and Tx completion per packet [nsec] */
+	u64 tx_cpu_ns;
+	/** CPU time in Rx NAPI poll per packet [nsec] */
+	u64 rx_cpu_ns;
+};
+
+/**
+ * @brief Loopback perf test report
+ */
+struct ether_perf_report {
+	/** Test used PHY loopback instead of MAC loopback */
+	bool phy_lb;
+	/** Frame size without FCS [bytes] */
+	unsigned int frame_size;
+	/** Packets sent per DMA channel */
+	unsigned int count;
+	/** Maximum packets in flight */
+	unsigned int window;
+	/** Result of the test run */
+	int err;
+	/** No. of valid entries in chans */
+	unsigned int num_chans;
+	/** Per DMA channel results */
+	struct ether_perf_chan chans[OSI_MGBE_MAX_NUM_CHANS];
+};
+
 /**
  * @brief Ethernet IVC context
  */
@@ -363,6 +607,16 @@ struct ether_ivc_ctxt {
 	raw_spinlock_t ivck_lock;
 	/** Flag to indicate ivc started or stopped */
 	unsigned int ivc_state;
+	/** CPU holding an open command batch, nr_cpu_ids if none */
+	unsigned int batch_cpu;
+	/** Batched commands still waiting for their response */
+	unsigned int batch_pending;
+	/** First error returned by the server for the batch */
+	int batch_err;
+	/** IRQ flags saved when the batch was opened */
+	unsigned long batch_flags;
+	/** Response buffer of batched commands */
+	ivc_msg_common_t batch_resp;
 };
 
 /**
@@ -376,33 +630,34 @@ struct ether_mac_addr {
 };
 
 /**
- * @brief tx timestamp pending skb list node structure
+ * @brief tx timestamp pending skb ring entry
  */
-struct ether_tx_ts_skb_list {
-	/** Link list node head */
-	struct list_head list_head;
-	/** if node is in use */
-	unsigned int in_use;
+struct ether_tx_ts_entry {
 	/** skb pointer */
 	struct sk_buff *skb;
 	/** packet id to identify timestamp */
 	unsigned int pktid;
 	/** SKB jiffies to find time */
 	unsigned long pkt_jiffies;
+	/** Time at which Tx completion queued the skb */
+	ktime_t queued;
 };
 
 /**
- * @brief skb list with timestamp node structure
+ * @brief Per channel lock-free tx timestamp pending skb ring
+ *
+ * Single producer (Tx completion NAPI context of the channel) and single
+ * consumer (ether_get_tx_ts() owner, serialized with tx_ts_ref_cnt).
  */
-struct ether_timestamp_skb_list {
-	/** Link list node head */
-	struct list_head list_h;
-	/** skb pointer */
-	struct sk_buff *skb;
-	/* Nano sec tx timestamp for skbinfo*/
-	unsigned long long nsec;
-	/** if node is in use */
-	unsigned int in_use;
+struct ether_tx_ts_ring {
+	/** Pending skb entries */
+	struct ether_tx_ts_entry entry[ETHER_TX_TS_RING_SZ];
+	/** Producer index, only updated by Tx completion */
+	unsigned int head;
+	/** Consumer index, only updated by ether_get_tx_ts() */
+	unsigned int tail;
+	/** skb count dropped because ring was full */
+	unsigned long full_n;
 };
 
 /**
@@ -417,10 +672,62 @@ struct ether_xtra_stat_counters {
 	nveu64_t tx_usecs_swtimer_n[OSI_MGBE_MAX_NUM_QUEUES];
 	/** RX per channel interrupt count */
 	nveu64_t rx_normal_irq_n[OSI_MGBE_MAX_NUM_QUEUES];
+	/** TX per channel DMA tail pointer (doorbell) update count */
+	nveu64_t tx_doorbell_n[OSI_MGBE_MAX_NUM_QUEUES];
+	/** TX per channel count of packets queued with xmit_more hint */
+	nveu64_t tx_xmit_more_n[OSI_MGBE_MAX_NUM_QUEUES];
 	/** link connect count */
 	nveu64_t link_connect_count;
 	/** link disconnect count */
 	nveu64_t link_disconnect_count;
+#ifdef ETHER_XDP
+	/** RX per channel XDP_PASS count */
+	nveu64_t rx_xdp_pass_n[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel XDP_DROP/XDP_ABORTED count */
+	nveu64_t rx_xdp_drop_n[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel XDP_TX count */
+	nveu64_t rx_xdp_tx_n[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel XDP_REDIRECT count */
+	nveu64_t rx_xdp_redirect_n[OSI_MGBE_MAX_NUM_QUEUES];
+	/** TX per channel ndo_xdp_xmit frame count */
+	nveu64_t tx_xdp_xmit_n[OSI_MGBE_MAX_NUM_QUEUES];
+#endif /* ETHER_XDP */
+#ifdef ETHER_RX_HDR_SPLIT
+	/** RX per channel frames delivered as page pool frags */
+	nveu64_t rx_hdr_split_n[OSI_MGBE_MAX_NUM_QUEUES];
+#endif /* ETHER_RX_HDR_SPLIT */
+#ifdef ETHER_PAGE_POOL
+	/** RX per channel ring refill count */
+	nveu64_t rx_refill_n[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel buffers refilled from page pool */
+	nveu64_t rx_refill_buf_n[OSI_MGBE_MAX_NUM_QUEUES];
+#endif /* ETHER_PAGE_POOL */
+#ifdef ETHER_PAGE_POOL_STATS
+	/** RX per channel page pool allocations served from cache */
+	nveu64_t rx_pp_alloc_fast[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel page pool allocations from page allocator */
+	nveu64_t rx_pp_alloc_slow[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel page pool high order allocations */
+	nveu64_t rx_pp_alloc_slow_ho[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel page pool allocations with empty ring */
+	nveu64_t rx_pp_alloc_empty[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel page pool cache refills from ring */
+	nveu64_t rx_pp_alloc_refill[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel page pool pages recycled to cache */
+	nveu64_t rx_pp_recycle_cached[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel page pool pages recycled to ring */
+	nveu64_t rx_pp_recycle_ring[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel page pool pages released as ring was full */
+	nveu64_t rx_pp_recycle_ring_full[OSI_MGBE_MAX_NUM_QUEUES];
+	/** RX per channel page pool pages released due to elevated refcnt */
+	nveu64_t rx_pp_recycle_released[OSI_MGBE_MAX_NUM_QUEUES];
+#endif /* ETHER_PAGE_POOL_STATS */
+#ifdef ETHER_DIM
+	/** RX per channel interrupt holdoff usecs chosen by DIM */
+	nveu64_t rx_dim_usecs[OSI_MGBE_MAX_NUM_QUEUES];
+	/** TX per channel SW timer usecs chosen by DIM */
+	nveu64_t tx_dim_usecs[OSI_MGBE_MAX_NUM_QUEUES];
+#endif /* ETHER_DIM */
 };
 
 /**
@@ -540,6 +847,10 @@ struct ether_priv_data {
 	unsigned int vlan_hash_filtering;
 	/** L2 filter mode */
 	unsigned int l2_filtering_mode;
+	/** ethtool ntuple rules, indexed by L3/L4 filter number */
+	struct ethtool_rx_flow_spec ntuple_rules[ETHER_MAX_NTUPLE_RULES];
+	/** Bitmap of valid entries in ntuple_rules */
+	DECLARE_BITMAP(ntuple_valid, ETHER_MAX_NTUPLE_RULES);
 	/** PTP clock operations structure */
 	struct ptp_clock_info ptp_clock_ops;
 	/** PTP system clock */
@@ -554,6 +865,10 @@ struct ether_priv_data {
 	unsigned int max_platform_mtu;
 	/** Spin lock for PTP registers */
 	raw_spinlock_t ptp_lock;
+	/** Last frequency adjustment programmed to MAC [ppb] */
+	s32 ptp_adj_ppb;
+	/** ptp_adj_ppb matches HW, cleared when PTP is reconfigured */
+	bool ptp_adj_ppb_valid;
 	/** Clocks enable check */
 	bool clks_enable;
 	/** Promiscuous mode support, configuration in DT */
@@ -577,7 +892,31 @@ struct ether_priv_data {
 #ifdef ETHER_PAGE_POOL
 	/** Pointer to page pool */
 	struct page_pool *page_pool[OSI_MGBE_MAX_NUM_CHANS];
+	/** Headroom reserved in front of each Rx page pool buffer */
+	unsigned int rx_headroom;
 #endif
+#ifdef ETHER_RX_HDR_SPLIT
+	/** Rx header split (page frags + napi_gro_frags) mode enabled */
+	unsigned int rx_hdr_split;
+#endif /* ETHER_RX_HDR_SPLIT */
+	/** TSN validation mode, HW timestamp every Tx frame */
+	unsigned int tsn_validation;
+	/** Protects tsn_lat updates from Tx completion and timestamp work */
+	spinlock_t tsn_lat_lock;
+	/** Per traffic class egress latency measured in validation mode */
+	struct ether_tsn_lat tsn_lat[ETHER_TSN_MAX_TC];
+	/** Frames with egress timestamp older than enqueue (clock not synced) */
+	unsigned long tsn_lat_unsync_n;
+#ifdef ETHER_XDP
+	/** Attached XDP program */
+	struct bpf_prog *xdp_prog;
+#endif /* ETHER_XDP */
+#ifdef ETHER_DIM
+	/** Adaptive Rx interrupt moderation enabled through ethtool */
+	unsigned int use_rx_dim;
+	/** Adaptive Tx interrupt moderation enabled through ethtool */
+	unsigned int use_tx_dim;
+#endif /* ETHER_DIM */
 #ifdef CONFIG_DEBUG_FS
 	/** Debug fs directory pointer */
 	struct dentry *dbgfs_dir;
@@ -587,7 +926,17 @@ struct ether_priv_data {
 	struct dentry *dbgfs_desc_dump;
 	/** Register dump debug fs pointer */
 	struct dentry *dbgfs_reg_dump;
+	/** Tx timestamp latency histogram debug fs pointer */
+	struct dentry *dbgfs_tx_ts_lat;
+	/** TSN per traffic class latency debug fs pointer */
+	struct dentry *dbgfs_tsn_lat;
+	/** Loopback perf test debug fs pointer */
+	struct dentry *dbgfs_perf;
 #endif
+	/** Loopback perf test running, NAPI polls account their CPU time */
+	bool perf_active;
+	/** Report of the last loopback perf test, protected by rtnl */
+	struct ether_perf_report perf;
 #ifdef MACSEC_SUPPORT
 	/** MACsec priv data */
 	struct macsec_priv_data *macsec_pdata;
@@ -596,14 +945,12 @@ struct ether_priv_data {
 	struct ether_mac_addr mac_addr[ETHER_ADDR_REG_CNT_128];
 	/** skb tx timestamp update work queue */
 	struct delayed_work tx_ts_work;
-	/** local skb list head */
-	struct list_head tx_ts_skb_head;
-	/** local skb list head with timestamp*/
-	struct list_head timestamp_skb_head;
-	/** pre allocated memory for ether_tx_ts_skb_list list */
-	struct ether_tx_ts_skb_list tx_ts_skb[ETHER_MAX_PENDING_SKB_CNT];
-	/** pre allocated memory for ether_timestamp_skb_list list */
-	struct ether_timestamp_skb_list timestamp_skb[ETHER_MAX_PENDING_SKB_CNT];
+	/** Per channel pending skb rings waiting for Tx timestamp */
+	struct ether_tx_ts_ring tx_ts_ring[OSI_MGBE_MAX_NUM_CHANS];
+	/** Tx timestamp delivery latency histogram in log2(usec) buckets */
+	unsigned long tx_ts_lat_hist[ETHER_TX_TS_LAT_BUCKETS];
+	/** skb count dropped as timestamp was not available within 1 sec */
+	unsigned long tx_ts_timeout_n;
 	/** Atomic variable to hold the current pad calibration status */
 	atomic_t padcal_in_progress;
 	/** eqos dev pinctrl handle */
@@ -648,14 +995,20 @@ struct ether_priv_data {
 	bool rx_pcs_m_enabled;
 	/* Timer value in msec for ether_stats_work thread */
 	unsigned int stats_timer;
+	/** User configured HW counters poll interval in msec */
+	unsigned int mmc_poll_ms;
+	/** Serialize MMC counters read and accumulation in OSI */
+	spinlock_t mmc_lock;
+	/** jiffies of last MMC counters read */
+	unsigned long mmc_read_jiffies;
+	/** Guest stats snapshot read since the interface came up */
+	bool vm_stats_valid;
 #ifdef HSI_SUPPORT
 	/** Delayed work queue for error reporting */
 	struct delayed_work ether_hsi_work;
 	/** HSI lock */
 	struct mutex hsi_lock;
 #endif
-	/** Protect critical section of TX TS SKB list */
-	raw_spinlock_t txts_lock;
 	/** Ref count for ether_get_tx_ts_func */
 	atomic_t tx_ts_ref_cnt;
 	/** Ref count for set_speed_work_func */
@@ -743,6 +1096,22 @@ int ether_handle_priv_ts_ioctl(struct ether_priv_data *pdata,
 			       struct ifreq *ifr);
 #ifndef OSI_STRIPPED_LIB
 int ether_conf_eee(struct ether_priv_data *pdata, unsigned int tx_lpi_enable);
+
+/**
+ * @brief ether_ntuple_restore - Reprogram ethtool ntuple rules in HW
+ *
+ * @param[in] pdata: OSD private data structure.
+ *
+ * @note MAC needs to be initialized, L3/L4 filters are lost on MAC reset.
+ */
+void ether_ntuple_restore(struct ether_priv_data *pdata);
+
+/**
+ * @brief ether_ntuple_flush - Remove all ethtool ntuple rules
+ *
+ * @param[in] pdata: OSD private data structure.
+ */
+void ether_ntuple_flush(struct ether_priv_data *pdata);
 #endif /* !OSI_STRIPPED_LIB */
 
 /**
@@ -761,6 +1130,9 @@ void ether_selftest_run(struct net_device *dev,
 			struct ethtool_test *etest, u64 *buf);
 void ether_selftest_get_strings(struct ether_priv_data *pdata, u8 *data);
 int ether_selftest_get_count(struct ether_priv_data *pdata);
+int ether_selftest_perf(struct ether_priv_data *pdata, bool phy_lb,
+			unsigned int frame_size, unsigned int count,
+			unsigned int window);
 #else
 static inline void ether_selftest_run(struct net_device *dev,
 				      struct ethtool_test *etest, u64 *buf)
@@ -806,6 +1178,30 @@ void ether_assign_osd_ops(struct osi_core_priv_data *osi_core,
 int osd_ivc_send_cmd(void *priv, ivc_msg_common_t *ivc_buf,
 		     unsigned int len);
 
+/**
+ * @brief ether_ivc_batch_begin - Open an IVC command batch
+ *
+ * Algorithm: Until ether_ivc_batch_end(), commands sent by this CPU are
+ * written to the IVC queue without waiting for the server response, so a
+ * sequence of configuration commands costs one round trip instead of one
+ * per command. Responses are not copied back to the caller, so only
+ * commands whose result is just a status may be batched. The IVC lock is
+ * held with IRQs disabled for the whole batch.
+ *
+ * @param[in] pdata: OSD private data
+ */
+void ether_ivc_batch_begin(struct ether_priv_data *pdata);
+
+/**
+ * @brief ether_ivc_batch_end - Close an IVC command batch
+ *
+ * @param[in] pdata: OSD private data
+ *
+ * @retval 0 if all batched commands succeeded
+ * @retval first failing status otherwise
+ */
+int ether_ivc_batch_end(struct ether_priv_data *pdata);
+
 void ether_set_rx_mode(struct net_device *dev);
 
 /**
@@ -842,6 +1238,62 @@ int ether_tc_setup_taprio(struct ether_priv_data *pdata,
 int ether_tc_setup_cbs(struct ether_priv_data *pdata,
 		       struct tc_cbs_qopt_offload *qopt);
 
+/**
+ * @brief ether_tsn_lat_update - Account Tx frame egress latency per TC
+ *
+ * Algorithm: In TSN validation mode latency is the difference between
+ * egress HW timestamp and CLOCK_TAI at ndo_start_xmit, so PHC needs to
+ * be synchronized to system TAI clock (as required by taprio anyway).
+ *
+ * @param[in] pdata: Pointer to private data structure.
+ * @param[in] skb: Transmitted skb.
+ * @param[in] hw_ns: Egress HW timestamp in nsec.
+ */
+void ether_tsn_lat_update(struct ether_priv_data *pdata,
+			  struct sk_buff *skb, u64 hw_ns);
+
+/**
+ * @brief ether_tsn_lat_reset - Clear TSN validation latency counters
+ *
+ * @param[in] pdata: Pointer to private data structure.
+ */
+void ether_tsn_lat_reset(struct ether_priv_data *pdata);
+
+
+/**
+ * @brief ether_read_mmc - Read and accumulate HW MMC counters in OSI
+ *
+ * @param[in] pdata: Pointer to private data structure.
+ *
+ * @note MAC needs to be initialized. With virtualization enabled this
+ * may sleep.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+int ether_read_mmc(struct ether_priv_data *pdata);
+
+/**
+ * @brief ether_vm_read_stats - Refresh the guest MMC and core stats snapshot
+ *
+ * Algorithm: With virtualization enabled every counter read is an IVC round
+ * trip to the Ethernet server. Keep the last MMC and core stats read as a
+ * snapshot and only refresh it when it is older than stats_timer msec, so
+ * polling readers cost no IVC traffic.
+ *
+ * @param[in] pdata: Pointer to private data structure.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+int ether_vm_read_stats(struct ether_priv_data *pdata);
+
+/**
+ * @brief ether_stats_timer_update - Derive HW counters poll interval
+ *
+ * @param[in] pdata: Pointer to private data structure.
+ */
+void ether_stats_timer_update(struct ether_priv_data *pdata);
 
 /**
  * @brief Get Tx done timestamp from OSI and update in skb
@@ -854,7 +1306,107 @@ int ether_tc_setup_cbs(struct ether_priv_data *pdata,
  * @retval EAGAIN on Failure
  */
 int ether_get_tx_ts(struct ether_priv_data *pdata);
+
+/**
+ * @brief Queue skb waiting for delayed Tx timestamp on channel ring
+ *
+ * @param[in] pdata: Pointer to private data structure.
+ * @param[in] chan: Tx DMA channel number.
+ * @param[in] skb: skb waiting for Tx timestamp.
+ * @param[in] pktid: Packet ID to identify timestamp.
+ *
+ * @note Must be called only from Tx completion of the channel.
+ */
+void ether_tx_ts_queue(struct ether_priv_data *pdata, unsigned int chan,
+		       struct sk_buff *skb, unsigned int pktid);
 void ether_restart_lane_bringup_task(struct tasklet_struct *t);
+
+#ifdef ETHER_XDP
+/**
+ * @brief ether_xdp_rxq_info_reg - Register XDP Rx queue info for a channel
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] chan: Rx DMA channel number.
+ *
+ * @note Page pool for the channel must be created.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+int ether_xdp_rxq_info_reg(struct ether_priv_data *pdata, unsigned int chan);
+
+/**
+ * @brief ether_xdp_rxq_info_unreg - Unregister XDP Rx queue info
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] chan: Rx DMA channel number.
+ */
+void ether_xdp_rxq_info_unreg(struct ether_priv_data *pdata,
+			      unsigned int chan);
+
+/**
+ * @brief ether_xdp_run_rx - Run attached XDP program on a received frame
+ *
+ * Algorithm: Runs the program on the page pool buffer and executes the
+ * verdict. On XDP_PASS, data and len are updated with the (possibly
+ * adjusted) frame boundaries so caller can build the skb.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] prog: XDP program.
+ * @param[in] chan: Rx DMA channel number.
+ * @param[in] page: Page pool page holding the frame.
+ * @param[in,out] data: Start of frame data.
+ * @param[in,out] len: Frame length.
+ *
+ * @retval ETHER_XDP_PASS if frame needs to be passed to stack
+ * @retval ETHER_XDP_CONSUMED/ETHER_XDP_TX/ETHER_XDP_REDIRECT otherwise
+ */
+unsigned int ether_xdp_run_rx(struct ether_priv_data *pdata,
+			      struct bpf_prog *prog, unsigned int chan,
+			      struct page *page, void **data,
+			      unsigned int *len);
+
+/**
+ * @brief ether_xdp_rx_flush - Flush XDP actions at end of Rx NAPI poll
+ *
+ * @param[in] rx_napi: Rx NAPI instance.
+ */
+void ether_xdp_rx_flush(struct ether_rx_napi *rx_napi);
+
+/**
+ * @brief ether_xdp_tx_complete - Tx completion for XDP buffers
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] swcx: Tx software context of completed descriptor.
+ *
+ * @retval true if buffer was an XDP frame and is released
+ * @retval false if buffer is not an XDP frame
+ */
+bool ether_xdp_tx_complete(struct ether_priv_data *pdata,
+			   const struct osi_tx_swcx *swcx);
+
+/**
+ * @brief ether_xdp_tx_wake - Wake Tx queue stopped behind XDP frames
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] chan: Tx DMA channel number.
+ */
+void ether_xdp_tx_wake(struct ether_priv_data *pdata, unsigned int chan);
+
+/**
+ * @brief ether_xdp_xmit - ndo_xdp_xmit handler
+ *
+ * @param[in] ndev: Network device.
+ * @param[in] num_frames: Number of frames.
+ * @param[in] frames: Array of XDP frames.
+ * @param[in] flags: XDP_XMIT_* flags.
+ *
+ * @retval Number of frames queued for transmission
+ * @retval "negative value" on failure.
+ */
+int ether_xdp_xmit(struct net_device *ndev, int num_frames,
+		   struct xdp_frame **frames, u32 flags);
+#endif /* ETHER_XDP */
 #ifdef ETHER_NVGRO
 void ether_nvgro_purge_timer(struct timer_list *t);
 #endif /* ETHER_NVGRO */
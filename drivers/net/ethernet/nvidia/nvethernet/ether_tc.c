@@ -4,6 +4,87 @@
 #include <nvidia/conftest.h>
 #include "ether_linux.h"
 
+/**
+ * @brief ether_tc_gcl_depth - Get number of GCL entries supported
+ *
+ * @param[in] pdata: OSD private data.
+ *
+ * @retval Max GCL entries as per HW feature register, limited to OSI GCL size
+ */
+static unsigned int ether_tc_gcl_depth(struct ether_priv_data *pdata)
+{
+	unsigned int depth = pdata->hw_feat.gcl_depth;
+
+	/* HW encodes depth as 1 - 64, 2 - 128, ... 5 - 1024 */
+	if ((pdata->osi_core->hw_feature == OSI_NULL) || (depth == 0U) ||
+	    (depth > 5U)) {
+		return OSI_GCL_SIZE_256;
+	}
+
+	return min_t(unsigned int, 64U << (depth - 1U), OSI_GCL_SIZE_256);
+}
+
+/**
+ * @brief ether_tc_gcl_width - Get width of GCL time interval field
+ *
+ * @param[in] pdata: OSD private data.
+ *
+ * @retval Number of time interval bits in a GCL entry
+ */
+static unsigned int ether_tc_gcl_width(struct ether_priv_data *pdata)
+{
+	if (pdata->osi_core->hw_feature == OSI_NULL) {
+		return 24U;
+	}
+
+	switch (pdata->hw_feat.gcl_width) {
+	case 1:
+		return 16U;
+	case 2:
+		return 20U;
+	default:
+		return 24U;
+	}
+}
+
+/**
+ * @brief ether_tc_adjust_base_time - Move base time into the future
+ *
+ * Algorithm: HW reports BTRE if base time is older than current MAC time.
+ * As per 802.1Qbv a schedule with base time in the past starts at the next
+ * cycle boundary, so advance base time by whole cycles past MAC time.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] base_time: Requested base time in nsec.
+ * @param[in] cycle_time: Cycle time in nsec.
+ *
+ * @retval Base time in nsec to program
+ */
+static u64 ether_tc_adjust_base_time(struct ether_priv_data *pdata,
+				     u64 base_time, u64 cycle_time)
+{
+	unsigned int sec = 0, nsec = 0;
+	unsigned long flags;
+	u64 now, n;
+	int ret;
+
+	raw_spin_lock_irqsave(&pdata->ptp_lock, flags);
+	ret = osi_dma_get_systime_from_mac(pdata->osi_dma, &sec, &nsec);
+	raw_spin_unlock_irqrestore(&pdata->ptp_lock, flags);
+	if (ret < 0) {
+		return base_time;
+	}
+
+	now = ((u64)sec * OSI_NSEC_PER_SEC) + nsec;
+	if (base_time >= now) {
+		return base_time;
+	}
+
+	n = div64_u64(now - base_time, cycle_time) + 1U;
+
+	return base_time + (n * cycle_time);
+}
+
 int ether_tc_setup_taprio(struct ether_priv_data *pdata,
 			  struct tc_taprio_qopt_offload *qopt)
 {
@@ -11,15 +92,12 @@ int ether_tc_setup_taprio(struct ether_priv_data *pdata,
 	unsigned int fpe_required = OSI_DISABLE;
 	struct osi_ioctl tc_ioctl_data = {};
 	unsigned long cycle_time = 0x0U;
-	/* Hardcode width base on current HW config, input parameter validation
-	 * will be done by OSI code any way
-	 */
-	/* total GCL enatry will have 32 valid bits */
-	unsigned int wid_val = OSI_MAX_32BITS;
+	/* total GCL entry will have 32 valid bits, gates above time field */
+	unsigned int wid = ether_tc_gcl_width(pdata);
+	unsigned int depth = ether_tc_gcl_depth(pdata);
+	unsigned int preempt_mask = 0x0U;
 	unsigned int gates = 0x0U;
-	/* time is 24 bit long */
-	unsigned int wid = 24U;
-	struct timespec64 time;
+	u64 base_time, gcl;
 	unsigned long ctr;
 	int i, ret = 0;
 
@@ -35,8 +113,10 @@ int ether_tc_setup_taprio(struct ether_priv_data *pdata,
 		goto done;
 	}
 
-	if (qopt->num_entries >= OSI_GCL_SIZE_256) {
-		netdev_err(pdata->ndev, "invalid number of GCL entries\n");
+	if (qopt->num_entries > depth) {
+		netdev_err(pdata->ndev,
+			   "invalid number of GCL entries %zu, max %u\n",
+			   qopt->num_entries, depth);
 		ret = -ERANGE;
 		goto done;
 	}
@@ -100,6 +180,8 @@ int ether_tc_setup_taprio(struct ether_priv_data *pdata,
 			fpe_required = OSI_ENABLE;
 			break;
 		case TC_TAPRIO_CMD_SET_AND_RELEASE:
+			/* Queues opened in release window are preemptible */
+			preempt_mask |= (gates & ~OSI_BIT(0));
 			gates &= ~OSI_BIT(0);
 			fpe_required = OSI_ENABLE;
 			break;
@@ -109,20 +191,40 @@ int ether_tc_setup_taprio(struct ether_priv_data *pdata,
 			goto done;
 		}
 
-		tc_ioctl_data.est.gcl[i] = cycle_time | (gates << wid);
-		if (tc_ioctl_data.est.gcl[i] > wid_val) {
+		if (cycle_time >= BIT(wid)) {
+			netdev_err(pdata->ndev,
+				   "GCL[%d] interval %lu exceeds %u bit HW width\n",
+				   i, cycle_time, wid);
+			ret = -ERANGE;
+			goto done;
+		}
+
+		gcl = (u64)cycle_time | ((u64)gates << wid);
+		if (gcl > OSI_MAX_32BITS) {
 			netdev_err(pdata->ndev, "invalid GCL creation\n");
 			ret = -EINVAL;
 			goto done;
 		}
+		tc_ioctl_data.est.gcl[i] = (unsigned int)gcl;
 	}
 
-	/* Adjust for real system time TODO better to have
-	 * some offset to avoid BTRE
+	if ((qopt->cycle_time_extension < 0) ||
+	    (qopt->cycle_time_extension > qopt->cycle_time) ||
+	    (qopt->cycle_time_extension >= BIT(wid))) {
+		netdev_err(pdata->ndev, "invalid cycle time extension\n");
+		ret = -ERANGE;
+		goto done;
+	}
+	/* Last entry of a cycle can be stretched by TER nsec to avoid
+	 * a short trailing entry when schedule changes
 	 */
-	time = ktime_to_timespec64(qopt->base_time);
-	tc_ioctl_data.est.btr[0] = (unsigned int)time.tv_nsec;
-	tc_ioctl_data.est.btr[1] = (unsigned int)time.tv_sec;
+	tc_ioctl_data.est.ter = (unsigned int)qopt->cycle_time_extension;
+
+	base_time = ether_tc_adjust_base_time(pdata, (u64)qopt->base_time,
+					      (u64)qopt->cycle_time);
+	tc_ioctl_data.est.btr[0] = (unsigned int)do_div(base_time,
+							NSEC_PER_SEC);
+	tc_ioctl_data.est.btr[1] = (unsigned int)base_time;
 	tc_ioctl_data.est.btr_offset[0] = 0;
 	tc_ioctl_data.est.btr_offset[1] = 0;
 
@@ -138,7 +240,8 @@ int ether_tc_setup_taprio(struct ether_priv_data *pdata,
 
 	if (fpe_required == OSI_ENABLE) {
 		tc_ioctl_data.fpe.rq = osi_core->residual_queue;
-		tc_ioctl_data.fpe.tx_queue_preemption_enable = 0x1;
+		tc_ioctl_data.fpe.tx_queue_preemption_enable =
+			(preempt_mask != 0U) ? preempt_mask : 0x1;
 		tc_ioctl_data.cmd = OSI_CMD_CONFIG_FPE;
 		ret = osi_handle_ioctl(osi_core, &tc_ioctl_data);
 		if (ret < 0) {
@@ -256,3 +359,48 @@ int ether_tc_setup_cbs(struct ether_priv_data *pdata,
 
 	return osi_handle_ioctl(osi_core, &ioctl_data);
 }
+
+void ether_tsn_lat_update(struct ether_priv_data *pdata,
+			  struct sk_buff *skb, u64 hw_ns)
+{
+	struct ether_tsn_lat *lat;
+	unsigned long flags;
+	s64 delta;
+	int tc;
+
+	if (READ_ONCE(pdata->tsn_validation) != OSI_ENABLE) {
+		return;
+	}
+
+	delta = (s64)hw_ns - ktime_to_ns(ETHER_SKB_CB(skb)->xmit_tai);
+	tc = netdev_txq_to_tc(pdata->ndev, skb_get_queue_mapping(skb));
+	if ((tc < 0) || (tc >= (int)ETHER_TSN_MAX_TC)) {
+		tc = 0;
+	}
+
+	spin_lock_irqsave(&pdata->tsn_lat_lock, flags);
+	if (delta < 0) {
+		pdata->tsn_lat_unsync_n++;
+	} else {
+		lat = &pdata->tsn_lat[tc];
+		if ((lat->samples == 0U) || ((u64)delta < lat->min_ns)) {
+			lat->min_ns = (u64)delta;
+		}
+		if ((u64)delta > lat->max_ns) {
+			lat->max_ns = (u64)delta;
+		}
+		lat->sum_ns += (u64)delta;
+		lat->samples++;
+	}
+	spin_unlock_irqrestore(&pdata->tsn_lat_lock, flags);
+}
+
+void ether_tsn_lat_reset(struct ether_priv_data *pdata)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pdata->tsn_lat_lock, flags);
+	memset(pdata->tsn_lat, 0, sizeof(pdata->tsn_lat));
+	pdata->tsn_lat_unsync_n = 0;
+	spin_unlock_irqrestore(&pdata->tsn_lat_lock, flags);
+}
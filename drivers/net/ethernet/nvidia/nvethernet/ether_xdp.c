@@ -0,0 +1,396 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/* Copyright (c) 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved */
+
+#include "ether_linux.h"
+
+#ifdef ETHER_XDP
+/**
+ * @brief ether_xdp_chan_to_qinx - Get netdev queue index for DMA channel
+ *
+ * @param[in] osi_dma: OSI DMA private data.
+ * @param[in] chan: DMA channel number.
+ *
+ * @retval netdev queue index
+ */
+static inline unsigned int ether_xdp_chan_to_qinx(struct osi_dma_priv_data *osi_dma,
+						  unsigned int chan)
+{
+	unsigned int i;
+
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		if (osi_dma->dma_chans[i] == chan) {
+			return i;
+		}
+	}
+
+	return 0U;
+}
+
+/**
+ * @brief ether_xdp_swcx_to_tx_napi - Get Tx NAPI owning a Tx SW context
+ *
+ * Algorithm: Tx completion callback does not carry the channel for XDP
+ * frames (no skb queue mapping), so find the ring whose swcx array
+ * contains the given entry.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] swcx: Tx software context of completed descriptor.
+ *
+ * @retval Tx NAPI instance on success
+ * @retval NULL if swcx does not belong to any enabled Tx ring
+ */
+static struct ether_tx_napi *
+ether_xdp_swcx_to_tx_napi(struct ether_priv_data *pdata,
+			  const struct osi_tx_swcx *swcx)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct osi_tx_ring *tx_ring;
+	unsigned int i, chan;
+
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		tx_ring = osi_dma->tx_ring[chan];
+		if (tx_ring != NULL && swcx >= tx_ring->tx_swcx &&
+		    swcx < tx_ring->tx_swcx + osi_dma->tx_ring_sz) {
+			return pdata->tx_napi[chan];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief ether_xdp_tx_timer_arm - Arm Tx SW coalesce timer.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] chan: Tx DMA channel number.
+ */
+static inline void ether_xdp_tx_timer_arm(struct ether_priv_data *pdata,
+					  unsigned int chan)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+
+	if (osi_dma->use_tx_usecs == OSI_ENABLE &&
+	    atomic_read(&pdata->tx_napi[chan]->tx_usecs_timer_armed) ==
+			OSI_DISABLE) {
+		atomic_set(&pdata->tx_napi[chan]->tx_usecs_timer_armed,
+			   OSI_ENABLE);
+		hrtimer_start(&pdata->tx_napi[chan]->tx_usecs_timer,
+			      pdata->tx_napi[chan]->tx_usecs * NSEC_PER_USEC,
+			      HRTIMER_MODE_REL);
+	}
+}
+
+/**
+ * @brief ether_xdp_xmit_frame - Post one XDP frame on a Tx ring.
+ *
+ * Algorithm:
+ * 1) Map (ndo_xdp_xmit) or sync (XDP_TX, page pool backed) frame buffer.
+ * 2) Fill single Tx software context and packet context.
+ * 3) Invoke OSI for data transmission.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] chan: Tx DMA channel number.
+ * @param[in] xdpf: XDP frame.
+ * @param[in] dma_map: true if frame buffer needs to be DMA mapped.
+ *
+ * @note Caller must hold netdev Tx queue lock of the channel.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_xdp_xmit_frame(struct ether_priv_data *pdata,
+				unsigned int chan, struct xdp_frame *xdpf,
+				bool dma_map)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct osi_tx_ring *tx_ring = osi_dma->tx_ring[chan];
+	struct osi_tx_pkt_cx *tx_pkt_cx = &tx_ring->tx_pkt_cx;
+	struct osi_tx_swcx *tx_swcx = tx_ring->tx_swcx + tx_ring->cur_tx_idx;
+	unsigned long type = ETHER_TX_BUF_XDP_TX;
+	dma_addr_t dma_addr;
+	int ret;
+
+	if (ether_avail_txdesc_cnt(osi_dma, tx_ring) <=
+	    ETHER_TX_DESC_THRESHOLD || tx_swcx->len) {
+		return -EBUSY;
+	}
+
+	if (dma_map) {
+		dma_addr = dma_map_single(pdata->dev, xdpf->data, xdpf->len,
+					  DMA_TO_DEVICE);
+		if (unlikely(dma_mapping_error(pdata->dev, dma_addr))) {
+			return -ENOMEM;
+		}
+		type = ETHER_TX_BUF_XDP_NDO;
+	} else {
+		dma_addr = page_pool_get_dma_addr(virt_to_page(xdpf->data)) +
+			   sizeof(*xdpf) + xdpf->headroom;
+		dma_sync_single_for_device(pdata->dev, dma_addr, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+	}
+
+	memset(tx_pkt_cx, 0, sizeof(*tx_pkt_cx));
+	tx_pkt_cx->flags |= OSI_PKT_CX_LEN;
+	tx_pkt_cx->payload_len = xdpf->len;
+	tx_pkt_cx->desc_cnt = 1;
+
+	tx_swcx->buf_phy_addr = dma_addr;
+	tx_swcx->flags &= ~OSI_PKT_CX_PAGED_BUF;
+	tx_swcx->len = xdpf->len;
+	tx_swcx->buf_virt_addr = (void *)((unsigned long)xdpf | type);
+
+	ret = osi_hw_transmit(osi_dma, chan);
+	if (unlikely(ret < 0)) {
+		if (dma_map) {
+			dma_unmap_single(pdata->dev, dma_addr, xdpf->len,
+					 DMA_TO_DEVICE);
+		}
+		tx_swcx->buf_virt_addr = NULL;
+		tx_swcx->buf_phy_addr = 0;
+		tx_swcx->len = 0;
+		tx_swcx->flags = 0;
+		return ret;
+	}
+
+	pdata->xstats.tx_doorbell_n[chan] =
+		osi_update_stats_counter(pdata->xstats.tx_doorbell_n[chan], 1U);
+
+	return 0;
+}
+
+/**
+ * @brief ether_xdp_tx_back - Transmit XDP_TX frame on the Rx channel.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] chan: Rx DMA channel number.
+ * @param[in] xdp: XDP buffer.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_xdp_tx_back(struct ether_priv_data *pdata, unsigned int chan,
+			     struct xdp_buff *xdp)
+{
+	struct xdp_frame *xdpf = xdp_convert_buff_to_frame(xdp);
+	struct netdev_queue *txq;
+	int ret;
+
+	if (unlikely(!xdpf)) {
+		return -EOVERFLOW;
+	}
+
+	txq = netdev_get_tx_queue(pdata->ndev,
+				  ether_xdp_chan_to_qinx(pdata->osi_dma, chan));
+
+	__netif_tx_lock(txq, smp_processor_id());
+	ret = ether_xdp_xmit_frame(pdata, chan, xdpf, false);
+	__netif_tx_unlock(txq);
+
+	if (ret == 0) {
+		ether_xdp_tx_timer_arm(pdata, chan);
+	}
+
+	return ret;
+}
+
+unsigned int ether_xdp_run_rx(struct ether_priv_data *pdata,
+			      struct bpf_prog *prog, unsigned int chan,
+			      struct page *page, void **data,
+			      unsigned int *len)
+{
+	struct ether_rx_napi *rx_napi = pdata->rx_napi[chan];
+	struct ether_xtra_stat_counters *xstats = &pdata->xstats;
+	struct xdp_buff xdp;
+	unsigned int ret = ETHER_XDP_CONSUMED;
+	u32 act;
+
+	xdp_init_buff(&xdp, PAGE_SIZE, &rx_napi->xdp_rxq);
+	xdp_prepare_buff(&xdp, page_address(page), pdata->rx_headroom,
+			 *len, false);
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		*data = xdp.data;
+		*len = xdp.data_end - xdp.data;
+		xstats->rx_xdp_pass_n[chan] =
+			osi_update_stats_counter(xstats->rx_xdp_pass_n[chan],
+						 1UL);
+		return ETHER_XDP_PASS;
+	case XDP_TX:
+		if (ether_xdp_tx_back(pdata, chan, &xdp) < 0) {
+			goto drop;
+		}
+		xstats->rx_xdp_tx_n[chan] =
+			osi_update_stats_counter(xstats->rx_xdp_tx_n[chan],
+						 1UL);
+		ret = ETHER_XDP_TX;
+		break;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(pdata->ndev, &xdp, prog) < 0) {
+			goto drop;
+		}
+		xstats->rx_xdp_redirect_n[chan] =
+			osi_update_stats_counter(xstats->rx_xdp_redirect_n[chan],
+						 1UL);
+		ret = ETHER_XDP_REDIRECT;
+		break;
+	default:
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+		bpf_warn_invalid_xdp_action(pdata->ndev, prog, act);
+#else
+		bpf_warn_invalid_xdp_action(act);
+#endif
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(pdata->ndev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		goto drop;
+	}
+
+	rx_napi->xdp_status |= ret;
+	return ret;
+
+drop:
+	xstats->rx_xdp_drop_n[chan] =
+		osi_update_stats_counter(xstats->rx_xdp_drop_n[chan], 1UL);
+	page_pool_recycle_direct(pdata->page_pool[chan], page);
+	return ETHER_XDP_CONSUMED;
+}
+
+void ether_xdp_rx_flush(struct ether_rx_napi *rx_napi)
+{
+	if ((rx_napi->xdp_status & ETHER_XDP_REDIRECT) == ETHER_XDP_REDIRECT) {
+		xdp_do_flush();
+	}
+
+	rx_napi->xdp_status = 0U;
+}
+
+bool ether_xdp_tx_complete(struct ether_priv_data *pdata,
+			   const struct osi_tx_swcx *swcx)
+{
+	unsigned long buf = (unsigned long)swcx->buf_virt_addr;
+	unsigned long type = buf & ETHER_TX_BUF_XDP_MASK;
+	struct ether_tx_napi *tx_napi;
+	struct xdp_frame *xdpf;
+
+	if (likely(type == 0UL)) {
+		return false;
+	}
+
+	xdpf = (struct xdp_frame *)(buf & ~ETHER_TX_BUF_XDP_MASK);
+	if (type == ETHER_TX_BUF_XDP_NDO && swcx->buf_phy_addr != 0UL) {
+		dma_unmap_single(pdata->dev, swcx->buf_phy_addr, swcx->len,
+				 DMA_TO_DEVICE);
+	}
+
+	tx_napi = ether_xdp_swcx_to_tx_napi(pdata, swcx);
+	if (likely(tx_napi != NULL)) {
+		u64_stats_update_begin(&tx_napi->stats.syncp);
+		tx_napi->stats.packets++;
+		tx_napi->stats.bytes += xdpf->len;
+		u64_stats_update_end(&tx_napi->stats.syncp);
+	}
+
+	xdp_return_frame(xdpf);
+
+	return true;
+}
+
+void ether_xdp_tx_wake(struct ether_priv_data *pdata, unsigned int chan)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct netdev_queue *txq;
+
+	txq = netdev_get_tx_queue(pdata->ndev,
+				  ether_xdp_chan_to_qinx(osi_dma, chan));
+	if (netif_tx_queue_stopped(txq) &&
+	    (ether_avail_txdesc_cnt(osi_dma, osi_dma->tx_ring[chan]) >
+	     ETHER_TX_DESC_THRESHOLD)) {
+		netif_tx_wake_queue(txq);
+	}
+}
+
+int ether_xdp_xmit(struct net_device *ndev, int num_frames,
+		   struct xdp_frame **frames, u32 flags)
+{
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	unsigned int cpu = smp_processor_id();
+	struct netdev_queue *txq;
+	unsigned int qinx, chan;
+	unsigned long val;
+	int i, nxmit = 0;
+
+	if (unlikely((flags & ~XDP_XMIT_FLAGS_MASK) != 0U)) {
+		return -EINVAL;
+	}
+
+	if (unlikely(!netif_running(ndev) || !netif_carrier_ok(ndev))) {
+		return -ENETDOWN;
+	}
+
+	qinx = cpu % osi_dma->num_dma_chans;
+	chan = osi_dma->dma_chans[qinx];
+	txq = netdev_get_tx_queue(ndev, qinx);
+
+	__netif_tx_lock(txq, cpu);
+	for (i = 0; i < num_frames; i++) {
+		if (ether_xdp_xmit_frame(pdata, chan, frames[i], true) < 0) {
+			break;
+		}
+		nxmit++;
+	}
+	__netif_tx_unlock(txq);
+
+	if (nxmit > 0) {
+		val = pdata->xstats.tx_xdp_xmit_n[chan];
+		pdata->xstats.tx_xdp_xmit_n[chan] =
+			osi_update_stats_counter(val, (unsigned long)nxmit);
+		ether_xdp_tx_timer_arm(pdata, chan);
+	}
+
+	return nxmit;
+}
+
+int ether_xdp_rxq_info_reg(struct ether_priv_data *pdata, unsigned int chan)
+{
+	struct ether_rx_napi *rx_napi = pdata->rx_napi[chan];
+	int ret;
+
+	ret = xdp_rxq_info_reg(&rx_napi->xdp_rxq, pdata->ndev, chan,
+			       rx_napi->napi.napi_id);
+	if (ret < 0) {
+		dev_err(pdata->dev, "failed to register XDP rxq info %u\n",
+			chan);
+		return ret;
+	}
+
+	ret = xdp_rxq_info_reg_mem_model(&rx_napi->xdp_rxq,
+					 MEM_TYPE_PAGE_POOL,
+					 pdata->page_pool[chan]);
+	if (ret < 0) {
+		dev_err(pdata->dev, "failed to register XDP mem model %u\n",
+			chan);
+		xdp_rxq_info_unreg(&rx_napi->xdp_rxq);
+		return ret;
+	}
+
+	rx_napi->xdp_status = 0U;
+
+	return 0;
+}
+
+void ether_xdp_rxq_info_unreg(struct ether_priv_data *pdata,
+			      unsigned int chan)
+{
+	struct ether_rx_napi *rx_napi = pdata->rx_napi[chan];
+
+	if (rx_napi && xdp_rxq_info_is_reg(&rx_napi->xdp_rxq)) {
+		xdp_rxq_info_unreg(&rx_napi->xdp_rxq);
+	}
+}
+#endif /* ETHER_XDP */
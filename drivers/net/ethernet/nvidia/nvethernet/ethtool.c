@@ -198,6 +198,228 @@ static const struct ether_stats ether_gstrings_stats[] = {
 	ETHER_EXTRA_STAT(rx_normal_irq_n[9]),
 	ETHER_EXTRA_STAT(link_disconnect_count),
 	ETHER_EXTRA_STAT(link_connect_count),
+	ETHER_EXTRA_STAT(tx_doorbell_n[0]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[1]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[2]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[3]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[4]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[5]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[6]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[7]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[8]),
+	ETHER_EXTRA_STAT(tx_doorbell_n[9]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[0]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[1]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[2]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[3]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[4]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[5]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[6]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[7]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[8]),
+	ETHER_EXTRA_STAT(tx_xmit_more_n[9]),
+#ifdef ETHER_XDP
+
+	/* XDP verdicts per Rx channel and ndo_xdp_xmit per Tx channel */
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[0]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[1]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[2]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[3]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[4]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[5]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[6]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[7]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[8]),
+	ETHER_EXTRA_STAT(rx_xdp_pass_n[9]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[0]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[1]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[2]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[3]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[4]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[5]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[6]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[7]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[8]),
+	ETHER_EXTRA_STAT(rx_xdp_drop_n[9]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[0]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[1]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[2]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[3]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[4]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[5]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[6]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[7]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[8]),
+	ETHER_EXTRA_STAT(rx_xdp_tx_n[9]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[0]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[1]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[2]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[3]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[4]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[5]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[6]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[7]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[8]),
+	ETHER_EXTRA_STAT(rx_xdp_redirect_n[9]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[0]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[1]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[2]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[3]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[4]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[5]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[6]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[7]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[8]),
+	ETHER_EXTRA_STAT(tx_xdp_xmit_n[9]),
+#endif /* ETHER_XDP */
+#ifdef ETHER_RX_HDR_SPLIT
+	ETHER_EXTRA_STAT(rx_hdr_split_n[0]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[1]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[2]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[3]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[4]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[5]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[6]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[7]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[8]),
+	ETHER_EXTRA_STAT(rx_hdr_split_n[9]),
+#endif /* ETHER_RX_HDR_SPLIT */
+#ifdef ETHER_PAGE_POOL
+	ETHER_EXTRA_STAT(rx_refill_n[0]),
+	ETHER_EXTRA_STAT(rx_refill_n[1]),
+	ETHER_EXTRA_STAT(rx_refill_n[2]),
+	ETHER_EXTRA_STAT(rx_refill_n[3]),
+	ETHER_EXTRA_STAT(rx_refill_n[4]),
+	ETHER_EXTRA_STAT(rx_refill_n[5]),
+	ETHER_EXTRA_STAT(rx_refill_n[6]),
+	ETHER_EXTRA_STAT(rx_refill_n[7]),
+	ETHER_EXTRA_STAT(rx_refill_n[8]),
+	ETHER_EXTRA_STAT(rx_refill_n[9]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[0]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[1]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[2]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[3]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[4]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[5]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[6]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[7]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[8]),
+	ETHER_EXTRA_STAT(rx_refill_buf_n[9]),
+#endif /* ETHER_PAGE_POOL */
+#ifdef ETHER_PAGE_POOL_STATS
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[0]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[1]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[2]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[3]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[4]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[5]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[6]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[7]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[8]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_fast[9]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[0]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[1]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[2]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[3]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[4]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[5]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[6]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[7]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[8]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow[9]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[0]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[1]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[2]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[3]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[4]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[5]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[6]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[7]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[8]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_slow_ho[9]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[0]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[1]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[2]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[3]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[4]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[5]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[6]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[7]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[8]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_empty[9]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[0]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[1]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[2]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[3]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[4]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[5]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[6]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[7]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[8]),
+	ETHER_EXTRA_STAT(rx_pp_alloc_refill[9]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[0]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[1]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[2]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[3]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[4]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[5]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[6]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[7]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[8]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_cached[9]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[0]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[1]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[2]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[3]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[4]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[5]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[6]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[7]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[8]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring[9]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[0]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[1]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[2]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[3]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[4]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[5]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[6]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[7]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[8]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_ring_full[9]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[0]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[1]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[2]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[3]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[4]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[5]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[6]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[7]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[8]),
+	ETHER_EXTRA_STAT(rx_pp_recycle_released[9]),
+#endif /* ETHER_PAGE_POOL_STATS */
+#ifdef ETHER_DIM
+	ETHER_EXTRA_STAT(rx_dim_usecs[0]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[1]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[2]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[3]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[4]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[5]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[6]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[7]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[8]),
+	ETHER_EXTRA_STAT(rx_dim_usecs[9]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[0]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[1]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[2]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[3]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[4]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[5]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[6]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[7]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[8]),
+	ETHER_EXTRA_STAT(tx_dim_usecs[9]),
+#endif /* ETHER_DIM */
 };
 
 /**
@@ -486,6 +708,47 @@ static const struct ether_stats ether_tstrings_stats[] = {
 #endif /* OSI_STRIPPED_LIB */
 };
 
+#ifdef ETHER_PAGE_POOL_STATS
+/**
+ * @brief Snapshot per channel page pool counters into extra stats.
+ *
+ * @param[in] pdata: OSD private data.
+ */
+static void ether_update_page_pool_stats(struct ether_priv_data *pdata)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct ether_xtra_stat_counters *xstats = &pdata->xstats;
+	struct page_pool_stats pp_stats;
+	unsigned int i, chan;
+
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		if (pdata->page_pool[chan] == NULL) {
+			continue;
+		}
+
+		memset(&pp_stats, 0, sizeof(pp_stats));
+		if (!page_pool_get_stats(pdata->page_pool[chan], &pp_stats)) {
+			continue;
+		}
+
+		xstats->rx_pp_alloc_fast[chan] = pp_stats.alloc_stats.fast;
+		xstats->rx_pp_alloc_slow[chan] = pp_stats.alloc_stats.slow;
+		xstats->rx_pp_alloc_slow_ho[chan] =
+			pp_stats.alloc_stats.slow_high_order;
+		xstats->rx_pp_alloc_empty[chan] = pp_stats.alloc_stats.empty;
+		xstats->rx_pp_alloc_refill[chan] = pp_stats.alloc_stats.refill;
+		xstats->rx_pp_recycle_cached[chan] =
+			pp_stats.recycle_stats.cached;
+		xstats->rx_pp_recycle_ring[chan] = pp_stats.recycle_stats.ring;
+		xstats->rx_pp_recycle_ring_full[chan] =
+			pp_stats.recycle_stats.ring_full;
+		xstats->rx_pp_recycle_released[chan] =
+			pp_stats.recycle_stats.released_refcnt;
+	}
+}
+#endif /* ETHER_PAGE_POOL_STATS */
+
 /**
  * @brief This function is invoked by kernel when user requests to get the
  *  extended statistics about the device.
@@ -507,7 +770,6 @@ static void ether_get_ethtool_stats(struct net_device *dev,
 #ifndef OSI_STRIPPED_LIB
 	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
 #endif /* OSI_STRIPPED_LIB */
-	struct osi_ioctl ioctl_data = {};
 	int i, j = 0;
 	int ret;
 
@@ -517,23 +779,15 @@ static void ether_get_ethtool_stats(struct net_device *dev,
 	}
 
 	if (pdata->hw_feat.mmc_sel == 1U) {
-		ioctl_data.cmd = OSI_CMD_READ_MMC;
-		ret = osi_handle_ioctl(osi_core, &ioctl_data);
+		if (osi_core->use_virtualization == OSI_ENABLE)
+			ret = ether_vm_read_stats(pdata);
+		else
+			ret = ether_read_mmc(pdata);
 		if (ret == -1) {
 			dev_err(pdata->dev, "Error in reading MMC counter\n");
 			return;
 		}
 
-		if (osi_core->use_virtualization == OSI_ENABLE) {
-			ioctl_data.cmd = OSI_CMD_READ_STATS;
-			ret = osi_handle_ioctl(osi_core, &ioctl_data);
-			if (ret == -1) {
-				dev_err(pdata->dev,
-					"Fail to read core stats\n");
-				return;
-			}
-		}
-
 		for (i = 0; i < ETHER_MMC_STATS_LEN; i++) {
 			char *p = (char *)osi_core + ether_mmc[i].stat_offset;
 
@@ -542,6 +796,9 @@ static void ether_get_ethtool_stats(struct net_device *dev,
 				     (*(u32 *)p);
 		}
 
+#ifdef ETHER_PAGE_POOL_STATS
+		ether_update_page_pool_stats(pdata);
+#endif /* ETHER_PAGE_POOL_STATS */
 		for (i = 0; i < ETHER_EXTRA_STAT_LEN; i++) {
 			char *p = (char *)pdata +
 				  ether_gstrings_stats[i].stat_offset;
@@ -587,6 +844,19 @@ static void ether_get_ethtool_stats(struct net_device *dev,
 	}
 }
 
+/**
+ * @brief Driver private flag names, indexed by ETHER_PRIV_FLAG bit position
+ */
+static const char ether_priv_flags_strings[][ETH_GSTRING_LEN] = {
+	"rx-hdr-split",
+	"tsn-validation",
+};
+
+/**
+ * @brief Driver private flags count
+ */
+#define ETHER_PRIV_FLAGS_LEN ARRAY_SIZE(ether_priv_flags_strings)
+
 /**
  * @brief This function gets number of strings
  *
@@ -643,6 +913,8 @@ static int ether_get_sset_count(struct net_device *dev, int sset)
 		}
 	} else if (sset == ETH_SS_TEST) {
 		len = ether_selftest_get_count(pdata);
+	} else if (sset == ETH_SS_PRIV_FLAGS) {
+		len = ETHER_PRIV_FLAGS_LEN;
 	} else {
 		len = -EOPNOTSUPP;
 	}
@@ -728,6 +1000,9 @@ static void ether_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 		}
 	} else if (stringset == (u32)ETH_SS_TEST) {
 		ether_selftest_get_strings(pdata, p);
+	} else if (stringset == (u32)ETH_SS_PRIV_FLAGS) {
+		memcpy(p, ether_priv_flags_strings,
+		       sizeof(ether_priv_flags_strings));
 	} else {
 		dev_err(pdata->dev, "%s() Unsupported stringset\n", __func__);
 	}
@@ -936,7 +1211,9 @@ static int ether_set_coalesce(struct net_device *dev,
 	/* Check for not supported parameters  */
 	if ((ec->rx_coalesce_usecs_irq) ||
 	    (ec->rx_max_coalesced_frames_irq) || (ec->tx_coalesce_usecs_irq) ||
+#ifndef ETHER_DIM
 	    (ec->use_adaptive_rx_coalesce) || (ec->use_adaptive_tx_coalesce) ||
+#endif /* !ETHER_DIM */
 	    (ec->pkt_rate_low) || (ec->rx_coalesce_usecs_low) ||
 	    (ec->rx_max_coalesced_frames_low) || (ec->tx_coalesce_usecs_high) ||
 	    (ec->tx_max_coalesced_frames_low) || (ec->pkt_rate_high) ||
@@ -1037,6 +1314,29 @@ static int ether_set_coalesce(struct net_device *dev,
 	netdev_err(dev, "RX COALESCING FRAMES is %s\n", osi_dma->use_rx_frames ?
 		   "ENABLED" : "DISABLED");
 
+#ifdef ETHER_DIM
+	/* Adaptive Tx moderation tunes the SW Tx timer period, so it needs
+	 * tx-usecs to be enabled.
+	 */
+	if (ec->use_adaptive_tx_coalesce &&
+	    osi_dma->use_tx_usecs == OSI_DISABLE) {
+		netdev_err(dev, "invalid settings : tx-usecs must be enabled"
+			   " along with adaptive-tx\n");
+		return -EINVAL;
+	}
+
+	pdata->use_rx_dim = ec->use_adaptive_rx_coalesce ?
+			    OSI_ENABLE : OSI_DISABLE;
+	pdata->use_tx_dim = ec->use_adaptive_tx_coalesce ?
+			    OSI_ENABLE : OSI_DISABLE;
+
+	netdev_err(dev, "RX ADAPTIVE COALESCING is %s\n", pdata->use_rx_dim ?
+		   "ENABLED" : "DISABLED");
+
+	netdev_err(dev, "TX ADAPTIVE COALESCING is %s\n", pdata->use_tx_dim ?
+		   "ENABLED" : "DISABLED");
+#endif /* ETHER_DIM */
+
 	osi_dma->rx_riwt = ec->rx_coalesce_usecs;
 	osi_dma->rx_frames = ec->rx_max_coalesced_frames;
 	osi_dma->tx_usecs = ec->tx_coalesce_usecs;
@@ -1077,6 +1377,10 @@ static int ether_get_coalesce(struct net_device *dev,
 	ec->rx_max_coalesced_frames = osi_dma->rx_frames;
 	ec->tx_coalesce_usecs = osi_dma->tx_usecs;
 	ec->tx_max_coalesced_frames = osi_dma->tx_frames;
+#ifdef ETHER_DIM
+	ec->use_adaptive_rx_coalesce = pdata->use_rx_dim;
+	ec->use_adaptive_tx_coalesce = pdata->use_tx_dim;
+#endif /* ETHER_DIM */
 
 	return 0;
 }
@@ -1431,14 +1735,289 @@ static void ether_get_wol(struct net_device *ndev, struct ethtool_wolinfo *wol)
 	phy_ethtool_get_wol(pdata->phydev, wol);
 }
 
+/**
+ * @brief Max ethtool ntuple rules supported by HW L3/L4 filters
+ *
+ * @param[in] pdata: OSD private data structure.
+ *
+ * @retval Number of ntuple rule locations
+ */
+static inline unsigned int ether_ntuple_max_rules(struct ether_priv_data *pdata)
+{
+	return min_t(unsigned int, pdata->hw_feat.l3l4_filter_num,
+		     ETHER_MAX_NTUPLE_RULES);
+}
+
+/**
+ * @brief Convert ethtool ntuple rule into OSI L3/L4 filter
+ *
+ * Algorithm: Only IPv4 TCP/UDP rules are supported. HW either matches
+ * complete address/port or ignores it, so each mask must be all ones
+ * or zero. Rule action is routing to the DMA channel of the Rx queue.
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] fs: ethtool flow spec.
+ * @param[out] filter: OSI L3/L4 filter to be filled.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_ntuple_to_l3l4(struct ether_priv_data *pdata,
+				const struct ethtool_rx_flow_spec *fs,
+				struct osi_l3_l4_filter *filter)
+{
+	const struct ethtool_tcpip4_spec *spec = &fs->h_u.tcp_ip4_spec;
+	const struct ethtool_tcpip4_spec *mask = &fs->m_u.tcp_ip4_spec;
+	unsigned int qinx = ethtool_get_flow_spec_ring(fs->ring_cookie);
+
+	memset(filter, 0, sizeof(*filter));
+
+	switch (fs->flow_type) {
+	case TCP_V4_FLOW:
+		filter->data.is_udp = OSI_FALSE;
+		break;
+	case UDP_V4_FLOW:
+		filter->data.is_udp = OSI_TRUE;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	if (fs->ring_cookie == RX_CLS_FLOW_DISC ||
+	    ethtool_get_flow_spec_ring_vf(fs->ring_cookie) != 0U ||
+	    mask->tos != 0U) {
+		return -EOPNOTSUPP;
+	}
+
+	if (qinx >= pdata->osi_core->num_mtl_queues) {
+		return -EINVAL;
+	}
+
+	if ((mask->ip4src != 0U && mask->ip4src != htonl(~0U)) ||
+	    (mask->ip4dst != 0U && mask->ip4dst != htonl(~0U)) ||
+	    (mask->psrc != 0U && mask->psrc != htons(U16_MAX)) ||
+	    (mask->pdst != 0U && mask->pdst != htons(U16_MAX))) {
+		netdev_err(pdata->ndev, "partial ntuple masks not supported\n");
+		return -EINVAL;
+	}
+
+	if (mask->ip4src == 0U && mask->ip4dst == 0U &&
+	    mask->psrc == 0U && mask->pdst == 0U) {
+		return -EINVAL;
+	}
+
+	filter->data.is_ipv6 = OSI_FALSE;
+	if (mask->ip4src != 0U) {
+		memcpy(filter->data.src.ip4_addr, &spec->ip4src,
+		       sizeof(filter->data.src.ip4_addr));
+		filter->data.src.addr_match = OSI_TRUE;
+	}
+	if (mask->ip4dst != 0U) {
+		memcpy(filter->data.dst.ip4_addr, &spec->ip4dst,
+		       sizeof(filter->data.dst.ip4_addr));
+		filter->data.dst.addr_match = OSI_TRUE;
+	}
+	if (mask->psrc != 0U) {
+		filter->data.src.port_no = ntohs(spec->psrc);
+		filter->data.src.port_match = OSI_TRUE;
+	}
+	if (mask->pdst != 0U) {
+		filter->data.dst.port_no = ntohs(spec->pdst);
+		filter->data.dst.port_match = OSI_TRUE;
+	}
+
+	filter->dma_routing_enable = OSI_TRUE;
+	filter->dma_chan = pdata->osi_dma->dma_chans[qinx];
+	filter->filter_no = fs->location;
+	filter->filter_enb_dis = OSI_TRUE;
+
+	return 0;
+}
+
+/**
+ * @brief Program or remove an ethtool ntuple rule in HW L3/L4 filter
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] fs: ethtool flow spec.
+ * @param[in] enable: OSI_ENABLE to program, OSI_DISABLE to remove.
+ *
+ * @note MAC needs to be initialized.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_ntuple_program(struct ether_priv_data *pdata,
+				const struct ethtool_rx_flow_spec *fs,
+				unsigned int enable)
+{
+	struct osi_ioctl ioctl_data = {};
+	int ret;
+
+	ret = ether_ntuple_to_l3l4(pdata, fs, &ioctl_data.l3l4_filter);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (enable == OSI_DISABLE) {
+		ioctl_data.l3l4_filter.filter_enb_dis = OSI_FALSE;
+		ioctl_data.l3l4_filter.dma_routing_enable = OSI_FALSE;
+	}
+
+	ioctl_data.cmd = OSI_CMD_L3L4_FILTER;
+	return osi_handle_ioctl(pdata->osi_core, &ioctl_data);
+}
+
+void ether_ntuple_restore(struct ether_priv_data *pdata)
+{
+	unsigned int loc;
+
+	for_each_set_bit(loc, pdata->ntuple_valid, ETHER_MAX_NTUPLE_RULES) {
+		if (ether_ntuple_program(pdata, &pdata->ntuple_rules[loc],
+					 OSI_ENABLE) < 0) {
+			netdev_err(pdata->ndev,
+				   "failed to restore ntuple rule %u\n", loc);
+			clear_bit(loc, pdata->ntuple_valid);
+		}
+	}
+}
+
+void ether_ntuple_flush(struct ether_priv_data *pdata)
+{
+	unsigned int loc;
+
+	for_each_set_bit(loc, pdata->ntuple_valid, ETHER_MAX_NTUPLE_RULES) {
+		if (netif_running(pdata->ndev)) {
+			(void)ether_ntuple_program(pdata,
+						   &pdata->ntuple_rules[loc],
+						   OSI_DISABLE);
+		}
+		clear_bit(loc, pdata->ntuple_valid);
+	}
+}
+
+/**
+ * @brief Insert ethtool ntuple rule
+ *
+ * Algorithm: Rule is stored in driver and programmed in HW if interface
+ * is up. Stored rules are reprogrammed on every interface up since MAC
+ * reset clears L3/L4 filters.
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] fs: ethtool flow spec.
+ *
+ * @note Filters configured through EQOS_L3L4_FILTER_CMD private ioctl
+ * share the same HW filter numbers.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_ntuple_insert(struct ether_priv_data *pdata,
+			       struct ethtool_rx_flow_spec *fs)
+{
+	struct osi_l3_l4_filter filter;
+	int ret;
+
+	if ((pdata->ndev->features & NETIF_F_NTUPLE) != NETIF_F_NTUPLE) {
+		return -EOPNOTSUPP;
+	}
+
+	if (fs->location >= ether_ntuple_max_rules(pdata)) {
+		return -EINVAL;
+	}
+
+	/* Validate before overwriting any existing rule */
+	ret = ether_ntuple_to_l3l4(pdata, fs, &filter);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (netif_running(pdata->ndev)) {
+		ret = ether_ntuple_program(pdata, fs, OSI_ENABLE);
+		if (ret < 0) {
+			netdev_err(pdata->ndev,
+				   "failed to program ntuple rule %u\n",
+				   fs->location);
+			return ret;
+		}
+	}
+
+	pdata->ntuple_rules[fs->location] = *fs;
+	set_bit(fs->location, pdata->ntuple_valid);
+
+	return 0;
+}
+
+/**
+ * @brief Delete ethtool ntuple rule
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] loc: Rule location.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_ntuple_delete(struct ether_priv_data *pdata, unsigned int loc)
+{
+	int ret = 0;
+
+	if (loc >= ETHER_MAX_NTUPLE_RULES ||
+	    !test_bit(loc, pdata->ntuple_valid)) {
+		return -ENOENT;
+	}
+
+	if (netif_running(pdata->ndev)) {
+		ret = ether_ntuple_program(pdata, &pdata->ntuple_rules[loc],
+					   OSI_DISABLE);
+	}
+
+	if (ret == 0) {
+		clear_bit(loc, pdata->ntuple_valid);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Get RSS hash fields for a flow type
+ *
+ * Algorithm: MAC RSS hashes IP addresses for all IPv4/IPv6 packets and
+ * L4 ports in addition for TCP/UDP packets.
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] flow_type: ethtool flow type.
+ *
+ * @retval RXH_* bitmap of hashed fields
+ */
+static u64 ether_get_rss_hash_fields(struct ether_priv_data *pdata,
+				     u32 flow_type)
+{
+	if (pdata->osi_core->rss.enable == 0U) {
+		return 0;
+	}
+
+	switch (flow_type) {
+	case TCP_V4_FLOW:
+	case UDP_V4_FLOW:
+	case TCP_V6_FLOW:
+	case UDP_V6_FLOW:
+		return RXH_IP_SRC | RXH_IP_DST | RXH_L4_B_0_1 | RXH_L4_B_2_3;
+	case IPV4_FLOW:
+	case IPV6_FLOW:
+		return RXH_IP_SRC | RXH_IP_DST;
+	default:
+		return 0;
+	}
+}
+
 /**
  * @brief Get RX flow classification rules
  *
- * Algorithm: Returns RX flow classification rules.
+ * Algorithm: Returns number of Rx rings, RSS hash fields and ntuple
+ * rules programmed on L3/L4 filters.
  *
  * param[in] ndev: Pointer to net device structure.
  * param[in] rxnfc: Pointer to rxflow data
- * param[in] rule_locs: TBD
+ * param[out] rule_locs: Locations of ntuple rules for ETHTOOL_GRXCLSRLALL
  *
  * @note MAC and PHY need to be initialized.
  *
@@ -1451,11 +2030,40 @@ static int ether_get_rxnfc(struct net_device *ndev,
 {
 	struct ether_priv_data *pdata = netdev_priv(ndev);
 	struct osi_core_priv_data *osi_core = pdata->osi_core;
+	unsigned int loc, cnt = 0;
 
 	switch (rxnfc->cmd) {
 	case ETHTOOL_GRXRINGS:
 		rxnfc->data = osi_core->num_mtl_queues;
 		break;
+	case ETHTOOL_GRXFH:
+		rxnfc->data = ether_get_rss_hash_fields(pdata,
+							rxnfc->flow_type);
+		break;
+	case ETHTOOL_GRXCLSRLCNT:
+		rxnfc->rule_cnt = bitmap_weight(pdata->ntuple_valid,
+						ETHER_MAX_NTUPLE_RULES);
+		rxnfc->data = ether_ntuple_max_rules(pdata);
+		break;
+	case ETHTOOL_GRXCLSRULE:
+		loc = rxnfc->fs.location;
+		if (loc >= ETHER_MAX_NTUPLE_RULES ||
+		    !test_bit(loc, pdata->ntuple_valid)) {
+			return -ENOENT;
+		}
+		rxnfc->fs = pdata->ntuple_rules[loc];
+		break;
+	case ETHTOOL_GRXCLSRLALL:
+		for_each_set_bit(loc, pdata->ntuple_valid,
+				 ETHER_MAX_NTUPLE_RULES) {
+			if (cnt == rxnfc->rule_cnt) {
+				return -EMSGSIZE;
+			}
+			rule_locs[cnt++] = loc;
+		}
+		rxnfc->rule_cnt = cnt;
+		rxnfc->data = ether_ntuple_max_rules(pdata);
+		break;
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -1463,6 +2071,39 @@ static int ether_get_rxnfc(struct net_device *ndev,
 	return 0;
 }
 
+/**
+ * @brief Set RX flow classification rules
+ *
+ * Algorithm: Inserts/deletes ntuple rules on L3/L4 filters. RSS hash
+ * fields are fixed in HW, so only the current hash fields are accepted.
+ *
+ * param[in] ndev: Pointer to net device structure.
+ * param[in] rxnfc: Pointer to rxflow data
+ *
+ * @retval 0 on success
+ * @retval negative on failure
+ */
+static int ether_set_rxnfc(struct net_device *ndev,
+			   struct ethtool_rxnfc *rxnfc)
+{
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+
+	switch (rxnfc->cmd) {
+	case ETHTOOL_SRXFH:
+		if (rxnfc->data != ether_get_rss_hash_fields(pdata,
+							     rxnfc->flow_type)) {
+			return -EOPNOTSUPP;
+		}
+		return 0;
+	case ETHTOOL_SRXCLSRLINS:
+		return ether_ntuple_insert(pdata, &rxnfc->fs);
+	case ETHTOOL_SRXCLSRLDEL:
+		return ether_ntuple_delete(pdata, rxnfc->fs.location);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 /**
  * @brief Get the size of the RX flow hash key
  *
@@ -1569,15 +2210,14 @@ static int ether_set_rxfh(struct net_device *ndev, const u32 *indir,
 #endif
 	int i;
 
-	if (!netif_running(ndev)) {
-		netdev_err(pdata->ndev, "interface must be up\n");
-		return -ENODEV;
-	}
-
 	if ((hfunc != ETH_RSS_HASH_NO_CHANGE) && (hfunc != ETH_RSS_HASH_TOP))
 		return -EOPNOTSUPP;
 
 	if (indir) {
+		for (i = 0; i < ARRAY_SIZE(osi_core->rss.table); i++) {
+			if (indir[i] >= osi_core->num_mtl_queues)
+				return -EINVAL;
+		}
 		for (i = 0; i < ARRAY_SIZE(osi_core->rss.table); i++)
 			osi_core->rss.table[i] = indir[i];
 	}
@@ -1585,6 +2225,10 @@ static int ether_set_rxfh(struct net_device *ndev, const u32 *indir,
 	if (key)
 		memcpy(osi_core->rss.key, key, sizeof(osi_core->rss.key));
 
+	/* RSS table and key get programmed by MAC init on interface up */
+	if (!netif_running(ndev))
+		return 0;
+
 	ioctl_data.cmd = OSI_CMD_CONFIG_RSS;
 	return osi_handle_ioctl(pdata->osi_core, &ioctl_data);
 
@@ -1669,6 +2313,88 @@ static void ether_set_msglevel(struct net_device *ndev, u32 level)
 }
 #endif /* OSI_STRIPPED_LIB */
 
+/**
+ * @brief Get driver private flags
+ *
+ * @param[in] ndev: network device instance
+ *
+ * @retval Bitmap of enabled ETHER_PRIV_FLAG flags
+ */
+static u32 ether_get_priv_flags(struct net_device *ndev)
+{
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	u32 flags = 0U;
+
+#ifdef ETHER_RX_HDR_SPLIT
+	if (pdata->rx_hdr_split == OSI_ENABLE) {
+		flags |= ETHER_PRIV_FLAG_RX_HDR_SPLIT;
+	}
+#endif /* ETHER_RX_HDR_SPLIT */
+	if (pdata->tsn_validation == OSI_ENABLE) {
+		flags |= ETHER_PRIV_FLAG_TSN_VALIDATION;
+	}
+
+	return flags;
+}
+
+/**
+ * @brief Set driver private flags
+ *
+ * Algorithm: Rx header split only changes how Rx skbs are built from
+ * page pool pages, so it takes effect from the next received frame
+ * without interface restart. TSN validation mode HW timestamps every
+ * Tx frame from the next ndo_start_xmit, latency counters are cleared
+ * when it is enabled.
+ *
+ * @param[in] ndev: network device instance
+ * @param[in] flags: Bitmap of ETHER_PRIV_FLAG flags to be enabled
+ *
+ * @retval 0 on Success
+ * @retval "negative value" on failure.
+ */
+static int ether_set_priv_flags(struct net_device *ndev, u32 flags)
+{
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	u32 supported = ETHER_PRIV_FLAG_TSN_VALIDATION;
+	unsigned int tsn_validation;
+
+#ifdef ETHER_RX_HDR_SPLIT
+	supported |= ETHER_PRIV_FLAG_RX_HDR_SPLIT;
+#endif /* ETHER_RX_HDR_SPLIT */
+	if ((flags & ~supported) != 0U) {
+		return -EINVAL;
+	}
+
+#ifdef ETHER_RX_HDR_SPLIT
+	if (pdata->rx_hdr_split !=
+	    (((flags & ETHER_PRIV_FLAG_RX_HDR_SPLIT) != 0U) ?
+	     OSI_ENABLE : OSI_DISABLE)) {
+		WRITE_ONCE(pdata->rx_hdr_split,
+			   ((flags & ETHER_PRIV_FLAG_RX_HDR_SPLIT) != 0U) ?
+			   OSI_ENABLE : OSI_DISABLE);
+
+		netdev_info(ndev, "RX HEADER SPLIT is %s\n",
+			    (pdata->rx_hdr_split == OSI_ENABLE) ?
+			    "ENABLED" : "DISABLED");
+	}
+#endif /* ETHER_RX_HDR_SPLIT */
+
+	tsn_validation = ((flags & ETHER_PRIV_FLAG_TSN_VALIDATION) != 0U) ?
+			 OSI_ENABLE : OSI_DISABLE;
+	if (pdata->tsn_validation != tsn_validation) {
+		if (tsn_validation == OSI_ENABLE) {
+			ether_tsn_lat_reset(pdata);
+		}
+		WRITE_ONCE(pdata->tsn_validation, tsn_validation);
+
+		netdev_info(ndev, "TSN VALIDATION is %s\n",
+			    (tsn_validation == OSI_ENABLE) ?
+			    "ENABLED" : "DISABLED");
+	}
+
+	return 0;
+}
+
 /**
  * @brief Set of ethtool operations
  */
@@ -1681,14 +2407,21 @@ static const struct ethtool_ops ether_ethtool_ops = {
 	.get_ethtool_stats = ether_get_ethtool_stats,
 	.get_sset_count = ether_get_sset_count,
 	.get_coalesce = ether_get_coalesce,
+#ifdef ETHER_DIM
+	.supported_coalesce_params = (ETHTOOL_COALESCE_USECS |
+		ETHTOOL_COALESCE_MAX_FRAMES |
+		ETHTOOL_COALESCE_USE_ADAPTIVE),
+#else
 	.supported_coalesce_params = (ETHTOOL_COALESCE_USECS |
 		ETHTOOL_COALESCE_MAX_FRAMES),
+#endif /* ETHER_DIM */
 	.set_coalesce = ether_set_coalesce,
 #ifndef OSI_STRIPPED_LIB
 	.get_wol = ether_get_wol,
 	.set_wol = ether_set_wol,
 	.self_test = ether_selftest_run,
 	.get_rxnfc = ether_get_rxnfc,
+	.set_rxnfc = ether_set_rxnfc,
 	.get_pauseparam = ether_get_pauseparam,
 	.set_pauseparam = ether_set_pauseparam,
 	.get_eee = ether_get_eee,
@@ -1702,6 +2435,8 @@ static const struct ethtool_ops ether_ethtool_ops = {
 	.get_msglevel = ether_get_msglevel,
 	.set_msglevel = ether_set_msglevel,
 #endif /* OSI_STRIPPED_LIB */
+	.get_priv_flags = ether_get_priv_flags,
+	.set_priv_flags = ether_set_priv_flags,
 };
 
 void ether_set_ethtool_ops(struct net_device *ndev)
@@ -21,6 +21,10 @@ static int macsec_tz_kt_config(struct ether_priv_data *pdata,
 			unsigned char cmd,
 			struct osi_macsec_kt_config *const kt_config,
 			struct genl_info *const info, struct nvpkcs_data *pkcs);
+static int macsec_tz_kt_config_batch(struct ether_priv_data *pdata,
+				     struct macsec_batch_sa *batch,
+				     unsigned int cnt,
+				     struct genl_info *const info);
 #endif
 
 static irqreturn_t macsec_s_isr(int irq, void *data)
@@ -480,15 +484,11 @@ exit:
 	return ret;
 }
 
-static int parse_sa_config(struct nlattr **attrs, struct nlattr **tb_sa,
-			   struct osi_macsec_sc_info *sc_info,
-			   struct nvpkcs_data *pkcs)
+static int parse_sa_nest(const struct nlattr *nest, struct nlattr **tb_sa,
+			 struct osi_macsec_sc_info *sc_info,
+			 struct nvpkcs_data *pkcs)
 {
-	if (!attrs[NV_MACSEC_ATTR_SA_CONFIG])
-		return -EINVAL;
-
-	if (nla_parse_nested(tb_sa, NV_MACSEC_SA_ATTR_MAX,
-			     attrs[NV_MACSEC_ATTR_SA_CONFIG],
+	if (nla_parse_nested(tb_sa, NV_MACSEC_SA_ATTR_MAX, nest,
 			     nv_macsec_sa_genl_policy, NULL))
 		return -EINVAL;
 
@@ -525,6 +525,17 @@ static int parse_sa_config(struct nlattr **attrs, struct nlattr **tb_sa,
 	return 0;
 }
 
+static int parse_sa_config(struct nlattr **attrs, struct nlattr **tb_sa,
+			   struct osi_macsec_sc_info *sc_info,
+			   struct nvpkcs_data *pkcs)
+{
+	if (!attrs[NV_MACSEC_ATTR_SA_CONFIG])
+		return -EINVAL;
+
+	return parse_sa_nest(attrs[NV_MACSEC_ATTR_SA_CONFIG], tb_sa, sc_info,
+			     pkcs);
+}
+
 static int macsec_dis_rx_sa(struct sk_buff *skb, struct genl_info *info)
 {
 	struct nlattr **attrs = info->attrs;
@@ -1121,6 +1132,14 @@ static int macsec_init(struct sk_buff *skb, struct genl_info *info)
 		goto exit;
 	}
 	mutex_lock(&macsec_pdata->lock);
+#ifdef ETHER_MACSEC_OFFLOAD
+	if (macsec_pdata->offload_secy_cnt > 0U) {
+		ret = -EBUSY;
+		mutex_unlock(&macsec_pdata->lock);
+		dev_err(dev, "%s: MACsec offloaded by kernel MACsec", __func__);
+		goto exit;
+	}
+#endif /* ETHER_MACSEC_OFFLOAD */
 	/* only one supplicant is allowed per VF */
 	if (macsec_pdata->next_supp_idx >= MAX_SUPPLICANTS_ALLOWED) {
 		ret = -EPROTO;
@@ -1213,6 +1232,315 @@ exit:
 	return ret;
 }
 
+/**
+ * @brief macsec_create_sa_batch - Create multiple SAs in one request
+ *
+ * Algorithm:
+ * - Parse all NV_MACSEC_ATTR_SA_CONFIG nests of NV_MACSEC_ATTR_SA_LIST
+ *   (and generate HKeys) before touching HW.
+ * - Program all SAs under a single macsec lock hold, rolling back the
+ *   already programmed ones if any of them fails.
+ * - When keys are owned by TZ, return all key table entries in a single
+ *   genl reply.
+ *
+ * @param[in] skb: genl request buffer
+ * @param[in] info: Pointer to netlink msg structure
+ *
+ * @retval 0 on success
+ * @retval negative value on failure.
+ */
+static int macsec_create_sa_batch(struct sk_buff *skb, struct genl_info *info)
+{
+	struct nlattr **attrs = info->attrs;
+	struct macsec_priv_data *macsec_pdata;
+	struct ether_priv_data *pdata;
+	struct nlattr *tb_sa[NUM_NV_MACSEC_SA_ATTR];
+	struct macsec_batch_sa *batch = NULL;
+	struct device *dev = NULL;
+	struct nlattr *nest;
+	unsigned int cnt = 0U, i;
+	int rem, ret = 0;
+
+	PRINT_ENTRY();
+	macsec_pdata = genl_to_macsec_pdata(info);
+	if (macsec_pdata) {
+		pdata = macsec_pdata->ether_pdata;
+	} else {
+		ret = -EPROTO;
+		goto exit;
+	}
+	dev = pdata->dev;
+
+	if (!netif_running(pdata->ndev)) {
+		ret = -ENETDOWN;
+		dev_err(dev, "%s: MAC interface down!!\n", __func__);
+		goto exit;
+	}
+
+	if (!attrs[NV_MACSEC_ATTR_IFNAME] || !attrs[NV_MACSEC_ATTR_SA_LIST]) {
+		dev_err(dev, "%s: failed to parse nlattrs", __func__);
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	batch = kcalloc(NV_MACSEC_MAX_BATCH_SA, sizeof(*batch), GFP_KERNEL);
+	if (!batch) {
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	nla_for_each_nested(nest, attrs[NV_MACSEC_ATTR_SA_LIST], rem) {
+		struct macsec_batch_sa *sa;
+
+		if (nla_type(nest) != NV_MACSEC_ATTR_SA_CONFIG) {
+			continue;
+		}
+
+		if (cnt >= NV_MACSEC_MAX_BATCH_SA) {
+			dev_err(dev, "%s: more than %u SAs in batch\n",
+				__func__, NV_MACSEC_MAX_BATCH_SA);
+			ret = -E2BIG;
+			goto free_batch;
+		}
+
+		sa = &batch[cnt];
+		memset(tb_sa, 0, sizeof(tb_sa));
+		if (parse_sa_nest(nest, tb_sa, &sa->sc_info, &sa->pkcs)) {
+			dev_err(dev, "%s: failed to parse SA %u", __func__,
+				cnt);
+			ret = -EINVAL;
+			goto free_batch;
+		}
+
+		sa->ctlr = OSI_CTLR_SEL_TX;
+		if (tb_sa[NV_MACSEC_SA_ATTR_CTRL]) {
+			sa->ctlr = nla_get_u8(tb_sa[NV_MACSEC_SA_ATTR_CTRL]);
+		}
+		if (sa->ctlr != OSI_CTLR_SEL_TX && sa->ctlr != OSI_CTLR_SEL_RX) {
+			dev_err(dev, "%s: invalid controller %u for SA %u",
+				__func__, sa->ctlr, cnt);
+			ret = -EINVAL;
+			goto free_batch;
+		}
+
+		sa->sc_info.pn_window = macsec_pdata->pn_window;
+#ifdef MACSEC_KEY_PROGRAM
+		sa->sc_info.flags = OSI_CREATE_SA;
+		ret = hkey_generation(sa->sc_info.sak, sa->sc_info.hkey);
+		if (ret != 0) {
+			dev_err(dev, "%s: failed to Generate HKey", __func__);
+			ret = -EINVAL;
+			goto free_batch;
+		}
+#endif /* MACSEC_KEY_PROGRAM */
+		cnt++;
+	}
+
+	if (cnt == 0U) {
+		ret = -EINVAL;
+		goto free_batch;
+	}
+
+	mutex_lock(&macsec_pdata->lock);
+	for (i = 0; i < cnt; i++) {
+		ret = osi_macsec_config(pdata->osi_core, &batch[i].sc_info,
+					OSI_ENABLE, batch[i].ctlr,
+					&batch[i].kt_idx);
+		if (ret < 0) {
+			dev_err(dev, "%s: failed to create %s SA %u",
+				__func__, (batch[i].ctlr == OSI_CTLR_SEL_TX) ?
+				"Tx" : "Rx", i);
+			break;
+		}
+	}
+
+	if (ret < 0) {
+		/* Remove SAs of this batch which are already in HW */
+		while (i-- > 0U) {
+			if (osi_macsec_config(pdata->osi_core,
+					      &batch[i].sc_info, OSI_DISABLE,
+					      batch[i].ctlr,
+					      &batch[i].kt_idx) < 0) {
+				dev_err(dev, "%s: failed to rollback SA %u",
+					__func__, i);
+			}
+		}
+		mutex_unlock(&macsec_pdata->lock);
+		goto free_batch;
+	}
+	mutex_unlock(&macsec_pdata->lock);
+
+	dev_info(dev, "%s: created %u SAs\n", __func__, cnt);
+
+#ifndef MACSEC_KEY_PROGRAM
+	ret = macsec_tz_kt_config_batch(pdata, batch, cnt, info);
+	if (ret < 0) {
+		dev_err(dev, "%s: failed to program SAKs through TZ %d",
+			__func__, ret);
+	}
+#endif /* !MACSEC_KEY_PROGRAM */
+
+free_batch:
+	memzero_explicit(batch, NV_MACSEC_MAX_BATCH_SA * sizeof(*batch));
+	kfree(batch);
+exit:
+	PRINT_EXIT();
+	return ret;
+}
+
+/**
+ * @brief macsec_put_sc_stats - Add one SC index counters to genl msg
+ *
+ * @param[in] msg: genl reply message.
+ * @param[in] mmc: MACsec HW counters.
+ * @param[in] idx: SC index.
+ *
+ * @retval 0 on success
+ * @retval negative value on failure.
+ */
+static int macsec_put_sc_stats(struct sk_buff *msg,
+			       struct osi_macsec_mmc_counters *mmc,
+			       unsigned int idx)
+{
+	struct nlattr *nest;
+
+	nest = nla_nest_start(msg, NV_MACSEC_STATS_ATTR_SC);
+	if (!nest) {
+		return -EMSGSIZE;
+	}
+
+	if (nla_put_u32(msg, NV_MACSEC_STATS_ATTR_SC_INDEX, idx) ||
+	    nla_put_u64_64bit(msg, NV_MACSEC_STATS_ATTR_TX_PKTS_PROTECTED,
+			      mmc->tx_pkts_protected[idx],
+			      NV_MACSEC_STATS_ATTR_PAD) ||
+	    nla_put_u64_64bit(msg, NV_MACSEC_STATS_ATTR_RX_PKTS_OK,
+			      mmc->rx_pkts_ok[idx], NV_MACSEC_STATS_ATTR_PAD) ||
+	    nla_put_u64_64bit(msg, NV_MACSEC_STATS_ATTR_RX_PKTS_INVALID,
+			      mmc->in_pkts_invalid[idx],
+			      NV_MACSEC_STATS_ATTR_PAD) ||
+	    nla_put_u64_64bit(msg, NV_MACSEC_STATS_ATTR_RX_PKTS_DELAYED,
+			      mmc->rx_pkts_delayed[idx],
+			      NV_MACSEC_STATS_ATTR_PAD)) {
+		nla_nest_cancel(msg, nest);
+		return -EMSGSIZE;
+	}
+	nla_nest_end(msg, nest);
+
+	return 0;
+}
+
+/**
+ * @brief macsec_get_stats - Read all MACsec SC counters in one request
+ *
+ * Algorithm: Read HW counters once and return octet counters along with
+ * the counters of every SC index in use, so that supplicant does not need
+ * one sysfs read (and HW MMC read) per SA.
+ *
+ * @param[in] skb: genl request buffer
+ * @param[in] info: Pointer to netlink msg structure
+ *
+ * @retval 0 on success
+ * @retval negative value on failure.
+ */
+static int macsec_get_stats(struct sk_buff *skb, struct genl_info *info)
+{
+	struct nlattr **attrs = info->attrs;
+	struct macsec_priv_data *macsec_pdata;
+	struct osi_macsec_mmc_counters *mmc;
+	struct ether_priv_data *pdata;
+	struct device *dev = NULL;
+	struct sk_buff *msg;
+	struct nlattr *nest;
+	void *msg_head;
+	unsigned int i;
+	int ret = 0;
+
+	PRINT_ENTRY();
+	macsec_pdata = genl_to_macsec_pdata(info);
+	if (macsec_pdata) {
+		pdata = macsec_pdata->ether_pdata;
+	} else {
+		ret = -EPROTO;
+		goto exit;
+	}
+	dev = pdata->dev;
+	mmc = &pdata->osi_core->macsec_mmc;
+
+	if (!netif_running(pdata->ndev)) {
+		ret = -ENETDOWN;
+		dev_err(dev, "%s: MAC interface down!!\n", __func__);
+		goto exit;
+	}
+
+	if (!attrs[NV_MACSEC_ATTR_IFNAME]) {
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	msg = genlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
+	if (!msg) {
+		dev_err(dev, "Unable to alloc genl reply\n");
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	msg_head = genlmsg_put_reply(msg, info, &macsec_pdata->nv_macsec_fam, 0,
+				     NV_MACSEC_CMD_GET_STATS);
+	if (!msg_head) {
+		dev_err(dev, "unable to get replyhead\n");
+		ret = -EINVAL;
+		goto failure;
+	}
+
+	nest = nla_nest_start(msg, NV_MACSEC_ATTR_STATS);
+	if (!nest) {
+		ret = -EMSGSIZE;
+		goto failure;
+	}
+
+	mutex_lock(&macsec_pdata->lock);
+	osi_macsec_read_mmc(pdata->osi_core);
+	if (nla_put_u64_64bit(msg, NV_MACSEC_STATS_ATTR_TX_OCTETS_PROTECTED,
+			      mmc->tx_octets_protected,
+			      NV_MACSEC_STATS_ATTR_PAD) ||
+	    nla_put_u64_64bit(msg, NV_MACSEC_STATS_ATTR_RX_OCTETS_VALIDATED,
+			      mmc->rx_octets_validated,
+			      NV_MACSEC_STATS_ATTR_PAD)) {
+		ret = -EMSGSIZE;
+		goto err_unlock;
+	}
+
+	for (i = 0; i < OSI_MACSEC_SC_INDEX_MAX; i++) {
+		/* Skip SC indexes which never carried traffic */
+		if ((mmc->tx_pkts_protected[i] | mmc->rx_pkts_ok[i] |
+		     mmc->in_pkts_invalid[i] | mmc->rx_pkts_delayed[i]) == 0U) {
+			continue;
+		}
+
+		ret = macsec_put_sc_stats(msg, mmc, i);
+		if (ret < 0) {
+			goto err_unlock;
+		}
+	}
+	mutex_unlock(&macsec_pdata->lock);
+	nla_nest_end(msg, nest);
+
+	genlmsg_end(msg, msg_head);
+	ret = genlmsg_reply(msg, info);
+	if (ret != 0)
+		dev_err(dev, "Unable to send reply\n");
+
+	PRINT_EXIT();
+	return ret;
+err_unlock:
+	mutex_unlock(&macsec_pdata->lock);
+failure:
+	nlmsg_free(msg);
+exit:
+	PRINT_EXIT();
+	return ret;
+}
+
 static const struct genl_ops nv_macsec_genl_ops[] = {
 	{
 		.cmd = NV_MACSEC_CMD_INIT,
@@ -1269,55 +1597,613 @@ static const struct genl_ops nv_macsec_genl_ops[] = {
 		.doit = macsec_get_tx_next_pn,
 		.flags = GENL_ADMIN_PERM,
 	},
+	{
+		.cmd = NV_MACSEC_CMD_CREATE_SA_BATCH,
+		.doit = macsec_create_sa_batch,
+		.flags = GENL_ADMIN_PERM,
+	},
+	{
+		.cmd = NV_MACSEC_CMD_GET_STATS,
+		.doit = macsec_get_stats,
+		.flags = GENL_ADMIN_PERM,
+	},
 };
 
-void macsec_remove(struct ether_priv_data *pdata)
+#ifdef ETHER_MACSEC_OFFLOAD
+/**
+ * @brief ether_macsec_sci_to_osi - Convert upstream SCI to OSI SCI bytes
+ *
+ * @param[in] sci: SCI in network byte order.
+ * @param[out] osi_sci: SCI in OSI LUT byte order (LSB first).
+ */
+static void ether_macsec_sci_to_osi(sci_t sci, unsigned char *osi_sci)
 {
-	struct macsec_priv_data *macsec_pdata = NULL;
-	struct macsec_supplicant_data *supplicant = NULL;
-	int i;
-
-	PRINT_ENTRY();
-	macsec_pdata = pdata->macsec_pdata;
-	if (macsec_pdata) {
-		mutex_lock(&macsec_pdata->lock);
-		/* Delete if any supplicant active heartbeat timer */
-		supplicant = macsec_pdata->supplicant;
-		for (i = 0; i < OSI_MAX_NUM_SC; i++) {
-			if (supplicant[i].in_use == OSI_ENABLE) {
-				supplicant->snd_portid = OSI_NONE;
-				supplicant->in_use = OSI_NONE;
-			}
-		}
-		mutex_unlock(&macsec_pdata->lock);
-		/* if macsec_close() is not called by supplicant gracefully
-		 * close it now.
-		 */
-		if (atomic_read(&macsec_pdata->ref_count) > 0) {
-			macsec_close(macsec_pdata);
-		}
-
-		/* Unregister generic netlink */
-		if (macsec_pdata->is_nv_macsec_fam_registered == OSI_ENABLE) {
-			genl_unregister_family(&macsec_pdata->nv_macsec_fam);
-			macsec_pdata->is_nv_macsec_fam_registered = OSI_DISABLE;
-		}
+	u64 val = be64_to_cpu((__force __be64)sci);
+	unsigned int i;
 
-		/* Release platform resources */
-		macsec_release_platform_res(macsec_pdata);
-		/* free macsec priv */
-		devm_kfree(pdata->dev, macsec_pdata);
+	for (i = 0; i < OSI_SCI_LEN; i++) {
+		osi_sci[i] = (unsigned char)(val >> (8U * i));
 	}
-	PRINT_EXIT();
 }
 
-int macsec_probe(struct ether_priv_data *pdata)
+/**
+ * @brief ether_macsec_ctx_pdata - Get MACsec private data for mdo context
+ *
+ * @param[in] ctx: upstream MACsec offload context.
+ *
+ * @retval MACsec private data or NULL if MACsec is not probed.
+ */
+static struct macsec_priv_data *ether_macsec_ctx_pdata(struct macsec_context *ctx)
 {
-	struct device *dev = pdata->dev;
-	struct platform_device *pdev = to_platform_device(dev);
-	struct osi_core_priv_data *osi_core = pdata->osi_core;
-	struct macsec_priv_data *macsec_pdata = NULL;
-	struct resource *res = NULL;
+	struct ether_priv_data *pdata = netdev_priv(ctx->netdev);
+
+	return pdata->macsec_pdata;
+}
+
+/**
+ * @brief ether_macsec_sc_idx - Get HW SC index of an SCI
+ *
+ * @param[in] macsec_pdata: MACsec private data.
+ * @param[in] sci: SCI in network byte order.
+ * @param[in] ctlr: OSI_CTLR_SEL_TX or OSI_CTLR_SEL_RX.
+ *
+ * @retval SC index on success
+ * @retval negative value if SCI is not programmed.
+ */
+static int ether_macsec_sc_idx(struct macsec_priv_data *macsec_pdata,
+			       sci_t sci, unsigned short ctlr)
+{
+	struct ether_priv_data *pdata = macsec_pdata->ether_pdata;
+	unsigned char osi_sci[OSI_SCI_LEN];
+	unsigned int key_index = 0;
+	int ret;
+
+	ether_macsec_sci_to_osi(sci, osi_sci);
+	ret = osi_macsec_get_sc_lut_key_index(pdata->osi_core, osi_sci,
+					      &key_index, ctlr);
+	if (ret < 0) {
+		return ret;
+	}
+
+	key_index /= OSI_MAX_NUM_SA;
+	if (key_index >= OSI_MACSEC_SC_INDEX_MAX) {
+		return -ERANGE;
+	}
+
+	return (int)key_index;
+}
+
+/**
+ * @brief ether_macsec_sa_config - Program one SA for upstream offload
+ *
+ * @param[in] ctx: upstream MACsec offload context.
+ * @param[in] sci: SCI of the SC owning the SA.
+ * @param[in] ctlr: OSI_CTLR_SEL_TX or OSI_CTLR_SEL_RX.
+ * @param[in] next_pn: Next PN of the SA.
+ * @param[in] flags: OSI_CREATE_SA or OSI_ENABLE_SA, 0 to disable.
+ *
+ * @retval 0 on success
+ * @retval negative value on failure.
+ */
+static int ether_macsec_sa_config(struct macsec_context *ctx, sci_t sci,
+				  unsigned short ctlr, u32 next_pn,
+				  unsigned int flags)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	struct osi_macsec_sc_info sc_info = {0};
+	struct ether_priv_data *pdata;
+	unsigned short kt_idx;
+	int ret;
+
+	if (!macsec_pdata) {
+		return -EOPNOTSUPP;
+	}
+	pdata = macsec_pdata->ether_pdata;
+
+	ether_macsec_sci_to_osi(sci, sc_info.sci);
+	sc_info.curr_an = ctx->sa.assoc_num;
+	sc_info.next_pn = next_pn;
+	sc_info.lowest_pn = next_pn;
+	sc_info.pn_window = macsec_pdata->pn_window;
+	sc_info.flags = flags;
+
+	if (flags == OSI_CREATE_SA) {
+		memcpy(sc_info.sak, ctx->sa.key, ctx->secy->key_len);
+		ret = hkey_generation(sc_info.sak, sc_info.hkey);
+		if (ret != 0) {
+			ret = -EINVAL;
+			goto exit;
+		}
+	}
+
+	mutex_lock(&macsec_pdata->lock);
+	ret = osi_macsec_config(pdata->osi_core, &sc_info,
+				(flags != 0U) ? OSI_ENABLE : OSI_DISABLE,
+				ctlr, &kt_idx);
+	mutex_unlock(&macsec_pdata->lock);
+	if (ret < 0) {
+		netdev_err(ctx->netdev, "%s: failed to %s %s SA an %u\n",
+			   __func__, (flags != 0U) ? "enable" : "disable",
+			   (ctlr == OSI_CTLR_SEL_TX) ? "Tx" : "Rx",
+			   ctx->sa.assoc_num);
+		ret = -EIO;
+	}
+exit:
+	memzero_explicit(&sc_info, sizeof(sc_info));
+	return ret;
+}
+
+static int ether_macsec_mdo_dev_open(struct macsec_context *ctx)
+{
+	return 0;
+}
+
+static int ether_macsec_mdo_dev_stop(struct macsec_context *ctx)
+{
+	return 0;
+}
+
+static int ether_macsec_mdo_add_secy(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	const struct macsec_secy *secy = ctx->secy;
+	struct ether_priv_data *pdata;
+	unsigned int cipher;
+	int ret = 0;
+
+	if (!macsec_pdata) {
+		return -EOPNOTSUPP;
+	}
+	pdata = macsec_pdata->ether_pdata;
+
+	if (secy->xpn) {
+		netdev_err(ctx->netdev, "MACsec XPN offload not supported\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (!netif_running(ctx->netdev)) {
+		return -ENETDOWN;
+	}
+
+	/* HW is shared with the supplicant genl interface, which owns it
+	 * once initialized.
+	 */
+	if (atomic_read(&macsec_pdata->ref_count) > 0) {
+		netdev_err(ctx->netdev, "MACsec in use by supplicant\n");
+		return -EBUSY;
+	}
+
+	cipher = (secy->key_len == OSI_KEY_LEN_256) ?
+		 OSI_MACSEC_CIPHER_AES256 : OSI_MACSEC_CIPHER_AES128;
+
+	if (macsec_pdata->offload_secy_cnt == 0U) {
+		ret = macsec_open(macsec_pdata, NULL);
+		if (ret < 0) {
+			return ret;
+		}
+		macsec_pdata->macsec_rx_an_map = 0U;
+		macsec_pdata->macsec_tx_an_map = 0U;
+	}
+
+	mutex_lock(&macsec_pdata->lock);
+	if (macsec_pdata->cipher != cipher) {
+		ret = osi_macsec_cipher_config(pdata->osi_core, cipher);
+		if (ret < 0) {
+			mutex_unlock(&macsec_pdata->lock);
+			netdev_err(ctx->netdev, "Failed to set macsec cipher\n");
+			goto err_close;
+		}
+		macsec_pdata->cipher = cipher;
+	}
+	macsec_pdata->pn_window = secy->replay_protect ?
+				  secy->replay_window : OSI_PN_MAX_DEFAULT;
+	macsec_pdata->offload_secy_cnt++;
+	mutex_unlock(&macsec_pdata->lock);
+
+	return 0;
+
+err_close:
+	if (macsec_pdata->offload_secy_cnt == 0U) {
+		macsec_close(macsec_pdata);
+	}
+	return ret;
+}
+
+static int ether_macsec_mdo_upd_secy(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	const struct macsec_secy *secy = ctx->secy;
+
+	if (!macsec_pdata) {
+		return -EOPNOTSUPP;
+	}
+
+	mutex_lock(&macsec_pdata->lock);
+	macsec_pdata->pn_window = secy->replay_protect ?
+				  secy->replay_window : OSI_PN_MAX_DEFAULT;
+	mutex_unlock(&macsec_pdata->lock);
+
+	return 0;
+}
+
+static int ether_macsec_mdo_del_secy(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+
+	if (!macsec_pdata || macsec_pdata->offload_secy_cnt == 0U) {
+		return 0;
+	}
+
+	macsec_pdata->offload_secy_cnt--;
+	if (macsec_pdata->offload_secy_cnt == 0U &&
+	    macsec_pdata->enabled == OSI_ENABLE) {
+		return macsec_close(macsec_pdata);
+	}
+
+	return 0;
+}
+
+static int ether_macsec_mdo_rxsc(struct macsec_context *ctx)
+{
+	/* SCI LUT entries are programmed along with the first Rx SA */
+	return 0;
+}
+
+static int ether_macsec_mdo_add_rxsa(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	struct macsec_rx_sa *rx_sa = ctx->sa.rx_sa;
+	sci_t sci = rx_sa->sc->sci;
+	int ret;
+
+	ret = ether_macsec_sa_config(ctx, sci, OSI_CTLR_SEL_RX,
+				     rx_sa->next_pn_halves.lower,
+				     OSI_CREATE_SA);
+	if (ret < 0 || !rx_sa->active) {
+		return ret;
+	}
+
+	ret = ether_macsec_sa_config(ctx, sci, OSI_CTLR_SEL_RX,
+				     rx_sa->next_pn_halves.lower,
+				     OSI_ENABLE_SA);
+	if (ret == 0) {
+		macsec_pdata->macsec_rx_an_map |= (1U << ctx->sa.assoc_num);
+	}
+
+	return ret;
+}
+
+static int ether_macsec_mdo_upd_rxsa(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	struct macsec_rx_sa *rx_sa = ctx->sa.rx_sa;
+	int ret;
+
+	ret = ether_macsec_sa_config(ctx, rx_sa->sc->sci, OSI_CTLR_SEL_RX,
+				     rx_sa->next_pn_halves.lower,
+				     rx_sa->active ? OSI_ENABLE_SA : 0U);
+	if (ret == 0) {
+		if (rx_sa->active) {
+			macsec_pdata->macsec_rx_an_map |=
+				(1U << ctx->sa.assoc_num);
+		} else {
+			macsec_pdata->macsec_rx_an_map &=
+				~(1U << ctx->sa.assoc_num);
+		}
+	}
+
+	return ret;
+}
+
+static int ether_macsec_mdo_del_rxsa(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	struct macsec_rx_sa *rx_sa = ctx->sa.rx_sa;
+	int ret;
+
+	ret = ether_macsec_sa_config(ctx, rx_sa->sc->sci, OSI_CTLR_SEL_RX,
+				     rx_sa->next_pn_halves.lower, 0U);
+	if (ret == 0) {
+		macsec_pdata->macsec_rx_an_map &= ~(1U << ctx->sa.assoc_num);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief ether_macsec_txsa_enable - Check if Tx SA should transmit
+ *
+ * @param[in] ctx: upstream MACsec offload context.
+ *
+ * @retval true if SA is active and is the encoding SA of the SecY.
+ */
+static bool ether_macsec_txsa_enable(struct macsec_context *ctx)
+{
+	return ctx->sa.tx_sa->active &&
+	       ctx->sa.assoc_num == ctx->secy->tx_sc.encoding_sa;
+}
+
+static int ether_macsec_mdo_add_txsa(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	struct macsec_tx_sa *tx_sa = ctx->sa.tx_sa;
+	sci_t sci = ctx->secy->sci;
+	int ret;
+
+	ret = ether_macsec_sa_config(ctx, sci, OSI_CTLR_SEL_TX,
+				     tx_sa->next_pn_halves.lower,
+				     OSI_CREATE_SA);
+	if (ret < 0 || !ether_macsec_txsa_enable(ctx)) {
+		return ret;
+	}
+
+	ret = ether_macsec_sa_config(ctx, sci, OSI_CTLR_SEL_TX,
+				     tx_sa->next_pn_halves.lower,
+				     OSI_ENABLE_SA);
+	if (ret == 0) {
+		macsec_pdata->macsec_tx_an_map |= (1U << ctx->sa.assoc_num);
+	}
+
+	return ret;
+}
+
+static int ether_macsec_mdo_upd_txsa(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	struct macsec_tx_sa *tx_sa = ctx->sa.tx_sa;
+	bool enable = ether_macsec_txsa_enable(ctx);
+	int ret;
+
+	ret = ether_macsec_sa_config(ctx, ctx->secy->sci, OSI_CTLR_SEL_TX,
+				     tx_sa->next_pn_halves.lower,
+				     enable ? OSI_ENABLE_SA : 0U);
+	if (ret == 0) {
+		if (enable) {
+			macsec_pdata->macsec_tx_an_map |=
+				(1U << ctx->sa.assoc_num);
+		} else {
+			macsec_pdata->macsec_tx_an_map &=
+				~(1U << ctx->sa.assoc_num);
+		}
+	}
+
+	return ret;
+}
+
+static int ether_macsec_mdo_del_txsa(struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	struct macsec_tx_sa *tx_sa = ctx->sa.tx_sa;
+	int ret;
+
+	ret = ether_macsec_sa_config(ctx, ctx->secy->sci, OSI_CTLR_SEL_TX,
+				     tx_sa->next_pn_halves.lower, 0U);
+	if (ret == 0) {
+		macsec_pdata->macsec_tx_an_map &= ~(1U << ctx->sa.assoc_num);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief ether_macsec_read_mmc - Refresh MACsec HW counters for mdo stats
+ *
+ * @param[in] ctx: upstream MACsec offload context.
+ *
+ * @retval MACsec HW counters or NULL if MACsec is not probed.
+ */
+static struct osi_macsec_mmc_counters *ether_macsec_read_mmc(
+					struct macsec_context *ctx)
+{
+	struct macsec_priv_data *macsec_pdata = ether_macsec_ctx_pdata(ctx);
+	struct ether_priv_data *pdata;
+
+	if (!macsec_pdata || macsec_pdata->enabled != OSI_ENABLE) {
+		return NULL;
+	}
+	pdata = macsec_pdata->ether_pdata;
+
+	mutex_lock(&macsec_pdata->lock);
+	osi_macsec_read_mmc(pdata->osi_core);
+	mutex_unlock(&macsec_pdata->lock);
+
+	return &pdata->osi_core->macsec_mmc;
+}
+
+static int ether_macsec_mdo_get_dev_stats(struct macsec_context *ctx)
+{
+	struct osi_macsec_mmc_counters *mmc = ether_macsec_read_mmc(ctx);
+	struct macsec_dev_stats *stats = ctx->stats.dev_stats;
+
+	if (!mmc) {
+		return 0;
+	}
+
+	stats->OutPktsUntagged = mmc->tx_pkts_untaged;
+	stats->OutPktsTooLong = mmc->tx_pkts_too_long;
+	stats->InPktsUntagged = mmc->rx_pkts_untagged;
+	stats->InPktsNoTag = mmc->rx_pkts_no_tag;
+	stats->InPktsBadTag = mmc->rx_pkts_bad_tag;
+	stats->InPktsNoSCI = mmc->rx_pkts_no_sa_err;
+	stats->InPktsUnknownSCI = mmc->rx_pkts_no_sa;
+	stats->InPktsOverrun = mmc->rx_pkts_overrun;
+
+	return 0;
+}
+
+static int ether_macsec_mdo_get_tx_sc_stats(struct macsec_context *ctx)
+{
+	struct osi_macsec_mmc_counters *mmc = ether_macsec_read_mmc(ctx);
+	struct macsec_tx_sc_stats *stats = ctx->stats.tx_sc_stats;
+	int idx;
+
+	if (!mmc) {
+		return 0;
+	}
+
+	idx = ether_macsec_sc_idx(ether_macsec_ctx_pdata(ctx), ctx->secy->sci,
+				  OSI_CTLR_SEL_TX);
+	if (idx < 0) {
+		return 0;
+	}
+
+	/* HW counts protected octets for all Tx SCs */
+	if (ctx->secy->tx_sc.encrypt) {
+		stats->OutPktsEncrypted = mmc->tx_pkts_protected[idx];
+		stats->OutOctetsEncrypted = mmc->tx_octets_protected;
+	} else {
+		stats->OutPktsProtected = mmc->tx_pkts_protected[idx];
+		stats->OutOctetsProtected = mmc->tx_octets_protected;
+	}
+
+	return 0;
+}
+
+static int ether_macsec_mdo_get_tx_sa_stats(struct macsec_context *ctx)
+{
+	struct osi_macsec_mmc_counters *mmc;
+	struct macsec_tx_sa_stats *stats = ctx->stats.tx_sa_stats;
+	int idx;
+
+	/* HW has no per AN counters, account SC counters to encoding SA */
+	if (ctx->sa.assoc_num != ctx->secy->tx_sc.encoding_sa) {
+		return 0;
+	}
+
+	mmc = ether_macsec_read_mmc(ctx);
+	if (!mmc) {
+		return 0;
+	}
+
+	idx = ether_macsec_sc_idx(ether_macsec_ctx_pdata(ctx), ctx->secy->sci,
+				  OSI_CTLR_SEL_TX);
+	if (idx < 0) {
+		return 0;
+	}
+
+	if (ctx->secy->tx_sc.encrypt) {
+		stats->OutPktsEncrypted = (u32)mmc->tx_pkts_protected[idx];
+	} else {
+		stats->OutPktsProtected = (u32)mmc->tx_pkts_protected[idx];
+	}
+
+	return 0;
+}
+
+static int ether_macsec_mdo_get_rx_sc_stats(struct macsec_context *ctx)
+{
+	struct osi_macsec_mmc_counters *mmc = ether_macsec_read_mmc(ctx);
+	struct macsec_rx_sc_stats *stats = ctx->stats.rx_sc_stats;
+	int idx;
+
+	if (!mmc) {
+		return 0;
+	}
+
+	idx = ether_macsec_sc_idx(ether_macsec_ctx_pdata(ctx),
+				  ctx->rx_sc->sci, OSI_CTLR_SEL_RX);
+	if (idx < 0) {
+		return 0;
+	}
+
+	/* HW counts validated octets for all Rx SCs */
+	stats->InOctetsValidated = mmc->rx_octets_validated;
+	stats->InPktsOK = mmc->rx_pkts_ok[idx];
+	stats->InPktsInvalid = mmc->in_pkts_invalid[idx];
+	stats->InPktsDelayed = mmc->rx_pkts_delayed[idx];
+
+	return 0;
+}
+
+static int ether_macsec_mdo_get_rx_sa_stats(struct macsec_context *ctx)
+{
+	/* HW has no per AN Rx counters, reported per SC only */
+	return 0;
+}
+
+static const struct macsec_ops ether_macsec_ops = {
+	.mdo_dev_open = ether_macsec_mdo_dev_open,
+	.mdo_dev_stop = ether_macsec_mdo_dev_stop,
+	.mdo_add_secy = ether_macsec_mdo_add_secy,
+	.mdo_upd_secy = ether_macsec_mdo_upd_secy,
+	.mdo_del_secy = ether_macsec_mdo_del_secy,
+	.mdo_add_rxsc = ether_macsec_mdo_rxsc,
+	.mdo_upd_rxsc = ether_macsec_mdo_rxsc,
+	.mdo_del_rxsc = ether_macsec_mdo_rxsc,
+	.mdo_add_rxsa = ether_macsec_mdo_add_rxsa,
+	.mdo_upd_rxsa = ether_macsec_mdo_upd_rxsa,
+	.mdo_del_rxsa = ether_macsec_mdo_del_rxsa,
+	.mdo_add_txsa = ether_macsec_mdo_add_txsa,
+	.mdo_upd_txsa = ether_macsec_mdo_upd_txsa,
+	.mdo_del_txsa = ether_macsec_mdo_del_txsa,
+	.mdo_get_dev_stats = ether_macsec_mdo_get_dev_stats,
+	.mdo_get_tx_sc_stats = ether_macsec_mdo_get_tx_sc_stats,
+	.mdo_get_tx_sa_stats = ether_macsec_mdo_get_tx_sa_stats,
+	.mdo_get_rx_sc_stats = ether_macsec_mdo_get_rx_sc_stats,
+	.mdo_get_rx_sa_stats = ether_macsec_mdo_get_rx_sa_stats,
+};
+#endif /* ETHER_MACSEC_OFFLOAD */
+
+void macsec_remove(struct ether_priv_data *pdata)
+{
+	struct macsec_priv_data *macsec_pdata = NULL;
+	struct macsec_supplicant_data *supplicant = NULL;
+	int i;
+
+	PRINT_ENTRY();
+	macsec_pdata = pdata->macsec_pdata;
+	if (macsec_pdata) {
+#ifdef ETHER_MACSEC_OFFLOAD
+		rtnl_lock();
+		pdata->ndev->features &= ~NETIF_F_HW_MACSEC;
+		pdata->ndev->hw_features &= ~NETIF_F_HW_MACSEC;
+		pdata->ndev->macsec_ops = NULL;
+		netdev_features_change(pdata->ndev);
+		rtnl_unlock();
+		if (macsec_pdata->offload_secy_cnt > 0U &&
+		    macsec_pdata->enabled == OSI_ENABLE) {
+			macsec_close(macsec_pdata);
+		}
+		macsec_pdata->offload_secy_cnt = 0U;
+#endif /* ETHER_MACSEC_OFFLOAD */
+		mutex_lock(&macsec_pdata->lock);
+		/* Delete if any supplicant active heartbeat timer */
+		supplicant = macsec_pdata->supplicant;
+		for (i = 0; i < OSI_MAX_NUM_SC; i++) {
+			if (supplicant[i].in_use == OSI_ENABLE) {
+				supplicant->snd_portid = OSI_NONE;
+				supplicant->in_use = OSI_NONE;
+			}
+		}
+		mutex_unlock(&macsec_pdata->lock);
+		/* if macsec_close() is not called by supplicant gracefully
+		 * close it now.
+		 */
+		if (atomic_read(&macsec_pdata->ref_count) > 0) {
+			macsec_close(macsec_pdata);
+		}
+
+		/* Unregister generic netlink */
+		if (macsec_pdata->is_nv_macsec_fam_registered == OSI_ENABLE) {
+			genl_unregister_family(&macsec_pdata->nv_macsec_fam);
+			macsec_pdata->is_nv_macsec_fam_registered = OSI_DISABLE;
+		}
+
+		/* Release platform resources */
+		macsec_release_platform_res(macsec_pdata);
+		/* free macsec priv */
+		devm_kfree(pdata->dev, macsec_pdata);
+	}
+	PRINT_EXIT();
+}
+
+int macsec_probe(struct ether_priv_data *pdata)
+{
+	struct device *dev = pdata->dev;
+	struct platform_device *pdev = to_platform_device(dev);
+	struct osi_core_priv_data *osi_core = pdata->osi_core;
+	struct macsec_priv_data *macsec_pdata = NULL;
+	struct resource *res = NULL;
 	struct device_node *np = dev->of_node;
 	int ret = 0;
 #ifdef MACSEC_KEY_PROGRAM
@@ -1433,6 +2319,16 @@ int macsec_probe(struct ether_priv_data *pdata)
 			macsec_pdata->is_nv_macsec_fam_registered = OSI_ENABLE;
 	}
 
+#ifdef ETHER_MACSEC_OFFLOAD
+	/* Keys are programmed by driver, so upstream MACsec can offload */
+	rtnl_lock();
+	pdata->ndev->macsec_ops = &ether_macsec_ops;
+	pdata->ndev->features |= NETIF_F_HW_MACSEC;
+	pdata->ndev->hw_features |= NETIF_F_HW_MACSEC;
+	netdev_features_change(pdata->ndev);
+	rtnl_unlock();
+#endif /* ETHER_MACSEC_OFFLOAD */
+
 	PRINT_EXIT();
 	return ret;
 genl_err:
@@ -1450,6 +2346,148 @@ exit:
 }
 
 #ifndef MACSEC_KEY_PROGRAM
+/**
+ * @brief macsec_tz_put_kt_config - Add one TZ key table entry to genl msg
+ *
+ * @param[in] msg: genl reply message.
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] kt_config: Pointer to osi_macsec_kt_config structure
+ * @param[in] pkcs: Wrapped key data, can be NULL
+ *
+ * @retval 0 on success
+ * @retval negative value on failure.
+ */
+static int macsec_tz_put_kt_config(struct sk_buff *msg,
+				   struct ether_priv_data *pdata,
+				   struct osi_macsec_kt_config *const kt_config,
+				   struct nvpkcs_data *pkcs)
+{
+	struct nlattr *nest;
+
+	nest = nla_nest_start(msg, NV_MACSEC_ATTR_TZ_CONFIG);
+	if (!nest) {
+		return -EMSGSIZE;
+	}
+
+	if (nla_put_u32(msg, NV_MACSEC_TZ_INSTANCE_ID,
+			pdata->osi_core->instance_id) ||
+	    nla_put_u8(msg, NV_MACSEC_TZ_ATTR_CTRL,
+		       kt_config->table_config.ctlr_sel) ||
+	    nla_put_u8(msg, NV_MACSEC_TZ_ATTR_RW,
+		       kt_config->table_config.rw) ||
+	    nla_put_u8(msg, NV_MACSEC_TZ_ATTR_INDEX,
+		       kt_config->table_config.index) ||
+	    nla_put_u32(msg, NV_MACSEC_TZ_ATTR_FLAG, kt_config->flags)) {
+		goto cancel;
+	}
+#ifdef NVPKCS_MACSEC
+	if (pkcs) {
+		if (nla_put(msg, NV_MACSEC_TZ_PKCS_KEY_WRAP,
+			    sizeof(pkcs->nv_key), pkcs->nv_key) ||
+		    nla_put_u64_64bit(msg, NV_MACSEC_TZ_PKCS_KEK_HANDLE,
+				      pkcs->nv_kek, NL_POLICY_TYPE_ATTR_PAD)) {
+			goto cancel;
+		}
+	}
+#else
+	if (nla_put(msg, NV_MACSEC_TZ_ATTR_KEY, OSI_KEY_LEN_256,
+		    kt_config->entry.sak)) {
+		goto cancel;
+	}
+#endif /* NVPKCS_MACSEC */
+	nla_nest_end(msg, nest);
+
+	return 0;
+
+cancel:
+	nla_nest_cancel(msg, nest);
+	return -EMSGSIZE;
+}
+
+/**
+ * @brief macsec_tz_kt_config_batch - Program many key table entries at once
+ *
+ * Algorithm: Send all key table entries of a batch SA install in a single
+ * genl reply (NV_MACSEC_ATTR_TZ_CONFIG_LIST), so that supplicant does one
+ * TZ round-trip per batch instead of one per SA.
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] batch: SAs installed in HW.
+ * @param[in] cnt: Number of SAs in batch.
+ * @param[in] info: Pointer to netlink msg structure
+ *
+ * @retval 0 on success
+ * @retval negative value on failure.
+ */
+static int macsec_tz_kt_config_batch(struct ether_priv_data *pdata,
+				     struct macsec_batch_sa *batch,
+				     unsigned int cnt,
+				     struct genl_info *const info)
+{
+	struct macsec_priv_data *macsec_pdata = pdata->macsec_pdata;
+	struct osi_macsec_kt_config kt_config;
+	struct osi_macsec_table_config *table_config;
+	struct device *dev = pdata->dev;
+	struct sk_buff *msg;
+	struct nlattr *nest;
+	void *msg_head;
+	unsigned int i;
+	int ret = 0;
+
+	msg = genlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
+	if (msg == NULL) {
+		dev_err(dev, "Unable to alloc genl reply\n");
+		return -ENOMEM;
+	}
+
+	msg_head = genlmsg_put_reply(msg, info, &macsec_pdata->nv_macsec_fam, 0,
+				     NV_MACSEC_CMD_TZ_CONFIG);
+	if (msg_head == NULL) {
+		dev_err(dev, "unable to get replyhead\n");
+		ret = -EINVAL;
+		goto failure;
+	}
+
+	nest = nla_nest_start(msg, NV_MACSEC_ATTR_TZ_CONFIG_LIST);
+	if (!nest) {
+		ret = -EMSGSIZE;
+		goto failure;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		memset(&kt_config, 0, sizeof(kt_config));
+		table_config = &kt_config.table_config;
+		table_config->ctlr_sel = batch[i].ctlr;
+		table_config->rw = OSI_LUT_WRITE;
+		table_config->index = batch[i].kt_idx;
+		kt_config.flags |= OSI_LUT_FLAGS_ENTRY_VALID;
+		memcpy(kt_config.entry.sak, batch[i].sc_info.sak,
+		       OSI_KEY_LEN_256);
+
+		ret = macsec_tz_put_kt_config(msg, pdata, &kt_config,
+					      &batch[i].pkcs);
+		memzero_explicit(kt_config.entry.sak,
+				 sizeof(kt_config.entry.sak));
+		if (ret < 0) {
+			dev_err(dev, "TZ config list overflow at SA %u\n", i);
+			goto failure;
+		}
+	}
+	nla_nest_end(msg, nest);
+
+	genlmsg_end(msg, msg_head);
+	ret = genlmsg_reply(msg, info);
+	if (ret != 0) {
+		dev_err(dev, "Unable to send reply\n");
+	}
+
+	return ret;
+
+failure:
+	nlmsg_free(msg);
+	return ret;
+}
+
 /**
  * @brief macsec_tz_kt_config - Program macsec key table entry.
  *
@@ -1515,42 +2553,10 @@ static int macsec_tz_kt_config(struct ether_priv_data *pdata,
 	}
 
 	if (cmd == NV_MACSEC_CMD_TZ_CONFIG && kt_config != NULL) {
-		/* pr_err("%s: ctrl: %hu rw: %hu idx: %hu flags: %#x\n"
-		 *	  __func__,
-		 *	 kt_config->table_config.ctlr_sel,
-		 *	 kt_config->table_config.rw,
-		 *	 kt_config->table_config.index,
-		 *	 kt_config->flags);
-		 */
-
-		nest = nla_nest_start(msg, NV_MACSEC_ATTR_TZ_CONFIG);
-		if (!nest) {
-			ret = EINVAL;
+		ret = macsec_tz_put_kt_config(msg, pdata, kt_config, pkcs);
+		if (ret < 0) {
 			goto failure;
 		}
-		nla_put_u32(msg, NV_MACSEC_TZ_INSTANCE_ID,
-			    pdata->osi_core->instance_id);
-		nla_put_u8(msg, NV_MACSEC_TZ_ATTR_CTRL,
-			   kt_config->table_config.ctlr_sel);
-		nla_put_u8(msg, NV_MACSEC_TZ_ATTR_RW,
-			   kt_config->table_config.rw);
-		nla_put_u8(msg, NV_MACSEC_TZ_ATTR_INDEX,
-			   kt_config->table_config.index);
-		nla_put_u32(msg, NV_MACSEC_TZ_ATTR_FLAG, kt_config->flags);
-#ifdef NVPKCS_MACSEC
-		if (pkcs) {
-			nla_put(msg, NV_MACSEC_TZ_PKCS_KEY_WRAP,
-				sizeof(pkcs->nv_key),
-				pkcs->nv_key);
-			nla_put_u64_64bit(msg, NV_MACSEC_TZ_PKCS_KEK_HANDLE,
-					  pkcs->nv_kek,
-					  NL_POLICY_TYPE_ATTR_PAD);
-		}
-#else
-		nla_put(msg, NV_MACSEC_TZ_ATTR_KEY, OSI_KEY_LEN_256,
-			kt_config->entry.sak);
-#endif /* NVPKCS_MACSEC */
-		nla_nest_end(msg, nest);
 	}
 	genlmsg_end(msg, msg_head);
 	ret = genlmsg_reply(msg, info);
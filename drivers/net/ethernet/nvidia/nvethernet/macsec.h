@@ -8,7 +8,14 @@
 #include <linux/random.h>
 #include <net/genetlink.h>
 #include <linux/crypto.h>
-
+#if defined(MACSEC_KEY_PROGRAM) && IS_ENABLED(CONFIG_MACSEC) && \
+	(LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0))
+/* Upstream MACsec offload needs keys programmed by driver and
+ * single phase (no ctx->prepare) mdo callbacks
+ */
+#include <net/macsec.h>
+#define ETHER_MACSEC_OFFLOAD
+#endif
 
 /**
  * @brief Expected number of inputs in BYP or SCI LUT sysfs config
@@ -37,6 +44,12 @@
 
 #define NV_MACSEC_GENL_VERSION	1
 
+/**
+ * @brief Max SAs in one NV_MACSEC_CMD_CREATE_SA_BATCH request, bounded so
+ * that the TZ key table reply fits in one NLMSG_GOODSIZE message
+ */
+#define NV_MACSEC_MAX_BATCH_SA	16U
+
 #ifdef MACSEC_KEY_PROGRAM
 #define MACSEC_SIZE 0x10000U
 #endif
@@ -67,6 +80,7 @@ enum nv_macsec_sa_attrs {
 #else
 	NV_MACSEC_SA_ATTR_KEY,
 #endif /* NVPKCS_MACSEC */
+	NV_MACSEC_SA_ATTR_CTRL, /* OSI_CTLR_SEL_TX/RX, batch SA install */
 	__NV_MACSEC_SA_ATTR_END,
 	NUM_NV_MACSEC_SA_ATTR = __NV_MACSEC_SA_ATTR_END,
 	NV_MACSEC_SA_ATTR_MAX = __NV_MACSEC_SA_ATTR_END - 1,
@@ -108,11 +122,30 @@ enum nv_macsec_attrs {
 	NV_MACSEC_ATTR_SA_CONFIG, /* Nested SA config */
 	NV_MACSEC_ATTR_TZ_CONFIG, /* Nested TZ config */
 	NV_MACSEC_ATTR_TZ_KT_RESET, /* Nested TZ KT config */
+	NV_MACSEC_ATTR_SA_LIST, /* Nested list of SA config */
+	NV_MACSEC_ATTR_TZ_CONFIG_LIST, /* Nested list of TZ config */
+	NV_MACSEC_ATTR_STATS, /* Nested MACsec counters */
 	__NV_MACSEC_ATTR_END,
 	NUM_NV_MACSEC_ATTR = __NV_MACSEC_ATTR_END,
 	NV_MACSEC_ATTR_MAX = __NV_MACSEC_ATTR_END - 1,
 };
 
+enum nv_macsec_stats_attrs {
+	NV_MACSEC_STATS_ATTR_UNSPEC,
+	NV_MACSEC_STATS_ATTR_PAD,
+	NV_MACSEC_STATS_ATTR_TX_OCTETS_PROTECTED,
+	NV_MACSEC_STATS_ATTR_RX_OCTETS_VALIDATED,
+	NV_MACSEC_STATS_ATTR_SC, /* Nested per SC index counters */
+	NV_MACSEC_STATS_ATTR_SC_INDEX,
+	NV_MACSEC_STATS_ATTR_TX_PKTS_PROTECTED,
+	NV_MACSEC_STATS_ATTR_RX_PKTS_OK,
+	NV_MACSEC_STATS_ATTR_RX_PKTS_INVALID,
+	NV_MACSEC_STATS_ATTR_RX_PKTS_DELAYED,
+	__NV_MACSEC_STATS_ATTR_END,
+	NUM_NV_MACSEC_STATS_ATTR = __NV_MACSEC_STATS_ATTR_END,
+	NV_MACSEC_STATS_ATTR_MAX = __NV_MACSEC_STATS_ATTR_END - 1,
+};
+
 static const struct nla_policy nv_macsec_sa_genl_policy[NUM_NV_MACSEC_SA_ATTR] = {
 	[NV_MACSEC_SA_ATTR_SCI] = { .type = NLA_BINARY,
 				    .len = 8, }, /* SCI is 64bit */
@@ -127,6 +160,7 @@ static const struct nla_policy nv_macsec_sa_genl_policy[NUM_NV_MACSEC_SA_ATTR] =
 	[NV_MACSEC_SA_ATTR_KEY] = { .type = NLA_BINARY,
 				    .len = OSI_KEY_LEN_256,},
 #endif /* NVPKCS_MACSEC */
+	[NV_MACSEC_SA_ATTR_CTRL] = { .type = NLA_U8 },
 };
 
 static const struct nla_policy nv_macsec_tz_genl_policy[NUM_NV_MACSEC_TZ_ATTR] = {
@@ -157,6 +191,7 @@ static const struct nla_policy nv_macsec_genl_policy[NUM_NV_MACSEC_ATTR] = {
 	[NV_MACSEC_ATTR_SA_CONFIG] = { .type = NLA_NESTED },
 	[NV_MACSEC_ATTR_TZ_CONFIG] = { .type = NLA_NESTED },
 	[NV_MACSEC_ATTR_TZ_KT_RESET] = { .type = NLA_NESTED },
+	[NV_MACSEC_ATTR_SA_LIST] = { .type = NLA_NESTED },
 };
 
 enum nv_macsec_nl_commands {
@@ -173,6 +208,8 @@ enum nv_macsec_nl_commands {
 	NV_MACSEC_CMD_TZ_CONFIG,
 	NV_MACSEC_CMD_TZ_KT_RESET,
 	NV_MACSEC_CMD_DEINIT,
+	NV_MACSEC_CMD_CREATE_SA_BATCH,
+	NV_MACSEC_CMD_GET_STATS,
 };
 
 /**
@@ -203,6 +240,20 @@ struct nvpkcs_data {
 	u64 nv_kek;
 };
 
+/**
+ * @brief One SA of NV_MACSEC_CMD_CREATE_SA_BATCH request
+ */
+struct macsec_batch_sa {
+	/** SA parameters and key */
+	struct osi_macsec_sc_info sc_info;
+	/** pkcs wrapped key */
+	struct nvpkcs_data pkcs;
+	/** OSI_CTLR_SEL_TX or OSI_CTLR_SEL_RX */
+	unsigned short ctlr;
+	/** Key table index returned by OSI */
+	unsigned short kt_idx;
+};
+
 /**
  * @brief MACsec private data structure
  */
@@ -253,6 +304,10 @@ struct macsec_priv_data {
 	unsigned int macsec_tx_an_map;
 	/** Macsec RX currently enabled AN */
 	unsigned int macsec_rx_an_map;
+#ifdef ETHER_MACSEC_OFFLOAD
+	/** Number of offloaded SecYs using the controller */
+	unsigned int offload_secy_cnt;
+#endif /* ETHER_MACSEC_OFFLOAD */
 };
 
 int macsec_probe(struct ether_priv_data *pdata);
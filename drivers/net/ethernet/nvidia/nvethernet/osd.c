@@ -3,84 +3,6 @@
 
 #include "ether_linux.h"
 
-/**
- * @brief ether_get_free_tx_ts_node - get free node for pending SKB
- *
- * Algorithm:
- *  - Find index of statically allocayted free memory for pending SKB
- *
- * @param[in] pdata: OSD private data structure.
- *
- * @retval index number
- */
-static inline unsigned int ether_get_free_tx_ts_node(struct ether_priv_data *pdata)
-{
-	unsigned int i;
-
-	for (i = 0; i < ETHER_MAX_PENDING_SKB_CNT; i++) {
-		if (pdata->tx_ts_skb[i].in_use == OSI_NONE) {
-			break;
-		}
-	}
-
-	return i;
-}
-
-static inline void add_skb_node(struct ether_priv_data *pdata, struct sk_buff *skb,
-				unsigned int pktid) {
-	struct list_head *head_node, *temp_head_node;
-	struct ether_tx_ts_skb_list *pnode = NULL;
-	unsigned int idx;
-	unsigned long flags;
-	unsigned long now_jiffies = jiffies;
-
-	if (list_empty(&pdata->tx_ts_skb_head)) {
-		goto empty;
-	}
-
-	raw_spin_lock_irqsave(&pdata->txts_lock, flags);
-	list_for_each_safe(head_node, temp_head_node,
-			   &pdata->tx_ts_skb_head) {
-		pnode = list_entry(head_node,
-				   struct ether_tx_ts_skb_list,
-				   list_head);
-
-		if ((jiffies_to_msecs(now_jiffies) - jiffies_to_msecs(pnode->pkt_jiffies))
-		     >= ETHER_SECTOMSEC) {
-			dev_dbg(pdata->dev, "%s() skb %p deleting for pktid = %x time=%lu\n",
-				__func__, pnode->skb, pnode->pktid, pnode->pkt_jiffies);
-			if (pnode->skb != NULL) {
-				dev_consume_skb_any(pnode->skb);
-			}
-			list_del(head_node);
-			pnode->in_use = OSI_DISABLE;
-		}
-	}
-	raw_spin_unlock_irqrestore(&pdata->txts_lock, flags);
-empty:
-	raw_spin_lock_irqsave(&pdata->txts_lock, flags);
-	idx = ether_get_free_tx_ts_node(pdata);
-	if (idx == ETHER_MAX_PENDING_SKB_CNT) {
-		dev_err(pdata->dev,
-			"No free node to store pending SKB\n");
-		dev_consume_skb_any(skb);
-		raw_spin_unlock_irqrestore(&pdata->txts_lock, flags);
-		return;
-	}
-
-	pdata->tx_ts_skb[idx].in_use = OSI_ENABLE;
-	pnode = &pdata->tx_ts_skb[idx];
-	pnode->skb = skb;
-	pnode->pktid = pktid;
-	pnode->pkt_jiffies = now_jiffies;
-
-	dev_dbg(pdata->dev, "%s() SKB %p added for pktid = %x time=%lu\n",
-		__func__, skb, pktid, pnode->pkt_jiffies);
-	list_add_tail(&pnode->list_head,
-		      &pdata->tx_ts_skb_head);
-	raw_spin_unlock_irqrestore(&pdata->txts_lock, flags);
-}
-
 /**
  * @brief Adds delay in micro seconds.
  *
@@ -183,6 +105,7 @@ static void osd_log(void *priv,
 	}
 }
 
+#ifndef ETHER_PAGE_POOL
 /**
  * @brief Allocate and DMA map Rx buffer.
  *
@@ -201,10 +124,8 @@ static inline int ether_alloc_skb(struct ether_priv_data *pdata,
 				  unsigned int dma_rx_buf_len,
 				  unsigned int chan)
 {
-#ifndef ETHER_PAGE_POOL
 	struct sk_buff *skb = NULL;
 	dma_addr_t dma_addr;
-#endif
 	unsigned long val;
 
 	if (((rx_swcx->flags & OSI_RX_SWCX_REUSE) == OSI_RX_SWCX_REUSE) &&
@@ -217,7 +138,6 @@ static inline int ether_alloc_skb(struct ether_priv_data *pdata,
 		return 0;
 	}
 
-#ifndef ETHER_PAGE_POOL
 	skb = netdev_alloc_skb_ip_align(pdata->ndev, dma_rx_buf_len);
 
 	if (unlikely(skb == NULL)) {
@@ -239,26 +159,8 @@ static inline int ether_alloc_skb(struct ether_priv_data *pdata,
 		return -ENOMEM;
 	}
 
-#else
-	rx_swcx->buf_virt_addr = page_pool_dev_alloc_pages(pdata->page_pool[chan]);
-	if (!rx_swcx->buf_virt_addr) {
-		dev_err(pdata->dev,
-			"page pool allocation failed using resv_buf\n");
-		rx_swcx->buf_virt_addr = pdata->resv_buf_virt_addr;
-		rx_swcx->buf_phy_addr = pdata->resv_buf_phy_addr;
-		rx_swcx->flags |= OSI_RX_SWCX_BUF_VALID;
-		val = pdata->xstats.re_alloc_rxbuf_failed[chan];
-		pdata->xstats.re_alloc_rxbuf_failed[chan] =
-			osi_update_stats_counter(val, 1UL);
-		return 0;
-	}
-
-	rx_swcx->buf_phy_addr = page_pool_get_dma_addr(rx_swcx->buf_virt_addr);
-#endif
-#ifndef ETHER_PAGE_POOL
 	rx_swcx->buf_virt_addr = skb;
 	rx_swcx->buf_phy_addr = dma_addr;
-#endif
 	rx_swcx->flags |= OSI_RX_SWCX_BUF_VALID;
 
 	return 0;
@@ -305,6 +207,134 @@ static void ether_realloc_rx_skb(struct ether_priv_data *pdata,
 		dev_err(pdata->dev, "Failed to refill Rx ring %u\n", chan);
 	}
 }
+#else
+/**
+ * @brief Allocate a batch of Rx pages from page pool.
+ *
+ * Algorithm: Pull up to cnt pages from the channel page pool back to back
+ * so that the pool cache (and its bulk refill from page allocator on
+ * slow path) is used once per refill rather than interleaved with
+ * descriptor updates.
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] chan: DMA Rx channel number.
+ * @param[out] pages: Array to store allocated pages.
+ * @param[in] cnt: Number of pages requested.
+ *
+ * @retval number of pages allocated
+ */
+static unsigned int ether_rx_alloc_pages_bulk(struct ether_priv_data *pdata,
+					      unsigned int chan,
+					      struct page **pages,
+					      unsigned int cnt)
+{
+	struct page_pool *pool = pdata->page_pool[chan];
+	unsigned int i;
+
+	for (i = 0; i < cnt; i++) {
+		pages[i] = page_pool_dev_alloc_pages(pool);
+		if (unlikely(pages[i] == NULL)) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+/**
+ * @brief Re-fill DMA channel Rx ring from page pool in batches.
+ *
+ * Algorithm: Walk from refill index to current Rx index, take pages from
+ * a batch of up to ETHER_RX_REFILL_BULK pages and fill the Rx software
+ * contexts. Entries which can not be backed by a page use the reserved
+ * buffer, as in single buffer allocation. Descriptors are programmed once
+ * for the whole batch.
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] rx_ring: DMA channel Rx ring instance.
+ * @param[in] chan: DMA Rx channel number.
+ */
+static void ether_realloc_rx_skb(struct ether_priv_data *pdata,
+				 struct osi_rx_ring *rx_ring,
+				 unsigned int chan)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct ether_xtra_stat_counters *xstats = &pdata->xstats;
+	struct page *pages[ETHER_RX_REFILL_BULK];
+	unsigned int local_refill_idx = rx_ring->refill_idx;
+	unsigned int left = osi_get_refill_rx_desc_cnt(osi_dma, chan);
+	unsigned int cnt = 0U, idx = 0U, filled = 0U, failed = 0U;
+	struct osi_rx_swcx *rx_swcx = NULL;
+	struct page *page;
+	int ret = 0;
+
+	while (local_refill_idx != rx_ring->cur_rx_idx &&
+	       local_refill_idx < osi_dma->rx_ring_sz) {
+		rx_swcx = rx_ring->rx_swcx + local_refill_idx;
+		INCR_RX_DESC_INDEX(local_refill_idx, osi_dma->rx_ring_sz);
+		left = (left > 0U) ? (left - 1U) : 0U;
+
+		if (((rx_swcx->flags & OSI_RX_SWCX_REUSE) == OSI_RX_SWCX_REUSE) &&
+		    (rx_swcx->buf_virt_addr != pdata->resv_buf_virt_addr)) {
+			/* Skip buffer allocation since PTP software context
+			 * will have valid buffer and DMA addresses.
+			 */
+			rx_swcx->flags |= OSI_RX_SWCX_BUF_VALID;
+			continue;
+		}
+
+		if (idx == cnt && failed == 0U) {
+			cnt = ether_rx_alloc_pages_bulk(pdata, chan, pages,
+							clamp_t(unsigned int,
+								left + 1U, 1U,
+								ETHER_RX_REFILL_BULK));
+			idx = 0U;
+		}
+
+		if (unlikely(idx == cnt)) {
+			/* Page pool is empty, keep ring alive with reserved
+			 * buffer and retry on next refill.
+			 */
+			rx_swcx->buf_virt_addr = pdata->resv_buf_virt_addr;
+			rx_swcx->buf_phy_addr = pdata->resv_buf_phy_addr;
+			rx_swcx->flags |= OSI_RX_SWCX_BUF_VALID;
+			failed++;
+			continue;
+		}
+
+		page = pages[idx++];
+		rx_swcx->buf_virt_addr = page;
+		rx_swcx->buf_phy_addr = page_pool_get_dma_addr(page) +
+					pdata->rx_headroom;
+		rx_swcx->flags |= OSI_RX_SWCX_BUF_VALID;
+		filled++;
+	}
+
+	/* Return pages not consumed because of PTP reuse contexts */
+	while (idx < cnt) {
+		page_pool_put_full_page(pdata->page_pool[chan], pages[idx++],
+					false);
+	}
+
+	if (unlikely(failed > 0U)) {
+		dev_err(pdata->dev,
+			"page pool allocation failed using resv_buf\n");
+		xstats->re_alloc_rxbuf_failed[chan] =
+			osi_update_stats_counter(xstats->re_alloc_rxbuf_failed[chan],
+						 failed);
+	}
+
+	xstats->rx_refill_n[chan] =
+		osi_update_stats_counter(xstats->rx_refill_n[chan], 1UL);
+	xstats->rx_refill_buf_n[chan] =
+		osi_update_stats_counter(xstats->rx_refill_buf_n[chan], filled);
+
+	ret = osi_rx_dma_desc_init(osi_dma, rx_ring, chan);
+	if (ret < 0) {
+		dev_err(pdata->dev, "Failed to refill Rx ring %u\n", chan);
+	}
+}
+#endif /* !ETHER_PAGE_POOL */
 
 /**
  * @brief osd_realloc_buf - Allocate RX sk_buffer
@@ -590,6 +620,64 @@ exit:
 }
 #endif
 
+#ifdef ETHER_PAGE_POOL
+/**
+ * @brief ether_rx_page_to_skb - Build skb for Rx frame in page pool page
+ *
+ * Algorithm:
+ * 1) In Rx header split mode, frame above copybreak is attached as page
+ * frag to the NAPI frags skb. napi_gro_frags() pulls only the headers
+ * into the skb head and the payload is never copied.
+ * 2) Otherwise frame is copied into linear skb and page is recycled.
+ *
+ * @param[in] pdata: OSD private data structure.
+ * @param[in] chan: Rx DMA channel number.
+ * @param[in] page: Page pool page holding the frame.
+ * @param[in] data: Start of frame in page.
+ * @param[in] len: Frame length.
+ * @param[out] frags: Set to true if skb must be passed to napi_gro_frags().
+ *
+ * @retval skb pointer on success
+ * @retval NULL on failure, page is recycled.
+ */
+static struct sk_buff *ether_rx_page_to_skb(struct ether_priv_data *pdata,
+					    unsigned int chan,
+					    struct page *page, void *data,
+					    unsigned int len, bool *frags)
+{
+	struct page_pool *pool = pdata->page_pool[chan];
+	struct sk_buff *skb;
+
+#ifdef ETHER_RX_HDR_SPLIT
+	if (READ_ONCE(pdata->rx_hdr_split) == OSI_ENABLE &&
+	    len > ETHER_RX_COPYBREAK) {
+		skb = napi_get_frags(&pdata->rx_napi[chan]->napi);
+		if (unlikely(!skb)) {
+			page_pool_recycle_direct(pool, page);
+			return NULL;
+		}
+
+		/* Page goes back to the pool when skb is freed */
+		skb_add_rx_frag(skb, 0, page,
+				(unsigned int)(data - page_address(page)),
+				len, PAGE_SIZE << pool->p.order);
+		skb_mark_for_recycle(skb);
+		*frags = true;
+		return skb;
+	}
+#endif /* ETHER_RX_HDR_SPLIT */
+
+	skb = netdev_alloc_skb_ip_align(pdata->ndev, len);
+	if (likely(skb)) {
+		skb_copy_to_linear_data(skb, data, len);
+		skb_put(skb, len);
+	}
+	page_pool_recycle_direct(pool, page);
+
+	return skb;
+}
+#endif /* ETHER_PAGE_POOL */
+
 /**
  * @brief Handover received packet to network stack.
  *
@@ -614,18 +702,24 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 			       struct osi_rx_swcx *rx_swcx)
 {
 	struct ether_priv_data *pdata = (struct ether_priv_data *)priv;
-	struct osi_core_priv_data *osi_core = pdata->osi_core;
 	struct ether_rx_napi *rx_napi = pdata->rx_napi[chan];
+	unsigned int rx_bytes = 0;
+	bool rx_err = false;
 #ifdef ETHER_PAGE_POOL
 	struct page *page = (struct page *)rx_swcx->buf_virt_addr;
 	struct sk_buff *skb = NULL;
+	unsigned int len = rx_pkt_cx->pkt_len;
+	bool rx_frags = false;
+	void *data;
+#ifdef ETHER_XDP
+	struct bpf_prog *xdp_prog = READ_ONCE(pdata->xdp_prog);
+#endif /* ETHER_XDP */
 #else
 	struct sk_buff *skb = (struct sk_buff *)rx_swcx->buf_virt_addr;
 #endif
 	dma_addr_t dma_addr = (dma_addr_t)rx_swcx->buf_phy_addr;
 	struct net_device *ndev = pdata->ndev;
 #ifndef OSI_STRIPPED_LIB
-	struct osi_pkt_err_stats *pkt_err_stat = &pdata->osi_dma->pkt_err_stats;
 	unsigned long val;
 #endif /* !OSI_STRIPPED_LIB */
 	struct skb_shared_hwtstamps *shhwtstamp;
@@ -647,23 +741,30 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 	if (likely((rx_pkt_cx->flags & OSI_PKT_CX_VALID) ==
 		   OSI_PKT_CX_VALID)) {
 #ifdef ETHER_PAGE_POOL
-		skb = netdev_alloc_skb_ip_align(pdata->ndev,
-						rx_pkt_cx->pkt_len);
+		data = page_address(page) + pdata->rx_headroom;
+		dma_sync_single_for_cpu(pdata->dev, dma_addr, len,
+					page_pool_get_dma_dir(pdata->page_pool[chan]));
+#ifdef ETHER_XDP
+		if (xdp_prog &&
+		    ether_xdp_run_rx(pdata, xdp_prog, chan, page, &data,
+				     &len) != ETHER_XDP_PASS) {
+			/* Page is either recycled or owned by XDP now */
+			rx_bytes = len;
+			goto done;
+		}
+#endif /* ETHER_XDP */
+
+		skb = ether_rx_page_to_skb(pdata, chan, page, data, len,
+					   &rx_frags);
 		if (unlikely(!skb)) {
-			pdata->ndev->stats.rx_dropped++;
+			u64_stats_update_begin(&rx_napi->stats.syncp);
+			rx_napi->stats.dropped++;
+			u64_stats_update_end(&rx_napi->stats.syncp);
 			dev_err(pdata->dev,
 				"%s(): Error in allocating the skb\n",
 			        __func__);
-			page_pool_recycle_direct(pdata->page_pool[chan], page);
 			return;
 		}
-
-		dma_sync_single_for_cpu(pdata->dev, dma_addr,
-					rx_pkt_cx->pkt_len, DMA_FROM_DEVICE);
-		skb_copy_to_linear_data(skb, page_address(page),
-					rx_pkt_cx->pkt_len);
-		skb_put(skb, rx_pkt_cx->pkt_len);
-		page_pool_recycle_direct(pdata->page_pool[chan], page);
 #else
 		skb_put(skb, rx_pkt_cx->pkt_len);
 #endif
@@ -696,9 +797,26 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 		}
 
 		skb_record_rx_queue(skb, chan);
+#ifdef ETHER_RX_HDR_SPLIT
+		if (rx_frags) {
+			/* Ethernet header is still part of the frag here */
+			rx_bytes = skb->len - ETH_HLEN;
+#ifdef ETHER_DIM
+			rx_napi->dim_bytes += rx_bytes;
+#endif /* ETHER_DIM */
+			pdata->xstats.rx_hdr_split_n[chan] =
+				osi_update_stats_counter(
+					pdata->xstats.rx_hdr_split_n[chan], 1UL);
+			napi_gro_frags(&rx_napi->napi);
+			goto done;
+		}
+#endif /* ETHER_RX_HDR_SPLIT */
 		skb->dev = ndev;
 		skb->protocol = eth_type_trans(skb, ndev);
-		ndev->stats.rx_bytes += skb->len;
+		rx_bytes = skb->len;
+#ifdef ETHER_DIM
+		rx_napi->dim_bytes += rx_bytes;
+#endif /* ETHER_DIM */
 #ifdef ETHER_NVGRO
 		if ((ndev->features & NETIF_F_GRO) &&
 		    ether_do_nvgro(pdata, &rx_napi->napi, skb))
@@ -710,28 +828,33 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 			netif_receive_skb(skb);
 		}
 	} else {
-#ifndef OSI_STRIPPED_LIB
-		ndev->stats.rx_crc_errors = pkt_err_stat->rx_crc_error;
-		ndev->stats.rx_frame_errors = pkt_err_stat->rx_frame_error;
-#endif /* !OSI_STRIPPED_LIB */
-		ndev->stats.rx_fifo_errors = osi_core->mmc.mmc_rx_fifo_overflow;
-		ndev->stats.rx_errors++;
+		/* CRC/frame/FIFO error details are reported by
+		 * ndo_get_stats64 from OSI/MMC counters.
+		 */
+		rx_err = true;
 #ifdef ETHER_PAGE_POOL
 		page_pool_recycle_direct(pdata->page_pool[chan], page);
 #endif
 		dev_kfree_skb_any(skb);
 	}
 
-#ifdef ETHER_NVGRO
+#if defined(ETHER_NVGRO) || defined(ETHER_XDP) || defined(ETHER_RX_HDR_SPLIT)
 done:
 #endif
-	ndev->stats.rx_packets++;
+	u64_stats_update_begin(&rx_napi->stats.syncp);
+	rx_napi->stats.packets++;
+	rx_napi->stats.bytes += rx_bytes;
+	if (rx_err) {
+		rx_napi->stats.errors++;
+	}
+	u64_stats_update_end(&rx_napi->stats.syncp);
 	rx_swcx->buf_virt_addr = NULL;
 	rx_swcx->buf_phy_addr = 0;
 	/* mark packet is processed */
 	rx_swcx->flags |= OSI_RX_SWCX_PROCESSED;
 
-	if (osi_get_refill_rx_desc_cnt(pdata->osi_dma, chan) >= 16U)
+	if (osi_get_refill_rx_desc_cnt(pdata->osi_dma, chan) >=
+	    ETHER_RX_REFILL_THRESH)
 		ether_realloc_rx_skb(pdata, rx_ring, chan);
 }
 
@@ -765,14 +888,26 @@ static void osd_transmit_complete(void *priv, const struct osi_tx_swcx *swcx,
 	struct netdev_queue *txq;
 	unsigned int chan, qinx;
 	unsigned int len = swcx->len;
+	struct ether_tx_napi *tx_napi;
 
-	ndev->stats.tx_bytes += len;
+#ifdef ETHER_XDP
+	if (ether_xdp_tx_complete(pdata, swcx)) {
+		return;
+	}
+#endif /* ETHER_XDP */
 
 	if ((txdone_pkt_cx->flags & OSI_TXDONE_CX_TS) == OSI_TXDONE_CX_TS) {
-		memset(&shhwtstamp, 0, sizeof(struct skb_shared_hwtstamps));
-		shhwtstamp.hwtstamp = ns_to_ktime(txdone_pkt_cx->ns);
-		/* pass tstamp to stack */
-		skb_tstamp_tx(skb, &shhwtstamp);
+		/* Frames timestamped only for TSN validation are not
+		 * reported to socket
+		 */
+		if (skb_shinfo(skb)->tx_flags & SKBTX_IN_PROGRESS) {
+			memset(&shhwtstamp, 0,
+			       sizeof(struct skb_shared_hwtstamps));
+			shhwtstamp.hwtstamp = ns_to_ktime(txdone_pkt_cx->ns);
+			/* pass tstamp to stack */
+			skb_tstamp_tx(skb, &shhwtstamp);
+		}
+		ether_tsn_lat_update(pdata, skb, txdone_pkt_cx->ns);
 	}
 
 	if (dmaaddr != 0UL) {
@@ -802,10 +937,19 @@ static void osd_transmit_complete(void *priv, const struct osi_tx_swcx *swcx,
 			netdev_dbg(ndev, "Tx ring[%d] - waking Txq\n", chan);
 		}
 
-		ndev->stats.tx_packets++;
+		tx_napi = pdata->tx_napi[chan];
+		u64_stats_update_begin(&tx_napi->stats.syncp);
+		tx_napi->stats.packets++;
+		tx_napi->stats.bytes += skb->len;
+		u64_stats_update_end(&tx_napi->stats.syncp);
+#ifdef ETHER_DIM
+		tx_napi->dim_pkts++;
+		tx_napi->dim_bytes += skb->len;
+#endif /* ETHER_DIM */
 		if ((txdone_pkt_cx->flags & OSI_TXDONE_CX_TS_DELAYED) ==
 		    OSI_TXDONE_CX_TS_DELAYED) {
-			add_skb_node(pdata, skb, txdone_pkt_cx->pktid);
+			ether_tx_ts_queue(pdata, chan, skb,
+					  txdone_pkt_cx->pktid);
 			/* Consume the timestamp immediately if already available */
 			if (ether_get_tx_ts(pdata) < 0)
 				schedule_delayed_work(&pdata->tx_ts_work,
@@ -941,6 +1085,130 @@ void ether_assign_osd_ops(struct osi_core_priv_data *osi_core,
 #endif
 }
 
+/**
+ * @brief ether_ivc_batch_drain_one - Collect the response of the oldest
+ * batched command
+ *
+ * @param[in] pdata: OSD private data
+ *
+ * @retval 0 on success
+ * @retval -ETIMEDOUT if the server did not respond
+ */
+static int ether_ivc_batch_drain_one(struct ether_priv_data *pdata)
+{
+	struct ether_ivc_ctxt *ictxt = &pdata->ictxt;
+	int status = 0;
+	int ret;
+
+	ret = readx_poll_timeout_atomic(tegra_hv_ivc_can_read, ictxt->ivck,
+					status, status, 10, IVC_WAIT_TIMEOUT_CNT);
+	if (ret == -ETIMEDOUT) {
+		dev_err(pdata->dev, "IVC batch read timeout, %u pending\n",
+			ictxt->batch_pending);
+		ictxt->batch_pending = 0;
+		if (ictxt->batch_err == 0)
+			ictxt->batch_err = ret;
+		return ret;
+	}
+
+	ictxt->batch_pending--;
+	ictxt->batch_resp.status = -1;
+	ret = tegra_hv_ivc_read(ictxt->ivck, &ictxt->batch_resp,
+				sizeof(ictxt->batch_resp));
+	if (ret < 0) {
+		dev_err(pdata->dev, "IVC batch read failed: %d\n", ret);
+		if (ictxt->batch_err == 0)
+			ictxt->batch_err = ret;
+	} else if (ictxt->batch_resp.status < 0 && ictxt->batch_err == 0) {
+		ictxt->batch_err = ictxt->batch_resp.status;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief ether_ivc_batch_post - Queue a command of the open batch
+ *
+ * @param[in] pdata: OSD private data
+ * @param[in] ivc_buf: ivc_msg_common structure
+ * @param[in] len: length of data
+ *
+ * @retval 0 when queued, the server status is reported at batch end
+ * @retval "negative value" on failure
+ */
+static int ether_ivc_batch_post(struct ether_priv_data *pdata,
+				ivc_msg_common_t *ivc_buf, unsigned int len)
+{
+	struct ether_ivc_ctxt *ictxt = &pdata->ictxt;
+	int ret;
+
+	if (ictxt->batch_err == -ETIMEDOUT)
+		return ictxt->batch_err;
+
+	/* Make room by collecting responses once the queue is full */
+	while (!tegra_hv_ivc_can_write(ictxt->ivck)) {
+		if (ictxt->batch_pending == 0U ||
+		    ether_ivc_batch_drain_one(pdata) < 0)
+			return -ETIMEDOUT;
+	}
+
+	ret = tegra_hv_ivc_write(ictxt->ivck, ivc_buf, len);
+	if (ret != len) {
+		dev_err(pdata->dev, "IVC batch write with len %d ret %d cmd %d failed\n",
+			len, ret, ivc_buf->cmd);
+		return -EIO;
+	}
+
+	ictxt->batch_pending++;
+
+	return 0;
+}
+
+void ether_ivc_batch_begin(struct ether_priv_data *pdata)
+{
+	struct ether_ivc_ctxt *ictxt = &pdata->ictxt;
+	unsigned long flags;
+	int status = -1;
+
+	if (ictxt->ivck == NULL)
+		return;
+
+	raw_spin_lock_irqsave(&ictxt->ivck_lock, flags);
+	ictxt->batch_flags = flags;
+	ictxt->batch_pending = 0;
+	ictxt->batch_err = 0;
+
+	if (readx_poll_timeout_atomic(tegra_hv_ivc_channel_notified,
+				      ictxt->ivck, status, status == 0, 10,
+				      IVC_WAIT_TIMEOUT_CNT) == -ETIMEDOUT) {
+		dev_err(pdata->dev, "IVC channel timeout\n");
+		ictxt->batch_err = -ETIMEDOUT;
+	}
+
+	WRITE_ONCE(ictxt->batch_cpu, raw_smp_processor_id());
+}
+
+int ether_ivc_batch_end(struct ether_priv_data *pdata)
+{
+	struct ether_ivc_ctxt *ictxt = &pdata->ictxt;
+	int ret;
+
+	if (ictxt->ivck == NULL ||
+	    READ_ONCE(ictxt->batch_cpu) != raw_smp_processor_id())
+		return 0;
+
+	while (ictxt->batch_pending != 0U) {
+		if (ether_ivc_batch_drain_one(pdata) < 0)
+			break;
+	}
+
+	ret = ictxt->batch_err;
+	WRITE_ONCE(ictxt->batch_cpu, nr_cpu_ids);
+	raw_spin_unlock_irqrestore(&ictxt->ivck_lock, ictxt->batch_flags);
+
+	return ret;
+}
+
 /**
  * @brief osd_send_cmd - OSD ivc send cmd
  *
@@ -972,6 +1240,10 @@ int osd_ivc_send_cmd(void *priv, ivc_msg_common_t *ivc_buf, unsigned int len)
 	ivc_buf->status = -1;
 	ivc_buf->count = cnt++;
 
+	/* The batch owner already holds the lock with IRQs disabled */
+	if (READ_ONCE(ictxt->batch_cpu) == raw_smp_processor_id())
+		return ether_ivc_batch_post(pdata, ivc_buf, len);
+
 	raw_spin_lock_irqsave(&ictxt->ivck_lock, flags);
 
 	/* Waiting for the channel to be ready */
@@ -2,6 +2,12 @@
 // SPDX-FileCopyrightText: Copyright (c) 2019-2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
 
 #include "ether_linux.h"
+#include <linux/timekeeping.h>
+#if defined(NV_SYSTEM_COUNTERVAL_T_STRUCT_HAS_CS_ID) && \
+	defined(CONFIG_ARM_ARCH_TIMER) /* Linux v6.9 */
+#include <asm/arch_timer.h>
+#define ETHER_PTP_CROSSTSTAMP
+#endif
 
 /**
  * @brief DEFINE_RAW_SPINLOCK: raw spinlock to get HW PTP time and kernel time atomically
@@ -116,6 +122,23 @@ static int ether_adjust_time(struct ptp_clock_info *ptp, s64 nsec_delta)
 	return ret;
 }
 
+/**
+ * @brief Forget the cached frequency adjustment
+ *
+ * Algorithm: OSI_CMD_CONFIG_PTP reprograms the default addend, so the
+ * next adjfine must reach the MAC even if its ppb value is unchanged.
+ *
+ * @param[in] pdata: OSD private data.
+ */
+static void ether_ptp_adj_invalidate(struct ether_priv_data *pdata)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&pdata->ptp_lock, flags);
+	pdata->ptp_adj_ppb_valid = false;
+	raw_spin_unlock_irqrestore(&pdata->ptp_lock, flags);
+}
+
 /**
  * @brief Adjust MAC hardware frequency
  *
@@ -136,20 +159,30 @@ static int ether_adjust_clock(struct ptp_clock_info *ptp, long scaled_ppm)
 						     ptp_clock_ops);
 	struct osi_core_priv_data *osi_core = pdata->osi_core;
 	struct osi_ioctl ioctl_data = {};
+	s32 ppb = scaled_ppm_to_ppb(scaled_ppm);
 	unsigned long flags;
-	int ret = -1;
+	int ret = 0;
 
 	raw_spin_lock_irqsave(&pdata->ptp_lock, flags);
 
+	/* Servos call this every sample, most land on the same ppb value */
+	if (pdata->ptp_adj_ppb_valid && pdata->ptp_adj_ppb == ppb)
+		goto unlock;
+
 	ioctl_data.cmd = OSI_CMD_ADJ_FREQ;
-	ioctl_data.arg6_32 = scaled_ppm_to_ppb(scaled_ppm);
+	ioctl_data.arg6_32 = ppb;
 	ret = osi_handle_ioctl(osi_core, &ioctl_data);
 	if (ret < 0) {
+		pdata->ptp_adj_ppb_valid = false;
 		dev_err(pdata->dev,
 			"%s:failed to adjust frequency with reason code %d\n",
 			__func__, ret);
+	} else {
+		pdata->ptp_adj_ppb = ppb;
+		pdata->ptp_adj_ppb_valid = true;
 	}
 
+unlock:
 	raw_spin_unlock_irqrestore(&pdata->ptp_lock, flags);
 
 	return ret;
@@ -194,6 +227,116 @@ static int ether_get_time(struct ptp_clock_info *ptp, struct timespec64 *ts)
 	return 0;
 }
 
+/**
+ * @brief Gets current hardware time with system time stamps around the read
+ *
+ * Algorithm: Same as ether_get_time(), with the system clock read right
+ * before and after the MAC time registers and interrupts disabled, so the
+ * PTP_SYS_OFFSET_EXTENDED window only covers the register accesses.
+ *
+ * @param[in] ptp: Pointer to ptp_clock_info structure.
+ * @param[out] ts: Pointer to hold time.
+ * @param[out] sts: System time stamps before and after the read.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_get_time_ex(struct ptp_clock_info *ptp,
+			     struct timespec64 *ts,
+			     struct ptp_system_timestamp *sts)
+{
+	struct ether_priv_data *pdata = container_of(ptp,
+						     struct ether_priv_data,
+						     ptp_clock_ops);
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	unsigned int sec, nsec;
+	unsigned long flags;
+	int ret;
+
+	raw_spin_lock_irqsave(&pdata->ptp_lock, flags);
+	ptp_read_system_prets(sts);
+	ret = osi_dma_get_systime_from_mac(osi_dma, &sec, &nsec);
+	ptp_read_system_postts(sts);
+	raw_spin_unlock_irqrestore(&pdata->ptp_lock, flags);
+
+	if (ret < 0) {
+		dev_err(pdata->dev, "%s: Failed to read systime from MAC %d\n",
+			__func__, ret);
+		return ret;
+	}
+
+	ts->tv_sec = sec;
+	ts->tv_nsec = nsec;
+
+	return 0;
+}
+
+#ifdef ETHER_PTP_CROSSTSTAMP
+/**
+ * @brief Capture MAC time and system counter at the same instant
+ *
+ * Algorithm: MAC latches PTP time and TSC together. TSC feeds the ARM
+ * architected counter which backs the system clocksource, so the latched
+ * TSC value converted to counter ticks is the system side of the pair.
+ *
+ * @param[out] device: MAC time of the capture.
+ * @param[out] system: System counter value of the capture.
+ * @param[in] ctx: OSD private data.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_get_syncdevicetime(ktime_t *device,
+				    struct system_counterval_t *system,
+				    void *ctx)
+{
+	struct ether_priv_data *pdata = ctx;
+	struct osi_ioctl ioctl_data = {};
+	struct osi_core_ptp_tsc_data *tsc = &ioctl_data.ptp_tsc;
+	unsigned long flags;
+	u64 tsc_ns;
+	int ret;
+
+	raw_spin_lock_irqsave(&pdata->ptp_lock, flags);
+	ioctl_data.cmd = OSI_CMD_CAP_TSC_PTP;
+	ret = osi_handle_ioctl(pdata->osi_core, &ioctl_data);
+	raw_spin_unlock_irqrestore(&pdata->ptp_lock, flags);
+	/* Not every MAC latches TSC, callers fall back to gettimex64 */
+	if (ret != 0)
+		return -EOPNOTSUPP;
+
+	*device = ns_to_ktime(tsc->ptp_low_bits +
+			      (tsc->ptp_high_bits * OSI_NSEC_PER_SEC));
+	tsc_ns = ((u64)tsc->tsc_high_bits << TSC_HIGH_SHIFT) |
+		 tsc->tsc_low_bits;
+	system->cycles = mul_u64_u32_div(tsc_ns, arch_timer_get_cntfrq(),
+					 NSEC_PER_SEC);
+	system->cs_id = CSID_ARM_ARCH_COUNTER;
+
+	return 0;
+}
+
+/**
+ * @brief Hardware cross timestamp of MAC time and system time
+ *
+ * @param[in] ptp: Pointer to ptp_clock_info structure.
+ * @param[out] cts: Cross timestamp.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_get_crosststamp(struct ptp_clock_info *ptp,
+				 struct system_device_crosststamp *cts)
+{
+	struct ether_priv_data *pdata = container_of(ptp,
+						     struct ether_priv_data,
+						     ptp_clock_ops);
+
+	return get_device_system_crosststamp(ether_get_syncdevicetime, pdata,
+					     NULL, cts);
+}
+#endif /* ETHER_PTP_CROSSTSTAMP */
+
 /**
  * @brief Set current system time to MAC Hardware
  *
@@ -248,6 +391,10 @@ static struct ptp_clock_info ether_ptp_clock_ops = {
 	.adjfine = ether_adjust_clock,
 	.adjtime = ether_adjust_time,
 	.gettime64 = ether_get_time,
+	.gettimex64 = ether_get_time_ex,
+#ifdef ETHER_PTP_CROSSTSTAMP
+	.getcrosststamp = ether_get_crosststamp,
+#endif /* ETHER_PTP_CROSSTSTAMP */
 	.settime64 = ether_set_time,
 };
 
@@ -279,6 +426,7 @@ static int ether_early_ptp_init(struct ether_priv_data *pdata)
 	ioctl_data.arg1_u32 = OSI_ENABLE;
 	ioctl_data.cmd = OSI_CMD_CONFIG_PTP;
 	ret = osi_handle_ioctl(osi_core, &ioctl_data);
+	ether_ptp_adj_invalidate(pdata);
 	if (ret < 0) {
 		dev_err(pdata->dev, "Failure to enable CONFIG_PTP\n");
 		return -EFAULT;
@@ -297,6 +445,7 @@ int ether_ptp_init(struct ether_priv_data *pdata)
 	}
 
 	raw_spin_lock_init(&pdata->ptp_lock);
+	pdata->ptp_adj_ppb_valid = false;
 
 	pdata->ptp_clock_ops = ether_ptp_clock_ops;
 	pdata->ptp_clock = ptp_clock_register(&pdata->ptp_clock_ops,
@@ -560,6 +709,7 @@ int ether_handle_hwtstamp_ioctl(struct ether_priv_data *pdata,
 		ioctl_data.arg1_u32 = OSI_DISABLE;
 		ioctl_data.cmd = OSI_CMD_CONFIG_PTP;
 		ret = osi_handle_ioctl(osi_core, &ioctl_data);
+		ether_ptp_adj_invalidate(pdata);
 		if (ret < 0) {
 			dev_err(pdata->dev, "Failure to disable CONFIG_PTP\n");
 			return -EFAULT;
@@ -582,6 +732,7 @@ int ether_handle_hwtstamp_ioctl(struct ether_priv_data *pdata,
 		ioctl_data.arg1_u32 = OSI_ENABLE;
 		ioctl_data.cmd = OSI_CMD_CONFIG_PTP;
 		ret = osi_handle_ioctl(osi_core, &ioctl_data);
+		ether_ptp_adj_invalidate(pdata);
 		if (ret < 0) {
 			dev_err(pdata->dev, "Failure to enable CONFIG_PTP\n");
 			return -EFAULT;
@@ -3,6 +3,7 @@
 
 #ifndef OSI_STRIPPED_LIB
 #include "ether_linux.h"
+#include <linux/sort.h>
 #include <net/udp.h>
 
 /**
@@ -15,6 +16,10 @@ struct ether_packet_ctxt {
 #else
 	unsigned char *dst;
 #endif
+	/** Extra payload bytes after test header */
+	unsigned int size;
+	/** Received packet is expected to carry payload in page frags */
+	bool exp_frags;
 };
 
 /**
@@ -55,6 +60,8 @@ struct ether_testhdr {
 #define ETHER_UDP_TEST_PORT	9
 #define ETHER_IP_IHL		5
 #define ETHER_IP_TTL		32
+/* Payload large enough to take Rx header split path */
+#define ETHER_TEST_SPLIT_PAYLOAD	1024U
 /** @} */
 
 /**
@@ -78,7 +85,7 @@ static struct sk_buff *ether_test_get_udp_skb(struct ether_priv_data *pdata,
 	struct iphdr *iph;
 	int    iplen;
 
-	skb = netdev_alloc_skb(pdata->ndev, ETHER_TEST_PKT_SIZE);
+	skb = netdev_alloc_skb(pdata->ndev, ETHER_TEST_PKT_SIZE + ctxt->size);
 	if (!skb) {
 		netdev_err(pdata->ndev, "Failed to allocate loopback skb\n");
 		return NULL;
@@ -104,7 +111,8 @@ static struct sk_buff *ether_test_get_udp_skb(struct ether_priv_data *pdata,
 	/* Fill UDP header */
 	udph->source = htons(ETHER_UDP_TEST_PORT);
 	udph->dest = htons(ETHER_UDP_TEST_PORT); /* Discard Protocol */
-	udph->len = htons(sizeof(struct ether_testhdr) + sizeof(struct udphdr));
+	udph->len = htons(sizeof(struct ether_testhdr) + sizeof(struct udphdr) +
+			  ctxt->size);
 	udph->check = OSI_NONE;
 
 	/* Fill IP header */
@@ -113,7 +121,7 @@ static struct sk_buff *ether_test_get_udp_skb(struct ether_priv_data *pdata,
 	iph->version = IPVERSION;
 	iph->protocol = IPPROTO_UDP;
 	iplen = sizeof(struct iphdr) + sizeof(struct udphdr) +
-		sizeof(struct ether_testhdr);
+		sizeof(struct ether_testhdr) + ctxt->size;
 	iph->tot_len = htons(iplen);
 	iph->frag_off = OSI_NONE;
 	iph->saddr = OSI_NONE;
@@ -125,6 +133,8 @@ static struct sk_buff *ether_test_get_udp_skb(struct ether_priv_data *pdata,
 	/* Fill test header and data */
 	testhdr = skb_put(skb, sizeof(*testhdr));
 	testhdr->magic = cpu_to_be64(ETHER_TEST_PKT_MAGIC);
+	if (ctxt->size > 0U)
+		skb_put_zero(skb, ctxt->size);
 
 	skb->csum = OSI_NONE;
 	skb->ip_summed = CHECKSUM_PARTIAL;
@@ -164,6 +174,10 @@ static int ether_test_loopback_validate(struct sk_buff *skb,
 	struct udphdr *uhdr;
 	struct iphdr *ihdr;
 
+	/* Check before skb_unshare() which may linearize a copy */
+	if (tpdata->ctxt->exp_frags && !skb_is_nonlinear(skb))
+		goto out;
+
 	skb = skb_unshare(skb, GFP_ATOMIC);
 	if (!skb)
 		goto out;
@@ -310,15 +324,13 @@ static int ether_test_phy_loopback(struct ether_priv_data *pdata)
 static int ether_test_mmc_counters(struct ether_priv_data *pdata)
 {
 	struct osi_core_priv_data *osi_core = pdata->osi_core;
-	struct osi_ioctl ioctl_data = {};
 	unsigned int mmc_tx_framecount_g = 0;
 	unsigned int mmc_rx_framecount_gb = 0;
 	unsigned int mmc_rx_ipv4_gd = 0;
 	unsigned int mmc_rx_udp_gd = 0;
 	int ret = 0;
 
-	ioctl_data.cmd = OSI_CMD_READ_MMC;
-	ret = osi_handle_ioctl(osi_core, &ioctl_data);
+	ret = ether_read_mmc(pdata);
 	if (ret < 0)
 		return ret;
 
@@ -330,8 +342,7 @@ static int ether_test_mmc_counters(struct ether_priv_data *pdata)
 	ret = ether_test_mac_loopback(pdata);
 	if (ret < 0)
 		return ret;
-	ioctl_data.cmd = OSI_CMD_READ_MMC;
-	ret = osi_handle_ioctl(osi_core, &ioctl_data);
+	ret = ether_read_mmc(pdata);
 	if (ret < 0)
 		return ret;
 
@@ -347,6 +358,34 @@ static int ether_test_mmc_counters(struct ether_priv_data *pdata)
 	return 0;
 }
 
+#ifdef ETHER_RX_HDR_SPLIT
+/**
+ * @brief ether_test_rx_hdr_split - Ethernet selftest for Rx header split
+ *
+ * Algorithm: Sends MAC loopback packet with payload above Rx copybreak
+ * and checks that it is received with payload in page frags.
+ *
+ * @param[in] pdata: Ethernet OSD private data
+ *
+ * @retval zero on success
+ * @retval -EOPNOTSUPP if Rx header split is not enabled.
+ * @retval negative value on failure.
+ */
+static int ether_test_rx_hdr_split(struct ether_priv_data *pdata)
+{
+	struct ether_packet_ctxt ctxt = { };
+
+	if (pdata->rx_hdr_split != OSI_ENABLE)
+		return -EOPNOTSUPP;
+
+	ctxt.dst = pdata->ndev->dev_addr;
+	ctxt.size = ETHER_TEST_SPLIT_PAYLOAD;
+	ctxt.exp_frags = true;
+
+	return ether_test_loopback(pdata, &ctxt);
+}
+#endif /* ETHER_RX_HDR_SPLIT */
+
 #define ETHER_LOOPBACK_NONE	0
 #define ETHER_LOOPBACK_MAC	1
 #define ETHER_LOOPBACK_PHY	2
@@ -368,9 +407,59 @@ static const struct ether_test {
 		.name = "MMC Counters		",
 		.lb = ETHER_LOOPBACK_MAC,
 		.fn = ether_test_mmc_counters,
+#ifdef ETHER_RX_HDR_SPLIT
+	}, {
+		.name = "RX Header Split	",
+		.lb = ETHER_LOOPBACK_MAC,
+		.fn = ether_test_rx_hdr_split,
+#endif /* ETHER_RX_HDR_SPLIT */
 	},
 };
 
+/**
+ * @brief ether_test_set_loopback - Enable or disable test loopback
+ *
+ * Algorithm: PHY loopback falls back to MAC loopback when the PHY
+ * does not support it.
+ *
+ * @param[in] pdata: Ethernet OSD private data
+ * @param[in] lb: ETHER_LOOPBACK_MAC or ETHER_LOOPBACK_PHY
+ * @param[in] enable: true to enable, false to disable loopback
+ *
+ * @retval zero on success.
+ * @retval negative value on failure.
+ */
+static int ether_test_set_loopback(struct ether_priv_data *pdata, int lb,
+				   bool enable)
+{
+	struct net_device *dev = pdata->ndev;
+	struct osi_ioctl ioctl_data = {};
+	int ret = 0;
+
+	switch (lb) {
+	case ETHER_LOOPBACK_PHY:
+		ret = -EOPNOTSUPP;
+		if (dev->phydev)
+			ret = phy_loopback(dev->phydev, enable);
+		if (!ret)
+			break;
+	/* Fallthrough */
+		fallthrough;
+	case ETHER_LOOPBACK_MAC:
+		if (pdata->osi_core) {
+			ioctl_data.cmd = OSI_CMD_MAC_LB;
+			ioctl_data.arg1_u32 = enable ? OSI_ENABLE : OSI_DISABLE;
+			ret = osi_handle_ioctl(pdata->osi_core, &ioctl_data);
+		}
+		break;
+	default:
+		ret = -EOPNOTSUPP;
+		break;
+	}
+
+	return ret;
+}
+
 /**
  * @brief ether_selftest_run - Ethernet selftests.
  *
@@ -385,7 +474,6 @@ void ether_selftest_run(struct net_device *dev,
 			struct ethtool_test *etest, u64 *buf)
 {
 	struct ether_priv_data *pdata = netdev_priv(dev);
-	struct osi_ioctl ioctl_data = {};
 	int count = ether_selftest_get_count(pdata);
 	int carrier = netif_carrier_ok(dev);
 	int i, ret;
@@ -400,30 +488,8 @@ void ether_selftest_run(struct net_device *dev,
 	netif_carrier_off(dev);
 
 	for (i = 0; i < count; i++) {
-		ret = 0;
-
-		switch (ether_selftests[i].lb) {
-		case ETHER_LOOPBACK_PHY:
-			ret = -EOPNOTSUPP;
-			if (dev->phydev)
-				ret = phy_loopback(dev->phydev, true);
-			if (!ret)
-				break;
-		/* Fallthrough */
-			fallthrough;
-		case ETHER_LOOPBACK_MAC:
-			if (pdata->osi_core) {
-				ioctl_data.cmd = OSI_CMD_MAC_LB;
-				ioctl_data.arg1_u32 = OSI_ENABLE;
-				ret = osi_handle_ioctl(pdata->osi_core,
-						       &ioctl_data);
-			}
-			break;
-		default:
-			ret = -EOPNOTSUPP;
-			break;
-		}
-
+		ret = ether_test_set_loopback(pdata, ether_selftests[i].lb,
+					      true);
 		if (ret) {
 			netdev_err(dev, "Loopback is not supported\n");
 			etest->flags |= ETH_TEST_FL_FAILED;
@@ -435,32 +501,389 @@ void ether_selftest_run(struct net_device *dev,
 			etest->flags |= ETH_TEST_FL_FAILED;
 		buf[i] = ret;
 
-		switch (ether_selftests[i].lb) {
-		case ETHER_LOOPBACK_PHY:
-			ret = -EOPNOTSUPP;
-			if (dev->phydev)
-				ret = phy_loopback(dev->phydev, false);
-			if (!ret)
-				break;
-		/* Fallthrough */
-			fallthrough;
-		case ETHER_LOOPBACK_MAC:
-			if (pdata->osi_core) {
-				ioctl_data.cmd = OSI_CMD_MAC_LB;
-				ioctl_data.arg1_u32 = OSI_DISABLE;
-				ret = osi_handle_ioctl(pdata->osi_core,
-						       &ioctl_data);
-			}
-			if (!ret)
-				break;
-		default:
+		(void)ether_test_set_loopback(pdata, ether_selftests[i].lb,
+					      false);
+	}
+
+	/* Restart everything */
+	if (carrier)
+		netif_carrier_on(dev);
+}
+
+/**
+ * @brief Loopback perf test header, follows the Ethernet test header
+ */
+struct ether_perf_hdr {
+	/** Packet sequence number within a channel run */
+	__be32 seq;
+	/** DMA channel the packet was sent on */
+	__be32 chan;
+	/** CLOCK_MONOTONIC transmit time [nsec] */
+	__be64 tstamp;
+};
+
+/**
+ * @addtogroup Ethernet loopback perf test helper macros
+ *
+ * @brief Limits and defaults of the loopback perf test
+ * @{
+ */
+#define ETHER_PERF_MAX_PKTS	65536U
+#define ETHER_PERF_MAX_WINDOW	1024U
+#define ETHER_PERF_TIMEOUT_MS	1000U
+#define ETHER_PERF_MIN_FRAME	(ETHER_TEST_PKT_SIZE + \
+				 sizeof(struct ether_perf_hdr))
+/** @} */
+
+/**
+ * @brief Loopback perf test context of one channel run
+ */
+struct ether_perf_ctxt {
+	/** Packet type to get the looped back packets */
+	struct packet_type pt;
+	/** Woken when packets come back */
+	wait_queue_head_t wq;
+	/** DMA channel under test */
+	unsigned int chan;
+	/** Packets to send */
+	unsigned int count;
+	/** Packets received back */
+	atomic_t received;
+	/** Frame bytes received back */
+	atomic64_t rx_bytes;
+	/** Receive time of the last packet [nsec] */
+	atomic64_t last_rx_ns;
+	/** Round trip latency per sequence number [nsec], 0 if lost */
+	u32 *lat_ns;
+};
+
+/**
+ * @brief ether_perf_rx - Loopback perf test Rx handler
+ *
+ * Algorithm: Records the round trip latency of a looped back perf
+ * packet. The skb is shared with the stack and only read here.
+ *
+ * @param[in] skb: socket buffer pointer
+ * @param[in] ndev: Network device pointer
+ * @param[in] pt: Packet type for ethernet received packet
+ * @param[in] orig_dev: Original network device pointer
+ *
+ * @retval 0 always
+ */
+static int ether_perf_rx(struct sk_buff *skb, struct net_device *ndev,
+			 struct packet_type *pt, struct net_device *orig_ndev)
+{
+	struct ether_perf_ctxt *pctxt = pt->af_packet_priv;
+	struct ether_perf_hdr _phdr, *phdr;
+	struct ether_testhdr _thdr, *thdr;
+	struct udphdr _uhdr, *uhdr;
+	struct iphdr _ihdr, *ihdr;
+	unsigned int off;
+	u64 now = ktime_get_ns();
+	u64 lat;
+	u32 seq;
+
+	ihdr = skb_header_pointer(skb, 0, sizeof(_ihdr), &_ihdr);
+	if (!ihdr || ihdr->protocol != IPPROTO_UDP)
+		goto out;
+
+	off = 4U * ihdr->ihl;
+	uhdr = skb_header_pointer(skb, off, sizeof(_uhdr), &_uhdr);
+	if (!uhdr || uhdr->dest != htons(ETHER_UDP_TEST_PORT))
+		goto out;
+
+	off += sizeof(_uhdr);
+	thdr = skb_header_pointer(skb, off, sizeof(_thdr), &_thdr);
+	if (!thdr || thdr->magic != cpu_to_be64(ETHER_TEST_PKT_MAGIC))
+		goto out;
+
+	off += sizeof(_thdr);
+	phdr = skb_header_pointer(skb, off, sizeof(_phdr), &_phdr);
+	if (!phdr || be32_to_cpu(phdr->chan) != pctxt->chan)
+		goto out;
+
+	seq = be32_to_cpu(phdr->seq);
+	if (seq >= pctxt->count || pctxt->lat_ns[seq] != 0U)
+		goto out;
+
+	lat = now - be64_to_cpu(phdr->tstamp);
+	pctxt->lat_ns[seq] = clamp_t(u64, lat, 1U, U32_MAX);
+	atomic64_add(skb->len + ETH_HLEN, &pctxt->rx_bytes);
+	atomic64_set(&pctxt->last_rx_ns, now);
+	atomic_inc(&pctxt->received);
+	wake_up(&pctxt->wq);
+out:
+	kfree_skb(skb);
+	return 0;
+}
+
+static int ether_perf_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief ether_perf_xmit - Send one perf packet on a Tx queue
+ *
+ * Algorithm: Calls the driver transmit directly under the queue lock,
+ * like pktgen, so that the packet goes to the channel under test and
+ * the submit cost is measured without the qdisc.
+ *
+ * @param[in] pdata: Ethernet OSD private data
+ * @param[in] skb: Perf packet
+ * @param[in] qinx: Tx queue index
+ * @param[out] cpu_ns: CPU time of the transmit call is added here
+ *
+ * @retval NETDEV_TX_OK when the packet was queued to hardware.
+ * @retval NETDEV_TX_BUSY when the queue is stopped, skb is not consumed.
+ */
+static netdev_tx_t ether_perf_xmit(struct ether_priv_data *pdata,
+				   struct sk_buff *skb, unsigned int qinx,
+				   u64 *cpu_ns)
+{
+	struct net_device *ndev = pdata->ndev;
+	struct netdev_queue *txq = netdev_get_tx_queue(ndev, qinx);
+	netdev_tx_t ret = NETDEV_TX_BUSY;
+	u64 start;
+
+	local_bh_disable();
+	__netif_tx_lock(txq, smp_processor_id());
+	if (!netif_xmit_frozen_or_stopped(txq)) {
+		start = local_clock();
+		ret = netdev_start_xmit(skb, ndev, txq, false);
+		*cpu_ns += local_clock() - start;
+	}
+	__netif_tx_unlock(txq);
+	local_bh_enable();
+
+	return ret;
+}
+
+/**
+ * @brief ether_perf_run_chan - Loopback perf test of one DMA channel
+ *
+ * Algorithm:
+ * 1) Sends count packets on the Tx queue of the channel, keeping at
+ *    most window packets in flight.
+ * 2) Waits for the looped back packets and computes throughput,
+ *    latency percentiles and CPU time per packet.
+ *
+ * @param[in] pdata: Ethernet OSD private data
+ * @param[in] pctxt: Perf test context, lat_ns sized for count packets
+ * @param[in] qinx: Tx queue index of the channel
+ * @param[in] frame_size: Frame size without FCS [bytes]
+ * @param[in] window: Maximum packets in flight
+ * @param[out] res: Result of the channel run
+ *
+ * @retval zero on success.
+ * @retval negative value on failure.
+ */
+static int ether_perf_run_chan(struct ether_priv_data *pdata,
+			       struct ether_perf_ctxt *pctxt, unsigned int qinx,
+			       unsigned int frame_size, unsigned int window,
+			       struct ether_perf_chan *res)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct ether_packet_ctxt ctxt = { };
+	unsigned int chan = pctxt->chan;
+	u64 tx_ns = 0, tx_napi_ns, rx_napi_ns = 0, rx_napi_start = 0;
+	u64 first_tx_ns = 0;
+	struct ether_perf_hdr *phdr;
+	struct sk_buff *skb;
+	unsigned int seq, n, i, j;
+	int ret = 0;
+
+	ctxt.dst = pdata->ndev->dev_addr;
+	ctxt.size = frame_size - ETHER_TEST_PKT_SIZE;
+
+	memset(pctxt->lat_ns, 0, pctxt->count * sizeof(*pctxt->lat_ns));
+	atomic_set(&pctxt->received, 0);
+	atomic64_set(&pctxt->rx_bytes, 0);
+	atomic64_set(&pctxt->last_rx_ns, 0);
+
+	tx_napi_ns = pdata->tx_napi[chan]->perf_ns;
+	for (i = 0; i < osi_dma->num_dma_chans; i++)
+		rx_napi_start += pdata->rx_napi[osi_dma->dma_chans[i]]->perf_ns;
+
+	for (seq = 0; seq < pctxt->count; ) {
+		if (!wait_event_timeout(pctxt->wq,
+					seq - atomic_read(&pctxt->received) <
+					window,
+					msecs_to_jiffies(ETHER_PERF_TIMEOUT_MS)))
+			break;
+
+		skb = ether_test_get_udp_skb(pdata, &ctxt);
+		if (!skb) {
+			ret = -ENOMEM;
 			break;
 		}
+
+		skb_set_queue_mapping(skb, qinx);
+		phdr = (struct ether_perf_hdr *)(udp_hdr(skb) + 1);
+		phdr = (struct ether_perf_hdr *)((u8 *)phdr +
+						 sizeof(struct ether_testhdr));
+		phdr->seq = cpu_to_be32(seq);
+		phdr->chan = cpu_to_be32(chan);
+		phdr->tstamp = cpu_to_be64(ktime_get_ns());
+		if (seq == 0U)
+			first_tx_ns = be64_to_cpu(phdr->tstamp);
+
+		if (ether_perf_xmit(pdata, skb, qinx, &tx_ns) != NETDEV_TX_OK) {
+			/* Ring full, let Tx completion catch up */
+			kfree_skb(skb);
+			usleep_range(10, 20);
+			continue;
+		}
+		seq++;
 	}
 
-	/* Restart everything */
+	wait_event_timeout(pctxt->wq, atomic_read(&pctxt->received) == seq,
+			   msecs_to_jiffies(ETHER_PERF_TIMEOUT_MS));
+
+	res->chan = chan;
+	res->tx_pkts = seq;
+	res->rx_pkts = atomic_read(&pctxt->received);
+	res->rx_bytes = atomic64_read(&pctxt->rx_bytes);
+	if (res->rx_pkts > 0U)
+		res->elapsed_ns = atomic64_read(&pctxt->last_rx_ns) -
+				  first_tx_ns;
+
+	tx_napi_ns = pdata->tx_napi[chan]->perf_ns - tx_napi_ns;
+	for (i = 0; i < osi_dma->num_dma_chans; i++)
+		rx_napi_ns += pdata->rx_napi[osi_dma->dma_chans[i]]->perf_ns;
+	rx_napi_ns -= rx_napi_start;
+	if (res->tx_pkts > 0U)
+		res->tx_cpu_ns = div64_u64(tx_ns + tx_napi_ns, res->tx_pkts);
+	if (res->rx_pkts > 0U)
+		res->rx_cpu_ns = div64_u64(rx_napi_ns, res->rx_pkts);
+
+	/* Compact the latencies of received packets and sort them */
+	for (i = 0, n = 0; i < seq; i++) {
+		if (pctxt->lat_ns[i] != 0U)
+			pctxt->lat_ns[n++] = pctxt->lat_ns[i];
+	}
+	if (n > 0U) {
+		sort(pctxt->lat_ns, n, sizeof(*pctxt->lat_ns),
+		     ether_perf_cmp_u32, NULL);
+		j = n - 1U;
+		res->lat_p50_ns = pctxt->lat_ns[(j * 500ULL) / 1000U];
+		res->lat_p99_ns = pctxt->lat_ns[(j * 990ULL) / 1000U];
+		res->lat_p999_ns = pctxt->lat_ns[(j * 999ULL) / 1000U];
+		res->lat_max_ns = pctxt->lat_ns[j];
+	}
+
+	if (!ret && res->rx_pkts != res->tx_pkts)
+		ret = -ETIMEDOUT;
+
+	return ret;
+}
+
+/**
+ * @brief ether_selftest_perf - Loopback throughput and latency test
+ *
+ * Algorithm: Puts the interface in MAC or PHY loopback and runs
+ * ether_perf_run_chan() on every DMA channel in turn. Results are kept
+ * in pdata->perf. CPU time is taken from local_clock() in the transmit
+ * call and the NAPI polls while pdata->perf_active is set, so it is in
+ * nsec rather than cycles and includes time spent in the stack on Rx.
+ *
+ * @param[in] pdata: Ethernet OSD private data
+ * @param[in] phy_lb: Use PHY loopback instead of MAC loopback
+ * @param[in] frame_size: Frame size without FCS [bytes]
+ * @param[in] count: Packets to send per channel
+ * @param[in] window: Maximum packets in flight
+ *
+ * @note Must be called with rtnl held.
+ *
+ * @retval zero on success.
+ * @retval negative value on failure.
+ */
+int ether_selftest_perf(struct ether_priv_data *pdata, bool phy_lb,
+			unsigned int frame_size, unsigned int count,
+			unsigned int window)
+{
+	struct ether_perf_report *rep = &pdata->perf;
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct net_device *dev = pdata->ndev;
+	int lb = phy_lb ? ETHER_LOOPBACK_PHY : ETHER_LOOPBACK_MAC;
+	struct ether_perf_ctxt *pctxt;
+	int carrier, ret, err;
+	unsigned int i;
+
+	ASSERT_RTNL();
+
+	if (!netif_running(dev))
+		return -ENETDOWN;
+
+	if (frame_size < ETHER_PERF_MIN_FRAME ||
+	    frame_size > dev->mtu + ETH_HLEN || count == 0U ||
+	    count > ETHER_PERF_MAX_PKTS || window == 0U ||
+	    window > ETHER_PERF_MAX_WINDOW)
+		return -EINVAL;
+
+	memset(rep, 0, sizeof(*rep));
+	rep->phy_lb = phy_lb;
+	rep->frame_size = frame_size;
+	rep->count = count;
+	rep->window = window;
+
+	pctxt = kzalloc(sizeof(*pctxt), GFP_KERNEL);
+	if (!pctxt) {
+		rep->err = -ENOMEM;
+		return rep->err;
+	}
+
+	pctxt->lat_ns = vzalloc(array_size(count, sizeof(*pctxt->lat_ns)));
+	if (!pctxt->lat_ns) {
+		kfree(pctxt);
+		rep->err = -ENOMEM;
+		return rep->err;
+	}
+
+	init_waitqueue_head(&pctxt->wq);
+	pctxt->count = count;
+	pctxt->pt.type = htons(ETH_P_IP);
+	pctxt->pt.func = ether_perf_rx;
+	pctxt->pt.dev = dev;
+	pctxt->pt.af_packet_priv = pctxt;
+
+	carrier = netif_carrier_ok(dev);
+	netif_carrier_off(dev);
+
+	ret = ether_test_set_loopback(pdata, lb, true);
+	if (ret) {
+		netdev_err(dev, "Loopback is not supported\n");
+		goto out;
+	}
+
+	dev_add_pack(&pctxt->pt);
+	WRITE_ONCE(pdata->perf_active, true);
+
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		pctxt->chan = osi_dma->dma_chans[i];
+		err = ether_perf_run_chan(pdata, pctxt, i, frame_size, window,
+					  &rep->chans[i]);
+		rep->num_chans++;
+		if (err && !ret)
+			ret = err;
+		if (err == -ENOMEM)
+			break;
+	}
+
+	WRITE_ONCE(pdata->perf_active, false);
+	dev_remove_pack(&pctxt->pt);
+
+	(void)ether_test_set_loopback(pdata, lb, false);
+out:
 	if (carrier)
 		netif_carrier_on(dev);
+
+	vfree(pctxt->lat_ns);
+	kfree(pctxt);
+	rep->err = ret;
+	return ret;
 }
 
 /**
@@ -2543,6 +2543,69 @@ static DEVICE_ATTR(nvgro_dump, 0644,
 		   ether_nvgro_dump_show, NULL);
 #endif
 
+/**
+ * @brief Shows the current background MMC poll interval in msec.
+ *
+ * @param[in] dev: Device data.
+ * @param[in] attr: Device attribute
+ * @param[in] buf: Buffer to store the current MMC poll interval
+ */
+static ssize_t ether_mmc_poll_ms_show(struct device *dev,
+				      struct device_attribute *attr,
+				      char *buf)
+{
+	struct net_device *ndev = (struct net_device *)dev_get_drvdata(dev);
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", pdata->mmc_poll_ms);
+}
+
+/**
+ * @brief Set the background MMC poll interval in msec.
+ *
+ * Algorithm: MMC counters are read on demand by ndo_get_stats64 and
+ * ethtool -S, the background poll only protects the 32 bit hw counters
+ * from wrapping. New interval takes effect from the next poll.
+ *
+ * @param[in] dev: Device data.
+ * @param[in] attr: Device attribute
+ * @param[in] buf: Buffer which contains the poll interval in msec
+ * @param[in] size: size of buffer
+ *
+ * @return size of buffer.
+ */
+static ssize_t ether_mmc_poll_ms_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t size)
+{
+	struct net_device *ndev = (struct net_device *)dev_get_drvdata(dev);
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &val);
+	if (ret < 0 || val < ETHER_STATS_TIMER_MIN ||
+	    val > ETHER_STATS_TIMER_MAX) {
+		dev_err(pdata->dev,
+			"Invalid MMC poll interval, range %u - %u msec\n",
+			ETHER_STATS_TIMER_MIN, ETHER_STATS_TIMER_MAX);
+		return -EINVAL;
+	}
+
+	pdata->mmc_poll_ms = val;
+	ether_stats_timer_update(pdata);
+
+	return size;
+}
+
+/**
+ * @brief Sysfs attribute for background MMC poll interval
+ *
+ */
+static DEVICE_ATTR(mmc_poll_ms, 0644,
+		   ether_mmc_poll_ms_show,
+		   ether_mmc_poll_ms_store);
+
 #ifdef HSI_SUPPORT
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
 static int hsi_inject_err_fsi(unsigned int inst_id,
@@ -2728,6 +2791,7 @@ static struct attribute *ether_sysfs_attrs[] = {
 	&dev_attr_nvgro_stats.attr,
 	&dev_attr_nvgro_dump.attr,
 #endif
+	&dev_attr_mmc_poll_ms.attr,
 #ifdef HSI_SUPPORT
 	&dev_attr_hsi_enable.attr,
 #endif
@@ -3249,6 +3313,196 @@ static const struct file_operations ether_register_dump_fops = {
 	.release = single_release,
 };
 
+static int ether_tx_ts_latency_read(struct seq_file *seq, void *v)
+{
+	struct net_device *ndev = seq->private;
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	unsigned int i, chan;
+
+	seq_puts(seq, "Tx timestamp delivery latency (usec):\n");
+	seq_printf(seq, "\t%10s : %lu\n", "< 1",
+		   pdata->tx_ts_lat_hist[0]);
+	for (i = 1U; i < (ETHER_TX_TS_LAT_BUCKETS - 1U); i++) {
+		seq_printf(seq, "\t%4lu-%-5lu : %lu\n", BIT(i - 1U),
+			   BIT(i) - 1UL, pdata->tx_ts_lat_hist[i]);
+	}
+	seq_printf(seq, "\t>= %-7lu : %lu\n",
+		   BIT(ETHER_TX_TS_LAT_BUCKETS - 2U),
+		   pdata->tx_ts_lat_hist[ETHER_TX_TS_LAT_BUCKETS - 1U]);
+
+	seq_printf(seq, "Timed out: %lu\n", pdata->tx_ts_timeout_n);
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		seq_printf(seq, "Chan %u: pending %u, ring full drops %lu\n",
+			   chan, READ_ONCE(pdata->tx_ts_ring[chan].head) -
+			   READ_ONCE(pdata->tx_ts_ring[chan].tail),
+			   pdata->tx_ts_ring[chan].full_n);
+	}
+
+	return 0;
+}
+
+static int ether_tx_ts_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ether_tx_ts_latency_read, inode->i_private);
+}
+
+static const struct file_operations ether_tx_ts_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = ether_tx_ts_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int ether_tsn_latency_read(struct seq_file *seq, void *v)
+{
+	struct net_device *ndev = seq->private;
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct ether_tsn_lat lat[ETHER_TSN_MAX_TC];
+	unsigned long flags, unsync;
+	unsigned int i;
+
+	spin_lock_irqsave(&pdata->tsn_lat_lock, flags);
+	memcpy(lat, pdata->tsn_lat, sizeof(lat));
+	unsync = pdata->tsn_lat_unsync_n;
+	spin_unlock_irqrestore(&pdata->tsn_lat_lock, flags);
+
+	seq_printf(seq, "TSN validation mode: %s\n",
+		   (pdata->tsn_validation == OSI_ENABLE) ?
+		   "enabled" : "disabled");
+	seq_puts(seq, "Enqueue to egress latency (nsec):\n");
+	seq_printf(seq, "\t%-4s %12s %12s %12s %12s\n", "TC", "samples",
+		   "min", "avg", "max");
+	for (i = 0; i < ETHER_TSN_MAX_TC; i++) {
+		if (lat[i].samples == 0U) {
+			continue;
+		}
+
+		seq_printf(seq, "\t%-4u %12llu %12llu %12llu %12llu\n", i,
+			   lat[i].samples, lat[i].min_ns,
+			   div64_u64(lat[i].sum_ns, lat[i].samples),
+			   lat[i].max_ns);
+	}
+	seq_printf(seq, "Unsynced (egress before enqueue): %lu\n", unsync);
+
+	return 0;
+}
+
+static int ether_tsn_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ether_tsn_latency_read, inode->i_private);
+}
+
+static const struct file_operations ether_tsn_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = ether_tsn_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int ether_loopback_perf_read(struct seq_file *seq, void *v)
+{
+	struct net_device *ndev = seq->private;
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct ether_perf_report *rep;
+	struct ether_perf_chan *c;
+	unsigned int i;
+
+	rep = kmalloc(sizeof(*rep), GFP_KERNEL);
+	if (!rep)
+		return -ENOMEM;
+
+	rtnl_lock();
+	memcpy(rep, &pdata->perf, sizeof(*rep));
+	rtnl_unlock();
+
+	if (rep->count == 0U) {
+		seq_puts(seq, "No test run, write \"<mac|phy> [frame_size] [count] [window]\"\n");
+		goto out;
+	}
+
+	seq_printf(seq, "%s loopback, frame %u bytes, %u packets, window %u: %s (%d)\n",
+		   rep->phy_lb ? "PHY" : "MAC", rep->frame_size, rep->count,
+		   rep->window, rep->err ? "failed" : "passed", rep->err);
+	seq_printf(seq, "%-4s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n",
+		   "chan", "tx", "rx", "kpps", "Mbps", "p50_ns", "p99_ns",
+		   "p999_ns", "max_ns", "txcpu_ns", "rxcpu_ns");
+	for (i = 0; i < rep->num_chans; i++) {
+		c = &rep->chans[i];
+		seq_printf(seq, "%-4u %8llu %8llu %8llu %8llu %8llu %8llu %8llu %8llu %8llu %8llu\n",
+			   c->chan, c->tx_pkts, c->rx_pkts,
+			   c->elapsed_ns ?
+			   div64_u64(c->rx_pkts * 1000000ULL, c->elapsed_ns) : 0,
+			   c->elapsed_ns ?
+			   div64_u64(c->rx_bytes * 8000ULL, c->elapsed_ns) : 0,
+			   c->lat_p50_ns, c->lat_p99_ns, c->lat_p999_ns,
+			   c->lat_max_ns, c->tx_cpu_ns, c->rx_cpu_ns);
+	}
+out:
+	kfree(rep);
+	return 0;
+}
+
+static int ether_loopback_perf_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ether_loopback_perf_read, inode->i_private);
+}
+
+/**
+ * @brief ether_loopback_perf_write - Run the loopback perf test
+ *
+ * Algorithm: Parses "<mac|phy> [frame_size] [count] [window]" and runs
+ * ether_selftest_perf(). The write returns once the test is done.
+ */
+static ssize_t ether_loopback_perf_write(struct file *file,
+					 const char __user *ubuf,
+					 size_t count, loff_t *ppos)
+{
+	struct seq_file *seq = file->private_data;
+	struct net_device *ndev = seq->private;
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	unsigned int frame_size = ETH_FRAME_LEN, pkts = 10000U, window = 64U;
+	char buf[64], mode[4];
+	int ret;
+
+	if (count == 0U || count >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%3s %u %u %u", mode, &frame_size, &pkts,
+		   &window) < 1)
+		return -EINVAL;
+
+	if (strcmp(mode, "mac") != 0 && strcmp(mode, "phy") != 0)
+		return -EINVAL;
+
+	rtnl_lock();
+	ret = ether_selftest_perf(pdata, strcmp(mode, "phy") == 0,
+				  frame_size, pkts, window);
+	rtnl_unlock();
+
+	/* The report carries per channel results of a failed run too */
+	if (ret == -EINVAL || ret == -ENETDOWN)
+		return ret;
+
+	return count;
+}
+
+static const struct file_operations ether_loopback_perf_fops = {
+	.owner = THIS_MODULE,
+	.open = ether_loopback_perf_open,
+	.read = seq_read,
+	.write = ether_loopback_perf_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int ether_create_debugfs(struct ether_priv_data *pdata)
 {
 	char *buf;
@@ -3303,6 +3557,43 @@ static int ether_create_debugfs(struct ether_priv_data *pdata)
 		goto exit;
 	}
 
+	pdata->dbgfs_tx_ts_lat = debugfs_create_file("tx_ts_latency", S_IRUGO,
+						     pdata->dbgfs_dir,
+						     pdata->ndev,
+						     &ether_tx_ts_latency_fops);
+	if (!pdata->dbgfs_tx_ts_lat) {
+		netdev_err(pdata->ndev,
+			   "failed to create Tx timestamp latency debugfs\n");
+		debugfs_remove_recursive(pdata->dbgfs_dir);
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	pdata->dbgfs_tsn_lat = debugfs_create_file("tsn_latency", S_IRUGO,
+						   pdata->dbgfs_dir,
+						   pdata->ndev,
+						   &ether_tsn_latency_fops);
+	if (!pdata->dbgfs_tsn_lat) {
+		netdev_err(pdata->ndev,
+			   "failed to create TSN latency debugfs\n");
+		debugfs_remove_recursive(pdata->dbgfs_dir);
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	pdata->dbgfs_perf = debugfs_create_file("loopback_perf",
+						S_IRUGO | S_IWUSR,
+						pdata->dbgfs_dir,
+						pdata->ndev,
+						&ether_loopback_perf_fops);
+	if (!pdata->dbgfs_perf) {
+		netdev_err(pdata->ndev,
+			   "failed to create loopback perf debugfs\n");
+		debugfs_remove_recursive(pdata->dbgfs_dir);
+		ret = -ENOMEM;
+		goto exit;
+	}
+
 exit:
 	kfree(buf);
 	return ret;
@@ -19,14 +19,99 @@
 
 #include <linux/aer.h>
 #include <linux/etherdevice.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
 #include <linux/module.h>
 #include <linux/netdevice.h>
 #include <linux/pci.h>
 #include <linux/tegra_vnet.h>
 
+static unsigned int num_queues = TVNET_MAX_QUEUES;
+module_param(num_queues, uint, 0444);
+MODULE_PARM_DESC(num_queues,
+	"Maximum data queue pairs, limited by the endpoint and MSI-X vectors");
+
+static unsigned int tx_coalesce_frames = 16;
+module_param(tx_coalesce_frames, uint, 0644);
+MODULE_PARM_DESC(tx_coalesce_frames,
+	"Frames pushed to the endpoint before it is interrupted");
+
+static unsigned int tx_coalesce_usecs = 20;
+module_param(tx_coalesce_usecs, uint, 0644);
+MODULE_PARM_DESC(tx_coalesce_usecs,
+	"Maximum delay in us of the endpoint interrupt, 0 disables coalescing");
+
+#if ENABLE_DMA
+static unsigned int copybreak = 256;
+module_param(copybreak, uint, 0644);
+MODULE_PARM_DESC(copybreak,
+	"Linear packets up to this size are copied to the endpoint by CPU");
+
+static unsigned int tx_reap_us = 50;
+module_param(tx_reap_us, uint, 0644);
+MODULE_PARM_DESC(tx_reap_us,
+	"Interval in us to reclaim transmitted skbs while DMA is in flight");
+#endif
+
+struct tvnet_priv;
+struct tvnet_host_queue;
+
+#if ENABLE_DMA
+/* Mapping of a DMA linked list element, skb is set on the last one of it */
+struct tvnet_host_tx_buf {
+	struct sk_buff *skb;
+	struct tvnet_host_queue *q;
+	dma_addr_t iova;
+	u32 len;
+	bool page;
+	u64 dst_iova;
+};
+#endif
+
+/* EP DMA read channel used by host, shared by queues with the same channel */
+struct tvnet_host_dma {
+	struct tvnet_dma_desc *dma_desc;
+#if ENABLE_DMA
+	struct dma_desc_cnt desc_cnt;
+	struct tvnet_priv *tvnet;
+	/* EP address of dma_desc, as read back from the channel LLP register */
+	u64 llp_base;
+	struct tvnet_host_tx_buf *tx_buf;
+	/* Reclaims completed elements when xmit is idle */
+	struct hrtimer reap_timer;
+#endif
+	/* To serialize xmit of queues sharing this channel */
+	spinlock_t lock;
+	u32 chan;
+};
+
+struct tvnet_host_queue {
+	struct tvnet_priv *tvnet;
+	u32 qid;
+	struct napi_struct napi;
+	struct ep_ring_buf ep_mem;
+	struct host_ring_buf host_mem;
+	struct irq_md *irq_data;
+	struct tvnet_host_dma *dma;
+	struct list_head ep2h_empty_list;
+	/* To protect ep2h empty list */
+	spinlock_t ep2h_empty_lock;
+#if ENABLE_DMA
+	/* Packets of this queue in flight on DMA, protected by dma->lock */
+	u32 tx_pending;
+#endif
+	/* Frames pushed to EP since it was last interrupted */
+	atomic_t irq_pending;
+	struct hrtimer irq_timer;
+
+	struct tvnet_counter h2ep_empty;
+	struct tvnet_counter h2ep_full;
+	struct tvnet_counter ep2h_empty;
+	struct tvnet_counter ep2h_full;
+};
+
 struct tvnet_priv {
 	struct net_device *ndev;
-	struct napi_struct napi;
 	struct pci_dev *pdev;
 	void __iomem *mmio_base;
 	void __iomem *msix_tbl;
@@ -34,13 +119,14 @@ struct tvnet_priv {
 	struct bar_md *bar_md;
 	struct ep_ring_buf ep_mem;
 	struct host_ring_buf host_mem;
-	struct list_head ep2h_empty_list;
-	/* To protect ep2h empty list */
-	spinlock_t ep2h_empty_lock;
-	struct tvnet_dma_desc *dma_desc;
-#if ENABLE_DMA
-	struct dma_desc_cnt desc_cnt;
-#endif
+	/* Queues offered by EP, 0 if it has no queue_md */
+	u32 ep_num_queues;
+	u32 num_queues;
+	/* TVNET_F_* and buffer size of EP, from its CTRL_MSG_LINK_UP */
+	u32 peer_features;
+	u32 peer_max_frame;
+	struct tvnet_host_queue queues[TVNET_MAX_QUEUES];
+	struct tvnet_host_dma dma[DMA_RD_CHNL_NUM];
 	enum dir_link_state tx_link_state;
 	enum dir_link_state rx_link_state;
 	enum os_link_state os_link_state;
@@ -54,12 +140,14 @@ struct tvnet_priv {
 
 	struct tvnet_counter h2ep_ctrl;
 	struct tvnet_counter ep2h_ctrl;
-	struct tvnet_counter h2ep_empty;
-	struct tvnet_counter h2ep_full;
-	struct tvnet_counter ep2h_empty;
-	struct tvnet_counter ep2h_full;
 };
 
+/* MSI-X vector 0 is for ctrl, data queue N uses vector N + 1 */
+static inline int tvnet_host_data_vector(struct tvnet_priv *tvnet, u32 qid)
+{
+	return pci_irq_vector(tvnet->pdev, qid + 1);
+}
+
 #if ENABLE_DMA
 /* Program MSI settings in EP DMA for interrupts from EP DMA */
 static void tvnet_host_write_dma_msix_settings(struct tvnet_priv *tvnet)
@@ -96,9 +184,10 @@ static void tvnet_host_raise_ep_ctrl_irq(struct tvnet_priv *tvnet)
 	}
 }
 
-static void tvnet_host_raise_ep_data_irq(struct tvnet_priv *tvnet)
+static void tvnet_host_raise_ep_data_irq(struct tvnet_priv *tvnet,
+					 struct tvnet_host_queue *q)
 {
-	struct irq_md *irq = &tvnet->bar_md->irq_data;
+	struct irq_md *irq = q->irq_data;
 
 	if (irq->irq_type == IRQ_SIMPLE) {
 		/* Can write any value to generate sync point irq */
@@ -112,6 +201,41 @@ static void tvnet_host_raise_ep_data_irq(struct tvnet_priv *tvnet)
 	}
 }
 
+static void tvnet_host_notify_ep(struct tvnet_host_queue *q)
+{
+	/* EP refills H2EP_EMPTY_BUF from ctrl irq, data irq for full ones */
+	tvnet_host_raise_ep_ctrl_irq(q->tvnet);
+	tvnet_host_raise_ep_data_irq(q->tvnet, q);
+}
+
+/*
+ * Account a frame pushed to H2EP full ring, EP is interrupted once
+ * tx_coalesce_frames of them are pending or tx_coalesce_usecs passed.
+ */
+static void tvnet_host_notify_ep_coalesced(struct tvnet_host_queue *q)
+{
+	if (!tx_coalesce_usecs ||
+	    atomic_inc_return(&q->irq_pending) >= tx_coalesce_frames) {
+		atomic_set(&q->irq_pending, 0);
+		tvnet_host_notify_ep(q);
+	} else if (!hrtimer_is_queued(&q->irq_timer)) {
+		hrtimer_start(&q->irq_timer, us_to_ktime(tx_coalesce_usecs),
+			      HRTIMER_MODE_REL);
+	}
+}
+
+static enum hrtimer_restart tvnet_host_irq_timer(struct hrtimer *timer)
+{
+	struct tvnet_host_queue *q = container_of(timer,
+						  struct tvnet_host_queue,
+						  irq_timer);
+
+	if (atomic_xchg(&q->irq_pending, 0))
+		tvnet_host_notify_ep(q);
+
+	return HRTIMER_NORESTART;
+}
+
 static void tvnet_host_read_ctrl_msg(struct tvnet_priv *tvnet,
 				     struct ctrl_msg *msg)
 {
@@ -156,16 +280,18 @@ static int tvnet_host_write_ctrl_msg(struct tvnet_priv *tvnet,
 	return 0;
 }
 
-static void tvnet_host_alloc_empty_buffers(struct tvnet_priv *tvnet)
+static void tvnet_host_alloc_empty_buffers(struct tvnet_priv *tvnet,
+					   struct tvnet_host_queue *q)
 {
 	struct net_device *ndev = tvnet->ndev;
-	struct host_ring_buf *host_mem = &tvnet->host_mem;
+	struct host_ring_buf *host_mem = &q->host_mem;
 	struct data_msg *ep2h_empty_msg = host_mem->ep2h_empty_msgs;
 	struct ep2h_empty_list *ep2h_empty_ptr;
 	struct device *d = &tvnet->pdev->dev;
 	unsigned long flags;
+	u32 count = 0;
 
-	while (!tvnet_ivc_full(&tvnet->ep2h_empty)) {
+	while (!tvnet_ivc_full(&q->ep2h_empty)) {
 		struct sk_buff *skb;
 		dma_addr_t iova;
 		int len = ndev->mtu + ETH_HLEN;
@@ -197,11 +323,11 @@ static void tvnet_host_alloc_empty_buffers(struct tvnet_priv *tvnet)
 		ep2h_empty_ptr->skb = skb;
 		ep2h_empty_ptr->iova = iova;
 		ep2h_empty_ptr->len = len;
-		spin_lock_irqsave(&tvnet->ep2h_empty_lock, flags);
-		list_add_tail(&ep2h_empty_ptr->list, &tvnet->ep2h_empty_list);
-		spin_unlock_irqrestore(&tvnet->ep2h_empty_lock, flags);
+		spin_lock_irqsave(&q->ep2h_empty_lock, flags);
+		list_add_tail(&ep2h_empty_ptr->list, &q->ep2h_empty_list);
+		spin_unlock_irqrestore(&q->ep2h_empty_lock, flags);
 
-		idx = tvnet_ivc_get_wr_cnt(&tvnet->ep2h_empty) %
+		idx = tvnet_ivc_get_wr_cnt(&q->ep2h_empty) %
 					RING_COUNT;
 		ep2h_empty_msg[idx].u.empty_buffer.pcie_address = iova;
 		ep2h_empty_msg[idx].u.empty_buffer.buffer_len = len;
@@ -209,20 +335,24 @@ static void tvnet_host_alloc_empty_buffers(struct tvnet_priv *tvnet)
 		 * buffers are updated before updating counters.
 		 */
 		mb();
-		tvnet_ivc_advance_wr(&tvnet->ep2h_empty);
+		tvnet_ivc_advance_wr(&q->ep2h_empty);
+		count++;
+	}
 
+	/* One interrupt for the whole batch of empty buffers */
+	if (count)
 		tvnet_host_raise_ep_ctrl_irq(tvnet);
-	}
 }
 
-static void tvnet_host_free_empty_buffers(struct tvnet_priv *tvnet)
+static void tvnet_host_free_empty_buffers(struct tvnet_priv *tvnet,
+					  struct tvnet_host_queue *q)
 {
 	struct ep2h_empty_list *ep2h_empty_ptr, *temp;
 	struct device *d = &tvnet->pdev->dev;
 	unsigned long flags;
 
-	spin_lock_irqsave(&tvnet->ep2h_empty_lock, flags);
-	list_for_each_entry_safe(ep2h_empty_ptr, temp, &tvnet->ep2h_empty_list,
+	spin_lock_irqsave(&q->ep2h_empty_lock, flags);
+	list_for_each_entry_safe(ep2h_empty_ptr, temp, &q->ep2h_empty_list,
 				 list) {
 		list_del(&ep2h_empty_ptr->list);
 		dma_unmap_single(d, ep2h_empty_ptr->iova, ep2h_empty_ptr->len,
@@ -230,14 +360,14 @@ static void tvnet_host_free_empty_buffers(struct tvnet_priv *tvnet)
 		dev_kfree_skb_any(ep2h_empty_ptr->skb);
 		kfree(ep2h_empty_ptr);
 	}
-	spin_unlock_irqrestore(&tvnet->ep2h_empty_lock, flags);
+	spin_unlock_irqrestore(&q->ep2h_empty_lock, flags);
 }
 
 static void tvnet_host_stop_tx_queue(struct tvnet_priv *tvnet)
 {
 	struct net_device *ndev = tvnet->ndev;
 
-	netif_stop_queue(ndev);
+	netif_tx_stop_all_queues(ndev);
 	/* Get tx lock to make sure that there is no ongoing xmit */
 	netif_tx_lock(ndev);
 	netif_tx_unlock(ndev);
@@ -245,32 +375,39 @@ static void tvnet_host_stop_tx_queue(struct tvnet_priv *tvnet)
 
 static void tvnet_host_stop_rx_work(struct tvnet_priv *tvnet)
 {
+	u32 i;
+
 	/* wait for interrupt handle to return to ensure rx is stopped */
-	synchronize_irq(pci_irq_vector(tvnet->pdev, 1));
+	for (i = 0; i < tvnet->num_queues; i++)
+		synchronize_irq(tvnet_host_data_vector(tvnet, i));
 }
 
 static void tvnet_host_clear_data_msg_counters(struct tvnet_priv *tvnet)
 {
-	struct host_ring_buf *host_mem = &tvnet->host_mem;
-	struct host_own_cnt *host_cnt = host_mem->host_cnt;
-	struct ep_ring_buf *ep_mem = &tvnet->ep_mem;
-	struct ep_own_cnt *ep_cnt = ep_mem->ep_cnt;
-
-	host_cnt->ep2h_empty_wr_cnt = 0;
-	ep_cnt->ep2h_empty_rd_cnt = 0;
-	host_cnt->h2ep_full_wr_cnt = 0;
-	ep_cnt->h2ep_full_rd_cnt = 0;
+	struct host_own_cnt *host_cnt;
+	struct ep_own_cnt *ep_cnt;
+	u32 i;
+
+	for (i = 0; i < tvnet->num_queues; i++) {
+		host_cnt = tvnet->queues[i].host_mem.host_cnt;
+		ep_cnt = tvnet->queues[i].ep_mem.ep_cnt;
+
+		host_cnt->ep2h_empty_wr_cnt = 0;
+		ep_cnt->ep2h_empty_rd_cnt = 0;
+		host_cnt->h2ep_full_wr_cnt = 0;
+		ep_cnt->h2ep_full_rd_cnt = 0;
+	}
 }
 
 static void tvnet_host_update_link_state(struct net_device *ndev,
 					 enum os_link_state state)
 {
 	if (state == OS_LINK_STATE_UP) {
-		netif_start_queue(ndev);
+		netif_tx_start_all_queues(ndev);
 		netif_carrier_on(ndev);
 	} else if (state == OS_LINK_STATE_DOWN) {
 		netif_carrier_off(ndev);
-		netif_stop_queue(ndev);
+		netif_tx_stop_all_queues(ndev);
 	} else {
 		pr_err("%s: invalid sate: %d\n", __func__, state);
 	}
@@ -296,10 +433,14 @@ static void tvnet_host_update_link_sm(struct tvnet_priv *tvnet)
 static void tvnet_host_user_link_up_req(struct tvnet_priv *tvnet)
 {
 	struct ctrl_msg msg = {};
+	u32 i;
 
 	tvnet_host_clear_data_msg_counters(tvnet);
-	tvnet_host_alloc_empty_buffers(tvnet);
+	for (i = 0; i < tvnet->num_queues; i++)
+		tvnet_host_alloc_empty_buffers(tvnet, &tvnet->queues[i]);
 	msg.msg_id = CTRL_MSG_LINK_UP;
+	msg.u.link_up.features = TVNET_F_CSUM | TVNET_F_GSO;
+	msg.u.link_up.max_frame = tvnet->ndev->mtu + ETH_HLEN;
 	tvnet_host_write_ctrl_msg(tvnet, &msg);
 	tvnet->rx_link_state = DIR_LINK_STATE_UP;
 	tvnet_host_update_link_sm(tvnet);
@@ -315,8 +456,12 @@ static void tvnet_host_user_link_down_req(struct tvnet_priv *tvnet)
 	tvnet_host_update_link_sm(tvnet);
 }
 
-static void tvnet_host_rcv_link_up_msg(struct tvnet_priv *tvnet)
+static void tvnet_host_rcv_link_up_msg(struct tvnet_priv *tvnet,
+				       struct ctrl_msg *msg)
 {
+	/* Offloads are used from the next xmit, see ndo_features_check */
+	WRITE_ONCE(tvnet->peer_features, msg->u.link_up.features);
+	WRITE_ONCE(tvnet->peer_max_frame, msg->u.link_up.max_frame);
 	tvnet->tx_link_state = DIR_LINK_STATE_UP;
 	tvnet_host_update_link_sm(tvnet);
 }
@@ -335,9 +480,12 @@ static void tvnet_host_rcv_link_down_msg(struct tvnet_priv *tvnet)
 
 static void tvnet_host_rcv_link_down_ack(struct tvnet_priv *tvnet)
 {
+	u32 i;
+
 	/* Stop using empty buffers(which are full in rx) of local system */
 	tvnet_host_stop_rx_work(tvnet);
-	tvnet_host_free_empty_buffers(tvnet);
+	for (i = 0; i < tvnet->num_queues; i++)
+		tvnet_host_free_empty_buffers(tvnet, &tvnet->queues[i]);
 	tvnet->rx_link_state = DIR_LINK_STATE_DOWN;
 	wake_up_interruptible(&tvnet->link_state_wq);
 	tvnet_host_update_link_sm(tvnet);
@@ -346,11 +494,13 @@ static void tvnet_host_rcv_link_down_ack(struct tvnet_priv *tvnet)
 static int tvnet_host_open(struct net_device *ndev)
 {
 	struct tvnet_priv *tvnet = netdev_priv(ndev);
+	u32 i;
 
 	mutex_lock(&tvnet->link_state_lock);
 	if (tvnet->rx_link_state == DIR_LINK_STATE_DOWN)
 		tvnet_host_user_link_up_req(tvnet);
-	napi_enable(&tvnet->napi);
+	for (i = 0; i < tvnet->num_queues; i++)
+		napi_enable(&tvnet->queues[i].napi);
 	mutex_unlock(&tvnet->link_state_lock);
 
 	return 0;
@@ -360,9 +510,11 @@ static int tvnet_host_close(struct net_device *ndev)
 {
 	struct tvnet_priv *tvnet = netdev_priv(ndev);
 	int ret = 0;
+	u32 i;
 
 	mutex_lock(&tvnet->link_state_lock);
-	napi_disable(&tvnet->napi);
+	for (i = 0; i < tvnet->num_queues; i++)
+		napi_disable(&tvnet->queues[i].napi);
 	if (tvnet->rx_link_state == DIR_LINK_STATE_UP)
 		tvnet_host_user_link_down_req(tvnet);
 
@@ -399,6 +551,7 @@ static int tvnet_host_change_mtu(struct net_device *ndev, int new_mtu)
 
 	pr_info("changing MTU from %d to %d\n", ndev->mtu, new_mtu);
 	ndev->mtu = new_mtu;
+	netif_set_gso_max_size(ndev, new_mtu + ETH_HLEN);
 
 	if (set_down)
 		tvnet_host_open(ndev);
@@ -406,170 +559,373 @@ static int tvnet_host_change_mtu(struct net_device *ndev, int new_mtu)
 	return 0;
 }
 
+/* Pass a filled dst buffer on to EP, data must be in EP memory already */
+static void tvnet_host_push_h2ep_full(struct tvnet_host_queue *q,
+				      u64 dst_iova, struct sk_buff *skb)
+{
+	struct data_msg *h2ep_full_msg = q->host_mem.h2ep_full_msgs;
+	u32 wr_idx;
+
+	wr_idx = tvnet_ivc_get_wr_cnt(&q->h2ep_full) % RING_COUNT;
+	h2ep_full_msg[wr_idx].u.full_buffer.packet_size = skb->len;
+	h2ep_full_msg[wr_idx].u.full_buffer.pcie_address = dst_iova;
+	tvnet_offload_from_skb(skb, &h2ep_full_msg[wr_idx].u.full_buffer.offload);
+	h2ep_full_msg[wr_idx].msg_id = DATA_MSG_FULL_BUF;
+	/* BAR0 mmio address is wc mem, add mb to make sure that full
+	 * buffer is written before updating counters.
+	 */
+	mb();
+	tvnet_ivc_advance_wr(&q->h2ep_full);
+	tvnet_host_notify_ep_coalesced(q);
+}
+
+#if ENABLE_DMA
+/* Address of the linked list element the channel is on */
+static u64 tvnet_host_dma_llp(struct tvnet_priv *tvnet, u32 chan)
+{
+	u64 llp;
+
+	llp = dma_channel_rd(tvnet->dma_base, chan, DMA_LLP_LOW_OFF_RDCH);
+	llp |= (u64)dma_channel_rd(tvnet->dma_base, chan,
+				   DMA_LLP_HIGH_OFF_RDCH) << 32;
+
+	return llp;
+}
+
+static void tvnet_host_unmap_tx_buf(struct device *d,
+				    struct tvnet_host_tx_buf *buf)
+{
+	if (buf->page)
+		dma_unmap_page(d, buf->iova, buf->len, DMA_TO_DEVICE);
+	else
+		dma_unmap_single(d, buf->iova, buf->len, DMA_TO_DEVICE);
+}
+
+/*
+ * Complete the packets whose elements the channel has moved past: the data
+ * is in EP memory, so push the dst buffers to EP and free the skbs.
+ * Called with dma->lock held.
+ */
+static void tvnet_host_dma_reap(struct tvnet_host_dma *dma)
+{
+	struct tvnet_priv *tvnet = dma->tvnet;
+	struct dma_desc_cnt *desc_cnt = &dma->desc_cnt;
+	struct device *d = &tvnet->pdev->dev;
+	struct tvnet_host_tx_buf *buf;
+	unsigned long done_mask = 0;
+	u32 done, idx, qid;
+
+	if (desc_cnt->wr_cnt == desc_cnt->rd_cnt)
+		return;
+
+	done = tvnet_dma_desc_done(tvnet_host_dma_llp(tvnet, dma->chan),
+				   dma->llp_base, desc_cnt->rd_cnt);
+	done = min(done, desc_cnt->wr_cnt - desc_cnt->rd_cnt);
+
+	while (done--) {
+		idx = desc_cnt->rd_cnt % DMA_DESC_COUNT;
+		buf = &dma->tx_buf[idx];
+		/* Clear DMA cycle bit for the next pass over the ring */
+		dma->dma_desc[idx].ctrl_reg.ctrl_e.cb = 0;
+		tvnet_host_unmap_tx_buf(d, buf);
+		if (buf->skb) {
+			tvnet_host_push_h2ep_full(buf->q, buf->dst_iova,
+						  buf->skb);
+			buf->q->tx_pending--;
+			done_mask |= BIT(buf->q->qid);
+			dev_consume_skb_any(buf->skb);
+			buf->skb = NULL;
+		}
+		desc_cnt->rd_cnt++;
+	}
+	mb();
+
+	if (tvnet->os_link_state != OS_LINK_STATE_UP)
+		return;
+
+	for_each_set_bit(qid, &done_mask, TVNET_MAX_QUEUES)
+		netif_tx_wake_queue(netdev_get_tx_queue(tvnet->ndev, qid));
+}
+
+static enum hrtimer_restart tvnet_host_dma_reap_timer(struct hrtimer *timer)
+{
+	struct tvnet_host_dma *dma = container_of(timer, struct tvnet_host_dma,
+						  reap_timer);
+	enum hrtimer_restart restart = HRTIMER_NORESTART;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dma->lock, flags);
+	tvnet_host_dma_reap(dma);
+	/* xmit may have armed the timer again meanwhile */
+	if (dma->desc_cnt.wr_cnt != dma->desc_cnt.rd_cnt &&
+	    !hrtimer_is_queued(timer)) {
+		hrtimer_forward_now(timer, us_to_ktime(max(tx_reap_us, 1U)));
+		restart = HRTIMER_RESTART;
+	}
+	spin_unlock_irqrestore(&dma->lock, flags);
+
+	return restart;
+}
+
+/* Drop whatever is left in flight, the channel must be idle or reset */
+static void tvnet_host_dma_reset(struct tvnet_host_dma *dma)
+{
+	struct dma_desc_cnt *desc_cnt = &dma->desc_cnt;
+	struct device *d = &dma->tvnet->pdev->dev;
+	struct tvnet_host_tx_buf *buf;
+	unsigned long flags;
+
+	hrtimer_cancel(&dma->reap_timer);
+
+	spin_lock_irqsave(&dma->lock, flags);
+	for (; desc_cnt->rd_cnt != desc_cnt->wr_cnt; desc_cnt->rd_cnt++) {
+		buf = &dma->tx_buf[desc_cnt->rd_cnt % DMA_DESC_COUNT];
+		tvnet_host_unmap_tx_buf(d, buf);
+		if (buf->skb) {
+			buf->q->tx_pending--;
+			dev_kfree_skb_any(buf->skb);
+			buf->skb = NULL;
+		}
+	}
+	desc_cnt->wr_cnt = desc_cnt->rd_cnt = 0;
+	spin_unlock_irqrestore(&dma->lock, flags);
+}
+
+/*
+ * Add linked list elements reading the skb head and frags into consecutive
+ * dst_iova space, called with dma->lock held. The channel is not started.
+ */
+static int tvnet_host_dma_map_skb(struct tvnet_host_dma *dma,
+				  struct tvnet_host_queue *q,
+				  struct sk_buff *skb, u64 dst_iova)
+{
+	struct skb_shared_info *info = skb_shinfo(skb);
+	struct device *d = &dma->tvnet->pdev->dev;
+	struct dma_desc_cnt *desc_cnt = &dma->desc_cnt;
+	struct tvnet_host_tx_buf *buf;
+	struct tvnet_dma_desc *desc;
+	u32 i, j, idx, len, ctrl_d;
+	u64 dst = dst_iova;
+	dma_addr_t iova;
+
+	for (i = 0; i <= info->nr_frags; i++) {
+		idx = (desc_cnt->wr_cnt + i) % DMA_DESC_COUNT;
+		buf = &dma->tx_buf[idx];
+		if (i == 0) {
+			len = skb_headlen(skb);
+			iova = dma_map_single(d, skb->data, len, DMA_TO_DEVICE);
+		} else {
+			len = skb_frag_size(&info->frags[i - 1]);
+			iova = skb_frag_dma_map(d, &info->frags[i - 1], 0, len,
+						DMA_TO_DEVICE);
+		}
+		if (dma_mapping_error(d, iova)) {
+			pr_err("%s: dma map failed\n", __func__);
+			goto unmap;
+		}
+		buf->iova = iova;
+		buf->len = len;
+		buf->page = (i != 0);
+		buf->skb = NULL;
+
+		desc = &dma->dma_desc[idx];
+		desc->size = len;
+		desc->sar_low = lower_32_bits(iova);
+		desc->sar_high = upper_32_bits(iova);
+		desc->dar_low = lower_32_bits(dst);
+		desc->dar_high = upper_32_bits(dst);
+		dst += len;
+	}
+	buf->skb = skb;
+	buf->q = q;
+	buf->dst_iova = dst_iova;
+
+	/* CB bit should be set at the end */
+	mb();
+	/*
+	 * Set CB back to front, so that a running channel never sees the first
+	 * element of the packet before the others are ready.
+	 */
+	for (j = info->nr_frags + 1; j-- > 0;) {
+		idx = (desc_cnt->wr_cnt + j) % DMA_DESC_COUNT;
+		ctrl_d = DMA_CH_CONTROL1_OFF_RDCH_CB;
+		/* Interrupts only once the whole packet is done */
+		if (j == info->nr_frags) {
+			ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_RIE;
+			ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_LIE;
+		}
+		dma->dma_desc[idx].ctrl_reg.ctrl_d = ctrl_d;
+	}
+	/*
+	 * Read after write to avoid EP DMA reading LLE before CB is written to
+	 * EP's system memory.
+	 */
+	ctrl_d = dma->dma_desc[desc_cnt->wr_cnt % DMA_DESC_COUNT].ctrl_reg.ctrl_d;
+
+	desc_cnt->wr_cnt += info->nr_frags + 1;
+	q->tx_pending++;
+
+	return 0;
+
+unmap:
+	for (j = 0; j < i; j++)
+		tvnet_host_unmap_tx_buf(d, &dma->tx_buf[(desc_cnt->wr_cnt + j) %
+							DMA_DESC_COUNT]);
+
+	return -ENOMEM;
+}
+#endif
+
 static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 					 struct net_device *ndev)
 {
 	struct tvnet_priv *tvnet = netdev_priv(ndev);
-	struct host_ring_buf *host_mem = &tvnet->host_mem;
-	struct data_msg *h2ep_full_msg = host_mem->h2ep_full_msgs;
-	struct skb_shared_info *info = skb_shinfo(skb);
-	struct ep_ring_buf *ep_mem = &tvnet->ep_mem;
+	u16 qid = skb_get_queue_mapping(skb);
+	struct tvnet_host_queue *q = &tvnet->queues[qid];
+	struct netdev_queue *txq = netdev_get_tx_queue(ndev, qid);
+	struct ep_ring_buf *ep_mem = &q->ep_mem;
 	struct data_msg *h2ep_empty_msg = ep_mem->h2ep_empty_msgs;
-	struct device *d = &tvnet->pdev->dev;
 #if ENABLE_DMA
-	struct tvnet_dma_desc *dma_desc = tvnet->dma_desc;
-	struct dma_desc_cnt *desc_cnt = &tvnet->desc_cnt;
-	u32 desc_widx, desc_ridx, val;
-	u32 ctrl_d;
-	unsigned long timeout;
-#endif
+	struct tvnet_host_dma *dma = q->dma;
+	struct dma_desc_cnt *desc_cnt = &dma->desc_cnt;
+	unsigned long flags;
+	u32 nr_desc;
+	bool copy;
+#else
+	struct device *d = &tvnet->pdev->dev;
 	dma_addr_t src_iova;
+#endif
 	dma_addr_t dst_iova;
 	u32 rd_idx;
-	u32 wr_idx;
 	void *dst_virt;
 	int len;
 
+#if !ENABLE_DMA
 	/* TODO Not expecting skb frags, remove this after testing */
-	WARN_ON(info->nr_frags);
+	WARN_ON(skb_shinfo(skb)->nr_frags);
+#endif
 
 	/* Check if H2EP_EMPTY_BUF available to read */
-	if (!tvnet_ivc_rd_available(&tvnet->h2ep_empty)) {
+	if (!tvnet_ivc_rd_available(&q->h2ep_empty)) {
 		tvnet_host_raise_ep_ctrl_irq(tvnet);
 		pr_debug("%s: No H2EP empty msg, stop tx\n", __func__);
-		netif_stop_queue(ndev);
+		netif_tx_stop_queue(txq);
 		return NETDEV_TX_BUSY;
 	}
 
 	/* Check if H2EP_FULL_BUF available to write */
-	if (tvnet_ivc_full(&tvnet->h2ep_full)) {
+	if (tvnet_ivc_full(&q->h2ep_full)) {
 		tvnet_host_raise_ep_ctrl_irq(tvnet);
 		pr_debug("%s: No H2EP full buf, stop tx\n", __func__);
-		netif_stop_queue(ndev);
+		netif_tx_stop_queue(txq);
 		return NETDEV_TX_BUSY;
 	}
 
+	len = skb->len;
+
 #if ENABLE_DMA
-	/* Check if dma desc available */
-	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt) >= DMA_DESC_COUNT) {
+	/* Queues sharing the DMA channel are serialized on its ring */
+	spin_lock_irqsave(&dma->lock, flags);
+	tvnet_host_dma_reap(dma);
+
+	/*
+	 * Small packets are cheaper to copy than to DMA, unless an earlier
+	 * packet of this queue is still in flight and would be overtaken.
+	 */
+	copy = !skb_is_nonlinear(skb) && len <= copybreak && !q->tx_pending;
+
+	/* Check if dma descs available, one is left unused to tell full */
+	nr_desc = skb_shinfo(skb)->nr_frags + 1;
+	if (!copy && (desc_cnt->wr_cnt - desc_cnt->rd_cnt + nr_desc) >=
+	    DMA_DESC_COUNT) {
+		spin_unlock_irqrestore(&dma->lock, flags);
 		pr_debug("%s: dma descriptors are not available\n", __func__);
-		netif_stop_queue(ndev);
+		netif_tx_stop_queue(txq);
 		return NETDEV_TX_BUSY;
 	}
 #endif
 
-	len = skb_headlen(skb);
+	/* Get H2EP empty msg */
+	rd_idx = tvnet_ivc_get_rd_cnt(&q->h2ep_empty) %
+				RING_COUNT;
+	dst_iova = h2ep_empty_msg[rd_idx].u.empty_buffer.pcie_address;
+	dst_virt = (__force void *)tvnet->mmio_base + (dst_iova - tvnet->bar_md->bar0_base_phy);
 
+#if ENABLE_DMA
+	if (!copy && tvnet_host_dma_map_skb(dma, q, skb, dst_iova) < 0) {
+		spin_unlock_irqrestore(&dma->lock, flags);
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+#else
 	src_iova = dma_map_single(d, skb->data, len, DMA_TO_DEVICE);
 	if (dma_mapping_error(d, src_iova)) {
 		pr_err("%s: dma_map_single failed\n", __func__);
 		dev_kfree_skb_any(skb);
 		return NETDEV_TX_OK;
 	}
+#endif
 
-	/* Get H2EP empty msg */
-	rd_idx = tvnet_ivc_get_rd_cnt(&tvnet->h2ep_empty) %
-				RING_COUNT;
-	dst_iova = h2ep_empty_msg[rd_idx].u.empty_buffer.pcie_address;
-	dst_virt = (__force void *)tvnet->mmio_base + (dst_iova - tvnet->bar_md->bar0_base_phy);
 	/* Advance read count after all failure cases complated, to avoid
 	 * dangling buffer at endpoint.
 	 */
-	tvnet_ivc_advance_rd(&tvnet->h2ep_empty);
-	/* Raise an interrupt to let EP populate H2EP_EMPTY_BUF ring */
-	tvnet_host_raise_ep_ctrl_irq(tvnet);
+	tvnet_ivc_advance_rd(&q->h2ep_empty);
 
 #if ENABLE_DMA
-	/* Trigger DMA write from src_iova to dst_iova */
-	desc_widx = desc_cnt->wr_cnt % DMA_DESC_COUNT;
-	dma_desc[desc_widx].size = len;
-	dma_desc[desc_widx].sar_low = lower_32_bits(src_iova);
-	dma_desc[desc_widx].sar_high = upper_32_bits(src_iova);
-	dma_desc[desc_widx].dar_low = lower_32_bits(dst_iova);
-	dma_desc[desc_widx].dar_high = upper_32_bits(dst_iova);
-	/* CB bit should be set at the end */
-	mb();
-	/* RIE is not required for polling mode */
-	ctrl_d = DMA_CH_CONTROL1_OFF_RDCH_RIE;
-	ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_LIE;
-	ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_CB;
-	dma_desc[desc_widx].ctrl_reg.ctrl_d = ctrl_d;
-	/*
-	 * Read after write to avoid EP DMA reading LLE before CB is written to
-	 * EP's system memory.
-	 */
-	ctrl_d = dma_desc[desc_widx].ctrl_reg.ctrl_d;
-
-	/* DMA write should not go out of order wrt CB bit set */
-	mb();
-
-	timeout = jiffies + msecs_to_jiffies(1000);
-	dma_common_wr(tvnet->dma_base, DMA_RD_DATA_CH, DMA_READ_DOORBELL_OFF);
-
-	desc_cnt->wr_cnt++;
+	if (!copy) {
+		/* DMA write should not go out of order wrt CB bit set */
+		mb();
+		dma_common_wr(tvnet->dma_base, dma->chan, DMA_READ_DOORBELL_OFF);
+		/* skb is freed and pushed to H2EP full ring once DMA is done */
+		if (!hrtimer_is_queued(&dma->reap_timer))
+			hrtimer_start(&dma->reap_timer,
+				      us_to_ktime(max(tx_reap_us, 1U)),
+				      HRTIMER_MODE_REL);
+		spin_unlock_irqrestore(&dma->lock, flags);
 
-	while (true) {
-		val = dma_common_rd(tvnet->dma_base, DMA_READ_INT_STATUS_OFF);
-		if (val == BIT(DMA_RD_DATA_CH)) {
-			dma_common_wr(tvnet->dma_base, val,
-				      DMA_READ_INT_CLEAR_OFF);
-			break;
-		}
-		if (time_after(jiffies, timeout)) {
-			pr_err("dma took more time, reset dma engine\n");
-			dma_common_wr(tvnet->dma_base,
-				      DMA_READ_ENGINE_EN_OFF_DISABLE,
-				      DMA_READ_ENGINE_EN_OFF);
-			mdelay(1);
-			dma_common_wr(tvnet->dma_base,
-				      DMA_READ_ENGINE_EN_OFF_ENABLE,
-				      DMA_READ_ENGINE_EN_OFF);
-			desc_cnt->wr_cnt--;
-			dma_unmap_single(d, src_iova, len, DMA_TO_DEVICE);
-			return NETDEV_TX_BUSY;
-		}
+		return NETDEV_TX_OK;
 	}
+#endif
 
-	desc_ridx = tvnet->desc_cnt.rd_cnt % DMA_DESC_COUNT;
-	/* Clear DMA cycle bit and increment rd_cnt */
-	dma_desc[desc_ridx].ctrl_reg.ctrl_e.cb = 0;
-	mb();
-
-	tvnet->desc_cnt.rd_cnt++;
-#else
 	/* Copy skb->data to endpoint dst address, use CPU virt addr */
 	memcpy(dst_virt, skb->data, len);
 	/* BAR0 mmio address is wc mem, add mb to make sure that complete
 	 * skb->data is written before updating counters.
 	 */
 	mb();
-#endif
 
 	/* Push dst to H2EP full ring */
-	wr_idx = tvnet_ivc_get_wr_cnt(&tvnet->h2ep_full) %
-				RING_COUNT;
-	h2ep_full_msg[wr_idx].u.full_buffer.packet_size = len;
-	h2ep_full_msg[wr_idx].u.full_buffer.pcie_address = dst_iova;
-	h2ep_full_msg[wr_idx].msg_id = DATA_MSG_FULL_BUF;
-	/* BAR0 mmio address is wc mem, add mb to make sure that full
-	 * buffer is written before updating counters.
-	 */
-	mb();
-	tvnet_ivc_advance_wr(&tvnet->h2ep_full);
-	tvnet_host_raise_ep_data_irq(tvnet);
+	tvnet_host_push_h2ep_full(q, dst_iova, skb);
+#if ENABLE_DMA
+	spin_unlock_irqrestore(&dma->lock, flags);
+#endif
 
 	/* Free skb */
+#if !ENABLE_DMA
 	dma_unmap_single(d, src_iova, len, DMA_TO_DEVICE);
+#endif
 	dev_kfree_skb_any(skb);
 
 	return NETDEV_TX_OK;
 }
 
+static netdev_features_t tvnet_host_features_check(struct sk_buff *skb,
+						   struct net_device *ndev,
+						   netdev_features_t features)
+{
+	struct tvnet_priv *tvnet = netdev_priv(ndev);
+
+	return tvnet_features_check(skb, features,
+				    READ_ONCE(tvnet->peer_features),
+				    READ_ONCE(tvnet->peer_max_frame));
+}
+
 static const struct net_device_ops tvnet_host_netdev_ops = {
 	.ndo_open = tvnet_host_open,
 	.ndo_stop = tvnet_host_close,
 	.ndo_start_xmit	= tvnet_host_start_xmit,
 	.ndo_change_mtu = tvnet_host_change_mtu,
+	.ndo_features_check = tvnet_host_features_check,
 };
 
 static void tvnet_host_setup_bar0_md(struct tvnet_priv *tvnet)
@@ -583,35 +939,107 @@ static void tvnet_host_setup_bar0_md(struct tvnet_priv *tvnet)
 					tvnet->bar_md->ep_own_cnt_offset);
 	ep_mem->ep2h_ctrl_msgs = (__force struct ctrl_msg *)(tvnet->mmio_base +
 					tvnet->bar_md->ctrl_md.ep2h_offset);
-	ep_mem->ep2h_full_msgs = (__force struct data_msg *)(tvnet->mmio_base +
-					tvnet->bar_md->ep2h_md.ep2h_offset);
-	ep_mem->h2ep_empty_msgs = (__force struct data_msg *)(tvnet->mmio_base +
-					tvnet->bar_md->h2ep_md.ep2h_offset);
 
 	host_mem->host_cnt = (__force struct host_own_cnt *)(tvnet->mmio_base +
 					tvnet->bar_md->host_own_cnt_offset);
 	host_mem->h2ep_ctrl_msgs = (__force struct ctrl_msg *)(tvnet->mmio_base +
 					tvnet->bar_md->ctrl_md.h2ep_offset);
-	host_mem->ep2h_empty_msgs = (__force struct data_msg *)(tvnet->mmio_base +
-					tvnet->bar_md->ep2h_md.h2ep_offset);
-	host_mem->h2ep_full_msgs = (__force struct data_msg *)(tvnet->mmio_base +
-					tvnet->bar_md->h2ep_md.h2ep_offset);
-
-	tvnet->dma_desc = (__force struct tvnet_dma_desc *)(tvnet->mmio_base +
-					tvnet->bar_md->host_dma_offset);
 
 	tvnet->h2ep_ctrl.rd = &ep_mem->ep_cnt->h2ep_ctrl_rd_cnt;
 	tvnet->h2ep_ctrl.wr = &host_mem->host_cnt->h2ep_ctrl_wr_cnt;
 	tvnet->ep2h_ctrl.rd = &host_mem->host_cnt->ep2h_ctrl_rd_cnt;
 	tvnet->ep2h_ctrl.wr = &ep_mem->ep_cnt->ep2h_ctrl_wr_cnt;
-	tvnet->h2ep_empty.rd = &host_mem->host_cnt->h2ep_empty_rd_cnt;
-	tvnet->h2ep_empty.wr = &ep_mem->ep_cnt->h2ep_empty_wr_cnt;
-	tvnet->h2ep_full.rd = &ep_mem->ep_cnt->h2ep_full_rd_cnt;
-	tvnet->h2ep_full.wr = &host_mem->host_cnt->h2ep_full_wr_cnt;
-	tvnet->ep2h_empty.rd = &ep_mem->ep_cnt->ep2h_empty_rd_cnt;
-	tvnet->ep2h_empty.wr = &host_mem->host_cnt->ep2h_empty_wr_cnt;
-	tvnet->ep2h_full.rd = &host_mem->host_cnt->ep2h_full_rd_cnt;
-	tvnet->ep2h_full.wr = &ep_mem->ep_cnt->ep2h_full_wr_cnt;
+
+	/*
+	 * Old endpoints do not clear metadata beyond the legacy fields, only
+	 * trust queue_md if queue 0 matches the legacy layout.
+	 */
+	tvnet->ep_num_queues = tvnet->bar_md->num_queues;
+	if (tvnet->ep_num_queues > TVNET_MAX_QUEUES ||
+	    tvnet->bar_md->queue_md[0].ep_own_cnt_offset !=
+	    tvnet->bar_md->ep_own_cnt_offset ||
+	    tvnet->bar_md->queue_md[0].h2ep_md.h2ep_offset !=
+	    tvnet->bar_md->h2ep_md.h2ep_offset)
+		tvnet->ep_num_queues = 0;
+}
+
+/* Setup rings of a data queue, endpoints without queue_md have only queue 0 */
+static int tvnet_host_setup_queue_md(struct tvnet_priv *tvnet, u32 qid)
+{
+	struct tvnet_host_queue *q = &tvnet->queues[qid];
+	struct ep_ring_buf *ep_mem = &q->ep_mem;
+	struct host_ring_buf *host_mem = &q->host_mem;
+	struct bar_md *bar_md = tvnet->bar_md;
+	struct ring_buf_md *ep2h_md, *h2ep_md;
+	u32 ep_cnt_offset, host_cnt_offset, dma_offset, chan;
+
+	if (tvnet->ep_num_queues) {
+		struct queue_md *queue_md = &bar_md->queue_md[qid];
+
+		q->irq_data = &queue_md->irq_data;
+		ep_cnt_offset = queue_md->ep_own_cnt_offset;
+		host_cnt_offset = queue_md->host_own_cnt_offset;
+		ep2h_md = &queue_md->ep2h_md;
+		h2ep_md = &queue_md->h2ep_md;
+		dma_offset = queue_md->host_dma_offset;
+		chan = queue_md->host_dma_chan;
+	} else {
+		q->irq_data = &bar_md->irq_data;
+		ep_cnt_offset = bar_md->ep_own_cnt_offset;
+		host_cnt_offset = bar_md->host_own_cnt_offset;
+		ep2h_md = &bar_md->ep2h_md;
+		h2ep_md = &bar_md->h2ep_md;
+		dma_offset = bar_md->host_dma_offset;
+		chan = DMA_RD_DATA_CH;
+	}
+
+	if (chan >= DMA_RD_CHNL_NUM) {
+		dev_err(&tvnet->pdev->dev, "queue %u: invalid DMA channel %u\n",
+			qid, chan);
+		return -EINVAL;
+	}
+
+	ep_mem->ep_cnt = (__force struct ep_own_cnt *)(tvnet->mmio_base +
+					ep_cnt_offset);
+	ep_mem->ep2h_full_msgs = (__force struct data_msg *)(tvnet->mmio_base +
+					ep2h_md->ep2h_offset);
+	ep_mem->h2ep_empty_msgs = (__force struct data_msg *)(tvnet->mmio_base +
+					h2ep_md->ep2h_offset);
+
+	host_mem->host_cnt = (__force struct host_own_cnt *)(tvnet->mmio_base +
+					host_cnt_offset);
+	host_mem->ep2h_empty_msgs = (__force struct data_msg *)(tvnet->mmio_base +
+					ep2h_md->h2ep_offset);
+	host_mem->h2ep_full_msgs = (__force struct data_msg *)(tvnet->mmio_base +
+					h2ep_md->h2ep_offset);
+
+	q->dma = &tvnet->dma[chan];
+	q->dma->chan = chan;
+	q->dma->dma_desc = (__force struct tvnet_dma_desc *)(tvnet->mmio_base +
+					dma_offset);
+#if ENABLE_DMA
+	/* EP points the channel at the start of its ring on link up */
+	q->dma->llp_base = tvnet_host_dma_llp(tvnet, chan);
+#endif
+
+	q->h2ep_empty.rd = &host_mem->host_cnt->h2ep_empty_rd_cnt;
+	q->h2ep_empty.wr = &ep_mem->ep_cnt->h2ep_empty_wr_cnt;
+	q->h2ep_full.rd = &ep_mem->ep_cnt->h2ep_full_rd_cnt;
+	q->h2ep_full.wr = &host_mem->host_cnt->h2ep_full_wr_cnt;
+	q->ep2h_empty.rd = &ep_mem->ep_cnt->ep2h_empty_rd_cnt;
+	q->ep2h_empty.wr = &host_mem->host_cnt->ep2h_empty_wr_cnt;
+	q->ep2h_full.rd = &host_mem->host_cnt->ep2h_full_rd_cnt;
+	q->ep2h_full.wr = &ep_mem->ep_cnt->ep2h_full_wr_cnt;
+
+	q->tvnet = tvnet;
+	q->qid = qid;
+	INIT_LIST_HEAD(&q->ep2h_empty_list);
+	spin_lock_init(&q->ep2h_empty_lock);
+	atomic_set(&q->irq_pending, 0);
+	hrtimer_init(&q->irq_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	q->irq_timer.function = tvnet_host_irq_timer;
+
+	return 0;
 }
 
 static void tvnet_host_process_ctrl_msg(struct tvnet_priv *tvnet)
@@ -621,7 +1049,7 @@ static void tvnet_host_process_ctrl_msg(struct tvnet_priv *tvnet)
 	while (tvnet_ivc_rd_available(&tvnet->ep2h_ctrl)) {
 		tvnet_host_read_ctrl_msg(tvnet, &msg);
 		if (msg.msg_id == CTRL_MSG_LINK_UP)
-			tvnet_host_rcv_link_up_msg(tvnet);
+			tvnet_host_rcv_link_up_msg(tvnet, &msg);
 		else if (msg.msg_id == CTRL_MSG_LINK_DOWN)
 			tvnet_host_rcv_link_down_msg(tvnet);
 		else if (msg.msg_id == CTRL_MSG_LINK_DOWN_ACK)
@@ -629,9 +1057,10 @@ static void tvnet_host_process_ctrl_msg(struct tvnet_priv *tvnet)
 	}
 }
 
-static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet)
+static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet,
+				       struct tvnet_host_queue *q)
 {
-	struct ep_ring_buf *ep_mem = &tvnet->ep_mem;
+	struct ep_ring_buf *ep_mem = &q->ep_mem;
 	struct data_msg *data_msg = ep_mem->ep2h_full_msgs;
 	struct device *d = &tvnet->pdev->dev;
 	struct ep2h_empty_list *ep2h_empty_ptr;
@@ -639,7 +1068,8 @@ static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet)
 	int count = 0;
 
 	while ((count < TVNET_NAPI_WEIGHT) &&
-	       tvnet_ivc_rd_available(&tvnet->ep2h_full)) {
+	       tvnet_ivc_rd_available(&q->ep2h_full)) {
+		struct tvnet_offload offload;
 		struct sk_buff *skb;
 		u64 pcie_address;
 		u32 len;
@@ -647,13 +1077,14 @@ static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet)
 		unsigned long flags;
 
 		/* Read EP2H full msg */
-		idx = tvnet_ivc_get_rd_cnt(&tvnet->ep2h_full) %
+		idx = tvnet_ivc_get_rd_cnt(&q->ep2h_full) %
 					RING_COUNT;
 		len = data_msg[idx].u.full_buffer.packet_size;
 		pcie_address = data_msg[idx].u.full_buffer.pcie_address;
+		offload = data_msg[idx].u.full_buffer.offload;
 
-		spin_lock_irqsave(&tvnet->ep2h_empty_lock, flags);
-		list_for_each_entry(ep2h_empty_ptr, &tvnet->ep2h_empty_list,
+		spin_lock_irqsave(&q->ep2h_empty_lock, flags);
+		list_for_each_entry(ep2h_empty_ptr, &q->ep2h_empty_list,
 				    list) {
 			if (ep2h_empty_ptr->iova == pcie_address) {
 				list_del(&ep2h_empty_ptr->list);
@@ -661,29 +1092,39 @@ static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet)
 				break;
 			}
 		}
-		spin_unlock_irqrestore(&tvnet->ep2h_empty_lock, flags);
+		spin_unlock_irqrestore(&q->ep2h_empty_lock, flags);
 
 		/* Advance H2EP full buffer after search in local list */
-		tvnet_ivc_advance_rd(&tvnet->ep2h_full);
+		tvnet_ivc_advance_rd(&q->ep2h_full);
 		if (WARN_ON(!found))
 			continue;
 
-		/* If EP2H network queue is stopped due to lack of EP2H_FULL
-		 * queue, raising ctrl irq will help.
-		 */
-		tvnet_host_raise_ep_ctrl_irq(tvnet);
-
 		dma_unmap_single(d, pcie_address, ndev->mtu + ETH_HLEN, DMA_FROM_DEVICE);
 		skb = ep2h_empty_ptr->skb;
 		skb_put(skb, len);
-		skb->protocol = eth_type_trans(skb, ndev);
-		napi_gro_receive(&tvnet->napi, skb);
+		/* Peers without offload support leave offload unwritten */
+		if (tvnet->peer_features &&
+		    tvnet_offload_to_skb(skb, &offload) < 0) {
+			pr_debug("%s: invalid offload from EP\n", __func__);
+			ndev->stats.rx_errors++;
+			dev_kfree_skb_any(skb);
+		} else {
+			skb->protocol = eth_type_trans(skb, ndev);
+			skb_record_rx_queue(skb, q->qid);
+			napi_gro_receive(&q->napi, skb);
+		}
 
 		/* Free EP2H empty list element */
 		kfree(ep2h_empty_ptr);
 		count++;
 	}
 
+	/* If EP2H network queue is stopped due to lack of EP2H_FULL
+	 * queue, raising ctrl irq will help.
+	 */
+	if (count)
+		tvnet_host_raise_ep_ctrl_irq(tvnet);
+
 	return count;
 }
 
@@ -691,34 +1132,51 @@ static irqreturn_t tvnet_irq_ctrl(int irq, void *data)
 {
 	struct net_device *ndev = data;
 	struct tvnet_priv *tvnet = netdev_priv(ndev);
+	struct tvnet_host_queue *q;
+	struct netdev_queue *txq;
+	u32 i;
+
+#if ENABLE_DMA
+	/* EP DMA done of the last element of a packet (RIE) lands here too */
+	for (i = 0; i < DMA_RD_CHNL_NUM; i++) {
+		spin_lock(&tvnet->dma[i].lock);
+		tvnet_host_dma_reap(&tvnet->dma[i]);
+		spin_unlock(&tvnet->dma[i].lock);
+	}
+#endif
 
-	if (netif_queue_stopped(ndev)) {
-		if ((tvnet->os_link_state == OS_LINK_STATE_UP) &&
-		    tvnet_ivc_rd_available(&tvnet->h2ep_empty) &&
-		    !tvnet_ivc_full(&tvnet->h2ep_full)) {
-			pr_debug("%s: wake net tx queue\n", __func__);
-			netif_wake_queue(ndev);
+	for (i = 0; i < tvnet->num_queues; i++) {
+		q = &tvnet->queues[i];
+		txq = netdev_get_tx_queue(ndev, i);
+		if (netif_tx_queue_stopped(txq) &&
+		    (tvnet->os_link_state == OS_LINK_STATE_UP) &&
+		    tvnet_ivc_rd_available(&q->h2ep_empty) &&
+		    !tvnet_ivc_full(&q->h2ep_full)) {
+			pr_debug("%s: wake net tx queue %u\n", __func__, i);
+			netif_tx_wake_queue(txq);
 		}
 	}
 
 	if (tvnet_ivc_rd_available(&tvnet->ep2h_ctrl))
 		tvnet_host_process_ctrl_msg(tvnet);
 
-	if (!tvnet_ivc_full(&tvnet->ep2h_empty) &&
-	    (tvnet->os_link_state == OS_LINK_STATE_UP))
-		tvnet_host_alloc_empty_buffers(tvnet);
+	for (i = 0; i < tvnet->num_queues; i++) {
+		q = &tvnet->queues[i];
+		if (!tvnet_ivc_full(&q->ep2h_empty) &&
+		    (tvnet->os_link_state == OS_LINK_STATE_UP))
+			tvnet_host_alloc_empty_buffers(tvnet, q);
+	}
 
 	return IRQ_HANDLED;
 }
 
 static irqreturn_t tvnet_irq_data(int irq, void *data)
 {
-	struct net_device *ndev = data;
-	struct tvnet_priv *tvnet = netdev_priv(ndev);
+	struct tvnet_host_queue *q = data;
 
-	if (tvnet_ivc_rd_available(&tvnet->ep2h_full)) {
-		disable_irq_nosync(pci_irq_vector(tvnet->pdev, 1));
-		napi_schedule(&tvnet->napi);
+	if (tvnet_ivc_rd_available(&q->ep2h_full)) {
+		disable_irq_nosync(irq);
+		napi_schedule(&q->napi);
 	}
 
 	return IRQ_HANDLED;
@@ -726,28 +1184,68 @@ static irqreturn_t tvnet_irq_data(int irq, void *data)
 
 static int tvnet_host_poll(struct napi_struct *napi, int budget)
 {
-	struct tvnet_priv *tvnet = container_of(napi, struct tvnet_priv, napi);
+	struct tvnet_host_queue *q = container_of(napi, struct tvnet_host_queue,
+						  napi);
+	struct tvnet_priv *tvnet = q->tvnet;
 	int work_done;
 
-	work_done = tvnet_host_process_ep2h_msg(tvnet);
+	work_done = tvnet_host_process_ep2h_msg(tvnet, q);
 	if (work_done < budget) {
 		napi_complete(napi);
-		enable_irq(pci_irq_vector(tvnet->pdev, 1));
+		enable_irq(tvnet_host_data_vector(tvnet, q->qid));
 	}
 
 	return work_done;
 }
 
+static void tvnet_host_free_data_irqs(struct tvnet_priv *tvnet, u32 count)
+{
+	u32 i;
+
+	for (i = 0; i < count; i++)
+		free_irq(tvnet_host_data_vector(tvnet, i), &tvnet->queues[i]);
+}
+
+static int tvnet_host_request_data_irqs(struct tvnet_priv *tvnet)
+{
+	struct pci_dev *pdev = tvnet->pdev;
+	const struct cpumask *mask;
+	int ret;
+	u32 i;
+
+	for (i = 0; i < tvnet->num_queues; i++) {
+		ret = request_irq(tvnet_host_data_vector(tvnet, i),
+				  tvnet_irq_data, 0, tvnet->ndev->name,
+				  &tvnet->queues[i]);
+		if (ret < 0) {
+			dev_err(&pdev->dev, "request_irq() fail: %d\n", ret);
+			tvnet_host_free_data_irqs(tvnet, i);
+			return ret;
+		}
+
+		/* Transmit from the CPUs which also receive on this queue */
+		mask = pci_irq_get_affinity(pdev, i + 1);
+		if (mask)
+			netif_set_xps_queue(tvnet->ndev, mask, i);
+	}
+
+	return 0;
+}
+
 static int tvnet_host_probe(struct pci_dev *pdev,
 			    const struct pci_device_id *pci_id)
 {
+	struct irq_affinity affd = { .pre_vectors = 1 };
+	struct tvnet_host_dma *dma;
 	struct tvnet_priv *tvnet;
 	struct net_device *ndev;
+	u32 i, nq;
 	int ret;
 
 	dev_dbg(&pdev->dev, "%s: PCIe VID: 0x%x DID: 0x%x\n", __func__,
 		pci_id->vendor, pci_id->device);
-	ndev = alloc_etherdev(sizeof(struct tvnet_priv));
+	ndev = alloc_etherdev_mqs(sizeof(struct tvnet_priv), TVNET_MAX_QUEUES,
+				  TVNET_MAX_QUEUES);
 	if (!ndev) {
 		ret = -ENOMEM;
 		dev_err(&pdev->dev, "alloc_etherdev() failed");
@@ -815,20 +1313,64 @@ static int tvnet_host_probe(struct pci_dev *pdev,
 	/* Setup BAR0 meta data */
 	tvnet_host_setup_bar0_md(tvnet);
 
+	/* One data vector per queue, spread over CPUs, in addition to ctrl */
+	nq = tvnet->ep_num_queues ? tvnet->ep_num_queues : 1;
+	nq = min_t(u32, nq, clamp_t(u32, num_queues, 1, TVNET_MAX_QUEUES));
+	ret = pci_alloc_irq_vectors_affinity(pdev, 2, nq + 1, PCI_IRQ_MSIX |
+					     PCI_IRQ_AFFINITY, &affd);
+	if (ret <= 0) {
+		dev_err(&pdev->dev, "pci_alloc_irq_vectors() fail: %d\n", ret);
+		ret = -EIO;
+		goto pci_disable;
+	}
+	tvnet->num_queues = ret - 1;
+
+	for (i = 0; i < DMA_RD_CHNL_NUM; i++) {
+		dma = &tvnet->dma[i];
+		spin_lock_init(&dma->lock);
+#if ENABLE_DMA
+		dma->tvnet = tvnet;
+		dma->tx_buf = devm_kcalloc(&pdev->dev, DMA_DESC_COUNT,
+					   sizeof(*dma->tx_buf), GFP_KERNEL);
+		if (!dma->tx_buf) {
+			ret = -ENOMEM;
+			goto del_napi;
+		}
+		hrtimer_init(&dma->reap_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		dma->reap_timer.function = tvnet_host_dma_reap_timer;
+#endif
+	}
+
+	for (i = 0; i < tvnet->num_queues; i++) {
+		ret = tvnet_host_setup_queue_md(tvnet, i);
+		if (ret < 0)
+			goto del_napi;
 #if defined(NV_NETIF_NAPI_ADD_WEIGHT_PRESENT) /* Linux v6.1 */
-	netif_napi_add_weight(ndev, &tvnet->napi, tvnet_host_poll, TVNET_NAPI_WEIGHT);
+		netif_napi_add_weight(ndev, &tvnet->queues[i].napi,
+				      tvnet_host_poll, TVNET_NAPI_WEIGHT);
 #else
-	netif_napi_add(ndev, &tvnet->napi, tvnet_host_poll, TVNET_NAPI_WEIGHT);
+		netif_napi_add(ndev, &tvnet->queues[i].napi, tvnet_host_poll,
+			       TVNET_NAPI_WEIGHT);
 #endif
+	}
 
-	ndev->mtu = TVNET_DEFAULT_MTU;
+	netif_set_real_num_tx_queues(ndev, tvnet->num_queues);
+	netif_set_real_num_rx_queues(ndev, tvnet->num_queues);
+	/* Let the endpoint spread its xmit over the queues serviced here */
+	if (tvnet->ep_num_queues)
+		tvnet->bar_md->host_num_queues = tvnet->num_queues;
 
-	ret = register_netdev(ndev);
-	if (ret) {
-		dev_err(&pdev->dev, "register_netdev() fail: %d\n", ret);
-		goto pci_disable;
-	}
-	netif_carrier_off(ndev);
+	ndev->mtu = TVNET_DEFAULT_MTU;
+	/* Checksums are left to EP, the link itself is reliable */
+	ndev->hw_features |= TVNET_NETIF_F_CSUM;
+#if ENABLE_DMA
+	/* Frags are read by EP DMA straight into the dst buffer */
+	ndev->hw_features |= NETIF_F_SG | TVNET_NETIF_F_GSO;
+#endif
+	ndev->features |= ndev->hw_features;
+	/* Build superframes up to one EP receive buffer */
+	netif_set_gso_max_size(ndev, ndev->mtu + ETH_HLEN);
 
 	tvnet->rx_link_state = DIR_LINK_STATE_DOWN;
 	tvnet->tx_link_state = DIR_LINK_STATE_DOWN;
@@ -836,45 +1378,49 @@ static int tvnet_host_probe(struct pci_dev *pdev,
 	mutex_init(&tvnet->link_state_lock);
 	init_waitqueue_head(&tvnet->link_state_wq);
 
-	ret = pci_alloc_irq_vectors(pdev, 2, 2, PCI_IRQ_MSIX |
-				    PCI_IRQ_AFFINITY);
-	if (ret <= 0) {
-		dev_err(&pdev->dev, "pci_alloc_irq_vectors() fail: %d\n", ret);
-		ret = -EIO;
-		goto unreg_netdev;
+	ret = register_netdev(ndev);
+	if (ret) {
+		dev_err(&pdev->dev, "register_netdev() fail: %d\n", ret);
+		goto del_napi;
 	}
+	netif_carrier_off(ndev);
 
 	ret = request_irq(pci_irq_vector(pdev, 0), tvnet_irq_ctrl, 0,
 			  ndev->name, ndev);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "request_irq() fail: %d\n", ret);
-		goto disable_msi;
+		goto unreg_netdev;
 	}
 
-	ret = request_irq(pci_irq_vector(pdev, 1), tvnet_irq_data, 0,
-			  ndev->name, ndev);
-	if (ret < 0) {
-		dev_err(&pdev->dev, "request_irq() fail: %d\n", ret);
+	ret = tvnet_host_request_data_irqs(tvnet);
+	if (ret < 0)
 		goto fail_request_irq_ctrl;
-	}
 
 #if ENABLE_DMA
 	tvnet_host_write_dma_msix_settings(tvnet);
 #endif
 
-	INIT_LIST_HEAD(&tvnet->ep2h_empty_list);
-	spin_lock_init(&tvnet->ep2h_empty_lock);
+	dev_info(&pdev->dev, "%u data queues\n", tvnet->num_queues);
 
 	return 0;
 
 fail_request_irq_ctrl:
 	free_irq(pci_irq_vector(pdev, 0), ndev);
-disable_msi:
-	pci_free_irq_vectors(pdev);
 unreg_netdev:
 	unregister_netdev(ndev);
+#if ENABLE_DMA
+	for (i = 0; i < DMA_RD_CHNL_NUM; i++)
+		tvnet_host_dma_reset(&tvnet->dma[i]);
+#endif
+del_napi:
+	for (i = 0; i < tvnet->num_queues; i++) {
+		if (!tvnet->queues[i].tvnet)
+			continue;
+		hrtimer_cancel(&tvnet->queues[i].irq_timer);
+		netif_napi_del(&tvnet->queues[i].napi);
+	}
+	pci_free_irq_vectors(pdev);
 pci_disable:
-	netif_napi_del(&tvnet->napi);
 	pci_disable_device(pdev);
 free_netdev:
 	free_netdev(ndev);
@@ -886,6 +1432,7 @@ static void tvnet_host_remove(struct pci_dev *pdev)
 {
 	int ret = -1;
 	struct tvnet_priv *tvnet = pci_get_drvdata(pdev);
+	u32 i;
 
 	if (tvnet->rx_link_state == DIR_LINK_STATE_UP)
 		tvnet_host_user_link_down_req(tvnet);
@@ -902,10 +1449,17 @@ static void tvnet_host_remove(struct pci_dev *pdev)
 	}
 
 	free_irq(pci_irq_vector(pdev, 0), tvnet->ndev);
-	free_irq(pci_irq_vector(pdev, 1), tvnet->ndev);
-	pci_free_irq_vectors(pdev);
+	tvnet_host_free_data_irqs(tvnet, tvnet->num_queues);
 	unregister_netdev(tvnet->ndev);
-	netif_napi_del(&tvnet->napi);
+#if ENABLE_DMA
+	for (i = 0; i < DMA_RD_CHNL_NUM; i++)
+		tvnet_host_dma_reset(&tvnet->dma[i]);
+#endif
+	for (i = 0; i < tvnet->num_queues; i++) {
+		hrtimer_cancel(&tvnet->queues[i].irq_timer);
+		netif_napi_del(&tvnet->queues[i].napi);
+	}
+	pci_free_irq_vectors(pdev);
 	pci_disable_device(pdev);
 	free_netdev(tvnet->ndev);
 }
@@ -913,8 +1467,10 @@ static void tvnet_host_remove(struct pci_dev *pdev)
 static int tvnet_host_suspend(struct pci_dev *pdev, pm_message_t state)
 {
 	struct tvnet_priv *tvnet = pci_get_drvdata(pdev);
+	u32 i;
 
-	disable_irq(pci_irq_vector(tvnet->pdev, 1));
+	for (i = 0; i < tvnet->num_queues; i++)
+		disable_irq(tvnet_host_data_vector(tvnet, i));
 
 	if (tvnet->rx_link_state == DIR_LINK_STATE_UP) {
 		tvnet_host_close(tvnet->ndev);
@@ -927,10 +1483,13 @@ static int tvnet_host_suspend(struct pci_dev *pdev, pm_message_t state)
 static int tvnet_host_resume(struct pci_dev *pdev)
 {
 	struct tvnet_priv *tvnet = pci_get_drvdata(pdev);
+	u32 i;
 #if ENABLE_DMA
-	struct dma_desc_cnt *desc_cnt = &tvnet->desc_cnt;
-
-	desc_cnt->wr_cnt = desc_cnt->rd_cnt = 0;
+	/* EP restarts its channels at the start of the rings */
+	for (i = 0; i < DMA_RD_CHNL_NUM; i++) {
+		tvnet_host_dma_reset(&tvnet->dma[i]);
+		tvnet->dma[i].llp_base = tvnet_host_dma_llp(tvnet, i);
+	}
 	tvnet_host_write_dma_msix_settings(tvnet);
 #endif
 
@@ -939,7 +1498,8 @@ static int tvnet_host_resume(struct pci_dev *pdev)
 		tvnet->pm_closed = false;
 	}
 
-	enable_irq(pci_irq_vector(tvnet->pdev, 1));
+	for (i = 0; i < tvnet->num_queues; i++)
+		enable_irq(tvnet_host_data_vector(tvnet, i));
 
 	return 0;
 }
@@ -5,6 +5,12 @@
 #include <linux/version.h>
 #include <linux/mmu_notifier.h>
 #include <linux/module.h>
+#include <linux/kref.h>
+#include <linux/llist.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/scatterlist.h>
+#include <linux/workqueue.h>
 #include <linux/nv-p2p.h>
 
 MODULE_DESCRIPTION("Nvidia Tegra P2P Driver");
@@ -61,37 +67,349 @@ static inline s32 safe_cast_s64_to_s32(s64 sl_a)
 	}
 }
 
+static unsigned int cache_max_idle = 16;
+module_param(cache_max_idle, uint, 0644);
+MODULE_PARM_DESC(cache_max_idle,
+		 "Number of released page ranges kept pinned per process for reuse");
+
+/* One DMA mapping of a pinned range, shared by every user of the same device */
+struct nvidia_p2p_dma_cache {
+	struct list_head node;
+	struct device *dev;
+	enum dma_data_direction direction;
+	struct sg_table sgt;
+	int count;
+	u32 users;
+};
+
+/*
+ * Pinned user pages of one (mm, vaddr, size) range. Cached pins are on
+ * the pins list of their mm and stay pinned on the idle list after the
+ * last page table using them is freed, so that registering the same
+ * buffer again neither pins nor maps it again. Pins are dropped from the
+ * cache once any part of the range is invalidated.
+ */
+struct nvidia_p2p_pin {
+	struct list_head node;
+	struct list_head idle;
+	struct nvidia_p2p_mm *p2p_mm;
+	u64 vaddr;
+	u64 size;
+	u32 entries;
+	struct page **pages;
+	u32 users;
+	bool cached;
+
+	/* Protects maps */
+	struct mutex map_lock;
+	struct list_head maps;
+};
+
+/*
+ * Per process state, a single MMU notifier walks all the registrations
+ * of the mm instead of one notifier per page table.
+ */
+struct nvidia_p2p_mm {
+	struct mmu_notifier mn;
+	struct mm_struct *mm;
+	/* One reference for each registered page table and each pin */
+	struct kref ref;
+	struct list_head node;
+	struct llist_node free_node;
+
+	/* Protects everything below and the lists of the pins */
+	struct mutex lock;
+	/* Registered page tables, sorted by vaddr */
+	struct list_head regs;
+	struct list_head pins;
+	struct list_head idle;
+	u32 nr_idle;
+	u64 inval_seq;
+	bool dead;
+};
+
+static LIST_HEAD(nvidia_p2p_mm_list);
+static DEFINE_MUTEX(nvidia_p2p_mm_lock);
+static LLIST_HEAD(nvidia_p2p_mm_free_list);
+
+static void nvidia_p2p_mm_free_work(struct work_struct *work)
+{
+	struct llist_node *list = llist_del_all(&nvidia_p2p_mm_free_list);
+	struct nvidia_p2p_mm *p2p_mm, *tmp;
+
+	llist_for_each_entry_safe(p2p_mm, tmp, list, free_node) {
+		mmu_notifier_unregister(&p2p_mm->mn, p2p_mm->mm);
+		kfree(p2p_mm);
+	}
+}
+static DECLARE_WORK(nvidia_p2p_mm_free, nvidia_p2p_mm_free_work);
+
+static void nvidia_p2p_mm_release_ref(struct kref *ref)
+	__releases(&nvidia_p2p_mm_lock)
+{
+	struct nvidia_p2p_mm *p2p_mm = container_of(ref, struct nvidia_p2p_mm,
+						    ref);
+
+	list_del(&p2p_mm->node);
+	mutex_unlock(&nvidia_p2p_mm_lock);
+
+	/*
+	 * The last reference can be dropped from inside the notifier, which
+	 * cannot unregister itself.
+	 */
+	llist_add(&p2p_mm->free_node, &nvidia_p2p_mm_free_list);
+	schedule_work(&nvidia_p2p_mm_free);
+}
+
+static void nvidia_p2p_mm_put(struct nvidia_p2p_mm *p2p_mm)
+{
+	kref_put_mutex(&p2p_mm->ref, nvidia_p2p_mm_release_ref,
+		       &nvidia_p2p_mm_lock);
+}
+
+static inline bool nvidia_p2p_overlaps(u64 vaddr, u64 size, u64 start, u64 end)
+{
+	return vaddr < end && vaddr + size > start;
+}
+
+static void nvidia_p2p_pin_free(struct nvidia_p2p_pin *pin)
+{
+	struct nvidia_p2p_dma_cache *cache, *tmp;
+
+	list_for_each_entry_safe(cache, tmp, &pin->maps, node) {
+		WARN_ON(cache->users);
+		dma_unmap_sg(cache->dev, cache->sgt.sgl,
+			safe_cast_u32_to_s32(cache->sgt.nents),
+			cache->direction);
+		sg_free_table(&cache->sgt);
+		put_device(cache->dev);
+		kfree(cache);
+	}
+
+	release_pages(pin->pages, safe_cast_u32_to_s32(pin->entries));
+	kfree(pin->pages);
+	nvidia_p2p_mm_put(pin->p2p_mm);
+	kfree(pin);
+}
+
+static void nvidia_p2p_pin_free_list(struct list_head *list)
+{
+	struct nvidia_p2p_pin *pin, *tmp;
+
+	list_for_each_entry_safe(pin, tmp, list, idle)
+		nvidia_p2p_pin_free(pin);
+}
+
+/* Called with p2p_mm->lock held, idle pins are moved to release */
+static void nvidia_p2p_pin_uncache(struct nvidia_p2p_mm *p2p_mm,
+	struct nvidia_p2p_pin *pin, struct list_head *release)
+{
+	list_del(&pin->node);
+	pin->cached = false;
+
+	if (!pin->users) {
+		list_move_tail(&pin->idle, release);
+		p2p_mm->nr_idle--;
+	}
+}
+
+static void nvidia_p2p_pin_put(struct nvidia_p2p_pin *pin)
+{
+	struct nvidia_p2p_mm *p2p_mm = pin->p2p_mm;
+	struct nvidia_p2p_pin *victim;
+	LIST_HEAD(release);
+
+	mutex_lock(&p2p_mm->lock);
+	if (--pin->users == 0) {
+		if (pin->cached) {
+			list_add_tail(&pin->idle, &p2p_mm->idle);
+			p2p_mm->nr_idle++;
+		} else {
+			list_add_tail(&pin->idle, &release);
+		}
+
+		while (p2p_mm->nr_idle > READ_ONCE(cache_max_idle)) {
+			victim = list_first_entry(&p2p_mm->idle,
+						  struct nvidia_p2p_pin, idle);
+			nvidia_p2p_pin_uncache(p2p_mm, victim, &release);
+		}
+	}
+	mutex_unlock(&p2p_mm->lock);
+
+	nvidia_p2p_pin_free_list(&release);
+}
+
+/* Called with p2p_mm->lock held */
+static struct nvidia_p2p_pin *nvidia_p2p_pin_lookup(
+	struct nvidia_p2p_mm *p2p_mm, u64 vaddr, u64 size)
+{
+	struct nvidia_p2p_pin *pin;
+
+	list_for_each_entry(pin, &p2p_mm->pins, node) {
+		if (pin->vaddr != vaddr || pin->size != size)
+			continue;
+
+		if (!pin->users++) {
+			list_del(&pin->idle);
+			p2p_mm->nr_idle--;
+		}
+		return pin;
+	}
+
+	return NULL;
+}
+
+static struct nvidia_p2p_pin *nvidia_p2p_pin_create(
+	struct nvidia_p2p_mm *p2p_mm, u64 vaddr, u64 size, int nr_pages)
+{
+	struct nvidia_p2p_pin *pin;
+	int user_pages = 0;
+	int ret = 0;
+
+	pin = kzalloc(sizeof(*pin), GFP_KERNEL);
+	if (!pin) {
+		return ERR_PTR(-ENOMEM);
+	}
+
+	pin->pages = kcalloc(nr_pages, sizeof(*pin->pages), GFP_KERNEL);
+	if (!pin->pages) {
+		ret = -ENOMEM;
+		goto free_pin;
+	}
+
+	user_pages = safe_cast_s64_to_s32(get_user_pages_unlocked(vaddr & PAGE_MASK, nr_pages,
+					  pin->pages, FOLL_WRITE | FOLL_FORCE));
+	if (user_pages != nr_pages) {
+		ret = user_pages < 0 ? user_pages : -ENOMEM;
+		if (user_pages > 0) {
+			release_pages(pin->pages, user_pages);
+		}
+		goto free_pages;
+	}
+
+	pin->vaddr = vaddr;
+	pin->size = size;
+	pin->entries = safe_cast_s32_to_u32(user_pages);
+	pin->users = 1;
+	INIT_LIST_HEAD(&pin->node);
+	INIT_LIST_HEAD(&pin->idle);
+	mutex_init(&pin->map_lock);
+	INIT_LIST_HEAD(&pin->maps);
+
+	kref_get(&p2p_mm->ref);
+	pin->p2p_mm = p2p_mm;
+
+	return pin;
+free_pages:
+	kfree(pin->pages);
+free_pin:
+	kfree(pin);
+	return ERR_PTR(ret);
+}
+
+/* Called with p2p_mm->lock held */
+static void nvidia_p2p_reg_add(struct nvidia_p2p_mm *p2p_mm,
+	struct nvidia_p2p_page_table *page_table)
+{
+	struct nvidia_p2p_page_table *pos;
+
+	list_for_each_entry(pos, &p2p_mm->regs, node) {
+		if (pos->vaddr > page_table->vaddr)
+			break;
+	}
+	list_add_tail(&page_table->node, &pos->node);
+}
+
+/* Returns true if the page table was still registered */
+static bool nvidia_p2p_reg_del(struct nvidia_p2p_page_table *page_table)
+{
+	struct nvidia_p2p_mm *p2p_mm = page_table->p2p_mm;
+	bool registered;
+
+	mutex_lock(&p2p_mm->lock);
+	registered = !list_empty(&page_table->node);
+	list_del_init(&page_table->node);
+	mutex_unlock(&p2p_mm->lock);
+
+	return registered;
+}
+
+static void nvidia_p2p_mm_invalidate(struct nvidia_p2p_mm *p2p_mm,
+	u64 start, u64 end, bool release)
+{
+	struct nvidia_p2p_page_table *page_table, *pos;
+	struct nvidia_p2p_pin *pin, *tmp;
+	void (*free_callback)(void *data) = NULL;
+	void (*last_callback)(void *data) = NULL;
+	void *data = NULL, *last_data = NULL;
+	LIST_HEAD(stale);
+
+	mutex_lock(&p2p_mm->lock);
+	p2p_mm->inval_seq++;
+	if (release) {
+		p2p_mm->dead = true;
+	}
+	list_for_each_entry_safe(pin, tmp, &p2p_mm->pins, node) {
+		if (nvidia_p2p_overlaps(pin->vaddr, pin->size, start, end))
+			nvidia_p2p_pin_uncache(p2p_mm, pin, &stale);
+	}
+	mutex_unlock(&p2p_mm->lock);
+
+	/*
+	 * The callbacks free the page tables, so take them off the list one
+	 * at a time and do not hold the lock while calling out. Adjacent
+	 * registrations with the same callback and data are one buffer of
+	 * the client and only get a single callback.
+	 */
+	for (;;) {
+		page_table = NULL;
+
+		mutex_lock(&p2p_mm->lock);
+		list_for_each_entry(pos, &p2p_mm->regs, node) {
+			if (pos->vaddr >= end)
+				break;
+			if (nvidia_p2p_overlaps(pos->vaddr, pos->size, start, end)) {
+				page_table = pos;
+				break;
+			}
+		}
+		if (page_table) {
+			list_del_init(&page_table->node);
+			free_callback = page_table->free_callback;
+			data = page_table->data;
+		}
+		mutex_unlock(&p2p_mm->lock);
+
+		if (!page_table)
+			break;
+
+		if (free_callback != last_callback || data != last_data) {
+			free_callback(data);
+			last_callback = free_callback;
+			last_data = data;
+		}
+		nvidia_p2p_mm_put(p2p_mm);
+	}
+
+	nvidia_p2p_pin_free_list(&stale);
+}
+
 static void nvidia_p2p_mn_release(struct mmu_notifier *mn,
 	struct mm_struct *mm)
 {
-	struct nvidia_p2p_page_table *page_table = container_of(mn,
-						struct nvidia_p2p_page_table,
-						mn);
+	struct nvidia_p2p_mm *p2p_mm = container_of(mn, struct nvidia_p2p_mm,
+						    mn);
 
-	page_table->free_callback(page_table->data);
+	nvidia_p2p_mm_invalidate(p2p_mm, 0, U64_MAX, true);
 }
 
 static void nvidia_p2p_mn_invl_range_start_legacy(struct mmu_notifier *mn,
 	struct mm_struct *mm, unsigned long start, unsigned long end)
 {
-	struct nvidia_p2p_page_table *page_table = container_of(mn,
-						struct  nvidia_p2p_page_table,
-						mn);
-
-	u64 vaddr = 0;
-	u64 size = 0;
+	struct nvidia_p2p_mm *p2p_mm = container_of(mn, struct nvidia_p2p_mm,
+						    mn);
 
-	vaddr = page_table->vaddr;
-	size = page_table->size;
-
-	if (vaddr >= start && vaddr <= end) {
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-		mmu_notifier_put(&page_table->mn);
-#else
-		mmu_notifier_unregister_no_release(&page_table->mn, page_table->mm);
-#endif
-		page_table->free_callback(page_table->data);
-	}
+	nvidia_p2p_mm_invalidate(p2p_mm, start, end, false);
 }
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 20, 0)
@@ -104,12 +422,6 @@ static int nvidia_p2p_mn_invl_range_start(struct mmu_notifier *mn,
 }
 #endif
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-static void nvidia_p2p_free_notifier(struct mmu_notifier *mn)
-{
-}
-#endif
-
 static struct mmu_notifier_ops nvidia_p2p_mmu_ops = {
 	.release		= nvidia_p2p_mn_release,
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 20, 0)
@@ -117,20 +429,62 @@ static struct mmu_notifier_ops nvidia_p2p_mmu_ops = {
 #else
 	.invalidate_range_start	= nvidia_p2p_mn_invl_range_start_legacy,
 #endif
-
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-	.free_notifier		= nvidia_p2p_free_notifier,
-#endif
 };
 
+static struct nvidia_p2p_mm *nvidia_p2p_mm_get(struct mm_struct *mm)
+{
+	struct nvidia_p2p_mm *p2p_mm;
+	int ret = 0;
+
+	mutex_lock(&nvidia_p2p_mm_lock);
+	list_for_each_entry(p2p_mm, &nvidia_p2p_mm_list, node) {
+		if (p2p_mm->mm == mm && !READ_ONCE(p2p_mm->dead)) {
+			kref_get(&p2p_mm->ref);
+			mutex_unlock(&nvidia_p2p_mm_lock);
+			return p2p_mm;
+		}
+	}
+	mutex_unlock(&nvidia_p2p_mm_lock);
+
+	p2p_mm = kzalloc(sizeof(*p2p_mm), GFP_KERNEL);
+	if (!p2p_mm) {
+		return ERR_PTR(-ENOMEM);
+	}
+
+	p2p_mm->mm = mm;
+	kref_init(&p2p_mm->ref);
+	mutex_init(&p2p_mm->lock);
+	INIT_LIST_HEAD(&p2p_mm->regs);
+	INIT_LIST_HEAD(&p2p_mm->pins);
+	INIT_LIST_HEAD(&p2p_mm->idle);
+	p2p_mm->mn.ops = &nvidia_p2p_mmu_ops;
+
+	/*
+	 * Registering takes mmap_lock, which the notifier callbacks nest
+	 * inside of, so it cannot be done under nvidia_p2p_mm_lock.
+	 */
+	ret = mmu_notifier_register(&p2p_mm->mn, mm);
+	if (ret) {
+		kfree(p2p_mm);
+		return ERR_PTR(ret);
+	}
+
+	mutex_lock(&nvidia_p2p_mm_lock);
+	list_add(&p2p_mm->node, &nvidia_p2p_mm_list);
+	mutex_unlock(&nvidia_p2p_mm_lock);
+
+	return p2p_mm;
+}
+
 int nvidia_p2p_get_pages(u64 vaddr, u64 size,
 		struct nvidia_p2p_page_table **page_table,
 		void (*free_callback)(void *data), void *data)
 {
 	int ret = 0;
-	int user_pages = 0;
 	int nr_pages = safe_cast_u64_to_s32(size >> PAGE_SHIFT);
-	struct page **pages;
+	struct nvidia_p2p_mm *p2p_mm;
+	struct nvidia_p2p_pin *pin;
+	u64 seq;
 
 	if (nr_pages <= 0) {
 		return -EINVAL;
@@ -141,44 +495,62 @@ int nvidia_p2p_get_pages(u64 vaddr, u64 size,
 		return -ENOMEM;
 	}
 
-	pages = kcalloc(nr_pages, sizeof(*pages), GFP_KERNEL);
-	if (!pages) {
-		ret = -ENOMEM;
-		goto free_page_table;
-	}
-
-	user_pages = safe_cast_s64_to_s32(get_user_pages_unlocked(vaddr & PAGE_MASK, nr_pages,
-					  pages, FOLL_WRITE | FOLL_FORCE));
-	if (user_pages != nr_pages) {
-		ret = user_pages < 0 ? user_pages : -ENOMEM;
-		goto free_pages;
-	}
-
 	(*page_table)->version = NVIDIA_P2P_PAGE_TABLE_VERSION;
-	(*page_table)->pages = pages;
-	(*page_table)->entries = user_pages;
 	(*page_table)->page_size = NVIDIA_P2P_PAGE_SIZE_4KB;
 	(*page_table)->size = size;
-
-	(*page_table)->mn.ops = &nvidia_p2p_mmu_ops;
 	(*page_table)->mm = current->mm;
 	(*page_table)->free_callback = free_callback;
 	(*page_table)->data = data;
 	(*page_table)->vaddr = vaddr;
 	mutex_init(&(*page_table)->lock);
-	(*page_table)->mapped = NVIDIA_P2P_PINNED;
+	INIT_LIST_HEAD(&(*page_table)->node);
 
-	ret = mmu_notifier_register(&(*page_table)->mn, (*page_table)->mm);
-	if (ret) {
-		goto free_pages;
+	/* The reference taken here is owned by the registration */
+	p2p_mm = nvidia_p2p_mm_get(current->mm);
+	if (IS_ERR(p2p_mm)) {
+		ret = PTR_ERR(p2p_mm);
+		goto free_page_table;
 	}
+	(*page_table)->p2p_mm = p2p_mm;
 
-	return 0;
-free_pages:
-	while (--user_pages >= 0) {
-		put_page(pages[user_pages]);
+	mutex_lock(&p2p_mm->lock);
+	pin = nvidia_p2p_pin_lookup(p2p_mm, vaddr, size);
+	if (pin) {
+		(*page_table)->pin = pin;
+		nvidia_p2p_reg_add(p2p_mm, *page_table);
+	}
+	seq = p2p_mm->inval_seq;
+	mutex_unlock(&p2p_mm->lock);
+
+	if (!pin) {
+		pin = nvidia_p2p_pin_create(p2p_mm, vaddr, size, nr_pages);
+		if (IS_ERR(pin)) {
+			ret = PTR_ERR(pin);
+			goto put_mm;
+		}
+
+		/*
+		 * Pages pinned while part of the mm was being invalidated may
+		 * already be stale for the next user, so only cache the pin if
+		 * nothing was invalidated in between.
+		 */
+		mutex_lock(&p2p_mm->lock);
+		if (!p2p_mm->dead && seq == p2p_mm->inval_seq) {
+			list_add(&pin->node, &p2p_mm->pins);
+			pin->cached = true;
+		}
+		(*page_table)->pin = pin;
+		nvidia_p2p_reg_add(p2p_mm, *page_table);
+		mutex_unlock(&p2p_mm->lock);
 	}
-	kfree(pages);
+
+	(*page_table)->pages = pin->pages;
+	(*page_table)->entries = pin->entries;
+	(*page_table)->mapped = NVIDIA_P2P_PINNED;
+
+	return 0;
+put_mm:
+	nvidia_p2p_mm_put(p2p_mm);
 free_page_table:
 	kfree(*page_table);
 	*page_table = NULL;
@@ -188,11 +560,18 @@ EXPORT_SYMBOL(nvidia_p2p_get_pages);
 
 int nvidia_p2p_put_pages(struct nvidia_p2p_page_table *page_table)
 {
+	struct nvidia_p2p_mm *p2p_mm;
+
 	if (!page_table) {
 		return -EINVAL;
 	}
 
-	mmu_notifier_unregister(&page_table->mn, page_table->mm);
+	/* The callback frees the page table */
+	p2p_mm = page_table->p2p_mm;
+	if (nvidia_p2p_reg_del(page_table)) {
+		page_table->free_callback(page_table->data);
+		nvidia_p2p_mm_put(p2p_mm);
+	}
 
 	return 0;
 }
@@ -200,13 +579,16 @@ EXPORT_SYMBOL(nvidia_p2p_put_pages);
 
 int nvidia_p2p_free_page_table(struct nvidia_p2p_page_table *page_table)
 {
-	int user_pages = 0;
-	struct page **pages = NULL;
+	struct nvidia_p2p_pin *pin = NULL;
 
 	if (!page_table) {
 		return 0;
 	}
 
+	if (nvidia_p2p_reg_del(page_table)) {
+		nvidia_p2p_mm_put(page_table->p2p_mm);
+	}
+
 	mutex_lock(&page_table->lock);
 
 	if (page_table->mapped & NVIDIA_P2P_MAPPED) {
@@ -214,34 +596,108 @@ int nvidia_p2p_free_page_table(struct nvidia_p2p_page_table *page_table)
 	}
 
 	if (page_table->mapped & NVIDIA_P2P_PINNED) {
-		pages = page_table->pages;
-		user_pages = safe_cast_u32_to_s32(page_table->entries);
-
-		while (--user_pages >= 0) {
-			put_page(pages[user_pages]);
-		}
-
-		kfree(pages);
+		pin = page_table->pin;
+		page_table->pages = NULL;
 		page_table->mapped &= ~NVIDIA_P2P_PINNED;
 	}
 
 	mutex_unlock(&page_table->lock);
 
+	if (pin) {
+		nvidia_p2p_pin_put(pin);
+	}
+	kfree(page_table);
+
 	return 0;
 }
 EXPORT_SYMBOL(nvidia_p2p_free_page_table);
 
+static struct nvidia_p2p_dma_cache *nvidia_p2p_dma_cache_get(
+	struct nvidia_p2p_pin *pin, struct device *dev,
+	enum dma_data_direction direction)
+{
+	struct nvidia_p2p_dma_cache *cache;
+	unsigned int max_segment = UINT_MAX;
+	int ret = 0;
+
+	mutex_lock(&pin->map_lock);
+
+	list_for_each_entry(cache, &pin->maps, node) {
+		if (cache->dev == dev && cache->direction == direction) {
+			cache->users++;
+			goto unlock;
+		}
+	}
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	/*
+	 * Physically contiguous pages, such as the ones of a large folio,
+	 * are merged into a single segment up to what the peer can take.
+	 */
+	if (dev->dma_parms) {
+		max_segment = dma_get_max_seg_size(dev);
+	}
+	max_segment &= PAGE_MASK;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0)
+	ret = sg_alloc_table_from_pages_segment(&cache->sgt, pin->pages,
+				pin->entries, 0, pin->size, max_segment,
+				GFP_KERNEL);
+#else
+	ret = sg_alloc_table_from_pages(&cache->sgt, pin->pages,
+				pin->entries, 0, pin->size, GFP_KERNEL);
+#endif
+	if (ret) {
+		goto free_cache;
+	}
+
+	cache->count = dma_map_sg(dev, cache->sgt.sgl,
+				  safe_cast_u32_to_s32(cache->sgt.nents), direction);
+	if (cache->count < 1) {
+		ret = -EIO;
+		goto free_sg_table;
+	}
+
+	cache->dev = get_device(dev);
+	cache->direction = direction;
+	cache->users = 1;
+	list_add(&cache->node, &pin->maps);
+unlock:
+	mutex_unlock(&pin->map_lock);
+
+	return cache;
+free_sg_table:
+	sg_free_table(&cache->sgt);
+free_cache:
+	kfree(cache);
+err:
+	mutex_unlock(&pin->map_lock);
+
+	return ERR_PTR(ret);
+}
+
+static void nvidia_p2p_dma_cache_put(struct nvidia_p2p_pin *pin,
+	struct nvidia_p2p_dma_cache *cache)
+{
+	/* The mapping stays around until the pin is released */
+	mutex_lock(&pin->map_lock);
+	cache->users--;
+	mutex_unlock(&pin->map_lock);
+}
+
 int nvidia_p2p_dma_map_pages(struct device *dev,
 		struct nvidia_p2p_page_table *page_table,
 		struct nvidia_p2p_dma_mapping **dma_mapping,
 		enum dma_data_direction direction)
 {
-	struct sg_table *sgt = NULL;
+	struct nvidia_p2p_dma_cache *cache;
 	struct scatterlist *sg;
-	struct page **pages = NULL;
-	u32 nr_pages = 0;
 	int ret = 0;
-	int i, count;
+	int i;
 
 	if (!page_table) {
 		return -EINVAL;
@@ -249,9 +705,8 @@ int nvidia_p2p_dma_map_pages(struct device *dev,
 
 	mutex_lock(&page_table->lock);
 
-	pages = page_table->pages;
-	nr_pages = page_table->entries;
-	if (nr_pages <= 0) {
+	if (!(page_table->mapped & NVIDIA_P2P_PINNED) ||
+	    page_table->entries <= 0) {
 		mutex_unlock(&page_table->lock);
 		return -EINVAL;
 	}
@@ -261,42 +716,33 @@ int nvidia_p2p_dma_map_pages(struct device *dev,
 		mutex_unlock(&page_table->lock);
 		return -ENOMEM;
 	}
-	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
-	if (!sgt) {
-		ret = -ENOMEM;
+
+	cache = nvidia_p2p_dma_cache_get(page_table->pin, dev, direction);
+	if (IS_ERR(cache)) {
+		ret = PTR_ERR(cache);
 		goto free_dma_mapping;
 	}
-	ret = sg_alloc_table_from_pages(sgt, pages,
-				nr_pages, 0, page_table->size, GFP_KERNEL);
-	if (ret) {
-		goto free_sgt;
-	}
 
 	(*dma_mapping)->version = NVIDIA_P2P_DMA_MAPPING_VERSION;
-	(*dma_mapping)->sgt = sgt;
+	(*dma_mapping)->sgt = &cache->sgt;
 	(*dma_mapping)->dev = dev;
 	(*dma_mapping)->direction = direction;
 	(*dma_mapping)->page_table = page_table;
+	(*dma_mapping)->cache = cache;
+	(*dma_mapping)->entries = cache->count;
 
-	count = dma_map_sg(dev, sgt->sgl, sgt->nents, direction);
-	if (count < 1) {
-		goto free_sg_table;
-	}
-
-	(*dma_mapping)->entries = count;
-
-	(*dma_mapping)->hw_address = kcalloc(count, sizeof(u64), GFP_KERNEL);
+	(*dma_mapping)->hw_address = kcalloc(cache->count, sizeof(u64), GFP_KERNEL);
 	if (!((*dma_mapping)->hw_address)) {
 		ret = -ENOMEM;
-		goto unmap_sg;
+		goto put_cache;
 	}
-	(*dma_mapping)->hw_len = kcalloc(count, sizeof(u64), GFP_KERNEL);
+	(*dma_mapping)->hw_len = kcalloc(cache->count, sizeof(u64), GFP_KERNEL);
 	if (!((*dma_mapping)->hw_len)) {
 		ret = -ENOMEM;
 		goto free_hw_address;
 	}
 
-	for_each_sg(sgt->sgl, sg, count, i) {
+	for_each_sg(cache->sgt.sgl, sg, cache->count, i) {
 		(*dma_mapping)->hw_address[i] = sg_dma_address(sg);
 		(*dma_mapping)->hw_len[i] = sg_dma_len(sg);
 	}
@@ -306,13 +752,8 @@ int nvidia_p2p_dma_map_pages(struct device *dev,
 	return 0;
 free_hw_address:
 	kfree((*dma_mapping)->hw_address);
-unmap_sg:
-	dma_unmap_sg(dev, sgt->sgl,
-		safe_cast_u32_to_s32(sgt->nents), direction);
-free_sg_table:
-	sg_free_table(sgt);
-free_sgt:
-	kfree(sgt);
+put_cache:
+	nvidia_p2p_dma_cache_put(page_table->pin, cache);
 free_dma_mapping:
 	kfree(*dma_mapping);
 	*dma_mapping = NULL;
@@ -339,13 +780,7 @@ int nvidia_p2p_dma_unmap_pages(struct nvidia_p2p_dma_mapping *dma_mapping)
 	if (page_table->mapped & NVIDIA_P2P_MAPPED) {
 		kfree(dma_mapping->hw_len);
 		kfree(dma_mapping->hw_address);
-		if (dma_mapping->entries)
-			dma_unmap_sg(dma_mapping->dev,
-				dma_mapping->sgt->sgl,
-				safe_cast_u32_to_s32(dma_mapping->sgt->nents),
-				dma_mapping->direction);
-		sg_free_table(dma_mapping->sgt);
-		kfree(dma_mapping->sgt);
+		nvidia_p2p_dma_cache_put(page_table->pin, dma_mapping->cache);
 		kfree(dma_mapping);
 		page_table->mapped &= ~NVIDIA_P2P_MAPPED;
 	}
@@ -360,3 +795,9 @@ int nvidia_p2p_free_dma_mapping(struct nvidia_p2p_dma_mapping *dma_mapping)
 	return nvidia_p2p_dma_unmap_pages(dma_mapping);
 }
 EXPORT_SYMBOL(nvidia_p2p_free_dma_mapping);
+
+static void __exit nvidia_p2p_exit(void)
+{
+	flush_work(&nvidia_p2p_mm_free);
+}
+module_exit(nvidia_p2p_exit);
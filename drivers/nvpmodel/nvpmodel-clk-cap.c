@@ -3,7 +3,9 @@
 
 #include <linux/clk.h>
 #include <linux/kobject.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/printk.h>
@@ -13,10 +15,25 @@
 #include <soc/tegra/bpmp.h>
 #include <soc/tegra/bpmp-abi.h>
 
+#define NVPMODEL_MAX_MODES	32
+
+struct nvpmodel_clk_cap;
+
 struct nvpmodel_clk {
 	struct kobj_attribute attr;
 	struct clk *clk;
 	struct tegra_bpmp *bpmp;
+	struct nvpmodel_clk_cap *nvpm_clk_cap;
+	/* cap currently applied, 0 if not known */
+	unsigned long cap;
+};
+
+/*
+ * A power mode, as the caps of the clocks already rounded when the mode
+ * was defined, 0 for the clocks the mode leaves alone.
+ */
+struct nvpmodel_mode {
+	unsigned long *caps;
 };
 
 struct nvpmodel_clk_cap {
@@ -24,6 +41,17 @@ struct nvpmodel_clk_cap {
 	struct nvpmodel_clk *clks;
 	struct tegra_bpmp *bpmp;
 	int num_clocks;
+
+	/* serializes cap changes */
+	struct mutex lock;
+	struct nvpmodel_mode modes[NVPMODEL_MAX_MODES];
+	int active_mode;
+	u64 switch_count;
+	u64 switch_last_ns;
+	u64 switch_max_ns;
+	struct kobj_attribute modes_attr;
+	struct kobj_attribute mode_attr;
+	struct kobj_attribute latency_attr;
 };
 
 static ssize_t ccf_set_max_rate(struct clk *clk, unsigned long rate)
@@ -70,6 +98,37 @@ static ssize_t bpmp_set_emc_cap_rate(struct tegra_bpmp *bpmp, unsigned long rate
 	return ret;
 }
 
+static bool nvpmodel_clk_is_emc(struct nvpmodel_clk *nvpm_clk)
+{
+	return !strncmp(nvpm_clk->attr.attr.name, "emc", strlen("emc"));
+}
+
+/*
+ * Round a cap the way ccf_set_max_rate() would, leaving the cap that is
+ * currently applied in place.
+ */
+static long ccf_round_max_rate(struct clk *clk, unsigned long rate)
+{
+	long prev_max_rate, rounded_rate;
+	int ret;
+
+	prev_max_rate = clk_round_rate(clk, S64_MAX);
+	if (prev_max_rate < 0)
+		return prev_max_rate;
+
+	ret = clk_set_max_rate(clk, S64_MAX);
+	if (ret)
+		return ret;
+
+	rounded_rate = clk_round_rate(clk, rate);
+
+	ret = clk_set_max_rate(clk, prev_max_rate);
+	if (ret)
+		return ret;
+
+	return rounded_rate;
+}
+
 static ssize_t clk_cap_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
 	long rate;
@@ -82,17 +141,10 @@ static ssize_t clk_cap_show(struct kobject *kobj, struct kobj_attribute *attr, c
 	return sprintf(buf, "%ld\n", rate);
 }
 
-static ssize_t clk_cap_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf,
-			     size_t count)
+static int __clk_cap_store(struct nvpmodel_clk *nvpm_clk, unsigned long rate)
 {
 	int ccf_ret, bpmp_ret;
 	long prev_max_rate, rounded_max_rate;
-	unsigned long rate;
-	struct nvpmodel_clk *nvpm_clk = container_of(attr, struct nvpmodel_clk, attr);
-
-	ccf_ret = kstrtoul(buf, 0, &rate);
-	if (ccf_ret)
-		return ccf_ret;
 
 	/* Store previous max freq in case of later failure */
 	prev_max_rate = clk_round_rate(nvpm_clk->clk, S64_MAX);
@@ -105,8 +157,8 @@ static ssize_t clk_cap_store(struct kobject *kobj, struct kobj_attribute *attr,
 		return ccf_ret;
 
 	/* Early return for the clocks that do not require additional BPMP MRQ involvement */
-	if (strncmp(nvpm_clk->attr.attr.name, "emc", strlen("emc")))
-		return count;
+	if (!nvpmodel_clk_is_emc(nvpm_clk))
+		return 0;
 
 	/*
 	 * The max freq has been successfully updated in the CCF, so any later
@@ -137,7 +189,265 @@ static ssize_t clk_cap_store(struct kobject *kobj, struct kobj_attribute *attr,
 		return bpmp_ret;
 	}
 
-	return count;
+	return 0;
+}
+
+static ssize_t clk_cap_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf,
+			     size_t count)
+{
+	int ccf_ret;
+	unsigned long rate;
+	struct nvpmodel_clk *nvpm_clk = container_of(attr, struct nvpmodel_clk, attr);
+
+	ccf_ret = kstrtoul(buf, 0, &rate);
+	if (ccf_ret)
+		return ccf_ret;
+
+	mutex_lock(&nvpm_clk->nvpm_clk_cap->lock);
+	nvpm_clk->nvpm_clk_cap->active_mode = -1;
+	nvpm_clk->cap = 0;
+	ccf_ret = __clk_cap_store(nvpm_clk, rate);
+	mutex_unlock(&nvpm_clk->nvpm_clk_cap->lock);
+
+	return ccf_ret ? ccf_ret : count;
+}
+
+/*
+ * Apply a precomputed cap set. The caps are already rounded, so each clock
+ * costs a single clk_set_max_rate(), and clocks whose cap does not change
+ * are skipped.
+ */
+static int nvpmodel_apply_mode(struct nvpmodel_clk_cap *nvpm_clk_cap, int id)
+{
+	struct nvpmodel_mode *mode = &nvpm_clk_cap->modes[id];
+	struct nvpmodel_clk *nvpm_clk;
+	ktime_t start;
+	u64 delta;
+	int i, ret, err = 0;
+
+	start = ktime_get();
+
+	for (i = 0; i < nvpm_clk_cap->num_clocks; i++) {
+		nvpm_clk = &nvpm_clk_cap->clks[i];
+		if (!mode->caps[i] || !nvpm_clk->clk || nvpm_clk->cap == mode->caps[i])
+			continue;
+
+		ret = clk_set_max_rate(nvpm_clk->clk, mode->caps[i]);
+		if (!ret && nvpmodel_clk_is_emc(nvpm_clk))
+			ret = bpmp_set_emc_cap_rate(nvpm_clk->bpmp, mode->caps[i]);
+
+		if (ret) {
+			pr_debug("Failed to cap %s to %lu: %d\n",
+				 nvpm_clk->attr.attr.name, mode->caps[i], ret);
+			nvpm_clk->cap = 0;
+			if (!err)
+				err = ret;
+			continue;
+		}
+
+		nvpm_clk->cap = mode->caps[i];
+	}
+
+	delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+	nvpm_clk_cap->switch_count++;
+	nvpm_clk_cap->switch_last_ns = delta;
+	nvpm_clk_cap->switch_max_ns = max(nvpm_clk_cap->switch_max_ns, delta);
+	nvpm_clk_cap->active_mode = err ? -1 : id;
+
+	return err;
+}
+
+static struct nvpmodel_clk *nvpmodel_find_clk(struct nvpmodel_clk_cap *nvpm_clk_cap,
+					      const char *name, int *idx)
+{
+	int i;
+
+	for (i = 0; i < nvpm_clk_cap->num_clocks; i++) {
+		if (nvpm_clk_cap->clks[i].clk && nvpm_clk_cap->clks[i].attr.attr.name &&
+		    !strcmp(nvpm_clk_cap->clks[i].attr.attr.name, name)) {
+			*idx = i;
+			return &nvpm_clk_cap->clks[i];
+		}
+	}
+
+	return NULL;
+}
+
+static ssize_t modes_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	struct nvpmodel_clk_cap *nvpm_clk_cap =
+		container_of(attr, struct nvpmodel_clk_cap, modes_attr);
+	ssize_t len = 0;
+	int id, i;
+
+	mutex_lock(&nvpm_clk_cap->lock);
+	for (id = 0; id < NVPMODEL_MAX_MODES; id++) {
+		if (!nvpm_clk_cap->modes[id].caps)
+			continue;
+
+		len += sysfs_emit_at(buf, len, "%d", id);
+		for (i = 0; i < nvpm_clk_cap->num_clocks; i++) {
+			if (nvpm_clk_cap->modes[id].caps[i])
+				len += sysfs_emit_at(buf, len, " %s=%lu",
+						     nvpm_clk_cap->clks[i].attr.attr.name,
+						     nvpm_clk_cap->modes[id].caps[i]);
+		}
+		len += sysfs_emit_at(buf, len, "\n");
+	}
+	mutex_unlock(&nvpm_clk_cap->lock);
+
+	return len;
+}
+
+/*
+ * Define a mode as "<id> <clock>=<rate> ...", or delete it with "<id>".
+ * The caps are rounded now, so switching to the mode later does not have
+ * to lift and round every cap again.
+ */
+static ssize_t modes_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf,
+			   size_t count)
+{
+	struct nvpmodel_clk_cap *nvpm_clk_cap =
+		container_of(attr, struct nvpmodel_clk_cap, modes_attr);
+	struct nvpmodel_clk *nvpm_clk;
+	char *str, *cur, *tok, *val;
+	unsigned long *caps = NULL;
+	unsigned long rate;
+	long rounded;
+	int id, idx, ret;
+
+	str = kstrndup(buf, count, GFP_KERNEL);
+	if (!str)
+		return -ENOMEM;
+
+	cur = strim(str);
+	tok = strsep(&cur, " \t");
+	ret = kstrtoint(tok, 0, &id);
+	if (ret)
+		goto out;
+
+	if (id < 0 || id >= NVPMODEL_MAX_MODES) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (cur) {
+		caps = kcalloc(nvpm_clk_cap->num_clocks, sizeof(*caps), GFP_KERNEL);
+		if (!caps) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	mutex_lock(&nvpm_clk_cap->lock);
+
+	while ((tok = strsep(&cur, " \t"))) {
+		if (!*tok)
+			continue;
+
+		val = strchr(tok, '=');
+		if (!val) {
+			ret = -EINVAL;
+			goto unlock;
+		}
+		*val++ = '\0';
+
+		nvpm_clk = nvpmodel_find_clk(nvpm_clk_cap, tok, &idx);
+		if (!nvpm_clk) {
+			ret = -ENOENT;
+			goto unlock;
+		}
+
+		ret = kstrtoul(val, 0, &rate);
+		if (ret)
+			goto unlock;
+
+		rounded = ccf_round_max_rate(nvpm_clk->clk, rate);
+		if (rounded <= 0) {
+			ret = rounded ? rounded : -EINVAL;
+			goto unlock;
+		}
+
+		caps[idx] = rounded;
+	}
+
+	kfree(nvpm_clk_cap->modes[id].caps);
+	nvpm_clk_cap->modes[id].caps = caps;
+	caps = NULL;
+	if (nvpm_clk_cap->active_mode == id)
+		nvpm_clk_cap->active_mode = -1;
+	ret = 0;
+
+unlock:
+	mutex_unlock(&nvpm_clk_cap->lock);
+out:
+	kfree(caps);
+	kfree(str);
+
+	return ret ? ret : count;
+}
+
+static ssize_t mode_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	struct nvpmodel_clk_cap *nvpm_clk_cap =
+		container_of(attr, struct nvpmodel_clk_cap, mode_attr);
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(nvpm_clk_cap->active_mode));
+}
+
+static ssize_t mode_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf,
+			  size_t count)
+{
+	struct nvpmodel_clk_cap *nvpm_clk_cap =
+		container_of(attr, struct nvpmodel_clk_cap, mode_attr);
+	int id, ret;
+
+	ret = kstrtoint(buf, 0, &id);
+	if (ret)
+		return ret;
+
+	if (id < 0 || id >= NVPMODEL_MAX_MODES)
+		return -EINVAL;
+
+	mutex_lock(&nvpm_clk_cap->lock);
+	if (nvpm_clk_cap->modes[id].caps)
+		ret = nvpmodel_apply_mode(nvpm_clk_cap, id);
+	else
+		ret = -ENOENT;
+	mutex_unlock(&nvpm_clk_cap->lock);
+
+	return ret ? ret : count;
+}
+
+static ssize_t mode_switch_latency_us_show(struct kobject *kobj, struct kobj_attribute *attr,
+					   char *buf)
+{
+	struct nvpmodel_clk_cap *nvpm_clk_cap =
+		container_of(attr, struct nvpmodel_clk_cap, latency_attr);
+	ssize_t len;
+
+	mutex_lock(&nvpm_clk_cap->lock);
+	len = sysfs_emit(buf, "last %llu max %llu switches %llu\n",
+			 div_u64(nvpm_clk_cap->switch_last_ns, NSEC_PER_USEC),
+			 div_u64(nvpm_clk_cap->switch_max_ns, NSEC_PER_USEC),
+			 nvpm_clk_cap->switch_count);
+	mutex_unlock(&nvpm_clk_cap->lock);
+
+	return len;
+}
+
+static void nvpmodel_mode_attr_init(struct kobj_attribute *attr, const char *name,
+				    umode_t mode,
+				    ssize_t (*show)(struct kobject *, struct kobj_attribute *,
+						    char *),
+				    ssize_t (*store)(struct kobject *, struct kobj_attribute *,
+						     const char *, size_t))
+{
+	sysfs_attr_init(&attr->attr);
+	attr->attr.name = name;
+	attr->attr.mode = mode;
+	attr->show = show;
+	attr->store = store;
 }
 
 static const struct of_device_id of_nvpmodel_clk_cap_match[] = {
@@ -168,6 +478,8 @@ static int nvpmodel_clk_cap_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, nvpm_clk_cap);
 
+	mutex_init(&nvpm_clk_cap->lock);
+	nvpm_clk_cap->active_mode = -1;
 	nvpm_clk_cap->bpmp = tb;
 	nvpm_clk_cap->num_clocks = of_property_count_strings(dn, "clock-names");
 	if (nvpm_clk_cap->num_clocks <= 0) {
@@ -198,6 +510,7 @@ static int nvpmodel_clk_cap_probe(struct platform_device *pdev)
 		}
 
 		(nvpm_clk_cap->clks)[i].bpmp = tb;
+		(nvpm_clk_cap->clks)[i].nvpm_clk_cap = nvpm_clk_cap;
 		(nvpm_clk_cap->clks)[i].clk = devm_clk_get(&pdev->dev, clk_name);
 		if (IS_ERR((nvpm_clk_cap->clks)[i].clk)) {
 			(nvpm_clk_cap->clks)[i].clk = NULL;
@@ -227,6 +540,17 @@ static int nvpmodel_clk_cap_probe(struct platform_device *pdev)
 		}
 	}
 
+	nvpmodel_mode_attr_init(&nvpm_clk_cap->modes_attr, "modes", 0664,
+				modes_show, modes_store);
+	nvpmodel_mode_attr_init(&nvpm_clk_cap->mode_attr, "mode", 0664,
+				mode_show, mode_store);
+	nvpmodel_mode_attr_init(&nvpm_clk_cap->latency_attr, "mode_switch_latency_us", 0444,
+				mode_switch_latency_us_show, NULL);
+	if (sysfs_create_file(nvpm_clk_cap->clk_cap_kobject, &nvpm_clk_cap->modes_attr.attr) ||
+	    sysfs_create_file(nvpm_clk_cap->clk_cap_kobject, &nvpm_clk_cap->mode_attr.attr) ||
+	    sysfs_create_file(nvpm_clk_cap->clk_cap_kobject, &nvpm_clk_cap->latency_attr.attr))
+		dev_warn(&pdev->dev, "Couldn't create power mode sysfs\n");
+
 	return ret;
 
 put_bpmp:
@@ -245,6 +569,12 @@ static int nvpmodel_clk_cap_remove(struct platform_device *pdev)
 
 	tegra_bpmp_put(nvpm_clk_cap->bpmp);
 
+	sysfs_remove_file(nvpm_clk_cap->clk_cap_kobject, &nvpm_clk_cap->latency_attr.attr);
+	sysfs_remove_file(nvpm_clk_cap->clk_cap_kobject, &nvpm_clk_cap->mode_attr.attr);
+	sysfs_remove_file(nvpm_clk_cap->clk_cap_kobject, &nvpm_clk_cap->modes_attr.attr);
+	for (i = 0; i < NVPMODEL_MAX_MODES; i++)
+		kfree(nvpm_clk_cap->modes[i].caps);
+
 	if (nvpm_clk_cap->clks) {
 		for (i = 0; i < nvpm_clk_cap->num_clocks; i++) {
 			if ((nvpm_clk_cap->clks)[i].attr.attr.name)
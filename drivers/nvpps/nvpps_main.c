@@ -23,6 +23,7 @@
 #include <linux/hte.h>
 #include <linux/nvpps.h>
 #include <linux/of_address.h>
+#include <linux/mm.h>
 
 
 /* the following control flags are for
@@ -33,6 +34,7 @@
 
 
 #define MAX_NVPPS_SOURCES	1
+#define NVPPS_XTS_MAX_SAMPLES	32
 #define NVPPS_DEF_MODE		NVPPS_MODE_GPIO
 
 /* statics */
@@ -63,6 +65,11 @@ struct nvpps_device_data {
 	u64			secondary_phc;
 	u64			irq_latency;
 	u64			tsc_res_ns;
+	u64			corr_err_ns;
+	/* PTP/TSC cross timestamp samples per event, 0 for a single read */
+	u32			xts_samples;
+	struct page		*shm_page;
+	struct nvpps_shm	*shm;
 	raw_spinlock_t		lock;
 	struct mutex		ts_lock;
 
@@ -235,6 +242,82 @@ static inline u64 get_systime(struct nvpps_device_data *pdev_data, u64 *tsc)
 	return ns;
 }
 
+/*
+ * Sample PHC and TSC xts_samples times, bracketing each PHC read with two
+ * TSC reads, and keep the sample with the shortest bracket. Interrupts and
+ * bus contention only ever make the bracket longer, so the shortest one is
+ * the best estimate of the PHC/TSC relation and half of its width is the
+ * remaining error.
+ */
+static u64 get_systime_xts(struct nvpps_device_data *pdev_data, u64 *tsc,
+			   u64 *corr_err_ns)
+{
+	u64 ns1, ns2, ns = 0;
+	u64 tsc1, tsc2, delay, best_delay = U64_MAX;
+	u32 varmac_stnsr1, varmac_stnsr2;
+	u32 varmac_stsr;
+	u32 i;
+
+	for (i = 0; i < pdev_data->xts_samples; i++) {
+		tsc1 = __arch_counter_get_cntvct();
+
+		MAC_STNSR_RD(varmac_stnsr1);
+		MAC_STSR_RD(varmac_stsr);
+		MAC_STNSR_RD(varmac_stnsr2);
+
+		ns1 = GET_VALUE(varmac_stnsr1, MAC_STNSR_TSSS_LPOS, MAC_STNSR_TSSS_HPOS);
+		ns2 = GET_VALUE(varmac_stnsr2, MAC_STNSR_TSSS_LPOS, MAC_STNSR_TSSS_HPOS);
+
+		/* nsec counter rollover, read the updated sec counter again */
+		if (ns1 > ns2) {
+			MAC_STSR_RD(varmac_stsr);
+			ns1 = ns2;
+		}
+
+		tsc2 = __arch_counter_get_cntvct();
+
+		delay = tsc2 - tsc1;
+		if (delay < best_delay) {
+			best_delay = delay;
+			*tsc = tsc1 + delay / 2;
+			ns = ns1 + (varmac_stsr * 1000000000ull);
+		}
+	}
+
+	*corr_err_ns = (best_delay * pdev_data->tsc_res_ns) / 2;
+
+	return ns;
+}
+
+/*
+ * Publish the latest event to the mmap page, called with lock held
+ */
+static void nvpps_shm_publish(struct nvpps_device_data *pdev_data)
+{
+	struct nvpps_shm *shm = pdev_data->shm;
+	u64 tsc = pdev_data->tsc;
+
+	if (pdev_data->tsc_mode == NVPPS_TSC_NSEC &&
+	    !pdev_data->use_gpio_int_timestamp)
+		tsc *= pdev_data->tsc_res_ns;
+
+	WRITE_ONCE(shm->seq, shm->seq + 1);
+	smp_wmb();
+
+	WRITE_ONCE(shm->evt_nb, pdev_data->pps_event_id);
+	WRITE_ONCE(shm->evt_mode, pdev_data->actual_evt_mode);
+	WRITE_ONCE(shm->tsc_mode, pdev_data->tsc_mode);
+	WRITE_ONCE(shm->tsc, tsc);
+	WRITE_ONCE(shm->ptp, pdev_data->phc);
+	WRITE_ONCE(shm->secondary_ptp, pdev_data->secondary_phc);
+	WRITE_ONCE(shm->tsc_res_ns, pdev_data->tsc_res_ns);
+	WRITE_ONCE(shm->irq_latency, pdev_data->irq_latency);
+	WRITE_ONCE(shm->corr_err_ns, pdev_data->corr_err_ns);
+
+	smp_wmb();
+	WRITE_ONCE(shm->seq, shm->seq + 1);
+}
+
 /*
  * Report the PPS event
  */
@@ -244,13 +327,17 @@ static void nvpps_get_ts(struct nvpps_device_data *pdev_data, u64 irq_tsc)
 	u64		phc = 0;
 	u64		secondary_phc = 0;
 	u64		irq_latency = 0;
+	u64		corr_err_ns = 0;
 	unsigned long	flags;
 	struct ptp_tsc_data ptp_tsc_ts = {0}, sec_ptp_tsc_ts = {0};
 
 	/* get the PTP timestamp */
 	if (pdev_data->mac_base_addr) {
 		/* get both the phc(using memmap reg) and tsc */
-		phc = get_systime(pdev_data, &tsc);
+		if (pdev_data->xts_samples)
+			phc = get_systime_xts(pdev_data, &tsc, &corr_err_ns);
+		else
+			phc = get_systime(pdev_data, &tsc);
 		/*TODO : support fetching ptp offset using memmap method */
 	} else {
 		/* get PTP_TSC concurrent timestamp(using ptp notifier) from MAC driver */
@@ -330,6 +417,8 @@ static void nvpps_get_ts(struct nvpps_device_data *pdev_data, u64 irq_tsc)
 	 * irq_latency will be 0 if TIMER mode,  >0 if GPIO mode
 	 */
 	pdev_data->secondary_phc = secondary_phc ? secondary_phc - irq_latency : secondary_phc;
+	pdev_data->corr_err_ns = corr_err_ns;
+	nvpps_shm_publish(pdev_data);
 	raw_spin_unlock_irqrestore(&pdev_data->lock, flags);
 
 	/* event notification */
@@ -708,6 +797,29 @@ static long nvpps_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 
 
 
+static int nvpps_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct nvpps_file_data		*pfile_data = (struct nvpps_file_data *)file->private_data;
+	struct nvpps_device_data	*pdev_data = pfile_data->pdev_data;
+
+	if (vma->vm_pgoff || (vma->vm_end - vma->vm_start) != PAGE_SIZE)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	/* the mapping holds its own reference on the page */
+	return vm_insert_page(vma, vma->vm_start, pdev_data->shm_page);
+}
+
+
+
 static int nvpps_open(struct inode *inode, struct file *file)
 {
 	struct nvpps_device_data	*pdev_data = container_of(inode->i_cdev, struct nvpps_device_data, cdev);
@@ -747,6 +859,7 @@ static const struct file_operations nvpps_fops = {
 	.poll		= nvpps_poll,
 	.fasync		= nvpps_fasync,
 	.unlocked_ioctl	= nvpps_ioctl,
+	.mmap		= nvpps_mmap,
 	.open		= nvpps_open,
 	.release	= nvpps_close,
 };
@@ -939,6 +1052,12 @@ static void nvpps_ptp_tsc_sync_config(struct platform_device *pdev)
 	return;
 }
 
+static void nvpps_shm_free(void *data)
+{
+	/* mappings still in place keep the page until they are gone */
+	put_page(data);
+}
+
 static int nvpps_probe(struct platform_device *pdev)
 {
 	struct nvpps_device_data	*pdev_data;
@@ -998,6 +1117,24 @@ static int nvpps_probe(struct platform_device *pdev)
 	raw_spin_lock_init(&pdev_data->lock);
 	mutex_init(&pdev_data->ts_lock);
 	pdev_data->pdev = pdev;
+
+	if (of_property_read_u32(np, "ptp_tsc_xts_samples", &pdev_data->xts_samples) == 0) {
+		if (pdev_data->xts_samples > NVPPS_XTS_MAX_SAMPLES)
+			pdev_data->xts_samples = NVPPS_XTS_MAX_SAMPLES;
+		if (pdev_data->xts_samples && !pdev_data->mac_base_addr)
+			dev_warn(&pdev->dev, "ptp_tsc_xts_samples needs memmap_phc_regs, ignored\n");
+		else
+			dev_info(&pdev->dev, "Using %u PTP/TSC cross timestamp samples\n",
+				 pdev_data->xts_samples);
+	}
+
+	pdev_data->shm_page = alloc_page(GFP_KERNEL | __GFP_ZERO);
+	if (!pdev_data->shm_page)
+		return -ENOMEM;
+	err = devm_add_action_or_reset(&pdev->dev, nvpps_shm_free, pdev_data->shm_page);
+	if (err)
+		return err;
+	pdev_data->shm = page_address(pdev_data->shm_page);
 	pdev_data->evt_mode = 0; /* NVPPS_MODE_GPIO */
 	pdev_data->tsc_mode = NVPPS_TSC_NSEC;
 	#define _PICO_SECS (1000000000000ULL)
@@ -14,6 +14,113 @@
 #include <linux/pci-ecam.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/xarray.h>
+
+/*
+ * Every config access from the VM traps into the hypervisor. The dwords of
+ * the header that are read-only are kept after the first read, which also
+ * remembers empty slots, and BARs are only claimed once a driver binds.
+ */
+static bool config_cache = true;
+module_param(config_cache, bool, 0444);
+MODULE_PARM_DESC(config_cache, "Cache read-only config space dwords");
+
+static bool defer_bar_claim = true;
+module_param(defer_bar_claim, bool, 0444);
+MODULE_PARM_DESC(defer_bar_claim, "Claim BARs of a function when its driver binds");
+
+/* cached dwords: vendor/device, class/revision and capability pointer */
+#define PCI_TEGRA_VF_CACHE_DWORDS	3
+
+struct pci_tegra_vf_cfg_cache {
+	u32 dw[PCI_TEGRA_VF_CACHE_DWORDS];
+	unsigned long valid;
+};
+
+struct pci_tegra_vf {
+	struct pci_host_bridge *bridge;
+	struct notifier_block nb;
+	/* pci_tegra_vf_cfg_cache indexed by bus number << 8 | devfn */
+	struct xarray cache;
+};
+
+static int pci_tegra_vf_cache_slot(int where)
+{
+	switch (where & ~3) {
+	case PCI_VENDOR_ID:
+		return 0;
+	case PCI_CLASS_REVISION:
+		return 1;
+	case PCI_CAPABILITY_LIST:
+		return 2;
+	default:
+		return -1;
+	}
+}
+
+/* Called with pci_lock held, so nothing here may sleep */
+static int pci_tegra_vf_config_read(struct pci_bus *bus, unsigned int devfn,
+				    int where, int size, u32 *val)
+{
+	struct pci_config_window *cfg = bus->sysdata;
+	struct pci_tegra_vf *vf = cfg->priv;
+	unsigned long index = (bus->number << 8) | devfn;
+	struct pci_tegra_vf_cfg_cache *entry;
+	int slot = pci_tegra_vf_cache_slot(where);
+	u32 dw;
+	int ret;
+
+	if (!config_cache || slot < 0)
+		return pci_generic_config_read(bus, devfn, where, size, val);
+
+	entry = xa_load(&vf->cache, index);
+	if (entry && test_bit(slot, &entry->valid)) {
+		dw = entry->dw[slot];
+	} else {
+		ret = pci_generic_config_read(bus, devfn, where & ~3, 4, &dw);
+		if (ret != PCIBIOS_SUCCESSFUL)
+			return ret;
+
+		if (!entry) {
+			entry = kzalloc(sizeof(*entry), GFP_ATOMIC);
+			if (entry && xa_err(xa_store(&vf->cache, index, entry,
+						     GFP_ATOMIC))) {
+				kfree(entry);
+				entry = NULL;
+			}
+		}
+
+		if (entry) {
+			entry->dw[slot] = dw;
+			__set_bit(slot, &entry->valid);
+		}
+	}
+
+	dw >>= 8 * (where & 3);
+	if (size < 4)
+		dw &= (1U << (8 * size)) - 1;
+	*val = dw;
+
+	return PCIBIOS_SUCCESSFUL;
+}
+
+static struct pci_ops pci_tegra_vf_pci_ops = {
+	.map_bus = pci_ecam_map_bus,
+	.read = pci_tegra_vf_config_read,
+	.write = pci_generic_config_write,
+};
+
+static void pci_tegra_vf_cache_free(struct pci_tegra_vf *vf)
+{
+	struct pci_tegra_vf_cfg_cache *entry;
+	unsigned long index;
+
+	xa_for_each(&vf->cache, index, entry)
+		kfree(entry);
+
+	xa_destroy(&vf->cache);
+}
 
 static void pci_tegra_vf_ecam_free(void *ptr)
 {
@@ -70,11 +177,30 @@ static int pci_tegra_vf_claim_resource(struct pci_dev *dev, void *data)
 	return 0;
 }
 
+static int pci_tegra_vf_bus_notify(struct notifier_block *nb,
+				   unsigned long action, void *data)
+{
+	struct pci_tegra_vf *vf = container_of(nb, struct pci_tegra_vf, nb);
+	struct pci_dev *pdev = to_pci_dev(data);
+
+	if (action != BUS_NOTIFY_BIND_DRIVER)
+		return NOTIFY_DONE;
+
+	if (pci_find_host_bridge(pdev->bus) != vf->bridge)
+		return NOTIFY_DONE;
+
+	/* may run from pci_bus_add_devices() with the rescan lock held */
+	pci_tegra_vf_claim_resource(pdev, NULL);
+
+	return NOTIFY_OK;
+}
+
 static int pci_tegra_vf_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
 	struct pci_host_bridge *bridge;
 	struct pci_config_window *cfg;
+	struct pci_tegra_vf *vf;
 	struct pci_bus *bus;
 	LIST_HEAD(resources);
 	static struct resource busn_res = {
@@ -83,6 +209,12 @@ static int pci_tegra_vf_probe(struct platform_device *pdev)
 		.flags = IORESOURCE_BUS,
 	};
 
+	vf = devm_kzalloc(dev, sizeof(*vf), GFP_KERNEL);
+	if (!vf)
+		return -ENOMEM;
+
+	xa_init(&vf->cache);
+
 	bridge = pci_alloc_host_bridge(0);
 	if (!bridge) {
 		dev_err(dev, "pci_alloc_host_bridge() failed\n");
@@ -96,10 +228,11 @@ static int pci_tegra_vf_probe(struct platform_device *pdev)
 		return PTR_ERR(cfg);
 	}
 
+	cfg->priv = vf;
 	bridge->sysdata = cfg;
-	bridge->ops = (struct pci_ops *)&pci_generic_ecam_ops.pci_ops;
+	bridge->ops = &pci_tegra_vf_pci_ops;
 
-	platform_set_drvdata(pdev, bridge);
+	platform_set_drvdata(pdev, vf);
 
 	pci_add_resource(&resources, &ioport_resource);
 	pci_add_resource(&resources, &iomem_resource);
@@ -112,10 +245,19 @@ static int pci_tegra_vf_probe(struct platform_device *pdev)
 		dev_err(dev, "pci_scan_root_bus() failed\n");
 		pci_unlock_rescan_remove();
 		pci_free_resource_list(&resources);
+		pci_tegra_vf_cache_free(vf);
 		return -ENOMEM;
 	}
 
-	pci_walk_bus(bus, pci_tegra_vf_claim_resource, pdev);
+	/* pci_scan_root_bus() creates the host bridge the bus hangs off */
+	vf->bridge = to_pci_host_bridge(bus->bridge);
+
+	if (defer_bar_claim) {
+		vf->nb.notifier_call = pci_tegra_vf_bus_notify;
+		bus_register_notifier(&pci_bus_type, &vf->nb);
+	} else {
+		pci_walk_bus(bus, pci_tegra_vf_claim_resource, pdev);
+	}
 
 	pci_bus_add_devices(bus);
 
@@ -126,13 +268,19 @@ static int pci_tegra_vf_probe(struct platform_device *pdev)
 
 static int pci_tegra_vf_remove(struct platform_device *pdev)
 {
-	struct pci_host_bridge *bridge = platform_get_drvdata(pdev);
+	struct pci_tegra_vf *vf = platform_get_drvdata(pdev);
+	struct pci_bus *bus = vf->bridge->bus;
+
+	if (defer_bar_claim)
+		bus_unregister_notifier(&pci_bus_type, &vf->nb);
 
 	pci_lock_rescan_remove();
-	pci_stop_root_bus(bridge->bus);
-	pci_remove_root_bus(bridge->bus);
+	pci_stop_root_bus(bus);
+	pci_remove_root_bus(bus);
 	pci_unlock_rescan_remove();
 
+	pci_tegra_vf_cache_free(vf);
+
 	return 0;
 }
 
@@ -146,6 +294,8 @@ static struct platform_driver pci_tegra_vf_driver = {
 	.driver = {
 		.name = "pcie-tegra-vf",
 		.of_match_table = pci_tegra_vf_of_match,
+		/* keep VF enumeration out of the way of the rest of boot */
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = pci_tegra_vf_probe,
 	.remove = pci_tegra_vf_remove,
@@ -8,8 +8,11 @@
 #include <linux/module.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
+#include <linux/hrtimer.h>
 #include <linux/io.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
@@ -33,6 +36,23 @@
 
 #define INCR_DESC(idx, i) ((idx) = ((idx) + (i)) % (ch->desc_sz))
 
+static unsigned int intr_coalesce = 1;
+module_param(intr_coalesce, uint, 0644);
+MODULE_PARM_DESC(intr_coalesce,
+	"Async xfers per completion interrupt for channels that do not set it, 1 interrupts every xfer");
+
+static unsigned int coalesce_timeout_us = 50;
+module_param(coalesce_timeout_us, uint, 0644);
+MODULE_PARM_DESC(coalesce_timeout_us,
+	"Time after which completed xfers are reaped when no interrupt was raised for them");
+
+static unsigned int ring_depth;
+module_param(ring_depth, uint, 0444);
+MODULE_PARM_DESC(ring_depth,
+	"Descriptors per local EDMA channel, power of 2, 0 uses the client's num_descriptors");
+
+struct edma_prv;
+
 struct edma_chan {
 	void *desc;
 	void __iomem *remap_desc;
@@ -55,6 +75,23 @@ struct edma_chan {
 	bool db_pos;
 	/** This field is updated to abort or de-init to stop further xfer submits */
 	edma_xfer_status_t st;
+	struct edma_prv *prv;
+	/** Async xfers per completion interrupt */
+	u32 intr_coalesce;
+	/** Async xfers submitted since the last one with LIE set */
+	u32 intr_pending;
+	/** Reaps xfers submitted without LIE */
+	struct hrtimer coalesce_timer;
+	atomic_t reap;
+	edma_complete_batch_t *complete_batch;
+	void *batch_priv;
+	/** priv cookies of one completion pass, passed to complete_batch */
+	void **batch;
+	spinlock_t stats_lock;
+	struct tegra_pcie_edma_chan_stats stats;
+	/** Time the ring went non-empty, 0 while idle */
+	ktime_t busy_since;
+	ktime_t stats_start;
 };
 
 struct edma_prv {
@@ -72,6 +109,8 @@ struct edma_prv {
 	struct edma_chan rx[DMA_RD_CHNL_NUM];
 	/* BIT(0) - Write initialized, BIT(1) - Read initialized */
 	uint32_t ch_init;
+	/* Set by the hard irq handler, the thread may also run from the coalescing timer */
+	atomic_t irq_masked;
 };
 
 /** TODO: Define osi_ll_init strcuture and make this as OSI */
@@ -199,12 +238,20 @@ static inline int edma_ch_init(struct edma_prv *prv, struct edma_chan *ch)
 	ch->pcs = 1;
 	ch->st = EDMA_XFER_SUCCESS;
 
+	ch->intr_pending = 0;
+
 	if (!ch->ring) {
 		ch->ring = kcalloc(ch->desc_sz, sizeof(*ch->ring), GFP_KERNEL);
 		if (!ch->ring)
 			return -ENOMEM;
 	}
 
+	if (ch->complete_batch && !ch->batch) {
+		ch->batch = kcalloc(ch->desc_sz, sizeof(*ch->batch), GFP_KERNEL);
+		if (!ch->batch)
+			return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -265,10 +312,11 @@ static inline u32 get_dma_idx_from_llp(struct edma_prv *prv, u8 chan, struct edm
 
 static inline void process_r_idx(struct edma_chan *ch, edma_xfer_status_t st, u32 idx)
 {
-	u32 count = 0;
+	u32 count = 0, done = 0, nbatch = 0;
 	struct edma_hw_desc *dma_ll_virt;
 	struct edma_dblock *db;
 	struct tegra_pcie_edma_xfer_info *ring;
+	ktime_t now;
 
 	while ((ch->r_idx != idx) && (count < ch->desc_sz)) {
 		count++;
@@ -280,13 +328,53 @@ static inline void process_r_idx(struct edma_chan *ch, edma_xfer_status_t st, u3
 		/* clear lie and rie if any set */
 		dma_ll_virt->ctrl_reg.ctrl_e.lie = 0;
 		dma_ll_virt->ctrl_reg.ctrl_e.rie = 0;
-		if (ch->type == EDMA_CHAN_XFER_ASYNC && ring->complete) {
-			ring->complete(ring->priv, st, NULL);
-			/* Clear ring callback and priv variables */
-			ring->complete = NULL;
-			ring->priv = NULL;
+		/* nents is only set in the ring entry of the last desc of a xfer */
+		if (ring->nents == 0)
+			continue;
+
+		done++;
+		if (ch->type == EDMA_CHAN_XFER_ASYNC) {
+			if (ch->complete_batch)
+				ch->batch[nbatch++] = ring->priv;
+			else if (ring->complete)
+				ring->complete(ring->priv, st, NULL);
 		}
+		/* Clear ring callback and priv variables */
+		ring->complete = NULL;
+		ring->priv = NULL;
+		ring->nents = 0;
 	}
+
+	if (nbatch)
+		ch->complete_batch(ch->batch_priv, st, ch->batch, nbatch);
+
+	now = ktime_get();
+	spin_lock(&ch->stats_lock);
+	ch->stats.completions += done;
+	if (ch->r_idx == ch->w_idx && ch->busy_since) {
+		ch->stats.busy_ns += ktime_to_ns(ktime_sub(now, ch->busy_since));
+		ch->busy_since = 0;
+	}
+	spin_unlock(&ch->stats_lock);
+}
+
+static void edma_coalesce_arm(struct edma_chan *ch)
+{
+	if (!hrtimer_active(&ch->coalesce_timer))
+		hrtimer_start(&ch->coalesce_timer,
+			      us_to_ktime(max(coalesce_timeout_us, 1U)),
+			      HRTIMER_MODE_REL);
+}
+
+static enum hrtimer_restart edma_coalesce_timer(struct hrtimer *timer)
+{
+	struct edma_chan *ch = container_of(timer, struct edma_chan, coalesce_timer);
+
+	/* Reap from the irq thread, which owns r_idx */
+	atomic_set(&ch->reap, 1);
+	irq_wake_thread(ch->prv->irq, ch->prv);
+
+	return HRTIMER_NORESTART;
 }
 
 static inline void process_ch_irq(struct edma_prv *prv, u32 chan, struct edma_chan *ch,
@@ -321,8 +409,11 @@ process_abort:
 
 static irqreturn_t edma_irq(int irq, void *cookie)
 {
+	struct edma_prv *prv = (struct edma_prv *)cookie;
+
 	/* Disable irq before wake thread handler */
 	disable_irq_nosync((u32)(irq & INT_MAX));
+	atomic_set(&prv->irq_masked, 1);
 
 	return IRQ_WAKE_THREAD;
 }
@@ -357,6 +448,7 @@ static irqreturn_t edma_irq_handler(int irq, void *cookie)
 	u32 mode_cnt[2] = {DMA_WR_CHNL_NUM, DMA_RD_CHNL_NUM};
 	u32 ctrl_off[2] = {DMA_CH_CONTROL1_OFF_WRCH, DMA_CH_CONTROL1_OFF_RDCH};
 	u32 db_off[2] = {DMA_WRITE_DOORBELL_OFF, DMA_READ_DOORBELL_OFF};
+	bool reap;
 
 	for (i = 0; i < 2; i++) {
 		if (!(prv->ch_init & OSI_BIT(i)))
@@ -400,21 +492,34 @@ static irqreturn_t edma_irq_handler(int irq, void *cookie)
 		} else {
 			for (bit = 0; bit < mode_cnt[i]; bit++) {
 				ch = chan[i] + bit;
+				reap = atomic_xchg(&ch->reap, 0) && ch->ring;
 				if (OSI_BIT(bit) & val) {
 					dma_common_wr(prv->edma_base, OSI_BIT(bit),
 						      int_clear_off[i]);
-					process_ch_irq(prv, bit, ch, i);
-					/* Check if there are pending descriptors */
-					if (ch->w_idx != ch->r_idx)
-						edma_check_and_ring_db(prv, (u8)(bit & 0xFF),
-								       ctrl_off[i], db_off[i]);
+				} else if (reap) {
+					spin_lock(&ch->stats_lock);
+					ch->stats.timer_reaps++;
+					spin_unlock(&ch->stats_lock);
+				} else {
+					continue;
+				}
+
+				process_ch_irq(prv, bit, ch, i);
+				/* Check if there are pending descriptors */
+				if (ch->w_idx != ch->r_idx) {
+					edma_check_and_ring_db(prv, (u8)(bit & 0xFF),
+							       ctrl_off[i], db_off[i]);
+					/* xfers without LIE may be among them */
+					if (ch->intr_coalesce > 1 && ch->st == EDMA_XFER_SUCCESS)
+						edma_coalesce_arm(ch);
 				}
 			}
 		}
 	}
 
-	/* Must enable before exit */
-	enable_irq((u32)(irq & INT_MAX));
+	/* Must enable before exit, only if the hard irq handler disabled it */
+	if (atomic_xchg(&prv->irq_masked, 0))
+		enable_irq((u32)(irq & INT_MAX));
 	return IRQ_HANDLED;
 }
 
@@ -441,6 +546,16 @@ void *tegra_pcie_edma_initialize(struct tegra_pcie_edma_init_info *info)
 	chan_info[0] = &info->tx[0];
 	chan_info[1] = &info->rx[0];
 
+	for (j = 0; j < 2; j++) {
+		for (i = 0; i < mode_cnt[j]; i++) {
+			ch = chan[j] + i;
+			ch->prv = prv;
+			spin_lock_init(&ch->stats_lock);
+			hrtimer_init(&ch->coalesce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+			ch->coalesce_timer.function = edma_coalesce_timer;
+		}
+	}
+
 	if (info->edma_remote != NULL) {
 		if (!info->edma_remote->dev) {
 			pr_err("%s: dev pointer is NULL\n", __func__);
@@ -509,6 +624,21 @@ void *tegra_pcie_edma_initialize(struct tegra_pcie_edma_init_info *info)
 
 			ch->type = ch_info->ch_type;
 			ch->desc_sz = ch_info->num_descriptors;
+			/* Remote DMA descriptors are allocated by the client */
+			if (!prv->is_remote_dma && ring_depth) {
+				if (is_power_of_2(ring_depth) && ring_depth > 1)
+					ch->desc_sz = ring_depth;
+				else
+					dev_warn(prv->dev, "ignoring ring_depth %u, not a power of 2\n",
+						 ring_depth);
+			}
+			ch->intr_coalesce = ch_info->intr_coalesce ? ch_info->intr_coalesce :
+								     max(intr_coalesce, 1U);
+			if (ch->type == EDMA_CHAN_XFER_ASYNC) {
+				ch->complete_batch = ch_info->complete_batch;
+				ch->batch_priv = ch_info->batch_priv;
+			}
+			ch->stats_start = ktime_get();
 			ch->edma_desc_size = (sizeof(struct edma_dblock)) * ((ch->desc_sz / 2) + 1);
 
 			if (prv->is_remote_dma) {
@@ -578,6 +708,7 @@ free_ring:
 		for (i = 0; i < mode_cnt[j]; i++) {
 			ch = chan[j] + i;
 			kfree(ch->ring);
+			kfree(ch->batch);
 		}
 	}
 free_dma_desc:
@@ -610,14 +741,14 @@ edma_xfer_status_t tegra_pcie_edma_submit_xfer(void *cookie,
 	struct edma_hw_desc *dma_ll_virt = NULL;
 	struct edma_dblock *db;
 	int i;
-	u64 total_sz = 0;
+	u64 total_sz = 0, bytes = 0;
 	edma_xfer_status_t st = EDMA_XFER_SUCCESS;
 	u32 avail, to_ms;
 	struct tegra_pcie_edma_xfer_info *ring;
 	u32 int_status_off[2] = {DMA_WRITE_INT_STATUS_OFF, DMA_READ_INT_STATUS_OFF};
 	u32 doorbell_off[2] = {DMA_WRITE_DOORBELL_OFF, DMA_READ_DOORBELL_OFF};
 	u32 mode_cnt[2] = {DMA_WR_CHNL_NUM, DMA_RD_CHNL_NUM};
-	bool pcs, final_pcs = false;
+	bool pcs, final_pcs = false, intr = true;
 	long ret, to_jif;
 
 	if (!prv || !tx_info || tx_info->nents == 0 || !tx_info->desc ||
@@ -631,7 +762,8 @@ edma_xfer_status_t tegra_pcie_edma_submit_xfer(void *cookie,
 	if (!ch->desc_sz)
 		return EDMA_XFER_FAIL_INVAL_INPUTS;
 
-	if ((tx_info->complete == NULL) && (ch->type == EDMA_CHAN_XFER_ASYNC))
+	if ((tx_info->complete == NULL) && (ch->type == EDMA_CHAN_XFER_ASYNC) &&
+	    (ch->complete_batch == NULL))
 		return EDMA_XFER_FAIL_INVAL_INPUTS;
 
 	/* Get hold of the hardware - locking */
@@ -649,10 +781,25 @@ edma_xfer_status_t tegra_pcie_edma_submit_xfer(void *cookie,
 	if (tx_info->nents > avail) {
 		dev_dbg(prv->dev, "Descriptors full. w_idx %d. r_idx %d, avail %d, req %d\n",
 			ch->w_idx, ch->r_idx, avail, tx_info->nents);
+		spin_lock(&ch->stats_lock);
+		ch->stats.ring_full++;
+		spin_unlock(&ch->stats_lock);
 		st = EDMA_XFER_FAIL_NOMEM;
 		goto unlock;
 	}
 
+	/*
+	 * Coalesce completion interrupts of async xfers, but always interrupt
+	 * before the ring runs low so that submitters do not see it full.
+	 */
+	if (ch->type == EDMA_CHAN_XFER_ASYNC && ch->intr_coalesce > 1) {
+		ch->intr_pending++;
+		intr = (ch->intr_pending >= ch->intr_coalesce) ||
+		       ((avail - tx_info->nents) < (ch->desc_sz / 4U));
+		if (intr)
+			ch->intr_pending = 0;
+	}
+
 	dev_dbg(prv->dev, "xmit for %d nents at %d widx and %d ridx\n",
 		tx_info->nents, ch->w_idx, ch->r_idx);
 	db = (struct edma_dblock *)ch->desc + (ch->w_idx/2);
@@ -662,14 +809,15 @@ edma_xfer_status_t tegra_pcie_edma_submit_xfer(void *cookie,
 		/* calculate number of packets and add those many headers */
 		total_sz +=  (u64)(((tx_info->desc[i].sz / ch->desc_sz) + 1) * 30ULL);
 		total_sz += tx_info->desc[i].sz;
+		bytes += tx_info->desc[i].sz;
 		dma_ll_virt->sar_low = lower_32_bits(tx_info->desc[i].src);
 		dma_ll_virt->sar_high = upper_32_bits(tx_info->desc[i].src);
 		dma_ll_virt->dar_low = lower_32_bits(tx_info->desc[i].dst);
 		dma_ll_virt->dar_high = upper_32_bits(tx_info->desc[i].dst);
 		/* Set LIE or RIE in last element */
 		if (i == tx_info->nents - 1) {
-			dma_ll_virt->ctrl_reg.ctrl_e.lie = 1;
-			dma_ll_virt->ctrl_reg.ctrl_e.rie = !!prv->is_remote_dma;
+			dma_ll_virt->ctrl_reg.ctrl_e.lie = intr;
+			dma_ll_virt->ctrl_reg.ctrl_e.rie = intr && prv->is_remote_dma;
 			final_pcs = ch->pcs;
 		} else {
 			/* CB should be updated last in the descriptor */
@@ -694,6 +842,16 @@ edma_xfer_status_t tegra_pcie_edma_submit_xfer(void *cookie,
 	ring = &ch->ring[avail];
 	ring->priv = tx_info->priv;
 	ring->complete = tx_info->complete;
+	ring->nents = tx_info->nents;
+
+	spin_lock(&ch->stats_lock);
+	ch->stats.xfers++;
+	ch->stats.descs += tx_info->nents;
+	ch->stats.bytes += bytes;
+	ch->stats.intrs += intr;
+	if (!ch->busy_since)
+		ch->busy_since = ktime_get();
+	spin_unlock(&ch->stats_lock);
 
 	/* Update CB post SW ring update to order callback and transfer updates */
 	dma_ll_virt->ctrl_reg.ctrl_e.cb = final_pcs;
@@ -717,6 +875,9 @@ edma_xfer_status_t tegra_pcie_edma_submit_xfer(void *cookie,
 
 	dma_common_wr(prv->edma_base, tx_info->channel_num, doorbell_off[tx_info->type]);
 
+	if (!intr)
+		edma_coalesce_arm(ch);
+
 	if (ch->type == EDMA_CHAN_XFER_SYNC) {
 		total_sz = GET_SYNC_TIMEOUT(total_sz);
 		to_ms = (total_sz > UINT_MAX) ? UINT_MAX : (u32)(total_sz & UINT_MAX);
@@ -776,16 +937,51 @@ static void edma_stop(struct edma_prv *prv, edma_xfer_status_t st)
 
 	synchronize_irq(prv->irq);
 
+	/* The irq thread may have re-armed a timer before seeing st */
+	for (j = 0; j < 2; j++)
+		for (i = 0; i < mode_cnt[j]; i++)
+			hrtimer_cancel(&chan[j][i].coalesce_timer);
+
+	synchronize_irq(prv->irq);
+
 	for (j = 0; j < 2; j++) {
 		for (i = 0; i < mode_cnt[j]; i++) {
 			ch = chan[j] + i;
 
-			if (prv->ch_init & OSI_BIT(i))
+			if (prv->ch_init & OSI_BIT(j))
 				process_r_idx(ch, st, ch->w_idx);
 		}
 	}
 }
 
+bool tegra_pcie_edma_get_stats(void *cookie, edma_xfer_type_t type, uint32_t channel_num,
+			       struct tegra_pcie_edma_chan_stats *stats)
+{
+	struct edma_prv *prv = (struct edma_prv *)cookie;
+	u32 mode_cnt[2] = {DMA_WR_CHNL_NUM, DMA_RD_CHNL_NUM};
+	struct edma_chan *ch;
+	ktime_t now;
+
+	if (!prv || !stats || (type < EDMA_XFER_WRITE || type > EDMA_XFER_READ) ||
+	    channel_num >= mode_cnt[type])
+		return false;
+
+	ch = (type == EDMA_XFER_WRITE) ? &prv->tx[channel_num] : &prv->rx[channel_num];
+	if (!ch->desc_sz)
+		return false;
+
+	now = ktime_get();
+	spin_lock(&ch->stats_lock);
+	*stats = ch->stats;
+	if (ch->busy_since)
+		stats->busy_ns += ktime_to_ns(ktime_sub(now, ch->busy_since));
+	spin_unlock(&ch->stats_lock);
+	stats->elapsed_ns = ktime_to_ns(ktime_sub(now, ch->stats_start));
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(tegra_pcie_edma_get_stats);
+
 bool tegra_pcie_edma_stop(void *cookie)
 {
 	struct edma_prv *prv = (struct edma_prv *)cookie;
@@ -825,6 +1021,7 @@ void tegra_pcie_edma_deinit(void *cookie)
 				dma_free_coherent(prv->dev, ch->edma_desc_size,
 						  ch->desc, ch->dma_iova);
 			kfree(ch->ring);
+			kfree(ch->batch);
 		}
 	}
 
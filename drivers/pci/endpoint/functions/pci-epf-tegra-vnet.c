@@ -4,12 +4,14 @@
 #include <nvidia/conftest.h>
 
 #include <linux/etherdevice.h>
+#include <linux/hrtimer.h>
 #include <linux/module.h>
 #include <linux/netdevice.h>
 #include <linux/of_platform.h>
 #include <linux/pci-epc.h>
 #include <linux/pci-epf.h>
 #include <linux/platform_device.h>
+#include <linux/reciprocal_div.h>
 #include <linux/version.h>
 #include <linux/workqueue.h>
 #include <linux/vmalloc.h>
@@ -33,6 +35,30 @@
 #define APPL_INTR_EN_L1_8_0                     0x44
 #define APPL_INTR_EN_L1_8_EDMA_INT_EN           BIT(6)
 
+/* DMA linked list of one channel, last element points back to the first */
+#define DMA_DESC_RING_SIZE	((DMA_DESC_COUNT + 1) * sizeof(struct tvnet_dma_desc))
+
+static unsigned int num_queues = TVNET_MAX_QUEUES;
+module_param(num_queues, uint, 0444);
+MODULE_PARM_DESC(num_queues, "Number of data queue pairs offered to the host");
+
+static unsigned int tx_coalesce_frames = 16;
+module_param(tx_coalesce_frames, uint, 0644);
+MODULE_PARM_DESC(tx_coalesce_frames,
+	"Frames pushed to the host before it is interrupted");
+
+static unsigned int tx_coalesce_usecs = 20;
+module_param(tx_coalesce_usecs, uint, 0644);
+MODULE_PARM_DESC(tx_coalesce_usecs,
+	"Maximum delay in us of the host interrupt, 0 disables coalescing");
+
+#if ENABLE_DMA
+static unsigned int tx_reap_us = 50;
+module_param(tx_reap_us, uint, 0644);
+MODULE_PARM_DESC(tx_reap_us,
+	"Interval in us to reclaim transmitted skbs while DMA is in flight");
+#endif
+
 enum bar0_amap_type {
 	META_DATA,
 	SIMPLE_IRQ,
@@ -87,6 +113,9 @@ struct syncpt_t {
 
 #endif
 
+struct pci_epf_tvnet;
+struct tvnet_ep_queue;
+
 struct irqsp_data {
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
 	/* Notification. */
@@ -96,6 +125,58 @@ struct irqsp_data {
 	struct work_struct reprime_work;
 #endif
 	struct device *dev;
+	/* Data queue notified through this syncpoint, NULL for ctrl */
+	struct tvnet_ep_queue *queue;
+};
+
+#if ENABLE_DMA
+/* Mapping of a DMA linked list element, skb is set on the last one of it */
+struct tvnet_ep_tx_buf {
+	struct sk_buff *skb;
+	struct tvnet_ep_queue *q;
+	dma_addr_t iova;
+	u32 len;
+	bool page;
+	u64 dst_iova;
+};
+
+/* EP DMA write channel, shared by queues with the same channel */
+struct tvnet_ep_dma {
+	struct pci_epf_tvnet *tvnet;
+	void *virt;
+	dma_addr_t iova;
+	struct dma_desc_cnt desc_cnt;
+	struct tvnet_ep_tx_buf *tx_buf;
+	/* Reclaims completed elements when xmit is idle */
+	struct hrtimer reap_timer;
+	/* To serialize xmit of queues sharing this channel */
+	spinlock_t lock;
+	u32 chan;
+};
+#endif
+
+struct tvnet_ep_queue {
+	struct pci_epf_tvnet *tvnet;
+	u32 qid;
+	struct napi_struct napi;
+	struct ep_ring_buf ep_ring_buf;
+	struct host_ring_buf host_ring_buf;
+	struct list_head h2ep_empty_list;
+	/* To protect h2ep empty list */
+	spinlock_t h2ep_empty_lock;
+#if ENABLE_DMA
+	struct tvnet_ep_dma *dma;
+#endif
+	struct irqsp_data *data_irqsp;
+	struct work_struct raise_irq_work;
+	/* Frames pushed to host since it was last interrupted */
+	atomic_t irq_pending;
+	struct hrtimer irq_timer;
+
+	struct tvnet_counter h2ep_empty;
+	struct tvnet_counter h2ep_full;
+	struct tvnet_counter ep2h_empty;
+	struct tvnet_counter ep2h_full;
 };
 
 struct pci_epf_tvnet {
@@ -107,7 +188,6 @@ struct pci_epf_tvnet {
 	struct bar_md *bar_md;
 	dma_addr_t bar0_iova;
 	struct net_device *ndev;
-	struct napi_struct napi;
 	bool pcie_link_status;
 	struct ep_ring_buf ep_ring_buf;
 	struct host_ring_buf host_ring_buf;
@@ -117,29 +197,28 @@ struct pci_epf_tvnet {
 	/* To synchronize network link state machine*/
 	struct mutex link_state_lock;
 	wait_queue_head_t link_state_wq;
-	struct list_head h2ep_empty_list;
+	u32 num_queues;
+	/* Queues serviced by host, xmit is spread over these only */
+	u32 active_queues;
+	/* TVNET_F_* and buffer size of host, from its CTRL_MSG_LINK_UP */
+	u32 peer_features;
+	u32 peer_max_frame;
+	struct tvnet_ep_queue queues[TVNET_MAX_QUEUES];
 #if ENABLE_DMA
-	struct dma_desc_cnt desc_cnt;
+	u32 num_dma;
+	struct tvnet_ep_dma dma[DMA_WR_CHNL_NUM];
 #endif
-	/* To protect h2ep empty list */
-	spinlock_t h2ep_empty_lock;
+	/* Read channels used by host, with linked lists in BAR0 HOST_DMA */
+	u32 num_host_dma;
 	dma_addr_t rx_buf_iova;
 	unsigned long *rx_buf_bitmap;
 	int rx_num_pages;
 	void __iomem *tx_dst_va;
 	phys_addr_t tx_dst_pci_addr;
-	void *ep_dma_virt;
-	dma_addr_t ep_dma_iova;
 	struct irqsp_data *ctrl_irqsp;
-	struct irqsp_data *data_irqsp;
-	struct work_struct raise_irq_work;
 
 	struct tvnet_counter h2ep_ctrl;
 	struct tvnet_counter ep2h_ctrl;
-	struct tvnet_counter h2ep_empty;
-	struct tvnet_counter h2ep_full;
-	struct tvnet_counter ep2h_empty;
-	struct tvnet_counter ep2h_full;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
 	/* DRV_MODE specific.*/
 	struct pci_epc *epc;
@@ -153,29 +232,70 @@ struct pci_epf_tvnet {
 #endif
 };
 
-static void tvnet_ep_raise_irq_work_function(struct work_struct *work)
+/* MSI-X vector 0 is for ctrl, data queue N uses vector N + 1 */
+static void tvnet_ep_raise_irq(struct pci_epf_tvnet *tvnet, u16 vector)
 {
-	struct pci_epf_tvnet *tvnet =
-		container_of(work, struct pci_epf_tvnet, raise_irq_work);
-
 	struct pci_epc *epc = tvnet->epf->epc;
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
 	struct pci_epf *epf = tvnet->epf;
-#endif
 
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
 #if defined(PCI_EPC_IRQ_TYPE_ENUM_PRESENT) /* Dropped from Linux 6.8 */
-	lpci_epc_raise_irq(epc, epf->func_no, PCI_EPC_IRQ_MSIX, 0);
-	lpci_epc_raise_irq(epc, epf->func_no, PCI_EPC_IRQ_MSIX, 1);
+	lpci_epc_raise_irq(epc, epf->func_no, PCI_EPC_IRQ_MSIX, vector);
 #else
-	lpci_epc_raise_irq(epc, epf->func_no, PCI_IRQ_MSIX, 0);
-	lpci_epc_raise_irq(epc, epf->func_no, PCI_IRQ_MSIX, 1);
+	lpci_epc_raise_irq(epc, epf->func_no, PCI_IRQ_MSIX, vector);
 #endif
 #else
-	pci_epc_raise_irq(epc, PCI_EPC_IRQ_MSIX, 0);
-	pci_epc_raise_irq(epc, PCI_EPC_IRQ_MSIX, 1);
+	pci_epc_raise_irq(epc, PCI_EPC_IRQ_MSIX, vector);
 #endif
+}
 
+static void tvnet_ep_raise_irq_work_function(struct work_struct *work)
+{
+	struct tvnet_ep_queue *q =
+		container_of(work, struct tvnet_ep_queue, raise_irq_work);
+
+	tvnet_ep_raise_irq(q->tvnet, 0);
+	tvnet_ep_raise_irq(q->tvnet, q->qid + 1);
+}
+
+/*
+ * Account a frame pushed to EP2H full ring, host is interrupted once
+ * tx_coalesce_frames of them are pending or tx_coalesce_usecs passed.
+ */
+static void tvnet_ep_notify_host_coalesced(struct tvnet_ep_queue *q)
+{
+	if (!tx_coalesce_usecs ||
+	    atomic_inc_return(&q->irq_pending) >= tx_coalesce_frames) {
+		atomic_set(&q->irq_pending, 0);
+		schedule_work(&q->raise_irq_work);
+	} else if (!hrtimer_is_queued(&q->irq_timer)) {
+		hrtimer_start(&q->irq_timer, us_to_ktime(tx_coalesce_usecs),
+			      HRTIMER_MODE_REL);
+	}
+}
+
+static enum hrtimer_restart tvnet_ep_irq_timer(struct hrtimer *timer)
+{
+	struct tvnet_ep_queue *q = container_of(timer, struct tvnet_ep_queue,
+						irq_timer);
+
+	if (atomic_xchg(&q->irq_pending, 0))
+		schedule_work(&q->raise_irq_work);
+
+	return HRTIMER_NORESTART;
+}
+
+static u32 tvnet_ep_max_queues(void)
+{
+#if ENABLE_DMA && (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
+	return clamp_t(u32, num_queues, 1, TVNET_MAX_QUEUES);
+#else
+	/*
+	 * CPU copy xmit shares a single PCIe window for host buffers and
+	 * nvhost provides one data syncpoint irq from DT, use one queue.
+	 */
+	return 1;
+#endif
 }
 
 static void tvnet_ep_read_ctrl_msg(struct pci_epf_tvnet *tvnet,
@@ -201,23 +321,11 @@ static int tvnet_ep_write_ctrl_msg(struct pci_epf_tvnet *tvnet,
 {
 	struct ep_ring_buf *ep_ring_buf = &tvnet->ep_ring_buf;
 	struct ctrl_msg *ctrl_msg = ep_ring_buf->ep2h_ctrl_msgs;
-	struct pci_epc *epc = tvnet->epf->epc;
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
-	struct pci_epf *epf = tvnet->epf;
-#endif
 	u32 idx;
 
 	if (tvnet_ivc_full(&tvnet->ep2h_ctrl)) {
 		/* Raise an interrupt to let host process EP2H ring */
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
-#if defined(PCI_EPC_IRQ_TYPE_ENUM_PRESENT) /* Dropped from Linux 6.8 */
-		lpci_epc_raise_irq(epc, epf->func_no, PCI_EPC_IRQ_MSIX, 0);
-#else
-		lpci_epc_raise_irq(epc, epf->func_no, PCI_IRQ_MSIX, 0);
-#endif
-#else
-		pci_epc_raise_irq(epc, PCI_EPC_IRQ_MSIX, 0);
-#endif
+		tvnet_ep_raise_irq(tvnet, 0);
 		dev_dbg(tvnet->fdev, "%s: EP2H ctrl ring full\n", __func__);
 		return -EAGAIN;
 	}
@@ -225,15 +333,7 @@ static int tvnet_ep_write_ctrl_msg(struct pci_epf_tvnet *tvnet,
 	idx = tvnet_ivc_get_wr_cnt(&tvnet->ep2h_ctrl) % RING_COUNT;
 	memcpy(&ctrl_msg[idx], msg, sizeof(*msg));
 	tvnet_ivc_advance_wr(&tvnet->ep2h_ctrl);
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
-#if defined(PCI_EPC_IRQ_TYPE_ENUM_PRESENT) /* Dropped from Linux 6.8 */
-	lpci_epc_raise_irq(epc, epf->func_no, PCI_EPC_IRQ_MSIX, 0);
-#else
-	lpci_epc_raise_irq(epc, epf->func_no, PCI_IRQ_MSIX, 0);
-#endif
-#else
-	pci_epc_raise_irq(epc, PCI_EPC_IRQ_MSIX, 0);
-#endif
+	tvnet_ep_raise_irq(tvnet, 0);
 
 	return 0;
 }
@@ -265,16 +365,15 @@ static void tvnet_ep_iova_dealloc(struct pci_epf_tvnet *tvnet, dma_addr_t iova)
 }
 #endif
 
-static void tvnet_ep_alloc_empty_buffers(struct pci_epf_tvnet *tvnet)
+static void tvnet_ep_alloc_empty_buffers(struct pci_epf_tvnet *tvnet,
+					 struct tvnet_ep_queue *q)
 {
-	struct ep_ring_buf *ep_ring_buf = &tvnet->ep_ring_buf;
+	struct ep_ring_buf *ep_ring_buf = &q->ep_ring_buf;
 	struct pci_epc *epc = tvnet->epf->epc;
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
-	struct pci_epf *epf = tvnet->epf;
-#endif
 	struct device *cdev = epc->dev.parent;
 	struct data_msg *h2ep_empty_msg = ep_ring_buf->h2ep_empty_msgs;
 	struct h2ep_empty_list *h2ep_empty_ptr;
+	u32 count = 0;
 #if ENABLE_DMA
 	struct net_device *ndev = tvnet->ndev;
 #else
@@ -282,7 +381,7 @@ static void tvnet_ep_alloc_empty_buffers(struct pci_epf_tvnet *tvnet)
 	int ret = 0;
 #endif
 
-	while (!tvnet_ivc_full(&tvnet->h2ep_empty)) {
+	while (!tvnet_ivc_full(&q->h2ep_empty)) {
 		dma_addr_t iova;
 #if ENABLE_DMA
 		struct sk_buff *skb;
@@ -375,28 +474,24 @@ static void tvnet_ep_alloc_empty_buffers(struct pci_epf_tvnet *tvnet)
 		h2ep_empty_ptr->size = PAGE_SIZE;
 #endif
 		h2ep_empty_ptr->iova = iova;
-		spin_lock_irqsave(&tvnet->h2ep_empty_lock, flags);
-		list_add_tail(&h2ep_empty_ptr->list, &tvnet->h2ep_empty_list);
-		spin_unlock_irqrestore(&tvnet->h2ep_empty_lock, flags);
+		spin_lock_irqsave(&q->h2ep_empty_lock, flags);
+		list_add_tail(&h2ep_empty_ptr->list, &q->h2ep_empty_list);
+		spin_unlock_irqrestore(&q->h2ep_empty_lock, flags);
 
-		idx = tvnet_ivc_get_wr_cnt(&tvnet->h2ep_empty) % RING_COUNT;
+		idx = tvnet_ivc_get_wr_cnt(&q->h2ep_empty) % RING_COUNT;
 		h2ep_empty_msg[idx].u.empty_buffer.pcie_address = iova;
 		h2ep_empty_msg[idx].u.empty_buffer.buffer_len = PAGE_SIZE;
-		tvnet_ivc_advance_wr(&tvnet->h2ep_empty);
-
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
-#if defined(PCI_EPC_IRQ_TYPE_ENUM_PRESENT) /* Dropped from Linux 6.8 */
-		lpci_epc_raise_irq(epc, epf->func_no, PCI_EPC_IRQ_MSIX, 0);
-#else
-		lpci_epc_raise_irq(epc, epf->func_no, PCI_IRQ_MSIX, 0);
-#endif
-#else
-		pci_epc_raise_irq(epc, PCI_EPC_IRQ_MSIX, 0);
-#endif
+		tvnet_ivc_advance_wr(&q->h2ep_empty);
+		count++;
 	}
+
+	/* One interrupt for the whole batch of empty buffers */
+	if (count)
+		tvnet_ep_raise_irq(tvnet, 0);
 }
 
-static void tvnet_ep_free_empty_buffers(struct pci_epf_tvnet *tvnet)
+static void tvnet_ep_free_empty_buffers(struct pci_epf_tvnet *tvnet,
+					struct tvnet_ep_queue *q)
 {
 	struct pci_epf *epf = tvnet->epf;
 	struct pci_epc *epc = epf->epc;
@@ -407,8 +502,8 @@ static void tvnet_ep_free_empty_buffers(struct pci_epf_tvnet *tvnet)
 	struct h2ep_empty_list *h2ep_empty_ptr, *temp;
 	unsigned long flags;
 
-	spin_lock_irqsave(&tvnet->h2ep_empty_lock, flags);
-	list_for_each_entry_safe(h2ep_empty_ptr, temp, &tvnet->h2ep_empty_list,
+	spin_lock_irqsave(&q->h2ep_empty_lock, flags);
+	list_for_each_entry_safe(h2ep_empty_ptr, temp, &q->h2ep_empty_list,
 				 list) {
 		list_del(&h2ep_empty_ptr->list);
 #if ENABLE_DMA
@@ -423,14 +518,14 @@ static void tvnet_ep_free_empty_buffers(struct pci_epf_tvnet *tvnet)
 #endif
 		kfree(h2ep_empty_ptr);
 	}
-	spin_unlock_irqrestore(&tvnet->h2ep_empty_lock, flags);
+	spin_unlock_irqrestore(&q->h2ep_empty_lock, flags);
 }
 
 static void tvnet_ep_stop_tx_queue(struct pci_epf_tvnet *tvnet)
 {
 	struct net_device *ndev = tvnet->ndev;
 
-	netif_stop_queue(ndev);
+	netif_tx_stop_all_queues(ndev);
 	/* Get tx lock to make sure that there is no ongoing xmit */
 	netif_tx_lock(ndev);
 	netif_tx_unlock(ndev);
@@ -443,26 +538,30 @@ static void tvnet_ep_stop_rx_work(struct pci_epf_tvnet *tvnet)
 
 static void tvnet_ep_clear_data_msg_counters(struct pci_epf_tvnet *tvnet)
 {
-	struct host_ring_buf *host_ring_buf = &tvnet->host_ring_buf;
-	struct host_own_cnt *host_cnt = host_ring_buf->host_cnt;
-	struct ep_ring_buf *ep_ring_buf = &tvnet->ep_ring_buf;
-	struct ep_own_cnt *ep_cnt = ep_ring_buf->ep_cnt;
+	struct host_own_cnt *host_cnt;
+	struct ep_own_cnt *ep_cnt;
+	u32 i;
+
+	for (i = 0; i < tvnet->num_queues; i++) {
+		host_cnt = tvnet->queues[i].host_ring_buf.host_cnt;
+		ep_cnt = tvnet->queues[i].ep_ring_buf.ep_cnt;
 
-	host_cnt->h2ep_empty_rd_cnt = 0;
-	ep_cnt->h2ep_empty_wr_cnt = 0;
-	ep_cnt->ep2h_full_wr_cnt = 0;
-	host_cnt->ep2h_full_rd_cnt = 0;
+		host_cnt->h2ep_empty_rd_cnt = 0;
+		ep_cnt->h2ep_empty_wr_cnt = 0;
+		ep_cnt->ep2h_full_wr_cnt = 0;
+		host_cnt->ep2h_full_rd_cnt = 0;
+	}
 }
 
 static void tvnet_ep_update_link_state(struct net_device *ndev,
 				    enum os_link_state state)
 {
 	if (state == OS_LINK_STATE_UP) {
-		netif_start_queue(ndev);
+		netif_tx_start_all_queues(ndev);
 		netif_carrier_on(ndev);
 	} else if (state == OS_LINK_STATE_DOWN) {
 		netif_carrier_off(ndev);
-		netif_stop_queue(ndev);
+		netif_tx_stop_all_queues(ndev);
 	} else {
 		pr_err("%s: invalid sate: %d\n", __func__, state);
 	}
@@ -487,11 +586,19 @@ static void tvnet_ep_update_link_sm(struct pci_epf_tvnet *tvnet)
 /* One way link state machine */
 static void tvnet_ep_user_link_up_req(struct pci_epf_tvnet *tvnet)
 {
-	struct ctrl_msg msg;
+	struct ctrl_msg msg = {};
+	u32 i;
 
 	tvnet_ep_clear_data_msg_counters(tvnet);
-	tvnet_ep_alloc_empty_buffers(tvnet);
+	for (i = 0; i < tvnet->num_queues; i++)
+		tvnet_ep_alloc_empty_buffers(tvnet, &tvnet->queues[i]);
 	msg.msg_id = CTRL_MSG_LINK_UP;
+	msg.u.link_up.features = TVNET_F_CSUM | TVNET_F_GSO;
+#if ENABLE_DMA
+	msg.u.link_up.max_frame = tvnet->ndev->mtu + ETH_HLEN;
+#else
+	msg.u.link_up.max_frame = PAGE_SIZE;
+#endif
 	tvnet_ep_write_ctrl_msg(tvnet, &msg);
 	tvnet->rx_link_state = DIR_LINK_STATE_UP;
 	tvnet_ep_update_link_sm(tvnet);
@@ -499,7 +606,7 @@ static void tvnet_ep_user_link_up_req(struct pci_epf_tvnet *tvnet)
 
 static void tvnet_ep_user_link_down_req(struct pci_epf_tvnet *tvnet)
 {
-	struct ctrl_msg msg;
+	struct ctrl_msg msg = {};
 
 	tvnet->rx_link_state = DIR_LINK_STATE_SENT_DOWN;
 	msg.msg_id = CTRL_MSG_LINK_DOWN;
@@ -507,15 +614,25 @@ static void tvnet_ep_user_link_down_req(struct pci_epf_tvnet *tvnet)
 	tvnet_ep_update_link_sm(tvnet);
 }
 
-static void tvnet_ep_rcv_link_up_msg(struct pci_epf_tvnet *tvnet)
+static void tvnet_ep_rcv_link_up_msg(struct pci_epf_tvnet *tvnet,
+				     struct ctrl_msg *msg)
 {
+	u32 host_queues = tvnet->bar_md->host_num_queues;
+
+	/* Offloads are used from the next xmit, see ndo_features_check */
+	WRITE_ONCE(tvnet->peer_features, msg->u.link_up.features);
+	WRITE_ONCE(tvnet->peer_max_frame, msg->u.link_up.max_frame);
+
+	/* Hosts without multi-queue support leave host_num_queues as 0 */
+	WRITE_ONCE(tvnet->active_queues,
+		   clamp_t(u32, host_queues, 1, tvnet->num_queues));
 	tvnet->tx_link_state = DIR_LINK_STATE_UP;
 	tvnet_ep_update_link_sm(tvnet);
 }
 
 static void tvnet_ep_rcv_link_down_msg(struct pci_epf_tvnet *tvnet)
 {
-	struct ctrl_msg msg;
+	struct ctrl_msg msg = {};
 
 	/* Stop using empty buffers of remote system */
 	tvnet_ep_stop_tx_queue(tvnet);
@@ -527,9 +644,12 @@ static void tvnet_ep_rcv_link_down_msg(struct pci_epf_tvnet *tvnet)
 
 static void tvnet_ep_rcv_link_down_ack(struct pci_epf_tvnet *tvnet)
 {
+	u32 i;
+
 	/* Stop using empty buffers(which are full in rx) of local system */
 	tvnet_ep_stop_rx_work(tvnet);
-	tvnet_ep_free_empty_buffers(tvnet);
+	for (i = 0; i < tvnet->num_queues; i++)
+		tvnet_ep_free_empty_buffers(tvnet, &tvnet->queues[i]);
 	tvnet->rx_link_state = DIR_LINK_STATE_DOWN;
 	wake_up_interruptible(&tvnet->link_state_wq);
 	tvnet_ep_update_link_sm(tvnet);
@@ -539,6 +659,7 @@ static int tvnet_ep_open(struct net_device *ndev)
 {
 	struct device *fdev = ndev->dev.parent;
 	struct pci_epf_tvnet *tvnet = dev_get_drvdata(fdev);
+	u32 i;
 
 	if (!tvnet->pcie_link_status) {
 		dev_err(fdev, "%s: PCIe link is not up\n", __func__);
@@ -548,7 +669,8 @@ static int tvnet_ep_open(struct net_device *ndev)
 	mutex_lock(&tvnet->link_state_lock);
 	if (tvnet->rx_link_state == DIR_LINK_STATE_DOWN)
 		tvnet_ep_user_link_up_req(tvnet);
-	napi_enable(&tvnet->napi);
+	for (i = 0; i < tvnet->num_queues; i++)
+		napi_enable(&tvnet->queues[i].napi);
 	mutex_unlock(&tvnet->link_state_lock);
 
 	return 0;
@@ -559,9 +681,11 @@ static int tvnet_ep_close(struct net_device *ndev)
 	struct device *fdev = ndev->dev.parent;
 	struct pci_epf_tvnet *tvnet = dev_get_drvdata(fdev);
 	int ret = 0;
+	u32 i;
 
 	mutex_lock(&tvnet->link_state_lock);
-	napi_disable(&tvnet->napi);
+	for (i = 0; i < tvnet->num_queues; i++)
+		napi_disable(&tvnet->queues[i].napi);
 	if (tvnet->rx_link_state == DIR_LINK_STATE_UP)
 		tvnet_ep_user_link_down_req(tvnet);
 
@@ -598,6 +722,7 @@ static int tvnet_ep_change_mtu(struct net_device *ndev, int new_mtu)
 	pr_info("changing MTU from %d to %d\n", ndev->mtu, new_mtu);
 
 	ndev->mtu = new_mtu;
+	netif_set_gso_max_size(ndev, new_mtu + ETH_HLEN);
 
 	if (set_down)
 		tvnet_ep_open(ndev);
@@ -605,77 +730,293 @@ static int tvnet_ep_change_mtu(struct net_device *ndev, int new_mtu)
 	return 0;
 }
 
+#if ENABLE_DMA
+static void tvnet_ep_unmap_tx_buf(struct device *cdev,
+				  struct tvnet_ep_tx_buf *buf)
+{
+	if (buf->page)
+		dma_unmap_page(cdev, buf->iova, buf->len, DMA_TO_DEVICE);
+	else
+		dma_unmap_single(cdev, buf->iova, buf->len, DMA_TO_DEVICE);
+}
+
+/*
+ * Complete the packets whose elements the channel has moved past: the data
+ * is in host memory, so push the dst buffers to host and free the skbs.
+ * Called with dma->lock held.
+ */
+static void tvnet_ep_dma_reap(struct tvnet_ep_dma *dma)
+{
+	struct pci_epf_tvnet *tvnet = dma->tvnet;
+	struct device *cdev = tvnet->epf->epc->dev.parent;
+	struct dma_desc_cnt *desc_cnt = &dma->desc_cnt;
+	struct tvnet_dma_desc *ep_dma_virt = dma->virt;
+	struct tvnet_ep_tx_buf *buf;
+	struct data_msg *ep2h_full_msg;
+	unsigned long done_mask = 0;
+	u32 done, idx, wr_idx, qid;
+	struct tvnet_ep_queue *q;
+	u64 llp;
+
+	if (desc_cnt->wr_cnt == desc_cnt->rd_cnt)
+		return;
+
+	llp = dma_channel_rd(tvnet->dma_base, dma->chan, DMA_LLP_LOW_OFF_WRCH);
+	llp |= (u64)dma_channel_rd(tvnet->dma_base, dma->chan,
+				   DMA_LLP_HIGH_OFF_WRCH) << 32;
+	done = tvnet_dma_desc_done(llp, dma->iova, desc_cnt->rd_cnt);
+	done = min(done, desc_cnt->wr_cnt - desc_cnt->rd_cnt);
+
+	while (done--) {
+		idx = desc_cnt->rd_cnt % DMA_DESC_COUNT;
+		buf = &dma->tx_buf[idx];
+		/* Clear DMA cycle bit for the next pass over the ring */
+		ep_dma_virt[idx].ctrl_reg.ctrl_e.cb = 0;
+		tvnet_ep_unmap_tx_buf(cdev, buf);
+		if (buf->skb) {
+			/* Push dst to EP2H full ring */
+			q = buf->q;
+			ep2h_full_msg = q->ep_ring_buf.ep2h_full_msgs;
+			wr_idx = tvnet_ivc_get_wr_cnt(&q->ep2h_full) %
+				RING_COUNT;
+			ep2h_full_msg[wr_idx].u.full_buffer.packet_size =
+				buf->skb->len;
+			ep2h_full_msg[wr_idx].u.full_buffer.pcie_address =
+				buf->dst_iova;
+			tvnet_offload_from_skb(buf->skb,
+				&ep2h_full_msg[wr_idx].u.full_buffer.offload);
+			tvnet_ivc_advance_wr(&q->ep2h_full);
+			tvnet_ep_notify_host_coalesced(q);
+			done_mask |= BIT(q->qid);
+			dev_consume_skb_any(buf->skb);
+			buf->skb = NULL;
+		}
+		desc_cnt->rd_cnt++;
+	}
+	mb();
+
+	if (tvnet->os_link_state != OS_LINK_STATE_UP)
+		return;
+
+	for_each_set_bit(qid, &done_mask, TVNET_MAX_QUEUES)
+		netif_tx_wake_queue(netdev_get_tx_queue(tvnet->ndev, qid));
+}
+
+static enum hrtimer_restart tvnet_ep_dma_reap_timer(struct hrtimer *timer)
+{
+	struct tvnet_ep_dma *dma = container_of(timer, struct tvnet_ep_dma,
+						reap_timer);
+	enum hrtimer_restart restart = HRTIMER_NORESTART;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dma->lock, flags);
+	tvnet_ep_dma_reap(dma);
+	/* xmit may have armed the timer again meanwhile */
+	if (dma->desc_cnt.wr_cnt != dma->desc_cnt.rd_cnt &&
+	    !hrtimer_is_queued(timer)) {
+		hrtimer_forward_now(timer, us_to_ktime(max(tx_reap_us, 1U)));
+		restart = HRTIMER_RESTART;
+	}
+	spin_unlock_irqrestore(&dma->lock, flags);
+
+	return restart;
+}
+
+/* Drop whatever is left in flight, the channel must be idle or reset */
+static void tvnet_ep_dma_reset(struct tvnet_ep_dma *dma)
+{
+	struct device *cdev = dma->tvnet->epf->epc->dev.parent;
+	struct dma_desc_cnt *desc_cnt = &dma->desc_cnt;
+	struct tvnet_dma_desc *ep_dma_virt = dma->virt;
+	struct tvnet_ep_tx_buf *buf;
+	unsigned long flags;
+	u32 idx;
+
+	hrtimer_cancel(&dma->reap_timer);
+
+	spin_lock_irqsave(&dma->lock, flags);
+	for (; desc_cnt->rd_cnt != desc_cnt->wr_cnt; desc_cnt->rd_cnt++) {
+		idx = desc_cnt->rd_cnt % DMA_DESC_COUNT;
+		buf = &dma->tx_buf[idx];
+		ep_dma_virt[idx].ctrl_reg.ctrl_e.cb = 0;
+		tvnet_ep_unmap_tx_buf(cdev, buf);
+		if (buf->skb) {
+			dev_kfree_skb_any(buf->skb);
+			buf->skb = NULL;
+		}
+	}
+	desc_cnt->wr_cnt = desc_cnt->rd_cnt = 0;
+	spin_unlock_irqrestore(&dma->lock, flags);
+}
+
+/*
+ * Add linked list elements writing the skb head and frags into consecutive
+ * dst_iova space, called with dma->lock held. The channel is not started.
+ */
+static int tvnet_ep_dma_map_skb(struct tvnet_ep_dma *dma,
+				struct tvnet_ep_queue *q,
+				struct sk_buff *skb, u64 dst_iova)
+{
+	struct device *cdev = dma->tvnet->epf->epc->dev.parent;
+	struct skb_shared_info *info = skb_shinfo(skb);
+	struct dma_desc_cnt *desc_cnt = &dma->desc_cnt;
+	struct tvnet_dma_desc *ep_dma_virt = dma->virt;
+	struct tvnet_ep_tx_buf *buf;
+	u32 i, j, idx, len, ctrl_d;
+	u64 dst = dst_iova;
+	dma_addr_t iova;
+
+	for (i = 0; i <= info->nr_frags; i++) {
+		idx = (desc_cnt->wr_cnt + i) % DMA_DESC_COUNT;
+		buf = &dma->tx_buf[idx];
+		if (i == 0) {
+			len = skb_headlen(skb);
+			iova = dma_map_single(cdev, skb->data, len,
+					      DMA_TO_DEVICE);
+		} else {
+			len = skb_frag_size(&info->frags[i - 1]);
+			iova = skb_frag_dma_map(cdev, &info->frags[i - 1], 0,
+						len, DMA_TO_DEVICE);
+		}
+		if (dma_mapping_error(cdev, iova)) {
+			dev_err(dma->tvnet->fdev, "%s: dma map failed\n",
+				__func__);
+			goto unmap;
+		}
+		buf->iova = iova;
+		buf->len = len;
+		buf->page = (i != 0);
+		buf->skb = NULL;
+
+		ep_dma_virt[idx].size = len;
+		ep_dma_virt[idx].sar_low = lower_32_bits(iova);
+		ep_dma_virt[idx].sar_high = upper_32_bits(iova);
+		ep_dma_virt[idx].dar_low = lower_32_bits(dst);
+		ep_dma_virt[idx].dar_high = upper_32_bits(dst);
+		dst += len;
+	}
+	buf->skb = skb;
+	buf->q = q;
+	buf->dst_iova = dst_iova;
+
+	/* CB bit should be set at the end */
+	mb();
+	/*
+	 * Set CB back to front, so that a running channel never sees the first
+	 * element of the packet before the others are ready.
+	 */
+	for (j = info->nr_frags + 1; j-- > 0;) {
+		idx = (desc_cnt->wr_cnt + j) % DMA_DESC_COUNT;
+		ctrl_d = DMA_CH_CONTROL1_OFF_WRCH_CB;
+		if (j == info->nr_frags)
+			ctrl_d |= DMA_CH_CONTROL1_OFF_WRCH_LIE;
+		ep_dma_virt[idx].ctrl_reg.ctrl_d = ctrl_d;
+	}
+
+	desc_cnt->wr_cnt += info->nr_frags + 1;
+
+	return 0;
+
+unmap:
+	for (j = 0; j < i; j++)
+		tvnet_ep_unmap_tx_buf(cdev, &dma->tx_buf[(desc_cnt->wr_cnt + j) %
+							 DMA_DESC_COUNT]);
+
+	return -ENOMEM;
+}
+#endif
+
 static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
-				    struct net_device *ndev)
+				       struct net_device *ndev)
 {
 	struct device *fdev = ndev->dev.parent;
 	struct pci_epf_tvnet *tvnet = dev_get_drvdata(fdev);
-	struct host_ring_buf *host_ring_buf = &tvnet->host_ring_buf;
-	struct ep_ring_buf *ep_ring_buf = &tvnet->ep_ring_buf;
-	struct data_msg *ep2h_full_msg = ep_ring_buf->ep2h_full_msgs;
-	struct skb_shared_info *info = skb_shinfo(skb);
+	u16 qid = skb_get_queue_mapping(skb);
+	struct tvnet_ep_queue *q = &tvnet->queues[qid];
+	struct netdev_queue *txq = netdev_get_tx_queue(ndev, qid);
+	struct host_ring_buf *host_ring_buf = &q->host_ring_buf;
 	struct data_msg *ep2h_empty_msg = host_ring_buf->ep2h_empty_msgs;
+#if ENABLE_DMA
+	struct tvnet_ep_dma *dma = q->dma;
+	struct dma_desc_cnt *desc_cnt = &dma->desc_cnt;
+	unsigned long flags;
+	u32 nr_desc;
+#else
+	struct ep_ring_buf *ep_ring_buf = &q->ep_ring_buf;
+	struct data_msg *ep2h_full_msg = ep_ring_buf->ep2h_full_msgs;
 	struct pci_epf *epf = tvnet->epf;
 	struct pci_epc *epc = epf->epc;
 	struct device *cdev = epc->dev.parent;
-#if ENABLE_DMA
-	struct dma_desc_cnt *desc_cnt = &tvnet->desc_cnt;
-	struct tvnet_dma_desc *ep_dma_virt =
-				(struct tvnet_dma_desc *)tvnet->ep_dma_virt;
-	u32 desc_widx, desc_ridx, val, ctrl_d;
-	unsigned long timeout;
-#else
-	int ret;
-#endif
 	dma_addr_t src_iova;
-	u32 rd_idx, wr_idx;
-	u64 dst_masked, dst_off, dst_iova;
+	u64 dst_masked, dst_off;
+	u32 wr_idx;
 	int dst_len, len;
+	int ret;
+#endif
+	u64 dst_iova;
+	u32 rd_idx;
 
+#if !ENABLE_DMA
 	/*TODO Not expecting skb frags, remove this after testing */
-	WARN_ON(info->nr_frags);
+	WARN_ON(skb_shinfo(skb)->nr_frags);
+#endif
 
 	/* Check if EP2H_EMPTY_BUF available to read */
-	if (!tvnet_ivc_rd_available(&tvnet->ep2h_empty)) {
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
-#if defined(PCI_EPC_IRQ_TYPE_ENUM_PRESENT) /* Dropped from Linux 6.8 */
-		lpci_epc_raise_irq(epc, epf->func_no, PCI_EPC_IRQ_MSIX, 0);
-#else
-		lpci_epc_raise_irq(epc, epf->func_no, PCI_IRQ_MSIX, 0);
-#endif
-#else
-		pci_epc_raise_irq(epc, PCI_EPC_IRQ_MSIX, 0);
-#endif
+	if (!tvnet_ivc_rd_available(&q->ep2h_empty)) {
+		tvnet_ep_raise_irq(tvnet, 0);
 		dev_dbg(fdev, "%s: No EP2H empty msg, stop tx\n", __func__);
-		netif_stop_queue(ndev);
+		netif_tx_stop_queue(txq);
 		return NETDEV_TX_BUSY;
 	}
 
 	/* Check if EP2H_FULL_BUF available to write */
-	if (tvnet_ivc_full(&tvnet->ep2h_full)) {
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
-#if defined(PCI_EPC_IRQ_TYPE_ENUM_PRESENT) /* Dropped from Linux 6.8 */
-		lpci_epc_raise_irq(epc, epf->func_no, PCI_EPC_IRQ_MSIX, 1);
-#else
-		lpci_epc_raise_irq(epc, epf->func_no, PCI_IRQ_MSIX, 1);
-#endif
-#else
-		pci_epc_raise_irq(epc, PCI_EPC_IRQ_MSIX, 1);
-#endif
+	if (tvnet_ivc_full(&q->ep2h_full)) {
+		tvnet_ep_raise_irq(tvnet, qid + 1);
 		dev_dbg(fdev, "%s: No EP2H full buf, stop tx\n", __func__);
-		netif_stop_queue(ndev);
+		netif_tx_stop_queue(txq);
 		return NETDEV_TX_BUSY;
 	}
 
 #if ENABLE_DMA
-	/* Check if dma desc available */
-	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt) >= DMA_DESC_COUNT) {
+	/* Queues sharing the DMA channel are serialized on its ring */
+	spin_lock_irqsave(&dma->lock, flags);
+	tvnet_ep_dma_reap(dma);
+
+	/* Check if dma descs available, one is left unused to tell full */
+	nr_desc = skb_shinfo(skb)->nr_frags + 1;
+	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt + nr_desc) >=
+	    DMA_DESC_COUNT) {
+		spin_unlock_irqrestore(&dma->lock, flags);
 		dev_dbg(fdev, "%s: dma descs are not available\n", __func__);
-		netif_stop_queue(ndev);
+		netif_tx_stop_queue(txq);
 		return NETDEV_TX_BUSY;
 	}
-#endif
 
+	/* Get EP2H empty msg */
+	rd_idx = tvnet_ivc_get_rd_cnt(&q->ep2h_empty) % RING_COUNT;
+	dst_iova = ep2h_empty_msg[rd_idx].u.empty_buffer.pcie_address;
+
+	if (tvnet_ep_dma_map_skb(dma, q, skb, dst_iova) < 0) {
+		spin_unlock_irqrestore(&dma->lock, flags);
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+
+	/*
+	 * Advance read count after all failure cases completed, to avoid
+	 * dangling buffer at host.
+	 */
+	tvnet_ivc_advance_rd(&q->ep2h_empty);
+
+	/* DMA write should not go out of order wrt CB bit set */
+	mb();
+	dma_common_wr8(tvnet->dma_base, dma->chan, DMA_WRITE_DOORBELL_OFF);
+	/* skb is freed and pushed to EP2H full ring once DMA is done */
+	if (!hrtimer_is_queued(&dma->reap_timer))
+		hrtimer_start(&dma->reap_timer, us_to_ktime(max(tx_reap_us, 1U)),
+			      HRTIMER_MODE_REL);
+	spin_unlock_irqrestore(&dma->lock, flags);
+#else
 	len = skb_headlen(skb);
 
 	src_iova = dma_map_single(cdev, skb->data, len, DMA_TO_DEVICE);
@@ -686,7 +1027,7 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 	}
 
 	/* Get EP2H empty msg */
-	rd_idx = tvnet_ivc_get_rd_cnt(&tvnet->ep2h_empty) % RING_COUNT;
+	rd_idx = tvnet_ivc_get_rd_cnt(&q->ep2h_empty) % RING_COUNT;
 	dst_iova = ep2h_empty_msg[rd_idx].u.empty_buffer.pcie_address;
 	dst_len = ep2h_empty_msg[rd_idx].u.empty_buffer.buffer_len;
 
@@ -697,7 +1038,6 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 	dst_masked = (dst_iova & ~(SZ_64K - 1));
 	dst_off = (dst_iova & (SZ_64K - 1));
 
-#if !ENABLE_DMA
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
 	ret = lpci_epc_map_addr(epc, epf->func_no, tvnet->tx_dst_pci_addr,
 			       dst_masked, dst_len);
@@ -711,68 +1051,12 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 		dev_kfree_skb_any(skb);
 		return NETDEV_TX_OK;
 	}
-#endif
 	/*
 	 * Advance read count after all failure cases completed, to avoid
 	 * dangling buffer at host.
 	 */
-	tvnet_ivc_advance_rd(&tvnet->ep2h_empty);
-
-#if ENABLE_DMA
-	/* Trigger DMA write from src_iova to dst_iova */
-	desc_widx = desc_cnt->wr_cnt % DMA_DESC_COUNT;
-	ep_dma_virt[desc_widx].size = len;
-	ep_dma_virt[desc_widx].sar_low = lower_32_bits(src_iova);
-	ep_dma_virt[desc_widx].sar_high = upper_32_bits(src_iova);
-	ep_dma_virt[desc_widx].dar_low = lower_32_bits(dst_iova);
-	ep_dma_virt[desc_widx].dar_high = upper_32_bits(dst_iova);
-	/* CB bit should be set at the end */
-	mb();
-	ctrl_d = DMA_CH_CONTROL1_OFF_WRCH_LIE;
-	ctrl_d |= DMA_CH_CONTROL1_OFF_WRCH_CB;
-	ep_dma_virt[desc_widx].ctrl_reg.ctrl_d = ctrl_d;
-
-	/* DMA write should not go out of order wrt CB bit set */
-	mb();
+	tvnet_ivc_advance_rd(&q->ep2h_empty);
 
-	timeout = jiffies + msecs_to_jiffies(1000);
-	dma_common_wr8(tvnet->dma_base, DMA_WR_DATA_CH, DMA_WRITE_DOORBELL_OFF);
-	desc_cnt->wr_cnt++;
-
-	while (true) {
-		val = dma_common_rd(tvnet->dma_base, DMA_WRITE_INT_STATUS_OFF);
-		if (val == BIT(DMA_WR_DATA_CH)) {
-			dma_common_wr(tvnet->dma_base, val,
-				      DMA_WRITE_INT_CLEAR_OFF);
-			break;
-		}
-		if (time_after(jiffies, timeout)) {
-			dev_err(fdev, "dma took more time, reset dma engine\n");
-			dma_common_wr(tvnet->dma_base,
-				      DMA_WRITE_ENGINE_EN_OFF_DISABLE,
-				      DMA_WRITE_ENGINE_EN_OFF);
-			mdelay(1);
-			dma_common_wr(tvnet->dma_base,
-				      DMA_WRITE_ENGINE_EN_OFF_ENABLE,
-				      DMA_WRITE_ENGINE_EN_OFF);
-			desc_cnt->wr_cnt--;
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
-			lpci_epc_unmap_addr(epc, epf->func_no, tvnet->tx_dst_pci_addr);
-#else
-			pci_epc_unmap_addr(epc, tvnet->tx_dst_pci_addr);
-#endif
-			dma_unmap_single(cdev, src_iova, len, DMA_TO_DEVICE);
-			return NETDEV_TX_BUSY;
-		}
-	}
-
-	desc_ridx = tvnet->desc_cnt.rd_cnt % DMA_DESC_COUNT;
-	/* Clear DMA cycle bit and increment rd_cnt */
-	ep_dma_virt[desc_ridx].ctrl_reg.ctrl_e.cb = 0;
-	mb();
-
-	tvnet->desc_cnt.rd_cnt++;
-#else
 	/* Copy skb->data to host dst address, use CPU virt addr */
 	memcpy((void *)(tvnet->tx_dst_va + dst_off), skb->data, len);
 	/*
@@ -780,34 +1064,64 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 	 * written to dst before adding it to full buffer
 	 */
 	mb();
-#endif
 
 	/* Push dst to EP2H full ring */
-	wr_idx = tvnet_ivc_get_wr_cnt(&tvnet->ep2h_full) % RING_COUNT;
+	wr_idx = tvnet_ivc_get_wr_cnt(&q->ep2h_full) % RING_COUNT;
 	ep2h_full_msg[wr_idx].u.full_buffer.packet_size = len;
 	ep2h_full_msg[wr_idx].u.full_buffer.pcie_address = dst_iova;
-	tvnet_ivc_advance_wr(&tvnet->ep2h_full);
+	tvnet_offload_from_skb(skb, &ep2h_full_msg[wr_idx].u.full_buffer.offload);
+	tvnet_ivc_advance_wr(&q->ep2h_full);
 
 	/* Free temp src and skb */
-#if !ENABLE_DMA
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
 	lpci_epc_unmap_addr(epc, epf->func_no, tvnet->tx_dst_pci_addr);
 #else
 	pci_epc_unmap_addr(epc, tvnet->tx_dst_pci_addr);
-#endif
 #endif
 	dma_unmap_single(cdev, src_iova, len, DMA_TO_DEVICE);
 	dev_kfree_skb_any(skb);
-	schedule_work(&tvnet->raise_irq_work);
+	tvnet_ep_notify_host_coalesced(q);
+#endif
 
 	return NETDEV_TX_OK;
 }
 
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
+static u16 tvnet_ep_select_queue(struct net_device *ndev, struct sk_buff *skb,
+				 struct net_device *sb_dev)
+{
+	struct pci_epf_tvnet *tvnet = dev_get_drvdata(ndev->dev.parent);
+	u32 active_queues = READ_ONCE(tvnet->active_queues);
+	u16 qid = netdev_pick_tx(ndev, skb, sb_dev);
+
+	/* Host may service fewer queues than offered, rehash over those */
+	if (qid >= active_queues)
+		qid = reciprocal_scale(skb_get_hash(skb), active_queues);
+
+	return qid;
+}
+#endif
+
+static netdev_features_t tvnet_ep_features_check(struct sk_buff *skb,
+						 struct net_device *ndev,
+						 netdev_features_t features)
+{
+	struct pci_epf_tvnet *tvnet = dev_get_drvdata(ndev->dev.parent);
+
+	return tvnet_features_check(skb, features,
+				    READ_ONCE(tvnet->peer_features),
+				    READ_ONCE(tvnet->peer_max_frame));
+}
+
 static const struct net_device_ops tvnet_netdev_ops = {
 	.ndo_open = tvnet_ep_open,
 	.ndo_stop = tvnet_ep_close,
 	.ndo_start_xmit = tvnet_ep_start_xmit,
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
+	.ndo_select_queue = tvnet_ep_select_queue,
+#endif
 	.ndo_change_mtu = tvnet_ep_change_mtu,
+	.ndo_features_check = tvnet_ep_features_check,
 };
 
 static void tvnet_ep_process_ctrl_msg(struct pci_epf_tvnet *tvnet)
@@ -817,7 +1131,7 @@ static void tvnet_ep_process_ctrl_msg(struct pci_epf_tvnet *tvnet)
 	while (tvnet_ivc_rd_available(&tvnet->h2ep_ctrl)) {
 		tvnet_ep_read_ctrl_msg(tvnet, &msg);
 		if (msg.msg_id == CTRL_MSG_LINK_UP)
-			tvnet_ep_rcv_link_up_msg(tvnet);
+			tvnet_ep_rcv_link_up_msg(tvnet, &msg);
 		else if (msg.msg_id == CTRL_MSG_LINK_DOWN)
 			tvnet_ep_rcv_link_down_msg(tvnet);
 		else if (msg.msg_id == CTRL_MSG_LINK_DOWN_ACK)
@@ -825,9 +1139,29 @@ static void tvnet_ep_process_ctrl_msg(struct pci_epf_tvnet *tvnet)
 	}
 }
 
-static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet)
+static void tvnet_ep_rx_skb(struct tvnet_ep_queue *q, struct sk_buff *skb,
+			    struct tvnet_offload *offload)
 {
-	struct host_ring_buf *host_ring_buf = &tvnet->host_ring_buf;
+	struct net_device *ndev = q->tvnet->ndev;
+
+	/* Peers without offload support leave offload unwritten */
+	if (q->tvnet->peer_features && tvnet_offload_to_skb(skb, offload) < 0) {
+		dev_dbg(q->tvnet->fdev, "%s: invalid offload from host\n",
+			__func__);
+		ndev->stats.rx_errors++;
+		dev_kfree_skb_any(skb);
+		return;
+	}
+
+	skb->protocol = eth_type_trans(skb, ndev);
+	skb_record_rx_queue(skb, q->qid);
+	napi_gro_receive(&q->napi, skb);
+}
+
+static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet,
+				     struct tvnet_ep_queue *q)
+{
+	struct host_ring_buf *host_ring_buf = &q->host_ring_buf;
 	struct data_msg *data_msg = host_ring_buf->h2ep_full_msgs;
 	struct pci_epf *epf = tvnet->epf;
 	struct pci_epc *epc = epf->epc;
@@ -840,7 +1174,8 @@ static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet)
 	int count = 0;
 
 	while ((count < TVNET_NAPI_WEIGHT) &&
-	       tvnet_ivc_rd_available(&tvnet->h2ep_full)) {
+	       tvnet_ivc_rd_available(&q->h2ep_full)) {
+		struct tvnet_offload offload;
 		struct sk_buff *skb;
 		int idx, found = 0;
 		u32 len;
@@ -848,13 +1183,14 @@ static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet)
 		unsigned long flags;
 
 		/* Read H2EP full msg */
-		idx = tvnet_ivc_get_rd_cnt(&tvnet->h2ep_full) % RING_COUNT;
+		idx = tvnet_ivc_get_rd_cnt(&q->h2ep_full) % RING_COUNT;
 		len = data_msg[idx].u.full_buffer.packet_size;
 		pcie_address = data_msg[idx].u.full_buffer.pcie_address;
+		offload = data_msg[idx].u.full_buffer.offload;
 
 		/* Get H2EP msg pointer from saved list */
-		spin_lock_irqsave(&tvnet->h2ep_empty_lock, flags);
-		list_for_each_entry(h2ep_empty_ptr, &tvnet->h2ep_empty_list,
+		spin_lock_irqsave(&q->h2ep_empty_lock, flags);
+		list_for_each_entry(h2ep_empty_ptr, &q->h2ep_empty_list,
 				    list) {
 			if (h2ep_empty_ptr->iova == pcie_address) {
 				list_del(&h2ep_empty_ptr->list);
@@ -862,10 +1198,10 @@ static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet)
 				break;
 			}
 		}
-		spin_unlock_irqrestore(&tvnet->h2ep_empty_lock, flags);
+		spin_unlock_irqrestore(&q->h2ep_empty_lock, flags);
 
 		/* Advance H2EP full buffer after search in local list */
-		tvnet_ivc_advance_rd(&tvnet->h2ep_full);
+		tvnet_ivc_advance_rd(&q->h2ep_full);
 		if (WARN_ON(!found))
 			continue;
 #if ENABLE_DMA
@@ -873,15 +1209,13 @@ static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet)
 				 DMA_FROM_DEVICE);
 		skb = h2ep_empty_ptr->skb;
 		skb_put(skb, len);
-		skb->protocol = eth_type_trans(skb, ndev);
-		napi_gro_receive(&tvnet->napi, skb);
+		tvnet_ep_rx_skb(q, skb, &offload);
 #else
 		/* Alloc new skb and copy data from full buffer */
 		skb = netdev_alloc_skb(ndev, len);
 		memcpy(skb->data, h2ep_empty_ptr->virt, len);
 		skb_put(skb, len);
-		skb->protocol = eth_type_trans(skb, ndev);
-		napi_gro_receive(&tvnet->napi, skb);
+		tvnet_ep_rx_skb(q, skb, &offload);
 
 		/* Free H2EP dst msg */
 		vunmap(h2ep_empty_ptr->virt);
@@ -901,64 +1235,72 @@ static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet)
 static void tvnet_ep_setup_dma(struct pci_epf_tvnet *tvnet)
 {
 	dma_addr_t iova = tvnet->bar0_amap[HOST_DMA].iova;
-	struct dma_desc_cnt *desc_cnt = &tvnet->desc_cnt;
-	u32 val;
-
-	desc_cnt->rd_cnt = desc_cnt->wr_cnt = 0;
-
-	/* Enable linked list mode and set CCS for write channel-0 */
-	val = dma_channel_rd(tvnet->dma_base, DMA_WR_DATA_CH,
-			     DMA_CH_CONTROL1_OFF_WRCH);
-	val |= DMA_CH_CONTROL1_OFF_WRCH_LLE;
-	val |= DMA_CH_CONTROL1_OFF_WRCH_CCS;
-	dma_channel_wr(tvnet->dma_base, DMA_WR_DATA_CH, val,
-		       DMA_CH_CONTROL1_OFF_WRCH);
-
-	/* Unmask write channel-0 done irq to enable LIE */
-	val = dma_common_rd(tvnet->dma_base, DMA_WRITE_INT_MASK_OFF);
-	val &= ~0x1;
-	dma_common_wr(tvnet->dma_base, val, DMA_WRITE_INT_MASK_OFF);
-
-	/* Enable write channel-0 local abort irq */
-	val = dma_common_rd(tvnet->dma_base, DMA_WRITE_LINKED_LIST_ERR_EN_OFF);
-	val |= (0x1 << 16);
-	dma_common_wr(tvnet->dma_base, val, DMA_WRITE_LINKED_LIST_ERR_EN_OFF);
-
-	/* Program DMA write linked list base address to DMA LLP register */
-	dma_channel_wr(tvnet->dma_base, DMA_WR_DATA_CH,
-		       lower_32_bits(tvnet->ep_dma_iova),
-		       DMA_LLP_LOW_OFF_WRCH);
-	dma_channel_wr(tvnet->dma_base, DMA_WR_DATA_CH,
-		       upper_32_bits(tvnet->ep_dma_iova),
-		       DMA_LLP_HIGH_OFF_WRCH);
+	struct tvnet_ep_dma *dma;
+	u32 val, i;
+
+	for (i = 0; i < tvnet->num_dma; i++) {
+		dma = &tvnet->dma[i];
+		tvnet_ep_dma_reset(dma);
+
+		/* Enable linked list mode and set CCS for write channel */
+		val = dma_channel_rd(tvnet->dma_base, dma->chan,
+				     DMA_CH_CONTROL1_OFF_WRCH);
+		val |= DMA_CH_CONTROL1_OFF_WRCH_LLE;
+		val |= DMA_CH_CONTROL1_OFF_WRCH_CCS;
+		dma_channel_wr(tvnet->dma_base, dma->chan, val,
+			       DMA_CH_CONTROL1_OFF_WRCH);
+
+		/* Unmask write channel done irq to enable LIE */
+		val = dma_common_rd(tvnet->dma_base, DMA_WRITE_INT_MASK_OFF);
+		val &= ~BIT(dma->chan);
+		dma_common_wr(tvnet->dma_base, val, DMA_WRITE_INT_MASK_OFF);
+
+		/* Enable write channel local abort irq */
+		val = dma_common_rd(tvnet->dma_base,
+				    DMA_WRITE_LINKED_LIST_ERR_EN_OFF);
+		val |= BIT(16 + dma->chan);
+		dma_common_wr(tvnet->dma_base, val,
+			      DMA_WRITE_LINKED_LIST_ERR_EN_OFF);
+
+		/* Program DMA write linked list base address to DMA LLP register */
+		dma_channel_wr(tvnet->dma_base, dma->chan,
+			       lower_32_bits(dma->iova), DMA_LLP_LOW_OFF_WRCH);
+		dma_channel_wr(tvnet->dma_base, dma->chan,
+			       upper_32_bits(dma->iova), DMA_LLP_HIGH_OFF_WRCH);
+	}
 
 	/* Enable DMA write engine */
 	dma_common_wr(tvnet->dma_base, DMA_WRITE_ENGINE_EN_OFF_ENABLE,
 		      DMA_WRITE_ENGINE_EN_OFF);
 
-	/* Enable linked list mode and set CCS for read channel-0 */
-	val = dma_channel_rd(tvnet->dma_base, DMA_RD_DATA_CH,
-			     DMA_CH_CONTROL1_OFF_RDCH);
-	val |= DMA_CH_CONTROL1_OFF_RDCH_LLE;
-	val |= DMA_CH_CONTROL1_OFF_RDCH_CCS;
-	dma_channel_wr(tvnet->dma_base, DMA_RD_DATA_CH, val,
-		       DMA_CH_CONTROL1_OFF_RDCH);
-
-	/* Mask read channel-0 done irq to enable RIE */
-	val = dma_common_rd(tvnet->dma_base, DMA_READ_INT_MASK_OFF);
-	val |= 0x1;
-	dma_common_wr(tvnet->dma_base, val, DMA_READ_INT_MASK_OFF);
-
-	val = dma_common_rd(tvnet->dma_base, DMA_READ_LINKED_LIST_ERR_EN_OFF);
-	/* Enable read channel-0 remote abort irq */
-	val |= 0x1;
-	dma_common_wr(tvnet->dma_base, val, DMA_READ_LINKED_LIST_ERR_EN_OFF);
-
-	/* Program DMA read linked list base address to DMA LLP register */
-	dma_channel_wr(tvnet->dma_base, DMA_RD_DATA_CH,
-		       lower_32_bits(iova), DMA_LLP_LOW_OFF_RDCH);
-	dma_channel_wr(tvnet->dma_base, DMA_RD_DATA_CH,
-		       upper_32_bits(iova), DMA_LLP_HIGH_OFF_RDCH);
+	for (i = 0; i < tvnet->num_host_dma; i++) {
+		/* Enable linked list mode and set CCS for read channel */
+		val = dma_channel_rd(tvnet->dma_base, i,
+				     DMA_CH_CONTROL1_OFF_RDCH);
+		val |= DMA_CH_CONTROL1_OFF_RDCH_LLE;
+		val |= DMA_CH_CONTROL1_OFF_RDCH_CCS;
+		dma_channel_wr(tvnet->dma_base, i, val,
+			       DMA_CH_CONTROL1_OFF_RDCH);
+
+		/* Mask read channel done irq to enable RIE */
+		val = dma_common_rd(tvnet->dma_base, DMA_READ_INT_MASK_OFF);
+		val |= BIT(i);
+		dma_common_wr(tvnet->dma_base, val, DMA_READ_INT_MASK_OFF);
+
+		val = dma_common_rd(tvnet->dma_base,
+				    DMA_READ_LINKED_LIST_ERR_EN_OFF);
+		/* Enable read channel remote abort irq */
+		val |= BIT(i);
+		dma_common_wr(tvnet->dma_base, val,
+			      DMA_READ_LINKED_LIST_ERR_EN_OFF);
+
+		/* Program DMA read linked list base address to DMA LLP register */
+		dma_channel_wr(tvnet->dma_base, i,
+			       lower_32_bits(iova), DMA_LLP_LOW_OFF_RDCH);
+		dma_channel_wr(tvnet->dma_base, i,
+			       upper_32_bits(iova), DMA_LLP_HIGH_OFF_RDCH);
+		iova += DMA_DESC_RING_SIZE;
+	}
 
 	/* Enable DMA read engine */
 	dma_common_wr(tvnet->dma_base, DMA_READ_ENGINE_EN_OFF_ENABLE,
@@ -966,6 +1308,22 @@ static void tvnet_ep_setup_dma(struct pci_epf_tvnet *tvnet)
 }
 #endif
 
+/*
+ * If host goes through a suspend resume, it recycles EP2H empty buffer.
+ * Clear any pending EP2H full buffer by setting "wr_cnt = rd_cnt".
+ */
+static void tvnet_ep_clear_ep2h_full(struct pci_epf_tvnet *tvnet)
+{
+	struct tvnet_ep_queue *q;
+	u32 i;
+
+	for (i = 0; i < tvnet->num_queues; i++) {
+		q = &tvnet->queues[i];
+		tvnet_ivc_set_wr(&q->ep2h_full,
+				 tvnet_ivc_get_rd_cnt(&q->ep2h_full));
+	}
+}
+
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
 /* Returns aperture offset of syncpoint on SHIM_BASE. */
 static inline u64 get_syncpt_shim_offset(u32 id)
@@ -1065,21 +1423,29 @@ static void tvnet_ep_ctrl_irqsp_callback(void *private_data)
 	struct irqsp_data *data_irqsp = private_data;
 	struct pci_epf_tvnet *tvnet = dev_get_drvdata(data_irqsp->dev);
 	struct net_device *ndev = tvnet->ndev;
+	struct tvnet_ep_queue *q;
+	struct netdev_queue *txq;
+	u32 i;
 
-	if (netif_queue_stopped(ndev)) {
-		if ((tvnet->os_link_state == OS_LINK_STATE_UP) &&
-		    tvnet_ivc_rd_available(&tvnet->ep2h_empty) &&
-		    !tvnet_ivc_full(&tvnet->ep2h_full)) {
-			netif_wake_queue(ndev);
-		}
+	for (i = 0; i < tvnet->num_queues; i++) {
+		q = &tvnet->queues[i];
+		txq = netdev_get_tx_queue(ndev, i);
+		if (netif_tx_queue_stopped(txq) &&
+		    (tvnet->os_link_state == OS_LINK_STATE_UP) &&
+		    tvnet_ivc_rd_available(&q->ep2h_empty) &&
+		    !tvnet_ivc_full(&q->ep2h_full))
+			netif_tx_wake_queue(txq);
 	}
 
 	if (tvnet_ivc_rd_available(&tvnet->h2ep_ctrl))
 		tvnet_ep_process_ctrl_msg(tvnet);
 
-	if (!tvnet_ivc_full(&tvnet->h2ep_empty) &&
-	    (tvnet->os_link_state == OS_LINK_STATE_UP))
-		tvnet_ep_alloc_empty_buffers(tvnet);
+	for (i = 0; i < tvnet->num_queues; i++) {
+		q = &tvnet->queues[i];
+		if (!tvnet_ivc_full(&q->h2ep_empty) &&
+		    (tvnet->os_link_state == OS_LINK_STATE_UP))
+			tvnet_ep_alloc_empty_buffers(tvnet, q);
+	}
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 14, 0))
 	schedule_work(&data_irqsp->reprime_work);
 #endif
@@ -1103,10 +1469,10 @@ static void tvnet_ep_data_irqsp_work(struct work_struct *work)
 static void tvnet_ep_data_irqsp_callback(void *private_data)
 {
 	struct irqsp_data *data_irqsp = private_data;
-	struct pci_epf_tvnet *tvnet = dev_get_drvdata(data_irqsp->dev);
+	struct tvnet_ep_queue *q = data_irqsp->queue;
 
-	if (tvnet_ivc_rd_available(&tvnet->h2ep_full))
-		napi_schedule(&tvnet->napi);
+	if (tvnet_ivc_rd_available(&q->h2ep_full))
+		napi_schedule(&q->napi);
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 14, 0))
 	else
 		schedule_work(&data_irqsp->reprime_work);
@@ -1115,14 +1481,14 @@ static void tvnet_ep_data_irqsp_callback(void *private_data)
 
 static int tvnet_ep_poll(struct napi_struct *napi, int budget)
 {
-	struct pci_epf_tvnet *tvnet = container_of(napi, struct pci_epf_tvnet,
-						   napi);
+	struct tvnet_ep_queue *q = container_of(napi, struct tvnet_ep_queue,
+						napi);
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 14, 0))
-	struct irqsp_data *data_irqsp = tvnet->data_irqsp;
+	struct irqsp_data *data_irqsp = q->data_irqsp;
 #endif
 	int work_done;
 
-	work_done = tvnet_ep_process_h2ep_msg(tvnet);
+	work_done = tvnet_ep_process_h2ep_msg(q->tvnet, q);
 	if (work_done < budget) {
 		napi_complete(napi);
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 14, 0))
@@ -1133,188 +1499,172 @@ static int tvnet_ep_poll(struct napi_struct *napi, int budget)
 	return work_done;
 }
 
-static int tvnet_ep_pci_epf_setup_irqsp(struct pci_epf_tvnet *tvnet)
+static struct irqsp_data *tvnet_ep_alloc_irqsp(struct pci_epf_tvnet *tvnet,
+						const char *name,
+						work_func_t work,
+						void (*callback)(void *))
 {
-	struct bar0_amap *amap = &tvnet->bar0_amap[SIMPLE_IRQ];
-	struct irqsp_data *ctrl_irqsp, *data_irqsp;
-	struct pci_epf *epf = tvnet->epf;
 	struct device *fdev = tvnet->fdev;
-	struct pci_epc *epc = epf->epc;
-	struct device *cdev = epc->dev.parent;
-	struct iommu_domain *domain = iommu_get_domain_for_dev(cdev);
-	struct irq_md *irq;
-	phys_addr_t syncpt_addr;
+	struct irqsp_data *irqsp;
 	int ret;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
-	struct host1x *host1x = NULL;
-	struct syncpt_t *syncpt = NULL;
-
-	host1x = platform_get_drvdata(tvnet->host1x_pdev);
-	if (!host1x) {
-		pr_err("Host1x handle is null.");
-		return -EINVAL;
-	}
+	struct host1x *host1x = platform_get_drvdata(tvnet->host1x_pdev);
+	struct syncpt_t *syncpt;
+#else
+	struct device *cdev = tvnet->epf->epc->dev.parent;
 #endif
-	ctrl_irqsp = devm_kzalloc(fdev, sizeof(*ctrl_irqsp), GFP_KERNEL);
-	if (!ctrl_irqsp) {
-		ret = -ENOMEM;
-		goto fail;
-	}
 
+	irqsp = devm_kzalloc(fdev, sizeof(*irqsp), GFP_KERNEL);
+	if (!irqsp)
+		return ERR_PTR(-ENOMEM);
+
+	irqsp->dev = fdev;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
-	syncpt = &ctrl_irqsp->syncpt;
+	syncpt = &irqsp->syncpt;
 	syncpt->sp = host1x_syncpt_alloc(host1x, HOST1X_SYNCPT_CLIENT_MANAGED,
-					 "pcie-ep-vnet-ctrl");
+					 name);
 	if (IS_ERR_OR_NULL(syncpt->sp)) {
-		ret = -ENOMEM;
 		pr_err("Failed to reserve comm notify syncpt\n");
-		goto free_ctrl_sp;
+		return ERR_PTR(-ENOMEM);
 	}
 
 	syncpt->id = host1x_syncpt_id(syncpt->sp);
-	ctrl_irqsp->dev = fdev;
-	INIT_WORK(&syncpt->work, tvnet_ep_ctrl_irqsp_work);
-	tvnet->ctrl_irqsp = ctrl_irqsp;
+	INIT_WORK(&syncpt->work, work);
 
 	syncpt->threshold = host1x_syncpt_read(syncpt->sp);
 
 	/* enable syncpt notifications handling from peer.*/
 	mutex_init(&syncpt->lock);
-	syncpt->notifier = tvnet_ep_ctrl_irqsp_callback;
-	syncpt->notifier_data = (void *)ctrl_irqsp;
+	syncpt->notifier = callback;
+	syncpt->notifier_data = (void *)irqsp;
 	syncpt->host1x_cb_set = true;
 	syncpt->fence_release = false;
 
 	ret = allocate_fence(syncpt);
 	if (ret != 0) {
 		pr_err("allocate_fence failed with: %d\n", ret);
-		goto free_ctrl_sp;
+		host1x_syncpt_put(syncpt->sp);
+		return ERR_PTR(ret);
 	}
+
+	syncpt->phy_addr = get_syncpt_shim_offset(syncpt->id);
+	syncpt->size = PAGE_SIZE;
 #else
-	ctrl_irqsp->is =
-		nvhost_interrupt_syncpt_get(cdev->of_node,
-					    tvnet_ep_ctrl_irqsp_callback,
-					    ctrl_irqsp);
-	if (IS_ERR(ctrl_irqsp->is)) {
-		ret = PTR_ERR(ctrl_irqsp->is);
-		dev_err(fdev, "failed to get ctrl syncpt irq: %d\n", ret);
-		goto fail;
+	irqsp->is = nvhost_interrupt_syncpt_get(cdev->of_node, callback, irqsp);
+	if (IS_ERR(irqsp->is)) {
+		ret = PTR_ERR(irqsp->is);
+		dev_err(fdev, "failed to get %s syncpt irq: %d\n", name, ret);
+		return ERR_PTR(ret);
 	}
 
-	ctrl_irqsp->dev = fdev;
-	INIT_WORK(&ctrl_irqsp->reprime_work, tvnet_ep_ctrl_irqsp_reprime_work);
-	tvnet->ctrl_irqsp = ctrl_irqsp;
+	INIT_WORK(&irqsp->reprime_work, work);
 #endif
-	data_irqsp = devm_kzalloc(fdev, sizeof(*data_irqsp), GFP_KERNEL);
-	if (!data_irqsp) {
-		ret = -ENOMEM;
-		goto free_ctrl_sp;
-	}
 
+	return irqsp;
+}
+
+static void tvnet_ep_free_irqsp(struct irqsp_data *irqsp)
+{
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
-	syncpt = &data_irqsp->syncpt;
-	syncpt->sp = host1x_syncpt_alloc(host1x, HOST1X_SYNCPT_CLIENT_MANAGED,
-					 "pcie-ep-vnet-data");
-	if (IS_ERR_OR_NULL(syncpt->sp)) {
-		ret = -ENOMEM;
-		pr_err("Failed to reserve comm notify syncpt\n");
-		goto free_ctrl_sp;
-	}
+	host1x_syncpt_put(irqsp->syncpt.sp);
+#else
+	nvhost_interrupt_syncpt_free(irqsp->is);
+#endif
+}
 
-	syncpt->id = host1x_syncpt_id(syncpt->sp);
-	data_irqsp->dev = fdev;
-	INIT_WORK(&syncpt->work, tvnet_ep_data_irqsp_work);
-	tvnet->data_irqsp = data_irqsp;
+static phys_addr_t tvnet_ep_irqsp_addr(struct irqsp_data *irqsp)
+{
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
+	return irqsp->syncpt.phy_addr;
+#else
+	return nvhost_interrupt_syncpt_get_syncpt_addr(irqsp->is);
+#endif
+}
 
-	syncpt->threshold = host1x_syncpt_read(syncpt->sp);
+/* SIMPLE_IRQ page 0 is for ctrl, data queue N uses page N + 1 */
+static struct irqsp_data *tvnet_ep_irqsp_of_page(struct pci_epf_tvnet *tvnet,
+						 u32 page)
+{
+	return page ? tvnet->queues[page - 1].data_irqsp : tvnet->ctrl_irqsp;
+}
 
-	/* enable syncpt notifications handling from peer.*/
-	mutex_init(&syncpt->lock);
-	syncpt->notifier = tvnet_ep_data_irqsp_callback;
-	syncpt->notifier_data = (void *)data_irqsp;
-	syncpt->host1x_cb_set = true;
-	syncpt->fence_release = false;
+static int tvnet_ep_pci_epf_setup_irqsp(struct pci_epf_tvnet *tvnet)
+{
+	struct bar0_amap *amap = &tvnet->bar0_amap[SIMPLE_IRQ];
+	struct bar_md *bar_md = tvnet->bar_md;
+	struct irqsp_data *irqsp;
+	struct pci_epf *epf = tvnet->epf;
+	struct device *fdev = tvnet->fdev;
+	struct pci_epc *epc = epf->epc;
+	struct device *cdev = epc->dev.parent;
+	struct iommu_domain *domain = iommu_get_domain_for_dev(cdev);
+	struct irq_md *irq;
+	int ret;
+	u32 i;
 
-	ret = allocate_fence(syncpt);
-	if (ret != 0) {
-		pr_err("allocate_fence failed with: %d\n", ret);
-		goto free_ctrl_sp;
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
+	if (!tvnet->host1x_pdev || !platform_get_drvdata(tvnet->host1x_pdev)) {
+		pr_err("Host1x handle is null.");
+		return -EINVAL;
 	}
-
-	syncpt_addr = get_syncpt_shim_offset(ctrl_irqsp->syncpt.id);
-	ctrl_irqsp->syncpt.phy_addr = syncpt_addr;
-	ctrl_irqsp->syncpt.size = PAGE_SIZE;
-#else
-	data_irqsp->is =
-		nvhost_interrupt_syncpt_get(cdev->of_node,
-					    tvnet_ep_data_irqsp_callback,
-					    data_irqsp);
-	if (IS_ERR(data_irqsp->is)) {
-		ret = PTR_ERR(data_irqsp->is);
-		dev_err(fdev, "failed to get data syncpt irq: %d\n", ret);
-		goto free_ctrl_sp;
+#endif
+	irqsp = tvnet_ep_alloc_irqsp(tvnet, "pcie-ep-vnet-ctrl",
+				     tvnet_ep_ctrl_irqsp_work,
+				     tvnet_ep_ctrl_irqsp_callback);
+	if (IS_ERR(irqsp))
+		return PTR_ERR(irqsp);
+	tvnet->ctrl_irqsp = irqsp;
+
+	for (i = 0; i < tvnet->num_queues; i++) {
+		irqsp = tvnet_ep_alloc_irqsp(tvnet, "pcie-ep-vnet-data",
+					     tvnet_ep_data_irqsp_work,
+					     tvnet_ep_data_irqsp_callback);
+		if (IS_ERR(irqsp)) {
+			ret = PTR_ERR(irqsp);
+			goto free_irqsp;
+		}
+		irqsp->queue = &tvnet->queues[i];
+		tvnet->queues[i].data_irqsp = irqsp;
 	}
 
-	data_irqsp->dev = fdev;
-	INIT_WORK(&data_irqsp->reprime_work, tvnet_ep_data_irqsp_reprime_work);
-	tvnet->data_irqsp = data_irqsp;
-
-	syncpt_addr = nvhost_interrupt_syncpt_get_syncpt_addr(ctrl_irqsp->is);
-#endif
-	ret = iommu_map(domain, amap->iova, syncpt_addr, PAGE_SIZE,
+	for (i = 0; i <= tvnet->num_queues; i++) {
+		irqsp = tvnet_ep_irqsp_of_page(tvnet, i);
+		ret = iommu_map(domain, amap->iova + i * PAGE_SIZE,
+				tvnet_ep_irqsp_addr(irqsp), PAGE_SIZE,
 #if defined(NV_IOMMU_MAP_HAS_GFP_ARG)
-			IOMMU_CACHE | IOMMU_READ | IOMMU_WRITE, GFP_KERNEL);
+				IOMMU_CACHE | IOMMU_READ | IOMMU_WRITE, GFP_KERNEL);
 #else
-			IOMMU_CACHE | IOMMU_READ | IOMMU_WRITE);
+				IOMMU_CACHE | IOMMU_READ | IOMMU_WRITE);
 #endif
-	if (ret < 0) {
-		dev_err(fdev, "%s: iommu_map of ctrlsp mem failed: %d\n",
-			__func__, ret);
-		goto free_data_sp;
+		if (ret < 0) {
+			dev_err(fdev, "%s: iommu_map of irqsp %u mem failed: %d\n",
+				__func__, i, ret);
+			goto unmap_irqsp;
+		}
 	}
 
-	irq = &tvnet->bar_md->irq_ctrl;
+	irq = &bar_md->irq_ctrl;
 	irq->irq_addr = PAGE_SIZE;
 	irq->irq_type = IRQ_SIMPLE;
 
-#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
-	syncpt_addr = get_syncpt_shim_offset(data_irqsp->syncpt.id);
-	data_irqsp->syncpt.phy_addr = syncpt_addr;
-	data_irqsp->syncpt.size = PAGE_SIZE;
-#else
-	syncpt_addr = nvhost_interrupt_syncpt_get_syncpt_addr(data_irqsp->is);
-#endif
-	ret = iommu_map(domain, amap->iova + PAGE_SIZE, syncpt_addr, PAGE_SIZE,
-#if defined(NV_IOMMU_MAP_HAS_GFP_ARG)
-			IOMMU_CACHE | IOMMU_READ | IOMMU_WRITE, GFP_KERNEL);
-#else
-			IOMMU_CACHE | IOMMU_READ | IOMMU_WRITE);
-#endif
-	if (ret < 0) {
-		dev_err(fdev, "%s: iommu_map of datasp mem failed: %d\n",
-			__func__, ret);
-		goto free_ctrl_ivoa;
+	for (i = 0; i < tvnet->num_queues; i++) {
+		irq = &bar_md->queue_md[i].irq_data;
+		irq->irq_addr = (i + 2) * PAGE_SIZE;
+		irq->irq_type = IRQ_SIMPLE;
 	}
-
-	irq = &tvnet->bar_md->irq_data;
-	irq->irq_addr = 2 * PAGE_SIZE;
-	irq->irq_type = IRQ_SIMPLE;
+	bar_md->irq_data = bar_md->queue_md[0].irq_data;
 
 	return 0;
 
-free_ctrl_ivoa:
-	iommu_unmap(domain, amap->iova, PAGE_SIZE);
-free_data_sp:
-#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
-	host1x_syncpt_put(data_irqsp->syncpt.sp);
-free_ctrl_sp:
-	host1x_syncpt_put(ctrl_irqsp->syncpt.sp);
-#else
-	nvhost_interrupt_syncpt_free(data_irqsp->is);
-free_ctrl_sp:
-	nvhost_interrupt_syncpt_free(ctrl_irqsp->is);
-#endif
-fail:
+unmap_irqsp:
+	while (i--)
+		iommu_unmap(domain, amap->iova + i * PAGE_SIZE, PAGE_SIZE);
+	i = tvnet->num_queues;
+free_irqsp:
+	while (i--)
+		tvnet_ep_free_irqsp(tvnet->queues[i].data_irqsp);
+	tvnet_ep_free_irqsp(tvnet->ctrl_irqsp);
+
 	return ret;
 }
 
@@ -1324,17 +1674,14 @@ static void tvnet_ep_pci_epf_destroy_irqsp(struct pci_epf_tvnet *tvnet)
 	struct pci_epc *epc = epf->epc;
 	struct device *cdev = epc->dev.parent;
 	struct iommu_domain *domain = iommu_get_domain_for_dev(cdev);
+	u32 i;
 
-	iommu_unmap(domain, tvnet->bar0_amap[SIMPLE_IRQ].iova + PAGE_SIZE,
-		    PAGE_SIZE);
-	iommu_unmap(domain, tvnet->bar0_amap[SIMPLE_IRQ].iova, PAGE_SIZE);
-#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
-	host1x_syncpt_put(tvnet->data_irqsp->syncpt.sp);
-	host1x_syncpt_put(tvnet->ctrl_irqsp->syncpt.sp);
-#else
-	nvhost_interrupt_syncpt_free(tvnet->data_irqsp->is);
-	nvhost_interrupt_syncpt_free(tvnet->ctrl_irqsp->is);
-#endif
+	for (i = 0; i <= tvnet->num_queues; i++) {
+		iommu_unmap(domain,
+			    tvnet->bar0_amap[SIMPLE_IRQ].iova + i * PAGE_SIZE,
+			    PAGE_SIZE);
+		tvnet_ep_free_irqsp(tvnet_ep_irqsp_of_page(tvnet, i));
+	}
 }
 
 static int tvnet_ep_alloc_single_page_bar0_mem(struct pci_epf *epf,
@@ -1579,15 +1926,7 @@ static int tvnet_ep_pci_epf_notifier(struct notifier_block *nb,
 #if ENABLE_DMA
 		tvnet_ep_setup_dma(tvnet);
 #endif
-
-		/*
-		 * If host goes through a suspend resume, it recycles EP2H
-		 * empty buffer. Clear any pending EP2H full buffer by setting
-		 * "wr_cnt = rd_cnt".
-		 */
-		tvnet_ivc_set_wr(&tvnet->ep2h_full,
-				 tvnet_ivc_get_rd_cnt(&tvnet->ep2h_full));
-
+		tvnet_ep_clear_ep2h_full(tvnet);
 		tvnet->pcie_link_status = true;
 		break;
 
@@ -1610,14 +1949,7 @@ static void tvnet_ep_pci_epf_linkup(struct pci_epf *epf)
 #if ENABLE_DMA
 	tvnet_ep_setup_dma(tvnet);
 #endif
-
-	/*
-	 * If host goes through a suspend resume, it recycles EP2H empty buffer.
-	 * Clear any pending EP2H full buffer by setting "wr_cnt = rd_cnt".
-	 */
-	tvnet_ivc_set_wr(&tvnet->ep2h_full,
-			 tvnet_ivc_get_rd_cnt(&tvnet->ep2h_full));
-
+	tvnet_ep_clear_ep2h_full(tvnet);
 	tvnet->pcie_link_status = true;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
 	val = readl(tvnet->appl_base + APPL_INTR_EN_L1_8_0);
@@ -1677,6 +2009,85 @@ struct iommu_dma_cookie {
 };
 #endif
 
+/*
+ * Data queue 0 keeps the legacy layout after the ctrl rings and shares their
+ * counters, every other queue has its own counters followed by data rings.
+ */
+static void tvnet_ep_setup_queue_md(struct pci_epf_tvnet *tvnet)
+{
+	struct bar_md *bar_md = tvnet->bar_md;
+	void *ep_virt = tvnet->bar0_amap[EP_MEM].virt;
+	void *host_virt = tvnet->bar0_amap[HOST_MEM].virt;
+	u32 ep_off = 0, host_off = 0, i;
+
+	for (i = 0; i < tvnet->num_queues; i++) {
+		struct tvnet_ep_queue *q = &tvnet->queues[i];
+		struct queue_md *queue_md = &bar_md->queue_md[i];
+		struct ep_ring_buf *ep_ring_buf = &q->ep_ring_buf;
+		struct host_ring_buf *host_ring_buf = &q->host_ring_buf;
+
+		ep_ring_buf->ep_cnt = ep_virt + ep_off;
+		queue_md->ep_own_cnt_offset = bar_md->ep_own_cnt_offset + ep_off;
+		ep_off += sizeof(struct ep_own_cnt);
+		host_ring_buf->host_cnt = host_virt + host_off;
+		queue_md->host_own_cnt_offset = bar_md->host_own_cnt_offset +
+						host_off;
+		host_off += sizeof(struct host_own_cnt);
+		if (i == 0) {
+			ep_off += RING_COUNT * sizeof(struct ctrl_msg);
+			host_off += RING_COUNT * sizeof(struct ctrl_msg);
+		} else {
+			memset(ep_ring_buf->ep_cnt, 0, sizeof(struct ep_own_cnt));
+			memset(host_ring_buf->host_cnt, 0,
+			       sizeof(struct host_own_cnt));
+		}
+
+		/* EP owned memory */
+		ep_ring_buf->ep2h_full_msgs = ep_virt + ep_off;
+		queue_md->ep2h_md.ep2h_offset = bar_md->ep_own_cnt_offset + ep_off;
+		queue_md->ep2h_md.ep2h_size = RING_COUNT;
+		ep_off += RING_COUNT * sizeof(struct data_msg);
+		ep_ring_buf->h2ep_empty_msgs = ep_virt + ep_off;
+		queue_md->h2ep_md.ep2h_offset = bar_md->ep_own_cnt_offset + ep_off;
+		queue_md->h2ep_md.ep2h_size = RING_COUNT;
+		ep_off += RING_COUNT * sizeof(struct data_msg);
+
+		/* Host owned memory */
+		host_ring_buf->ep2h_empty_msgs = host_virt + host_off;
+		queue_md->ep2h_md.h2ep_offset = bar_md->host_own_cnt_offset +
+						host_off;
+		queue_md->ep2h_md.h2ep_size = RING_COUNT;
+		host_off += RING_COUNT * sizeof(struct data_msg);
+		host_ring_buf->h2ep_full_msgs = host_virt + host_off;
+		queue_md->h2ep_md.h2ep_offset = bar_md->host_own_cnt_offset +
+						host_off;
+		queue_md->h2ep_md.h2ep_size = RING_COUNT;
+		host_off += RING_COUNT * sizeof(struct data_msg);
+
+		q->h2ep_empty.rd = &host_ring_buf->host_cnt->h2ep_empty_rd_cnt;
+		q->h2ep_empty.wr = &ep_ring_buf->ep_cnt->h2ep_empty_wr_cnt;
+		q->h2ep_full.rd = &ep_ring_buf->ep_cnt->h2ep_full_rd_cnt;
+		q->h2ep_full.wr = &host_ring_buf->host_cnt->h2ep_full_wr_cnt;
+		q->ep2h_empty.rd = &ep_ring_buf->ep_cnt->ep2h_empty_rd_cnt;
+		q->ep2h_empty.wr = &host_ring_buf->host_cnt->ep2h_empty_wr_cnt;
+		q->ep2h_full.rd = &host_ring_buf->host_cnt->ep2h_full_rd_cnt;
+		q->ep2h_full.wr = &ep_ring_buf->ep_cnt->ep2h_full_wr_cnt;
+
+		/* Queues beyond the channel count share DMA channels */
+		queue_md->host_dma_chan = i % tvnet->num_host_dma;
+		queue_md->host_dma_offset = bar_md->host_dma_offset +
+				queue_md->host_dma_chan * DMA_DESC_RING_SIZE;
+#if ENABLE_DMA
+		q->dma = &tvnet->dma[i % tvnet->num_dma];
+#endif
+	}
+
+	/* Legacy fields describe queue 0 for hosts without queue_md */
+	bar_md->ep2h_md = bar_md->queue_md[0].ep2h_md;
+	bar_md->h2ep_md = bar_md->queue_md[0].h2ep_md;
+	bar_md->num_queues = tvnet->num_queues;
+}
+
 static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 {
 	struct pci_epf_tvnet *tvnet = epf_get_drvdata(epf);
@@ -1696,6 +2107,7 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	struct bar0_amap *amap;
 	struct tvnet_dma_desc *dma_desc;
 	int ret, size, bitmap_size;
+	u32 i;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
 	unsigned long shift;
 #endif
@@ -1776,12 +2188,40 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 
 	tvnet->bar_md = (struct bar_md *)tvnet->bar0_amap[META_DATA].virt;
 	bar_md = tvnet->bar_md;
+	memset(bar_md, 0, tvnet->bar0_amap[META_DATA].size);
 
-	/* BAR0 SIMPLE_IRQ setup: two interrupts required two pages */
+	tvnet->num_queues = tvnet_ep_max_queues();
+	tvnet->active_queues = 1;
+	tvnet->num_host_dma = min_t(u32, tvnet->num_queues, DMA_RD_CHNL_NUM);
+#if ENABLE_DMA
+	tvnet->num_dma = min_t(u32, tvnet->num_queues, DMA_WR_CHNL_NUM);
+	for (i = 0; i < tvnet->num_dma; i++) {
+		tvnet->dma[i].tvnet = tvnet;
+		tvnet->dma[i].chan = DMA_WR_DATA_CH + i;
+		spin_lock_init(&tvnet->dma[i].lock);
+		hrtimer_init(&tvnet->dma[i].reap_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		tvnet->dma[i].reap_timer.function = tvnet_ep_dma_reap_timer;
+	}
+#endif
+	for (i = 0; i < tvnet->num_queues; i++) {
+		tvnet->queues[i].tvnet = tvnet;
+		tvnet->queues[i].qid = i;
+		INIT_LIST_HEAD(&tvnet->queues[i].h2ep_empty_list);
+		spin_lock_init(&tvnet->queues[i].h2ep_empty_lock);
+		INIT_WORK(&tvnet->queues[i].raise_irq_work,
+			  tvnet_ep_raise_irq_work_function);
+		atomic_set(&tvnet->queues[i].irq_pending, 0);
+		hrtimer_init(&tvnet->queues[i].irq_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		tvnet->queues[i].irq_timer.function = tvnet_ep_irq_timer;
+	}
+
+	/* BAR0 SIMPLE_IRQ setup: one page each for ctrl and data queues */
 	amap = &tvnet->bar0_amap[SIMPLE_IRQ];
 	amap->iova = tvnet->bar0_amap[META_DATA].iova +
 		tvnet->bar0_amap[META_DATA].size;
-	amap->size = 2 * PAGE_SIZE;
+	amap->size = (tvnet->num_queues + 1) * PAGE_SIZE;
 
 	ret = tvnet_ep_pci_epf_setup_irqsp(tvnet);
 	if (ret < 0) {
@@ -1793,8 +2233,8 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	amap = &tvnet->bar0_amap[EP_MEM];
 	amap->iova = tvnet->bar0_amap[SIMPLE_IRQ].iova +
 		tvnet->bar0_amap[SIMPLE_IRQ].size;
-	size = sizeof(struct ep_own_cnt) + (RING_COUNT *
-		(sizeof(struct ctrl_msg) + 2 * sizeof(struct data_msg)));
+	size = RING_COUNT * sizeof(struct ctrl_msg) + tvnet->num_queues *
+		(sizeof(struct ep_own_cnt) + 2 * RING_COUNT * sizeof(struct data_msg));
 	amap->size = PAGE_ALIGN(size);
 	ret = tvnet_ep_alloc_multi_page_bar0_mem(epf, EP_MEM);
 	if (ret < 0) {
@@ -1805,10 +2245,6 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	ep_ring_buf->ep_cnt = (struct ep_own_cnt *)amap->virt;
 	ep_ring_buf->ep2h_ctrl_msgs = (struct ctrl_msg *)
 				(ep_ring_buf->ep_cnt + 1);
-	ep_ring_buf->ep2h_full_msgs = (struct data_msg *)
-				(ep_ring_buf->ep2h_ctrl_msgs + RING_COUNT);
-	ep_ring_buf->h2ep_empty_msgs = (struct data_msg *)
-				(ep_ring_buf->ep2h_full_msgs + RING_COUNT);
 	/* Clear EP counters */
 	memset(ep_ring_buf->ep_cnt, 0, sizeof(struct ep_own_cnt));
 
@@ -1816,8 +2252,8 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	amap = &tvnet->bar0_amap[HOST_MEM];
 	amap->iova = tvnet->bar0_amap[EP_MEM].iova +
 					tvnet->bar0_amap[EP_MEM].size;
-	size = (sizeof(struct host_own_cnt)) + (RING_COUNT *
-		(sizeof(struct ctrl_msg) + 2 * sizeof(struct data_msg)));
+	size = RING_COUNT * sizeof(struct ctrl_msg) + tvnet->num_queues *
+		(sizeof(struct host_own_cnt) + 2 * RING_COUNT * sizeof(struct data_msg));
 	amap->size = PAGE_ALIGN(size);
 	ret = tvnet_ep_alloc_multi_page_bar0_mem(epf, HOST_MEM);
 	if (ret < 0) {
@@ -1828,21 +2264,18 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	host_ring_buf->host_cnt = (struct host_own_cnt *)amap->virt;
 	host_ring_buf->h2ep_ctrl_msgs = (struct ctrl_msg *)
 				(host_ring_buf->host_cnt + 1);
-	host_ring_buf->ep2h_empty_msgs = (struct data_msg *)
-				(host_ring_buf->h2ep_ctrl_msgs + RING_COUNT);
-	host_ring_buf->h2ep_full_msgs = (struct data_msg *)
-				(host_ring_buf->ep2h_empty_msgs + RING_COUNT);
 	/* Clear host counters */
 	memset(host_ring_buf->host_cnt, 0, sizeof(struct host_own_cnt));
 
 	/*
-	 * Allocate local memory for DMA read link list elements.
+	 * Allocate local memory for DMA read link list elements, one list for
+	 * each read channel used by host.
 	 * This is exposed through BAR0 to initiate DMA read from host.
 	 */
 	amap = &tvnet->bar0_amap[HOST_DMA];
 	amap->iova = tvnet->bar0_amap[HOST_MEM].iova +
 					tvnet->bar0_amap[HOST_MEM].size;
-	size = ((DMA_DESC_COUNT + 1) * sizeof(struct tvnet_dma_desc));
+	size = tvnet->num_host_dma * DMA_DESC_RING_SIZE;
 	amap->size = PAGE_ALIGN(size);
 	ret = tvnet_ep_alloc_multi_page_bar0_mem(epf, HOST_DMA);
 	if (ret < 0) {
@@ -1852,10 +2285,15 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 
 	/* Set link list pointer to create a dma desc ring */
 	memset(amap->virt, 0, amap->size);
-	dma_desc = (struct tvnet_dma_desc *)amap->virt;
-	dma_desc[DMA_DESC_COUNT].sar_low = (amap->iova & 0xffffffff);
-	dma_desc[DMA_DESC_COUNT].sar_high = ((amap->iova >> 32) & 0xffffffff);
-	dma_desc[DMA_DESC_COUNT].ctrl_reg.ctrl_e.llp = 1;
+	for (i = 0; i < tvnet->num_host_dma; i++) {
+		size = i * DMA_DESC_RING_SIZE;
+		dma_desc = (struct tvnet_dma_desc *)(amap->virt + size);
+		dma_desc[DMA_DESC_COUNT].sar_low =
+					lower_32_bits(amap->iova + size);
+		dma_desc[DMA_DESC_COUNT].sar_high =
+					upper_32_bits(amap->iova + size);
+		dma_desc[DMA_DESC_COUNT].ctrl_reg.ctrl_e.llp = 1;
+	}
 
 	/* Update BAR metadata region with offsets */
 	/* EP owned memory */
@@ -1864,12 +2302,6 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	bar_md->ctrl_md.ep2h_offset = bar_md->ep_own_cnt_offset +
 					sizeof(struct ep_own_cnt);
 	bar_md->ctrl_md.ep2h_size = RING_COUNT;
-	bar_md->ep2h_md.ep2h_offset = bar_md->ctrl_md.ep2h_offset +
-					(RING_COUNT * sizeof(struct ctrl_msg));
-	bar_md->ep2h_md.ep2h_size = RING_COUNT;
-	bar_md->h2ep_md.ep2h_offset = bar_md->ep2h_md.ep2h_offset +
-					(RING_COUNT * sizeof(struct data_msg));
-	bar_md->h2ep_md.ep2h_size = RING_COUNT;
 
 	/* Host owned memory */
 	bar_md->host_own_cnt_offset = bar_md->ep_own_cnt_offset +
@@ -1877,31 +2309,19 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	bar_md->ctrl_md.h2ep_offset = bar_md->host_own_cnt_offset +
 					sizeof(struct host_own_cnt);
 	bar_md->ctrl_md.h2ep_size = RING_COUNT;
-	bar_md->ep2h_md.h2ep_offset = bar_md->ctrl_md.h2ep_offset +
-					(RING_COUNT * sizeof(struct ctrl_msg));
-	bar_md->ep2h_md.h2ep_size = RING_COUNT;
-	bar_md->h2ep_md.h2ep_offset = bar_md->ep2h_md.h2ep_offset +
-					(RING_COUNT * sizeof(struct data_msg));
-	bar_md->h2ep_md.h2ep_size = RING_COUNT;
 
 	tvnet->h2ep_ctrl.rd = &ep_ring_buf->ep_cnt->h2ep_ctrl_rd_cnt;
 	tvnet->h2ep_ctrl.wr = &host_ring_buf->host_cnt->h2ep_ctrl_wr_cnt;
 	tvnet->ep2h_ctrl.rd = &host_ring_buf->host_cnt->ep2h_ctrl_rd_cnt;
 	tvnet->ep2h_ctrl.wr = &ep_ring_buf->ep_cnt->ep2h_ctrl_wr_cnt;
-	tvnet->h2ep_empty.rd = &host_ring_buf->host_cnt->h2ep_empty_rd_cnt;
-	tvnet->h2ep_empty.wr = &ep_ring_buf->ep_cnt->h2ep_empty_wr_cnt;
-	tvnet->h2ep_full.rd = &ep_ring_buf->ep_cnt->h2ep_full_rd_cnt;
-	tvnet->h2ep_full.wr = &host_ring_buf->host_cnt->h2ep_full_wr_cnt;
-	tvnet->ep2h_empty.rd = &ep_ring_buf->ep_cnt->ep2h_empty_rd_cnt;
-	tvnet->ep2h_empty.wr = &host_ring_buf->host_cnt->ep2h_empty_wr_cnt;
-	tvnet->ep2h_full.rd = &host_ring_buf->host_cnt->ep2h_full_rd_cnt;
-	tvnet->ep2h_full.wr = &ep_ring_buf->ep_cnt->ep2h_full_wr_cnt;
 
 	/* RAM region for use by host when programming EP DMA controller */
 	bar_md->host_dma_offset = bar_md->host_own_cnt_offset +
 					tvnet->bar0_amap[HOST_MEM].size;
 	bar_md->host_dma_size = tvnet->bar0_amap[HOST_DMA].size;
 
+	tvnet_ep_setup_queue_md(tvnet);
+
 	/* EP Rx pkt IOVA range */
 	tvnet->rx_buf_iova = tvnet->bar0_amap[HOST_DMA].iova +
 					tvnet->bar0_amap[HOST_DMA].size;
@@ -1936,7 +2356,7 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	}
 
 	/* Register network device */
-	ndev = alloc_etherdev(0);
+	ndev = alloc_etherdev_mqs(0, tvnet->num_queues, tvnet->num_queues);
 	if (!ndev) {
 		dev_err(fdev, "alloc_etherdev() failed\n");
 		ret = -ENOMEM;
@@ -1947,12 +2367,25 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	tvnet->ndev = ndev;
 	SET_NETDEV_DEV(ndev, fdev);
 	ndev->netdev_ops = &tvnet_netdev_ops;
+	for (i = 0; i < tvnet->num_queues; i++) {
 #if defined(NV_NETIF_NAPI_ADD_WEIGHT_PRESENT) /* Linux v6.1 */
-	netif_napi_add_weight(ndev, &tvnet->napi, tvnet_ep_poll, TVNET_NAPI_WEIGHT);
+		netif_napi_add_weight(ndev, &tvnet->queues[i].napi,
+				      tvnet_ep_poll, TVNET_NAPI_WEIGHT);
 #else
-	netif_napi_add(ndev, &tvnet->napi, tvnet_ep_poll, TVNET_NAPI_WEIGHT);
+		netif_napi_add(ndev, &tvnet->queues[i].napi, tvnet_ep_poll,
+			       TVNET_NAPI_WEIGHT);
 #endif
+	}
 	ndev->mtu = TVNET_DEFAULT_MTU;
+	/* Checksums are left to host, the link itself is reliable */
+	ndev->hw_features |= TVNET_NETIF_F_CSUM;
+#if ENABLE_DMA
+	/* Frags are written by DMA straight into the host buffer */
+	ndev->hw_features |= NETIF_F_SG | TVNET_NETIF_F_GSO;
+#endif
+	ndev->features |= ndev->hw_features;
+	/* Build superframes up to one host receive buffer */
+	netif_set_gso_max_size(ndev, ndev->mtu + ETH_HLEN);
 
 	ret = register_netdev(ndev);
 	if (ret < 0) {
@@ -1967,11 +2400,6 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	mutex_init(&tvnet->link_state_lock);
 	init_waitqueue_head(&tvnet->link_state_wq);
 
-	INIT_LIST_HEAD(&tvnet->h2ep_empty_list);
-	spin_lock_init(&tvnet->h2ep_empty_lock);
-
-	INIT_WORK(&tvnet->raise_irq_work, tvnet_ep_raise_irq_work_function);
-
 #if (LINUX_VERSION_CODE <= KERNEL_VERSION(4, 15, 0))
 	/* TODO Update it to 64-bit prefetch type */
 	ret = pci_epc_set_bar(epc, BAR_0, tvnet->bar0_iova, BAR0_SIZE,
@@ -1991,28 +2419,42 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	}
 #endif
 
+#if ENABLE_DMA
 	/* Allocate local memory for DMA write link list elements */
-	size = ((DMA_DESC_COUNT + 1) * sizeof(struct tvnet_dma_desc));
-	tvnet->ep_dma_virt = dma_alloc_coherent(cdev, size,
-						&tvnet->ep_dma_iova,
-						GFP_KERNEL);
-	if (!tvnet->ep_dma_virt) {
-		dev_err(fdev, "%s ep dma mem alloc failed\n", __func__);
-		ret = -ENOMEM;
-		goto fail_clear_bar;
-	}
+	for (i = 0; i < tvnet->num_dma; i++) {
+		struct tvnet_ep_dma *dma = &tvnet->dma[i];
+
+		dma->virt = dma_alloc_coherent(cdev, DMA_DESC_RING_SIZE,
+					       &dma->iova, GFP_KERNEL);
+		if (!dma->virt) {
+			dev_err(fdev, "%s ep dma mem alloc failed\n", __func__);
+			ret = -ENOMEM;
+			goto fail_free_ep_dma;
+		}
 
-	/* Set link list pointer to create a dma desc ring */
-	memset(tvnet->ep_dma_virt, 0, size);
-	dma_desc = (struct tvnet_dma_desc *)tvnet->ep_dma_virt;
-	dma_desc[DMA_DESC_COUNT].sar_low = (tvnet->ep_dma_iova & 0xffffffff);
-	dma_desc[DMA_DESC_COUNT].sar_high = ((tvnet->ep_dma_iova >> 32) &
-					     0xffffffff);
-	dma_desc[DMA_DESC_COUNT].ctrl_reg.ctrl_e.llp = 1;
+		dma->tx_buf = kcalloc(DMA_DESC_COUNT, sizeof(*dma->tx_buf),
+				      GFP_KERNEL);
+		if (!dma->tx_buf) {
+			dma_free_coherent(cdev, DMA_DESC_RING_SIZE, dma->virt,
+					  dma->iova);
+			ret = -ENOMEM;
+			goto fail_free_ep_dma;
+		}
+
+		/* Set link list pointer to create a dma desc ring */
+		memset(dma->virt, 0, DMA_DESC_RING_SIZE);
+		dma_desc = (struct tvnet_dma_desc *)dma->virt;
+		dma_desc[DMA_DESC_COUNT].sar_low = (dma->iova & 0xffffffff);
+		dma_desc[DMA_DESC_COUNT].sar_high = ((dma->iova >> 32) &
+						     0xffffffff);
+		dma_desc[DMA_DESC_COUNT].ctrl_reg.ctrl_e.llp = 1;
+	}
+#endif
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 14, 0))
 	nvhost_interrupt_syncpt_prime(tvnet->ctrl_irqsp->is);
-	nvhost_interrupt_syncpt_prime(tvnet->data_irqsp->is);
+	for (i = 0; i < tvnet->num_queues; i++)
+		nvhost_interrupt_syncpt_prime(tvnet->queues[i].data_irqsp->is);
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
 	epf->nb.notifier_call = tvnet_ep_pci_epf_notifier;
@@ -2022,6 +2464,14 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 
 	return 0;
 
+#if ENABLE_DMA
+fail_free_ep_dma:
+	while (i--) {
+		kfree(tvnet->dma[i].tx_buf);
+		dma_free_coherent(cdev, DMA_DESC_RING_SIZE, tvnet->dma[i].virt,
+				  tvnet->dma[i].iova);
+	}
+#endif
 fail_clear_bar:
 #if (LINUX_VERSION_CODE <= KERNEL_VERSION(4, 15, 0))
 	pci_epc_clear_bar(epc, BAR_0);
@@ -2029,7 +2479,8 @@ fail_unreg_netdev:
 #endif
 	unregister_netdev(ndev);
 fail_free_netdev:
-	netif_napi_del(&tvnet->napi);
+	for (i = 0; i < tvnet->num_queues; i++)
+		netif_napi_del(&tvnet->queues[i].napi);
 	free_netdev(ndev);
 free_pci_mem:
 	pci_epc_mem_free_addr(epc, tvnet->tx_dst_pci_addr, tvnet->tx_dst_va,
@@ -2087,6 +2538,7 @@ static void tvnet_ep_pci_epf_unbind(struct pci_epf *epf)
 #endif
 	struct pci_epc *epc = epf->epc;
 	struct device *cdev = epc->dev.parent;
+	u32 i;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
 	struct syncpt_t *syncpt = NULL;
 
@@ -2094,9 +2546,11 @@ static void tvnet_ep_pci_epf_unbind(struct pci_epf *epf)
 	free_fence_resource(syncpt);
 	cancel_work_sync(&syncpt->work);
 
-	syncpt = &tvnet->data_irqsp->syncpt;
-	free_fence_resource(syncpt);
-	cancel_work_sync(&syncpt->work);
+	for (i = 0; i < tvnet->num_queues; i++) {
+		syncpt = &tvnet->queues[i].data_irqsp->syncpt;
+		free_fence_resource(syncpt);
+		cancel_work_sync(&syncpt->work);
+	}
 #endif
 	pci_epc_stop(epc);
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
@@ -2104,11 +2558,20 @@ static void tvnet_ep_pci_epf_unbind(struct pci_epf *epf)
 #else
 	pci_epc_clear_bar(epc, BAR_0);
 #endif
-	dma_free_coherent(cdev,
-			  ((RING_COUNT + 1) * sizeof(struct tvnet_dma_desc)),
-			  tvnet->ep_dma_virt, tvnet->ep_dma_iova);
+#if ENABLE_DMA
+	for (i = 0; i < tvnet->num_dma; i++) {
+		tvnet_ep_dma_reset(&tvnet->dma[i]);
+		kfree(tvnet->dma[i].tx_buf);
+		dma_free_coherent(cdev, DMA_DESC_RING_SIZE, tvnet->dma[i].virt,
+				  tvnet->dma[i].iova);
+	}
+#endif
 	unregister_netdev(tvnet->ndev);
-	netif_napi_del(&tvnet->napi);
+	for (i = 0; i < tvnet->num_queues; i++) {
+		netif_napi_del(&tvnet->queues[i].napi);
+		hrtimer_cancel(&tvnet->queues[i].irq_timer);
+		cancel_work_sync(&tvnet->queues[i].raise_irq_work);
+	}
 	free_netdev(tvnet->ndev);
 	pci_epc_mem_free_addr(epc, tvnet->tx_dst_pci_addr, tvnet->tx_dst_va,
 			      SZ_64K);
@@ -17,6 +17,8 @@
 #include <linux/sched.h>
 #include <linux/sched/clock.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
 
 #include <aon.h>
 #include <aon-hsp-combo.h>
@@ -35,6 +37,13 @@ struct aon_hsp {
 	struct completion emptied;
 	void (*full_notify)(void *data, u32 value);
 	void *pdata;
+	/* Doorbell coalescing, see tegra_aon_hsp_sm_tx_doorbell() */
+	spinlock_t db_lock;
+	bool db_inflight;
+	bool db_deferred;
+	u32 db_value;
+	ktime_t db_sent;
+	struct tegra_aon_hsp_stats stats;
 };
 
 static void aon_hsp_rx_full_notify(struct mbox_client *cl, void *data)
@@ -50,8 +59,41 @@ static void aon_hsp_tx_empty_notify(struct mbox_client *cl, void *data,
 {
 	struct aon_hsp *aonhsp = dev_get_drvdata(cl->dev);
 
+	u32 value = (u32) (unsigned long) data;
+	bool resend = false;
+	unsigned long flags;
+	u64 ns;
+
 	(void)empty_value;	/* ignored */
 
+	spin_lock_irqsave(&aonhsp->db_lock, flags);
+	if (aonhsp->db_inflight && value == aonhsp->db_value) {
+		ns = ktime_to_ns(ktime_sub(ktime_get(), aonhsp->db_sent));
+		aonhsp->stats.ack_lat_ns_total += ns;
+		if (ns > aonhsp->stats.ack_lat_ns_max)
+			aonhsp->stats.ack_lat_ns_max = ns;
+
+		/*
+		 * The remote may have read the semaphores before the
+		 * coalesced bits were set, so ring once more for them.
+		 */
+		if (aonhsp->db_deferred) {
+			aonhsp->db_deferred = false;
+			aonhsp->db_sent = ktime_get();
+			aonhsp->stats.doorbells++;
+			resend = true;
+		} else {
+			aonhsp->db_inflight = false;
+		}
+	}
+	spin_unlock_irqrestore(&aonhsp->db_lock, flags);
+
+	if (resend && mbox_send_message(aonhsp->tx.chan, data) < 0) {
+		spin_lock_irqsave(&aonhsp->db_lock, flags);
+		aonhsp->db_inflight = false;
+		spin_unlock_irqrestore(&aonhsp->db_lock, flags);
+	}
+
 	complete(&aonhsp->emptied);
 }
 
@@ -143,6 +185,7 @@ static struct aon_hsp *aon_hsp_create(struct device *dev,
 	aonhsp->pdata = pdata;
 
 	init_completion(&aonhsp->emptied);
+	spin_lock_init(&aonhsp->db_lock);
 
 	aonhsp->dev.type = &aon_hsp_combo_dev_type;
 	aonhsp->dev.release = aon_hsp_combo_dev_release;
@@ -187,6 +230,73 @@ int tegra_aon_hsp_sm_tx_write(struct tegra_aon *aon, u32 value)
 				 (void *) (unsigned long) value);
 }
 
+/*
+ * Rings the IVC doorbell. The channels to look at are already set in the
+ * tx shared semaphore, so while an earlier doorbell hasn't been read by
+ * the remote a new one carries no extra information. It's held back and
+ * sent once when the earlier one is read, which bounds the HSP traffic to
+ * two doorbells per remote wakeup whatever the message rate.
+ */
+int tegra_aon_hsp_sm_tx_doorbell(struct tegra_aon *aon, u32 value)
+{
+	struct aon_hsp *aonhsp = aon->hsp;
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&aonhsp->db_lock, flags);
+	if (aonhsp->db_inflight) {
+		aonhsp->db_deferred = true;
+		aonhsp->stats.coalesced++;
+		spin_unlock_irqrestore(&aonhsp->db_lock, flags);
+		return 0;
+	}
+	aonhsp->db_inflight = true;
+	aonhsp->db_value = value;
+	aonhsp->db_sent = ktime_get();
+	aonhsp->stats.doorbells++;
+	spin_unlock_irqrestore(&aonhsp->db_lock, flags);
+
+	ret = mbox_send_message(aonhsp->tx.chan,
+				(void *) (unsigned long) value);
+	if (ret < 0) {
+		spin_lock_irqsave(&aonhsp->db_lock, flags);
+		aonhsp->db_inflight = false;
+		spin_unlock_irqrestore(&aonhsp->db_lock, flags);
+		return ret;
+	}
+
+	return 0;
+}
+
+void tegra_aon_hsp_get_stats(struct tegra_aon *aon,
+			     struct tegra_aon_hsp_stats *stats)
+{
+	struct aon_hsp *aonhsp = aon->hsp;
+	unsigned long flags;
+
+	if (aonhsp == NULL) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	spin_lock_irqsave(&aonhsp->db_lock, flags);
+	*stats = aonhsp->stats;
+	spin_unlock_irqrestore(&aonhsp->db_lock, flags);
+}
+
+void tegra_aon_hsp_reset_stats(struct tegra_aon *aon)
+{
+	struct aon_hsp *aonhsp = aon->hsp;
+	unsigned long flags;
+
+	if (aonhsp == NULL)
+		return;
+
+	spin_lock_irqsave(&aonhsp->db_lock, flags);
+	memset(&aonhsp->stats, 0, sizeof(aonhsp->stats));
+	spin_unlock_irqrestore(&aonhsp->db_lock, flags);
+}
+
 int tegra_aon_hsp_sm_pair_request(struct tegra_aon *aon,
 				  void (*full_notify)(void *data, u32 value),
 				  void *pdata)
@@ -9,8 +9,13 @@
 #include <linux/types.h>
 
 struct tegra_aon;
+struct tegra_aon_hsp_stats;
 
 int tegra_aon_hsp_sm_tx_write(struct tegra_aon *aon, u32 value);
+int tegra_aon_hsp_sm_tx_doorbell(struct tegra_aon *aon, u32 value);
+void tegra_aon_hsp_get_stats(struct tegra_aon *aon,
+			     struct tegra_aon_hsp_stats *stats);
+void tegra_aon_hsp_reset_stats(struct tegra_aon *aon);
 int tegra_aon_hsp_sm_pair_request(struct tegra_aon *aon,
 				void (*full_notify)(void *data, u32 value),
 				void *pdata);
@@ -21,6 +21,39 @@ enum smbox_msgs {
 	SMBOX_IVC_NOTIFY = 0x0000AABB,
 };
 
+/**
+ * struct tegra_aon_mbox_chan_stats - Traffic counters of one IVC channel.
+ *
+ * rx latency is measured from the HSP doorbell to the client callback
+ * returning, per message.
+ */
+struct tegra_aon_mbox_chan_stats {
+	u64 tx_msgs;
+	u64 tx_bytes;
+	u64 tx_full;
+	u64 tx_batches;
+	u64 rx_msgs;
+	u64 rx_bytes;
+	u64 rx_batches;
+	u64 rx_batch_max;
+	u64 rx_lat_ns_total;
+	u64 rx_lat_ns_max;
+};
+
+/**
+ * struct tegra_aon_hsp_stats - Counters of the HSP doorbell shared by all
+ * IVC channels.
+ *
+ * A notify while the previous doorbell is still unread only sets its
+ * shared semaphore bit and is counted as coalesced.
+ */
+struct tegra_aon_hsp_stats {
+	u64 doorbells;
+	u64 coalesced;
+	u64 ack_lat_ns_total;
+	u64 ack_lat_ns_max;
+};
+
 /**
  * Declaration for struct aon_hsp that allows other structs to have a pointer
  * to it without having to define it
@@ -152,6 +185,10 @@ static inline void tegra_aon_debugfs_remove(struct tegra_aon *aon) { return; }
 
 int tegra_aon_reset(struct tegra_aon *aon);
 int tegra_aon_mail_init(struct tegra_aon *aon);
+int tegra_aon_mail_num_chans(void);
+const char *tegra_aon_mail_chan_name(int chan);
+void tegra_aon_mail_get_stats(int chan, struct tegra_aon_mbox_chan_stats *stats);
+void tegra_aon_mail_reset_stats(void);
 int tegra_aon_ipc_init(struct tegra_aon *aon);
 void tegra_aon_mail_deinit(struct tegra_aon *aon);
 int tegra_aon_ast_config(struct tegra_aon *aon);
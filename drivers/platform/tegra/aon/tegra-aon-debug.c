@@ -17,8 +17,10 @@
 #include <linux/completion.h>
 #include <linux/jiffies.h>
 #include <linux/firmware.h>
+#include <linux/math64.h>
 
 #include <aon.h>
+#include <aon-hsp-combo.h>
 
 #include "aon-ivc-dbg-messages.h"
 
@@ -349,6 +351,8 @@ static struct aon_dbg_response *aon_create_ivc_dbg_req(u32 request,
 		dev_err(aondbg->dev, "mbox_send_message failed\n");
 		return ERR_PTR(ret);
 	}
+	/* The frame is written by now, see <linux/tegra-aon.h> */
+	mbox_client_txdone(aondbg->mbox, 0);
 	timeout = get_completion_timeout();
 	ret = wait_for_completion_timeout(aon_nodes[req.req_type].wait_on,
 				msecs_to_jiffies(timeout));
@@ -696,6 +700,61 @@ static int aon_timeout_store(void *data, u64 val)
 DEFINE_SIMPLE_ATTRIBUTE(aon_timeout_fops, aon_timeout_show,
 			aon_timeout_store, "%lld\n");
 
+/*
+ * Per channel IVC traffic since the last reset, plus the shared HSP
+ * doorbell. Throughput is the difference between two reads. Writing
+ * anything resets the counters.
+ */
+static int aon_ivc_stats_show(struct seq_file *file, void *param)
+{
+	struct tegra_aon_mbox_chan_stats st;
+	struct tegra_aon_hsp_stats hst;
+	const char *name;
+	int i;
+
+	seq_puts(file, "channel tx_msgs tx_bytes tx_full tx_batches rx_msgs rx_bytes rx_batches rx_batch_max rx_lat_avg_ns rx_lat_max_ns\n");
+	for (i = 0; i < tegra_aon_mail_num_chans(); i++) {
+		name = tegra_aon_mail_chan_name(i);
+		tegra_aon_mail_get_stats(i, &st);
+		seq_printf(file, "%s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
+			   name ? name : "-", st.tx_msgs, st.tx_bytes,
+			   st.tx_full, st.tx_batches, st.rx_msgs, st.rx_bytes,
+			   st.rx_batches, st.rx_batch_max,
+			   st.rx_msgs ? div64_u64(st.rx_lat_ns_total, st.rx_msgs) : 0ULL,
+			   st.rx_lat_ns_max);
+	}
+
+	tegra_aon_hsp_get_stats(aondbg_dev.aon, &hst);
+	seq_printf(file, "hsp doorbells %llu coalesced %llu ack_lat_avg_ns %llu ack_lat_max_ns %llu\n",
+		   hst.doorbells, hst.coalesced,
+		   hst.doorbells ? div64_u64(hst.ack_lat_ns_total, hst.doorbells) : 0ULL,
+		   hst.ack_lat_ns_max);
+
+	return 0;
+}
+
+static int aon_ivc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, aon_ivc_stats_show, inode->i_private);
+}
+
+static ssize_t aon_ivc_stats_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	tegra_aon_mail_reset_stats();
+	tegra_aon_hsp_reset_stats(aondbg_dev.aon);
+
+	return count;
+}
+
+static const struct file_operations aon_ivc_stats_fops = {
+	.open = aon_ivc_stats_open,
+	.read = seq_read,
+	.write = aon_ivc_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release
+};
+
 static struct aon_dbgfs_node aon_nodes[] = {
 	{.name = "boot", .id = AON_BOOT, .pdr_id = AON_ROOT,
 			.mode = 0644, .fops = &aon_boot_fops, },
@@ -727,6 +786,8 @@ static struct aon_dbgfs_node aon_nodes[] = {
 			.mode = 0644, .fops = &aon_tag_fops,},
 	{.name = "completion_timeout", .pdr_id = AON_ROOT,
 			.mode = 0644, .fops = &aon_timeout_fops,},
+	{.name = "ivc_stats", .pdr_id = AON_ROOT,
+			.mode = 0644, .fops = &aon_ivc_stats_fops,},
 };
 
 static void tegra_aondbg_recv_msg(struct mbox_client *cl, void *rx_msg)
@@ -822,9 +883,9 @@ int tegra_aon_debugfs_create(struct tegra_aon *aon)
 	aondbg->dev = aon->dev;
 	aondbg->aon = aon;
 	aondbg->cl.dev = aon->dev;
-	aondbg->cl.tx_block = true;
+	aondbg->cl.tx_block = false;
 	aondbg->cl.tx_tout = TX_BLOCK_PERIOD;
-	aondbg->cl.knows_txdone = false;
+	aondbg->cl.knows_txdone = true;
 	aondbg->cl.rx_callback = tegra_aondbg_recv_msg;
 	aondbg->mbox = mbox_request_channel(&aondbg->cl, 0);
 	if (IS_ERR(aondbg->mbox)) {
@@ -13,6 +13,7 @@
 #include <linux/tegra-ivc-instance.h>
 #include <linux/tegra-aon.h>
 #include <linux/cache.h>
+#include <linux/ktime.h>
 
 #include <aon-hsp-combo.h>
 #include <aon.h>
@@ -29,6 +30,7 @@ struct tegra_aon_ivc_chan {
 	int chan_id;
 	struct tegra_aon *aon;
 	bool last_tx_done;
+	struct tegra_aon_mbox_chan_stats stats;
 };
 
 static struct tegra_aon_ivc aon_ivc;
@@ -83,9 +85,75 @@ static int tegra_aon_mbox_send_data(struct mbox_chan *mbox_chan, void *data)
 	}
 	ivc_chan->last_tx_done = (ret == 0);
 
+	if (ret == 0) {
+		ivc_chan->stats.tx_msgs++;
+		ivc_chan->stats.tx_bytes += msg->length;
+	} else {
+		ivc_chan->stats.tx_full++;
+	}
+
 	return ret;
 }
 
+/**
+ * tegra_aon_mbox_send_batch - Queues several messages on one IVC channel.
+ *
+ * The messages are written back to back into the IVC frames, bypassing the
+ * mailbox core which only moves one message per tx done tick. The remote
+ * is notified once, when the channel goes from empty to non-empty.
+ *
+ * @mbox_chan : Channel obtained with mbox_request_channel().
+ * @msgs : Messages to send, in order.
+ * @count : Number of messages.
+ *
+ * Return : Number of messages queued, fewer than @count if the channel
+ * filled up, or a negative error code. -EBUSY means messages sent through
+ * mbox_send_message() are still pending and nothing was queued.
+ */
+int tegra_aon_mbox_send_batch(struct mbox_chan *mbox_chan,
+			      const struct tegra_aon_mbox_msg *msgs,
+			      unsigned int count)
+{
+	struct tegra_aon_ivc_chan *ivc_chan;
+	unsigned long flags;
+	unsigned int i;
+	int bytes;
+	int ret = 0;
+
+	if (mbox_chan == NULL || msgs == NULL)
+		return -EINVAL;
+
+	ivc_chan = (struct tegra_aon_ivc_chan *)mbox_chan->con_priv;
+	if (ivc_chan == NULL || ivc_chan->chan_id == -1)
+		return -ENODEV;
+
+	/* Same lock the mailbox core holds around send_data */
+	spin_lock_irqsave(&mbox_chan->lock, flags);
+	if (mbox_chan->msg_count != 0U) {
+		spin_unlock_irqrestore(&mbox_chan->lock, flags);
+		return -EBUSY;
+	}
+
+	for (i = 0; i < count; i++) {
+		bytes = tegra_ivc_write(&ivc_chan->ivc, msgs[i].data,
+					msgs[i].length);
+		if (bytes != msgs[i].length) {
+			ivc_chan->stats.tx_full++;
+			if (i == 0 && bytes < 0)
+				ret = bytes;
+			break;
+		}
+		ivc_chan->stats.tx_msgs++;
+		ivc_chan->stats.tx_bytes += bytes;
+	}
+	if (i > 0)
+		ivc_chan->stats.tx_batches++;
+	spin_unlock_irqrestore(&mbox_chan->lock, flags);
+
+	return ret < 0 ? ret : (int)i;
+}
+EXPORT_SYMBOL_GPL(tegra_aon_mbox_send_batch);
+
 static int tegra_aon_mbox_startup(struct mbox_chan *mbox_chan)
 {
 	return 0;
@@ -122,15 +190,16 @@ static void tegra_aon_notify_remote(struct ivc *ivc)
 	ivc_chan = container_of(ivc, struct tegra_aon_ivc_chan, ivc);
 	tegra_aon_hsp_ss_set(ivc_chan->aon, ivc_chan->aon->ivc_tx_ss,
 				BIT(ivc_chan->chan_id));
-	tegra_aon_hsp_sm_tx_write(ivc_chan->aon, SMBOX_IVC_NOTIFY);
+	tegra_aon_hsp_sm_tx_doorbell(ivc_chan->aon, SMBOX_IVC_NOTIFY);
 }
 
-static void tegra_aon_rx_handler(u32 ivc_chans)
+static void tegra_aon_rx_handler(u32 ivc_chans, ktime_t doorbell)
 {
 	struct mbox_chan *mbox_chan;
 	struct ivc *ivc;
 	struct tegra_aon_ivc_chan *ivc_chan;
 	struct tegra_aon_mbox_msg msg;
+	u64 batch, ns;
 	int i;
 
 	ivc_chans &= BIT(aon_ivc.mbox.num_chans) - 1;
@@ -143,11 +212,25 @@ static void tegra_aon_rx_handler(u32 ivc_chans)
 		if (ivc_chan->chan_id == -1)
 			continue;
 		ivc = &ivc_chan->ivc;
+		batch = 0;
 		while (tegra_ivc_can_read(ivc)) {
 			msg.data = tegra_ivc_read_get_next_frame(ivc);
 			msg.length = ivc->frame_size;
 			mbox_chan_received_data(mbox_chan, &msg);
 			tegra_ivc_read_advance(ivc);
+
+			ns = ktime_to_ns(ktime_sub(ktime_get(), doorbell));
+			ivc_chan->stats.rx_lat_ns_total += ns;
+			if (ns > ivc_chan->stats.rx_lat_ns_max)
+				ivc_chan->stats.rx_lat_ns_max = ns;
+			ivc_chan->stats.rx_bytes += msg.length;
+			batch++;
+		}
+		if (batch) {
+			ivc_chan->stats.rx_msgs += batch;
+			ivc_chan->stats.rx_batches++;
+			if (batch > ivc_chan->stats.rx_batch_max)
+				ivc_chan->stats.rx_batch_max = batch;
 		}
 	}
 }
@@ -155,6 +238,7 @@ static void tegra_aon_rx_handler(u32 ivc_chans)
 static void tegra_aon_hsp_sm_full_notify(void *data, u32 value)
 {
 	struct tegra_aon *aon = data;
+	ktime_t doorbell = ktime_get();
 	u32 ss_val;
 
 	if (value != SMBOX_IVC_NOTIFY) {
@@ -164,7 +248,7 @@ static void tegra_aon_hsp_sm_full_notify(void *data, u32 value)
 
 	ss_val = tegra_aon_hsp_ss_status(aon, aon->ivc_rx_ss);
 	tegra_aon_hsp_ss_clr(aon, aon->ivc_rx_ss, ss_val);
-	tegra_aon_rx_handler(ss_val);
+	tegra_aon_rx_handler(ss_val, doorbell);
 }
 
 static int tegra_aon_parse_channel(struct tegra_aon *aon,
@@ -416,6 +500,52 @@ exit:
 	return ret;
 }
 
+int tegra_aon_mail_num_chans(void)
+{
+	return aon_ivc.mbox.num_chans;
+}
+
+const char *tegra_aon_mail_chan_name(int chan)
+{
+	struct tegra_aon_ivc_chan *ivc_chan;
+
+	if (chan < 0 || chan >= aon_ivc.mbox.num_chans)
+		return NULL;
+
+	ivc_chan = aon_ivc.mbox.chans[chan].con_priv;
+
+	return ivc_chan ? ivc_chan->name : NULL;
+}
+
+/*
+ * The counters are updated without a lock shared with this reader, so a
+ * snapshot taken under traffic may be slightly inconsistent.
+ */
+void tegra_aon_mail_get_stats(int chan, struct tegra_aon_mbox_chan_stats *stats)
+{
+	struct tegra_aon_ivc_chan *ivc_chan;
+
+	memset(stats, 0, sizeof(*stats));
+	if (chan < 0 || chan >= aon_ivc.mbox.num_chans)
+		return;
+
+	ivc_chan = aon_ivc.mbox.chans[chan].con_priv;
+	if (ivc_chan)
+		*stats = ivc_chan->stats;
+}
+
+void tegra_aon_mail_reset_stats(void)
+{
+	struct tegra_aon_ivc_chan *ivc_chan;
+	int i;
+
+	for (i = 0; i < aon_ivc.mbox.num_chans; i++) {
+		ivc_chan = aon_ivc.mbox.chans[i].con_priv;
+		if (ivc_chan)
+			memset(&ivc_chan->stats, 0, sizeof(ivc_chan->stats));
+	}
+}
+
 void tegra_aon_mail_deinit(struct tegra_aon *aon)
 {
 	mbox_controller_unregister(&aon_ivc.mbox);
@@ -536,8 +536,17 @@ out:
 	return ret;
 }
 
+/*
+ * Only the display RM channels are needed before RM bootstrap. The rest are
+ * created after boot is done so the first frame doesn't wait on them.
+ */
+static bool dce_admin_is_late_ipc(uint32_t ch_type)
+{
+	return ch_type == DCE_IPC_CH_KMD_TYPE_HDCP;
+}
+
 static int dce_admin_setup_clients_ipc(struct tegra_dce *d,
-		struct dce_ipc_message *msg)
+		struct dce_ipc_message *msg, bool late)
 {
 	uint32_t i;
 	int ret = 0;
@@ -556,6 +565,8 @@ static int dce_admin_setup_clients_ipc(struct tegra_dce *d,
 	for (i = 0; i < DCE_IPC_CH_KMD_TYPE_MAX; i++) {
 		if (i == DCE_IPC_CH_KMD_TYPE_ADMIN)
 			continue;
+		if (dce_admin_is_late_ipc(i) != late)
+			continue;
 		ret = dce_ipc_get_channel_info(d, &q_info, i);
 		if (ret) {
 			dce_info(d, "Get queue info failed for [%u]", i);
@@ -641,7 +652,7 @@ int dce_start_admin_seq(struct tegra_dce *d)
 		goto out;
 	}
 
-	ret = dce_admin_setup_clients_ipc(d, msg);
+	ret = dce_admin_setup_clients_ipc(d, msg, false);
 	if (ret) {
 		dce_err(d, "RPC failed for DCE_ADMIN_CMD_IPC_CREATE");
 		goto out;
@@ -659,3 +670,32 @@ out:
 		d->boot_status |= DCE_FW_ADMIN_SEQ_FAILED;
 	return ret;
 }
+
+/**
+ * dce_start_late_admin_seq - Creates the IPC channels deferred past boot.
+ *
+ * Called once dce_start_admin_seq() is done and display clients are
+ * unblocked. Clients of the late channels wait for DCE_FW_LATE_IPC_DONE.
+ *
+ * @d : Pointer to tegra_dce struct.
+ *
+ * Return : 0 if successful
+ */
+int dce_start_late_admin_seq(struct tegra_dce *d)
+{
+	int ret = 0;
+	struct dce_ipc_message *msg;
+
+	msg = dce_admin_allocate_message(d);
+	if (!msg)
+		return -1;
+
+	ret = dce_admin_setup_clients_ipc(d, msg, true);
+	if (ret)
+		dce_err(d, "RPC failed for late DCE_ADMIN_CMD_IPC_CREATE");
+	else
+		d->boot_status |= DCE_FW_LATE_IPC_DONE;
+
+	dce_admin_free_message(d, msg);
+	return ret;
+}
@@ -114,6 +114,7 @@ boot_done:
 	if (!ret) {
 		dce_set_boot_complete(d, true);
 		d->boot_status |= DCE_FW_EARLY_BOOT_DONE;
+		dce_boot_ts_mark(d, DCE_BOOT_TS_FW_READY);
 		dce_debug(d, "dce is ready to receive bootstrap commands");
 	} else {
 		d->boot_status |= DCE_FW_EARLY_BOOT_FAILED;
@@ -161,16 +162,30 @@ dce_start_boot_flow(struct tegra_dce *d)
 	ret = dce_start_admin_seq(d);
 	if (ret) {
 		dce_err(d, "DCE_BOOT_FAILED: Admin flow didn't complete");
-	} else {
-		d->boot_status |= DCE_FW_BOOT_DONE;
-		dce_info(d, "DCE_BOOT_DONE");
-		dce_cond_broadcast_interruptible(&d->dce_bootstrap_done);
+		goto exit;
 	}
 
+	d->boot_status |= DCE_FW_BOOT_DONE;
+	dce_boot_ts_mark(d, DCE_BOOT_TS_BOOT_DONE);
+	dce_info(d, "DCE_BOOT_DONE");
+	dce_cond_broadcast_interruptible(&d->dce_bootstrap_done);
+
+	/**
+	 * Display clients are running from here on. A failure to create
+	 * the late channels only affects their own clients.
+	 */
+	if (dce_start_late_admin_seq(d))
+		dce_err(d, "Late IPC channel setup failed");
+	else
+		dce_boot_ts_mark(d, DCE_BOOT_TS_LATE_IPC);
+	dce_cond_broadcast_interruptible(&d->dce_bootstrap_done);
+
 exit:
 	if (ret)
 		d->boot_status |= DCE_STATUS_FAILED;
 
+	dce_schedule_late_init(d);
+
 	return ret;
 }
 
@@ -190,6 +205,8 @@ void dce_bootstrap_work_fn(struct tegra_dce *d)
 		return;
 	}
 
+	dce_boot_ts_mark(d, DCE_BOOT_TS_BOOT_WORK);
+
 	ret = dce_fsm_post_event(d, EVENT_ID_DCE_FSM_START, NULL);
 	if (ret) {
 		dce_err(d, "FSM start failed\n");
@@ -855,6 +872,7 @@ int dce_start_bootstrap_flow(struct tegra_dce *d)
 	}
 
 	d->boot_status |= DCE_FW_BOOTSTRAP_DONE;
+	dce_boot_ts_mark(d, DCE_BOOT_TS_BOOTSTRAP);
 	return 0;
 
 err_sending:
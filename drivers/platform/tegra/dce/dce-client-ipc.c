@@ -3,6 +3,8 @@
  * Copyright (c) 2019-2023, NVIDIA CORPORATION & AFFILIATES.  All rights reserved.
  */
 
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <dce.h>
 #include <dce-ipc.h>
 #include <dce-util-common.h>
@@ -14,6 +16,25 @@
 
 static struct tegra_dce_client_ipc client_handles[DCE_CLIENT_IPC_TYPE_MAX];
 
+/**
+ * struct dce_client_ipc_async_msg - an async message of a client
+ *
+ * @node : entry in the inflight or backlog list of the client
+ * @msg : message passed by the client
+ * @done : completion callback passed by the client
+ * @ctx : context passed to @done
+ * @sent : time the request was written to the IPC channel
+ * @status : result passed to @done
+ */
+struct dce_client_ipc_async_msg {
+	struct list_head node;
+	struct dce_ipc_message *msg;
+	tegra_dce_client_ipc_done_t done;
+	void *ctx;
+	ktime_t sent;
+	int status;
+};
+
 static uint32_t dce_interface_type_map[DCE_CLIENT_IPC_TYPE_MAX] = {
 	[DCE_CLIENT_IPC_TYPE_CPU_RM] = DCE_IPC_TYPE_DISPRM,
 	[DCE_CLIENT_IPC_TYPE_HDCP_KMD] = DCE_IPC_TYPE_HDCP,
@@ -109,6 +130,151 @@ static int dce_client_ipc_handle_free(u32 handle)
 	return 0;
 }
 
+static void dce_client_ipc_rtt_record(struct tegra_dce *d, u32 type,
+				      ktime_t sent)
+{
+	struct tegra_dce_async_ipc_info *d_aipc = &d->d_async_ipc;
+	struct dce_client_ipc_rtt_stats *rtt = &d_aipc->rtt[type];
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), sent));
+	u64 us = ns / NSEC_PER_USEC;
+	u32 bucket = us ? ilog2(us) + 1U : 0U;
+	unsigned long flags;
+
+	if (bucket >= DCE_CLIENT_IPC_RTT_BUCKETS)
+		bucket = DCE_CLIENT_IPC_RTT_BUCKETS - 1U;
+
+	spin_lock_irqsave(&d_aipc->rtt_lock, flags);
+	if (rtt->count == 0U || ns < rtt->min_ns)
+		rtt->min_ns = ns;
+	if (ns > rtt->max_ns)
+		rtt->max_ns = ns;
+	rtt->total_ns += ns;
+	rtt->count++;
+	rtt->hist[bucket]++;
+	spin_unlock_irqrestore(&d_aipc->rtt_lock, flags);
+
+	if (type == DCE_CLIENT_IPC_TYPE_CPU_RM)
+		dce_boot_ts_mark(d, DCE_BOOT_TS_FIRST_RM_IPC);
+}
+
+void dce_client_ipc_rtt_get(struct tegra_dce *d, u32 type,
+			    struct dce_client_ipc_rtt_stats *stats)
+{
+	struct tegra_dce_async_ipc_info *d_aipc = &d->d_async_ipc;
+	unsigned long flags;
+
+	spin_lock_irqsave(&d_aipc->rtt_lock, flags);
+	*stats = d_aipc->rtt[type];
+	spin_unlock_irqrestore(&d_aipc->rtt_lock, flags);
+}
+
+void dce_client_ipc_rtt_reset(struct tegra_dce *d)
+{
+	struct tegra_dce_async_ipc_info *d_aipc = &d->d_async_ipc;
+	unsigned long flags;
+
+	spin_lock_irqsave(&d_aipc->rtt_lock, flags);
+	memset(d_aipc->rtt, 0, sizeof(d_aipc->rtt));
+	spin_unlock_irqrestore(&d_aipc->rtt_lock, flags);
+}
+
+static inline bool dce_client_ipc_async_is_idle(struct tegra_dce_client_ipc *cl)
+{
+	return atomic_read(&cl->async_pending) == 0;
+}
+
+static inline bool dce_client_ipc_is_free(struct tegra_dce_client_ipc *cl)
+{
+	return dce_client_ipc_async_is_idle(cl) && !READ_ONCE(cl->sync_busy);
+}
+
+/*
+ * Send queued messages while the channel has free frames. Messages that
+ * can not be sent are moved to @done with their error. Called with
+ * async_lock held.
+ */
+static void dce_client_ipc_async_kick(struct tegra_dce_client_ipc *cl,
+				      struct list_head *done)
+{
+	struct dce_client_ipc_async_msg *m;
+	int ret;
+
+	while (!cl->sync_busy && cl->async_nr_inflight < cl->async_window &&
+	       !list_empty(&cl->async_backlog)) {
+		m = list_first_entry(&cl->async_backlog,
+				     struct dce_client_ipc_async_msg, node);
+
+		/*
+		 * Account for the message before it is written, the response
+		 * may be signalled before dce_ipc_send_message() returns.
+		 */
+		list_move_tail(&m->node, &cl->async_inflight);
+		cl->async_nr_inflight++;
+		m->sent = ktime_get();
+
+		ret = dce_ipc_send_message(cl->d, cl->int_type, m->msg->tx.data,
+					   m->msg->tx.size);
+		if (ret) {
+			dce_err(cl->d, "Error in sending async message to DCE");
+			cl->async_nr_inflight--;
+			m->status = ret;
+			list_move_tail(&m->node, done);
+		}
+	}
+}
+
+static void dce_client_ipc_async_complete(struct tegra_dce_client_ipc *cl,
+					  struct list_head *done)
+{
+	struct dce_client_ipc_async_msg *m, *tmp;
+
+	list_for_each_entry_safe(m, tmp, done, node) {
+		list_del(&m->node);
+		m->done(cl->handle, m->status, m->msg, m->ctx);
+		dce_kfree(cl->d, m);
+
+		if (atomic_dec_and_test(&cl->async_pending))
+			dce_cond_broadcast_interruptible(&cl->async_idle);
+	}
+}
+
+/*
+ * Responses come back in request order, so each one pending on the
+ * channel completes the oldest inflight message.
+ */
+static void dce_client_ipc_async_rx_work(struct work_struct *work)
+{
+	struct tegra_dce_client_ipc *cl =
+		container_of(work, struct tegra_dce_client_ipc, async_rx_work);
+	struct dce_client_ipc_async_msg *m;
+	struct tegra_dce *d = cl->d;
+	LIST_HEAD(done);
+
+	dce_mutex_lock(&cl->async_lock);
+
+	while (!list_empty(&cl->async_inflight) &&
+	       dce_ipc_is_data_available(d, cl->int_type)) {
+		m = list_first_entry(&cl->async_inflight,
+				     struct dce_client_ipc_async_msg, node);
+		list_move_tail(&m->node, &done);
+		cl->async_nr_inflight--;
+
+		m->status = dce_ipc_read_message(d, cl->int_type,
+						 m->msg->rx.data, m->msg->rx.size);
+		if (m->status)
+			dce_err(d, "Error in reading DCE msg for ch_type [%d]",
+				cl->int_type);
+		else
+			dce_client_ipc_rtt_record(d, cl->type, m->sent);
+	}
+
+	dce_client_ipc_async_kick(cl, &done);
+
+	dce_mutex_unlock(&cl->async_lock);
+
+	dce_client_ipc_async_complete(cl, &done);
+}
+
 static void dce_client_async_event_work(struct work_struct *data)
 {
 	struct tegra_dce_client_ipc *cl;
@@ -122,6 +288,18 @@ static void dce_client_async_event_work(struct work_struct *data)
 	atomic_set(&work->in_use, 0);
 }
 
+/*
+ * HDCP's channel is created after boot is done, see
+ * dce_start_late_admin_seq().
+ */
+static bool dce_client_ipc_channel_ready(struct tegra_dce *d, u32 int_type)
+{
+	if (int_type == DCE_IPC_TYPE_HDCP)
+		return dce_is_late_ipc_done(d);
+
+	return dce_is_bootstrap_done(d);
+}
+
 int tegra_dce_register_ipc_client(u32 type,
 		tegra_dce_client_ipc_callback_t callback_fn,
 		void *data, u32 *handlep)
@@ -157,7 +335,7 @@ int tegra_dce_register_ipc_client(u32 type,
 	 */
 #define DCE_IPC_REGISTER_BOOT_WAIT	(30U * 1000)
 	ret = DCE_COND_WAIT_INTERRUPTIBLE_TIMEOUT(&d->dce_bootstrap_done,
-						  dce_is_bootstrap_done(d),
+						  dce_client_ipc_channel_ready(d, int_type),
 						  DCE_IPC_REGISTER_BOOT_WAIT);
 	if (ret) {
 		dce_info(d, "dce boot wait failed (%d)\n", ret);
@@ -185,6 +363,33 @@ int tegra_dce_register_ipc_client(u32 type,
 		goto out;
 	}
 
+	ret = dce_cond_init(&cl->async_idle);
+	if (ret) {
+		dce_err(d, "dce condition initialization failed for int_type: [%u]",
+			int_type);
+		dce_cond_destroy(&cl->recv_wait);
+		goto out;
+	}
+
+	ret = dce_mutex_init(&cl->async_lock);
+	if (ret) {
+		dce_cond_destroy(&cl->async_idle);
+		dce_cond_destroy(&cl->recv_wait);
+		goto out;
+	}
+
+	INIT_LIST_HEAD(&cl->async_inflight);
+	INIT_LIST_HEAD(&cl->async_backlog);
+	INIT_WORK(&cl->async_rx_work, dce_client_ipc_async_rx_work);
+	cl->async_nr_inflight = 0U;
+	atomic_set(&cl->async_pending, 0);
+	cl->sync_busy = false;
+
+	/* As many requests can be outstanding as the channel has frames */
+	cl->async_window = 1U;
+	if (int_type < DCE_IPC_CH_KMD_TYPE_MAX && d->d_ipc.ch[int_type] != NULL)
+		cl->async_window = max_t(u32, d->d_ipc.ch[int_type]->q_info.nframes, 1U);
+
 	d->d_clients[type] = cl;
 
 out:
@@ -208,6 +413,14 @@ int tegra_dce_unregister_ipc_client(u32 handle)
 		return -EINVAL;
 	}
 
+	if (cl->valid && cl->d != NULL) {
+		/* Let outstanding messages complete before the client goes */
+		DCE_COND_WAIT(&cl->async_idle, dce_client_ipc_async_is_idle(cl));
+		cancel_work_sync(&cl->async_rx_work);
+		dce_mutex_destroy(&cl->async_lock);
+		dce_cond_destroy(&cl->async_idle);
+	}
+
 	dce_cond_destroy(&cl->recv_wait);
 
 	return dce_client_ipc_handle_free(handle);
@@ -217,6 +430,8 @@ EXPORT_SYMBOL(tegra_dce_unregister_ipc_client);
 int tegra_dce_client_ipc_send_recv(u32 handle, struct dce_ipc_message *msg)
 {
 	int ret;
+	bool kick;
+	ktime_t sent;
 	struct tegra_dce_client_ipc *cl;
 
 	if (msg == NULL) {
@@ -230,13 +445,124 @@ int tegra_dce_client_ipc_send_recv(u32 handle, struct dce_ipc_message *msg)
 		goto out;
 	}
 
+	/*
+	 * A synchronous round trip owns the channel, wait until no async
+	 * message is pending. Async sends meanwhile are queued.
+	 */
+	do {
+		ret = DCE_COND_WAIT_INTERRUPTIBLE(&cl->async_idle,
+				dce_client_ipc_is_free(cl));
+		if (ret)
+			goto out;
+
+		dce_mutex_lock(&cl->async_lock);
+		if (dce_client_ipc_is_free(cl)) {
+			WRITE_ONCE(cl->sync_busy, true);
+			dce_mutex_unlock(&cl->async_lock);
+			break;
+		}
+		dce_mutex_unlock(&cl->async_lock);
+	} while (true);
+
+	sent = ktime_get();
 	ret = dce_ipc_send_message_sync(cl->d, cl->int_type, msg);
+	if (ret == 0)
+		dce_client_ipc_rtt_record(cl->d, cl->type, sent);
+
+	dce_mutex_lock(&cl->async_lock);
+	WRITE_ONCE(cl->sync_busy, false);
+	kick = !list_empty(&cl->async_backlog);
+	dce_mutex_unlock(&cl->async_lock);
+
+	if (kick)
+		queue_work(cl->d->d_async_ipc.async_event_wq, &cl->async_rx_work);
+	dce_cond_broadcast_interruptible(&cl->async_idle);
 
 out:
 	return ret;
 }
 EXPORT_SYMBOL(tegra_dce_client_ipc_send_recv);
 
+static int dce_client_ipc_queue_async(struct tegra_dce_client_ipc *cl,
+		struct dce_ipc_message *msgs, u32 count,
+		tegra_dce_client_ipc_done_t done, void *usr_ctx)
+{
+	struct dce_client_ipc_async_msg *m, *tmp;
+	LIST_HEAD(queue);
+	LIST_HEAD(failed);
+	u32 i;
+
+	for (i = 0U; i < count; i++) {
+		m = dce_kzalloc(cl->d, sizeof(*m), false);
+		if (m == NULL)
+			goto free;
+
+		m->msg = &msgs[i];
+		m->done = done;
+		m->ctx = usr_ctx;
+		list_add_tail(&m->node, &queue);
+	}
+
+	dce_mutex_lock(&cl->async_lock);
+	atomic_add(count, &cl->async_pending);
+	list_splice_tail(&queue, &cl->async_backlog);
+	dce_client_ipc_async_kick(cl, &failed);
+	dce_mutex_unlock(&cl->async_lock);
+
+	dce_client_ipc_async_complete(cl, &failed);
+
+	return 0;
+
+free:
+	list_for_each_entry_safe(m, tmp, &queue, node) {
+		list_del(&m->node);
+		dce_kfree(cl->d, m);
+	}
+
+	return -ENOMEM;
+}
+
+int tegra_dce_client_ipc_send_async(u32 handle, struct dce_ipc_message *msg,
+		tegra_dce_client_ipc_done_t done, void *usr_ctx)
+{
+	return tegra_dce_client_ipc_send_batch(handle, msg, 1U, done, usr_ctx);
+}
+EXPORT_SYMBOL(tegra_dce_client_ipc_send_async);
+
+int tegra_dce_client_ipc_send_batch(u32 handle, struct dce_ipc_message *msgs,
+		u32 count, tegra_dce_client_ipc_done_t done, void *usr_ctx)
+{
+	struct tegra_dce_client_ipc *cl;
+
+	if (msgs == NULL || done == NULL || count == 0U ||
+	    count > DCE_CLIENT_IPC_MAX_BATCH)
+		return -EINVAL;
+
+	cl = dce_client_ipc_lookup_handle(handle);
+	if (cl == NULL || cl->valid == false || cl->d == NULL)
+		return -EINVAL;
+
+	/* The event channel only carries notifications from DCE */
+	if (cl->type == DCE_CLIENT_IPC_TYPE_RM_EVENT)
+		return -EINVAL;
+
+	return dce_client_ipc_queue_async(cl, msgs, count, done, usr_ctx);
+}
+EXPORT_SYMBOL(tegra_dce_client_ipc_send_batch);
+
+int tegra_dce_client_ipc_flush(u32 handle)
+{
+	struct tegra_dce_client_ipc *cl;
+
+	cl = dce_client_ipc_lookup_handle(handle);
+	if (cl == NULL || cl->valid == false || cl->d == NULL)
+		return -EINVAL;
+
+	return DCE_COND_WAIT_INTERRUPTIBLE(&cl->async_idle,
+			dce_client_ipc_async_is_idle(cl));
+}
+EXPORT_SYMBOL(tegra_dce_client_ipc_flush);
+
 int dce_client_init(struct tegra_dce *d)
 {
 	int ret = 0;
@@ -246,6 +572,9 @@ int dce_client_init(struct tegra_dce *d)
 	d_aipc->async_event_wq =
 		create_singlethread_workqueue("dce-async-ipc-wq");
 
+	spin_lock_init(&d_aipc->rtt_lock);
+	memset(d_aipc->rtt, 0, sizeof(d_aipc->rtt));
+
 	for (i = 0; i < DCE_MAX_ASYNC_WORK; i++) {
 		struct dce_async_work *d_work = &d_aipc->work[i];
 
@@ -377,6 +706,12 @@ void dce_client_ipc_wakeup(struct tegra_dce *d, u32 ch_type)
 	if (type == DCE_CLIENT_IPC_TYPE_RM_EVENT)
 		return dce_client_schedule_event_work(d);
 
+	/* Responses to async messages are read by the client's rx work */
+	if (!READ_ONCE(cl->sync_busy)) {
+		queue_work(d->d_async_ipc.async_event_wq, &cl->async_rx_work);
+		return;
+	}
+
 	atomic_set(&cl->complete, 1);
 	dce_cond_signal_interruptible(&cl->recv_wait);
 }
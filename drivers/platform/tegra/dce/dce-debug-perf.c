@@ -2,6 +2,7 @@
 // SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
 
 #include <linux/errno.h>
+#include <linux/math64.h>
 #include <linux/debugfs.h>
 #include <linux/uaccess.h>
 #include <dce.h>
@@ -523,3 +524,155 @@ int dbg_dce_perf_events_events_fops_open(struct inode *inode,
 	return single_open(file, dbg_dce_perf_events_events_fops_show,
 			   inode->i_private);
 }
+
+/*
+ * Debugfs nodes for the round trip times of client IPC messages, measured
+ * by the CPU driver from writing the request to reading the response.
+ * Writing anything clears them.
+ */
+static const char * const dce_perf_ipc_client_names[DCE_CLIENT_IPC_TYPE_MAX] = {
+	[DCE_CLIENT_IPC_TYPE_CPU_RM] = "cpu_rm",
+	[DCE_CLIENT_IPC_TYPE_HDCP_KMD] = "hdcp_kmd",
+	[DCE_CLIENT_IPC_TYPE_RM_EVENT] = "rm_event",
+};
+
+static void dbg_dce_perf_ipc_rtt_show_csv(struct seq_file *s,
+					  const struct dce_client_ipc_rtt_stats *rtt,
+					  uint32_t type)
+{
+	uint32_t i;
+
+	seq_printf(s, "\"%s\",\"%llu\",\"%llu\",\"%llu\",\"%llu\"",
+		   dce_perf_ipc_client_names[type], rtt->count, rtt->min_ns,
+		   rtt->count ? div64_u64(rtt->total_ns, rtt->count) : 0ULL,
+		   rtt->max_ns);
+	for (i = 0U; i < DCE_CLIENT_IPC_RTT_BUCKETS; i++)
+		seq_printf(s, ",\"%llu\"", rtt->hist[i]);
+	seq_puts(s, "\n");
+}
+
+static void dbg_dce_perf_ipc_rtt_show_xml(struct seq_file *s,
+					  const struct dce_client_ipc_rtt_stats *rtt,
+					  uint32_t type)
+{
+	uint32_t i;
+
+	seq_printf(s, "<client><name>%s</name><count>%llu</count>",
+		   dce_perf_ipc_client_names[type], rtt->count);
+	seq_printf(s, "<min>%llu</min><avg>%llu</avg><max>%llu</max>\n",
+		   rtt->min_ns,
+		   rtt->count ? div64_u64(rtt->total_ns, rtt->count) : 0ULL,
+		   rtt->max_ns);
+	for (i = 0U; i < DCE_CLIENT_IPC_RTT_BUCKETS; i++)
+		seq_printf(s, "<bucket><le_us>%llu</le_us><count>%llu</count></bucket>\n",
+			   (1ULL << i), rtt->hist[i]);
+	seq_puts(s, "</client>\n");
+}
+
+static int dbg_dce_perf_ipc_rtt_fops_show(struct seq_file *s, void *data)
+{
+	struct dce_client_ipc_rtt_stats rtt;
+	struct tegra_dce *d = (struct tegra_dce *)s->private;
+	uint32_t type, i;
+
+	if (perf_output_format == DCE_PERF_OUTPUT_FORMAT_CSV) {
+		seq_puts(s, "\"client\",\"count\",\"min_ns\",\"avg_ns\",\"max_ns\"");
+		for (i = 0U; i < DCE_CLIENT_IPC_RTT_BUCKETS; i++)
+			seq_printf(s, ",\"le_%lluus\"", (1ULL << i));
+		seq_puts(s, "\n");
+	} else {
+		seq_puts(s, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+		seq_puts(s, "<IpcRttData>\n");
+	}
+
+	for (type = 0U; type < DCE_CLIENT_IPC_TYPE_MAX; type++) {
+		/* The event channel has no requests to time */
+		if (type == DCE_CLIENT_IPC_TYPE_RM_EVENT)
+			continue;
+
+		dce_client_ipc_rtt_get(d, type, &rtt);
+
+		if (perf_output_format == DCE_PERF_OUTPUT_FORMAT_CSV)
+			dbg_dce_perf_ipc_rtt_show_csv(s, &rtt, type);
+		else
+			dbg_dce_perf_ipc_rtt_show_xml(s, &rtt, type);
+	}
+
+	if (perf_output_format != DCE_PERF_OUTPUT_FORMAT_CSV)
+		seq_puts(s, "</IpcRttData>\n");
+
+	return 0;
+}
+
+int dbg_dce_perf_ipc_rtt_fops_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dbg_dce_perf_ipc_rtt_fops_show,
+			   inode->i_private);
+}
+
+ssize_t dbg_dce_perf_ipc_rtt_fops_write(struct file *file,
+					const char __user *user_buf,
+					size_t count, loff_t *ppos)
+{
+	struct tegra_dce *d = ((struct seq_file *)file->private_data)->private;
+
+	dce_client_ipc_rtt_reset(d);
+
+	return count;
+}
+
+/*
+ * Debugfs node for the boot phase timestamps, as CLOCK_MONOTONIC time and
+ * time since probe. Phases not reached yet are left out.
+ */
+static const char * const dce_perf_boot_phase_names[DCE_BOOT_TS_MAX] = {
+	[DCE_BOOT_TS_PROBE] = "probe",
+	[DCE_BOOT_TS_BOOT_WORK] = "boot_work",
+	[DCE_BOOT_TS_FW_READY] = "fw_ready",
+	[DCE_BOOT_TS_BOOTSTRAP] = "bootstrap",
+	[DCE_BOOT_TS_BOOT_DONE] = "boot_done",
+	[DCE_BOOT_TS_LATE_IPC] = "late_ipc",
+	[DCE_BOOT_TS_DEBUGFS] = "debugfs",
+	[DCE_BOOT_TS_FIRST_RM_IPC] = "first_rm_ipc",
+};
+
+static int dbg_dce_perf_boot_fops_show(struct seq_file *s, void *data)
+{
+	struct tegra_dce *d = (struct tegra_dce *)s->private;
+	u64 probe_ns = READ_ONCE(d->boot_ts_ns[DCE_BOOT_TS_PROBE]);
+	uint32_t phase;
+	u64 ts_ns;
+
+	if (perf_output_format == DCE_PERF_OUTPUT_FORMAT_CSV) {
+		seq_puts(s, "\"phase\",\"timestamp_ns\",\"since_probe_ns\"\n");
+	} else {
+		seq_puts(s, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+		seq_puts(s, "<BootPhaseData>\n");
+	}
+
+	for (phase = 0U; phase < DCE_BOOT_TS_MAX; phase++) {
+		ts_ns = READ_ONCE(d->boot_ts_ns[phase]);
+		if (ts_ns == 0U)
+			continue;
+
+		if (perf_output_format == DCE_PERF_OUTPUT_FORMAT_CSV)
+			seq_printf(s, "\"%s\",\"%llu\",\"%llu\"\n",
+				   dce_perf_boot_phase_names[phase], ts_ns,
+				   ts_ns - probe_ns);
+		else
+			seq_printf(s, "<phase><name>%s</name><timestamp_ns>%llu</timestamp_ns><since_probe_ns>%llu</since_probe_ns></phase>\n",
+				   dce_perf_boot_phase_names[phase], ts_ns,
+				   ts_ns - probe_ns);
+	}
+
+	if (perf_output_format != DCE_PERF_OUTPUT_FORMAT_CSV)
+		seq_puts(s, "</BootPhaseData>\n");
+
+	return 0;
+}
+
+int dbg_dce_perf_boot_fops_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dbg_dce_perf_boot_fops_show,
+			   inode->i_private);
+}
@@ -544,6 +544,9 @@ core_boot_done:
 	last_status = DCE_BIT(find_first_bit(&bitmap, 32));
 
 	switch (last_status) {
+	case DCE_FW_LATE_IPC_DONE:
+		strcpy(buf, "DCE_FW_LATE_IPC_DONE");
+		break;
 	case DCE_FW_SUSPENDED:
 		strcpy(buf, "DCE_FW_SUSPENDED");
 		break;
@@ -643,6 +646,21 @@ static const struct file_operations perf_events_help_fops = {
 	.release	= single_release,
 };
 
+static const struct file_operations perf_ipc_rtt_fops = {
+	.open		= dbg_dce_perf_ipc_rtt_fops_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= dbg_dce_perf_ipc_rtt_fops_write,
+};
+
+static const struct file_operations perf_boot_fops = {
+	.open		= dbg_dce_perf_boot_fops_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void dce_remove_debug(struct tegra_dce *d)
 {
 	struct dce_device *d_dev = dce_device_from_dce(d);
@@ -775,6 +793,11 @@ void dce_init_debug(struct tegra_dce *d)
 	if (!retval)
 		goto err_handle;
 
+	retval = debugfs_create_file("boot", 0444,
+				     perf_debugfs_dir, d, &perf_boot_fops);
+	if (!retval)
+		goto err_handle;
+
 	debugfs_dir = debugfs_create_dir("stats", perf_debugfs_dir);
 	if (!debugfs_dir)
 		goto err_handle;
@@ -803,6 +826,15 @@ void dce_init_debug(struct tegra_dce *d)
 	if (!retval)
 		goto err_handle;
 
+	debugfs_dir = debugfs_create_dir("ipc", perf_debugfs_dir);
+	if (!debugfs_dir)
+		goto err_handle;
+
+	retval = debugfs_create_file("rtt", 0644,
+				     debugfs_dir, d, &perf_ipc_rtt_fops);
+	if (!retval)
+		goto err_handle;
+
 	retval = debugfs_create_file("dump_hsp_regs", 0444,
 				     d_dev->debugfs, d, &dump_hsp_regs_fops);
 	if (!retval)
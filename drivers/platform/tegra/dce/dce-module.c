@@ -171,6 +171,44 @@ static int dce_req_interrupts(struct platform_device *pdev)
 	return ret;
 }
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Debugfs isn't needed for the first frame, so it's created once boot is done.
+ * The timeout still brings it up when boot hangs, to debug just that.
+ */
+#define DCE_DEBUGFS_INIT_TIMEOUT_MS	10000U
+
+static void dce_debugfs_work_fn(struct work_struct *work)
+{
+	struct dce_device *d_dev = container_of(to_delayed_work(work),
+						struct dce_device,
+						debugfs_work);
+	struct tegra_dce *d = &d_dev->d;
+
+	if (d_dev->debugfs != NULL)
+		return;
+
+	dce_init_debug(d);
+	dce_boot_ts_mark(d, DCE_BOOT_TS_DEBUGFS);
+}
+#endif
+
+/**
+ * dce_schedule_late_init - Runs the init deferred until boot is done.
+ *
+ * @d : Pointer to tegra_dce struct.
+ *
+ * Return : void
+ */
+void dce_schedule_late_init(struct tegra_dce *d)
+{
+#ifdef CONFIG_DEBUG_FS
+	struct dce_device *d_dev = dce_device_from_dce(d);
+
+	mod_delayed_work(system_wq, &d_dev->debugfs_work, 0);
+#endif
+}
+
 static int match_display_dev(struct device *dev, const void *data)
 {
 	if ((dev != NULL) && (dev->of_node != NULL)) {
@@ -221,12 +259,19 @@ static int tegra_dce_probe(struct platform_device *pdev)
 	}
 
 	d = dce_get_pdata_dce(pdev);
+	dce_boot_ts_mark(d, DCE_BOOT_TS_PROBE);
 
 	/**
 	 * TODO: Get HSP_ID from DT
 	 */
 	d->hsp_id = pdata->hsp_id;
 
+#ifdef CONFIG_DEBUG_FS
+	INIT_DELAYED_WORK(&dce_device_from_dce(d)->debugfs_work,
+			  dce_debugfs_work_fn);
+	schedule_delayed_work(&dce_device_from_dce(d)->debugfs_work,
+			      msecs_to_jiffies(DCE_DEBUGFS_INIT_TIMEOUT_MS));
+#endif
 
 	err = dce_driver_init(d);
 	if (err) {
@@ -236,10 +281,6 @@ static int tegra_dce_probe(struct platform_device *pdev)
 
 	dce_set_irqs(pdev, true);
 
-#ifdef CONFIG_DEBUG_FS
-	dce_init_debug(d);
-#endif
-
 	c_dev = bus_find_device(&platform_bus_type, NULL, NULL, match_display_dev);
 	if (c_dev != NULL) {
 		dce_info(d, "Found display consumer device");
@@ -247,7 +288,8 @@ static int tegra_dce_probe(struct platform_device *pdev)
 				       DL_FLAG_PM_RUNTIME | DL_FLAG_AUTOREMOVE_SUPPLIER);
 		if (link == NULL) {
 			dce_err(d, "Failed to create device link to %s\n", dev_name(c_dev));
-			return -EINVAL;
+			err = -EINVAL;
+			goto err_driver_init;
 		}
 	}
 
@@ -265,6 +307,10 @@ req_intr_err:
 os_init_err:
 err_get_pdata:
 err_driver_init:
+#ifdef CONFIG_DEBUG_FS
+	if (d != NULL)
+		cancel_delayed_work_sync(&dce_device_from_dce(d)->debugfs_work);
+#endif
 	return err;
 }
 
@@ -275,6 +321,7 @@ static int tegra_dce_remove(struct platform_device *pdev)
 			dce_get_pdata_dce(pdev);
 
 #ifdef CONFIG_DEBUG_FS
+	cancel_delayed_work_sync(&dce_device_from_dce(d)->debugfs_work);
 	dce_remove_debug(d);
 #endif
 
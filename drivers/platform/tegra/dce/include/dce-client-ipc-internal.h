@@ -6,7 +6,12 @@
 #ifndef DCE_CLIENT_IPC_INTERNAL_H
 #define DCE_CLIENT_IPC_INTERNAL_H
 
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <linux/platform/tegra/dce/dce-client-ipc.h>
+#include <dce-cond.h>
+#include <dce-lock.h>
 
 /**
  * struct tegra_dce_client_ipc - Data Structure to hold client specific ipc
@@ -24,6 +29,16 @@
  * @complete : atomic variable used for IPC synchronization
  * @callback_fn : function pointer to the callback function passed by the
  *                client during registration
+ * @async_lock : protects the async message lists and counters
+ * @async_inflight : async messages sent to DCE, oldest first
+ * @async_backlog : async messages waiting for a free IPC frame
+ * @async_nr_inflight : number of messages on @async_inflight
+ * @async_pending : async messages whose callback did not run yet
+ * @async_window : number of messages that can be outstanding at DCE
+ * @sync_busy : a synchronous send_recv owns the channel
+ * @async_idle : signalled when no async message is left or a synchronous
+ *               send_recv finished
+ * @async_rx_work : reads responses and completes async messages
  */
 struct tegra_dce_client_ipc {
 	bool valid;
@@ -35,6 +50,31 @@ struct tegra_dce_client_ipc {
 	struct dce_cond recv_wait;
 	atomic_t complete;
 	tegra_dce_client_ipc_callback_t callback_fn;
+	struct dce_mutex async_lock;
+	struct list_head async_inflight;
+	struct list_head async_backlog;
+	u32 async_nr_inflight;
+	atomic_t async_pending;
+	u32 async_window;
+	bool sync_busy;
+	struct dce_cond async_idle;
+	struct work_struct async_rx_work;
+};
+
+/* log2 buckets of round trip times, the first one up to 1us */
+#define DCE_CLIENT_IPC_RTT_BUCKETS	16U
+
+/**
+ * struct dce_client_ipc_rtt_stats - round trip times of client messages,
+ *				from writing the request to reading the
+ *				response
+ */
+struct dce_client_ipc_rtt_stats {
+	u64 count;
+	u64 min_ns;
+	u64 max_ns;
+	u64 total_ns;
+	u64 hist[DCE_CLIENT_IPC_RTT_BUCKETS];
 };
 
 #define DCE_MAX_ASYNC_WORK	8
@@ -46,10 +86,14 @@ struct dce_async_work {
 
 /**
  * @async_event_wq - Workqueue to process async events from DCE
+ * @rtt_lock - protects @rtt
+ * @rtt - per client type round trip times, kept across registrations
  */
 struct tegra_dce_async_ipc_info {
 	struct workqueue_struct *async_event_wq;
 	struct dce_async_work work[DCE_MAX_ASYNC_WORK];
+	spinlock_t rtt_lock;
+	struct dce_client_ipc_rtt_stats rtt[DCE_CLIENT_IPC_TYPE_MAX];
 };
 
 void dce_client_ipc_wakeup(struct tegra_dce *d,	u32 ch_type);
@@ -58,6 +102,11 @@ int dce_client_ipc_wait(struct tegra_dce *d, u32 ch_type);
 
 int dce_client_init(struct tegra_dce *d);
 
+void dce_client_ipc_rtt_get(struct tegra_dce *d, u32 type,
+			    struct dce_client_ipc_rtt_stats *stats);
+
+void dce_client_ipc_rtt_reset(struct tegra_dce *d);
+
 void dce_client_deinit(struct tegra_dce *d);
 
 #endif
@@ -30,4 +30,11 @@ ssize_t dbg_dce_perf_events_events_fops_write(struct file *file,
 					      size_t count, loff_t *ppos);
 int dbg_dce_perf_events_help_fops_open(struct inode *inode,
 				      struct file *file);
+
+int dbg_dce_perf_ipc_rtt_fops_open(struct inode *inode, struct file *file);
+ssize_t dbg_dce_perf_ipc_rtt_fops_write(struct file *file,
+					const char __user *user_buf,
+					size_t count, loff_t *ppos);
+
+int dbg_dce_perf_boot_fops_open(struct inode *inode, struct file *file);
 #endif
@@ -7,7 +7,9 @@
 #define TEGRA_DCE_H
 
 #include <linux/cdev.h>
+#include <linux/ktime.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 #include <dce-log.h>
 #include <dce-ipc.h>
 #include <dce-hsp.h>
@@ -48,11 +50,37 @@
 #define DCE_FW_ADMIN_SEQ_START		DCE_BIT(10)
 #define DCE_FW_ADMIN_SEQ_FAILED		DCE_BIT(9)
 #define DCE_FW_ADMIN_SEQ_DONE		DCE_BIT(8)
+#define DCE_FW_LATE_IPC_DONE		DCE_BIT(3)
 #define DCE_FW_SUSPENDED		DCE_BIT(2)
 #define DCE_FW_BOOT_DONE		DCE_BIT(1)
 #define DCE_STATUS_FAILED		DCE_BIT(0)
 #define DCE_STATUS_UNKNOWN		((u32)(0))
 
+/**
+ * DCE Boot Phases : Timestamped once, on the first boot after probe, so the
+ * time to the first display IPC can be measured. SC7 exits don't update them.
+ *
+ * @DCE_BOOT_TS_PROBE : Driver probe entered
+ * @DCE_BOOT_TS_BOOT_WORK : Bootstrap work started running
+ * @DCE_BOOT_TS_FW_READY : Firmware signalled boot complete
+ * @DCE_BOOT_TS_BOOTSTRAP : Mailbox bootstrap commands done
+ * @DCE_BOOT_TS_BOOT_DONE : Admin sequence done, display clients unblocked
+ * @DCE_BOOT_TS_LATE_IPC : Deferred non-display IPC channels created
+ * @DCE_BOOT_TS_DEBUGFS : Debugfs nodes created
+ * @DCE_BOOT_TS_FIRST_RM_IPC : First display RM IPC response received
+ */
+enum dce_boot_ts_phase {
+	DCE_BOOT_TS_PROBE = 0,
+	DCE_BOOT_TS_BOOT_WORK,
+	DCE_BOOT_TS_FW_READY,
+	DCE_BOOT_TS_BOOTSTRAP,
+	DCE_BOOT_TS_BOOT_DONE,
+	DCE_BOOT_TS_LATE_IPC,
+	DCE_BOOT_TS_DEBUGFS,
+	DCE_BOOT_TS_FIRST_RM_IPC,
+	DCE_BOOT_TS_MAX
+};
+
 struct tegra_dce;
 
 /**
@@ -208,6 +236,11 @@ struct tegra_dce {
 	 * @fw_data - Stores info regardign firmware to be used runtime.
 	 */
 	struct dce_firmware *fw_data;
+	/**
+	 * @boot_ts_ns - CLOCK_MONOTONIC time of each boot phase, 0 if the
+	 * phase hasn't been reached yet.
+	 */
+	u64 boot_ts_ns[DCE_BOOT_TS_MAX];
 };
 
 /**
@@ -248,6 +281,11 @@ struct dce_device {
 	 * debugfs
 	 */
 	s32 ext_test_status;
+	/**
+	 * @debugfs_work : Creates the debugfs nodes once boot is done, or
+	 * after a timeout if it never completes.
+	 */
+	struct delayed_work debugfs_work;
 #endif
 };
 
@@ -300,7 +338,7 @@ static inline void dce_set_boot_complete(struct tegra_dce *d, bool val)
 {
 	d->boot_complete = val;
 	if (!val)
-		d->boot_status &= (~DCE_FW_BOOT_DONE);
+		d->boot_status &= ~(DCE_FW_BOOT_DONE | DCE_FW_LATE_IPC_DONE);
 }
 
 /**
@@ -329,6 +367,33 @@ static inline bool dce_is_bootstrap_done(struct tegra_dce *d)
 	return (d->boot_status & DCE_FW_BOOT_DONE) ? true : false;
 }
 
+/**
+ * dce_is_late_ipc_done - check if the deferred IPC channels are created.
+ *
+ * @d : Pointer to tegra_dce struct.
+ *
+ * Return : true if late IPC setup is done else false
+ */
+static inline bool dce_is_late_ipc_done(struct tegra_dce *d)
+{
+	return (d->boot_status & DCE_FW_LATE_IPC_DONE) ? true : false;
+}
+
+/**
+ * dce_boot_ts_mark - records the time a boot phase is first reached.
+ *
+ * @d : Pointer to tegra_dce struct.
+ * @phase : Boot phase reached.
+ *
+ * Return : void
+ */
+static inline void dce_boot_ts_mark(struct tegra_dce *d,
+				    enum dce_boot_ts_phase phase)
+{
+	if (READ_ONCE(d->boot_ts_ns[phase]) == 0U)
+		WRITE_ONCE(d->boot_ts_ns[phase], ktime_get_ns());
+}
+
 /**
  * dce_set_ast_config_status - updates the current status of ast configuration.
  *
@@ -398,6 +463,7 @@ int dce_handle_boot_complete_received_event(struct tegra_dce *d, void *params);
 int dce_admin_init(struct tegra_dce *d);
 void dce_admin_deinit(struct tegra_dce *d);
 int dce_start_admin_seq(struct tegra_dce *d);
+int dce_start_late_admin_seq(struct tegra_dce *d);
 struct dce_ipc_message
 		*dce_admin_allocate_message(struct tegra_dce *d);
 void dce_admin_free_message(struct tegra_dce *d,
@@ -443,6 +509,8 @@ void dce_request_fw_boot_complete(struct tegra_dce *d);
 void dce_config_ast(struct tegra_dce *d);
 int dce_reset_dce(struct tegra_dce *d);
 
+void dce_schedule_late_init(struct tegra_dce *d);
+
 #ifdef CONFIG_DEBUG_FS
 void dce_init_debug(struct tegra_dce *d);
 void dce_remove_debug(struct tegra_dce *d);
@@ -8,22 +8,54 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/export.h>
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
 #include <linux/of_device.h>
 #include <linux/of_address.h>
 #include <linux/platform_device.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/platform/tegra/mc-hwpm.h>
 
 #include <uapi/linux/tegra-soc-hwpm-uapi.h>
 
 /* Broadcast Channel + 16 MC Channels */
 #define MAX_MC_CHANNELS 17
 
+/* Upper bound of the memory a stream may keep */
+#define MC_HWPM_MAX_STREAM_BUF	SZ_16M
+
 static struct tegra_soc_hwpm_ip_ops hwpm_ip_ops;
 
+struct tegra_mc_hwpm;
+
+struct tegra_mc_hwpm_stream {
+	struct tegra_mc_hwpm *mc;
+	struct hrtimer timer;
+	/* protects the record ring against the sampling timer */
+	spinlock_t lock;
+	ktime_t period;
+	struct tegra_mc_hwpm_stream_reg *regs;
+	u32 nr_regs;
+	void *buf;
+	size_t record_size;
+	u32 nr_records;
+	u64 head;
+	u64 tail;
+	u64 dropped;
+};
+
 struct tegra_mc_hwpm {
 	struct device *dev;
 	void __iomem **ch_regs;
 	u32 no_ch;
 	u64 base_addr;
+
+	/* serializes stream start and stop */
+	struct mutex stream_lock;
+	struct tegra_mc_hwpm_stream *stream;
 };
 
 /**
@@ -44,18 +76,27 @@ static void mc_writel(struct tegra_mc_hwpm *mc, u32 ch_no, u32 val, u32 reg)
 	writel(val, mc->ch_regs[ch_no] + reg);
 }
 
+static struct tegra_mc_hwpm *tegra_mc_hwpm_get(void *ip_dev)
+{
+	struct device *dev = (struct device *)ip_dev;
+	struct tegra_mc_hwpm *mc;
+
+	mc = dev ? dev_get_drvdata(dev) : NULL;
+	if (!mc)
+		pr_err("tegra-mc-hwpm: Invalid device\n");
+
+	return mc;
+}
+
 static int tegra_mc_hwpm_reg_op(void *ip_dev,
 	enum tegra_soc_hwpm_ip_reg_op reg_op,
 	u32 inst_element_index, u64 reg_offset, u32 *reg_data)
 {
-	struct device *dev = (struct device *)ip_dev;
 	struct tegra_mc_hwpm *mc;
 
-	mc = dev_get_drvdata(dev);
-	if (!mc) {
-		pr_err("tegra-mc-hwpm: Invalid device\n");
+	mc = tegra_mc_hwpm_get(ip_dev);
+	if (!mc)
 		return -ENODEV;
-	}
 
 	if (inst_element_index >= mc->no_ch) {
 		dev_err(mc->dev, "Incorrect channel number: %u\n", inst_element_index);
@@ -74,6 +115,255 @@ static int tegra_mc_hwpm_reg_op(void *ip_dev,
 	return 0;
 }
 
+/**
+ * tegra_mc_hwpm_reg_ops - perform a batch of MC register accesses
+ * @ip_dev: ip_dev of the MC HWPM registration
+ * @ops: accesses, performed in order, read values are stored in place
+ * @count: number of accesses, up to TEGRA_MC_HWPM_MAX_BATCH
+ *
+ * The whole batch is validated before any register is touched, so a bad
+ * entry does not leave the perfmons half programmed.
+ */
+int tegra_mc_hwpm_reg_ops(void *ip_dev, struct tegra_mc_hwpm_reg_op *ops,
+			  u32 count)
+{
+	struct tegra_mc_hwpm *mc;
+	u32 i;
+
+	mc = tegra_mc_hwpm_get(ip_dev);
+	if (!mc)
+		return -ENODEV;
+
+	if (!ops || !count || count > TEGRA_MC_HWPM_MAX_BATCH)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		if (ops[i].channel >= mc->no_ch ||
+		    (ops[i].op != TEGRA_MC_HWPM_OP_READ &&
+		     ops[i].op != TEGRA_MC_HWPM_OP_WRITE)) {
+			dev_err(mc->dev, "Invalid reg op %u: op %u channel %u\n",
+				i, ops[i].op, ops[i].channel);
+			return -EINVAL;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		if (ops[i].op == TEGRA_MC_HWPM_OP_READ)
+			ops[i].value = mc_readl(mc, ops[i].channel, ops[i].offset);
+		else
+			mc_writel(mc, ops[i].channel, ops[i].value, ops[i].offset);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(tegra_mc_hwpm_reg_ops);
+
+static enum hrtimer_restart tegra_mc_hwpm_stream_sample(struct hrtimer *timer)
+{
+	struct tegra_mc_hwpm_stream *stream =
+		container_of(timer, struct tegra_mc_hwpm_stream, timer);
+	struct tegra_mc_hwpm *mc = stream->mc;
+	unsigned long flags;
+	u32 *values;
+	u64 *record;
+	u32 i;
+
+	spin_lock_irqsave(&stream->lock, flags);
+
+	/* the ring is full, the oldest record goes */
+	if (stream->head - stream->tail == stream->nr_records) {
+		stream->tail++;
+		stream->dropped++;
+	}
+
+	record = stream->buf +
+		(stream->head % stream->nr_records) * stream->record_size;
+	values = (u32 *)(record + 1);
+
+	*record = ktime_get_ns();
+	for (i = 0; i < stream->nr_regs; i++)
+		values[i] = mc_readl(mc, stream->regs[i].channel,
+				     stream->regs[i].offset);
+
+	stream->head++;
+
+	spin_unlock_irqrestore(&stream->lock, flags);
+
+	hrtimer_forward_now(timer, stream->period);
+
+	return HRTIMER_RESTART;
+}
+
+static void tegra_mc_hwpm_stream_free(struct tegra_mc_hwpm_stream *stream)
+{
+	vfree(stream->buf);
+	kfree(stream->regs);
+	kfree(stream);
+}
+
+/**
+ * tegra_mc_hwpm_stream_start - sample MC registers periodically
+ * @ip_dev: ip_dev of the MC HWPM registration
+ * @config: registers to sample, period and number of records to keep
+ *
+ * The registers are read from a timer in the MC HWPM driver, so the
+ * profiler only pays for draining the records with
+ * tegra_mc_hwpm_stream_read(). Only one stream can run at a time.
+ */
+int tegra_mc_hwpm_stream_start(void *ip_dev,
+			       const struct tegra_mc_hwpm_stream_config *config)
+{
+	struct tegra_mc_hwpm_stream *stream;
+	struct tegra_mc_hwpm *mc;
+	u32 i;
+	int err;
+
+	mc = tegra_mc_hwpm_get(ip_dev);
+	if (!mc)
+		return -ENODEV;
+
+	if (!config || !config->regs || !config->nr_regs ||
+	    config->nr_regs > TEGRA_MC_HWPM_MAX_STREAM_REGS ||
+	    !config->nr_records ||
+	    config->period_us < TEGRA_MC_HWPM_MIN_STREAM_PERIOD_US)
+		return -EINVAL;
+
+	if ((u64)config->nr_records *
+	    tegra_mc_hwpm_stream_record_size(config->nr_regs) >
+	    MC_HWPM_MAX_STREAM_BUF)
+		return -E2BIG;
+
+	for (i = 0; i < config->nr_regs; i++) {
+		if (config->regs[i].channel >= mc->no_ch) {
+			dev_err(mc->dev, "Incorrect channel number: %u\n",
+				config->regs[i].channel);
+			return -EINVAL;
+		}
+	}
+
+	stream = kzalloc(sizeof(*stream), GFP_KERNEL);
+	if (!stream)
+		return -ENOMEM;
+
+	stream->regs = kmemdup(config->regs,
+			       config->nr_regs * sizeof(*config->regs),
+			       GFP_KERNEL);
+	stream->nr_regs = config->nr_regs;
+	stream->nr_records = config->nr_records;
+	stream->record_size = tegra_mc_hwpm_stream_record_size(config->nr_regs);
+	stream->buf = vmalloc(stream->nr_records * stream->record_size);
+	if (!stream->regs || !stream->buf) {
+		err = -ENOMEM;
+		goto free_stream;
+	}
+
+	stream->mc = mc;
+	spin_lock_init(&stream->lock);
+	stream->period = us_to_ktime(config->period_us);
+	hrtimer_init(&stream->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	stream->timer.function = tegra_mc_hwpm_stream_sample;
+
+	mutex_lock(&mc->stream_lock);
+	if (mc->stream) {
+		mutex_unlock(&mc->stream_lock);
+		err = -EBUSY;
+		goto free_stream;
+	}
+
+	mc->stream = stream;
+	hrtimer_start(&stream->timer, stream->period, HRTIMER_MODE_REL);
+	mutex_unlock(&mc->stream_lock);
+
+	return 0;
+
+free_stream:
+	tegra_mc_hwpm_stream_free(stream);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(tegra_mc_hwpm_stream_start);
+
+/**
+ * tegra_mc_hwpm_stream_read - drain sampled records
+ * @ip_dev: ip_dev of the MC HWPM registration
+ * @buf: destination, max_records records of the stream's record size
+ * @max_records: number of records buf has room for
+ * @dropped: optional, set to the records overwritten since the last read
+ *
+ * Returns the number of records copied, oldest first.
+ */
+int tegra_mc_hwpm_stream_read(void *ip_dev, void *buf, u32 max_records,
+			      u64 *dropped)
+{
+	struct tegra_mc_hwpm_stream *stream;
+	struct tegra_mc_hwpm *mc;
+	unsigned long flags;
+	u32 nr = 0, idx;
+
+	mc = tegra_mc_hwpm_get(ip_dev);
+	if (!mc)
+		return -ENODEV;
+
+	mutex_lock(&mc->stream_lock);
+
+	stream = mc->stream;
+	if (!stream) {
+		mutex_unlock(&mc->stream_lock);
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&stream->lock, flags);
+
+	while (nr < max_records && stream->tail != stream->head) {
+		idx = stream->tail % stream->nr_records;
+		memcpy(buf + nr * stream->record_size,
+		       stream->buf + idx * stream->record_size,
+		       stream->record_size);
+		stream->tail++;
+		nr++;
+	}
+
+	if (dropped)
+		*dropped = stream->dropped;
+	stream->dropped = 0;
+
+	spin_unlock_irqrestore(&stream->lock, flags);
+	mutex_unlock(&mc->stream_lock);
+
+	return nr;
+}
+EXPORT_SYMBOL_GPL(tegra_mc_hwpm_stream_read);
+
+static void __tegra_mc_hwpm_stream_stop(struct tegra_mc_hwpm *mc)
+{
+	struct tegra_mc_hwpm_stream *stream;
+
+	mutex_lock(&mc->stream_lock);
+	stream = mc->stream;
+	mc->stream = NULL;
+	mutex_unlock(&mc->stream_lock);
+
+	if (!stream)
+		return;
+
+	hrtimer_cancel(&stream->timer);
+	tegra_mc_hwpm_stream_free(stream);
+}
+
+/**
+ * tegra_mc_hwpm_stream_stop - stop sampling and drop the pending records
+ * @ip_dev: ip_dev of the MC HWPM registration
+ */
+void tegra_mc_hwpm_stream_stop(void *ip_dev)
+{
+	struct tegra_mc_hwpm *mc;
+
+	mc = tegra_mc_hwpm_get(ip_dev);
+	if (mc)
+		__tegra_mc_hwpm_stream_stop(mc);
+}
+EXPORT_SYMBOL_GPL(tegra_mc_hwpm_stream_stop);
+
 static const struct of_device_id mc_hwpm_of_ids[] = {
 	{ .compatible = "nvidia,tegra-t23x-mc-hwpm" },
 	{ }
@@ -92,6 +382,7 @@ static int tegra_mc_hwpm_hwpm_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, mc);
 	mc->dev = &pdev->dev;
+	mutex_init(&mc->stream_lock);
 
 	mc->no_ch = MAX_MC_CHANNELS;
 	mc->ch_regs = devm_kcalloc(mc->dev, mc->no_ch, sizeof(*mc->ch_regs),
@@ -142,6 +433,8 @@ static int tegra_mc_hwpm_remove(struct platform_device *pdev)
 	hwpm_ip_ops.hwpm_ip_reg_op = NULL;
 	tegra_soc_hwpm_ip_unregister(&hwpm_ip_ops);
 
+	__tegra_mc_hwpm_stream_stop(mc);
+
 	return 0;
 }
 
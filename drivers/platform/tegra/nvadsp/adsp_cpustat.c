@@ -21,6 +21,7 @@
 #include <linux/platform/tegra/clock.h>
 #include <linux/irqchip/tegra-agic.h>
 #include <linux/irq.h>
+#include <linux/math64.h>
 #include <linux/spinlock.h>
 
 #include "dev.h"
@@ -165,6 +166,26 @@ static void adsp_cpustat_disable(void)
 	spin_unlock_irqrestore(&cpumon->lock, flags);
 }
 
+/*
+ * Active ADSP cycles per ms of the last sample, in kHz. Returns -ENODEV
+ * while cpustat is not sampling.
+ */
+long adsp_cpustat_activity(void)
+{
+	unsigned long flags;
+	long freq = -ENODEV;
+
+	if (!cpumon)
+		return freq;
+
+	spin_lock_irqsave(&cpumon->lock, flags);
+	if (cpumon->enable)
+		freq = (long)div_u64(cpumon->cur_usage * cpumon->adsp_freq, 100);
+	spin_unlock_irqrestore(&cpumon->lock, flags);
+
+	return freq;
+}
+
 #define RW_MODE (S_IWUSR | S_IRUSR)
 #define RO_MODE S_IRUSR
 
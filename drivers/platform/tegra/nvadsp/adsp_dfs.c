@@ -28,6 +28,7 @@
 #include <linux/sched/cputime.h>
 #endif
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "dev.h"
 #include "ape_actmon.h"
@@ -48,6 +49,22 @@ enum adsp_dfs_reply {
 	NACK,
 };
 
+/* Load governor defaults, load in % of the current adsp cpu rate */
+#define GOV_DEFAULT_PERIOD		20 /* in ms */
+#define GOV_DEFAULT_UP_THRESHOLD	85
+#define GOV_DEFAULT_DOWN_THRESHOLD	50
+#define GOV_DEFAULT_TARGET_LOAD		70
+#define GOV_DEFAULT_DOWN_SAMPLES	5
+
+static bool governor;
+module_param(governor, bool, 0444);
+MODULE_PARM_DESC(governor,
+	"Scale adsp cpu rate and emc floor with the sampled adsp load");
+
+static unsigned int governor_period_ms = GOV_DEFAULT_PERIOD;
+module_param(governor_period_ms, uint, 0444);
+MODULE_PARM_DESC(governor_period_ms, "Load governor sampling period in ms");
+
 /*
  * Freqency in Hz.The frequency always needs to be a multiple of 12.8 Mhz and
  * should be extended with a slab 38.4 Mhz.
@@ -111,6 +128,25 @@ struct adsp_dfs_policy {
 	struct dentry *root;
 #endif
 	unsigned long ovr_freq;
+
+	/*
+	 * Load governor: raises the rate as soon as a sample crosses
+	 * gov_up_threshold, lowers it only after gov_down_samples samples
+	 * in a row below gov_down_threshold. Either way the new rate puts
+	 * the load at gov_target_load.
+	 */
+	struct delayed_work gov_work;
+	bool gov_enable;
+	u32 gov_period;		/* in ms */
+	u32 gov_up_threshold;
+	u32 gov_down_threshold;
+	u32 gov_target_load;
+	u32 gov_down_samples;
+	u32 gov_down_count;
+	u32 gov_load;		/* last sampled load in % */
+	u64 gov_samples;
+	u64 gov_ups;
+	u64 gov_downs;
 };
 
 
@@ -122,7 +158,8 @@ struct adsp_freq_stats {
 	struct device *dev;
 	unsigned long long last_time;
 	int last_index;
-	u64 time_in_state[TIME_IN_STATE_SIZE];
+	u64 time_in_state[TIME_IN_STATE_SIZE];	/* in jiffies */
+	u64 total_trans;
 
 	int state_num;
 };
@@ -261,8 +298,37 @@ static unsigned long adsp_get_target_freq(unsigned long tfreq, int *index)
 static struct adsp_dfs_policy dfs_policy =  {
 	.enable = 1,
 	.clk_name = "adsp_cpu",
+	.gov_up_threshold = GOV_DEFAULT_UP_THRESHOLD,
+	.gov_down_threshold = GOV_DEFAULT_DOWN_THRESHOLD,
+	.gov_target_load = GOV_DEFAULT_TARGET_LOAD,
+	.gov_down_samples = GOV_DEFAULT_DOWN_SAMPLES,
 };
 
+static void adspfreq_stats_update(void)
+{
+	unsigned long long cur_time;
+
+	cur_time = get_jiffies_64();
+	freq_stats.time_in_state[freq_stats.last_index] += cur_time -
+		freq_stats.last_time;
+	freq_stats.last_time = cur_time;
+}
+
+/* Account the time spent so far to the old rate and move to freq_khz */
+static void adspfreq_stats_set(unsigned long freq_khz)
+{
+	int index;
+
+	if (!adsp_get_target_freq(freq_khz * 1000, &index))
+		return;
+
+	adspfreq_stats_update();
+	if (index != freq_stats.last_index) {
+		freq_stats.last_index = index;
+		freq_stats.total_trans++;
+	}
+}
+
 static int adsp_update_freq_handshake(unsigned long tfreq_hz, int index)
 {
 	struct nvadsp_mbox *mbx = &policy->mbox;
@@ -405,9 +471,107 @@ err_out:
 
 		tfreq_hz = old_freq_khz * 1000;
 	}
+
+	adspfreq_stats_set(tfreq_hz / 1000);
 	return tfreq_hz / 1000;
 }
 
+/* Active adsp cpu cycle rate in kHz, from whichever monitor is sampling */
+static long adsp_dfs_activity(void)
+{
+	long active = -ENODEV;
+
+#ifdef CONFIG_TEGRA_ADSP_ACTMON
+	active = ape_actmon_activity();
+#endif
+#ifdef CONFIG_TEGRA_ADSP_CPUSTAT
+	if (active < 0)
+		active = adsp_cpustat_activity();
+#endif
+	return active;
+}
+
+/* Returns the rate in KHz for load, called with policy_mutex held */
+static unsigned long adsp_dfs_governor_target(unsigned long load)
+{
+	unsigned long cur = policy->cur;
+	unsigned long target, tfreq;
+	u32 target_load = policy->gov_target_load ? : GOV_DEFAULT_TARGET_LOAD;
+	int index;
+
+	if (load >= policy->gov_up_threshold) {
+		policy->gov_down_count = 0;
+		target = DIV_ROUND_UP(cur * load, target_load);
+	} else if (load <= policy->gov_down_threshold) {
+		if (++policy->gov_down_count < policy->gov_down_samples)
+			return cur;
+		policy->gov_down_count = 0;
+		target = DIV_ROUND_UP(cur * load, target_load);
+	} else {
+		policy->gov_down_count = 0;
+		return cur;
+	}
+
+	target = clamp(target, policy->min, policy->max);
+	tfreq = adsp_get_target_freq(target * 1000, &index) / 1000;
+
+	/* A busy adsp goes up at least one step */
+	if ((load >= policy->gov_up_threshold) && (tfreq <= cur) &&
+	    (index + 1 < adsp_cpu_freq_table_size))
+		tfreq = adsp_cpu_freq_table[index + 1] / 1000;
+
+	return min(tfreq, policy->max);
+}
+
+static void adsp_dfs_governor_work(struct work_struct *work)
+{
+	unsigned long load, tfreq, freq;
+	long active;
+
+	mutex_lock(&policy_mutex);
+
+	if (!policy->gov_enable)
+		goto exit_out;
+
+	if (!policy->enable || !policy->cur || !is_os_running(device))
+		goto requeue;
+
+	active = adsp_dfs_activity();
+	if (active < 0)
+		goto requeue;
+
+	load = min_t(unsigned long, active * 100 / policy->cur, 100);
+	policy->gov_load = load;
+	policy->gov_samples++;
+
+	tfreq = adsp_dfs_governor_target(load);
+	if (tfreq == policy->cur)
+		goto requeue;
+
+	freq = update_freq(tfreq);
+	if (freq && freq != policy->cur) {
+		if (freq > policy->cur)
+			policy->gov_ups++;
+		else
+			policy->gov_downs++;
+		policy->cur = freq;
+	}
+
+requeue:
+	schedule_delayed_work(&policy->gov_work,
+		msecs_to_jiffies(max_t(u32, policy->gov_period, 1)));
+exit_out:
+	mutex_unlock(&policy_mutex);
+}
+
+/* Called with policy_mutex held */
+static void adsp_dfs_governor_start(void)
+{
+	policy->gov_enable = true;
+	policy->gov_down_count = 0;
+	schedule_delayed_work(&policy->gov_work, 0);
+}
+
 /* Set adsp dfs policy min freq(Khz) */
 static int policy_min_set(void *data, u64 val)
 {
@@ -583,15 +747,58 @@ exit_out:
 DEFINE_SIMPLE_ATTRIBUTE(cur_fops, policy_cur_get,
 	policy_cur_set, "%llu\n");
 
-static void adspfreq_stats_update(void)
+/* Get load governor status: 0: disabled, 1: enabled */
+static int governor_get(void *data, u64 *val)
 {
-	unsigned long long cur_time;
+	mutex_lock(&policy_mutex);
+	*val = policy->gov_enable;
+	mutex_unlock(&policy_mutex);
 
-	cur_time = get_jiffies_64();
-	freq_stats.time_in_state[freq_stats.last_index] += cur_time -
-		freq_stats.last_time;
-	freq_stats.last_time = cur_time;
+	return 0;
+}
+
+/* Enable/disable the load governor */
+static int governor_set(void *data, u64 val)
+{
+	mutex_lock(&policy_mutex);
+	if (val && !policy->gov_enable)
+		adsp_dfs_governor_start();
+	else if (!val && policy->gov_enable)
+		/* The work sees this and does not queue itself again */
+		policy->gov_enable = false;
+	mutex_unlock(&policy_mutex);
+
+	return 0;
 }
+DEFINE_SIMPLE_ATTRIBUTE(governor_fops, governor_get,
+	governor_set, "%llu\n");
+
+static int governor_stats_show(struct seq_file *s, void *data)
+{
+	mutex_lock(&policy_mutex);
+	seq_printf(s, "load %u\n", policy->gov_load);
+	seq_printf(s, "samples %llu\n", policy->gov_samples);
+	seq_printf(s, "up %llu\n", policy->gov_ups);
+	seq_printf(s, "down %llu\n", policy->gov_downs);
+	if (is_os_running(device))
+		adspfreq_stats_update();
+	seq_printf(s, "total_trans %llu\n", freq_stats.total_trans);
+	mutex_unlock(&policy_mutex);
+
+	return 0;
+}
+
+static int governor_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, governor_stats_show, inode->i_private);
+}
+
+static const struct file_operations governor_stats_fops = {
+	.open = governor_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 
 /*
  * Print residency in each freq levels
@@ -605,10 +812,9 @@ static void dump_stats_table(struct seq_file *s, struct adsp_freq_stats *fstats)
 		adspfreq_stats_update();
 
 	for (i = 0; i < fstats->state_num; i++) {
-		u64 jiffies64 = nsecs_to_jiffies64(fstats->time_in_state[i]);
 		seq_printf(s, "%lu %llu\n",
 			(long unsigned int)(adsp_cpu_freq_table[i] / 1000),
-			jiffies_64_to_clock_t(jiffies64));
+			jiffies_64_to_clock_t(fstats->time_in_state[i]));
 	}
 	mutex_unlock(&policy_mutex);
 }
@@ -675,6 +881,41 @@ static int adsp_dfs_debugfs_init(struct platform_device *pdev)
 	if (!d)
 		goto err_out;
 
+	d = debugfs_create_file("governor", RW_MODE, root, NULL,
+		&governor_fops);
+	if (!d)
+		goto err_out;
+
+	d = debugfs_create_u32("governor_period_ms", RW_MODE, root,
+		&policy->gov_period);
+	if (!d)
+		goto err_out;
+
+	d = debugfs_create_u32("governor_up_threshold", RW_MODE, root,
+		&policy->gov_up_threshold);
+	if (!d)
+		goto err_out;
+
+	d = debugfs_create_u32("governor_down_threshold", RW_MODE, root,
+		&policy->gov_down_threshold);
+	if (!d)
+		goto err_out;
+
+	d = debugfs_create_u32("governor_target_load", RW_MODE, root,
+		&policy->gov_target_load);
+	if (!d)
+		goto err_out;
+
+	d = debugfs_create_u32("governor_down_samples", RW_MODE, root,
+		&policy->gov_down_samples);
+	if (!d)
+		goto err_out;
+
+	d = debugfs_create_file("governor_stats", RO_MODE, root, NULL,
+		&governor_stats_fops);
+	if (!d)
+		goto err_out;
+
 	return 0;
 
 err_out:
@@ -700,6 +941,10 @@ void adsp_cpu_set_rate(unsigned long freq)
 		goto exit_out;
 	}
 
+	/* The load governor samples actmon itself */
+	if (policy->gov_enable)
+		goto exit_out;
+
 	if (freq < policy->min)
 		freq = policy->min;
 	else if (freq > policy->max)
@@ -840,6 +1085,16 @@ int adsp_dfs_core_init(struct platform_device *pdev)
 		goto end;
 	}
 
+	INIT_DELAYED_WORK(&policy->gov_work, adsp_dfs_governor_work);
+	policy->gov_period = governor_period_ms;
+	policy->gov_samples = policy->gov_ups = policy->gov_downs = 0;
+	freq_stats.total_trans = 0;
+	if (governor) {
+		mutex_lock(&policy_mutex);
+		adsp_dfs_governor_start();
+		mutex_unlock(&policy_mutex);
+	}
+
 #ifdef CONFIG_DEBUG_FS
 	adsp_dfs_debugfs_init(pdev);
 #endif
@@ -863,6 +1118,11 @@ int adsp_dfs_core_exit(struct platform_device *pdev)
 	if (!drv->dfs_initialized)
 		return -ENODEV;
 
+	mutex_lock(&policy_mutex);
+	policy->gov_enable = false;
+	mutex_unlock(&policy_mutex);
+	cancel_delayed_work_sync(&policy->gov_work);
+
 	ret = nvadsp_mbox_close(&policy->mbox);
 	if (ret)
 		dev_info(&pdev->dev,
@@ -26,6 +26,11 @@
 #include <linux/debugfs.h>
 #include <linux/platform_device.h>
 #include <linux/list.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/timekeeping.h>
 
 #include <linux/tegra_nvadsp.h>
 #include <uapi/linux/sched/types.h>
@@ -36,6 +41,14 @@
 
 #define ADSPFF_MAX_OPEN_FILES	(32)
 
+/*
+ * The ADSP asks for at most what fits its shared ring, one message at a
+ * time, so reads are served from a larger per file read-ahead buffer and
+ * writes are collected and written back in large blocks.
+ */
+#define ADSPFF_READ_AHEAD_SIZE		(256 * 1024)
+#define ADSPFF_WRITE_BEHIND_SIZE	(256 * 1024)
+
 struct file_struct {
 	struct file *fp;
 	uint8_t file_name[ADSPFF_MAX_FILENAME_SIZE];
@@ -43,12 +56,42 @@ struct file_struct {
 	unsigned long long wr_offset;
 	unsigned long long rd_offset;
 	struct list_head list;
+
+	/* read-ahead, ra_buf[0] is at file offset ra_offset */
+	uint8_t *ra_buf;
+	unsigned long long ra_offset;
+	uint32_t ra_len;
+
+	/* write-behind, wb_buf[0] goes to file offset wr_offset */
+	uint8_t *wb_buf;
+	uint32_t wb_len;
+};
+
+struct adspff_stats {
+	u64 reads;
+	u64 read_bytes;
+	u64 read_hit_bytes;
+	u64 read_ns;
+	u64 writes;
+	u64 write_bytes;
+	u64 write_ns;
+	u64 flushes;
+	u64 flush_bytes;
+	u64 write_errors;
 };
 
 static struct list_head file_list;
 static spinlock_t adspff_lock;
 static int open_count;
 
+/* only the kthread updates these */
+static struct adspff_stats adspff_stats;
+static bool adspff_dirty;
+
+static unsigned int flush_ms = 100;
+module_param(flush_ms, uint, 0644);
+MODULE_PARM_DESC(flush_ms, "Write back ADSPFF file data buffered for this long");
+
 /******************************************************************************
 * Kernel file functions
 ******************************************************************************/
@@ -90,11 +133,11 @@ static int file_write(struct file *file, unsigned long long *offset,
 	return ret;
 }
 
-static uint32_t file_read(struct file *file, unsigned long long *offset,
+static int file_read(struct file *file, unsigned long long *offset,
 				unsigned char *data, unsigned int size)
 {
 	mm_segment_t oldfs;
-	uint32_t ret = 0;
+	int ret = 0;
 
 	oldfs = get_fs();
 	set_fs(KERNEL_DS);
@@ -123,6 +166,139 @@ static uint32_t file_size(struct file *file)
 	return size;
 }
 
+/******************************************************************************
+* Buffered file functions
+******************************************************************************/
+
+static void adspff_file_flush(struct file_struct *file)
+{
+	int ret;
+
+	if (!file->wb_len)
+		return;
+
+	ret = file_write(file->fp, &file->wr_offset, file->wb_buf,
+			file->wb_len);
+	if (ret != file->wb_len) {
+		pr_err_ratelimited("write back of %u bytes to %s failed: %d\n",
+			file->wb_len, file->file_name, ret);
+		adspff_stats.write_errors++;
+	}
+
+	adspff_stats.flushes++;
+	adspff_stats.flush_bytes += file->wb_len;
+	file->wb_len = 0;
+}
+
+static void adspff_flush_all(void)
+{
+	struct file_struct *file;
+
+	list_for_each_entry(file, &file_list, list) {
+		if (file->fp)
+			adspff_file_flush(file);
+	}
+
+	adspff_dirty = false;
+}
+
+static void adspff_file_drop_buffers(struct file_struct *file)
+{
+	adspff_file_flush(file);
+	file->ra_len = 0;
+}
+
+static void adspff_file_free_buffers(struct file_struct *file)
+{
+	kvfree(file->ra_buf);
+	file->ra_buf = NULL;
+	file->ra_len = 0;
+	kvfree(file->wb_buf);
+	file->wb_buf = NULL;
+	file->wb_len = 0;
+}
+
+/*
+ * Writes to a file make its read-ahead stale, and a read must see the data
+ * still sitting in the write-behind buffer.
+ */
+static uint32_t adspff_file_write(struct file_struct *file,
+				const uint8_t *data, uint32_t size)
+{
+	int ret;
+
+	file->ra_len = 0;
+
+	if (!file->wb_buf)
+		file->wb_buf = kvmalloc(ADSPFF_WRITE_BEHIND_SIZE, GFP_KERNEL);
+
+	if (file->wb_len + size > ADSPFF_WRITE_BEHIND_SIZE)
+		adspff_file_flush(file);
+
+	if (!file->wb_buf || size > ADSPFF_WRITE_BEHIND_SIZE) {
+		ret = file_write(file->fp, &file->wr_offset,
+				(unsigned char *)data, size);
+		if (ret < 0) {
+			adspff_stats.write_errors++;
+			return 0;
+		}
+		return ret;
+	}
+
+	memcpy(file->wb_buf + file->wb_len, data, size);
+	file->wb_len += size;
+	adspff_dirty = true;
+
+	return size;
+}
+
+static uint32_t adspff_file_read(struct file_struct *file, uint8_t *data,
+				uint32_t size)
+{
+	uint32_t done = 0;
+	uint32_t chunk;
+	int ret;
+
+	adspff_file_flush(file);
+
+	if (!file->ra_buf)
+		file->ra_buf = kvmalloc(ADSPFF_READ_AHEAD_SIZE, GFP_KERNEL);
+
+	if (!file->ra_buf) {
+		ret = file_read(file->fp, &file->rd_offset, data, size);
+		return ret > 0 ? ret : 0;
+	}
+
+	while (done < size) {
+		bool hit = true;
+
+		if (file->rd_offset < file->ra_offset ||
+		    file->rd_offset >= file->ra_offset + file->ra_len) {
+			unsigned long long offset = file->rd_offset;
+
+			file->ra_offset = offset;
+			ret = file_read(file->fp, &offset, file->ra_buf,
+					ADSPFF_READ_AHEAD_SIZE);
+			file->ra_len = ret > 0 ? ret : 0;
+			if (!file->ra_len)
+				break;
+			hit = false;
+		}
+
+		chunk = min_t(uint32_t, size - done,
+			file->ra_offset + file->ra_len - file->rd_offset);
+		memcpy(data + done,
+			file->ra_buf + (file->rd_offset - file->ra_offset),
+			chunk);
+		if (hit)
+			adspff_stats.read_hit_bytes += chunk;
+		file->rd_offset += chunk;
+		done += chunk;
+	}
+
+	return done;
+}
+
 /******************************************************************************
 * ADSPFF file functions
 ******************************************************************************/
@@ -316,6 +492,7 @@ static void adspff_fclose(void)
 
 	file = (struct file_struct *)message->msg.payload.fclose_msg.file;
 	if (file) {
+		adspff_file_drop_buffers(file);
 		if ((file->flags & O_APPEND) == 0) {
 			if (is_read_file(file))
 				file->rd_offset = 0;
@@ -348,6 +525,7 @@ static void adspff_fsize(void)
 	}
 	file = (struct file_struct *)message.msg.payload.fsize_msg.file;
 	if (file) {
+		adspff_file_flush(file);
 		size = file_size(file->fp);
 	}
 
@@ -396,15 +574,15 @@ static void adspff_fwrite(void)
 
 	bytes_to_write = ((adspff->write_buf.read_index + size) < ADSPFF_SHARED_BUFFER_SIZE) ?
 		size : (ADSPFF_SHARED_BUFFER_SIZE - adspff->write_buf.read_index);
-	ret = file_write(file->fp, &file->wr_offset,
+	bytes_written += adspff_file_write(file,
 			adspff->write_buf.data + adspff->write_buf.read_index, bytes_to_write);
-	bytes_written += ret;
 
-	if ((size - bytes_to_write) > 0) {
-		ret = file_write(file->fp, &file->wr_offset,
+	if ((size - bytes_to_write) > 0)
+		bytes_written += adspff_file_write(file,
 				adspff->write_buf.data, size - bytes_to_write);
-		bytes_written += ret;
-	}
+
+	adspff_stats.writes++;
+	adspff_stats.write_bytes += bytes_written;
 
 	adspff->write_buf.read_index =
 		(adspff->write_buf.read_index + size) % ADSPFF_SHARED_BUFFER_SIZE;
@@ -476,24 +654,24 @@ static void adspff_fread(void)
 	if (can_wrap) {
 		uint32_t bytes_to_read = (size < (ADSPFF_SHARED_BUFFER_SIZE - wi)) ?
 			size : (ADSPFF_SHARED_BUFFER_SIZE - wi);
-		ret = file_read(file->fp, &file->rd_offset,
+		size_read = adspff_file_read(file,
 				adspff->read_buf.data + wi, bytes_to_read);
-		size_read = ret;
-		if (ret < bytes_to_read)
+		if (size_read < bytes_to_read)
 			goto send_ack;
 		if ((size - bytes_to_read) > 0) {
-			ret = file_read(file->fp, &file->rd_offset,
+			size_read += adspff_file_read(file,
 					adspff->read_buf.data, size - bytes_to_read);
-			size_read += ret;
 			goto send_ack;
 		}
 	} else {
-		ret = file_read(file->fp, &file->rd_offset,
+		size_read = adspff_file_read(file,
 				adspff->read_buf.data + wi, size);
-		size_read = ret;
 		goto send_ack;
 	}
 send_ack:
+	adspff_stats.reads++;
+	adspff_stats.read_bytes += size_read;
+
 	msg_recv->msg.payload.ack_msg.size = size_read;
 	ret = msgq_queue_message(&adspff->msgq_recv.msgq,
 			(msgq_message_t *)msg_recv);
@@ -533,18 +711,31 @@ static int adspff_kthread_fn(void *data)
 	int ret = 0;
 	struct adspff_kthread_msg *kmsg;
 	unsigned long flags;
+	long timeout;
+	u64 start;
 
 	while (1) {
 
-		ret = wait_event_interruptible(wait_queue, kthread_should_stop()
-				 || !list_empty(&adspff_kthread_msgq_head));
+		timeout = adspff_dirty ?
+			msecs_to_jiffies(flush_ms) : MAX_SCHEDULE_TIMEOUT;
+		ret = wait_event_interruptible_timeout(wait_queue,
+				kthread_should_stop() ||
+				!list_empty(&adspff_kthread_msgq_head),
+				timeout);
 
-		if (kthread_should_stop())
+		if (kthread_should_stop()) {
+			adspff_flush_all();
 			do_exit(0);
+		}
+
+		/* nothing came in for flush_ms, write back what is buffered */
+		if (ret == 0 && adspff_dirty)
+			adspff_flush_all();
 
 		if (!list_empty(&adspff_kthread_msgq_head)) {
 			kmsg = list_first_entry(&adspff_kthread_msgq_head,
 					struct adspff_kthread_msg, list);
+			start = ktime_get_ns();
 			switch (kmsg->msg_id) {
 			case adspff_cmd_fopen:
 				adspff_fopen();
@@ -554,9 +745,11 @@ static int adspff_kthread_fn(void *data)
 				break;
 			case adspff_cmd_fwrite:
 				adspff_fwrite();
+				adspff_stats.write_ns += ktime_get_ns() - start;
 				break;
 			case adspff_cmd_fread:
 				adspff_fread();
+				adspff_stats.read_ns += ktime_get_ns() - start;
 				break;
 			case adspff_cmd_fsize:
 				adspff_fsize();
@@ -610,8 +803,11 @@ static int adspff_set(void *data, u64 val)
 	list_for_each_safe(pos, n, &file_list) {
 		file = list_entry(pos, struct file_struct, list);
 		list_del(pos);
-		if (file->fp)
+		if (file->fp) {
+			adspff_file_flush(file);
 			file_close(file->fp);
+		}
+		adspff_file_free_buffers(file);
 		kfree(file);
 	}
 
@@ -621,6 +817,35 @@ static int adspff_set(void *data, u64 val)
 }
 DEFINE_SIMPLE_ATTRIBUTE(adspff_fops, NULL, adspff_set, "%llu\n");
 
+static u64 adspff_kbps(u64 bytes, u64 ns)
+{
+	if (!ns)
+		return 0;
+
+	return div64_u64(bytes * (NSEC_PER_SEC / 1024), ns);
+}
+
+/*
+ * Throughput is over the time spent serving the requests on the CPU side,
+ * it does not include the time the ADSP takes between two requests.
+ */
+static int adspff_stats_show(struct seq_file *s, void *data)
+{
+	struct adspff_stats st = adspff_stats;
+
+	seq_printf(s, "reads: %llu bytes: %llu read-ahead hits: %llu KiB/s: %llu\n",
+		st.reads, st.read_bytes, st.read_hit_bytes,
+		adspff_kbps(st.read_bytes, st.read_ns));
+	seq_printf(s, "writes: %llu bytes: %llu KiB/s: %llu\n",
+		st.writes, st.write_bytes,
+		adspff_kbps(st.write_bytes, st.write_ns));
+	seq_printf(s, "flushes: %llu bytes: %llu errors: %llu\n",
+		st.flushes, st.flush_bytes, st.write_errors);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(adspff_stats);
+
 #ifdef CONFIG_DEBUG_FS
 static int adspff_debugfs_init(struct nvadsp_drv_data *drv)
 {
@@ -639,6 +864,11 @@ static int adspff_debugfs_init(struct nvadsp_drv_data *drv)
 	if (!d)
 		return ret;
 
+	d = debugfs_create_file("stats", 0400, /* S_IRUSR */
+			dir, NULL, &adspff_stats_fops);
+	if (!d)
+		return ret;
+
 	return 0;
 }
 #endif
@@ -249,18 +249,24 @@ static inline void actmon_dev_avg_wmark_set(struct actmon_dev *dev)
 	actmon_writel(avg - band, offs(ACTMON_DEV_AVG_DOWN_WMARK));
 }
 
-static unsigned long actmon_dev_avg_freq_get(struct actmon_dev *dev)
+static unsigned long actmon_dev_count_to_freq(struct actmon_dev *dev,
+					      u32 count)
 {
 	u64 val;
 
 	if (dev->type == ACTMON_FREQ_SAMPLER)
-		return dev->avg_count / apemon->sampling_period;
+		return count / apemon->sampling_period;
 
-	val = (u64) dev->avg_count * dev->cur_freq;
+	val = (u64) count * dev->cur_freq;
 	do_div(val , apemon->freq * apemon->sampling_period);
 	return (u32)val;
 }
 
+static unsigned long actmon_dev_avg_freq_get(struct actmon_dev *dev)
+{
+	return actmon_dev_count_to_freq(dev, dev->avg_count);
+}
+
 /* Activity monitor sampling operations */
 static irqreturn_t ape_actmon_dev_isr(int irq, void *dev_id)
 {
@@ -807,6 +813,26 @@ void actmon_rate_change(unsigned long freq, bool override)
 	clk_set_rate(apemon->clk, freq * 500);
 };
 
+/*
+ * Average ADSP activity in kHz, straight from the moving average counter
+ * rather than the copy the avg watermark interrupts leave behind.
+ * Returns -ENODEV while the monitor is not sampling.
+ */
+long ape_actmon_activity(void)
+{
+	struct actmon_dev *dev = &actmon_dev_adsp;
+	unsigned long flags;
+	long freq = -ENODEV;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->state == ACTMON_ON)
+		freq = actmon_dev_count_to_freq(dev,
+				actmon_readl(offs(ACTMON_DEV_AVG_COUNT)));
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	return freq;
+}
+
 int ape_actmon_probe(struct platform_device *pdev)
 {
 	int ret = 0;
@@ -83,4 +83,5 @@ struct actmon {
 int ape_actmon_init(struct platform_device *pdev);
 int ape_actmon_exit(struct platform_device *pdev);
 void actmon_rate_change(unsigned long freq, bool override);
+long ape_actmon_activity(void);
 #endif
@@ -11,6 +11,10 @@
 #include <linux/platform_device.h>
 #include <linux/firmware.h>
 #include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/overflow.h>
 #include <asm/hwcap.h>
 
 #include "os.h"
@@ -32,6 +36,22 @@
 #define INIT_OFFSET_MASK (1U < (BITS_PER_INT-1))
 
 
+static bool app_elf_cache = true;
+module_param(app_elf_cache, bool, 0644);
+MODULE_PARM_DESC(app_elf_cache,
+	"Keep the ELF of dynamic apps in memory to load them again without the filesystem");
+
+/* Unrelocated ELF of a dynamic app, looked up by file name */
+struct adsp_app_elf {
+	struct list_head node;
+	const char *file;
+	size_t size;
+	u8 data[];
+};
+
+static LIST_HEAD(adsp_app_elf_list);
+static DEFINE_MUTEX(adsp_app_elf_lock);
+
 #define HWCAP_SWP	(1 << 0)
 #define HWCAP_HALF	(1 << 1)
 #define HWCAP_THUMB	(1 << 2)
@@ -837,12 +857,65 @@ struct adsp_module *load_adsp_static_module(const char *appname,
 	return mod;
 }
 
+/* entries are never removed while the driver is bound */
+static struct adsp_app_elf *adsp_app_elf_lookup(const char *appfile)
+{
+	struct adsp_app_elf *elf, *found = NULL;
+
+	mutex_lock(&adsp_app_elf_lock);
+	list_for_each_entry(elf, &adsp_app_elf_list, node) {
+		if (!strcmp(elf->file, appfile)) {
+			found = elf;
+			break;
+		}
+	}
+	mutex_unlock(&adsp_app_elf_lock);
+
+	return found;
+}
+
+static void adsp_app_elf_add(const char *appfile, const struct firmware *fw)
+{
+	struct adsp_app_elf *elf;
+
+	elf = kvmalloc(struct_size(elf, data, fw->size), GFP_KERNEL);
+	if (!elf)
+		return;
+
+	elf->file = kstrdup(appfile, GFP_KERNEL);
+	if (!elf->file) {
+		kvfree(elf);
+		return;
+	}
+	elf->size = fw->size;
+	memcpy(elf->data, fw->data, fw->size);
+
+	mutex_lock(&adsp_app_elf_lock);
+	list_add_tail(&elf->node, &adsp_app_elf_list);
+	mutex_unlock(&adsp_app_elf_lock);
+}
+
+void adsp_app_elf_cache_flush(void)
+{
+	struct adsp_app_elf *elf, *tmp;
+
+	mutex_lock(&adsp_app_elf_lock);
+	list_for_each_entry_safe(elf, tmp, &adsp_app_elf_list, node) {
+		list_del(&elf->node);
+		kfree(elf->file);
+		kvfree(elf);
+	}
+	mutex_unlock(&adsp_app_elf_lock);
+}
+
 struct adsp_module *load_adsp_dynamic_module(const char *appname,
 	const char *appfile, struct device *dev)
 {
 	struct load_info info = { };
 	struct adsp_module *mod = NULL;
-	const struct firmware *fw;
+	const struct firmware *fw = NULL;
+	struct firmware cached_fw = { };
+	struct adsp_app_elf *elf;
 	struct elf32_shdr *data_shdr;
 	struct elf32_shdr *shared_shdr;
 	struct elf32_shdr *shared_wc_shdr;
@@ -852,22 +925,32 @@ struct adsp_module *load_adsp_dynamic_module(const char *appname,
 	void *buf;
 	int ret;
 
-	ret = request_firmware(&fw, appfile, dev);
-	if (ret < 0) {
-		dev_err(dev,
-			"request firmware for %s(%s) failed with %d\n",
-							appname, appfile, ret);
-		return ERR_PTR(ret);
+	elf = app_elf_cache ? adsp_app_elf_lookup(appfile) : NULL;
+	if (elf) {
+		/* relocation depends on the load address, so it is redone */
+		dev_dbg(dev, "loading %s from the ELF cache\n", appfile);
+		cached_fw.size = elf->size;
+		cached_fw.data = elf->data;
+	} else {
+		ret = request_firmware(&fw, appfile, dev);
+		if (ret < 0) {
+			dev_err(dev,
+				"request firmware for %s(%s) failed with %d\n",
+								appname, appfile, ret);
+			return ERR_PTR(ret);
+		}
+		cached_fw.size = fw->size;
+		cached_fw.data = fw->data;
 	}
 
-	buf = kzalloc(fw->size, GFP_KERNEL);
+	buf = kzalloc(cached_fw.size, GFP_KERNEL);
 	if (!buf)
 		goto release_firmware;
 
-	memcpy(buf, fw->data, fw->size);
+	memcpy(buf, cached_fw.data, cached_fw.size);
 
 	info.hdr = (struct elf32_hdr *)buf;
-	info.len = fw->size;
+	info.len = cached_fw.size;
 	info.dev = dev;
 	info.name = appname;
 
@@ -884,11 +967,11 @@ struct adsp_module *load_adsp_dynamic_module(const char *appname,
 		goto error_free_memory;
 
 	/* update adsp specific sections */
-	data_shdr = nvadsp_get_section(fw, ".dram_data");
-	shared_shdr = nvadsp_get_section(fw, ".dram_shared");
-	shared_wc_shdr = nvadsp_get_section(fw, ".dram_shared_wc");
-	aram_shdr = nvadsp_get_section(fw, ".aram_data");
-	aram_x_shdr = nvadsp_get_section(fw, ".aram_x_data");
+	data_shdr = nvadsp_get_section(&cached_fw, ".dram_data");
+	shared_shdr = nvadsp_get_section(&cached_fw, ".dram_shared");
+	shared_wc_shdr = nvadsp_get_section(&cached_fw, ".dram_shared_wc");
+	aram_shdr = nvadsp_get_section(&cached_fw, ".aram_data");
+	aram_x_shdr = nvadsp_get_section(&cached_fw, ".aram_x_data");
 
 	mem_size = (void *)&mod->mem_size;
 
@@ -939,6 +1022,10 @@ struct adsp_module *load_adsp_dynamic_module(const char *appname,
 
 	mod->dynamic = true;
 
+	/* only files that loaded fine are kept */
+	if (fw && app_elf_cache)
+		adsp_app_elf_add(appfile, fw);
+
  error_free_memory:
 	kfree(buf);
  release_firmware:
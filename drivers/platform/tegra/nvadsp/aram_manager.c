@@ -55,6 +55,26 @@ static const struct file_operations aram_dump_fops = {
 	.release	= single_release,
 };
 
+static struct dentry *aram_frag_debugfs_file;
+
+static int nvadsp_aram_frag(struct seq_file *s, void *data)
+{
+	mem_frag_dump(aram_handle, s);
+	return 0;
+}
+
+static int nvadsp_aram_frag_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nvadsp_aram_frag, inode->i_private);
+}
+
+static const struct file_operations aram_frag_fops = {
+	.open		= nvadsp_aram_frag_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int nvadsp_aram_init(unsigned long addr, unsigned long size)
 {
 	aram_handle = create_mem_manager("ARAM", addr, size);
@@ -71,12 +91,18 @@ int nvadsp_aram_init(unsigned long addr, unsigned long size)
 			destroy_mem_manager(aram_handle);
 			return -ENOMEM;
 		}
+
+		aram_frag_debugfs_file = debugfs_create_file("aram_frag",
+			S_IRUSR, NULL, NULL, &aram_frag_fops);
+		if (!aram_frag_debugfs_file)
+			pr_err("ERROR: failed to create aram_frag debugfs");
 	}
 	return 0;
 }
 
 void nvadsp_aram_exit(void)
 {
+	debugfs_remove(aram_frag_debugfs_file);
 	debugfs_remove(aram_dump_debugfs_file);
 	destroy_mem_manager(aram_handle);
 }
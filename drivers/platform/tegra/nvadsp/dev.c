@@ -499,6 +499,7 @@ static int nvadsp_remove(struct platform_device *pdev)
 	nvadsp_bw_unregister(drv_data);
 
 	nvadsp_aram_exit();
+	adsp_app_elf_cache_flush();
 
 	pm_runtime_disable(&pdev->dev);
 
@@ -275,6 +275,7 @@ int ape_actmon_probe(struct platform_device *pdev);
 #ifdef CONFIG_TEGRA_ADSP_CPUSTAT
 int adsp_cpustat_init(struct platform_device *pdev);
 int adsp_cpustat_exit(struct platform_device *pdev);
+long adsp_cpustat_activity(void);
 #endif
 
 #if defined(CONFIG_TEGRA_ADSP_FILEIO)
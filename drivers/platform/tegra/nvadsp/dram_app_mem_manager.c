@@ -57,6 +57,26 @@ static const struct file_operations dram_app_mem_dump_fops = {
 	.release	= single_release,
 };
 
+static struct dentry *dram_app_mem_frag_debugfs_file;
+
+static int dram_app_mem_frag(struct seq_file *s, void *data)
+{
+	mem_frag_dump(dram_app_mem_handle, s);
+	return 0;
+}
+
+static int dram_app_mem_frag_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dram_app_mem_frag, inode->i_private);
+}
+
+static const struct file_operations dram_app_mem_frag_fops = {
+	.open		= dram_app_mem_frag_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int dram_app_mem_init(unsigned long start, unsigned long size)
 {
 	dram_app_mem_handle =
@@ -75,12 +95,19 @@ int dram_app_mem_init(unsigned long start, unsigned long size)
 			destroy_mem_manager(dram_app_mem_handle);
 			return -ENOMEM;
 		}
+
+		dram_app_mem_frag_debugfs_file =
+			debugfs_create_file("dram_app_mem_frag",
+					S_IRUSR, NULL, NULL, &dram_app_mem_frag_fops);
+		if (!dram_app_mem_frag_debugfs_file)
+			pr_err("ERROR: failed to create dram_app_mem_frag debugfs");
 	}
 	return 0;
 }
 
 void dram_app_mem_exit(void)
 {
+	debugfs_remove(dram_app_mem_frag_debugfs_file);
 	debugfs_remove(dram_app_mem_dump_debugfs_file);
 	destroy_mem_manager(dram_app_mem_handle);
 }
@@ -8,98 +8,151 @@
 #include <linux/string.h>
 #include <linux/err.h>
 #include <linux/seq_file.h>
+#include <linux/bitops.h>
+#include <linux/kernel.h>
 
 #include "mem_manager.h"
 
 static void clear_alloc_list(struct mem_manager_info *mm_info);
 
+static inline unsigned int mem_bin(unsigned long size)
+{
+	if (!size)
+		return 0;
+
+	return min_t(unsigned int, __fls(size), MEM_NR_BINS - 1);
+}
+
+static void mem_bin_add(struct mem_manager_info *mm_info, struct mem_chunk *mc)
+{
+	list_add(&mc->bin_node, &mm_info->bins[mem_bin(mc->size)]);
+}
+
+static void mem_bin_resize(struct mem_manager_info *mm_info,
+			   struct mem_chunk *mc, unsigned long size)
+{
+	if (mem_bin(size) != mem_bin(mc->size)) {
+		list_del(&mc->bin_node);
+		mc->size = size;
+		mem_bin_add(mm_info, mc);
+	} else {
+		mc->size = size;
+	}
+}
+
+/*
+ * Smallest free chunk of at least size bytes. Only the bin of size can hold
+ * chunks that are too small, every chunk of the bins above fits.
+ */
+static struct mem_chunk *mem_find_best_fit(struct mem_manager_info *mm_info,
+					   unsigned long size)
+{
+	struct mem_chunk *mc, *best = NULL;
+	unsigned int bin;
+
+	for (bin = mem_bin(size); bin < MEM_NR_BINS; bin++) {
+		list_for_each_entry(mc, &mm_info->bins[bin], bin_node) {
+			if (mc->size < size)
+				continue;
+			if (!best || mc->size < best->size)
+				best = mc;
+		}
+		if (best)
+			break;
+	}
+
+	return best;
+}
+
+/* keep the allocated list in address order */
+static void mem_add_alloc(struct mem_manager_info *mm_info,
+			  struct mem_chunk *new_mc)
+{
+	struct mem_chunk *mc_iterator;
+
+	list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
+		if (new_mc->address < mc_iterator->address) {
+			list_add_tail(&new_mc->node, &mc_iterator->node);
+			return;
+		}
+	}
+	list_add_tail(&new_mc->node, mm_info->alloc_list);
+}
+
 void *mem_request(void *mem_handle, const char *name, size_t size)
 {
 	unsigned long flags;
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
-	struct mem_chunk *mc_iterator = NULL, *best_match_chunk = NULL;
+	struct mem_chunk *best_match_chunk = NULL;
 	struct mem_chunk *new_mc = NULL;
 
+	if (!size)
+		return ERR_PTR(-EINVAL);
+
+	/* allocated outside the lock, freed again on an exact match */
+	new_mc = kzalloc(sizeof(struct mem_chunk), GFP_ATOMIC);
+	if (unlikely(!new_mc)) {
+		pr_err("failed to allocate memory for mem_chunk\n");
+		return ERR_PTR(-ENOMEM);
+	}
+
 	spin_lock_irqsave(&mm_info->lock, flags);
 
 	/* Is mem full? */
 	if (list_empty(mm_info->free_list)) {
 		pr_err("%s : memory full\n", mm_info->name);
-		spin_unlock_irqrestore(&mm_info->lock, flags);
-		return ERR_PTR(-ENOMEM);
+		goto no_mem;
 	}
 
-	/* Find the best size match */
-	list_for_each_entry(mc_iterator, mm_info->free_list, node) {
-		if (mc_iterator->size >= size) {
-			if (best_match_chunk == NULL)
-				best_match_chunk = mc_iterator;
-			else if (mc_iterator->size < best_match_chunk->size)
-				best_match_chunk = mc_iterator;
-		}
-	}
+	best_match_chunk = mem_find_best_fit(mm_info, size);
 
 	/* Is free node found? */
 	if (best_match_chunk == NULL) {
 		pr_err("%s : no enough memory available\n", mm_info->name);
-		spin_unlock_irqrestore(&mm_info->lock, flags);
-		return ERR_PTR(-ENOMEM);
+		goto no_mem;
 	}
 
+	mm_info->free_size -= size;
+
 	/* Is it exact match? */
 	if (best_match_chunk->size == size) {
 		list_del(&best_match_chunk->node);
-		list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
-			if (best_match_chunk->address < mc_iterator->address) {
-				list_add_tail(&best_match_chunk->node,
-						&mc_iterator->node);
-				strscpy(best_match_chunk->name, name,
-						NAME_SIZE);
-				spin_unlock_irqrestore(&mm_info->lock, flags);
-				return best_match_chunk;
-			}
-		}
-		list_add(&best_match_chunk->node, mm_info->alloc_list);
+		list_del(&best_match_chunk->bin_node);
 		strscpy(best_match_chunk->name, name, NAME_SIZE);
+		mem_add_alloc(mm_info, best_match_chunk);
 		spin_unlock_irqrestore(&mm_info->lock, flags);
+		kfree(new_mc);
 		return best_match_chunk;
-	} else {
-		new_mc = kzalloc(sizeof(struct mem_chunk), GFP_ATOMIC);
-		if (unlikely(!new_mc)) {
-			pr_err("failed to allocate memory for mem_chunk\n");
-
-			spin_unlock_irqrestore(&mm_info->lock, flags);
-			return ERR_PTR(-ENOMEM);
-		}
-		new_mc->address = best_match_chunk->address;
-		new_mc->size = size;
-		strscpy(new_mc->name, name, NAME_SIZE);
-		best_match_chunk->address += size;
-		best_match_chunk->size -= size;
-		list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
-			if (new_mc->address < mc_iterator->address) {
-				list_add_tail(&new_mc->node,
-						&mc_iterator->node);
-				spin_unlock_irqrestore(&mm_info->lock, flags);
-				return new_mc;
-			}
-		}
-		list_add_tail(&new_mc->node, mm_info->alloc_list);
-		spin_unlock_irqrestore(&mm_info->lock, flags);
-		return new_mc;
 	}
+
+	new_mc->address = best_match_chunk->address;
+	new_mc->size = size;
+	strscpy(new_mc->name, name, NAME_SIZE);
+	best_match_chunk->address += size;
+	mem_bin_resize(mm_info, best_match_chunk,
+		       best_match_chunk->size - size);
+	mem_add_alloc(mm_info, new_mc);
+	spin_unlock_irqrestore(&mm_info->lock, flags);
+	return new_mc;
+
+no_mem:
+	mm_info->failed_requests++;
+	spin_unlock_irqrestore(&mm_info->lock, flags);
+	kfree(new_mc);
+	return ERR_PTR(-ENOMEM);
 }
 
 /*
- * Find the node with sepcified address and remove it from list
+ * Move an allocated chunk back to the free list, merged with its free
+ * neighbours.
  */
 bool mem_release(void *mem_handle, void *handle)
 {
 	unsigned long flags;
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
-	struct mem_chunk *mc_curr = NULL, *mc_prev = NULL;
+	struct mem_chunk *mc_curr = NULL, *mc_prev = NULL, *mc_next = NULL;
 	struct mem_chunk *mc_free = (struct mem_chunk *)handle;
 
 	pr_debug(" addr = %lu, size = %lu, name = %s\n",
@@ -107,50 +160,47 @@ bool mem_release(void *mem_handle, void *handle)
 
 	spin_lock_irqsave(&mm_info->lock, flags);
 
+	/* free neighbours on both sides of the chunk */
 	list_for_each_entry(mc_curr, mm_info->free_list, node) {
 		if (mc_free->address < mc_curr->address) {
-
-			strscpy(mc_free->name, "FREE", NAME_SIZE);
-
-			/* adjacent next free node */
-			if (mc_curr->address ==
-				(mc_free->address + mc_free->size)) {
-
-				mc_curr->address = mc_free->address;
-				mc_curr->size += mc_free->size;
-				list_del(&mc_free->node);
-				kfree(mc_free);
-
-				/* and adjacent prev free node */
-				if ((mc_prev != NULL) &&
-				   ((mc_prev->address + mc_prev->size) ==
-						mc_curr->address)) {
-
-					mc_prev->size += mc_curr->size;
-					list_del(&mc_curr->node);
-					kfree(mc_curr);
-				}
-			}
-			/* adjacent prev free node */
-			else if ((mc_prev != NULL) &&
-				((mc_prev->address + mc_prev->size) ==
-						mc_free->address)) {
-
-				mc_prev->size += mc_free->size;
-				list_del(&mc_free->node);
-				kfree(mc_free);
-			} else {
-				list_del(&mc_free->node);
-				list_add_tail(&mc_free->node,
-						&mc_curr->node);
-			}
-			spin_unlock_irqrestore(&mm_info->lock, flags);
-			return true;
+			mc_next = mc_curr;
+			break;
 		}
 		mc_prev = mc_curr;
 	}
+
+	strscpy(mc_free->name, "FREE", NAME_SIZE);
+	list_del(&mc_free->node);
+	mm_info->free_size += mc_free->size;
+
+	if (mc_prev && (mc_prev->address + mc_prev->size) == mc_free->address) {
+		/* adjacent prev free node, and maybe the next one too */
+		unsigned long size = mc_prev->size + mc_free->size;
+
+		kfree(mc_free);
+		if (mc_next && (mc_prev->address + size) == mc_next->address) {
+			size += mc_next->size;
+			list_del(&mc_next->node);
+			list_del(&mc_next->bin_node);
+			kfree(mc_next);
+		}
+		mem_bin_resize(mm_info, mc_prev, size);
+	} else if (mc_next &&
+		   (mc_free->address + mc_free->size) == mc_next->address) {
+		/* adjacent next free node */
+		mc_next->address = mc_free->address;
+		mem_bin_resize(mm_info, mc_next, mc_next->size + mc_free->size);
+		kfree(mc_free);
+	} else {
+		if (mc_next)
+			list_add_tail(&mc_free->node, &mc_next->node);
+		else
+			list_add_tail(&mc_free->node, mm_info->free_list);
+		mem_bin_add(mm_info, mc_free);
+	}
+
 	spin_unlock_irqrestore(&mm_info->lock, flags);
-	return false;
+	return true;
 }
 
 inline unsigned long mem_get_address(void *handle)
@@ -207,6 +257,44 @@ void mem_dump(void *mem_handle, struct seq_file *s)
 	seq_puts(s, "---------------------------------------\n");
 }
 
+/*
+ * Free space and how much of it the largest chunk holds. A request larger
+ * than the largest free chunk fails even when enough memory is free.
+ */
+void mem_frag_dump(void *mem_handle, struct seq_file *s)
+{
+	struct mem_manager_info *mm_info =
+		(struct mem_manager_info *)mem_handle;
+	unsigned long largest = 0, free_size, failed, flags;
+	unsigned int bin_count[MEM_NR_BINS] = { };
+	unsigned int chunks = 0, i;
+	struct mem_chunk *mc;
+
+	spin_lock_irqsave(&mm_info->lock, flags);
+	list_for_each_entry(mc, mm_info->free_list, node) {
+		largest = max(largest, mc->size);
+		bin_count[mem_bin(mc->size)]++;
+		chunks++;
+	}
+	free_size = mm_info->free_size;
+	failed = mm_info->failed_requests;
+	spin_unlock_irqrestore(&mm_info->lock, flags);
+
+	seq_printf(s, "%s\n", mm_info->name);
+	seq_printf(s, "  size = %lu, free = %lu\n", mm_info->size, free_size);
+	seq_printf(s, "  free chunks = %u, largest = %lu\n", chunks, largest);
+	seq_printf(s, "  fragmentation = %lu%%\n", free_size ?
+		   100 - (largest * 100) / free_size : 0);
+	seq_printf(s, "  failed requests = %lu\n", failed);
+	for (i = 0; i < MEM_NR_BINS; i++) {
+		if (bin_count[i])
+			seq_printf(s, "  bin %lu-%lu: %u\n", 1UL << i,
+				   i + 1 < BITS_PER_LONG ?
+				   (1UL << (i + 1)) - 1 : ULONG_MAX,
+				   bin_count[i]);
+	}
+}
+
 static void clear_alloc_list(struct mem_manager_info *mm_info)
 {
 	struct list_head *curr, *next;
@@ -226,6 +314,7 @@ void *create_mem_manager(const char *name, unsigned long start_address,
 {
 	void *ret = NULL;
 	struct mem_chunk *mc;
+	unsigned int i;
 	struct mem_manager_info *mm_info =
 			kzalloc(sizeof(struct mem_manager_info), GFP_KERNEL);
 	if (unlikely(!mm_info)) {
@@ -263,10 +352,15 @@ void *create_mem_manager(const char *name, unsigned long start_address,
 		goto free_free_list;
 	}
 
+	for (i = 0; i < MEM_NR_BINS; i++)
+		INIT_LIST_HEAD(&mm_info->bins[i]);
+
 	mc->address = mm_info->start_address;
 	mc->size = mm_info->size;
 	strscpy(mc->name, "FREE", NAME_SIZE);
 	list_add(&mc->node, mm_info->free_list);
+	mem_bin_add(mm_info, mc);
+	mm_info->free_size = mm_info->size;
 	spin_lock_init(&mm_info->lock);
 
 	return (void *)mm_info;
@@ -6,12 +6,20 @@
 #ifndef __TEGRA_NVADSP_MEM_MANAGER_H
 #define __TEGRA_NVADSP_MEM_MANAGER_H
 
+#include <linux/bits.h>
+#include <linux/list.h>
 #include <linux/sizes.h>
+#include <linux/spinlock.h>
 
 #define NAME_SIZE SZ_16
 
+/* free chunks of [2^n, 2^(n + 1)) bytes are kept in bin n */
+#define MEM_NR_BINS BITS_PER_LONG
+
 struct mem_chunk {
 	struct list_head node;
+	/* size bin of a free chunk */
+	struct list_head bin_node;
 	char name[NAME_SIZE];
 	unsigned long address;
 	unsigned long size;
@@ -19,10 +27,14 @@ struct mem_chunk {
 
 struct mem_manager_info {
 	struct list_head *alloc_list;
+	/* free chunks in address order, to merge neighbours */
 	struct list_head *free_list;
+	struct list_head bins[MEM_NR_BINS];
 	char name[NAME_SIZE];
 	unsigned long start_address;
 	unsigned long size;
+	unsigned long free_size;
+	unsigned long failed_requests;
 	spinlock_t lock;
 };
 
@@ -37,5 +49,6 @@ unsigned long mem_get_address(void *handle);
 
 void mem_print(void *mem_handle);
 void mem_dump(void *mem_handle, struct seq_file *s);
+void mem_frag_dump(void *mem_handle, struct seq_file *s);
 
 #endif /* __TEGRA_NVADSP_MEM_MANAGER_H */
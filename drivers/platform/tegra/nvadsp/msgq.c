@@ -8,6 +8,15 @@
 #define msgq_wmemcpy(dest, src, words) \
 	memcpy(dest, src, (words) * sizeof(int32_t))
 
+/*
+ * A queue has one producer and one consumer, one of them on the ADSP. Each
+ * side only writes its own index, so no lock is needed between them: the
+ * producer publishes write_index after the message words and the consumer
+ * publishes read_index after it has copied the message out. The index of
+ * the other side is read once per operation. Several local producers (or
+ * consumers) of one queue still have to serialise among themselves.
+ */
+
 
 /**
  * msgq_init - Initialize message queue
@@ -39,6 +48,44 @@ void msgq_init(msgq_t *msgq, int32_t size)
 	msgq->write_index = 0;
 }
 EXPORT_SYMBOL(msgq_init);
+/* copy a message at wi without publishing it, returns the next wi */
+static int32_t msgq_write_message(msgq_t *msgq, int32_t ri, int32_t wi,
+				  const msgq_message_t *message)
+{
+	bool wrap = ri <= wi;
+	int32_t *start = msgq->queue;
+	int32_t *end = &msgq->queue[msgq->size];
+	int32_t *first = &msgq->queue[wi];
+	int32_t *last = &msgq->queue[ri];
+	int32_t qremainder = wrap ? end - first : last - first;
+	int32_t qsize = wrap ? qremainder + (last - start) : qremainder;
+	int32_t msize = &message->payload[message->size] -
+		(int32_t *)message;
+
+	/* don't allow read == write */
+	if (qsize <= msize)
+		return -ENOSPC;
+
+	if (msize < qremainder) {
+		msgq_wmemcpy(first, message, msize);
+		return wi + MSGQ_MESSAGE_HEADER_WSIZE + message->size;
+	}
+
+	/* message wrapped */
+	msgq_wmemcpy(first, message, qremainder);
+	msgq_wmemcpy(msgq->queue, (int32_t *)message + qremainder,
+		msize - qremainder);
+	return wi + MSGQ_MESSAGE_HEADER_WSIZE + message->size - msgq->size;
+}
+
+/* make the messages written up to wi visible to the consumer */
+static void msgq_publish(msgq_t *msgq, int32_t wi)
+{
+	/* the message words before the index that covers them */
+	wmb();
+	WRITE_ONCE(msgq->write_index, wi);
+}
+
 /**
  * msgq_queue_message - Queues a message in the queue
  * @msgq:           pointer to the client message queue
@@ -54,47 +101,89 @@ EXPORT_SYMBOL(msgq_init);
  */
 int32_t msgq_queue_message(msgq_t *msgq, const msgq_message_t *message)
 {
-	int32_t ret = 0;
+	int32_t ri, wi;
 
-	if (msgq && message) {
-		int32_t ri = msgq->read_index;
-		int32_t wi = msgq->write_index;
-		bool wrap = ri <= wi;
-		int32_t *start = msgq->queue;
-		int32_t *end = &msgq->queue[msgq->size];
-		int32_t *first = &msgq->queue[wi];
-		int32_t *last = &msgq->queue[ri];
-		int32_t qremainder = wrap ? end - first : last - first;
-		int32_t qsize = wrap ? qremainder + (last - start) : qremainder;
-		int32_t msize = &message->payload[message->size] -
-			(int32_t *)message;
-
-		if (qsize <= msize) {
-			/* don't allow read == write */
-			pr_err("%s failed: msgq ri: %d, wi %d, msg size %d\n",
-				__func__, msgq->read_index,
-				msgq->write_index, message->size);
-			ret = -ENOSPC;
-		} else if (msize < qremainder) {
-			msgq_wmemcpy(first, message, msize);
-			msgq->write_index = wi + MSGQ_MESSAGE_HEADER_WSIZE +
-				message->size;
-		} else {
-			/* message wrapped */
-			msgq_wmemcpy(first, message, qremainder);
-			msgq_wmemcpy(msgq->queue, (int32_t *)message +
-				qremainder, msize - qremainder);
-			msgq->write_index = wi + MSGQ_MESSAGE_HEADER_WSIZE +
-				message->size - msgq->size;
-		}
-	} else {
+	if (!msgq || !message) {
 		pr_err("NULL: msgq %p message %p\n", msgq, message);
-		ret = -EFAULT; /* Bad Address */
+		return -EFAULT; /* Bad Address */
 	}
 
-	return ret;
+	ri = READ_ONCE(msgq->read_index);
+	wi = msgq->write_index;
+	/* the consumer is done with the words up to ri */
+	mb();
+
+	wi = msgq_write_message(msgq, ri, wi, message);
+	if (wi < 0) {
+		pr_err("%s failed: msgq ri: %d, wi %d, msg size %d\n",
+			__func__, ri, msgq->write_index, message->size);
+		return wi;
+	}
+
+	msgq_publish(msgq, wi);
+
+	return 0;
 }
 EXPORT_SYMBOL(msgq_queue_message);
+
+/**
+ * msgq_queue_messages - Queues several messages at once
+ * @msgq:           pointer to the client message queue
+ * @messages:       messages to copy from
+ * @count:          number of messages
+ *
+ * The messages are copied in order and made visible to the consumer
+ * together, so the caller rings the doorbell once for all of them.
+ *
+ * This function returns the number of messages queued, which is less
+ * than count when the queue fills up, or -ENOSPC when none fits.
+ */
+int32_t msgq_queue_messages(msgq_t *msgq, const msgq_message_t * const *messages,
+			    int32_t count)
+{
+	int32_t ri, wi, next;
+	int32_t i;
+
+	if (!msgq || !messages) {
+		pr_err("NULL: msgq %p messages %p\n", msgq, messages);
+		return -EFAULT; /* Bad Address */
+	}
+
+	ri = READ_ONCE(msgq->read_index);
+	wi = msgq->write_index;
+	mb();
+
+	for (i = 0; i < count; i++) {
+		next = msgq_write_message(msgq, ri, wi, messages[i]);
+		if (next < 0)
+			break;
+		wi = next;
+	}
+
+	if (i == 0) {
+		pr_err("%s failed: msgq ri: %d, wi %d, full\n",
+			__func__, ri, wi);
+		return -ENOSPC;
+	}
+
+	msgq_publish(msgq, wi);
+
+	return i;
+}
+EXPORT_SYMBOL(msgq_queue_messages);
+
+/**
+ * msgq_empty - Checks for a message without consuming it
+ * @msgq:           pointer to the client message queue
+ *
+ * Lets a consumer that drains the queue stop without the error that
+ * msgq_dequeue_message() reports on an empty queue.
+ */
+bool msgq_empty(msgq_t *msgq)
+{
+	return READ_ONCE(msgq->read_index) == READ_ONCE(msgq->write_index);
+}
+EXPORT_SYMBOL(msgq_empty);
 /**
  * msgq_dequeue_message - Dequeues a message from the queue
  * @msgq:           pointer to the client message queue
@@ -122,8 +211,10 @@ int32_t msgq_dequeue_message(msgq_t *msgq, msgq_message_t *message)
 	}
 
 	ri = msgq->read_index;
-	wi = msgq->write_index;
-	msg = (msgq_message_t *)&msgq->queue[msgq->read_index];
+	wi = READ_ONCE(msgq->write_index);
+	/* the message words after the index that covers them */
+	rmb();
+	msg = (msgq_message_t *)&msgq->queue[ri];
 
 	if (ri == wi) {
 		/* empty queue */
@@ -135,7 +226,9 @@ int32_t msgq_dequeue_message(msgq_t *msgq, msgq_message_t *message)
 	} else if (!message) {
 		/* no input buffer, discard top message */
 		ri += MSGQ_MESSAGE_HEADER_WSIZE + msg->size;
-		msgq->read_index = ri < msgq->size ? ri : ri - msgq->size;
+		mb();
+		WRITE_ONCE(msgq->read_index,
+			   ri < msgq->size ? ri : ri - msgq->size);
 	} else if (message->size < msg->size) {
 		/* return buffer too small */
 		pr_err("%s failed: msgq ri: %d, wi %d, NO SPACE\n",
@@ -151,16 +244,18 @@ int32_t msgq_dequeue_message(msgq_t *msgq, msgq_message_t *message)
 
 		if (msize < qremainder) {
 			msgq_wmemcpy(message, first, msize);
-			msgq->read_index = ri + MSGQ_MESSAGE_HEADER_WSIZE +
-				msg->size;
+			ri += MSGQ_MESSAGE_HEADER_WSIZE + msg->size;
 		} else {
 			/* message wrapped */
 			msgq_wmemcpy(message, first, qremainder);
 			msgq_wmemcpy((int32_t *)message + qremainder,
 				msgq->queue, msize - qremainder);
-			msgq->read_index = ri + MSGQ_MESSAGE_HEADER_WSIZE +
-				msg->size - msgq->size;
+			ri += MSGQ_MESSAGE_HEADER_WSIZE + msg->size -
+				msgq->size;
 		}
+		/* the copy is done before the producer may reuse the words */
+		mb();
+		WRITE_ONCE(msgq->read_index, ri);
 	}
 
 	return ret;
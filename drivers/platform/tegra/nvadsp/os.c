@@ -28,6 +28,8 @@
 #include <linux/tegra-firmwares.h>
 #include <linux/reset.h>
 #include <linux/poll.h>
+#include <linux/async.h>
+#include <linux/ktime.h>
 
 #include <linux/uaccess.h>
 
@@ -86,8 +88,38 @@ struct nvadsp_debug_log {
 	struct completion	complete;
 };
 
+/*
+ * Cluster RAM contents built from the ADSP OS ELF. They only change with the
+ * firmware, so a restart copies them back instead of rebuilding them.
+ */
+struct nvadsp_os_image {
+	void			*shadow[MAX_CLUSTER_MEM];
+	bool			active[MAX_CLUSTER_MEM];
+	bool			valid;
+};
+
+/* Time spent in each step of the last ADSP OS load and boot, in us */
+struct nvadsp_boot_times {
+	u64			fw_fetch;
+	u64			multi_fw_load;
+	u64			os_elf_load;
+	u64			os_boot;
+	u64			static_apps;
+	u64			reload;
+	unsigned int		reloads;
+};
+
+/* A firmware file requested in parallel with the others */
+struct nvadsp_fw_fetch {
+	const char		*name;
+	const struct firmware	*fw;
+	int			ret;
+};
+
 struct nvadsp_os_data {
 	const struct firmware	*os_firmware;
+	struct nvadsp_os_image	os_image;
+	struct nvadsp_boot_times boot_times;
 	struct platform_device	*pdev;
 	struct global_sym_info	*adsp_glo_sym_tbl;
 	void __iomem		*hwmailbox_base;
@@ -108,6 +140,13 @@ struct nvadsp_os_data {
 
 static struct nvadsp_os_data priv;
 
+static ASYNC_DOMAIN_EXCLUSIVE(nvadsp_fw_domain);
+
+static inline u64 nvadsp_us_since(ktime_t start)
+{
+	return ktime_us_delta(ktime_get(), start);
+}
+
 struct nvadsp_mappings {
 	phys_addr_t da;
 	void *va;
@@ -566,10 +605,17 @@ static void copy_io_in_l(void *to, const void *from, int sz)
 	}
 }
 
-static int nvadsp_os_elf_load(const struct firmware *fw)
+/*
+ * Load an ELF into the ADSP memories. With cache set the cluster RAM image of
+ * the first load is kept in priv.os_image and later loads only copy it back
+ * and reload the DRAM and EVP segments, which the ADSP changes while running.
+ */
+static int nvadsp_os_elf_load(const struct firmware *fw, bool cache)
 {
 	struct device *dev = &priv.pdev->dev;
 	struct nvadsp_drv_data *drv_data = platform_get_drvdata(priv.pdev);
+	struct nvadsp_os_image *img = cache ? &priv.os_image : NULL;
+	bool reuse = img && img->valid;
 	struct elf32_hdr *ehdr;
 	struct elf32_phdr *phdr;
 	int i, ret = 0, clust_id;
@@ -603,6 +649,12 @@ static int nvadsp_os_elf_load(const struct firmware *fw)
 			goto end;
 		}
 
+		if (reuse) {
+			shadow_buf[i] = img->shadow[i];
+			cluster_mem_active[i] = img->active[i];
+			continue;
+		}
+
 		shadow_buf[i] = devm_kzalloc(dev, cluster_mem->size, GFP_KERNEL);
 		if (!shadow_buf[i]) {
 			dev_err(dev, "alloc for cluster mem failed\n");
@@ -657,6 +709,9 @@ static int nvadsp_os_elf_load(const struct firmware *fw)
 		if (filesz) {
 			clust_id = is_cluster_mem_addr(da);
 			if (clust_id != -1) {
+				/* already in the kept shadow buffer */
+				if (reuse)
+					continue;
 				cluster_mem_active[clust_id] = true;
 				memcpy(va, elf_data + offset, filesz);
 			} else if (is_adsp_dram_addr(da)) {
@@ -691,11 +746,21 @@ static int nvadsp_os_elf_load(const struct firmware *fw)
 				cluster_mem->size);
 	}
 
+	if (img && !reuse && !ret) {
+		for (i = 0; i < MAX_CLUSTER_MEM; i++) {
+			img->shadow[i] = shadow_buf[i];
+			img->active[i] = cluster_mem_active[i];
+			/* the load mappings keep pointing at it */
+			shadow_buf[i] = NULL;
+		}
+		img->valid = true;
+	}
+
 end:
 	for (i = 0; i < MAX_CLUSTER_MEM; i++) {
 		if (!IS_ERR_OR_NULL(cluster_mem_va[i]))
 			devm_memunmap(dev, cluster_mem_va[i]);
-		if (shadow_buf[i])
+		if (shadow_buf[i] && !reuse)
 			devm_kfree(dev, shadow_buf[i]);
 	}
 
@@ -961,20 +1026,45 @@ static int __nvadsp_os_secload(struct platform_device *pdev)
 	return 0;
 }
 
-static int nvadsp_firmware_load(struct platform_device *pdev)
+static void nvadsp_fw_fetch_work(void *data, async_cookie_t cookie)
+{
+	struct nvadsp_fw_fetch *fetch = data;
+
+	fetch->ret = request_firmware(&fetch->fw, fetch->name, &priv.pdev->dev);
+}
+
+/* read a firmware file in the background, see nvadsp_fw_fetch_wait() */
+static void nvadsp_fw_fetch_start(struct nvadsp_fw_fetch *fetch,
+				  const char *name)
+{
+	fetch->name = name;
+	fetch->fw = NULL;
+	fetch->ret = -ENOENT;
+	async_schedule_domain(nvadsp_fw_fetch_work, fetch, &nvadsp_fw_domain);
+}
+
+static void nvadsp_fw_fetch_wait(void)
+{
+	async_synchronize_full_domain(&nvadsp_fw_domain);
+}
+
+static int nvadsp_firmware_load(struct platform_device *pdev,
+				struct nvadsp_fw_fetch *fetch)
 {
 	struct nvadsp_shared_mem *shared_mem;
 	struct nvadsp_drv_data *drv_data = platform_get_drvdata(pdev);
 	struct device *dev = &pdev->dev;
 	const struct firmware *fw;
+	ktime_t start;
 	int ret = 0;
 
-	ret = request_firmware(&fw, drv_data->adsp_elf, dev);
+	ret = fetch->ret;
 	if (ret < 0) {
 		dev_err(dev, "reqest firmware for %s failed with %d\n",
 				drv_data->adsp_elf, ret);
 		goto end;
 	}
+	fw = fetch->fw;
 #ifdef CONFIG_ANDROID
 	ret = create_global_symbol_table(fw);
 	if (ret) {
@@ -990,7 +1080,9 @@ static int nvadsp_firmware_load(struct platform_device *pdev)
 
 	dev_info(dev, "Loading ADSP OS firmware %s\n", drv_data->adsp_elf);
 
-	ret = nvadsp_os_elf_load(fw);
+	start = ktime_get();
+	ret = nvadsp_os_elf_load(fw, true);
+	priv.boot_times.os_elf_load = nvadsp_us_since(start);
 	if (ret) {
 		dev_err(dev, "failed to load %s\n", drv_data->adsp_elf);
 		goto deallocate_os_memory;
@@ -1044,7 +1136,31 @@ end:
 dma_addr_t mfw_smem_iova[MFW_MAX_OTHER_CORES];
 void *mfw_hsp_va[MFW_MAX_OTHER_CORES];
 
-static int nvadsp_load_multi_fw(struct platform_device *pdev)
+/* start reading the FW of the other cores, empty names are skipped */
+static void nvadsp_multi_fw_fetch(struct platform_device *pdev,
+				  struct nvadsp_fw_fetch *fetch)
+{
+	struct device *dev = &pdev->dev;
+	const char *adsp_elf;
+	int i;
+
+	for (i = 0; i < MFW_MAX_OTHER_CORES; i++) {
+		fetch[i].fw = NULL;
+		fetch[i].ret = -ENOENT;
+
+		if (of_property_read_string_index(dev->of_node,
+				"nvidia,adsp_elf_multi", i, &adsp_elf))
+			continue;
+
+		if (!strcmp(adsp_elf, ""))
+			continue;
+
+		nvadsp_fw_fetch_start(&fetch[i], adsp_elf);
+	}
+}
+
+static int nvadsp_load_multi_fw(struct platform_device *pdev,
+				struct nvadsp_fw_fetch *fetch)
 {
 	struct nvadsp_drv_data *drv_data = platform_get_drvdata(pdev);
 	struct device *dev = &pdev->dev;
@@ -1098,12 +1214,13 @@ static int nvadsp_load_multi_fw(struct platform_device *pdev)
 			if (!strcmp(adsp_elf, ""))
 				continue;
 
-			ret = request_firmware(&fw, adsp_elf, dev);
+			ret = fetch[i].ret;
 			if (ret < 0) {
 				dev_err(dev, "request FW failed for %s: %d\n",
 						adsp_elf, ret);
 				continue;
 			}
+			fw = fetch[i].fw;
 
 			os_size = drv_data->adsp_mem[ADSP_OS_SIZE];
 			os_mem  = drv_data->adsp_mem[ADSP_OS_ADDR] +
@@ -1131,7 +1248,7 @@ static int nvadsp_load_multi_fw(struct platform_device *pdev)
 						dram_va, (size_t)os_size);
 
 			dev_info(dev, "Loading ADSP OS firmware %s\n", adsp_elf);
-			ret = nvadsp_os_elf_load(fw);
+			ret = nvadsp_os_elf_load(fw, false);
 			if (ret) {
 				dev_err(dev, "failed to load %s\n", adsp_elf);
 				continue;
@@ -1203,8 +1320,13 @@ static int nvadsp_load_multi_fw(struct platform_device *pdev)
 
 int nvadsp_os_load(void)
 {
+	struct nvadsp_fw_fetch os_fetch = { };
+#ifdef CONFIG_TEGRA_ADSP_MULTIPLE_FW
+	struct nvadsp_fw_fetch mfw_fetch[MFW_MAX_OTHER_CORES] = { };
+#endif
 	struct nvadsp_drv_data *drv_data;
 	struct device *dev;
+	ktime_t start;
 	int ret = 0;
 
 	if (!priv.pdev) {
@@ -1219,16 +1341,29 @@ int nvadsp_os_load(void)
 	drv_data = platform_get_drvdata(priv.pdev);
 	dev = &priv.pdev->dev;
 
+	/* read all FW files at once, loading them stays in order */
+	start = ktime_get();
+	if (!drv_data->adsp_os_secload) {
+		nvadsp_fw_fetch_start(&os_fetch, drv_data->adsp_elf);
+#ifdef CONFIG_TEGRA_ADSP_MULTIPLE_FW
+		nvadsp_multi_fw_fetch(priv.pdev, mfw_fetch);
+#endif // CONFIG_TEGRA_ADSP_MULTIPLE_FW
+		nvadsp_fw_fetch_wait();
+	}
+	priv.boot_times.fw_fetch = nvadsp_us_since(start);
+
 #ifdef CONFIG_TEGRA_ADSP_MULTIPLE_FW
 	dev_info(dev, "Loading multiple ADSP FW....\n");
-	nvadsp_load_multi_fw(priv.pdev);
+	start = ktime_get();
+	nvadsp_load_multi_fw(priv.pdev, mfw_fetch);
+	priv.boot_times.multi_fw_load = nvadsp_us_since(start);
 #endif // CONFIG_TEGRA_ADSP_MULTIPLE_FW
 
 	if (drv_data->adsp_os_secload) {
 		dev_info(dev, "ADSP OS firmware already loaded\n");
 		ret = __nvadsp_os_secload(priv.pdev);
 	} else {
-		ret = nvadsp_firmware_load(priv.pdev);
+		ret = nvadsp_firmware_load(priv.pdev, &os_fetch);
 	}
 
 	if (ret == 0) {
@@ -1560,9 +1695,13 @@ static int wait_for_adsp_os_load_complete(void)
 		data == ADSP_OS_BOOT_COMPLETE ? "BOOTED" : "RESUMED");
 
 	switch (data) {
-	case ADSP_OS_BOOT_COMPLETE:
+	case ADSP_OS_BOOT_COMPLETE: {
+		ktime_t start = ktime_get();
+
 		ret = load_adsp_static_apps();
+		priv.boot_times.static_apps = nvadsp_us_since(start);
 		break;
+	}
 	case ADSP_OS_RESUME:
 	default:
 		break;
@@ -1575,6 +1714,7 @@ static int __nvadsp_os_start(void)
 {
 	struct nvadsp_drv_data *drv_data;
 	struct device *dev;
+	ktime_t start;
 	int ret = 0;
 
 	dev = &priv.pdev->dev;
@@ -1610,12 +1750,18 @@ static int __nvadsp_os_start(void)
 
 	dev_dbg(dev, "Waiting for ADSP OS to boot up...\n");
 
+	priv.boot_times.static_apps = 0;
+	start = ktime_get();
 	ret = wait_for_adsp_os_load_complete();
 	if (ret) {
 		dev_err(dev, "Unable to start ADSP OS\n");
 		goto end;
 	}
-	dev_dbg(dev, "ADSP OS boot up... Done!\n");
+	/* static apps are timed on their own */
+	priv.boot_times.os_boot = nvadsp_us_since(start) -
+				  priv.boot_times.static_apps;
+	dev_dbg(dev, "ADSP OS boot up... Done! (%llu us)\n",
+		priv.boot_times.os_boot);
 
 #ifdef CONFIG_TEGRA_ADSP_DFS
 	ret = adsp_dfs_core_init(priv.pdev);
@@ -2287,6 +2433,7 @@ static void __nvadsp_os_stop(bool reload)
 	const struct firmware *fw = priv.os_firmware;
 	struct nvadsp_drv_data *drv_data;
 	struct device *dev;
+	ktime_t start;
 	int err = 0;
 
 	dev = &priv.pdev->dev;
@@ -2350,9 +2497,12 @@ static void __nvadsp_os_stop(bool reload)
 		logger->debug_ram_rdr[0] = EOT;
 		logger->ram_iter = 0;
 		/* load a fresh copy of adsp.elf */
-		if (nvadsp_os_elf_load(fw))
+		start = ktime_get();
+		if (nvadsp_os_elf_load(fw, true))
 			dev_err(dev, "failed to reload %s\n",
 				drv_data->adsp_elf);
+		priv.boot_times.reload = nvadsp_us_since(start);
+		priv.boot_times.reloads++;
 	}
 
  end:
@@ -2582,6 +2732,48 @@ static const struct file_operations adsp_health_fops = {
 	.poll = adsp_health_poll,
 };
 
+static int adsp_boot_times_show(struct seq_file *s, void *data)
+{
+	struct nvadsp_boot_times *t = &priv.boot_times;
+
+	seq_printf(s, "fw_fetch_us: %llu\n", t->fw_fetch);
+	seq_printf(s, "multi_fw_load_us: %llu\n", t->multi_fw_load);
+	seq_printf(s, "os_elf_load_us: %llu\n", t->os_elf_load);
+	seq_printf(s, "os_boot_us: %llu\n", t->os_boot);
+	seq_printf(s, "static_apps_us: %llu\n", t->static_apps);
+	seq_printf(s, "reload_us: %llu\n", t->reload);
+	seq_printf(s, "reloads: %u\n", t->reloads);
+	seq_printf(s, "os_image_cached: %d\n", priv.os_image.valid);
+
+	return 0;
+}
+
+static int adsp_boot_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, adsp_boot_times_show, inode->i_private);
+}
+
+static const struct file_operations adsp_boot_times_fops = {
+	.open = adsp_boot_times_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int adsp_create_boot_times(struct dentry *adsp_debugfs_root)
+{
+	struct device *dev = &priv.pdev->dev;
+	struct dentry *d;
+
+	d = debugfs_create_file("adsp_boot_times", RO_MODE, adsp_debugfs_root,
+				NULL, &adsp_boot_times_fops);
+	if (!d) {
+		dev_err(dev, "failed to create adsp_boot_times\n");
+		return -EINVAL;
+	}
+	return 0;
+}
+
 static int adsp_create_adsp_health(struct dentry *adsp_debugfs_root)
 {
 	struct device *dev = &priv.pdev->dev;
@@ -2656,6 +2848,9 @@ int __init nvadsp_os_probe(struct platform_device *pdev)
 	if (adsp_create_adsp_health(drv_data->adsp_debugfs_root))
 		dev_err(dev, "unable to create adsp_health file\n");
 
+	if (adsp_create_boot_times(drv_data->adsp_debugfs_root))
+		dev_err(dev, "unable to create adsp_boot_times file\n");
+
 	drv_data->adsp_crashed = false;
 	init_waitqueue_head(&drv_data->adsp_health_waitq);
 
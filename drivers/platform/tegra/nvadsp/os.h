@@ -179,6 +179,7 @@ struct adsp_module *load_adsp_dynamic_module(const char *, const char *,
 struct adsp_module *load_adsp_static_module(const char *,
 	struct adsp_shared_app *, struct device *);
 void unload_adsp_module(struct adsp_module *);
+void adsp_app_elf_cache_flush(void);
 
 int allocate_memory_from_adsp(void **, unsigned int);
 bool is_adsp_dram_addr(u64);
@@ -12,6 +12,8 @@
 #include <linux/dma-mapping.h>
 #include <linux/types.h>
 #include <linux/completion.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 #include "tegra23x_psc.h"
 
 /* EXT_CFG register offset */
@@ -343,6 +345,54 @@ static const struct file_operations psc_debug_fops = {
 	.unlocked_ioctl = psc_debug_ioctl,
 };
 
+/*
+ * Mailbox counters of each VM channel since the last reset. Writing
+ * anything resets them.
+ */
+static int psc_mbox_stats_show(struct seq_file *s, void *unused)
+{
+	struct psc_debug_dev *dbg = s->private;
+	struct psc_mbox_chan_stats st;
+	int i;
+
+	seq_puts(s, "chan tx_msgs tx_busy tx_polls tx_poll_avg_ns tx_poll_max_ns rx_msgs rx_invalid rx_cb_avg_ns rx_cb_max_ns\n");
+	for (i = 0; i < psc_mbox_num_chans(dbg->mbox); i++) {
+		psc_mbox_get_stats(dbg->mbox, i, &st);
+		seq_printf(s, "%d %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
+			   i, st.tx_msgs, st.tx_busy, st.tx_polls,
+			   st.tx_polls ? div64_u64(st.tx_poll_ns_total, st.tx_polls) : 0ULL,
+			   st.tx_poll_ns_max, st.rx_msgs, st.rx_invalid,
+			   st.rx_msgs ? div64_u64(st.rx_cb_ns_total, st.rx_msgs) : 0ULL,
+			   st.rx_cb_ns_max);
+	}
+
+	return 0;
+}
+
+static int psc_mbox_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, psc_mbox_stats_show, inode->i_private);
+}
+
+static ssize_t psc_mbox_stats_write(struct file *file,
+				    const char __user *buffer,
+				    size_t count, loff_t *ppos)
+{
+	struct psc_debug_dev *dbg = ((struct seq_file *)file->private_data)->private;
+
+	psc_mbox_reset_stats(dbg->mbox);
+
+	return count;
+}
+
+static const struct file_operations psc_mbox_stats_fops = {
+	.open		= psc_mbox_stats_open,
+	.read		= seq_read,
+	.write		= psc_mbox_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static void psc_chan_rx_callback(struct mbox_client *c, void *msg)
 {
 	struct device *dev = c->dev;
@@ -385,6 +435,8 @@ int psc_debugfs_create(struct platform_device *pdev, struct mbox_controller *mbo
 			(u64 *)&dbg->cl.tx_tout);
 	debugfs_create_file("mbox_dbg", 0600, debugfs_root,
 			dbg, &psc_debug_fops);
+	debugfs_create_file("mbox_stats", 0644, debugfs_root,
+			dbg, &psc_mbox_stats_fops);
 
 	dma_set_mask_and_coherent(dev, DMA_BIT_MASK(39));
 
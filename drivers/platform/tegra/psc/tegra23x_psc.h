@@ -17,6 +17,28 @@ static inline void psc_debugfs_remove(struct platform_device *pdev) { return; }
 
 struct mbox_chan *psc_mbox_request_channel0(struct mbox_controller *mbox, struct mbox_client *cl);
 
+/*
+ * Per VM channel mailbox counters. tx_polls counts sends that found the
+ * previous message still unread and polled for it, with the time spent.
+ * rx_cb_ns is the time spent in the client's rx callback.
+ */
+struct psc_mbox_chan_stats {
+	u64 tx_msgs;
+	u64 tx_busy;
+	u64 tx_polls;
+	u64 tx_poll_ns_total;
+	u64 tx_poll_ns_max;
+	u64 rx_msgs;
+	u64 rx_invalid;
+	u64 rx_cb_ns_total;
+	u64 rx_cb_ns_max;
+};
+
+int psc_mbox_num_chans(struct mbox_controller *mbox);
+void psc_mbox_get_stats(struct mbox_controller *mbox, int chan,
+			struct psc_mbox_chan_stats *stats);
+void psc_mbox_reset_stats(struct mbox_controller *mbox);
+
 #if IS_ENABLED(CONFIG_NUMA)
 #define PSC_HAVE_NUMA
 #endif
@@ -5,8 +5,11 @@
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/property.h>
 #include <linux/io.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
+#include <linux/delay.h>
 #include <linux/mailbox_controller.h>
 #include <linux/mailbox_client.h>
 
@@ -35,12 +38,16 @@
 #define MBOX_CHAN_TX	0x800
 #define MBOX_CHAN_RX	0x1000
 
+/* Upper bound on the busy wait for PSC to read out the previous message */
+#define MBOX_TX_POLL_MAX_US	1000U
+
 struct psc_mbox;
 
 struct mbox_vm_chan {
 	unsigned int irq;
 	void __iomem *base;
 	struct psc_mbox *parent;
+	struct psc_mbox_chan_stats stats;
 };
 
 struct psc_mbox {
@@ -49,6 +56,12 @@ struct psc_mbox {
 	struct mbox_chan chan[MBOX_NUM];
 	struct mbox_controller mbox;
 	struct mbox_vm_chan vm_chan[MBOX_NUM];
+	/*
+	 * When non-zero, a send that finds MBOX_IN_VALID still set polls up
+	 * to this long for PSC to consume it instead of failing with -EBUSY,
+	 * so clients can queue messages back to back.
+	 */
+	u32 tx_poll_us;
 };
 
 
@@ -109,6 +122,8 @@ static irqreturn_t psc_mbox_rx_interrupt(int irq, void *p)
 	struct device *dev = vm_chan->parent->dev;
 	u32 ext_ctrl;
 	u32 psc_ctrl;
+	ktime_t start;
+	u64 ns;
 	int i;
 
 	psc_ctrl = readl(vm_chan->base + MBOX_CHAN_PSC_CTRL);
@@ -117,13 +132,20 @@ static irqreturn_t psc_mbox_rx_interrupt(int irq, void *p)
 		ext_ctrl = readl(vm_chan->base + MBOX_CHAN_EXT_CTRL);
 		dev_err_once(dev, "invalid interrupt, psc_ctrl: 0x%08x ext_ctrl: 0x%08x\n",
 			psc_ctrl, ext_ctrl);
+		vm_chan->stats.rx_invalid++;
 		return IRQ_HANDLED;
 	}
 
 	for (i = 0; i < MBOX_MSG_SIZE; i++)
 		data[i] = readl(vm_chan->base + MBOX_CHAN_RX + i * 4);
 
+	start = ktime_get();
 	mbox_chan_received_data(chan, data);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	vm_chan->stats.rx_msgs++;
+	vm_chan->stats.rx_cb_ns_total += ns;
+	if (ns > vm_chan->stats.rx_cb_ns_max)
+		vm_chan->stats.rx_cb_ns_max = ns;
 	/* finish read */
 	ext_ctrl = readl(vm_chan->base + MBOX_CHAN_EXT_CTRL);
 	ext_ctrl |= MBOX_OUT_DONE;
@@ -142,8 +164,27 @@ static int psc_mbox_send_data(struct mbox_chan *chan, void *data)
 
 	ext_ctrl = readl0(vm_chan->base + MBOX_CHAN_EXT_CTRL);
 
+	if ((ext_ctrl & MBOX_IN_VALID) != 0 && vm_chan->parent->tx_poll_us) {
+		ktime_t start = ktime_get();
+		u64 ns;
+
+		/* Called with the channel lock held, so busy wait */
+		do {
+			udelay(1);
+			ext_ctrl = readl0(vm_chan->base + MBOX_CHAN_EXT_CTRL);
+			ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		} while ((ext_ctrl & MBOX_IN_VALID) != 0 &&
+			 ns < vm_chan->parent->tx_poll_us * NSEC_PER_USEC);
+
+		vm_chan->stats.tx_polls++;
+		vm_chan->stats.tx_poll_ns_total += ns;
+		if (ns > vm_chan->stats.tx_poll_ns_max)
+			vm_chan->stats.tx_poll_ns_max = ns;
+	}
+
 	if ((ext_ctrl & MBOX_IN_VALID) != 0) {
 		dev_err(dev, "%s:pending write.\n", __func__);
+		vm_chan->stats.tx_busy++;
 		return -EBUSY;
 	}
 	for (i = 0; i < MBOX_MSG_SIZE; i++)
@@ -151,6 +192,7 @@ static int psc_mbox_send_data(struct mbox_chan *chan, void *data)
 
 	ext_ctrl |= MBOX_IN_VALID;
 	writel0(ext_ctrl, vm_chan->base + MBOX_CHAN_EXT_CTRL);
+	vm_chan->stats.tx_msgs++;
 	return 0;
 }
 
@@ -216,6 +258,10 @@ static int tegra234_psc_probe(struct platform_device *pdev)
 	psc->vm_chan_base = base;
 	psc->dev = dev;
 
+	if (!device_property_read_u32(dev, "nvidia,tx-poll-timeout-us",
+				      &psc->tx_poll_us))
+		psc->tx_poll_us = min(psc->tx_poll_us, MBOX_TX_POLL_MAX_US);
+
 	for (i = 0; i < MBOX_NUM; i++) {
 		int irq;
 
@@ -306,6 +352,33 @@ static struct platform_driver tegra234_psc_driver = {
 	},
 };
 
+int psc_mbox_num_chans(struct mbox_controller *mbox)
+{
+	return mbox->num_chans;
+}
+
+void psc_mbox_get_stats(struct mbox_controller *mbox, int chan,
+			struct psc_mbox_chan_stats *stats)
+{
+	struct psc_mbox *psc = container_of(mbox, struct psc_mbox, mbox);
+
+	memset(stats, 0, sizeof(*stats));
+	if (chan < 0 || chan >= mbox->num_chans)
+		return;
+
+	*stats = psc->vm_chan[chan].stats;
+}
+
+void psc_mbox_reset_stats(struct mbox_controller *mbox)
+{
+	struct psc_mbox *psc = container_of(mbox, struct psc_mbox, mbox);
+	int i;
+
+	for (i = 0; i < mbox->num_chans; i++)
+		memset(&psc->vm_chan[i].stats, 0,
+		       sizeof(psc->vm_chan[i].stats));
+}
+
 struct mbox_chan *psc_mbox_request_channel0(struct mbox_controller *mbox, struct mbox_client *cl)
 {
 	struct device *dev = cl->dev;
@@ -16,26 +16,72 @@
 #define TOTAL_CHANNELS (NUM_CAPTURE_CHANNELS + NUM_CAPTURE_TRANSACTION_IDS)
 #define TRANS_ID_START_IDX NUM_CAPTURE_CHANNELS
 
+/** Depth of a per-channel dispatch queue [frames] */
+#define CAPTURE_IVC_DISPATCH_DEPTH 16U
+
 /**
- * @brief Callback context of an IVC channel.
+ * @brief Callback registered by a client, published to the dispatcher via
+ * SRCU so that message dispatch does not take any lock.
  */
-struct tegra_capture_ivc_cb_ctx {
-	/** Linked list of callback contexts */
-	struct list_head node;
+struct tegra_capture_ivc_cb {
 	/** Callback function registered by client */
 	tegra_capture_ivc_cb_func cb_func;
 	/** Private context of a VI/ISP capture context */
 	const void *priv_context;
 };
 
+/**
+ * @brief Callback context of an IVC channel.
+ */
+struct tegra_capture_ivc_cb_ctx {
+	/** Linked list of callback contexts */
+	struct list_head node;
+	/** Registered callback, NULL if idle */
+	struct tegra_capture_ivc_cb __rcu *cb;
+	/** Owning IVC channel context */
+	struct tegra_capture_ivc *civc;
+	/** Per-channel dispatch work, if the channel has a dispatch queue */
+	struct work_struct dispatch_work;
+	/** Queue of received frames awaiting dispatch */
+	struct kfifo dispatch_fifo;
+	/** Frame buffer used by the dispatch work */
+	void *dispatch_msg;
+	/** Dispatch queue occupancy high-water mark [frames] */
+	unsigned int dispatch_hwm;
+};
+
+/**
+ * @brief IVC channel statistics.
+ */
+struct tegra_capture_ivc_stats {
+	/** Messages received */
+	u64 rx_msgs;
+	/** Worker passes over the receive queue */
+	u64 rx_passes;
+	/** Passes ended by exhausting the receive budget */
+	u64 rx_budget_exhausted;
+	/** Frames received in one backlog, high-water mark */
+	unsigned int rx_hwm;
+	/** Frames received in the current backlog */
+	unsigned int rx_backlog;
+	/** Writes that had to wait for a free frame */
+	u64 tx_full;
+	/** Frames that had to wait for a full dispatch queue */
+	u64 dispatch_full;
+};
+
 /**
  * @brief IVC channel context.
  */
 struct tegra_capture_ivc {
 	/** Pointer to IVC channel */
 	struct tegra_ivc_channel *chan;
-	/** Callback context lock */
+	/** Service name */
+	const char *service;
+	/** Callback context lock, serializes callback updates */
 	struct mutex cb_ctx_lock;
+	/** SRCU domain protecting the callbacks in cb_ctx */
+	struct srcu_struct cb_srcu;
 	/** Channel write lock */
 	struct mutex ivc_wr_lock;
 	/** Deferred work */
@@ -44,6 +90,8 @@ struct tegra_capture_ivc {
 	struct kthread_worker ivc_worker;
 	/** task struct **/
 	struct task_struct *ivc_kthread;
+	/** Workqueue running the per-channel dispatch works */
+	struct workqueue_struct *dispatch_wq;
 	/** Channel work queue head */
 	wait_queue_head_t write_q;
 	/** Array holding callbacks registered by each channel */
@@ -52,6 +100,10 @@ struct tegra_capture_ivc {
 	spinlock_t avl_ctx_list_lock;
 	/** Linked list holding callback contexts */
 	struct list_head avl_ctx_list;
+	/** Channel statistics */
+	struct tegra_capture_ivc_stats stats;
+	/** debugfs statistics file */
+	struct dentry *debugfs;
 };
 
 /**
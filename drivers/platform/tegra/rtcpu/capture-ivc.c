@@ -6,6 +6,8 @@
 #include <linux/tegra-capture-ivc.h>
 
 #include <linux/completion.h>
+#include <linux/debugfs.h>
+#include <linux/kfifo.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
@@ -16,13 +18,29 @@
 #include <linux/nospec.h>
 #include <linux/kthread.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/srcu.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 #include <asm/barrier.h>
 
 #include <trace/events/tegra_capture.h>
 
 #include "capture-ivc-priv.h"
 
+static unsigned int rx_budget;
+module_param(rx_budget, uint, 0644);
+MODULE_PARM_DESC(rx_budget,
+	"Max messages dispatched per worker pass before yielding (0 = no limit)");
+
+static bool per_channel_dispatch;
+module_param(per_channel_dispatch, bool, 0444);
+MODULE_PARM_DESC(per_channel_dispatch,
+	"Run capture channel callbacks from a per-channel work item");
+
+static struct dentry *tegra_capture_ivc_debugfs_root;
+
 static int tegra_capture_ivc_tx_(struct tegra_capture_ivc *civc,
 				const void *req, size_t len)
 {
@@ -39,6 +57,9 @@ static int tegra_capture_ivc_tx_(struct tegra_capture_ivc *civc,
 	if (unlikely(ret))
 		return ret;
 
+	if (!tegra_ivc_can_write(&chan->ivc))
+		civc->stats.tx_full++;
+
 	ret = wait_event_interruptible(civc->write_q,
 				tegra_ivc_can_write(&chan->ivc));
 	if (likely(ret == 0))
@@ -80,6 +101,63 @@ static int tegra_capture_ivc_tx(struct tegra_capture_ivc *civc,
 	return ret;
 }
 
+/*
+ * Write a batch of messages while holding the IVC write lock once. Returns
+ * the number of messages written, which may be less than @count if an error
+ * occurred after the first one, or a negative errno if nothing was written.
+ */
+static int tegra_capture_ivc_tx_batch(struct tegra_capture_ivc *civc,
+				const void *reqs, size_t len, unsigned int count)
+{
+	struct tegra_capture_ivc_msg_header hdr;
+	struct tegra_ivc_channel *chan;
+	const char *ch_name;
+	unsigned int i;
+	int ret;
+
+	if (WARN_ON(len < sizeof(hdr)))
+		return -EINVAL;
+
+	chan = civc->chan;
+	if (chan == NULL || WARN_ON(!chan->is_ready))
+		return -EIO;
+
+	ch_name = dev_name(&chan->dev);
+
+	ret = mutex_lock_interruptible(&civc->ivc_wr_lock);
+	if (unlikely(ret == -EINTR))
+		return -ERESTARTSYS;
+	if (unlikely(ret))
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		const void *req = reqs + i * len;
+
+		memcpy(&hdr, req, sizeof(hdr));
+
+		if (!tegra_ivc_can_write(&chan->ivc))
+			civc->stats.tx_full++;
+
+		ret = wait_event_interruptible(civc->write_q,
+					tegra_ivc_can_write(&chan->ivc));
+		if (likely(ret == 0))
+			ret = tegra_ivc_write(&chan->ivc, NULL, req, len);
+
+		if (unlikely(ret < 0)) {
+			dev_err(&chan->dev, "tegra_ivc_write: error %d\n", ret);
+			trace_capture_ivc_send_error(ch_name, hdr.msg_id,
+						hdr.channel_id, ret);
+			break;
+		}
+
+		trace_capture_ivc_send(ch_name, hdr.msg_id, hdr.channel_id);
+	}
+
+	mutex_unlock(&civc->ivc_wr_lock);
+
+	return i > 0 ? i : ret;
+}
+
 int tegra_capture_ivc_control_submit(const void *control_desc, size_t len)
 {
 	if (WARN_ON(__scivc_control == NULL))
@@ -98,12 +176,73 @@ int tegra_capture_ivc_capture_submit(const void *capture_desc, size_t len)
 }
 EXPORT_SYMBOL(tegra_capture_ivc_capture_submit);
 
+int tegra_capture_ivc_capture_submit_batch(const void *capture_descs,
+					size_t len, unsigned int count)
+{
+	if (WARN_ON(__scivc_capture == NULL))
+		return -ENODEV;
+
+	if (count == 0)
+		return 0;
+
+	return tegra_capture_ivc_tx_batch(__scivc_capture, capture_descs,
+					len, count);
+}
+EXPORT_SYMBOL(tegra_capture_ivc_capture_submit_batch);
+
+static inline struct tegra_capture_ivc_cb *tegra_capture_ivc_cb_locked(
+	struct tegra_capture_ivc *civc, uint32_t id)
+{
+	return rcu_dereference_protected(civc->cb_ctx[id].cb,
+			lockdep_is_held(&civc->cb_ctx_lock));
+}
+
+static int tegra_capture_ivc_dispatch_alloc(
+	struct tegra_capture_ivc *civc,
+	struct tegra_capture_ivc_cb_ctx *cb_ctx)
+{
+	size_t frame_size = civc->chan->ivc.frame_size;
+	int ret;
+
+	cb_ctx->dispatch_msg = kzalloc(frame_size, GFP_KERNEL);
+	if (unlikely(cb_ctx->dispatch_msg == NULL))
+		return -ENOMEM;
+
+	ret = kfifo_alloc(&cb_ctx->dispatch_fifo,
+			CAPTURE_IVC_DISPATCH_DEPTH * frame_size, GFP_KERNEL);
+	if (unlikely(ret)) {
+		kfree(cb_ctx->dispatch_msg);
+		cb_ctx->dispatch_msg = NULL;
+		return ret;
+	}
+
+	cb_ctx->dispatch_hwm = 0;
+
+	return 0;
+}
+
+/* Called with cb_ctx_lock held, after the callback has been unpublished */
+static void tegra_capture_ivc_dispatch_free(
+	struct tegra_capture_ivc_cb_ctx *cb_ctx)
+{
+	if (cb_ctx->dispatch_msg == NULL)
+		return;
+
+	/* Frames still queued are dropped, there is no callback anymore */
+	flush_work(&cb_ctx->dispatch_work);
+
+	kfifo_free(&cb_ctx->dispatch_fifo);
+	kfree(cb_ctx->dispatch_msg);
+	cb_ctx->dispatch_msg = NULL;
+}
+
 int tegra_capture_ivc_register_control_cb(
 		tegra_capture_ivc_cb_func control_resp_cb,
 		uint32_t *trans_id, const void *priv_context)
 {
 	struct tegra_capture_ivc *civc;
 	struct tegra_capture_ivc_cb_ctx *cb_ctx;
+	struct tegra_capture_ivc_cb *cb;
 	size_t ctx_id;
 	int ret;
 
@@ -117,9 +256,16 @@ int tegra_capture_ivc_register_control_cb(
 
 	civc = __scivc_control;
 
+	cb = kmalloc(sizeof(*cb), GFP_KERNEL);
+	if (unlikely(cb == NULL))
+		return -ENOMEM;
+
+	cb->cb_func = control_resp_cb;
+	cb->priv_context = priv_context;
+
 	ret = tegra_ivc_channel_runtime_get(civc->chan);
 	if (unlikely(ret < 0))
-		return ret;
+		goto free;
 
 	spin_lock(&civc->avl_ctx_list_lock);
 	if (unlikely(list_empty(&civc->avl_ctx_list))) {
@@ -146,14 +292,14 @@ int tegra_capture_ivc_register_control_cb(
 
 	mutex_lock(&civc->cb_ctx_lock);
 
-	if (WARN(cb_ctx->cb_func != NULL, "cb_ctx is busy")) {
+	if (WARN(tegra_capture_ivc_cb_locked(civc, ctx_id) != NULL,
+			"cb_ctx is busy")) {
 		ret = -EIO;
 		goto locked_fail;
 	}
 
 	*trans_id = (uint32_t)ctx_id;
-	cb_ctx->cb_func = control_resp_cb;
-	cb_ctx->priv_context = priv_context;
+	rcu_assign_pointer(cb_ctx->cb, cb);
 
 	mutex_unlock(&civc->cb_ctx_lock);
 
@@ -163,6 +309,8 @@ locked_fail:
 	mutex_unlock(&civc->cb_ctx_lock);
 fail:
 	tegra_ivc_channel_runtime_put(civc->chan);
+free:
+	kfree(cb);
 	return ret;
 }
 EXPORT_SYMBOL(tegra_capture_ivc_register_control_cb);
@@ -170,6 +318,7 @@ EXPORT_SYMBOL(tegra_capture_ivc_register_control_cb);
 int tegra_capture_ivc_notify_chan_id(uint32_t chan_id, uint32_t trans_id)
 {
 	struct tegra_capture_ivc *civc;
+	struct tegra_capture_ivc_cb *cb;
 
 	if (WARN(chan_id >= NUM_CAPTURE_CHANNELS, "invalid chan_id"))
 		return -EINVAL;
@@ -186,26 +335,26 @@ int tegra_capture_ivc_notify_chan_id(uint32_t chan_id, uint32_t trans_id)
 
 	mutex_lock(&civc->cb_ctx_lock);
 
-	if (WARN(civc->cb_ctx[trans_id].cb_func == NULL,
+	cb = tegra_capture_ivc_cb_locked(civc, trans_id);
+	if (WARN(cb == NULL,
 			"transaction context at %u is idle", trans_id)) {
 		mutex_unlock(&civc->cb_ctx_lock);
 		return -EBADF;
 	}
 
-	if (WARN(civc->cb_ctx[chan_id].cb_func != NULL,
+	if (WARN(tegra_capture_ivc_cb_locked(civc, chan_id) != NULL,
 			"channel context at %u is busy", chan_id)) {
 		mutex_unlock(&civc->cb_ctx_lock);
 		return -EBUSY;
 	}
 
-	/* Update cb_ctx index */
-	civc->cb_ctx[chan_id].cb_func = civc->cb_ctx[trans_id].cb_func;
-	civc->cb_ctx[chan_id].priv_context =
-			civc->cb_ctx[trans_id].priv_context;
-
-	/* Reset trans_id cb_ctx fields */
-	civc->cb_ctx[trans_id].cb_func = NULL;
-	civc->cb_ctx[trans_id].priv_context = NULL;
+	/*
+	 * Move the callback to the chan_id slot. A dispatcher still holding
+	 * it via the trans_id slot calls the same callback, so there is no
+	 * need to wait for a grace period here.
+	 */
+	rcu_assign_pointer(civc->cb_ctx[chan_id].cb, cb);
+	RCU_INIT_POINTER(civc->cb_ctx[trans_id].cb, NULL);
 
 	mutex_unlock(&civc->cb_ctx_lock);
 
@@ -222,6 +371,7 @@ int tegra_capture_ivc_register_capture_cb(
 		uint32_t chan_id, const void *priv_context)
 {
 	struct tegra_capture_ivc *civc;
+	struct tegra_capture_ivc_cb *cb;
 	int ret;
 
 	if (WARN(capture_status_ind_cb == NULL, "callback function is NULL"))
@@ -237,26 +387,42 @@ int tegra_capture_ivc_register_capture_cb(
 
 	civc = __scivc_capture;
 
+	cb = kmalloc(sizeof(*cb), GFP_KERNEL);
+	if (unlikely(cb == NULL))
+		return -ENOMEM;
+
+	cb->cb_func = capture_status_ind_cb;
+	cb->priv_context = priv_context;
+
 	ret = tegra_ivc_channel_runtime_get(civc->chan);
 	if (ret < 0)
-		return ret;
+		goto free;
 
 	mutex_lock(&civc->cb_ctx_lock);
 
-	if (WARN(civc->cb_ctx[chan_id].cb_func != NULL,
+	if (WARN(tegra_capture_ivc_cb_locked(civc, chan_id) != NULL,
 			"capture channel %u is busy", chan_id)) {
 		ret = -EBUSY;
 		goto fail;
 	}
 
-	civc->cb_ctx[chan_id].cb_func = capture_status_ind_cb;
-	civc->cb_ctx[chan_id].priv_context = priv_context;
+	if (civc->dispatch_wq != NULL) {
+		ret = tegra_capture_ivc_dispatch_alloc(civc,
+				&civc->cb_ctx[chan_id]);
+		if (ret < 0)
+			goto fail;
+	}
+
+	/* Publish after the dispatch queue is set up */
+	rcu_assign_pointer(civc->cb_ctx[chan_id].cb, cb);
 	mutex_unlock(&civc->cb_ctx_lock);
 
 	return 0;
 fail:
 	mutex_unlock(&civc->cb_ctx_lock);
 	tegra_ivc_channel_runtime_put(civc->chan);
+free:
+	kfree(cb);
 
 	return ret;
 }
@@ -265,6 +431,7 @@ EXPORT_SYMBOL(tegra_capture_ivc_register_capture_cb);
 int tegra_capture_ivc_unregister_control_cb(uint32_t id)
 {
 	struct tegra_capture_ivc *civc;
+	struct tegra_capture_ivc_cb *cb;
 
 	/* id could be temporary trans_id or rtcpu-allocated chan_id */
 	if (WARN(id >= TOTAL_CHANNELS, "invalid id %u", id))
@@ -278,17 +445,21 @@ int tegra_capture_ivc_unregister_control_cb(uint32_t id)
 
 	mutex_lock(&civc->cb_ctx_lock);
 
-	if (WARN(civc->cb_ctx[id].cb_func == NULL,
-			"control channel %u is idle", id)) {
+	cb = tegra_capture_ivc_cb_locked(civc, id);
+	if (WARN(cb == NULL, "control channel %u is idle", id)) {
 		mutex_unlock(&civc->cb_ctx_lock);
 		return -EBADF;
 	}
 
-	civc->cb_ctx[id].cb_func = NULL;
-	civc->cb_ctx[id].priv_context = NULL;
+	RCU_INIT_POINTER(civc->cb_ctx[id].cb, NULL);
+
+	/* The callback must not be running once we return */
+	synchronize_srcu(&civc->cb_srcu);
 
 	mutex_unlock(&civc->cb_ctx_lock);
 
+	kfree(cb);
+
 	/*
 	 * If it's trans_id, client encountered an error before or during
 	 * chan_id update, in that case the corresponding cb_ctx
@@ -309,6 +480,7 @@ EXPORT_SYMBOL(tegra_capture_ivc_unregister_control_cb);
 int tegra_capture_ivc_unregister_capture_cb(uint32_t chan_id)
 {
 	struct tegra_capture_ivc *civc;
+	struct tegra_capture_ivc_cb *cb;
 
 	if (chan_id >= NUM_CAPTURE_CHANNELS)
 		return -EINVAL;
@@ -322,55 +494,130 @@ int tegra_capture_ivc_unregister_capture_cb(uint32_t chan_id)
 
 	mutex_lock(&civc->cb_ctx_lock);
 
-	if (WARN(civc->cb_ctx[chan_id].cb_func == NULL,
-			"capture channel %u is idle", chan_id)) {
+	cb = tegra_capture_ivc_cb_locked(civc, chan_id);
+	if (WARN(cb == NULL, "capture channel %u is idle", chan_id)) {
 		mutex_unlock(&civc->cb_ctx_lock);
 		return -EBADF;
 	}
 
-	civc->cb_ctx[chan_id].cb_func = NULL;
-	civc->cb_ctx[chan_id].priv_context = NULL;
+	RCU_INIT_POINTER(civc->cb_ctx[chan_id].cb, NULL);
+
+	/* The callback must not be running once we return */
+	synchronize_srcu(&civc->cb_srcu);
+	tegra_capture_ivc_dispatch_free(&civc->cb_ctx[chan_id]);
 
 	mutex_unlock(&civc->cb_ctx_lock);
 
+	kfree(cb);
+
 	tegra_ivc_channel_runtime_put(civc->chan);
 
 	return 0;
 }
 EXPORT_SYMBOL(tegra_capture_ivc_unregister_capture_cb);
 
+static void tegra_capture_ivc_dispatch_work(struct work_struct *work)
+{
+	struct tegra_capture_ivc_cb_ctx *cb_ctx = container_of(work,
+			struct tegra_capture_ivc_cb_ctx, dispatch_work);
+	struct tegra_capture_ivc *civc = cb_ctx->civc;
+	size_t frame_size = civc->chan->ivc.frame_size;
+	const struct tegra_capture_ivc_cb *cb;
+	int idx;
+
+	while (kfifo_out(&cb_ctx->dispatch_fifo, cb_ctx->dispatch_msg,
+			frame_size) == frame_size) {
+		idx = srcu_read_lock(&civc->cb_srcu);
+		cb = srcu_dereference(cb_ctx->cb, &civc->cb_srcu);
+		if (likely(cb != NULL))
+			cb->cb_func(cb_ctx->dispatch_msg, cb->priv_context);
+		srcu_read_unlock(&civc->cb_srcu, idx);
+	}
+}
+
+static void tegra_capture_ivc_dispatch_queue(
+	struct tegra_capture_ivc *civc,
+	struct tegra_capture_ivc_cb_ctx *cb_ctx,
+	const void *msg)
+{
+	size_t frame_size = civc->chan->ivc.frame_size;
+	unsigned int depth;
+
+	/* Keep the frame order; wait for the channel to catch up */
+	if (unlikely(kfifo_avail(&cb_ctx->dispatch_fifo) < frame_size)) {
+		civc->stats.dispatch_full++;
+		flush_work(&cb_ctx->dispatch_work);
+	}
+
+	kfifo_in(&cb_ctx->dispatch_fifo, msg, frame_size);
+
+	depth = kfifo_len(&cb_ctx->dispatch_fifo) / frame_size;
+	if (depth > cb_ctx->dispatch_hwm)
+		cb_ctx->dispatch_hwm = depth;
+
+	queue_work(civc->dispatch_wq, &cb_ctx->dispatch_work);
+}
+
 static inline void tegra_capture_ivc_recv_msg(
 	struct tegra_capture_ivc *civc,
 	uint32_t id,
 	const void *msg)
 {
+	struct tegra_capture_ivc_cb_ctx *cb_ctx = &civc->cb_ctx[id];
 	struct device *dev = &civc->chan->dev;
+	const struct tegra_capture_ivc_cb *cb;
+	int idx;
+
+	idx = srcu_read_lock(&civc->cb_srcu);
+
+	cb = srcu_dereference(cb_ctx->cb, &civc->cb_srcu);
 
 	/* Check if callback function available */
-	if (unlikely(!civc->cb_ctx[id].cb_func)) {
+	if (unlikely(cb == NULL)) {
 		dev_dbg(dev, "No callback for id %u\n", id);
+	} else if (cb_ctx->dispatch_msg != NULL) {
+		/* Hand over to the per-channel dispatch work */
+		tegra_capture_ivc_dispatch_queue(civc, cb_ctx, msg);
 	} else {
 		/* Invoke client callback. */
-		civc->cb_ctx[id].cb_func(msg, civc->cb_ctx[id].priv_context);
+		cb->cb_func(msg, cb->priv_context);
 	}
+
+	srcu_read_unlock(&civc->cb_srcu, idx);
 }
 
-static inline void tegra_capture_ivc_recv(struct tegra_capture_ivc *civc)
+/*
+ * Drain the receive queue, up to rx_budget messages if set. Returns true if
+ * the budget ran out with messages still pending.
+ */
+static inline bool tegra_capture_ivc_recv(struct tegra_capture_ivc *civc)
 {
 	struct tegra_ivc *ivc = &civc->chan->ivc;
 	struct device *dev = &civc->chan->dev;
+	struct tegra_capture_ivc_stats *stats = &civc->stats;
+	unsigned int budget = READ_ONCE(rx_budget);
 	const void *msg;
 	const struct tegra_capture_ivc_msg_header *hdr;
+	unsigned int count = 0;
+	bool more = false;
 	uint32_t id;
 
 	while (tegra_ivc_can_read(ivc)) {
 #if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP) /* Linux 6.2 */
 		struct iosys_map map;
 		int err;
+#endif
+
+		if (budget != 0U && count >= budget) {
+			more = true;
+			break;
+		}
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP) /* Linux 6.2 */
 		err = tegra_ivc_read_get_next_frame(ivc, &map);
 		if (err) {
 			dev_err(dev, "Failed to get next frame for read\n");
-			return;
+			break;
 		}
 		msg = map.vaddr;
 #else
@@ -390,7 +637,25 @@ static inline void tegra_capture_ivc_recv(struct tegra_capture_ivc *civc)
 		}
 
 		tegra_ivc_read_advance(ivc);
+		count++;
+	}
+
+	if (count != 0U)
+		trace_capture_ivc_rx_depth(dev_name(dev), count, more);
+
+	stats->rx_msgs += count;
+	stats->rx_passes++;
+	stats->rx_backlog += count;
+
+	if (more) {
+		stats->rx_budget_exhausted++;
+	} else {
+		if (stats->rx_backlog > stats->rx_hwm)
+			stats->rx_hwm = stats->rx_backlog;
+		stats->rx_backlog = 0;
 	}
+
+	return more;
 }
 
 static void tegra_capture_ivc_worker(struct kthread_work *work)
@@ -409,7 +674,9 @@ static void tegra_capture_ivc_worker(struct kthread_work *work)
 	if (pm_runtime_get_if_in_use(&chan->dev) > 0) {
 		WARN_ON(!chan->is_ready);
 
-		tegra_capture_ivc_recv(civc);
+		/* Out of budget: requeue behind any other queued work */
+		if (tegra_capture_ivc_recv(civc))
+			kthread_queue_work(&civc->ivc_worker, &civc->work);
 
 		pm_runtime_put(&chan->dev);
 	} else {
@@ -428,6 +695,35 @@ static void tegra_capture_ivc_notify(struct tegra_ivc_channel *chan)
 	kthread_queue_work(&civc->ivc_worker, &civc->work);
 }
 
+static int tegra_capture_ivc_stats_show(struct seq_file *s, void *data)
+{
+	struct tegra_capture_ivc *civc = s->private;
+	const struct tegra_capture_ivc_stats *stats = &civc->stats;
+	unsigned int i;
+
+	seq_printf(s, "rx_msgs: %llu\n", stats->rx_msgs);
+	seq_printf(s, "rx_passes: %llu\n", stats->rx_passes);
+	seq_printf(s, "rx_budget: %u\n", READ_ONCE(rx_budget));
+	seq_printf(s, "rx_budget_exhausted: %llu\n",
+			stats->rx_budget_exhausted);
+	seq_printf(s, "rx_hwm: %u\n", stats->rx_hwm);
+	seq_printf(s, "tx_full: %llu\n", stats->tx_full);
+
+	if (civc->dispatch_wq == NULL)
+		return 0;
+
+	seq_printf(s, "dispatch_full: %llu\n", stats->dispatch_full);
+
+	for (i = 0; i < NUM_CAPTURE_CHANNELS; i++) {
+		if (civc->cb_ctx[i].dispatch_hwm != 0U)
+			seq_printf(s, "ch%u dispatch_hwm: %u\n", i,
+					civc->cb_ctx[i].dispatch_hwm);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tegra_capture_ivc_stats);
+
 #define NV(x) "nvidia," #x
 
 static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
@@ -450,10 +746,15 @@ static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
 	}
 
 	civc->chan = chan;
+	civc->service = service;
 
 	mutex_init(&civc->cb_ctx_lock);
 	mutex_init(&civc->ivc_wr_lock);
 
+	ret = init_srcu_struct(&civc->cb_srcu);
+	if (unlikely(ret))
+		return ret;
+
 	/* Initialize kworker */
 	kthread_init_work(&civc->work, tegra_capture_ivc_worker);
 
@@ -464,7 +765,7 @@ static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
 	if (IS_ERR(civc->ivc_kthread)) {
 		dev_err(dev, "Cannot allocate ivc worker thread\n");
 		ret = PTR_ERR(civc->ivc_kthread);
-		goto err;
+		goto err_srcu;
 	}
 	sched_set_fifo_low(civc->ivc_kthread);
 	wake_up_process(civc->ivc_kthread);
@@ -480,6 +781,12 @@ static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
 	for (i = TRANS_ID_START_IDX; i < ARRAY_SIZE(civc->cb_ctx); i++)
 		list_add_tail(&civc->cb_ctx[i].node, &civc->avl_ctx_list);
 
+	for (i = 0; i < ARRAY_SIZE(civc->cb_ctx); i++) {
+		civc->cb_ctx[i].civc = civc;
+		INIT_WORK(&civc->cb_ctx[i].dispatch_work,
+				tegra_capture_ivc_dispatch_work);
+	}
+
 	tegra_ivc_channel_set_drvdata(chan, civc);
 
 	if (!strcmp("capture-control", service)) {
@@ -493,6 +800,14 @@ static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
 			ret = -EEXIST;
 			goto err_service;
 		}
+		if (per_channel_dispatch) {
+			civc->dispatch_wq = alloc_workqueue("%s-dispatch",
+					WQ_HIGHPRI | WQ_UNBOUND, 0, service);
+			if (civc->dispatch_wq == NULL) {
+				ret = -ENOMEM;
+				goto err_service;
+			}
+		}
 		__scivc_capture = civc;
 	} else {
 		dev_err(dev, "Unknown ivc channel %s\n", service);
@@ -500,11 +815,19 @@ static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
 		goto err_service;
 	}
 
+	if (tegra_capture_ivc_debugfs_root == NULL)
+		tegra_capture_ivc_debugfs_root =
+			debugfs_create_dir("tegra_capture_ivc", NULL);
+	civc->debugfs = debugfs_create_file(service, 0444,
+			tegra_capture_ivc_debugfs_root, civc,
+			&tegra_capture_ivc_stats_fops);
+
 	return 0;
 
 err_service:
 	kthread_stop(civc->ivc_kthread);
-err:
+err_srcu:
+	cleanup_srcu_struct(&civc->cb_srcu);
 	return ret;
 }
 
@@ -512,15 +835,27 @@ static void tegra_capture_ivc_remove(struct tegra_ivc_channel *chan)
 {
 	struct tegra_capture_ivc *civc = tegra_ivc_channel_get_drvdata(chan);
 
+	debugfs_remove(civc->debugfs);
+
 	kthread_flush_worker(&civc->ivc_worker);
 	kthread_stop(civc->ivc_kthread);
 
+	if (civc->dispatch_wq != NULL)
+		destroy_workqueue(civc->dispatch_wq);
+
+	cleanup_srcu_struct(&civc->cb_srcu);
+
 	if (__scivc_control == civc)
 		__scivc_control = NULL;
 	else if (__scivc_capture == civc)
 		__scivc_capture = NULL;
 	else
 		dev_warn(&chan->dev, "Unknown ivc channel\n");
+
+	if (__scivc_control == NULL && __scivc_capture == NULL) {
+		debugfs_remove(tegra_capture_ivc_debugfs_root);
+		tegra_capture_ivc_debugfs_root = NULL;
+	}
 }
 
 static struct of_device_id tegra_capture_ivc_channel_of_match[] = {
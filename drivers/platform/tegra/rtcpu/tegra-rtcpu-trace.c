@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: GPL-2.0
 // Copyright (c) 2022-2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
 
+#include <nvidia/conftest.h>
+
 #include "soc/tegra/camrtc-trace.h"
 
 #include <linux/completion.h>
@@ -10,16 +12,19 @@
 #include <linux/ioport.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/nospec.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/of_reserved_mem.h>
+#include <linux/poll.h>
 #include <linux/printk.h>
 #include <linux/seq_buf.h>
 #include <linux/slab.h>
 #include <linux/tegra-camera-rtcpu.h>
 #include <linux/tegra-rtcpu-trace.h>
+#include <linux/uaccess.h>
 #include <linux/workqueue.h>
 #include <linux/platform_device.h>
 #include <linux/nvhost.h>
@@ -37,12 +42,62 @@ EXPORT_TRACEPOINT_SYMBOL_GPL(capture_ivc_send);
 EXPORT_TRACEPOINT_SYMBOL_GPL(capture_ivc_send_error);
 EXPORT_TRACEPOINT_SYMBOL_GPL(capture_ivc_notify);
 EXPORT_TRACEPOINT_SYMBOL_GPL(capture_ivc_recv);
+EXPORT_TRACEPOINT_SYMBOL_GPL(capture_ivc_rx_depth);
 
 #define NV(p) "nvidia," #p
 
 #define WORK_INTERVAL_DEFAULT		100
 #define EXCEPTION_STR_LENGTH		2048
 
+/* RTCPU event timestamps come from the 31.25 MHz TKE TSC */
+#define RTCPU_TSC_NS_PER_TICK		32
+#define LOAD_CAPTURE_CHANNELS		64
+
+static bool decode_events = true;
+module_param(decode_events, bool, 0444);
+MODULE_PARM_DESC(decode_events,
+	"Decode trace events to ftrace/printk (runtime switch in debugfs)");
+
+/*
+ * Load sampling: RCE utilization derived from the RTOS low power idle
+ * events and per channel SOF to EOF latency from the capture events.
+ * Accumulated while the events are decoded, published once per worker
+ * pass.
+ */
+
+struct rtcpu_trace_channel_load {
+	u64 sof_tstamp;
+	u32 sof_sequence;
+	u64 frames;
+	u64 errors;
+	u64 latency_ns;
+	u64 latency_max_ns;
+};
+
+struct rtcpu_trace_load {
+	/* current window, in TSC ticks */
+	u64 window_start;
+	u64 last_tstamp;
+	u64 idle_begin;
+	u64 idle_ticks;
+	u32 events;
+	u32 backlog_max;
+	bool idle_seen;
+
+	/* published at the end of each window */
+	int load_permille;
+	int load_max_permille;
+	unsigned long backlog;
+	unsigned long capture_latency_max_us;
+
+	struct rtcpu_trace_channel_load ch[LOAD_CAPTURE_CHANNELS];
+
+	struct dev_ext_attribute attrs[4];
+	struct attribute *attr_ptrs[5];
+	struct attribute_group group;
+	bool sysfs;
+};
+
 /*
  * Private driver data structure
  */
@@ -82,6 +137,12 @@ struct tegra_rtcpu_trace {
 	u32 n_exceptions;
 	u64 n_events;
 
+	/* decode events in the kernel, otherwise only track the ring */
+	bool decode;
+	struct rtcpu_trace_load load;
+	/* raw ring readers waiting for new events */
+	wait_queue_head_t raw_wq;
+
 	/* copy of the latest exception and event */
 	char last_exception_str[EXCEPTION_STR_LENGTH];
 	struct camrtc_event_struct copy_last_event;
@@ -1179,6 +1240,117 @@ static void rtcpu_trace_event(struct tegra_rtcpu_trace *tracer,
 	}
 }
 
+static void rtcpu_trace_load_event(struct rtcpu_trace_load *load,
+	const struct camrtc_event_struct *event)
+{
+	const struct capture_event *ev = (const void *)&event->data;
+	u64 tstamp = event->header.tstamp;
+	struct rtcpu_trace_channel_load *ch;
+	u64 latency;
+
+	if (load->window_start == 0)
+		load->window_start = tstamp;
+	if (tstamp > load->last_tstamp)
+		load->last_tstamp = tstamp;
+	load->events++;
+
+	switch (event->header.id) {
+	case camrtc_trace_rtos_low_power_idle_begin:
+		load->idle_seen = true;
+		load->idle_begin = tstamp;
+		break;
+	case camrtc_trace_rtos_low_power_idle_end:
+		load->idle_seen = true;
+		if (load->idle_begin != 0 && tstamp > load->idle_begin)
+			load->idle_ticks += tstamp - load->idle_begin;
+		load->idle_begin = 0;
+		break;
+	case camrtc_trace_capture_event_sof:
+		if (ev->progress.channel_id >= LOAD_CAPTURE_CHANNELS)
+			break;
+		ch = &load->ch[array_index_nospec(ev->progress.channel_id,
+				LOAD_CAPTURE_CHANNELS)];
+		ch->sof_tstamp = tstamp;
+		ch->sof_sequence = ev->progress.sequence;
+		break;
+	case camrtc_trace_capture_event_eof:
+		if (ev->progress.channel_id >= LOAD_CAPTURE_CHANNELS)
+			break;
+		ch = &load->ch[array_index_nospec(ev->progress.channel_id,
+				LOAD_CAPTURE_CHANNELS)];
+		if (ch->sof_tstamp == 0 || tstamp < ch->sof_tstamp ||
+				ch->sof_sequence != ev->progress.sequence)
+			break;
+		latency = (tstamp - ch->sof_tstamp) * RTCPU_TSC_NS_PER_TICK;
+		ch->latency_ns = latency;
+		ch->latency_max_ns = max(ch->latency_max_ns, latency);
+		ch->frames++;
+		ch->sof_tstamp = 0;
+		break;
+	case camrtc_trace_capture_event_error:
+		if (ev->progress.channel_id >= LOAD_CAPTURE_CHANNELS)
+			break;
+		load->ch[array_index_nospec(ev->progress.channel_id,
+				LOAD_CAPTURE_CHANNELS)].errors++;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Close the current window. The load is unknown until the RTOS has
+ * reported idle at least once, as firmware without idle tracing would
+ * otherwise show up as saturated.
+ */
+static void rtcpu_trace_load_sample(struct tegra_rtcpu_trace *tracer)
+{
+	struct rtcpu_trace_load *load = &tracer->load;
+	u64 end, window, latency_max = 0;
+	int permille = -1;
+	unsigned int i;
+
+	mutex_lock(&tracer->lock);
+
+	end = load->last_tstamp;
+	window = end - load->window_start;
+
+	if (load->idle_seen && load->window_start != 0) {
+		if (load->idle_begin != 0 && end > load->idle_begin) {
+			load->idle_ticks += end - load->idle_begin;
+			load->idle_begin = end;
+		}
+		if (window != 0)
+			permille = 1000 - (int)div64_u64(
+				min(load->idle_ticks, window) * 1000, window);
+		else if (load->idle_begin != 0)
+			permille = 0;
+	}
+
+	for (i = 0; i < LOAD_CAPTURE_CHANNELS; i++) {
+		latency_max = max(latency_max, load->ch[i].latency_max_ns);
+		load->ch[i].latency_max_ns = 0;
+	}
+
+	trace_rtcpu_load(permille, window * RTCPU_TSC_NS_PER_TICK,
+		load->events, load->backlog_max, latency_max);
+
+	WRITE_ONCE(load->load_permille, permille);
+	if (permille > load->load_max_permille)
+		WRITE_ONCE(load->load_max_permille, permille);
+	WRITE_ONCE(load->backlog, load->backlog_max);
+	WRITE_ONCE(load->capture_latency_max_us,
+		(unsigned long)div_u64(latency_max, NSEC_PER_USEC));
+
+	if (load->window_start != 0)
+		load->window_start = end;
+	load->idle_ticks = 0;
+	load->events = 0;
+	load->backlog_max = 0;
+
+	mutex_unlock(&tracer->lock);
+}
+
 static inline void rtcpu_trace_events(struct tegra_rtcpu_trace *tracer)
 {
 	const struct camrtc_trace_memory_header *header = tracer->trace_memory;
@@ -1199,26 +1371,43 @@ static inline void rtcpu_trace_events(struct tegra_rtcpu_trace *tracer)
 	if (old_next == new_next)
 		return;
 
+	tracer->load.backlog_max = max(tracer->load.backlog_max,
+			(new_next + tracer->event_entries - old_next) %
+			tracer->event_entries);
+
 	rtcpu_trace_invalidate_entries(tracer,
 				tracer->dma_handle_events,
 				old_next, new_next,
 				CAMRTC_TRACE_EVENT_SIZE,
 				tracer->event_entries);
 
+	if (!READ_ONCE(tracer->decode)) {
+		/* leave the events to raw ring readers */
+		tracer->n_events += (new_next + tracer->event_entries -
+				old_next) % tracer->event_entries;
+		last_event = &tracer->events[(new_next == 0 ?
+				tracer->event_entries : new_next) - 1];
+		goto done;
+	}
+
 	/* pull events */
 	while (old_next != new_next) {
 		old_next = array_index_nospec(old_next, tracer->event_entries);
 		event = &tracer->events[old_next];
 		last_event = event;
 		rtcpu_trace_event(tracer, event);
+		rtcpu_trace_load_event(&tracer->load, event);
 		tracer->n_events++;
 
 		if (++old_next == tracer->event_entries)
 			old_next = 0;
 	}
 
+done:
 	tracer->event_last_idx = new_next;
 	tracer->copy_last_event = *last_event;
+
+	wake_up_interruptible(&tracer->raw_wq);
 }
 
 void tegra_rtcpu_trace_flush(struct tegra_rtcpu_trace *tracer)
@@ -1247,6 +1436,7 @@ static void rtcpu_trace_worker(struct work_struct *work)
 	tracer = container_of(work, struct tegra_rtcpu_trace, work.work);
 
 	tegra_rtcpu_trace_flush(tracer);
+	rtcpu_trace_load_sample(tracer);
 
 	/* reschedule */
 	schedule_delayed_work(&tracer->work, tracer->work_interval_jiffies);
@@ -1341,6 +1531,132 @@ static int rtcpu_trace_debugfs_last_event_read(
 DEFINE_SEQ_FOPS(rtcpu_trace_debugfs_last_event,
 	rtcpu_trace_debugfs_last_event_read);
 
+static int rtcpu_trace_debugfs_load_read(
+	struct seq_file *file, void *data)
+{
+	struct tegra_rtcpu_trace *tracer = file->private;
+	const struct rtcpu_trace_load *load = &tracer->load;
+	const struct rtcpu_trace_channel_load *ch;
+	unsigned int i;
+
+	mutex_lock(&tracer->lock);
+
+	seq_printf(file, "Load: %d\nLoad max: %d\nBacklog: %lu\n",
+		load->load_permille, load->load_max_permille, load->backlog);
+	seq_printf(file, "Capture latency max: %lu us\n",
+		load->capture_latency_max_us);
+
+	for (i = 0; i < LOAD_CAPTURE_CHANNELS; i++) {
+		ch = &load->ch[i];
+		if (ch->frames == 0 && ch->errors == 0)
+			continue;
+		seq_printf(file, "ch%u frames:%llu errors:%llu latency:%llu us\n",
+			i, ch->frames, ch->errors,
+			div_u64(ch->latency_ns, NSEC_PER_USEC));
+	}
+
+	mutex_unlock(&tracer->lock);
+
+	return 0;
+}
+
+DEFINE_SEQ_FOPS(rtcpu_trace_debugfs_load, rtcpu_trace_debugfs_load_read);
+
+/*
+ * Raw trace ring: mmap() maps the whole trace memory read-only, starting
+ * with struct camrtc_trace_memory_header, whose event_next_idx is the
+ * head of the event ring. poll() reports readable once new events have
+ * been seen by the worker since the last read(), and read() returns the
+ * current head index and the total number of events as
+ * "<event_next_idx> <events>\n".
+ */
+
+static int rtcpu_trace_raw_open(struct inode *inode, struct file *file)
+{
+	u64 *seen;
+
+	seen = kzalloc(sizeof(*seen), GFP_KERNEL);
+	if (seen == NULL)
+		return -ENOMEM;
+
+	file->private_data = seen;
+
+	return nonseekable_open(inode, file);
+}
+
+static int rtcpu_trace_raw_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+
+	return 0;
+}
+
+static ssize_t rtcpu_trace_raw_read(struct file *file, char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	struct tegra_rtcpu_trace *tracer = file_inode(file)->i_private;
+	u64 *seen = file->private_data;
+	char str[32];
+	int len;
+
+	mutex_lock(&tracer->lock);
+	*seen = tracer->n_events;
+	len = scnprintf(str, sizeof(str), "%u %llu\n",
+			tracer->event_last_idx, tracer->n_events);
+	mutex_unlock(&tracer->lock);
+
+	if (count < len)
+		return -EINVAL;
+
+	if (copy_to_user(buf, str, len))
+		return -EFAULT;
+
+	return len;
+}
+
+static __poll_t rtcpu_trace_raw_poll(struct file *file, poll_table *wait)
+{
+	struct tegra_rtcpu_trace *tracer = file_inode(file)->i_private;
+	u64 *seen = file->private_data;
+
+	poll_wait(file, &tracer->raw_wq, wait);
+
+	if (READ_ONCE(tracer->n_events) != *seen)
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
+static int rtcpu_trace_raw_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct tegra_rtcpu_trace *tracer = file_inode(file)->i_private;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start >
+			PAGE_ALIGN(tracer->trace_memory_size))
+		return -EINVAL;
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	return dma_mmap_coherent(tracer->dev, vma, tracer->trace_memory,
+			tracer->dma_handle, tracer->trace_memory_size);
+}
+
+static const struct file_operations rtcpu_trace_debugfs_raw = {
+	.open = rtcpu_trace_raw_open,
+	.release = rtcpu_trace_raw_release,
+	.read = rtcpu_trace_raw_read,
+	.poll = rtcpu_trace_raw_poll,
+	.mmap = rtcpu_trace_raw_mmap,
+	.llseek = no_llseek,
+};
+
 static void rtcpu_trace_debugfs_deinit(struct tegra_rtcpu_trace *tracer)
 {
 	debugfs_remove_recursive(tracer->debugfs_root);
@@ -1369,12 +1685,71 @@ static void rtcpu_trace_debugfs_init(struct tegra_rtcpu_trace *tracer)
 	if (IS_ERR_OR_NULL(entry))
 		goto failed_create;
 
+	entry = debugfs_create_file("raw", S_IRUGO,
+	    tracer->debugfs_root, tracer, &rtcpu_trace_debugfs_raw);
+	if (IS_ERR_OR_NULL(entry))
+		goto failed_create;
+
+	entry = debugfs_create_file("load", S_IRUGO,
+	    tracer->debugfs_root, tracer, &rtcpu_trace_debugfs_load);
+	if (IS_ERR_OR_NULL(entry))
+		goto failed_create;
+
+	debugfs_create_bool("decode", S_IRUGO | S_IWUSR,
+	    tracer->debugfs_root, &tracer->decode);
+
 	return;
 
 failed_create:
 	debugfs_remove_recursive(tracer->debugfs_root);
 }
 
+/*
+ * Sysfs: the latest load sample, cheap enough to poll for alarms
+ */
+
+static void rtcpu_trace_load_attr(struct rtcpu_trace_load *load,
+	unsigned int i, const char *name, void *var, bool is_int)
+{
+	struct dev_ext_attribute *attr = &load->attrs[i];
+
+	sysfs_attr_init(&attr->attr.attr);
+	attr->attr.attr.name = name;
+	attr->attr.attr.mode = S_IRUGO;
+	attr->attr.show = is_int ? device_show_int : device_show_ulong;
+	attr->var = var;
+	load->attr_ptrs[i] = &attr->attr.attr;
+}
+
+static void rtcpu_trace_sysfs_init(struct tegra_rtcpu_trace *tracer)
+{
+	struct rtcpu_trace_load *load = &tracer->load;
+
+	rtcpu_trace_load_attr(load, 0, "load_permille",
+		&load->load_permille, true);
+	rtcpu_trace_load_attr(load, 1, "load_max_permille",
+		&load->load_max_permille, true);
+	rtcpu_trace_load_attr(load, 2, "trace_backlog",
+		&load->backlog, false);
+	rtcpu_trace_load_attr(load, 3, "capture_latency_max_us",
+		&load->capture_latency_max_us, false);
+	load->attr_ptrs[4] = NULL;
+
+	load->group.name = "rtcpu_load";
+	load->group.attrs = load->attr_ptrs;
+
+	if (sysfs_create_group(&tracer->dev->kobj, &load->group))
+		dev_warn(tracer->dev, "failed to create load attributes\n");
+	else
+		load->sysfs = true;
+}
+
+static void rtcpu_trace_sysfs_deinit(struct tegra_rtcpu_trace *tracer)
+{
+	if (tracer->load.sysfs)
+		sysfs_remove_group(&tracer->dev->kobj, &tracer->load.group);
+}
+
 /*
  * Init/Cleanup
  */
@@ -1392,6 +1767,10 @@ struct tegra_rtcpu_trace *tegra_rtcpu_trace_create(struct device *dev,
 
 	tracer->dev = dev;
 	mutex_init(&tracer->lock);
+	init_waitqueue_head(&tracer->raw_wq);
+	tracer->decode = decode_events;
+	tracer->load.load_permille = -1;
+	tracer->load.load_max_permille = -1;
 
 	/* Get the trace memory */
 	ret = rtcpu_trace_setup_memory(tracer);
@@ -1452,6 +1831,8 @@ struct tegra_rtcpu_trace *tegra_rtcpu_trace_create(struct device *dev,
 	INIT_DELAYED_WORK(&tracer->work, rtcpu_trace_worker);
 	tracer->work_interval_jiffies = msecs_to_jiffies(param);
 
+	rtcpu_trace_sysfs_init(tracer);
+
 	/* Done with initialization */
 	schedule_delayed_work(&tracer->work, 0);
 
@@ -1489,6 +1870,7 @@ void tegra_rtcpu_trace_destroy(struct tegra_rtcpu_trace *tracer)
 	of_node_put(tracer->of_node);
 	cancel_delayed_work_sync(&tracer->work);
 	flush_delayed_work(&tracer->work);
+	rtcpu_trace_sysfs_deinit(tracer);
 	rtcpu_trace_debugfs_deinit(tracer);
 	dma_free_coherent(tracer->dev, tracer->trace_memory_size,
 			tracer->trace_memory, tracer->dma_handle);
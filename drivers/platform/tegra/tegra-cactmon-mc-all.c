@@ -7,11 +7,22 @@
 #include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/fs.h>
+#include <linux/hrtimer.h>
 #include <linux/io.h>
+#include <linux/kref.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
 #include <linux/types.h>
+#include <linux/vmalloc.h>
+#include <uapi/linux/tegra-cactmon.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_cactmon.h>
 
 #define	CENTRAL_ACTMON_CTRL_REG			0x0
 #define CENTRAL_ACTMON_MC_ALL_AVG_COUNT_REG	0x124
@@ -19,12 +30,37 @@
 #define CENTRAL_ACTMON_CTRL_SAMPLE_TICK(v)	((v & (0x1 << 10)) >> 10)
 #define CENTRAL_ACTMON_CTRL_SAMPLE_PERIOD(v)	((v & (0xff << 0)) >> 0)
 
+#define CENTRAL_ACTMON_RING_MIN_PERIOD_USEC	1000
+#define CENTRAL_ACTMON_RING_MAX_SAMPLES		(1U << 20)
+
+static unsigned int ring_samples = 8192;
+module_param(ring_samples, uint, 0444);
+MODULE_PARM_DESC(ring_samples, "Number of samples in the MC_ALL sample ring");
+
+/*
+ * The ring outlives the device while user space still has it open or
+ * mapped, hence the reference count.
+ */
+struct central_actmon_ring {
+	struct kref ref;
+	struct cactmon_mc_all_ring *hdr;
+	struct cactmon_mc_all_sample *samples;
+	size_t size;
+};
+
 struct central_actmon {
 	struct device *dev;
 	struct clk *clk;
 	unsigned long rate;
 	void __iomem *regs;
 	struct dentry *debugfs;
+
+	struct central_actmon_ring *ring;
+	struct miscdevice miscdev;
+	struct hrtimer timer;
+	/* serializes changes of the ring sampling period */
+	struct mutex lock;
+	ktime_t period;
 };
 
 static u32 cactmon_readl(struct central_actmon *cactmon, u32 offset)
@@ -67,16 +103,22 @@ DEFINE_SIMPLE_ATTRIBUTE(central_actmon_sample_period_fops,
 		central_actmon_sample_period_get, NULL,
 		"%lld\n");
 
-static int central_actmon_mc_all_get(void *data, u64 *val)
+static u64 __central_actmon_mc_all_get(struct central_actmon *cactmon)
 {
-	struct central_actmon *cactmon = (struct central_actmon *)data;
 	u32 sample_period_usec, mc_all_actives;
 
 	sample_period_usec = __central_actmon_sample_period_get(cactmon);
 
 	mc_all_actives = cactmon_readl(cactmon, CENTRAL_ACTMON_MC_ALL_AVG_COUNT_REG);
 
-	*val = (u64)mc_all_actives * 1000 / sample_period_usec;
+	return (u64)mc_all_actives * 1000 / sample_period_usec;
+}
+
+static int central_actmon_mc_all_get(void *data, u64 *val)
+{
+	struct central_actmon *cactmon = (struct central_actmon *)data;
+
+	*val = __central_actmon_mc_all_get(cactmon);
 
 	return 0;
 }
@@ -85,6 +127,159 @@ DEFINE_SIMPLE_ATTRIBUTE(central_actmon_mc_all_fops,
 		central_actmon_mc_all_get, NULL,
 		"%lld\n");
 
+static struct central_actmon_ring *central_actmon_ring_alloc(unsigned int nr)
+{
+	struct central_actmon_ring *ring;
+	size_t offset = ALIGN(sizeof(struct cactmon_mc_all_ring), 64);
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return NULL;
+
+	ring->size = PAGE_ALIGN(offset + nr * sizeof(struct cactmon_mc_all_sample));
+	ring->hdr = vmalloc_user(ring->size);
+	if (!ring->hdr) {
+		kfree(ring);
+		return NULL;
+	}
+
+	kref_init(&ring->ref);
+	ring->samples = (void *)ring->hdr + offset;
+	ring->hdr->version = CACTMON_MC_ALL_RING_VERSION;
+	ring->hdr->nr_samples = nr;
+	ring->hdr->sample_offset = offset;
+	ring->hdr->sample_size = sizeof(struct cactmon_mc_all_sample);
+
+	return ring;
+}
+
+static void central_actmon_ring_release(struct kref *ref)
+{
+	struct central_actmon_ring *ring =
+		container_of(ref, struct central_actmon_ring, ref);
+
+	vfree(ring->hdr);
+	kfree(ring);
+}
+
+static enum hrtimer_restart central_actmon_ring_sample(struct hrtimer *timer)
+{
+	struct central_actmon *cactmon =
+		container_of(timer, struct central_actmon, timer);
+	struct central_actmon_ring *ring = cactmon->ring;
+	struct cactmon_mc_all_sample *sample;
+	u64 head = ring->hdr->head;
+	u64 mc_all;
+
+	mc_all = __central_actmon_mc_all_get(cactmon);
+
+	sample = &ring->samples[head % ring->hdr->nr_samples];
+	sample->timestamp_ns = ktime_get_ns();
+	sample->mc_all = mc_all;
+	smp_store_release(&ring->hdr->head, head + 1);
+
+	trace_cactmon_mc_all_sample(head, mc_all);
+
+	hrtimer_forward_now(timer, cactmon->period);
+
+	return HRTIMER_RESTART;
+}
+
+static int central_actmon_ring_period_get(void *data, u64 *val)
+{
+	struct central_actmon *cactmon = (struct central_actmon *)data;
+
+	*val = ktime_to_us(cactmon->period);
+
+	return 0;
+}
+
+/* Writing 0 stops the sampling */
+static int central_actmon_ring_period_set(void *data, u64 val)
+{
+	struct central_actmon *cactmon = (struct central_actmon *)data;
+
+	if (val && val < CENTRAL_ACTMON_RING_MIN_PERIOD_USEC)
+		return -EINVAL;
+
+	if (val > U32_MAX)
+		return -EINVAL;
+
+	mutex_lock(&cactmon->lock);
+
+	hrtimer_cancel(&cactmon->timer);
+
+	cactmon->period = us_to_ktime(val);
+	cactmon->ring->hdr->period_us = val;
+	cactmon->ring->hdr->hw_period_us =
+		__central_actmon_sample_period_get(cactmon);
+
+	if (val)
+		hrtimer_start(&cactmon->timer, cactmon->period,
+			      HRTIMER_MODE_REL);
+
+	mutex_unlock(&cactmon->lock);
+
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(central_actmon_ring_period_fops,
+		central_actmon_ring_period_get, central_actmon_ring_period_set,
+		"%lld\n");
+
+static int central_actmon_ring_open(struct inode *inode, struct file *file)
+{
+	struct miscdevice *miscdev = file->private_data;
+	struct central_actmon *cactmon =
+		container_of(miscdev, struct central_actmon, miscdev);
+
+	if (file->f_mode & FMODE_WRITE)
+		return -EPERM;
+
+	/* misc_open() holds the misc lock, so cactmon can not go away here */
+	kref_get(&cactmon->ring->ref);
+	file->private_data = cactmon->ring;
+
+	return 0;
+}
+
+static int central_actmon_ring_release_file(struct inode *inode,
+					    struct file *file)
+{
+	struct central_actmon_ring *ring = file->private_data;
+
+	kref_put(&ring->ref, central_actmon_ring_release);
+
+	return 0;
+}
+
+static int central_actmon_ring_mmap(struct file *file,
+				    struct vm_area_struct *vma)
+{
+	struct central_actmon_ring *ring = file->private_data;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (vma->vm_end - vma->vm_start > ring->size)
+		return -EINVAL;
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	return remap_vmalloc_range(vma, ring->hdr, vma->vm_pgoff);
+}
+
+static const struct file_operations central_actmon_ring_fops = {
+	.owner		= THIS_MODULE,
+	.open		= central_actmon_ring_open,
+	.release	= central_actmon_ring_release_file,
+	.mmap		= central_actmon_ring_mmap,
+};
+
 static void central_actmon_debugfs_init(struct central_actmon *cactmon)
 {
 	cactmon->debugfs = debugfs_create_dir("cactmon", NULL);
@@ -93,11 +288,15 @@ static void central_actmon_debugfs_init(struct central_actmon *cactmon)
 			    &central_actmon_sample_period_fops);
 	debugfs_create_file("mc_all", 0444, cactmon->debugfs, cactmon,
 			    &central_actmon_mc_all_fops);
+	debugfs_create_file("ring_period_usec", 0644, cactmon->debugfs, cactmon,
+			    &central_actmon_ring_period_fops);
 }
 
 static int central_actmon_probe(struct platform_device *pdev)
 {
 	struct central_actmon *cactmon;
+	unsigned int nr;
+	int err;
 
 	cactmon = devm_kzalloc(&pdev->dev, sizeof(*cactmon), GFP_KERNEL);
 	if (!cactmon)
@@ -117,6 +316,27 @@ static int central_actmon_probe(struct platform_device *pdev)
 	cactmon->dev = &pdev->dev;
 	platform_set_drvdata(pdev, cactmon);
 
+	nr = clamp(ring_samples, 1U, CENTRAL_ACTMON_RING_MAX_SAMPLES);
+	cactmon->ring = central_actmon_ring_alloc(nr);
+	if (!cactmon->ring)
+		return -ENOMEM;
+
+	mutex_init(&cactmon->lock);
+	hrtimer_init(&cactmon->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	cactmon->timer.function = central_actmon_ring_sample;
+
+	cactmon->miscdev.minor = MISC_DYNAMIC_MINOR;
+	cactmon->miscdev.name = "cactmon-mc-all";
+	cactmon->miscdev.fops = &central_actmon_ring_fops;
+	cactmon->miscdev.parent = &pdev->dev;
+	cactmon->miscdev.mode = 0444;
+	err = misc_register(&cactmon->miscdev);
+	if (err) {
+		dev_err(&pdev->dev, "failed to register misc device: %d\n", err);
+		kref_put(&cactmon->ring->ref, central_actmon_ring_release);
+		return err;
+	}
+
 	central_actmon_debugfs_init(cactmon);
 
 	return 0;
@@ -127,6 +347,12 @@ static int central_actmon_remove(struct platform_device *pdev)
 	struct central_actmon *cactmon = platform_get_drvdata(pdev);
 
 	debugfs_remove_recursive(cactmon->debugfs);
+	hrtimer_cancel(&cactmon->timer);
+	misc_deregister(&cactmon->miscdev);
+
+	/* mappings of the ring stay valid, they just stop advancing */
+	cactmon->ring->hdr->period_us = 0;
+	kref_put(&cactmon->ring->ref, central_actmon_ring_release);
 
 	return 0;
 }
@@ -10,9 +10,17 @@
 #include <linux/of_device.h>
 #include <linux/dma-buf.h>
 #include <linux/device.h>
+#include <linux/eventfd.h>
 #include <linux/kdev_t.h>
+#include <linux/kfifo.h>
+#include <linux/log2.h>
 #include <linux/mailbox_client.h>
+#include <linux/poll.h>
 #include <linux/sched/signal.h>
+#include <linux/version.h>
+#if defined(NV_LINUX_IOSYS_MAP_H_PRESENT)
+#include <linux/iosys-map.h>
+#endif
 #include <uapi/linux/tegra-fsicom.h>
 #include <linux/pm.h>
 
@@ -23,6 +31,10 @@
 /* Unique signature for HSP Data */
 #define IOVA_UNI_CODE	0xFE0D
 #define PM_STATE_UNI_CODE	0xFDED
+#define RING_UNI_CODE	0xFE1D
+
+/* Events queued for read(), a power of two */
+#define FSICOM_EVENT_FIFO_SIZE	64
 
 /* State Management */
 #define PM_SUSPEND	6U
@@ -34,11 +46,25 @@ struct fsi_hsp_sm {
 	struct mbox_chan *chan;
 };
 
+/* Shared-memory ring in a buffer mapped for FSI */
+struct fsi_ring {
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	void *vaddr;
+	struct fsicom_ring_hdr *hdr;
+	u32 chid;
+};
+
 /* Data type for accessing TOP2 HSP */
 struct fsi_hsp {
 	struct fsi_hsp_sm rx;
 	struct fsi_hsp_sm tx;
 	struct device dev;
+	u8 coreid;
+	struct fsi_ring ring[FSICOM_RING_DIR_MAX];
+	/* Set from an FSI ring doorbell until its event is read */
+	atomic_t rx_ring_pending;
 };
 
 struct fsi_dev_ctx {
@@ -62,6 +88,16 @@ static int sgMaxCore;
 static LIST_HEAD(fsi_dev_list);
 static DEFINE_MUTEX(fsi_dev_list_mutex);
 
+/* Serializes ring setup, teardown and doorbells */
+static DEFINE_MUTEX(fsi_ring_mutex);
+
+/* FSI events for read() and poll(), in place of signals */
+static DEFINE_KFIFO(fsi_event_fifo, struct fsicom_event, FSICOM_EVENT_FIFO_SIZE);
+static DEFINE_SPINLOCK(fsi_event_lock);
+static DECLARE_WAIT_QUEUE_HEAD(fsi_event_wq);
+static struct eventfd_ctx *fsi_event_ctx;
+static bool fsi_event_overflow;
+
 static int fsicom_fsi_pm_notify(u32 state)
 {
 	uint32_t pdata[4] = {0};
@@ -96,10 +132,53 @@ static void fsicom_send_signal(int sig, int32_t data)
 			pr_err("Unable to send signal %d\n", sig);
 }
 
+static void fsicom_queue_event(u8 coreid, u32 flags, const u32 *data)
+{
+	struct fsicom_event ev = {0};
+	unsigned long irqflags;
+
+	ev.coreid = coreid;
+	ev.flags = flags;
+	if (data != NULL)
+		memcpy(ev.data, data, sizeof(ev.data));
+
+	spin_lock_irqsave(&fsi_event_lock, irqflags);
+	if (fsi_event_overflow)
+		ev.flags |= FSICOM_EVENT_OVERFLOW;
+	if (kfifo_put(&fsi_event_fifo, ev))
+		fsi_event_overflow = false;
+	else
+		fsi_event_overflow = true;
+
+	if (fsi_event_ctx != NULL)
+#if defined(NV_EVENTFD_SIGNAL_HAS_COUNTER_ARG)
+		eventfd_signal(fsi_event_ctx, 1);
+#else
+		eventfd_signal(fsi_event_ctx);
+#endif
+	spin_unlock_irqrestore(&fsi_event_lock, irqflags);
+
+	wake_up_interruptible(&fsi_event_wq);
+}
+
 static void tegra_hsp_rx_notify(struct mbox_client *cl, void *msg)
 {
+	struct fsi_hsp_sm *sm = container_of(cl, struct fsi_hsp_sm, client);
+	struct fsi_hsp *hsp = container_of(sm, struct fsi_hsp, rx);
+	u32 *data = msg;
+
+	if (data[3] == RING_UNI_CODE) {
+		/*
+		 * FSI rings once per batch. Until the reader has seen the
+		 * event, more doorbells carry no new information.
+		 */
+		if (atomic_xchg(&hsp->rx_ring_pending, 1) == 0)
+			fsicom_queue_event(hsp->coreid, FSICOM_EVENT_RING, data);
+		return;
+	}
 
-	fsicom_send_signal(SIG_FSI_WRITE_EVENT, *((uint32_t *)msg));
+	fsicom_queue_event(hsp->coreid, FSICOM_EVENT_MSG, data);
+	fsicom_send_signal(SIG_FSI_WRITE_EVENT, data[0]);
 }
 
 static void tegra_hsp_tx_empty_notify(struct mbox_client *cl,
@@ -123,6 +202,8 @@ static int tegra_hsp_mb_init(struct device *dev)
 		if (dma_set_mask_and_coherent(dev, DMA_BIT_MASK(32)))
 			dev_err(dev, "FsiCom: setting DMA MASK failed!\n");
 
+		fsi_hsp_v[lCoreId]->coreid = lCoreId;
+		atomic_set(&fsi_hsp_v[lCoreId]->rx_ring_pending, 0);
 		fsi_hsp_v[lCoreId]->tx.client.dev = dev;
 		fsi_hsp_v[lCoreId]->rx.client.dev = dev;
 		fsi_hsp_v[lCoreId]->tx.client.tx_block = true;
@@ -221,6 +302,329 @@ static int smmu_buff_map(unsigned long arg)
 	return 0;
 }
 
+static struct fsi_dev_ctx *fsicom_find_ctx(u32 coreid)
+{
+	struct fsi_dev_ctx *ctx;
+	u32 val;
+
+	list_for_each_entry(ctx, &fsi_dev_list, list) {
+		if (of_property_read_u32(ctx->pdev->dev.of_node, "smmu_inst", &val))
+			continue;
+		if (val == coreid)
+			return ctx;
+	}
+
+	return NULL;
+}
+
+static void *fsicom_dmabuf_vmap(struct dma_buf *dmabuf)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+#if defined(NV_LINUX_IOSYS_MAP_H_PRESENT)
+	struct iosys_map map = {0};
+#else
+	struct dma_buf_map map = {0};
+#endif
+	/* Linux v5.11 and later kernels */
+	if (dma_buf_vmap(dmabuf, &map))
+		return NULL;
+
+	return map.vaddr;
+#else
+	/* Linux v5.10 and earlier kernels */
+	return dma_buf_vmap(dmabuf);
+#endif
+}
+
+static void fsicom_dmabuf_vunmap(struct dma_buf *dmabuf, void *addr)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+#if defined(NV_LINUX_IOSYS_MAP_H_PRESENT)
+	struct iosys_map map = IOSYS_MAP_INIT_VADDR(addr);
+#else
+	struct dma_buf_map map = DMA_BUF_MAP_INIT_VADDR(addr);
+#endif
+	/* Linux v5.11 and later kernels */
+	dma_buf_vunmap(dmabuf, &map);
+#else
+	/* Linux v5.10 and earlier kernels */
+	dma_buf_vunmap(dmabuf, addr);
+#endif
+}
+
+/* Called with fsi_ring_mutex held */
+static void fsicom_ring_release(struct fsi_ring *ring)
+{
+	if (ring->dmabuf == NULL)
+		return;
+
+	fsicom_dmabuf_vunmap(ring->dmabuf, ring->vaddr);
+	dma_buf_unmap_attachment(ring->attach, ring->sgt, DMA_BIDIRECTIONAL);
+	dma_buf_detach(ring->dmabuf, ring->attach);
+	dma_buf_put(ring->dmabuf);
+	memset(ring, 0, sizeof(*ring));
+}
+
+static void fsicom_rings_release(void)
+{
+	int lCoreId;
+	u32 dir;
+
+	mutex_lock(&fsi_ring_mutex);
+	for (lCoreId = 0; lCoreId < sgMaxCore; lCoreId++) {
+		if (fsi_hsp_v[lCoreId] == NULL)
+			continue;
+		for (dir = 0; dir < FSICOM_RING_DIR_MAX; dir++)
+			fsicom_ring_release(&fsi_hsp_v[lCoreId]->ring[dir]);
+	}
+	mutex_unlock(&fsi_ring_mutex);
+}
+
+/*
+ * Maps the ring for the CPU and for FSI, initializes its header and hands
+ * it to FSI as a buffer of the channel, the same way TEGRA_IOVA_DATA does.
+ */
+static int fsicom_ring_setup(unsigned long arg)
+{
+	struct fsicom_ring_setup setup;
+	struct fsi_dev_ctx *ctx;
+	struct fsi_ring ring = {0};
+	struct fsi_ring *slot;
+	uint32_t pdata[4] = {0};
+	dma_addr_t iova;
+	int ret;
+
+	if (copy_from_user(&setup, (void __user *)arg, sizeof(setup)))
+		return -EACCES;
+	if (setup.coreid >= sgMaxCore || setup.dir >= FSICOM_RING_DIR_MAX)
+		return -ECHRNG;
+	if (!is_power_of_2(setup.size) ||
+	    !IS_ALIGNED(setup.offset, sizeof(u32)))
+		return -EINVAL;
+
+	mutex_lock(&fsi_dev_list_mutex);
+	ctx = fsicom_find_ctx(setup.coreid);
+	mutex_unlock(&fsi_dev_list_mutex);
+	if (ctx == NULL)
+		return -ENODEV;
+
+	ring.dmabuf = dma_buf_get(setup.fd);
+	if (IS_ERR_OR_NULL(ring.dmabuf))
+		return -EINVAL;
+
+	if ((u64)setup.offset + sizeof(struct fsicom_ring_hdr) + setup.size >
+	    ring.dmabuf->size) {
+		ret = -EINVAL;
+		goto err_put;
+	}
+
+	ring.attach = dma_buf_attach(ring.dmabuf, &ctx->pdev->dev);
+	if (IS_ERR_OR_NULL(ring.attach)) {
+		ret = -EINVAL;
+		goto err_put;
+	}
+
+	ring.sgt = dma_buf_map_attachment(ring.attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR_OR_NULL(ring.sgt)) {
+		ret = -EINVAL;
+		goto err_detach;
+	}
+
+	ring.vaddr = fsicom_dmabuf_vmap(ring.dmabuf);
+	if (ring.vaddr == NULL) {
+		ret = -ENOMEM;
+		goto err_unmap;
+	}
+
+	iova = sg_dma_address(ring.sgt->sgl);
+	ring.hdr = ring.vaddr + setup.offset;
+	ring.chid = setup.chid;
+
+	memset(ring.hdr, 0, sizeof(*ring.hdr));
+	ring.hdr->size = setup.size;
+	/* The first batch always gets a doorbell */
+	ring.hdr->need_doorbell = (setup.dir == FSICOM_RING_TX) ? 1U : 0U;
+	/* Publish the header before the magic that makes it valid */
+	wmb();
+	WRITE_ONCE(ring.hdr->magic, FSICOM_RING_MAGIC);
+
+	pdata[0] = setup.offset;
+	pdata[1] = (u32)iova;
+	pdata[2] = setup.chid;
+	pdata[3] = IOVA_UNI_CODE;
+
+	mutex_lock(&fsi_ring_mutex);
+	slot = &fsi_hsp_v[setup.coreid]->ring[setup.dir];
+	fsicom_ring_release(slot);
+	ret = mbox_send_message(fsi_hsp_v[setup.coreid]->tx.chan,
+				(void *)pdata);
+	if (ret >= 0) {
+		*slot = ring;
+		ret = 0;
+	}
+	mutex_unlock(&fsi_ring_mutex);
+	if (ret)
+		goto err_vunmap;
+
+	return 0;
+
+err_vunmap:
+	fsicom_dmabuf_vunmap(ring.dmabuf, ring.vaddr);
+err_unmap:
+	dma_buf_unmap_attachment(ring.attach, ring.sgt, DMA_BIDIRECTIONAL);
+err_detach:
+	dma_buf_detach(ring.dmabuf, ring.attach);
+err_put:
+	dma_buf_put(ring.dmabuf);
+	return ret;
+}
+
+/*
+ * Rings the TX doorbell of a core after userspace has advanced head, but
+ * only if FSI asked for it. While FSI is still consuming it picks the new
+ * records up without another HSP message.
+ */
+static int fsicom_ring_doorbell(unsigned long arg)
+{
+	struct fsicom_ring_doorbell db;
+	struct fsi_ring *ring;
+	uint32_t pdata[4] = {0};
+	int ret = 0;
+
+	if (copy_from_user(&db, (void __user *)arg, sizeof(db)))
+		return -EACCES;
+	if (db.coreid >= sgMaxCore)
+		return -ECHRNG;
+
+	db.rung = 0U;
+
+	mutex_lock(&fsi_ring_mutex);
+	ring = &fsi_hsp_v[db.coreid]->ring[FSICOM_RING_TX];
+	if (ring->hdr == NULL) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	/* Order the producer's head update against the need_doorbell read */
+	smp_mb();
+	if (READ_ONCE(ring->hdr->need_doorbell) == 0U)
+		goto out;
+
+	WRITE_ONCE(ring->hdr->need_doorbell, 0U);
+	pdata[0] = READ_ONCE(ring->hdr->head);
+	pdata[1] = ring->chid;
+	pdata[3] = RING_UNI_CODE;
+	ret = mbox_send_message(fsi_hsp_v[db.coreid]->tx.chan, (void *)pdata);
+	if (ret >= 0) {
+		db.rung = 1U;
+		ret = 0;
+	}
+out:
+	mutex_unlock(&fsi_ring_mutex);
+
+	if (!ret && copy_to_user((void __user *)arg, &db, sizeof(db)))
+		ret = -EACCES;
+
+	return ret;
+}
+
+static int fsicom_set_eventfd(unsigned long arg)
+{
+	struct fsicom_eventfd req;
+	struct eventfd_ctx *ctx = NULL;
+	struct eventfd_ctx *old;
+
+	if (copy_from_user(&req, (void __user *)arg, sizeof(req)))
+		return -EACCES;
+
+	if (req.fd >= 0) {
+		ctx = eventfd_ctx_fdget(req.fd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	} else if (req.fd != -1) {
+		return -EINVAL;
+	}
+
+	spin_lock_irq(&fsi_event_lock);
+	old = fsi_event_ctx;
+	fsi_event_ctx = ctx;
+	spin_unlock_irq(&fsi_event_lock);
+
+	if (old != NULL)
+		eventfd_ctx_put(old);
+
+	req.nr_cores = (u8)sgMaxCore;
+	if (copy_to_user((void __user *)arg, &req, sizeof(req)))
+		return -EACCES;
+
+	return 0;
+}
+
+static ssize_t device_file_read(struct file *fp, char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct fsicom_event ev;
+	size_t copied = 0;
+	int ret;
+
+	if (count < sizeof(ev))
+		return -EINVAL;
+
+	if (kfifo_is_empty(&fsi_event_fifo)) {
+		if (fp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(fsi_event_wq,
+					       !kfifo_is_empty(&fsi_event_fifo));
+		if (ret)
+			return ret;
+	}
+
+	while (copied + sizeof(ev) <= count) {
+		unsigned long irqflags;
+		unsigned int n;
+
+		spin_lock_irqsave(&fsi_event_lock, irqflags);
+		n = kfifo_get(&fsi_event_fifo, &ev);
+		spin_unlock_irqrestore(&fsi_event_lock, irqflags);
+		if (n == 0)
+			break;
+
+		/* Let the next FSI ring doorbell through once it's seen */
+		if ((ev.flags & FSICOM_EVENT_RING) && ev.coreid < sgMaxCore)
+			atomic_set(&fsi_hsp_v[ev.coreid]->rx_ring_pending, 0);
+
+		if (copy_to_user(buf + copied, &ev, sizeof(ev)))
+			return copied ? copied : -EFAULT;
+		copied += sizeof(ev);
+	}
+
+	return copied;
+}
+
+static __poll_t device_file_poll(struct file *fp, poll_table *wait)
+{
+	poll_wait(fp, &fsi_event_wq, wait);
+
+	return kfifo_is_empty(&fsi_event_fifo) ? 0 : (EPOLLIN | EPOLLRDNORM);
+}
+
+static int device_file_release(struct inode *inode, struct file *fp)
+{
+	struct eventfd_ctx *old;
+
+	fsicom_rings_release();
+
+	spin_lock_irq(&fsi_event_lock);
+	old = fsi_event_ctx;
+	fsi_event_ctx = NULL;
+	spin_unlock_irq(&fsi_event_lock);
+
+	if (old != NULL)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
 static ssize_t device_file_ioctl(
 		struct file *fp, unsigned int cmd, unsigned long arg)
 {
@@ -266,6 +670,18 @@ static ssize_t device_file_ioctl(
 			return -EACCES;
 		break;
 
+	case TEGRA_RING_SETUP:
+		ret = fsicom_ring_setup(arg);
+		break;
+
+	case TEGRA_RING_DOORBELL:
+		ret = fsicom_ring_doorbell(arg);
+		break;
+
+	case TEGRA_EVENTFD_REG:
+		ret = fsicom_set_eventfd(arg);
+		break;
+
 	case TEGRA_IOVA_DATA:
 		if (copy_from_user(&ldata, (void __user *)arg,
 					sizeof(struct iova_data)))
@@ -291,6 +707,9 @@ static ssize_t device_file_ioctl(
 static const struct file_operations fsicom_driver_fops = {
 	.owner   = THIS_MODULE,
 	.unlocked_ioctl   = device_file_ioctl,
+	.read    = device_file_read,
+	.poll    = device_file_poll,
+	.release = device_file_release,
 };
 
 static int fsicom_register_device(void)
@@ -418,6 +837,7 @@ static int fsicom_client_remove(struct platform_device *pdev)
 	if (val == 0) {
 		pr_debug("fsicom remove called");
 		fsicom_unregister_device();
+		fsicom_rings_release();
 		mutex_lock(&fsi_dev_list_mutex);
 		list_del(&ctx->list);
 		mutex_unlock(&fsi_dev_list_mutex);
@@ -455,8 +875,10 @@ static int __maybe_unused fsicom_client_resume(struct device *dev)
 		pr_err("failed to read smmu_inst\n");
 		return -1;
 	}
-	if (val == 0)
+	if (val == 0) {
+		fsicom_queue_event(0, FSICOM_EVENT_RESUME, NULL);
 		fsicom_send_signal(SIG_DRIVER_RESUME, 0);
+	}
 
 	return 0;
 }
@@ -18,6 +18,11 @@
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
+#include <linux/device.h>
+#include <linux/i2c.h>
+#include <linux/notifier.h>
+#include <linux/sort.h>
+#include <linux/mm.h>
 
 #include "tegra_bootloader_debug.h"
 
@@ -39,6 +44,7 @@ static const char *gr_file_mb1 = "gr_mb1";
 static const char *gr_file_mb2 = "gr_mb2";
 static const char *gr_file_cpu_bl = "gr_cpu_bl";
 static const char *boot_cfg = "boot_cfg";
+static const char *boot_timeline = "boot_timeline";
 #endif
 
 static char *bl_debug_data = "0@0x0";
@@ -112,6 +118,8 @@ static void *tegra_bl_mapped_debug_data_start;
 static int boot_cfg_show(struct seq_file *s, void *unused);
 static int boot_cfg_open(struct inode *inode, struct file *file);
 static void *tegra_bl_mapped_boot_cfg_start;
+static int boot_timeline_show(struct seq_file *s, void *unused);
+static int boot_timeline_open(struct inode *inode, struct file *file);
 
 static const struct file_operations debug_gr_fops_mb1 = {
 	.open		= dbg_golden_register_open_mb1,
@@ -142,6 +150,13 @@ static const struct file_operations boot_cfg_fops = {
 	.llseek		= seq_lseek,
 	.release	= single_release,
 };
+
+static const struct file_operations boot_timeline_fops = {
+	.open		= boot_timeline_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
 #endif /* CONFIG_DEBUG_FS */
 
 #define MAX_PROFILE_STRLEN	55
@@ -277,6 +292,121 @@ static ssize_t add_profiler_record_store(struct kobject *kobj,
 static struct kobj_attribute add_profiler_record_attribute =
 	__ATTR_WO(add_profiler_record);
 
+/*
+ * Driver probes seen on the platform and I2C buses, timestamped with the
+ * same microsecond counter the bootloaders use for their profiler records,
+ * so both can be put on one timeline. Probes that finished before this
+ * module was loaded are not seen.
+ */
+#define TEGRA_BL_MAX_PROBES	1024
+#define TEGRA_BL_PROBE_NAMELEN	48
+
+enum tegra_bl_probe_state {
+	TEGRA_BL_PROBE_RUNNING,
+	TEGRA_BL_PROBE_BOUND,
+	TEGRA_BL_PROBE_FAILED,
+};
+
+struct tegra_bl_probe {
+	struct device *dev;
+	char dev_name[TEGRA_BL_PROBE_NAMELEN];
+	char drv_name[TEGRA_BL_PROBE_NAMELEN];
+	u32 start_us;
+	u32 end_us;
+	enum tegra_bl_probe_state state;
+};
+
+static struct tegra_bl_probe *tegra_bl_probes;
+static unsigned int tegra_bl_nr_probes;
+static DEFINE_SPINLOCK(tegra_bl_probe_lock);
+
+static int tegra_bl_bus_notify(struct notifier_block *nb,
+			       unsigned long action, void *data)
+{
+	struct device *dev = data;
+	struct tegra_bl_probe *probe;
+	u32 now;
+	int i;
+
+	if (action != BUS_NOTIFY_BIND_DRIVER &&
+	    action != BUS_NOTIFY_BOUND_DRIVER &&
+	    action != BUS_NOTIFY_DRIVER_NOT_BOUND)
+		return NOTIFY_DONE;
+
+	now = readl(usc);
+
+	spin_lock(&tegra_bl_probe_lock);
+
+	if (action == BUS_NOTIFY_BIND_DRIVER) {
+		if (tegra_bl_nr_probes < TEGRA_BL_MAX_PROBES) {
+			probe = &tegra_bl_probes[tegra_bl_nr_probes++];
+			probe->dev = dev;
+			strscpy(probe->dev_name, dev_name(dev),
+				TEGRA_BL_PROBE_NAMELEN);
+			strscpy(probe->drv_name,
+				dev->driver ? dev->driver->name : "?",
+				TEGRA_BL_PROBE_NAMELEN);
+			probe->start_us = now;
+			probe->end_us = now;
+			probe->state = TEGRA_BL_PROBE_RUNNING;
+		}
+		goto unlock;
+	}
+
+	/* deferred probes bind again later, so take the latest attempt */
+	for (i = tegra_bl_nr_probes - 1; i >= 0; i--) {
+		probe = &tegra_bl_probes[i];
+		if (probe->dev != dev || probe->state != TEGRA_BL_PROBE_RUNNING)
+			continue;
+
+		probe->end_us = now;
+		probe->state = action == BUS_NOTIFY_BOUND_DRIVER ?
+			TEGRA_BL_PROBE_BOUND : TEGRA_BL_PROBE_FAILED;
+		break;
+	}
+
+unlock:
+	spin_unlock(&tegra_bl_probe_lock);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block tegra_bl_platform_nb = {
+	.notifier_call = tegra_bl_bus_notify,
+};
+
+#if IS_ENABLED(CONFIG_I2C)
+static struct notifier_block tegra_bl_i2c_nb = {
+	.notifier_call = tegra_bl_bus_notify,
+};
+#endif
+
+static void tegra_bl_probe_timing_init(void)
+{
+	tegra_bl_probes = kcalloc(TEGRA_BL_MAX_PROBES,
+				  sizeof(*tegra_bl_probes), GFP_KERNEL);
+	if (!tegra_bl_probes)
+		return;
+
+	bus_register_notifier(&platform_bus_type, &tegra_bl_platform_nb);
+#if IS_ENABLED(CONFIG_I2C)
+	bus_register_notifier(&i2c_bus_type, &tegra_bl_i2c_nb);
+#endif
+}
+
+static void tegra_bl_probe_timing_exit(void)
+{
+	if (!tegra_bl_probes)
+		return;
+
+#if IS_ENABLED(CONFIG_I2C)
+	bus_unregister_notifier(&i2c_bus_type, &tegra_bl_i2c_nb);
+#endif
+	bus_unregister_notifier(&platform_bus_type, &tegra_bl_platform_nb);
+	kfree(tegra_bl_probes);
+	tegra_bl_probes = NULL;
+}
+
 #ifdef CONFIG_DEBUG_FS
 static int dbg_golden_register_show(struct seq_file *s, void *unused)
 {
@@ -413,6 +543,15 @@ static int __init tegra_bootloader_debuginit(void)
 					(__force void *)ptr_bl_debug_data_start;
 		}
 
+		bl_debug_verify_reg_node = debugfs_create_file(boot_timeline, 0400,
+					bl_debug_node, NULL, &boot_timeline_fops);
+
+		if (IS_ERR_OR_NULL(bl_debug_verify_reg_node)) {
+			pr_err("%s: failed to create debugfs entries: %ld\n",
+				module_name, PTR_ERR(bl_debug_verify_reg_node));
+			goto out_err;
+		}
+
 		/*
 		 * The BCP can be optional, so ignore creating if variables are not set
 		 */
@@ -507,6 +646,8 @@ static int __init tegra_bootloader_debuginit(void)
 
 	spin_lock_init(&tegra_bl_lock);
 
+	tegra_bl_probe_timing_init();
+
 	return 0;
 
 out_err:
@@ -580,6 +721,112 @@ static int boot_cfg_open(struct inode *inode, struct file *file)
 {
 	return single_open(file, boot_cfg_show, &inode->i_private);
 }
+
+struct boot_timeline_event {
+	u64 timestamp;
+	u64 duration;
+	const char *state;
+	char name[2 * TEGRA_BL_PROBE_NAMELEN + 2];
+	bool is_probe;
+};
+
+static int boot_timeline_cmp(const void *a, const void *b)
+{
+	const struct boot_timeline_event *ea = a, *eb = b;
+
+	if (ea->timestamp < eb->timestamp)
+		return -1;
+
+	return ea->timestamp > eb->timestamp;
+}
+
+/*
+ * One list sorted by the microsecond counter: bootloader profiler records,
+ * then the kernel driver probes with their duration.
+ */
+static int boot_timeline_show(struct seq_file *s, void *unused)
+{
+	static const char * const probe_states[] = {
+		[TEGRA_BL_PROBE_RUNNING] = "running",
+		[TEGRA_BL_PROBE_BOUND] = "bound",
+		[TEGRA_BL_PROBE_FAILED] = "failed",
+	};
+	struct profiler_record *records;
+	struct boot_timeline_event *events;
+	struct tegra_bl_probe probe;
+	unsigned int nr_records = 0, nr = 0, i;
+	u64 prev = 0;
+
+	if (is_privileged_vm) {
+		records = tegra_bl_mapped_prof_ro_start;
+		if (records)
+			nr_records = tegra_bl_prof_ro_size / sizeof(*records);
+	} else {
+		records = tegra_bl_mapped_prof_start;
+		if (records)
+			nr_records = tegra_bl_prof_size / sizeof(*records);
+	}
+
+	events = kvcalloc(nr_records + TEGRA_BL_MAX_PROBES, sizeof(*events),
+			  GFP_KERNEL);
+	if (!events)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_records; i++) {
+		if (!records[i].timestamp)
+			continue;
+
+		events[nr].timestamp = records[i].timestamp;
+		memcpy(events[nr].name, records[i].str, MAX_PROFILE_STRLEN);
+		events[nr].name[MAX_PROFILE_STRLEN] = '\0';
+		nr++;
+	}
+
+	for (i = 0; tegra_bl_probes && i < TEGRA_BL_MAX_PROBES; i++) {
+		spin_lock(&tegra_bl_probe_lock);
+		if (i >= tegra_bl_nr_probes) {
+			spin_unlock(&tegra_bl_probe_lock);
+			break;
+		}
+		probe = tegra_bl_probes[i];
+		spin_unlock(&tegra_bl_probe_lock);
+
+		events[nr].timestamp = probe.start_us;
+		events[nr].duration = probe.end_us - probe.start_us;
+		events[nr].state = probe_states[probe.state];
+		events[nr].is_probe = true;
+		snprintf(events[nr].name, sizeof(events[nr].name), "%s %s",
+			 probe.drv_name, probe.dev_name);
+		nr++;
+	}
+
+	sort(events, nr, sizeof(*events), boot_timeline_cmp, NULL);
+
+	seq_printf(s, "%16s %12s %12s  %-7s %s\n", "timestamp_us", "delta_us",
+		   "duration_us", "source", "event");
+
+	for (i = 0; i < nr; i++) {
+		seq_printf(s, "%16llu %12llu ", events[i].timestamp,
+			   i ? events[i].timestamp - prev : 0);
+		if (events[i].is_probe)
+			seq_printf(s, "%12llu  %-7s probe %s (%s)\n",
+				   events[i].duration, "kernel",
+				   events[i].name, events[i].state);
+		else
+			seq_printf(s, "%12s  %-7s %s\n", "-", "boot",
+				   events[i].name);
+		prev = events[i].timestamp;
+	}
+
+	kvfree(events);
+
+	return 0;
+}
+
+static int boot_timeline_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_timeline_show, inode->i_private);
+}
 #endif /* CONFIG_DEBUG_FS */
 
 static int __init tegra_bl_args(char *options, phys_addr_t *tegra_bl_arg_size,
@@ -730,6 +977,8 @@ err_out:
 
 static void __exit tegra_bl_debuginit_module_exit(void)
 {
+	tegra_bl_probe_timing_exit();
+
 #ifdef CONFIG_DEBUG_FS
 	if (!IS_ERR_OR_NULL(bl_debug_node))
 		debugfs_remove_recursive(bl_debug_node);
@@ -28,13 +28,16 @@
 
 /* All uncore counters are 32 bit */
 #define COUNTER_MASK 0xFFFFFFFF
-#define MAX_COUNTER (1ULL << 32)
+
+/* CPU that owns the uncore counters and receives their interrupt */
+#define UNCORE_CPU	0
 
 /*
- * Format for raw events is 0xEEU
- * EE: event number
- * U:  unit (0 for SCF)
+ * Format for raw events is 0xEEEEU
+ * EEEE: event number
+ * U:    unit (0 for SCF)
  * eg. SCF BUS_ACCESS: perf stat -e r190
+ *     SNOC internal event 0x12: perf stat -e rd0120
  */
 #define CONFIG_UNIT(_config)	(_config & 0xf)
 #define CONFIG_EVENT(_config)	(_config >> 4)
@@ -89,6 +92,15 @@ SCF_EVENT_ATTR(scf_cache_refill, SCF_CACHE_REFILL);
 SCF_EVENT_ATTR(scf_cache, SCF_CACHE);
 SCF_EVENT_ATTR(scf_cache_wb, SCF_CACHE_WB);
 
+/* Common names for the events above, used by the pipeline profiling tools */
+SCF_EVENT_ATTR(scf_cache_miss, SCF_CACHE_REFILL);
+SCF_EVENT_ATTR(scf_cache_access, SCF_CACHE);
+SCF_EVENT_ATTR(scf_cache_writeback, SCF_CACHE_WB);
+SCF_EVENT_ATTR(dram_read_access, BUS_ACCESS_RD);
+SCF_EVENT_ATTR(dram_write_access, BUS_ACCESS_WR);
+SCF_EVENT_ATTR(snoop_access, BUS_ACCESS_SHARED);
+SCF_EVENT_ATTR(io_access, BUS_ACCESS_PERIPH);
+
 static struct attribute *scf_uncore_pmu_events[] = {
 	&scf_event_attr_bus_access.attr.attr,
 	&scf_event_attr_bus_cycles.attr.attr,
@@ -102,6 +114,13 @@ static struct attribute *scf_uncore_pmu_events[] = {
 	&scf_event_attr_scf_cache_refill.attr.attr,
 	&scf_event_attr_scf_cache.attr.attr,
 	&scf_event_attr_scf_cache_wb.attr.attr,
+	&scf_event_attr_scf_cache_miss.attr.attr,
+	&scf_event_attr_scf_cache_access.attr.attr,
+	&scf_event_attr_scf_cache_writeback.attr.attr,
+	&scf_event_attr_dram_read_access.attr.attr,
+	&scf_event_attr_dram_write_access.attr.attr,
+	&scf_event_attr_snoop_access.attr.attr,
+	&scf_event_attr_io_access.attr.attr,
 	NULL,
 };
 
@@ -111,7 +130,7 @@ static struct attribute_group scf_uncore_pmu_events_group = {
 };
 
 PMU_FORMAT_ATTR(unit,	"config:0-3");
-PMU_FORMAT_ATTR(event,	"config:4-15");
+PMU_FORMAT_ATTR(event,	"config:4-19");
 
 static struct attribute *scf_uncore_pmu_formats[] = {
 	&format_attr_event.attr,
@@ -124,9 +143,27 @@ static struct attribute_group scf_uncore_pmu_format_group = {
 	.attrs = scf_uncore_pmu_formats,
 };
 
+/* Tell perf to open uncore events on the CPU that owns the counters only */
+static ssize_t cpumask_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(UNCORE_CPU));
+}
+static DEVICE_ATTR_RO(cpumask);
+
+static struct attribute *scf_uncore_pmu_cpumask_attrs[] = {
+	&dev_attr_cpumask.attr,
+	NULL,
+};
+
+static struct attribute_group scf_uncore_pmu_cpumask_group = {
+	.attrs = scf_uncore_pmu_cpumask_attrs,
+};
+
 static const struct attribute_group *scf_uncore_pmu_attr_grps[] = {
 	&scf_uncore_pmu_events_group,
 	&scf_uncore_pmu_format_group,
+	&scf_uncore_pmu_cpumask_group,
 	NULL,
 };
 
@@ -246,19 +283,44 @@ static void scf_uncore_pmu_disable(struct pmu *pmu)
 }
 
 /*
- * To handle cases of extreme interrupt latency, we program
- * the counter with half of the max count for the counters.
+ * Program the counter to overflow after the remaining sample period. To
+ * handle cases of extreme interrupt latency, the counter is never programmed
+ * with more than half of the max count, counting events use that as their
+ * period. Returns true when a new period was started.
  */
-static void scf_uncore_event_set_period(
+static bool scf_uncore_event_set_period(
 		struct uncore_unit *uncore_unit, struct perf_event *event)
 {
 	struct hw_perf_event *hwc = &event->hw;
+	s64 left = local64_read(&hwc->period_left);
+	s64 period = hwc->sample_period;
 	int idx = hwc->idx;
+	bool ret = false;
+	u32 val;
+
+	if (unlikely(left <= -period)) {
+		left = period;
+		local64_set(&hwc->period_left, left);
+		hwc->last_period = period;
+		ret = true;
+	}
+
+	if (unlikely(left <= 0)) {
+		left += period;
+		local64_set(&hwc->period_left, left);
+		hwc->last_period = period;
+		ret = true;
+	}
+
+	if (left > (COUNTER_MASK >> 1))
+		left = COUNTER_MASK >> 1;
 
-	u32 val = COUNTER_MASK >> 1;
+	val = (u32)(-left) & COUNTER_MASK;
 	local64_set(&hwc->prev_count, val);
 
 	mce_perfmon_write(uncore_unit, NV_PMEVCNTR, idx, val);
+
+	return ret;
 }
 
 static void scf_uncore_event_start(struct perf_event *event, int flags) {
@@ -271,7 +333,7 @@ static void scf_uncore_event_start(struct perf_event *event, int flags) {
 	u32 event_id;
 
 	/* CPU0 does all uncore counting */
-	if (event->cpu != 0)
+	if (event->cpu != UNCORE_CPU)
 		return;
 
 	/* We always reprogram the counter */
@@ -299,7 +361,7 @@ static void scf_uncore_event_start(struct perf_event *event, int flags) {
 }
 
 static void scf_uncore_event_update(
-		struct uncore_unit *uncore_unit, struct perf_event *event, bool ovf)
+		struct uncore_unit *uncore_unit, struct perf_event *event)
 {
 	struct hw_perf_event *hwc = &event->hw;
 	u32 idx = hwc->idx;
@@ -312,13 +374,14 @@ static void scf_uncore_event_update(
 		now = mce_perfmon_read(uncore_unit, NV_PMEVCNTR, idx);
 	} while (local64_cmpxchg(&hwc->prev_count, prev, now) != prev);
 
-	if (prev > now)
-		delta = MAX_COUNTER - prev + now;
-	else
-		/* Either an incremental read, or fielding an IRQ from a ctr overflow */
-		delta = now - prev + (ovf ? MAX_COUNTER : 0);
+	/*
+	 * The counter is never programmed beyond half of its range, so it
+	 * can not wrap twice between two updates, even on an overflow IRQ.
+	 */
+	delta = (now - prev) & COUNTER_MASK;
 
 	local64_add(delta, &event->count);
+	local64_sub(delta, &hwc->period_left);
 }
 
 static void scf_uncore_event_stop(struct perf_event *event, int flags)
@@ -330,7 +393,7 @@ static void scf_uncore_event_stop(struct perf_event *event, int flags)
 	u32 unit_id;
 
 	/* CPU0 does all uncore counting */
-	if (event->cpu != 0)
+	if (event->cpu != UNCORE_CPU)
 		return;
 
 	if (event->hw.state & PERF_HES_STOPPED)
@@ -348,7 +411,7 @@ static void scf_uncore_event_stop(struct perf_event *event, int flags)
 	mce_perfmon_write(uncore_unit, NV_PMINTENCLR, 0, BIT(idx));
 
 	if (flags & PERF_EF_UPDATE)
-		scf_uncore_event_update(uncore_unit, event, false);
+		scf_uncore_event_update(uncore_unit, event);
 
 	event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
 }
@@ -367,7 +430,7 @@ static int scf_uncore_event_add(struct perf_event *event, int flags)
 	u32 idx;
 
 	/* CPU0 does all uncore counting */
-	if (event->cpu != 0)
+	if (event->cpu != UNCORE_CPU)
 		return 0;
 
 	unit_id = CONFIG_UNIT(event->attr.config);
@@ -406,7 +469,7 @@ static void scf_uncore_event_del(struct perf_event *event, int flags)
 	u32 idx = hwc->idx;
 
 	/* CPU0 does all uncore counting */
-	if (event->cpu != 0)
+	if (event->cpu != UNCORE_CPU)
 		return;
 
 	unit_id = CONFIG_UNIT(event->attr.config);
@@ -431,7 +494,7 @@ static void scf_uncore_event_read(struct perf_event *event)
 	u32 unit_id;
 
 	/* CPU0 does all uncore counting */
-	if (event->cpu != 0)
+	if (event->cpu != UNCORE_CPU)
 		return;
 
 	unit_id = CONFIG_UNIT(event->attr.config);
@@ -441,7 +504,7 @@ static void scf_uncore_event_read(struct perf_event *event)
 	if (unlikely(uncore_unit == NULL))
 		return;
 
-	scf_uncore_event_update(uncore_unit, event, false);
+	scf_uncore_event_update(uncore_unit, event);
 }
 
 /*
@@ -452,11 +515,14 @@ static irqreturn_t scf_handle_irq(int irq_num, void *data)
 {
 	struct uncore_pmu *uncore_pmu = data;
 	struct uncore_unit *uncore_unit;
+	struct perf_sample_data sample;
+	struct pt_regs *regs;
 	u32 int_en;
 	u32 ovf;
 	u32 idx;
 
 	uncore_unit = &uncore_pmu->scf;
+	regs = get_irq_regs();
 
 	int_en = mce_perfmon_read(uncore_unit, NV_PMINTENCLR, 0);
 	ovf = mce_perfmon_read(uncore_unit, NV_PMOVSCLR, 0);
@@ -470,9 +536,24 @@ static irqreturn_t scf_handle_irq(int irq_num, void *data)
 			struct perf_event *event;
 
 			event = uncore_unit->events[idx];
-			if (event) {
-				scf_uncore_event_update(uncore_unit, event, true);
-				scf_uncore_event_set_period(uncore_unit, event);
+			if (!event)
+				continue;
+
+			scf_uncore_event_update(uncore_unit, event);
+			if (!scf_uncore_event_set_period(uncore_unit, event))
+				continue;
+
+			if (!is_sampling_event(event))
+				continue;
+
+			/*
+			 * Samples are attributed to whatever CPU0 was running
+			 * when the uncore counter overflowed.
+			 */
+			perf_sample_data_init(&sample, 0, event->hw.last_period);
+			if (perf_event_overflow(event, &sample, regs)) {
+				scf_uncore_event_stop(event, 0);
+				int_en &= ~BIT(idx);
 			}
 		}
 	}
@@ -484,6 +565,35 @@ static irqreturn_t scf_handle_irq(int irq_num, void *data)
 	return IRQ_HANDLED;
 }
 
+/*
+ * A group is only schedulable if all of its uncore events fit in the
+ * counters of the unit, software events can be mixed in.
+ */
+static bool scf_uncore_validate_group(struct perf_event *event)
+{
+	struct perf_event *leader = event->group_leader;
+	struct perf_event *sibling;
+	int counters = 0;
+
+	if (leader == event)
+		return true;
+
+	if (leader->pmu == event->pmu)
+		counters++;
+	else if (!is_software_event(leader))
+		return false;
+
+	for_each_sibling_event(sibling, leader) {
+		if (sibling->pmu == event->pmu)
+			counters++;
+		else if (!is_software_event(sibling))
+			return false;
+	}
+
+	/* and the new event itself */
+	return counters + 1 <= UNIT_CTRS;
+}
+
 /*
  * event_init: Verify this PMU can handle the desired event
  */
@@ -500,10 +610,10 @@ static int scf_uncore_event_init(struct perf_event *event)
 
 	/*
 	 * The uncore counters are shared by all CPU cores. Therefore it does not
-	 * support sampling mode or attach to a task (per-process mode).
+	 * support attach to a task (per-process mode).
 	 */
-	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK) {
-		dev_dbg(&pdev->dev, "Can't support sampling events\n");
+	if (event->attach_state & PERF_ATTACH_TASK) {
+		dev_dbg(&pdev->dev, "Can't support per-task counters\n");
 		return -EOPNOTSUPP;
 	}
 
@@ -515,6 +625,22 @@ static int scf_uncore_event_init(struct perf_event *event)
 		return -EINVAL;
 	}
 
+	/* Uncore overflows can not be attributed to user or kernel mode */
+	if (is_sampling_event(event) &&
+	    (event->attr.exclude_user || event->attr.exclude_kernel ||
+	     event->attr.exclude_hv || event->attr.exclude_idle)) {
+		dev_dbg(&pdev->dev, "Can't support mode exclusion\n");
+		return -EINVAL;
+	}
+
+	if (!scf_uncore_validate_group(event)) {
+		dev_dbg(&pdev->dev, "Too many events in the group\n");
+		return -EINVAL;
+	}
+
+	/* Everything is counted on the CPU that owns the uncore counters */
+	event->cpu = UNCORE_CPU;
+
 	unit_id = CONFIG_UNIT(event->attr.config);
 	event_id = CONFIG_EVENT(event->attr.config);
 
@@ -545,6 +671,12 @@ static int scf_uncore_event_init(struct perf_event *event)
 	hwc->idx = -1;
 	hwc->config_base = event->attr.config;
 
+	if (!is_sampling_event(event)) {
+		hwc->sample_period = COUNTER_MASK >> 1;
+		hwc->last_period = hwc->sample_period;
+		local64_set(&hwc->period_left, hwc->sample_period);
+	}
+
 	return 0;
 }
 
@@ -593,6 +725,12 @@ static int scf_pmu_device_probe(struct platform_device *pdev)
 		return err;
 	}
 
+	/* Samples are taken from the regs of the CPU that owns the counters */
+	err = irq_set_affinity(irq, cpumask_of(UNCORE_CPU));
+	if (err)
+		dev_warn(&pdev->dev, "Unable to route IRQ to CPU%d: %d\n",
+			 UNCORE_CPU, err);
+
 	err = perf_pmu_register(&uncore_pmu->pmu, uncore_pmu->pmu.name, -1);
 	if (err) {
 		dev_err(&pdev->dev, "Error %d registering T23x SCF Uncore PMU\n", err);
@@ -609,7 +747,6 @@ static int scf_pmu_device_remove(struct platform_device *pdev)
 	struct uncore_pmu *uncore_pmu = platform_get_drvdata(pdev);
 
 	perf_pmu_unregister(&uncore_pmu->pmu);
-	kfree(uncore_pmu);
 	dev_info(&pdev->dev, "Unregistered T23x SCF Uncore PMU\n");
 
 	return 0;
@@ -16,7 +16,9 @@
 #include <linux/io.h>
 #include <linux/hwmon.h>
 #include <linux/hwmon-sysfs.h>
+#include <linux/mutex.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 
 #define DRIVER_NAME "pwm_tach"
 
@@ -78,6 +80,9 @@
 #define TACH_FAN_ERR_PERIOD_SHIFT			0x8
 #define TACH_FAN_INTERRUPT_ENABLE			0x1
 
+/* RPM averaging, sampled from a work since the tach only has error irqs */
+#define TACH_RPM_MAX_SAMPLES				64
+#define TACH_RPM_MIN_SAMPLE_MS				10
 
 struct pwm_tegra_tach_soc_data {
 	bool has_interrupt_support;
@@ -93,6 +98,16 @@ struct pwm_tegra_tach {
 	unsigned int		capture_win_len;
 	unsigned int		upper_threshold;
 	unsigned int		lower_threshold;
+
+	/* RPM averaging, rpm_lock protects all of it */
+	struct mutex		rpm_lock;
+	struct delayed_work	rpm_work;
+	unsigned int		rpm_sample_ms;	/* 0 reads on demand */
+	unsigned int		rpm_nr_samples;	/* averaging window */
+	unsigned int		rpm_samples[TACH_RPM_MAX_SAMPLES];
+	unsigned int		rpm_head;
+	unsigned int		rpm_count;
+	u64			rpm_sum;
 #if !defined(NV_PWM_CHIP_STRUCT_HAS_STRUCT_DEVICE)
 	struct pwm_chip		chip;
 #endif
@@ -108,32 +123,165 @@ static struct pwm_tegra_tach *to_tegra_pwm_chip(struct pwm_chip *chip)
 #endif
 }
 
+static int pwm_tegra_tach_read_rpm(struct pwm_chip *chip, unsigned int *rpm)
+{
+	struct pwm_device *pwm = &chip->pwms[0];
+	struct pwm_capture result;
+	int ret;
+
+	ret = pwm_capture(pwm, &result, 0);
+	if (ret < 0)
+		return ret;
+
+	*rpm = 0;
+	if (result.period)
+		*rpm = DIV_ROUND_CLOSEST_ULL(60ULL * NSEC_PER_SEC,
+					     result.period);
+
+	return 0;
+}
+
+static void pwm_tegra_tach_rpm_reset(struct pwm_tegra_tach *ptt)
+{
+	ptt->rpm_head = 0;
+	ptt->rpm_count = 0;
+	ptt->rpm_sum = 0;
+}
+
+/*
+ * Keep a moving average of the last rpm_nr_samples readings, so reading rpm
+ * is a cache hit and a single slow or missed pulse does not show up.
+ */
+static void pwm_tegra_tach_rpm_work(struct work_struct *work)
+{
+	struct pwm_tegra_tach *ptt = container_of(to_delayed_work(work),
+					struct pwm_tegra_tach, rpm_work);
+	struct pwm_chip *chip = dev_get_drvdata(ptt->dev);
+	unsigned int rpm;
+
+	mutex_lock(&ptt->rpm_lock);
+
+	if (!pwm_tegra_tach_read_rpm(chip, &rpm)) {
+		if (ptt->rpm_count == ptt->rpm_nr_samples)
+			ptt->rpm_sum -= ptt->rpm_samples[ptt->rpm_head];
+		else
+			ptt->rpm_count++;
+
+		ptt->rpm_samples[ptt->rpm_head] = rpm;
+		ptt->rpm_sum += rpm;
+		ptt->rpm_head = (ptt->rpm_head + 1) % ptt->rpm_nr_samples;
+	}
+
+	if (ptt->rpm_sample_ms)
+		queue_delayed_work(system_power_efficient_wq, &ptt->rpm_work,
+				   msecs_to_jiffies(ptt->rpm_sample_ms));
+
+	mutex_unlock(&ptt->rpm_lock);
+}
+
 static ssize_t rpm_show(struct device *dev, struct device_attribute *attr,
 			char *buf)
 {
 	struct pwm_chip *chip = dev_get_drvdata(dev);
-	struct pwm_device *pwm = &chip->pwms[0];
-	struct pwm_capture result;
+	struct pwm_tegra_tach *ptt = to_tegra_pwm_chip(chip);
 	unsigned int rpm = 0;
 	int ret;
 
-	ret = pwm_capture(pwm, &result, 0);
+	mutex_lock(&ptt->rpm_lock);
+	if (ptt->rpm_sample_ms && ptt->rpm_count) {
+		rpm = DIV_ROUND_CLOSEST_ULL(ptt->rpm_sum, ptt->rpm_count);
+		mutex_unlock(&ptt->rpm_lock);
+		return sprintf(buf, "%u\n", rpm);
+	}
+	mutex_unlock(&ptt->rpm_lock);
+
+	ret = pwm_tegra_tach_read_rpm(chip, &rpm);
 	if (ret < 0) {
 		dev_err(dev, "Failed to capture PWM: %d\n", ret);
 		return ret;
 	}
 
-	if (result.period)
-		rpm = DIV_ROUND_CLOSEST_ULL(60ULL * NSEC_PER_SEC,
-					    result.period);
-
 	return sprintf(buf, "%u\n", rpm);
 }
 
 static DEVICE_ATTR_RO(rpm);
 
+static ssize_t rpm_sample_ms_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct pwm_tegra_tach *ptt = to_tegra_pwm_chip(dev_get_drvdata(dev));
+
+	return sprintf(buf, "%u\n", READ_ONCE(ptt->rpm_sample_ms));
+}
+
+/* 0 stops the averaging and rpm reads the tachometer again */
+static ssize_t rpm_sample_ms_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct pwm_tegra_tach *ptt = to_tegra_pwm_chip(dev_get_drvdata(dev));
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	if (val && val < TACH_RPM_MIN_SAMPLE_MS)
+		return -EINVAL;
+
+	cancel_delayed_work_sync(&ptt->rpm_work);
+
+	mutex_lock(&ptt->rpm_lock);
+	ptt->rpm_sample_ms = val;
+	pwm_tegra_tach_rpm_reset(ptt);
+	if (val)
+		queue_delayed_work(system_power_efficient_wq, &ptt->rpm_work, 0);
+	mutex_unlock(&ptt->rpm_lock);
+
+	return count;
+}
+
+static DEVICE_ATTR_RW(rpm_sample_ms);
+
+static ssize_t rpm_average_samples_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct pwm_tegra_tach *ptt = to_tegra_pwm_chip(dev_get_drvdata(dev));
+
+	return sprintf(buf, "%u\n", READ_ONCE(ptt->rpm_nr_samples));
+}
+
+static ssize_t rpm_average_samples_store(struct device *dev,
+					 struct device_attribute *attr,
+					 const char *buf, size_t count)
+{
+	struct pwm_tegra_tach *ptt = to_tegra_pwm_chip(dev_get_drvdata(dev));
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	if (!val || val > TACH_RPM_MAX_SAMPLES)
+		return -EINVAL;
+
+	mutex_lock(&ptt->rpm_lock);
+	ptt->rpm_nr_samples = val;
+	pwm_tegra_tach_rpm_reset(ptt);
+	mutex_unlock(&ptt->rpm_lock);
+
+	return count;
+}
+
+static DEVICE_ATTR_RW(rpm_average_samples);
+
 static struct attribute *pwm_tach_attrs[] = {
 	&dev_attr_rpm.attr,
+	&dev_attr_rpm_sample_ms.attr,
+	&dev_attr_rpm_average_samples.attr,
 	NULL,
 };
 
@@ -383,6 +531,9 @@ static int pwm_tegra_tach_probe(struct platform_device *pdev)
 #endif
 
 	ptt->dev = &pdev->dev;
+	mutex_init(&ptt->rpm_lock);
+	INIT_DELAYED_WORK(&ptt->rpm_work, pwm_tegra_tach_rpm_work);
+	ptt->rpm_nr_samples = 8;
 
 	ptt->soc_data = of_device_get_match_data(&pdev->dev);
 	if (!ptt->soc_data) {
@@ -517,6 +668,11 @@ static int pwm_tegra_tach_remove(struct platform_device *pdev)
 	if (WARN_ON(!ptt))
 		return -ENODEV;
 
+	mutex_lock(&ptt->rpm_lock);
+	ptt->rpm_sample_ms = 0;
+	mutex_unlock(&ptt->rpm_lock);
+	cancel_delayed_work_sync(&ptt->rpm_work);
+
 	reset_control_assert(ptt->rst);
 
 	clk_disable_unprepare(ptt->clk);
@@ -528,6 +684,11 @@ static int pwm_tegra_tach_remove(struct platform_device *pdev)
 
 static int pwm_tegra_tach_suspend(struct device *dev)
 {
+	struct pwm_chip *chip = dev_get_drvdata(dev);
+	struct pwm_tegra_tach *ptt = to_tegra_pwm_chip(chip);
+
+	cancel_delayed_work_sync(&ptt->rpm_work);
+
 	return 0;
 }
 
@@ -538,6 +699,13 @@ static int pwm_tegra_tach_resume(struct device *dev)
 
 	pwm_tegra_tacho_set_wlen(ptt, ptt->capture_win_len);
 
+	/* Readings from before suspend do not describe the fan anymore */
+	mutex_lock(&ptt->rpm_lock);
+	pwm_tegra_tach_rpm_reset(ptt);
+	if (ptt->rpm_sample_ms)
+		queue_delayed_work(system_power_efficient_wq, &ptt->rpm_work, 0);
+	mutex_unlock(&ptt->rpm_lock);
+
 	return 0;
 }
 
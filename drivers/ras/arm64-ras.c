@@ -9,12 +9,74 @@
 #include <linux/platform_device.h>
 #include <linux/arm64-ras.h>
 #include <linux/cpuhotplug.h>
+#include <linux/jiffies.h>
+#include <linux/percpu.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <linux/workqueue.h>
 
 static int fhi_irq[CONFIG_NR_CPUS];
 static u8 is_ras_probe_done;
 static LIST_HEAD(fhi_callback_list);
 static DEFINE_RAW_SPINLOCK(fhi_lock);
 
+/*
+ * Corrected errors are summed up per error record, syndrome and address
+ * and reported every ce_report_ms instead of being logged one by one. A
+ * CPU taking more than ce_storm_threshold FHIs within a second gets its FHI
+ * masked for ce_storm_backoff_ms, the errors stay latched in the records
+ * and are collected once it is unmasked.
+ */
+static unsigned int ce_report_ms = 1000;
+module_param(ce_report_ms, uint, 0644);
+MODULE_PARM_DESC(ce_report_ms,
+	"Corrected error report period in ms (0 = log every error)");
+
+static unsigned int ce_storm_threshold = 100;
+module_param(ce_storm_threshold, uint, 0644);
+MODULE_PARM_DESC(ce_storm_threshold,
+	"FHIs per second on a CPU before its FHI is masked (0 = never)");
+
+static unsigned int ce_storm_backoff_ms = 1000;
+module_param(ce_storm_backoff_ms, uint, 0644);
+MODULE_PARM_DESC(ce_storm_backoff_ms, "How long a storming FHI stays masked");
+
+struct ras_cpu_stats {
+	u64 fhi_count;
+	u64 ce_count;
+	u64 storms;
+	unsigned long window_start;
+	unsigned int window_fhis;
+	bool masked;
+	int cpu;
+	struct delayed_work unmask_work;
+};
+
+static DEFINE_PER_CPU(struct ras_cpu_stats, ras_cpu_stats);
+
+#define RAS_CE_MAX_ENTRIES	64
+#define RAS_CE_NAME_LEN		32
+
+struct ras_ce_entry {
+	char name[RAS_CE_NAME_LEN];
+	int errselr;
+	u16 ierr;
+	u16 serr;
+	bool addr_valid;
+	u64 addr;
+	u64 count;
+	u64 reported;
+	u64 last_ns;
+};
+
+static struct ras_ce_entry ras_ce_entries[RAS_CE_MAX_ENTRIES];
+static unsigned int ras_ce_nr;
+static u64 ras_ce_dropped;
+static DEFINE_RAW_SPINLOCK(ras_ce_lock);
+
+static void ras_ce_report_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(ras_ce_report_work, ras_ce_report_fn);
+
 /* saved hotplug state */
 static enum cpuhp_state hp_state;
 
@@ -252,6 +314,88 @@ int is_ras_ready(void)
 }
 EXPORT_SYMBOL(is_ras_ready);
 
+static void ras_ce_report_fn(struct work_struct *work)
+{
+	struct ras_ce_entry entry;
+	unsigned long flags;
+	bool found;
+	u64 count;
+	unsigned int i;
+
+	for (i = 0; i < RAS_CE_MAX_ENTRIES; i++) {
+		raw_spin_lock_irqsave(&ras_ce_lock, flags);
+		found = i < ras_ce_nr &&
+			ras_ce_entries[i].count != ras_ce_entries[i].reported;
+		if (found) {
+			entry = ras_ce_entries[i];
+			ras_ce_entries[i].reported = entry.count;
+		}
+		raw_spin_unlock_irqrestore(&ras_ce_lock, flags);
+
+		if (!found)
+			continue;
+
+		count = entry.count - entry.reported;
+		if (entry.addr_valid)
+			pr_warn("RAS: %llu corrected errors in %s, ERRSELR_EL1=%d IERR=0x%x SERR=0x%x ADDR=0x%llx\n",
+				count, entry.name, entry.errselr, entry.ierr,
+				entry.serr, entry.addr);
+		else
+			pr_warn("RAS: %llu corrected errors in %s, ERRSELR_EL1=%d IERR=0x%x SERR=0x%x\n",
+				count, entry.name, entry.errselr, entry.ierr,
+				entry.serr);
+	}
+}
+
+/* Called from the FHI, so only account here and leave the printing */
+static void ras_ce_account(struct error_record *record, int errselr,
+			   u16 ierr, u16 serr, bool addr_valid, u64 addr)
+{
+	struct ras_ce_entry *entry = NULL;
+	unsigned long flags;
+	unsigned int i;
+
+	this_cpu_inc(ras_cpu_stats.ce_count);
+
+	raw_spin_lock_irqsave(&ras_ce_lock, flags);
+
+	for (i = 0; i < ras_ce_nr; i++) {
+		struct ras_ce_entry *e = &ras_ce_entries[i];
+
+		if (e->errselr == errselr && e->ierr == ierr &&
+		    e->serr == serr && e->addr_valid == addr_valid &&
+		    (!addr_valid || e->addr == addr) &&
+		    !strncmp(e->name, record->name, RAS_CE_NAME_LEN - 1)) {
+			entry = e;
+			break;
+		}
+	}
+
+	if (!entry && ras_ce_nr < RAS_CE_MAX_ENTRIES) {
+		entry = &ras_ce_entries[ras_ce_nr++];
+		memset(entry, 0, sizeof(*entry));
+		strscpy(entry->name, record->name, RAS_CE_NAME_LEN);
+		entry->errselr = errselr;
+		entry->ierr = ierr;
+		entry->serr = serr;
+		entry->addr_valid = addr_valid;
+		entry->addr = addr_valid ? addr : 0;
+	}
+
+	if (entry) {
+		entry->count++;
+		entry->last_ns = ktime_get_ns();
+	} else {
+		ras_ce_dropped++;
+	}
+
+	raw_spin_unlock_irqrestore(&ras_ce_lock, flags);
+
+	if (!delayed_work_pending(&ras_ce_report_work))
+		schedule_delayed_work(&ras_ce_report_work,
+				      msecs_to_jiffies(READ_ONCE(ce_report_ms)));
+}
+
 void print_error_record(struct error_record *record, u64 status, int errselr)
 {
 	struct ras_error *errors;
@@ -261,6 +405,25 @@ void print_error_record(struct error_record *record, u64 status, int errselr)
 	int found = 0;
 	u64 err_status = 0;
 
+	/* Corrected only, batch it unless every error is to be logged */
+	if (READ_ONCE(ce_report_ms) && get_error_status_ce(status) &&
+	    !(status & (ERRi_STATUS_UE | ERRi_STATUS_OF))) {
+		addr = 0;
+		err_status = ERRi_STATUS_CE | ERRi_STATUS_VALID;
+		if (status & ERRi_STATUS_MV)
+			err_status |= ERRi_STATUS_MV;
+		if (status & ERRi_STATUS_AV) {
+			addr = ras_read_error_address();
+			err_status |= ERRi_STATUS_AV;
+		}
+		ras_write_error_status(err_status);
+
+		ras_ce_account(record, errselr, get_error_status_ierr(status),
+			       get_error_status_serr(status),
+			       status & ERRi_STATUS_AV, addr);
+		return;
+	}
+
 	pr_crit("**************************************\n");
 	pr_crit("RAS Error in %s, ERRSELR_EL1=%d:\n", record->name, errselr);
 	pr_crit("\tStatus = 0x%llx\n", status);
@@ -345,11 +508,32 @@ EXPORT_SYMBOL(print_error_record);
  */
 static irqreturn_t ras_fhi_isr(int irq, void *dev_id)
 {
+	struct ras_cpu_stats *stats = this_cpu_ptr(&ras_cpu_stats);
+	unsigned int threshold = READ_ONCE(ce_storm_threshold);
 	unsigned long flags;
 	struct ras_fhi_callback *callback;
 
+	stats->fhi_count++;
+	if (time_after(jiffies, stats->window_start + HZ)) {
+		stats->window_start = jiffies;
+		stats->window_fhis = 0;
+	}
+
+	if (threshold && ++stats->window_fhis > threshold && !stats->masked) {
+		/* unmasked again by ras_fhi_unmask_fn() */
+		WRITE_ONCE(stats->masked, true);
+		stats->storms++;
+		disable_irq_nosync(irq);
+		schedule_delayed_work(&stats->unmask_work,
+				msecs_to_jiffies(READ_ONCE(ce_storm_backoff_ms)));
+		pr_warn_ratelimited("CPU%d: RAS: FHI %d storm, masked for %u ms\n",
+			smp_processor_id(), irq, READ_ONCE(ce_storm_backoff_ms));
+	}
+
+	if (!READ_ONCE(ce_report_ms))
+		pr_crit("CPU%d: RAS: FHI %d detected\n", smp_processor_id(), irq);
+
 	/* Iterate through the banks looking for one with an error */
-	pr_crit("CPU%d: RAS: FHI %d detected\n", smp_processor_id(), irq);
 
 	raw_spin_lock_irqsave(&fhi_lock, flags);
 	list_for_each_entry(callback, &fhi_callback_list, node) {
@@ -360,6 +544,17 @@ static irqreturn_t ras_fhi_isr(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+static void ras_fhi_unmask_fn(struct work_struct *work)
+{
+	struct ras_cpu_stats *stats = container_of(to_delayed_work(work),
+					struct ras_cpu_stats, unmask_work);
+
+	stats->window_fhis = 0;
+	stats->window_start = jiffies;
+	WRITE_ONCE(stats->masked, false);
+	enable_irq(fhi_irq[stats->cpu]);
+}
+
 static int ras_fhi_enable(unsigned int cpu)
 {
 	if (irq_force_affinity(fhi_irq[cpu], cpumask_of(cpu))) {
@@ -407,6 +602,94 @@ isr_err:
 	return err;
 }
 
+static ssize_t ce_count_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct ras_cpu_stats *stats;
+	ssize_t len = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		stats = per_cpu_ptr(&ras_cpu_stats, cpu);
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "cpu%d fhi %llu ce %llu storms %llu masked %d\n",
+				 cpu, stats->fhi_count, stats->ce_count,
+				 stats->storms, READ_ONCE(stats->masked));
+	}
+
+	return len;
+}
+static DEVICE_ATTR_RO(ce_count);
+
+static ssize_t ce_records_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct ras_ce_entry entry;
+	unsigned long flags;
+	ssize_t len = 0;
+	u64 dropped;
+	unsigned int i;
+	bool found;
+
+	for (i = 0; i < RAS_CE_MAX_ENTRIES; i++) {
+		raw_spin_lock_irqsave(&ras_ce_lock, flags);
+		found = i < ras_ce_nr;
+		if (found)
+			entry = ras_ce_entries[i];
+		raw_spin_unlock_irqrestore(&ras_ce_lock, flags);
+
+		if (!found)
+			break;
+
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%s errselr %d ierr 0x%x serr 0x%x addr ",
+				 entry.name, entry.errselr, entry.ierr,
+				 entry.serr);
+		if (entry.addr_valid)
+			len += scnprintf(buf + len, PAGE_SIZE - len, "0x%llx",
+					 entry.addr);
+		else
+			len += scnprintf(buf + len, PAGE_SIZE - len, "-");
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 " count %llu last_ns %llu\n",
+				 entry.count, entry.last_ns);
+	}
+
+	raw_spin_lock_irqsave(&ras_ce_lock, flags);
+	dropped = ras_ce_dropped;
+	raw_spin_unlock_irqrestore(&ras_ce_lock, flags);
+
+	len += scnprintf(buf + len, PAGE_SIZE - len, "dropped %llu\n", dropped);
+
+	return len;
+}
+
+/* Any write forgets the collected errors */
+static ssize_t ce_records_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&ras_ce_lock, flags);
+	ras_ce_nr = 0;
+	ras_ce_dropped = 0;
+	raw_spin_unlock_irqrestore(&ras_ce_lock, flags);
+
+	return count;
+}
+static DEVICE_ATTR_RW(ce_records);
+
+static struct attribute *ras_attrs[] = {
+	&dev_attr_ce_count.attr,
+	&dev_attr_ce_records.attr,
+	NULL,
+};
+
+static const struct attribute_group ras_attr_group = {
+	.attrs = ras_attrs,
+};
+
 /* This is an API for CPU specific FHI callbacks
  * to be registered with fhi_isr handler
  */
@@ -474,6 +757,18 @@ static int ras_probe(struct platform_device *pdev)
 		return err;
 	}
 
+	for_each_possible_cpu(cpu) {
+		struct ras_cpu_stats *stats = per_cpu_ptr(&ras_cpu_stats, cpu);
+
+		stats->cpu = cpu;
+		stats->window_start = jiffies;
+		INIT_DELAYED_WORK(&stats->unmask_work, ras_fhi_unmask_fn);
+	}
+
+	err = sysfs_create_group(&dev->kobj, &ras_attr_group);
+	if (err < 0)
+		dev_warn(dev, "Failed to create sysfs attributes: %d\n", err);
+
 	/* make sure we have executed everything in the probe
 	 * before setting is_ras_probe_done
 	 */
@@ -485,7 +780,21 @@ static int ras_probe(struct platform_device *pdev)
 
 static int ras_remove(struct platform_device *pdev)
 {
+	struct ras_cpu_stats *stats;
+	int cpu;
+
+	sysfs_remove_group(&pdev->dev.kobj, &ras_attr_group);
+
+	for_each_possible_cpu(cpu) {
+		stats = per_cpu_ptr(&ras_cpu_stats, cpu);
+		if (cancel_delayed_work_sync(&stats->unmask_work))
+			ras_fhi_unmask_fn(&stats->unmask_work.work);
+	}
+
 	cpuhp_remove_state(hp_state);
+	cancel_delayed_work_sync(&ras_ce_report_work);
+	ras_ce_report_fn(NULL);
+
 	return 0;
 }
 
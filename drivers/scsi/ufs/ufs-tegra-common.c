@@ -26,6 +26,11 @@
 #include <linux/pinctrl/consumer.h>
 
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/pm_runtime.h>
+#include <linux/sysfs.h>
+#include <scsi/scsi_cmnd.h>
+#include <scsi/scsi_host.h>
 
 #if defined(NV_UFS_UFSHCD_H_PRESENT)
 #include <drivers-private/scsi/ufs/ufshcd-pltfrm.h>
@@ -988,6 +993,7 @@ static int ufs_tegra_suspend(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 	if (pm_op != UFS_SYSTEM_PM)
 		return 0;
 
+	cancel_delayed_work_sync(&ufs_tegra->scale.work);
 	ufs_tegra->ufshc_state = UFSHC_SUSPEND;
 
 	if (ufs_tegra->soc->chip_id < TEGRA234) {
@@ -1112,6 +1118,13 @@ static int ufs_tegra_resume(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 	pm_runtime_set_active(dev);
 	pm_runtime_enable(dev);
 
+	/* ufshc clock is back at full rate */
+	mutex_lock(&ufs_tegra->scale.lock);
+	ufs_tegra->scale.clk_low = false;
+	if (ufs_tegra->scale.enabled)
+		ufs_tegra_scale_start(ufs_tegra);
+	mutex_unlock(&ufs_tegra->scale.lock);
+
 	return ret;
 
 out_disable_mphylane_clks:
@@ -1122,6 +1135,465 @@ out_disable_ufs_clks:
 	return ret;
 }
 
+/* Nominal HS payload bandwidth per lane in MB/s, rate B, 8b10b */
+static const u32 ufs_tegra_gear_mbps[UFS_TEGRA_SCALE_GEARS] = {
+	0, 145, 291, 583, 1166,
+};
+
+static u32 ufs_tegra_scale_cur_gear(struct ufs_hba *hba)
+{
+	struct ufs_pa_layer_attr *pwr = &hba->pwr_info;
+
+	if (!pwr->hs_rate || (pwr->pwr_rx != FAST_MODE &&
+			      pwr->pwr_rx != FASTAUTO_MODE))
+		return 0;
+
+	if (pwr->gear_rx >= UFS_TEGRA_SCALE_GEARS)
+		return UFS_TEGRA_SCALE_GEARS - 1;
+
+	return pwr->gear_rx;
+}
+
+static u32 ufs_tegra_scale_max_gear(struct ufs_tegra_scale *scale)
+{
+	if (scale->max_gear && scale->max_gear < scale->hw_max_gear)
+		return scale->max_gear;
+
+	return scale->hw_max_gear;
+}
+
+/* Bandwidth of a gear in kB/s over all configured lanes */
+static u64 ufs_tegra_scale_cap(struct ufs_hba *hba, u32 gear)
+{
+	u32 lanes = max_t(u32, hba->pwr_info.lane_rx, 1);
+
+	return (u64)ufs_tegra_gear_mbps[gear] * 1000 * lanes;
+}
+
+static void ufs_tegra_scale_account(struct ufs_tegra_scale *scale)
+{
+	unsigned long now = jiffies;
+
+	scale->time_in_gear_ms[scale->cur_gear] +=
+		jiffies_to_msecs(now - scale->last_jiffies);
+	scale->last_jiffies = now;
+}
+
+static int ufs_tegra_wait_for_doorbell_clr(struct ufs_hba *hba,
+					   u64 timeout_us)
+{
+	ktime_t timeout = ktime_add_us(ktime_get(), timeout_us);
+
+	do {
+		if (!ufshcd_readl(hba, REG_UTP_TASK_REQ_DOOR_BELL) &&
+		    !ufshcd_readl(hba, REG_UTP_TRANSFER_REQ_DOOR_BELL))
+			return 0;
+		usleep_range(50, 100);
+	} while (ktime_before(ktime_get(), timeout));
+
+	return -EBUSY;
+}
+
+static int ufs_tegra_scale_set_clk(struct ufs_tegra_host *ufs_tegra, bool low)
+{
+	struct ufs_tegra_scale *scale = &ufs_tegra->scale;
+	int err;
+
+	if (scale->clk_low == low)
+		return 0;
+
+	err = clk_set_rate(ufs_tegra->ufshc_clk,
+			   low ? scale->clk_min_hz : UFSHC_CLK_FREQ);
+	if (!err)
+		scale->clk_low = low;
+
+	return err;
+}
+
+/*
+ * Switches both directions to the given HS gear and the ufshc clock to the
+ * matching rate. New requests are held off and the doorbells drained first,
+ * the same way the core quiesces the host for clock scaling. Called with
+ * scale->lock held.
+ */
+static int ufs_tegra_scale_change(struct ufs_tegra_host *ufs_tegra,
+				  u32 gear, bool clk_low)
+{
+	struct ufs_tegra_scale *scale = &ufs_tegra->scale;
+	struct ufs_hba *hba = ufs_tegra->hba;
+	struct ufs_pa_layer_attr new_pwr;
+	int err;
+
+#if KERNEL_VERSION(6, 5, 0) <= LINUX_VERSION_CODE
+	ufshcd_hold(hba);
+#else
+	ufshcd_hold(hba, false);
+#endif
+	scsi_block_requests(hba->host);
+	down_write(&hba->clk_scaling_lock);
+
+	err = ufs_tegra_wait_for_doorbell_clr(hba,
+					      UFS_TEGRA_SCALE_DB_TIMEOUT_US);
+	if (err)
+		goto out;
+
+	/* full clock before going up, lower it only once the gear is down */
+	if (!clk_low) {
+		err = ufs_tegra_scale_set_clk(ufs_tegra, false);
+		if (err)
+			goto out;
+	}
+
+	if (gear != ufs_tegra_scale_cur_gear(hba)) {
+		memcpy(&new_pwr, &hba->pwr_info, sizeof(new_pwr));
+		new_pwr.gear_rx = gear;
+		new_pwr.gear_tx = gear;
+
+		scale->busy = true;
+		err = ufshcd_config_pwr_mode(hba, &new_pwr);
+		scale->busy = false;
+		if (err)
+			goto out;
+
+		ufs_tegra_scale_account(scale);
+		scale->cur_gear = ufs_tegra_scale_cur_gear(hba);
+		scale->transitions++;
+	}
+
+	if (clk_low)
+		err = ufs_tegra_scale_set_clk(ufs_tegra, true);
+out:
+	up_write(&hba->clk_scaling_lock);
+	scsi_unblock_requests(hba->host);
+	ufshcd_release(hba);
+
+	if (err) {
+		scale->failures++;
+		dev_err(hba->dev, "gear scaling to HS-G%u failed %d\n",
+			gear, err);
+	}
+
+	return err;
+}
+
+static void ufs_tegra_scale_work(struct work_struct *work)
+{
+	struct ufs_tegra_scale *scale = container_of(to_delayed_work(work),
+					struct ufs_tegra_scale, work);
+	struct ufs_tegra_host *ufs_tegra = container_of(scale,
+					struct ufs_tegra_host, scale);
+	struct ufs_hba *hba = ufs_tegra->hba;
+	unsigned int elapsed_ms;
+	unsigned int reqs;
+	u64 bytes, qd_sum, kbps, qd;
+	u32 gear, target, min_gear, max_gear;
+	bool up, down, clk_low;
+
+	mutex_lock(&scale->lock);
+	if (!scale->enabled)
+		goto unlock;
+
+	elapsed_ms = max_t(unsigned int, 1,
+			   jiffies_to_msecs(jiffies - scale->last_jiffies));
+	ufs_tegra_scale_account(scale);
+
+	bytes = atomic64_xchg(&scale->bytes, 0);
+	qd_sum = atomic64_xchg(&scale->qd_sum, 0);
+	reqs = atomic_xchg(&scale->reqs, 0);
+
+	gear = ufs_tegra_scale_cur_gear(hba);
+	scale->cur_gear = gear;
+
+	/* nothing to scale outside HS mode or while the link is managed */
+	if (!gear || hba->pm_op_in_progress ||
+	    hba->ufshcd_state != UFSHCD_STATE_OPERATIONAL ||
+	    !ufshcd_is_link_active(hba) || pm_runtime_suspended(hba->dev))
+		goto resched;
+
+	kbps = div_u64(bytes, elapsed_ms);
+	qd = reqs ? div_u64(qd_sum, reqs) : 0;
+	max_gear = ufs_tegra_scale_max_gear(scale);
+	min_gear = clamp_t(u32, scale->min_gear, UFS_HS_G1, max_gear);
+
+	up = gear < max_gear &&
+	     (kbps * 100 >= ufs_tegra_scale_cap(hba, gear) *
+			    scale->up_threshold ||
+	      qd >= scale->qd_up);
+	down = gear > min_gear &&
+	       kbps * 100 < ufs_tegra_scale_cap(hba, gear - 1) *
+			    scale->down_threshold &&
+	       qd <= scale->qd_down;
+
+	target = gear;
+	if (up) {
+		scale->down_cnt = 0;
+		if (++scale->up_cnt >= scale->up_hold) {
+			scale->up_cnt = 0;
+			target = gear + 1;
+		}
+	} else if (down) {
+		scale->up_cnt = 0;
+		if (++scale->down_cnt >= scale->down_hold) {
+			scale->down_cnt = 0;
+			target = gear - 1;
+		}
+	} else {
+		scale->up_cnt = 0;
+		scale->down_cnt = 0;
+	}
+
+	/* limits changed through sysfs apply right away */
+	target = clamp_t(u32, target, min_gear, max_gear);
+	clk_low = scale->clk_min_hz && target == min_gear;
+
+	if (target != gear || clk_low != scale->clk_low)
+		ufs_tegra_scale_change(ufs_tegra, target, clk_low);
+
+resched:
+	queue_delayed_work(system_power_efficient_wq, &scale->work,
+			   msecs_to_jiffies(scale->sample_ms));
+unlock:
+	mutex_unlock(&scale->lock);
+}
+
+static void ufs_tegra_scale_reset_stats(struct ufs_tegra_scale *scale)
+{
+	memset(scale->time_in_gear_ms, 0, sizeof(scale->time_in_gear_ms));
+	scale->transitions = 0;
+	scale->failures = 0;
+	scale->last_jiffies = jiffies;
+}
+
+/* Called with scale->lock held */
+static void ufs_tegra_scale_start(struct ufs_tegra_host *ufs_tegra)
+{
+	struct ufs_tegra_scale *scale = &ufs_tegra->scale;
+
+	scale->up_cnt = 0;
+	scale->down_cnt = 0;
+	scale->cur_gear = ufs_tegra_scale_cur_gear(ufs_tegra->hba);
+	scale->last_jiffies = jiffies;
+	atomic64_set(&scale->bytes, 0);
+	atomic64_set(&scale->qd_sum, 0);
+	atomic_set(&scale->reqs, 0);
+	queue_delayed_work(system_power_efficient_wq, &scale->work,
+			   msecs_to_jiffies(scale->sample_ms));
+}
+
+static void ufs_tegra_setup_xfer_req(struct ufs_hba *hba, int tag,
+				     bool is_scsi_cmd)
+{
+	struct ufs_tegra_host *ufs_tegra = hba->priv;
+	struct ufs_tegra_scale *scale = &ufs_tegra->scale;
+	struct scsi_cmnd *cmd;
+
+	if (!is_scsi_cmd || !READ_ONCE(scale->enabled))
+		return;
+
+	cmd = hba->lrb[tag].cmd;
+	if (cmd)
+		atomic64_add(scsi_bufflen(cmd), &scale->bytes);
+	atomic64_add(hweight_long(READ_ONCE(hba->outstanding_reqs)),
+		     &scale->qd_sum);
+	atomic_inc(&scale->reqs);
+}
+
+static inline struct ufs_tegra_host *ufs_tegra_from_dev(struct device *dev)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return hba->priv;
+}
+
+static ssize_t enable_show(struct device *dev,
+			   struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", ufs_tegra_from_dev(dev)->scale.enabled);
+}
+
+static ssize_t enable_store(struct device *dev,
+			    struct device_attribute *attr,
+			    const char *buf, size_t count)
+{
+	struct ufs_tegra_host *ufs_tegra = ufs_tegra_from_dev(dev);
+	struct ufs_tegra_scale *scale = &ufs_tegra->scale;
+	bool enable;
+	int err;
+
+	err = kstrtobool(buf, &enable);
+	if (err)
+		return err;
+
+	mutex_lock(&scale->lock);
+	if (enable == scale->enabled) {
+		mutex_unlock(&scale->lock);
+		return count;
+	}
+
+	WRITE_ONCE(scale->enabled, enable);
+	if (enable)
+		ufs_tegra_scale_start(ufs_tegra);
+	else
+		ufs_tegra_scale_account(scale);
+	mutex_unlock(&scale->lock);
+
+	if (!enable)
+		cancel_delayed_work_sync(&scale->work);
+
+	return count;
+}
+static DEVICE_ATTR_RW(enable);
+
+#define UFS_TEGRA_SCALE_ATTR(_name, _min, _max)				\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	return sprintf(buf, "%u\n",					\
+		       ufs_tegra_from_dev(dev)->scale._name);		\
+}									\
+									\
+static ssize_t _name##_store(struct device *dev,			\
+			     struct device_attribute *attr,		\
+			     const char *buf, size_t count)		\
+{									\
+	struct ufs_tegra_scale *scale = &ufs_tegra_from_dev(dev)->scale;\
+	u32 val;							\
+	int err;							\
+									\
+	err = kstrtou32(buf, 0, &val);					\
+	if (err)							\
+		return err;						\
+	if (val < (_min) || val > (_max))				\
+		return -EINVAL;						\
+									\
+	mutex_lock(&scale->lock);					\
+	scale->_name = val;						\
+	mutex_unlock(&scale->lock);					\
+									\
+	return count;							\
+}									\
+static DEVICE_ATTR_RW(_name)
+
+UFS_TEGRA_SCALE_ATTR(sample_ms, 10, 10000);
+UFS_TEGRA_SCALE_ATTR(up_threshold, 1, 100);
+UFS_TEGRA_SCALE_ATTR(down_threshold, 0, 100);
+UFS_TEGRA_SCALE_ATTR(up_hold, 1, 1000);
+UFS_TEGRA_SCALE_ATTR(down_hold, 1, 1000);
+UFS_TEGRA_SCALE_ATTR(qd_up, 1, 32);
+UFS_TEGRA_SCALE_ATTR(qd_down, 0, 32);
+UFS_TEGRA_SCALE_ATTR(min_gear, UFS_HS_G1, UFS_HS_G4);
+UFS_TEGRA_SCALE_ATTR(max_gear, 0, UFS_HS_G4);
+UFS_TEGRA_SCALE_ATTR(clk_min_hz, 0, UFSHC_CLK_FREQ);
+
+static ssize_t time_in_gear_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct ufs_tegra_scale *scale = &ufs_tegra_from_dev(dev)->scale;
+	ssize_t len = 0;
+	unsigned int i;
+
+	mutex_lock(&scale->lock);
+	if (scale->enabled)
+		ufs_tegra_scale_account(scale);
+
+	for (i = 0; i < UFS_TEGRA_SCALE_GEARS; i++) {
+		if (i)
+			len += sprintf(buf + len, "%sHS-G%u %llu\n",
+				       i == scale->cur_gear ? "*" : " ",
+				       i, scale->time_in_gear_ms[i]);
+		else
+			len += sprintf(buf + len, "%sother %llu\n",
+				       i == scale->cur_gear ? "*" : " ",
+				       scale->time_in_gear_ms[i]);
+	}
+	len += sprintf(buf + len, "transitions %llu\n", scale->transitions);
+	len += sprintf(buf + len, "failures %llu\n", scale->failures);
+	len += sprintf(buf + len, "clk_low %d\n", scale->clk_low);
+	mutex_unlock(&scale->lock);
+
+	return len;
+}
+
+/* Any write clears the statistics */
+static ssize_t time_in_gear_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct ufs_tegra_scale *scale = &ufs_tegra_from_dev(dev)->scale;
+
+	mutex_lock(&scale->lock);
+	ufs_tegra_scale_reset_stats(scale);
+	mutex_unlock(&scale->lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(time_in_gear);
+
+static struct attribute *ufs_tegra_scale_attrs[] = {
+	&dev_attr_enable.attr,
+	&dev_attr_sample_ms.attr,
+	&dev_attr_up_threshold.attr,
+	&dev_attr_down_threshold.attr,
+	&dev_attr_up_hold.attr,
+	&dev_attr_down_hold.attr,
+	&dev_attr_qd_up.attr,
+	&dev_attr_qd_down.attr,
+	&dev_attr_min_gear.attr,
+	&dev_attr_max_gear.attr,
+	&dev_attr_clk_min_hz.attr,
+	&dev_attr_time_in_gear.attr,
+	NULL,
+};
+
+static const struct attribute_group ufs_tegra_scale_group = {
+	.name = "tegra_scaling",
+	.attrs = ufs_tegra_scale_attrs,
+};
+
+static void ufs_tegra_scale_init(struct ufs_tegra_host *ufs_tegra)
+{
+	struct ufs_tegra_scale *scale = &ufs_tegra->scale;
+	struct device *dev = ufs_tegra->hba->dev;
+	int err;
+
+	mutex_init(&scale->lock);
+	INIT_DEFERRABLE_WORK(&scale->work, ufs_tegra_scale_work);
+	scale->sample_ms = UFS_TEGRA_SCALE_SAMPLE_MS;
+	scale->up_threshold = UFS_TEGRA_SCALE_UP_THRESHOLD;
+	scale->down_threshold = UFS_TEGRA_SCALE_DOWN_THRESHOLD;
+	scale->up_hold = UFS_TEGRA_SCALE_UP_HOLD;
+	scale->down_hold = UFS_TEGRA_SCALE_DOWN_HOLD;
+	scale->qd_up = UFS_TEGRA_SCALE_QD_UP;
+	scale->qd_down = UFS_TEGRA_SCALE_QD_DOWN;
+	scale->min_gear = UFS_HS_G1;
+	scale->last_jiffies = jiffies;
+
+	/* the attributes may be read before the core sets drvdata */
+	dev_set_drvdata(dev, ufs_tegra->hba);
+	err = sysfs_create_group(&dev->kobj, &ufs_tegra_scale_group);
+	if (err)
+		dev_warn(dev, "gear scaling sysfs failed %d\n", err);
+
+	if (ufs_tegra->enable_hs_mode && ufs_tegra->enable_gear_scaling) {
+		mutex_lock(&scale->lock);
+		scale->enabled = true;
+		ufs_tegra_scale_start(ufs_tegra);
+		mutex_unlock(&scale->lock);
+	}
+}
+
+static void ufs_tegra_scale_exit(struct ufs_tegra_host *ufs_tegra)
+{
+	struct ufs_tegra_scale *scale = &ufs_tegra->scale;
+
+	sysfs_remove_group(&ufs_tegra->hba->dev->kobj, &ufs_tegra_scale_group);
+
+	mutex_lock(&scale->lock);
+	WRITE_ONCE(scale->enabled, false);
+	mutex_unlock(&scale->lock);
+	cancel_delayed_work_sync(&scale->work);
+}
+
 static void ufs_tegra_print_power_mode_config(struct ufs_hba *hba,
 			struct ufs_pa_layer_attr *configured_params)
 {
@@ -1261,6 +1733,12 @@ static int ufs_tegra_pwr_change_notify(struct ufs_hba *hba,
 			sizeof(struct ufs_pa_layer_attr));
 		break;
 	case POST_CHANGE:
+		/* the gear negotiated outside the policy is its ceiling */
+		if (dev_req_params->hs_rate && !ufs_tegra->scale.busy &&
+		    dev_req_params->gear_rx > ufs_tegra->scale.hw_max_gear)
+			ufs_tegra->scale.hw_max_gear = min_t(u32,
+					dev_req_params->gear_rx,
+					UFS_TEGRA_SCALE_GEARS - 1);
 		ufs_tegra_print_power_mode_config(hba, dev_req_params);
 		ufshcd_dme_get(hba, UIC_ARG_MIB(PA_SCRAMBLING), &pa_reg_check);
 		if (pa_reg_check & SCREN)
@@ -1422,6 +1900,9 @@ static int ufs_tegra_config_soc_data(struct ufs_tegra_host *ufs_tegra)
 	ufs_tegra->configure_uphy_pll3 =
 		of_property_read_bool(np, "nvidia,configure-uphy-pll3");
 
+	ufs_tegra->enable_gear_scaling =
+		of_property_read_bool(np, "nvidia,enable-gear-scaling");
+
 
 	of_property_read_u32(np, "nvidia,max-hs-gear", &ufs_tegra->max_hs_gear);
 	of_property_read_u32(np, "nvidia,max-pwm-gear",
@@ -1849,6 +2330,7 @@ end:
 #ifdef CONFIG_DEBUG_FS
 	ufs_tegra_init_debugfs(hba);
 #endif
+	ufs_tegra_scale_init(ufs_tegra);
 
 	return err;
 
@@ -1866,6 +2348,7 @@ static void ufs_tegra_exit(struct ufs_hba *hba)
 {
 	struct ufs_tegra_host *ufs_tegra = hba->priv;
 
+	ufs_tegra_scale_exit(ufs_tegra);
 	ufs_tegra_disable_mphylane_clks(ufs_tegra);
 
 #ifdef CONFIG_DEBUG_FS
@@ -1889,6 +2372,7 @@ struct ufs_hba_variant_ops ufs_hba_tegra_vops = {
 	.hce_enable_notify      = ufs_tegra_hce_enable_notify,
 	.link_startup_notify	= ufs_tegra_link_startup_notify,
 	.pwr_change_notify      = ufs_tegra_pwr_change_notify,
+	.setup_xfer_req		= ufs_tegra_setup_xfer_req,
 };
 
 static int ufs_tegra_probe(struct platform_device *pdev)
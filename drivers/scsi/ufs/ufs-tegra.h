@@ -6,6 +6,9 @@
 #define _UFS_TEGRA_H
 
 #include <linux/io.h>
+#include <linux/atomic.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #define NV_ADDRESS_MAP_MPHY_L0_BASE		0x02470000
 #define NV_ADDRESS_MAP_MPHY_L1_BASE		0x02480000
@@ -161,6 +164,55 @@ enum ufs_state {
 	UFSHC_RESUME,
 };
 
+/* Dynamic gear scaling defaults */
+#define UFS_TEGRA_SCALE_GEARS			5	/* PWM/unknown, HS-G1..G4 */
+#define UFS_TEGRA_SCALE_SAMPLE_MS		100
+#define UFS_TEGRA_SCALE_UP_THRESHOLD		60	/* % of current gear */
+#define UFS_TEGRA_SCALE_DOWN_THRESHOLD		40	/* % of next lower gear */
+#define UFS_TEGRA_SCALE_UP_HOLD			1	/* samples */
+#define UFS_TEGRA_SCALE_DOWN_HOLD		10	/* samples */
+#define UFS_TEGRA_SCALE_QD_UP			8
+#define UFS_TEGRA_SCALE_QD_DOWN			2
+#define UFS_TEGRA_SCALE_DB_TIMEOUT_US		1000000
+
+/*
+ * Load driven HS gear scaling. Throughput and queue depth are sampled
+ * from setup_xfer_req, the work moves one gear per decision.
+ */
+struct ufs_tegra_scale {
+	struct delayed_work work;
+	/* protects everything below */
+	struct mutex lock;
+	bool enabled;
+	/* a gear change requested by the policy is in progress */
+	bool busy;
+	/* ufshc clock runs at clk_min_hz */
+	bool clk_low;
+	u32 sample_ms;
+	u32 up_threshold;
+	u32 down_threshold;
+	u32 up_hold;
+	u32 down_hold;
+	u32 qd_up;
+	u32 qd_down;
+	u32 min_gear;
+	/* 0 = highest gear negotiated with the device */
+	u32 max_gear;
+	/* ufshc clock at min_gear, 0 = never lowered */
+	u32 clk_min_hz;
+	u32 hw_max_gear;
+	u32 cur_gear;
+	unsigned int up_cnt;
+	unsigned int down_cnt;
+	unsigned long last_jiffies;
+	u64 time_in_gear_ms[UFS_TEGRA_SCALE_GEARS];
+	u64 transitions;
+	u64 failures;
+	atomic64_t bytes;
+	atomic64_t qd_sum;
+	atomic_t reqs;
+};
+
 /* vendor specific pre-defined parameters */
 
 /*
@@ -337,6 +389,7 @@ struct ufs_tegra_host {
 	bool mask_fast_auto_mode;
 	bool mask_hs_mode_b;
 	bool configure_uphy_pll3;
+	bool enable_gear_scaling;
 	u32 max_pwm_gear;
 	enum ufs_state ufshc_state;
 	void *mphy_context;
@@ -391,6 +444,7 @@ struct ufs_tegra_host {
 	u32 ref_clk_freq;
 	struct ufs_tegra_soc_data *soc;
 	u32 streamid;
+	struct ufs_tegra_scale scale;
 #ifdef CONFIG_DEBUG_FS
 	u32 refclk_value;
 	long program_refclk;
@@ -19,6 +19,7 @@
 #include <linux/kthread.h>
 #include <linux/sched/signal.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/of.h>
@@ -350,6 +351,20 @@ struct tegra_spi_data {
 	int				rx_trig_words;
 	int				force_unpacked_mode;
 	bool				lsbyte_first;
+
+	/* continuous receive into a cyclic rx dma ring */
+	struct mutex			msg_lock;
+	bool				ring_active;
+	struct tegra124_spi_slave_ring	ring;
+	void				*ring_buf;
+	dma_addr_t			ring_phys;
+	size_t				ring_len;
+	dma_cookie_t			ring_cookie;
+	bool				ring_has_residue;
+	u64				ring_head;
+	u64				ring_tail;
+	u64				ring_missed;
+	u64				ring_fifo_ovf;
 #ifdef PROFILE_SPI_SLAVE
 	ktime_t				start_time;
 	ktime_t				end_time;
@@ -397,6 +412,29 @@ static ssize_t force_unpacked_mode_show(struct device *dev,
 
 static DEVICE_ATTR(force_unpacked_mode, 0644, force_unpacked_mode_show,
 						force_unpacked_mode_set);
+
+static ssize_t ring_stats_show(struct device *dev,
+			       struct device_attribute *attr,
+			       char *buf)
+{
+	struct tegra_spi_data *tspi;
+	struct spi_controller *controller = dev_get_drvdata(dev);
+	unsigned long flags;
+	ssize_t ret;
+
+	if (!controller)
+		return -ENODEV;
+
+	tspi = spi_controller_get_devdata(controller);
+	spin_lock_irqsave(&tspi->lock, flags);
+	ret = sprintf(buf, "active %d head %llu tail %llu missed %llu fifo_ovf %llu\n",
+		      tspi->ring_active, tspi->ring_head, tspi->ring_tail,
+		      tspi->ring_missed, tspi->ring_fifo_ovf);
+	spin_unlock_irqrestore(&tspi->lock, flags);
+	return ret;
+}
+
+static DEVICE_ATTR_RO(ring_stats);
 #endif
 
 static inline unsigned long tegra_spi_readl(struct tegra_spi_data *tspi,
@@ -1250,6 +1288,49 @@ static void set_best_clk_source(struct spi_device *spi,
 	}
 }
 
+static int tegra_spi_set_core_clk(struct spi_device *spi,
+		struct tegra_spi_data *tspi, u32 speed)
+{
+	u32 core_speed;
+	int ret;
+
+	/* Set slave controller clk 1.5 times the bus frequency */
+	if (!speed)
+		speed = spi->max_speed_hz;
+
+	if (tspi->chip_data->new_features) {
+		/* In case of new feature, all DMA interfaces are async.
+		 * so only 1.5x freq ration required
+		 * Set speed to 2x to avoid border cases where actual
+		 * clock is not same requested rate
+		 */
+		core_speed = (speed * 2);
+	} else {
+		/* To maintain min 1.5x and max 4x ratio between
+		 * slave core clk and interface clk
+		 */
+		core_speed = speed * 3;
+	}
+	if (core_speed > spi->max_speed_hz)
+		core_speed = spi->max_speed_hz;
+
+	if (core_speed < ((speed * 3) >> 1)) {
+		dev_err(tspi->dev, "Cannot set requested clk freq %d\n", speed);
+		return -EINVAL;
+	}
+
+	if (core_speed != tspi->cur_speed) {
+		set_best_clk_source(spi, core_speed);
+		ret = clk_set_rate(tspi->clk, core_speed);
+		if (ret) {
+			dev_err(tspi->dev, "Failed to set clk freq %d\n", ret);
+			return -EINVAL;
+		}
+		tspi->cur_speed = core_speed;
+	}
+	return 0;
+}
+
 static int tegra_spi_start_transfer_one(struct spi_device *spi,
 		struct spi_transfer *t, bool is_first_of_msg,
 		bool is_single_xfer)
@@ -1257,7 +1338,6 @@ static int tegra_spi_start_transfer_one(struct spi_device *spi,
 	struct tegra_spi_data *tspi = spi_controller_get_devdata(spi->controller);
 	struct tegra_spi_controller_data *cdata = spi->controller_data;
 	u32 speed;
-	u32 core_speed;
 	u8 bits_per_word;
 	unsigned int total_fifo_words;
 	int ret;
@@ -1266,11 +1346,11 @@ static int tegra_spi_start_transfer_one(struct spi_device *spi,
 
 	bits_per_word = t->bits_per_word;
 	speed = t->speed_hz ? t->speed_hz : spi->max_speed_hz;
-	/* Set slave controller clk 1.5 times the bus frequency */
-	if (!speed)
-		speed = spi->max_speed_hz;
+	ret = tegra_spi_set_core_clk(spi, tspi, speed);
+	if (ret < 0)
+		return ret;
 
-	if (tspi->chip_data->new_features) {
+	tspi->cur_spi = spi;
 		/* In case of new feature, all DMA interfaces are async.
 		 * so only 1.5x freq ration required
 		 * Set speed to 2x to avoid border cases where actual
@@ -1298,10 +1378,6 @@ static int tegra_spi_start_transfer_one(struct spi_device *spi,
 			dev_err(tspi->dev, "Failed to set clk freq %d\n", ret);
 			return -EINVAL;
 		}
-		tspi->cur_speed = core_speed;
-	}
-
-	tspi->cur_spi = spi;
 	tspi->curr_xfer = t;
 	tspi->curr_rx_pos = 0;
 	tspi->curr_pos = 0;
@@ -1770,9 +1846,19 @@ static int tegra_spi_transfer_one_message(struct spi_controller *controller,
 	msg->status = 0;
 	msg->actual_length = 0;
 
+	/* the ring owns the controller until it is stopped */
+	mutex_lock(&tspi->msg_lock);
+	if (tspi->ring_active) {
+		mutex_unlock(&tspi->msg_lock);
+		msg->status = -EBUSY;
+		spi_finalize_current_message(controller);
+		return -EBUSY;
+	}
+
 	ret = pm_runtime_get_sync(tspi->dev);
 	if (ret < 0) {
 		dev_err(tspi->dev, "runtime PM get failed: %d\n", ret);
+		mutex_unlock(&tspi->msg_lock);
 		msg->status = ret;
 		spi_finalize_current_message(controller);
 		return ret;
@@ -1843,11 +1929,377 @@ static int tegra_spi_transfer_one_message(struct spi_controller *controller,
 exit:
 	tegra_spi_writel(tspi, tspi->def_command1_reg, SPI_COMMAND1);
 	pm_runtime_put(tspi->dev);
+	mutex_unlock(&tspi->msg_lock);
 	msg->status = ret;
 	spi_finalize_current_message(controller);
 	return ret;
 }
 
+/* Last segment the cyclic dma has finished, from its position in the ring */
+static unsigned int tegra_spi_ring_dma_seg(struct tegra_spi_data *tspi)
+{
+	struct dma_tx_state state;
+	size_t pos;
+
+	dmaengine_tx_status(tspi->rx_dma_chan, tspi->ring_cookie, &state);
+	if (!state.residue || state.residue > tspi->ring_len)
+		pos = 0;
+	else
+		pos = tspi->ring_len - state.residue;
+
+	/* segment being filled now, everything before it is complete */
+	return pos / tspi->ring.seg_len;
+}
+
+static void tegra_spi_ring_dma_complete(void *args)
+{
+	struct tegra_spi_data *tspi = args;
+	struct tegra124_spi_slave_ring *ring = &tspi->ring;
+	unsigned int nsegs = ring->nsegs;
+	unsigned long flags;
+	unsigned int done;
+	u64 start, head, pending;
+
+	spin_lock_irqsave(&tspi->lock, flags);
+	if (!tspi->ring_active) {
+		spin_unlock_irqrestore(&tspi->lock, flags);
+		return;
+	}
+
+	/*
+	 * Completions of several periods can be folded into one callback,
+	 * so the dma position decides how far the ring moved. A full lap
+	 * between two callbacks can not be told apart from no progress.
+	 */
+	if (tspi->ring_has_residue)
+		done = (tegra_spi_ring_dma_seg(tspi) + nsegs -
+			(unsigned int)(tspi->ring_head % nsegs)) % nsegs;
+	else
+		done = 1;
+
+	start = tspi->ring_head;
+	tspi->ring_head += done;
+	head = tspi->ring_head;
+
+	/* the segment the dma is filling now can not be held by the client */
+	pending = head - tspi->ring_tail;
+	if (pending > nsegs - 1) {
+		tspi->ring_missed += pending - (nsegs - 1);
+		tspi->ring_tail = head - (nsegs - 1);
+		start = max(start, tspi->ring_tail);
+	}
+	spin_unlock_irqrestore(&tspi->lock, flags);
+
+	for (; start < head; start++) {
+		unsigned int seg = start % nsegs;
+
+		if (ring->seg_done)
+			ring->seg_done(ring->client_data, seg,
+				       tspi->ring_buf + seg * ring->seg_len,
+				       ring->seg_len);
+	}
+
+	if (!ring->manual_release) {
+		spin_lock_irqsave(&tspi->lock, flags);
+		if (tspi->ring_tail < head)
+			tspi->ring_tail = head;
+		spin_unlock_irqrestore(&tspi->lock, flags);
+	}
+}
+
+static int tegra_spi_ring_start_dma(struct tegra_spi_data *tspi)
+{
+	struct dma_async_tx_descriptor *desc;
+	struct dma_slave_config dma_sconfig;
+	struct dma_slave_caps caps;
+	unsigned int seg_len = tspi->ring.seg_len;
+	unsigned long val;
+	int maxburst;
+	int ret;
+
+	/* same attention level selection as the per message transfers */
+	if (seg_len & 0xF) {
+		val = SPI_RX_TRIG_1;
+		maxburst = 1;
+	} else if ((seg_len >> 4) & 0x1) {
+		val = SPI_RX_TRIG_4;
+		maxburst = 4;
+	} else {
+		val = SPI_RX_TRIG_8;
+		maxburst = 8;
+	}
+
+	memset(&dma_sconfig, 0, sizeof(dma_sconfig));
+	dma_sconfig.src_addr = tspi->phys + SPI_RX_FIFO;
+	dma_sconfig.src_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES;
+	dma_sconfig.src_maxburst = maxburst;
+	ret = dmaengine_slave_config(tspi->rx_dma_chan, &dma_sconfig);
+	if (ret < 0) {
+		dev_err(tspi->dev, "DMA slave config failed: %d\n", ret);
+		return ret;
+	}
+
+	tspi->ring_has_residue =
+		!dma_get_slave_caps(tspi->rx_dma_chan, &caps) &&
+		caps.residue_granularity != DMA_RESIDUE_GRANULARITY_DESCRIPTOR;
+
+	desc = dmaengine_prep_dma_cyclic(tspi->rx_dma_chan, tspi->ring_phys,
+					 tspi->ring_len, seg_len,
+					 DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	if (!desc) {
+		dev_err(tspi->dev, "Not able to get cyclic desc for Rx\n");
+		return -EIO;
+	}
+
+	desc->callback = tegra_spi_ring_dma_complete;
+	desc->callback_param = tspi;
+	tspi->ring_cookie = dmaengine_submit(desc);
+	dma_async_issue_pending(tspi->rx_dma_chan);
+
+	/* only rx overflow is worth an interrupt, there is no end of block */
+	if (tspi->chip_data->intr_mask_reg) {
+		unsigned long intr_mask;
+
+		intr_mask = tegra_spi_readl(tspi, SPI_INTR_MASK);
+		intr_mask |= SPI_INTR_CS_MASK | SPI_INTR_FRAME_END_MASK |
+			SPI_INTR_RDY_MASK | SPI_INTR_RX_FIFO_UNF_MASK |
+			SPI_INTR_TX_FIFO_UNF_MASK | SPI_INTR_TX_FIFO_OVF_MASK;
+		intr_mask &= ~SPI_INTR_RX_FIFO_OVF_MASK;
+		tegra_spi_writel(tspi, intr_mask, SPI_INTR_MASK);
+	}
+
+	/* continuous mode ignores the block count and runs until stopped */
+	tegra_spi_writel(tspi, SPI_DMA_BLK_SET(MAX_PACKETS - 1), SPI_DMA_BLK);
+	val |= SPI_CONT;
+	tegra_spi_writel(tspi, val, SPI_DMA_CTL);
+	tspi->dma_control_reg = val;
+	tspi->is_curr_dma_xfer = true;
+	tspi->cur_direction = DATA_DIR_RX;
+
+	val |= SPI_DMA_EN;
+	dump_regs(dbg, tspi, "Before ring DMA EN");
+	tegra_spi_writel(tspi, val, SPI_DMA_CTL);
+	tegra_spi_fence(tspi);
+
+	return tegra_spi_ext_clk_enable(true, tspi);
+}
+
+int tegra124_spi_slave_ring_start(struct spi_device *spi,
+				  const struct tegra124_spi_slave_ring *ring)
+{
+	struct spi_controller *controller = spi->controller;
+	struct tegra_spi_data *tspi = spi_controller_get_devdata(controller);
+	unsigned long command1, flags;
+	unsigned int bits_per_word;
+	int req_mode;
+	int ret;
+
+	if (!tspi || !ring || ring->nsegs < 2 || !ring->seg_len ||
+	    ring->seg_len % 4)
+		return -EINVAL;
+
+	bits_per_word = spi->bits_per_word;
+	tspi->bytes_per_word = (bits_per_word - 1) / 8 + 1;
+	/* the ring holds bytes as they came off the wire */
+	if (!tspi->force_unpacked_mode &&
+	    (bits_per_word == 8 || bits_per_word == 16)) {
+		tspi->is_packed = 1;
+		tspi->words_per_32bit = 32 / bits_per_word;
+	} else if (bits_per_word == 32) {
+		tspi->is_packed = 0;
+		tspi->words_per_32bit = 1;
+	} else {
+		dev_err(tspi->dev, "ring needs 8, 16 or 32 bits per word\n");
+		return -EINVAL;
+	}
+
+	/* a slave message can wait for the master forever, do not block */
+	if (!mutex_trylock(&tspi->msg_lock))
+		return -EBUSY;
+	if (tspi->ring_active) {
+		ret = -EBUSY;
+		goto exit_unlock;
+	}
+
+	ret = pm_runtime_get_sync(tspi->dev);
+	if (ret < 0) {
+		dev_err(tspi->dev, "runtime PM get failed: %d\n", ret);
+		pm_runtime_put_noidle(tspi->dev);
+		goto exit_unlock;
+	}
+
+	tspi->ring = *ring;
+	tspi->ring_len = (size_t)ring->seg_len * ring->nsegs;
+	tspi->ring_buf = dma_alloc_coherent(tspi->dev, tspi->ring_len,
+					    &tspi->ring_phys, GFP_KERNEL);
+	if (!tspi->ring_buf) {
+		ret = -ENOMEM;
+		goto exit_pm_put;
+	}
+
+	ret = tegra_spi_set_core_clk(spi, tspi, spi->max_speed_hz);
+	if (ret < 0)
+		goto exit_free;
+
+	tegra_spi_ext_clk_enable(false, tspi);
+	tspi->reset_ctrl_status = true;
+	reset_controller(tspi);
+	ret = check_and_clear_fifo(tspi);
+	if (ret < 0)
+		goto exit_free;
+
+	command1 = tspi->def_command1_reg;
+	command1 |= SPI_BIT_LENGTH(bits_per_word - 1);
+	command1 &= ~(SPI_CONTROL_MODE_MASK | SPI_CS_SEL_MASK | SPI_TX_EN);
+	req_mode = spi->mode & 0x3;
+	command1 |= SPI_MODE_SEL(req_mode);
+	if (spi->mode & SPI_LSB_FIRST)
+		command1 |= SPI_LSBIT_FE;
+	if (tspi->is_packed)
+		command1 |= SPI_PACKED;
+	command1 |= SPI_RX_EN;
+#if defined(NV_SPI_GET_CHIPSELECT_PRESENT)
+	command1 |= SPI_CS_SEL(spi_get_chipselect(spi, 0));
+#else
+	command1 |= SPI_CS_SEL(spi->chip_select);
+#endif
+	tegra_spi_writel(tspi, command1, SPI_COMMAND1);
+	tspi->command1_reg = command1;
+	tspi->cur_spi = spi;
+
+	spin_lock_irqsave(&tspi->lock, flags);
+	tspi->ring_head = 0;
+	tspi->ring_tail = 0;
+	tspi->ring_missed = 0;
+	tspi->ring_fifo_ovf = 0;
+	tspi->ring_active = true;
+	spin_unlock_irqrestore(&tspi->lock, flags);
+
+	ret = tegra_spi_ring_start_dma(tspi);
+	if (ret < 0)
+		goto exit_stop;
+
+	tegra_spi_slave_ready(tspi);
+	mutex_unlock(&tspi->msg_lock);
+	return 0;
+
+exit_stop:
+	spin_lock_irqsave(&tspi->lock, flags);
+	tspi->ring_active = false;
+	spin_unlock_irqrestore(&tspi->lock, flags);
+	dmaengine_terminate_all(tspi->rx_dma_chan);
+	dmaengine_synchronize(tspi->rx_dma_chan);
+	tspi->reset_ctrl_status = true;
+	reset_controller(tspi);
+	tegra_spi_writel(tspi, tspi->def_command1_reg, SPI_COMMAND1);
+exit_free:
+	dma_free_coherent(tspi->dev, tspi->ring_len, tspi->ring_buf,
+			  tspi->ring_phys);
+	tspi->ring_buf = NULL;
+exit_pm_put:
+	pm_runtime_put(tspi->dev);
+exit_unlock:
+	mutex_unlock(&tspi->msg_lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(tegra124_spi_slave_ring_start);
+
+void tegra124_spi_slave_ring_stop(struct spi_device *spi)
+{
+	struct spi_controller *controller = spi->controller;
+	struct tegra_spi_data *tspi = spi_controller_get_devdata(controller);
+	unsigned long flags;
+
+	mutex_lock(&tspi->msg_lock);
+	spin_lock_irqsave(&tspi->lock, flags);
+	if (!tspi->ring_active) {
+		spin_unlock_irqrestore(&tspi->lock, flags);
+		mutex_unlock(&tspi->msg_lock);
+		return;
+	}
+	tspi->ring_active = false;
+	spin_unlock_irqrestore(&tspi->lock, flags);
+
+	tegra_spi_slave_busy(tspi);
+	tegra_spi_writel(tspi, tspi->dma_control_reg & ~SPI_CONT,
+			 SPI_DMA_CTL);
+	tegra_spi_ext_clk_enable(false, tspi);
+	dmaengine_terminate_all(tspi->rx_dma_chan);
+	/* no segment callback may run once the ring is freed */
+	dmaengine_synchronize(tspi->rx_dma_chan);
+
+	tspi->reset_ctrl_status = true;
+	reset_controller(tspi);
+	tegra_spi_writel(tspi, tspi->def_command1_reg, SPI_COMMAND1);
+
+	dev_dbg(tspi->dev, "ring stopped: head %llu missed %llu fifo-ovf %llu\n",
+		tspi->ring_head, tspi->ring_missed, tspi->ring_fifo_ovf);
+
+	dma_free_coherent(tspi->dev, tspi->ring_len, tspi->ring_buf,
+			  tspi->ring_phys);
+	tspi->ring_buf = NULL;
+	pm_runtime_put(tspi->dev);
+	mutex_unlock(&tspi->msg_lock);
+}
+EXPORT_SYMBOL_GPL(tegra124_spi_slave_ring_stop);
+
+int tegra124_spi_slave_ring_release(struct spi_device *spi,
+				    unsigned int count)
+{
+	struct tegra_spi_data *tspi = spi_controller_get_devdata(spi->controller);
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&tspi->lock, flags);
+	if (!tspi->ring_active)
+		ret = -ENODEV;
+	else if (count > tspi->ring_head - tspi->ring_tail)
+		ret = -EINVAL;
+	else
+		tspi->ring_tail += count;
+	spin_unlock_irqrestore(&tspi->lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(tegra124_spi_slave_ring_release);
+
+int tegra124_spi_slave_ring_get_stats(struct spi_device *spi,
+				struct tegra124_spi_slave_ring_stats *stats)
+{
+	struct tegra_spi_data *tspi = spi_controller_get_devdata(spi->controller);
+	unsigned long flags;
+
+	if (!tspi || !stats)
+		return -EINVAL;
+
+	spin_lock_irqsave(&tspi->lock, flags);
+	stats->head = tspi->ring_head;
+	stats->tail = tspi->ring_tail;
+	stats->missed = tspi->ring_missed;
+	stats->fifo_overflows = tspi->ring_fifo_ovf;
+	spin_unlock_irqrestore(&tspi->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(tegra124_spi_slave_ring_get_stats);
+
+int tegra124_spi_slave_ring_mmap(struct spi_device *spi,
+				 struct vm_area_struct *vma)
+{
+	struct tegra_spi_data *tspi = spi_controller_get_devdata(spi->controller);
+
+	if (!tspi->ring_active)
+		return -ENODEV;
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(tspi->ring_len))
+		return -EINVAL;
+
+	return dma_mmap_coherent(tspi->dev, vma, tspi->ring_buf,
+				 tspi->ring_phys, tspi->ring_len);
+}
+EXPORT_SYMBOL_GPL(tegra124_spi_slave_ring_mmap);
+
 static irqreturn_t tegra_spi_isr(int irq, void *context_data)
 {
 	struct tegra_spi_data *tspi = context_data;
@@ -1856,6 +2308,19 @@ static irqreturn_t tegra_spi_isr(int irq, void *context_data)
 	status_reg = tegra_spi_readl(tspi, SPI_FIFO_STATUS);
 	dump_regs(dbg, tspi, "@isr");
 
+	if (tspi->ring_active) {
+		/* received words were dropped, the ring keeps running */
+		if (status_reg & SPI_RX_FIFO_OVF) {
+			spin_lock(&tspi->lock);
+			tspi->ring_fifo_ovf++;
+			spin_unlock(&tspi->lock);
+			dev_err_ratelimited(tspi->dev, "ring rx fifo overflow\n");
+		}
+		tegra_spi_writel(tspi, status_reg & SPI_FIFO_ERROR,
+				 SPI_FIFO_STATUS);
+		return IRQ_HANDLED;
+	}
+
 	tegra_spi_clear_status(tspi);
 
 	/* if isr was not expected */
@@ -2038,6 +2503,7 @@ static int tegra_spi_probe(struct platform_device *pdev)
 	gpiod_direction_output(tspi->gpio_slave_ready, deassert_val);
 
 	spin_lock_init(&tspi->lock);
+	mutex_init(&tspi->msg_lock);
 
 	r = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	if (!r) {
@@ -2151,8 +2617,14 @@ static int tegra_spi_probe(struct platform_device *pdev)
 	if (ret != 0)
 		goto exit_unregister_controller;
 
+	ret = device_create_file(&pdev->dev, &dev_attr_ring_stats);
+	if (ret != 0)
+		goto exit_remove_unpacked_mode;
+
 	return ret;
 
+exit_remove_unpacked_mode:
+	device_remove_file(&pdev->dev, &dev_attr_force_unpacked_mode);
 exit_unregister_controller:
 	spi_unregister_controller(controller);
 
@@ -2180,6 +2652,7 @@ static int tegra_spi_remove(struct platform_device *pdev)
 	struct tegra_spi_data	*tspi = spi_controller_get_devdata(controller);
 
 #ifdef TEGRA_SPI_SLAVE_DEBUG
+	device_remove_file(&pdev->dev, &dev_attr_ring_stats);
 	device_remove_file(&pdev->dev, &dev_attr_force_unpacked_mode);
 #endif
 	free_irq(tspi->irq, tspi);
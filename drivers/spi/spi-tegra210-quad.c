@@ -121,6 +121,7 @@
 
 #define QSPI_DMA_BLK				0x024
 #define QSPI_DMA_BLK_SET(x)			(((x) & 0xffff) << 0)
+#define QSPI_DMA_BLK_MAX_WORDS			0x10000
 
 #define QSPI_DMA_MEM_ADDRESS_REG		0x028
 #define QSPI_DMA_HI_ADDRESS_REG			0x02c
@@ -224,6 +225,8 @@ struct tegra_qspi {
 	unsigned int				dma_buf_size;
 	unsigned int				max_buf_size;
 	bool					is_curr_dma_xfer;
+	bool					is_direct_dma;
+	bool					is_cmb_seq;
 
 	struct completion			rx_dma_complete;
 	struct completion			tx_dma_complete;
@@ -330,6 +333,20 @@ static void tegra_qspi_mask_clear_irq(struct tegra_qspi *tqspi)
 		tegra_qspi_writel(tqspi, QSPI_ERR | QSPI_FIFO_ERROR, QSPI_FIFO_STATUS);
 }
 
+/*
+ * Tegra QSPI controller supports packed or unpacked mode transfers.
+ * Packed mode is used for data transfers using 8, 16, or 32 bits per
+ * word with a minimum transfer of 1 word and for all other transfers
+ * unpacked mode will be used.
+ */
+static bool tegra_qspi_xfer_is_packed(struct spi_transfer *t)
+{
+	unsigned int bits_per_word = t->bits_per_word;
+
+	return (bits_per_word == 8 || bits_per_word == 16 ||
+		bits_per_word == 32) && t->len > 3;
+}
+
 static unsigned int
 tegra_qspi_calculate_curr_xfer_param(struct tegra_qspi *tqspi, struct spi_transfer *t)
 {
@@ -339,15 +356,7 @@ tegra_qspi_calculate_curr_xfer_param(struct tegra_qspi *tqspi, struct spi_transf
 
 	tqspi->bytes_per_word = DIV_ROUND_UP(bits_per_word, 8);
 
-	/*
-	 * Tegra QSPI controller supports packed or unpacked mode transfers.
-	 * Packed mode is used for data transfers using 8, 16, or 32 bits per
-	 * word with a minimum transfer of 1 word and for all other transfers
-	 * unpacked mode will be used.
-	 */
-
-	if ((bits_per_word == 8 || bits_per_word == 16 ||
-	     bits_per_word == 32) && t->len > 3) {
+	if (tegra_qspi_xfer_is_packed(t)) {
 		tqspi->is_packed = true;
 		tqspi->words_per_32bit = 32 / bits_per_word;
 	} else {
@@ -356,7 +365,15 @@ tegra_qspi_calculate_curr_xfer_param(struct tegra_qspi *tqspi, struct spi_transf
 	}
 
 	if (tqspi->is_packed) {
-		max_len = min(remain_len, tqspi->max_buf_size);
+		/*
+		 * Client buffers mapped for DMA are only bounded by the block
+		 * count of the controller, bounced ones by the DMA buffers.
+		 */
+		if (tqspi->is_direct_dma)
+			max_len = min(remain_len,
+				      QSPI_DMA_BLK_MAX_WORDS * tqspi->bytes_per_word);
+		else
+			max_len = min(remain_len, tqspi->max_buf_size);
 		tqspi->curr_dma_words = max_len / tqspi->bytes_per_word;
 		total_fifo_words = (max_len + 3) / 4;
 	} else {
@@ -465,6 +482,11 @@ tegra_qspi_read_rx_fifo_to_client_rxbuf(struct tegra_qspi *tqspi, struct spi_tra
 static void
 tegra_qspi_copy_client_txbuf_to_qspi_txbuf(struct tegra_qspi *tqspi, struct spi_transfer *t)
 {
+	if (tqspi->is_direct_dma) {
+		tqspi->cur_tx_pos += tqspi->curr_dma_words * tqspi->bytes_per_word;
+		return;
+	}
+
 	dma_sync_single_for_cpu(tqspi->dev, tqspi->tx_dma_phys,
 				tqspi->dma_buf_size, DMA_TO_DEVICE);
 
@@ -477,7 +499,10 @@ tegra_qspi_copy_client_txbuf_to_qspi_txbuf(struct tegra_qspi *tqspi, struct spi_
 	 * ignored by the hardware and are invalid bits.
 	 */
 	if (tqspi->is_packed) {
-		tqspi->cur_tx_pos += tqspi->curr_dma_words * tqspi->bytes_per_word;
+		unsigned int len = tqspi->curr_dma_words * tqspi->bytes_per_word;
+
+		memcpy(tqspi->tx_dma_buf, t->tx_buf + tqspi->cur_tx_pos, len);
+		tqspi->cur_tx_pos += len;
 	} else {
 		u8 *tx_buf = (u8 *)t->tx_buf + tqspi->cur_tx_pos;
 		unsigned int i, count, consume, write_bytes;
@@ -508,11 +533,19 @@ tegra_qspi_copy_client_txbuf_to_qspi_txbuf(struct tegra_qspi *tqspi, struct spi_
 static void
 tegra_qspi_copy_qspi_rxbuf_to_client_rxbuf(struct tegra_qspi *tqspi, struct spi_transfer *t)
 {
+	if (tqspi->is_direct_dma) {
+		tqspi->cur_rx_pos += tqspi->curr_dma_words * tqspi->bytes_per_word;
+		return;
+	}
+
 	dma_sync_single_for_cpu(tqspi->dev, tqspi->rx_dma_phys,
 				tqspi->dma_buf_size, DMA_FROM_DEVICE);
 
 	if (tqspi->is_packed) {
-		tqspi->cur_rx_pos += tqspi->curr_dma_words * tqspi->bytes_per_word;
+		unsigned int len = tqspi->curr_dma_words * tqspi->bytes_per_word;
+
+		memcpy(t->rx_buf + tqspi->cur_rx_pos, tqspi->rx_dma_buf, len);
+		tqspi->cur_rx_pos += len;
 	} else {
 		unsigned char *rx_buf = t->rx_buf + tqspi->cur_rx_pos;
 		u32 rx_mask = ((u32)1 << t->bits_per_word) - 1;
@@ -548,17 +581,10 @@ static void tegra_qspi_dma_complete(void *args)
 	complete(dma_complete);
 }
 
-static int tegra_qspi_start_tx_dma(struct tegra_qspi *tqspi, struct spi_transfer *t, int len)
+static int tegra_qspi_start_tx_dma(struct tegra_qspi *tqspi, dma_addr_t tx_dma_phys, int len)
 {
-	dma_addr_t tx_dma_phys;
-
 	reinit_completion(&tqspi->tx_dma_complete);
 
-	if (tqspi->is_packed)
-		tx_dma_phys = t->tx_dma;
-	else
-		tx_dma_phys = tqspi->tx_dma_phys;
-
 	tqspi->tx_dma_desc = dmaengine_prep_slave_single(tqspi->tx_dma_chan, tx_dma_phys,
 							 len, DMA_MEM_TO_DEV,
 							 DMA_PREP_INTERRUPT |  DMA_CTRL_ACK);
@@ -576,17 +602,10 @@ static int tegra_qspi_start_tx_dma(struct tegra_qspi *tqspi, struct spi_transfer
 	return 0;
 }
 
-static int tegra_qspi_start_rx_dma(struct tegra_qspi *tqspi, struct spi_transfer *t, int len)
+static int tegra_qspi_start_rx_dma(struct tegra_qspi *tqspi, dma_addr_t rx_dma_phys, int len)
 {
-	dma_addr_t rx_dma_phys;
-
 	reinit_completion(&tqspi->rx_dma_complete);
 
-	if (tqspi->is_packed)
-		rx_dma_phys = t->rx_dma;
-	else
-		rx_dma_phys = tqspi->rx_dma_phys;
-
 	tqspi->rx_dma_desc = dmaengine_prep_slave_single(tqspi->rx_dma_chan, rx_dma_phys,
 							 len, DMA_DEV_TO_MEM,
 							 DMA_PREP_INTERRUPT |  DMA_CTRL_ACK);
@@ -635,41 +654,64 @@ static void tegra_qspi_unmask_irq(struct tegra_qspi *tqspi)
 	tegra_qspi_writel(tqspi, intr_mask, QSPI_INTR_MASK);
 }
 
-static int tegra_qspi_dma_map_xfer(struct tegra_qspi *tqspi, struct spi_transfer *t)
+static bool tegra_qspi_buf_dma_capable(const void *buf)
 {
-	u8 *tx_buf = (u8 *)t->tx_buf + tqspi->cur_tx_pos;
-	u8 *rx_buf = (u8 *)t->rx_buf + tqspi->cur_rx_pos;
-	unsigned int len;
+	return virt_addr_valid(buf) && IS_ALIGNED((unsigned long)buf, 4);
+}
+
+/*
+ * Packed transfers above the FIFO depth are DMAed straight from and to the
+ * client buffers when those are in the linear map and the DMA, which always
+ * moves whole FIFO words, can not run past their end. The buffers are mapped
+ * once for the whole transfer. Everything else is bounced through the
+ * preallocated DMA buffers.
+ */
+static void tegra_qspi_dma_map_xfer(struct tegra_qspi *tqspi, struct spi_transfer *t)
+{
+	tqspi->is_direct_dma = false;
+
+	if (!tqspi->use_dma || !tegra_qspi_xfer_is_packed(t))
+		return;
 
-	len = DIV_ROUND_UP(tqspi->curr_dma_words * tqspi->bytes_per_word, 4) * 4;
+	if (t->len <= (QSPI_FIFO_DEPTH << 2) || !IS_ALIGNED(t->len, 4))
+		return;
+
+	if ((t->tx_buf && !tegra_qspi_buf_dma_capable(t->tx_buf)) ||
+	    (t->rx_buf && !tegra_qspi_buf_dma_capable(t->rx_buf)))
+		return;
 
 	if (t->tx_buf) {
-		t->tx_dma = dma_map_single(tqspi->dev, (void *)tx_buf, len, DMA_TO_DEVICE);
+		t->tx_dma = dma_map_single(tqspi->dev, (void *)t->tx_buf, t->len,
+					   DMA_TO_DEVICE);
 		if (dma_mapping_error(tqspi->dev, t->tx_dma))
-			return -ENOMEM;
+			return;
 	}
 
 	if (t->rx_buf) {
-		t->rx_dma = dma_map_single(tqspi->dev, (void *)rx_buf, len, DMA_FROM_DEVICE);
+		t->rx_dma = dma_map_single(tqspi->dev, t->rx_buf, t->len,
+					   DMA_FROM_DEVICE);
 		if (dma_mapping_error(tqspi->dev, t->rx_dma)) {
-			dma_unmap_single(tqspi->dev, t->tx_dma, len, DMA_TO_DEVICE);
-			return -ENOMEM;
+			if (t->tx_buf)
+				dma_unmap_single(tqspi->dev, t->tx_dma, t->len,
+						 DMA_TO_DEVICE);
+			return;
 		}
 	}
 
-	return 0;
+	tqspi->is_direct_dma = true;
 }
 
 static void tegra_qspi_dma_unmap_xfer(struct tegra_qspi *tqspi, struct spi_transfer *t)
 {
-	unsigned int len;
-
-	len = DIV_ROUND_UP(tqspi->curr_dma_words * tqspi->bytes_per_word, 4) * 4;
+	if (!tqspi->is_direct_dma)
+		return;
 
 	if (t->tx_buf)
-		dma_unmap_single(tqspi->dev, t->tx_dma, len, DMA_TO_DEVICE);
+		dma_unmap_single(tqspi->dev, t->tx_dma, t->len, DMA_TO_DEVICE);
 	if (t->rx_buf)
-		dma_unmap_single(tqspi->dev, t->rx_dma, len, DMA_FROM_DEVICE);
+		dma_unmap_single(tqspi->dev, t->rx_dma, t->len, DMA_FROM_DEVICE);
+
+	tqspi->is_direct_dma = false;
 }
 
 static int tegra_qspi_start_dma_based_transfer(struct tegra_qspi *tqspi, struct spi_transfer *t)
@@ -682,10 +724,12 @@ static int tegra_qspi_start_dma_based_transfer(struct tegra_qspi *tqspi, struct
 	u32 val;
 	bool has_ext_dma = tqspi->soc_data->dma_mode & QSPI_DMA_EXT;
 
-	if (tqspi->is_packed) {
-		ret = tegra_qspi_dma_map_xfer(tqspi, t);
-		if (ret < 0)
-			return ret;
+	if (tqspi->is_direct_dma) {
+		tx_dma_phys = t->tx_dma + tqspi->cur_tx_pos;
+		rx_dma_phys = t->rx_dma + tqspi->cur_rx_pos;
+	} else {
+		tx_dma_phys = tqspi->tx_dma_phys;
+		rx_dma_phys = tqspi->rx_dma_phys;
 	}
 
 	val = QSPI_DMA_BLK_SET(tqspi->curr_dma_words - 1);
@@ -718,10 +762,6 @@ static int tegra_qspi_start_dma_based_transfer(struct tegra_qspi *tqspi, struct
 
 	dma_sconfig.device_fc = true;
 	if ((tqspi->cur_direction & DATA_DIR_TX) && !has_ext_dma) {
-		if (tqspi->is_packed)
-			tx_dma_phys = t->tx_dma;
-		else
-			tx_dma_phys = tqspi->tx_dma_phys;
 		tegra_qspi_copy_client_txbuf_to_qspi_txbuf(tqspi, t);
 		tegra_qspi_writel(tqspi, lower_32_bits(tx_dma_phys),
 				  QSPI_DMA_MEM_ADDRESS_REG);
@@ -738,7 +778,7 @@ static int tegra_qspi_start_dma_based_transfer(struct tegra_qspi *tqspi, struct
 		}
 
 		tegra_qspi_copy_client_txbuf_to_qspi_txbuf(tqspi, t);
-		ret = tegra_qspi_start_tx_dma(tqspi, t, len);
+		ret = tegra_qspi_start_tx_dma(tqspi, tx_dma_phys, len);
 		if (ret < 0) {
 			dev_err(tqspi->dev, "failed to starting TX DMA: %d\n", ret);
 			return ret;
@@ -746,10 +786,6 @@ static int tegra_qspi_start_dma_based_transfer(struct tegra_qspi *tqspi, struct
 	}
 
 	if ((tqspi->cur_direction & DATA_DIR_RX) && !has_ext_dma) {
-		if (tqspi->is_packed)
-			rx_dma_phys = t->rx_dma;
-		else
-			rx_dma_phys = tqspi->rx_dma_phys;
 		tegra_qspi_writel(tqspi, (rx_dma_phys & 0xffffffff),
 				  QSPI_DMA_MEM_ADDRESS_REG);
 		tegra_qspi_writel(tqspi, ((rx_dma_phys >> 32) & 0xff),
@@ -764,11 +800,12 @@ static int tegra_qspi_start_dma_based_transfer(struct tegra_qspi *tqspi, struct
 			return ret;
 		}
 
-		dma_sync_single_for_device(tqspi->dev, tqspi->rx_dma_phys,
-					   tqspi->dma_buf_size,
-					   DMA_FROM_DEVICE);
+		if (!tqspi->is_direct_dma)
+			dma_sync_single_for_device(tqspi->dev, tqspi->rx_dma_phys,
+						   tqspi->dma_buf_size,
+						   DMA_FROM_DEVICE);
 
-		ret = tegra_qspi_start_rx_dma(tqspi, t, len);
+		ret = tegra_qspi_start_rx_dma(tqspi, rx_dma_phys, len);
 		if (ret < 0) {
 			dev_err(tqspi->dev, "failed to start RX DMA: %d\n", ret);
 			if (tqspi->cur_direction & DATA_DIR_TX)
@@ -1028,6 +1065,7 @@ static int tegra_qspi_start_transfer_one(struct spi_device *spi,
 	u8 bus_width = 0;
 	int ret;
 
+	tegra_qspi_dma_map_xfer(tqspi, t);
 	total_fifo_words = tegra_qspi_calculate_curr_xfer_param(tqspi, t);
 
 	command1 &= ~QSPI_PACKED;
@@ -1065,13 +1103,22 @@ static int tegra_qspi_start_transfer_one(struct spi_device *spi,
 
 	ret = tegra_qspi_flush_fifos(tqspi, false);
 	if (ret < 0)
-		return ret;
+		goto err_unmap;
 
-	if (tqspi->use_dma && total_fifo_words > QSPI_FIFO_DEPTH)
+	/* A mapped client buffer must not be touched by the CPU, tail included */
+	if (tqspi->is_direct_dma ||
+	    (tqspi->use_dma && total_fifo_words > QSPI_FIFO_DEPTH))
 		ret = tegra_qspi_start_dma_based_transfer(tqspi, t);
 	else
 		ret = tegra_qspi_start_cpu_based_transfer(tqspi, t);
 
+	if (ret < 0)
+		goto err_unmap;
+
+	return 0;
+
+err_unmap:
+	tegra_qspi_dma_unmap_xfer(tqspi, t);
 	return ret;
 }
 
@@ -1211,6 +1258,27 @@ static u32 tegra_qspi_addr_config(bool is_ddr, u8 bus_width, u8 len)
 	return addr_config;
 }
 
+/*
+ * Command and address of a combined sequence go out with the first chunk of
+ * the data only. CS is held between the chunks, so the rest of the data are
+ * plain transfers the device keeps streaming.
+ */
+static void tegra_qspi_cmb_seq_next_chunk(struct tegra_qspi *tqspi)
+{
+	u32 val;
+
+	if (!tqspi->is_cmb_seq)
+		return;
+
+	val = tegra_qspi_readl(tqspi, QSPI_GLOBAL_CONFIG);
+	val &= ~QSPI_CMB_SEQ_EN;
+	tegra_qspi_writel(tqspi, val, QSPI_GLOBAL_CONFIG);
+
+	tqspi->dummy_cycles = 0;
+	tegra_qspi_writel(tqspi, QSPI_NUM_DUMMY_CYCLE(0), QSPI_MISC_REG);
+	tqspi->is_cmb_seq = false;
+}
+
 static int tegra_qspi_combined_seq_xfer(struct tegra_qspi *tqspi,
 					struct spi_message *msg)
 {
@@ -1224,6 +1292,7 @@ static int tegra_qspi_combined_seq_xfer(struct tegra_qspi *tqspi,
 	u32 address_value = 0;
 	u32 cmd_config = 0, addr_config = 0;
 	u8 cmd_value = 0, val = 0;
+	unsigned long flags;
 
 	/* Enable Combined sequence mode */
 	val = tegra_qspi_readl(tqspi, QSPI_GLOBAL_CONFIG);
@@ -1264,6 +1333,7 @@ static int tegra_qspi_combined_seq_xfer(struct tegra_qspi *tqspi,
 					  QSPI_CMB_SEQ_ADDR_CFG);
 
 			reinit_completion(&tqspi->xfer_completion);
+			tqspi->is_cmb_seq = true;
 			cmd1 = tegra_qspi_setup_transfer_one(spi, xfer,
 							     is_first_msg);
 			ret = tegra_qspi_start_transfer_one(spi, xfer,
@@ -1293,6 +1363,10 @@ static int tegra_qspi_combined_seq_xfer(struct tegra_qspi *tqspi,
 					dmaengine_terminate_all
 						(tqspi->rx_dma_chan);
 
+				spin_lock_irqsave(&tqspi->lock, flags);
+				tegra_qspi_dma_unmap_xfer(tqspi, xfer);
+				spin_unlock_irqrestore(&tqspi->lock, flags);
+
 				/* Abort transfer by resetting pio/dma bit */
 				if (!tqspi->is_curr_dma_xfer) {
 					cmd1 = tegra_qspi_readl
@@ -1353,6 +1427,7 @@ static int tegra_qspi_non_combined_seq_xfer(struct tegra_qspi *tqspi,
 	struct spi_transfer *transfer;
 	bool is_first_msg = true;
 	bool has_ext_dma = tqspi->soc_data->dma_mode & QSPI_DMA_EXT;
+	unsigned long flags;
 	int ret = 0, val = 0;
 
 	msg->status = 0;
@@ -1364,6 +1439,7 @@ static int tegra_qspi_non_combined_seq_xfer(struct tegra_qspi *tqspi,
 	val = tegra_qspi_readl(tqspi, QSPI_GLOBAL_CONFIG);
 	val &= ~QSPI_CMB_SEQ_EN;
 	tegra_qspi_writel(tqspi, val, QSPI_GLOBAL_CONFIG);
+	tqspi->is_cmb_seq = false;
 	list_for_each_entry(transfer, &msg->transfers, transfer_list) {
 		struct spi_transfer *xfer = transfer;
 		u8 dummy_bytes = 0;
@@ -1411,6 +1487,9 @@ static int tegra_qspi_non_combined_seq_xfer(struct tegra_qspi *tqspi,
 			if (tqspi->is_curr_dma_xfer && has_ext_dma &&
 			    (tqspi->cur_direction & DATA_DIR_RX))
 				dmaengine_terminate_all(tqspi->rx_dma_chan);
+			spin_lock_irqsave(&tqspi->lock, flags);
+			tegra_qspi_dma_unmap_xfer(tqspi, xfer);
+			spin_unlock_irqrestore(&tqspi->lock, flags);
 			tegra_qspi_handle_error(tqspi);
 			ret = -EIO;
 			goto complete_xfer;
@@ -1483,9 +1562,6 @@ static bool tegra_qspi_validate_cmb_seq(struct tegra_qspi *tqspi,
 	if (!tqspi->soc_data->dma_mode && xfer->len > (QSPI_FIFO_DEPTH << 2))
 		return false;
 
-	if (xfer->len > tqspi->dma_buf_size)
-		return false;
-
 	return true;
 }
 
@@ -1531,6 +1607,7 @@ static irqreturn_t handle_cpu_based_xfer(struct tegra_qspi *tqspi)
 		goto exit;
 	}
 
+	tegra_qspi_cmb_seq_next_chunk(tqspi);
 	tegra_qspi_calculate_curr_xfer_param(tqspi, t);
 	tegra_qspi_start_cpu_based_transfer(tqspi, t);
 exit:
@@ -1610,11 +1687,10 @@ static irqreturn_t handle_dma_based_xfer(struct tegra_qspi *tqspi)
 		goto exit;
 	}
 
-	tegra_qspi_dma_unmap_xfer(tqspi, t);
-
 	/* continue transfer in current message */
+	tegra_qspi_cmb_seq_next_chunk(tqspi);
 	total_fifo_words = tegra_qspi_calculate_curr_xfer_param(tqspi, t);
-	if (total_fifo_words > QSPI_FIFO_DEPTH)
+	if (tqspi->is_direct_dma || total_fifo_words > QSPI_FIFO_DEPTH)
 		err = tegra_qspi_start_dma_based_transfer(tqspi, t);
 	else
 		err = tegra_qspi_start_cpu_based_transfer(tqspi, t);
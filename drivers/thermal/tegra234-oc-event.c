@@ -3,58 +3,114 @@
 
 #include <dt-bindings/thermal/tegra234-soctherm.h>
 #include <linux/err.h>
+#include <linux/fs.h>
 #include <linux/hwmon-sysfs.h>
 #include <linux/hwmon.h>
+#include <linux/kref.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
 #include <linux/sysfs.h>
+#include <linux/timekeeping.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include <soc/tegra/bpmp-abi.h>
 #include <soc/tegra/bpmp.h>
+#include <uapi/linux/tegra-thermal-event.h>
+
+static unsigned int oc_poll_ms = 1;
+module_param(oc_poll_ms, uint, 0644);
+MODULE_PARM_DESC(oc_poll_ms,
+	"Period to query the OC status while /dev/soctherm-oc is open, in ms");
 
 struct oc_soc_data {
 	const struct attribute_group **attr_groups;
+	unsigned int nr_alarms;
+};
+
+struct tegra234_oc_event;
+
+/*
+ * Status page of the char device. It outlives the device while user space
+ * still has it open or mapped, hence the reference count.
+ */
+struct tegra234_oc_status {
+	struct kref ref;
+	wait_queue_head_t waitq;
+	struct tegra_oc_event_page *page;
+	/* serializes users against the driver going away */
+	struct mutex lock;
+	struct tegra234_oc_event *oc;
+	unsigned int users;
+	bool dead;
+};
+
+/* what a reader of the char device has seen */
+struct tegra234_oc_file {
+	struct tegra234_oc_status *status;
+	u32 seq;
 };
 
 struct tegra234_oc_event {
 	struct device *hwmon;
 	struct tegra_bpmp *bpmp;
 	const struct oc_soc_data *soc_data;
+	struct tegra234_oc_status *status;
+	struct miscdevice miscdev;
+	struct delayed_work poll_work;
 };
 
-static ssize_t throt_en_show(struct device *dev, struct device_attribute *attr,
-			     char *buf)
+static int tegra234_oc_get_status(struct device *dev, struct tegra_bpmp *bpmp,
+				  struct mrq_oc_status_response *resp)
 {
 	int err = 0;
-	struct tegra234_oc_event *tegra234_oc = dev_get_drvdata(dev);
-	struct sensor_device_attribute *sensor_attr =
-		container_of(attr, struct sensor_device_attribute, dev_attr);
-	struct mrq_oc_status_response resp;
 	struct tegra_bpmp_message msg = {
 		.mrq = MRQ_OC_STATUS,
 		.rx = {
-			.data = &resp,
-			.size = sizeof(resp),
+			.data = resp,
+			.size = sizeof(*resp),
 		},
 	};
 
-	if (sensor_attr->index < 0) {
-		dev_err(dev, "Negative index for OC events\n");
-		return -EDOM;
-	}
-
-	err = tegra_bpmp_transfer(tegra234_oc->bpmp, &msg);
+	/* ratelimited, this also runs from the poll work */
+	err = tegra_bpmp_transfer(bpmp, &msg);
 	if (err) {
-		dev_err(dev, "Failed to transfer message: %d\n", err);
+		dev_err_ratelimited(dev, "Failed to transfer message: %d\n", err);
 		return err;
 	}
 
 	if (msg.rx.ret < 0) {
-		dev_err(dev, "Negative bpmp message return value: %d\n",
+		dev_err_ratelimited(dev, "Negative bpmp message return value: %d\n",
 			msg.rx.ret);
 		return -EINVAL;
 	}
 
+	return 0;
+}
+
+static ssize_t throt_en_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	int err = 0;
+	struct tegra234_oc_event *tegra234_oc = dev_get_drvdata(dev);
+	struct sensor_device_attribute *sensor_attr =
+		container_of(attr, struct sensor_device_attribute, dev_attr);
+	struct mrq_oc_status_response resp;
+
+	if (sensor_attr->index < 0) {
+		dev_err(dev, "Negative index for OC events\n");
+		return -EDOM;
+	}
+
+	err = tegra234_oc_get_status(dev, tegra234_oc->bpmp, &resp);
+	if (err)
+		return err;
+
 	return sprintf(buf, "%u\n", resp.throt_en[sensor_attr->index]);
 }
 
@@ -66,30 +122,15 @@ static ssize_t event_cnt_show(struct device *dev, struct device_attribute *attr,
 	struct sensor_device_attribute *sensor_attr =
 		container_of(attr, struct sensor_device_attribute, dev_attr);
 	struct mrq_oc_status_response resp;
-	struct tegra_bpmp_message msg = {
-		.mrq = MRQ_OC_STATUS,
-		.rx = {
-			.data = &resp,
-			.size = sizeof(resp),
-		},
-	};
 
 	if (sensor_attr->index < 0) {
 		dev_err(dev, "Negative index for OC events\n");
 		return -EDOM;
 	}
 
-	err = tegra_bpmp_transfer(tegra234_oc->bpmp, &msg);
-	if (err) {
-		dev_err(dev, "Failed to transfer message: %d\n", err);
+	err = tegra234_oc_get_status(dev, tegra234_oc->bpmp, &resp);
+	if (err)
 		return err;
-	}
-
-	if (msg.rx.ret < 0) {
-		dev_err(dev, "Negative bpmp message return value: %d\n",
-			msg.rx.ret);
-		return -EINVAL;
-	}
 
 	return sprintf(buf, "%u\n", resp.event_cnt[sensor_attr->index]);
 }
@@ -146,6 +187,233 @@ static const struct attribute_group *t234_oc_groups[] = {
 
 static const struct oc_soc_data t234_oc_soc_data = {
 	.attr_groups = t234_oc_groups,
+	.nr_alarms = TEGRA234_SOCTHERM_EDP_OC_CNT,
+};
+
+static struct tegra234_oc_status *tegra234_oc_status_alloc(unsigned int nr)
+{
+	struct tegra234_oc_status *status;
+
+	status = kzalloc(sizeof(*status), GFP_KERNEL);
+	if (!status)
+		return NULL;
+
+	status->page = vmalloc_user(PAGE_SIZE);
+	if (!status->page) {
+		kfree(status);
+		return NULL;
+	}
+
+	kref_init(&status->ref);
+	init_waitqueue_head(&status->waitq);
+	mutex_init(&status->lock);
+	status->page->version = TEGRA_OC_EVENT_PAGE_VERSION;
+	status->page->nr_alarms = min_t(unsigned int, nr,
+					TEGRA_OC_EVENT_MAX_ALARMS);
+
+	return status;
+}
+
+static void tegra234_oc_status_release(struct kref *ref)
+{
+	struct tegra234_oc_status *status =
+		container_of(ref, struct tegra234_oc_status, ref);
+
+	mutex_destroy(&status->lock);
+	vfree(status->page);
+	kfree(status);
+}
+
+/*
+ * Publish a new OC status if it changed, the poll work is the only writer
+ * of the page. The hwmon attributes of the alarms that changed are
+ * notified too, for sysfs pollers.
+ */
+static void tegra234_oc_status_update(struct tegra234_oc_event *tegra234_oc,
+				      struct mrq_oc_status_response *resp)
+{
+	struct tegra234_oc_status *status = tegra234_oc->status;
+	struct tegra_oc_event_page *page = status->page;
+	unsigned long changed = 0;
+	char name[32];
+	unsigned int i;
+
+	for (i = 0; i < page->nr_alarms; i++) {
+		if (page->throt_en[i] != resp->throt_en[i] ||
+		    page->event_cnt[i] != resp->event_cnt[i])
+			changed |= BIT(i);
+	}
+
+	if (!changed)
+		return;
+
+	WRITE_ONCE(page->seq, page->seq + 1);
+	smp_wmb();
+	for (i = 0; i < page->nr_alarms; i++) {
+		page->throt_en[i] = resp->throt_en[i];
+		page->event_cnt[i] = resp->event_cnt[i];
+	}
+	page->timestamp_ns = ktime_get_ns();
+	smp_store_release(&page->seq, page->seq + 1);
+
+	wake_up_interruptible_all(&status->waitq);
+
+	for_each_set_bit(i, &changed, page->nr_alarms) {
+		snprintf(name, sizeof(name), "oc%u_event_cnt", i + 1);
+		sysfs_notify(&tegra234_oc->hwmon->kobj, NULL, name);
+		snprintf(name, sizeof(name), "oc%u_throt_en", i + 1);
+		sysfs_notify(&tegra234_oc->hwmon->kobj, NULL, name);
+	}
+}
+
+/*
+ * The BPMP owns soctherm and does not signal OC events, so the status is
+ * queried periodically, but only while somebody has the char device open.
+ */
+static void tegra234_oc_poll_work(struct work_struct *work)
+{
+	struct tegra234_oc_event *tegra234_oc = container_of(to_delayed_work(work),
+					struct tegra234_oc_event, poll_work);
+	struct mrq_oc_status_response resp;
+	unsigned int period_ms = max(READ_ONCE(oc_poll_ms), 1U);
+
+	if (!tegra234_oc_get_status(tegra234_oc->hwmon, tegra234_oc->bpmp,
+				    &resp))
+		tegra234_oc_status_update(tegra234_oc, &resp);
+
+	WRITE_ONCE(tegra234_oc->status->page->poll_period_us,
+		   period_ms * USEC_PER_MSEC);
+	schedule_delayed_work(&tegra234_oc->poll_work,
+			      msecs_to_jiffies(period_ms));
+}
+
+static int tegra234_oc_dev_open(struct inode *inode, struct file *file)
+{
+	struct miscdevice *miscdev = file->private_data;
+	struct tegra234_oc_event *tegra234_oc =
+		container_of(miscdev, struct tegra234_oc_event, miscdev);
+	struct tegra234_oc_status *status = tegra234_oc->status;
+	struct tegra234_oc_file *of;
+
+	if (file->f_mode & FMODE_WRITE)
+		return -EPERM;
+
+	of = kzalloc(sizeof(*of), GFP_KERNEL);
+	if (!of)
+		return -ENOMEM;
+
+	/* misc_open() holds the misc lock, so tegra234_oc can not go away here */
+	kref_get(&status->ref);
+	of->status = status;
+	of->seq = READ_ONCE(status->page->seq);
+	file->private_data = of;
+
+	mutex_lock(&status->lock);
+	if (status->users++ == 0)
+		schedule_delayed_work(&tegra234_oc->poll_work, 0);
+	mutex_unlock(&status->lock);
+
+	return 0;
+}
+
+static int tegra234_oc_dev_release(struct inode *inode, struct file *file)
+{
+	struct tegra234_oc_file *of = file->private_data;
+	struct tegra234_oc_status *status = of->status;
+
+	mutex_lock(&status->lock);
+	if (--status->users == 0 && status->oc) {
+		cancel_delayed_work_sync(&status->oc->poll_work);
+		WRITE_ONCE(status->page->poll_period_us, 0);
+	}
+	mutex_unlock(&status->lock);
+
+	kref_put(&status->ref, tegra234_oc_status_release);
+	kfree(of);
+
+	return 0;
+}
+
+static ssize_t tegra234_oc_dev_read(struct file *file, char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	struct tegra234_oc_file *of = file->private_data;
+	struct tegra234_oc_status *status = of->status;
+	struct tegra_oc_event_page snap;
+	u32 seq;
+	int ret;
+
+	if (count < sizeof(snap))
+		return -EINVAL;
+
+	if (READ_ONCE(status->page->seq) == of->seq) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(status->waitq,
+			READ_ONCE(status->page->seq) != of->seq ||
+			READ_ONCE(status->dead));
+		if (ret)
+			return ret;
+	}
+
+	do {
+		seq = smp_load_acquire(&status->page->seq);
+		memcpy(&snap, status->page, sizeof(snap));
+		smp_rmb();
+	} while ((seq & 1) || seq != READ_ONCE(status->page->seq));
+
+	of->seq = seq;
+
+	if (copy_to_user(buf, &snap, sizeof(snap)))
+		return -EFAULT;
+
+	return sizeof(snap);
+}
+
+static __poll_t tegra234_oc_dev_poll(struct file *file, poll_table *wait)
+{
+	struct tegra234_oc_file *of = file->private_data;
+	struct tegra234_oc_status *status = of->status;
+	__poll_t mask = 0;
+
+	poll_wait(file, &status->waitq, wait);
+
+	if (READ_ONCE(status->page->seq) != of->seq)
+		mask |= EPOLLIN | EPOLLRDNORM;
+	if (READ_ONCE(status->dead))
+		mask |= EPOLLHUP;
+
+	return mask;
+}
+
+static int tegra234_oc_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct tegra234_oc_file *of = file->private_data;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (vma->vm_end - vma->vm_start > PAGE_SIZE)
+		return -EINVAL;
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	return remap_vmalloc_range(vma, of->status->page, vma->vm_pgoff);
+}
+
+static const struct file_operations tegra234_oc_dev_fops = {
+	.owner		= THIS_MODULE,
+	.open		= tegra234_oc_dev_open,
+	.release	= tegra234_oc_dev_release,
+	.read		= tegra234_oc_dev_read,
+	.poll		= tegra234_oc_dev_poll,
+	.mmap		= tegra234_oc_dev_mmap,
+	.llseek		= noop_llseek,
 };
 
 static const struct of_device_id of_tegra234_oc_event_match[] = {
@@ -188,8 +456,30 @@ static int tegra234_oc_event_probe(struct platform_device *pdev)
 		goto put_bpmp;
 	}
 
+	tegra234_oc->status =
+		tegra234_oc_status_alloc(tegra234_oc->soc_data->nr_alarms);
+	if (!tegra234_oc->status) {
+		err = -ENOMEM;
+		goto put_bpmp;
+	}
+	tegra234_oc->status->oc = tegra234_oc;
+	INIT_DELAYED_WORK(&tegra234_oc->poll_work, tegra234_oc_poll_work);
+
+	tegra234_oc->miscdev.minor = MISC_DYNAMIC_MINOR;
+	tegra234_oc->miscdev.name = "soctherm-oc";
+	tegra234_oc->miscdev.fops = &tegra234_oc_dev_fops;
+	tegra234_oc->miscdev.parent = &pdev->dev;
+	tegra234_oc->miscdev.mode = 0444;
+	err = misc_register(&tegra234_oc->miscdev);
+	if (err) {
+		dev_err(&pdev->dev, "Failed to register misc device: %d\n", err);
+		goto put_status;
+	}
+
 	return err;
 
+put_status:
+	kref_put(&tegra234_oc->status->ref, tegra234_oc_status_release);
 put_bpmp:
 	tegra_bpmp_put(tb);
 
@@ -203,6 +493,17 @@ static int tegra234_oc_event_remove(struct platform_device *pdev)
 	if (!tegra234_oc)
 		return -EINVAL;
 
+	misc_deregister(&tegra234_oc->miscdev);
+
+	/* Open files see EPOLLHUP and keep the page until they are closed */
+	mutex_lock(&tegra234_oc->status->lock);
+	tegra234_oc->status->oc = NULL;
+	WRITE_ONCE(tegra234_oc->status->dead, true);
+	mutex_unlock(&tegra234_oc->status->lock);
+	cancel_delayed_work_sync(&tegra234_oc->poll_work);
+	wake_up_interruptible_all(&tegra234_oc->status->waitq);
+	kref_put(&tegra234_oc->status->ref, tegra234_oc_status_release);
+
 	tegra_bpmp_put(tegra234_oc->bpmp);
 	return 0;
 }
@@ -1,11 +1,20 @@
 // SPDX-License-Identifier: GPL-2.0-only
 // SPDX-FileCopyrightText: Copyright (c) 2023, NVIDIA CORPORATION & AFFILIATES.  All rights reserved.
 
+#include <linux/fs.h>
 #include <linux/kernel.h>
+#include <linux/kref.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
 #include <linux/thermal.h>
+#include <linux/timekeeping.h>
+#include <linux/vmalloc.h>
 #include <linux/wait.h>
+#include <uapi/linux/tegra-thermal-event.h>
 
 enum cdev_states {
 	CDEV_INACTIVE,
@@ -13,6 +22,23 @@ enum cdev_states {
 	CDEV_DESTROY,
 };
 
+/*
+ * Status page of the char device. It outlives the device while user space
+ * still has it open or mapped, hence the reference count.
+ */
+struct tte_status {
+	struct kref ref;
+	wait_queue_head_t waitq;
+	struct thermal_trip_event_page *page;
+	bool dead;
+};
+
+/* what a reader of the char device has seen */
+struct tte_file {
+	struct tte_status *status;
+	u32 seq;
+};
+
 struct therm_trip_event {
 	unsigned int cur_state;
 	unsigned int max_state;
@@ -21,8 +47,58 @@ struct therm_trip_event {
 	struct mutex event_timeout_lock;
 	struct thermal_cooling_device *cdev;
 	wait_queue_head_t waitq_head;
+	struct device *dev;
+	struct tte_status *status;
+	struct miscdevice miscdev;
+	char miscdev_name[THERMAL_NAME_LENGTH + 24];
 };
 
+static struct tte_status *tte_status_alloc(unsigned int max_state)
+{
+	struct tte_status *status;
+
+	status = kzalloc(sizeof(*status), GFP_KERNEL);
+	if (!status)
+		return NULL;
+
+	status->page = vmalloc_user(PAGE_SIZE);
+	if (!status->page) {
+		kfree(status);
+		return NULL;
+	}
+
+	kref_init(&status->ref);
+	init_waitqueue_head(&status->waitq);
+	status->page->version = THERMAL_TRIP_EVENT_PAGE_VERSION;
+	status->page->max_state = max_state;
+
+	return status;
+}
+
+static void tte_status_release(struct kref *ref)
+{
+	struct tte_status *status = container_of(ref, struct tte_status, ref);
+
+	vfree(status->page);
+	kfree(status);
+}
+
+/* Called with cur_state_lock held, the only writer of the page */
+static void tte_status_update(struct tte_status *status, unsigned int state)
+{
+	struct thermal_trip_event_page *page = status->page;
+
+	WRITE_ONCE(page->seq, page->seq + 1);
+	smp_wmb();
+	if (page->state == CDEV_INACTIVE && state != CDEV_INACTIVE)
+		page->trips++;
+	page->state = state;
+	page->timestamp_ns = ktime_get_ns();
+	smp_store_release(&page->seq, page->seq + 1);
+
+	wake_up_interruptible_all(&status->waitq);
+}
+
 static int tte_cdev_get_max_state(struct thermal_cooling_device *tcd,
 				  unsigned long *state)
 {
@@ -65,8 +141,11 @@ static int tte_cdev_set_cur_state(struct thermal_cooling_device *tcd,
 	 */
 	mutex_lock(&tte->cur_state_lock);
 	tte->cur_state = state;
+	tte_status_update(tte->status, state);
 	mutex_unlock(&tte->cur_state_lock);
 
+	sysfs_notify(&tte->dev->kobj, NULL, "thermal_trip_event");
+
 	if (tte->cur_state != CDEV_INACTIVE) {
 		if (wq_has_sleeper(&tte->waitq_head)) {
 			wake_up_interruptible_all(&tte->waitq_head);
@@ -127,6 +206,121 @@ static ssize_t thermal_trip_event_block_store(struct device *dev,
 	return count;
 }
 
+static int tte_dev_open(struct inode *inode, struct file *file)
+{
+	struct miscdevice *miscdev = file->private_data;
+	struct therm_trip_event *tte =
+		container_of(miscdev, struct therm_trip_event, miscdev);
+	struct tte_file *tf;
+
+	if (file->f_mode & FMODE_WRITE)
+		return -EPERM;
+
+	tf = kzalloc(sizeof(*tf), GFP_KERNEL);
+	if (!tf)
+		return -ENOMEM;
+
+	/* misc_open() holds the misc lock, so tte can not go away here */
+	kref_get(&tte->status->ref);
+	tf->status = tte->status;
+	tf->seq = READ_ONCE(tte->status->page->seq);
+	file->private_data = tf;
+
+	return 0;
+}
+
+static int tte_dev_release(struct inode *inode, struct file *file)
+{
+	struct tte_file *tf = file->private_data;
+
+	kref_put(&tf->status->ref, tte_status_release);
+	kfree(tf);
+
+	return 0;
+}
+
+static ssize_t tte_dev_read(struct file *file, char __user *buf,
+			    size_t count, loff_t *ppos)
+{
+	struct tte_file *tf = file->private_data;
+	struct tte_status *status = tf->status;
+	struct thermal_trip_event_page snap;
+	u32 seq;
+	int ret;
+
+	if (count < sizeof(snap))
+		return -EINVAL;
+
+	if (READ_ONCE(status->page->seq) == tf->seq) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(status->waitq,
+			READ_ONCE(status->page->seq) != tf->seq ||
+			READ_ONCE(status->dead));
+		if (ret)
+			return ret;
+	}
+
+	do {
+		seq = smp_load_acquire(&status->page->seq);
+		memcpy(&snap, status->page, sizeof(snap));
+		smp_rmb();
+	} while ((seq & 1) || seq != READ_ONCE(status->page->seq));
+
+	tf->seq = seq;
+
+	if (copy_to_user(buf, &snap, sizeof(snap)))
+		return -EFAULT;
+
+	return sizeof(snap);
+}
+
+static __poll_t tte_dev_poll(struct file *file, poll_table *wait)
+{
+	struct tte_file *tf = file->private_data;
+	struct tte_status *status = tf->status;
+	__poll_t mask = 0;
+
+	poll_wait(file, &status->waitq, wait);
+
+	if (READ_ONCE(status->page->seq) != tf->seq)
+		mask |= EPOLLIN | EPOLLRDNORM;
+	if (READ_ONCE(status->dead))
+		mask |= EPOLLHUP;
+
+	return mask;
+}
+
+static int tte_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct tte_file *tf = file->private_data;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (vma->vm_end - vma->vm_start > PAGE_SIZE)
+		return -EINVAL;
+
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	return remap_vmalloc_range(vma, tf->status->page, vma->vm_pgoff);
+}
+
+static const struct file_operations tte_dev_fops = {
+	.owner		= THIS_MODULE,
+	.open		= tte_dev_open,
+	.release	= tte_dev_release,
+	.read		= tte_dev_read,
+	.poll		= tte_dev_poll,
+	.mmap		= tte_dev_mmap,
+	.llseek		= noop_llseek,
+};
+
 static struct thermal_cooling_device_ops tte_cdev_ops = {
 	.get_max_state = tte_cdev_get_max_state,
 	.get_cur_state = tte_cdev_get_cur_state,
@@ -164,13 +358,20 @@ static int thermal_trip_event_probe(struct platform_device *pdev)
 	mutex_init(&tte->cur_state_lock);
 	mutex_init(&tte->event_timeout_lock);
 	init_waitqueue_head(&tte->waitq_head);
+	tte->dev = dev;
 	dev_set_drvdata(dev, tte);
 
+	tte->status = tte_status_alloc(tte->max_state);
+	if (!tte->status) {
+		ret = -ENOMEM;
+		goto destroy_lock;
+	}
+
 	tte->cdev = thermal_of_cooling_device_register(np, cdev_type, tte,
 						       &tte_cdev_ops);
 	if (IS_ERR(tte->cdev)) {
 		ret = PTR_ERR(tte->cdev);
-		goto destroy_lock;
+		goto put_status;
 	}
 
 	ret = sysfs_create_files(&dev->kobj, tte_cdev_attr);
@@ -186,13 +387,30 @@ static int thermal_trip_event_probe(struct platform_device *pdev)
 		goto free_sysfs_files;
 	}
 
+	snprintf(tte->miscdev_name, sizeof(tte->miscdev_name),
+		 "thermal-trip-event-%s", cdev_type);
+	tte->miscdev.minor = MISC_DYNAMIC_MINOR;
+	tte->miscdev.name = tte->miscdev_name;
+	tte->miscdev.fops = &tte_dev_fops;
+	tte->miscdev.parent = dev;
+	tte->miscdev.mode = 0444;
+	ret = misc_register(&tte->miscdev);
+	if (ret) {
+		dev_err(dev, "failed to register misc device: %d\n", ret);
+		goto free_sysfs_link;
+	}
+
 	dev_info(dev, "cooling device registered.\n");
 	return 0;
 
+free_sysfs_link:
+	sysfs_remove_link(&tte->cdev->device.kobj, "thermal_trip_event");
 free_sysfs_files:
 	sysfs_remove_files(&dev->kobj, tte_cdev_attr);
 free_cdev:
 	thermal_cooling_device_unregister(tte->cdev);
+put_status:
+	kref_put(&tte->status->ref, tte_status_release);
 destroy_lock:
 	mutex_destroy(&tte->event_timeout_lock);
 	mutex_destroy(&tte->cur_state_lock);
@@ -213,6 +431,8 @@ static int thermal_trip_event_remove(struct platform_device *pdev)
 	 * perceived by the thermal framework, but it's not a big deal as the
 	 * cooling device is going to be destroyed soon.
 	 */
+	misc_deregister(&tte->miscdev);
+
 	mutex_lock(&tte->cur_state_lock);
 	tte->cur_state = CDEV_DESTROY;
 	mutex_unlock(&tte->cur_state_lock);
@@ -225,6 +445,12 @@ static int thermal_trip_event_remove(struct platform_device *pdev)
 	sysfs_remove_link(&cdev->device.kobj, "thermal_trip_event");
 	sysfs_remove_files(&dev->kobj, tte_cdev_attr);
 	thermal_cooling_device_unregister(cdev);
+
+	/* Open files see EPOLLHUP and keep the page until they are closed */
+	WRITE_ONCE(tte->status->dead, true);
+	wake_up_interruptible_all(&tte->status->waitq);
+	kref_put(&tte->status->ref, tte_status_release);
+
 	mutex_destroy(&tte->event_timeout_lock);
 	mutex_destroy(&tte->cur_state_lock);
 
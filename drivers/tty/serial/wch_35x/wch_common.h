@@ -464,6 +464,10 @@ struct wch_board {
 #define WCH_SER_DUMP_PORT_INFO  (WCH_IOCTL + 50)
 #define WCH_SER_DUMP_PORT_PERF  (WCH_IOCTL + 51)
 #define WCH_SER_DUMP_DRIVER_VER (WCH_IOCTL + 52)
+#define WCH_SER_SET_RX_TRIGGER  (WCH_IOCTL + 53)
+
+// rx fifo trigger selection, index into the four levels of the chip
+#define WCH_RX_TRIGGER_SEL_MAX 3
 
 /*******************************************************
  * serial define
@@ -534,6 +538,38 @@ struct wch_board {
 struct ser_info;
 struct ser_port;
 
+// per-port servicing counters, kept under port->lock
+struct ser_perf {
+    __u32 irq;
+    __u32 rx_irq;
+    __u32 rx_timeout;
+    __u32 tx_irq;
+    __u32 rx_bulk;
+    __u32 tx_bulk;
+    __u32 irq_rate;
+    __u32 rate_count;
+    unsigned long rate_start;
+};
+
+// returned by WCH_SER_DUMP_PORT_PERF
+struct ser_port_perf_info {
+    unsigned int line;
+    unsigned int fifosize;
+    unsigned int rx_trigger;
+    unsigned int rx_trigger_sel;
+    __u32 irq;
+    __u32 rx_irq;
+    __u32 rx_timeout;
+    __u32 tx_irq;
+    __u32 rx_bulk;
+    __u32 tx_bulk;
+    /* port interrupts serviced in the last full second */
+    __u32 irq_rate;
+    /* bytes lost in the uart fifo and in the tty buffer */
+    __u32 overrun;
+    __u32 buf_overrun;
+};
+
 struct ser_icount {
     __u32 cts;
     __u32 dsr;
@@ -586,6 +622,7 @@ struct ser_port {
     struct ser_info *info;
     struct ser_state *state;
     struct ser_icount icount;
+    struct ser_perf perf;
 
     unsigned int flags;
     unsigned int mctrl;
@@ -606,6 +643,7 @@ struct ser_port {
     unsigned int port_flag;
     unsigned int baud_base;
     int rx_trigger;
+    unsigned char rx_trigger_sel;
     bool bext1stport;
     bool bspe1stport;
     bool hardflow;
@@ -24,6 +24,87 @@ static DEFINE_SEMAPHORE(ser_port_sem);
 #define WCH_HIGH_BITS_OFFSET ((sizeof(long) - sizeof(int)) * 8)
 #define wch_ser_users(state) ((state)->count + ((state)->info ? (state)->info->blocked_open : 0))
 
+static int rx_trigger_sel = -1;
+module_param(rx_trigger_sel, int, 0444);
+MODULE_PARM_DESC(rx_trigger_sel, "RX FIFO trigger level 0-3 for all ports, -1 keeps the chip default");
+
+// the four rx trigger levels selected by FCR[7:6], per fifo size
+static const unsigned short wch_rx_trigger_16fifo[4] = {
+    CH351_TRIGGER_LEVEL_16FIFO_01, CH351_TRIGGER_LEVEL_16FIFO_04,
+    CH351_TRIGGER_LEVEL_16FIFO_08, CH351_TRIGGER_LEVEL_16FIFO_14,
+};
+
+static const unsigned short wch_rx_trigger_128fifo[4] = {
+    CH358_TRIGGER_LEVEL_128FIFO_01, CH358_TRIGGER_LEVEL_128FIFO_32,
+    CH358_TRIGGER_LEVEL_128FIFO_64, CH358_TRIGGER_LEVEL_128FIFO_112,
+};
+
+static const unsigned short wch_rx_trigger_ch438[4] = {
+    CH438_TRIGGER_LEVEL_128FIFO_01, CH438_TRIGGER_LEVEL_128FIFO_16,
+    CH438_TRIGGER_LEVEL_128FIFO_64, CH438_TRIGGER_LEVEL_128FIFO_112,
+};
+
+static const unsigned short wch_rx_trigger_256fifo[4] = {
+    CH384_TRIGGER_LEVEL_256FIFO_01, CH384_TRIGGER_LEVEL_256FIFO_32,
+    CH384_TRIGGER_LEVEL_256FIFO_128, CH384_TRIGGER_LEVEL_256FIFO_224,
+};
+
+static const unsigned char wch_rx_trigger_fcr[4] = {
+    UART_TRIGGER00_FCR, UART_TRIGGER01_FCR, UART_TRIGGER10_FCR, UART_TRIGGER11_FCR,
+};
+
+static const unsigned short *wch_ser_rx_trigger_table(struct ser_port *port)
+{
+    switch (port->fifosize) {
+    case CH351_FIFOSIZE_16:
+        return wch_rx_trigger_16fifo;
+    case CH358_FIFOSIZE_128:
+        if (port->chip_flag == WCH_BOARD_CH365_32S)
+            return wch_rx_trigger_ch438;
+        return wch_rx_trigger_128fifo;
+    case CH384_FIFOSIZE_256:
+        return wch_rx_trigger_256fifo;
+    default:
+        return NULL;
+    }
+}
+
+static void wch_ser_set_rx_trigger(struct ser_port *port, unsigned int sel)
+{
+    const unsigned short *levels = wch_ser_rx_trigger_table(port);
+
+    if (!levels) {
+        return;
+    }
+
+    port->rx_trigger_sel = sel;
+    port->rx_trigger = levels[sel];
+}
+
+static void wch_ser_init_rx_trigger(struct ser_port *port)
+{
+    const unsigned short *levels = wch_ser_rx_trigger_table(port);
+    unsigned int sel = 2;
+    unsigned int i;
+
+    if (!levels) {
+        port->rx_trigger_sel = 0;
+        return;
+    }
+
+    if (rx_trigger_sel >= 0 && rx_trigger_sel <= WCH_RX_TRIGGER_SEL_MAX) {
+        sel = rx_trigger_sel;
+    } else {
+        /* the chip default from the board table */
+        for (i = 0; i <= WCH_RX_TRIGGER_SEL_MAX; i++) {
+            if (levels[i] == port->rx_trigger)
+                sel = i;
+        }
+    }
+
+    wch_ser_set_rx_trigger(port, sel);
+}
+
 struct serial_uart_config {
     char *name;
     int dfl_xmit_fifo_size;
@@ -215,7 +296,9 @@ static unsigned char READ_UART_RX(struct wch_ser_port *sp)
 static unsigned char READ_UART_RX_BUFFER(struct wch_ser_port *sp, unsigned char *buf, int count)
 {
     if (sp->port.iobase) {
-        {
+        if (ch365_32s) {
+            readsb(sp->port.port_membase + UART_RX, buf, count);
+        } else {
             insb(sp->port.iobase + UART_RX, buf, count);
         }
     }
@@ -223,6 +306,17 @@ static unsigned char READ_UART_RX_BUFFER(struct wch_ser_port *sp, unsigned char
     return 0;
 }
 
+static void WRITE_UART_TX_BUFFER(struct wch_ser_port *sp, const unsigned char *buf, int count)
+{
+    if (sp->port.iobase) {
+        if (ch365_32s) {
+            writesb(sp->port.port_membase + UART_TX, buf, count);
+        } else {
+            outsb(sp->port.iobase + UART_TX, buf, count);
+        }
+    }
+}
+
 static void WRITE_UART_TX(struct wch_ser_port *sp, unsigned char data)
 {
     if (sp->port.iobase) {
@@ -1134,6 +1228,56 @@ static int ser_get_count(struct ser_state *state, struct serial_icounter_struct
     return copy_to_user(icnt, &icount, sizeof(icount)) ? -EFAULT : 0;
 }
 
+static int ser_get_perf(struct ser_state *state, struct ser_port_perf_info *uinfo)
+{
+    struct ser_port_perf_info info;
+    struct ser_port *port = state->port;
+
+    memset(&info, 0, sizeof(info));
+    spin_lock_irq(&port->lock);
+    info.line = port->line;
+    info.fifosize = port->fifosize;
+    info.rx_trigger = port->rx_trigger;
+    info.rx_trigger_sel = port->rx_trigger_sel;
+    info.irq = port->perf.irq;
+    info.rx_irq = port->perf.rx_irq;
+    info.rx_timeout = port->perf.rx_timeout;
+    info.tx_irq = port->perf.tx_irq;
+    info.rx_bulk = port->perf.rx_bulk;
+    info.tx_bulk = port->perf.tx_bulk;
+    info.irq_rate = port->perf.irq_rate;
+    info.overrun = port->icount.overrun;
+    info.buf_overrun = port->icount.buf_overrun;
+    spin_unlock_irq(&port->lock);
+
+    return copy_to_user(uinfo, &info, sizeof(info)) ? -EFAULT : 0;
+}
+
+static int ser_set_rx_trigger(struct ser_state *state, unsigned long sel)
+{
+    struct ser_port *port = state->port;
+    struct wch_ser_port *sp = (struct wch_ser_port *)port;
+    unsigned long flags;
+
+    if (sel > WCH_RX_TRIGGER_SEL_MAX) {
+        return -EINVAL;
+    }
+
+    if (!wch_ser_rx_trigger_table(port)) {
+        return -EOPNOTSUPP;
+    }
+
+    spin_lock_irqsave(&port->lock, flags);
+    wch_ser_set_rx_trigger(port, sel);
+    /* FCR writes leave the fifo contents alone without the clear bits */
+    if (sp->capabilities & UART_USE_FIFO) {
+        WRITE_UART_FCR(sp, UART_FCR_ENABLE_FIFO | wch_rx_trigger_fcr[port->rx_trigger_sel]);
+    }
+    spin_unlock_irqrestore(&port->lock, flags);
+
+    return 0;
+}
+
 static void ser_config_rs485(struct ser_state *state, struct serial_rs485 *rs485)
 {
     struct ser_port *port = state->port;
@@ -1226,6 +1370,16 @@ static int ser_ioctl(struct tty_struct *tty, unsigned int cmd, unsigned long arg
             ret = ser_get_count(state, (struct serial_icounter_struct *)arg);
         }
         break;
+    case WCH_SER_DUMP_PORT_PERF:
+        if (line < wch_ser_port_total_cnt) {
+            ret = ser_get_perf(state, (struct ser_port_perf_info *)arg);
+        }
+        break;
+    case WCH_SER_SET_RX_TRIGGER:
+        if (line < wch_ser_port_total_cnt) {
+            ret = ser_set_rx_trigger(state, arg);
+        }
+        break;
     }
 
     if (ret != -ENOIOCTLCMD) {
@@ -2044,7 +2198,7 @@ static void wch_ser_set_termios(struct ser_port *port, struct WCHTERMIOS *termio
     }
 
     if (sp->capabilities & UART_USE_FIFO) {
-        fcr = UART_FCR_ENABLE_FIFO | UART_FCR_R_TRIG_10;
+        fcr = UART_FCR_ENABLE_FIFO | wch_rx_trigger_fcr[port->rx_trigger_sel];
     }
 
     sp->mcr &= ~UART_MCR_AFE;
@@ -2145,21 +2299,29 @@ static _INLINE_ void ser_receive_chars(struct wch_ser_port *sp, unsigned char *s
     unsigned char flag;
 
     unsigned char rbuf[256];
-    int readcont = 0;
     int count;
 
     do {
-        if (iir == UART_IIR_RDI) {
-            READ_UART_RX_BUFFER(sp, rbuf, sp->port.rx_trigger);
-            sp->port.icount.rx += sp->port.rx_trigger;
-            count = sp->port.rx_trigger;
-            readcont = 1;
+        /*
+         * A trigger interrupt guarantees rx_trigger bytes in the fifo. Take
+         * them in one string read when no byte in the fifo carries an error
+         * and no flow control character has to be picked out.
+         */
+        if (iir == UART_IIR_RDI && sp->port.rx_trigger > 1 &&
+            !(lsr & (UART_LSR_BI | UART_LSR_PE | UART_LSR_FE | UART_LSR_OE | UART_LSR_ERR_IN_RFIFO)) &&
+            !I_IXOFF(tty) && !I_IXON(tty)) {
+            count = min_t(int, sp->port.rx_trigger, sizeof(rbuf));
+            READ_UART_RX_BUFFER(sp, rbuf, count);
+            sp->port.icount.rx += count;
+            sp->port.perf.rx_bulk++;
             iir = 0;
-        } else {
-            ch = READ_UART_RX(sp);
-            sp->port.icount.rx++;
-            readcont = 0;
+            ser_insert_buffer(&sp->port, lsr, UART_LSR_OE, rbuf, count, TTY_NORMAL);
+            goto ignore_char;
         }
+
+        iir = 0;
+        ch = READ_UART_RX(sp);
+        sp->port.icount.rx++;
         flag = TTY_NORMAL;
         if (unlikely(lsr & (UART_LSR_BI | UART_LSR_PE | UART_LSR_FE | UART_LSR_OE)))
         {
@@ -2203,10 +2365,7 @@ static _INLINE_ void ser_receive_chars(struct wch_ser_port *sp, unsigned char *s
             }
         }
 
-        if (readcont)
-            ser_insert_buffer(&sp->port, lsr, UART_LSR_OE, rbuf, count, flag);
-        else
-            ser_insert_char(&sp->port, lsr, UART_LSR_OE, ch, flag);
+        ser_insert_char(&sp->port, lsr, UART_LSR_OE, ch, flag);
 
     ignore_char:
         lsr = READ_UART_LSR(sp);
@@ -2252,18 +2411,23 @@ static _INLINE_ void ser_transmit_chars(struct wch_ser_port *sp)
         return;
     }
 
-    count = sp->port.fifosize / 2;
-
-    do {
-        WRITE_UART_TX(sp, xmit->buf[xmit->tail]);
-        xmit->tail = (xmit->tail + 1) & (WCH_UART_XMIT_SIZE - 1);
-        sp->port.icount.tx++;
+    /* THRE with the fifo enabled means the whole tx fifo is free */
+    if (sp->capabilities & UART_USE_FIFO) {
+        count = sp->port.fifosize;
+    } else {
+        count = 1;
+    }
 
-        if (ser_circ_empty(xmit)) {
-            break;
-        }
+    /* at most two string writes, before and after the wrap of the ring */
+    while (count > 0 && !ser_circ_empty(xmit)) {
+        int n = min_t(int, count, CIRC_CNT_TO_END(xmit->head, xmit->tail, WCH_UART_XMIT_SIZE));
 
-    } while (--count > 0);
+        WRITE_UART_TX_BUFFER(sp, xmit->buf + xmit->tail, n);
+        xmit->tail = (xmit->tail + n) & (WCH_UART_XMIT_SIZE - 1);
+        sp->port.icount.tx += n;
+        sp->port.perf.tx_bulk++;
+        count -= n;
+    }
 
     if (ser_circ_chars_pending(xmit) < WAKEUP_CHARS_SER) {
         ser_write_wakeup(&sp->port);
@@ -2305,6 +2469,28 @@ static _INLINE_ void ser_check_modem_status(struct wch_ser_port *sp, unsigned ch
     wake_up_interruptible(&sp->port.info->delta_msr_wait);
 }
 
+static _INLINE_ void ser_count_irq(struct wch_ser_port *sp, unsigned char iir)
+{
+    struct ser_perf *perf = &sp->port.perf;
+    unsigned long elapsed = jiffies - perf->rate_start;
+
+    perf->irq++;
+    if (iir == UART_IIR_RDI) {
+        perf->rx_irq++;
+    } else if (iir == UART_IIR_CTO) {
+        perf->rx_timeout++;
+    } else if (iir == UART_IIR_THRI) {
+        perf->tx_irq++;
+    }
+
+    if (elapsed >= HZ) {
+        perf->irq_rate = mult_frac(perf->rate_count, HZ, elapsed);
+        perf->rate_count = 0;
+        perf->rate_start = jiffies;
+    }
+    perf->rate_count++;
+}
+
 static _INLINE_ void ser_handle_port(struct wch_ser_port *sp, unsigned char iir)
 {
     unsigned char lsr = READ_UART_LSR(sp);
@@ -2314,6 +2500,8 @@ static _INLINE_ void ser_handle_port(struct wch_ser_port *sp, unsigned char iir)
         lsr = 0x01;
     }
 
+    ser_count_irq(sp, iir);
+
     if ((iir == UART_IIR_RLSI) || (iir == UART_IIR_CTO) || (iir == UART_IIR_RDI)) {
         ser_receive_chars(sp, &lsr, iir);
     }
@@ -2529,6 +2717,7 @@ extern int wch_ser_register_ports(struct ser_driver *drv)
         {
 
             timer_setup(&sp->timer, wch_ser_timeout, 0);
+            wch_ser_init_rx_trigger(&sp->port);
 
             sp->mcr_mask = ~0;
             sp->mcr_force = 0;
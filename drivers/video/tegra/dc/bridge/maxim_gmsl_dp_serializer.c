@@ -7,17 +7,20 @@
 
 #include <nvidia/conftest.h>
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/fwnode.h>
 #include <linux/gpio/consumer.h>
 #include <linux/gpio/driver.h>
 #include <linux/i2c.h>
 #include <linux/i2c-mux.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of_graph.h>
 #include <linux/slab.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
 #include <linux/of_gpio.h>
 #include <linux/workqueue.h>
 #include <linux/of_device.h>
@@ -265,6 +268,90 @@ struct max_gmsl_dp_ser_priv {
 	u32 enable_gmsl3[MAX_GMSL_LINKS];
 	u32 enable_gmsl_fec[MAX_GMSL_LINKS];
 	struct superframe_info superframe;
+	struct dentry *debugfs;
+	/* serializer init timing, for probe and every resume */
+	struct {
+		unsigned int count;
+		u64 powerup_us;
+		u64 last_us;
+		u64 max_us;
+	} init_stats;
+};
+
+/* a multi-byte field of the sub-image attributes, least significant byte first */
+struct max_gmsl_dp_ser_field {
+	size_t offset;
+	unsigned int bytes;
+};
+
+#define MAX_GMSL_FIELD(_name, _bytes) \
+	{ offsetof(struct max_gmsl_subimage_attr, _name), _bytes }
+
+/* fields of a run of consecutive registers, written in one I2C burst */
+struct max_gmsl_dp_ser_block {
+	u32 reg;
+	const struct max_gmsl_dp_ser_field *fields;
+	unsigned int num_fields;
+};
+
+static const struct max_gmsl_dp_ser_field max_gmsl_subimage_size_fields[] = {
+	MAX_GMSL_FIELD(m, 3),
+	MAX_GMSL_FIELD(n, 3),
+	MAX_GMSL_FIELD(x_offset, 2),
+	MAX_GMSL_FIELD(x_max, 2),
+	MAX_GMSL_FIELD(y_max, 2),
+};
+
+static const struct max_gmsl_dp_ser_field max_gmsl_subimage_sync_fields[] = {
+	MAX_GMSL_FIELD(vs_dly, 3),
+	MAX_GMSL_FIELD(vs_high, 3),
+	MAX_GMSL_FIELD(vs_low, 3),
+	MAX_GMSL_FIELD(hs_dly, 3),
+	MAX_GMSL_FIELD(hs_high, 2),
+	MAX_GMSL_FIELD(hs_low, 2),
+	MAX_GMSL_FIELD(hs_cnt, 2),
+	MAX_GMSL_FIELD(hs_llow, 3),
+	MAX_GMSL_FIELD(de_dly, 3),
+	MAX_GMSL_FIELD(de_high, 2),
+	MAX_GMSL_FIELD(de_low, 2),
+	MAX_GMSL_FIELD(de_cnt, 2),
+	MAX_GMSL_FIELD(de_llow, 3),
+};
+
+/* X_M_L..X_Y_MAX_H and X_VS_DLY_L..X_DE_LLOW_H, offset per pipe */
+static const struct max_gmsl_dp_ser_block max_gmsl_subimage_blocks[] = {
+	{
+		MAX_GMSL_DP_SER_X_M_L, max_gmsl_subimage_size_fields,
+		ARRAY_SIZE(max_gmsl_subimage_size_fields),
+	}, {
+		MAX_GMSL_DP_SER_X_VS_DLY_L, max_gmsl_subimage_sync_fields,
+		ARRAY_SIZE(max_gmsl_subimage_sync_fields),
+	},
+};
+
+/*
+ * Symmetric dual view sequence. The same registers are written more than
+ * once on purpose, so this must not be turned into bursts.
+ */
+static const struct reg_sequence max_gmsl_dual_view_seq[] = {
+	{ MAX_GMSL_DP_SER_ASYM_14_Y, 0x37 },
+	{ MAX_GMSL_DP_SER_ASYM_17_X, 0xF8 },
+	{ MAX_GMSL_DP_SER_ASYM_17_Y, 0xF8 },
+	{ MAX_GMSL_DP_SER_ASYM_15_X, 0xBF },
+	{ MAX_GMSL_DP_SER_ASYM_15_Y, 0xBF },
+	{ MAX_GMSL_DP_SER_ASYM_17_X, 0xFC },
+	{ MAX_GMSL_DP_SER_ASYM_17_Y, 0xFC },
+	{ MAX_GMSL_DP_SER_ASYM_14_X, 0x2F },
+	{ MAX_GMSL_DP_SER_ASYM_14_X, 0x0F },
+	{ MAX_GMSL_DP_SER_ASYM_14_Y, 0x27 },
+	{ MAX_GMSL_DP_SER_ASYM_14_Y, 0x07 },
+};
+
+static const struct reg_sequence max_gmsl_internal_crc_seq[] = {
+	{ MAX_GMSL_DP_SER_INTERNAL_CRC_X, MAX_GMSL_DP_SER_INTERNAL_CRC_ENABLE },
+	{ MAX_GMSL_DP_SER_INTERNAL_CRC_Y, MAX_GMSL_DP_SER_INTERNAL_CRC_ENABLE },
+	{ MAX_GMSL_DP_SER_INTERNAL_CRC_Z, MAX_GMSL_DP_SER_INTERNAL_CRC_ENABLE },
+	{ MAX_GMSL_DP_SER_INTERNAL_CRC_U, MAX_GMSL_DP_SER_INTERNAL_CRC_ENABLE },
 };
 
 static int max_gmsl_dp_ser_read(struct max_gmsl_dp_ser_priv *priv, int reg)
@@ -292,6 +379,35 @@ static int max_gmsl_dp_ser_write(struct max_gmsl_dp_ser_priv *priv, u32 reg, u8
 	return ret;
 }
 
+static int max_gmsl_dp_ser_write_burst(struct max_gmsl_dp_ser_priv *priv, u32 reg,
+				       const u8 *buf, size_t len)
+{
+	int ret;
+
+	ret = regmap_bulk_write(priv->regmap, reg, buf, len);
+	if (ret < 0)
+		dev_err(&priv->client->dev,
+			"%s: %zu byte burst at 0x%04x failed (%d)\n",
+			__func__, len, reg, ret);
+
+	return ret;
+}
+
+static int max_gmsl_dp_ser_write_seq(struct max_gmsl_dp_ser_priv *priv,
+				     const struct reg_sequence *seq, int num,
+				     u32 offset)
+{
+	int i, ret;
+
+	for (i = 0; i < num; i++) {
+		ret = max_gmsl_dp_ser_write(priv, seq[i].reg + offset, seq[i].def);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
 /* static api to update given value */
 static inline void max_gmsl_dp_ser_update(struct max_gmsl_dp_ser_priv *priv,
 					  u32 reg, u32 mask, u8 val)
@@ -368,6 +484,15 @@ static void max_gmsl_dp_ser_setup(struct max_gmsl_dp_ser_priv *priv)
 		MAX_GMSL_DP_SER_REG_4_GMSL_B_PAM4_VAL,
 	};
 
+	static const u32 max_gmsl_ser_phy_edp_regs[] = {
+		MAX_GMSL_DP_SER_PHY_EDP_0_CTRL0_B0,
+		MAX_GMSL_DP_SER_PHY_EDP_1_CTRL0_B0,
+		MAX_GMSL_DP_SER_PHY_EDP_2_CTRL0_B0,
+		MAX_GMSL_DP_SER_PHY_EDP_3_CTRL0_B0,
+	};
+
+	static const u8 phy_edp_ctrl0[] = { 0x0f, 0x0f };
+
 	/*
 	 * Just enable "Loss of Training" and "Register control" events.
 	 * Mask rest of event which can trigger HPD_IRQ.
@@ -375,14 +500,10 @@ static void max_gmsl_dp_ser_setup(struct max_gmsl_dp_ser_priv *priv)
 	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_HPD_INTERRUPT_MASK,
 				MAX_GMSL_DP_SER_HPD_INTERRUPT_VAL);
 
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_PHY_EDP_0_CTRL0_B0, 0x0f);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_PHY_EDP_0_CTRL0_B1, 0x0f);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_PHY_EDP_1_CTRL0_B0, 0x0f);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_PHY_EDP_1_CTRL0_B1, 0x0f);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_PHY_EDP_2_CTRL0_B0, 0x0f);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_PHY_EDP_2_CTRL0_B1, 0x0f);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_PHY_EDP_3_CTRL0_B0, 0x0f);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_PHY_EDP_3_CTRL0_B1, 0x0f);
+	/* CTRL0_B0 and CTRL0_B1 of each eDP PHY are adjacent */
+	for (i = 0; i < ARRAY_SIZE(max_gmsl_ser_phy_edp_regs); i++)
+		max_gmsl_dp_ser_write_burst(priv, max_gmsl_ser_phy_edp_regs[i],
+					    phy_edp_ctrl0, sizeof(phy_edp_ctrl0));
 
 	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_LOCAL_EDID, 0x1);
 
@@ -532,108 +653,43 @@ static void max_gmsl_dp_ser_program_dual_view_for_superframe_group(struct device
 	 * is modified with different values. As of now, data sheet does not
 	 * have details for all fields of these registers.
 	 */
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_14_Y + offset, 0x37);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_17_X + offset, 0xF8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_17_Y + offset, 0xF8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_15_X + offset, 0xBF);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_15_Y + offset, 0xBF);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_17_X + offset, 0xFC);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_17_Y + offset, 0xFC);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_14_X + offset, 0x2F);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_14_X + offset, 0x0F);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_14_Y + offset, 0x27);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_ASYM_14_Y + offset, 0x07);
+	max_gmsl_dp_ser_write_seq(priv, max_gmsl_dual_view_seq,
+				  ARRAY_SIZE(max_gmsl_dual_view_seq), offset);
 }
 
 static void max_gmsl_dp_ser_program_subimage_timings(struct device *dev, u32 pipe_id)
 {
 	struct i2c_client *client = to_i2c_client(dev);
 	struct max_gmsl_dp_ser_priv *priv = i2c_get_clientdata(client);
+	struct max_gmsl_subimage_attr *attr = &priv->superframe.subimage_attr[pipe_id];
 	u32 offset = pipe_id * MAX_GMSL_DP_SER_PIPE_SUBIMAGE_OFFSET;
+	unsigned int i, j, k, len;
+	u8 buf[40];
+
+	/*
+	 * The sub-image attributes are split into little-endian byte fields of
+	 * consecutive registers, so write each run of them in a single burst
+	 * rather than one I2C transfer per byte.
+	 */
+	for (i = 0; i < ARRAY_SIZE(max_gmsl_subimage_blocks); i++) {
+		const struct max_gmsl_dp_ser_block *block = &max_gmsl_subimage_blocks[i];
+
+		for (len = 0, j = 0; j < block->num_fields; j++) {
+			const struct max_gmsl_dp_ser_field *field = &block->fields[j];
+			u32 value = *(u32 *)((u8 *)attr + field->offset);
+
+			if (WARN_ON(len + field->bytes > sizeof(buf)))
+				return;
+
+			for (k = 0; k < field->bytes; k++)
+				buf[len++] = (value >> (8 * k)) & 0xff;
+		}
 
-	// Asymmetric dual-view total pixel count per frame in sub-image
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_M_L + offset, (priv->superframe.subimage_attr[pipe_id].m & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_M_M + offset, (priv->superframe.subimage_attr[pipe_id].m & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_M_H + offset, (priv->superframe.subimage_attr[pipe_id].m & 0xFF0000) >> 16);
-
-	// Asymmetric dual-view total pixel count per frame for superframe
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_N_L + offset, (priv->superframe.subimage_attr[pipe_id].n & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_N_M + offset, (priv->superframe.subimage_attr[pipe_id].n & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_N_H + offset, (priv->superframe.subimage_attr[pipe_id].n & 0xFF0000) >> 16);
-
-	// Number of pixels to skip before writing when receiving a new line
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_X_OFFSET_L + offset, (priv->superframe.subimage_attr[pipe_id].x_offset & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_X_OFFSET_H + offset, (priv->superframe.subimage_attr[pipe_id].x_offset & 0xFF00) >> 8);
-
-	// Index of the last pixel of sub-image in the superframe
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_X_MAX_L + offset, (priv->superframe.subimage_attr[pipe_id].x_max & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_X_MAX_H + offset, (priv->superframe.subimage_attr[pipe_id].x_max & 0xFF00) >> 8);
-
-	// Index of the last line of sub-image in the superframe
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_Y_MAX_L + offset, (priv->superframe.subimage_attr[pipe_id].y_max & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_Y_MAX_H + offset, (priv->superframe.subimage_attr[pipe_id].y_max & 0xFF00) >> 8);
-
-	// VS delay in terms of PCLK cycles. The output VS is delayed by VS_DELAY cycles from the start.
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_DLY_L + offset, (priv->superframe.subimage_attr[pipe_id].vs_dly & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_DLY_M + offset, (priv->superframe.subimage_attr[pipe_id].vs_dly & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_DLY_H + offset, (priv->superframe.subimage_attr[pipe_id].vs_dly & 0xFF0000) >> 16);
-
-	// VS high period in terms of PCLK
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_HIGH_L + offset, (priv->superframe.subimage_attr[pipe_id].vs_high & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_HIGH_M + offset, (priv->superframe.subimage_attr[pipe_id].vs_high & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_HIGH_H + offset, (priv->superframe.subimage_attr[pipe_id].vs_high & 0xFF0000) >> 16);
-
-	// VS low period in terms of PCLK cycles
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_LOW_L + offset, (priv->superframe.subimage_attr[pipe_id].vs_low & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_LOW_M + offset, (priv->superframe.subimage_attr[pipe_id].vs_low & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_VS_LOW_H + offset, (priv->superframe.subimage_attr[pipe_id].vs_low & 0xFF0000) >> 16);
-
-	// HS delay in terms of PCLK cycles The output HS is delayed by HS_DELAY cycles from the start.
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_DLY_L + offset, (priv->superframe.subimage_attr[pipe_id].hs_dly & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_DLY_M + offset, (priv->superframe.subimage_attr[pipe_id].hs_dly & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_DLY_H + offset, (priv->superframe.subimage_attr[pipe_id].hs_dly & 0xFF0000) >> 16);
-
-	// HS high period in terms of PCLK cycles
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_HIGH_L + offset, (priv->superframe.subimage_attr[pipe_id].hs_high & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_HIGH_H + offset, (priv->superframe.subimage_attr[pipe_id].hs_high & 0xFF00) >> 8);
-
-	// HS low period in terms of PCLK cycles
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_LOW_L + offset, (priv->superframe.subimage_attr[pipe_id].hs_low & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_LOW_H + offset, (priv->superframe.subimage_attr[pipe_id].hs_low & 0xFF00) >> 8);
-
-	// HS pulses per frame
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_CNT_L + offset, (priv->superframe.subimage_attr[pipe_id].hs_cnt & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_CNT_H + offset, (priv->superframe.subimage_attr[pipe_id].hs_cnt & 0xFF00) >> 8);
-
-	// HS long low period in terms of PCLK cycles
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_LLOW_L + offset, (priv->superframe.subimage_attr[pipe_id].hs_llow & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_LLOW_M + offset, (priv->superframe.subimage_attr[pipe_id].hs_llow & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_HS_LLOW_H + offset, (priv->superframe.subimage_attr[pipe_id].hs_llow & 0xFF0000) >> 16);
-
-	// DE delay in terms of PCLK cycles The output HS is delayed by HS_DELAY cycles from the start.
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_DLY_L + offset, (priv->superframe.subimage_attr[pipe_id].de_dly & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_DLY_M + offset, (priv->superframe.subimage_attr[pipe_id].de_dly & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_DLY_H + offset, (priv->superframe.subimage_attr[pipe_id].de_dly & 0xFF0000) >> 16);
-
-	// DE high period in terms of PCLK cycles
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_HIGH_L + offset, (priv->superframe.subimage_attr[pipe_id].de_high & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_HIGH_H + offset, (priv->superframe.subimage_attr[pipe_id].de_high & 0xFF00) >> 8);
-
-	// DE low period in terms of PCLK cycles
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_LOW_L + offset, (priv->superframe.subimage_attr[pipe_id].de_low & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_LOW_H + offset, (priv->superframe.subimage_attr[pipe_id].de_low & 0xFF00) >> 8);
-
-	// DE pulses per frame
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_CNT_L + offset, (priv->superframe.subimage_attr[pipe_id].de_cnt & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_CNT_H + offset, (priv->superframe.subimage_attr[pipe_id].de_cnt & 0xFF00) >> 8);
-
-	// DE long low period in terms of PCLK cycles
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_LLOW_L + offset, (priv->superframe.subimage_attr[pipe_id].de_llow & 0xFF));
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_LLOW_M + offset, (priv->superframe.subimage_attr[pipe_id].de_llow & 0xFF00) >> 8);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_DE_LLOW_H + offset, (priv->superframe.subimage_attr[pipe_id].de_llow & 0xFF0000) >> 16);
+		max_gmsl_dp_ser_write_burst(priv, block->reg + offset, buf, len);
+	}
 
 	// LUT Template
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_LUT_TEMPLATE + offset, (priv->superframe.subimage_attr[pipe_id].lut_template));
+	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_X_LUT_TEMPLATE + offset, attr->lut_template);
 }
 
 static int max_gmsl_dp_ser_configure_superframe(struct device *dev)
@@ -668,14 +724,30 @@ static int max_gmsl_dp_ser_configure_superframe(struct device *dev)
 	return 0;
 }
 
+static void max_gmsl_dp_ser_init_done(struct max_gmsl_dp_ser_priv *priv,
+				      ktime_t start, ktime_t powered)
+{
+	u64 us = ktime_us_delta(ktime_get(), start);
+
+	priv->init_stats.count++;
+	priv->init_stats.powerup_us = ktime_us_delta(powered, start);
+	priv->init_stats.last_us = us;
+	priv->init_stats.max_us = max(priv->init_stats.max_us, us);
+
+	dev_dbg(&priv->client->dev, "%s: serializer up in %llu us\n", __func__, us);
+}
+
 static int max_gmsl_dp_ser_init(struct device *dev)
 {
 	struct max_gmsl_dp_ser_priv *priv;
 	struct i2c_client *client;
+	ktime_t start, powered;
 
 	client = to_i2c_client(dev);
 	priv = i2c_get_clientdata(client);
 
+	start = ktime_get();
+
 	priv->gpiod_pwrdn = devm_gpiod_get_optional(&client->dev, "enable",
 						    GPIOD_OUT_HIGH);
 	if (IS_ERR(priv->gpiod_pwrdn)) {
@@ -690,6 +762,8 @@ static int max_gmsl_dp_ser_init(struct device *dev)
 	/* Wait ~4ms for powerup to complete */
 	usleep_range(4000, 4200);
 
+	powered = ktime_get();
+
 	/*
 	 * Write RESET_LINK = 1 (for both Phy A, 0x29, and Phy B, 0x33)
 	 * within 10ms
@@ -761,14 +835,8 @@ static int max_gmsl_dp_ser_init(struct device *dev)
 			       MAX_GMSL_DP_SER_INTR8_VAL);
 
 	/* enable internal CRC after link training */
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_INTERNAL_CRC_X,
-			       MAX_GMSL_DP_SER_INTERNAL_CRC_ENABLE);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_INTERNAL_CRC_Y,
-			       MAX_GMSL_DP_SER_INTERNAL_CRC_ENABLE);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_INTERNAL_CRC_Z,
-			       MAX_GMSL_DP_SER_INTERNAL_CRC_ENABLE);
-	max_gmsl_dp_ser_write(priv, MAX_GMSL_DP_SER_INTERNAL_CRC_U,
-			       MAX_GMSL_DP_SER_INTERNAL_CRC_ENABLE);
+	max_gmsl_dp_ser_write_seq(priv, max_gmsl_internal_crc_seq,
+				  ARRAY_SIZE(max_gmsl_internal_crc_seq), 0);
 
 	/* configure superframe settings */
 	max_gmsl_dp_ser_configure_superframe(dev);
@@ -783,9 +851,44 @@ static int max_gmsl_dp_ser_init(struct device *dev)
 	max_gmsl_dp_ser_update(priv, MAX_GMSL_DP_SER_VID_TX_U,
 			       MAX_GMSL_DP_SER_VID_TX_MASK, 0x1);
 
+	max_gmsl_dp_ser_init_done(priv, start, powered);
+
 	return 0;
 }
 
+static int max_gmsl_dp_ser_timing_show(struct seq_file *s, void *data)
+{
+	struct max_gmsl_dp_ser_priv *priv = s->private;
+
+	seq_printf(s, "inits: %u\n", priv->init_stats.count);
+	seq_printf(s, "last: %llu us (power-up wait %llu us)\n",
+		   priv->init_stats.last_us, priv->init_stats.powerup_us);
+	seq_printf(s, "max: %llu us\n", priv->init_stats.max_us);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max_gmsl_dp_ser_timing);
+
+static void max_gmsl_dp_ser_debugfs_remove(void *data)
+{
+	debugfs_remove_recursive(data);
+}
+
+static void max_gmsl_dp_ser_debugfs_init(struct max_gmsl_dp_ser_priv *priv)
+{
+	struct device *dev = &priv->client->dev;
+	char name[32];
+
+	snprintf(name, sizeof(name), "max_gmsl_dp_ser-%s", dev_name(dev));
+
+	priv->debugfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("init_timing", 0444, priv->debugfs, priv,
+			    &max_gmsl_dp_ser_timing_fops);
+
+	if (devm_add_action_or_reset(dev, max_gmsl_dp_ser_debugfs_remove, priv->debugfs))
+		priv->debugfs = NULL;
+}
+
 static int max_gmsl_dp_ser_parse_mst_props(struct i2c_client *client,
 					   struct max_gmsl_dp_ser_priv *priv)
 {
@@ -1284,6 +1387,8 @@ static int max_gmsl_dp_ser_probe(struct i2c_client *client)
 		return -EFAULT;
 	}
 
+	max_gmsl_dp_ser_debugfs_init(priv);
+
 	priv->ser_errb = of_get_named_gpio(ser, "ser-errb", 0);
 
 	ret = devm_gpio_request_one(&client->dev, priv->ser_errb,
@@ -1371,6 +1476,8 @@ static struct i2c_driver max_gmsl_dp_ser_i2c_driver = {
 	.driver	= {
 		.name		= "max_gmsl_dp_ser",
 		.of_match_table	= of_match_ptr(max_gmsl_dp_ser_dt_ids),
+		/* bring up the serializers of all displays in parallel */
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
 #ifdef CONFIG_PM
 		.pm	= &max_gmsl_dp_ser_pm_ops,
 #endif
@@ -7,18 +7,21 @@
 
 #include <nvidia/conftest.h>
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/fwnode.h>
 #include <linux/gpio/consumer.h>
 #include <linux/gpio/driver.h>
 #include <linux/i2c.h>
 #include <linux/i2c-mux.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of_graph.h>
 #include <linux/regulator/consumer.h>
 #include <linux/slab.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
 #include <linux/of_gpio.h>
 #include <linux/workqueue.h>
 #include <linux/of_device.h>
@@ -241,6 +244,15 @@ struct ti_fpdlink_dp_ser_priv {
 	struct view_port vp;
 	bool link_0_select;
 	bool link_1_select;
+	struct dentry *debugfs;
+	/* serializer init timing */
+	struct {
+		u64 powerup_us;
+		u64 pll_us;
+		u64 dp_config_us;
+		u64 viewport_us;
+		u64 total_us;
+	} init_stats;
 };
 
 static int ti_i2c_read(struct ti_fpdlink_dp_ser_priv *priv, u8 reg)
@@ -270,6 +282,20 @@ static int ti_i2c_write(struct ti_fpdlink_dp_ser_priv *priv, u8 reg, int val)
 	return ret;
 }
 
+static int ti_i2c_write_burst(struct ti_fpdlink_dp_ser_priv *priv, u8 reg,
+	const u8 *buf, size_t len)
+{
+	int ret;
+
+	ret = regmap_bulk_write(priv->regmap, reg, buf, len);
+	if (ret < 0)
+		dev_err(&priv->client->dev,
+			"%s: %zu byte burst at 0x%02x failed (%d)\n",
+			__func__, len, reg, ret);
+
+	return ret;
+}
+
 static int ti_page_indirect_i2c_write(struct ti_fpdlink_dp_ser_priv *priv,
 	u32 page, u32 buffer[][2], u32 length)
 {
@@ -281,13 +307,10 @@ static int ti_page_indirect_i2c_write(struct ti_fpdlink_dp_ser_priv *priv,
 		goto fail;
 
 	for (i = 0; i < length; i++) {
-		// write address at i2c indirect register 0x41
-		ret = ti_i2c_write(priv, TI_IND_ACC_ADDR, buffer[i][0]);
-		if (ret < 0)
-			goto fail;
+		// address at 0x41 and data at 0x42 in a single burst
+		u8 pair[2] = { buffer[i][0], buffer[i][1] };
 
-		// write data at i2c indirect register 0x42
-		ret = ti_i2c_write(priv, TI_IND_ACC_DATA, buffer[i][1]);
+		ret = ti_i2c_write_burst(priv, TI_IND_ACC_ADDR, pair, sizeof(pair));
 		if (ret < 0)
 			goto fail;
 	}
@@ -302,23 +325,13 @@ fail:
 static void ti_fpdlink_dp_apb_write(struct ti_fpdlink_dp_ser_priv *priv,
 		u8 apb_addr[2], u8 apb_data[4])
 {
-	// addr 0
-	ti_i2c_write(priv, TI_APB_ADDR0, apb_addr[0]);
+	// APB_ADDR0..APB_DATA3 are consecutive, write them in one burst
+	u8 buf[6] = {
+		apb_addr[0], apb_addr[1],
+		apb_data[0], apb_data[1], apb_data[2], apb_data[3],
+	};
 
-	// addr 1
-	ti_i2c_write(priv, TI_APB_ADDR1, apb_addr[1]);
-
-	// data 0
-	ti_i2c_write(priv, TI_APB_DATA0, apb_data[0]);
-
-	// data 1
-	ti_i2c_write(priv, TI_APB_DATA1, apb_data[1]);
-
-	// data 2
-	ti_i2c_write(priv, TI_APB_DATA2, apb_data[2]);
-
-	// data 3
-	ti_i2c_write(priv, TI_APB_DATA3, apb_data[3]);
+	ti_i2c_write_burst(priv, TI_APB_ADDR0, buf, sizeof(buf));
 }
 
 static void ti_program_pll_port_0(struct ti_fpdlink_dp_ser_priv *priv)
@@ -624,46 +637,56 @@ static void ti_program_viewport_timing(struct ti_fpdlink_dp_ser_priv *priv)
 		// set page address with autoincrement writes.
 		// ie. If first register is set to 0x2 (using 0x41) then first write will be to 0x2,
 		// next write will 0x3 and so on.
-		ti_i2c_write(priv, TI_IND_ACC_CTL, page);
-		ti_i2c_write(priv, TI_IND_ACC_ADDR, TI_VID_PROC_CFG_VP0);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, TI_VID_PROC_CFG_VP0_DEFAULT);
-		// VID H Active
-		ti_i2c_write(priv, TI_IND_ACC_ADDR, TI_DP_H_ACTIVE0_VP0);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.h_active & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.h_active & 0xFF00) >> 8);
-		//Horizontal Active - VID_H_ACTIVE0_VP0
-		ti_i2c_write(priv, TI_IND_ACC_ADDR, TI_VID_H_ACTIVE0_VP0);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.h_active & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.h_active & 0xFF00) >> 8);
-		//Horizontal Back Porch - VID_H_BACK0_VP0
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.h_back_porch & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.h_back_porch & 0xFF00) >> 8);
-		//Horizontal Sync - VID_H_WIDTH0_VP0
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.h_width & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.h_width & 0xFF00) >> 8);
-		//Horizontal Total - VID_H_TOTAL0_VP0
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.h_total & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.h_total & 0xFF00) >> 8);
-		//Vertical Active - VID_V_ACTIVE0_VP0
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.v_active & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.v_active & 0xFF00) >> 8);
-		//Vertical Back Porch - VID_V_BACK0_VP0
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.v_back_porch & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.v_back_porch & 0xFF00) >> 8);
-		//Vertical Sync - VID_V_WIDTH0_VP0
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.v_width & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.v_width & 0xFF00) >> 8);
-		//Vertical Front Porch - VID_V_FRONT0_VP0
-		ti_i2c_write(priv, TI_IND_ACC_DATA, priv->vp.v_front_porch & 0xFF);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, (priv->vp.v_front_porch & 0xFF00) >> 8);
-		//HSYNC Polarity = +, VSYNC Polarity = +, - VID_PROC_CFG2_VP0
-		ti_i2c_write(priv, TI_IND_ACC_ADDR, TI_VID_PROC_CFG2_VP0);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, 0x0);
-		//M/N Register - M,M and N value
-		ti_i2c_write(priv, TI_IND_ACC_ADDR, TI_PCLK_GEN_M_0_VP0);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, 0x14);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, 0xe);
-		ti_i2c_write(priv, TI_IND_ACC_DATA, 0xf);
+		// The data writes are on the auto-incremented page address, so
+		// they remain separate transfers but go out as one sequence.
+		const struct reg_sequence vp_seq[] = {
+			{ TI_IND_ACC_CTL, page },
+			{ TI_IND_ACC_ADDR, TI_VID_PROC_CFG_VP0 },
+			{ TI_IND_ACC_DATA, TI_VID_PROC_CFG_VP0_DEFAULT },
+			// VID H Active
+			{ TI_IND_ACC_ADDR, TI_DP_H_ACTIVE0_VP0 },
+			{ TI_IND_ACC_DATA, priv->vp.h_active & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.h_active & 0xFF00) >> 8 },
+			//Horizontal Active - VID_H_ACTIVE0_VP0
+			{ TI_IND_ACC_ADDR, TI_VID_H_ACTIVE0_VP0 },
+			{ TI_IND_ACC_DATA, priv->vp.h_active & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.h_active & 0xFF00) >> 8 },
+			//Horizontal Back Porch - VID_H_BACK0_VP0
+			{ TI_IND_ACC_DATA, priv->vp.h_back_porch & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.h_back_porch & 0xFF00) >> 8 },
+			//Horizontal Sync - VID_H_WIDTH0_VP0
+			{ TI_IND_ACC_DATA, priv->vp.h_width & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.h_width & 0xFF00) >> 8 },
+			//Horizontal Total - VID_H_TOTAL0_VP0
+			{ TI_IND_ACC_DATA, priv->vp.h_total & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.h_total & 0xFF00) >> 8 },
+			//Vertical Active - VID_V_ACTIVE0_VP0
+			{ TI_IND_ACC_DATA, priv->vp.v_active & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.v_active & 0xFF00) >> 8 },
+			//Vertical Back Porch - VID_V_BACK0_VP0
+			{ TI_IND_ACC_DATA, priv->vp.v_back_porch & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.v_back_porch & 0xFF00) >> 8 },
+			//Vertical Sync - VID_V_WIDTH0_VP0
+			{ TI_IND_ACC_DATA, priv->vp.v_width & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.v_width & 0xFF00) >> 8 },
+			//Vertical Front Porch - VID_V_FRONT0_VP0
+			{ TI_IND_ACC_DATA, priv->vp.v_front_porch & 0xFF },
+			{ TI_IND_ACC_DATA, (priv->vp.v_front_porch & 0xFF00) >> 8 },
+			//HSYNC Polarity = +, VSYNC Polarity = +, - VID_PROC_CFG2_VP0
+			{ TI_IND_ACC_ADDR, TI_VID_PROC_CFG2_VP0 },
+			{ TI_IND_ACC_DATA, 0x0 },
+			//M/N Register - M,M and N value
+			{ TI_IND_ACC_ADDR, TI_PCLK_GEN_M_0_VP0 },
+			{ TI_IND_ACC_DATA, 0x14 },
+			{ TI_IND_ACC_DATA, 0xe },
+			{ TI_IND_ACC_DATA, 0xf },
+		};
+		int ret;
+
+		ret = regmap_multi_reg_write(priv->regmap, vp_seq, ARRAY_SIZE(vp_seq));
+		if (ret < 0)
+			dev_err(&priv->client->dev,
+				"%s: viewport timing write failed (%d)\n", __func__, ret);
 	}
 
 	// Enable VP
@@ -725,11 +748,14 @@ static int ti_fpdlink_dp_ser_init(struct device *dev)
 {
 	struct ti_fpdlink_dp_ser_priv *priv;
 	struct i2c_client *client;
+	ktime_t start, t;
 	int ret = 0;
 
 	client = to_i2c_client(dev);
 	priv = i2c_get_clientdata(client);
 
+	start = ktime_get();
+
 	priv->gpiod_pwrdn = devm_gpiod_get_optional(&client->dev, "enable",
 						    GPIOD_OUT_HIGH);
 	if (IS_ERR(priv->gpiod_pwrdn)) {
@@ -744,6 +770,9 @@ static int ti_fpdlink_dp_ser_init(struct device *dev)
 	/* Wait ~20ms for link to establish after power up */
 	usleep_range(20000, 21000);
 
+	t = ktime_get();
+	priv->init_stats.powerup_us = ktime_us_delta(t, start);
+
 	// Init addresses
 	ti_i2c_write(priv, TI_TARGET_ID_0, TI_TARGET_ID_VAL);
 	ti_i2c_write(priv, TI_TARGET_ALIAS_ID_0, TI_TARGET_ALIAS_ID_VAL);
@@ -751,13 +780,56 @@ static int ti_fpdlink_dp_ser_init(struct device *dev)
 
 	ti_program_pll(priv);
 
+	priv->init_stats.pll_us = ktime_us_delta(ktime_get(), t);
+	t = ktime_get();
+
 	ti_program_dp_config(priv);
 
+	priv->init_stats.dp_config_us = ktime_us_delta(ktime_get(), t);
+	t = ktime_get();
+
 	ti_program_viewport_timing(priv);
 
+	priv->init_stats.viewport_us = ktime_us_delta(ktime_get(), t);
+	priv->init_stats.total_us = ktime_us_delta(ktime_get(), start);
+
 	return ret;
 }
 
+static int ti_fpdlink_dp_ser_timing_show(struct seq_file *s, void *data)
+{
+	struct ti_fpdlink_dp_ser_priv *priv = s->private;
+
+	seq_printf(s, "power-up wait: %llu us\n", priv->init_stats.powerup_us);
+	seq_printf(s, "pll: %llu us\n", priv->init_stats.pll_us);
+	seq_printf(s, "dp config: %llu us\n", priv->init_stats.dp_config_us);
+	seq_printf(s, "viewport: %llu us\n", priv->init_stats.viewport_us);
+	seq_printf(s, "total: %llu us\n", priv->init_stats.total_us);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ti_fpdlink_dp_ser_timing);
+
+static void ti_fpdlink_dp_ser_debugfs_remove(void *data)
+{
+	debugfs_remove_recursive(data);
+}
+
+static void ti_fpdlink_dp_ser_debugfs_init(struct ti_fpdlink_dp_ser_priv *priv)
+{
+	struct device *dev = &priv->client->dev;
+	char name[32];
+
+	snprintf(name, sizeof(name), "ti_fpdlink_dp_ser-%s", dev_name(dev));
+
+	priv->debugfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("init_timing", 0444, priv->debugfs, priv,
+			    &ti_fpdlink_dp_ser_timing_fops);
+
+	if (devm_add_action_or_reset(dev, ti_fpdlink_dp_ser_debugfs_remove, priv->debugfs))
+		priv->debugfs = NULL;
+}
+
 static int ti_fpdlink_dp_ser_parse_dt_link_config(struct i2c_client *client,
 				struct ti_fpdlink_dp_ser_priv *priv)
 {
@@ -1011,6 +1083,8 @@ static int ti_fpdlink_dp_ser_probe(struct i2c_client *client)
 	}
 	dev_err(dev, "%s: TI Serializer initialization completed\n", __func__);
 
+	ti_fpdlink_dp_ser_debugfs_init(priv);
+
 	return ret;
 }
 
@@ -1040,6 +1114,8 @@ static struct i2c_driver ti_fpdlink_dp_ser_i2c_driver = {
 	.driver	= {
 		.name		= "ti_fpdlink_dp_ser",
 		.of_match_table	= of_match_ptr(ti_fpdlink_dp_ser_dt_ids),
+		/* bring up the serializers of all displays in parallel */
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
 	},
 #if defined(NV_I2C_DRIVER_STRUCT_HAS_PROBE_NEW) /* Dropped on Linux 6.6 */
 	.probe_new	= ti_fpdlink_dp_ser_probe,
@@ -24,6 +24,9 @@
 #include <linux/regulator/consumer.h>
 #include <linux/slab.h>
 #include <linux/nvhost.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 
 #include <media/mc_common.h>
 
@@ -40,7 +43,40 @@ static int debugfs_deskew_data_stats_high[NVCSI_PHY_CIL_NUM_LANE];
 static unsigned int enabled_deskew_lanes;
 static unsigned int done_deskew_lanes;
 
-static int nvcsi_deskew_apply_helper(unsigned int active_lanes);
+/*
+ * Trimmer settings that converged on a PHY. The clock trimmer is shared by
+ * the lanes of the PHY and the data trimmers are relative to it, so an
+ * entry is only reused for the exact lane set and data rate it was
+ * computed for.
+ */
+struct deskew_cache_entry {
+	u64 data_rate;
+	unsigned int lanes;
+	unsigned int d_trimmer[4];
+	unsigned int clk_trimmer;
+	unsigned int err_restarts;
+	u64 stamp;
+};
+
+struct deskew_timing {
+	u64 count;
+	u64 last_us;
+	u64 max_us;
+	u64 total_us;
+};
+
+static struct deskew_cache_entry
+	deskew_cache[NVCSI_PHY_NUM_BRICKS][DESKEW_CACHE_ENTRIES];
+static u64 deskew_cache_stamp;
+static u64 deskew_cache_hits;
+static u64 deskew_drift_recalibrations;
+static struct deskew_timing deskew_calib_timing;
+static struct deskew_timing deskew_apply_timing;
+
+static int nvcsi_deskew_apply_helper(unsigned int active_lanes, u64 data_rate);
+static void set_trimmer(unsigned int phy_num, unsigned int cila,
+			unsigned int cilb,
+			unsigned int *d, unsigned int c);
 
 static bool is_t19x_or_greater;
 // a regmap for address changes between chips
@@ -94,6 +130,12 @@ void nvcsi_deskew_platform_setup(struct tegra_csi_device *dev, bool t19x)
 	mutex_init(&deskew_lock);
 	enabled_deskew_lanes = 0;
 	done_deskew_lanes = 0;
+	memset(deskew_cache, 0, sizeof(deskew_cache));
+	deskew_cache_stamp = 0;
+	deskew_cache_hits = 0;
+	deskew_drift_recalibrations = 0;
+	memset(&deskew_calib_timing, 0, sizeof(deskew_calib_timing));
+	memset(&deskew_apply_timing, 0, sizeof(deskew_apply_timing));
 	if (is_t19x_or_greater)
 		for (i = 0; i < REGS_COUNT; ++i)
 			regs[i] = t194_regs[i];
@@ -335,19 +377,180 @@ static int wait_cilb_done(unsigned int phy_num, unsigned int cilb_io_lanes,
 	return -ETIMEDOUT;
 }
 
+static void deskew_timing_add(struct deskew_timing *t, ktime_t start)
+{
+	u64 us = ktime_us_delta(ktime_get(), start);
+
+	t->count++;
+	t->last_us = us;
+	t->max_us = max(t->max_us, us);
+	t->total_us += us;
+}
+
+/*
+ * Read and clear the CIL interrupt status of the given lanes of a PHY.
+ * Only the deskew done bits are expected while a PHY is healthy, anything
+ * else latched since the last apply counts as an error.
+ */
+static bool nvcsi_deskew_phy_errors(unsigned int phy_num,
+				    unsigned int cil_lanes)
+{
+	const unsigned int done = intr_dphy_cil_deskew_calib_done_ctrl |
+				  intr_dphy_cil_deskew_calib_done_lane1 |
+				  intr_dphy_cil_deskew_calib_done_lane0;
+	unsigned int addr, val;
+	bool err = false;
+
+	if (cil_lanes & (NVCSI_PHY_0_NVCSI_CIL_A_IO0 |
+			 NVCSI_PHY_0_NVCSI_CIL_A_IO1)) {
+		addr = NVCSI_PHY_0_CILA_INTR_STATUS + NVCSI_PHY_OFFSET * phy_num;
+		val = host1x_readl(mc_csi->pdev, addr);
+		host1x_writel(mc_csi->pdev, addr, val);
+		err |= !!(val & ~done);
+	}
+	if (cil_lanes & (NVCSI_PHY_0_NVCSI_CIL_B_IO0 |
+			 NVCSI_PHY_0_NVCSI_CIL_B_IO1)) {
+		addr = NVCSI_PHY_0_CILB_INTR_STATUS + NVCSI_PHY_OFFSET * phy_num;
+		val = host1x_readl(mc_csi->pdev, addr);
+		host1x_writel(mc_csi->pdev, addr, val);
+		err |= !!(val & ~done);
+	}
+
+	return err;
+}
+
+static struct deskew_cache_entry *deskew_cache_find(unsigned int phy_num,
+						    unsigned int cil_lanes,
+						    u64 data_rate)
+{
+	struct deskew_cache_entry *entry;
+	unsigned int i;
+
+	for (i = 0; i < DESKEW_CACHE_ENTRIES; i++) {
+		entry = &deskew_cache[phy_num][i];
+		if (entry->lanes == cil_lanes && entry->data_rate == data_rate)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void deskew_cache_store(unsigned int phy_num, unsigned int cil_lanes,
+			       u64 data_rate, unsigned int *d, unsigned int c)
+{
+	struct deskew_cache_entry *entry, *victim;
+	unsigned int i;
+
+	if (!data_rate)
+		return;
+
+	mutex_lock(&deskew_lock);
+	victim = deskew_cache_find(phy_num, cil_lanes, data_rate);
+	for (i = 0; !victim && i < DESKEW_CACHE_ENTRIES; i++) {
+		entry = &deskew_cache[phy_num][i];
+		if (!entry->lanes) {
+			victim = entry;
+			break;
+		}
+	}
+	if (!victim) {
+		/* evict the entry that was least recently applied */
+		victim = &deskew_cache[phy_num][0];
+		for (i = 1; i < DESKEW_CACHE_ENTRIES; i++) {
+			entry = &deskew_cache[phy_num][i];
+			if (entry->stamp < victim->stamp)
+				victim = entry;
+		}
+	}
+
+	victim->data_rate = data_rate;
+	victim->lanes = cil_lanes;
+	memcpy(victim->d_trimmer, d, sizeof(victim->d_trimmer));
+	victim->clk_trimmer = c;
+	victim->err_restarts = 0;
+	victim->stamp = ++deskew_cache_stamp;
+	mutex_unlock(&deskew_lock);
+
+	/* errors latched during the sweep must not count against the result */
+	nvcsi_deskew_phy_errors(phy_num, cil_lanes);
+}
+
+/*
+ * Program the cached trimmers of every PHY of the context that has a
+ * matching entry and return the lanes that no longer need a sweep. A PHY
+ * whose CIL keeps reporting errors with cached trimmers is dropped from
+ * the cache so it gets calibrated again.
+ */
+static unsigned int nvcsi_deskew_apply_cached(struct nvcsi_deskew_context *ctx)
+{
+	struct deskew_cache_entry *entry;
+	unsigned int phy_num, cil_lanes, applied = 0;
+	ktime_t start = ktime_get();
+
+	if (!ctx->data_rate)
+		return 0;
+
+	mutex_lock(&deskew_lock);
+	for (phy_num = 0; phy_num < NVCSI_PHY_NUM_BRICKS; phy_num++) {
+		cil_lanes = (ctx->deskew_lanes >> (phy_num * 4)) & 0xf;
+		/* leave PHYs that are mid-sweep for another stream alone */
+		if (!cil_lanes ||
+		    (enabled_deskew_lanes & (0xf << (phy_num * 4))))
+			continue;
+		entry = deskew_cache_find(phy_num, cil_lanes, ctx->data_rate);
+		if (!entry)
+			continue;
+
+		if (nvcsi_deskew_phy_errors(phy_num, cil_lanes)) {
+			if (++entry->err_restarts >= DESKEW_DRIFT_RESTARTS) {
+				dev_info(mc_csi->dev,
+					"deskew drift on phy %u, recalibrating\n",
+					phy_num);
+				memset(entry, 0, sizeof(*entry));
+				deskew_drift_recalibrations++;
+				continue;
+			}
+		} else {
+			entry->err_restarts = 0;
+		}
+
+		set_trimmer(phy_num,
+			cil_lanes & (NVCSI_PHY_0_NVCSI_CIL_A_IO0 |
+				     NVCSI_PHY_0_NVCSI_CIL_A_IO1),
+			cil_lanes & (NVCSI_PHY_0_NVCSI_CIL_B_IO0 |
+				     NVCSI_PHY_0_NVCSI_CIL_B_IO1),
+			entry->d_trimmer, entry->clk_trimmer);
+		entry->stamp = ++deskew_cache_stamp;
+		applied |= cil_lanes << (phy_num * 4);
+	}
+	if (applied) {
+		deskew_cache_hits++;
+		deskew_timing_add(&deskew_apply_timing, start);
+		done_deskew_lanes |= applied;
+	}
+	mutex_unlock(&deskew_lock);
+
+	if (applied)
+		dev_dbg(mc_csi->dev,
+			"deskew reused cached trimmers for lanes 0x%04x\n",
+			applied);
+
+	return applied;
+}
+
 static int nvcsi_deskew_thread(void *data)
 {
 	int ret = 0;
 	unsigned int phy_num = 0;
 	unsigned int cil_lanes = 0, cila_io_lanes = 0, cilb_io_lanes = 0;
 	struct nvcsi_deskew_context *ctx = data;
-	unsigned int remaining_lanes = ctx->deskew_lanes;
+	unsigned int remaining_lanes = ctx->calib_lanes;
 	unsigned long timeout = 0;
 
 	timeout = jiffies + msecs_to_jiffies(DESKEW_TIMEOUT_MSEC);
 
 	while (remaining_lanes) {
-		cil_lanes = (ctx->deskew_lanes & (0x000f << (phy_num * 4)))
+		cil_lanes = (ctx->calib_lanes & (0x000f << (phy_num * 4)))
 				>> (phy_num * 4);
 		cila_io_lanes =  cil_lanes & (NVCSI_PHY_0_NVCSI_CIL_A_IO0
 			| NVCSI_PHY_0_NVCSI_CIL_A_IO1);
@@ -367,15 +570,18 @@ static int nvcsi_deskew_thread(void *data)
 		phy_num++;
 	}
 
-	ret = nvcsi_deskew_apply_helper(ctx->deskew_lanes);
+	ret = nvcsi_deskew_apply_helper(ctx->calib_lanes, ctx->data_rate);
 	if (!ret) {
 		dev_info(mc_csi->dev, "deskew finished for lanes 0x%04x",
-							ctx->deskew_lanes);
-		set_done_with_lock(ctx->deskew_lanes);
+							ctx->calib_lanes);
+		mutex_lock(&deskew_lock);
+		deskew_timing_add(&deskew_calib_timing, ctx->calib_start);
+		mutex_unlock(&deskew_lock);
+		set_done_with_lock(ctx->calib_lanes);
 	} else {
 		dev_info(mc_csi->dev,
 			"deskew apply helper failed for lanes 0x%04x",
-							ctx->deskew_lanes);
+							ctx->calib_lanes);
 		goto err;
 	}
 
@@ -386,11 +592,11 @@ static int nvcsi_deskew_thread(void *data)
 err:
 	if (ret == -ETIMEDOUT)
 		dev_info(mc_csi->dev, "deskew timed out for lanes 0x%04x",
-					ctx->deskew_lanes);
+					ctx->calib_lanes);
 	else if (ret == -EINVAL)
 		dev_info(mc_csi->dev, "deskew calib err for lanes 0x%04x",
-					ctx->deskew_lanes);
-	unset_enabled_with_lock(ctx->deskew_lanes);
+					ctx->calib_lanes);
+	unset_enabled_with_lock(ctx->calib_lanes);
 	complete(&ctx->thread_done);
 
 	return ret;
@@ -414,17 +620,23 @@ int nvcsi_deskew_setup(struct nvcsi_deskew_context *ctx)
 	done_deskew_lanes &= ~(ctx->deskew_lanes);
 	mutex_unlock(&deskew_lock);
 
-	new_lanes = ctx->deskew_lanes & ~enabled_deskew_lanes;
+	init_completion(&ctx->thread_done);
+	new_lanes = ctx->deskew_lanes & ~nvcsi_deskew_apply_cached(ctx);
+	new_lanes &= ~enabled_deskew_lanes;
 	if (new_lanes) {
+		ctx->calib_lanes = new_lanes;
+		ctx->calib_start = ktime_get();
 		set_enabled_with_lock(new_lanes);
 		nvcsi_deskew_setup_start(new_lanes);
-		init_completion(&ctx->thread_done);
 		ctx->deskew_kthread = kthread_run(nvcsi_deskew_thread,
 							ctx, "deskew");
 		if (IS_ERR(ctx->deskew_kthread)) {
 			ret = PTR_ERR(ctx->deskew_kthread);
+			unset_enabled_with_lock(new_lanes);
 			complete(&ctx->thread_done);
 		}
+	} else {
+		complete(&ctx->thread_done);
 	}
 	return ret;
 }
@@ -668,7 +880,7 @@ int nvcsi_deskew_apply_check(struct nvcsi_deskew_context *ctx)
 }
 EXPORT_SYMBOL(nvcsi_deskew_apply_check);
 
-static int nvcsi_deskew_apply_helper(unsigned int active_lanes)
+static int nvcsi_deskew_apply_helper(unsigned int active_lanes, u64 data_rate)
 {
 	unsigned int phy_num = -1;
 	unsigned int cil_lanes = 0, cila_io_lanes = 0, cilb_io_lanes = 0;
@@ -711,6 +923,8 @@ static int nvcsi_deskew_apply_helper(unsigned int active_lanes)
 		/*step 3: Apply trimmer settings */
 		set_trimmer(phy_num, cila_io_lanes, cilb_io_lanes,
 				d_trimmer, clk_trimmer);
+		deskew_cache_store(phy_num, cil_lanes, data_rate,
+				d_trimmer, clk_trimmer);
 	}
 	return 0;
 }
@@ -743,3 +957,38 @@ void deskew_dbgfs_deskew_stats(struct seq_file *s)
 	}
 }
 
+
+static void deskew_dbgfs_print_timing(struct seq_file *s, const char *name,
+				      const struct deskew_timing *t)
+{
+	seq_printf(s, "%s: count %llu last %lluus max %lluus avg %lluus\n",
+		   name, t->count, t->last_us, t->max_us,
+		   t->count ? div64_u64(t->total_us, t->count) : 0);
+}
+
+void deskew_dbgfs_deskew_timing(struct seq_file *s)
+{
+	const struct deskew_cache_entry *entry;
+	unsigned int phy_num, i;
+
+	mutex_lock(&deskew_lock);
+	deskew_dbgfs_print_timing(s, "calibration", &deskew_calib_timing);
+	deskew_dbgfs_print_timing(s, "cached apply", &deskew_apply_timing);
+	seq_printf(s, "cache hits %llu drift recalibrations %llu\n",
+		   deskew_cache_hits, deskew_drift_recalibrations);
+	seq_puts(s, "phy lanes data_rate clk data errors\n");
+	for (phy_num = 0; phy_num < NVCSI_PHY_NUM_BRICKS; phy_num++) {
+		for (i = 0; i < DESKEW_CACHE_ENTRIES; i++) {
+			entry = &deskew_cache[phy_num][i];
+			if (!entry->lanes)
+				continue;
+			seq_printf(s, "%u 0x%x %llu %u %u/%u/%u/%u %u\n",
+				   phy_num, entry->lanes, entry->data_rate,
+				   entry->clk_trimmer,
+				   entry->d_trimmer[0], entry->d_trimmer[1],
+				   entry->d_trimmer[2], entry->d_trimmer[3],
+				   entry->err_restarts);
+		}
+	}
+	mutex_unlock(&deskew_lock);
+}
@@ -10,6 +10,7 @@
 #define __DESKEW_H__
 
 #include <linux/completion.h>
+#include <linux/ktime.h>
 #include <uapi/linux/nvhost_nvcsi_ioctl.h>
 #include <media/csi.h>
 
@@ -132,8 +133,21 @@
 
 #define DESKEW_TIMEOUT_MSEC 100
 
+/* converged trimmer sets kept per PHY, one per lane set and data rate */
+#define DESKEW_CACHE_ENTRIES 4
+/*
+ * consecutive stream starts that may see CIL errors before the cached
+ * trimmers of a PHY are dropped and the sweep is run again
+ */
+#define DESKEW_DRIFT_RESTARTS 2
+
 struct nvcsi_deskew_context {
 	unsigned int deskew_lanes;
+	/* lanes of deskew_lanes swept by the calibration thread */
+	unsigned int calib_lanes;
+	/* data rate the trimmers are cached under, 0 bypasses the cache */
+	u64 data_rate;
+	ktime_t calib_start;
 	struct task_struct *deskew_kthread;
 	struct completion thread_done;
 };
@@ -146,5 +160,6 @@ void nvcsi_deskew_platform_setup(struct tegra_csi_device *dev, bool is_t19x);
 
 void deskew_dbgfs_calc_bound(struct seq_file *s, long long input_stats);
 void deskew_dbgfs_deskew_stats(struct seq_file *s);
+void deskew_dbgfs_deskew_timing(struct seq_file *s);
 
 #endif
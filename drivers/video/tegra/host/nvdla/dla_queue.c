@@ -12,6 +12,8 @@
 #include <linux/vmalloc.h>
 #include <linux/dma-mapping.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/wait.h>
 
 #include <linux/nvhost.h>
 
@@ -38,8 +40,10 @@
  * alloc_table		Keep track of the index being assigned
  *			and freed for a task
  * max_task_cnt	Maximum task count that can be supported.
- * cleanup_done	Completion status of cleanup wait.
- * cleanup_wait	Records wait for cleanup action.
+ * free_wait		Wait queue of submitters waiting for a free slot.
+ * alloc_count		Number of slots handed out.
+ * exhausted_count	Number of allocations that found the pool full.
+ * max_in_use		Largest number of slots in use at once.
  */
 
 struct nvdla_queue_task_pool {
@@ -51,8 +55,10 @@ struct nvdla_queue_task_pool {
 	unsigned long alloc_table;
 	unsigned long max_task_cnt;
 
-	struct completion cleanup_done;
-	int cleanup_wait;
+	wait_queue_head_t free_wait;
+	u64 alloc_count;
+	u64 exhausted_count;
+	unsigned int max_in_use;
 };
 
 static int nvdla_queue_task_pool_alloc(struct platform_device *pdev,
@@ -91,8 +97,10 @@ static int nvdla_queue_task_pool_alloc(struct platform_device *pdev,
 
 	mutex_init(&task_pool->lock);
 
-	init_completion(&task_pool->cleanup_done);
-	task_pool->cleanup_wait = 0;
+	init_waitqueue_head(&task_pool->free_wait);
+	task_pool->alloc_count = 0;
+	task_pool->exhausted_count = 0;
+	task_pool->max_in_use = 0;
 
 	return err;
 
@@ -568,6 +576,42 @@ int nvdla_queue_get_task_size(struct nvdla_queue *queue)
 	return 0;
 }
 
+static bool nvdla_queue_task_pool_has_free(
+			struct nvdla_queue_task_pool *task_pool)
+{
+	return find_first_zero_bit(&task_pool->alloc_table,
+				   task_pool->max_task_cnt) <
+		task_pool->max_task_cnt;
+}
+
+/* Claim a free slot of the pool, returns the slot or -EAGAIN */
+static int nvdla_queue_task_pool_claim(struct nvdla_queue_task_pool *task_pool)
+{
+	unsigned int in_use;
+	int index;
+
+	mutex_lock(&task_pool->lock);
+
+	index = find_first_zero_bit(&task_pool->alloc_table,
+				    task_pool->max_task_cnt);
+	if (index >= task_pool->max_task_cnt) {
+		index = -EAGAIN;
+		goto out;
+	}
+
+	set_bit(index, &task_pool->alloc_table);
+	task_pool->alloc_count++;
+	in_use = bitmap_weight(&task_pool->alloc_table,
+			       task_pool->max_task_cnt);
+	if (in_use > task_pool->max_in_use)
+		task_pool->max_in_use = in_use;
+
+out:
+	mutex_unlock(&task_pool->lock);
+
+	return index;
+}
+
 int nvdla_queue_alloc_task_memory(
 			struct nvdla_queue *queue,
 			struct nvdla_queue_task_mem_info *task_mem_info)
@@ -578,33 +622,32 @@ int nvdla_queue_alloc_task_memory(
 	struct nvdla_queue_task_pool *task_pool =
 		(struct nvdla_queue_task_pool *)queue->task_pool;
 
-	if (task_pool->cleanup_wait == 1) {
-		unsigned long timeout =
-			msecs_to_jiffies(NVDLA_TASK_MEM_AVAIL_RETRY_PERIOD);
-
-		/**
-		 * Error intentionally ignored to be catpured as part of
-		 * out-of-range index during allocation.
-		 **/
-		(void) wait_for_completion_timeout(&task_pool->cleanup_done,
-				timeout);
+	index = nvdla_queue_task_pool_claim(task_pool);
+	if (index == -EAGAIN) {
+		unsigned long deadline = jiffies +
+			msecs_to_jiffies(NVDLA_TASK_MEM_AVAIL_TIMEOUT_MS);
+
+		mutex_lock(&task_pool->lock);
+		task_pool->exhausted_count++;
+		mutex_unlock(&task_pool->lock);
+
+		/* slots are released by task completion, wait for one */
+		while ((index < 0) && time_before(jiffies, deadline)) {
+			(void) wait_event_timeout(task_pool->free_wait,
+				nvdla_queue_task_pool_has_free(task_pool),
+				deadline - jiffies);
+			index = nvdla_queue_task_pool_claim(task_pool);
+		}
 	}
 
-	mutex_lock(&task_pool->lock);
-
-	index = find_first_zero_bit(&task_pool->alloc_table,
-				    task_pool->max_task_cnt);
-
 	/* quit if pre-allocated task array is not free */
-	if (index >= task_pool->max_task_cnt) {
+	if (index < 0) {
 		dev_warn(&pdev->dev, "failed to get Task Pool Memory\n");
-		task_pool->cleanup_wait = 1; // wait for cleanup
 		err = -EAGAIN;
 		goto err_alloc_task_mem;
 	}
 
 	/* assign the task array */
-	set_bit(index, &task_pool->alloc_table);
 	hw_offset = index * queue->task_dma_size;
 	sw_offset = index * queue->task_kmem_size;
 	task_mem_info->kmem_addr =
@@ -614,8 +657,6 @@ int nvdla_queue_alloc_task_memory(
 	task_mem_info->pool_index = index;
 
 err_alloc_task_mem:
-	mutex_unlock(&task_pool->lock);
-
 	return err;
 }
 
@@ -637,10 +678,32 @@ void nvdla_queue_free_task_memory(struct nvdla_queue *queue, int index)
 
 	mutex_lock(&task_pool->lock);
 	clear_bit(index, &task_pool->alloc_table);
+	mutex_unlock(&task_pool->lock);
 
-	if (task_pool->cleanup_wait == 1) {
-		task_pool->cleanup_wait = 0;
-		complete(&task_pool->cleanup_done);
+	wake_up(&task_pool->free_wait);
+}
+
+void nvdla_queue_pool_dump_task_pools(struct nvdla_queue_pool *pool,
+				      struct seq_file *s)
+{
+	unsigned int queue_id;
+
+	mutex_lock(&pool->queue_lock);
+	for_each_set_bit(queue_id, &pool->alloc_table, pool->max_queue_cnt) {
+		struct nvdla_queue *queue = &pool->queues[queue_id];
+		struct nvdla_queue_task_pool *tpool = queue->task_pool;
+
+		if (queue->task_dma_size == 0)
+			continue;
+
+		mutex_lock(&tpool->lock);
+		seq_printf(s, "queue %u: slots %lu in_use %u max_in_use %u allocs %llu exhausted %llu\n",
+			   queue_id, tpool->max_task_cnt,
+			   bitmap_weight(&tpool->alloc_table,
+					 tpool->max_task_cnt),
+			   tpool->max_in_use, tpool->alloc_count,
+			   tpool->exhausted_count);
+		mutex_unlock(&tpool->lock);
 	}
-	mutex_unlock(&task_pool->lock);
+	mutex_unlock(&pool->queue_lock);
 }
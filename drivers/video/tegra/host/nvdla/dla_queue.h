@@ -11,7 +11,6 @@
 #include <linux/kref.h>
 
 #define NVDLA_TASK_MEM_AVAIL_TIMEOUT_MS 10  /* 10 ms */
-#define NVDLA_TASK_MEM_AVAIL_RETRY_PERIOD 1 /* 1 ms */
 
 struct nvdla_queue_task_pool;
 
@@ -246,7 +245,8 @@ int nvdla_queue_get_task_size(struct nvdla_queue *queue);
  *
  * This function helps to assign a task memory from
  * the preallocated task memory pool. This memory is shared memory between
- * kernel and firmware
+ * kernel and firmware. When the pool is full, this waits up to
+ * NVDLA_TASK_MEM_AVAIL_TIMEOUT_MS for a task to release its memory.
  *
  * @queue		Pointer to an allocated queue
  * @task_mem_info	Pointer to nvdla_queue_task_mem_info struct
@@ -270,6 +270,17 @@ int nvdla_queue_alloc_task_memory(
  */
 void nvdla_queue_free_task_memory(struct nvdla_queue *queue, int index);
 
+/**
+ * @brief	Dump the task memory pool usage of the allocated queues
+ *
+ * @param pool	Pointer to a queue pool
+ * @param s	seq_file to print to
+ * @return	void
+ *
+ */
+void nvdla_queue_pool_dump_task_pools(struct nvdla_queue_pool *pool,
+				      struct seq_file *s);
+
 /**
  * @brief	Sets the attribute to the queue
  *
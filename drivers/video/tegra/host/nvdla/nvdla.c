@@ -1172,6 +1172,10 @@ static int nvdla_probe(struct platform_device *pdev)
 	if (err)
 		goto err_alloc_window_size_mem;
 
+	err = nvdla_load_init(pdev);
+	if (err)
+		goto err_load_init;
+
 	nvdla_dbg_info(pdev, "hwpm ip %s register", pdev->name);
 	hwpm_ip_ops.ip_dev = (void *)pdev;
 	hwpm_ip_ops.ip_base_address = pdev->resource[0].start;
@@ -1238,8 +1242,10 @@ err_clk_cap_fail:
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
 err_inj_handler_init:
 	tegra_soc_hwpm_ip_unregister(&hwpm_ip_ops);
-	nvdla_free_window_size_memory(pdev);
 #endif /* CONFIG_TEGRA_HSIERRRPTINJ */
+	nvdla_load_deinit(pdev);
+err_load_init:
+	nvdla_free_window_size_memory(pdev);
 err_alloc_window_size_mem:
 	nvdla_free_utilization_rate_memory(pdev);
 err_alloc_utilization_rate_mem:
@@ -1295,6 +1301,7 @@ static int __exit nvdla_remove(struct platform_device *pdev)
 	nvdla_error_inj_handler_deinit(nvdla_dev);
 #endif /* CONFIG_TEGRA_HSIERRRPTINJ */
 
+	nvdla_load_deinit(pdev);
 	nvhost_syncpt_unit_interface_deinit(pdev);
 	nvdla_queue_deinit(nvdla_dev->pool);
 	nvhost_client_device_release(pdev);
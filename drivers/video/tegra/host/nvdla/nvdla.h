@@ -11,6 +11,8 @@
 #include <linux/completion.h>
 #include <linux/interconnect.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <uapi/linux/nvdev_fence.h>
 #include <uapi/linux/nvhost_nvdla_ioctl.h>
 
@@ -41,6 +43,9 @@
 
 #endif /* CONFIG_TEGRA_HSIERRRPTINJ */
 
+struct devfreq;
+struct seq_file;
+
 /* DLA FUSE REGISTER
  * Corresponds to the offset of "opt-dla-disable" - part of the
  * struct tegra_fuse_cells of type nvmem_cell_info.
@@ -252,6 +257,37 @@ enum nvdla_submit_mode {
 	NVDLA_SUBMIT_MODE_CHANNEL	= 1
 };
 
+/**
+ * data structure to keep sampled DLA load
+ *
+ * @work				periodic utilization sampling work
+ * @lock				protects the fields below
+ * @last_sample			time of the last utilization sample
+ * @utilization			last firmware utilization, percent scaled by 10000
+ * @busy_ns				sampled busy time
+ * @total_ns			sampled time
+ * @df_busy_ns			busy_ns at the previous devfreq status read
+ * @df_total_ns			total_ns at the previous devfreq status read
+ * @tasks				number of completed tasks
+ * @task_exec_us		accumulated task execution time
+ * @task_exec_max_us	longest task execution time
+ * @devfreq				devfreq device, NULL when clock scaling is unavailable
+ */
+struct nvdla_load {
+	struct delayed_work work;
+	spinlock_t lock;
+	ktime_t last_sample;
+	u32 utilization;
+	u64 busy_ns;
+	u64 total_ns;
+	u64 df_busy_ns;
+	u64 df_total_ns;
+	u64 tasks;
+	u64 task_exec_us;
+	u32 task_exec_max_us;
+	struct devfreq *devfreq;
+};
+
 /**
  * data structure to keep per DLA engine device data
  *
@@ -279,6 +315,7 @@ enum nvdla_submit_mode {
  * @window_mem_va       virtual address of window size buffer
  * @is_suspended	flag to check if module is in suspend state.
  * @ping_lock	lock to synchronize the ping operation requests.
+ * @load	sampled load and clock scaling state
  */
 struct nvdla_device {
 	struct device *dev;
@@ -312,6 +349,7 @@ struct nvdla_device {
 	bool is_suspended;
 #endif
 	struct mutex ping_lock;
+	struct nvdla_load load;
 };
 
 /**
@@ -351,6 +389,8 @@ struct nvdla_emu_task {
  * @buf_size		Total size of task dma alloc
  * @timeout		max timeout to wait for task completion
  * @op_handle		pointer to handle list of operation descriptor
+ * @ordered		task is part of an NVDLA_SUBMIT_FLAGS_ORDERED submit
+ * @batch_fence		queue syncpoint max value before the ordered submit
  *
  */
 struct nvdla_task {
@@ -381,6 +421,8 @@ struct nvdla_task {
 	size_t buf_size;
 	int timeout;
 	int pool_index;
+	bool ordered;
+	u32 batch_fence;
 
 	struct dma_buf *memory_dmabuf[MAX_NVDLA_BUFFERS_PER_TASK];
 	struct dma_buf *prefences_sem_dmabuf[MAX_NVDLA_PREFENCES_PER_TASK];
@@ -509,6 +551,57 @@ size_t nvdla_get_max_task_size(void);
 int nvdla_alloc_gcov_region(struct platform_device *pdev);
 int nvdla_free_gcov_region(struct platform_device *pdev, bool update_region);
 
+/**
+ * nvdla_get_stats() read the firmware utilization rate
+ *
+ * @nvdla_dev		Pointer to DLA device, must be powered on
+ *
+ * Return		0 on success otherwise negative
+ *
+ * The utilization is written to utilization_mem_va as percent scaled
+ * by 10000, measured over the firmware statistics window.
+ */
+int nvdla_get_stats(struct nvdla_device *nvdla_dev);
+
+/**
+ * nvdla_load_init() start load sampling and register for clock scaling
+ *
+ * @pdev		Pointer for platform device
+ *
+ * Return		0 on success otherwise negative
+ */
+int nvdla_load_init(struct platform_device *pdev);
+
+/**
+ * nvdla_load_deinit() stop load sampling and clock scaling
+ *
+ * @pdev		Pointer for platform device
+ */
+void nvdla_load_deinit(struct platform_device *pdev);
+
+/**
+ * nvdla_load_account_task() account execution time of a completed task
+ *
+ * @nvdla_dev		Pointer to DLA device
+ * @exec_us		task execution time reported by the firmware
+ */
+void nvdla_load_account_task(struct nvdla_device *nvdla_dev, u32 exec_us);
+
+/**
+ * nvdla_load_notify_submit() let clock scaling react to a task submit
+ *
+ * @nvdla_dev		Pointer to DLA device
+ */
+void nvdla_load_notify_submit(struct nvdla_device *nvdla_dev);
+
+/**
+ * nvdla_load_show() print the sampled load
+ *
+ * @nvdla_dev		Pointer to DLA device
+ * @s			seq_file to print to
+ */
+void nvdla_load_show(struct nvdla_device *nvdla_dev, struct seq_file *s);
+
 int nvdla_emulator_submit(struct nvdla_queue *queue,
 				struct nvdla_emu_task *task);
 void task_free(struct kref *ref);
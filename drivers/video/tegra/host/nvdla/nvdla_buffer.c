@@ -12,8 +12,13 @@
 #include <linux/slab.h>
 #include <linux/dma-buf.h>
 
+#include <trace/events/tegra_frame.h>
+
 #include "nvdla_buffer.h"
 
+/* unpinned buffers whose mapping is kept for a later pin */
+#define NVDLA_BUFFER_IDLE_CACHE_MAX	32U
+
 /**
  * nvdla_vm_buffer - Virtual mapping information for a buffer
  *
@@ -28,7 +33,8 @@
  * @offset		offset
  * @access_flags	access (rw/ro)
  * @rb_node:		pinned buffer node
- * @list_head:		List entry
+ * @list_head:		Entry in the buffer list, or in the idle list once
+ *			the buffer is neither pinned nor used by a task
  *
  */
 struct nvdla_vm_buffer {
@@ -99,25 +105,39 @@ static void nvdla_buffer_insert_map_buffer(
 
 	/* Add the node into a list  */
 	list_add_tail(&new_vm->list_head, &nvdla_buffers->list_head);
+	nvdla_buffers->num_pinned++;
+}
+
+static struct nvdla_vm_buffer *nvdla_buffer_take_idle(
+				struct nvdla_buffers *nvdla_buffers,
+				struct dma_buf *dmabuf, u32 access_flags)
+{
+	struct nvdla_vm_buffer *vm;
+
+	list_for_each_entry(vm, &nvdla_buffers->idle_list, list_head) {
+		if ((vm->dmabuf == dmabuf) &&
+		    (vm->access_flags == access_flags)) {
+			list_del(&vm->list_head);
+			nvdla_buffers->num_idle--;
+			return vm;
+		}
+	}
+
+	return NULL;
 }
 
+/* consumes the dmabuf reference, also on failure */
 static int nvdla_buffer_map(struct platform_device *pdev,
 				struct nvdla_mem_share_handle *desc,
+				struct dma_buf *dmabuf,
 				struct nvdla_vm_buffer *vm)
 {
 	struct dma_buf_attachment *attach;
-	struct dma_buf *dmabuf;
 	struct sg_table *sgt;
 	dma_addr_t dma_addr;
 	dma_addr_t phys_addr;
 	int err = 0;
 
-	dmabuf = dma_buf_get((__s32)desc->import_id);
-	if (IS_ERR_OR_NULL(dmabuf)) {
-		err = -EFAULT;
-		goto fail_to_get_dma_buf;
-	}
-
 	attach = dma_buf_attach(dmabuf, &pdev->dev);
 	if (IS_ERR_OR_NULL(attach)) {
 		err = PTR_ERR(dmabuf);
@@ -169,38 +189,70 @@ buf_map_err:
 	dma_buf_detach(dmabuf, attach);
 buf_attach_err:
 	dma_buf_put(dmabuf);
-fail_to_get_dma_buf:
 	return err;
 }
 
+static void nvdla_buffer_destroy(struct nvdla_vm_buffer *vm)
+{
+	if (vm->access_flags == NVDLA_MEM_ACCESS_READ)
+		dma_buf_unmap_attachment(vm->attach, vm->sgt, DMA_TO_DEVICE);
+	else
+		dma_buf_unmap_attachment(vm->attach, vm->sgt, DMA_BIDIRECTIONAL);
+
+	dma_buf_detach(vm->dmabuf, vm->attach);
+	dma_buf_put(vm->dmabuf);
+
+	list_del(&vm->list_head);
+
+	kfree(vm);
+}
+
+static void nvdla_buffer_flush_idle(struct nvdla_buffers *nvdla_buffers)
+{
+	struct nvdla_vm_buffer *vm, *n;
+
+	list_for_each_entry_safe(vm, n, &nvdla_buffers->idle_list, list_head)
+		nvdla_buffer_destroy(vm);
+	nvdla_buffers->num_idle = 0;
+}
+
 static void nvdla_free_buffers(struct kref *kref)
 {
 	struct nvdla_buffers *nvdla_buffers =
 		container_of(kref, struct nvdla_buffers, kref);
 
+	/* buffers released by tasks after nvdla_buffer_release() */
+	nvdla_buffer_flush_idle(nvdla_buffers);
+
 	kfree(nvdla_buffers);
 }
 
 static void nvdla_buffer_unmap(struct nvdla_buffers *nvdla_buffers,
 				struct nvdla_vm_buffer *vm)
 {
+	struct nvdla_vm_buffer *oldest;
+
 	pr_debug("%s\n", __func__);
 
 	if ((vm->user_map_count != 0) || (vm->submit_map_count != 0))
 		return;
 
-	if (vm->access_flags == NVDLA_MEM_ACCESS_READ)
-		dma_buf_unmap_attachment(vm->attach, vm->sgt, DMA_TO_DEVICE);
-	else
-		dma_buf_unmap_attachment(vm->attach, vm->sgt, DMA_BIDIRECTIONAL);
-
-	dma_buf_detach(vm->dmabuf, vm->attach);
-	dma_buf_put(vm->dmabuf);
-
+	/*
+	 * The handle is gone, but keep the mapping so that pinning the same
+	 * dma-buf again does not attach and map it again.
+	 */
 	rb_erase(&vm->rb_node, &nvdla_buffers->rb_root);
-	list_del(&vm->list_head);
-
-	kfree(vm);
+	nvdla_buffers->num_pinned--;
+	list_move_tail(&vm->list_head, &nvdla_buffers->idle_list);
+	nvdla_buffers->num_idle++;
+
+	if (nvdla_buffers->num_idle > NVDLA_BUFFER_IDLE_CACHE_MAX) {
+		oldest = list_first_entry(&nvdla_buffers->idle_list,
+					  struct nvdla_vm_buffer, list_head);
+		nvdla_buffer_destroy(oldest);
+		nvdla_buffers->num_idle--;
+		nvdla_buffers->evictions++;
+	}
 }
 
 struct nvdla_buffers *nvdla_buffer_init(struct platform_device *pdev)
@@ -218,6 +270,7 @@ struct nvdla_buffers *nvdla_buffer_init(struct platform_device *pdev)
 	mutex_init(&nvdla_buffers->mutex);
 	nvdla_buffers->rb_root = RB_ROOT;
 	INIT_LIST_HEAD(&nvdla_buffers->list_head);
+	INIT_LIST_HEAD(&nvdla_buffers->idle_list);
 	kref_init(&nvdla_buffers->kref);
 
 	return nvdla_buffers;
@@ -283,6 +336,7 @@ int nvdla_buffer_pin(struct nvdla_buffers *nvdla_buffers,
 			u32 count)
 {
 	struct nvdla_vm_buffer *vm;
+	struct dma_buf *dmabuf;
 	int i = 0;
 	int err = 0;
 
@@ -295,17 +349,40 @@ int nvdla_buffer_pin(struct nvdla_buffers *nvdla_buffers,
 			continue;
 		}
 
+		dmabuf = dma_buf_get((__s32)descs[i].import_id);
+		if (IS_ERR_OR_NULL(dmabuf)) {
+			err = -EFAULT;
+			goto unpin;
+		}
+
+		vm = nvdla_buffer_take_idle(nvdla_buffers, dmabuf,
+					    descs[i].access_flags);
+		if (vm) {
+			/* the cached mapping holds its own reference */
+			dma_buf_put(dmabuf);
+			vm->handle = descs[i].share_id;
+			vm->offset = descs[i].offset;
+			vm->user_map_count = 1;
+			nvdla_buffer_insert_map_buffer(nvdla_buffers, vm);
+			nvdla_buffers->hits++;
+			continue;
+		}
+
 		vm = kzalloc(sizeof(struct nvdla_vm_buffer), GFP_KERNEL);
 		if (!vm) {
 			pr_err("%s: could not allocate vm_buffer\n", __func__);
+			dma_buf_put(dmabuf);
+			err = -ENOMEM;
 			goto unpin;
 		}
 
-		err = nvdla_buffer_map(nvdla_buffers->pdev, &descs[i], vm);
+		err = nvdla_buffer_map(nvdla_buffers->pdev, &descs[i],
+				       dmabuf, vm);
 		if (err)
 			goto free_vm;
 
 		nvdla_buffer_insert_map_buffer(nvdla_buffers, vm);
+		nvdla_buffers->misses++;
 	}
 	spec_bar(); /* break_spec_p#5_1 */
 
@@ -382,7 +459,42 @@ void nvdla_buffer_release(struct nvdla_buffers *nvdla_buffers)
 		vm->user_map_count = 0;
 		nvdla_buffer_unmap(nvdla_buffers, vm);
 	}
+	nvdla_buffer_flush_idle(nvdla_buffers);
 	mutex_unlock(&nvdla_buffers->mutex);
 
 	kref_put(&nvdla_buffers->kref, nvdla_free_buffers);
 }
+
+u64 nvdla_buffer_get_dmabuf_id(struct nvdla_buffers *nvdla_buffers,
+				u32 handle)
+{
+	struct nvdla_vm_buffer *vm;
+	u64 id = 0;
+
+	mutex_lock(&nvdla_buffers->mutex);
+	vm = nvdla_find_map_buffer(nvdla_buffers, handle);
+	if (vm)
+		id = tegra_frame_dmabuf_id(vm->dmabuf);
+	mutex_unlock(&nvdla_buffers->mutex);
+
+	return id;
+}
+
+void nvdla_buffer_get_cache_stats(struct nvdla_buffers *nvdla_buffers,
+				  struct nvdla_buffer_cache_stats_args *stats)
+{
+	mutex_lock(&nvdla_buffers->mutex);
+	stats->hits = nvdla_buffers->hits;
+	stats->misses = nvdla_buffers->misses;
+	stats->evictions = nvdla_buffers->evictions;
+	stats->num_pinned = nvdla_buffers->num_pinned;
+	stats->num_cached = nvdla_buffers->num_idle;
+	mutex_unlock(&nvdla_buffers->mutex);
+}
+
+void nvdla_buffer_flush_cache(struct nvdla_buffers *nvdla_buffers)
+{
+	mutex_lock(&nvdla_buffers->mutex);
+	nvdla_buffer_flush_idle(nvdla_buffers);
+	mutex_unlock(&nvdla_buffers->mutex);
+}
@@ -23,6 +23,12 @@ enum nvdla_buffers_heap {
  * list			List for traversing through all the buffers
  * mutex		Mutex for the buffer tree and the buffer list
  * kref			Reference count for the bufferlist
+ * idle_list		Mapped buffers no longer pinned, least recently used first
+ * num_idle		Number of buffers in idle_list
+ * num_pinned		Number of buffers in the tree
+ * hits			Pins that reused a mapping from idle_list
+ * misses		Pins that mapped the buffer
+ * evictions		Mappings dropped from idle_list to bound its size
  *
  */
 struct nvdla_buffers {
@@ -33,6 +39,13 @@ struct nvdla_buffers {
 	struct mutex mutex;
 
 	struct kref kref;
+
+	struct list_head idle_list;
+	u32 num_idle;
+	u32 num_pinned;
+	u64 hits;
+	u64 misses;
+	u64 evictions;
 };
 
 /**
@@ -136,6 +149,37 @@ int nvdla_buffer_submit_pin(struct nvdla_buffers *nvdla_buffers,
 void nvdla_buffer_submit_unpin(struct nvdla_buffers *nvdla_buffers,
 					u32 *handles, u32 count);
 
+/**
+ * @brief		Look up the trace id of a mapped buffer
+ *
+ * @param nvdla_buffers		Pointer to nvdla_buffer struct
+ * @param handle		MemHandle of the buffer
+ * @return			dmabuf inode number, 0 if not mapped
+ *
+ */
+u64 nvdla_buffer_get_dmabuf_id(struct nvdla_buffers *nvdla_buffers,
+				u32 handle);
+
+/**
+ * @brief			Read the mapping cache counters
+ *
+ * @param nvdla_buffers		Pointer to nvdla_buffer struct
+ * @param stats			Counters to fill
+ * @return			None
+ *
+ */
+void nvdla_buffer_get_cache_stats(struct nvdla_buffers *nvdla_buffers,
+				  struct nvdla_buffer_cache_stats_args *stats);
+
+/**
+ * @brief			Unmap the cached mappings of unpinned buffers
+ *
+ * @param nvdla_buffers		Pointer to nvdla_buffer struct
+ * @return			None
+ *
+ */
+void nvdla_buffer_flush_cache(struct nvdla_buffers *nvdla_buffers);
+
 /**
  * @brief			Drop a user reference to buffer structure
  *
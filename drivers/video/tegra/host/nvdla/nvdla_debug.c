@@ -7,12 +7,14 @@
 
 #include <linux/platform_device.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/nvhost.h>
 #include <linux/uaccess.h>
 #include <linux/delay.h>
 #include <linux/version.h>
 
 #include "dla_os_interface.h"
+#include "dla_queue.h"
 #include "nvdla.h"
 #include "nvdla_debug.h"
 
@@ -277,29 +279,6 @@ static int debug_dla_fw_gcov_gcda_show(struct seq_file *s, void *data)
 	return 0;
 }
 
-static int nvdla_get_stats(struct nvdla_device *nvdla_dev)
-{
-	int err = 0;
-	struct nvdla_cmd_data cmd_data;
-	struct platform_device *pdev;
-
-	/* prepare command data */
-	cmd_data.method_id = DLA_CMD_GET_STATISTICS;
-	cmd_data.method_data = ALIGNED_DMA(nvdla_dev->utilization_mem_pa);
-	cmd_data.wait = true;
-
-	pdev = nvdla_dev->pdev;
-	if (pdev == NULL)
-		return -EFAULT;
-
-	/* pass set debug command to falcon */
-	err = nvdla_send_cmd(pdev, &cmd_data);
-	if (err != 0)
-		nvdla_dbg_err(pdev, "failed to send get stats command");
-
-	return err;
-}
-
 static int debug_dla_fw_resource_util_show(struct seq_file *s, void *data)
 {
 	int err = 0;
@@ -1169,6 +1148,51 @@ fail_create_file_err_inj:
 }
 #endif /* CONFIG_TEGRA_HSIERRRPTINJ */
 
+static int debug_dla_load_show(struct seq_file *s, void *data)
+{
+	struct nvdla_device *nvdla_dev = (struct nvdla_device *)s->private;
+
+	nvdla_load_show(nvdla_dev, s);
+
+	return 0;
+}
+
+static int debug_dla_load_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, debug_dla_load_show, inode->i_private);
+}
+
+static const struct file_operations debug_dla_load_fops = {
+	.open		= debug_dla_load_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int debug_dla_task_pool_show(struct seq_file *s, void *data)
+{
+	struct nvdla_device *nvdla_dev = (struct nvdla_device *)s->private;
+
+	if (nvdla_dev->pool == NULL)
+		return -ENODEV;
+
+	nvdla_queue_pool_dump_task_pools(nvdla_dev->pool, s);
+
+	return 0;
+}
+
+static int debug_dla_task_pool_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, debug_dla_task_pool_show, inode->i_private);
+}
+
+static const struct file_operations debug_dla_task_pool_fops = {
+	.open		= debug_dla_task_pool_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void nvdla_debug_init(struct platform_device *pdev)
 {
 	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
@@ -1199,5 +1223,10 @@ void nvdla_debug_init(struct platform_device *pdev)
 	nvdla_pm_debugfs_init(pdev);
 #endif
 
+	debugfs_create_file("task_pool", S_IRUGO, de,
+			nvdla_dev, &debug_dla_task_pool_fops);
+	debugfs_create_file("load", S_IRUGO, de,
+			nvdla_dev, &debug_dla_load_fops);
+
 	dla_fw_debugfs_init(pdev);
 }
@@ -242,6 +242,29 @@ fail_to_get_val_arg:
 	return err;
 }
 
+static int nvdla_get_buffer_cache_stats(struct nvdla_private *priv, void *arg)
+{
+	struct nvdla_buffer_cache_stats_args *stats =
+			(struct nvdla_buffer_cache_stats_args *)arg;
+
+	if (!nvdla_buffer_is_valid(priv->buffers))
+		return -EINVAL;
+
+	nvdla_buffer_get_cache_stats(priv->buffers, stats);
+
+	return 0;
+}
+
+static int nvdla_flush_buffer_cache(struct nvdla_private *priv)
+{
+	if (!nvdla_buffer_is_valid(priv->buffers))
+		return -EINVAL;
+
+	nvdla_buffer_flush_cache(priv->buffers);
+
+	return 0;
+}
+
 static int nvdla_ping(struct platform_device *pdev,
 			   struct nvdla_ping_args *args)
 {
@@ -1035,6 +1058,8 @@ static int nvdla_submit(struct nvdla_private *priv, void *arg)
 	struct nvdla_task *task = NULL; // task under submission
 	int err = 0, i = 0;
 	bool bypass_exec;
+	bool ordered;
+	u32 batch_fence = 0;
 
 	if (!args || !priv)
 		return -EINVAL;
@@ -1061,6 +1086,10 @@ static int nvdla_submit(struct nvdla_private *priv, void *arg)
 	bypass_exec = ((args->flags & NVDLA_SUBMIT_FLAGS_BYPASS_EXEC) != 0U);
 	nvdla_dbg_info(pdev, "submit flags [%u]", args->flags);
 
+	ordered = ((args->flags & NVDLA_SUBMIT_FLAGS_ORDERED) != 0U);
+	if (ordered)
+		batch_fence = nvhost_syncpt_read_maxval(pdev, queue->syncpt_id);
+
 	for (i = 0; i < num_tasks; i++) {
 		/* IOCTL copy descriptor */
 		if (copy_from_user(&local_task, (void __user *)&user_tasks[i],
@@ -1089,6 +1118,9 @@ static int nvdla_submit(struct nvdla_private *priv, void *arg)
 		}
 		nvdla_dbg_info(pdev, "local task[%d] filled", i + 1);
 
+		task->ordered = ordered;
+		task->batch_fence = batch_fence;
+
 		/* dump task input parameters */
 		nvdla_dump_task(task);
 		nvdla_dbg_info(pdev, "dump task[%d] done", i + 1);
@@ -1225,6 +1257,12 @@ static long nvdla_ioctl(struct file *file, unsigned int cmd,
 	case NVDLA_IOCTL_RELEASE_QUEUE:
 		err = nvdla_queue_release_handler(priv, (void*)buf);
 		break;
+	case NVDLA_IOCTL_GET_BUFFER_CACHE_STATS:
+		err = nvdla_get_buffer_cache_stats(priv, (void *)buf);
+		break;
+	case NVDLA_IOCTL_FLUSH_BUFFER_CACHE:
+		err = nvdla_flush_buffer_cache(priv);
+		break;
 	default:
 		nvdla_dbg_err(pdev, "invalid IOCTL CMD");
 		err = -ENOIOCTLCMD;
@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2024, NVIDIA Corporation.  All rights reserved.
+ *
+ * NVDLA load sampling and clock scaling
+ */
+
+#include <linux/clk.h>
+#include <linux/devfreq.h>
+#include <linux/devfreq/nvhost_podgov.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/nvhost.h>
+#include <linux/platform_device.h>
+#include <linux/pm_opp.h>
+#include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
+
+#include "dla_os_interface.h"
+#include "nvdla.h"
+#include "nvdla_debug.h"
+
+/* firmware utilization of a fully busy DLA, percent scaled by 10000 */
+#define NVDLA_UTILIZATION_FULL		1000000U
+
+/* utilization samples per devfreq evaluation */
+#define NVDLA_DEVFREQ_SAMPLES		4U
+
+#define NVDLA_DEVFREQ_GOVERNOR		DEVFREQ_GOV_NVHOST_PODGOV
+
+static unsigned int load_sample_ms = 50;
+module_param(load_sample_ms, uint, 0444);
+MODULE_PARM_DESC(load_sample_ms,
+	"DLA utilization sampling period in ms, 0 disables sampling and clock scaling");
+
+int nvdla_get_stats(struct nvdla_device *nvdla_dev)
+{
+	int err = 0;
+	struct nvdla_cmd_data cmd_data;
+	struct platform_device *pdev;
+
+	/* prepare command data */
+	cmd_data.method_id = DLA_CMD_GET_STATISTICS;
+	cmd_data.method_data = ALIGNED_DMA(nvdla_dev->utilization_mem_pa);
+	cmd_data.wait = true;
+
+	pdev = nvdla_dev->pdev;
+	if (pdev == NULL)
+		return -EFAULT;
+
+	/* pass set debug command to falcon */
+	err = nvdla_send_cmd(pdev, &cmd_data);
+	if (err != 0)
+		nvdla_dbg_err(pdev, "failed to send get stats command");
+
+	return err;
+}
+
+static void nvdla_load_sample(struct nvdla_device *nvdla_dev)
+{
+	struct platform_device *pdev = nvdla_dev->pdev;
+	struct nvdla_load *load = &nvdla_dev->load;
+	u32 utilization = 0;
+	ktime_t now;
+	u64 dt;
+
+	/* a powered off DLA is idle, do not power it on to ask */
+	if (pm_runtime_get_if_in_use(&pdev->dev) > 0) {
+		if (nvdla_get_stats(nvdla_dev) == 0)
+			utilization = min(READ_ONCE(*nvdla_dev->utilization_mem_va),
+					  NVDLA_UTILIZATION_FULL);
+		nvhost_module_idle(pdev);
+	}
+
+	now = ktime_get();
+
+	spin_lock_irq(&load->lock);
+	dt = ktime_to_ns(ktime_sub(now, load->last_sample));
+	load->last_sample = now;
+	load->utilization = utilization;
+	load->busy_ns += mul_u64_u32_div(dt, utilization,
+					 NVDLA_UTILIZATION_FULL);
+	load->total_ns += dt;
+	spin_unlock_irq(&load->lock);
+}
+
+static void nvdla_load_work(struct work_struct *work)
+{
+	struct nvdla_load *load = container_of(to_delayed_work(work),
+					       struct nvdla_load, work);
+	struct nvdla_device *nvdla_dev = container_of(load,
+					struct nvdla_device, load);
+
+	nvdla_load_sample(nvdla_dev);
+
+	queue_delayed_work(system_power_efficient_wq, &load->work,
+			   msecs_to_jiffies(load_sample_ms));
+}
+
+void nvdla_load_account_task(struct nvdla_device *nvdla_dev, u32 exec_us)
+{
+	struct nvdla_load *load = &nvdla_dev->load;
+	unsigned long flags;
+
+	spin_lock_irqsave(&load->lock, flags);
+	load->tasks++;
+	load->task_exec_us += exec_us;
+	if (exec_us > load->task_exec_max_us)
+		load->task_exec_max_us = exec_us;
+	spin_unlock_irqrestore(&load->lock, flags);
+}
+
+void nvdla_load_notify_submit(struct nvdla_device *nvdla_dev)
+{
+	if (nvdla_dev->load.devfreq)
+		nvhost_podgov_notify_submit(nvdla_dev->load.devfreq);
+}
+
+void nvdla_load_show(struct nvdla_device *nvdla_dev, struct seq_file *s)
+{
+	struct nvdla_load *load = &nvdla_dev->load;
+	u64 busy_ns, total_ns, tasks, task_exec_us;
+	u32 utilization, task_exec_max_us;
+
+	spin_lock_irq(&load->lock);
+	utilization = load->utilization;
+	busy_ns = load->busy_ns;
+	total_ns = load->total_ns;
+	tasks = load->tasks;
+	task_exec_us = load->task_exec_us;
+	task_exec_max_us = load->task_exec_max_us;
+	spin_unlock_irq(&load->lock);
+
+	seq_printf(s, "utilization: %u.%04u\n",
+		   utilization / 10000, utilization % 10000);
+	seq_printf(s, "busy_ns: %llu\n", busy_ns);
+	seq_printf(s, "total_ns: %llu\n", total_ns);
+	seq_printf(s, "tasks: %llu\n", tasks);
+	seq_printf(s, "task_exec_avg_us: %llu\n",
+		   tasks ? div64_u64(task_exec_us, tasks) : 0);
+	seq_printf(s, "task_exec_max_us: %u\n", task_exec_max_us);
+}
+
+/* load of the last sample in per mille, as the nvhost load attribute */
+static ssize_t load_show(struct device *dev,
+			 struct device_attribute *attr, char *buf)
+{
+	struct nvhost_device_data *pdata = dev_get_drvdata(dev);
+	struct nvdla_device *nvdla_dev = pdata->private_data;
+	u32 utilization;
+
+	spin_lock_irq(&nvdla_dev->load.lock);
+	utilization = nvdla_dev->load.utilization;
+	spin_unlock_irq(&nvdla_dev->load.lock);
+
+	return sysfs_emit(buf, "%u\n", utilization / 1000);
+}
+static DEVICE_ATTR_RO(load);
+
+static int nvdla_devfreq_target(struct device *dev, unsigned long *freq,
+				u32 flags)
+{
+	struct nvhost_device_data *pdata = dev_get_drvdata(dev);
+	struct clk *clk = pdata->clks[0].clk;
+	int err;
+
+	err = clk_set_rate(clk, *freq);
+	if (err < 0) {
+		dev_err(dev, "failed to set clock rate\n");
+		return err;
+	}
+
+	*freq = clk_get_rate(clk);
+
+	return 0;
+}
+
+static int nvdla_devfreq_get_dev_status(struct device *dev,
+					struct devfreq_dev_status *stat)
+{
+	struct nvhost_device_data *pdata = dev_get_drvdata(dev);
+	struct nvdla_device *nvdla_dev = pdata->private_data;
+	struct nvdla_load *load = &nvdla_dev->load;
+
+	spin_lock_irq(&load->lock);
+	stat->busy_time = div_u64(load->busy_ns - load->df_busy_ns,
+				  NSEC_PER_USEC);
+	stat->total_time = div_u64(load->total_ns - load->df_total_ns,
+				   NSEC_PER_USEC);
+	load->df_busy_ns = load->busy_ns;
+	load->df_total_ns = load->total_ns;
+	spin_unlock_irq(&load->lock);
+
+	stat->current_frequency = clk_get_rate(pdata->clks[0].clk);
+
+	return 0;
+}
+
+static int nvdla_devfreq_get_cur_freq(struct device *dev, unsigned long *freq)
+{
+	struct nvhost_device_data *pdata = dev_get_drvdata(dev);
+
+	*freq = clk_get_rate(pdata->clks[0].clk);
+
+	return 0;
+}
+
+static int nvdla_devfreq_init(struct platform_device *pdev)
+{
+	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
+	struct nvdla_device *nvdla_dev = pdata->private_data;
+	struct devfreq_dev_profile *profile;
+	struct devfreq *devfreq;
+	unsigned long max_rate, min_rate, margin, rate;
+	struct clk *clk;
+
+	if (!IS_ENABLED(CONFIG_PM_DEVFREQ) || pdata->num_clks == 0)
+		return 0;
+
+	clk = pdata->clks[0].clk;
+	max_rate = clk_round_rate(clk, ULONG_MAX);
+	min_rate = clk_round_rate(clk, 0);
+	margin = clk_round_rate(clk, min_rate + 1) - min_rate;
+	if (margin == 0)
+		margin = max_rate - min_rate;
+
+	for (rate = min_rate; rate <= max_rate; rate += margin) {
+		dev_pm_opp_add(&pdev->dev, rate, 0);
+		if (margin == 0)
+			break;
+	}
+
+	profile = devm_kzalloc(&pdev->dev, sizeof(*profile), GFP_KERNEL);
+	if (!profile)
+		return -ENOMEM;
+
+	profile->target = nvdla_devfreq_target;
+	profile->get_dev_status = nvdla_devfreq_get_dev_status;
+	profile->get_cur_freq = nvdla_devfreq_get_cur_freq;
+	profile->initial_freq = max_rate;
+	profile->polling_ms = load_sample_ms * NVDLA_DEVFREQ_SAMPLES;
+
+	devfreq = devm_devfreq_add_device(&pdev->dev, profile,
+					  NVDLA_DEVFREQ_GOVERNOR, NULL);
+	if (IS_ERR(devfreq)) {
+		/* keep running at the maximum rate */
+		dev_info(&pdev->dev, "no DLA clock scaling: %ld\n",
+			 PTR_ERR(devfreq));
+		dev_pm_opp_remove_all_dynamic(&pdev->dev);
+		devm_kfree(&pdev->dev, profile);
+		return 0;
+	}
+
+	nvdla_dev->load.devfreq = devfreq;
+
+	return 0;
+}
+
+int nvdla_load_init(struct platform_device *pdev)
+{
+	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
+	struct nvdla_device *nvdla_dev = pdata->private_data;
+	struct nvdla_load *load = &nvdla_dev->load;
+	int err;
+
+	spin_lock_init(&load->lock);
+	INIT_DEFERRABLE_WORK(&load->work, nvdla_load_work);
+	load->last_sample = ktime_get();
+
+	err = device_create_file(&pdev->dev, &dev_attr_load);
+	if (err)
+		return err;
+
+	if (load_sample_ms == 0)
+		return 0;
+
+	err = nvdla_devfreq_init(pdev);
+	if (err)
+		goto err_devfreq_init;
+
+	queue_delayed_work(system_power_efficient_wq, &load->work,
+			   msecs_to_jiffies(load_sample_ms));
+
+	return 0;
+
+err_devfreq_init:
+	device_remove_file(&pdev->dev, &dev_attr_load);
+	return err;
+}
+
+void nvdla_load_deinit(struct platform_device *pdev)
+{
+	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
+	struct nvdla_device *nvdla_dev = pdata->private_data;
+	struct nvdla_load *load = &nvdla_dev->load;
+
+	if (load->devfreq) {
+		devm_devfreq_remove_device(&pdev->dev, load->devfreq);
+		dev_pm_opp_remove_all_dynamic(&pdev->dev);
+		load->devfreq = NULL;
+	}
+
+	cancel_delayed_work_sync(&load->work);
+	device_remove_file(&pdev->dev, &dev_attr_load);
+}
@@ -22,6 +22,8 @@
 #include "nvdla_debug.h"
 #include "dla_os_interface.h"
 
+#include <trace/events/tegra_frame.h>
+
 #define CREATE_TRACE_POINTS
 #include <trace/events/nvdla_ftrace.h>
 
@@ -86,16 +88,14 @@ int nvdla_get_task_mem(struct nvdla_queue *queue,
 	struct nvdla_task *task = NULL;
 	struct nvdla_queue_task_mem_info task_mem_info;
 	struct platform_device *pdev = queue->pool->pdev;
-	int n_retries = (NVDLA_TASK_MEM_AVAIL_TIMEOUT_MS /
-					NVDLA_TASK_MEM_AVAIL_RETRY_PERIOD);
 
 	nvdla_dbg_fn(pdev, "");
 
-	/* get mem task descriptor and task mem from task_mem_pool */
-	do {
-		n_retries = n_retries - 1;
-		err = nvdla_queue_alloc_task_memory(queue, &task_mem_info);
-	} while ((n_retries > 0) && (err == -EAGAIN));
+	/*
+	 * get mem task descriptor and task mem from task_mem_pool, this
+	 * waits up to NVDLA_TASK_MEM_AVAIL_TIMEOUT_MS for a free slot
+	 */
+	err = nvdla_queue_alloc_task_memory(queue, &task_mem_info);
 
 	task = task_mem_info.kmem_addr;
 	if ((err < 0) || !task)
@@ -321,6 +321,29 @@ static inline size_t nvdla_profile_status_offset(struct nvdla_task *task)
 }
 
 
+static void nvdla_trace_frame_submit(struct nvdla_task *task, u32 task_id)
+{
+	struct nvdla_queue *queue = task->queue;
+	u64 ts = tegra_frame_ts_ns();
+	u64 buf_id;
+	int i;
+
+	for (i = 0; i < task->num_addresses; i++) {
+		if (task->memory_handles[i].type == NVDLA_BUFFER_TYPE_INTERNAL ||
+		    !task->memory_handles[i].handle)
+			continue;
+
+		buf_id = nvdla_buffer_get_dmabuf_id(task->buffers,
+					task->memory_handles[i].handle);
+		if (buf_id == 0)
+			continue;
+
+		trace_tegra_frame_submit(TEGRA_FRAME_ENGINE_DLA,
+				task->task_desc->queue_id, buf_id, task_id,
+				queue->syncpt_id, task->fence, ts);
+	}
+}
+
 #if IS_ENABLED(CONFIG_TEGRA_GRHOST)
 /*
  * This function definition can be removed once support
@@ -335,6 +358,8 @@ static void nvdla_queue_update(void *priv)
 	struct nvdla_task *task, *safe;
 	struct nvdla_queue *queue = priv;
 	struct platform_device *pdev = queue->pool->pdev;
+	struct nvhost_device_data *pdata = platform_get_drvdata(pdev);
+	struct nvdla_device *nvdla_dev = pdata->private_data;
 	struct nvhost_notification *tsp_notifier;
 	u64 timestamp_start, timestamp_end;
 	u64 *timestamp_ptr;
@@ -365,9 +390,20 @@ static void nvdla_queue_update(void *priv)
 			timestamp_end = *timestamp_ptr >> 5;
 			timestamp_start = (*timestamp_ptr -
 					(tsp_notifier->info32 * 1000)) >> 5;
+			nvdla_load_account_task(nvdla_dev,
+						tsp_notifier->info32);
 
 		if (IS_ENABLED(CONFIG_TRACING)) {
 			trace_job_timestamps(task_id, timestamp_start, timestamp_end);
+			trace_tegra_frame_start(TEGRA_FRAME_ENGINE_DLA,
+					task->task_desc->queue_id, 0, task_id,
+					queue->syncpt_id, task->fence,
+					*timestamp_ptr -
+					(tsp_notifier->info32 * 1000));
+			trace_tegra_frame_done(TEGRA_FRAME_ENGINE_DLA,
+					task->task_desc->queue_id, 0, task_id,
+					queue->syncpt_id, task->fence,
+					*timestamp_ptr);
 
 			/* Record task postfences */
 			for (i = 0; i < task->num_postfences; i++) {
@@ -928,6 +964,27 @@ fail:
 	return err;
 }
 
+/*
+ * Within an ordered submit, a wait on the queue syncpoint for a value that an
+ * earlier task of the submit signals is met by the queue order alone.
+ */
+static bool nvdla_prefence_in_batch(struct nvdla_task *task,
+				    struct nvdev_fence *fence)
+{
+	struct nvdla_queue *queue = task->queue;
+	struct platform_device *pdev = queue->pool->pdev;
+	u32 max;
+
+	if (!task->ordered || fence->type != NVDEV_FENCE_TYPE_SYNCPT ||
+	    fence->syncpoint_index != queue->syncpt_id)
+		return false;
+
+	max = nvhost_syncpt_read_maxval(pdev, queue->syncpt_id);
+
+	return ((s32)(fence->syncpoint_value - task->batch_fence) > 0) &&
+		((s32)(fence->syncpoint_value - max) <= 0);
+}
+
 static int nvdla_fill_preactions(struct nvdla_task *task)
 {
 	int err = 0;
@@ -952,6 +1009,12 @@ static int nvdla_fill_preactions(struct nvdla_task *task)
 		if (task->prefences[i].action != NVDEV_FENCE_WAIT)
 			continue;
 
+		if (nvdla_prefence_in_batch(task, &task->prefences[i])) {
+			nvdla_dbg_info(pdev, "prefence[%u] met by queue order",
+				       i);
+			continue;
+		}
+
 		/* update action */
 		err = nvdla_fill_wait_fence_action(task,
 				&task->prefences[i],
@@ -1342,6 +1405,8 @@ static int nvdla_queue_submit_op(struct nvdla_queue *queue, void *in_task)
 	if (nvhost_module_busy(pdev))
 		goto fail_to_poweron;
 
+	nvdla_load_notify_submit(nvdla_dev);
+
 	/* prepare command for channel submit */
 	if (nvdla_dev->submit_mode == NVDLA_SUBMIT_MODE_CHANNEL) {
 
@@ -1389,6 +1454,9 @@ static int nvdla_queue_submit_op(struct nvdla_queue *queue, void *in_task)
 				trace_job_prefence(task_id, task->prefences[i].syncpoint_index,
 						task->prefences[i].syncpoint_value);
 			}
+
+			if (trace_tegra_frame_submit_enabled())
+				nvdla_trace_frame_submit(task, task_id);
 		}
 	}
 
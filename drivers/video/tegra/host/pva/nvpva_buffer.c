@@ -349,6 +349,8 @@ struct nvpva_buffers
 	kref_init(&nvpva_buffers->kref);
 	memset(nvpva_buffers->ids, 0, sizeof(nvpva_buffers->ids));
 	nvpva_buffers->num_assigned_ids = 0;
+	INIT_LIST_HEAD(&nvpva_buffers->caches);
+	mutex_init(&nvpva_buffers->cache_lock);
 
 	return nvpva_buffers;
 
@@ -552,11 +554,143 @@ nvpva_buffer_unpin(struct nvpva_buffers *nvpva_buffers,
 	mutex_unlock(&nvpva_buffers->mutex);
 }
 
+static void nvpva_buffer_cache_release(struct kref *kref)
+{
+	struct nvpva_buffer_cache_entry *entry =
+		container_of(kref, struct nvpva_buffer_cache_entry, kref);
+
+	nvpva_buffer_submit_unpin_id(entry->buffers, &entry->id, 1);
+	kfree(entry);
+}
+
+struct nvpva_buffer_cache
+*nvpva_buffer_cache_alloc(struct nvpva_buffers *nvpva_buffers)
+{
+	struct nvpva_buffer_cache *cache;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_init(&cache->lock);
+	hash_init(cache->entries);
+	cache->buffers = nvpva_buffers;
+	kref_get(&nvpva_buffers->kref);
+
+	mutex_lock(&nvpva_buffers->cache_lock);
+	list_add_tail(&cache->list, &nvpva_buffers->caches);
+	mutex_unlock(&nvpva_buffers->cache_lock);
+
+	return cache;
+}
+
+void nvpva_buffer_cache_free(struct nvpva_buffer_cache *cache)
+{
+	struct nvpva_buffers *nvpva_buffers = cache->buffers;
+	struct nvpva_buffer_cache_entry *entry;
+	struct hlist_node *tmp;
+	int bkt;
+
+	mutex_lock(&nvpva_buffers->cache_lock);
+	list_del(&cache->list);
+	mutex_unlock(&nvpva_buffers->cache_lock);
+
+	mutex_lock(&cache->lock);
+	hash_for_each_safe(cache->entries, bkt, tmp, entry, node) {
+		hash_del(&entry->node);
+		kref_put(&entry->kref, nvpva_buffer_cache_release);
+	}
+	mutex_unlock(&cache->lock);
+
+	mutex_destroy(&cache->lock);
+	kfree(cache);
+
+	kref_put(&nvpva_buffers->kref, nvpva_free_buffers);
+}
+
+int nvpva_buffer_cache_get(struct nvpva_buffer_cache *cache, u32 id,
+			   struct nvpva_buffer_cache_entry **entry)
+{
+	struct nvpva_buffer_cache_entry *e;
+	int err = 0;
+
+	mutex_lock(&cache->lock);
+
+	hash_for_each_possible(cache->entries, e, node, id) {
+		if (e->id == id) {
+			kref_get(&e->kref);
+			goto out;
+		}
+	}
+
+	e = kzalloc(sizeof(*e), GFP_KERNEL);
+	if (!e) {
+		err = -ENOMEM;
+		goto unlock;
+	}
+
+	e->id = id;
+	e->buffers = cache->buffers;
+	err = nvpva_buffer_submit_pin_id(cache->buffers, &e->id, 1,
+					 &e->dmabuf, &e->addr, &e->size,
+					 &e->serial_id, &e->heap);
+	if (err) {
+		kfree(e);
+		goto unlock;
+	}
+
+	/* one reference for the cache, one for the caller */
+	kref_init(&e->kref);
+	kref_get(&e->kref);
+	hash_add(cache->entries, &e->node, id);
+out:
+	*entry = e;
+unlock:
+	mutex_unlock(&cache->lock);
+
+	return err;
+}
+
+void nvpva_buffer_cache_put(struct nvpva_buffer_cache_entry *entry)
+{
+	kref_put(&entry->kref, nvpva_buffer_cache_release);
+}
+
+/* Drop the cached submit pins of a buffer that is being unpinned */
+static void nvpva_buffer_cache_evict(struct nvpva_buffers *nvpva_buffers,
+				     u32 id)
+{
+	struct nvpva_buffer_cache *cache;
+	struct nvpva_buffer_cache_entry *entry;
+
+	mutex_lock(&nvpva_buffers->cache_lock);
+	list_for_each_entry(cache, &nvpva_buffers->caches, list) {
+		mutex_lock(&cache->lock);
+		hash_for_each_possible(cache->entries, entry, node, id) {
+			if (entry->id == id) {
+				hash_del(&entry->node);
+				kref_put(&entry->kref,
+					 nvpva_buffer_cache_release);
+				break;
+			}
+		}
+		mutex_unlock(&cache->lock);
+	}
+	mutex_unlock(&nvpva_buffers->cache_lock);
+}
+
 void nvpva_buffer_unpin_id(struct nvpva_buffers *nvpva_buffers,
 			 u32 *ids, u32 count)
 {
 	int i = 0;
 
+	/*
+	 * Evict first: a cached submit pin would keep the buffer mapped
+	 * after userspace unpinned it.
+	 */
+	for (i = 0; i < count; i++)
+		nvpva_buffer_cache_evict(nvpva_buffers, ids[i]);
+
 	mutex_lock(&nvpva_buffers->mutex);
 
 	for (i = 0; i < count; i++) {
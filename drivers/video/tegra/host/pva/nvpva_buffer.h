@@ -9,6 +9,9 @@
 #define __NVPVA_NVPVA_BUFFER_H__
 
 #include <linux/dma-buf.h>
+#include <linux/hashtable.h>
+#include <linux/kref.h>
+#include <linux/mutex.h>
 #include "pva_bit_helpers.h"
 
 enum nvpva_buffers_heap {
@@ -24,6 +27,9 @@ enum nvpva_buffers_heap {
  * mutex		Mutex for the buffer tree and the buffer list
  * kref			Reference count for the bufferlist
  * ids			unique ID assigned to a pinned buffer
+ * caches		Submit pin caches of the queues using these buffers
+ * cache_lock		Mutex for the caches list, taken before the mutex
+ *			of a cache and before the buffer mutex
  */
 #define NVPVA_ID_SEGMENT_SIZE		32
 #define NVPVA_MAX_NUM_UNIQUE_IDS	(NVPVA_ID_SEGMENT_SIZE * 1024)
@@ -40,6 +46,51 @@ struct nvpva_buffers {
 	struct kref kref;
 	uint32_t ids[NVPVA_NUM_ID_SEGMENTS];
 	uint32_t num_assigned_ids;
+	struct list_head caches;
+	struct mutex cache_lock;
+};
+
+#define NVPVA_BUFFER_CACHE_HASH_BITS	6
+
+/**
+ * @brief		Submit pin of a buffer held in a pin cache
+ *
+ * kref			References from the cache and from pinning tasks
+ * node			Hash table entry in the cache, unhashed on eviction
+ * buffers		Buffer list the submit pin was taken on
+ * id			Buffer ID
+ * dmabuf, addr, size,
+ * serial_id, heap	Mapping returned by nvpva_buffer_submit_pin_id()
+ */
+struct nvpva_buffer_cache_entry {
+	struct kref kref;
+	struct hlist_node node;
+	struct nvpva_buffers *buffers;
+	u32 id;
+	struct dma_buf *dmabuf;
+	dma_addr_t addr;
+	u64 size;
+	u64 serial_id;
+	enum nvpva_buffers_heap heap;
+};
+
+/**
+ * @brief		Cache of buffer submit pins shared by the tasks of a queue
+ *
+ * Tasks of a queue tend to use the same buffers, so the submit pin of a
+ * buffer is kept across tasks instead of being taken and dropped by each
+ * one. Entries are evicted when their buffer is unpinned by userspace.
+ *
+ * buffers		Buffer list the entries are pinned on
+ * list			Entry in the caches list of @buffers
+ * lock			Mutex for the hash table, taken before the buffer mutex
+ * entries		Cached submit pins, hashed by buffer ID
+ */
+struct nvpva_buffer_cache {
+	struct nvpva_buffers *buffers;
+	struct list_head list;
+	struct mutex lock;
+	DECLARE_HASHTABLE(entries, NVPVA_BUFFER_CACHE_HASH_BITS);
 };
 
 /**
@@ -212,4 +263,51 @@ void nvpva_buffer_release(struct nvpva_buffers *nvpva_buffers);
 int nvpva_get_iova_addr(struct nvpva_buffers *nvpva_buffers,
 			struct dma_buf *dmabuf, dma_addr_t *addr);
 
+/**
+ * @brief			Allocate a submit pin cache
+ *
+ * @param nvpva_buffers		Pointer to nvpva_buffer struct
+ * @return			nvpva_buffer_cache pointer on success
+ *				or negative on error
+ *
+ */
+struct nvpva_buffer_cache
+*nvpva_buffer_cache_alloc(struct nvpva_buffers *nvpva_buffers);
+
+/**
+ * @brief			Free a submit pin cache
+ *
+ * Drops the cache references to its entries; entries still in use by
+ * tasks are released when the tasks unpin them.
+ *
+ * @param cache			Pointer to nvpva_buffer_cache struct
+ * @return			None
+ *
+ */
+void nvpva_buffer_cache_free(struct nvpva_buffer_cache *cache);
+
+/**
+ * @brief			Get the submit pin of a buffer from a cache
+ *
+ * Pins the buffer for task submission on the first use and returns the
+ * cached pin afterwards.
+ *
+ * @param cache			Pointer to nvpva_buffer_cache struct
+ * @param id			Buffer ID
+ * @param entry			Pointer to return the referenced entry
+ * @return			0 on success or negative on error
+ *
+ */
+int nvpva_buffer_cache_get(struct nvpva_buffer_cache *cache, u32 id,
+			   struct nvpva_buffer_cache_entry **entry);
+
+/**
+ * @brief			Drop a reference to a cached submit pin
+ *
+ * @param entry			Pointer to nvpva_buffer_cache_entry struct
+ * @return			None
+ *
+ */
+void nvpva_buffer_cache_put(struct nvpva_buffer_cache_entry *entry);
+
 #endif /*__NVPVA_NVPVA_BUFFER_H__ */
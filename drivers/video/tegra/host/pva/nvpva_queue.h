@@ -15,6 +15,8 @@
 #define NUM_POOL_ALLOC_SUB_TABLES	4
 
 struct nvpva_queue_task_pool;
+struct nvpva_buffer_cache;
+struct pva_dma_config_cache;
 /** @brief Holds PVA HW task which can be submitted to PVA R5 FW */
 struct pva_hw_task;
 
@@ -54,6 +56,8 @@ struct nvpva_queue_task_mem_info {
  * task_kmem_size	kernel memory size for a task
  * aux_dma_size		kernel memory size for a task aux buffer
  * attr			queue attribute associated with the host module
+ * pin_cache		buffer submit pins shared by the tasks of the queue
+ * dma_config_cache	DMA configurations already validated on this queue
  *
  */
 struct nvpva_queue {
@@ -92,6 +96,9 @@ struct nvpva_queue {
 	struct pva_hw_task *hw_task_tail;
 
 	u64 batch_id;
+
+	struct nvpva_buffer_cache *pin_cache;
+	struct pva_dma_config_cache *dma_config_cache;
 };
 
 /**
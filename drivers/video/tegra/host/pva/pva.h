@@ -31,6 +31,7 @@ enum {
 };
 
 struct nvpva_client_context;
+struct pva_task_profile;
 
 enum pva_submit_mode {
 	PVA_SUBMIT_MODE_MAILBOX = 0,
@@ -365,8 +366,9 @@ struct nvpva_syncpts_desc {
  * profiling_level
  * driver_log_mask	controls the level of detail printed by kernel
  *			debug statements
+ * task_profile_enabled	account task statistics in @task_profile
+ * task_profile		per queue and per VPU task timing, see pva_profile.c
  */
-
 struct pva {
 	u32 version;
 	struct pva_version_config *version_config;
@@ -428,6 +430,8 @@ struct pva {
 	bool is_hv_mode;
 	struct pva_vpu_util_info vpu_util_info;
 	u32 profiling_level;
+	bool task_profile_enabled;
+	struct pva_task_profile *task_profile;
 
 	struct work_struct pva_abort_handler_work;
 #ifdef CONFIG_PVA_INTERRUPT_DISABLED
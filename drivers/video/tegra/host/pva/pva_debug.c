@@ -20,6 +20,7 @@
 #include <uapi/linux/nvpva_ioctl.h>
 
 #include "pva.h"
+#include "pva_profile.h"
 #include "pva_vpu_ocd.h"
 #include "pva-fw-address-map.h"
 
@@ -405,6 +406,8 @@ void pva_debugfs_deinit(struct pva *pva)
 		mutex_destroy(&pva->fw_debug_log.saved_log_lock);
 		kfree(pva->fw_debug_log.saved_log);
 	}
+
+	pva_profile_deinit(pva);
 }
 
 void pva_debugfs_init(struct platform_device *pdev)
@@ -450,6 +453,11 @@ void pva_debugfs_init(struct platform_device *pdev)
 	debugfs_create_bool("stats_enabled", 0644, de, &pva->stats_enabled);
 	debugfs_create_file("vpu_stats", 0644, de, pva, &pva_stats_fops);
 
+	err = pva_profile_init(pva, de);
+	if (err)
+		dev_err(&pva->pdev->dev,
+			"err = %d. failed to allocate task profile\n", err);
+
 	mutex_init(&pva->fw_debug_log.saved_log_lock);
 	pva->fw_debug_log.size = FW_DEBUG_LOG_BUFFER_SIZE;
 	pva->fw_debug_log.saved_log =
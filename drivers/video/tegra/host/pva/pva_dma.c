@@ -2,7 +2,12 @@
 // SPDX-FileCopyrightText: Copyright (c) 2021-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
 
 #include <linux/kernel.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
 #include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <linux/nospec.h>
 #include "pva_dma.h"
 #include "pva_queue.h"
@@ -28,6 +33,47 @@
 #define LOW_BITS		(0xFFFFFFFFU >> (32U - 4U))
 #define NVPVA_MAX_VALID_BLK_HGT_LG2 5U
 
+/* Validated DMA configurations kept per queue */
+#define PVA_DMA_CONFIG_CACHE_SIZE	8U
+
+/**
+ * @brief	DMA configuration that passed validation
+ *
+ * Tasks running the same VPU program usually submit the same descriptors,
+ * channels and HW sequencer blob with different DRAM buffers. The
+ * descriptor and HW sequencer checks only depend on this configuration,
+ * so they are skipped for a task whose configuration matches one that
+ * already passed them. Descriptors are stored with their DRAM buffer
+ * handles cleared. The sequencer bounds checks also depend on the buffer
+ * sizes, so they are skipped only while those sizes match @buff_info.
+ */
+struct pva_dma_config {
+	struct list_head list;
+	struct kref kref;
+	u32 hwgen;
+	u32 hwseq_trig_mode;
+	u32 hwseq_size;
+	u8 num_descriptors;
+	u8 num_channels;
+	struct nvpva_dma_descriptor descriptors[MAX_NUM_DESCS];
+	struct nvpva_dma_channel channels[MAX_NUM_CHANNELS];
+	u8 hwseq[PVA_HWSEQ_RAM_SIZE_T26X];
+	struct pva_dma_task_buffer_info_s buff_info[MAX_NUM_DESCS];
+};
+
+/**
+ * @brief	Per queue cache of validated DMA configurations
+ *
+ * lock		Mutex for the list and the buffer sizes of its entries
+ * lru		Configurations, most recently used first
+ * num_configs	Number of configurations in @lru
+ */
+struct pva_dma_config_cache {
+	struct mutex lock;
+	struct list_head lru;
+	u32 num_configs;
+};
+
 static const u8 max_desc_id[4] = {
 	[0] = 0U, // dummy entry to simplify lookup
 	[PVA_HW_GEN1] = NVPVA_TASK_MAX_DMA_DESCRIPTORS_T19X,
@@ -860,9 +906,10 @@ static int32_t nvpva_task_dma_desc_mapping(struct pva_submit_task *task,
 		dim3_check_relaxed = is_hwseq_mode_frm(task, desc_num)
 					|| is_hwseq_mode_t26x(task, desc_num);
 
-		err = validate_descriptor(umd_dma_desc,
-					  task->hwseq_config.hwseqTrigMode,
-					  dim3_check_relaxed);
+		if (!task->dma_config_validated)
+			err = validate_descriptor(umd_dma_desc,
+						  task->hwseq_config.hwseqTrigMode,
+						  dim3_check_relaxed);
 		if (err) {
 			task_err(
 			    task,
@@ -1058,6 +1105,9 @@ verify_dma_desc_hwseq(struct pva_submit_task *task,
 		goto out;
 
 	set_hwseq_mode_frm(task, did);
+	if (task->dma_config_validated)
+		goto out;
+
 	if ((desc->px != 0U)
 	 || (desc->py != 0U)
 	 || (desc->descReloadEnable != 0U)) {
@@ -2169,6 +2219,177 @@ out:
 	return err;
 }
 
+struct pva_dma_config_cache *pva_dma_config_cache_alloc(void)
+{
+	struct pva_dma_config_cache *cache;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (cache == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_init(&cache->lock);
+	INIT_LIST_HEAD(&cache->lru);
+
+	return cache;
+}
+
+static void pva_dma_config_release(struct kref *kref)
+{
+	struct pva_dma_config *config =
+		container_of(kref, struct pva_dma_config, kref);
+
+	kvfree(config);
+}
+
+void pva_dma_config_cache_free(struct pva_dma_config_cache *cache)
+{
+	struct pva_dma_config *config, *n;
+
+	list_for_each_entry_safe(config, n, &cache->lru, list) {
+		list_del(&config->list);
+		kref_put(&config->kref, pva_dma_config_release);
+	}
+
+	mutex_destroy(&cache->lock);
+	kfree(cache);
+}
+
+/* Copy a descriptor, dropping the DRAM buffer handles */
+static void pva_dma_config_copy_desc(struct nvpva_dma_descriptor *dst,
+				     const struct nvpva_dma_descriptor *src)
+{
+	/* memcpy keeps the padding, so that copies compare equal */
+	memcpy(dst, src, sizeof(*dst));
+
+	if (dst->srcTransferMode == (uint8_t)DMA_DESC_SRC_XFER_MC)
+		dst->srcPtr = 0U;
+
+	if (dst->dstTransferMode == (uint8_t)DMA_DESC_DST_XFER_MC)
+		dst->dstPtr = 0U;
+}
+
+static bool pva_dma_config_match(const struct pva_dma_config *config,
+				 const struct pva_submit_task *task,
+				 const u8 *hwseq, u32 hwseq_size)
+{
+	struct nvpva_dma_descriptor desc;
+	u32 i;
+
+	if ((config->hwgen != task->pva->version)
+	 || (config->hwseq_trig_mode != task->hwseq_config.hwseqTrigMode)
+	 || (config->num_descriptors != task->num_dma_descriptors)
+	 || (config->num_channels != task->num_dma_channels)
+	 || (config->hwseq_size != hwseq_size))
+		return false;
+
+	if (memcmp(config->channels, task->dma_channels,
+		   task->num_dma_channels * sizeof(config->channels[0])) != 0)
+		return false;
+
+	if ((hwseq_size != 0U) && (memcmp(config->hwseq, hwseq, hwseq_size) != 0))
+		return false;
+
+	for (i = 0; i < task->num_dma_descriptors; i++) {
+		pva_dma_config_copy_desc(&desc, &task->dma_descriptors[i]);
+		if (memcmp(&desc, &config->descriptors[i], sizeof(desc)) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+static struct pva_dma_config *
+pva_dma_config_get(struct pva_submit_task *task, const u8 *hwseq, u32 hwseq_size)
+{
+	struct pva_dma_config_cache *cache = task->queue->dma_config_cache;
+	struct pva_dma_config *config;
+
+	if (cache == NULL)
+		return NULL;
+
+	mutex_lock(&cache->lock);
+	list_for_each_entry(config, &cache->lru, list) {
+		if (pva_dma_config_match(config, task, hwseq, hwseq_size)) {
+			list_move(&config->list, &cache->lru);
+			kref_get(&config->kref);
+			mutex_unlock(&cache->lock);
+			return config;
+		}
+	}
+	mutex_unlock(&cache->lock);
+
+	return NULL;
+}
+
+/* Remember the configuration of a task that passed all DMA checks */
+static void pva_dma_config_add(struct pva_submit_task *task, const u8 *hwseq,
+			       u32 hwseq_size)
+{
+	struct pva_dma_config_cache *cache = task->queue->dma_config_cache;
+	struct pva_dma_config *config, *old;
+	u32 i;
+
+	if (cache == NULL)
+		return;
+
+	/* the cache is best effort, a failed allocation only costs a miss */
+	config = kvzalloc(sizeof(*config), GFP_KERNEL);
+	if (config == NULL)
+		return;
+
+	kref_init(&config->kref);
+	config->hwgen = task->pva->version;
+	config->hwseq_trig_mode = task->hwseq_config.hwseqTrigMode;
+	config->hwseq_size = hwseq_size;
+	config->num_descriptors = task->num_dma_descriptors;
+	config->num_channels = task->num_dma_channels;
+	memcpy(config->channels, task->dma_channels,
+	       task->num_dma_channels * sizeof(config->channels[0]));
+	if (hwseq_size != 0U)
+		memcpy(config->hwseq, hwseq, hwseq_size);
+	for (i = 0; i < task->num_dma_descriptors; i++)
+		pva_dma_config_copy_desc(&config->descriptors[i],
+					 &task->dma_descriptors[i]);
+	memcpy(config->buff_info, task->task_buff_info,
+	       sizeof(config->buff_info));
+
+	mutex_lock(&cache->lock);
+	list_add(&config->list, &cache->lru);
+	if (++cache->num_configs > PVA_DMA_CONFIG_CACHE_SIZE) {
+		old = list_last_entry(&cache->lru, struct pva_dma_config, list);
+		list_del(&old->list);
+		cache->num_configs--;
+		kref_put(&old->kref, pva_dma_config_release);
+	}
+	mutex_unlock(&cache->lock);
+}
+
+/* Returns true if the config passed the bounds checks with these sizes */
+static bool pva_dma_config_bounds_valid(struct pva_submit_task *task,
+					struct pva_dma_config *config)
+{
+	struct pva_dma_config_cache *cache = task->queue->dma_config_cache;
+	bool valid;
+
+	mutex_lock(&cache->lock);
+	valid = (memcmp(config->buff_info, task->task_buff_info,
+			sizeof(config->buff_info)) == 0);
+	mutex_unlock(&cache->lock);
+
+	return valid;
+}
+
+static void pva_dma_config_set_bounds(struct pva_submit_task *task,
+				      struct pva_dma_config *config)
+{
+	struct pva_dma_config_cache *cache = task->queue->dma_config_cache;
+
+	mutex_lock(&cache->lock);
+	memcpy(config->buff_info, task->task_buff_info,
+	       sizeof(config->buff_info));
+	mutex_unlock(&cache->lock);
+}
+
 int pva_task_write_dma_info(struct pva_submit_task *task,
 			    struct pva_hw_task *hw_task)
 {
@@ -2189,6 +2410,9 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 	u32 hwseq_ram_size = (hwgen == PVA_HW_GEN2)
 				? PVA_HWSEQ_RAM_SIZE_T23X
 				: PVA_HWSEQ_RAM_SIZE_T26X;
+	struct pva_dma_config *config = NULL;
+	u32 hwseq_size = 0U;
+	bool bounds_checked = false;
 
 	nvpva_dbg_fn(task->pva, "");
 
@@ -2197,6 +2421,7 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 	memset(task->desc_processed, 0, sizeof(task->desc_processed));
 	task->num_dma_desc_processed = 0;
 	task->special_access = 0;
+	task->dma_config_validated = false;
 	hw_task_dma_info = &hw_task->dma_info_and_params_list.dma_info;
 
 	if (task->num_dma_descriptors == 0L || task->num_dma_channels == 0L) {
@@ -2244,8 +2469,12 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 			task->hwseq_config.hwseqBuf.offset;
 		hw_task_dma_info->num_hwseq =
 			task->hwseq_config.hwseqBuf.size;
+		hwseq_size = task->hwseq_config.hwseqBuf.size;
 	}
 
+	config = pva_dma_config_get(task, hwseqbuf_cpuva, hwseq_size);
+	task->dma_config_validated = (config != NULL);
+
 	/* write dma channel info */
 	hw_task_dma_info->num_channels = task->num_dma_channels;
 	hw_task_dma_info->num_descriptors = task->num_dma_descriptors;
@@ -2337,7 +2566,8 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 		goto out;
 	}
 
-	if (task->pva->version <= PVA_HW_GEN2) {
+	if ((task->pva->version <= PVA_HW_GEN2)
+	 && ((config == NULL) || !pva_dma_config_bounds_valid(task, config))) {
 		for (i = 0; i < task->num_dma_channels; i++) {
 			err = 0;
 			if (task->hwseq_info[i].verify_bounds)
@@ -2349,8 +2579,14 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 				goto out;
 			}
 		}
+		bounds_checked = true;
 	}
 
+	if (config == NULL)
+		pva_dma_config_add(task, hwseqbuf_cpuva, hwseq_size);
+	else if (bounds_checked)
+		pva_dma_config_set_bounds(task, config);
+
 	hw_task->task.dma_info =
 		task->dma_addr + offsetof(struct pva_hw_task, dma_info_and_params_list)
 		+ offsetof(struct pva_dma_info_and_params_list_s, dma_info);
@@ -2360,6 +2596,9 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 	hw_task_dma_info->dma_info_version = PVA_DMA_INFO_VERSION_ID;
 	hw_task_dma_info->dma_info_size = sizeof(struct pva_dma_info_s);
 out:
+	if (config != NULL)
+		kref_put(&config->kref, pva_dma_config_release);
+
 	if (hwseqbuf_cpuva != NULL)
 		pva_dmabuf_vunmap(mem->dmabuf, hwseqbuf_cpuva);
 
@@ -77,9 +77,15 @@ enum pva_dma_chan_sig {
 	PVA_HWSEQ_VPUWRITE_START = 0x10000
 };
 
+struct pva_dma_config_cache;
+
 int pva_task_write_dma_info(struct pva_submit_task *task,
 			    struct pva_hw_task *hw_task);
 
 int pva_task_write_dma_misr_info(struct pva_submit_task *task,
 			    struct pva_hw_task *hw_task);
+
+struct pva_dma_config_cache *pva_dma_config_cache_alloc(void);
+
+void pva_dma_config_cache_free(struct pva_dma_config_cache *cache);
 #endif
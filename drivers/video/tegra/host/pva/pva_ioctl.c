@@ -24,6 +24,7 @@
 
 #include "pva.h"
 #include "pva_queue.h"
+#include "pva_dma.h"
 #include "nvpva_buffer.h"
 #include "pva_vpu_exe.h"
 #include "pva_vpu_app_auth.h"
@@ -567,8 +568,7 @@ static int pva_unpin(struct pva_private *priv, void *arg)
 static int
 pva_authenticate_vpu_app(struct pva *pva,
 			 struct pva_vpu_auth_s *auth,
-			 uint8_t *data,
-			 u32 size,
+			 struct pva_vpu_app_digest *digest,
 			 bool is_sys)
 {
 	int err = 0;
@@ -596,8 +596,7 @@ pva_authenticate_vpu_app(struct pva *pva,
 	mutex_unlock(&auth->allow_list_lock);
 	err = pva_vpu_check_sha256_key(pva,
 				       auth->vpu_hash_keys,
-				       data,
-				       size);
+				       digest);
 	if (err != 0)
 		nvpva_dbg_fn(pva, "app authentication failed");
 out:
@@ -615,6 +614,7 @@ static int pva_register_vpu_exec(struct pva_private *priv, void *arg)
 	uint16_t		exe_id;
 	bool			is_system = false;
 	uint64_t		data_size;
+	struct pva_vpu_app_digest digest;
 	int			err = 0;
 
 	data_size = reg_in->exe_data.size;
@@ -634,16 +634,17 @@ static int pva_register_vpu_exec(struct pva_private *priv, void *arg)
 		goto free_mem;
 	}
 
+	/* both allow lists share the hashes of the ELF */
+	pva_vpu_app_digest_init(&digest, (uint8_t *)exec_data, data_size);
+
 	err = pva_authenticate_vpu_app(priv->pva,
 				       &priv->pva->pva_auth,
-				       (uint8_t *)exec_data,
-				       data_size,
+				       &digest,
 				       false);
 	if (err != 0) {
 		err = pva_authenticate_vpu_app(priv->pva,
 					       &priv->pva->pva_auth_sys,
-					       (uint8_t *)exec_data,
-					       data_size,
+					       &digest,
 					       true);
 		if (err != 0)
 			goto free_mem;
@@ -1004,6 +1005,20 @@ static int pva_open(struct inode *inode, struct file *file)
 		goto err_alloc_queue;
 	}
 
+	priv->queue->pin_cache = nvpva_buffer_cache_alloc(priv->client->buffers);
+	if (IS_ERR(priv->queue->pin_cache)) {
+		err = PTR_ERR(priv->queue->pin_cache);
+		priv->queue->pin_cache = NULL;
+		goto err_alloc_cache;
+	}
+
+	priv->queue->dma_config_cache = pva_dma_config_cache_alloc();
+	if (IS_ERR(priv->queue->dma_config_cache)) {
+		err = PTR_ERR(priv->queue->dma_config_cache);
+		priv->queue->dma_config_cache = NULL;
+		goto err_alloc_dma_config_cache;
+	}
+
 	sema_init(&priv->queue->task_pool_sem, MAX_PVA_TASK_COUNT_PER_QUEUE);
 	err = nvhost_module_busy(pva->pdev);
 	if (err < 0) {
@@ -1015,6 +1030,12 @@ static int pva_open(struct inode *inode, struct file *file)
 	return nonseekable_open(inode, file);
 
 err_device_busy:
+	pva_dma_config_cache_free(priv->queue->dma_config_cache);
+	priv->queue->dma_config_cache = NULL;
+err_alloc_dma_config_cache:
+	nvpva_buffer_cache_free(priv->queue->pin_cache);
+	priv->queue->pin_cache = NULL;
+err_alloc_cache:
 	nvpva_queue_put(priv->queue);
 err_alloc_queue:
 	nvpva_client_context_put(priv->client);
@@ -1089,6 +1110,13 @@ static int pva_release(struct inode *inode, struct file *file)
 
 	nvhost_module_idle(priv->pva->pdev);
 
+	/* Tasks still running hold their own references to cached pins */
+	nvpva_buffer_cache_free(priv->queue->pin_cache);
+	priv->queue->pin_cache = NULL;
+
+	pva_dma_config_cache_free(priv->queue->dma_config_cache);
+	priv->queue->dma_config_cache = NULL;
+
 	/* Release reference to client */
 	nvpva_client_context_put(priv->client);
 
@@ -0,0 +1,372 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+/*
+ * PVA task profiling
+ *
+ * Splits the firmware statistics of each completed task into the time spent
+ * waiting in its queue, processing its inputs, getting a VPU set up, running
+ * on the VPU and completing. The phases are accumulated per queue as log2
+ * histograms and per VPU as busy time, both in debugfs, and every task is
+ * appended to a ring userspace can mmap, see uapi/linux/nvpva_profile.h.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#include <uapi/linux/nvpva_profile.h>
+#include <trace/events/nvpva_ftrace.h>
+
+#include "pva.h"
+#include "pva_queue.h"
+#include "pva_profile.h"
+
+/* The TSC the firmware timestamps tasks with runs at 31.25 MHz */
+#define PVA_PROFILE_TSC_TICK_NS		32ULL
+
+/* log2 buckets of the task phase times in us, the last one is open ended */
+#define PVA_PROFILE_HIST_BUCKETS	24U
+
+static unsigned int task_profile_ring_records = 4096U;
+module_param(task_profile_ring_records, uint, 0444);
+MODULE_PARM_DESC(task_profile_ring_records,
+		 "Number of tasks kept in the task profile ring, rounded up to a power of 2");
+
+enum pva_profile_phase {
+	PVA_PROFILE_WAIT,
+	PVA_PROFILE_INPUT,
+	PVA_PROFILE_SETUP,
+	PVA_PROFILE_VPU,
+	PVA_PROFILE_OUTPUT,
+	PVA_PROFILE_R5_OVERHEAD,
+	PVA_PROFILE_TOTAL,
+	PVA_PROFILE_NUM_PHASES,
+};
+
+static const char * const pva_profile_phase_names[PVA_PROFILE_NUM_PHASES] = {
+	[PVA_PROFILE_WAIT] = "wait",
+	[PVA_PROFILE_INPUT] = "input",
+	[PVA_PROFILE_SETUP] = "setup",
+	[PVA_PROFILE_VPU] = "vpu",
+	[PVA_PROFILE_OUTPUT] = "output",
+	[PVA_PROFILE_R5_OVERHEAD] = "r5_overhead",
+	[PVA_PROFILE_TOTAL] = "total",
+};
+
+struct pva_profile_hist {
+	u64 count;
+	u64 sum_ns;
+	u64 max_ns;
+	u64 buckets[PVA_PROFILE_HIST_BUCKETS];
+};
+
+/**
+ * struct pva_task_profile - task profile of a PVA device
+ * @lock: protects the histograms, the VPU counters and the ring
+ * @window_start_ns: boot time of the last reset
+ * @queues: phase histograms per queue
+ * @vpu_busy_ns: VPU execution time per VPU since the last reset
+ * @vpu_tasks: tasks executed per VPU since the last reset
+ * @ring: start of the ring mapping
+ * @records: records of the ring
+ * @ring_size: size of the ring mapping
+ * @ring_mask: number of records in the ring - 1
+ */
+struct pva_task_profile {
+	spinlock_t lock;
+	u64 window_start_ns;
+	struct pva_profile_hist queues[MAX_PVA_QUEUE_COUNT]
+				      [PVA_PROFILE_NUM_PHASES];
+	u64 vpu_busy_ns[NUM_VPU_BLOCKS];
+	u64 vpu_tasks[NUM_VPU_BLOCKS];
+
+	struct nvpva_profile_ring_header *ring;
+	struct nvpva_profile_record *records;
+	size_t ring_size;
+	u32 ring_mask;
+};
+
+static inline u64 pva_profile_delta_ns(u64 start, u64 end)
+{
+	/* a stage the firmware skipped leaves its timestamp behind */
+	if (end <= start)
+		return 0;
+
+	return (end - start) * PVA_PROFILE_TSC_TICK_NS;
+}
+
+static void pva_profile_hist_add(struct pva_profile_hist *hist, u64 ns)
+{
+	u64 us = ns / NSEC_PER_USEC;
+	unsigned int bucket = (us == 0) ? 0U : (unsigned int)fls64(us);
+
+	bucket = min(bucket, PVA_PROFILE_HIST_BUCKETS - 1U);
+
+	hist->count++;
+	hist->sum_ns += ns;
+	hist->max_ns = max(hist->max_ns, ns);
+	hist->buckets[bucket]++;
+}
+
+void pva_profile_task(struct pva *pva, struct pva_submit_task *task,
+		      const struct pva_task_statistics_s *stats)
+{
+	struct pva_task_profile *profile = pva->task_profile;
+	struct pva_profile_hist *hists;
+	struct nvpva_profile_record rec;
+	u64 phase_ns[PVA_PROFILE_NUM_PHASES];
+	u32 queue_id = task->queue->id;
+	u32 vpu = stats->vpu_assigned & 0x1U;
+	unsigned int i;
+	u64 head;
+
+	if ((profile == NULL) || (queue_id >= MAX_PVA_QUEUE_COUNT))
+		return;
+
+	phase_ns[PVA_PROFILE_WAIT] =
+		pva_profile_delta_ns(stats->queued_time, stats->head_time);
+	phase_ns[PVA_PROFILE_INPUT] =
+		pva_profile_delta_ns(stats->head_time,
+				     stats->input_actions_complete);
+	phase_ns[PVA_PROFILE_SETUP] =
+		pva_profile_delta_ns(stats->input_actions_complete,
+				     stats->vpu_start_time);
+	phase_ns[PVA_PROFILE_VPU] =
+		pva_profile_delta_ns(stats->vpu_start_time,
+				     stats->vpu_complete_time);
+	phase_ns[PVA_PROFILE_OUTPUT] =
+		pva_profile_delta_ns(stats->vpu_complete_time,
+				     stats->complete_time);
+	phase_ns[PVA_PROFILE_TOTAL] =
+		pva_profile_delta_ns(stats->queued_time, stats->complete_time);
+	phase_ns[PVA_PROFILE_R5_OVERHEAD] =
+		phase_ns[PVA_PROFILE_TOTAL] -
+		min(phase_ns[PVA_PROFILE_VPU], phase_ns[PVA_PROFILE_TOTAL]);
+
+	rec.queued_ns = stats->queued_time * PVA_PROFILE_TSC_TICK_NS;
+	rec.wait_ns = phase_ns[PVA_PROFILE_WAIT];
+	rec.input_ns = phase_ns[PVA_PROFILE_INPUT];
+	rec.setup_ns = phase_ns[PVA_PROFILE_SETUP];
+	rec.vpu_ns = phase_ns[PVA_PROFILE_VPU];
+	rec.output_ns = phase_ns[PVA_PROFILE_OUTPUT];
+	rec.r5_overhead_ns = phase_ns[PVA_PROFILE_R5_OVERHEAD];
+	rec.task_id = task->id;
+	rec.queue_id = (u8)queue_id;
+	rec.vpu = (u8)vpu;
+	memset(rec.reserved, 0, sizeof(rec.reserved));
+
+	trace_nvpva_task_profile(pva->pdev->name, rec.task_id, queue_id, vpu,
+				 rec.queued_ns, rec.wait_ns, rec.input_ns,
+				 rec.setup_ns, rec.vpu_ns, rec.output_ns,
+				 rec.r5_overhead_ns);
+
+	spin_lock(&profile->lock);
+
+	hists = profile->queues[queue_id];
+	for (i = 0; i < PVA_PROFILE_NUM_PHASES; i++)
+		pva_profile_hist_add(&hists[i], phase_ns[i]);
+
+	profile->vpu_busy_ns[vpu] += phase_ns[PVA_PROFILE_VPU];
+	profile->vpu_tasks[vpu]++;
+
+	head = profile->ring->data_head;
+	profile->records[head & profile->ring_mask] = rec;
+	/* publish the record before the head that covers it */
+	smp_store_release(&profile->ring->data_head, head + 1U);
+
+	spin_unlock(&profile->lock);
+}
+
+static void pva_profile_reset(struct pva_task_profile *profile)
+{
+	spin_lock(&profile->lock);
+	memset(profile->queues, 0, sizeof(profile->queues));
+	memset(profile->vpu_busy_ns, 0, sizeof(profile->vpu_busy_ns));
+	memset(profile->vpu_tasks, 0, sizeof(profile->vpu_tasks));
+	profile->window_start_ns = ktime_get_boottime_ns();
+	spin_unlock(&profile->lock);
+}
+
+static int pva_profile_show(struct seq_file *s, void *data)
+{
+	struct pva *pva = s->private;
+	struct pva_task_profile *profile = pva->task_profile;
+	struct pva_profile_hist *hist;
+	u64 window_ns, busy_permille, max_busy_permille = 0;
+	u64 wait_ns = 0, total_ns = 0;
+	unsigned int q, p, b;
+	struct pva_task_profile *snap;
+
+	/* the histograms are too big to print under the spinlock */
+	snap = kvmalloc(sizeof(*snap), GFP_KERNEL);
+	if (snap == NULL)
+		return -ENOMEM;
+
+	spin_lock(&profile->lock);
+	memcpy(snap->queues, profile->queues, sizeof(snap->queues));
+	memcpy(snap->vpu_busy_ns, profile->vpu_busy_ns,
+	       sizeof(snap->vpu_busy_ns));
+	memcpy(snap->vpu_tasks, profile->vpu_tasks, sizeof(snap->vpu_tasks));
+	window_ns = ktime_get_boottime_ns() - profile->window_start_ns;
+	spin_unlock(&profile->lock);
+
+	seq_printf(s, "window_ns: %llu\n", window_ns);
+
+	for (b = 0; b < NUM_VPU_BLOCKS; b++) {
+		busy_permille = (window_ns == 0) ? 0 :
+			div64_u64(snap->vpu_busy_ns[b] * 1000ULL, window_ns);
+		busy_permille = min_t(u64, busy_permille, 1000ULL);
+		max_busy_permille = max(max_busy_permille, busy_permille);
+		seq_printf(s, "vpu%u: tasks %llu busy_ns %llu util %llu.%llu%%\n",
+			   b, snap->vpu_tasks[b], snap->vpu_busy_ns[b],
+			   busy_permille / 10ULL, busy_permille % 10ULL);
+	}
+
+	for (q = 0; q < MAX_PVA_QUEUE_COUNT; q++) {
+		if (snap->queues[q][PVA_PROFILE_TOTAL].count == 0)
+			continue;
+
+		wait_ns += snap->queues[q][PVA_PROFILE_WAIT].sum_ns;
+		total_ns += snap->queues[q][PVA_PROFILE_TOTAL].sum_ns;
+
+		seq_printf(s, "queue%u:\n", q);
+		for (p = 0; p < PVA_PROFILE_NUM_PHASES; p++) {
+			hist = &snap->queues[q][p];
+			seq_printf(s, "  %-11s count %llu avg_ns %llu max_ns %llu buckets_us",
+				   pva_profile_phase_names[p], hist->count,
+				   div64_u64(hist->sum_ns, hist->count),
+				   hist->max_ns);
+			for (b = 0; b < PVA_PROFILE_HIST_BUCKETS; b++)
+				seq_printf(s, " %llu", hist->buckets[b]);
+			seq_puts(s, "\n");
+		}
+	}
+
+	/*
+	 * A busy VPU means the VPUs are the limit. Idle VPUs with tasks that
+	 * mostly wait in their queue point at the dependencies between tasks;
+	 * idle VPUs otherwise mean tasks are not submitted fast enough.
+	 */
+	if (total_ns == 0)
+		seq_puts(s, "bound: idle\n");
+	else if (max_busy_permille >= 900ULL)
+		seq_puts(s, "bound: vpu\n");
+	else if (wait_ns * 2ULL > total_ns)
+		seq_puts(s, "bound: queue\n");
+	else
+		seq_puts(s, "bound: submit\n");
+
+	kvfree(snap);
+
+	return 0;
+}
+
+static int pva_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pva_profile_show, inode->i_private);
+}
+
+/* Any write restarts the profile window */
+static ssize_t pva_profile_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct pva *pva = s->private;
+
+	pva_profile_reset(pva->task_profile);
+
+	return count;
+}
+
+static const struct file_operations pva_profile_fops = {
+	.open = pva_profile_open,
+	.read = seq_read,
+	.write = pva_profile_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int pva_profile_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct pva *pva = file->private_data;
+	struct pva_task_profile *profile = pva->task_profile;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if ((vma->vm_pgoff != 0) ||
+	    (vma->vm_end - vma->vm_start > profile->ring_size))
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, profile->ring, 0);
+}
+
+static const struct file_operations pva_profile_ring_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.mmap = pva_profile_ring_mmap,
+	.llseek = noop_llseek,
+};
+
+int pva_profile_init(struct pva *pva, struct dentry *de)
+{
+	struct pva_task_profile *profile;
+	u32 num_records;
+
+	profile = kvzalloc(sizeof(*profile), GFP_KERNEL);
+	if (profile == NULL)
+		return -ENOMEM;
+
+	num_records = roundup_pow_of_two(max(task_profile_ring_records, 1U));
+	profile->ring_size = PAGE_ALIGN(PAGE_SIZE +
+			(size_t)num_records * sizeof(struct nvpva_profile_record));
+	profile->ring = vmalloc_user(profile->ring_size);
+	if (profile->ring == NULL) {
+		kvfree(profile);
+		return -ENOMEM;
+	}
+
+	profile->records = (struct nvpva_profile_record *)
+				((u8 *)profile->ring + PAGE_SIZE);
+	profile->ring_mask = num_records - 1U;
+	profile->ring->version = NVPVA_PROFILE_RING_VERSION;
+	profile->ring->record_size = sizeof(struct nvpva_profile_record);
+	profile->ring->data_offset = PAGE_SIZE;
+	profile->ring->num_records = num_records;
+
+	spin_lock_init(&profile->lock);
+	profile->window_start_ns = ktime_get_boottime_ns();
+	pva->task_profile = profile;
+
+	debugfs_create_bool("task_profile", 0644, de,
+			    &pva->task_profile_enabled);
+	debugfs_create_file("task_profile_stats", 0644, de, pva,
+			    &pva_profile_fops);
+	debugfs_create_file_size("task_profile_ring", 0444, de, pva,
+				 &pva_profile_ring_fops, profile->ring_size);
+
+	return 0;
+}
+
+void pva_profile_deinit(struct pva *pva)
+{
+	struct pva_task_profile *profile = pva->task_profile;
+
+	if (profile == NULL)
+		return;
+
+	pva->task_profile_enabled = false;
+	pva->task_profile = NULL;
+	vfree(profile->ring);
+	kvfree(profile);
+}
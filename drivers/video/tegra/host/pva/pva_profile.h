@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * PVA task profiling
+ */
+
+#ifndef _PVA_PROFILE_H_
+#define _PVA_PROFILE_H_
+
+#include <linux/types.h>
+
+struct dentry;
+struct pva;
+struct pva_submit_task;
+struct pva_task_statistics_s;
+
+/**
+ * @brief	Create the task profile debugfs files
+ *
+ * Allocates the per-queue and per-VPU histograms and the task profile
+ * ring. Profiling stays off until the task_profile debugfs file is set.
+ *
+ * @param pva	Pointer to PVA device
+ * @param de	debugfs directory of the PVA device
+ * @return	0 on success, or a negative error code
+ */
+int pva_profile_init(struct pva *pva, struct dentry *de);
+
+/**
+ * @brief	Free the task profile
+ *
+ * @param pva	Pointer to PVA device
+ */
+void pva_profile_deinit(struct pva *pva);
+
+/**
+ * @brief	Account the statistics of a completed task
+ *
+ * Called from the task completion path for tasks that were submitted with
+ * the statistics post action.
+ *
+ * @param pva	Pointer to PVA device
+ * @param task	Completed task
+ * @param stats	Statistics written by the firmware
+ */
+void pva_profile_task(struct pva *pva, struct pva_submit_task *task,
+		      const struct pva_task_statistics_s *stats);
+
+#endif
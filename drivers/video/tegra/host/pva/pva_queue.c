@@ -31,6 +31,7 @@
 
 #include <linux/seq_file.h>
 #include <uapi/linux/nvpva_ioctl.h>
+#include <trace/events/tegra_frame.h>
 #define CREATE_TRACE_POINTS
 #include <trace/events/nvpva_ftrace.h>
 
@@ -46,6 +47,7 @@
 #include "pva_vpu_exe.h"
 #include "nvpva_client.h"
 #include "nvpva_syncpt.h"
+#include "pva_profile.h"
 
 void *pva_dmabuf_vmap(struct dma_buf *dmabuf)
 {
@@ -140,41 +142,78 @@ static void pva_task_unpin_mem(struct pva_submit_task *task)
 	for (i = 0; i < task->num_pinned; i++) {
 		struct pva_pinned_memory *mem = &task->pinned_memory[i];
 
-		nvpva_buffer_submit_unpin_id(task->client->buffers,
-					    &mem->id, 1);
+		if (mem->entry != NULL)
+			nvpva_buffer_cache_put(mem->entry);
+		else
+			nvpva_buffer_submit_unpin_id(task->client->buffers,
+						    &mem->id, 1);
 	}
 
 	task->num_pinned = 0;
+	hash_init(task->pinned_hash);
+}
+
+static struct pva_pinned_memory *find_pinned_mem(struct pva_submit_task *task,
+						 int id)
+{
+	struct pva_pinned_memory *mem;
+
+	hash_for_each_possible(task->pinned_hash, mem, node, id)
+		if (mem->id == id)
+			return mem;
+	return NULL;
 }
 
 struct pva_pinned_memory *pva_task_pin_mem(struct pva_submit_task *task,
 					   u32 id)
 {
+	struct nvpva_buffer_cache *cache = task->queue->pin_cache;
+	struct nvpva_buffer_cache_entry *entry;
 	int err;
 	struct pva_pinned_memory *mem;
 
-	if (task->num_pinned >= ARRAY_SIZE(task->pinned_memory)) {
-		task_err(task, "too many objects to pin");
-		err = -ENOMEM;
-		goto err_out;
-	}
-
 	if (id == 0) {
 		task_err(task, "pin id  is 0");
 		err = -EFAULT;
 		goto err_out;
 	}
 
+	/* DMA descriptors and parameters of a task share buffers */
+	mem = find_pinned_mem(task, id);
+	if (mem != NULL)
+		return mem;
+
+	if (task->num_pinned >= ARRAY_SIZE(task->pinned_memory)) {
+		task_err(task, "too many objects to pin");
+		err = -ENOMEM;
+		goto err_out;
+	}
+
 	mem = &task->pinned_memory[task->num_pinned];
 	mem->id = id;
-	err = nvpva_buffer_submit_pin_id(task->client->buffers, &mem->id, 1,
-					 &mem->dmabuf, &mem->dma_addr,
-					 &mem->size, &mem->serial_id, &mem->heap);
+	mem->entry = NULL;
+	if (cache != NULL) {
+		err = nvpva_buffer_cache_get(cache, id, &entry);
+		if (!err) {
+			mem->entry = entry;
+			mem->dmabuf = entry->dmabuf;
+			mem->dma_addr = entry->addr;
+			mem->size = entry->size;
+			mem->serial_id = entry->serial_id;
+			mem->heap = entry->heap;
+		}
+	} else {
+		err = nvpva_buffer_submit_pin_id(task->client->buffers,
+						 &mem->id, 1, &mem->dmabuf,
+						 &mem->dma_addr, &mem->size,
+						 &mem->serial_id, &mem->heap);
+	}
 	if (err) {
 		task_err(task, "submit pin failed; Is the handle pinned?");
 		goto err_out;
 	}
 
+	hash_add(task->pinned_hash, &mem->node, id);
 	task->num_pinned += 1;
 
 	return mem;
@@ -428,17 +467,45 @@ out:
 	return err;
 }
 
+/*
+ * Returns true if the fence is a postfence of an earlier task in the same
+ * submit. Those tasks increment the queue syncpoint beyond the threshold
+ * the submit started from, up to the current threshold of the task.
+ */
+static bool pva_task_prefence_in_batch(struct pva_submit_task *task,
+				       struct nvpva_submit_fence *fence)
+{
+	u32 value = fence->obj.syncpt.value;
+
+	if ((fence->type != NVPVA_FENCE_OBJ_SYNCPT)
+	 || (fence->obj.syncpt.id != task->queue->syncpt_id))
+		return false;
+
+	return ((s32)(value - task->batch_syncpt_thresh) > 0)
+	    && ((s32)(value - task->syncpt_thresh) <= 0);
+}
+
 static int pva_task_process_prefences(struct pva_submit_task *task,
 				      struct pva_hw_task *hw_task)
 {
 	u32 i;
-	int err;
+	int err = 0;
 	struct pva_task_action_s *fw_preactions = NULL;
 	for (i = 0; i < task->num_prefences; i++) {
 		struct nvpva_submit_fence *fence = &task->prefences[i];
 		dma_addr_t fence_addr = 0;
 		u32 fence_val;
 
+		/*
+		 * Waiting for all earlier tasks of the queue covers the
+		 * fence, without the firmware polling the syncpoint
+		 */
+		if ((task->flags & NVPVA_BATCH_ORDERED)
+		 && pva_task_prefence_in_batch(task, fence)) {
+			hw_task->task.flags |= PVA_TASK_FL_SYNC_TASKS;
+			continue;
+		}
+
 		err = pva_task_pin_fence(task,
 					 fence,
 					 &fence_addr,
@@ -529,6 +596,7 @@ static int pva_task_process_output_status(struct pva_submit_task *task,
 	stats_addr = task->dma_addr + offsetof(struct pva_hw_task, statistics);
 	fw_postactions = &hw_task->postactions[hw_task->task.num_postactions];
 	if ((task->pva->stats_enabled)
+	  || (task->pva->task_profile_enabled)
 	  || (task->pva->profiling_level > 0)) {
 		pva_task_write_stats_action_op(fw_postactions,
 					       (uint8_t)TASK_ACT_PVA_STATISTICS,
@@ -943,6 +1011,49 @@ pva_trace_log_record_task_states(struct platform_device *pdev,
 	}
 }
 
+static void pva_trace_frame_submit(struct pva_submit_task *task, u64 ts)
+{
+	u32 i;
+
+	for (i = 0; i < task->num_pinned; i++) {
+		u64 buf_id = tegra_frame_dmabuf_id(task->pinned_memory[i].dmabuf);
+
+		if (buf_id == 0)
+			continue;
+
+		trace_tegra_frame_submit(TEGRA_FRAME_ENGINE_PVA,
+					 task->queue->id, buf_id, task->id,
+					 task->queue->syncpt_id,
+					 task->syncpt_thresh, ts);
+	}
+}
+
+static void pva_trace_frame_done(struct pva_submit_task *task,
+				 struct pva_hw_task *hw_task)
+{
+	struct pva_task_statistics_s *stats = &hw_task->statistics;
+
+	/* Statistics are only written back when requested at submit */
+	if (hw_task->task.flags & PVA_TASK_FL_STATS_ENABLE) {
+		trace_tegra_frame_start(TEGRA_FRAME_ENGINE_PVA,
+					task->queue->id, 0, task->id,
+					task->queue->syncpt_id,
+					task->syncpt_thresh,
+					tegra_frame_tsc_to_ns(stats->vpu_start_time));
+		trace_tegra_frame_done(TEGRA_FRAME_ENGINE_PVA,
+				       task->queue->id, 0, task->id,
+				       task->queue->syncpt_id,
+				       task->syncpt_thresh,
+				       tegra_frame_tsc_to_ns(stats->complete_time));
+	} else {
+		trace_tegra_frame_done(TEGRA_FRAME_ENGINE_PVA,
+				       task->queue->id, 0, task->id,
+				       task->queue->syncpt_id,
+				       task->syncpt_thresh,
+				       tegra_frame_ts_ns());
+	}
+}
+
 void pva_task_free(struct kref *ref)
 {
 	struct pva_submit_task *task =
@@ -1022,6 +1133,10 @@ static void update_one_task(struct pva *pva)
 		task_info.error == PVA_ERR_BAD_TASK_ACTION_LIST);
 	hw_task = (struct pva_hw_task *)task->va;
 	stats = &hw_task->statistics;
+	if (task->pva->task_profile_enabled
+	 && (hw_task->task.flags & PVA_TASK_FL_STATS_ENABLE))
+		pva_profile_task(pva, task, stats);
+
 	if (!task->pva->stats_enabled)
 		goto prof;
 
@@ -1053,6 +1168,9 @@ static void update_one_task(struct pva *pva)
 			       stats->vpu_assigned,
 			       r5_overhead);
 prof:
+	if (trace_tegra_frame_done_enabled())
+		pva_trace_frame_done(task, hw_task);
+
 	if ((task->pva->profiling_level == 0) || (!IS_ENABLED(CONFIG_TRACING)))
 		goto out;
 
@@ -1172,6 +1290,7 @@ static int pva_task_submit(const struct pva_submit_tasks *task_header)
 #else
 	timestamp = arch_counter_get_cntvct();
 #endif
+	mutex_lock(&queue->list_lock);
 	for (i = 0; i < task_header->num_tasks; i++) {
 		struct pva_submit_task *task = task_header->tasks[i];
 		struct pva_hw_task *hw_task = task->va;
@@ -1182,12 +1301,11 @@ static int pva_task_submit(const struct pva_submit_tasks *task_header)
 		nvpva_syncpt_incr_max(queue, task->fence_num);
 		task->client->curr_sema_value += task->sem_num;
 
-		mutex_lock(&queue->list_lock);
 		list_add_tail(&task->node, &queue->tasklist);
-		mutex_unlock(&queue->list_lock);
 
 		hw_task->task.queued_time = timestamp;
 	}
+	mutex_unlock(&queue->list_lock);
 
 	/*
 	 * TSC timestamp is same as CNTVCT. Task statistics are being
@@ -1217,6 +1335,12 @@ static int pva_task_submit(const struct pva_submit_tasks *task_header)
 		goto remove_tasks;
 	}
 
+	if (trace_tegra_frame_submit_enabled()) {
+		for (i = 0; i < task_header->num_tasks; i++)
+			pva_trace_frame_submit(task_header->tasks[i],
+					       tegra_frame_tsc_to_ns(timestamp));
+	}
+
 	if (first_task->pva->profiling_level == 0)
 		goto out;
 
@@ -1250,12 +1374,16 @@ out:
 	return 0;
 
 remove_tasks:
+	mutex_lock(&queue->list_lock);
 	for (i = 0; i < task_header->num_tasks; i++) {
 		struct pva_submit_task *task = task_header->tasks[i];
 
-		mutex_lock(&queue->list_lock);
 		list_del(&task->node);
-		mutex_unlock(&queue->list_lock);
+	}
+	mutex_unlock(&queue->list_lock);
+
+	for (i = 0; i < task_header->num_tasks; i++) {
+		struct pva_submit_task *task = task_header->tasks[i];
 
 		nvpva_syncpt_dec_max(queue, task->fence_num);
 		task->client->curr_sema_value -= task->sem_num;
@@ -1382,17 +1510,19 @@ static int pva_queue_submit(struct nvpva_queue *queue, void *args)
 	const struct pva_submit_tasks *task_header = args;
 	int err = 0;
 	int i;
-	uint32_t thresh, sem_thresh;
+	uint32_t thresh, batch_thresh, sem_thresh;
 	struct pva_hw_task *prev_hw_task = NULL;
 	struct nvpva_client_context *client = task_header->tasks[0]->client;
 
 	mutex_lock(&client->sema_val_lock);
 	thresh = nvpva_syncpt_read_max(queue);
+	batch_thresh = thresh;
 	sem_thresh = client->curr_sema_value;
 	for (i = 0; i < task_header->num_tasks; i++) {
 		struct pva_submit_task *task = task_header->tasks[i];
 		task->fence_num = 0;
 		task->syncpt_thresh = thresh;
+		task->batch_syncpt_thresh = batch_thresh;
 
 		task->sem_num = 0;
 		task->sem_thresh = sem_thresh;
@@ -1445,17 +1575,6 @@ unlock:
 	return err;
 }
 
-static struct pva_pinned_memory *find_pinned_mem(struct pva_submit_task *task,
-						 int id)
-{
-	u32 i;
-
-	for (i = 0; i < task->num_pinned; i++)
-		if (task->pinned_memory[i].id == id)
-			return &task->pinned_memory[i];
-	return NULL;
-}
-
 static void pva_queue_cleanup_semaphore(struct pva_submit_task *task,
 					struct nvpva_submit_fence *fence)
 {
@@ -6,6 +6,7 @@
 #ifndef PVA_QUEUE_H
 #define PVA_QUEUE_H
 
+#include <linux/hashtable.h>
 #include <uapi/linux/nvpva_ioctl.h>
 #include "nvpva_queue.h"
 #include "nvpva_buffer.h"
@@ -39,6 +40,8 @@ struct dma_buf;
 
 extern struct nvpva_queue_ops pva_queue_ops;
 
+#define PVA_TASK_PINNED_HASH_BITS	6
+
 struct pva_pinned_memory {
 	u64 size;
 	u64 serial_id;
@@ -46,6 +49,10 @@ struct pva_pinned_memory {
 	struct dma_buf *dmabuf;
 	int id;
 	enum nvpva_buffers_heap heap;
+	/* entry in the pinned_hash of the task */
+	struct hlist_node node;
+	/* queue pin cache entry, NULL if pinned directly */
+	struct nvpva_buffer_cache_entry *entry;
 };
 
 struct pva_cb {
@@ -149,7 +156,11 @@ struct pva_submit_task {
 	u64 desc_hwseq_t26x[2];
 	u64 desc_processed[2];
 	u8 num_dma_desc_processed;
+	/* DMA configuration matched one validated before on the queue */
+	bool dma_config_validated;
 	u32 syncpt_thresh;
+	/* queue syncpoint threshold before the first task of the submit */
+	u32 batch_syncpt_thresh;
 	u32 fence_num;
 	u32 local_sync_counter;
 
@@ -174,6 +185,8 @@ struct pva_submit_task {
 
 	struct pva_pinned_memory pinned_memory[256];
 	u32 num_pinned;
+	/* pinned_memory hashed by buffer ID, empty in zeroed task memory */
+	DECLARE_HASHTABLE(pinned_hash, PVA_TASK_PINNED_HASH_BITS);
 	u8 num_pva_fence_actions[NVPVA_MAX_FENCE_TYPES];
 	struct nvpva_fence_action
 		pva_fence_actions[NVPVA_MAX_FENCE_TYPES]
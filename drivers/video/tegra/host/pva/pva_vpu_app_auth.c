@@ -1,12 +1,17 @@
 // SPDX-License-Identifier: GPL-2.0-only
 // SPDX-FileCopyrightText: Copyright (c) 2021-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
 
+#include <crypto/hash.h>
+#include <linux/crc32.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/scatterlist.h>
 #include <linux/types.h>
 #include <linux/string.h>
 #include <linux/firmware.h>
 #include <linux/nvhost.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 
 #include "pva.h"
 #include "pva_bit_helpers.h"
@@ -187,54 +192,129 @@ pva_auth_allow_list_destroy(struct pva_vpu_auth_s *pva_auth)
 	pva_auth->vpu_hash_keys = NULL;
 }
 
-/**
- * \brief
- * is_key_match calculates the sha256 key of ELF and checks if it matches with key.
- * \param[in] dataptr Pointer to the data to which sha256 to ba calculated
- * \param[in] size length in bytes of the data to which sha256 to be calculated.
- * \param[in] key the key with which calculated key would be compared for match.
- * \return The completion status of the operation. Possible values are:
- * \ref 0 Success. Passed in key matched wth calculated key.
- * \ref -EACCES. Passed in Key doesn't match with calcualted key.
- */
-static int32_t
-is_key_match(uint8_t *dataptr,
-	     size_t size,
-	     struct shakey_s key)
+/* SE hash engine, used when its driver is loaded */
+#define PVA_SHA256_SE_DRIVER	"tegra-se-sha256"
+
+static void
+pva_sha256_sw(uint8_t *dataptr,
+	      size_t size,
+	      uint8_t *out)
 {
-	int32_t err = 0;
 	uint32_t calc_key[8];
 	size_t off;
-	struct sha256_ctx_s ctx1;
-	struct sha256_ctx_s ctx2;
+	struct sha256_ctx_s ctx;
 
-	sha256_init(&ctx1);
+	sha256_init(&ctx);
 	off = (size / 64U) * 64U;
 	if (off > 0U)
-		pva_sha256_update(&ctx1, dataptr, off);
-
-	/* clone */
-	sha256_copy(&ctx1, &ctx2);
+		pva_sha256_update(&ctx, dataptr, off);
 
 	/* finalize with leftover, if any */
-	sha256_finalize(&ctx2, dataptr + off, size % 64U, calc_key);
+	sha256_finalize(&ctx, dataptr + off, size % 64U, calc_key);
 
-	err = memcmp((void *)&(key.sha_key),
-		     (void *)calc_key,
-		     NVPVA_SHA256_DIGEST_SIZE);
-	if (err != 0)
-		err = -EACCES;
+	(void)memcpy(out, calc_key, NVPVA_SHA256_DIGEST_SIZE);
+}
+
+/**
+ * \brief
+ * Calculates the sha256 key of ELF with the SE hash engine.
+ * \param[in] dataptr Pointer to the data, kmalloc or vmalloc memory
+ * \param[in] size length in bytes of the data
+ * \param[out] out the calculated key
+ * \return 0 on success, or an error code when the SE can not be used.
+ */
+static int
+pva_sha256_se(uint8_t *dataptr,
+	      size_t size,
+	      uint8_t *out)
+{
+	DECLARE_CRYPTO_WAIT(wait);
+	struct crypto_ahash *tfm;
+	struct ahash_request *req;
+	struct scatterlist *sg;
+	unsigned int nents, i;
+	size_t done;
+	int err;
+
+	if ((size == 0U) || (size > UINT_MAX))
+		return -EINVAL;
+
+	tfm = crypto_alloc_ahash(PVA_SHA256_SE_DRIVER, 0, 0);
+	if (IS_ERR(tfm))
+		return PTR_ERR(tfm);
+
+	if (is_vmalloc_addr(dataptr))
+		nents = DIV_ROUND_UP(offset_in_page(dataptr) + size, PAGE_SIZE);
+	else
+		nents = 1U;
+
+	sg = kvcalloc(nents, sizeof(*sg), GFP_KERNEL);
+	if (sg == NULL) {
+		err = -ENOMEM;
+		goto free_tfm;
+	}
+
+	sg_init_table(sg, nents);
+	if (is_vmalloc_addr(dataptr)) {
+		for (i = 0U, done = 0U; i < nents; i++) {
+			uint8_t *p = dataptr + done;
+			size_t len = min_t(size_t, size - done,
+					   PAGE_SIZE - offset_in_page(p));
+
+			sg_set_page(&sg[i], vmalloc_to_page(p), len,
+				    offset_in_page(p));
+			done += len;
+		}
+	} else {
+		sg_set_buf(&sg[0], dataptr, size);
+	}
+
+	req = ahash_request_alloc(tfm, GFP_KERNEL);
+	if (req == NULL) {
+		err = -ENOMEM;
+		goto free_sg;
+	}
+
+	ahash_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG |
+				   CRYPTO_TFM_REQ_MAY_SLEEP,
+				   crypto_req_done, &wait);
+	ahash_request_set_crypt(req, sg, out, size);
+	err = crypto_wait_req(crypto_ahash_digest(req), &wait);
+
+	ahash_request_free(req);
+free_sg:
+	kvfree(sg);
+free_tfm:
+	crypto_free_ahash(tfm);
 
 	return err;
 }
 
+static void
+pva_vpu_app_digest_sha256(struct pva *pva,
+			  struct pva_vpu_app_digest *digest)
+{
+	int err;
+
+	if (digest->sha256_valid)
+		return;
+
+	err = pva_sha256_se(digest->data, digest->size, digest->sha256);
+	if (err != 0) {
+		nvpva_dbg_info(pva, "SE hash unavailable (%d), using sw sha256",
+			       err);
+		pva_sha256_sw(digest->data, digest->size, digest->sha256);
+	}
+
+	digest->sha256_valid = true;
+}
+
 /**
  * \brief
  * Keeps checking all the keys accociated with match_hash
  * against the calculated sha256 key for dataptr, until it finds a match.
- * \param[in] pva  Pointer to PVA driver context structure struct \ref nvpva_drv_ctx
- * \param[in] dataptr pointer to ELF data
- * \param[in] size length (in bytes) of ELF data
+ * \param[in] pallkeys  Pointer to the keys of the allow list
+ * \param[in] calc_key sha256 key calculated for the ELF data
  * \param[in] match_hash pointer to matching hash structure, \ref struct vpu_hash_vector_s.
  * \return Matching status of the calculated key
  * against the keys asscociated with match_hash. possible values:
@@ -244,14 +324,12 @@ is_key_match(uint8_t *dataptr,
  */
 static int
 check_all_keys_for_match(struct shakey_s *pallkeys,
-			 uint8_t *dataptr,
-			 size_t size,
+			 const uint8_t *calc_key,
 			 const struct vpu_hash_vector_s *match_hash)
 {
-	int32_t err = 0;
+	int32_t err = -EACCES;
 	uint32_t idx;
 	uint32_t count;
-	struct shakey_s key;
 	uint32_t i;
 
 	idx = match_hash->index;
@@ -262,10 +340,11 @@ check_all_keys_for_match(struct shakey_s *pallkeys,
 	}
 
 	for (i = 0; i < count; i++) {
-		key = pallkeys[idx+i];
-		err = is_key_match(dataptr, size, key);
-		if (err == 0)
+		if (memcmp(pallkeys[idx + i].sha_key, calc_key,
+			   NVPVA_SHA256_DIGEST_SIZE) == 0) {
+			err = 0;
 			break;
+		}
 	}
 fail:
 	return err;
@@ -300,34 +379,6 @@ compare_hash_value(const void *pkey,
 	return ret;
 }
 
-/**
- * @brief
- * calculates crc32.
- * @param[in] crc initial crc value. usually 0.
- * @param[in] buf pointer to the buffer whose crc32 to be calculated.
- * @param[in] len length (in bytes) of data at @ref buf.
- * @retval value of calculated crc32.
- */
-static uint32_t
-pva_crc32(uint32_t crc,
-	  unsigned char *buf,
-	  size_t len)
-{
-	int k;
-
-	crc = ~crc;
-	while (len != 0U) {
-		crc ^= *buf++;
-		for (k = 0; k < 8; k++)
-			crc = ((crc & 1U) == 1U) ?
-			(crc >> 1U) ^ 0xedb88320U : crc >> 1U;
-
-		len--;
-	}
-
-	return ~crc;
-}
-
 const void
 *binary_search(const void *key,
 	       const void *base,
@@ -371,17 +422,28 @@ const void
 	}
 }
 
+void
+pva_vpu_app_digest_init(struct pva_vpu_app_digest *digest,
+			uint8_t *dataptr,
+			size_t size)
+{
+	digest->data = dataptr;
+	digest->size = size;
+	/* same as the reflected 0xedb88320 crc of the allow list tools */
+	digest->crc32 = ~crc32_le(~0U, dataptr, size);
+	digest->sha256_valid = false;
+}
+
 int
 pva_vpu_check_sha256_key(struct pva *pva,
 			 struct vpu_hash_key_pair_s *vpu_hash_keys,
-			 uint8_t *dataptr,
-			 size_t size)
+			 struct pva_vpu_app_digest *digest)
 {
 	int err = 0;
 	struct vpu_hash_vector_s cal_Hash;
 	const struct vpu_hash_vector_s *match_Hash;
 
-	cal_Hash.crc32_hash = pva_crc32(0L, dataptr, size);
+	cal_Hash.crc32_hash = digest->crc32;
 
 	match_Hash = (const struct vpu_hash_vector_s *)
 		binary_search(&cal_Hash,
@@ -395,9 +457,9 @@ pva_vpu_check_sha256_key(struct pva *pva,
 		goto fail;
 	}
 
+	pva_vpu_app_digest_sha256(pva, digest);
 	err = check_all_keys_for_match(vpu_hash_keys->psha_key,
-				       dataptr,
-				       size,
+				       digest->sha256,
 				       match_Hash);
 	if (err != 0)
 		nvpva_dbg_info(pva, "Error: Match key not found");
@@ -67,8 +67,36 @@ struct pva_vpu_auth_s {
 	bool pva_auth_allow_list_parsed;
 };
 
+/**
+ * Digests of an ELF, computed once per registration and shared by the
+ * checks against the user and system allow lists
+ */
+struct pva_vpu_app_digest {
+	/** ELF data */
+	uint8_t *data;
+	/** ELF size in bytes */
+	size_t size;
+	/** CRC32 hash of the ELF */
+	uint32_t crc32;
+	/** Flag to track if @ref sha256 is computed */
+	bool sha256_valid;
+	/** SHA256 key of the ELF, computed on the first hash match */
+	uint8_t sha256[NVPVA_SHA256_DIGEST_SIZE];
+};
+
 struct nvpva_drv_ctx;
 
+/**
+ * \brief Computes the CRC32 hash of an ELF for allow list lookups.
+ *
+ * \param[out] digest  digest to initialize
+ * \param[in] dataptr data pointer of ELF
+ * \param[in] size  ELF size in number of bytes
+ */
+void pva_vpu_app_digest_init(struct pva_vpu_app_digest *digest,
+			     uint8_t *dataptr,
+			     size_t size);
+
 /**
  * \brief checks if the sha256 key of ELF has a match in allowlist.
  *
@@ -81,10 +109,12 @@ struct nvpva_drv_ctx;
  * and compares it with the keys asscociated with the hash in the allowlist file.
  * If there is a key match then it returns successfully. Else it returs error code.
  *
+ * The sha256 key is computed by the SE when its hash engine is available,
+ * and only once per digest.
+ *
  * \param[in] vpu_hash_keys  Pointer to PVA vpu elf sha256 authentication
  *            keys structure \ref struct vpu_hash_key_pair_s
- * \param[in] dataptr data pointer of ELF to be validate SHA
- * \param[in] size  32-bit unsigned int ELF size in  number of bytes
+ * \param[in] digest digest of ELF from \ref pva_vpu_app_digest_init
  *
  * \return  The completion status of the operation. Possible values are:
  * - 0 when there exists a match key for the elf data pointed by dataptr.
@@ -94,8 +124,7 @@ struct nvpva_drv_ctx;
  */
 int pva_vpu_check_sha256_key(struct pva *pva,
 			     struct vpu_hash_key_pair_s *vpu_hash_keys,
-			     uint8_t *dataptr,
-			     size_t size);
+			     struct pva_vpu_app_digest *digest);
 
 
 /**
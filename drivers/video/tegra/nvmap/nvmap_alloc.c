@@ -11,6 +11,9 @@
 #include <linux/random.h>
 #include <linux/version.h>
 #include <linux/io.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
+#include <linux/sched/clock.h>
+#endif
 #if KERNEL_VERSION(4, 15, 0) > LINUX_VERSION_CODE
 #include <soc/tegra/chip-id.h>
 #else
@@ -28,12 +31,14 @@
 #include <linux/libnvdimm.h>
 #endif /* NVMAP_UPSTREAM_KERNEL */
 #include "nvmap_priv.h"
+#include "nvmap_heap.h"
 
 bool nvmap_convert_carveout_to_iovmm;
 bool nvmap_convert_iovmm_to_carveout;
 
 u32 nvmap_max_handle_count;
 u64 nvmap_big_page_allocs;
+u64 nvmap_huge_page_allocs;
 u64 nvmap_total_page_allocs;
 
 /* handles may be arbitrarily large (16+MiB), and any handle allocated from
@@ -480,6 +485,7 @@ static int handle_page_alloc(struct nvmap_client *client,
 	size_t size = h->size;
 	size_t nr_page = size >> PAGE_SHIFT;
 	int i = 0, page_index = 0, allocated = 0;
+	int pp_pages = 0, got __maybe_unused;
 	struct page **pages;
 	gfp_t gfp = GFP_NVMAP | __GFP_ZERO;
 #ifdef CONFIG_ARM64_4K_PAGES
@@ -488,7 +494,11 @@ static int handle_page_alloc(struct nvmap_client *client,
 #else
 	int pages_per_big_pg = 0;
 #endif
+	int big_page_index;
 #endif /* CONFIG_ARM64_4K_PAGES */
+#ifdef NVMAP_PP_HUGE_PAGES
+	int pages_per_huge_pg = NVMAP_PP_HUGE_PAGE_SIZE >> PAGE_SHIFT;
+#endif /* NVMAP_PP_HUGE_PAGES */
 #if KERNEL_VERSION(4, 15, 0) > LINUX_VERSION_CODE
 	static u32 chipid;
 #else
@@ -511,6 +521,24 @@ static int handle_page_alloc(struct nvmap_client *client,
 	if (!pages)
 		return -ENOMEM;
 
+	/*
+	 * Lazy handles only get their (zeroed) page array here; the backing
+	 * pages are populated on first touch by nvmap_handle_populate().
+	 * Contiguous, colored and dirty tracked handles are always populated
+	 * up front.
+	 */
+	if ((h->userflags & NVMAP_HANDLE_LAZY) && !contiguous &&
+	    s_nr_colors <= 1 &&
+	    !(h->userflags & (NVMAP_HANDLE_CACHE_SYNC |
+			      NVMAP_HANDLE_CACHE_SYNC_AT_RESERVE))) {
+		h->pgalloc.pages = pages;
+		h->pgalloc.contig = false;
+		h->pgalloc.lazy = true;
+		atomic_set(&h->pgalloc.npopulated, 0);
+		atomic_set(&h->pgalloc.ndirty, 0);
+		return 0;
+	}
+
 	if (contiguous) {
 		struct page *page;
 		page = nvmap_alloc_pages_exact(gfp, size, true, h->numa_id);
@@ -519,13 +547,47 @@ static int handle_page_alloc(struct nvmap_client *client,
 
 		for (i = 0; i < nr_page; i++)
 			pages[i] = nth_page(page, i);
+#ifdef NVMAP_PP_HUGE_PAGES
+		/* Buddy allocations are naturally aligned to their order */
+		h->pgalloc.huge = nr_page >= pages_per_huge_pg;
+#endif /* NVMAP_PP_HUGE_PAGES */
 
 	} else {
+#ifdef NVMAP_PP_HUGE_PAGES
+		/* Back as much as possible with 2MB chunks, for PMD mappings */
+		page_index = nvmap_page_pool_alloc_lots_huge(&nvmap_dev->pool,
+					pages, nr_page, true, h->numa_id);
+		pp_pages = page_index;
+		for (i = page_index; (nr_page - i) >= pages_per_huge_pg;
+		     i += pages_per_huge_pg, page_index += pages_per_huge_pg) {
+			struct page *page;
+			int idx;
+			gfp_t gfp_no_reclaim = (gfp | __GFP_NOMEMALLOC |
+						__GFP_NOWARN) & ~__GFP_RECLAIM;
+
+			page = nvmap_alloc_pages_exact(gfp_no_reclaim,
+					NVMAP_PP_HUGE_PAGE_SIZE, true,
+					h->numa_id);
+			if (!page)
+				break;
+
+			for (idx = 0; idx < pages_per_huge_pg; idx++)
+				pages[i + idx] = nth_page(page, idx);
+			nvmap_clean_cache(&pages[i], pages_per_huge_pg);
+		}
+		h->pgalloc.huge = page_index > 0;
+		nvmap_huge_page_allocs += page_index;
+#endif /* NVMAP_PP_HUGE_PAGES */
 #ifdef CONFIG_ARM64_4K_PAGES
+		big_page_index = page_index;
 #ifdef NVMAP_CONFIG_PAGE_POOLS
 		/* Get as many big pages from the pool as possible. */
-		page_index = nvmap_page_pool_alloc_lots_bp(&nvmap_dev->pool, pages,
-							nr_page, true, h->numa_id);
+		got = nvmap_page_pool_alloc_lots_bp(&nvmap_dev->pool,
+						    &pages[page_index],
+						    nr_page - page_index,
+						    true, h->numa_id);
+		page_index += got;
+		pp_pages += got;
 		pages_per_big_pg = nvmap_dev->pool.pages_per_big_pg;
 #endif
 		/* Try to allocate big pages from page allocator */
@@ -549,14 +611,16 @@ static int handle_page_alloc(struct nvmap_client *client,
 				pages[i + idx] = nth_page(page, idx);
 			nvmap_clean_cache(&pages[i], pages_per_big_pg);
 		}
-		nvmap_big_page_allocs += page_index;
+		nvmap_big_page_allocs += page_index - big_page_index;
 #endif /* CONFIG_ARM64_4K_PAGES */
 		if (s_nr_colors <= 1) {
 #ifdef NVMAP_CONFIG_PAGE_POOLS
 			/* Get as many pages from the pool as possible. */
-			page_index += nvmap_page_pool_alloc_lots(
+			got = nvmap_page_pool_alloc_lots(
 				      &nvmap_dev->pool, &pages[page_index],
 				      nr_page - page_index, true, h->numa_id);
+			page_index += got;
+			pp_pages += got;
 #endif
 			allocated = page_index;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
@@ -580,6 +644,8 @@ static int handle_page_alloc(struct nvmap_client *client,
 			page_index = nr_page;
 		}
 		nvmap_total_page_allocs += nr_page;
+		nvmap_stats_pp_lookup(client, h->userflags >> 16, pp_pages,
+				      nr_page - pp_pages);
 	}
 
 	/*
@@ -605,6 +671,115 @@ fail:
 	return -ENOMEM;
 }
 
+/*
+ * Back one chunk of a lazy handle, preferring big pages so that the IOMMU
+ * can still use 64K mappings for lazily populated memory.
+ */
+static int nvmap_lazy_alloc_chunk(struct nvmap_handle *h,
+				  struct page **pages, int nr)
+{
+	gfp_t gfp = GFP_NVMAP | __GFP_ZERO;
+	int got = 0, i;
+
+#ifdef CONFIG_ARM64_4K_PAGES
+	if (nr > 1) {
+#ifdef NVMAP_CONFIG_PAGE_POOLS
+		got = nvmap_page_pool_alloc_lots_bp(&nvmap_dev->pool, pages,
+						    nr, true, h->numa_id);
+#endif
+		if (!got) {
+			struct page *page;
+			gfp_t gfp_no_reclaim = (gfp | __GFP_NOMEMALLOC |
+						__GFP_NOWARN) & ~__GFP_RECLAIM;
+
+			page = nvmap_alloc_pages_exact(gfp_no_reclaim,
+					nr << PAGE_SHIFT, true, h->numa_id);
+			if (page) {
+				for (i = 0; i < nr; i++)
+					pages[i] = nth_page(page, i);
+				nvmap_clean_cache(pages, nr);
+				got = nr;
+			}
+		}
+		nvmap_big_page_allocs += got;
+	}
+#endif /* CONFIG_ARM64_4K_PAGES */
+#ifdef NVMAP_CONFIG_PAGE_POOLS
+	if (got < nr)
+		got += nvmap_page_pool_alloc_lots(&nvmap_dev->pool,
+				&pages[got], nr - got, true, h->numa_id);
+	nvmap_stats_pp_lookup(h->owner, h->userflags >> 16, got, nr - got);
+#endif
+	for (i = got; i < nr; i++) {
+		pages[i] = nvmap_alloc_pages_exact(gfp, PAGE_SIZE, true,
+						   h->numa_id);
+		if (!pages[i])
+			goto fail;
+	}
+	if (got < nr)
+		nvmap_clean_cache(&pages[got], nr - got);
+	nvmap_total_page_allocs += nr;
+	return 0;
+
+fail:
+	while (i--)
+		__free_page(pages[i]);
+	return -ENOMEM;
+}
+
+/*
+ * Make sure [offset, offset + len) of a lazy handle is backed by memory.
+ * Population is done in big page sized chunks; pages are published in the
+ * handle's page array only once they are zeroed and clean.
+ */
+int nvmap_handle_populate(struct nvmap_handle *h, size_t offset, size_t len)
+{
+	struct page *chunk[NVMAP_PP_BIG_PAGE_SIZE >> PAGE_SHIFT];
+	size_t nr_page = h->size >> PAGE_SHIFT;
+	size_t start, end, i;
+	int chunk_pages = 1, nr, j, err = 0;
+
+	if (!nvmap_handle_is_lazy(h) || !len)
+		return 0;
+
+	if (atomic_read(&h->pgalloc.npopulated) == nr_page)
+		return 0;
+
+#if defined(CONFIG_ARM64_4K_PAGES) && defined(NVMAP_CONFIG_PAGE_POOLS)
+	chunk_pages = max_t(u32, nvmap_dev->pool.pages_per_big_pg, 1);
+#endif
+	chunk_pages = min_t(int, chunk_pages, ARRAY_SIZE(chunk));
+
+	start = round_down(offset >> PAGE_SHIFT, chunk_pages);
+	end = min_t(size_t, round_up(PAGE_ALIGN(offset + len) >> PAGE_SHIFT,
+				     chunk_pages), nr_page);
+
+	mutex_lock(&h->pgalloc.populate_lock);
+	for (i = start; i < end; i += nr) {
+		nr = min_t(size_t, chunk_pages, end - i);
+
+		/* chunks are always populated as a whole */
+		if (READ_ONCE(h->pgalloc.pages[i]))
+			continue;
+
+		err = nvmap_lazy_alloc_chunk(h, chunk, nr);
+		if (err)
+			break;
+
+		/* page contents must be visible before the pages are */
+		smp_wmb();
+		for (j = 0; j < nr; j++)
+			WRITE_ONCE(h->pgalloc.pages[i + j], chunk[j]);
+
+		atomic_add(nr, &h->pgalloc.npopulated);
+		nvmap_stats_inc(NS_TOTAL, nr << PAGE_SHIFT);
+		nvmap_stats_inc(NS_ALLOC, nr << PAGE_SHIFT);
+	}
+	mutex_unlock(&h->pgalloc.populate_lock);
+
+	return err;
+}
+
 static struct device *nvmap_heap_pgalloc_dev(unsigned long type)
 {
 	int ret = -EINVAL;
@@ -855,6 +1030,7 @@ int nvmap_alloc_handle(struct nvmap_client *client,
 	int err = -ENOMEM;
 	int tag, i;
 	bool alloc_from_excl = false;
+	u64 t_start = local_clock();
 
 	h = nvmap_handle_get(h);
 
@@ -944,12 +1120,19 @@ int nvmap_alloc_handle(struct nvmap_client *client,
 
 out:
 	if (h->alloc) {
+		/* lazy handles are accounted as they get populated */
+		if (nvmap_handle_is_lazy(h)) {
+			nvmap_stats_dec(NS_TOTAL, h->size);
+			nvmap_stats_dec(NS_ALLOC, h->size);
+		}
 		if (client->kernel_client)
 			nvmap_stats_inc(NS_KALLOC, h->size);
 		else
 			nvmap_stats_inc(NS_UALLOC, h->size);
 		NVMAP_TAG_TRACE(trace_nvmap_alloc_handle_done,
 			NVMAP_TP_ARGS_CHR(client, h, NULL));
+		nvmap_stats_lat_alloc(client, tag, h->heap_type, h->flags,
+				      h->size, local_clock() - t_start);
 		err = 0;
 	} else {
 		nvmap_stats_dec(NS_TOTAL, h->size);
@@ -1011,7 +1194,7 @@ int nvmap_alloc_handle_from_va(struct nvmap_client *client,
 
 void _nvmap_handle_free(struct nvmap_handle *h)
 {
-	unsigned int i, nr_page, page_index = 0;
+	unsigned int i, nr_page, nr_alloced, page_index = 0;
 	struct nvmap_handle_dmabuf_priv *curr, *next;
 
 	list_for_each_entry_safe(curr, next, &h->dmabuf_priv, list) {
@@ -1027,18 +1210,24 @@ void _nvmap_handle_free(struct nvmap_handle *h)
 	if (nvmap_handle_remove(nvmap_dev, h) != 0)
 		return;
 
+	nvmap_dmabuf_stash_invalidate(h);
+
 	if (!h->alloc)
 		goto out;
 
 	nvmap_stats_inc(NS_RELEASE, h->size);
-	nvmap_stats_dec(NS_TOTAL, h->size);
+	if (nvmap_handle_is_lazy(h))
+		nvmap_stats_dec(NS_TOTAL,
+			(size_t)atomic_read(&h->pgalloc.npopulated) << PAGE_SHIFT);
+	else
+		nvmap_stats_dec(NS_TOTAL, h->size);
 	if (!h->heap_pgalloc) {
 		if (h->vaddr) {
 			void *addr = h->vaddr;
 
 			if (h->pgalloc.pages) {
 				vunmap(h->vaddr);
-			} else {
+			} else if (!nvmap_heap_vaddr_shared(h)) {
 				addr -= (h->carveout->base & ~PAGE_MASK);
 				iounmap((void __iomem *)addr);
 			}
@@ -1071,13 +1260,22 @@ void _nvmap_handle_free(struct nvmap_handle *h)
 	for (i = 0; i < nr_page; i++)
 		h->pgalloc.pages[i] = nvmap_to_page(h->pgalloc.pages[i]);
 
+	nr_alloced = nr_page;
+	if (h->pgalloc.lazy) {
+		/* squeeze out the holes of a partially populated handle */
+		for (i = 0, nr_alloced = 0; i < nr_page; i++)
+			if (h->pgalloc.pages[i])
+				h->pgalloc.pages[nr_alloced++] =
+					h->pgalloc.pages[i];
+	}
+
 #ifdef NVMAP_CONFIG_PAGE_POOLS
 	if (!h->from_va && !h->is_subhandle)
 		page_index = nvmap_page_pool_fill_lots(&nvmap_dev->pool,
-					h->pgalloc.pages, nr_page);
+					h->pgalloc.pages, nr_alloced);
 #endif
 
-	for (i = page_index; i < nr_page; i++) {
+	for (i = page_index; i < nr_alloced; i++) {
 		if (h->from_va)
 			put_page(h->pgalloc.pages[i]);
 		/* Knowingly kept in "else if" handle for subrange */
@@ -1121,6 +1319,9 @@ void nvmap_free_handle(struct nvmap_client *client,
 
 	smp_rmb();
 	rb_erase(&ref->node, &client->handle_refs);
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	xa_erase(&client->handle_ref_ids, nvmap_ref_index(h, is_ro));
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	client->handle_count--;
 	atomic_dec(&ref->handle->share_count);
 
@@ -1135,7 +1336,7 @@ void nvmap_free_handle(struct nvmap_client *client,
 		dma_buf_put(ref->handle->dmabuf);
 	NVMAP_TAG_TRACE(trace_nvmap_free_handle,
 		NVMAP_TP_ARGS_CHR(client, h, ref));
-	kfree(ref);
+	kfree_rcu(ref, rcu);
 
 out:
 	BUG_ON(!atomic_read(&h->ref));
@@ -1226,6 +1427,12 @@ static int nvmap_assign_pages_per_handle(struct nvmap_handle *src_h,
 	if (!src_h)
 		return -EINVAL;
 
+	if (nvmap_handle_populate(src_h, src_h_start,
+				  src_h_end - src_h_start)) {
+		nvmap_handle_put(src_h);
+		return -ENOMEM;
+	}
+
 	while (src_h_start < src_h_end) {
 		unsigned long next;
 		struct page *dest_page;
@@ -8,7 +8,12 @@
 #include <linux/io.h>
 #include <linux/debugfs.h>
 #include <linux/of.h>
+#include <linux/sort.h>
+#include <linux/moduleparam.h>
 #include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
+#include <linux/sched/clock.h>
+#endif
 #if KERNEL_VERSION(4, 15, 0) > LINUX_VERSION_CODE
 #include <soc/tegra/chip-id.h>
 #else
@@ -85,6 +90,14 @@ static void heap_page_cache_maint(
 		nvmap_zap_handle(h, start, end - start);
 	}
 
+	/*
+	 * Mapping a partially populated lazy handle would populate all of
+	 * it just for cache maintenance; walk the resident pages instead.
+	 */
+	if (inner && !h->vaddr && nvmap_handle_is_lazy(h) &&
+	    atomic_read(&h->pgalloc.npopulated) != h->size >> PAGE_SHIFT)
+		goto per_page_cache_maint;
+
 	if (inner) {
 		if (!h->vaddr) {
 			if (__nvmap_mmap(h))
@@ -112,6 +125,11 @@ per_page_cache_maint:
 
 		page = nvmap_to_page(h->pgalloc.pages[start >> PAGE_SHIFT]);
 		next = min(((start + PAGE_SIZE) & PAGE_MASK), end);
+		/* never populated, so nothing can be in the caches */
+		if (!page) {
+			start = next;
+			continue;
+		}
 		off = start & ~PAGE_MASK;
 		size = next - start;
 		paddr = page_to_phys(page) + off;
@@ -238,6 +256,7 @@ int __nvmap_do_cache_maint(struct nvmap_client *client,
 {
 	int err;
 	struct cache_maint_op cache_op;
+	u64 t_start;
 
 	h = nvmap_handle_get(h);
 	if (!h)
@@ -273,7 +292,11 @@ int __nvmap_do_cache_maint(struct nvmap_client *client,
 	cache_op.clean_only_dirty = clean_only_dirty;
 
 	nvmap_stats_inc(NS_CFLUSH_RQ, end - start);
+	t_start = local_clock();
 	err = do_cache_maint(&cache_op);
+	nvmap_stats_lat_cache_maint(client, h->userflags >> 16, op,
+				    cache_op.end - cache_op.start,
+				    local_clock() - t_start);
 	nvmap_kmaps_dec(h);
 	nvmap_handle_put(h);
 	return err;
@@ -327,17 +350,112 @@ out:
 	return err;
 }
 
+/*
+ * Byte equivalent cost of one extra per-range maintenance call, that is the
+ * number of bytes that could be maintained in the time spent on the call
+ * overhead. Measured at probe by nvmap_cache_maint_calibrate().
+ */
+static u32 cache_maint_range_cost = SZ_16K;
+module_param(cache_maint_range_cost, uint, 0644);
+
+#define NVMAP_CACHE_CALIB_ORDER	8
+
+void nvmap_cache_maint_calibrate(void)
+{
+	size_t size = PAGE_SIZE << NVMAP_CACHE_CALIB_ORDER;
+	u32 nr = 1 << NVMAP_CACHE_CALIB_ORDER;
+	u64 t_one, t_many;
+	struct page *page;
+	void *vaddr;
+	u32 i;
+
+	page = alloc_pages(GFP_KERNEL | __GFP_NOWARN, NVMAP_CACHE_CALIB_ORDER);
+	if (!page)
+		return;
+	vaddr = page_address(page);
+
+	memset(vaddr, 0, size);
+	t_one = local_clock();
+	inner_cache_maint(NVMAP_CACHE_OP_WB_INV, vaddr, size);
+	t_one = local_clock() - t_one;
+
+	memset(vaddr, 0, size);
+	t_many = local_clock();
+	for (i = 0; i < nr; i++)
+		inner_cache_maint(NVMAP_CACHE_OP_WB_INV, vaddr + i * PAGE_SIZE,
+				  PAGE_SIZE);
+	t_many = local_clock() - t_many;
+
+	__free_pages(page, NVMAP_CACHE_CALIB_ORDER);
+
+	if (!t_one || t_many <= t_one)
+		return;
+
+	cache_maint_range_cost = div64_u64((t_many - t_one) * size,
+					   t_one * (nr - 1));
+	pr_info("cache maint range cost: %u bytes\n", cache_maint_range_cost);
+}
+
+struct nvmap_cache_range {
+	struct nvmap_handle *h;
+	u64 start;
+	u64 end;
+	phys_addr_t phys;
+};
+
+static int nvmap_cache_range_cmp_handle(const void *a, const void *b)
+{
+	const struct nvmap_cache_range *ra = a, *rb = b;
+
+	if (ra->h != rb->h)
+		return ra->h < rb->h ? -1 : 1;
+	if (ra->start != rb->start)
+		return ra->start < rb->start ? -1 : 1;
+	return 0;
+}
+
+static int nvmap_cache_range_cmp_phys(const void *a, const void *b)
+{
+	const struct nvmap_cache_range *ra = a, *rb = b;
+
+	if (ra->phys != rb->phys)
+		return ra->phys < rb->phys ? -1 : 1;
+	return 0;
+}
+
+static phys_addr_t nvmap_cache_range_phys(struct nvmap_cache_range *r)
+{
+	struct nvmap_handle *h = r->h;
+
+	if (!h->alloc)
+		return 0;
+
+	if (h->heap_pgalloc) {
+		struct page *page = nvmap_to_page(
+				h->pgalloc.pages[r->start >> PAGE_SHIFT]);
+
+		/* unpopulated lazy page, the phys is only used for ordering */
+		if (!page)
+			return 0;
+		return page_to_phys(page) + offset_in_page(r->start);
+	}
+
+	return h->carveout->base + r->start;
+}
+
 /*
  * Perform cache op on the list of memory regions within passed handles.
  * A memory region within handle[i] is identified by offsets[i], sizes[i]
  *
  * sizes[i] == 0  is a special case which causes handle wide operation,
  * this is done by replacing offsets[i] = 0, sizes[i] = handles[i]->size.
- * So, the input arrays sizes, offsets  are not guaranteed to be read-only
  *
- * This will optimze the op if it can.
- * In the case that all the handles together are larger than the inner cache
- * maint threshold it is possible to just do an entire inner cache flush.
+ * Ranges of the same handle that overlap or touch are merged first, and the
+ * merged ranges are maintained in physical address order. When the merged
+ * ranges cover enough of their handles that the per-range call overhead
+ * (cache_maint_range_cost) outweighs the extra bytes, each handle is
+ * maintained once over its whole size instead. ARM64 kernels cannot flush
+ * the caches by set/way, so a handle wide op is the full flush here.
  *
  * NOTE: this omits outer cache operations which is fine for ARM64
  */
@@ -345,73 +463,111 @@ static int __nvmap_do_cache_maint_list(struct nvmap_handle **handles,
 				u64 *offsets, u64 *sizes, int op, u32 nr_ops,
 				bool is_32)
 {
-	u32 i;
-	u64 total = 0;
-	u64 thresh = ~0;
+	u32 *offs_32 = (u32 *)offsets, *sizes_32 = (u32 *)sizes;
+	struct nvmap_cache_range *ranges;
+	u64 t_start = local_clock();
+	u64 total = 0, handles_size = 0;
+	u32 i, j, nr = 0, nr_handles = 0;
+	bool handle_wide = false;
+	int err = 0;
 
 	WARN(!IS_ENABLED(CONFIG_ARM64),
 		"cache list operation may not function properly");
 
+	ranges = nvmap_altalloc(nr_ops * sizeof(*ranges));
+	if (!ranges)
+		return -ENOMEM;
+
 	for (i = 0; i < nr_ops; i++) {
-		bool inner, outer;
-		u32 *sizes_32 = (u32 *)sizes;
+		struct nvmap_handle *h = handles[i];
 		u64 size = is_32 ? sizes_32[i] : sizes[i];
+		u64 offset = is_32 ? offs_32[i] : offsets[i];
+		bool inner, outer;
 
-		nvmap_handle_get_cacheability(handles[i], &inner, &outer);
-
+		nvmap_handle_get_cacheability(h, &inner, &outer);
 		if (!inner && !outer)
 			continue;
 
-		if ((op == NVMAP_CACHE_OP_WB) && nvmap_handle_track_dirty(handles[i]))
-			total += atomic_read(&handles[i]->pgalloc.ndirty);
-		else
-			total += size ? size : handles[i]->size;
+		if (!size) {
+			offset = 0;
+			size = h->size;
+		}
+
+		if (offset >= h->size || size > h->size - offset) {
+			pr_err("cache maint range outside handle\n");
+			err = -EFAULT;
+			goto out;
+		}
+
+		ranges[nr].h = h;
+		ranges[nr].start = offset;
+		ranges[nr].end = offset + size;
+		nr++;
 	}
 
-	if (!total)
-		return 0;
+	if (!nr)
+		goto out;
 
-	/* Full flush in the case the passed list is bigger than our
-	 * threshold. */
-	if (total >= thresh) {
-		for (i = 0; i < nr_ops; i++) {
-			if (handles[i]->userflags &
-			    NVMAP_HANDLE_CACHE_SYNC) {
-				nvmap_handle_mkclean(handles[i], 0,
-						     handles[i]->size);
-				nvmap_zap_handle(handles[i], 0,
-						 handles[i]->size);
-			}
+	sort(ranges, nr, sizeof(*ranges), nvmap_cache_range_cmp_handle, NULL);
+	for (i = 0, j = 0; i < nr; i++) {
+		struct nvmap_cache_range *prev = j ? &ranges[j - 1] : NULL;
+
+		if (prev && prev->h == ranges[i].h &&
+		    ranges[i].start <= prev->end) {
+			prev->end = max(prev->end, ranges[i].end);
+			continue;
 		}
 
-		nvmap_stats_inc(NS_CFLUSH_RQ, total);
-		nvmap_stats_inc(NS_CFLUSH_DONE, thresh);
-		trace_nvmap_cache_flush(total,
-					nvmap_stats_read(NS_ALLOC),
-					nvmap_stats_read(NS_CFLUSH_RQ),
-					nvmap_stats_read(NS_CFLUSH_DONE));
-	} else {
-		for (i = 0; i < nr_ops; i++) {
-			u32 *offs_32 = (u32 *)offsets, *sizes_32 = (u32 *)sizes;
-			u64 size = is_32 ? sizes_32[i] : sizes[i];
-			u64 offset = is_32 ? offs_32[i] : offsets[i];
-			int err;
-
-			size = size ?: handles[i]->size;
-			offset = offset ?: 0;
-			err = __nvmap_do_cache_maint(handles[i]->owner,
-						     handles[i], offset,
-						     offset + size,
+		if (!prev || prev->h != ranges[i].h) {
+			nr_handles++;
+			handles_size += ranges[i].h->size;
+		}
+		ranges[j++] = ranges[i];
+	}
+	nr = j;
+
+	for (i = 0; i < nr; i++)
+		total += ranges[i].end - ranges[i].start;
+
+	handle_wide = nr > nr_handles &&
+		total + (u64)(nr - nr_handles) *
+			READ_ONCE(cache_maint_range_cost) >= handles_size;
+
+	if (handle_wide) {
+		/* ranges are still sorted by handle */
+		for (i = 0; i < nr; i++) {
+			if (i && ranges[i].h == ranges[i - 1].h)
+				continue;
+			err = __nvmap_do_cache_maint(ranges[i].h->owner,
+						     ranges[i].h, 0,
+						     ranges[i].h->size,
 						     op, false);
-			if (err) {
-				pr_err("cache maint per handle failed [%d]\n",
-						err);
-				return err;
-			}
+			if (err)
+				goto fail;
 		}
+		goto out;
 	}
 
-	return 0;
+	for (i = 0; i < nr; i++)
+		ranges[i].phys = nvmap_cache_range_phys(&ranges[i]);
+	sort(ranges, nr, sizeof(*ranges), nvmap_cache_range_cmp_phys, NULL);
+
+	for (i = 0; i < nr; i++) {
+		err = __nvmap_do_cache_maint(ranges[i].h->owner, ranges[i].h,
+					     ranges[i].start, ranges[i].end,
+					     op, false);
+		if (err)
+			goto fail;
+	}
+	goto out;
+
+fail:
+	pr_err("cache maint per handle failed [%d]\n", err);
+out:
+	trace_nvmap_cache_maint_list(nr_ops, nr, total, handle_wide,
+				     local_clock() - t_start);
+	nvmap_altfree(ranges, nr_ops * sizeof(*ranges));
+	return err;
 }
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 9, 0))
@@ -26,6 +26,7 @@
 #endif /* NVMAP_UPSTREAM_KERNEL */
 
 #include "nvmap_priv.h"
+#include "nvmap_heap.h"
 
 static phys_addr_t handle_phys(struct nvmap_handle *h)
 {
@@ -65,6 +66,9 @@ void *__nvmap_kmap(struct nvmap_handle *h, unsigned int pagenum)
 	if (pagenum >= h->size >> PAGE_SHIFT)
 		goto out;
 
+	if (nvmap_handle_populate(h, (size_t)pagenum << PAGE_SHIFT, PAGE_SIZE))
+		goto out;
+
 	if (h->vaddr) {
 		kaddr = (unsigned long)h->vaddr + pagenum * PAGE_SIZE;
 	} else {
@@ -157,6 +161,9 @@ void *__nvmap_mmap(struct nvmap_handle *h)
 	if (h->vaddr)
 		return h->vaddr;
 
+	if (nvmap_handle_populate(h, 0, h->size))
+		goto put_handle;
+
 	nvmap_kmaps_inc(h);
 	prot = nvmap_pgprot(h, PG_PROT_KERNEL);
 
@@ -177,6 +184,15 @@ void *__nvmap_mmap(struct nvmap_handle *h)
 		return h->vaddr;
 	}
 
+	/* IVM carveout - a window of the mapping shared by the region */
+	vaddr = nvmap_heap_ivm_vaddr(h);
+	if (vaddr) {
+		if (atomic_long_cmpxchg((atomic_long_t *)&h->vaddr,
+					0, (long)vaddr))
+			nvmap_kmaps_dec(h);
+		return h->vaddr;
+	}
+
 	/* carveout - explicitly map the pfns into a vmalloc area */
 	adj_size = h->carveout->base & ~PAGE_MASK;
 	adj_size += h->size;
@@ -310,6 +326,11 @@ struct sg_table *__nvmap_sg_table(struct nvmap_client *client,
 		goto put_handle;
 	}
 
+	/* devices have no way of faulting in a lazy handle */
+	err = nvmap_handle_populate(h, 0, h->size);
+	if (err)
+		goto put_handle;
+
 	npages = PAGE_ALIGN(h->size) >> PAGE_SHIFT;
 	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
 	if (!sgt) {
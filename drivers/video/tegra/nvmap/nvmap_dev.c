@@ -227,6 +227,9 @@ unlock:
 	}
 	client->name = name;
 	client->handle_refs = RB_ROOT;
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	xa_init(&client->handle_ref_ids);
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	client->task = task;
 
 	mutex_init(&client->ref_lock);
@@ -299,6 +302,9 @@ static void destroy_client(struct nvmap_client *client)
 
 		kfree(ref);
 	}
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	xa_destroy(&client->handle_ref_ids);
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 
 	if (client->task)
 		put_task_struct(client->task);
@@ -479,6 +485,10 @@ static long nvmap_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		err = nvmap_ioctl_get_handle_parameters(filp, uarg);
 		break;
 
+	case NVMAP_IOC_RW_LIST:
+		err = nvmap_ioctl_rw_handle_list(filp, uarg);
+		break;
+
 	case NVMAP_IOC_GET_SCIIPCID:
 		err = nvmap_ioctl_get_sci_ipc_id(filp, uarg);
 		break;
@@ -487,9 +497,24 @@ static long nvmap_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		err = nvmap_ioctl_handle_from_sci_ipc_id(filp, uarg);
 		break;
 
+	case NVMAP_IOC_GET_SCIIPCID_LIST:
+		err = nvmap_ioctl_get_sci_ipc_id_list(filp, uarg);
+		break;
+
+	case NVMAP_IOC_HANDLE_FROM_SCIIPCID_LIST:
+		err = nvmap_ioctl_handle_from_sci_ipc_id_list(filp, uarg);
+		break;
+
 	case NVMAP_IOC_QUERY_HEAP_PARAMS:
-		err = nvmap_ioctl_query_heap_params(filp, uarg);
+		err = nvmap_ioctl_query_heap_params(filp, uarg,
+			sizeof(struct nvmap_query_heap_params));
+		break;
+
+	case NVMAP_IOC_QUERY_HEAP_PARAMS_EXT:
+		err = nvmap_ioctl_query_heap_params(filp, uarg,
+			sizeof(struct nvmap_query_heap_params_ext));
 		break;
+
 	case NVMAP_IOC_GET_FD_FOR_RANGE_FROM_LIST:
 		err = nvmap_ioctl_get_fd_from_list(filp, uarg);
 		break;
@@ -816,7 +841,7 @@ static void nvmap_get_total_mss(u64 *pss, u64 *total, u32 heap_type)
 		for (i = 0; i < h->size >> PAGE_SHIFT; i++) {
 			struct page *page = nvmap_to_page(h->pgalloc.pages[i]);
 
-			if (nvmap_page_mapcount(page) > 0)
+			if (page && nvmap_page_mapcount(page) > 0)
 				*pss += PAGE_SIZE;
 		}
 	}
@@ -1434,6 +1459,9 @@ int __init nvmap_probe(struct platform_device *pdev)
 	dev->dev_user.fops = &nvmap_user_fops;
 	dev->dev_user.parent = &pdev->dev;
 	dev->handles = RB_ROOT;
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	nvmap_id_array_init(&dev->handle_ids);
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	dev->serial_id_counter = 0;
 
 #ifdef NVMAP_CONFIG_PAGE_POOLS
@@ -1442,6 +1470,8 @@ int __init nvmap_probe(struct platform_device *pdev)
 		goto fail;
 #endif
 
+	nvmap_cache_maint_calibrate();
+
 	spin_lock_init(&dev->handle_lock);
 	INIT_LIST_HEAD(&dev->clients);
 	dev->pids = RB_ROOT;
@@ -1562,6 +1592,9 @@ int nvmap_remove(struct platform_device *pdev)
 		rb_erase(&h->node, &dev->handles);
 		kfree(h);
 	}
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	nvmap_id_array_exit(&dev->handle_ids);
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 
 	for (i = 0; i < dev->nr_carveouts; i++) {
 		struct nvmap_carveout_node *node = &dev->heaps[i];
@@ -13,6 +13,7 @@
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/export.h>
+#include <linux/moduleparam.h>
 #include <linux/nvmap.h>
 #include <linux/dma-buf.h>
 #include <linux/spinlock.h>
@@ -39,16 +40,40 @@
 #define NVMAP_DMABUF_ATTACH  __nvmap_dmabuf_attach
 #endif
 
+/*
+ * Stashed device mappings live on the handle rather than on the dma_buf, so
+ * they survive attach/detach cycles and re-exports of the same handle. All
+ * stashed mappings are kept on a global LRU whose IOVA footprint is bounded
+ * by stash_budget_mb; mappings with no attachment using them are unmapped
+ * from the LRU head once the budget is exceeded.
+ *
+ * Lock order: handle->maps_lock -> nvmap_sgt_lru_lock. Eviction walks the
+ * LRU with nvmap_sgt_lru_lock held and only trylocks the handle lock.
+ */
 struct nvmap_handle_sgt {
 	enum dma_data_direction dir;
 	struct sg_table *sgt;
 	struct device *dev;
 	struct list_head maps_entry;
-	struct nvmap_handle_info *owner;
+	struct list_head lru_entry;
+	struct nvmap_handle *handle;
+	size_t size;		/* IOVA space held, 0 if not dma mapped */
+	u32 users;		/* attachments currently using the mapping */
 } ____cacheline_aligned_in_smp;
 
 static struct kmem_cache *handle_sgt_cache;
 
+static DEFINE_MUTEX(nvmap_sgt_lru_lock);
+static LIST_HEAD(nvmap_sgt_lru);
+static size_t nvmap_sgt_lru_size;
+
+static u32 stash_budget_mb = 512;
+module_param(stash_budget_mb, uint, 0644);
+
+/* Fill in the page tables of IVM carveout mappings at mmap time */
+static bool ivm_prefault = true;
+module_param(ivm_prefault, bool, 0644);
+
 /*
  * Initialize a kmem cache for allocating nvmap_handle_sgt's.
  */
@@ -114,7 +139,7 @@ static inline bool access_vpr_phys(struct device *dev)
 
 static int nvmap_dmabuf_stash_sgt_locked(struct dma_buf_attachment *attach,
 					 enum dma_data_direction dir,
-					 struct sg_table *sgt)
+					 struct sg_table *sgt, size_t size)
 {
 	struct nvmap_handle_sgt *nvmap_sgt;
 	struct nvmap_handle_info *info = attach->dmabuf->priv;
@@ -128,29 +153,57 @@ static int nvmap_dmabuf_stash_sgt_locked(struct dma_buf_attachment *attach,
 	nvmap_sgt->dir = dir;
 	nvmap_sgt->sgt = sgt;
 	nvmap_sgt->dev = attach->dev;
-	nvmap_sgt->owner = info;
-	list_add(&nvmap_sgt->maps_entry, &info->maps);
+	nvmap_sgt->handle = info->handle;
+	nvmap_sgt->size = size;
+	nvmap_sgt->users = 1;
+	list_add(&nvmap_sgt->maps_entry, &info->handle->maps);
+
+	mutex_lock(&nvmap_sgt_lru_lock);
+	list_add_tail(&nvmap_sgt->lru_entry, &nvmap_sgt_lru);
+	nvmap_sgt_lru_size += size;
+	mutex_unlock(&nvmap_sgt_lru_lock);
 
 	return 0;
 }
 
+static struct nvmap_handle_sgt *nvmap_dmabuf_find_stash_locked(
+		struct nvmap_handle *h, struct device *dev,
+		enum dma_data_direction dir, struct sg_table *sgt)
+{
+	struct nvmap_handle_sgt *nvmap_sgt;
+
+	list_for_each_entry(nvmap_sgt, &h->maps, maps_entry) {
+		if (nvmap_sgt->dir != dir || nvmap_sgt->dev != dev)
+			continue;
+		if (sgt && nvmap_sgt->sgt != sgt)
+			continue;
+		return nvmap_sgt;
+	}
+
+	return NULL;
+}
+
 static struct sg_table *nvmap_dmabuf_get_sgt_from_stash(struct dma_buf_attachment *attach,
 							enum dma_data_direction dir)
 {
 	struct nvmap_handle_info *info = attach->dmabuf->priv;
 	struct nvmap_handle_sgt *nvmap_sgt;
-	struct sg_table *sgt = NULL;
-
-	list_for_each_entry(nvmap_sgt, &info->maps, maps_entry) {
-		if (nvmap_sgt->dir != dir || nvmap_sgt->dev != attach->dev)
-			continue;
 
-		/* found sgt in stash */
-		sgt = nvmap_sgt->sgt;
-		break;
+	nvmap_sgt = nvmap_dmabuf_find_stash_locked(info->handle, attach->dev,
+						   dir, NULL);
+	if (!nvmap_sgt) {
+		nvmap_stats_inc(NS_SGT_STASH_MISS, 1);
+		return NULL;
 	}
 
-	return sgt;
+	/* found sgt in stash */
+	nvmap_stats_inc(NS_SGT_STASH_HIT, 1);
+	nvmap_sgt->users++;
+	mutex_lock(&nvmap_sgt_lru_lock);
+	list_move_tail(&nvmap_sgt->lru_entry, &nvmap_sgt_lru);
+	mutex_unlock(&nvmap_sgt_lru_lock);
+
+	return nvmap_sgt->sgt;
 }
 
 static struct sg_table *nvmap_dmabuf_map_dma_buf(struct dma_buf_attachment *attach,
@@ -158,6 +211,7 @@ static struct sg_table *nvmap_dmabuf_map_dma_buf(struct dma_buf_attachment *atta
 {
 	struct nvmap_handle_info *info = attach->dmabuf->priv;
 	int ents = 0;
+	size_t mapped_size = 0;
 	struct sg_table *sgt = NULL;
 #ifdef NVMAP_CONFIG_DEBUG_MAPS
 	char *device_name = NULL;
@@ -178,7 +232,7 @@ static struct sg_table *nvmap_dmabuf_map_dma_buf(struct dma_buf_attachment *atta
 		return ERR_PTR(-EACCES);
 
 	nvmap_lru_reset(info->handle);
-	mutex_lock(&info->maps_lock);
+	mutex_lock(&info->handle->maps_lock);
 
 	atomic_inc(&info->handle->pin);
 
@@ -189,7 +243,7 @@ static struct sg_table *nvmap_dmabuf_map_dma_buf(struct dma_buf_attachment *atta
 	sgt = __nvmap_sg_table(NULL, info->handle);
 	if (IS_ERR(sgt)) {
 		atomic_dec(&info->handle->pin);
-		mutex_unlock(&info->maps_lock);
+		mutex_unlock(&info->handle->maps_lock);
 		return sgt;
 	}
 
@@ -207,9 +261,10 @@ static struct sg_table *nvmap_dmabuf_map_dma_buf(struct dma_buf_attachment *atta
 					sgt->nents, dir, __DMA_ATTR(attrs));
 		if (ents <= 0)
 			goto err_map;
+		mapped_size = info->handle->size;
 	}
 
-	if (nvmap_dmabuf_stash_sgt_locked(attach, dir, sgt))
+	if (nvmap_dmabuf_stash_sgt_locked(attach, dir, sgt, mapped_size))
 		WARN(1, "No mem to prep sgt.\n");
 
 cache_hit:
@@ -225,26 +280,27 @@ cache_hit:
 		nvmap_add_device_name(device_name, dma_mask, heap_type);
 	}
 #endif /* NVMAP_CONFIG_DEBUG_MAPS */
-	mutex_unlock(&info->maps_lock);
+	mutex_unlock(&info->handle->maps_lock);
+	nvmap_dmabuf_stash_shrink();
 	return sgt;
 
 err_map:
 	__nvmap_free_sg_table(NULL, info->handle, sgt);
 	atomic_dec(&info->handle->pin);
-	mutex_unlock(&info->maps_lock);
+	mutex_unlock(&info->handle->maps_lock);
 	return ERR_PTR(-ENOMEM);
 }
 
 static void __nvmap_dmabuf_unmap_dma_buf(struct nvmap_handle_sgt *nvmap_sgt)
 {
-	struct nvmap_handle_info *info = nvmap_sgt->owner;
+	struct nvmap_handle *h = nvmap_sgt->handle;
 	enum dma_data_direction dir = nvmap_sgt->dir;
 	struct sg_table *sgt = nvmap_sgt->sgt;
 	struct device *dev = nvmap_sgt->dev;
 
-	if (!(nvmap_dev->dynamic_dma_map_mask & info->handle->heap_type)) {
+	if (!(nvmap_dev->dynamic_dma_map_mask & h->heap_type)) {
 		sg_dma_address(sgt->sgl) = 0;
-	} else if (info->handle->heap_type == NVMAP_HEAP_CARVEOUT_VPR &&
+	} else if (h->heap_type == NVMAP_HEAP_CARVEOUT_VPR &&
 			access_vpr_phys(dev)) {
 		sg_dma_address(sgt->sgl) = 0;
 	} else {
@@ -252,7 +308,73 @@ static void __nvmap_dmabuf_unmap_dma_buf(struct nvmap_handle_sgt *nvmap_sgt)
 				   sgt->sgl, sgt->nents,
 				   dir, DMA_ATTR_SKIP_CPU_SYNC);
 	}
-	__nvmap_free_sg_table(NULL, info->handle, sgt);
+	__nvmap_free_sg_table(NULL, h, sgt);
+}
+
+/*
+ * Unmap idle stashed mappings, oldest first, until the stash fits its
+ * budget. Handles whose maps_lock is contended are skipped; they are either
+ * mapping (and will call back in here) or being freed.
+ */
+static void nvmap_dmabuf_stash_shrink(void)
+{
+	size_t budget = (size_t)READ_ONCE(stash_budget_mb) << 20;
+	struct nvmap_handle_sgt *nvmap_sgt, *tmp;
+	struct nvmap_handle *h;
+
+	if (READ_ONCE(nvmap_sgt_lru_size) <= budget)
+		return;
+
+	mutex_lock(&nvmap_sgt_lru_lock);
+	list_for_each_entry_safe(nvmap_sgt, tmp, &nvmap_sgt_lru, lru_entry) {
+		if (nvmap_sgt_lru_size <= budget)
+			break;
+
+		h = nvmap_sgt->handle;
+		if (!nvmap_sgt->size || !mutex_trylock(&h->maps_lock))
+			continue;
+
+		if (nvmap_sgt->users) {
+			mutex_unlock(&h->maps_lock);
+			continue;
+		}
+
+		list_del(&nvmap_sgt->lru_entry);
+		list_del(&nvmap_sgt->maps_entry);
+		nvmap_sgt_lru_size -= nvmap_sgt->size;
+		__nvmap_dmabuf_unmap_dma_buf(nvmap_sgt);
+		mutex_unlock(&h->maps_lock);
+
+		kmem_cache_free(handle_sgt_cache, nvmap_sgt);
+		nvmap_stats_inc(NS_SGT_STASH_EVICT, 1);
+	}
+	mutex_unlock(&nvmap_sgt_lru_lock);
+}
+
+/*
+ * Drop all stashed mappings of a handle. Called when the handle is freed,
+ * at which point no dma_buf of the handle can be attached any more.
+ */
+void nvmap_dmabuf_stash_invalidate(struct nvmap_handle *h)
+{
+	struct nvmap_handle_sgt *nvmap_sgt;
+
+	mutex_lock(&h->maps_lock);
+	while (!list_empty(&h->maps)) {
+		nvmap_sgt = list_first_entry(&h->maps,
+					     struct nvmap_handle_sgt,
+					     maps_entry);
+		WARN_ON(nvmap_sgt->users);
+		mutex_lock(&nvmap_sgt_lru_lock);
+		list_del(&nvmap_sgt->lru_entry);
+		nvmap_sgt_lru_size -= nvmap_sgt->size;
+		mutex_unlock(&nvmap_sgt_lru_lock);
+
+		list_del(&nvmap_sgt->maps_entry);
+		__nvmap_dmabuf_unmap_dma_buf(nvmap_sgt);
+		kmem_cache_free(handle_sgt_cache, nvmap_sgt);
+	}
+	mutex_unlock(&h->maps_lock);
 }
 
 static void nvmap_dmabuf_unmap_dma_buf(struct dma_buf_attachment *attach,
@@ -260,6 +382,7 @@ static void nvmap_dmabuf_unmap_dma_buf(struct dma_buf_attachment *attach,
 				       enum dma_data_direction dir)
 {
 	struct nvmap_handle_info *info = attach->dmabuf->priv;
+	struct nvmap_handle_sgt *nvmap_sgt;
 #ifdef NVMAP_CONFIG_DEBUG_MAPS
 	char *device_name = NULL;
 	u32 heap_type = 0;
@@ -267,13 +390,18 @@ static void nvmap_dmabuf_unmap_dma_buf(struct dma_buf_attachment *attach,
 
 	trace_nvmap_dmabuf_unmap_dma_buf(attach->dmabuf, attach->dev);
 
-	mutex_lock(&info->maps_lock);
+	mutex_lock(&info->handle->maps_lock);
 	if (!atomic_add_unless(&info->handle->pin, -1, 0)) {
-		mutex_unlock(&info->maps_lock);
+		mutex_unlock(&info->handle->maps_lock);
 		WARN(1, "Unpinning handle that has yet to be pinned!\n");
 		return;
 	}
 
+	nvmap_sgt = nvmap_dmabuf_find_stash_locked(info->handle, attach->dev,
+						   dir, sgt);
+	if (!WARN_ON(!nvmap_sgt || !nvmap_sgt->users))
+		nvmap_sgt->users--;
+
 #ifdef NVMAP_CONFIG_DEBUG_MAPS
 	/* Remove the device name from the list of carveout accessing devices */
 	heap_type = info->handle->heap_type;
@@ -281,30 +409,23 @@ static void nvmap_dmabuf_unmap_dma_buf(struct dma_buf_attachment *attach,
 	if (device_name)
 		nvmap_remove_device_name(device_name, heap_type);
 #endif /* NVMAP_CONFIG_DEBUG_MAPS */
-	mutex_unlock(&info->maps_lock);
+	mutex_unlock(&info->handle->maps_lock);
+	nvmap_dmabuf_stash_shrink();
 }
 
 static void nvmap_dmabuf_release(struct dma_buf *dmabuf)
 {
 	struct nvmap_handle_info *info = dmabuf->priv;
-	struct nvmap_handle_sgt *nvmap_sgt;
 
 	trace_nvmap_dmabuf_release(info->handle->owner ?
 				   info->handle->owner->name : "unknown",
 				   info->handle,
 				   dmabuf);
 
-	mutex_lock(&info->maps_lock);
-	while (!list_empty(&info->maps)) {
-		nvmap_sgt = list_first_entry(&info->maps,
-					     struct nvmap_handle_sgt,
-					     maps_entry);
-		__nvmap_dmabuf_unmap_dma_buf(nvmap_sgt);
-		list_del(&nvmap_sgt->maps_entry);
-		kmem_cache_free(handle_sgt_cache, nvmap_sgt);
-	}
-	mutex_unlock(&info->maps_lock);
-
+	/*
+	 * Stashed mappings stay with the handle, a later export of the same
+	 * handle reuses them. They are dropped when the handle is freed.
+	 */
 	mutex_lock(&info->handle->lock);
 	if (info->is_ro) {
 		BUG_ON(dmabuf != info->handle->dmabuf_ro);
@@ -414,9 +535,45 @@ static void *nvmap_dmabuf_kmap_atomic(struct dma_buf *dmabuf,
 }
 #endif
 
+/*
+ * IVM buffers are mapped by every VM touching them, usually once per frame.
+ * Map the whole VMA up front instead of taking a fault per 4K page, unless
+ * the VMA lines up with the carveout at 2MB, where nvmap_vma_huge_fault()
+ * needs a single fault per PMD anyway.
+ */
+static void nvmap_ivm_prefault(struct nvmap_handle *h,
+			       struct vm_area_struct *vma)
+{
+	unsigned long offs = vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long len = vma->vm_end - vma->vm_start;
+	phys_addr_t phys;
+
+	if (!ivm_prefault || h->heap_pgalloc ||
+	    h->heap_type != NVMAP_HEAP_CARVEOUT_IVM)
+		return;
+
+	if (offs >= h->size || len > h->size - offs)
+		return;
+
+	phys = h->carveout->base + offs;
+	if (pfn_valid(__phys_to_pfn(phys)))
+		return;
+
+#ifdef NVMAP_PP_HUGE_PAGES
+	if (len >= PMD_SIZE && !((vma->vm_start ^ phys) & ~PMD_MASK))
+		return;
+#endif /* NVMAP_PP_HUGE_PAGES */
+
+	/* faults map whatever is left on failure */
+	if (remap_pfn_range(vma, vma->vm_start, __phys_to_pfn(phys), len,
+			    vma->vm_page_prot))
+		pr_debug("prefault of %lu bytes at %pa failed\n", len, &phys);
+}
+
 int __nvmap_map(struct nvmap_handle *h, struct vm_area_struct *vma)
 {
 	struct nvmap_vma_priv *priv;
+	vm_flags_t huge_flags = 0;
 
 	h = nvmap_handle_get(h);
 	if (!h)
@@ -452,13 +609,24 @@ int __nvmap_map(struct nvmap_handle *h, struct vm_area_struct *vma)
 	}
 	priv->handle = h;
 
+#ifdef NVMAP_PP_HUGE_PAGES
+	/*
+	 * PMD mappings are PFN based. Handles tracking dirty pages need
+	 * struct page faults, so they keep using 4K mappings.
+	 */
+	if (h->heap_pgalloc && h->pgalloc.huge && !nvmap_handle_track_dirty(h))
+		huge_flags = VM_PFNMAP | VM_HUGEPAGE;
+	else if (!h->heap_pgalloc && h->heap_type == NVMAP_HEAP_CARVEOUT_IVM)
+		huge_flags = VM_HUGEPAGE;
+#endif /* NVMAP_PP_HUGE_PAGES */
+
 #if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
 	vm_flags_set(vma, VM_SHARED | VM_DONTEXPAND |
-			  VM_DONTDUMP | VM_DONTCOPY |
+			  VM_DONTDUMP | VM_DONTCOPY | huge_flags |
 			  (h->heap_pgalloc ? 0 : VM_PFNMAP));
 #else
 	vma->vm_flags |= VM_SHARED | VM_DONTEXPAND |
-			  VM_DONTDUMP | VM_DONTCOPY |
+			  VM_DONTDUMP | VM_DONTCOPY | huge_flags |
 			  (h->heap_pgalloc ? 0 : VM_PFNMAP);
 #endif
 	vma->vm_ops = &nvmap_vma_ops;
@@ -466,6 +634,7 @@ int __nvmap_map(struct nvmap_handle *h, struct vm_area_struct *vma)
 	vma->vm_private_data = priv;
 	vma->vm_page_prot = nvmap_pgprot(h, vma->vm_page_prot);
 	nvmap_vma_open(vma);
+	nvmap_ivm_prefault(h, vma);
 	return 0;
 }
 
@@ -615,8 +784,6 @@ struct dma_buf *__nvmap_make_dmabuf(struct nvmap_client *client,
 	}
 	info->handle = handle;
 	info->is_ro = ro_buf;
-	INIT_LIST_HEAD(&info->maps);
-	mutex_init(&info->maps_lock);
 
 	dmabuf = __dma_buf_export(info, handle->size, ro_buf);
 	if (IS_ERR(dmabuf)) {
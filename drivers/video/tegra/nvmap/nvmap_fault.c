@@ -7,9 +7,14 @@
 
 #include <trace/events/nvmap.h>
 #include <linux/highmem.h>
+#include <linux/huge_mm.h>
 
 #include "nvmap_priv.h"
 
+#if defined(NV_VMF_INSERT_PFN_PMD_HAS_PFN_T_ARG)
+#include <linux/pfn_t.h>
+#endif
+
 static void nvmap_vma_close(struct vm_area_struct *vma);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
@@ -21,10 +26,23 @@ static int nvmap_vma_fault(struct vm_fault *vmf);
 static int nvmap_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf);
 #endif
 
+#ifdef NVMAP_PP_HUGE_PAGES
+#if defined(NV_VM_OPERATIONS_STRUCT_HUGE_FAULT_HAS_ORDER_ARG) /* Linux v6.6 */
+static vm_fault_t nvmap_vma_huge_fault(struct vm_fault *vmf,
+				       unsigned int order);
+#else
+static vm_fault_t nvmap_vma_huge_fault(struct vm_fault *vmf,
+				       enum page_entry_size pe_size);
+#endif
+#endif /* NVMAP_PP_HUGE_PAGES */
+
 struct vm_operations_struct nvmap_vma_ops = {
 	.open		= nvmap_vma_open,
 	.close		= nvmap_vma_close,
 	.fault		= nvmap_vma_fault,
+#ifdef NVMAP_PP_HUGE_PAGES
+	.huge_fault	= nvmap_vma_huge_fault,
+#endif /* NVMAP_PP_HUGE_PAGES */
 };
 
 int is_nvmap_vma(struct vm_area_struct *vma)
@@ -57,7 +75,8 @@ void nvmap_vma_open(struct vm_area_struct *vma)
 
 	mutex_lock(&h->lock);
 	vma_open_count = atomic_inc_return(&priv->count);
-	if (vma_open_count == 1 && h->heap_pgalloc) {
+	/* lazy handles gain pages after open, so they can't be balanced */
+	if (vma_open_count == 1 && h->heap_pgalloc && !h->pgalloc.lazy) {
 		nr_page = h->size >> PAGE_SHIFT;
 		for (i = 0; i < nr_page; i++) {
 			struct page *page = nvmap_to_page(h->pgalloc.pages[i]);
@@ -148,7 +167,7 @@ static void nvmap_vma_close(struct vm_area_struct *vma)
 	nvmap_umaps_dec(h);
 
 	if (__atomic_add_unless(&priv->count, -1, 0) == 1) {
-		if (h->heap_pgalloc) {
+		if (h->heap_pgalloc && !h->pgalloc.lazy) {
 			for (i = 0; i < nr_page; i++) {
 				struct page *page;
 				page = nvmap_to_page(h->pgalloc.pages[i]);
@@ -226,6 +245,9 @@ static int nvmap_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 			offs >>= PAGE_SHIFT;
 			if (atomic_read(&priv->handle->pgalloc.reserved))
 				return VM_FAULT_SIGBUS;
+			if (nvmap_handle_populate(priv->handle,
+						  offs << PAGE_SHIFT, PAGE_SIZE))
+				return VM_FAULT_OOM;
 			page = nvmap_to_page(priv->handle->pgalloc.pages[offs]);
 
 			if (PageAnon(page)) {
@@ -233,6 +255,13 @@ static int nvmap_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 					return VM_FAULT_SIGSEGV;
 			}
 
+			/* PMD capable mapping, see nvmap_vma_huge_fault() */
+			if (vma->vm_flags & VM_PFNMAP) {
+				vm_insert_pfn(vma, (unsigned long)vmf_address,
+					      page_to_pfn(page));
+				return VM_FAULT_NOPAGE;
+			}
+
 			if (!nvmap_handle_track_dirty(priv->handle))
 				goto finish;
 			mutex_lock(&priv->handle->lock);
@@ -262,3 +291,85 @@ finish:
 	vmf->page = page;
 	return (page) ? 0 : VM_FAULT_SIGBUS;
 }
+
+#ifdef NVMAP_PP_HUGE_PAGES
+/*
+ * Map a 2MB aligned chunk of a handle with a single PMD entry. Falls back
+ * to 4K faults when the VMA address/offset is not 2MB aligned or the pages
+ * behind it are not a 2MB aligned contiguous chunk. IVM carveouts are
+ * contiguous, only the physical address of the chunk needs checking.
+ */
+static vm_fault_t nvmap_vma_pmd_fault(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	unsigned long addr = vmf->address & PMD_MASK;
+	struct nvmap_vma_priv *priv = vma->vm_private_data;
+	struct nvmap_handle *h;
+	unsigned long offs, pfn;
+	size_t idx;
+
+	if (!priv || !priv->handle || !priv->handle->alloc)
+		return VM_FAULT_SIGBUS;
+
+	h = priv->handle;
+	if (!(vma->vm_flags & VM_PFNMAP))
+		return VM_FAULT_FALLBACK;
+
+	if (h->heap_pgalloc ? !h->pgalloc.huge :
+	    h->heap_type != NVMAP_HEAP_CARVEOUT_IVM)
+		return VM_FAULT_FALLBACK;
+
+	if (addr < vma->vm_start || addr + PMD_SIZE > vma->vm_end)
+		return VM_FAULT_FALLBACK;
+
+	offs = addr - vma->vm_start + priv->offs + (vma->vm_pgoff << PAGE_SHIFT);
+	if ((offs & ~PMD_MASK) || offs + PMD_SIZE > h->size)
+		return VM_FAULT_FALLBACK;
+
+	if (!h->heap_pgalloc) {
+		phys_addr_t phys = h->carveout->base + offs;
+
+		/* CMA backed carveouts are faulted by struct page */
+		pfn = __phys_to_pfn(phys);
+		if ((phys & ~PMD_MASK) || pfn_valid(pfn))
+			return VM_FAULT_FALLBACK;
+		goto insert;
+	}
+
+	if (atomic_read(&h->pgalloc.reserved))
+		return VM_FAULT_SIGBUS;
+
+	idx = offs >> PAGE_SHIFT;
+	if (!nvmap_is_huge_run(h->pgalloc.pages, idx, h->size >> PAGE_SHIFT))
+		return VM_FAULT_FALLBACK;
+
+	pfn = page_to_pfn(nvmap_to_page(h->pgalloc.pages[idx]));
+insert:
+#if defined(NV_VMF_INSERT_PFN_PMD_HAS_PFN_T_ARG)
+	return vmf_insert_pfn_pmd(vmf, pfn_to_pfn_t(pfn),
+				  vmf->flags & FAULT_FLAG_WRITE);
+#else
+	return vmf_insert_pfn_pmd(vmf, pfn, vmf->flags & FAULT_FLAG_WRITE);
+#endif
+}
+
+#if defined(NV_VM_OPERATIONS_STRUCT_HUGE_FAULT_HAS_ORDER_ARG) /* Linux v6.6 */
+static vm_fault_t nvmap_vma_huge_fault(struct vm_fault *vmf,
+				       unsigned int order)
+{
+	if (order != PMD_SHIFT - PAGE_SHIFT)
+		return VM_FAULT_FALLBACK;
+
+	return nvmap_vma_pmd_fault(vmf);
+}
+#else
+static vm_fault_t nvmap_vma_huge_fault(struct vm_fault *vmf,
+				       enum page_entry_size pe_size)
+{
+	if (pe_size != PE_SIZE_PMD)
+		return VM_FAULT_FALLBACK;
+
+	return nvmap_vma_pmd_fault(vmf);
+}
+#endif
+#endif /* NVMAP_PP_HUGE_PAGES */
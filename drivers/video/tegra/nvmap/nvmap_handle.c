@@ -43,6 +43,9 @@ struct nvmap_handle_ref *__nvmap_validate_locked(struct nvmap_client *c,
 						 struct nvmap_handle *h,
 						 bool is_ro)
 {
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	return xa_load(&c->handle_ref_ids, nvmap_ref_index(h, is_ro));
+#else
 	struct rb_node *n = c->handle_refs.rb_node;
 
 	while (n) {
@@ -57,6 +60,7 @@ struct nvmap_handle_ref *__nvmap_validate_locked(struct nvmap_client *c,
 	}
 
 	return NULL;
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 }
 /* adds a newly-created handle to the device master tree */
 void nvmap_handle_add(struct nvmap_device *dev, struct nvmap_handle *h)
@@ -65,6 +69,10 @@ void nvmap_handle_add(struct nvmap_device *dev, struct nvmap_handle *h)
 	struct rb_node *parent = NULL;
 
 	spin_lock(&dev->handle_lock);
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	/* h->id was reserved by nvmap_create_handle(), this can't fail */
+	xa_store(&dev->handle_ids, h->id, h, GFP_NOWAIT);
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	p = &dev->handles.rb_node;
 	while (*p) {
 		struct nvmap_handle *b;
@@ -106,6 +114,9 @@ int nvmap_handle_remove(struct nvmap_device *dev, struct nvmap_handle *h)
 
 	nvmap_lru_del(h);
 	rb_erase(&h->node, &dev->handles);
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	xa_erase(&dev->handle_ids, h->id);
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 
 	spin_unlock(&dev->handle_lock);
 	return 0;
@@ -116,6 +127,18 @@ int nvmap_handle_remove(struct nvmap_device *dev, struct nvmap_handle *h)
 struct nvmap_handle *nvmap_validate_get(struct nvmap_handle *id)
 {
 	struct nvmap_handle *h = NULL;
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	/*
+	 * Callers already hold a reference on @id, so its ID can be read
+	 * safely; the lockless lookup only checks that the handle has not
+	 * been removed from the device yet.
+	 */
+	h = xa_load(&nvmap_dev->handle_ids, id->id);
+	if (h != id)
+		return NULL;
+
+	return nvmap_handle_get(h);
+#else
 	struct rb_node *n;
 
 	spin_lock(&nvmap_dev->handle_lock);
@@ -136,14 +159,27 @@ struct nvmap_handle *nvmap_validate_get(struct nvmap_handle *id)
 	}
 	spin_unlock(&nvmap_dev->handle_lock);
 	return NULL;
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 }
 
-static void add_handle_ref(struct nvmap_client *client,
-			   struct nvmap_handle_ref *ref)
+static int add_handle_ref(struct nvmap_client *client,
+			  struct nvmap_handle_ref *ref)
 {
 	struct rb_node **p, *parent = NULL;
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	int err;
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 
 	nvmap_ref_lock(client);
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	err = xa_err(xa_store(&client->handle_ref_ids,
+			      nvmap_ref_index(ref->handle, ref->is_ro),
+			      ref, GFP_KERNEL));
+	if (err) {
+		nvmap_ref_unlock(client);
+		return err;
+	}
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	p = &client->handle_refs.rb_node;
 	while (*p) {
 		struct nvmap_handle_ref *node;
@@ -161,6 +197,7 @@ static void add_handle_ref(struct nvmap_client *client,
 		nvmap_max_handle_count = client->handle_count;
 	atomic_inc(&ref->handle->share_count);
 	nvmap_ref_unlock(client);
+	return 0;
 }
 
 struct nvmap_handle_ref *nvmap_create_handle_from_va(struct nvmap_client *client,
@@ -246,7 +283,15 @@ struct nvmap_handle_ref *nvmap_create_handle(struct nvmap_client *client,
 	INIT_LIST_HEAD(&h->dmabuf_priv);
 
 	INIT_LIST_HEAD(&h->pg_ref_h);
+	INIT_LIST_HEAD(&h->maps);
+	mutex_init(&h->maps_lock);
+	mutex_init(&h->pgalloc.populate_lock);
 	init_waitqueue_head(&h->waitq);
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	if (xa_alloc(&nvmap_dev->handle_ids, &h->id, NULL, xa_limit_31b,
+		     GFP_KERNEL))
+		goto id_alloc_fail;
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	/*
 	 * This takes out 1 ref on the dambuf. This corresponds to the
 	 * handle_ref that gets automatically made by nvmap_create_handle().
@@ -269,15 +314,24 @@ struct nvmap_handle_ref *nvmap_create_handle(struct nvmap_client *client,
 	 */
 	atomic_set(&ref->dupes, 1);
 	ref->handle = h;
-	add_handle_ref(client, ref);
 	if (ro_buf)
 		ref->is_ro = true;
 	else
 		ref->is_ro = false;
+	if (add_handle_ref(client, ref)) {
+		kfree(ref);
+		dma_buf_put(dmabuf);
+		nvmap_handle_put(h);
+		return ERR_PTR(-ENOMEM);
+	}
 	trace_nvmap_create_handle(client, client->name, h, size, ref);
 	return ref;
 
 make_dmabuf_fail:
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	xa_erase(&nvmap_dev->handle_ids, h->id);
+id_alloc_fail:
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	kfree(ref);
 ref_alloc_fail:
 	kfree(h);
@@ -382,6 +436,21 @@ struct nvmap_handle_ref *nvmap_duplicate_handle(struct nvmap_client *client,
 		return ERR_PTR(-EINVAL);
 	}
 
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	/*
+	 * Lockless fast path for an existing ref. Refs are freed after an RCU
+	 * grace period and a ref whose dupes already dropped to zero is about
+	 * to be removed, so it is left to the locked path below.
+	 */
+	rcu_read_lock();
+	ref = xa_load(&client->handle_ref_ids, nvmap_ref_index(h, is_ro));
+	if (ref && atomic_inc_not_zero(&ref->dupes)) {
+		rcu_read_unlock();
+		goto out;
+	}
+	rcu_read_unlock();
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
+
 	nvmap_ref_lock(client);
 	ref = __nvmap_validate_locked(client, h, is_ro);
 
@@ -401,19 +470,20 @@ struct nvmap_handle_ref *nvmap_duplicate_handle(struct nvmap_client *client,
 
 	atomic_set(&ref->dupes, 1);
 	ref->handle = h;
-	add_handle_ref(client, ref);
+	ref->is_ro = is_ro;
+	if (is_ro ? !h->dmabuf_ro : !h->dmabuf)
+		goto exit;
 
-	if (is_ro) {
-		ref->is_ro = true;
-		if (!h->dmabuf_ro)
-			goto exit;
+	if (add_handle_ref(client, ref)) {
+		kfree(ref);
+		nvmap_handle_put(h);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	if (is_ro)
 		get_dma_buf(h->dmabuf_ro);
-	} else {
-		ref->is_ro = false;
-		if (!h->dmabuf)
-			goto exit;
+	else
 		get_dma_buf(h->dmabuf);
-	}
 
 out:
 	NVMAP_TAG_TRACE(trace_nvmap_duplicate_handle,
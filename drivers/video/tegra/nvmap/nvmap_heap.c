@@ -21,6 +21,8 @@
 #include <linux/io.h>
 #include <linux/version.h>
 #include <linux/limits.h>
+#include <linux/moduleparam.h>
+#include <linux/workqueue.h>
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 #include <linux/sched/clock.h>
@@ -52,6 +54,22 @@
 
 static struct kmem_cache *heap_block_cache;
 
+#ifdef NVMAP_CONFIG_CARVEOUT_COMPACTION
+/*
+ * Moving a carveout block changes its physical address, which kernel users
+ * may have cached from handle params. Only compact when asked to.
+ */
+static bool nvmap_co_compaction;
+module_param_named(carveout_compaction, nvmap_co_compaction, bool, 0644);
+#endif /* NVMAP_CONFIG_CARVEOUT_COMPACTION */
+
+/*
+ * Map each IVM region once in the kernel and hand out windows of it, so
+ * importing a buffer from another VM doesn't set up a mapping of its own.
+ */
+static bool nvmap_ivm_shared_kmap = true;
+module_param_named(ivm_shared_kmap, nvmap_ivm_shared_kmap, bool, 0644);
+
 struct device *dma_dev_from_handle(unsigned long type)
 {
 	int i;
@@ -84,6 +102,28 @@ size_t nvmap_query_heap_size(struct nvmap_heap *heap)
 	return heap->len;
 }
 
+/*
+ * Largest free extent and number of free extents of a carveout. Falls back
+ * to reporting one page when the layout is not known.
+ */
+int nvmap_query_heap_frag(struct nvmap_heap *heap, u64 *largest,
+			  u32 *nr_free)
+{
+	*largest = PAGE_SIZE;
+	*nr_free = 0;
+	if (!heap)
+		return -EINVAL;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+	if (!heap->cma_dev && !heap->is_ivm)
+		return nvmap_dma_coherent_frag_stats(heap->dma_dev,
+				heap->is_gpu_co ?
+				PAGE_SHIFT_GRANULE(heap->granule_size) :
+				PAGE_SHIFT, largest, nr_free);
+#endif
+	return 0;
+}
+
 void nvmap_heap_debugfs_init(struct dentry *heap_root, struct nvmap_heap *heap)
 {
 	if (sizeof(heap->base) == sizeof(u64))
@@ -407,6 +447,52 @@ struct nvmap_heap *nvmap_block_to_heap(struct nvmap_heap_block *b)
 	return lb->heap;
 }
 
+/*
+ * nvmap_heap_ivm_vaddr: kernel address of IVM handle @h inside the mapping
+ * of its whole region. The region is mapped with the cache attributes of
+ * the first handle asking for it, handles with other attributes get NULL
+ * and map themselves.
+ */
+void *nvmap_heap_ivm_vaddr(struct nvmap_handle *h)
+{
+	struct nvmap_heap *heap = nvmap_block_to_heap(h->carveout);
+	unsigned int flags = h->flags & NVMAP_HANDLE_CACHE_FLAG;
+	void *vaddr = NULL;
+
+	if (!nvmap_ivm_shared_kmap || !heap->is_ivm ||
+	    (heap->base & ~PAGE_MASK) ||
+	    pfn_valid(__phys_to_pfn(heap->base)))
+		return NULL;
+
+	mutex_lock(&heap->lock);
+	if (!heap->ivm_vaddr) {
+		pgprot_t prot = nvmap_pgprot(h, PG_PROT_KERNEL);
+
+#if defined(CONFIG_GENERIC_IOREMAP)
+		heap->ivm_vaddr = ioremap_prot(heap->base, PAGE_ALIGN(heap->len),
+					       pgprot_val(prot));
+#else
+		heap->ivm_vaddr = (__force void *)__ioremap(heap->base,
+					PAGE_ALIGN(heap->len), prot);
+#endif
+		heap->ivm_vaddr_flags = flags;
+	}
+	if (heap->ivm_vaddr && heap->ivm_vaddr_flags == flags)
+		vaddr = heap->ivm_vaddr + (h->carveout->base - heap->base);
+	mutex_unlock(&heap->lock);
+
+	return vaddr;
+}
+
+/* nvmap_heap_vaddr_shared: true if h->vaddr belongs to the region mapping */
+bool nvmap_heap_vaddr_shared(struct nvmap_handle *h)
+{
+	struct nvmap_heap *heap = nvmap_block_to_heap(h->carveout);
+
+	return heap->ivm_vaddr && h->vaddr >= heap->ivm_vaddr &&
+	       h->vaddr < heap->ivm_vaddr + heap->len;
+}
+
 /* nvmap_heap_free: frees block b*/
 void nvmap_heap_free(struct nvmap_heap_block *b)
 {
@@ -440,6 +526,173 @@ void nvmap_heap_free(struct nvmap_heap_block *b)
 	mutex_unlock(&h->lock);
 }
 
+#ifdef NVMAP_CONFIG_CARVEOUT_COMPACTION
+static bool nvmap_heap_block_movable(struct nvmap_heap *heap,
+				     struct nvmap_handle *h)
+{
+	/* IVM peers and the GPU granule page lists track physical layout */
+	if (heap->is_ivm || heap->is_gpu_co || heap->cma_dev)
+		return false;
+
+	if (!(h->heap_type & nvmap_dev->cpu_access_mask))
+		return false;
+
+	return !h->pgalloc.pages && !h->vaddr &&
+	       !atomic_read(&h->pin) &&
+	       !atomic_read(&h->kmap_count) &&
+	       !atomic_read(&h->umap_count) &&
+	       list_empty(&h->vmas) && list_empty(&h->maps);
+}
+
+/*
+ * Slide the block of @h into the lowest free extent that fits, if that is
+ * below its current address. Called with h->lock, h->maps_lock and
+ * heap->lock held so the handle cannot get mapped while it is copied.
+ */
+static int nvmap_heap_move_block(struct nvmap_heap *heap,
+				 struct nvmap_handle *h)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 10, 0)
+	return -EOPNOTSUPP;
+#else
+	struct nvmap_heap_block *b = h->carveout;
+	struct list_block *lb = container_of(b, struct list_block, block);
+	dma_addr_t new_base = DMA_MAPPING_ERROR;
+	phys_addr_t old_base = b->base;
+	void *src, *dst, *ret;
+
+	ret = nvmap_dma_alloc_attrs_lowest(heap->dma_dev, lb->size, &new_base,
+					   DMA_ATTR_ALLOC_EXACT_SIZE);
+	if (IS_ERR(ret) || dma_mapping_error(heap->dma_dev, new_base))
+		return -ENOSPC;
+
+	if (new_base >= old_base) {
+		nvmap_free_mem(heap, new_base, lb->size, h);
+		return -ENOSPC;
+	}
+
+	nvmap_flush_heap_block(NULL, b, lb->size, lb->mem_prot);
+	src = memremap(old_base, lb->size, MEMREMAP_WB);
+	dst = memremap(new_base, lb->size, MEMREMAP_WB);
+	if (!src || !dst) {
+		if (src)
+			memunmap(src);
+		if (dst)
+			memunmap(dst);
+		nvmap_free_mem(heap, new_base, lb->size, h);
+		return -ENOMEM;
+	}
+	memcpy(dst, src, lb->size);
+	memunmap(src);
+	memunmap(dst);
+
+	/* devices access the new block without going through the caches */
+	nvmap_cache_maint_phys_range(NVMAP_CACHE_OP_WB_INV, new_base,
+				     new_base + lb->size, true, true);
+	nvmap_cache_maint_phys_range(NVMAP_CACHE_OP_WB_INV, old_base,
+				     old_base + lb->size, true, true);
+
+	nvmap_free_mem(heap, old_base, lb->size, h);
+	b->base = new_base;
+	lb->orig_addr = new_base;
+	return 0;
+#endif
+}
+
+/*
+ * Walk the blocks from the top of the carveout down, moving every movable
+ * one into the lowest hole it fits into. heap->lock is dropped between
+ * blocks so that allocations are only held off for one copy at a time.
+ */
+static void nvmap_heap_compact_work(struct work_struct *work)
+{
+	struct nvmap_heap *heap = container_of(work, struct nvmap_heap,
+					       compact_work);
+	phys_addr_t cursor = heap->base + heap->len;
+	u64 moved = 0, moved_bytes = 0, skipped = 0;
+
+	for (;;) {
+		struct list_block *lb, *next = NULL;
+		struct nvmap_handle *h;
+		size_t len;
+		int err;
+
+		mutex_lock(&heap->lock);
+		list_for_each_entry(lb, &heap->all_list, all_list) {
+			if (lb->block.base >= cursor)
+				continue;
+			if (!next || lb->block.base > next->block.base)
+				next = lb;
+		}
+		if (!next) {
+			mutex_unlock(&heap->lock);
+			break;
+		}
+		cursor = next->block.base;
+		len = next->size;
+		h = next->block.handle ? nvmap_handle_get(next->block.handle) :
+					 NULL;
+		mutex_unlock(&heap->lock);
+		if (!h)
+			continue;
+
+		nvmap_dmabuf_stash_invalidate(h);
+		mutex_lock(&h->lock);
+		mutex_lock(&h->maps_lock);
+		mutex_lock(&heap->lock);
+		if (h->carveout && nvmap_heap_block_movable(heap, h))
+			err = nvmap_heap_move_block(heap, h);
+		else
+			err = -EBUSY;
+
+		if (!err) {
+			heap->compact_moved++;
+			heap->compact_moved_bytes += len;
+			moved++;
+			moved_bytes += len;
+		} else if (err == -EBUSY) {
+			heap->compact_skipped++;
+			skipped++;
+		}
+		mutex_unlock(&heap->lock);
+		mutex_unlock(&h->maps_lock);
+		mutex_unlock(&h->lock);
+		nvmap_handle_put(h);
+		cond_resched();
+	}
+
+	mutex_lock(&heap->lock);
+	heap->compact_runs++;
+	heap->compacting = false;
+	mutex_unlock(&heap->lock);
+
+	pr_info("%s: compaction moved %llu blocks (%llu bytes), %llu busy\n",
+		heap->name, moved, moved_bytes, skipped);
+}
+
+/* Kick off a compaction pass; progress is reported by QUERY_HEAP_PARAMS */
+int nvmap_heap_compact(struct nvmap_heap *heap)
+{
+	if (!nvmap_co_compaction)
+		return -EPERM;
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 10, 0)
+	return -EOPNOTSUPP;
+#else
+	if (heap->is_ivm || heap->is_gpu_co || heap->cma_dev)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&heap->lock);
+	if (!heap->compacting) {
+		heap->compacting = true;
+		queue_work(system_unbound_wq, &heap->compact_work);
+	}
+	mutex_unlock(&heap->lock);
+	return 0;
+#endif
+}
+#endif /* NVMAP_CONFIG_CARVEOUT_COMPACTION */
+
 /* nvmap_heap_create: create a heap object of len bytes, starting from
  * address base.
  */
@@ -519,6 +772,9 @@ struct nvmap_heap *nvmap_heap_create(struct device *parent,
 
 	INIT_LIST_HEAD(&h->all_list);
 	mutex_init(&h->lock);
+#ifdef NVMAP_CONFIG_CARVEOUT_COMPACTION
+	INIT_WORK(&h->compact_work, nvmap_heap_compact_work);
+#endif /* NVMAP_CONFIG_CARVEOUT_COMPACTION */
 #ifdef NVMAP_CONFIG_DEBUG_MAPS
 	h->device_names = RB_ROOT;
 #endif /* NVMAP_CONFIG_DEBUG_MAPS */
@@ -555,6 +811,9 @@ fail:
 /* nvmap_heap_destroy: frees all resources in heap */
 void nvmap_heap_destroy(struct nvmap_heap *heap)
 {
+#ifdef NVMAP_CONFIG_CARVEOUT_COMPACTION
+	cancel_work_sync(&heap->compact_work);
+#endif /* NVMAP_CONFIG_CARVEOUT_COMPACTION */
 	WARN_ON(!list_empty(&heap->all_list));
 	if (heap->dma_dev->kobj.name)
 		kfree_const(heap->dma_dev->kobj.name);
@@ -562,6 +821,9 @@ void nvmap_heap_destroy(struct nvmap_heap *heap)
 	if (heap->is_ivm)
 		kfree(heap->name);
 
+	if (heap->ivm_vaddr)
+		iounmap((void __iomem *)heap->ivm_vaddr);
+
 #ifdef NVMAP_LOADABLE_MODULE
 	nvmap_dma_release_coherent_memory((struct dma_coherent_mem_replica *)
 					  heap->dma_dev->dma_mem);
@@ -36,10 +36,21 @@ struct nvmap_heap {
 	bool can_alloc; /* Used only if is_ivm == true */
 	unsigned int peer; /* Used only if is_ivm == true */
 	unsigned int vm_id; /* Used only if is_ivm == true */
+	/* Kernel mapping of the whole region, used only if is_ivm == true */
+	void *ivm_vaddr;
+	unsigned int ivm_vaddr_flags;
 	struct nvmap_pm_ops pm_ops;
 #ifdef NVMAP_CONFIG_DEBUG_MAPS
 	struct rb_root device_names;
 #endif /* NVMAP_CONFIG_DEBUG_MAPS */
+#ifdef NVMAP_CONFIG_CARVEOUT_COMPACTION
+	struct work_struct compact_work;
+	bool compacting;
+	u64 compact_runs;
+	u64 compact_moved;		/* blocks moved to a lower address */
+	u64 compact_moved_bytes;
+	u64 compact_skipped;		/* blocks pinned or mapped */
+#endif /* NVMAP_CONFIG_CARVEOUT_COMPACTION */
 };
 
 struct list_block {
@@ -67,6 +78,10 @@ struct nvmap_heap *nvmap_block_to_heap(struct nvmap_heap_block *b);
 
 void nvmap_heap_free(struct nvmap_heap_block *block);
 
+void *nvmap_heap_ivm_vaddr(struct nvmap_handle *h);
+
+bool nvmap_heap_vaddr_shared(struct nvmap_handle *h);
+
 int __init nvmap_heap_init(void);
 
 void nvmap_heap_deinit(void);
@@ -78,5 +93,11 @@ void nvmap_heap_debugfs_init(struct dentry *heap_root, struct nvmap_heap *heap);
 
 int nvmap_query_heap_peer(struct nvmap_heap *heap, unsigned int *peer);
 size_t nvmap_query_heap_size(struct nvmap_heap *heap);
+int nvmap_query_heap_frag(struct nvmap_heap *heap, u64 *largest,
+			  u32 *nr_free);
+
+#ifdef NVMAP_CONFIG_CARVEOUT_COMPACTION
+int nvmap_heap_compact(struct nvmap_heap *heap);
+#endif /* NVMAP_CONFIG_CARVEOUT_COMPACTION */
 
 #endif
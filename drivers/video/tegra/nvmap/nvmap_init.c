@@ -341,6 +341,42 @@ static int __nvmap_init_dt(struct platform_device *pdev)
 }
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+/*
+ * Place contiguous carveout allocations in the smallest free run that fits
+ * rather than the first one. Keeps big free runs intact for big requests
+ * when small and large allocations are mixed over a long uptime.
+ */
+static bool nvmap_co_best_fit = true;
+module_param_named(carveout_best_fit, nvmap_co_best_fit, bool, 0644);
+
+static unsigned long nvmap_bitmap_best_fit(unsigned long *map,
+					   unsigned long size,
+					   unsigned long start,
+					   unsigned int nr,
+					   unsigned long align_mask)
+{
+	unsigned long best = size, best_len = ULONG_MAX;
+	unsigned long rs, re, pos = start;
+
+	while (pos < size) {
+		rs = find_next_zero_bit(map, size, pos);
+		if (rs >= size)
+			break;
+		re = find_next_bit(map, size, rs);
+		pos = re;
+
+		if (__ALIGN_MASK(rs, align_mask) + nr > re)
+			continue;
+		if (re - rs < best_len) {
+			best = __ALIGN_MASK(rs, align_mask);
+			best_len = re - rs;
+			if (best_len == nr)
+				break;
+		}
+	}
+	return best;
+}
+
 static inline struct page **nvmap_kvzalloc_pages(u32 count)
 {
 	if (count * sizeof(struct page *) <= PAGE_SIZE)
@@ -354,7 +390,8 @@ static void *__nvmap_dma_alloc_from_coherent(struct device *dev,
 					     size_t size,
 					     dma_addr_t *dma_handle,
 					     unsigned long attrs,
-					     unsigned long start)
+					     unsigned long start,
+					     bool best_fit)
 {
 	int order = get_order(size);
 	unsigned long flags;
@@ -443,8 +480,12 @@ static void *__nvmap_dma_alloc_from_coherent(struct device *dev,
 	}
 
 	while (count) {
-		pageno = bitmap_find_next_zero_area(mem->bitmap, mem->size,
-						    start, alloc_size, align);
+		if (best_fit && alloc_size > 1)
+			pageno = nvmap_bitmap_best_fit(mem->bitmap, mem->size,
+						       start, alloc_size, align);
+		else
+			pageno = bitmap_find_next_zero_area(mem->bitmap,
+					mem->size, start, alloc_size, align);
 
 		if (pageno >= mem->size)
 			goto err;
@@ -514,10 +555,57 @@ void *nvmap_dma_alloc_attrs(struct device *dev, size_t size,
 	mem = (struct dma_coherent_mem_replica *)(dev->dma_mem);
 
 	return __nvmap_dma_alloc_from_coherent(dev, mem, size, dma_handle,
-						   attrs, 0);
+						   attrs, 0, nvmap_co_best_fit);
 }
 EXPORT_SYMBOL(nvmap_dma_alloc_attrs);
 
+/* Lowest addressed fit, used to slide blocks down when compacting */
+void *nvmap_dma_alloc_attrs_lowest(struct device *dev, size_t size,
+				   dma_addr_t *dma_handle, unsigned long attrs)
+{
+	struct dma_coherent_mem_replica *mem;
+
+	if (!dev || !dev->dma_mem)
+		return NULL;
+
+	mem = (struct dma_coherent_mem_replica *)(dev->dma_mem);
+
+	return __nvmap_dma_alloc_from_coherent(dev, mem, size, dma_handle,
+						   attrs, 0, false);
+}
+
+/*
+ * Free space layout of a declared coherent region, in bytes. unit_shift is
+ * the size of one bitmap bit (PAGE_SHIFT or the GPU carveout granule).
+ */
+int nvmap_dma_coherent_frag_stats(struct device *dev, unsigned int unit_shift,
+				  u64 *largest, u32 *nr_free)
+{
+	struct dma_coherent_mem_replica *mem;
+	unsigned long rs, re, pos = 0, flags;
+
+	*largest = 0;
+	*nr_free = 0;
+	if (!dev || !dev->dma_mem)
+		return -ENODEV;
+
+	mem = (struct dma_coherent_mem_replica *)(dev->dma_mem);
+
+	spin_lock_irqsave(&mem->spinlock, flags);
+	while (pos < mem->size) {
+		rs = find_next_zero_bit(mem->bitmap, mem->size, pos);
+		if (rs >= mem->size)
+			break;
+		re = find_next_bit(mem->bitmap, mem->size, rs);
+		pos = re;
+
+		(*nr_free)++;
+		*largest = max_t(u64, *largest, (u64)(re - rs) << unit_shift);
+	}
+	spin_unlock_irqrestore(&mem->spinlock, flags);
+	return 0;
+}
+
 void nvmap_dma_free_attrs(struct device *dev, size_t size, void *cpu_addr,
 			  dma_addr_t dma_handle, unsigned long attrs)
 {
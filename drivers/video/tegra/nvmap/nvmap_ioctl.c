@@ -13,6 +13,7 @@
 #include <linux/io.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/nvmap.h>
@@ -482,6 +483,37 @@ out:
 	return err;
 }
 
+static int rw_handle_check(struct nvmap_client *client,
+			   struct nvmap_handle *h, int handle, int is_read)
+{
+	bool is_ro = false;
+
+	if (is_nvmap_id_ro(client, handle, &is_ro) != 0) {
+		pr_err("Handle ID RO check failed\n");
+		return -EINVAL;
+	}
+
+	/* Don't allow write on RO handle */
+	if (!is_read && is_ro) {
+		pr_err("Write operation is not allowed on RO handle\n");
+		return -EPERM;
+	}
+
+	if (is_read && h->heap_type == NVMAP_HEAP_CARVEOUT_VPR) {
+		pr_err("CPU read operation is not allowed on VPR carveout\n");
+		return -EPERM;
+	}
+
+	/*
+	 * If Buffer is RO and write operation is asked from the buffer,
+	 * return error.
+	 */
+	if (h->is_ro && !is_read)
+		return -EPERM;
+
+	return 0;
+}
+
 int nvmap_ioctl_rw_handle(struct file *filp, int is_read, void __user *arg,
 			  size_t op_size)
 {
@@ -498,7 +530,6 @@ int nvmap_ioctl_rw_handle(struct file *filp, int is_read, void __user *arg,
 	unsigned long addr, offset, elem_size, hmem_stride, user_stride;
 	unsigned long count;
 	int handle;
-	bool is_ro = false;
 
 #ifdef CONFIG_COMPAT
 	if (op_size == sizeof(op32)) {
@@ -532,33 +563,9 @@ int nvmap_ioctl_rw_handle(struct file *filp, int is_read, void __user *arg,
 	if (IS_ERR_OR_NULL(h))
 		return -EINVAL;
 
-	if (is_nvmap_id_ro(client, handle, &is_ro) != 0) {
-		pr_err("Handle ID RO check failed\n");
-		err = -EINVAL;
-		goto fail;
-	}
-
-	/* Don't allow write on RO handle */
-	if (!is_read && is_ro) {
-		pr_err("Write operation is not allowed on RO handle\n");
-		err = -EPERM;
-		goto fail;
-	}
-
-	if (is_read && h->heap_type == NVMAP_HEAP_CARVEOUT_VPR) {
-		pr_err("CPU read operation is not allowed on VPR carveout\n");
-		err = -EPERM;
-		goto fail;
-	}
-
-	/*
-	 * If Buffer is RO and write operation is asked from the buffer,
-	 * return error.
-	 */
-	if (h->is_ro && !is_read) {
-		err = -EPERM;
+	err = rw_handle_check(client, h, handle, is_read);
+	if (err)
 		goto fail;
-	}
 
 	nvmap_kmaps_inc(h);
 	trace_nvmap_ioctl_rw_handle(client, h, is_read, offset,
@@ -646,6 +653,115 @@ close_fd:
 	return SYS_CLOSE(arg);
 }
 
+#define NVMAP_RW_LIST_MAX_NR	4096
+
+/*
+ * Vectored NVMAP_IOC_READ/WRITE. Consecutive records on the same handle
+ * share one handle lookup and permission check, and records that are
+ * contiguous both in the handle and in user memory are copied as one. The
+ * kernel mapping is the handle's cached h->vaddr, which stays around until
+ * the handle is freed, so only the first access to a handle maps it.
+ */
+int nvmap_ioctl_rw_handle_list(struct file *filp, void __user *arg)
+{
+	struct nvmap_client *client = filp->private_data;
+	struct nvmap_rw_handle_list __user *uarg = arg;
+	struct nvmap_rw_handle_list op;
+	struct nvmap_rw_vec *vecs;
+	struct nvmap_handle *h = NULL;
+	u32 cur_handle = 0, i, j, done = 0;
+	int cur_read = -1;
+	size_t bytes;
+	int err = 0;
+
+	if (copy_from_user(&op, arg, sizeof(op)))
+		return -EFAULT;
+
+	if (!op.nr || op.nr > NVMAP_RW_LIST_MAX_NR)
+		return -EINVAL;
+
+	bytes = op.nr * sizeof(*vecs);
+	vecs = nvmap_altalloc(bytes);
+	if (!vecs)
+		return -ENOMEM;
+
+	if (copy_from_user(vecs, (void __user *)(uintptr_t)op.vecs, bytes)) {
+		err = -EFAULT;
+		goto free_vecs;
+	}
+
+	for (i = 0; i < op.nr; i = j) {
+		struct nvmap_rw_vec *v = &vecs[i];
+		int is_read = !!(v->flags & NVMAP_RW_VEC_READ);
+		unsigned long len = v->len;
+		ssize_t copied;
+
+		if (!v->addr || !v->len) {
+			err = -EINVAL;
+			break;
+		}
+
+		/* fold in the records that continue this one */
+		for (j = i + 1; j < op.nr; j++) {
+			struct nvmap_rw_vec *n = &vecs[j];
+
+			if (n->handle != v->handle || n->flags != v->flags ||
+			    !n->len || n->offset != v->offset + len ||
+			    n->addr != v->addr + len)
+				break;
+			len += n->len;
+		}
+
+		if (!h || v->handle != cur_handle) {
+			if (h) {
+				nvmap_kmaps_dec(h);
+				nvmap_handle_put(h);
+			}
+			h = nvmap_handle_get_from_id(client, v->handle);
+			if (IS_ERR_OR_NULL(h)) {
+				h = NULL;
+				err = -EINVAL;
+				break;
+			}
+			cur_handle = v->handle;
+			cur_read = -1;
+			nvmap_kmaps_inc(h);
+		}
+
+		if (is_read != cur_read) {
+			err = rw_handle_check(client, h, v->handle, is_read);
+			if (err)
+				break;
+			cur_read = is_read;
+		}
+
+		trace_nvmap_ioctl_rw_handle(client, h, is_read, v->offset,
+					    v->addr, len, len, len, 1);
+		copied = rw_handle(client, h, is_read, v->offset, v->addr,
+				   len, len, len, 1);
+		if (copied < 0) {
+			err = copied;
+			break;
+		} else if (copied < len) {
+			err = -EINTR;
+			break;
+		}
+		done = j;
+	}
+
+	if (h) {
+		nvmap_kmaps_dec(h);
+		nvmap_handle_put(h);
+	}
+
+	if (put_user(done, &uarg->nr_done))
+		err = -EFAULT;
+
+free_vecs:
+	nvmap_altfree(vecs, bytes);
+	return err;
+}
+
 static ssize_t rw_handle(struct nvmap_client *client, struct nvmap_handle *h,
 			 int is_read, unsigned long h_offs,
 			 unsigned long sys_addr, unsigned long h_stride,
@@ -1223,49 +1339,36 @@ exit:
 }
 
 #ifdef NVMAP_CONFIG_SCIIPC
-int nvmap_ioctl_get_sci_ipc_id(struct file *filp, void __user *arg)
+/* Max entries of one SCI_IPC_ID list ioctl */
+#define NVMAP_SCIIPC_LIST_MAX_NR	1024
+
+static int nvmap_sci_ipc_export(struct nvmap_client *client,
+				struct nvmap_sciipc_map *op,
+				NvSciIpcEndpointVuid pr_vuid)
 {
-	struct nvmap_client *client = filp->private_data;
-	NvSciIpcEndpointVuid pr_vuid, lclu_vuid;
 	struct nvmap_handle *handle = NULL;
-	struct nvmap_sciipc_map op;
 	struct dma_buf *dmabuf = NULL;
 	bool is_ro = false;
 	int ret = 0;
 
-	if (copy_from_user(&op, arg, sizeof(op)))
-		return -EFAULT;
-
-	handle = nvmap_handle_get_from_id(client, op.handle);
+	handle = nvmap_handle_get_from_id(client, op->handle);
 	if (IS_ERR_OR_NULL(handle))
 		return -ENODEV;
 
-	if (is_nvmap_id_ro(client, op.handle, &is_ro) != 0) {
+	if (is_nvmap_id_ro(client, op->handle, &is_ro) != 0) {
 		pr_err("Handle ID RO check failed\n");
 		ret = -EINVAL;
 		goto exit;
 	}
 
 	/* Cannot create RW handle from RO handle */
-	if (is_ro && (op.flags != PROT_READ)) {
+	if (is_ro && (op->flags != PROT_READ)) {
 		ret = -EPERM;
 		goto exit;
 	}
 
-	ret = nvmap_validate_sci_ipc_params(client, op.auth_token,
-		&pr_vuid, &lclu_vuid);
-	if (ret)
-		goto exit;
-
-	ret = nvmap_create_sci_ipc_id(client, handle, op.flags,
-			 &op.sci_ipc_id, pr_vuid, is_ro);
-	if (ret)
-		goto exit;
-
-	if (copy_to_user(arg, &op, sizeof(op))) {
-		pr_err("copy_to_user failed\n");
-		ret = -EINVAL;
-	}
+	ret = nvmap_create_sci_ipc_id(client, handle, op->flags,
+			 &op->sci_ipc_id, pr_vuid, is_ro);
 
 exit:
 	if (!ret) {
@@ -1280,6 +1383,33 @@ exit:
 	return ret;
 }
 
+int nvmap_ioctl_get_sci_ipc_id(struct file *filp, void __user *arg)
+{
+	struct nvmap_client *client = filp->private_data;
+	NvSciIpcEndpointVuid pr_vuid, lclu_vuid;
+	struct nvmap_sciipc_map op;
+	int ret = 0;
+
+	if (copy_from_user(&op, arg, sizeof(op)))
+		return -EFAULT;
+
+	ret = nvmap_validate_sci_ipc_params(client, op.auth_token,
+		&pr_vuid, &lclu_vuid);
+	if (ret)
+		return ret;
+
+	ret = nvmap_sci_ipc_export(client, &op, pr_vuid);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(arg, &op, sizeof(op))) {
+		pr_err("copy_to_user failed\n");
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
 int nvmap_ioctl_handle_from_sci_ipc_id(struct file *filp, void __user *arg)
 {
 	struct nvmap_client *client = filp->private_data;
@@ -1309,6 +1439,80 @@ int nvmap_ioctl_handle_from_sci_ipc_id(struct file *filp, void __user *arg)
 exit:
 	return ret;
 }
+
+/*
+ * Export or import a list of buffers of one SciIpc endpoint. The auth
+ * token is validated once for the whole list, entries are processed in
+ * order up to the first error and nr_done tells how many succeeded.
+ */
+static int nvmap_ioctl_sci_ipc_id_list(struct file *filp, void __user *arg,
+				       bool import)
+{
+	struct nvmap_client *client = filp->private_data;
+	struct nvmap_sciipc_map_list __user *uarg = arg;
+	NvSciIpcEndpointVuid pr_vuid, lclu_vuid;
+	struct nvmap_sciipc_map_list op;
+	struct nvmap_sciipc_map *maps;
+	u32 i, done = 0;
+	size_t bytes;
+	int err;
+
+	if (copy_from_user(&op, arg, sizeof(op)))
+		return -EFAULT;
+
+	if (!op.nr || op.nr > NVMAP_SCIIPC_LIST_MAX_NR)
+		return -EINVAL;
+
+	err = nvmap_validate_sci_ipc_params(client, op.auth_token,
+		&pr_vuid, &lclu_vuid);
+	if (err)
+		return err;
+
+	bytes = op.nr * sizeof(*maps);
+	maps = nvmap_altalloc(bytes);
+	if (!maps)
+		return -ENOMEM;
+
+	if (copy_from_user(maps, (void __user *)(uintptr_t)op.maps, bytes)) {
+		err = -EFAULT;
+		goto free_maps;
+	}
+
+	for (i = 0; i < op.nr; i++) {
+		if (import)
+			err = nvmap_get_handle_from_sci_ipc_id(client,
+					maps[i].flags, maps[i].sci_ipc_id,
+					lclu_vuid, &maps[i].handle);
+		else
+			err = nvmap_sci_ipc_export(client, &maps[i], pr_vuid);
+		if (err)
+			break;
+		done++;
+	}
+
+	if (done && copy_to_user((void __user *)(uintptr_t)op.maps, maps,
+				 done * sizeof(*maps))) {
+		pr_err("copy_to_user failed\n");
+		err = -EINVAL;
+	}
+
+	if (put_user(done, &uarg->nr_done))
+		err = -EFAULT;
+
+free_maps:
+	nvmap_altfree(maps, bytes);
+	return err;
+}
+
+int nvmap_ioctl_get_sci_ipc_id_list(struct file *filp, void __user *arg)
+{
+	return nvmap_ioctl_sci_ipc_id_list(filp, arg, false);
+}
+
+int nvmap_ioctl_handle_from_sci_ipc_id_list(struct file *filp, void __user *arg)
+{
+	return nvmap_ioctl_sci_ipc_id_list(filp, arg, true);
+}
 #else
 int nvmap_ioctl_get_sci_ipc_id(struct file *filp, void __user *arg)
 {
@@ -1318,6 +1522,14 @@ int nvmap_ioctl_handle_from_sci_ipc_id(struct file *filp, void __user *arg)
 {
 	return -EPERM;
 }
+int nvmap_ioctl_get_sci_ipc_id_list(struct file *filp, void __user *arg)
+{
+	return -EPERM;
+}
+int nvmap_ioctl_handle_from_sci_ipc_id_list(struct file *filp, void __user *arg)
+{
+	return -EPERM;
+}
 #endif
 
 /*
@@ -1365,24 +1577,26 @@ static unsigned long system_heap_total_mem(void)
 	return sys_heap.totalram << PAGE_SHIFT;
 }
 
-int nvmap_ioctl_query_heap_params(struct file *filp, void __user *arg)
+int nvmap_ioctl_query_heap_params(struct file *filp, void __user *arg,
+		size_t op_size)
 {
 	unsigned int carveout_mask = NVMAP_HEAP_CARVEOUT_MASK;
 	unsigned int iovmm_mask = NVMAP_HEAP_IOVMM;
-	struct nvmap_query_heap_params op;
-	struct nvmap_heap *heap;
+	struct nvmap_query_heap_params_ext ext;
+	struct nvmap_query_heap_params *op = &ext.params;
+	struct nvmap_heap *heap = NULL;
 	unsigned int type;
 	int ret = 0;
 	int i;
 	unsigned long free_mem = 0;
 
-	memset(&op, 0, sizeof(op));
-	if (copy_from_user(&op, arg, sizeof(op))) {
+	memset(&ext, 0, sizeof(ext));
+	if (copy_from_user(&ext, arg, op_size)) {
 		ret =  -EFAULT;
 		goto exit;
 	}
 
-	type = op.heap_mask;
+	type = op->heap_mask;
 	WARN_ON(type & (type - 1));
 
 	if (nvmap_convert_carveout_to_iovmm) {
@@ -1395,17 +1609,16 @@ int nvmap_ioctl_query_heap_params(struct file *filp, void __user *arg)
 		}
 	}
 
-	/* To Do: select largest free block */
-	op.largest_free_block = PAGE_SIZE;
+	op->largest_free_block = PAGE_SIZE;
 
 	if (type & NVMAP_HEAP_CARVEOUT_MASK) {
 		for (i = 0; i < nvmap_dev->nr_carveouts; i++) {
 			if (type & nvmap_dev->heaps[i].heap_bit) {
 				heap = nvmap_dev->heaps[i].carveout;
-				op.total = nvmap_query_heap_size(heap);
-				op.free = heap->free_size;
+				op->total = nvmap_query_heap_size(heap);
+				op->free = heap->free_size;
 				if (nvmap_dev->heaps[i].carveout->is_gpu_co)
-					op.granule_size = nvmap_dev->heaps[i].carveout->granule_size;
+					op->granule_size = nvmap_dev->heaps[i].carveout->granule_size;
 				break;
 			}
 		}
@@ -1413,16 +1626,44 @@ int nvmap_ioctl_query_heap_params(struct file *filp, void __user *arg)
 		if (i >= nvmap_dev->nr_carveouts)
 			return -ENODEV;
 
+		nvmap_query_heap_frag(heap, &op->largest_free_block,
+				      &ext.nr_free_blocks);
+		if (op->free && op->largest_free_block < op->free)
+			ext.fragmentation = 100 - div64_u64(
+				op->largest_free_block * 100, op->free);
+
+		if (op_size == sizeof(ext)) {
+#ifdef NVMAP_CONFIG_CARVEOUT_COMPACTION
+			if (op->flags & NVMAP_HEAP_QUERY_COMPACT) {
+				ret = nvmap_heap_compact(heap);
+				if (ret)
+					goto exit;
+			}
+
+			mutex_lock(&heap->lock);
+			ext.compacting = heap->compacting;
+			ext.compact_runs = heap->compact_runs;
+			ext.compact_moved = heap->compact_moved;
+			ext.compact_moved_bytes = heap->compact_moved_bytes;
+			ext.compact_skipped = heap->compact_skipped;
+			mutex_unlock(&heap->lock);
+#else
+			if (op->flags & NVMAP_HEAP_QUERY_COMPACT) {
+				ret = -EOPNOTSUPP;
+				goto exit;
+			}
+#endif /* NVMAP_CONFIG_CARVEOUT_COMPACTION */
+		}
 	} else if (type & iovmm_mask) {
-		op.total = system_heap_total_mem();
+		op->total = system_heap_total_mem();
 		ret = system_heap_free_mem(&free_mem);
 		if (ret)
 			goto exit;
-		op.free = free_mem;
-		op.granule_size = PAGE_SIZE;
+		op->free = free_mem;
+		op->granule_size = PAGE_SIZE;
 	}
 
-	if (copy_to_user(arg, &op, sizeof(op)))
+	if (copy_to_user(arg, &ext, op_size))
 		ret = -EFAULT;
 exit:
 	return ret;
@@ -44,6 +44,8 @@ int nvmap_ioctl_cache_maint(struct file *filp, void __user *arg, int size);
 int nvmap_ioctl_rw_handle(struct file *filp, int is_read, void __user *arg,
 	size_t op_size);
 
+int nvmap_ioctl_rw_handle_list(struct file *filp, void __user *arg);
+
 int nvmap_ioctl_cache_maint_list(struct file *filp, void __user *arg);
 
 int nvmap_ioctl_gup_test(struct file *filp, void __user *arg);
@@ -62,7 +64,12 @@ int nvmap_ioctl_get_sci_ipc_id(struct file *filp, void __user *arg);
 
 int nvmap_ioctl_handle_from_sci_ipc_id(struct file *filp, void __user *arg);
 
-int nvmap_ioctl_query_heap_params(struct file *filp, void __user *arg);
+int nvmap_ioctl_get_sci_ipc_id_list(struct file *filp, void __user *arg);
+
+int nvmap_ioctl_handle_from_sci_ipc_id_list(struct file *filp, void __user *arg);
+
+int nvmap_ioctl_query_heap_params(struct file *filp, void __user *arg,
+		size_t op_size);
 
 int nvmap_ioctl_dup_handle(struct file *filp, void __user *arg);
 
@@ -16,9 +16,15 @@
 #include <linux/shrinker.h>
 #include <linux/kthread.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/percpu.h>
 #include <linux/freezer.h>
 #include <linux/highmem.h>
 #include <linux/version.h>
+#include <linux/cpumask.h>
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/sched/loadavg.h>
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 #include <linux/sched/clock.h>
@@ -38,6 +44,43 @@ static u32 pool_size;
 static struct task_struct *background_allocator;
 static DECLARE_WAIT_QUEUE_HEAD(nvmap_bg_wait);
 
+/*
+ * Background zeroing is throttled once the pool holds enough zeroed pages
+ * or the system is loaded; zero_throttle_ms is the back off per pass and
+ * 0 disables throttling.
+ */
+static u32 zero_throttle_ms = 10;
+module_param(zero_throttle_ms, uint, 0644);
+
+/*
+ * CPUs the zeroing thread may run on. Empty means the CPUs of the node the
+ * nvmap device lives on, so pages are zeroed close to their memory; setting a
+ * CPU list allows pinning it to a cluster that is not used by the media
+ * pipelines.
+ */
+static struct cpumask bg_zero_cpus;
+
+#ifdef NVMAP_CONFIG_PAGE_POOL_DMA_ZERO
+#define NVMAP_PP_DMA_ZERO_TIMEOUT_MS      1000
+
+static bool dma_zero = true;
+module_param(dma_zero, bool, 0644);
+
+static struct dma_chan *nvmap_pp_dma_chan;
+#endif /* NVMAP_CONFIG_PAGE_POOL_DMA_ZERO */
+
+/* Background zeroing stats, only updated by the zeroing thread */
+static struct nvmap_pp_zero_stats {
+	u64 cpu_bytes;
+	u64 dma_bytes;
+	u64 dma_fallbacks;
+	u64 throttled;
+	u64 cpu_time_ns;
+	u64 bytes_per_sec;
+	u64 window_start;
+	u64 window_bytes;
+} zero_stats;
+
 #ifdef NVMAP_CONFIG_PAGE_POOL_DEBUG
 static inline void __pp_dbg_var_add(u64 *dbg_var, u32 nr)
 {
@@ -139,8 +182,49 @@ exit:
 }
 #endif /* CONFIG_ARM64_4K_PAGES */
 
+#ifdef NVMAP_PP_HUGE_PAGES
+static inline struct page *get_huge_list_page(struct nvmap_page_pool *pool,
+					      bool use_numa, int numa_id)
+{
+	struct page *page, *tmp;
+	int nid = numa_id == NUMA_NO_NODE ? numa_mem_id() : numa_id;
+
+	if (list_empty(&pool->huge_list))
+		return NULL;
+
+	if (!use_numa) {
+		page = list_first_entry(&pool->huge_list, struct page, lru);
+		goto exit;
+	} else {
+		list_for_each_entry_safe(page, tmp, &pool->huge_list, lru)
+			if (page_to_nid(page) == nid)
+				goto exit;
+	}
+	return NULL;
+
+exit:
+	list_del(&page->lru);
+	pool->huge_count -= pool->pages_per_huge_pg;
+	return page;
+}
+
+/*
+ * Max number of pages the huge tier may hold. The tier shares the pool
+ * size with the small page lists and is capped to half of it, so that
+ * small allocations keep a warm pool.
+ */
+static inline u32 nvmap_pp_huge_max(struct nvmap_page_pool *pool)
+{
+	return pool->max / 2;
+}
+#endif /* NVMAP_PP_HUGE_PAGES */
+
 static inline bool nvmap_bg_should_run(struct nvmap_page_pool *pool)
 {
+#ifdef NVMAP_PP_HUGE_PAGES
+	if (!list_empty(&pool->huge_zero_list))
+		return true;
+#endif /* NVMAP_PP_HUGE_PAGES */
 	return !list_empty(&pool->zero_list);
 }
 
@@ -156,6 +240,152 @@ static void nvmap_pp_zero_pages(struct page **pages, int nr)
 	trace_nvmap_pp_zero_pages(nr);
 }
 
+#ifdef NVMAP_CONFIG_PAGE_POOL_DMA_ZERO
+static void nvmap_pp_dma_zero_done(void *arg)
+{
+	complete(arg);
+}
+
+/*
+ * Zero @nr chunks of @size bytes each with a dmaengine memset. The channel
+ * completes descriptors in order, so only the last one needs a callback.
+ * Mapping the chunks DMA_FROM_DEVICE invalidates any stale CPU cache lines,
+ * so no cache maintenance is needed afterwards. On any failure the channel
+ * is terminated and the caller has to zero all the chunks with the CPU.
+ */
+static int nvmap_pp_dma_zero(struct page **pages, int nr, size_t size)
+{
+	/* Local to the zeroing thread, like pending_zero_pages */
+	static dma_addr_t addrs[PENDING_PAGES_SIZE];
+	struct dma_chan *chan = nvmap_pp_dma_chan;
+	struct dma_async_tx_descriptor *tx;
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct device *dev;
+	dma_cookie_t cookie;
+	int i, mapped = 0;
+	int ret = 0;
+
+	if (!chan || !READ_ONCE(dma_zero) || !nr)
+		return -ENODEV;
+
+	dev = chan->device->dev;
+	for (i = 0; i < nr; i++) {
+		addrs[i] = dma_map_page(dev, pages[i], 0, size, DMA_FROM_DEVICE);
+		if (dma_mapping_error(dev, addrs[i])) {
+			ret = -ENOMEM;
+			goto terminate;
+		}
+		mapped++;
+
+		tx = dmaengine_prep_dma_memset(chan, addrs[i], 0, size,
+				i == nr - 1 ? DMA_PREP_INTERRUPT : 0);
+		if (!tx) {
+			ret = -EIO;
+			goto terminate;
+		}
+		if (i == nr - 1) {
+			tx->callback = nvmap_pp_dma_zero_done;
+			tx->callback_param = &done;
+		}
+		cookie = dmaengine_submit(tx);
+		if (dma_submit_error(cookie)) {
+			ret = -EIO;
+			goto terminate;
+		}
+	}
+
+	dma_async_issue_pending(chan);
+	if (!wait_for_completion_timeout(&done,
+			msecs_to_jiffies(NVMAP_PP_DMA_ZERO_TIMEOUT_MS))) {
+		ret = -ETIMEDOUT;
+		goto terminate;
+	}
+	goto unmap;
+
+terminate:
+	dmaengine_terminate_sync(chan);
+unmap:
+	for (i = 0; i < mapped; i++)
+		dma_unmap_page(dev, addrs[i], size, DMA_FROM_DEVICE);
+	return ret;
+}
+#else
+static inline int nvmap_pp_dma_zero(struct page **pages, int nr, size_t size)
+{
+	return -ENODEV;
+}
+#endif /* NVMAP_CONFIG_PAGE_POOL_DMA_ZERO */
+
+/*
+ * Zero @nr chunks of @size bytes for the background thread, preferring the
+ * DMA engine and falling back to the CPU.
+ */
+static void nvmap_pp_bg_zero(struct page **pages, int nr, size_t size)
+{
+	u64 bytes = (u64)nr * size;
+	u64 now, t_start;
+	int i, j;
+	int ret;
+
+	if (!nr)
+		return;
+
+	t_start = local_clock();
+	ret = nvmap_pp_dma_zero(pages, nr, size);
+	if (!ret) {
+		zero_stats.dma_bytes += bytes;
+	} else {
+		if (ret != -ENODEV)
+			zero_stats.dma_fallbacks++;
+		for (i = 0; i < nr; i++) {
+			for (j = 0; j < size >> PAGE_SHIFT; j++) {
+				clear_highpage(nth_page(pages[i], j));
+				nvmap_clean_cache_page(nth_page(pages[i], j));
+			}
+		}
+		zero_stats.cpu_bytes += bytes;
+	}
+	trace_nvmap_pp_zero_pages(bytes >> PAGE_SHIFT);
+
+	zero_stats.cpu_time_ns = current->se.sum_exec_runtime;
+	now = local_clock();
+	nvmap_stats_lat_pp_zero(now - t_start);
+	if (!zero_stats.window_start)
+		zero_stats.window_start = now;
+	zero_stats.window_bytes += bytes;
+	if (now - zero_stats.window_start >= NSEC_PER_SEC) {
+		zero_stats.bytes_per_sec = div64_u64(zero_stats.window_bytes *
+				NSEC_PER_SEC, now - zero_stats.window_start);
+		zero_stats.window_start = now;
+		zero_stats.window_bytes = 0;
+	}
+}
+
+static inline bool nvmap_pp_system_busy(void)
+{
+	return (avenrun[0] >> FSHIFT) >= num_online_cpus();
+}
+
+/*
+ * Back off between zeroing passes unless the pool is running low. Zeroed
+ * pages are only urgent when allocations are about to miss the pool, so a
+ * well filled pool or a busy system makes the thread yield its CPU (and the
+ * DMA engine) to the camera and DLA pipelines.
+ */
+static void nvmap_pp_bg_throttle(struct nvmap_page_pool *pool)
+{
+	u32 ms = READ_ONCE(zero_throttle_ms);
+	u32 count = READ_ONCE(pool->count);
+
+	if (!ms || count < pool->max / 8)
+		return;
+
+	if (count >= pool->max / 2 || nvmap_pp_system_busy()) {
+		zero_stats.throttled++;
+		schedule_timeout_interruptible(msecs_to_jiffies(ms));
+	}
+}
+
 static void nvmap_pp_do_background_zero_pages(struct nvmap_page_pool *pool)
 {
 	int i;
@@ -177,7 +407,7 @@ static void nvmap_pp_do_background_zero_pages(struct nvmap_page_pool *pool)
 	}
 	rt_mutex_unlock(&pool->lock);
 
-	nvmap_pp_zero_pages(pending_zero_pages, i);
+	nvmap_pp_bg_zero(pending_zero_pages, i, PAGE_SIZE);
 
 	rt_mutex_lock(&pool->lock);
 	ret = __nvmap_page_pool_fill_lots_locked(pool, pending_zero_pages, i);
@@ -188,6 +418,31 @@ static void nvmap_pp_do_background_zero_pages(struct nvmap_page_pool *pool)
 
 	for (; ret < i; ret++)
 		__free_page(pending_zero_pages[ret]);
+
+#ifdef NVMAP_PP_HUGE_PAGES
+	/* Zero one 2MB chunk per pass so the small page lists keep up */
+	rt_mutex_lock(&pool->lock);
+	page = NULL;
+	if (!list_empty(&pool->huge_zero_list)) {
+		page = list_first_entry(&pool->huge_zero_list, struct page,
+					lru);
+		list_del(&page->lru);
+		pool->huge_to_zero -= pool->pages_per_huge_pg;
+		pool->under_zero += pool->pages_per_huge_pg;
+	}
+	rt_mutex_unlock(&pool->lock);
+
+	if (!page)
+		return;
+
+	nvmap_pp_bg_zero(&page, 1, NVMAP_PP_HUGE_PAGE_SIZE);
+
+	rt_mutex_lock(&pool->lock);
+	list_add_tail(&page->lru, &pool->huge_list);
+	pool->huge_count += pool->pages_per_huge_pg;
+	pool->under_zero -= pool->pages_per_huge_pg;
+	rt_mutex_unlock(&pool->lock);
+#endif /* NVMAP_PP_HUGE_PAGES */
 }
 
 /*
@@ -215,8 +470,11 @@ static int nvmap_background_zero_thread(void *arg)
 #endif
 
 	while (!kthread_should_stop()) {
-		while (nvmap_bg_should_run(pool))
+		while (nvmap_bg_should_run(pool) && !kthread_should_stop()) {
 			nvmap_pp_do_background_zero_pages(pool);
+			nvmap_pp_bg_throttle(pool);
+			try_to_freeze();
+		}
 
 		wait_event_freezable(nvmap_bg_wait,
 				nvmap_bg_should_run(pool) ||
@@ -233,6 +491,204 @@ static void nvmap_pgcount(struct page *page, bool incr)
 }
 #endif /* NVMAP_CONFIG_PAGE_POOL_DEBUG */
 
+/*
+ * Per-CPU magazines. A magazine only holds zeroed pages taken from
+ * page_list (and page_list_bp), so pages handed out from it need no further
+ * work. Pages in magazines are accounted in pool->pcp_count and are still
+ * considered part of the pool by the shrinker and pool size checks.
+ *
+ * The per-CPU spinlock is normally only taken by its own CPU; drains of
+ * remote magazines happen with the global pool lock held.
+ */
+static u32 nvmap_pp_pcp_alloc(struct nvmap_page_pool *pool,
+			      struct page **pages, u32 nr,
+			      bool use_numa, int numa_id)
+{
+	struct nvmap_pp_pcp *pcp;
+	int nid = numa_id == NUMA_NO_NODE ? numa_mem_id() : numa_id;
+	u32 ind = 0;
+
+	if (!pool->pcp)
+		return 0;
+
+	pcp = raw_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	while (ind < nr && pcp->nr) {
+		struct page *page = pcp->pages[pcp->nr - 1];
+
+		if (use_numa && page_to_nid(page) != nid)
+			break;
+
+		pcp->nr--;
+		pages[ind++] = page;
+#ifdef NVMAP_CONFIG_PAGE_POOL_DEBUG
+		nvmap_pgcount(page, false);
+		BUG_ON(page_count(page) != 1);
+#endif /* NVMAP_CONFIG_PAGE_POOL_DEBUG */
+	}
+	pcp->hits += ind;
+	pcp->misses += nr - ind;
+	spin_unlock(&pcp->lock);
+
+	atomic_sub(ind, &pool->pcp_count);
+	return ind;
+}
+
+/*
+ * Top up this CPU's magazine by one batch from the global pool.
+ *
+ * You must lock the page pool before using this.
+ */
+static void nvmap_pp_pcp_refill_locked(struct nvmap_page_pool *pool,
+				       bool use_numa, int numa_id)
+{
+	struct nvmap_pp_pcp *pcp;
+	struct page *page;
+	u32 nr = 0;
+
+	if (!pool->pcp)
+		return;
+
+	pcp = raw_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->nr >= NVMAP_PP_PCP_BATCH)
+		goto unlock;
+
+	while (nr < NVMAP_PP_PCP_BATCH && pcp->nr < NVMAP_PP_PCP_SIZE) {
+		page = get_page_list_page(pool, use_numa, numa_id);
+		if (!page)
+			break;
+		pcp->pages[pcp->nr++] = page;
+		nr++;
+	}
+	if (nr)
+		pcp->refills++;
+unlock:
+	spin_unlock(&pcp->lock);
+
+	atomic_add(nr, &pool->pcp_count);
+}
+
+#ifdef CONFIG_ARM64_4K_PAGES
+static u32 nvmap_pp_pcp_alloc_bp(struct nvmap_page_pool *pool,
+				 struct page **pages, u32 nr,
+				 bool use_numa, int numa_id)
+{
+	struct nvmap_pp_pcp *pcp;
+	int nid = numa_id == NUMA_NO_NODE ? numa_mem_id() : numa_id;
+	u32 ind = 0;
+	int i;
+
+	if (!pool->pcp)
+		return 0;
+
+	pcp = raw_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	while (nr - ind >= pool->pages_per_big_pg && pcp->nr_bp) {
+		struct page *page = pcp->bp[pcp->nr_bp - 1];
+
+		if (use_numa && page_to_nid(page) != nid)
+			break;
+
+		pcp->nr_bp--;
+		for (i = 0; i < pool->pages_per_big_pg; i++)
+			pages[ind + i] = nth_page(page, i);
+		ind += pool->pages_per_big_pg;
+	}
+	pcp->hits += ind;
+	pcp->misses += (nr - ind) & ~(pool->pages_per_big_pg - 1);
+	spin_unlock(&pcp->lock);
+
+	atomic_sub(ind, &pool->pcp_count);
+	return ind;
+}
+
+static void nvmap_pp_pcp_refill_bp_locked(struct nvmap_page_pool *pool,
+					  bool use_numa, int numa_id)
+{
+	struct nvmap_pp_pcp *pcp;
+	struct page *page;
+	u32 nr = 0;
+
+	if (!pool->pcp)
+		return;
+
+	pcp = raw_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->nr_bp >= NVMAP_PP_PCP_BP_BATCH)
+		goto unlock;
+
+	while (nr < NVMAP_PP_PCP_BP_BATCH && pcp->nr_bp < NVMAP_PP_PCP_BP_SIZE) {
+		page = get_page_list_page_bp(pool, use_numa, numa_id);
+		if (!page)
+			break;
+		pcp->bp[pcp->nr_bp++] = page;
+		nr++;
+	}
+	if (nr)
+		pcp->refills++;
+unlock:
+	spin_unlock(&pcp->lock);
+
+	atomic_add(nr * pool->pages_per_big_pg, &pool->pcp_count);
+}
+#endif /* CONFIG_ARM64_4K_PAGES */
+
+/*
+ * Return all pages in all magazines to the global pool, so that they can be
+ * released by the shrinker or handed out to allocations on other nodes.
+ *
+ * You must lock the page pool before using this.
+ */
+static void nvmap_pp_pcp_drain_all_locked(struct nvmap_page_pool *pool)
+{
+	struct nvmap_pp_pcp *pcp;
+	u32 nr;
+	int cpu;
+
+	if (!pool->pcp)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+		nr = 0;
+
+		spin_lock(&pcp->lock);
+		while (pcp->nr) {
+			list_add(&pcp->pages[--pcp->nr]->lru, &pool->page_list);
+			nr++;
+		}
+#ifdef CONFIG_ARM64_4K_PAGES
+		while (pcp->nr_bp) {
+			list_add(&pcp->bp[--pcp->nr_bp]->lru,
+				 &pool->page_list_bp);
+			pool->big_page_count += pool->pages_per_big_pg;
+			nr += pool->pages_per_big_pg;
+		}
+#endif /* CONFIG_ARM64_4K_PAGES */
+		if (nr)
+			pcp->drains++;
+		spin_unlock(&pcp->lock);
+
+		pool->count += nr;
+		atomic_sub(nr, &pool->pcp_count);
+	}
+}
+
+/*
+ * Number of pages the pool can still take, counting pages sitting in the
+ * per-CPU magazines as part of the pool.
+ */
+static inline u32 nvmap_pp_free_slots(struct nvmap_page_pool *pool, u32 used)
+{
+	used += atomic_read(&pool->pcp_count);
+#ifdef NVMAP_PP_HUGE_PAGES
+	used += pool->huge_count + pool->huge_to_zero;
+#endif /* NVMAP_PP_HUGE_PAGES */
+
+	return used >= pool->max ? 0 : pool->max - used;
+}
+
 /*
  * Free the passed number of pages from the page pool. This happens regardless
  * of whether the page pools are enabled. This lets one disable the page pools
@@ -252,6 +708,10 @@ static ulong nvmap_page_pool_free_pages_locked(struct nvmap_page_pool *pool,
 
 	pr_debug("req to release pages=%ld\n", nr_pages);
 
+	/* Not enough pages in the global lists, pull the magazines back */
+	if (nr_pages > pool->count + pool->to_zero)
+		nvmap_pp_pcp_drain_all_locked(pool);
+
 	while (nr_pages) {
 
 #ifdef CONFIG_ARM64_4K_PAGES
@@ -298,6 +758,32 @@ static ulong nvmap_page_pool_free_pages_locked(struct nvmap_page_pool *pool,
 #endif /* CONFIG_ARM64_4K_PAGES */
 	}
 
+#ifdef NVMAP_PP_HUGE_PAGES
+	/* Break up huge pages last, they are the most expensive to refill */
+	while (nr_pages) {
+		if (!list_empty(&pool->huge_zero_list)) {
+			page = list_first_entry(&pool->huge_zero_list,
+						struct page, lru);
+			pool->huge_to_zero -= pool->pages_per_huge_pg;
+		} else if (!list_empty(&pool->huge_list)) {
+			page = list_first_entry(&pool->huge_list,
+						struct page, lru);
+			pool->huge_count -= pool->pages_per_huge_pg;
+		} else {
+			break;
+		}
+		list_del(&page->lru);
+
+		for (i = 0; i < pool->pages_per_huge_pg; i++)
+			__free_page(nth_page(page, i));
+		pr_debug("released %d pages\n", pool->pages_per_huge_pg);
+		if (nr_pages > pool->pages_per_huge_pg)
+			nr_pages -= pool->pages_per_huge_pg;
+		else
+			nr_pages = 0;
+	}
+#endif /* NVMAP_PP_HUGE_PAGES */
+
 	pr_debug("remaining pages to release=%ld\n", nr_pages);
 	return nr_pages;
 }
@@ -318,6 +804,10 @@ int nvmap_page_pool_alloc_lots(struct nvmap_page_pool *pool,
 	if (!enable_pp || !nr)
 		return 0;
 
+	ind = nvmap_pp_pcp_alloc(pool, pages, nr, use_numa, numa_id);
+	if (ind == nr)
+		goto out;
+
 	rt_mutex_lock(&pool->lock);
 
 	while (ind < nr) {
@@ -342,12 +832,17 @@ int nvmap_page_pool_alloc_lots(struct nvmap_page_pool *pool,
 #endif /* NVMAP_CONFIG_PAGE_POOL_DEBUG */
 	}
 
+	/* Global pool still has zeroed pages, cache a batch for this CPU */
+	if (ind == nr && !non_zero_cnt)
+		nvmap_pp_pcp_refill_locked(pool, use_numa, numa_id);
+
 	rt_mutex_unlock(&pool->lock);
 
 	/* Zero non-zeroed pages, if any */
 	if (non_zero_cnt)
 		nvmap_pp_zero_pages(&pages[non_zero_idx], non_zero_cnt);
 
+out:
 	pp_alloc_add(pool, ind);
 	pp_hit_add(pool, ind);
 	pp_miss_add(pool, nr - ind);
@@ -369,6 +864,10 @@ int nvmap_page_pool_alloc_lots_bp(struct nvmap_page_pool *pool,
 	    nr_pages < pool->pages_per_big_pg)
 		return 0;
 
+	ind = nvmap_pp_pcp_alloc_bp(pool, pages, nr, use_numa, numa_id);
+	if (nr_pages - ind < pool->pages_per_big_pg)
+		goto out;
+
 	rt_mutex_lock(&pool->lock);
 
 	while (nr_pages - ind >= pool->pages_per_big_pg) {
@@ -384,11 +883,46 @@ int nvmap_page_pool_alloc_lots_bp(struct nvmap_page_pool *pool,
 		ind += pool->pages_per_big_pg;
 	}
 
+	if (nr_pages - ind < pool->pages_per_big_pg)
+		nvmap_pp_pcp_refill_bp_locked(pool, use_numa, numa_id);
+
 	rt_mutex_unlock(&pool->lock);
+out:
 	trace_nvmap_pp_alloc_lots_bp(ind, nr);
 	return ind;
 }
 
+#ifdef NVMAP_PP_HUGE_PAGES
+int nvmap_page_pool_alloc_lots_huge(struct nvmap_page_pool *pool,
+				struct page **pages, u32 nr,
+				bool use_numa, int numa_id)
+{
+	u32 ind = 0;
+	struct page *page;
+
+	if (!enable_pp || nr < pool->pages_per_huge_pg)
+		return 0;
+
+	rt_mutex_lock(&pool->lock);
+
+	while (nr - ind >= pool->pages_per_huge_pg) {
+		int i;
+
+		page = get_huge_list_page(pool, use_numa, numa_id);
+		if (!page)
+			break;
+
+		for (i = 0; i < pool->pages_per_huge_pg; i++)
+			pages[ind + i] = nth_page(page, i);
+
+		ind += pool->pages_per_huge_pg;
+	}
+
+	rt_mutex_unlock(&pool->lock);
+	return ind;
+}
+#endif /* NVMAP_PP_HUGE_PAGES */
+
 static bool nvmap_is_big_page(struct nvmap_page_pool *pool,
 			      struct page **pages, int idx, int nr)
 {
@@ -431,7 +965,7 @@ static int __nvmap_page_pool_fill_lots_locked(struct nvmap_page_pool *pool,
 		return 0;
 
 	BUG_ON(pool->count > pool->max);
-	real_nr = min_t(u32, pool->max - pool->count, nr);
+	real_nr = min_t(u32, nvmap_pp_free_slots(pool, pool->count), nr);
 	pages_to_fill = real_nr;
 	if (real_nr == 0)
 		return 0;
@@ -464,6 +998,35 @@ static int __nvmap_page_pool_fill_lots_locked(struct nvmap_page_pool *pool,
 	return ind;
 }
 
+#ifdef NVMAP_PP_HUGE_PAGES
+/*
+ * Put a 2MB chunk starting at pages[idx] on the huge zero list, if it is
+ * one, none of its pages is still referenced and the huge tier has room.
+ *
+ * You must lock the page pool before using this.
+ */
+static bool nvmap_pp_fill_huge_locked(struct nvmap_page_pool *pool,
+				      struct page **pages, u32 idx, u32 nr)
+{
+	u32 i;
+
+	if (!nvmap_is_huge_run(pages, idx, nr))
+		return false;
+
+	if (pool->huge_count + pool->huge_to_zero + pool->pages_per_huge_pg >
+	    nvmap_pp_huge_max(pool))
+		return false;
+
+	for (i = 0; i < pool->pages_per_huge_pg; i++)
+		if (page_count(pages[idx + i]) > 1)
+			return false;
+
+	list_add_tail(&pages[idx]->lru, &pool->huge_zero_list);
+	pool->huge_to_zero += pool->pages_per_huge_pg;
+	return true;
+}
+#endif /* NVMAP_PP_HUGE_PAGES */
+
 u32 nvmap_page_pool_fill_lots(struct nvmap_page_pool *pool,
 				       struct page **pages, u32 nr)
 {
@@ -475,9 +1038,17 @@ u32 nvmap_page_pool_fill_lots(struct nvmap_page_pool *pool,
 
 	save_to_zero = pool->to_zero;
 
-	ret = min(nr, pool->max - pool->count - pool->to_zero - pool->under_zero);
+	ret = min(nr, nvmap_pp_free_slots(pool, pool->count + pool->to_zero +
+					  pool->under_zero));
 
 	for (i = 0; i < ret; i++) {
+#ifdef NVMAP_PP_HUGE_PAGES
+		/* Keep 2MB chunks intact, they are zeroed by the bg thread */
+		if (nvmap_pp_fill_huge_locked(pool, pages, i, ret)) {
+			i += pool->pages_per_huge_pg - 1;
+			continue;
+		}
+#endif /* NVMAP_PP_HUGE_PAGES */
 		/* If page has additonal referecnces, Don't add it into
 		 * page pool. get_user_pages() on mmap'ed nvmap handle can
 		 * hold a refcount on the page. These pages can't be
@@ -491,7 +1062,7 @@ u32 nvmap_page_pool_fill_lots(struct nvmap_page_pool *pool,
 		}
 	}
 
-	if (pool->to_zero)
+	if (nvmap_bg_should_run(pool))
 		wake_up_interruptible(&nvmap_bg_wait);
 	ret = i;
 
@@ -510,7 +1081,11 @@ ulong nvmap_page_pool_get_unused_pages(void)
 	if (!nvmap_dev)
 		return 0;
 
-	total = nvmap_dev->pool.count + nvmap_dev->pool.to_zero;
+	total = nvmap_dev->pool.count + nvmap_dev->pool.to_zero +
+		atomic_read(&nvmap_dev->pool.pcp_count);
+#ifdef NVMAP_PP_HUGE_PAGES
+	total += nvmap_dev->pool.huge_count + nvmap_dev->pool.huge_to_zero;
+#endif /* NVMAP_PP_HUGE_PAGES */
 
 	return total;
 }
@@ -525,7 +1100,8 @@ int nvmap_page_pool_clear(void)
 
 	rt_mutex_lock(&pool->lock);
 
-	(void)nvmap_page_pool_free_pages_locked(pool, pool->count + pool->to_zero);
+	(void)nvmap_page_pool_free_pages_locked(pool,
+					nvmap_page_pool_get_unused_pages());
 
 	/* For some reason, if an error occured... */
 	if (!list_empty(&pool->page_list) || !list_empty(&pool->zero_list)) {
@@ -666,6 +1242,56 @@ static struct kernel_param_ops enable_pp_ops = {
 
 module_param_cb(enable_page_pools, &enable_pp_ops, &enable_pp, 0644);
 
+static void nvmap_pp_bg_set_affinity(void)
+{
+	const struct cpumask *mask = &bg_zero_cpus;
+	int nid;
+
+	if (IS_ERR_OR_NULL(background_allocator))
+		return;
+
+	if (cpumask_empty(mask)) {
+		nid = dev_to_node(nvmap_dev->dev_user.parent);
+		mask = nid == NUMA_NO_NODE ? cpu_possible_mask :
+					     cpumask_of_node(nid);
+	}
+
+	if (set_cpus_allowed_ptr(background_allocator, mask))
+		pr_warn("failed to set zeroing thread affinity to %*pbl\n",
+			cpumask_pr_args(mask));
+}
+
+static int bg_zero_cpus_set(const char *arg, const struct kernel_param *kp)
+{
+	struct cpumask mask;
+	int ret;
+
+	ret = cpulist_parse(arg, &mask);
+	if (ret)
+		return ret;
+
+	if (!cpumask_empty(&mask) && !cpumask_intersects(&mask, cpu_online_mask))
+		return -EINVAL;
+
+	cpumask_copy(&bg_zero_cpus, &mask);
+	nvmap_pp_bg_set_affinity();
+
+	return 0;
+}
+
+static int bg_zero_cpus_get(char *buff, const struct kernel_param *kp)
+{
+	return scnprintf(buff, PAGE_SIZE, "%*pbl\n",
+			 cpumask_pr_args(&bg_zero_cpus));
+}
+
+static struct kernel_param_ops bg_zero_cpus_ops = {
+	.get = bg_zero_cpus_get,
+	.set = bg_zero_cpus_set,
+};
+
+module_param_cb(bg_zero_cpus, &bg_zero_cpus_ops, NULL, 0644);
+
 static int pool_size_set(const char *arg, const struct kernel_param *kp)
 {
 	int ret = param_set_uint(arg, kp);
@@ -688,6 +1314,89 @@ static struct kernel_param_ops pool_size_ops = {
 
 module_param_cb(pool_size, &pool_size_ops, &pool_size, 0644);
 
+static int nvmap_pp_pcp_stats_show(struct seq_file *s, void *unused)
+{
+	struct nvmap_page_pool *pool = s->private;
+	struct nvmap_pp_pcp *pcp;
+	u64 hits, misses, total;
+	u32 nr, nr_bp = 0;
+	int cpu;
+
+	if (!pool->pcp)
+		return 0;
+
+	seq_printf(s, "%-4s %8s %8s %12s %12s %6s %10s %10s\n", "cpu",
+		   "pages", "bigpages", "hits", "misses", "hit%",
+		   "refills", "drains");
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+
+		spin_lock(&pcp->lock);
+		nr = pcp->nr;
+#ifdef CONFIG_ARM64_4K_PAGES
+		nr_bp = pcp->nr_bp;
+#endif /* CONFIG_ARM64_4K_PAGES */
+		hits = pcp->hits;
+		misses = pcp->misses;
+		total = hits + misses;
+		seq_printf(s, "%-4d %8u %8u %12llu %12llu %6llu %10llu %10llu\n",
+			   cpu, nr, nr_bp, hits, misses,
+			   total ? div64_u64(hits * 100, total) : 0,
+			   pcp->refills, pcp->drains);
+		spin_unlock(&pcp->lock);
+	}
+
+	return 0;
+}
+
+static int nvmap_pp_zero_stats_show(struct seq_file *s, void *unused)
+{
+	u64 cpu_time = zero_stats.cpu_time_ns;
+	u64 bytes = zero_stats.cpu_bytes + zero_stats.dma_bytes;
+
+	seq_printf(s, "engine:        %s\n",
+#ifdef NVMAP_CONFIG_PAGE_POOL_DMA_ZERO
+		   nvmap_pp_dma_chan && READ_ONCE(dma_zero) ?
+		   dma_chan_name(nvmap_pp_dma_chan) : "cpu");
+#else
+		   "cpu");
+#endif /* NVMAP_CONFIG_PAGE_POOL_DMA_ZERO */
+	seq_printf(s, "cpu_bytes:     %llu\n", zero_stats.cpu_bytes);
+	seq_printf(s, "dma_bytes:     %llu\n", zero_stats.dma_bytes);
+	seq_printf(s, "dma_fallbacks: %llu\n", zero_stats.dma_fallbacks);
+	seq_printf(s, "bytes_per_sec: %llu\n", zero_stats.bytes_per_sec);
+	seq_printf(s, "cpu_time_ns:   %llu\n", cpu_time);
+	seq_printf(s, "cpu_ns_per_mb: %llu\n",
+		   bytes >> 20 ? div64_u64(cpu_time, bytes >> 20) : 0);
+	seq_printf(s, "throttled:     %llu\n", zero_stats.throttled);
+
+	return 0;
+}
+
+static int nvmap_pp_zero_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nvmap_pp_zero_stats_show, inode->i_private);
+}
+
+static const struct file_operations nvmap_pp_zero_stats_fops = {
+	.open = nvmap_pp_zero_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int nvmap_pp_pcp_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nvmap_pp_pcp_stats_show, inode->i_private);
+}
+
+static const struct file_operations nvmap_pp_pcp_stats_fops = {
+	.open = nvmap_pp_pcp_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int nvmap_page_pool_debugfs_init(struct dentry *nvmap_root)
 {
 	struct dentry *pp_root;
@@ -705,6 +1414,10 @@ int nvmap_page_pool_debugfs_init(struct dentry *nvmap_root)
 	debugfs_create_u32("page_pool_pages_to_zero",
 			   S_IRUGO, pp_root,
 			   &nvmap_dev->pool.to_zero);
+	debugfs_create_file("page_pool_pcp_stats", S_IRUGO, pp_root,
+			    &nvmap_dev->pool, &nvmap_pp_pcp_stats_fops);
+	debugfs_create_file("page_pool_zero_stats", S_IRUGO, pp_root,
+			    &nvmap_dev->pool, &nvmap_pp_zero_stats_fops);
 #ifdef CONFIG_ARM64_4K_PAGES
 	debugfs_create_u32("page_pool_available_big_pages",
 			   S_IRUGO, pp_root,
@@ -716,6 +1429,17 @@ int nvmap_page_pool_debugfs_init(struct dentry *nvmap_root)
 			   S_IRUGO, pp_root,
 			   &nvmap_big_page_allocs);
 #endif /* CONFIG_ARM64_4K_PAGES */
+#ifdef NVMAP_PP_HUGE_PAGES
+	debugfs_create_u32("page_pool_available_huge_pages",
+			   S_IRUGO, pp_root,
+			   &nvmap_dev->pool.huge_count);
+	debugfs_create_u32("page_pool_huge_pages_to_zero",
+			   S_IRUGO, pp_root,
+			   &nvmap_dev->pool.huge_to_zero);
+	debugfs_create_u64("total_huge_page_allocs",
+			   S_IRUGO, pp_root,
+			   &nvmap_huge_page_allocs);
+#endif /* NVMAP_PP_HUGE_PAGES */
 	debugfs_create_u64("total_page_allocs",
 			   S_IRUGO, pp_root,
 			   &nvmap_total_page_allocs);
@@ -742,6 +1466,10 @@ int nvmap_page_pool_init(struct nvmap_device *dev)
 {
 	struct sysinfo info;
 	struct nvmap_page_pool *pool = &dev->pool;
+#ifdef NVMAP_CONFIG_PAGE_POOL_DMA_ZERO
+	dma_cap_mask_t mask;
+#endif /* NVMAP_CONFIG_PAGE_POOL_DMA_ZERO */
+	int cpu;
 
 	memset(pool, 0x0, sizeof(*pool));
 	rt_mutex_init(&pool->lock);
@@ -753,6 +1481,18 @@ int nvmap_page_pool_init(struct nvmap_device *dev)
 	pool->big_pg_sz = NVMAP_PP_BIG_PAGE_SIZE;
 	pool->pages_per_big_pg = NVMAP_PP_BIG_PAGE_SIZE >> PAGE_SHIFT;
 #endif /* CONFIG_ARM64_4K_PAGES */
+#ifdef NVMAP_PP_HUGE_PAGES
+	INIT_LIST_HEAD(&pool->huge_list);
+	INIT_LIST_HEAD(&pool->huge_zero_list);
+	pool->pages_per_huge_pg = NVMAP_PP_HUGE_PAGE_SIZE >> PAGE_SHIFT;
+#endif /* NVMAP_PP_HUGE_PAGES */
+
+	pool->pcp = alloc_percpu(struct nvmap_pp_pcp);
+	if (!pool->pcp)
+		goto fail;
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(pool->pcp, cpu)->lock);
+	atomic_set(&pool->pcp_count, 0);
 
 	si_meminfo(&info);
 	pr_info("Total RAM pages: %lu\n", info.totalram);
@@ -771,10 +1511,22 @@ int nvmap_page_pool_init(struct nvmap_device *dev)
 	pr_info("nvmap page pool size: %u pages (%u MB)\n", pool->max,
 		(pool->max * info.mem_unit) >> 20);
 
+#ifdef NVMAP_CONFIG_PAGE_POOL_DMA_ZERO
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMSET, mask);
+	nvmap_pp_dma_chan = dma_request_channel(mask, NULL, NULL);
+	if (nvmap_pp_dma_chan)
+		pr_info("zeroing page pool pages with %s\n",
+			dma_chan_name(nvmap_pp_dma_chan));
+	else
+		pr_info("no DMA memset channel, zeroing pages with CPU\n");
+#endif /* NVMAP_CONFIG_PAGE_POOL_DMA_ZERO */
+
 	background_allocator = kthread_run(nvmap_background_zero_thread,
 					    NULL, "nvmap-bz");
 	if (IS_ERR(background_allocator))
 		goto fail;
+	nvmap_pp_bg_set_affinity();
 #if defined(NV_SHRINKER_ALLOC_PRESENT) /* Linux 6.7 */
 	nvmap_page_pool_shrinker = shrinker_alloc(0, "nvmap_pp_shrinker");
 	if (!nvmap_page_pool_shrinker) {
@@ -820,6 +1572,22 @@ int nvmap_page_pool_fini(struct nvmap_device *dev)
 		background_allocator = NULL;
 	}
 
+#ifdef NVMAP_CONFIG_PAGE_POOL_DMA_ZERO
+	if (nvmap_pp_dma_chan) {
+		dma_release_channel(nvmap_pp_dma_chan);
+		nvmap_pp_dma_chan = NULL;
+	}
+#endif /* NVMAP_CONFIG_PAGE_POOL_DMA_ZERO */
+
+	if (pool->pcp) {
+		rt_mutex_lock(&pool->lock);
+		nvmap_pp_pcp_drain_all_locked(pool);
+		rt_mutex_unlock(&pool->lock);
+		WARN_ON(atomic_read(&pool->pcp_count));
+		free_percpu(pool->pcp);
+		pool->pcp = NULL;
+	}
+
 	WARN_ON(!list_empty(&pool->page_list));
 
 	return 0;
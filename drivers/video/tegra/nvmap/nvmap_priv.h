@@ -145,6 +145,7 @@ void _nvmap_handle_free(struct nvmap_handle *h);
 /* holds max number of handles allocted per process at any time */
 extern u32 nvmap_max_handle_count;
 extern u64 nvmap_big_page_allocs;
+extern u64 nvmap_huge_page_allocs;
 extern u64 nvmap_total_page_allocs;
 
 extern bool nvmap_convert_iovmm_to_carveout;
@@ -188,8 +189,12 @@ struct nvmap_carveout_node {
 struct nvmap_pgalloc {
 	struct page **pages;
 	bool contig;			/* contiguous system memory */
+	bool huge;			/* has 2MB aligned contiguous chunks */
+	bool lazy;			/* pages populated on first touch */
 	atomic_t reserved;
 	atomic_t ndirty;	/* count number of dirty pages */
+	atomic_t npopulated;	/* resident pages of a lazy handle */
+	struct mutex populate_lock;	/* serializes lazy population */
 };
 
 #ifdef NVMAP_CONFIG_DEBUG_MAPS
@@ -271,12 +276,13 @@ struct nvmap_handle {
 	wait_queue_head_t waitq;
 	int numa_id;
 	u64 serial_id;
+	u32 id;			/* index in nvmap_dev->handle_ids */
+	struct list_head maps;	/* stashed device mappings */
+	struct mutex maps_lock;
 };
 
 struct nvmap_handle_info {
 	struct nvmap_handle *handle;
-	struct list_head maps;
-	struct mutex maps_lock;
 	bool is_ro;
 };
 
@@ -295,6 +301,7 @@ struct nvmap_handle_ref {
 	struct rb_node	node;
 	atomic_t	dupes;	/* number of times to free on file close */
 	bool is_ro;
+	struct rcu_head	rcu;
 };
 
 #if defined(NVMAP_CONFIG_PAGE_POOLS)
@@ -309,6 +316,44 @@ struct nvmap_handle_ref {
 #ifdef CONFIG_ARM64_4K_PAGES
 #define NVMAP_PP_BIG_PAGE_SIZE           (0x10000)
 #endif /* CONFIG_ARM64_4K_PAGES */
+
+/*
+ * 2MB huge page tier. With 4K pages a PMD maps 2MB, so handles backed by
+ * 2MB aligned chunks can be CPU mapped with PMD entries.
+ */
+#if defined(NVMAP_CONFIG_HUGE_PAGES) && defined(CONFIG_ARM64_4K_PAGES) && \
+	defined(CONFIG_TRANSPARENT_HUGEPAGE) && \
+	LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
+#define NVMAP_PP_HUGE_PAGES
+#define NVMAP_PP_HUGE_PAGE_SIZE          (PMD_SIZE)
+#endif
+
+/*
+ * Per-CPU front cache (magazine) of zeroed pool pages. Magazines are
+ * refilled from and drained to the global pool NVMAP_PP_PCP_BATCH pages
+ * at a time, so that small allocations don't take the global pool lock.
+ */
+#define NVMAP_PP_PCP_SIZE                (64)
+#define NVMAP_PP_PCP_BATCH               (NVMAP_PP_PCP_SIZE / 2)
+#ifdef CONFIG_ARM64_4K_PAGES
+#define NVMAP_PP_PCP_BP_SIZE             (4)
+#define NVMAP_PP_PCP_BP_BATCH            (NVMAP_PP_PCP_BP_SIZE / 2)
+#endif /* CONFIG_ARM64_4K_PAGES */
+
+struct nvmap_pp_pcp {
+	spinlock_t lock;
+	u32 nr;         /* Number of pages in pages[] */
+	struct page *pages[NVMAP_PP_PCP_SIZE];
+#ifdef CONFIG_ARM64_4K_PAGES
+	u32 nr_bp;      /* Number of big pages in bp[] */
+	struct page *bp[NVMAP_PP_PCP_BP_SIZE];
+#endif /* CONFIG_ARM64_4K_PAGES */
+	u64 hits;       /* Pages served from the magazine */
+	u64 misses;     /* Pages served by the global pool or allocator */
+	u64 refills;    /* Batches taken from the global pool */
+	u64 drains;     /* Batches returned to the global pool */
+};
+
 struct nvmap_page_pool {
 	struct rt_mutex lock;
 	u32 count;      /* Number of pages in the page & dirty list. */
@@ -325,6 +370,15 @@ struct nvmap_page_pool {
 #ifdef CONFIG_ARM64_4K_PAGES
 	struct list_head page_list_bp;
 #endif /* CONFIG_ARM64_4K_PAGES */
+#ifdef NVMAP_PP_HUGE_PAGES
+	u32 pages_per_huge_pg; /* Number of pages in huge page */
+	u32 huge_count;        /* Number of pages in huge_list */
+	u32 huge_to_zero;      /* Number of pages in huge_zero_list */
+	struct list_head huge_list;      /* Zeroed 2MB chunks */
+	struct list_head huge_zero_list; /* 2MB chunks to be zeroed */
+#endif /* NVMAP_PP_HUGE_PAGES */
+	struct nvmap_pp_pcp __percpu *pcp;
+	atomic_t pcp_count; /* Number of pages in all per-CPU magazines */
 
 #ifdef NVMAP_CONFIG_PAGE_POOL_DEBUG
 	u64 allocs;
@@ -343,6 +397,10 @@ int nvmap_page_pool_alloc_lots(struct nvmap_page_pool *pool,
 int nvmap_page_pool_alloc_lots_bp(struct nvmap_page_pool *pool,
 		struct page **pages, u32 nr, bool use_numa, int numa_id);
 #endif /* CONFIG_ARM64_4K_PAGES */
+#ifdef NVMAP_PP_HUGE_PAGES
+int nvmap_page_pool_alloc_lots_huge(struct nvmap_page_pool *pool,
+		struct page **pages, u32 nr, bool use_numa, int numa_id);
+#endif /* NVMAP_PP_HUGE_PAGES */
 u32 nvmap_page_pool_fill_lots(struct nvmap_page_pool *pool,
 				       struct page **pages, u32 nr);
 int nvmap_page_pool_clear(void);
@@ -360,6 +418,10 @@ struct xarray {};
 struct nvmap_client {
 	const char			*name;
 	struct rb_root			handle_refs;
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	/* handle refs indexed by nvmap_ref_index(), for lookups */
+	struct xarray			handle_ref_ids;
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	struct mutex			ref_lock;
 	bool				kernel_client;
 	atomic_t			count;
@@ -381,6 +443,9 @@ struct nvmap_vma_priv {
 
 struct nvmap_device {
 	struct rb_root	handles;
+#ifdef NVMAP_CONFIG_HANDLE_AS_ID
+	struct xarray	handle_ids;	/* handles indexed by h->id */
+#endif /* NVMAP_CONFIG_HANDLE_AS_ID */
 	spinlock_t	handle_lock;
 	struct miscdevice dev_user;
 	struct nvmap_carveout_node *heaps;
@@ -522,6 +587,13 @@ struct nvmap_handle_ref *__nvmap_validate_locked(struct nvmap_client *priv,
 
 struct nvmap_handle *nvmap_validate_get(struct nvmap_handle *h);
 
+/* Index of a client's reference to @h in nvmap_client.handle_ref_ids */
+static inline unsigned long nvmap_ref_index(struct nvmap_handle *h,
+					    bool is_ro)
+{
+	return ((unsigned long)h->id << 1) | is_ro;
+}
+
 struct nvmap_handle_ref *nvmap_create_handle(struct nvmap_client *client,
 					     size_t size, bool ro_buf);
 
@@ -597,6 +669,7 @@ int nvmap_cache_maint_phys_range(unsigned int op, phys_addr_t pstart,
 
 int nvmap_do_cache_maint_list(struct nvmap_handle **handles, u64 *offsets,
 			      u64 *sizes, int op, u32 nr_ops, bool is_32);
+void nvmap_cache_maint_calibrate(void);
 int __nvmap_cache_maint(struct nvmap_client *client,
 			       struct nvmap_cache_op_64 *op);
 
@@ -624,15 +697,48 @@ int __nvmap_dmabuf_fd(struct nvmap_client *client,
 
 int nvmap_dmabuf_stash_init(void);
 void nvmap_dmabuf_stash_deinit(void);
+void nvmap_dmabuf_stash_invalidate(struct nvmap_handle *h);
 
 void *nvmap_altalloc(size_t len);
 void nvmap_altfree(void *ptr, size_t len);
+int nvmap_handle_populate(struct nvmap_handle *h, size_t offset, size_t len);
+
+static inline bool nvmap_handle_is_lazy(struct nvmap_handle *h)
+{
+	return h->heap_pgalloc && h->pgalloc.lazy;
+}
 
 static inline struct page *nvmap_to_page(struct page *page)
 {
 	return (struct page *)((unsigned long)page & ~3UL);
 }
 
+#ifdef NVMAP_PP_HUGE_PAGES
+/*
+ * Check if pages[idx] starts a 2MB aligned, physically contiguous run of
+ * pages. Entries may carry nvmap page flag bits.
+ */
+static inline bool nvmap_is_huge_run(struct page **pages, size_t idx,
+				     size_t nr)
+{
+	unsigned long pfn;
+	size_t i, nr_huge = NVMAP_PP_HUGE_PAGE_SIZE >> PAGE_SHIFT;
+
+	if (nr - idx < nr_huge)
+		return false;
+
+	pfn = page_to_pfn(nvmap_to_page(pages[idx]));
+	if (pfn & (nr_huge - 1))
+		return false;
+
+	for (i = 1; i < nr_huge; i++)
+		if (page_to_pfn(nvmap_to_page(pages[idx + i])) != pfn + i)
+			return false;
+
+	return true;
+}
+#endif /* NVMAP_PP_HUGE_PAGES */
+
 static inline bool nvmap_page_dirty(struct page *page)
 {
 	return (unsigned long)page & 1UL;
@@ -673,8 +779,12 @@ static inline int nvmap_handle_mk(struct nvmap_handle *h,
 		(offset < h->size) &&
 		(size <= h->size) &&
 		(offset <= (h->size - size))) {
-		for (i = start_page; i < end_page; i++)
+		for (i = start_page; i < end_page; i++) {
+			/* unpopulated pages of a lazy handle */
+			if (!h->pgalloc.pages[i])
+				continue;
 			nchanged += fn(&h->pgalloc.pages[i]) ? 1 : 0;
+		}
 	}
 	if (!locked)
 		mutex_unlock(&h->lock);
@@ -931,6 +1041,12 @@ void *nvmap_dma_mark_declared_memory_occupied(struct device *dev,
 					dma_addr_t device_addr, size_t size);
 void nvmap_dma_mark_declared_memory_unoccupied(struct device *dev,
 					 dma_addr_t device_addr, size_t size);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+void *nvmap_dma_alloc_attrs_lowest(struct device *dev, size_t size,
+				   dma_addr_t *dma_handle, unsigned long attrs);
+int nvmap_dma_coherent_frag_stats(struct device *dev, unsigned int unit_shift,
+				  u64 *largest, u32 *nr_free);
+#endif
 
 extern void __dma_flush_area(const void *cpu_va, size_t size);
 extern void __dma_map_area(const void *cpu_va, size_t size, int dir);
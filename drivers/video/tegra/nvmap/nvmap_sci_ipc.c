@@ -11,10 +11,11 @@
 
 #include <linux/slab.h>
 #include <linux/nvmap.h>
-#include <linux/rbtree.h>
+#include <linux/hashtable.h>
 #include <linux/list.h>
 #include <linux/mman.h>
 #include <linux/wait.h>
+#include <linux/xarray.h>
 
 #include <linux/nvscierror.h>
 #include <linux/nvsciipc_interface.h>
@@ -23,8 +24,16 @@
 #include "nvmap_priv.h"
 #include "nvmap_sci_ipc.h"
 
+#define NVMAP_SCI_IPC_HASH_BITS	8
+
+/*
+ * Entries are found by sci_ipc_id on import and by (handle, flags, peer)
+ * on export. mlock only covers table updates and the entry counters, the
+ * dma-buf and fd work of an import runs without it.
+ */
 struct nvmap_sci_ipc {
-	struct rb_root entries;
+	struct xarray ids;
+	DECLARE_HASHTABLE(exports, NVMAP_SCI_IPC_HASH_BITS);
 	struct mutex mlock;
 	struct list_head free_sid_list;
 };
@@ -34,15 +43,18 @@ struct free_sid_node {
 	u64 sid;
 };
 
-/* An rb-tree root node for holding sci_ipc_id of clients */
+/* An entry of the sci_ipc_id table */
 struct nvmap_sci_ipc_entry {
-	struct rb_node entry;
+	struct hlist_node node;
 	struct nvmap_client *client;
 	struct nvmap_handle *handle;
 	u64 sci_ipc_id;
 	u64 peer_vuid;
 	u32 flags;
+	/* exports not yet imported */
 	u32 refcount;
+	/* imports running without mlock */
+	u32 inflight;
 };
 
 static struct nvmap_sci_ipc *nvmapsciipc;
@@ -98,18 +110,15 @@ ret_id:
 }
 
 static struct nvmap_sci_ipc_entry *nvmap_search_sci_ipc_entry(
-	struct rb_root *root,
 	struct nvmap_handle *h,
 	u32 flags,
 	NvSciIpcEndpointVuid peer_vuid)
 {
-	struct rb_node *node;  /* top of the tree */
 	struct nvmap_sci_ipc_entry *entry;
 
-	for (node = rb_first(root); node; node = rb_next(node)) {
-		entry = rb_entry(node, struct nvmap_sci_ipc_entry, entry);
-
-		if (entry && entry->handle == h
+	hash_for_each_possible(nvmapsciipc->exports, entry, node,
+			       (unsigned long)h) {
+		if (entry->handle == h
 			&& entry->flags == flags
 			&& entry->peer_vuid == peer_vuid)
 			return entry;
@@ -117,29 +126,20 @@ static struct nvmap_sci_ipc_entry *nvmap_search_sci_ipc_entry(
 	return NULL;
 }
 
-static void nvmap_insert_sci_ipc_entry(struct rb_root *root,
-		struct nvmap_sci_ipc_entry *new)
+/* Called with mlock held, the id goes back to the free list */
+static void nvmap_remove_sci_ipc_entry(struct nvmap_sci_ipc_entry *entry)
 {
-	struct nvmap_sci_ipc_entry *entry;
-	struct rb_node *parent = NULL;
-	u64 sid = new->sci_ipc_id;
-	struct rb_node **link;
-
-	link = &root->rb_node;
-	/* Go to the bottom of the tree */
-	while (*link) {
-		parent = *link;
-		entry = rb_entry(parent, struct nvmap_sci_ipc_entry, entry);
-
-		if (entry->sci_ipc_id > sid)
-			link = &parent->rb_left;
-		else
-			link = &parent->rb_right;
-	}
+	struct free_sid_node *free_node;
+
+	xa_erase(&nvmapsciipc->ids, entry->sci_ipc_id);
+	hash_del(&entry->node);
 
-	/* Put the new node there */
-	rb_link_node(&new->entry, parent, link);
-	rb_insert_color(&new->entry, root);
+	free_node = kzalloc(sizeof(*free_node), GFP_KERNEL);
+	if (free_node) {
+		free_node->sid = entry->sci_ipc_id;
+		list_add_tail(&free_node->list, &nvmapsciipc->free_sid_list);
+	}
+	kfree(entry);
 }
 
 int nvmap_create_sci_ipc_id(struct nvmap_client *client,
@@ -156,8 +156,7 @@ int nvmap_create_sci_ipc_id(struct nvmap_client *client,
 
 	mutex_lock(&nvmapsciipc->mlock);
 
-	entry = nvmap_search_sci_ipc_entry(&nvmapsciipc->entries,
-			h, flags, peer_vuid);
+	entry = nvmap_search_sci_ipc_entry(h, flags, peer_vuid);
 	if (entry) {
 		entry->refcount++;
 		*sci_ipc_id = entry->sci_ipc_id;
@@ -171,7 +170,6 @@ int nvmap_create_sci_ipc_id(struct nvmap_client *client,
 			goto unlock;
 		}
 		id = nvmap_unique_sci_ipc_id();
-		*sci_ipc_id = id;
 		new_entry->sci_ipc_id = id;
 		new_entry->client = client;
 		new_entry->handle = h;
@@ -183,8 +181,15 @@ int nvmap_create_sci_ipc_id(struct nvmap_client *client,
 			__LINE__, new_entry->sci_ipc_id, new_entry->peer_vuid,
 			new_entry->flags, new_entry->handle);
 
-		nvmap_insert_sci_ipc_entry(&nvmapsciipc->entries, new_entry);
-		ret = 0;
+		ret = xa_err(xa_store(&nvmapsciipc->ids, id, new_entry,
+				      GFP_KERNEL));
+		if (ret) {
+			kfree(new_entry);
+			goto unlock;
+		}
+		hash_add(nvmapsciipc->exports, &new_entry->node,
+			 (unsigned long)h);
+		*sci_ipc_id = id;
 	}
 unlock:
 	mutex_unlock(&nvmapsciipc->mlock);
@@ -196,21 +201,6 @@ unlock:
 	return ret;
 }
 
-static struct nvmap_sci_ipc_entry *nvmap_find_entry_for_id(struct rb_root *es,
-					 u64 id)
-{
-	struct nvmap_sci_ipc_entry *e = NULL;
-	struct rb_node *n;
-
-	for (n = rb_first(es); n; n = rb_next(n)) {
-		e = rb_entry(n, struct nvmap_sci_ipc_entry, entry);
-		if (e && e->sci_ipc_id == id)
-			goto found;
-	}
-found:
-	return e;
-}
-
 int nvmap_get_handle_from_sci_ipc_id(struct nvmap_client *client, u32 flags,
 		u64 sci_ipc_id, NvSciIpcEndpointVuid localu_vuid, u32 *handle)
 {
@@ -219,6 +209,7 @@ int nvmap_get_handle_from_sci_ipc_id(struct nvmap_client *client, u32 flags,
 	struct nvmap_sci_ipc_entry *entry;
 	struct dma_buf *dmabuf = NULL;
 	struct nvmap_handle *h;
+	bool consumed = false;
 	long remain;
 	int ret = 0;
 	int fd;
@@ -228,18 +219,26 @@ int nvmap_get_handle_from_sci_ipc_id(struct nvmap_client *client, u32 flags,
 	pr_debug("%d: Sci_Ipc_Id %lld local_vuid: %llu flags: %u\n",
 		__LINE__, sci_ipc_id, localu_vuid, flags);
 
-	entry = nvmap_find_entry_for_id(&nvmapsciipc->entries, sci_ipc_id);
+	entry = xa_load(&nvmapsciipc->ids, sci_ipc_id);
 	if ((entry == NULL) || (entry->handle == NULL) ||
-		(entry->peer_vuid != localu_vuid) || (entry->flags != flags)) {
+		(entry->peer_vuid != localu_vuid) || (entry->flags != flags) ||
+		(entry->refcount == 0U)) {
 
 		pr_debug("%d: No matching Sci_Ipc_Id %lld found\n",
 		__LINE__, sci_ipc_id);
 
-		ret = -EINVAL;
-		goto unlock;
+		mutex_unlock(&nvmapsciipc->mlock);
+		return -EINVAL;
 	}
 
+	/*
+	 * Claim one export, its handle reference keeps h alive while the
+	 * import runs without mlock. A failed import gives the export back.
+	 */
 	h = entry->handle;
+	entry->refcount--;
+	entry->inflight++;
+	mutex_unlock(&nvmapsciipc->mlock);
 
 	mutex_lock(&h->lock);
 	if (is_ro) {
@@ -248,7 +247,7 @@ int nvmap_get_handle_from_sci_ipc_id(struct nvmap_client *client, u32 flags,
 			if (IS_ERR(h->dmabuf_ro)) {
 				ret = PTR_ERR(h->dmabuf_ro);
 				mutex_unlock(&h->lock);
-				goto unlock;
+				goto done;
 			}
 		} else {
 #if defined(NV_GET_FILE_RCU_HAS_DOUBLE_PTR_FILE_ARG) /* Linux 6.7 */
@@ -265,11 +264,11 @@ int nvmap_get_handle_from_sci_ipc_id(struct nvmap_client *client, u32 flags,
 					if (IS_ERR(h->dmabuf_ro)) {
 						ret = PTR_ERR(h->dmabuf_ro);
 						mutex_unlock(&h->lock);
-						goto unlock;
+						goto done;
 					}
 				} else {
 					ret = -EINVAL;
-					goto unlock;
+					goto done;
 				}
 			}
 		}
@@ -287,9 +286,10 @@ int nvmap_get_handle_from_sci_ipc_id(struct nvmap_client *client, u32 flags,
 
 	if (IS_ERR(ref)) {
 		ret = -EINVAL;
-		goto unlock;
+		goto done;
 	}
 	nvmap_handle_put(h);
+	consumed = true;
 
 	if (!IS_ERR(ref)) {
 		u32 id = 0;
@@ -307,7 +307,7 @@ int nvmap_get_handle_from_sci_ipc_id(struct nvmap_client *client, u32 flags,
 					dma_buf_put(dmabuf);
 				nvmap_free_handle(client, h, is_ro);
 				ret = -ENOMEM;
-				goto unlock;
+				goto done;
 			}
 			if (!id)
 				*handle = 0;
@@ -321,28 +321,20 @@ int nvmap_get_handle_from_sci_ipc_id(struct nvmap_client *client, u32 flags,
 					dma_buf_put(dmabuf);
 				nvmap_free_handle(client, h, is_ro);
 				ret = -EINVAL;
-				goto unlock;
+				goto done;
 			}
 			*handle = fd;
 			fd_install(fd, dmabuf->file);
 		}
 	}
-	entry->refcount--;
-	if (entry->refcount == 0U) {
-		struct free_sid_node *free_node;
-
-		rb_erase(&entry->entry, &nvmapsciipc->entries);
-		free_node = kzalloc(sizeof(*free_node), GFP_KERNEL);
-		if (free_node == NULL) {
-			ret = -ENOMEM;
-			kfree(entry);
-			goto unlock;
-		}
-		free_node->sid = entry->sci_ipc_id;
-		list_add_tail(&free_node->list, &nvmapsciipc->free_sid_list);
-		kfree(entry);
-	}
-unlock:
+done:
+	mutex_lock(&nvmapsciipc->mlock);
+	entry->inflight--;
+	/* The export is used up once its handle reference was dropped */
+	if (ret && !consumed)
+		entry->refcount++;
+	if (entry->refcount == 0U && entry->inflight == 0U)
+		nvmap_remove_sci_ipc_entry(entry);
 	mutex_unlock(&nvmapsciipc->mlock);
 
 	if (!ret) {
@@ -368,7 +360,8 @@ int nvmap_sci_ipc_init(void)
 	nvmapsciipc = kzalloc(sizeof(*nvmapsciipc), GFP_KERNEL);
 	if (!nvmapsciipc)
 		return -ENOMEM;
-	nvmapsciipc->entries = RB_ROOT;
+	xa_init(&nvmapsciipc->ids);
+	hash_init(nvmapsciipc->exports);
 	INIT_LIST_HEAD(&nvmapsciipc->free_sid_list);
 	mutex_init(&nvmapsciipc->mlock);
 
@@ -379,14 +372,15 @@ void nvmap_sci_ipc_exit(void)
 {
 	struct nvmap_sci_ipc_entry *e;
 	struct free_sid_node *fnode, *temp;
-	struct rb_node *n;
+	unsigned long id;
 
 	mutex_lock(&nvmapsciipc->mlock);
-	while ((n = rb_first(&nvmapsciipc->entries))) {
-		e = rb_entry(n, struct nvmap_sci_ipc_entry, entry);
-		rb_erase(&e->entry, &nvmapsciipc->entries);
+	xa_for_each(&nvmapsciipc->ids, id, e) {
+		xa_erase(&nvmapsciipc->ids, id);
+		hash_del(&e->node);
 		kfree(e);
 	}
+	xa_destroy(&nvmapsciipc->ids);
 
 	list_for_each_entry_safe(fnode, temp, &nvmapsciipc->free_sid_list, list) {
 		list_del(&fnode->list);
@@ -6,11 +6,282 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/hashtable.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+
+#include <trace/events/nvmap.h>
 
 #include "nvmap_priv.h"
 
 struct nvmap_stats nvmap_stats;
 
+/*
+ * Per (process, tag) breakdown of allocator latencies, so a stalling
+ * process can be found among many. Entries live until stats are reset; a
+ * bounded number of them is kept and later comers are not tracked.
+ */
+#define NVMAP_LAT_MAX_CLIENTS	256
+
+struct nvmap_lat_client {
+	struct hlist_node node;
+	pid_t pid;
+	u32 tag;
+	char comm[TASK_COMM_LEN];
+	u64 allocs;
+	u64 alloc_ns;
+	u64 alloc_max_ns;
+	u64 alloc_bytes;
+	u64 pp_hits;
+	u64 pp_misses;
+	u64 cache_maints;
+	u64 cache_maint_ns;
+	u64 alloc_hist[NVMAP_LAT_BUCKETS];
+};
+
+static DEFINE_HASHTABLE(nvmap_lat_clients, 6);
+static DEFINE_SPINLOCK(nvmap_lat_lock);
+static u32 nvmap_lat_nr_clients;
+
+static inline int nvmap_lat_bucket(u64 ns)
+{
+	u64 us = ns >> 10;
+
+	if (!us)
+		return 0;
+	return min_t(int, ilog2(us), NVMAP_LAT_BUCKETS - 1);
+}
+
+static void nvmap_lat_hist_add(struct nvmap_lat_hist *hist, u64 ns)
+{
+	atomic64_inc(&hist->count[nvmap_lat_bucket(ns)]);
+	atomic64_add(ns, &hist->total_ns);
+}
+
+static void nvmap_lat_hist_reset(struct nvmap_lat_hist *hist)
+{
+	int i;
+
+	for (i = 0; i < NVMAP_LAT_BUCKETS; i++)
+		atomic64_set(&hist->count[i], 0);
+	atomic64_set(&hist->total_ns, 0);
+}
+
+static pid_t nvmap_lat_client_pid(struct nvmap_client *client)
+{
+	return client && client->task ? task_tgid_nr(client->task) : 0;
+}
+
+/* Called with nvmap_lat_lock held */
+static struct nvmap_lat_client *nvmap_lat_client_get(
+		struct nvmap_client *client, u32 tag)
+{
+	pid_t pid = nvmap_lat_client_pid(client);
+	u64 key = ((u64)pid << 32) | tag;
+	struct nvmap_lat_client *lc;
+
+	hash_for_each_possible(nvmap_lat_clients, lc, node, key)
+		if (lc->pid == pid && lc->tag == tag)
+			return lc;
+
+	if (nvmap_lat_nr_clients >= NVMAP_LAT_MAX_CLIENTS)
+		return NULL;
+
+	lc = kzalloc(sizeof(*lc), GFP_NOWAIT | __GFP_NOWARN);
+	if (!lc)
+		return NULL;
+
+	lc->pid = pid;
+	lc->tag = tag;
+	if (client && client->task)
+		get_task_comm(lc->comm, client->task);
+	else if (client && client->name)
+		strscpy(lc->comm, client->name, sizeof(lc->comm));
+	hash_add(nvmap_lat_clients, &lc->node, key);
+	nvmap_lat_nr_clients++;
+	return lc;
+}
+
+static void nvmap_lat_clients_reset(void)
+{
+	struct nvmap_lat_client *lc;
+	struct hlist_node *tmp;
+	int bkt;
+
+	spin_lock(&nvmap_lat_lock);
+	hash_for_each_safe(nvmap_lat_clients, bkt, tmp, lc, node) {
+		hash_del(&lc->node);
+		kfree(lc);
+	}
+	nvmap_lat_nr_clients = 0;
+	spin_unlock(&nvmap_lat_lock);
+}
+
+void nvmap_stats_lat_alloc(struct nvmap_client *client, u32 tag,
+			   u32 heap_type, u32 flags, size_t size, u64 ns)
+{
+	struct nvmap_lat_client *lc;
+	int heap;
+
+	trace_nvmap_alloc_latency(nvmap_lat_client_pid(client), tag,
+				  heap_type, flags, size, ns);
+	if (!nvmap_stats_collecting())
+		return;
+
+	heap = heap_type & NVMAP_HEAP_IOVMM ? 0 :
+	       heap_type ? min_t(int, __fls(heap_type) + 1,
+				 NVMAP_LAT_HEAPS - 1) : 0;
+	nvmap_lat_hist_add(&nvmap_stats.alloc[heap]
+			   [flags & NVMAP_HANDLE_CACHE_FLAG], ns);
+
+	spin_lock(&nvmap_lat_lock);
+	lc = nvmap_lat_client_get(client, tag);
+	if (lc) {
+		lc->allocs++;
+		lc->alloc_ns += ns;
+		lc->alloc_max_ns = max(lc->alloc_max_ns, ns);
+		lc->alloc_bytes += size;
+		lc->alloc_hist[nvmap_lat_bucket(ns)]++;
+	}
+	spin_unlock(&nvmap_lat_lock);
+}
+
+void nvmap_stats_lat_cache_maint(struct nvmap_client *client, u32 tag,
+				 u32 op, size_t size, u64 ns)
+{
+	struct nvmap_lat_client *lc;
+
+	trace_nvmap_cache_maint_latency(nvmap_lat_client_pid(client), tag,
+					op, size, ns);
+	if (!nvmap_stats_collecting())
+		return;
+
+	nvmap_lat_hist_add(&nvmap_stats.cache_maint, ns);
+
+	spin_lock(&nvmap_lat_lock);
+	lc = nvmap_lat_client_get(client, tag);
+	if (lc) {
+		lc->cache_maints++;
+		lc->cache_maint_ns += ns;
+	}
+	spin_unlock(&nvmap_lat_lock);
+}
+
+void nvmap_stats_lat_pp_zero(u64 ns)
+{
+	if (nvmap_stats_collecting())
+		nvmap_lat_hist_add(&nvmap_stats.pp_zero, ns);
+}
+
+void nvmap_stats_pp_lookup(struct nvmap_client *client, u32 tag,
+			   u32 hits, u32 misses)
+{
+	struct nvmap_lat_client *lc;
+
+	if (!nvmap_stats_collecting())
+		return;
+
+	spin_lock(&nvmap_lat_lock);
+	lc = nvmap_lat_client_get(client, tag);
+	if (lc) {
+		lc->pp_hits += hits;
+		lc->pp_misses += misses;
+	}
+	spin_unlock(&nvmap_lat_lock);
+}
+
+static void nvmap_lat_hist_show(struct seq_file *s, const char *name,
+				struct nvmap_lat_hist *hist)
+{
+	u64 count[NVMAP_LAT_BUCKETS], nr = 0;
+	int i;
+
+	for (i = 0; i < NVMAP_LAT_BUCKETS; i++) {
+		count[i] = atomic64_read(&hist->count[i]);
+		nr += count[i];
+	}
+	if (!nr)
+		return;
+
+	seq_printf(s, "%-20s %10llu %10llu", name, nr,
+		   div64_u64(atomic64_read(&hist->total_ns), nr * NSEC_PER_USEC));
+	for (i = 0; i < NVMAP_LAT_BUCKETS; i++)
+		seq_printf(s, " %llu", count[i]);
+	seq_puts(s, "\n");
+}
+
+static int nvmap_stats_latency_show(struct seq_file *s, void *unused)
+{
+	static const char * const cache_names[NVMAP_LAT_FLAGS] = {
+		"uc", "wc", "inner", "cached",
+	};
+	char name[32];
+	int heap, flag;
+
+	seq_printf(s, "%-20s %10s %10s %s\n", "histogram", "count", "avg_us",
+		   "log2(us) buckets");
+	for (heap = 0; heap < NVMAP_LAT_HEAPS; heap++) {
+		for (flag = 0; flag < NVMAP_LAT_FLAGS; flag++) {
+			if (heap)
+				snprintf(name, sizeof(name), "alloc.co%d.%s",
+					 heap - 1, cache_names[flag]);
+			else
+				snprintf(name, sizeof(name), "alloc.iovmm.%s",
+					 cache_names[flag]);
+			nvmap_lat_hist_show(s, name, &nvmap_stats.alloc[heap][flag]);
+		}
+	}
+	nvmap_lat_hist_show(s, "cache_maint", &nvmap_stats.cache_maint);
+	nvmap_lat_hist_show(s, "pp_zero", &nvmap_stats.pp_zero);
+	return 0;
+}
+
+static int nvmap_stats_latency_clients_show(struct seq_file *s, void *unused)
+{
+	struct nvmap_lat_client *lc;
+	int bkt, i;
+
+	seq_printf(s, "%-8s %-16s %-10s %8s %10s %10s %12s %10s %10s %8s %10s %s\n",
+		   "pid", "comm", "tag", "allocs", "avg_us", "max_us",
+		   "bytes", "pp_hits", "pp_misses", "cmaints", "cmaint_us",
+		   "log2(us) alloc buckets");
+	spin_lock(&nvmap_lat_lock);
+	hash_for_each(nvmap_lat_clients, bkt, lc, node) {
+		seq_printf(s, "%-8d %-16s 0x%08x %8llu %10llu %10llu %12llu %10llu %10llu %8llu %10llu",
+			   lc->pid, lc->comm, lc->tag, lc->allocs,
+			   lc->allocs ? div64_u64(lc->alloc_ns,
+					lc->allocs * NSEC_PER_USEC) : 0,
+			   div64_u64(lc->alloc_max_ns, NSEC_PER_USEC),
+			   lc->alloc_bytes, lc->pp_hits, lc->pp_misses,
+			   lc->cache_maints,
+			   div64_u64(lc->cache_maint_ns, NSEC_PER_USEC));
+		for (i = 0; i < NVMAP_LAT_BUCKETS; i++)
+			seq_printf(s, " %llu", lc->alloc_hist[i]);
+		seq_puts(s, "\n");
+	}
+	spin_unlock(&nvmap_lat_lock);
+	return 0;
+}
+
+#define NVMAP_STATS_FOPS(name) \
+static int nvmap_stats_##name##_open(struct inode *inode, struct file *file) \
+{ \
+	return single_open(file, nvmap_stats_##name##_show, inode->i_private); \
+} \
+\
+static const struct file_operations nvmap_stats_##name##_fops = { \
+	.open = nvmap_stats_##name##_open, \
+	.read = seq_read, \
+	.llseek = seq_lseek, \
+	.release = single_release, \
+}
+
+NVMAP_STATS_FOPS(latency);
+NVMAP_STATS_FOPS(latency_clients);
+
 static int nvmap_stats_reset(void *data, u64 val)
 {
 	int i;
@@ -22,6 +293,11 @@ static int nvmap_stats_reset(void *data, u64 val)
 				continue;
 			atomic64_set(&nvmap_stats.stats[i], 0);
 		}
+		for (i = 0; i < NVMAP_LAT_HEAPS * NVMAP_LAT_FLAGS; i++)
+			nvmap_lat_hist_reset(&nvmap_stats.alloc[0][0] + i);
+		nvmap_lat_hist_reset(&nvmap_stats.cache_maint);
+		nvmap_lat_hist_reset(&nvmap_stats.pp_zero);
+		nvmap_lat_clients_reset();
 	}
 	return 0;
 }
@@ -66,12 +342,19 @@ void nvmap_stats_init(struct dentry *nvmap_debug_root)
 		CREATE_DF(ucflush_done, nvmap_stats.stats[NS_UCFLUSH_DONE]);
 		CREATE_DF(kcflush_rq, nvmap_stats.stats[NS_KCFLUSH_RQ]);
 		CREATE_DF(kcflush_done, nvmap_stats.stats[NS_KCFLUSH_DONE]);
+		CREATE_DF(sgt_stash_hit, nvmap_stats.stats[NS_SGT_STASH_HIT]);
+		CREATE_DF(sgt_stash_miss, nvmap_stats.stats[NS_SGT_STASH_MISS]);
+		CREATE_DF(sgt_stash_evict, nvmap_stats.stats[NS_SGT_STASH_EVICT]);
 		CREATE_DF(total_memory, nvmap_stats.stats[NS_TOTAL]);
 
 		debugfs_create_file("collect", S_IRUGO | S_IWUSR,
 			stats_root, &nvmap_stats.collect, &stats_fops);
 		debugfs_create_file("reset", S_IWUSR,
 			stats_root, NULL, &reset_stats_fops);
+		debugfs_create_file("latency", S_IRUGO,
+			stats_root, NULL, &nvmap_stats_latency_fops);
+		debugfs_create_file("latency_clients", S_IRUGO,
+			stats_root, NULL, &nvmap_stats_latency_clients_fops);
 	}
 
 #undef CREATE_DF
@@ -19,19 +19,54 @@ enum nvmap_stats_t {
 	NS_UCFLUSH_DONE,
 	NS_KCFLUSH_RQ,
 	NS_KCFLUSH_DONE,
+	NS_SGT_STASH_HIT,
+	NS_SGT_STASH_MISS,
+	NS_SGT_STASH_EVICT,
 	NS_TOTAL,
 	NS_NUM,
 };
 
+/*
+ * Latency histograms, collected only while stats/collect is set. Bucket i
+ * counts events that took [2^i, 2^(i+1)) microseconds, bucket 0 also
+ * takes everything faster and the last bucket everything slower.
+ */
+#define NVMAP_LAT_BUCKETS	20
+#define NVMAP_LAT_HEAPS		8	/* iovmm + first seven carveout bits */
+#define NVMAP_LAT_FLAGS		4	/* NVMAP_HANDLE_CACHE_FLAG values */
+
+struct nvmap_lat_hist {
+	atomic64_t count[NVMAP_LAT_BUCKETS];
+	atomic64_t total_ns;
+};
+
 struct nvmap_stats {
 	atomic64_t stats[NS_NUM];
 	atomic64_t collect;
+	struct nvmap_lat_hist alloc[NVMAP_LAT_HEAPS][NVMAP_LAT_FLAGS];
+	struct nvmap_lat_hist cache_maint;
+	struct nvmap_lat_hist pp_zero;
 };
 
 extern struct nvmap_stats nvmap_stats;
 
+struct nvmap_client;
+
 void nvmap_stats_init(struct dentry *nvmap_debug_root);
 void nvmap_stats_inc(enum nvmap_stats_t, size_t size);
 void nvmap_stats_dec(enum nvmap_stats_t, size_t size);
 u64 nvmap_stats_read(enum nvmap_stats_t);
+
+static inline bool nvmap_stats_collecting(void)
+{
+	return atomic64_read(&nvmap_stats.collect);
+}
+
+void nvmap_stats_lat_alloc(struct nvmap_client *client, u32 tag,
+			   u32 heap_type, u32 flags, size_t size, u64 ns);
+void nvmap_stats_lat_cache_maint(struct nvmap_client *client, u32 tag,
+				 u32 op, size_t size, u64 ns);
+void nvmap_stats_lat_pp_zero(u64 ns);
+void nvmap_stats_pp_lookup(struct nvmap_client *client, u32 tag,
+			   u32 hits, u32 misses);
 #endif /* __VIDEO_TEGRA_NVMAP_STATS_H */
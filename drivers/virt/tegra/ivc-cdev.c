@@ -13,6 +13,7 @@
 #include <linux/poll.h>
 #include <linux/interrupt.h>
 #include <linux/device.h>
+#include <linux/eventfd.h>
 #include <linux/slab.h>
 #include <linux/mm.h>
 #include <linux/sched.h>
@@ -47,6 +48,10 @@ struct ivc_dev {
 	struct mutex		file_lock;
 	/* Bool to store whether we received any ivc interrupt */
 	bool			ivc_intr_rcvd;
+
+	/* eventfd signalled from the hard irq handler, if userspace set one */
+	spinlock_t		evt_lock;
+	struct eventfd_ctx	*evt_ctx;
 };
 
 static dev_t ivc_dev;
@@ -73,6 +78,21 @@ static irqreturn_t ivc_dev_handler(int irq, void *data)
 
 static irqreturn_t ivc_threaded_irq_handler(int irq, void *dev_id)
 {
+	struct ivc_dev *ivcd = dev_id;
+
+	/*
+	 * Signal the eventfd right away, userspace polling the mapped queues
+	 * does not need to wait for the thread.
+	 */
+	spin_lock(&ivcd->evt_lock);
+	if (ivcd->evt_ctx != NULL)
+#if defined(NV_EVENTFD_SIGNAL_HAS_COUNTER_ARG)
+		eventfd_signal(ivcd->evt_ctx, 1);
+#else
+		eventfd_signal(ivcd->evt_ctx);
+#endif
+	spin_unlock(&ivcd->evt_lock);
+
 	/*
 	 * Virtual IRQs are known to be edge-triggered, so no action is needed
 	 * to acknowledge them.
@@ -80,6 +100,30 @@ static irqreturn_t ivc_threaded_irq_handler(int irq, void *dev_id)
 	return IRQ_WAKE_THREAD;
 }
 
+static int ivc_dev_set_eventfd(struct ivc_dev *ivcd, int fd)
+{
+	struct eventfd_ctx *ctx = NULL;
+	struct eventfd_ctx *old;
+
+	if (fd >= 0) {
+		ctx = eventfd_ctx_fdget(fd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	} else if (fd != -1) {
+		return -EINVAL;
+	}
+
+	spin_lock_irq(&ivcd->evt_lock);
+	old = ivcd->evt_ctx;
+	ivcd->evt_ctx = ctx;
+	spin_unlock_irq(&ivcd->evt_lock);
+
+	if (old != NULL)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
 static int ivc_dev_open(struct inode *inode, struct file *filp)
 {
 	struct cdev *cdev = inode->i_cdev;
@@ -130,6 +174,12 @@ static int ivc_dev_release(struct inode *inode, struct file *filp)
 
 	devm_free_irq(ivcd->device, ivck->irq, ivcd);
 
+	/* the irq is gone, nothing can signal the eventfd any more */
+	if (ivcd->evt_ctx != NULL) {
+		eventfd_ctx_put(ivcd->evt_ctx);
+		ivcd->evt_ctx = NULL;
+	}
+
 	ivcd->ivck = NULL;
 
 	/*
@@ -236,6 +286,18 @@ static int ivc_dev_mmap(struct file *filp, struct vm_area_struct *vma)
 	return ret;
 }
 
+static bool ivc_dev_rx_first(const struct ivc_dev *ivcd)
+{
+	/*
+	 * The queue ids of loopback queues are always consecutive, so the
+	 * even-numbered one receives in the first area.
+	 */
+	if (ivcd->qd->peers[0] == ivcd->qd->peers[1])
+		return (ivcd->qd->id & 1) == 0;
+
+	return s_guestid == ivcd->qd->peers[0];
+}
+
 /* Need this temporarily to get the change merged. Will be removed later */
 #define NVIPC_IVC_IOCTL_GET_INFO_LEGACY 0xC018AA01
 #define NVIPC_IVC_IOCTL_NOTIFY_REMOTE_LEGACY 0xC018AA02
@@ -244,6 +306,8 @@ static long ivc_dev_ioctl(struct file *filp, unsigned int cmd,
 {
 	struct ivc_dev *ivcd = filp->private_data;
 	struct nvipc_ivc_info info;
+	struct nvipc_ivc_ring ring;
+	int32_t fd;
 	uint64_t ivc_area_ipa, ivc_area_size;
 	long ret = 0;
 
@@ -294,17 +358,7 @@ static long ivc_dev_ioctl(struct file *filp, unsigned int cmd,
 		info.noti_irq = ivcd->qd->raise_irq;
 #endif /* SUPPORTS_TRAP_MSI_NOTIFICATION */
 
-		if (ivcd->qd->peers[0] == ivcd->qd->peers[1]) {
-			/*
-			 * The queue ids of loopback queues are always
-			 * consecutive, so the even-numbered one
-			 * receives in the first area.
-			 */
-			info.rx_first = (ivcd->qd->id & 1) == 0;
-
-		} else {
-			info.rx_first = (s_guestid == ivcd->qd->peers[0]);
-		}
+		info.rx_first = ivc_dev_rx_first(ivcd);
 
 		if (cmd == NVIPC_IVC_IOCTL_GET_INFO) {
 			if (copy_to_user((void __user *) arg, &info,
@@ -325,6 +379,31 @@ static long ivc_dev_ioctl(struct file *filp, unsigned int cmd,
 		tegra_hv_ivc_notify(ivcd->ivck);
 		break;
 
+	case NVIPC_IVC_IOCTL_SET_EVENTFD:
+		if (copy_from_user(&fd, (void __user *) arg, sizeof(fd))) {
+			ret = -EFAULT;
+			goto exit;
+		}
+
+		ret = ivc_dev_set_eventfd(ivcd, fd);
+		break;
+
+	case NVIPC_IVC_IOCTL_GET_RING:
+		memset(&ring, 0, sizeof(ring));
+		if (ivc_dev_rx_first(ivcd)) {
+			ring.rx_offset = ivcd->qd->offset;
+			ring.tx_offset = ivcd->qd->offset + ivcd->qd->size;
+		} else {
+			ring.tx_offset = ivcd->qd->offset;
+			ring.rx_offset = ivcd->qd->offset + ivcd->qd->size;
+		}
+		ring.nframes = ivcd->qd->nframes;
+		ring.frame_size = ivcd->qd->frame_size;
+
+		if (copy_to_user((void __user *) arg, &ring, sizeof(ring)))
+			ret = -EFAULT;
+		break;
+
 	case NVIPC_IVC_IOCTL_GET_VMID:
 		if (copy_to_user((void __user *) arg, &s_guestid,
 			sizeof(s_guestid))) {
@@ -453,6 +532,7 @@ static int __init add_ivc(int i)
 	}
 
 	mutex_init(&ivc->file_lock);
+	spin_lock_init(&ivc->evt_lock);
 	init_waitqueue_head(&ivc->wq);
 
 	/* parent is this hvd dev */
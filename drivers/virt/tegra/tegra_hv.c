@@ -11,6 +11,8 @@
 #include <linux/errno.h>
 #include <linux/init.h>
 #include <linux/module.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/of_platform.h>
 #include <linux/slab.h>
@@ -65,6 +67,10 @@ struct hv_ivc {
 
 	char			name[16];
 	int			irq;
+
+	/* doorbells rung and skipped because the peer was draining */
+	atomic64_t		notify_raised;
+	atomic64_t		notify_suppressed;
 };
 
 #define cookie_to_ivc_dev(_cookie) \
@@ -98,6 +104,8 @@ struct tegra_hv_data {
 
 	struct class *hv_class;
 
+	struct dentry *debugfs;
+
 	struct device_node *dev;
 };
 
@@ -139,6 +147,14 @@ static void ivc_raise_irq(struct tegra_ivc *ivc_channel, void *data)
 	struct hv_ivc *ivc = container_of(ivc_channel, struct hv_ivc, ivc);
 	if (WARN_ON(!ivc->cookie.notify_va))
 		return;
+
+	/* each doorbell is a trap into the hypervisor, skip unwanted ones */
+	if (!tegra_ivc_peer_wants_notify(ivc_channel)) {
+		atomic64_inc(&ivc->notify_suppressed);
+		return;
+	}
+
+	atomic64_inc(&ivc->notify_raised);
 	*ivc->cookie.notify_va = ivc->qd->raise_irq;
 }
 
@@ -717,10 +733,27 @@ void tegra_hv_ivc_notify(struct tegra_hv_ivc_cookie *ivck)
 	ivc = cookie_to_ivc_dev(ivck);
 	if (WARN_ON(!ivc->cookie.notify_va))
 		return;
+	atomic64_inc(&ivc->notify_raised);
 	*ivc->cookie.notify_va = ivc->qd->raise_irq;
 }
 EXPORT_SYMBOL(tegra_hv_ivc_notify);
 
+void tegra_hv_ivc_notify_suppress(struct tegra_hv_ivc_cookie *ivck)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	tegra_ivc_notify_suppress(&ivc->ivc);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_notify_suppress);
+
+bool tegra_hv_ivc_notify_enable(struct tegra_hv_ivc_cookie *ivck)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	return tegra_ivc_notify_enable(&ivc->ivc);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_notify_enable);
+
 int tegra_hv_ivc_get_info(struct tegra_hv_ivc_cookie *ivck, uint64_t *pa,
 			  uint64_t *size)
 {
@@ -806,6 +839,24 @@ int tegra_hv_ivc_read_user(struct tegra_hv_ivc_cookie *ivck, void __user *buf, i
 }
 EXPORT_SYMBOL(tegra_hv_ivc_read_user);
 
+int tegra_hv_ivc_write_batch(struct tegra_hv_ivc_cookie *ivck, const void *buf,
+		int size, unsigned int count)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	return tegra_ivc_write_batch(&ivc->ivc, buf, size, count);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_write_batch);
+
+int tegra_hv_ivc_read_batch(struct tegra_hv_ivc_cookie *ivck, void *buf,
+		int size, unsigned int count)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	return tegra_ivc_read_batch(&ivc->ivc, buf, size, count);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_read_batch);
+
 int tegra_hv_ivc_read_peek(struct tegra_hv_ivc_cookie *ivck, void *buf,
 			   int off, int count)
 {
@@ -952,10 +1003,31 @@ void tegra_hv_ivc_channel_reset(struct tegra_hv_ivc_cookie *ivck)
 		BUG();
 	}
 
-	tegra_ivc_reset(&ivc->ivc);
+	tegra_ivc_channel_reset(&ivc->ivc);
 }
 EXPORT_SYMBOL(tegra_hv_ivc_channel_reset);
 
+static int ivc_notify_stats_show(struct seq_file *s, void *unused)
+{
+	struct tegra_hv_data *hvd = s->private;
+	uint32_t id;
+
+	seq_puts(s, "id raised suppressed\n");
+	for (id = 0; id <= hvd->max_qid; id++) {
+		struct hv_ivc *ivc = ivc_device_by_id(hvd, id);
+
+		if (ivc == NULL)
+			continue;
+
+		seq_printf(s, "%u %lld %lld\n", id,
+			   atomic64_read(&ivc->notify_raised),
+			   atomic64_read(&ivc->notify_suppressed));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ivc_notify_stats);
+
 static int tegra_hv_probe(struct platform_device *pdev)
 {
 	struct tegra_hv_data *hvd;
@@ -985,6 +1057,10 @@ static int tegra_hv_probe(struct platform_device *pdev)
 
 	BUG_ON(tegra_hv_data);
 	tegra_hv_data = hvd;
+
+	hvd->debugfs = debugfs_create_dir(DRV_NAME, NULL);
+	debugfs_create_file("ivc_notify_stats", 0444, hvd->debugfs, hvd,
+			    &ivc_notify_stats_fops);
 	INFO("tegra_hv driver probed successfully\n");
 
 	return 0;
@@ -995,6 +1071,7 @@ static int tegra_hv_remove(struct platform_device *pdev)
 	if (!is_tegra_hypervisor_mode())
 		return 0;
 
+	debugfs_remove_recursive(tegra_hv_data->debugfs);
 	tegra_hv_cleanup(tegra_hv_data);
 	kfree(tegra_hv_data);
 	tegra_hv_data = NULL;
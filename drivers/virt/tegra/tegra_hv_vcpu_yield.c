@@ -19,6 +19,11 @@
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
 #include <uapi/linux/tegra_hv_vcpu_yield_ioctl.h>
 #include <linux/interrupt.h>
 #include <soc/tegra/virt/hv-ivc.h>
@@ -28,8 +33,26 @@
 #define MAX_VCPU_YIELD_TIMEOUT_US 1000000
 #define MAX_IVC_READ_FLUSH 10
 
+/* log2 of microseconds, the last bucket takes everything above */
+#define VCPU_YIELD_HIST_BUCKETS 21
+
+/* weight of a new sample, 1/2^shift, in the timer overshoot estimate */
+#define VCPU_YIELD_EWMA_SHIFT 3
+
 #define DRV_NAME	"tegra_hv_vcpu_yield"
 
+struct vcpu_yield_stats {
+	u64 yields;
+	u64 ivc_wakeups;
+	u64 timeouts;
+	/* yields that ended in the spin window, and those the IVC ended */
+	u64 spins;
+	u64 spin_hits;
+	/* yield duration, and how late the yield returned past its deadline */
+	u64 yield_hist[VCPU_YIELD_HIST_BUCKETS];
+	u64 overshoot_hist[VCPU_YIELD_HIST_BUCKETS];
+};
+
 struct vcpu_yield_dev {
 	int minor;
 	dev_t dev;
@@ -45,6 +68,19 @@ struct vcpu_yield_dev {
 	char name[32];
 	bool char_is_open;
 	bool yield_in_progress;
+
+	/*
+	 * Learned in adaptive mode: how late the VCPU comes back after the
+	 * yield timer fired, mean and mean deviation, and how long the low
+	 * priority VM usually takes until its IVC message.
+	 */
+	s64 overshoot_avg_ns;
+	s64 overshoot_dev_ns;
+	s64 ivc_wait_avg_ns;
+
+	spinlock_t stats_lock;
+	struct vcpu_yield_stats stats;
+	struct dentry *debugfs;
 };
 
 struct vcpu_yield_plat_dev {
@@ -52,10 +88,20 @@ struct vcpu_yield_plat_dev {
 	dev_t vcpu_yield_dev;
 	struct class *vcpu_yield_class;
 	int vmid_count;
+	struct dentry *debugfs;
 };
 
 static uint32_t max_timeout_us = MAX_VCPU_YIELD_TIMEOUT_US;
 
+static bool adaptive;
+module_param(adaptive, bool, 0644);
+MODULE_PARM_DESC(adaptive,
+	"Wake up early by the learned resume latency and spin until the deadline");
+
+static unsigned int max_spin_us = 100;
+module_param(max_spin_us, uint, 0644);
+MODULE_PARM_DESC(max_spin_us, "Longest spin window of the adaptive mode in us");
+
 static enum hrtimer_restart timer_callback_func(struct hrtimer *hrt)
 {
 	return HRTIMER_NORESTART;
@@ -71,14 +117,56 @@ static irqreturn_t tegra_hv_vcpu_yield_ivc_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+static inline unsigned int vcpu_yield_hist_bucket(s64 ns)
+{
+	s64 us = div_s64(ns, NSEC_PER_USEC);
+
+	if (us <= 0)
+		return 0;
+
+	return min_t(unsigned int, fls64(us), VCPU_YIELD_HIST_BUCKETS - 1);
+}
+
+static inline void vcpu_yield_ewma(s64 *avg, s64 sample)
+{
+	*avg += (sample - *avg) >> VCPU_YIELD_EWMA_SHIFT;
+}
+
+/*
+ * How much earlier than the deadline to arm the yield timer: the expected
+ * overshoot plus twice its deviation, within the spin window.
+ */
+static s64 vcpu_yield_lead_ns(struct vcpu_yield_dev *vcpu_yield,
+			      s64 timeout_ns)
+{
+	s64 lead = vcpu_yield->overshoot_avg_ns +
+		   2 * vcpu_yield->overshoot_dev_ns;
+	s64 max_spin = (s64)READ_ONCE(max_spin_us) * NSEC_PER_USEC;
+
+	return clamp_t(s64, lead, 0, min(max_spin, timeout_ns));
+}
+
+static void vcpu_yield_learn_overshoot(struct vcpu_yield_dev *vcpu_yield,
+				       s64 overshoot_ns)
+{
+	s64 dev = abs(overshoot_ns - vcpu_yield->overshoot_avg_ns);
+
+	vcpu_yield_ewma(&vcpu_yield->overshoot_avg_ns, overshoot_ns);
+	vcpu_yield_ewma(&vcpu_yield->overshoot_dev_ns, dev);
+}
+
 static long vcpu_yield_func(void *data)
 {
-	ktime_t timeout;
+	ktime_t timeout, start, deadline, wake_at, now;
 	struct vcpu_yield_dev *vcpu_yield = (struct vcpu_yield_dev *)data;
+	struct vcpu_yield_stats *stats = &vcpu_yield->stats;
+	bool learn = READ_ONCE(adaptive);
 	int read_flush_count = 0;
 	bool ivc_rcvd = false;
+	bool spun = false;
+	s64 timeout_ns;
 
-	timeout = ktime_set(0, (NSEC_PER_USEC * vcpu_yield->timeout_us));
+	timeout_ns = (s64)NSEC_PER_USEC * vcpu_yield->timeout_us;
 
 	do {
 		if (tegra_hv_ivc_read_advance(vcpu_yield->ivck))
@@ -91,6 +179,14 @@ static long vcpu_yield_func(void *data)
 		return -EBUSY;
 	}
 
+	start = ktime_get();
+	deadline = ktime_add_ns(start, timeout_ns);
+	wake_at = deadline;
+	if (learn)
+		wake_at = ktime_sub_ns(deadline,
+				vcpu_yield_lead_ns(vcpu_yield, timeout_ns));
+	timeout = ktime_sub(wake_at, start);
+
 	while ((timeout > 0) && (ivc_rcvd == false)) {
 
 		preempt_disable();
@@ -117,8 +213,89 @@ static long vcpu_yield_func(void *data)
 		preempt_enable();
 	}
 
+	now = ktime_get();
+
+	/* the timer brought us back, it tells how late the VCPU resumes */
+	if (learn && !ivc_rcvd)
+		vcpu_yield_learn_overshoot(vcpu_yield,
+				max_t(s64, ktime_to_ns(ktime_sub(now, wake_at)), 0));
+
+	/*
+	 * Spin out the rest of the window rather than yield into a resume
+	 * latency that would overshoot the deadline.
+	 */
+	if (learn && !ivc_rcvd && ktime_before(now, deadline)) {
+		spun = true;
+		preempt_disable();
+		while (ktime_before(now, deadline)) {
+			if (tegra_hv_ivc_can_read(vcpu_yield->ivck)) {
+				ivc_rcvd = true;
+				break;
+			}
+			cpu_relax();
+			now = ktime_get();
+		}
+		preempt_enable();
+		now = ktime_get();
+	}
+
+	if (ivc_rcvd)
+		vcpu_yield_ewma(&vcpu_yield->ivc_wait_avg_ns,
+				ktime_to_ns(ktime_sub(now, start)));
+
+	spin_lock(&vcpu_yield->stats_lock);
+	stats->yields++;
+	if (ivc_rcvd)
+		stats->ivc_wakeups++;
+	else
+		stats->timeouts++;
+	if (spun) {
+		stats->spins++;
+		if (ivc_rcvd)
+			stats->spin_hits++;
+	}
+	stats->yield_hist[vcpu_yield_hist_bucket(
+			ktime_to_ns(ktime_sub(now, start)))]++;
+	stats->overshoot_hist[vcpu_yield_hist_bucket(
+			ktime_to_ns(ktime_sub(now, deadline)))]++;
+	spin_unlock(&vcpu_yield->stats_lock);
+
+	return 0;
+}
+
+static int vcpu_yield_stats_show(struct seq_file *s, void *unused)
+{
+	struct vcpu_yield_dev *vcpu_yield = s->private;
+	struct vcpu_yield_stats stats;
+	unsigned int i;
+
+	spin_lock(&vcpu_yield->stats_lock);
+	stats = vcpu_yield->stats;
+	spin_unlock(&vcpu_yield->stats_lock);
+
+	seq_printf(s, "yields: %llu\n", stats.yields);
+	seq_printf(s, "ivc_wakeups: %llu\n", stats.ivc_wakeups);
+	seq_printf(s, "timeouts: %llu\n", stats.timeouts);
+	seq_printf(s, "spins: %llu\n", stats.spins);
+	seq_printf(s, "spin_hits: %llu\n", stats.spin_hits);
+	seq_printf(s, "overshoot_avg_ns: %lld\n",
+		   READ_ONCE(vcpu_yield->overshoot_avg_ns));
+	seq_printf(s, "overshoot_dev_ns: %lld\n",
+		   READ_ONCE(vcpu_yield->overshoot_dev_ns));
+	seq_printf(s, "ivc_wait_avg_ns: %lld\n",
+		   READ_ONCE(vcpu_yield->ivc_wait_avg_ns));
+
+	seq_puts(s, "bucket_us yield overshoot\n");
+	for (i = 0; i < VCPU_YIELD_HIST_BUCKETS; i++)
+		seq_printf(s, "%s%llu %llu %llu\n",
+			   (i == VCPU_YIELD_HIST_BUCKETS - 1) ? ">=" : "<",
+			   (i == VCPU_YIELD_HIST_BUCKETS - 1) ?
+			   1ULL << (i - 1) : 1ULL << i,
+			   stats.yield_hist[i], stats.overshoot_hist[i]);
+
 	return 0;
 }
+DEFINE_SHOW_ATTRIBUTE(vcpu_yield_stats);
 
 static int tegra_hv_vcpu_yield_open(struct inode *inode, struct file *filp)
 {
@@ -233,6 +410,8 @@ static int tegra_hv_vcpu_yield_remove(struct platform_device *pdev)
 
 	vcpu_yield_pdev = (struct vcpu_yield_plat_dev *)dev_get_drvdata(&pdev->dev);
 	if (vcpu_yield_pdev) {
+		debugfs_remove_recursive(vcpu_yield_pdev->debugfs);
+
 		vcpu_yield_dev_list = vcpu_yield_pdev->vcpu_yield_dev_list;
 		vcpu_yield_class = vcpu_yield_pdev->vcpu_yield_class;
 
@@ -384,6 +563,7 @@ static int tegra_hv_vcpu_yield_probe(struct platform_device *pdev)
 	}
 
 	vcpu_yield_pdev->vcpu_yield_class = vcpu_yield_class;
+	vcpu_yield_pdev->debugfs = debugfs_create_dir(DRV_NAME, NULL);
 
 	for (i = 0; i < vmid_count; i++) {
 		vcpu_yield = &vcpu_yield_dev_list[i];
@@ -415,6 +595,11 @@ static int tegra_hv_vcpu_yield_probe(struct platform_device *pdev)
 		}
 
 		mutex_init(&vcpu_yield->mutex_lock);
+		spin_lock_init(&vcpu_yield->stats_lock);
+		vcpu_yield->debugfs = debugfs_create_dir(vcpu_yield->name,
+					vcpu_yield_pdev->debugfs);
+		debugfs_create_file("stats", 0444, vcpu_yield->debugfs,
+				vcpu_yield, &vcpu_yield_stats_fops);
 
 		ivck = tegra_hv_ivc_reserve(NULL, vcpu_yield->ivc, NULL);
 		if (IS_ERR_OR_NULL(ivck)) {
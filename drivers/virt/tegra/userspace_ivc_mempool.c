@@ -14,6 +14,11 @@
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/mm.h>
+#include <linux/huge_mm.h>
+#include <linux/io.h>
+#include <linux/libnvdimm.h>
+#include <linux/mutex.h>
+#include <linux/version.h>
 #include <soc/tegra/fuse.h>
 #include <soc/tegra/virt/hv-ivc.h>
 #include <uapi/linux/nvhvivc_mempool_ioctl.h>
@@ -22,6 +27,16 @@
 
 #include "tegra_hv.h"
 
+#if defined(NV_VMF_INSERT_PFN_PMD_HAS_PFN_T_ARG)
+#include <linux/pfn_t.h>
+#endif
+
+/* 2MB block mappings of mempools with a 2MB aligned base */
+#if defined(CONFIG_ARM64_4K_PAGES) && defined(CONFIG_TRANSPARENT_HUGEPAGE) && \
+	LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
+#define IVC_MEMPOOL_HUGE_PAGES
+#endif
+
 /* userspace ivc mempool device */
 struct ivc_mempool_dev {
 	int			minor;
@@ -32,6 +47,15 @@ struct ivc_mempool_dev {
 	/* config data for this mempool */
 	const struct ivc_mempool *mempoolcfg;
 	struct tegra_hv_ivm_cookie *mpool_cookie;
+
+	/* protects the fields below, userspace may share the open file */
+	struct mutex		lock;
+	/* TEGRA_MPL_MAP_* of the mmap() */
+	uint32_t		map_attr;
+	/* attributes are fixed once mapped */
+	bool			mapped;
+	/* kernel mapping for the cache maintenance of cached mappings */
+	void			*kva;
 };
 
 /* maximum ivc mempool id from all ivc mempools assigned to this guest */
@@ -106,6 +130,8 @@ static int ivc_mempool_open(struct inode *inode, struct file *filp)
 		return PTR_ERR(mpool_cookie);
 
 	mempool_dev->mpool_cookie = mpool_cookie;
+	mempool_dev->map_attr = TEGRA_MPL_MAP_CACHED;
+	mempool_dev->mapped = false;
 
 	filp->private_data = mempool_dev;
 	return 0;
@@ -120,6 +146,11 @@ static int ivc_mempool_release(struct inode *inode, struct file *filp)
 			(mempooldev->mpool_cookie != NULL))))
 		return -EFAULT;
 
+	if (mempooldev->kva != NULL) {
+		memunmap(mempooldev->kva);
+		mempooldev->kva = NULL;
+	}
+
 	/* Unreserve the mempool */
 	ret = tegra_hv_mempool_unreserve(mempooldev->mpool_cookie);
 	if (ret < 0)
@@ -159,6 +190,80 @@ static ssize_t ivc_mempool_write(struct file *filp,
 	return -ENOTSUPP;
 }
 
+static vm_fault_t ivc_mempool_vma_fault(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct ivc_mempool_dev *mempooldev = vma->vm_private_data;
+	/* the mempool is mapped from offset 0, pgoff covers split VMAs */
+	unsigned long offs = vmf->pgoff << PAGE_SHIFT;
+
+	return vmf_insert_pfn(vma, vmf->address,
+			(mempooldev->mempoolcfg->pa + offs) >> PAGE_SHIFT);
+}
+
+#ifdef IVC_MEMPOOL_HUGE_PAGES
+static vm_fault_t ivc_mempool_vma_pmd_fault(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct ivc_mempool_dev *mempooldev = vma->vm_private_data;
+	unsigned long addr = vmf->address & PMD_MASK;
+	unsigned long offs, pfn;
+
+	/* the base is 2MB aligned, so is every 2MB aligned offset */
+	if (addr < vma->vm_start || addr + PMD_SIZE > vma->vm_end)
+		return VM_FAULT_FALLBACK;
+
+	offs = addr - vma->vm_start + (vma->vm_pgoff << PAGE_SHIFT);
+	if (offs & ~PMD_MASK)
+		return VM_FAULT_FALLBACK;
+
+	pfn = (mempooldev->mempoolcfg->pa + offs) >> PAGE_SHIFT;
+#if defined(NV_VMF_INSERT_PFN_PMD_HAS_PFN_T_ARG)
+	return vmf_insert_pfn_pmd(vmf, pfn_to_pfn_t(pfn),
+				  vmf->flags & FAULT_FLAG_WRITE);
+#else
+	return vmf_insert_pfn_pmd(vmf, pfn, vmf->flags & FAULT_FLAG_WRITE);
+#endif
+}
+
+#if defined(NV_VM_OPERATIONS_STRUCT_HUGE_FAULT_HAS_ORDER_ARG) /* Linux v6.6 */
+static vm_fault_t ivc_mempool_vma_huge_fault(struct vm_fault *vmf,
+					     unsigned int order)
+{
+	if (order != PMD_SHIFT - PAGE_SHIFT)
+		return VM_FAULT_FALLBACK;
+
+	return ivc_mempool_vma_pmd_fault(vmf);
+}
+#else
+static vm_fault_t ivc_mempool_vma_huge_fault(struct vm_fault *vmf,
+					     enum page_entry_size pe_size)
+{
+	if (pe_size != PE_SIZE_PMD)
+		return VM_FAULT_FALLBACK;
+
+	return ivc_mempool_vma_pmd_fault(vmf);
+}
+#endif
+#endif /* IVC_MEMPOOL_HUGE_PAGES */
+
+static const struct vm_operations_struct ivc_mempool_vm_ops = {
+	.fault		= ivc_mempool_vma_fault,
+#ifdef IVC_MEMPOOL_HUGE_PAGES
+	.huge_fault	= ivc_mempool_vma_huge_fault,
+#endif
+};
+
+static bool ivc_mempool_can_map_huge(struct ivc_mempool_dev *mempooldev)
+{
+#ifdef IVC_MEMPOOL_HUGE_PAGES
+	return IS_ALIGNED(mempooldev->mempoolcfg->pa, PMD_SIZE) &&
+		(mempooldev->mempoolcfg->size >= PMD_SIZE);
+#else
+	return false;
+#endif
+}
+
 static int ivc_mempool_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	struct ivc_mempool_dev *mempooldev = filp->private_data;
@@ -173,23 +278,120 @@ static int ivc_mempool_mmap(struct file *filp, struct vm_area_struct *vma)
 	/* fail if userspace attempts to partially map the mempool */
 	map_region_sz = vma->vm_end - vma->vm_start;
 
-	if (((vma->vm_pgoff == 0) &&
-		(map_region_sz == mempooldev->mempoolcfg->size))) {
+	if (!((vma->vm_pgoff == 0) &&
+		(map_region_sz == mempooldev->mempoolcfg->size)))
+		return ret;
 
-		mpool_ipa_pfn =
-			(mempooldev->mempoolcfg->pa >> PAGE_SHIFT);
+	mutex_lock(&mempooldev->lock);
+	if (mempooldev->map_attr == TEGRA_MPL_MAP_WRITECOMBINE)
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+	else if (mempooldev->map_attr == TEGRA_MPL_MAP_UNCACHED)
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	mempooldev->mapped = true;
+	mutex_unlock(&mempooldev->lock);
+
+	/*
+	 * Shared mappings of a 2MB aligned mempool are faulted in with block
+	 * entries, which cuts the TLB misses of bulk transfers.
+	 */
+	if (ivc_mempool_can_map_huge(mempooldev) &&
+	    (vma->vm_flags & VM_SHARED)) {
+#if defined(NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS) /* Linux v6.3 */
+		vm_flags_set(vma, VM_PFNMAP | VM_IO | VM_DONTEXPAND |
+				  VM_DONTDUMP | VM_HUGEPAGE);
+#else
+		vma->vm_flags |= VM_PFNMAP | VM_IO | VM_DONTEXPAND |
+				 VM_DONTDUMP | VM_HUGEPAGE;
+#endif
+		vma->vm_ops = &ivc_mempool_vm_ops;
+		vma->vm_private_data = mempooldev;
 
-		if (remap_pfn_range(vma, vma->vm_start,
-					mpool_ipa_pfn,
-					map_region_sz,
-					vma->vm_page_prot)) {
-			ret = -EAGAIN;
-		} else {
-			/* success! */
-			ret = 0;
+		return 0;
+	}
+
+	mpool_ipa_pfn =
+		(mempooldev->mempoolcfg->pa >> PAGE_SHIFT);
+
+	if (remap_pfn_range(vma, vma->vm_start,
+				mpool_ipa_pfn,
+				map_region_sz,
+				vma->vm_page_prot)) {
+		ret = -EAGAIN;
+	} else {
+		/* success! */
+		ret = 0;
+	}
+
+	return ret;
+}
+
+static int ivc_mempool_set_map_attr(struct ivc_mempool_dev *mempooldev,
+		uint32_t attr)
+{
+	int ret = 0;
+
+	if ((attr != TEGRA_MPL_MAP_CACHED) &&
+	    (attr != TEGRA_MPL_MAP_WRITECOMBINE) &&
+	    (attr != TEGRA_MPL_MAP_UNCACHED))
+		return -EINVAL;
+
+	mutex_lock(&mempooldev->lock);
+	if (mempooldev->mapped)
+		ret = -EBUSY;
+	else
+		mempooldev->map_attr = attr;
+	mutex_unlock(&mempooldev->lock);
+
+	return ret;
+}
+
+static long ivc_mempool_sync(struct ivc_mempool_dev *mempooldev,
+		const struct tegra_mpl_sync *sync)
+{
+	uint64_t size = mempooldev->mempoolcfg->size;
+	long ret = 0;
+
+	if ((sync->flags == 0U) || (sync->reserved != 0U) ||
+	    (sync->flags & ~(TEGRA_MPL_SYNC_WRITE | TEGRA_MPL_SYNC_READ)))
+		return -EINVAL;
+
+	if ((sync->offset > size) || (sync->size > size - sync->offset))
+		return -EINVAL;
+
+	mutex_lock(&mempooldev->lock);
+
+	/*
+	 * Write combined and uncached mappings bypass the caches, draining
+	 * the write buffers before the peer gets notified is all they need.
+	 */
+	if (mempooldev->map_attr != TEGRA_MPL_MAP_CACHED) {
+		mb();
+		goto unlock;
+	}
+
+#if IS_ENABLED(CONFIG_ARCH_HAS_PMEM_API)
+	if (mempooldev->kva == NULL) {
+		mempooldev->kva = memremap(mempooldev->mempoolcfg->pa, size,
+				MEMREMAP_WB);
+		if (mempooldev->kva == NULL) {
+			ret = -ENOMEM;
+			goto unlock;
 		}
 	}
 
+	/* the data caches are physically tagged, the kernel alias will do */
+	if (sync->flags & TEGRA_MPL_SYNC_WRITE)
+		arch_wb_cache_pmem(mempooldev->kva + sync->offset, sync->size);
+	if (sync->flags & TEGRA_MPL_SYNC_READ)
+		arch_invalidate_pmem(mempooldev->kva + sync->offset,
+				sync->size);
+#else
+	ret = -EOPNOTSUPP;
+#endif
+
+unlock:
+	mutex_unlock(&mempooldev->lock);
+
 	return ret;
 }
 
@@ -197,6 +399,8 @@ static long ivc_mempool_dev_ioctl(struct file *filp, unsigned int cmd,
 		unsigned long arg)
 {
 	struct ivc_mempool_dev *mempooldev = filp->private_data;
+	struct tegra_mpl_sync sync;
+	uint32_t attr;
 	long ret = 0;
 
 	/* validate the cmd */
@@ -214,6 +418,25 @@ static long ivc_mempool_dev_ioctl(struct file *filp, unsigned int cmd,
 				ret = -EFAULT;
 			}
 			break;
+
+		case TEGRA_MPLUSERSPACE_IOCTL_SET_MAP_ATTR:
+			if (copy_from_user(&attr, (void __user *) arg,
+					sizeof(attr))) {
+				ret = -EFAULT;
+				break;
+			}
+			ret = ivc_mempool_set_map_attr(mempooldev, attr);
+			break;
+
+		case TEGRA_MPLUSERSPACE_IOCTL_SYNC:
+			if (copy_from_user(&sync, (void __user *) arg,
+					sizeof(sync))) {
+				ret = -EFAULT;
+				break;
+			}
+			ret = ivc_mempool_sync(mempooldev, &sync);
+			break;
+
 		default:
 			/* The ioctl cmd number was validated against
 			 * TEGRA_MPLUSERSPACE_IOCTL_NUMBER_MAX so execution
@@ -234,6 +457,10 @@ static const struct file_operations ivc_mempool_fops = {
 	.write		= ivc_mempool_write,
 	.unlocked_ioctl	= ivc_mempool_dev_ioctl,
 	.mmap		= ivc_mempool_mmap,
+#ifdef IVC_MEMPOOL_HUGE_PAGES
+	/* a 2MB aligned address lets the whole mapping use block entries */
+	.get_unmapped_area = thp_get_unmapped_area,
+#endif
 };
 
 
@@ -244,6 +471,7 @@ static int __init add_ivc_mempool_dev(struct ivc_mempool_dev *mempooldev,
 
 	/* TODO - validate mempool data */
 	mempooldev->mempoolcfg = mempoolcfg;
+	mutex_init(&mempooldev->lock);
 	mempooldev->minor = mempooldev->mempoolcfg->id;
 	mempooldev->dev = MKDEV(MAJOR(ivc_mempool_first_cdev),
 			mempooldev->minor);
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA Corporation. All rights reserved.
+ */
+
+#ifndef DEVFREQ_NVHOST_PODGOV_H
+#define DEVFREQ_NVHOST_PODGOV_H
+
+#include <linux/devfreq.h>
+
+#define DEVFREQ_GOV_NVHOST_PODGOV	"nvhost_podgov"
+
+/**
+ * nvhost_podgov_notify_submit() - tell the governor that work was submitted
+ * @df:		devfreq device of the engine
+ *
+ * Lets the governor raise the clock at the start of a submit burst instead
+ * of after the load of the burst has been sampled. Does nothing when @df
+ * does not use the nvhost_podgov governor. Can be called from atomic
+ * context.
+ */
+void nvhost_podgov_notify_submit(struct devfreq *df);
+
+#endif /* DEVFREQ_NVHOST_PODGOV_H */
@@ -7,6 +7,8 @@
 #define DEVFREQ_TEGRA_WMARK_H
 
 #include <linux/devfreq.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
 #include <linux/notifier.h>
 #include <linux/types.h>
 
@@ -45,11 +47,48 @@ struct devfreq_tegra_wmark_config {
  * @update_wmark_threshold:	Callback function provided by the devfreq driver
  *				to update the watermark thresholds of the actmon
  *				monitoring the device active time.
+ * @bw_to_freq:			Optional callback converting a bandwidth in kBps
+ *				to the device frequency in Hz needed to sustain
+ *				it. Bandwidth requests are only accepted when it
+ *				is provided.
  */
 struct devfreq_tegra_wmark_data {
 	enum devfreq_tegra_wmark_event event;
 	void (*update_wmark_threshold)(struct devfreq *this,
 				       struct devfreq_tegra_wmark_config *cfg);
+	unsigned long (*bw_to_freq)(struct devfreq *this, u32 kbps);
 };
 
+/**
+ * struct devfreq_tegra_wmark_request - bandwidth request of a client
+ * @node:			Entry in the governor's request list
+ * @df:				The devfreq device the request applies to
+ * @name:			Name of the requesting client
+ * @kbps:			Requested bandwidth in kBps
+ * @floor_owner:		Request is the largest one while the requested
+ *				bandwidth sets the frequency
+ * @owner_since:		Time the request became floor owner
+ * @floor_ns:			Accumulated time as floor owner
+ *
+ * The requests of a device are summed and converted to a frequency floor,
+ * the watermark governor does not scale the device below it. Embed the
+ * structure in client data and treat all fields as private.
+ */
+struct devfreq_tegra_wmark_request {
+	struct list_head node;
+	struct devfreq *df;
+	const char *name;
+	u32 kbps;
+	bool floor_owner;
+	ktime_t owner_since;
+	u64 floor_ns;
+};
+
+int devfreq_tegra_wmark_add_request(struct devfreq *df,
+				    struct devfreq_tegra_wmark_request *req,
+				    const char *name);
+int devfreq_tegra_wmark_update_request(struct devfreq_tegra_wmark_request *req,
+				       u32 kbps);
+void devfreq_tegra_wmark_remove_request(struct devfreq_tegra_wmark_request *req);
+
 #endif /* DEVFREQ_TEGRA_WMARK_H */
@@ -28,6 +28,10 @@
 	(NVIDIA_P2P_MINOR_VERSION((p)->version) >= \
 	(NVIDIA_P2P_MINOR_VERSION(v))))
 
+struct nvidia_p2p_mm;
+struct nvidia_p2p_pin;
+struct nvidia_p2p_dma_cache;
+
 enum nvidia_p2p_page_size_type {
 	NVIDIA_P2P_PAGE_SIZE_4KB = 0,
 	NVIDIA_P2P_PAGE_SIZE_64KB,
@@ -46,10 +50,14 @@ typedef struct nvidia_p2p_page_table {
 	u32 mapped;
 
 	struct mm_struct *mm;
-	struct mmu_notifier mn;
 	struct mutex lock;
 	void (*free_callback)(void *data);
 	void *data;
+
+	/* Private to the driver */
+	struct list_head node;
+	struct nvidia_p2p_mm *p2p_mm;
+	struct nvidia_p2p_pin *pin;
 } nvidia_p2p_page_table_t;
 
 typedef struct nvidia_p2p_dma_mapping {
@@ -62,6 +70,9 @@ typedef struct nvidia_p2p_dma_mapping {
 	struct device *dev;
 	struct nvidia_p2p_page_table *page_table;
 	enum dma_data_direction direction;
+
+	/* Private to the driver */
+	struct nvidia_p2p_dma_cache *cache;
 } nvidia_p2p_dma_mapping_t;
 
 #define NVIDIA_P2P_PAGE_TABLE_VERSION   0x00010000
@@ -74,6 +85,10 @@ typedef struct nvidia_p2p_dma_mapping {
  *   Make the pages underlying a range of GPU virtual memory
  *   accessible to a third-party device.
  *
+ *   Pinned ranges are cached per process and keyed by vaddr and size,
+ *   so registering the same buffer again reuses the pages and their DMA
+ *   mappings until part of the range is invalidated.
+ *
  * @param[in]     vaddr
  *   A GPU Virtual Address
  * @param[in]     size
@@ -84,7 +99,8 @@ typedef struct nvidia_p2p_dma_mapping {
  * @param[in]     free_callback
  *   A non-NULL pointer to the function to be invoked when the pages
  *   underlying the virtual address range are freed
- *   implicitly. Must be non NULL.
+ *   implicitly. Must be non NULL. Adjacent page tables sharing the
+ *   same callback and data get a single callback per invalidation.
  * @param[in]     data
  *   A non-NULL opaque pointer to private data to be passed to the
  *   callback function.
@@ -116,7 +132,7 @@ int nvidia_p2p_put_pages(struct nvidia_p2p_page_table *page_table);
  * @brief
  * Release the pages previously made accessible to
  * a third-party device. This is called  during the
- * execution of the free_callback().
+ * execution of the free_callback(). The page table is freed.
  *
  * @param[in]    *page_table
  *   A pointer to struct nvidia_p2p_page_table
@@ -216,6 +216,8 @@ bool nvhost_syncpt_is_valid_pt_ext(struct platform_device *dev, u32 id);
 void nvhost_syncpt_set_minval(struct platform_device *dev, u32 id, u32 val);
 void nvhost_syncpt_set_min_update(struct platform_device *pdev, u32 id, u32 val);
 int nvhost_syncpt_read_ext_check(struct platform_device *dev, u32 id, u32 *val);
+int nvhost_syncpt_read_ext_batch(struct platform_device *pdev, const u32 *ids,
+				 u32 *vals, unsigned int num);
 u32 nvhost_syncpt_read_maxval(struct platform_device *dev, u32 id);
 u32 nvhost_syncpt_incr_max_ext(struct platform_device *dev, u32 id, u32 incrs);
 int nvhost_syncpt_is_expired_ext(struct platform_device *dev, u32 id,
@@ -75,4 +75,58 @@ int tegra_dce_unregister_ipc_client(u32 handle);
  */
 int tegra_dce_client_ipc_send_recv(u32 handle, struct dce_ipc_message *msg);
 
+#define DCE_CLIENT_IPC_MAX_BATCH		64U
+
+/*
+ * tegra_dce_client_ipc_done_t - completion callback of an async send
+ *
+ * @handle: handle the message was sent on.
+ * @status: 0 when msg->rx holds the response, else the error.
+ * @msg: message passed to the send call.
+ * @usr_ctx: context passed to the send call.
+ *
+ * Called from the DCE client workqueue, in the order the messages were
+ * sent. It may send further messages.
+ */
+typedef void (*tegra_dce_client_ipc_done_t)(u32 handle, int status,
+	      struct dce_ipc_message *msg, void *usr_ctx);
+
+/*
+ * tegra_dce_client_ipc_send_async() - send an rpc without waiting for it
+ * @handle : handle registered with dce driver
+ * @msg : message to be sent, tx and rx must stay valid until @done runs
+ * @done : called once the response is in msg->rx
+ * @usr_ctx : passed to @done
+ *
+ * As many messages as the IPC channel has frames are outstanding at the
+ * DCE, later ones are queued and sent as responses come back.
+ *
+ * Return: 0 if the message was sent or queued else error value.
+ */
+int tegra_dce_client_ipc_send_async(u32 handle, struct dce_ipc_message *msg,
+		tegra_dce_client_ipc_done_t done, void *usr_ctx);
+
+/*
+ * tegra_dce_client_ipc_send_batch() - send several rpcs back to back
+ * @handle : handle registered with dce driver
+ * @msgs : up to DCE_CLIENT_IPC_MAX_BATCH messages, e.g. the flips of a frame
+ * @count : number of messages
+ * @done : called once per message, in order
+ * @usr_ctx : passed to @done
+ *
+ * Either all messages are queued or, on error, none of them.
+ *
+ * Return: 0 if no errors else corresponding error value.
+ */
+int tegra_dce_client_ipc_send_batch(u32 handle, struct dce_ipc_message *msgs,
+		u32 count, tegra_dce_client_ipc_done_t done, void *usr_ctx);
+
+/*
+ * tegra_dce_client_ipc_flush() - wait for all async rpcs of a handle
+ * @handle : handle registered with dce driver
+ *
+ * Return: 0 once all callbacks ran, -ERESTARTSYS if interrupted.
+ */
+int tegra_dce_client_ipc_flush(u32 handle);
+
 #endif
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Batched and streaming access to the MC perfmon registers, for the HWPM
+ * driver. ip_dev is the ip_dev registered through tegra_soc_hwpm_ip_ops.
+ */
+
+#ifndef _LINUX_TEGRA_MC_HWPM_H
+#define _LINUX_TEGRA_MC_HWPM_H
+
+#include <linux/types.h>
+
+#define TEGRA_MC_HWPM_MAX_BATCH		1024
+#define TEGRA_MC_HWPM_MAX_STREAM_REGS	64
+#define TEGRA_MC_HWPM_MIN_STREAM_PERIOD_US	100
+
+enum tegra_mc_hwpm_op {
+	TEGRA_MC_HWPM_OP_READ,
+	TEGRA_MC_HWPM_OP_WRITE,
+};
+
+/*
+ * One register access, value is filled in by reads. Channel is as for
+ * hwpm_ip_reg_op: 0 is the broadcast channel and N is MC channel N - 1.
+ */
+struct tegra_mc_hwpm_reg_op {
+	u8 op;
+	u32 channel;
+	u32 offset;
+	u32 value;
+};
+
+struct tegra_mc_hwpm_stream_reg {
+	u32 channel;
+	u32 offset;
+};
+
+/*
+ * Every period the registers are read in order and stored as a record of
+ * a u64 CLOCK_MONOTONIC timestamp followed by nr_regs u32 values.
+ */
+struct tegra_mc_hwpm_stream_config {
+	const struct tegra_mc_hwpm_stream_reg *regs;
+	u32 nr_regs;
+	u32 period_us;
+	/* records kept until tegra_mc_hwpm_stream_read() */
+	u32 nr_records;
+};
+
+static inline size_t tegra_mc_hwpm_stream_record_size(u32 nr_regs)
+{
+	return sizeof(u64) + nr_regs * sizeof(u32);
+}
+
+int tegra_mc_hwpm_reg_ops(void *ip_dev, struct tegra_mc_hwpm_reg_op *ops,
+			  u32 count);
+int tegra_mc_hwpm_stream_start(void *ip_dev,
+			       const struct tegra_mc_hwpm_stream_config *config);
+int tegra_mc_hwpm_stream_read(void *ip_dev, void *buf, u32 max_records,
+			      u64 *dropped);
+void tegra_mc_hwpm_stream_stop(void *ip_dev);
+
+#endif /* _LINUX_TEGRA_MC_HWPM_H */
@@ -6,6 +6,7 @@
 #ifndef __LINUX_SPI_TEGRA124_SLAVE_H
 #define __LINUX_SPI_TEGRA124_SLAVE_H
 
+#include <linux/mm_types.h>
 #include <linux/spi/spi.h>
 
 typedef int (*spi_callback)(void *client_data);
@@ -14,4 +15,42 @@ int tegra124_spi_slave_register_callback(struct spi_device *spi,
 				      spi_callback func_ready,
 				      spi_callback func_isr,
 				      void *client_data);
+
+/*
+ * Continuous receive: the controller stays armed and a cyclic DMA fills a
+ * ring of nsegs segments of seg_len bytes each. seg_done is called from the
+ * DMA completion (tasklet) context once per filled segment, in order.
+ *
+ * Without manual_release a segment is handed back to the ring as soon as
+ * seg_done returns. With manual_release the client keeps it, e.g. to hand
+ * it to user space through tegra124_spi_slave_ring_mmap(), and gives it
+ * back with tegra124_spi_slave_ring_release(). A segment that is still
+ * held when the DMA needs it again is overwritten and counted as missed.
+ */
+struct tegra124_spi_slave_ring {
+	unsigned int seg_len;
+	unsigned int nsegs;
+	void (*seg_done)(void *client_data, unsigned int seg,
+			 const void *buf, unsigned int len);
+	void *client_data;
+	bool manual_release;
+};
+
+/* head and tail are free running segment counts, seg = count % nsegs */
+struct tegra124_spi_slave_ring_stats {
+	u64 head;
+	u64 tail;
+	u64 missed;
+	u64 fifo_overflows;
+};
+
+int tegra124_spi_slave_ring_start(struct spi_device *spi,
+				  const struct tegra124_spi_slave_ring *ring);
+void tegra124_spi_slave_ring_stop(struct spi_device *spi);
+int tegra124_spi_slave_ring_release(struct spi_device *spi,
+				    unsigned int count);
+int tegra124_spi_slave_ring_get_stats(struct spi_device *spi,
+				struct tegra124_spi_slave_ring_stats *stats);
+int tegra124_spi_slave_ring_mmap(struct spi_device *spi,
+				 struct vm_area_struct *vma);
 #endif
@@ -11,4 +11,19 @@ struct tegra_aon_mbox_msg {
 	void *data;
 };
 
+struct mbox_chan;
+
+/*
+ * IVC channels write each message synchronously, so tx is complete as soon
+ * as mbox_send_message() returns. Clients that set knows_txdone and clear
+ * tx_block can call mbox_client_txdone() right away instead of waiting for
+ * the mailbox core's tx done poll, which ticks at most once per ms.
+ *
+ * For bursts of small messages tegra_aon_mbox_send_batch() queues them all
+ * with a single notification of the remote.
+ */
+int tegra_aon_mbox_send_batch(struct mbox_chan *mbox_chan,
+			      const struct tegra_aon_mbox_msg *msgs,
+			      unsigned int count);
+
 #endif
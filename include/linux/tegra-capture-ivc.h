@@ -37,6 +37,23 @@ int tegra_capture_ivc_capture_submit(
 	const void *capture_desc,
 	size_t len);
 
+/**
+ * @brief Submit several capture messages to capture-IVC driver in one go.
+ *	The messages are written back-to-back under a single hold of the
+ *	IVC write lock, so they are not interleaved with other channels.
+ *
+ * @param[in]	capture_descs	array of @a count capture message
+ *				descriptors, each @a len bytes in size.
+ * @param[in]	len		size of a single capture message.
+ * @param[in]	count		number of capture messages.
+ *
+ * @returns	number of messages written (success), neg. errno (failure)
+ */
+int tegra_capture_ivc_capture_submit_batch(
+	const void *capture_descs,
+	size_t len,
+	unsigned int count);
+
 /**
  * @brief Callback function to be registered by client to receive the rtcpu
  *	notifications through control or capture IVC channel.
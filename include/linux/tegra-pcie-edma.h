@@ -2,7 +2,7 @@
 /*
  * PCIe DMA EPF Library for Tegra PCIe
  *
- * Copyright (C) 2021-2022 NVIDIA Corporation. All rights reserved.
+ * Copyright (C) 2021-2024 NVIDIA Corporation. All rights reserved.
  */
 
 #ifndef TEGRA_PCIE_EDMA_H
@@ -53,6 +53,14 @@ struct tegra_pcie_edma_desc;
 typedef void (edma_complete_t)(void *priv, edma_xfer_status_t status,
 			       struct tegra_pcie_edma_desc *desc);
 
+/**
+ * @brief Async batch callback function pointer.
+ *  Called from threaded interrupt context with the priv cookies of all the
+ *  xfers, in submit order, that finished with the same status.
+ */
+typedef void (edma_complete_batch_t)(void *batch_priv, edma_xfer_status_t status,
+				     void **cookies, uint32_t num);
+
 
 /** @brief Remote EDMA controller details.
  *  @note: this is initial revision and expected to be modified.
@@ -89,6 +97,18 @@ struct tegra_pcie_edma_chans_info {
 	phys_addr_t desc_phy_base;
 	/** Abosolute IOVA address of desc of desc_phy_base. */
 	dma_addr_t desc_iova;
+	/** Number of async xfers per completion interrupt.
+	 *  @note
+	 *   - If 0 is passed, intr_coalesce module parameter is used.
+	 *   - Pending xfers are reaped by a timer when no interrupt comes in time.
+	 */
+	uint32_t intr_coalesce;
+	/** Optional batch callback for async channels. If set, it is called instead of
+	 *  edma_complete_t and tegra_pcie_edma_xfer_info.complete may be NULL.
+	 */
+	edma_complete_batch_t *complete_batch;
+	/** Private data pointer passed as part of edma_complete_batch_t */
+	void *batch_priv;
 };
 
 /** @brief init data structure to be used for tegra_pcie_edma_init() API */
@@ -134,6 +154,28 @@ struct tegra_pcie_edma_xfer_info {
 	void *priv;
 };
 
+/** @brief per channel statistics returned by tegra_pcie_edma_get_stats() API */
+struct tegra_pcie_edma_chan_stats {
+	/** Number of xfers submitted */
+	uint64_t xfers;
+	/** Number of descriptors submitted */
+	uint64_t descs;
+	/** Number of bytes submitted */
+	uint64_t bytes;
+	/** Number of xfers rejected with EDMA_XFER_FAIL_NOMEM */
+	uint64_t ring_full;
+	/** Number of xfers submitted with a completion interrupt */
+	uint64_t intrs;
+	/** Number of completion passes run from the coalescing timer */
+	uint64_t timer_reaps;
+	/** Number of xfers completed */
+	uint64_t completions;
+	/** Time in ns the channel had descriptors outstanding */
+	uint64_t busy_ns;
+	/** Time in ns since channel init, the utilization is busy_ns / elapsed_ns */
+	uint64_t elapsed_ns;
+};
+
 /**
  * @brief: API to perform EDMA library initialization.
  * @param[in] info: EDMA init data structure. Refer struct tegra_pcie_edma_init_info for details.
@@ -151,6 +193,17 @@ void *tegra_pcie_edma_initialize(struct tegra_pcie_edma_init_info *info);
 edma_xfer_status_t tegra_pcie_edma_submit_xfer(void *cookie,
 						struct tegra_pcie_edma_xfer_info *tx_info);
 
+/**
+ * @brief: API to read channel statistics.
+ * @param[in] cookie : cookie data returned in tegra_pcie_edma_initialize() call.
+ * @param[in] type : channel type, EDMA_XFER_WRITE or EDMA_XFER_READ.
+ * @param[in] channel_num : channel number.
+ * @param[out] stats : channel statistics.
+ * @retVal: Returns true on success and false on failure.
+ */
+bool tegra_pcie_edma_get_stats(void *cookie, edma_xfer_type_t type, uint32_t channel_num,
+			       struct tegra_pcie_edma_chan_stats *stats);
+
 /**
  * @brief: API to stop EDMA engine,.
  * @param[in] cookie : cookie data returned in tegra_pcie_edma_initialize() call.
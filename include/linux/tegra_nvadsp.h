@@ -139,7 +139,10 @@ typedef struct _msgq_t {
 
 void msgq_init(msgq_t *msgq, int32_t size);
 int32_t msgq_queue_message(msgq_t *msgq, const msgq_message_t *message);
+int32_t msgq_queue_messages(msgq_t *msgq, const msgq_message_t * const *messages,
+			    int32_t count);
 int32_t msgq_dequeue_message(msgq_t *msgq, msgq_message_t *message);
+bool msgq_empty(msgq_t *msgq);
 #define msgq_discard_message(msgq) msgq_dequeue_message(msgq, NULL)
 
 /*
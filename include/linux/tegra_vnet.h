@@ -1,6 +1,6 @@
 /* SPDX-License-Identifier: GPL-2.0-only */
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.  All rights reserved.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.  All rights reserved.
  */
 
 #ifndef PCIE_EPF_TEGRA_DMA_H
@@ -27,6 +27,9 @@
 
 #define TVNET_NAPI_WEIGHT	64
 
+/* Data queue pairs, each with its own rings, interrupts and NAPI */
+#define TVNET_MAX_QUEUES	4
+
 #define RING_COUNT 256
 
 /* Allocate 100% extra desc to handle the drift between empty & full buffer */
@@ -199,6 +202,21 @@ struct ring_buf_md {
 	u32 ep2h_size;
 };
 
+/* Per data queue location of rings and interrupts in BAR0 */
+struct queue_md {
+	/* IRQ generation for data packets of this queue */
+	struct irq_md irq_data;
+	/* Ring buffers counter offset */
+	u32 ep_own_cnt_offset;
+	u32 host_own_cnt_offset;
+	/* Ring buffers location offset, ep2h/h2ep_md of bar_md for queue 0 */
+	struct ring_buf_md ep2h_md;
+	struct ring_buf_md h2ep_md;
+	/* EP DMA read channel and its link list used by host for this queue */
+	u32 host_dma_chan;
+	u32 host_dma_offset;
+};
+
 struct bar_md {
 	/* IRQ generation for control packets */
 	struct irq_md irq_ctrl;
@@ -218,6 +236,15 @@ struct bar_md {
 	u64 bar0_base_phy;
 	u32 ep_rx_pkt_offset;
 	u32 ep_rx_pkt_size;
+	/*
+	 * Multi-queue extension. Endpoints without it leave num_queues 0 and
+	 * hosts without it leave host_num_queues 0, both mean one queue which
+	 * is described by the fields above.
+	 */
+	u32 num_queues;
+	/* Written by host: number of queues it services, <= num_queues */
+	u32 host_num_queues;
+	struct queue_md queue_md[TVNET_MAX_QUEUES];
 };
 
 enum ctrl_msg_type {
@@ -227,9 +254,19 @@ enum ctrl_msg_type {
 	CTRL_MSG_LINK_DOWN_ACK,
 };
 
+/* Receive offloads, advertised in CTRL_MSG_LINK_UP */
+#define TVNET_F_CSUM		BIT(0)	/* frames with a partial checksum */
+#define TVNET_F_GSO		BIT(1)	/* TCP superframes up to max_frame */
+
 struct ctrl_msg {
 	u32 msg_id; /* enum ctrl_msg_type */
 	union {
+		/* Zero from peers without offload support */
+		struct {
+			u32 features;
+			/* Receive buffer size including ethernet header */
+			u32 max_frame;
+		} link_up;
 		u32 reserved[7];
 	} u;
 };
@@ -240,6 +277,24 @@ enum data_msg_type {
 	DATA_MSG_FULL_BUF,
 };
 
+#define TVNET_OFFLOAD_CSUM_PARTIAL	BIT(0)
+
+#define TVNET_GSO_TCPV4		1
+#define TVNET_GSO_TCPV6		2
+#define TVNET_GSO_ECN		0x80
+
+/*
+ * Offload state of a full buffer, only sent to peers with the matching
+ * TVNET_F_* receive feature. Offsets are from the start of the frame.
+ */
+struct tvnet_offload {
+	u8 flags;
+	u8 gso_type;
+	u16 gso_size;
+	u16 csum_start;
+	u16 csum_offset;
+};
+
 struct data_msg {
 	u32 msg_id; /* enum data_msg_type */
 	union {
@@ -250,6 +305,7 @@ struct data_msg {
 		struct {
 			u32 packet_size;
 			u64 pcie_address;
+			struct tvnet_offload offload;
 		} full_buffer;
 		u32 reserved[7];
 	} u;
@@ -260,6 +316,10 @@ struct tvnet_counter {
 	u32 *wr;
 };
 
+/*
+ * Queue 0 counters share ep_own_cnt/host_own_cnt with the ctrl ring, other
+ * queues have their own copy and leave the ctrl counters unused.
+ */
 struct ep_own_cnt {
 	u32 h2ep_ctrl_rd_cnt;
 	u32 ep2h_ctrl_wr_cnt;
@@ -329,6 +389,22 @@ struct dma_desc_cnt {
 	u32 rd_cnt;
 	u32 wr_cnt;
 };
+
+/*
+ * A channel in linked list mode stops at the first element with CB clear,
+ * so its LLP register points at the element it is working on or waiting
+ * for. Return how many elements from rd_cnt on have completed.
+ */
+static inline u32 tvnet_dma_desc_done(u64 llp, u64 base, u32 rd_cnt)
+{
+	u32 idx = (u32)(llp - base) / sizeof(struct tvnet_dma_desc);
+
+	/* Parked on the link element back to the start of the ring */
+	if (idx >= DMA_DESC_COUNT)
+		idx = 0;
+
+	return (idx - rd_cnt) % DMA_DESC_COUNT;
+}
 #endif
 
 static inline bool tvnet_ivc_empty(struct tvnet_counter *counter)
@@ -411,6 +487,86 @@ static inline u32 tvnet_ivc_get_wr_cnt(struct tvnet_counter *counter)
 	return READ_ONCE(*counter->wr);
 }
 
+/* Netdev offloads used on xmit, masked per skb by what the peer accepts */
+#define TVNET_NETIF_F_CSUM	NETIF_F_HW_CSUM
+#define TVNET_NETIF_F_GSO	(NETIF_F_TSO | NETIF_F_TSO6 | NETIF_F_TSO_ECN)
+
+static inline netdev_features_t tvnet_features_check(struct sk_buff *skb,
+						     netdev_features_t features,
+						     u32 peer_features,
+						     u32 peer_max_frame)
+{
+	if (!(peer_features & TVNET_F_CSUM))
+		features &= ~(NETIF_F_CSUM_MASK | NETIF_F_GSO_MASK);
+	else if (!(peer_features & TVNET_F_GSO) ||
+		 (skb_is_gso(skb) && skb->len > peer_max_frame))
+		features &= ~NETIF_F_GSO_MASK;
+
+	return features;
+}
+
+static inline void tvnet_offload_from_skb(struct sk_buff *skb,
+					  struct tvnet_offload *offload)
+{
+	struct skb_shared_info *info = skb_shinfo(skb);
+
+	memset(offload, 0, sizeof(*offload));
+
+	if (skb->ip_summed == CHECKSUM_PARTIAL) {
+		offload->flags = TVNET_OFFLOAD_CSUM_PARTIAL;
+		offload->csum_start = skb_checksum_start_offset(skb);
+		offload->csum_offset = skb->csum_offset;
+	}
+
+	if (skb_is_gso(skb)) {
+		offload->gso_size = info->gso_size;
+		if (info->gso_type & SKB_GSO_TCPV4)
+			offload->gso_type = TVNET_GSO_TCPV4;
+		else
+			offload->gso_type = TVNET_GSO_TCPV6;
+		if (info->gso_type & SKB_GSO_TCP_ECN)
+			offload->gso_type |= TVNET_GSO_ECN;
+	}
+}
+
+/* Apply offload state to a received skb whose data still starts at the MAC */
+static inline int tvnet_offload_to_skb(struct sk_buff *skb,
+				       const struct tvnet_offload *offload)
+{
+	struct skb_shared_info *info = skb_shinfo(skb);
+
+	if (offload->flags & TVNET_OFFLOAD_CSUM_PARTIAL) {
+		/* Checksum is not needed on a lossless link, just resume it */
+		if (!skb_partial_csum_set(skb, offload->csum_start,
+					  offload->csum_offset))
+			return -EINVAL;
+	}
+
+	if (offload->gso_size) {
+		if (!(offload->flags & TVNET_OFFLOAD_CSUM_PARTIAL))
+			return -EINVAL;
+
+		switch (offload->gso_type & ~TVNET_GSO_ECN) {
+		case TVNET_GSO_TCPV4:
+			info->gso_type = SKB_GSO_TCPV4;
+			break;
+		case TVNET_GSO_TCPV6:
+			info->gso_type = SKB_GSO_TCPV6;
+			break;
+		default:
+			return -EINVAL;
+		}
+		if (offload->gso_type & TVNET_GSO_ECN)
+			info->gso_type |= SKB_GSO_TCP_ECN;
+		/* Header is from the peer, let the stack check it */
+		info->gso_type |= SKB_GSO_DODGY;
+		info->gso_size = offload->gso_size;
+		info->gso_segs = 0;
+	}
+
+	return 0;
+}
+
 static inline u32 tvnet_ivc_get_rd_cnt(struct tvnet_counter *counter)
 {
 	return READ_ONCE(*counter->rd);
@@ -21,6 +21,8 @@
 #include <linux/version.h>
 #include <linux/videodev2.h>
 #include <linux/module.h>
+#include <linux/workqueue.h>
+#include <linux/xarray.h>
 
 #include <media/camera_version_utils.h>
 #include <media/nvc_focus.h>
@@ -46,6 +48,29 @@ struct reg_16 {
 	u16 val;
 };
 
+/*
+ * Shadow of the register values written through
+ * regmap_util_write_table_8_cached(), used to skip registers that already
+ * hold the table value. Only table writes are tracked, so it must be
+ * invalidated whenever the sensor loses its register state.
+ */
+struct regmap_util_table_cache {
+	struct xarray vals;
+	u64 tables;
+	u64 bursts;
+	u64 regs_written;
+	u64 regs_skipped;
+};
+
+/* Sensor mode switch and stream start timing, in ns */
+struct camera_common_timing {
+	u64 mode_switch_ns;
+	u64 mode_switch_max_ns;
+	u64 stream_start_ns;
+	u64 stream_start_max_ns;
+	u64 stream_starts;
+};
+
 struct camera_common_power_rail {
 	struct regulator *dvdd;
 	struct regulator *avdd;
@@ -105,6 +130,17 @@ regmap_util_write_table_16_as_8(struct regmap *regmap,
 				int num_override_regs,
 				u16 wait_ms_addr, u16 end_addr);
 
+int
+regmap_util_write_table_8_cached(struct regmap *regmap,
+				 struct regmap_util_table_cache *cache,
+				 const struct reg_8 table[],
+				 const struct reg_8 override_list[],
+				 int num_override_regs,
+				 u16 wait_ms_addr, u16 end_addr);
+
+void regmap_util_table_cache_init(struct regmap_util_table_cache *cache);
+void regmap_util_table_cache_invalidate(struct regmap_util_table_cache *cache);
+
 enum switch_state {
 	SWITCH_OFF,
 	SWITCH_ON,
@@ -202,11 +238,29 @@ struct tegracam_ctrl_ops {
 			struct sensor_blob *blob, bool val);
 };
 
+/* Controls collected while streaming, in the order they are applied */
+enum tegracam_ctrl_batch_idx {
+	TEGRACAM_CTRL_BATCH_FRAME_RATE,
+	TEGRACAM_CTRL_BATCH_EXPOSURE,
+	TEGRACAM_CTRL_BATCH_EXPOSURE_SHORT,
+	TEGRACAM_CTRL_BATCH_GAIN,
+	TEGRACAM_CTRL_BATCH_NUM,
+};
+
+struct tegracam_ctrl_batch {
+	struct work_struct		work;
+	unsigned long			pending;
+	s64				vals[TEGRACAM_CTRL_BATCH_NUM];
+	u64				applied;
+	u64				errors;
+};
+
 struct tegracam_ctrl_handler {
 	struct v4l2_ctrl_handler	ctrl_handler;
 	const struct tegracam_ctrl_ops	*ctrl_ops;
 	struct tegracam_device          *tc_dev;
 	struct tegracam_sensor_data	sensor_data;
+	struct tegracam_ctrl_batch	batch;
 
 	int				numctrls;
 	struct v4l2_ctrl		*ctrls[MAX_CID_CONTROLS];
@@ -229,6 +283,8 @@ struct camera_common_data {
 	/* TODO: cleanup neeeded once all the sensors adapt new framework */
 	struct tegracam_ctrl_handler		*tegracam_ctrl_hdl;
 	struct regmap				*regmap;
+	struct regmap_util_table_cache		table_cache;
+	struct camera_common_timing		timing;
 	struct camera_common_pdata		*pdata;
 	/* TODO: cleanup needed for priv once all the sensors adapt new framework */
 	void	*priv;
@@ -358,6 +414,7 @@ const struct camera_common_colorfmt *camera_common_find_pixelfmt(
 int tegracam_ctrl_synchronize_ctrls(struct tegracam_ctrl_handler *handler);
 int tegracam_ctrl_set_overrides(struct tegracam_ctrl_handler *handler);
 int tegracam_ctrl_handler_init(struct tegracam_ctrl_handler *handler);
+void tegracam_ctrl_batch_flush(struct tegracam_ctrl_handler *handler);
 int tegracam_init_ctrl_ranges(struct tegracam_ctrl_handler *handler);
 int tegracam_init_ctrl_ranges_by_mode(
 		struct tegracam_ctrl_handler *handler,
@@ -134,6 +134,19 @@ struct isp_capture_req_ex {
 	uint32_t __pad[4];
 } __ISP_CAPTURE_ALIGN;
 
+/** Maximum no. of requests in a @ref isp_capture_req_batch */
+#define ISP_CAPTURE_MAX_BATCH	16U
+
+/**
+ * @brief ISP process capture request batch (IOCTL payload).
+ */
+struct isp_capture_req_batch {
+	uint64_t reqs;
+		/**< User pointer to an array of struct @ref isp_capture_req. */
+	uint32_t num_reqs; /**< No. of requests [1, ISP_CAPTURE_MAX_BATCH]. */
+	uint32_t num_submitted; /**< No. of requests sent to RCE (out). */
+} __ISP_CAPTURE_ALIGN;
+
 /**
  * @brief ISP capture progress status setup config (IOCTL payload).
  */
@@ -261,6 +274,26 @@ int isp_capture_request(
 	struct tegra_isp_channel *chan,
 	struct isp_capture_req *req);
 
+/**
+ * @brief Send several capture (aka. process) requests via the capture IVC
+ * channel to RCE. The surface buffers of all requests are pinned under a single
+ * hold of the unpins list lock, and the requests are written back-to-back
+ * under a single IVC write lock hold.
+ *
+ * Requests are sent in array order; the buffers of any request that is not
+ * sent are unpinned before returning. This is a non-blocking call.
+ *
+ * @param[in]	chan	ISP channel context
+ * @param[in]	reqs	Array of ISP process capture requests
+ * @param[in]	count	No. of requests in @a reqs
+ *
+ * @returns	No. of requests sent (success), neg. errno (failure)
+ */
+int isp_capture_request_batch(
+	struct tegra_isp_channel *chan,
+	struct isp_capture_req *reqs,
+	unsigned int count);
+
 /**
  * @brief Wait on receipt of the capture status of the head of the capture
  * request FIFO queue to RCE. The RCE ISP driver sends a CAPTURE_ISP_STATUS_IND
@@ -314,6 +347,37 @@ int isp_capture_program_request(
 int isp_capture_program_status(
 	struct tegra_isp_channel *chan);
 
+/**
+ * @brief Pin an ISP program descriptor's pushbuffer and keep it pinned across
+ * program requests, until @ref isp_capture_program_release().
+ *
+ * Program and extended requests that reference a retained slot skip the pin
+ * and only take a reference on it; the pushbuffer of the descriptor must not
+ * change while the slot is retained. A channel reset or release drops all
+ * retained slots.
+ *
+ * @param[in]	chan	ISP channel context
+ * @param[in]	req	ISP program request of the slot
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+int isp_capture_program_retain(
+	struct tegra_isp_channel *chan,
+	struct isp_program_req *req);
+
+/**
+ * @brief Release a retained ISP program slot. The pushbuffer is unpinned once
+ * the last request referencing the slot has been retired by RCE.
+ *
+ * @param[in]	chan		ISP channel context
+ * @param[in]	buffer_index	Program descriptor queue index
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+int isp_capture_program_release(
+	struct tegra_isp_channel *chan,
+	uint32_t buffer_index);
+
 /**
  * @brief Send an extended capture (aka. process) request for a frame,
  * containing the ISP pushbuffer program to execute via the capture IVC channel
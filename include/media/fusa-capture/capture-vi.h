@@ -90,6 +90,10 @@ struct vi_capture {
 		/**< Bitmask of RCE-assigned VI FW channel(s). */
 	uint64_t vi2_channel_mask;
 		/**< Bitmask of RCE-assigned VI FW channel(s) for 2nd VI. */
+
+	void (*status_notify)(void *data);
+		/**< Called from the capture IVC callback on frame completion */
+	void *status_notify_data; /**< Private data for status_notify */
 };
 
 /**
@@ -197,6 +201,19 @@ struct vi_capture_req {
 		 */
 } __VI_CAPTURE_ALIGN;
 
+/** Maximum no. of requests in a @ref vi_capture_req_batch */
+#define VI_CAPTURE_MAX_BATCH	16U
+
+/**
+ * @brief VI capture request batch (IOCTL payload)
+ */
+struct vi_capture_req_batch {
+	uint64_t reqs;
+		/**< User pointer to an array of struct @ref vi_capture_req. */
+	uint32_t num_reqs; /**< No. of requests [1, VI_CAPTURE_MAX_BATCH]. */
+	uint32_t num_submitted; /**< No. of requests sent to RCE (out). */
+} __VI_CAPTURE_ALIGN;
+
 /**
  * @brief VI capture progress status setup config (IOCTL payload)
  */
@@ -422,6 +439,24 @@ int vi_capture_request(
 	struct tegra_vi_channel *chan,
 	struct vi_capture_req *req);
 
+/**
+ * @brief Send several capture requests for a VI channel via the capture IVC
+ * channel to RCE, back-to-back under a single IVC write lock hold.
+ *
+ * The surface buffers of every request must already be pinned. This is a
+ * non-blocking call.
+ *
+ * @param[in]	chan	VI channel context
+ * @param[in]	reqs	Array of VI capture requests
+ * @param[in]	count	No. of requests in @a reqs
+ *
+ * @returns	No. of requests sent (success), neg. errno (failure)
+ */
+int vi_capture_request_batch(
+	struct tegra_vi_channel *chan,
+	const struct vi_capture_req *reqs,
+	unsigned int count);
+
 /**
  * @brief Wait on receipt of the capture status of the head of the capture
  *	  request FIFO queue to RCE. The RCE VI driver sends a
@@ -439,6 +474,39 @@ int vi_capture_status(
 	struct tegra_vi_channel *chan,
 	int32_t timeout_ms);
 
+/**
+ * @brief Check whether the capture status of the head of the capture
+ *	  request FIFO queue has been received, without blocking.
+ *
+ * A subsequent vi_capture_status() call is guaranteed not to block if this
+ * returns true.
+ *
+ * @param[in]	chan	VI channel context
+ *
+ * @returns	true (status available), false (still in flight)
+ */
+bool vi_capture_status_ready(
+	struct tegra_vi_channel *chan);
+
+/**
+ * @brief Register a function to be called whenever a capture status
+ *	  indication is received for a VI channel.
+ *
+ * The function runs in the capture IVC callback context, after the capture
+ * status completion has been signalled, and lets clients complete frames
+ * without a thread blocked in vi_capture_status(). Pass NULL to unregister.
+ *
+ * @param[in]	chan	VI channel context
+ * @param[in]	notify	Status notification function, or NULL
+ * @param[in]	data	Private data passed to @a notify
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+int vi_capture_set_status_notify(
+	struct tegra_vi_channel *chan,
+	void (*notify)(void *data),
+	void *data);
+
 /**
  * @brief Setup VI channel capture status progress notifier.
  *
@@ -39,6 +39,9 @@
 #include <linux/rwsem.h>
 #include <linux/version.h>
 
+struct tegra_capture_group;
+struct tegra_capture_group_join;
+
 #define MAX_FORMAT_NUM	64
 #define	MAX_SUBDEVICES	4
 #define	QUEUED_BUFFERS	4
@@ -70,6 +73,70 @@ enum interlaced_type {
 	Interleaved,
 };
 
+/* log2 buckets of 1 us and up, the last one catching everything longer */
+#define TEGRA_CHANNEL_FRAME_BUCKETS	24
+
+/**
+ * struct tegra_channel_frame_stats - per channel frame timing histograms
+ * @lock: protects the histograms and the previous frame timings
+ * @latency: sensor SOF to buffer completion latency histogram
+ * @jitter: histogram of the change in SOF-to-SOF interval between frames
+ * @frames: number of frames folded into @latency
+ * @last_sof_ns: SOF timestamp of the previous frame, 0 at stream start
+ * @last_interval_ns: SOF-to-SOF interval ending at the previous frame
+ */
+struct tegra_channel_frame_stats {
+	spinlock_t lock;
+	u32 latency[TEGRA_CHANNEL_FRAME_BUCKETS];
+	u32 jitter[TEGRA_CHANNEL_FRAME_BUCKETS];
+	u64 frames;
+	u64 last_sof_ns;
+	u64 last_interval_ns;
+};
+
+/* entries in a channel event log, a power of two */
+#define TEGRA_CHANNEL_EVENTS	256
+
+enum tegra_channel_event_type {
+	TEGRA_CHANNEL_EVENT_NONE = 0,
+	TEGRA_CHANNEL_EVENT_ENQUEUE,
+	TEGRA_CHANNEL_EVENT_DEQUEUE,
+	TEGRA_CHANNEL_EVENT_SOF,
+	TEGRA_CHANNEL_EVENT_EOF,
+	TEGRA_CHANNEL_EVENT_REQ_ERROR,
+	TEGRA_CHANNEL_EVENT_FRAME_ERROR,
+};
+
+/**
+ * struct tegra_channel_event - channel event log entry
+ * @tstamp: TSC ticks, the time base of the RTCPU trace
+ * @seq: low bits of the event sequence number, written last
+ * @type: enum tegra_channel_event_type, NONE for an unused entry
+ * @port: VI port the event belongs to
+ * @data: descriptor index for ENQUEUE, frame id for DEQUEUE, SOF and EOF,
+ *	negative errno for REQ_ERROR and the RCE err_data for FRAME_ERROR
+ *
+ * The log is also mapped read-only to user space through debugfs, so the
+ * layout is fixed.
+ */
+struct tegra_channel_event {
+	u64 tstamp;
+	u16 seq;
+	u8 type;
+	u8 port;
+	u32 data;
+};
+
+/**
+ * struct tegra_channel_event_log - always-on per channel event ring
+ * @head: sequence number of the latest event, writers claim slots with it
+ * @ring: TEGRA_CHANNEL_EVENTS entries, overwritten oldest first
+ */
+struct tegra_channel_event_log {
+	atomic_t head;
+	struct tegra_channel_event *ring;
+};
+
 /**
  * struct tegra_channel_buffer - video channel buffer
  * @buf: vb2 buffer base object
@@ -215,6 +282,16 @@ struct tegra_channel {
 	spinlock_t dequeue_lock;
 	struct work_struct status_work;
 	struct work_struct error_work;
+	bool event_completion;
+	bool event_paused;
+	struct mutex event_lock;
+
+	struct tegra_channel_frame_stats frame_stats;
+	struct tegra_channel_event_log events;
+	struct dentry *debugfs;
+
+	struct tegra_capture_group *capture_group;
+	unsigned int capture_group_member;
 
 	void __iomem *csibase[TEGRA_CSI_BLOCKS];
 	unsigned int stride_align;
@@ -339,6 +416,11 @@ struct tegra_mc_vi {
 	bool bypass;
 
 	const struct tegra_vi_fops *fops;
+
+	struct dentry *debugfs;
+
+	struct list_head capture_groups;
+	struct mutex capture_groups_lock;
 };
 
 int tegra_vi_get_port_info(struct tegra_channel *chan,
@@ -352,6 +434,16 @@ int tegra_channel_init(struct tegra_channel *chan);
 void tegra_vi_channels_unregister(struct tegra_mc_vi *vi);
 int tegra_vi_channels_init(struct tegra_mc_vi *vi);
 int tegra_channel_cleanup(struct tegra_channel *chan);
+void tegra_channel_record_frame(struct tegra_channel *chan, u64 sof_ns);
+int tegra_capture_group_join(struct tegra_channel *chan,
+			struct tegra_capture_group_join *args);
+int tegra_capture_group_leave(struct tegra_channel *chan);
+void tegra_capture_group_frame(struct tegra_channel *chan, u32 frame_id,
+			u64 sof_ns, bool error);
+void tegra_channel_reset_frame_stats(struct tegra_channel *chan,
+	bool histograms);
+void tegra_channel_log_event(struct tegra_channel *chan, u8 type, u8 port,
+	u32 data, u64 tstamp);
 int tegra_vi_channels_cleanup(struct tegra_mc_vi *vi);
 int tegra_channel_init_subdevices(struct tegra_channel *chan);
 void tegra_channel_remove_subdevices(struct tegra_channel *chan);
@@ -392,6 +484,8 @@ const struct tegra_video_format *tegra_core_get_format_by_fourcc(
 void tegra_channel_queued_buf_done(struct tegra_channel *chan,
 	enum vb2_buffer_state state, bool multi_queue);
 int tegra_channel_set_stream(struct tegra_channel *chan, bool on);
+int tegra_channel_set_pix_format(struct tegra_channel *chan,
+			struct v4l2_pix_format *pix);
 int tegra_channel_write_blobs(struct tegra_channel *chan);
 void tegra_channel_ring_buffer(struct tegra_channel *chan,
 			       struct vb2_v4l2_buffer *vb,
@@ -143,4 +143,66 @@ int tegra_ivc_read_peek(struct tegra_ivc *ivc, void __user *usr_buf, void *buf,
  */
 int tegra_ivc_write(struct tegra_ivc *ivc, const void __user *usr_buf, const void *buf, size_t size);
 
+/**
+ * tegra_ivc_write_batch - Writes several frames to ivc channel
+ * @ivc		pointer of the IVC channel
+ * @buf		kernel buffer holding @count frames of @size bytes each
+ * @size	Data size of each frame
+ * @count	Number of frames to write
+ *
+ * Writes as many of the frames as the channel has room for, then publishes
+ * them with a single counter update and at most one notification.
+ *
+ * Returns no. of frames written to ivc channel else return error.
+ */
+int tegra_ivc_write_batch(struct tegra_ivc *ivc, const void *buf, size_t size,
+			  unsigned int count);
+
+/**
+ * tegra_ivc_read_batch - Reads several frames form ivc channel
+ * @ivc		pointer of the IVC channel
+ * @buf		kernel buffer with room for @count frames of @size bytes each
+ * @size	Data size to be read from each frame
+ * @count	Max number of frames to read
+ *
+ * Reads the frames that are available, up to @count, and releases them
+ * with a single counter update and at most one notification.
+ *
+ * Returns no. of frames read from ivc channel else return error.
+ */
+int tegra_ivc_read_batch(struct tegra_ivc *ivc, void *buf, size_t size,
+			 unsigned int count);
+
+/**
+ * tegra_ivc_notify_suppress - Asks the peer to stop notifying
+ * @ivc		pointer of the IVC channel
+ *
+ * Tells the peer that this end is draining the channel, so the peer may skip
+ * the notifications for the frames it writes and releases meanwhile. Must be
+ * followed by tegra_ivc_notify_enable() before this end waits for the next
+ * notification.
+ */
+void tegra_ivc_notify_suppress(struct tegra_ivc *ivc);
+
+/**
+ * tegra_ivc_notify_enable - Asks the peer to notify again
+ * @ivc		pointer of the IVC channel
+ *
+ * Undoes tegra_ivc_notify_suppress().
+ *
+ * Returns true if frames arrived that may not have been notified, in which
+ * case the caller must drain the channel again.
+ */
+bool tegra_ivc_notify_enable(struct tegra_ivc *ivc);
+
+/**
+ * tegra_ivc_peer_wants_notify - Checks whether the peer asked for notifications
+ * @ivc		pointer of the IVC channel
+ *
+ * For the notify callback, after a counter update has been published.
+ *
+ * Returns false if the notification can be skipped.
+ */
+bool tegra_ivc_peer_wants_notify(struct tegra_ivc *ivc);
+
 #endif /* __TEGRA_IVC_EXT_H */
@@ -115,6 +115,55 @@ int tegra_hv_ivc_read(struct tegra_hv_ivc_cookie *ivck, void *buf, int size);
  */
 int tegra_hv_ivc_read_user(struct tegra_hv_ivc_cookie *ivck, void __user *buf, int size);
 
+/**
+ * tegra_hv_ivc_write_batch - Writes several frames to the IVC queue
+ * @ivck	IVC cookie of the queue
+ * @buf		Pointer to @count frames of @size bytes each
+ * @size	Size of the data of each frame
+ * @count	Number of frames to write
+ *
+ * Writes as many frames as there is room for with a single counter update
+ * and at most one notification of the remote guest.
+ *
+ * Returns the number of frames written and an error code otherwise
+ */
+int tegra_hv_ivc_write_batch(struct tegra_hv_ivc_cookie *ivck, const void *buf,
+		int size, unsigned int count);
+
+/**
+ * tegra_hv_ivc_read_batch - Reads several frames from the IVC queue
+ * @ivck	IVC cookie of the queue
+ * @buf		Pointer to room for @count frames of @size bytes each
+ * @size	max size of the data to read from each frame
+ * @count	max number of frames to read
+ *
+ * Reads the available frames, up to @count, with a single counter update
+ * and at most one notification of the remote guest.
+ *
+ * Returns the number of frames read and an error code otherwise
+ */
+int tegra_hv_ivc_read_batch(struct tegra_hv_ivc_cookie *ivck, void *buf,
+		int size, unsigned int count);
+
+/**
+ * tegra_hv_ivc_notify_suppress - Ask the remote guest to skip notifications
+ * @ivck	IVC cookie of the queue
+ *
+ * For receivers that drain the queue with the interrupt masked. The remote
+ * guest does not raise the interrupt for what it writes or releases until
+ * tegra_hv_ivc_notify_enable() is called.
+ */
+void tegra_hv_ivc_notify_suppress(struct tegra_hv_ivc_cookie *ivck);
+
+/**
+ * tegra_hv_ivc_notify_enable - Ask the remote guest to notify again
+ * @ivck	IVC cookie of the queue
+ *
+ * Returns true if frames arrived while notifications were suppressed and the
+ * queue must be drained again, false if it is safe to wait for the interrupt
+ */
+bool tegra_hv_ivc_notify_enable(struct tegra_hv_ivc_cookie *ivck);
+
 /**
  * ivc_hv_ivc_can_read - Test whether data are available
  * @ivck	IVC cookie of the queue
@@ -342,12 +391,34 @@ static inline int tegra_hv_ivc_read(struct tegra_hv_ivc_cookie *ivck, void *buf,
 	return -ENOTSUPP;
 };
 
+static inline int tegra_hv_ivc_write_batch(struct tegra_hv_ivc_cookie *ivck,
+		const void *buf, int size, unsigned int count)
+{
+	return -ENOTSUPP;
+};
+
+static inline int tegra_hv_ivc_read_batch(struct tegra_hv_ivc_cookie *ivck,
+		void *buf, int size, unsigned int count)
+{
+	return -ENOTSUPP;
+};
+
 static inline int tegra_hv_ivc_read_user(struct tegra_hv_ivc_cookie *ivck,
 					 void __user *buf, int size)
 {
 	return -ENOTSUPP;
 };
 
+static inline void tegra_hv_ivc_notify_suppress(
+		struct tegra_hv_ivc_cookie *ivck)
+{
+};
+
+static inline bool tegra_hv_ivc_notify_enable(struct tegra_hv_ivc_cookie *ivck)
+{
+	return false;
+};
+
 static inline int tegra_hv_ivc_can_read(struct tegra_hv_ivc_cookie *ivck)
 {
 	return -ENOTSUPP;
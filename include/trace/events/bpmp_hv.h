@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Virtual BPMP transfer latency logging to ftrace.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM bpmp_hv
+
+#if !defined(_TRACE_BPMP_HV_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_BPMP_HV_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(bpmp_hv_mrq_done,
+	TP_PROTO(unsigned int channel, unsigned int mrq, int ret, u64 latency_ns),
+
+	TP_ARGS(channel, mrq, ret, latency_ns),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, channel)
+		__field(unsigned int, mrq)
+		__field(int, ret)
+		__field(u64, latency_ns)
+	),
+
+	TP_fast_assign(
+		__entry->channel = channel;
+		__entry->mrq = mrq;
+		__entry->ret = ret;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("channel=%u mrq=%u ret=%d latency_ns=%llu",
+		  __entry->channel, __entry->mrq, __entry->ret,
+		  __entry->latency_ns)
+);
+
+#endif /* _TRACE_BPMP_HV_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
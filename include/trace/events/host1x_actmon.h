@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA Corporation.  All rights reserved.
+ *
+ * Host1x actmon engine load sampling to ftrace.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM host1x_actmon
+
+#if !defined(_TRACE_HOST1X_ACTMON_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_HOST1X_ACTMON_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(host1x_actmon_sample,
+	TP_PROTO(u32 class, u32 active_count, u32 load, unsigned long rate),
+
+	TP_ARGS(class, active_count, load, rate),
+
+	TP_STRUCT__entry(
+		__field(u32, class)
+		__field(u32, active_count)
+		__field(u32, load)
+		__field(unsigned long, rate)
+	),
+
+	TP_fast_assign(
+		__entry->class = class;
+		__entry->active_count = active_count;
+		__entry->load = load;
+		__entry->rate = rate;
+	),
+
+	TP_printk("class=0x%x, active_count=%u, load=%u, rate=%lu",
+	  __entry->class, __entry->active_count, __entry->load,
+	  __entry->rate)
+);
+
+#endif /*  _TRACE_HOST1X_ACTMON_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
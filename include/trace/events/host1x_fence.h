@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA Corporation.  All rights reserved.
+ *
+ * Host1x syncpoint fence event logging to ftrace.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM host1x_fence
+
+#if !defined(_TRACE_HOST1X_FENCE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_HOST1X_FENCE_H
+
+#include <linux/ktime.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(host1x_fence_signal,
+	TP_PROTO(u32 id, u32 threshold, u32 value, s64 latency_ns),
+
+	TP_ARGS(id, threshold, value, latency_ns),
+
+	TP_STRUCT__entry(
+		__field(u32, id)
+		__field(u32, threshold)
+		__field(u32, value)
+		__field(s64, latency_ns)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->threshold = threshold;
+		__entry->value = value;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("id=%u, threshold=%u, value=%u, latency_ns=%lld",
+	  __entry->id, __entry->threshold, __entry->value,
+	  __entry->latency_ns)
+);
+
+TRACE_EVENT(host1x_fence_signal_batch,
+	TP_PROTO(u32 id, u32 value, unsigned int count, s64 duration_ns),
+
+	TP_ARGS(id, value, count, duration_ns),
+
+	TP_STRUCT__entry(
+		__field(u32, id)
+		__field(u32, value)
+		__field(unsigned int, count)
+		__field(s64, duration_ns)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->value = value;
+		__entry->count = count;
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("id=%u, value=%u, count=%u, duration_ns=%lld",
+	  __entry->id, __entry->value, __entry->count,
+	  __entry->duration_ns)
+);
+
+#endif /*  _TRACE_HOST1X_FENCE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
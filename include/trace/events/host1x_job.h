@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA Corporation.  All rights reserved.
+ *
+ * Host1x job latency event logging to ftrace.
+ */
+
+#include <nvidia/conftest.h>
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM host1x_job
+
+#if !defined(_TRACE_HOST1X_JOB_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_HOST1X_JOB_H
+
+#include <linux/host1x-next.h>
+#include <linux/tracepoint.h>
+
+#define show_host1x_job_stage(stage)					\
+	__print_symbolic(stage,						\
+		{ HOST1X_JOB_STAGE_COPY,	"copy" },		\
+		{ HOST1X_JOB_STAGE_PIN,		"pin" },		\
+		{ HOST1X_JOB_STAGE_VALIDATE,	"validate" },		\
+		{ HOST1X_JOB_STAGE_PUSH,	"push" },		\
+		{ HOST1X_JOB_STAGE_QUEUE,	"queue" },		\
+		{ HOST1X_JOB_STAGE_EXECUTE,	"execute" },		\
+		{ HOST1X_JOB_STAGE_CLEANUP,	"cleanup" },		\
+		{ HOST1X_JOB_STAGE_TOTAL,	"total" })
+
+TRACE_EVENT(host1x_job_stage,
+	TP_PROTO(const char *name, u32 syncpt, u32 threshold,
+		 unsigned int stage, u64 ns),
+
+	TP_ARGS(name, syncpt, threshold, stage, ns),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(u32, syncpt)
+		__field(u32, threshold)
+		__field(unsigned int, stage)
+		__field(u64, ns)
+	),
+
+	TP_fast_assign(
+#if defined(NV___ASSIGN_STR_HAS_NO_SRC_ARG)
+		__assign_str(name);
+#else
+		__assign_str(name, name);
+#endif
+		__entry->syncpt = syncpt;
+		__entry->threshold = threshold;
+		__entry->stage = stage;
+		__entry->ns = ns;
+	),
+
+	TP_printk("name=%s, syncpt=%u, threshold=%u, stage=%s, ns=%llu",
+	  __get_str(name), __entry->syncpt, __entry->threshold,
+	  show_host1x_job_stage(__entry->stage), __entry->ns)
+);
+
+#endif /*  _TRACE_HOST1X_JOB_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -244,6 +244,35 @@ TRACE_EVENT(podgov_stats,
 		__entry->idle_max)
 );
 
+TRACE_EVENT(podgov_decision,
+	TP_PROTO(struct device *dev, unsigned long old_freq, unsigned long new_freq,
+		unsigned long load, unsigned long load_pred, bool boost),
+
+	TP_ARGS(dev, old_freq, new_freq, load, load_pred, boost),
+
+	TP_STRUCT__entry(
+		__field(struct device *, dev)
+		__field(unsigned long, old_freq)
+		__field(unsigned long, new_freq)
+		__field(unsigned long, load)
+		__field(unsigned long, load_pred)
+		__field(bool, boost)
+	),
+
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->old_freq = old_freq;
+		__entry->new_freq = new_freq;
+		__entry->load = load;
+		__entry->load_pred = load_pred;
+		__entry->boost = boost;
+	),
+
+	TP_printk("name=%s, old_freq=%lu, new_freq=%lu, load=%lu, load_pred=%lu, boost=%d",
+		dev_name(__entry->dev), __entry->old_freq, __entry->new_freq,
+		__entry->load, __entry->load_pred, __entry->boost)
+);
+
 #endif /*  _TRACE_NVHOST_PODGOV_H */
 
 /* This part must be outside protection */
@@ -275,6 +275,104 @@ TRACE_EVENT(nvmap_cache_flush,
 		(unsigned long long)__entry->total_done)
 );
 
+TRACE_EVENT(nvmap_cache_maint_list,
+	TP_PROTO(u32 nr_ops,
+		 u32 nr_ranges,
+		 u64 total,
+		 bool handle_wide,
+		 u64 time_ns
+	),
+
+	TP_ARGS(nr_ops, nr_ranges, total, handle_wide, time_ns),
+
+	TP_STRUCT__entry(
+		__field(u32, nr_ops)
+		__field(u32, nr_ranges)
+		__field(u64, total)
+		__field(bool, handle_wide)
+		__field(u64, time_ns)
+	),
+
+	TP_fast_assign(
+		__entry->nr_ops = nr_ops;
+		__entry->nr_ranges = nr_ranges;
+		__entry->total = total;
+		__entry->handle_wide = handle_wide;
+		__entry->time_ns = time_ns;
+	),
+
+	TP_printk("nr_ops=%u, nr_ranges=%u, total=%llu, handle_wide=%d, time_ns=%llu",
+		__entry->nr_ops, __entry->nr_ranges,
+		(unsigned long long)__entry->total, __entry->handle_wide,
+		(unsigned long long)__entry->time_ns)
+);
+
+TRACE_EVENT(nvmap_alloc_latency,
+	TP_PROTO(pid_t pid,
+		 u32 tag,
+		 u32 heap_type,
+		 u32 flags,
+		 size_t size,
+		 u64 time_ns
+	),
+
+	TP_ARGS(pid, tag, heap_type, flags, size, time_ns),
+
+	TP_STRUCT__entry(
+		__field(pid_t, pid)
+		__field(u32, tag)
+		__field(u32, heap_type)
+		__field(u32, flags)
+		__field(size_t, size)
+		__field(u64, time_ns)
+	),
+
+	TP_fast_assign(
+		__entry->pid = pid;
+		__entry->tag = tag;
+		__entry->heap_type = heap_type;
+		__entry->flags = flags;
+		__entry->size = size;
+		__entry->time_ns = time_ns;
+	),
+
+	TP_printk("pid=%d, tag=0x%x, heap=0x%x, flags=0x%x, size=%zu, time_ns=%llu",
+		__entry->pid, __entry->tag, __entry->heap_type,
+		__entry->flags, __entry->size,
+		(unsigned long long)__entry->time_ns)
+);
+
+TRACE_EVENT(nvmap_cache_maint_latency,
+	TP_PROTO(pid_t pid,
+		 u32 tag,
+		 u32 op,
+		 size_t size,
+		 u64 time_ns
+	),
+
+	TP_ARGS(pid, tag, op, size, time_ns),
+
+	TP_STRUCT__entry(
+		__field(pid_t, pid)
+		__field(u32, tag)
+		__field(u32, op)
+		__field(size_t, size)
+		__field(u64, time_ns)
+	),
+
+	TP_fast_assign(
+		__entry->pid = pid;
+		__entry->tag = tag;
+		__entry->op = op;
+		__entry->size = size;
+		__entry->time_ns = time_ns;
+	),
+
+	TP_printk("pid=%d, tag=0x%x, op=%u, size=%zu, time_ns=%llu",
+		__entry->pid, __entry->tag, __entry->op, __entry->size,
+		(unsigned long long)__entry->time_ns)
+);
+
 TRACE_EVENT(nvmap_map_into_caller_ptr,
 	TP_PROTO(struct nvmap_client *client,
 		 struct nvmap_handle *h,
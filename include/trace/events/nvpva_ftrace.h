@@ -305,6 +305,66 @@ TRACE_EVENT(nvpva_task_timestamp,
 		__entry->start_time, __entry->end_time)
 );
 
+TRACE_EVENT(nvpva_task_profile,
+	TP_PROTO(
+		const char *name,
+		u32 task_id,
+		u32 queue_id,
+		u32 vpu,
+		u64 queued_ns,
+		u64 wait_ns,
+		u64 input_ns,
+		u64 setup_ns,
+		u64 vpu_ns,
+		u64 output_ns,
+		u64 r5_overhead_ns
+		),
+	TP_ARGS(
+		name,
+		task_id,
+		queue_id,
+		vpu,
+		queued_ns,
+		wait_ns,
+		input_ns,
+		setup_ns,
+		vpu_ns,
+		output_ns,
+		r5_overhead_ns
+		),
+	TP_STRUCT__entry(
+		__field(const char *, name)
+		__field(u32, task_id)
+		__field(u32, queue_id)
+		__field(u32, vpu)
+		__field(u64, queued_ns)
+		__field(u64, wait_ns)
+		__field(u64, input_ns)
+		__field(u64, setup_ns)
+		__field(u64, vpu_ns)
+		__field(u64, output_ns)
+		__field(u64, r5_overhead_ns)
+		),
+	TP_fast_assign(
+		__entry->name = name;
+		__entry->task_id = task_id;
+		__entry->queue_id = queue_id;
+		__entry->vpu = vpu;
+		__entry->queued_ns = queued_ns;
+		__entry->wait_ns = wait_ns;
+		__entry->input_ns = input_ns;
+		__entry->setup_ns = setup_ns;
+		__entry->vpu_ns = vpu_ns;
+		__entry->output_ns = output_ns;
+		__entry->r5_overhead_ns = r5_overhead_ns;
+		),
+	TP_printk("name=%s, task_id=%u, queue=%u, vpu=%u, queued_ns=%llu, wait_ns=%llu, input_ns=%llu, setup_ns=%llu, vpu_ns=%llu, output_ns=%llu, r5_overhead_ns=%llu",
+		__entry->name, __entry->task_id, __entry->queue_id,
+		__entry->vpu, __entry->queued_ns, __entry->wait_ns,
+		__entry->input_ns, __entry->setup_ns, __entry->vpu_ns,
+		__entry->output_ns, __entry->r5_overhead_ns)
+);
+
 TRACE_EVENT(nvpva_write,
 	TP_PROTO(
 		u64 delta_time,
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA Corporation.  All rights reserved.
+ *
+ * Central activity monitor event logging to ftrace.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_cactmon
+
+#if !defined(_TRACE_TEGRA_CACTMON_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_CACTMON_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(cactmon_mc_all_sample,
+	TP_PROTO(u64 seq, u64 mc_all),
+
+	TP_ARGS(seq, mc_all),
+
+	TP_STRUCT__entry(
+		__field(u64, seq)
+		__field(u64, mc_all)
+	),
+
+	TP_fast_assign(
+		__entry->seq = seq;
+		__entry->mc_all = mc_all;
+	),
+
+	TP_printk("seq=%llu, mc_all=%llu", __entry->seq, __entry->mc_all)
+);
+
+#endif /* _TRACE_TEGRA_CACTMON_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
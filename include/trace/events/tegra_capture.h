@@ -57,6 +57,23 @@ DEFINE_EVENT(capture__msg, capture_ivc_recv,
 	TP_ARGS(ivc_name, msg_id, ch_id)
 );
 
+TRACE_EVENT(capture_ivc_rx_depth,
+	TP_PROTO(const char *ivc_name, u32 depth, bool more),
+	TP_ARGS(ivc_name, depth, more),
+	TP_STRUCT__entry(
+		__array(char, ivc_name, IVC_NAME_LEN)
+		__field(u32, depth)
+		__field(bool, more)
+	),
+	TP_fast_assign(
+		strscpy(__entry->ivc_name, ivc_name, sizeof(__entry->ivc_name));
+		__entry->depth = depth;
+		__entry->more = more;
+	),
+	TP_printk("ivc:\"%s\" depth:%u more:%d", __entry->ivc_name,
+		__entry->depth, __entry->more)
+);
+
 DEFINE_EVENT(capture__msg, capture_ivc_send,
 	TP_PROTO(const char *ivc_name, u32 msg_id, u32 ch_id),
 	TP_ARGS(ivc_name, msg_id, ch_id)
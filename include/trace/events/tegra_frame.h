@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Frame progress through the camera and compute engines, logged to ftrace.
+ *
+ * Every engine reports the buffers it was given on submit and the window it
+ * worked on them on start/done, all on the TSC timebase in ns. buf is the
+ * inode number of the dmabuf file, which stays the same for a buffer across
+ * drivers and processes, or 0 if the event is not about one buffer. seq is
+ * the sequence number of the engine (VI frame id, ISP buffer index, task or
+ * job id) and pairs up the events of one job on the same engine and ctx.
+ * syncpt/threshold is the fence of the job, which the syncpt done event
+ * reports when it signals.
+ *
+ * The events are defined by host1x, which all the engine drivers depend on.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_frame
+
+#if !defined(_TRACE_TEGRA_FRAME_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_FRAME_H
+
+#include <linux/tracepoint.h>
+
+#ifndef _TEGRA_FRAME_HELPERS
+#define _TEGRA_FRAME_HELPERS
+
+#include <linux/dma-buf.h>
+#include <linux/err.h>
+#include <linux/fs.h>
+#include <linux/version.h>
+#if defined(CONFIG_ARM64)
+#include <asm/arch_timer.h>
+#else
+#include <linux/timekeeping.h>
+#endif
+
+enum tegra_frame_engine {
+	TEGRA_FRAME_ENGINE_VI,
+	TEGRA_FRAME_ENGINE_ISP,
+	TEGRA_FRAME_ENGINE_PVA,
+	TEGRA_FRAME_ENGINE_DLA,
+	/* channel jobs of the host1x clients (VIC, NVENC, ...), ctx is the class */
+	TEGRA_FRAME_ENGINE_HOST1X,
+	TEGRA_FRAME_ENGINE_SYNCPT,
+};
+
+/* The TSC and CNTVCT count at 31.25 MHz */
+#define TEGRA_FRAME_TSC_NS_PER_TICK	32
+
+static inline u64 tegra_frame_tsc_to_ns(u64 ticks)
+{
+	return ticks * TEGRA_FRAME_TSC_NS_PER_TICK;
+}
+
+static inline u64 tegra_frame_ts_ns(void)
+{
+#if defined(CONFIG_ARM64)
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
+	return tegra_frame_tsc_to_ns(arch_timer_read_counter());
+#else
+	return tegra_frame_tsc_to_ns(arch_counter_get_cntvct());
+#endif
+#else
+	return ktime_get_ns();
+#endif
+}
+
+static inline u64 tegra_frame_dmabuf_id(struct dma_buf *dmabuf)
+{
+	if (IS_ERR_OR_NULL(dmabuf) || !dmabuf->file)
+		return 0;
+
+	return file_inode(dmabuf->file)->i_ino;
+}
+
+/* Only for the submitting task, fd is looked up in its file table */
+static inline u64 tegra_frame_fd_id(int fd)
+{
+	struct dma_buf *dmabuf;
+	u64 id;
+
+	if (fd <= 0)
+		return 0;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return 0;
+
+	id = tegra_frame_dmabuf_id(dmabuf);
+	dma_buf_put(dmabuf);
+
+	return id;
+}
+
+#endif /* _TEGRA_FRAME_HELPERS */
+
+TRACE_DEFINE_ENUM(TEGRA_FRAME_ENGINE_VI);
+TRACE_DEFINE_ENUM(TEGRA_FRAME_ENGINE_ISP);
+TRACE_DEFINE_ENUM(TEGRA_FRAME_ENGINE_PVA);
+TRACE_DEFINE_ENUM(TEGRA_FRAME_ENGINE_DLA);
+TRACE_DEFINE_ENUM(TEGRA_FRAME_ENGINE_HOST1X);
+TRACE_DEFINE_ENUM(TEGRA_FRAME_ENGINE_SYNCPT);
+
+#define show_tegra_frame_engine(engine)				\
+	__print_symbolic(engine,					\
+		{ TEGRA_FRAME_ENGINE_VI,	"vi" },			\
+		{ TEGRA_FRAME_ENGINE_ISP,	"isp" },		\
+		{ TEGRA_FRAME_ENGINE_PVA,	"pva" },		\
+		{ TEGRA_FRAME_ENGINE_DLA,	"dla" },		\
+		{ TEGRA_FRAME_ENGINE_HOST1X,	"host1x" },		\
+		{ TEGRA_FRAME_ENGINE_SYNCPT,	"syncpt" })
+
+DECLARE_EVENT_CLASS(tegra_frame,
+	TP_PROTO(u32 engine, u32 ctx, u64 buf, u64 seq, u32 syncpt,
+		 u32 threshold, u64 ts_ns),
+
+	TP_ARGS(engine, ctx, buf, seq, syncpt, threshold, ts_ns),
+
+	TP_STRUCT__entry(
+		__field(u32, engine)
+		__field(u32, ctx)
+		__field(u64, buf)
+		__field(u64, seq)
+		__field(u32, syncpt)
+		__field(u32, threshold)
+		__field(u64, ts_ns)
+	),
+
+	TP_fast_assign(
+		__entry->engine = engine;
+		__entry->ctx = ctx;
+		__entry->buf = buf;
+		__entry->seq = seq;
+		__entry->syncpt = syncpt;
+		__entry->threshold = threshold;
+		__entry->ts_ns = ts_ns;
+	),
+
+	TP_printk("engine=%s ctx=%u buf=%llu seq=%llu syncpt=%u threshold=%u ts_ns=%llu",
+		  show_tegra_frame_engine(__entry->engine), __entry->ctx,
+		  __entry->buf, __entry->seq, __entry->syncpt,
+		  __entry->threshold, __entry->ts_ns)
+);
+
+DEFINE_EVENT(tegra_frame, tegra_frame_submit,
+	TP_PROTO(u32 engine, u32 ctx, u64 buf, u64 seq, u32 syncpt,
+		 u32 threshold, u64 ts_ns),
+	TP_ARGS(engine, ctx, buf, seq, syncpt, threshold, ts_ns)
+);
+
+DEFINE_EVENT(tegra_frame, tegra_frame_start,
+	TP_PROTO(u32 engine, u32 ctx, u64 buf, u64 seq, u32 syncpt,
+		 u32 threshold, u64 ts_ns),
+	TP_ARGS(engine, ctx, buf, seq, syncpt, threshold, ts_ns)
+);
+
+DEFINE_EVENT(tegra_frame, tegra_frame_done,
+	TP_PROTO(u32 engine, u32 ctx, u64 buf, u64 seq, u32 syncpt,
+		 u32 threshold, u64 ts_ns),
+	TP_ARGS(engine, ctx, buf, seq, syncpt, threshold, ts_ns)
+);
+
+#endif /* _TRACE_TEGRA_FRAME_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
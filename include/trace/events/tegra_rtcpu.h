@@ -216,6 +216,34 @@ DEFINE_EVENT(rtcpu__perf, rtcpu_perf_reset,
 	TP_ARGS(tstamp, perf)
 );
 
+/*
+ * Load sampling, one event per trace worker pass
+ */
+
+TRACE_EVENT(rtcpu_load,
+	TP_PROTO(int load_permille, u64 window_ns, u32 events, u32 backlog,
+		u64 capture_latency_max_ns),
+	TP_ARGS(load_permille, window_ns, events, backlog,
+		capture_latency_max_ns),
+	TP_STRUCT__entry(
+		__field(int, load_permille)
+		__field(u64, window_ns)
+		__field(u32, events)
+		__field(u32, backlog)
+		__field(u64, capture_latency_max_ns)
+	),
+	TP_fast_assign(
+		__entry->load_permille = load_permille;
+		__entry->window_ns = window_ns;
+		__entry->events = events;
+		__entry->backlog = backlog;
+		__entry->capture_latency_max_ns = capture_latency_max_ns;
+	),
+	TP_printk("load:%d window_ns:%llu events:%u backlog:%u capture_latency_max_ns:%llu",
+		__entry->load_permille, __entry->window_ns, __entry->events,
+		__entry->backlog, __entry->capture_latency_max_ns)
+);
+
 
 /*
  * VI Notify events
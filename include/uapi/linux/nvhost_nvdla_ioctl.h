@@ -84,6 +84,28 @@ struct nvdla_pin_unpin_args {
 	__u32 reserved;
 };
 
+/**
+ * struct nvdla_buffer_cache_stats_args structure for buffer cache counters
+ *
+ * Unpinned buffers keep their device mapping in a per-channel cache, so
+ * pinning the same dma-buf again reuses it. The cache holds a reference to
+ * the dma-buf until the mapping is evicted, flushed or the channel closed.
+ *
+ * @hits		pins that reused a cached mapping
+ * @misses		pins that mapped the buffer
+ * @evictions		cached mappings dropped to make room
+ * @num_pinned		buffers currently pinned
+ * @num_cached		unpinned buffers whose mapping is cached
+ *
+ */
+struct nvdla_buffer_cache_stats_args {
+	__u64 hits;
+	__u64 misses;
+	__u64 evictions;
+	__u32 num_pinned;
+	__u32 num_cached;
+};
+
 /**
  * struct nvdla_submit_args structure for task submit
  *
@@ -99,6 +121,12 @@ struct nvdla_submit_args {
 #define MAX_NVDLA_TASKS_PER_SUBMIT	16
 #define NVDLA_SUBMIT_FLAGS_ATOMIC	(1 << 0)
 #define NVDLA_SUBMIT_FLAGS_BYPASS_EXEC	(1 << 1)
+/*
+ * Tasks of the submit run in order on the queue, so a prefence of a task on
+ * the queue syncpoint that is reached by an earlier task of the same submit
+ * is satisfied by the queue order and is not sent to the engine.
+ */
+#define NVDLA_SUBMIT_FLAGS_ORDERED	(1 << 2)
 	__u16 flags;
 	__u32 version;
 };
@@ -268,10 +296,14 @@ struct nvdla_status_notify {
 	_IO(NVHOST_NVDLA_IOCTL_MAGIC, 9)
 #define NVDLA_IOCTL_RELEASE_QUEUE \
 	_IO(NVHOST_NVDLA_IOCTL_MAGIC, 10)
+#define NVDLA_IOCTL_GET_BUFFER_CACHE_STATS \
+	_IOR(NVHOST_NVDLA_IOCTL_MAGIC, 11, struct nvdla_buffer_cache_stats_args)
+#define NVDLA_IOCTL_FLUSH_BUFFER_CACHE \
+	_IO(NVHOST_NVDLA_IOCTL_MAGIC, 12)
 #define NVDLA_IOCTL_LAST		\
-		_IOC_NR(NVDLA_IOCTL_RELEASE_QUEUE)
+		_IOC_NR(NVDLA_IOCTL_FLUSH_BUFFER_CACHE)
 
 #define NVDLA_IOCTL_MAX_ARG_SIZE  \
-		sizeof(struct nvdla_pin_unpin_args)
+		sizeof(struct nvdla_buffer_cache_stats_args)
 
 #endif /* __UAPI_LINUX_NVHOST_NVDLA_IOCTL_H */
@@ -11,12 +11,41 @@
 #define TEGRA_MPLUSERSPACE_IOCTL_MAGIC 0xA6
 
 
+/*
+ * Attributes of the mmap() of the mempool. Cached mappings need
+ * TEGRA_MPLUSERSPACE_IOCTL_SYNC with a peer that does not snoop the CPU
+ * caches, the others only need the ordering it provides.
+ */
+#define TEGRA_MPL_MAP_CACHED		0U
+#define TEGRA_MPL_MAP_WRITECOMBINE	1U
+#define TEGRA_MPL_MAP_UNCACHED		2U
+
+/* make the CPU writes to the range visible, before notifying the peer */
+#define TEGRA_MPL_SYNC_WRITE		(1U << 0)
+/* drop stale lines of the range, after being notified by the peer */
+#define TEGRA_MPL_SYNC_READ		(1U << 1)
+
+struct tegra_mpl_sync {
+	uint64_t offset;
+	uint64_t size;
+	uint32_t flags; /* TEGRA_MPL_SYNC_* */
+	uint32_t reserved;
+};
+
 /* IOCTL definitions */
 
 /* query ivc mempool configuration data */
 #define TEGRA_MPLUSERSPACE_IOCTL_GET_INFO \
 	_IOR(TEGRA_MPLUSERSPACE_IOCTL_MAGIC, 1, struct ivc_mempool)
 
-#define TEGRA_MPLUSERSPACE_IOCTL_NUMBER_MAX 1
+/* select the attributes of the mmap(), before mapping the mempool */
+#define TEGRA_MPLUSERSPACE_IOCTL_SET_MAP_ATTR \
+	_IOW(TEGRA_MPLUSERSPACE_IOCTL_MAGIC, 2, uint32_t)
+
+/* cache maintenance and memory fence for a range of the mempool */
+#define TEGRA_MPLUSERSPACE_IOCTL_SYNC \
+	_IOW(TEGRA_MPLUSERSPACE_IOCTL_MAGIC, 3, struct tegra_mpl_sync)
+
+#define TEGRA_MPLUSERSPACE_IOCTL_NUMBER_MAX 3
 
 #endif /* __UAPI_NVHVIVC_MEMPOOL_IOCTL_H__ */
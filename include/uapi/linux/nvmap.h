@@ -116,6 +116,24 @@ struct nvmap_rw_handle {
 	__u64 count;		/* number of atoms to copy */
 };
 
+/* nvmap_rw_vec.flags */
+#define NVMAP_RW_VEC_READ	(1 << 0)	/* copy from handle to user */
+
+struct nvmap_rw_vec {
+	__u64 addr;		/* user pointer */
+	__u64 offset;		/* offset into hmem */
+	__u32 handle;		/* nvmap handle */
+	__u32 len;		/* bytes to copy */
+	__u32 flags;		/* NVMAP_RW_VEC_* */
+	__u32 reserved;
+};
+
+struct nvmap_rw_handle_list {
+	__u64 vecs;		/* Ptr to array of struct nvmap_rw_vec */
+	__u32 nr;		/* Number of entries */
+	__u32 nr_done;		/* Entries fully copied, on return */
+};
+
 #ifdef __KERNEL__
 #ifdef CONFIG_COMPAT
 struct nvmap_rw_handle_32 {
@@ -216,6 +234,14 @@ struct nvmap_sciipc_map {
 	__u32 handle;      /* Nvmap handle */
 };
 
+struct nvmap_sciipc_map_list {
+	__u64 auth_token;	/* AuthToken of the endpoint, for all maps */
+	__u64 maps;		/* Ptr to array of struct nvmap_sciipc_map,
+				 * auth_token of the entries is ignored */
+	__u32 nr;		/* Number of entries */
+	__u32 nr_done;		/* Entries exported/imported, on return */
+};
+
 struct nvmap_handle_parameters {
     __u8 contig;
     __u32 import_id;
@@ -243,6 +269,26 @@ struct nvmap_query_heap_params {
 	__u32 granule_size;
 };
 
+/* nvmap_query_heap_params.flags for NVMAP_IOC_QUERY_HEAP_PARAMS_EXT */
+#define NVMAP_HEAP_QUERY_COMPACT	(1 << 0)	/* start compaction */
+
+/**
+ * Heap parameters together with carveout fragmentation and compaction
+ * progress
+ */
+struct nvmap_query_heap_params_ext {
+	struct nvmap_query_heap_params params;
+	__u32 nr_free_blocks;		/* free extents in the carveout */
+	__u32 fragmentation;		/* percent of free space outside
+					 * the largest free extent */
+	__u32 compacting;		/* compaction pass in progress */
+	__u32 reserved;
+	__u64 compact_runs;		/* completed compaction passes */
+	__u64 compact_moved;		/* blocks moved by compaction */
+	__u64 compact_moved_bytes;
+	__u64 compact_skipped;		/* blocks pinned or mapped */
+};
+
 /**
  * Struct used while duplicating memory handle
  */
@@ -342,6 +388,10 @@ struct nvmap_fd_for_range_from_list {
 #define NVMAP_IOC_PARAMETERS \
 	_IOR(NVMAP_IOC_MAGIC, 27, struct nvmap_handle_parameters)
 
+/* Read/write many (handle, offset, len, user ptr) records in one call */
+#define NVMAP_IOC_RW_LIST \
+	_IOWR(NVMAP_IOC_MAGIC, 28, struct nvmap_rw_handle_list)
+
 /* START of T124 IOCTLS */
 /* Actually allocates memory from IVM heaps */
 #define NVMAP_IOC_ALLOC_IVM _IOW(NVMAP_IOC_MAGIC, 101, struct nvmap_alloc_ivm_handle)
@@ -360,6 +410,8 @@ struct nvmap_fd_for_range_from_list {
 /* Get heap parameters such as total and frre size */
 #define NVMAP_IOC_QUERY_HEAP_PARAMS _IOR(NVMAP_IOC_MAGIC, 105, \
 		struct nvmap_query_heap_params)
+#define NVMAP_IOC_QUERY_HEAP_PARAMS_EXT _IOWR(NVMAP_IOC_MAGIC, 105, \
+		struct nvmap_query_heap_params_ext)
 
 /* Duplicate NvRmMemHandle with same/reduced permission */
 #define NVMAP_IOC_DUP_HANDLE _IOWR(NVMAP_IOC_MAGIC, 106, \
@@ -369,6 +421,14 @@ struct nvmap_fd_for_range_from_list {
 #define NVMAP_IOC_GET_FD_FOR_RANGE_FROM_LIST _IOR(NVMAP_IOC_MAGIC, 107, \
 		struct nvmap_fd_for_range_from_list)
 
-#define NVMAP_IOC_MAXNR (_IOC_NR(NVMAP_IOC_GET_FD_FOR_RANGE_FROM_LIST))
+/* Get SCI_IPC_IDs for a list of handles shared with one endpoint */
+#define NVMAP_IOC_GET_SCIIPCID_LIST _IOWR(NVMAP_IOC_MAGIC, 108, \
+		struct nvmap_sciipc_map_list)
+
+/* Get Nvmap handles for a list of SCI_IPC_IDs from one endpoint */
+#define NVMAP_IOC_HANDLE_FROM_SCIIPCID_LIST _IOWR(NVMAP_IOC_MAGIC, 109, \
+		struct nvmap_sciipc_map_list)
+
+#define NVMAP_IOC_MAXNR (_IOC_NR(NVMAP_IOC_HANDLE_FROM_SCIIPCID_LIST))
 
 #endif /* __UAPI_LINUX_NVMAP_H */
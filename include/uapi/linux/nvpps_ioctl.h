@@ -23,7 +23,7 @@ struct nvpps_version {
 #define NVPPS_VERSION_MAJOR	0
 #define NVPPS_VERSION_MINOR	2
 #define NVPPS_API_MAJOR		0
-#define NVPPS_API_MINOR         4
+#define NVPPS_API_MINOR         5
 
 struct nvpps_params {
 	__u32	evt_mode;
@@ -68,6 +68,30 @@ struct nvpps_timestamp_struct {
 	__u64		extra[2];
 };
 
+/*
+ * Latest PPS event, published in a page that is mmap()ed read-only from the
+ * nvpps device at offset 0. The page is updated without locks: seq is odd
+ * while an update is in progress, so readers retry until they see the same
+ * even seq before and after copying the fields.
+ *
+ * corr_err_ns is the half width of the interval the PTP time was sampled in
+ * with respect to the TSC, i.e. the uncertainty of the PTP/TSC pair. It is 0
+ * when the PTP/TSC pair is latched by the MAC hardware or when interval
+ * sampling is not enabled.
+ */
+struct nvpps_shm {
+	__u32	seq;
+	__u32	evt_nb;
+	__u32	evt_mode;
+	__u32	tsc_mode;
+	__u64	tsc;
+	__u64	ptp;
+	__u64	secondary_ptp;
+	__u64	tsc_res_ns;
+	__u64	irq_latency;
+	__u64	corr_err_ns;
+};
+
 
 #define NVPPS_GETVERSION	_IOR('p', 0x1, struct nvpps_version *)
 #define NVPPS_GETPARAMS		_IOR('p', 0x2, struct nvpps_params *)
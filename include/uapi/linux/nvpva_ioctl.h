@@ -213,7 +213,13 @@ enum nvpva_flags {
 	NVPVA_ERR_MASK_ILLEGAL_INSTR = 1U << 3U,
 	NVPVA_ERR_MASK_DIVIDE_BY_0 = 1U << 4U,
 	NVPVA_ERR_MASK_FP_NAN = 1U << 5U,
-	NVPVA_GR_CHECK_EXE_FLAG = 1U << 6U
+	NVPVA_GR_CHECK_EXE_FLAG = 1U << 6U,
+	/*
+	 * Prefences on syncpoint postfences of earlier tasks in the same
+	 * submit are replaced by a pre-barrier, so the task only waits on
+	 * fences at the boundary of the submit
+	 */
+	NVPVA_BATCH_ORDERED = 1U << 7U
 };
 
 enum nvpva_fence_action_type {
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Tegra PVA task profile ring, mapped from the task_profile_ring debugfs
+ * file of the PVA device
+ */
+
+#ifndef __NVPVA_PROFILE_H__
+#define __NVPVA_PROFILE_H__
+
+#include <linux/types.h>
+
+#define NVPVA_PROFILE_RING_VERSION	1U
+
+/**
+ * struct nvpva_profile_ring_header - first page of the mapping
+ * @version: NVPVA_PROFILE_RING_VERSION
+ * @record_size: size of struct nvpva_profile_record
+ * @data_offset: offset of the first record from the start of the mapping
+ * @num_records: number of records in the ring, a power of 2
+ * @data_head: number of records written so far, record n is at index
+ *	n % num_records. Read it with acquire semantics; a reader that fell
+ *	more than num_records behind lost the older records.
+ */
+struct nvpva_profile_ring_header {
+	__u32 version;
+	__u32 record_size;
+	__u32 data_offset;
+	__u32 num_records;
+	__u64 data_head;
+};
+
+/**
+ * struct nvpva_profile_record - timing of one completed task
+ * @queued_ns: TSC time the task was queued by the driver, in ns
+ * @wait_ns: time until the task reached the head of its queue
+ * @input_ns: time to process the prefences and input actions
+ * @setup_ns: time from the inputs to the VPU start, including waiting
+ *	for a VPU and the DMA and VPU setup
+ * @vpu_ns: VPU execution time
+ * @output_ns: time from the VPU completion to the task completion
+ * @r5_overhead_ns: firmware time of the task outside the VPU execution
+ * @task_id: task id, as in the job_submit trace event
+ * @queue_id: queue the task was submitted on
+ * @vpu: VPU the task ran on
+ * @reserved: 0
+ */
+struct nvpva_profile_record {
+	__u64 queued_ns;
+	__u64 wait_ns;
+	__u64 input_ns;
+	__u64 setup_ns;
+	__u64 vpu_ns;
+	__u64 output_ns;
+	__u64 r5_overhead_ns;
+	__u32 task_id;
+	__u8 queue_id;
+	__u8 vpu;
+	__u8 reserved[2];
+};
+
+#endif
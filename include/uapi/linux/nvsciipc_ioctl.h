@@ -56,6 +56,61 @@ struct nvsciipc_get_db_by_vuid {
 	uint32_t idx;
 };
 
+#define NVSCIIPC_DB_IDX_INVALID	0xFFFFFFFFU
+
+/*
+ * Looks up num_eps endpoints by name in one call. entries points to an
+ * array of struct nvsciipc_get_db_by_name, idx of an endpoint which is
+ * not in the database is set to NVSCIIPC_DB_IDX_INVALID.
+ */
+struct nvsciipc_get_db_by_names {
+	uint32_t num_eps;
+	/* number of endpoints found */
+	uint32_t num_found;
+	uint64_t entries;
+};
+
+/*
+ * Read-only snapshot of the endpoint database, mapped with mmap() at
+ * offset 0 of the nvsciipc device. A snapshot never changes once
+ * published. When set_db installs a new database, a new snapshot with
+ * a higher generation is published and NVSCIIPC_DB_SNAPSHOT_STALE is set
+ * in the flags of the old one, so mappings have to be redone to see the
+ * update.
+ *
+ * entry_offset is the offset of num_eps struct nvsciipc_db_snapshot_entry,
+ * in database index order. name_idx_offset is the offset of num_eps
+ * uint32_t database indices sorted by ep_name (strncmp() order, lower
+ * index first for duplicates) for binary search.
+ */
+#define NVSCIIPC_DB_SNAPSHOT_MAGIC	0x4E534442U	/* "NSDB" */
+#define NVSCIIPC_DB_SNAPSHOT_VERSION	1U
+#define NVSCIIPC_DB_SNAPSHOT_STALE	(1U << 0)
+
+struct nvsciipc_db_snapshot_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t generation;
+	uint32_t flags;
+	uint32_t num_eps;
+	uint32_t entry_size;
+	uint32_t entry_offset;
+	uint32_t name_idx_offset;
+	/* size of the mapping */
+	uint32_t size;
+};
+
+struct nvsciipc_db_snapshot_entry {
+	char ep_name[NVSCIIPC_MAX_EP_NAME];
+	uint64_t vuid;
+	uint32_t backend;
+	uint32_t id;
+	uint32_t nframes;
+	uint32_t frame_size;
+	uint32_t peer_vmid;
+	uint32_t noti_type;
+};
+
 /* for userspace level test, debugging purpose only */
 struct nvsciipc_validate_auth_token {
 	uint32_t auth_token;
@@ -104,6 +159,9 @@ struct nvsciipc_map_vuid {
 #define NVSCIIPC_IOCTL_GET_VMID \
 	_IOWR(NVSCIIPC_IOCTL_MAGIC, 8, uint32_t)
 
-#define NVSCIIPC_IOCTL_NUMBER_MAX 8
+#define NVSCIIPC_IOCTL_GET_DB_BY_NAMES \
+	_IOWR(NVSCIIPC_IOCTL_MAGIC, 9, struct nvsciipc_get_db_by_names)
+
+#define NVSCIIPC_IOCTL_NUMBER_MAX 9
 
 #endif /* __NVSCIIPC_IOCTL_H__ */
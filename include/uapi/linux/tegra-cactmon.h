@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: (GPL-2.0 WITH Linux-syscall-note) */
+/*
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Sample ring of the MC_ALL central activity monitor, mmap()ed read-only
+ * from /dev/cactmon-mc-all.
+ */
+
+#ifndef _UAPI_TEGRA_CACTMON_H_
+#define _UAPI_TEGRA_CACTMON_H_
+
+#include <linux/types.h>
+
+#define CACTMON_MC_ALL_RING_VERSION	1
+
+struct cactmon_mc_all_sample {
+	/* CLOCK_MONOTONIC time the sample was taken */
+	__u64 timestamp_ns;
+	/* MC_ALL average count, scaled to counts per millisecond */
+	__u64 mc_all;
+};
+
+/*
+ * The ring starts with this header, samples follow at sample_offset. The
+ * driver stores sample number N at index N % nr_samples and then bumps
+ * head to N + 1 with release semantics, overwriting the oldest samples. A
+ * reader loads head with acquire semantics, copies the samples it wants
+ * and then loads head again: samples older than the new head - nr_samples
+ * were overwritten while being copied.
+ */
+struct cactmon_mc_all_ring {
+	__u32 version;
+	__u32 nr_samples;
+	__u32 sample_offset;
+	__u32 sample_size;
+	/* sampling period of the ring, 0 while stopped */
+	__u32 period_us;
+	/* sampling period of the activity monitor itself */
+	__u32 hw_period_us;
+	__u64 head;
+};
+
+#endif /* _UAPI_TEGRA_CACTMON_H_ */
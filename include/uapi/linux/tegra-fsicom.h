@@ -7,6 +7,7 @@
 #define _UAPI_TEGRA_FSICOM_H_
 
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 #define MAX_FSI_CORE 2
 
@@ -28,6 +29,71 @@ struct iova_data {
 	uint32_t chid;
 };
 
+/*
+ * Shared-memory ring in a buffer mapped for FSI. The header sits at the
+ * ring offset and the data area follows it. head and tail are free-running
+ * byte counters, the producer only writes head and the consumer only
+ * writes tail.
+ *
+ * The consumer sets need_doorbell before it waits for more data and the
+ * producer only rings the HSP doorbell when it is set, so a busy consumer
+ * gets one doorbell for a whole batch of records.
+ */
+#define FSICOM_RING_MAGIC	0x46524e47U
+
+#define FSICOM_RING_TX		0U	/* CCPLEX produces, FSI consumes */
+#define FSICOM_RING_RX		1U	/* FSI produces, CCPLEX consumes */
+#define FSICOM_RING_DIR_MAX	2U
+
+struct fsicom_ring_hdr {
+	__u32 magic;
+	/* Size of the data area in bytes, a power of two */
+	__u32 size;
+	__u32 head;
+	__u32 tail;
+	__u32 need_doorbell;
+	__u32 reserved[3];
+};
+
+struct fsicom_ring_setup {
+	__u8 coreid;
+	__u8 dir;
+	__u16 reserved;
+	/* dmabuf fd, offset of the header in it and size of the data area */
+	__s32 fd;
+	__u32 offset;
+	__u32 size;
+	__u32 chid;
+};
+
+struct fsicom_ring_doorbell {
+	__u8 coreid;
+	__u8 reserved[3];
+	/* Out: 1 if the doorbell was rung, 0 if FSI was still consuming */
+	__u32 rung;
+};
+
+/* Register an eventfd to be signalled on FSI events, fd -1 unregisters */
+struct fsicom_eventfd {
+	__s32 fd;
+	/* Out: number of FSI cores */
+	__u8 nr_cores;
+	__u8 reserved[3];
+};
+
+#define FSICOM_EVENT_MSG	(1U << 0)	/* data holds an HSP message */
+#define FSICOM_EVENT_RING	(1U << 1)	/* FSI rang its RX ring doorbell */
+#define FSICOM_EVENT_RESUME	(1U << 2)	/* driver resumed */
+#define FSICOM_EVENT_OVERFLOW	(1U << 3)	/* earlier events were dropped */
+
+/* read() on the device returns these */
+struct fsicom_event {
+	__u8 coreid;
+	__u8 reserved[3];
+	__u32 flags;
+	__u32 data[4];
+};
+
 /* signal value */
 #define SIG_DRIVER_RESUME	43
 #define SIG_FSI_WRITE_EVENT	44
@@ -38,5 +104,8 @@ struct iova_data {
 #define TEGRA_HSP_WRITE   _IOWR('q', 3, struct rw_data *)
 #define TEGRA_SIGNAL_REG  _IOWR('q', 4, struct rw_data *)
 #define TEGRA_IOVA_DATA   _IOWR('q', 5, struct iova_data *)
+#define TEGRA_RING_SETUP     _IOW('q', 6, struct fsicom_ring_setup)
+#define TEGRA_RING_DOORBELL  _IOWR('q', 7, struct fsicom_ring_doorbell)
+#define TEGRA_EVENTFD_REG    _IOWR('q', 8, struct fsicom_eventfd)
 
 #endif	/* _UAPI_TEGRA_FSICOM_H_ */
@@ -24,6 +24,29 @@ struct nvipc_ivc_info {
 	uint16_t noti_type; /* IVC_TRAP_IPA, IVC_MSI_IPA */
 };
 
+/*
+ * Each queue starts with a header of two cache lines, the frames follow it.
+ * The writer of a queue owns tx.count and state in the first line, the
+ * reader owns rx.count in the second one. Both counters are free running
+ * frame counts, their difference is the number of frames in the queue.
+ */
+#define NVIPC_IVC_HEADER_SIZE		128U
+#define NVIPC_IVC_TX_COUNT_OFFSET	0U
+#define NVIPC_IVC_STATE_OFFSET		4U
+#define NVIPC_IVC_RX_COUNT_OFFSET	64U
+
+/*
+ * Layout of the channel within the mapping of the ivc area, for userspace
+ * that drives the queues directly instead of copying frames through
+ * the driver.
+ */
+struct nvipc_ivc_ring {
+	uint32_t rx_offset; /* header of the queue we receive from */
+	uint32_t tx_offset; /* header of the queue we transmit to */
+	uint32_t nframes;
+	uint32_t frame_size;
+};
+
 /*  IOCTL magic number */
 #define NVIPC_IVC_IOCTL_MAGIC 0xAA
 
@@ -39,7 +62,15 @@ struct nvipc_ivc_info {
 #define NVIPC_IVC_IOCTL_GET_VMID \
 	_IOR(NVIPC_IVC_IOCTL_MAGIC, 3, uint32_t)
 
-#define NVIPC_IVC_IOCTL_NUMBER_MAX 3
+/* signal an eventfd on every ivc interrupt, -1 detaches it */
+#define NVIPC_IVC_IOCTL_SET_EVENTFD \
+	_IOW(NVIPC_IVC_IOCTL_MAGIC, 4, int32_t)
+
+/* query the queue layout within the mapped ivc area */
+#define NVIPC_IVC_IOCTL_GET_RING \
+	_IOR(NVIPC_IVC_IOCTL_MAGIC, 5, struct nvipc_ivc_ring)
+
+#define NVIPC_IVC_IOCTL_NUMBER_MAX 5
 
 int ivc_cdev_get_peer_vmid(uint32_t qid, uint32_t *peer_vmid);
 int ivc_cdev_get_noti_type(uint32_t qid, uint32_t *noti_type);
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: (GPL-2.0 WITH Linux-syscall-note) */
+/*
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Zero-copy playback on the safety I2S interfaces, through the hwdep
+ * device "i2sN-zc" of the safety audio card.
+ */
+
+#ifndef _UAPI_TEGRA_SAFETY_AUDIO_H_
+#define _UAPI_TEGRA_SAFETY_AUDIO_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define SAFETY_AUDIO_ZC_MAX_MAPS	16
+
+/* Attach a dmabuf for playback, handle is filled in by the driver */
+struct safety_audio_zc_map {
+	__s32 fd;
+	__u32 handle;
+};
+
+/*
+ * One period of pre-rendered audio in a mapped dmabuf. Periods are played
+ * back to back in the order they are queued and cookie comes back in the
+ * completion event of the period.
+ */
+struct safety_audio_zc_period {
+	__u32 handle;
+	__u32 cookie;
+	__u64 offset;
+	__u64 len;
+};
+
+#define SAFETY_AUDIO_ZC_EVENT_UNDERRUN	(1U << 0)
+
+/* read() returns these, one per completed period */
+struct safety_audio_zc_event {
+	__u32 cookie;
+	__u32 flags;
+	/* CLOCK_MONOTONIC time the DMA finished the period */
+	__u64 timestamp_ns;
+};
+
+/*
+ * Jitter is the time between two period completions minus the duration
+ * of the later period at the configured rate. Intervals across an
+ * underrun are not counted.
+ */
+struct safety_audio_zc_stats {
+	__u64 periods;
+	__u64 intervals;
+	__s64 jitter_min_ns;
+	__s64 jitter_max_ns;
+	__u64 jitter_abs_sum_ns;
+	__u64 underruns;
+	__u64 events_dropped;
+};
+
+#define SAFETY_AUDIO_ZC_MAP		_IOWR('S', 0x01, struct safety_audio_zc_map)
+#define SAFETY_AUDIO_ZC_UNMAP		_IOW('S', 0x02, __u32)
+#define SAFETY_AUDIO_ZC_QUEUE		_IOW('S', 0x03, struct safety_audio_zc_period)
+#define SAFETY_AUDIO_ZC_START		_IO('S', 0x04)
+#define SAFETY_AUDIO_ZC_STOP		_IO('S', 0x05)
+#define SAFETY_AUDIO_ZC_GET_STATS	_IOR('S', 0x06, struct safety_audio_zc_stats)
+#define SAFETY_AUDIO_ZC_RESET_STATS	_IO('S', 0x07)
+
+#endif /* _UAPI_TEGRA_SAFETY_AUDIO_H_ */
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: (GPL-2.0 WITH Linux-syscall-note) */
+/*
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Status pages of the thermal trip event (/dev/thermal-trip-event-<type>)
+ * and soctherm over-current event (/dev/soctherm-oc) devices.
+ *
+ * The page can be mmap()ed read-only or read() whole. read() blocks until
+ * the page changed since the last read() on the file, and poll() reports
+ * EPOLLIN then. EPOLLHUP means the driver is gone.
+ *
+ * seq is odd while the driver updates the page. A reader of the mapping
+ * loads seq with acquire semantics, retries while it is odd, copies the
+ * fields and retries if seq changed in the meantime.
+ */
+
+#ifndef _UAPI_TEGRA_THERMAL_EVENT_H_
+#define _UAPI_TEGRA_THERMAL_EVENT_H_
+
+#include <linux/types.h>
+
+#define THERMAL_TRIP_EVENT_PAGE_VERSION	1
+
+struct thermal_trip_event_page {
+	__u32 version;
+	__u32 seq;
+	/* cooling state set by the thermal zone, 0 while not tripped */
+	__u32 state;
+	__u32 max_state;
+	/* times the state went from 0 to tripped */
+	__u64 trips;
+	/* CLOCK_MONOTONIC time of the last state change */
+	__u64 timestamp_ns;
+};
+
+#define TEGRA_OC_EVENT_PAGE_VERSION	1
+#define TEGRA_OC_EVENT_MAX_ALARMS	24
+
+struct tegra_oc_event_page {
+	__u32 version;
+	__u32 seq;
+	__u32 nr_alarms;
+	/* how often the BPMP is asked for the status while the device is open */
+	__u32 poll_period_us;
+	/* CLOCK_MONOTONIC time the status last changed */
+	__u64 timestamp_ns;
+	__u32 throt_en[TEGRA_OC_EVENT_MAX_ALARMS];
+	__u32 event_cnt[TEGRA_OC_EVENT_MAX_ALARMS];
+};
+
+#endif /* _UAPI_TEGRA_THERMAL_EVENT_H_ */
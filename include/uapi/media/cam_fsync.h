@@ -6,7 +6,61 @@
 #ifndef __CAM_FSYNC_H__
 #define __CAM_FSYNC_H__
 
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* the PTP/TSC time pair of the last sample is valid */
+#define CAM_FSYNC_TELEMETRY_PTP_VALID	(1U << 0)
+/* edge times were captured by the GTE rather than predicted */
+#define CAM_FSYNC_TELEMETRY_MEASURED	(1U << 1)
+/* automatic phase correction is enabled */
+#define CAM_FSYNC_TELEMETRY_CORRECTING	(1U << 2)
+
+/**
+ * struct cam_fsync_telemetry - Frame-sync telemetry of a generator group
+ * @ptp_ns: PTP time of the last sample
+ * @tsc_ns: TSC time of the last sample
+ * @phase_err_ns: Mean phase error of the group's edges to the PTP grid
+ * @filtered_phase_err_ns: Low-pass filtered @phase_err_ns
+ * @drift_ppb: Estimated phase drift rate against PTP time
+ * @max_abs_phase_err_ns: Largest absolute @phase_err_ns seen
+ * @skew_ns: Spread of the per-generator phase errors
+ * @samples: Number of telemetry samples taken
+ * @corrections: Number of phase corrections applied
+ * @flags: CAM_FSYNC_TELEMETRY_* flags
+ */
+struct cam_fsync_telemetry {
+	__u64 ptp_ns;
+	__u64 tsc_ns;
+	__s64 phase_err_ns;
+	__s64 filtered_phase_err_ns;
+	__s64 drift_ppb;
+	__s64 max_abs_phase_err_ns;
+	__s64 skew_ns;
+	__u64 samples;
+	__u32 corrections;
+	__u32 flags;
+};
+
+/**
+ * struct cam_fsync_phase_correction - Phase correction against PTP time
+ * @ptp_phase_ns: PTP phase of the group's first edge within each second
+ * @threshold_ns: Filtered phase error that triggers a correction, 0 disables
+ * @reserved: Must be 0
+ */
+struct cam_fsync_phase_correction {
+	__u64 ptp_phase_ns;
+	__u32 threshold_ns;
+	__u32 reserved;
+};
+
 #define CAM_FSYNC_GRP_ABS_START_VAL \
 	_IOW('T', 1, uint64_t)
 
+#define CAM_FSYNC_GRP_GET_TELEMETRY \
+	_IOR('T', 2, struct cam_fsync_telemetry)
+
+#define CAM_FSYNC_GRP_SET_PHASE_CORRECTION \
+	_IOW('T', 3, struct cam_fsync_phase_correction)
+
 #endif
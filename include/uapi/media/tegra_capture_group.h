@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Tegra VI capture groups: VI channels whose sensors are triggered by the
+ * same cam_fsync group, completing as one frame set per trigger.
+ */
+
+#ifndef _UAPI_TEGRA_CAPTURE_GROUP_H_
+#define _UAPI_TEGRA_CAPTURE_GROUP_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+#include <linux/videodev2.h>
+
+#define TEGRA_CAPTURE_GROUP_MAX_MEMBERS	8
+
+/*
+ * Argument of VIDIOC_TEGRA_CAPTURE_GROUP_JOIN, issued on the video node
+ * of each member channel while it is not streaming.
+ *
+ * @group_id: cam_fsync group id driving the member sensors
+ * @flags: reserved, must be 0
+ * @skew_threshold_ns: max start-of-frame spread within a frame set before
+ *	it is flagged with TEGRA_CAPTURE_GROUP_EVENT_SKEW, 0 keeps the
+ *	current group setting
+ * @fd: (out) file descriptor delivering the group's frame set events
+ * @member: (out) index of the channel in the frame set events
+ */
+struct tegra_capture_group_join {
+	__u32 group_id;
+	__u32 flags;
+	__u64 skew_threshold_ns;
+	__s32 fd;
+	__u32 member;
+};
+
+/* start-of-frame spread exceeded the group skew threshold */
+#define TEGRA_CAPTURE_GROUP_EVENT_SKEW		(1U << 0)
+/* one or more members did not deliver a frame for this set */
+#define TEGRA_CAPTURE_GROUP_EVENT_INCOMPLETE	(1U << 1)
+/* one or more member frames completed with an error */
+#define TEGRA_CAPTURE_GROUP_EVENT_ERROR		(1U << 2)
+
+/*
+ * Frame set completion event, read() from the group file descriptor.
+ *
+ * @sequence: frame set sequence number within the group
+ * @skew_ns: start-of-frame spread of the members present in the set
+ * @flags: TEGRA_CAPTURE_GROUP_EVENT_* flags
+ * @member_mask: members present in the set
+ * @error_mask: members whose frame completed with an error
+ * @dropped: events dropped before this one because nobody read them
+ * @sof_ns: per-member start-of-frame timestamps
+ * @frame_id: per-member frame ids
+ */
+struct tegra_capture_group_event {
+	__u64 sequence;
+	__u64 skew_ns;
+	__u32 flags;
+	__u32 member_mask;
+	__u32 error_mask;
+	__u32 dropped;
+	__u64 sof_ns[TEGRA_CAPTURE_GROUP_MAX_MEMBERS];
+	__u32 frame_id[TEGRA_CAPTURE_GROUP_MAX_MEMBERS];
+};
+
+#define VIDIOC_TEGRA_CAPTURE_GROUP_JOIN \
+	_IOWR('V', BASE_VIDIOC_PRIVATE + 32, struct tegra_capture_group_join)
+#define VIDIOC_TEGRA_CAPTURE_GROUP_LEAVE \
+	_IO('V', BASE_VIDIOC_PRIVATE + 33)
+
+#endif
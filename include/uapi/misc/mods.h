@@ -8,7 +8,7 @@
 
 /* Driver version */
 #define MODS_DRIVER_VERSION_MAJOR 4
-#define MODS_DRIVER_VERSION_MINOR 22
+#define MODS_DRIVER_VERSION_MINOR 24
 #define MODS_DRIVER_VERSION ((MODS_DRIVER_VERSION_MAJOR << 8) | \
 			     ((MODS_DRIVER_VERSION_MINOR / 10) << 4) | \
 			     (MODS_DRIVER_VERSION_MINOR % 10))
@@ -130,6 +130,10 @@ struct MODS_ALLOC_PAGES_2 {
 				      * numa_node as a hint only.
 				      */
 #define MODS_ALLOC_MAP_DEV       128 /* DMA map to PCI device */
+#define MODS_ALLOC_HUGEPAGES     256 /* Use naturally aligned chunks of at
+				      * least 2MB, fail instead of falling
+				      * back to smaller chunks.
+				      */
 
 /* Used by MODS_ESC_ALLOC_PAGES ioctl */
 struct MODS_ALLOC_PAGES {
@@ -903,6 +907,78 @@ struct MODS_QUERY_IRQ_3 {
 	__u8              more;
 };
 
+/* Used by MODS_ESC_CREATE_IRQ_RING ioctl.
+ *
+ * Creates an interrupt event ring for the client and returns a file
+ * descriptor for it.  Once the ring exists, every hooked interrupt is
+ * recorded in it instead of the queue read by MODS_ESC_QUERY_IRQ_3,
+ * including interrupts which fire again before the previous occurrence
+ * has been retrieved.  When the ring is full, new events are dropped and
+ * counted.
+ *
+ * The ring file descriptor:
+ * - can be mapped with mmap() at offset 0 and up to size bytes, the
+ *   mapping starts with struct MODS_IRQ_RING_HEADER,
+ * - signals POLLIN with poll() while the ring is not empty, and POLLHUP
+ *   once the MODS file descriptor of the client has been closed.
+ *
+ * The driver writes entries at head and the consumer advances tail after
+ * reading entries, either through the mapping or by calling
+ * MODS_ESC_QUERY_IRQ_RING.  Only one consumer may be used at a time.
+ *
+ * num_entries must be a power of 2 between MODS_IRQ_RING_MIN_ENTRIES and
+ * MODS_IRQ_RING_MAX_ENTRIES, or 0 for the default.
+ */
+#define MODS_IRQ_RING_MIN_ENTRIES     64
+#define MODS_IRQ_RING_MAX_ENTRIES     65536
+#define MODS_IRQ_RING_DEFAULT_ENTRIES 4096
+#define MODS_IRQ_RING_MAGIC           0x4D495251 /* "MIRQ" */
+
+struct MODS_CREATE_IRQ_RING {
+	/* IN */
+	__u32 num_entries;
+
+	/* OUT */
+	__s32 fd;
+	__u32 size;
+};
+
+/* One interrupt event, dev and irq_index as in struct mods_irq_3 */
+struct mods_irq_ring_entry {
+	struct mods_pci_dev_2 dev;
+	__u32                 irq_index;
+	__u32                 irq;      /* Linux IRQ number */
+	__u64                 time_ns;  /* CLOCK_MONOTONIC time of the IRQ */
+};
+
+struct MODS_IRQ_RING_HEADER {
+	__u32 magic;
+	__u32 num_entries;
+	__u32 entry_size;
+	__u32 entries_offset;
+	__u64 dropped;        /* Events lost because the ring was full */
+	__u32 head;           /* Written by the driver */
+	__u32 reserved0[9];
+	__u32 tail;           /* Written by the consumer */
+	__u32 reserved1[15];
+};
+
+#define MODS_IRQ_RING_BATCH 64
+
+/* Used by MODS_ESC_QUERY_IRQ_RING ioctl.
+ *
+ * Retrieves up to MODS_IRQ_RING_BATCH events from the interrupt ring of
+ * the client and advances tail past them.  more is non-zero if there are
+ * further events left in the ring.
+ */
+struct MODS_QUERY_IRQ_RING {
+	/* OUT */
+	struct mods_irq_ring_entry irq_list[MODS_IRQ_RING_BATCH];
+	__u64                      dropped;
+	__u32                      num_irqs;
+	__u32                      more;
+};
+
 /* Used by legacy MODS_ESC_QUERY_IRQ_2 ioctl */
 struct MODS_QUERY_IRQ_2 {
 	/* OUT */
@@ -1399,7 +1475,7 @@ struct MODS_SYSCTL_INT {
 	__s64 value;
 };
 
-#define MODS_DRIVER_STATS_VERSION 1
+#define MODS_DRIVER_STATS_VERSION 3
 
 /* Used by MODS_ESC_MODS_GET_DRIVER_STATS ioctl.
  *
@@ -1410,7 +1486,19 @@ struct MODS_GET_DRIVER_STATS {
 	__u64 version;
 	__u64 num_allocs;
 	__u64 num_pages;
-	__u64 reserved[13];
+	/* Since version 2: totals over successful MODS_ESC_ALLOC_PAGES_2
+	 * calls of this client, for computing allocation throughput.
+	 * cache_attr_time_ns is the part of alloc_time_ns spent changing
+	 * cache attributes of UC/WC allocations.
+	 */
+	__u64 alloc_bytes;
+	__u64 alloc_time_ns;
+	__u64 cache_attr_time_ns;
+	/* Since version 3: interrupts lost because the queue read by
+	 * MODS_ESC_QUERY_IRQ_3 was full.
+	 */
+	__u64 irq_dropped;
+	__u64 reserved[9];
 };
 
 #define MAX_CLOCK_HANDLE_NAME 64
@@ -2164,5 +2252,7 @@ struct MODS_IDLE {
 #define MODS_ESC_BPMP_UPHY_LANE_EOM_SCAN MODSIO(WR, 146, \
 						MODS_BPMP_UPHY_LANE_EOM_SCAN_PARAMS)
 #define MODS_ESC_IDLE MODSIO(W, 147, MODS_IDLE)
+#define MODS_ESC_CREATE_IRQ_RING MODSIO(WR, 148, MODS_CREATE_IRQ_RING)
+#define MODS_ESC_QUERY_IRQ_RING MODSIO(R, 149, MODS_QUERY_IRQ_RING)
 
 #endif /* _UAPI_MODS_H_  */
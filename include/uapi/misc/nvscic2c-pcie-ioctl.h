@@ -187,6 +187,24 @@ struct nvscic2c_pcie_submit_copy_args {
 	__u64 remote_post_fence_values;
 };
 
+/*
+ * @num_copy_requests: number of copy requests in the batch, not more than
+ *  @max_copy_requests of @nvscic2c_pcie_max_copy_args.
+ *
+ * @copy_requests: user memory atleast of size:
+ *  num_copy_requests * sizeof(struct nvscic2c_pcie_submit_copy_args)
+ *
+ * The flush ranges of the batch are copied as one eDMA descriptor list and
+ * all the post-fences of the batch are signalled once, when the whole batch
+ * is done. The post-fences may be carried by any copy request of the batch.
+ * Totals of flush ranges and post-fences over the batch must be within the
+ * @max_flush_ranges and @max_post_fences of one copy request.
+ */
+struct nvscic2c_pcie_submit_copy_batch_args {
+	__u64 num_copy_requests;
+	__u64 copy_requests;
+};
+
 /**
  * stream extensions - Pass upper limit for the total possible outstanding
  * submit copy requests.
@@ -202,8 +220,74 @@ struct nvscic2c_pcie_max_copy_args {
 	__u64 max_post_fences;
 };
 
+/* eDMA write channels copy requests are submitted on.*/
+#define NVSCIC2C_PCIE_EDMA_WR_CHANNELS	(4)
+
+/**
+ * stream extensions - usage of one eDMA write channel.
+ * @busy_ns: Time the channel had copies of the endpoint outstanding.
+ * @bytes: Bytes copied.
+ * @xfers: eDMA submissions completed.
+ * @errors: eDMA submissions failed.
+ */
+struct nvscic2c_pcie_edma_chan_stats {
+	__u64 busy_ns;
+	__u64 bytes;
+	__u64 xfers;
+	__u64 errors;
+};
+
+/**
+ * stream extensions - eDMA usage of the endpoint since it was opened.
+ * @elapsed_ns: Time since the endpoint was opened, channel utilization
+ *  is @busy_ns / @elapsed_ns.
+ * @striped_requests: Copy requests split over several channels.
+ * @chan: Usage of each eDMA write channel.
+ */
+struct nvscic2c_pcie_edma_stats_args {
+	__u64 elapsed_ns;
+	__u64 striped_requests;
+	struct nvscic2c_pcie_edma_chan_stats chan[NVSCIC2C_PCIE_EDMA_WR_CHANNELS];
+};
+
+/**
+ * busy-poll on the endpoint notifications.
+ * @spin_us: Time poll() spins on the endpoint notification counter before
+ *  sleeping for the notification interrupt, 0 disables busy-poll. It is
+ *  capped by the busy_poll_max_us module parameter.
+ * @reserved: Must be 0.
+ */
+struct nvscic2c_pcie_busy_poll_args {
+	__u32 spin_us;
+	__u32 reserved;
+};
+
+/* buckets of the notification round-trip histogram.*/
+#define NVSCIC2C_PCIE_RTT_HIST_BUCKETS	(16)
+
+/**
+ * notification round-trips of the endpoint since it was opened.
+ *
+ * A round-trip is the time from NVSCIC2C_PCIE_IOCTL_NOTIFY_REMOTE to the
+ * next notification from the peer reaching poll() on the endpoint.
+ * @busy_poll_notifications: Peer notifications found by busy-poll.
+ * @irq_notifications: Peer notifications delivered by the interrupt path.
+ * @rtt_hist: Bucket 0 counts round-trips below 1us, bucket i counts
+ *  round-trips of [2^(i-1), 2^i) us and the last bucket counts all
+ *  round-trips longer than that.
+ */
+struct nvscic2c_pcie_notify_stats_args {
+	__u64 busy_poll_notifications;
+	__u64 irq_notifications;
+	__u64 rtt_hist[NVSCIC2C_PCIE_RTT_HIST_BUCKETS];
+};
+
 /* Only to facilitate calculation of maximum size of ioctl arguments.*/
 union nvscic2c_pcie_ioctl_arg_max_size {
+	struct nvscic2c_pcie_notify_stats_args ns;
+	struct nvscic2c_pcie_busy_poll_args bp;
+	struct nvscic2c_pcie_edma_stats_args es;
+	struct nvscic2c_pcie_submit_copy_batch_args cb;
 	struct nvscic2c_pcie_max_copy_args mc;
 	struct nvscic2c_pcie_submit_copy_args cr;
 	struct nvscic2c_pcie_free_obj_args fo;
@@ -268,6 +352,34 @@ union nvscic2c_pcie_ioctl_arg_max_size {
 	_IOW(NVSCIC2C_PCIE_IOCTL_MAGIC, 8,\
 	      struct nvscic2c_pcie_max_copy_args)
 
-#define NVSCIC2C_PCIE_IOCTL_NUMBER_MAX 8
+/**
+ * Get the eDMA write channel usage of the endpoint.
+ */
+#define NVSCIC2C_PCIE_IOCTL_GET_EDMA_STATS \
+	_IOR(NVSCIC2C_PCIE_IOCTL_MAGIC, 9,\
+	      struct nvscic2c_pcie_edma_stats_args)
+
+/**
+ * Submit a batch of Copy requests for transfer, signalling once.
+ */
+#define NVSCIC2C_PCIE_IOCTL_SUBMIT_COPY_BATCH \
+	_IOW(NVSCIC2C_PCIE_IOCTL_MAGIC, 10,\
+	      struct nvscic2c_pcie_submit_copy_batch_args)
+
+/**
+ * Set the busy-poll budget of poll() on the endpoint.
+ */
+#define NVSCIC2C_PCIE_IOCTL_SET_BUSY_POLL \
+	_IOW(NVSCIC2C_PCIE_IOCTL_MAGIC, 11,\
+	      struct nvscic2c_pcie_busy_poll_args)
+
+/**
+ * Get the notification round-trip histogram of the endpoint.
+ */
+#define NVSCIC2C_PCIE_IOCTL_GET_NOTIFY_STATS \
+	_IOR(NVSCIC2C_PCIE_IOCTL_MAGIC, 12,\
+	      struct nvscic2c_pcie_notify_stats_args)
+
+#define NVSCIC2C_PCIE_IOCTL_NUMBER_MAX 12
 
 #endif /*__UAPI_NVSCIC2C_PCIE_IOCTL_H__*/
@@ -27,6 +27,7 @@
 #define TEGRA_NVVSE_CMDID_GET_IVC_DB			12
 #define TEGRA_NVVSE_CMDID_TSEC_SIGN_VERIFY		13
 #define TEGRA_NVVSE_CMDID_TSEC_GET_KEYLOAD_STATUS	14
+#define TEGRA_NVVSE_CMDID_BATCH				15
 
 /** Defines the length of the AES-CBC Initial Vector */
 #define TEGRA_NVVSE_AES_IV_LEN				16U
@@ -40,6 +41,10 @@
 #define TEGRA_NVVSE_AES_CMAC_LEN			16U
 /** Defines the counter offset byte in the AES Initial counter*/
 #define TEGRA_COUNTER_OFFSET				12U
+/** Defines the maximum number of operations in one batch */
+#define TEGRA_NVVSE_BATCH_MAX_OPS			256U
+/** Defines the maximum message length of a batched operation */
+#define TEGRA_NVVSE_BATCH_MAX_DATA_LEN			4096U
 
 /**
   * @brief Defines SHA Types.
@@ -412,5 +417,71 @@ struct tegra_nvvse_aes_drng_ctl {
 #define NVVSE_IOCTL_CMDID_AES_DRNG _IOWR(TEGRA_NVVSE_IOC_MAGIC, TEGRA_NVVSE_CMDID_AES_DRNG, \
 						struct tegra_nvvse_aes_drng_ctl)
 
+/**
+ * \brief Defines the operations of a batch.
+ */
+enum tegra_nvvse_batch_op_type {
+	/** Defines AES CMAC Sign */
+	TEGRA_NVVSE_BATCH_OP_CMAC_SIGN = 0u,
+	/** Defines AES CMAC Verify */
+	TEGRA_NVVSE_BATCH_OP_CMAC_VERIFY,
+	/** Defines AES GMAC Sign */
+	TEGRA_NVVSE_BATCH_OP_GMAC_SIGN,
+	/** Defines AES GMAC Verify */
+	TEGRA_NVVSE_BATCH_OP_GMAC_VERIFY,
+};
+
+/**
+ * \brief Holds one operation of a batch, a single part sign or verify
+ * of a whole message.
+ */
+struct tegra_nvvse_batch_op {
+	/** [in] Holds the enum tegra_nvvse_batch_op_type of the operation */
+	uint32_t op;
+	/** [in] Holds a keyslot handle */
+	uint8_t key_slot[KEYSLOT_SIZE_BYTES];
+	/** [in] Holds the Key length
+	 * Supported keylength is only 16 bytes and 32 bytes
+	 */
+	uint8_t key_length;
+	/** [in] Initial Vector (IV) of a GMAC verify, unused otherwise */
+	uint8_t initial_vector[TEGRA_NVVSE_AES_GCM_IV_LEN];
+	/** [in] Holds the length of the message.
+	 * Range supported is 1 to TEGRA_NVVSE_BATCH_MAX_DATA_LEN bytes.
+	 */
+	uint32_t data_length;
+	/** [in] Holds a pointer to the message */
+	uint8_t *src_buffer;
+	/** [inout] Holds a pointer to the 16 byte CMAC or GMAC tag.
+	 * It is written by sign operations and read by verify operations.
+	 */
+	uint8_t *tag_buffer;
+	/** [out] Holds 0 when the operation was run, a negative error code
+	 * otherwise. A failed operation does not stop the batch.
+	 */
+	int32_t status;
+	/** [out] Holds the verification result of verify operations.
+	 * - '0' indicates verification success.
+	 * - Non-zero value indicates verification failure.
+	 */
+	uint8_t result;
+};
+
+/**
+ * \brief Holds a batch of operations run by one IO control call.
+ * Transforms, requests and buffers are set up once for the batch and
+ * keys are only loaded again when the keyslot changes.
+ */
+struct tegra_nvvse_batch_ctl {
+	/** [in] Holds the number of operations, 1 to TEGRA_NVVSE_BATCH_MAX_OPS */
+	uint32_t num_ops;
+	/** [out] Holds the number of operations completed with status 0 */
+	uint32_t num_done;
+	/** [inout] Holds a pointer to an array of num_ops operations */
+	struct tegra_nvvse_batch_op *ops;
+};
+#define NVVSE_IOCTL_CMDID_BATCH _IOWR(TEGRA_NVVSE_IOC_MAGIC, TEGRA_NVVSE_CMDID_BATCH, \
+						struct tegra_nvvse_batch_ctl)
+
 #endif
 
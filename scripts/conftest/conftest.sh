@@ -6224,6 +6224,44 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS" "" "types"
         ;;
 
+        vm_operations_struct_huge_fault_has_order_arg)
+            #
+            # Determine if the 'huge_fault' callback of 'vm_operations_struct'
+            # takes an 'unsigned int order' argument instead of
+            # 'enum page_entry_size'.
+            #
+            # Changed by "mm: remove enum page_entry_size" in v6.6-rc1.
+            #
+            CODE="
+            #include <linux/mm.h>
+            static vm_fault_t conftest_huge_fault(struct vm_fault *vmf,
+                                                  unsigned int order) {
+                return 0;
+            }
+            void conftest_vm_operations_struct_huge_fault_has_order_arg(void) {
+                struct vm_operations_struct ops;
+                ops.huge_fault = conftest_huge_fault;
+            }"
+
+            compile_check_conftest "$CODE" "NV_VM_OPERATIONS_STRUCT_HUGE_FAULT_HAS_ORDER_ARG" "" "types"
+        ;;
+
+        vmf_insert_pfn_pmd_has_pfn_t_arg)
+            #
+            # Determine if vmf_insert_pfn_pmd() takes a 'pfn_t' argument.
+            # The pfn_t type was removed and the function takes an
+            # 'unsigned long pfn' in later kernels.
+            #
+            CODE="
+            #include <linux/huge_mm.h>
+            #include <linux/pfn_t.h>
+            vm_fault_t conftest_vmf_insert_pfn_pmd_has_pfn_t_arg(struct vm_fault *vmf) {
+                return vmf_insert_pfn_pmd(vmf, pfn_to_pfn_t(0), false);
+            }"
+
+            compile_check_conftest "$CODE" "NV_VMF_INSERT_PFN_PMD_HAS_PFN_T_ARG" "" "types"
+        ;;
+
         drm_driver_has_dumb_destroy)
             #
             # Determine if the 'drm_driver' structure has a 'dumb_destroy'
@@ -6571,6 +6609,43 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_BLK_MQ_DESTROY_QUEUE_PRESENT" "" "functions"
         ;;
 
+        blk_mq_ops_struct_map_queues_has_int_return_type)
+            #
+            # Determine if the 'map_queues' callback of the 'blk_mq_ops'
+            # structure has an integer return type.
+            #
+            # Commit a4e1d0b76e7b ("block: Change the return type of
+            # blk_mq_map_queues() into void") made the 'map_queues' callback
+            # return void instead of an integer in Linux v6.1.
+            #
+            CODE="
+            #include <linux/blk-mq.h>
+            int conftest_blk_mq_ops_struct_map_queues_has_int_return_type(struct blk_mq_ops *ops,
+                                                                          struct blk_mq_tag_set *set) {
+                    return ops->map_queues(set);
+            }"
+
+            compile_check_conftest "$CODE" "NV_BLK_MQ_OPS_STRUCT_MAP_QUEUES_HAS_INT_RETURN_TYPE" "" "types"
+        ;;
+
+        blk_mq_ops_struct_poll_has_io_comp_batch_arg)
+            #
+            # Determine if the 'poll' callback of the 'blk_mq_ops' structure
+            # has a 'struct io_comp_batch' argument.
+            #
+            # Commit 5a72e899ceb4 ("block: add a struct io_comp_batch argument
+            # to fops->iopoll()") added the argument in Linux v5.16.
+            #
+            CODE="
+            #include <linux/blk-mq.h>
+            int conftest_blk_mq_ops_struct_poll_has_io_comp_batch_arg(struct blk_mq_ops *ops,
+                                                                      struct blk_mq_hw_ctx *hctx) {
+                    return ops->poll(hctx, NULL);
+            }"
+
+            compile_check_conftest "$CODE" "NV_BLK_MQ_OPS_STRUCT_POLL_HAS_IO_COMP_BATCH_ARG" "" "types"
+        ;;
+
         blk_queue_max_hw_sectors)
             #
             # Determine whether function blk_queue_max_hw_sectors() is present.
@@ -7060,6 +7135,22 @@ compile_test() {
                     "NV_DRM_SCDC_GET_SET_HAS_STRUCT_DRM_CONNECTOR_ARG" "" "types"
         ;;
 
+        eventfd_signal_has_counter_arg)
+            #
+            # Determine if the eventfd_signal() function has the 'n' argument.
+            #
+            # Commit 3652117f8548 ("eventfd: simplify eventfd_signal()")
+            # removed the counter argument of eventfd_signal() in Linux v6.8.
+            #
+            CODE="
+            #include <linux/eventfd.h>
+            void conftest_eventfd_signal_has_counter_arg(struct eventfd_ctx *ctx) {
+                    eventfd_signal(ctx, 1);
+            }"
+
+            compile_check_conftest "$CODE" "NV_EVENTFD_SIGNAL_HAS_COUNTER_ARG" "" "types"
+        ;;
+
         ethtool_keee_struct_present)
             #
             # Determine if the 'struct ethtool_keee' is present.
@@ -7285,6 +7376,24 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_NETIF_SET_TSO_MAX_SIZE_PRESENT" "" "functions"
         ;;
 
+        net_dim_has_dim_sample_ptr_arg)
+            #
+            # Determine if net_dim() takes the 'dim_sample' argument by
+            # reference.
+            #
+            # Changed by commit ("net: dim: pass dim_sample to net_dim() by
+            # reference") in Linux v6.13.
+            #
+            CODE="
+            #include <linux/dim.h>
+            void conftest_net_dim_has_dim_sample_ptr_arg(struct dim *dim,
+                                                         const struct dim_sample *sample) {
+                    net_dim(dim, sample);
+            }"
+
+            compile_check_conftest "$CODE" "NV_NET_DIM_HAS_DIM_SAMPLE_PTR_ARG" "" "types"
+        ;;
+
         netif_napi_add_weight)
             #
             # Determine if netif_napi_add_weight() function is present
@@ -7797,6 +7906,24 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_SPI_GET_CHIPSELECT_PRESENT" "" "functions"
         ;;
 
+        system_counterval_t_struct_has_cs_id)
+            #
+            # Determine if struct system_counterval_t has a member named cs_id
+            #
+            # In Linux v6.9 struct system_counterval_t identifies the
+            # clocksource of a cross timestamp by 'enum clocksource_ids cs_id'
+            # instead of a 'struct clocksource' pointer, which lets drivers
+            # report cross timestamps against the ARM architected counter.
+            #
+            CODE="
+            #include <linux/timekeeping.h>
+            int conftest_system_counterval_t_struct_has_cs_id(void) {
+                return offsetof(struct system_counterval_t, cs_id);
+            }
+            "
+            compile_check_conftest "$CODE" "NV_SYSTEM_COUNTERVAL_T_STRUCT_HAS_CS_ID" "" "types"
+        ;;
+
         tc_taprio_qopt_offload_struct_has_cmd)
             #
             # Determine if struct tc_taprio_qopt_offload has a member named cmd
@@ -8123,6 +8250,41 @@ compile_test() {
             compile_check_conftest "$CODE" \
                     "NV_V4L2_SUBDEV_PAD_OPS_STRUCT_HAS_DV_TIMINGS" "" "types"
         ;;
+
+        vb2_core_reqbufs_has_flags_arg)
+            #
+            # Determine if vb2_core_reqbufs() has the 'flags' argument.
+            #
+            # The 'flags' argument, carrying the V4L2_MEMORY_FLAG_* buffer
+            # allocation hints, was added to vb2_core_reqbufs() in Linux
+            # v5.17.
+            #
+            CODE="
+            #include <media/videobuf2-core.h>
+            int vb2_core_reqbufs(struct vb2_queue *q, enum vb2_memory memory,
+                                 unsigned int flags, unsigned int *count);
+            "
+            compile_check_conftest "$CODE" \
+                    "NV_VB2_CORE_REQBUFS_HAS_FLAGS_ARG" "" "types"
+        ;;
+
+        vb2_core_qbuf_has_vb2_buffer_arg)
+            #
+            # Determine if vb2_core_qbuf() takes the struct vb2_buffer to
+            # queue rather than its index.
+            #
+            # vb2_core_qbuf() and vb2_core_prepare_buf() were changed to take
+            # a struct vb2_buffer pointer in Linux v6.8, as part of lifting
+            # the fixed limit on the number of buffers in a queue.
+            #
+            CODE="
+            #include <media/videobuf2-core.h>
+            int vb2_core_qbuf(struct vb2_queue *q, struct vb2_buffer *vb,
+                              void *pb, struct media_request *req);
+            "
+            compile_check_conftest "$CODE" \
+                    "NV_VB2_CORE_QBUF_HAS_VB2_BUFFER_ARG" "" "types"
+        ;;
         crypto_engine_ctx_struct_removed_test)
             #
             # Determine if struct 'crypto_engine_ctx' is removed in linux kernel.
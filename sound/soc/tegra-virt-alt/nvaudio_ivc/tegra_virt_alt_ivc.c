@@ -84,6 +84,68 @@ fail:
 }
 EXPORT_SYMBOL_GPL(nvaudio_ivc_send);
 
+/* Control updates that may be applied by the server without a reply */
+static bool nvaudio_ivc_cmd_batchable(enum nvaudio_ivc_cmd_t cmd)
+{
+	switch (cmd) {
+	case NVAUDIO_XBAR_SET_ROUTE:
+	case NVAUDIO_AMIXER_SET_RX_GAIN:
+	case NVAUDIO_AMIXER_SET_TX_ADDER_CONFIG:
+	case NVAUDIO_AMIXER_SET_ENABLE:
+	case NVAUDIO_AMIXER_SET_RX_DURATION:
+	case NVAUDIO_SFC_SET_IN_FREQ:
+	case NVAUDIO_SFC_SET_OUT_FREQ:
+	case NVAUDIO_ASRC_SET_INT_RATIO:
+	case NVAUDIO_ASRC_SET_FRAC_RATIO:
+	case NVAUDIO_ASRC_SET_RATIO_SOURCE:
+	case NVAUDIO_ASRC_SET_STREAM_ENABLE:
+	case NVAUDIO_ASRC_SET_HWCOMP_DISABLE:
+	case NVAUDIO_ASRC_SET_INPUT_THRESHOLD:
+	case NVAUDIO_ASRC_SET_OUTPUT_THRESHOLD:
+	case NVAUDIO_ASRC_SET_RATIO:
+	case NVAUDIO_ARAD_SET_LANE_SRC:
+	case NVAUDIO_ARAD_SET_PRESCALAR:
+	case NVAUDIO_ARAD_SET_LANE_ENABLE:
+	case NVAUDIO_AMX_SET_INPUT_STREAM_ENABLE:
+	case NVAUDIO_AMX_SET_INPUT_IDLE_CNT:
+	case NVAUDIO_I2S_SET_LOOPBACK_ENABLE:
+	case NVAUDIO_I2S_SET_RATE:
+	case NVAUDIO_MVC_SET_CURVETYPE:
+	case NVAUDIO_MVC_SET_TAR_VOL:
+	case NVAUDIO_MVC_SET_MUTE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Queue a set command of an open batch. It goes out right away without
+ * waiting for the server, which stays in step since it processes the
+ * queue in order. Returns 0 when the message is not part of a batch.
+ */
+static int nvaudio_ivc_batch_queue(struct nvaudio_ivc_ctxt *ictxt,
+			struct nvaudio_ivc_msg *msg, int size)
+{
+	unsigned long flags = 0;
+	int err;
+
+	if (!READ_ONCE(ictxt->batch_active) || !msg->ack_required ||
+	    !nvaudio_ivc_cmd_batchable(msg->cmd))
+		return 0;
+
+	msg->ack_required = false;
+	err = nvaudio_ivc_send_retry(ictxt, msg, size);
+	if (err < 0)
+		return err;
+
+	spin_lock_irqsave(&ictxt->lock, flags);
+	ictxt->batch_cmds++;
+	spin_unlock_irqrestore(&ictxt->lock, flags);
+
+	return err;
+}
+
 int nvaudio_ivc_send_receive(struct nvaudio_ivc_ctxt *ictxt,
 			struct nvaudio_ivc_msg *rx_msg, int size)
 {
@@ -98,6 +160,10 @@ int nvaudio_ivc_send_receive(struct nvaudio_ivc_ctxt *ictxt,
 	if (!ictxt || !ictxt->ivck || !msg || !size)
 		return -EINVAL;
 
+	err = nvaudio_ivc_batch_queue(ictxt, msg, size);
+	if (err)
+		return err;
+
 	while (tegra_hv_ivc_channel_notified(ictxt->ivck) != 0) {
 		dev_err(ictxt->dev, "channel notified returns non zero\n");
 		dcnt--;
@@ -152,6 +218,88 @@ fail:
 }
 EXPORT_SYMBOL_GPL(nvaudio_ivc_send_receive);
 
+/*
+ * Start collecting control updates. A server that does not know the batch
+ * commands rejects the begin, after which every update keeps its own
+ * round trip and this returns -EOPNOTSUPP without asking again.
+ */
+int nvaudio_ivc_batch_begin(struct nvaudio_ivc_ctxt *ictxt)
+{
+	struct nvaudio_ivc_msg msg;
+	int err;
+
+	if (!ictxt)
+		return -EINVAL;
+
+	if (ictxt->batch_unsupported)
+		return -EOPNOTSUPP;
+
+	if (ictxt->batch_active)
+		return 0;
+
+	memset(&msg, 0, sizeof(struct nvaudio_ivc_msg));
+	msg.cmd = NVAUDIO_BATCH_BEGIN;
+	msg.ack_required = true;
+
+	err = nvaudio_ivc_send_receive(ictxt, &msg,
+			sizeof(struct nvaudio_ivc_msg));
+	if (err < 0 || msg.err != NVAUDIO_ERR_OK) {
+		dev_info(ictxt->dev,
+			"IVC batching not supported by server, err %d/%d\n",
+			err, msg.err);
+		ictxt->batch_unsupported = true;
+		return -EOPNOTSUPP;
+	}
+
+	ictxt->batch_cmds = 0;
+	WRITE_ONCE(ictxt->batch_active, true);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(nvaudio_ivc_batch_begin);
+
+/* Close the batch and wait for the one reply that covers all of it */
+int nvaudio_ivc_batch_commit(struct nvaudio_ivc_ctxt *ictxt)
+{
+	struct nvaudio_ivc_msg msg;
+	u32 queued;
+	int err;
+
+	if (!ictxt)
+		return -EINVAL;
+
+	if (!ictxt->batch_active)
+		return 0;
+
+	WRITE_ONCE(ictxt->batch_active, false);
+	queued = ictxt->batch_cmds;
+
+	memset(&msg, 0, sizeof(struct nvaudio_ivc_msg));
+	msg.cmd = NVAUDIO_BATCH_COMMIT;
+	msg.ack_required = true;
+
+	err = nvaudio_ivc_send_receive(ictxt, &msg,
+			sizeof(struct nvaudio_ivc_msg));
+	if (err < 0) {
+		dev_err(ictxt->dev, "IVC batch commit failed: %d\n", err);
+		return err;
+	}
+
+	if (msg.err != NVAUDIO_ERR_OK ||
+	    msg.params.batch_info.num_failed ||
+	    msg.params.batch_info.num_cmds != queued) {
+		dev_err(ictxt->dev,
+			"IVC batch: %u queued, %u applied, %u failed (first cmd %d), err %d\n",
+			queued, msg.params.batch_info.num_cmds,
+			msg.params.batch_info.num_failed,
+			msg.params.batch_info.first_failed_cmd, msg.err);
+		return -EIO;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(nvaudio_ivc_batch_commit);
+
 /* Every communication with the server is identified
  * with this ivc context.
  * There can be one outstanding request to the server per
@@ -181,6 +329,7 @@ struct nvaudio_ivc_ctxt *nvaudio_ivc_alloc_ctxt(struct device *dev)
 
 	spin_lock_init(&ictxt->ivck_rx_lock);
 	spin_lock_init(&ictxt->ivck_tx_lock);
+	spin_lock_init(&ictxt->lock);
 
 	tegra_hv_ivc_channel_reset(ictxt->ivck);
 
@@ -22,6 +22,10 @@ struct nvaudio_ivc_ctxt {
 	spinlock_t			ivck_rx_lock;
 	spinlock_t			ivck_tx_lock;
 	spinlock_t			lock;
+	/* set commands queued since nvaudio_ivc_batch_begin() */
+	bool				batch_active;
+	bool				batch_unsupported;
+	u32				batch_cmds;
 };
 
 void nvaudio_ivc_rx(struct tegra_hv_ivc_cookie *ivck);
@@ -51,4 +55,7 @@ int tegra124_virt_xbar_get_ivc(struct nvaudio_ivc_ctxt *ictxt,
 
 struct nvaudio_ivc_ctxt *nvaudio_get_ivc_alloc_ctxt(void);
 
+int nvaudio_ivc_batch_begin(struct nvaudio_ivc_ctxt *ictxt);
+int nvaudio_ivc_batch_commit(struct nvaudio_ivc_ctxt *ictxt);
+
 #endif
\ No newline at end of file
@@ -151,6 +151,8 @@ enum nvaudio_ivc_cmd_t {
 	NVAUDIO_AMX_SET_INPUT_IDLE_CNT,
 	NVAUDIO_ADSP_RESET,
 	NVAUDIO_ADMA_BLOCK_REGDUMP,
+	NVAUDIO_BATCH_BEGIN,
+	NVAUDIO_BATCH_COMMIT,
 	NVAUDIO_CMD_MAX,
 };
 
@@ -253,6 +255,18 @@ struct nvaudio_ivc_t210_adma_info {
 	uint32_t        channel_num;
 };
 
+/*
+ * Between NVAUDIO_BATCH_BEGIN and NVAUDIO_BATCH_COMMIT the client sends
+ * set commands with ack_required cleared and the server applies them in
+ * order without replying. The commit reply carries the number of commands
+ * applied, how many of them failed and the first failing command.
+ */
+struct nvaudio_ivc_batch_info {
+	uint32_t	num_cmds;
+	uint32_t	num_failed;
+	int32_t		first_failed_cmd;
+};
+
 struct nvaudio_ivc_msg {
 	int32_t			channel_id;
 	enum nvaudio_ivc_cmd_t	cmd;
@@ -271,6 +285,7 @@ struct nvaudio_ivc_msg {
 		struct nvaudio_ivc_t210_amixer_fade_status	fade_status;
 		struct nvaudio_ivc_adsp_reset			adsp_reset_info;
 		struct nvaudio_ivc_t210_adma_info		adma_info;
+		struct nvaudio_ivc_batch_info			batch_info;
 	} params;
 	bool			ack_required;
 	int32_t			err;
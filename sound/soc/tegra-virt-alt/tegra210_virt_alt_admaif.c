@@ -481,6 +481,7 @@ ADMA_REGDUMP_CTRL_DECL("ADMA18 regdump", 18),
 ADMA_REGDUMP_CTRL_DECL("ADMA19 regdump", 19),
 ADMA_REGDUMP_CTRL_DECL("ADMA20 regdump", 20),
 
+IVC_BATCH_CTRL_DECL("IVC Batch"),
 };
 
 static const struct snd_kcontrol_new tegra_virt_t186ref_controls[] = {
@@ -787,6 +788,8 @@ ADMA_REGDUMP_CTRL_DECL("ADMA29 regdump", 29),
 ADMA_REGDUMP_CTRL_DECL("ADMA30 regdump", 30),
 ADMA_REGDUMP_CTRL_DECL("ADMA31 regdump", 31),
 ADMA_REGDUMP_CTRL_DECL("ADMA32 regdump", 32),
+
+IVC_BATCH_CTRL_DECL("IVC Batch"),
 };
 
 static struct snd_soc_component_driver tegra210_admaif_dai_driver = {
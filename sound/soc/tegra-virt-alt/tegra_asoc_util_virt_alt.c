@@ -1626,6 +1626,51 @@ int tegra_virt_t210mixer_get_fade_status(struct snd_kcontrol *kcontrol,
 }
 EXPORT_SYMBOL(tegra_virt_t210mixer_get_fade_status);
 
+/*
+ * Writing 1 collects the following control updates into one IVC batch,
+ * writing 0 sends it and waits for its single acknowledgement. Without
+ * server support the updates go out one by one as before.
+ */
+int tegra_virt_ivc_get_batch(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_card *card = snd_kcontrol_chip(kcontrol);
+	struct nvaudio_ivc_ctxt *hivc_client =
+		nvaudio_ivc_alloc_ctxt(card->dev);
+
+	ucontrol->value.integer.value[0] =
+		hivc_client ? READ_ONCE(hivc_client->batch_active) : 0;
+
+	return 0;
+}
+EXPORT_SYMBOL(tegra_virt_ivc_get_batch);
+
+int tegra_virt_ivc_set_batch(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_card *card = snd_kcontrol_chip(kcontrol);
+	struct nvaudio_ivc_ctxt *hivc_client =
+		nvaudio_ivc_alloc_ctxt(card->dev);
+	int err;
+
+	if (ucontrol->value.integer.value[0]) {
+		err = nvaudio_ivc_batch_begin(hivc_client);
+		/* per control updates still work, so this is not an error */
+		if (err == -EOPNOTSUPP)
+			err = 0;
+	} else {
+		err = nvaudio_ivc_batch_commit(hivc_client);
+	}
+
+	if (err < 0) {
+		pr_err("%s: error on ivc batch: %d\n", __func__, err);
+		return err;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(tegra_virt_ivc_set_batch);
+
 //Fade param info
 int tegra_virt_t210mixer_param_info(struct snd_kcontrol *kcontrol,
 		       struct snd_ctl_elem_info *uinfo)
@@ -203,6 +203,11 @@
 	tegra_virt_t210adma_get_regdump, \
 	tegra_virt_t210adma_set_regdump)
 
+#define IVC_BATCH_CTRL_DECL(ename) \
+	SOC_SINGLE_EXT(ename, 0, 0, 1, 0,	\
+	tegra_virt_ivc_get_batch, \
+	tegra_virt_ivc_set_batch)
+
 #define ADDER_CTRL_DECL(name, id)	\
 	static const struct snd_kcontrol_new name[] = {	\
 MIXER_ADDER_CTRL_DECL("RX1", id, 0x01),	\
@@ -415,4 +420,11 @@ int tegra_virt_t210adma_get_regdump(
 	struct snd_kcontrol *kcontrol,
 	struct snd_ctl_elem_value *ucontrol);
 
+int tegra_virt_ivc_get_batch(
+	struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol);
+int tegra_virt_ivc_set_batch(
+	struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol);
+
 #endif
\ No newline at end of file
@@ -8,6 +8,8 @@
 
 #include <linux/clk.h>
 #include <linux/device.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
@@ -99,6 +101,7 @@ static bool tegra_admaif_wr_reg(struct device *dev, unsigned int reg)
 		if ((reg == TEGRA_ADMAIF_RX_ENABLE) ||
 		    (reg == TEGRA_ADMAIF_RX_FIFO_CTRL) ||
 		    (reg == TEGRA_ADMAIF_RX_SOFT_RESET) ||
+		    (reg == TEGRA_ADMAIF_RX_INT_CLEAR) ||
 		    (reg == TEGRA_ADMAIF_CH_ACIF_RX_CTRL))
 			return true;
 	} else if ((reg >= tx_base) && (reg < tx_max)) {
@@ -106,6 +109,7 @@ static bool tegra_admaif_wr_reg(struct device *dev, unsigned int reg)
 		if ((reg == TEGRA_ADMAIF_TX_ENABLE) ||
 		    (reg == TEGRA_ADMAIF_TX_FIFO_CTRL) ||
 		    (reg == TEGRA_ADMAIF_TX_SOFT_RESET) ||
+		    (reg == TEGRA_ADMAIF_TX_INT_CLEAR) ||
 		    (reg == TEGRA_ADMAIF_CH_ACIF_TX_CTRL))
 			return true;
 	} else if ((reg >= global_base) && (reg < reg_max)) {
@@ -177,6 +181,7 @@ static bool tegra_admaif_volatile_reg(struct device *dev, unsigned int reg)
 		if ((reg == TEGRA_ADMAIF_RX_ENABLE) ||
 		    (reg == TEGRA_ADMAIF_RX_STATUS) ||
 		    (reg == TEGRA_ADMAIF_RX_INT_STATUS) ||
+		    (reg == TEGRA_ADMAIF_RX_INT_CLEAR) ||
 		    (reg == TEGRA_ADMAIF_RX_SOFT_RESET))
 			return true;
 	} else if ((reg >= tx_base) && (reg < tx_max)) {
@@ -184,6 +189,7 @@ static bool tegra_admaif_volatile_reg(struct device *dev, unsigned int reg)
 		if ((reg == TEGRA_ADMAIF_TX_ENABLE) ||
 		    (reg == TEGRA_ADMAIF_TX_STATUS) ||
 		    (reg == TEGRA_ADMAIF_TX_INT_STATUS) ||
+		    (reg == TEGRA_ADMAIF_TX_INT_CLEAR) ||
 		    (reg == TEGRA_ADMAIF_TX_SOFT_RESET))
 			return true;
 	} else if ((reg >= global_base) && (reg < reg_max)) {
@@ -267,6 +273,106 @@ static int tegra_admaif_set_pack_mode(struct regmap *map, unsigned int reg,
 	return 0;
 }
 
+/* Time of audio one burst may hold before it is moved */
+#define ADMAIF_BURST_TIME_US	250
+
+/*
+ * Largest power of two burst, in words, that the channel FIFO holds twice
+ * over and that the stream fills within ADMAIF_BURST_TIME_US. High channel
+ * counts at high rates get the full ADMA burst, low rate streams keep
+ * latency down with short bursts.
+ */
+static unsigned int tegra_admaif_auto_burst(unsigned int fifo_words,
+					    struct snd_pcm_hw_params *params)
+{
+	u64 words_per_sec = (u64)params_rate(params) *
+			    params_channels(params) *
+			    params_physical_width(params) / 32;
+	unsigned int burst = min_t(unsigned int, fifo_words / 2,
+				   ADMAIF_MAX_BURST);
+	u64 fill = div_u64(words_per_sec * ADMAIF_BURST_TIME_US,
+			   USEC_PER_SEC);
+
+	if (fill < burst)
+		burst = fill;
+
+	return rounddown_pow_of_two(max(burst, 1U));
+}
+
+static void tegra_admaif_set_fifo(struct tegra_admaif *admaif,
+				  struct snd_soc_dai *dai, unsigned int path,
+				  struct snd_pcm_hw_params *params)
+{
+	struct snd_dmaengine_dai_dma_data *dma_data;
+	unsigned int reg, val, fifo_words, burst, threshold;
+
+	if (path == ADMAIF_TX_PATH) {
+		reg = CH_TX_REG(TEGRA_ADMAIF_TX_FIFO_CTRL, dai->id);
+		dma_data = &admaif->playback_dma_data[dai->id];
+	} else {
+		reg = CH_RX_REG(TEGRA_ADMAIF_RX_FIFO_CTRL, dai->id);
+		dma_data = &admaif->capture_dma_data[dai->id];
+	}
+
+	regmap_read(admaif->regmap, reg, &val);
+	fifo_words = (((val & FIFO_SIZE_MASK) >> FIFO_SIZE_SHIFT) + 1) *
+		     ADMAIF_FIFO_UNIT_WORDS;
+
+	burst = admaif->burst[path][dai->id];
+	if (!burst)
+		burst = tegra_admaif_auto_burst(fifo_words, params);
+	burst = min(burst, fifo_words);
+
+	/* Picked up by the dmaengine slave config after this */
+	dma_data->maxburst = burst;
+
+	if (path != ADMAIF_TX_PATH) {
+		dev_dbg(dai->dev, "ADMAIF%d RX: fifo %u words, burst %u\n",
+			dai->id + 1, fifo_words, burst);
+		return;
+	}
+
+	/* The reset threshold is the whole FIFO */
+	threshold = admaif->tx_fifo_threshold[dai->id];
+	if (!threshold)
+		threshold = fifo_words;
+	threshold = clamp(threshold, burst, fifo_words);
+
+	regmap_update_bits(admaif->regmap, reg, TX_FIFO_THRESHOLD_MASK,
+			   threshold << TX_FIFO_THRESHOLD_SHIFT);
+
+	dev_dbg(dai->dev, "ADMAIF%d TX: fifo %u words, burst %u, threshold %u\n",
+		dai->id + 1, fifo_words, burst, threshold);
+}
+
+/*
+ * The FIFO error interrupt stays masked, so its status is folded into the
+ * counter at stop and when the counter is read. A count is the number of
+ * such checks that found at least one overrun or underrun.
+ */
+static void tegra_admaif_update_xruns(struct tegra_admaif *admaif,
+				      unsigned int id, unsigned int path)
+{
+	unsigned int status_reg, clear_reg, val;
+	unsigned long flags;
+
+	if (path == ADMAIF_TX_PATH) {
+		status_reg = CH_TX_REG(TEGRA_ADMAIF_TX_INT_STATUS, id);
+		clear_reg = CH_TX_REG(TEGRA_ADMAIF_TX_INT_CLEAR, id);
+	} else {
+		status_reg = CH_RX_REG(TEGRA_ADMAIF_RX_INT_STATUS, id);
+		clear_reg = CH_RX_REG(TEGRA_ADMAIF_RX_INT_CLEAR, id);
+	}
+
+	spin_lock_irqsave(&admaif->xrun_lock, flags);
+	regmap_read(admaif->regmap, status_reg, &val);
+	if (val & FIFO_ERR_INT) {
+		admaif->xruns[path][id]++;
+		regmap_write(admaif->regmap, clear_reg, FIFO_ERR_INT);
+	}
+	spin_unlock_irqrestore(&admaif->xrun_lock, flags);
+}
+
 static int tegra_admaif_prepare(struct snd_pcm_substream *substream,
 				struct snd_soc_dai *dai)
 {
@@ -344,6 +450,8 @@ static int tegra_admaif_hw_params(struct snd_pcm_substream *substream,
 
 	tegra_set_cif(admaif->regmap, reg, &cif_conf);
 
+	tegra_admaif_set_fifo(admaif, dai, path, params);
+
 	return 0;
 }
 
@@ -403,6 +511,10 @@ static int tegra_admaif_stop(struct snd_soc_dai *dai, int direction)
 	/* Disable TX/RX channel */
 	regmap_update_bits(admaif->regmap, enable_reg, mask, ~enable);
 
+	tegra_admaif_update_xruns(admaif, dai->id,
+				  (direction == SNDRV_PCM_STREAM_PLAYBACK) ?
+				  ADMAIF_TX_PATH : ADMAIF_RX_PATH);
+
 	/* Wait until ADMAIF TX/RX status is disabled */
 	err = regmap_read_poll_timeout_atomic(admaif->regmap, status_reg, val,
 					      !(val & enable), 10, 10000);
@@ -782,6 +894,129 @@ static int tegra210_admaif_cput_stereo_to_mono(struct snd_kcontrol *kcontrol,
 	return 1;
 }
 
+static int tegra210_admaif_pget_burst(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *cmpnt = snd_soc_kcontrol_component(kcontrol);
+	struct tegra_admaif *admaif = snd_soc_component_get_drvdata(cmpnt);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+
+	ucontrol->value.integer.value[0] =
+		admaif->burst[ADMAIF_TX_PATH][mc->reg];
+
+	return 0;
+}
+
+static int tegra210_admaif_pput_burst(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *cmpnt = snd_soc_kcontrol_component(kcontrol);
+	struct tegra_admaif *admaif = snd_soc_component_get_drvdata(cmpnt);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+	int value = ucontrol->value.integer.value[0];
+
+	if (value == admaif->burst[ADMAIF_TX_PATH][mc->reg])
+		return 0;
+
+	admaif->burst[ADMAIF_TX_PATH][mc->reg] = value;
+
+	return 1;
+}
+
+static int tegra210_admaif_cget_burst(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *cmpnt = snd_soc_kcontrol_component(kcontrol);
+	struct tegra_admaif *admaif = snd_soc_component_get_drvdata(cmpnt);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+
+	ucontrol->value.integer.value[0] =
+		admaif->burst[ADMAIF_RX_PATH][mc->reg];
+
+	return 0;
+}
+
+static int tegra210_admaif_cput_burst(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *cmpnt = snd_soc_kcontrol_component(kcontrol);
+	struct tegra_admaif *admaif = snd_soc_component_get_drvdata(cmpnt);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+	int value = ucontrol->value.integer.value[0];
+
+	if (value == admaif->burst[ADMAIF_RX_PATH][mc->reg])
+		return 0;
+
+	admaif->burst[ADMAIF_RX_PATH][mc->reg] = value;
+
+	return 1;
+}
+
+static int tegra210_admaif_get_fifo_threshold(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *cmpnt = snd_soc_kcontrol_component(kcontrol);
+	struct tegra_admaif *admaif = snd_soc_component_get_drvdata(cmpnt);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+
+	ucontrol->value.integer.value[0] = admaif->tx_fifo_threshold[mc->reg];
+
+	return 0;
+}
+
+static int tegra210_admaif_put_fifo_threshold(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *cmpnt = snd_soc_kcontrol_component(kcontrol);
+	struct tegra_admaif *admaif = snd_soc_component_get_drvdata(cmpnt);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+	int value = ucontrol->value.integer.value[0];
+
+	if (value == admaif->tx_fifo_threshold[mc->reg])
+		return 0;
+
+	admaif->tx_fifo_threshold[mc->reg] = value;
+
+	return 1;
+}
+
+static int tegra210_admaif_get_xruns(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol, unsigned int path)
+{
+	struct snd_soc_component *cmpnt = snd_soc_kcontrol_component(kcontrol);
+	struct tegra_admaif *admaif = snd_soc_component_get_drvdata(cmpnt);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+
+	/* Only look at the FIFO while something else keeps it powered */
+	if (pm_runtime_get_if_in_use(cmpnt->dev) > 0) {
+		tegra_admaif_update_xruns(admaif, mc->reg, path);
+		pm_runtime_put(cmpnt->dev);
+	}
+
+	ucontrol->value.integer.value[0] = admaif->xruns[path][mc->reg];
+
+	return 0;
+}
+
+static int tegra210_admaif_pget_xruns(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	return tegra210_admaif_get_xruns(kcontrol, ucontrol, ADMAIF_TX_PATH);
+}
+
+static int tegra210_admaif_cget_xruns(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	return tegra210_admaif_get_xruns(kcontrol, ucontrol, ADMAIF_RX_PATH);
+}
+
 static int tegra_admaif_dai_probe(struct snd_soc_dai *dai)
 {
 	struct tegra_admaif *admaif = snd_soc_dai_get_drvdata(dai);
@@ -1124,6 +1359,23 @@ static const char * const tegra_admaif_mono_conv_text[] = {
 			tegra210_admaif_cput_stereo_to_mono,		       \
 			tegra_admaif_stereo_conv_text)
 
+/* Counters are read only, writes to them fail with -EPERM */
+#define TEGRA_ADMAIF_FIFO_CTRL(reg)					  \
+	SOC_SINGLE_EXT("ADMAIF" #reg " Playback Burst", reg - 1, 0,	  \
+		       ADMAIF_MAX_BURST, 0, tegra210_admaif_pget_burst,	  \
+		       tegra210_admaif_pput_burst),			  \
+	SOC_SINGLE_EXT("ADMAIF" #reg " Capture Burst", reg - 1, 0,	  \
+		       ADMAIF_MAX_BURST, 0, tegra210_admaif_cget_burst,	  \
+		       tegra210_admaif_cput_burst),			  \
+	SOC_SINGLE_EXT("ADMAIF" #reg " Playback FIFO Threshold", reg - 1, \
+		       0, TX_FIFO_THRESHOLD_MAX, 0,			  \
+		       tegra210_admaif_get_fifo_threshold,		  \
+		       tegra210_admaif_put_fifo_threshold),		  \
+	SOC_SINGLE_EXT("ADMAIF" #reg " Playback Underruns", reg - 1, 0,	  \
+		       INT_MAX, 0, tegra210_admaif_pget_xruns, NULL),	  \
+	SOC_SINGLE_EXT("ADMAIF" #reg " Capture Overruns", reg - 1, 0,	  \
+		       INT_MAX, 0, tegra210_admaif_cget_xruns, NULL)
+
 static struct snd_kcontrol_new tegra210_admaif_controls[] = {
 	TEGRA_ADMAIF_CHANNEL_CTRL(1),
 	TEGRA_ADMAIF_CHANNEL_CTRL(2),
@@ -1145,6 +1397,16 @@ static struct snd_kcontrol_new tegra210_admaif_controls[] = {
 	TEGRA_ADMAIF_CIF_CTRL(8),
 	TEGRA_ADMAIF_CIF_CTRL(9),
 	TEGRA_ADMAIF_CIF_CTRL(10),
+	TEGRA_ADMAIF_FIFO_CTRL(1),
+	TEGRA_ADMAIF_FIFO_CTRL(2),
+	TEGRA_ADMAIF_FIFO_CTRL(3),
+	TEGRA_ADMAIF_FIFO_CTRL(4),
+	TEGRA_ADMAIF_FIFO_CTRL(5),
+	TEGRA_ADMAIF_FIFO_CTRL(6),
+	TEGRA_ADMAIF_FIFO_CTRL(7),
+	TEGRA_ADMAIF_FIFO_CTRL(8),
+	TEGRA_ADMAIF_FIFO_CTRL(9),
+	TEGRA_ADMAIF_FIFO_CTRL(10),
 	SOC_SINGLE_EXT("APE Reg Dump", SND_SOC_NOPM, 0, 1, 0,
 		       tegra210_admaif_get_reg_dump,
 		       tegra210_admaif_put_reg_dump),
@@ -1191,6 +1453,26 @@ static struct snd_kcontrol_new tegra186_admaif_controls[] = {
 	TEGRA_ADMAIF_CIF_CTRL(18),
 	TEGRA_ADMAIF_CIF_CTRL(19),
 	TEGRA_ADMAIF_CIF_CTRL(20),
+	TEGRA_ADMAIF_FIFO_CTRL(1),
+	TEGRA_ADMAIF_FIFO_CTRL(2),
+	TEGRA_ADMAIF_FIFO_CTRL(3),
+	TEGRA_ADMAIF_FIFO_CTRL(4),
+	TEGRA_ADMAIF_FIFO_CTRL(5),
+	TEGRA_ADMAIF_FIFO_CTRL(6),
+	TEGRA_ADMAIF_FIFO_CTRL(7),
+	TEGRA_ADMAIF_FIFO_CTRL(8),
+	TEGRA_ADMAIF_FIFO_CTRL(9),
+	TEGRA_ADMAIF_FIFO_CTRL(10),
+	TEGRA_ADMAIF_FIFO_CTRL(11),
+	TEGRA_ADMAIF_FIFO_CTRL(12),
+	TEGRA_ADMAIF_FIFO_CTRL(13),
+	TEGRA_ADMAIF_FIFO_CTRL(14),
+	TEGRA_ADMAIF_FIFO_CTRL(15),
+	TEGRA_ADMAIF_FIFO_CTRL(16),
+	TEGRA_ADMAIF_FIFO_CTRL(17),
+	TEGRA_ADMAIF_FIFO_CTRL(18),
+	TEGRA_ADMAIF_FIFO_CTRL(19),
+	TEGRA_ADMAIF_FIFO_CTRL(20),
 	SOC_SINGLE_EXT("APE Reg Dump", SND_SOC_NOPM, 0, 1, 0,
 		       tegra210_admaif_get_reg_dump,
 		       tegra210_admaif_put_reg_dump),
@@ -1308,8 +1590,28 @@ static int tegra_admaif_probe(struct platform_device *pdev)
 				     sizeof(unsigned int), GFP_KERNEL);
 		if (!admaif->stereo_to_mono[i])
 			return -ENOMEM;
+
+		admaif->burst[i] =
+			devm_kcalloc(&pdev->dev, admaif->soc_data->num_ch,
+				     sizeof(unsigned int), GFP_KERNEL);
+		if (!admaif->burst[i])
+			return -ENOMEM;
+
+		admaif->xruns[i] =
+			devm_kcalloc(&pdev->dev, admaif->soc_data->num_ch,
+				     sizeof(unsigned int), GFP_KERNEL);
+		if (!admaif->xruns[i])
+			return -ENOMEM;
 	}
 
+	admaif->tx_fifo_threshold =
+		devm_kcalloc(&pdev->dev, admaif->soc_data->num_ch,
+			     sizeof(unsigned int), GFP_KERNEL);
+	if (!admaif->tx_fifo_threshold)
+		return -ENOMEM;
+
+	spin_lock_init(&admaif->xrun_lock);
+
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 
 	regs = devm_ioremap_resource(&pdev->dev, res);
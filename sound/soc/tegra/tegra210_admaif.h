@@ -65,6 +65,18 @@
 #define RX_ENABLE					BIT(RX_ENABLE_SHIFT)
 #define SW_RESET_MASK					1
 #define SW_RESET					1
+#define FIFO_SIZE_SHIFT					8
+#define FIFO_SIZE_MASK					(0xf << FIFO_SIZE_SHIFT)
+#define TX_FIFO_THRESHOLD_SHIFT				20
+#define TX_FIFO_THRESHOLD_MAX				0x1ff
+#define TX_FIFO_THRESHOLD_MASK				(TX_FIFO_THRESHOLD_MAX << \
+							 TX_FIFO_THRESHOLD_SHIFT)
+/* RX overrun / TX underrun, masked by the reset INT_MASK */
+#define FIFO_ERR_INT					BIT(0)
+/* FIFO_SIZE counts FIFO units of 8 words, less one */
+#define ADMAIF_FIFO_UNIT_WORDS				8
+/* ADMA burst limit, in 32-bit words */
+#define ADMAIF_MAX_BURST				16
 /* Default values - Tegra210 */
 #define TEGRA210_ADMAIF_RX1_FIFO_CTRL_REG_DEFAULT	0x00000300
 #define TEGRA210_ADMAIF_RX2_FIFO_CTRL_REG_DEFAULT	0x00000304
@@ -160,6 +172,12 @@ struct tegra_admaif {
 	void __iomem *base_addr;
 	unsigned int *mono_to_stereo[ADMAIF_PATHS];
 	unsigned int *stereo_to_mono[ADMAIF_PATHS];
+	/* 0 picks the burst and TX FIFO threshold from the stream */
+	unsigned int *burst[ADMAIF_PATHS];
+	unsigned int *tx_fifo_threshold;
+	/* RX overruns and TX underruns seen at stop or on read */
+	unsigned int *xruns[ADMAIF_PATHS];
+	spinlock_t xrun_lock;
 	struct regmap *regmap;
 };
 
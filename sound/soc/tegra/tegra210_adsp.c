@@ -9,6 +9,7 @@
 
 #include <linux/module.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/io.h>
@@ -23,6 +24,9 @@
 #include <linux/platform_device.h>
 #include <linux/firmware.h>
 #include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 #include <linux/tegra_nvadsp.h>
 #include <linux/of_device.h>
 
@@ -63,6 +67,15 @@ struct adsp_event_nlmsg {
 /* ADSP controls plugin index */
 #define PLUGIN_SET_PARAMS_IDX	1
 #define PLUGIN_SEND_BYTES_IDX	21
+
+/* Shortest period the position poll is armed for, in us */
+#define ADSP_LL_PERIOD_TIME_MIN	1000
+
+static bool low_latency;
+module_param(low_latency, bool, 0644);
+MODULE_PARM_DESC(low_latency,
+	"Poll the APM shared position for PCM period updates (default: off)");
+
 static const unsigned int tegra210_adsp_rates[] = {
 	8000, 11025, 12000, 16000, 22050,
 	24000, 32000, 44100, 48000
@@ -99,6 +112,22 @@ struct tegra210_adsp_app_read_data {
 	int32_t data[NVFX_MAX_RAW_DATA_WSIZE];
 };
 
+/* Min, max and running sum of one latency sampled in us */
+struct tegra210_adsp_lat_stat {
+	u64 samples;
+	u64 sum;
+	u64 min;
+	u64 max;
+};
+
+/* Latency of the low latency PCM stream of an FE APM */
+struct tegra210_adsp_latency {
+	spinlock_t lock;
+	struct tegra210_adsp_lat_stat host;	/* queued in the ALSA ring */
+	struct tegra210_adsp_lat_stat graph;	/* taken in, not yet put out */
+	struct tegra210_adsp_lat_stat msg;	/* position msg after poll */
+};
+
 /* ADSP APP specific structure */
 struct tegra210_adsp_app {
 	struct tegra210_adsp *adsp;
@@ -129,6 +158,7 @@ struct tegra210_adsp_app {
 	int (*msg_handler)(struct tegra210_adsp_app *app, apm_msg_t *msg);
 	struct work_struct *override_freq_work;
 	spinlock_t apm_msg_queue_lock;
+	struct tegra210_adsp_latency latency; /* Valid for only FE APM */
 };
 
 struct tegra210_adsp_pcm_rtd {
@@ -136,6 +166,14 @@ struct tegra210_adsp_pcm_rtd {
 	struct snd_pcm_substream *substream;
 	struct tegra210_adsp_app *fe_apm;
 	snd_pcm_uframes_t prev_appl_ptr;
+	/* low latency mode, periods are taken from the APM shared state */
+	bool low_latency;
+	bool poll_running;
+	struct hrtimer poll_timer;
+	ktime_t poll_interval;
+	size_t period_bytes;
+	u64 last_period;
+	ktime_t period_ts;	/* when the poll saw the last period end */
 };
 
 struct tegra210_adsp_compr_rtd {
@@ -178,6 +216,7 @@ struct tegra210_adsp {
 		uint32_t rate;
 	} pcm_path[ADSP_FE_COUNT+1][2];
 	struct sock *nl_sk;
+	struct dentry *debugfs;
 };
 
 static const struct snd_pcm_hardware adsp_pcm_hardware = {
@@ -1232,14 +1271,23 @@ static status_t tegra210_adsp_msg_handler(uint32_t msg, void *data)
 
 	switch (msg) {
 	case apm_cmd_msg_ready: {
-		ret = tegra210_adsp_get_msg(app->apm, &apm_msg);
-		if (ret < 0) {
-			pr_err("Dequeue failed %d.", ret);
+		/*
+		 * Drain everything queued so far. The doorbells of messages
+		 * taken here then find the queue empty and return.
+		 */
+		if (msgq_empty(&app->apm->msgq_send.msgq))
 			break;
-		}
 
-		if (app->msg_handler)
-			ret = app->msg_handler(app, &apm_msg);
+		do {
+			ret = tegra210_adsp_get_msg(app->apm, &apm_msg);
+			if (ret < 0) {
+				pr_err("Dequeue failed %d.", ret);
+				break;
+			}
+
+			if (app->msg_handler)
+				ret = app->msg_handler(app, &apm_msg);
+		} while (!msgq_empty(&app->apm->msgq_send.msgq));
 	}
 	break;
 	case apm_cmd_raw_data_ready: {
@@ -1318,6 +1366,130 @@ static int tegra210_adsp_component_pcm_ack(struct snd_soc_component *component,
 	return tegra210_adsp_pcm_ack(substream);
 }
 
+/*
+ * Host side byte count of the FE APM. The ADSP updates it in the shared
+ * state as it moves data, so the pointer need not wait for a position msg.
+ */
+static size_t tegra210_adsp_pcm_hw_bytes(struct tegra210_adsp_pcm_rtd *prtd)
+{
+	nvfx_shared_state_t *shared = &prtd->fe_apm->apm->nvfx_shared_state;
+	size_t bytes;
+
+	if (prtd->substream->stream == SNDRV_PCM_STREAM_CAPTURE)
+		bytes = READ_ONCE(shared->output[0].bytes);
+	else
+		bytes = READ_ONCE(shared->input[0].bytes);
+
+	/* Order the captured data after the count that covers it */
+	rmb();
+
+	return bytes;
+}
+
+static void tegra210_adsp_lat_add(struct tegra210_adsp_lat_stat *stat,
+				  u64 us)
+{
+	if (!stat->samples || us < stat->min)
+		stat->min = us;
+	if (us > stat->max)
+		stat->max = us;
+	stat->sum += us;
+	stat->samples++;
+}
+
+static u64 tegra210_adsp_frames_to_us(struct snd_pcm_runtime *runtime,
+				      snd_pcm_uframes_t frames)
+{
+	return div_u64((u64)frames * USEC_PER_SEC, runtime->rate);
+}
+
+/* Called by the poll for each period it completes */
+static void tegra210_adsp_pcm_sample_latency(
+				struct tegra210_adsp_pcm_rtd *prtd)
+{
+	struct snd_pcm_runtime *runtime = prtd->substream->runtime;
+	nvfx_shared_state_t *shared = &prtd->fe_apm->apm->nvfx_shared_state;
+	struct tegra210_adsp_latency *lat = &prtd->fe_apm->latency;
+	snd_pcm_uframes_t queued;
+	unsigned long flags;
+	size_t in, out;
+
+	if (prtd->substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		queued = snd_pcm_playback_hw_avail(runtime);
+	else
+		queued = snd_pcm_capture_avail(runtime);
+
+	in = READ_ONCE(shared->input[0].bytes);
+	out = READ_ONCE(shared->output[0].bytes);
+
+	spin_lock_irqsave(&lat->lock, flags);
+	prtd->period_ts = ktime_get();
+	tegra210_adsp_lat_add(&lat->host,
+		tegra210_adsp_frames_to_us(runtime, queued));
+	/* Only comparable while no SRC or format change sits in the APM */
+	if (in >= out)
+		tegra210_adsp_lat_add(&lat->graph,
+			tegra210_adsp_frames_to_us(runtime,
+				bytes_to_frames(runtime, in - out)));
+	spin_unlock_irqrestore(&lat->lock, flags);
+}
+
+/* Called for a position msg, measures how late it is behind the poll */
+static void tegra210_adsp_pcm_sample_msg(struct tegra210_adsp_pcm_rtd *prtd)
+{
+	struct tegra210_adsp_latency *lat = &prtd->fe_apm->latency;
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	/* A msg that beats the poll has no period to pair with */
+	if (prtd->period_ts) {
+		tegra210_adsp_lat_add(&lat->msg,
+			ktime_us_delta(ktime_get(), prtd->period_ts));
+		prtd->period_ts = 0;
+	}
+	spin_unlock_irqrestore(&lat->lock, flags);
+}
+
+static enum hrtimer_restart tegra210_adsp_pcm_poll(struct hrtimer *timer)
+{
+	struct tegra210_adsp_pcm_rtd *prtd =
+		container_of(timer, struct tegra210_adsp_pcm_rtd, poll_timer);
+	u64 period;
+
+	if (!READ_ONCE(prtd->poll_running))
+		return HRTIMER_NORESTART;
+
+	period = div_u64(tegra210_adsp_pcm_hw_bytes(prtd), prtd->period_bytes);
+	if (period != prtd->last_period) {
+		prtd->last_period = period;
+		snd_pcm_period_elapsed(prtd->substream);
+		tegra210_adsp_pcm_sample_latency(prtd);
+	}
+
+	hrtimer_forward_now(timer, prtd->poll_interval);
+	return HRTIMER_RESTART;
+}
+
+static void tegra210_adsp_pcm_poll_start(struct tegra210_adsp_pcm_rtd *prtd)
+{
+	prtd->last_period = div_u64(tegra210_adsp_pcm_hw_bytes(prtd),
+				    prtd->period_bytes);
+	WRITE_ONCE(prtd->poll_running, true);
+	hrtimer_start(&prtd->poll_timer, prtd->poll_interval,
+		      HRTIMER_MODE_REL);
+}
+
+/*
+ * Called from trigger, where the stream lock the poll may be spinning on is
+ * held. The poll sees poll_running cleared and goes away by itself, and
+ * hw_free/close wait for it with hrtimer_cancel().
+ */
+static void tegra210_adsp_pcm_poll_stop(struct tegra210_adsp_pcm_rtd *prtd)
+{
+	WRITE_ONCE(prtd->poll_running, false);
+	hrtimer_try_to_cancel(&prtd->poll_timer);
+}
+
 static int tegra210_adsp_pcm_msg_handler(struct tegra210_adsp_app *app,
 					apm_msg_t *apm_msg)
 {
@@ -1329,7 +1501,10 @@ static int tegra210_adsp_pcm_msg_handler(struct tegra210_adsp_app *app,
 		if (!prtd || !prtd->substream)
 			return 0;
 		runtime = prtd->substream->runtime;
-		snd_pcm_period_elapsed(prtd->substream);
+		if (prtd->low_latency)
+			tegra210_adsp_pcm_sample_msg(prtd);
+		else
+			snd_pcm_period_elapsed(prtd->substream);
 		if ((IS_MMAP_ACCESS(runtime->access))) {
 			if (prtd->prev_appl_ptr !=
 				runtime->control->appl_ptr) {
@@ -1510,9 +1685,10 @@ static int tegra210_adsp_compr_set_params(struct snd_soc_component *component,
 	if (ret < 0)
 		return ret;
 
+	/* one doorbell for the three setup messages */
 	ret = tegra210_adsp_send_io_buffer_msg(prtd->fe_apm, prtd->buf.addr,
 					prtd->buf.bytes,
-					TEGRA210_ADSP_MSG_FLAG_SEND);
+					TEGRA210_ADSP_MSG_FLAG_HOLD);
 	if (ret < 0) {
 		dev_err(prtd->dev, "IO buffer send msg failed. err %d.", ret);
 		return ret;
@@ -1520,7 +1696,7 @@ static int tegra210_adsp_compr_set_params(struct snd_soc_component *component,
 
 	ret = tegra210_adsp_send_period_size_msg(prtd->fe_apm,
 					params->buffer.fragment_size,
-					TEGRA210_ADSP_MSG_FLAG_SEND);
+					TEGRA210_ADSP_MSG_FLAG_HOLD);
 	if (ret < 0) {
 		dev_err(prtd->dev, "Period size send msg failed. err %d.", ret);
 		return ret;
@@ -1576,9 +1752,10 @@ static int tegra210_adsp_compr_trigger(struct snd_soc_component *component,
 		}
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
+		/* the flush rings the doorbell for both */
 		ret = tegra210_adsp_send_state_msg(prtd->fe_apm,
 			nvfx_state_inactive,
-			TEGRA210_ADSP_MSG_FLAG_SEND);
+			TEGRA210_ADSP_MSG_FLAG_HOLD);
 		if (ret < 0) {
 			dev_err(prtd->dev, "Failed to set state stop");
 			return ret;
@@ -1811,6 +1988,36 @@ static int tegra210_adsp_pcm_open(struct snd_soc_component *component,
 			"failed to set buffer_size constraint %d\n", ret);
 		return ret;
 	}
+
+	prtd->low_latency = low_latency;
+	if (prtd->low_latency) {
+		unsigned long flags;
+
+		/* Bound the poll rate, 1ms periods are the shortest served */
+		ret = snd_pcm_hw_constraint_minmax(substream->runtime,
+			SNDRV_PCM_HW_PARAM_PERIOD_TIME,
+			ADSP_LL_PERIOD_TIME_MIN, UINT_MAX);
+		if (ret < 0) {
+			dev_err(adsp->dev,
+				"failed to set period_time constraint %d\n",
+				ret);
+			return ret;
+		}
+
+		hrtimer_init(&prtd->poll_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		prtd->poll_timer.function = tegra210_adsp_pcm_poll;
+
+		spin_lock_irqsave(&prtd->fe_apm->latency.lock, flags);
+		memset(&prtd->fe_apm->latency.host, 0,
+		       sizeof(prtd->fe_apm->latency.host));
+		memset(&prtd->fe_apm->latency.graph, 0,
+		       sizeof(prtd->fe_apm->latency.graph));
+		memset(&prtd->fe_apm->latency.msg, 0,
+		       sizeof(prtd->fe_apm->latency.msg));
+		spin_unlock_irqrestore(&prtd->fe_apm->latency.lock, flags);
+	}
+
 	substream->runtime->private_data = prtd;
 	prtd->substream = substream;
 	prtd->dev = adsp->dev;
@@ -1829,6 +2036,9 @@ static int tegra210_adsp_pcm_close(struct snd_soc_component *component,
 	tegra_isomgr_adma_setbw(substream, false);
 
 	if (prtd) {
+		if (prtd->low_latency)
+			hrtimer_cancel(&prtd->poll_timer);
+
 		tegra210_adsp_send_reset_msg(prtd->fe_apm,
 			TEGRA210_ADSP_MSG_FLAG_SEND |
 			TEGRA210_ADSP_MSG_FLAG_NEED_ACK);
@@ -1892,6 +2102,15 @@ static int tegra210_adsp_pcm_hw_params(struct snd_soc_component *component,
 	if (ret < 0)
 		dev_err(prtd->dev, "Failed to set secure state.");
 
+	if (prtd->low_latency) {
+		hrtimer_cancel(&prtd->poll_timer);
+		prtd->period_bytes = params_period_bytes(params);
+		/* Poll twice a period so a period end is seen within half */
+		prtd->poll_interval = ns_to_ktime(div_u64((u64)
+			params_period_size(params) * NSEC_PER_SEC,
+			params_rate(params) * 2));
+	}
+
 	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
 	return 0;
 }
@@ -1899,6 +2118,11 @@ static int tegra210_adsp_pcm_hw_params(struct snd_soc_component *component,
 static int tegra210_adsp_pcm_hw_free(struct snd_soc_component *component,
 				     struct snd_pcm_substream *substream)
 {
+	struct tegra210_adsp_pcm_rtd *prtd = substream->runtime->private_data;
+
+	if (prtd && prtd->low_latency)
+		hrtimer_cancel(&prtd->poll_timer);
+
 	snd_pcm_set_runtime_buffer(substream, NULL);
 	return 0;
 }
@@ -1931,9 +2155,15 @@ static int tegra210_adsp_pcm_trigger(struct snd_soc_component *component,
 			prtd->prev_appl_ptr = runtime->control->appl_ptr;
 			tegra210_adsp_pcm_ack(substream);
 		}
+
+		if (prtd->low_latency)
+			tegra210_adsp_pcm_poll_start(prtd);
 		break;
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 	case SNDRV_PCM_TRIGGER_SUSPEND:
+		if (prtd->low_latency)
+			tegra210_adsp_pcm_poll_stop(prtd);
+
 		ret = tegra210_adsp_send_state_msg(prtd->fe_apm,
 			nvfx_state_inactive,
 			TEGRA210_ADSP_MSG_FLAG_SEND);
@@ -1943,6 +2173,9 @@ static int tegra210_adsp_pcm_trigger(struct snd_soc_component *component,
 		}
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
+		if (prtd->low_latency)
+			tegra210_adsp_pcm_poll_stop(prtd);
+
 		ret = tegra210_adsp_send_state_msg(prtd->fe_apm,
 			nvfx_state_inactive,
 			TEGRA210_ADSP_MSG_FLAG_SEND);
@@ -1982,13 +2215,9 @@ static snd_pcm_uframes_t
 				  struct snd_pcm_substream *substream)
 {
 	struct tegra210_adsp_pcm_rtd *prtd = substream->runtime->private_data;
-	struct tegra210_adsp_app *app = prtd->fe_apm;
 	size_t bytes, pos;
 
-	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE)
-		bytes = app->apm->nvfx_shared_state.output[0].bytes;
-	else
-		bytes = app->apm->nvfx_shared_state.input[0].bytes;
+	bytes = tegra210_adsp_pcm_hw_bytes(prtd);
 
 	pos = bytes % frames_to_bytes(substream->runtime,
 		substream->runtime->buffer_size);
@@ -4495,6 +4724,48 @@ static void adsp_control_name_override(struct device *dev, int wt_idx, int i,
 	tegra210_adsp_mux_texts[mux_idx] = name;
 }
 
+static void tegra210_adsp_lat_show(struct seq_file *s, const char *name,
+				   const struct tegra210_adsp_lat_stat *stat)
+{
+	seq_printf(s, "  %s_us: samples %llu min %llu avg %llu max %llu\n",
+		   name, stat->samples, stat->min,
+		   stat->samples ? div64_u64(stat->sum, stat->samples) : 0,
+		   stat->max);
+}
+
+static int tegra210_adsp_latency_show(struct seq_file *s, void *data)
+{
+	struct tegra210_adsp *adsp = s->private;
+	struct tegra210_adsp_latency lat;
+	unsigned long flags;
+	int i;
+
+	for (i = APM_IN_START; i <= APM_OUT_END; i++) {
+		if (!IS_APM(i))
+			continue;
+
+		spin_lock_irqsave(&adsp->apps[i].latency.lock, flags);
+		lat.host = adsp->apps[i].latency.host;
+		lat.graph = adsp->apps[i].latency.graph;
+		lat.msg = adsp->apps[i].latency.msg;
+		spin_unlock_irqrestore(&adsp->apps[i].latency.lock, flags);
+
+		if (!lat.host.samples)
+			continue;
+
+		if (IS_APM_IN(i))
+			seq_printf(s, "apm-in%d:\n", i - APM_IN_START + 1);
+		else
+			seq_printf(s, "apm-out%d:\n", i - APM_OUT_START + 1);
+		tegra210_adsp_lat_show(s, "host", &lat.host);
+		tegra210_adsp_lat_show(s, "graph", &lat.graph);
+		tegra210_adsp_lat_show(s, "pos_msg", &lat.msg);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tegra210_adsp_latency);
+
 static int tegra210_adsp_audio_probe(struct platform_device *pdev)
 {
 	struct device_node *np = pdev->dev.of_node, *subnp;
@@ -4572,6 +4843,7 @@ static int tegra210_adsp_audio_probe(struct platform_device *pdev)
 	for (i = 0; i < TEGRA210_ADSP_VIRT_REG_MAX; i++) {
 		adsp->apps[i].reg = i;
 		adsp->apps[i].priority = APM_PRIORITY_DEFAULT;
+		spin_lock_init(&adsp->apps[i].latency.lock);
 		adsp->apps[i].min_adsp_clock = 0;
 		adsp->apps[i].secure_mode = false;
 		adsp->apps[i].input_mode = NVFX_APM_INPUT_MODE_PUSH;
@@ -4760,6 +5032,10 @@ static int tegra210_adsp_audio_probe(struct platform_device *pdev)
 		goto err_release_netlink;
 	}
 
+	adsp->debugfs = debugfs_create_dir(DRV_NAME, NULL);
+	debugfs_create_file("latency", 0444, adsp->debugfs, adsp,
+			    &tegra210_adsp_latency_fops);
+
 	dev_info(&pdev->dev, "Tegra210 ADSP driver successfully registered\n");
 
 	return 0;
@@ -4778,6 +5054,7 @@ static int tegra210_adsp_audio_remove(struct platform_device *pdev)
 {
 	struct tegra210_adsp *adsp = dev_get_drvdata(&pdev->dev);
 
+	debugfs_remove_recursive(adsp->debugfs);
 	netlink_kernel_release(adsp->nl_sk);
 	snd_soc_unregister_component(&pdev->dev);
 	pm_runtime_disable(&pdev->dev);
@@ -6,6 +6,7 @@
 
 #include <nvidia/conftest.h>
 
+#include <linux/bitmap.h>
 #include <linux/clk.h>
 #include <linux/device.h>
 #include <linux/module.h>
@@ -60,10 +61,11 @@ static int tegra_ahub_put_value_enum(struct snd_kcontrol *kctl,
 	struct tegra_ahub *ahub = snd_soc_component_get_drvdata(cmpnt);
 	struct snd_soc_dapm_context *dapm = snd_soc_dapm_kcontrol_dapm(kctl);
 	struct soc_enum *e = (struct soc_enum *)kctl->private_value;
-	struct snd_soc_dapm_update update[TEGRA_XBAR_UPDATE_MAX_REG] = { };
+	struct snd_soc_dapm_update update = { .kcontrol = kctl };
 	unsigned int *item = uctl->value.enumerated.item;
 	unsigned int value = e->values[item[0]];
 	unsigned int i, bit_pos, reg_idx = 0, reg_val = 0;
+	unsigned int stride = regmap_get_reg_stride(ahub->regmap);
 	int change = 0;
 
 	if (item[0] >= e->items)
@@ -78,24 +80,43 @@ static int tegra_ahub_put_value_enum(struct snd_kcontrol *kctl,
 
 	/*
 	 * Run through all parts of a MUX register to find the state changes.
-	 * There will be an additional update if new MUX input value is from
-	 * different part of the MUX register.
+	 * Moving to an input in a different part of the MUX register clears
+	 * the old part and sets the new one; both go out as one DAPM update
+	 * so the route change costs a single power sweep.
 	 */
 	for (i = 0; i < ahub->soc_data->reg_count; i++) {
-		update[i].reg = e->reg + (TEGRA210_XBAR_PART1_RX * i);
-		update[i].val = (i == reg_idx) ? reg_val : 0;
-		update[i].mask = ahub->soc_data->mask[i];
-		update[i].kcontrol = kctl;
-
-		/* Update widget power if state has changed */
-		if (snd_soc_component_test_bits(cmpnt, update[i].reg,
-						update[i].mask,
-						update[i].val))
-			change |= snd_soc_dapm_mux_update_power(dapm, kctl,
-								item[0], e,
-								&update[i]);
+		unsigned int reg = e->reg + (TEGRA210_XBAR_PART1_RX * i);
+		unsigned int mask = ahub->soc_data->mask[i];
+		unsigned int val = (i == reg_idx) ? reg_val : 0;
+
+		if (!snd_soc_component_test_bits(cmpnt, reg, mask, val))
+			continue;
+
+		set_bit(reg / stride, ahub->dirty);
+
+		if (!update.mask) {
+			update.reg = reg;
+			update.mask = mask;
+			update.val = val;
+			continue;
+		}
+
+		update.reg2 = reg;
+		update.mask2 = mask;
+		update.val2 = val;
+		update.has_second_set = true;
+
+		change |= snd_soc_dapm_mux_update_power(dapm, kctl, item[0], e,
+							&update);
+		memset(&update, 0, sizeof(update));
+		update.kcontrol = kctl;
 	}
 
+	/* Update widget power if state has changed */
+	if (update.mask)
+		change |= snd_soc_dapm_mux_update_power(dapm, kctl, item[0], e,
+							&update);
+
 	return change;
 }
 
@@ -112,10 +133,18 @@ void tegra210_ahub_write_ram(struct regmap *regmap, unsigned int reg_ctrl,
 	val |= TEGRA210_AHUBRAMCTL_CTRL_RW_WRITE;
 
 	regmap_write(regmap, reg_ctrl, val);
+
+	/*
+	 * The data port advances the RAM address on every access, so a map
+	 * that marks it writeable_noinc gets the whole block in one call.
+	 * Others, or a bus without noinc support, fail before anything is
+	 * written and fall back to one write per word.
+	 */
+	if (!regmap_noinc_write(regmap, reg_data, data, size * sizeof(*data)))
+		return;
+
 	for (i = 0; i < size; i++)
 		regmap_write(regmap, reg_data, data[i]);
-
-	return;
 }
 EXPORT_SYMBOL_GPL(tegra210_ahub_write_ram);
 
@@ -1582,6 +1611,35 @@ static const struct of_device_id tegra_ahub_of_match[] = {
 };
 MODULE_DEVICE_TABLE(of, tegra_ahub_of_match);
 
+/*
+ * Only MUX registers written through the AHUB controls can differ from
+ * their reset value, so resume restores just those instead of walking the
+ * whole cache. A register that ends up back at its reset value is dropped
+ * from the set once it has been written out.
+ */
+static void __maybe_unused tegra_ahub_sync_dirty(struct tegra_ahub *ahub)
+{
+	unsigned int stride = regmap_get_reg_stride(ahub->regmap);
+	unsigned long start, end = 0;
+	unsigned int val;
+
+	for (;;) {
+		start = find_next_bit(ahub->dirty, ahub->num_regs, end);
+		if (start >= ahub->num_regs)
+			break;
+
+		end = find_next_zero_bit(ahub->dirty, ahub->num_regs, start);
+		regcache_sync_region(ahub->regmap, start * stride,
+				     (end - 1) * stride);
+	}
+
+	for_each_set_bit(start, ahub->dirty, ahub->num_regs) {
+		regmap_read(ahub->regmap, start * stride, &val);
+		if (!val)
+			clear_bit(start, ahub->dirty);
+	}
+}
+
 static int __maybe_unused tegra_ahub_runtime_suspend(struct device *dev)
 {
 	struct tegra_ahub *ahub = dev_get_drvdata(dev);
@@ -1606,7 +1664,7 @@ static int __maybe_unused tegra_ahub_runtime_resume(struct device *dev)
 	}
 
 	regcache_cache_only(ahub->regmap, false);
-	regcache_sync(ahub->regmap);
+	tegra_ahub_sync_dirty(ahub);
 
 	return 0;
 }
@@ -1644,6 +1702,13 @@ static int tegra_ahub_probe(struct platform_device *pdev)
 
 	regcache_cache_only(ahub->regmap, true);
 
+	ahub->num_regs = ahub->soc_data->regmap_config->max_register /
+			 ahub->soc_data->regmap_config->reg_stride + 1;
+	ahub->dirty = devm_kcalloc(&pdev->dev, BITS_TO_LONGS(ahub->num_regs),
+				   sizeof(unsigned long), GFP_KERNEL);
+	if (!ahub->dirty)
+		return -ENOMEM;
+
 	err = devm_snd_soc_register_component(&pdev->dev,
 					      ahub->soc_data->cmpnt_drv,
 					      ahub->soc_data->dai_drv,
@@ -133,6 +133,9 @@ struct tegra_ahub {
 	const struct tegra_ahub_soc_data *soc_data;
 	struct regmap *regmap;
 	struct clk *clk;
+	/* registers to restore on resume, one bit per register */
+	unsigned long *dirty;
+	unsigned int num_regs;
 };
 
 void tegra210_ahub_write_ram(struct regmap *regmap, unsigned int reg_ctrl,
@@ -2910,6 +2910,10 @@ static int tegra210_sfc_runtime_suspend(struct device *dev)
 	regcache_cache_only(sfc->regmap, true);
 	regcache_mark_dirty(sfc->regmap);
 
+	/* The coefficient RAM is not in the cache and may lose its contents */
+	sfc->coef_srate_in = -1;
+	sfc->coef_srate_out = -1;
+
 	return 0;
 }
 
@@ -2931,18 +2935,26 @@ static int tegra210_sfc_write_coeff_ram(struct tegra210_sfc *sfc)
 	if (!coeff_ram)
 		return -EINVAL;
 
-	if (coeff_ram) {
+	/*
+	 * Soft reset leaves the RAM alone, so a stream restarted with the
+	 * same rate pair only needs the RAM switched back on.
+	 */
+	if (sfc->coef_srate_in != sfc->srate_in ||
+	    sfc->coef_srate_out != sfc->srate_out) {
 		tegra210_ahub_write_ram(sfc->regmap,
 			TEGRA210_SFC_CFG_RAM_CTRL,
 			TEGRA210_SFC_CFG_RAM_DATA,
 			0, coeff_ram, TEGRA210_SFC_COEF_RAM_DEPTH);
 
-		regmap_update_bits(sfc->regmap,
-			TEGRA210_SFC_COEF_RAM,
-			TEGRA210_SFC_COEF_RAM_EN,
-			TEGRA210_SFC_COEF_RAM_EN);
+		sfc->coef_srate_in = sfc->srate_in;
+		sfc->coef_srate_out = sfc->srate_out;
 	}
 
+	regmap_update_bits(sfc->regmap,
+		TEGRA210_SFC_COEF_RAM,
+		TEGRA210_SFC_COEF_RAM_EN,
+		TEGRA210_SFC_COEF_RAM_EN);
+
 	return 0;
 }
 
@@ -3421,6 +3433,11 @@ static bool tegra210_sfc_volatile_reg(struct device *dev, unsigned int reg)
 	}
 }
 
+static bool tegra210_sfc_wr_noinc_reg(struct device *dev, unsigned int reg)
+{
+	return reg == TEGRA210_SFC_CFG_RAM_DATA;
+}
+
 static bool tegra210_sfc_precious_reg(struct device *dev, unsigned int reg)
 {
 	switch (reg) {
@@ -3440,6 +3457,7 @@ static const struct regmap_config tegra210_sfc_regmap_config = {
 	.readable_reg = tegra210_sfc_rd_reg,
 	.volatile_reg = tegra210_sfc_volatile_reg,
 	.precious_reg = tegra210_sfc_precious_reg,
+	.writeable_noinc_reg = tegra210_sfc_wr_noinc_reg,
 	.reg_defaults = tegra210_sfc_reg_defaults,
 	.num_reg_defaults = ARRAY_SIZE(tegra210_sfc_reg_defaults),
 	.cache_type = REGCACHE_FLAT,
@@ -3464,6 +3482,9 @@ static int tegra210_sfc_platform_probe(struct platform_device *pdev)
 
 	dev_set_drvdata(dev, sfc);
 
+	sfc->coef_srate_in = -1;
+	sfc->coef_srate_out = -1;
+
 	regs = devm_platform_ioremap_resource(pdev, 0);
 	if (IS_ERR(regs))
 		return PTR_ERR(regs);
@@ -75,6 +75,9 @@ struct tegra210_sfc {
 	int client_ch_override; /* common for both TX and RX */
 	int stereo_to_mono[SFC_PATHS];
 	int mono_to_stereo[SFC_PATHS];
+	/* rate pair whose coefficients are in the RAM, -1 when unknown */
+	int coef_srate_in;
+	int coef_srate_out;
 };
 
 #endif
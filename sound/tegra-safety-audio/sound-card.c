@@ -595,6 +595,9 @@ static int safety_i2s_open(struct snd_pcm_substream *substream)
 	 */
 	substream->private_data = dma_data;
 
+	if (atomic_cmpxchg(&dma_data->users, 0, 1))
+		return -EBUSY;
+
 	runtime->hw.info = t234_pcm_hardware.info;
 	runtime->hw.rates = t234_pcm_hardware.rates;
 	runtime->hw.rate_min = t234_pcm_hardware.rate_min;
@@ -614,22 +617,29 @@ static int safety_i2s_open(struct snd_pcm_substream *substream)
 				SNDRV_PCM_HW_PARAM_PERIOD_BYTES, 0x8);
 	if (ret) {
 		pr_alert("Failed to set constraint %d\n", ret);
-		return ret;
+		goto release;
 	}
 	chan = dma_request_slave_channel(substream->pcm->card->dev,
 						dma_data->dma_chan_name);
 	if (!chan) {
 		pr_alert("failed to allocate dma channel\n");
-		return -ENODEV;
+		ret = -ENODEV;
+		goto release;
 	}
 
 	ret = snd_dmaengine_pcm_open(substream, chan);
 	if (ret) {
 		pr_alert("failed to open dmaengine\n");
-		return ret;
+		dma_release_channel(chan);
+		goto release;
 	}
 
 	return 0;
+
+release:
+	atomic_set(&dma_data->users, 0);
+
+	return ret;
 }
 
 static int safety_i2s_hw_params(struct snd_pcm_substream *substream,
@@ -662,6 +672,7 @@ static int safety_i2s_close(struct snd_pcm_substream *substream)
 	}
 
 	snd_dmaengine_pcm_close_release_chan(substream);
+	atomic_set(&data->users, 0);
 
 	return 0;
 }
@@ -790,6 +801,11 @@ static int t234_safety_audio_probe(struct platform_device *pdev)
 		prealloc_dma_buff(pcm, SNDRV_PCM_STREAM_CAPTURE, buffer_size);
 
 		safety_i2s_add_kcontrols(card, i);
+
+		ret = safety_i2s_zc_new(card, i, i);
+		if (ret < 0)
+			pr_alert("Could not add i2s%u zero-copy device, ret: %d\n",
+				 I2S_NODE_START_INDEX + i, ret);
 	}
 
 	ret = snd_card_register(card);
@@ -72,6 +72,8 @@ struct dma_data {
 	unsigned int width;
 	unsigned int req_sel;
 	unsigned int triggered;
+	/* the channel is held by the PCM or the zero-copy hwdep */
+	atomic_t users;
 };
 
 struct i2s_dev {
@@ -128,4 +130,17 @@ updatel(volatile void __iomem *addr, unsigned int mask, unsigned int val)
 /* Enable/Disable digital loopback with I2S controller */
 unsigned int i2s_set_loopback(unsigned int id, unsigned int enable);
 
+struct snd_card;
+
+/* Zero-copy dmabuf playback through a hwdep device, see zero-copy.c */
+#if IS_ENABLED(CONFIG_SND_HWDEP)
+int safety_i2s_zc_new(struct snd_card *card, unsigned int id, int device);
+#else
+static inline int
+safety_i2s_zc_new(struct snd_card *card, unsigned int id, int device)
+{
+	return 0;
+}
+#endif
+
 #endif /* _TEGRA_I2S_H_ */
@@ -0,0 +1,643 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * Zero-copy playback for the safety I2S interfaces. Clients map dmabufs
+ * holding pre-rendered audio once and queue periods out of them through a
+ * hwdep device. Each period is its own slave_sg descriptor on the I2S TX
+ * channel, so GPCDMA walks from one period to the next without the CPU
+ * touching samples, and every period completion is timestamped.
+ */
+
+#define pr_fmt(msg) "Safety I2S: " msg
+
+#include <nvidia/conftest.h>
+
+#include <linux/dma-buf.h>
+#include <linux/dmaengine.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <sound/core.h>
+#include <sound/hwdep.h>
+#include <uapi/linux/tegra-safety-audio.h>
+
+#include "tegra_i2s.h"
+
+#define ZC_EVENTS	64
+
+struct zc_map {
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+};
+
+struct zc_period {
+	struct list_head node;
+	struct safety_i2s_zc *zc;
+	struct sg_table sgt;
+	u32 cookie;
+	u64 len;
+};
+
+struct safety_i2s_zc {
+	unsigned int id;
+	struct device *dev;
+	struct dma_data *dma_data;
+	struct dma_chan *chan;
+	/* serialises ioctls against each other and release */
+	struct mutex lock;
+	struct zc_map maps[SAFETY_AUDIO_ZC_MAX_MAPS];
+
+	/* everything below is also touched from the DMA callback */
+	spinlock_t queue_lock;
+	struct list_head queued;
+	bool running;
+	ktime_t last_done;
+	struct safety_audio_zc_stats stats;
+	struct safety_audio_zc_event events[ZC_EVENTS];
+	unsigned int ev_head;
+	unsigned int ev_count;
+	wait_queue_head_t wait;
+};
+
+static unsigned int zc_frame_bytes(struct safety_i2s_zc *zc)
+{
+	struct i2s_config *config = &safety_i2s_get_priv()[zc->id].config;
+
+	return config->channels * (config->bit_size / 8);
+}
+
+static u64 zc_period_ns(struct safety_i2s_zc *zc, u64 len)
+{
+	struct i2s_config *config = &safety_i2s_get_priv()[zc->id].config;
+	u64 bytes_per_sec = (u64)zc_frame_bytes(zc) * config->srate;
+
+	return bytes_per_sec ? div64_u64(len * NSEC_PER_SEC, bytes_per_sec) : 0;
+}
+
+static void zc_reset_stats(struct safety_i2s_zc *zc)
+{
+	memset(&zc->stats, 0, sizeof(zc->stats));
+	zc->stats.jitter_min_ns = S64_MAX;
+	zc->stats.jitter_max_ns = S64_MIN;
+}
+
+static void zc_push_event(struct safety_i2s_zc *zc, u32 cookie, u32 flags,
+			  ktime_t ts)
+{
+	struct safety_audio_zc_event *ev;
+
+	if (zc->ev_count == ZC_EVENTS) {
+		zc->stats.events_dropped++;
+		return;
+	}
+
+	ev = &zc->events[(zc->ev_head + zc->ev_count) % ZC_EVENTS];
+	ev->cookie = cookie;
+	ev->flags = flags;
+	ev->timestamp_ns = ktime_to_ns(ts);
+	zc->ev_count++;
+}
+
+static void zc_free_period(struct zc_period *period)
+{
+	sg_free_table(&period->sgt);
+	kfree(period);
+}
+
+static void zc_period_done(void *param)
+{
+	struct zc_period *period = param;
+	struct safety_i2s_zc *zc = period->zc;
+	struct safety_audio_zc_stats *stats = &zc->stats;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	u32 ev_flags = 0;
+
+	spin_lock_irqsave(&zc->queue_lock, flags);
+
+	list_del(&period->node);
+	stats->periods++;
+
+	if (zc->last_done) {
+		s64 jitter = ktime_to_ns(ktime_sub(now, zc->last_done)) -
+			     (s64)zc_period_ns(zc, period->len);
+
+		stats->intervals++;
+		stats->jitter_min_ns = min(stats->jitter_min_ns, jitter);
+		stats->jitter_max_ns = max(stats->jitter_max_ns, jitter);
+		stats->jitter_abs_sum_ns += abs(jitter);
+	}
+	zc->last_done = now;
+
+	/* Nothing left behind this period, the I2S FIFO runs dry */
+	if (zc->running && list_empty(&zc->queued)) {
+		stats->underruns++;
+		zc->last_done = 0;
+		ev_flags |= SAFETY_AUDIO_ZC_EVENT_UNDERRUN;
+	}
+
+	zc_push_event(zc, period->cookie, ev_flags, now);
+
+	spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+	zc_free_period(period);
+	wake_up_interruptible(&zc->wait);
+}
+
+/* Describe [offset, offset + len) of a mapped dmabuf as its own table */
+static int zc_slice(struct sg_table *src, u64 offset, u64 len,
+		    struct sg_table *dst)
+{
+	struct scatterlist *sg, *out;
+	unsigned int nents = 0, i;
+	u64 pos, skip, end = offset + len;
+	int ret;
+
+	pos = 0;
+	for_each_sg(src->sgl, sg, src->nents, i) {
+		u64 seg_end = pos + sg_dma_len(sg);
+
+		if (seg_end > offset && pos < end)
+			nents++;
+		pos = seg_end;
+	}
+
+	if (!nents || pos < end)
+		return -EINVAL;
+
+	ret = sg_alloc_table(dst, nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	pos = 0;
+	out = dst->sgl;
+	for_each_sg(src->sgl, sg, src->nents, i) {
+		u64 seg_end = pos + sg_dma_len(sg);
+
+		if (seg_end > offset && pos < end) {
+			skip = (offset > pos) ? offset - pos : 0;
+			sg_dma_address(out) = sg_dma_address(sg) + skip;
+			sg_dma_len(out) = min(seg_end, end) - pos - skip;
+			out = sg_next(out);
+		}
+		pos = seg_end;
+	}
+
+	return 0;
+}
+
+static int zc_map_buf(struct safety_i2s_zc *zc, struct safety_audio_zc_map *m)
+{
+	struct zc_map *map = NULL;
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < SAFETY_AUDIO_ZC_MAX_MAPS; i++) {
+		if (!zc->maps[i].dmabuf) {
+			map = &zc->maps[i];
+			break;
+		}
+	}
+
+	if (!map)
+		return -ENOSPC;
+
+	dmabuf = dma_buf_get(m->fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	/* The buffer is read by the DMA controller, map it for that device */
+	attach = dma_buf_attach(dmabuf, zc->chan->device->dev);
+	if (IS_ERR(attach)) {
+		ret = PTR_ERR(attach);
+		goto put;
+	}
+
+	sgt = dma_buf_map_attachment(attach, DMA_TO_DEVICE);
+	if (IS_ERR(sgt)) {
+		ret = PTR_ERR(sgt);
+		goto detach;
+	}
+
+	map->dmabuf = dmabuf;
+	map->attach = attach;
+	map->sgt = sgt;
+	m->handle = i;
+
+	return 0;
+
+detach:
+	dma_buf_detach(dmabuf, attach);
+put:
+	dma_buf_put(dmabuf);
+
+	return ret;
+}
+
+static void zc_unmap_buf(struct zc_map *map)
+{
+	if (!map->dmabuf)
+		return;
+
+	dma_buf_unmap_attachment(map->attach, map->sgt, DMA_TO_DEVICE);
+	dma_buf_detach(map->dmabuf, map->attach);
+	dma_buf_put(map->dmabuf);
+	memset(map, 0, sizeof(*map));
+}
+
+static bool zc_idle(struct safety_i2s_zc *zc)
+{
+	unsigned long flags;
+	bool idle;
+
+	spin_lock_irqsave(&zc->queue_lock, flags);
+	idle = list_empty(&zc->queued);
+	spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+	return idle;
+}
+
+static int zc_queue(struct safety_i2s_zc *zc, struct safety_audio_zc_period *p)
+{
+	struct dma_async_tx_descriptor *desc;
+	struct zc_period *period;
+	struct zc_map *map;
+	unsigned long flags;
+	dma_cookie_t cookie;
+	bool running;
+	int ret;
+
+	if (p->handle >= SAFETY_AUDIO_ZC_MAX_MAPS)
+		return -EINVAL;
+
+	map = &zc->maps[p->handle];
+	if (!map->dmabuf)
+		return -EINVAL;
+
+	if (!p->len || (p->len % zc_frame_bytes(zc)) || (p->offset & 3) ||
+	    p->offset >= map->dmabuf->size ||
+	    p->len > map->dmabuf->size - p->offset)
+		return -EINVAL;
+
+	period = kzalloc(sizeof(*period), GFP_KERNEL);
+	if (!period)
+		return -ENOMEM;
+
+	period->zc = zc;
+	period->cookie = p->cookie;
+	period->len = p->len;
+
+	ret = zc_slice(map->sgt, p->offset, p->len, &period->sgt);
+	if (ret) {
+		kfree(period);
+		return ret;
+	}
+
+	desc = dmaengine_prep_slave_sg(zc->chan, period->sgt.sgl,
+				       period->sgt.nents, DMA_MEM_TO_DEV,
+				       DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!desc) {
+		zc_free_period(period);
+		return -ENOMEM;
+	}
+
+	desc->callback = zc_period_done;
+	desc->callback_param = period;
+
+	spin_lock_irqsave(&zc->queue_lock, flags);
+	list_add_tail(&period->node, &zc->queued);
+	running = zc->running;
+	spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+	cookie = dmaengine_submit(desc);
+	if (dma_submit_error(cookie)) {
+		spin_lock_irqsave(&zc->queue_lock, flags);
+		list_del(&period->node);
+		spin_unlock_irqrestore(&zc->queue_lock, flags);
+		zc_free_period(period);
+		return -EIO;
+	}
+
+	/* Chained behind whatever is in flight */
+	if (running)
+		dma_async_issue_pending(zc->chan);
+
+	return 0;
+}
+
+static void zc_start(struct safety_i2s_zc *zc)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&zc->queue_lock, flags);
+	if (zc->running) {
+		spin_unlock_irqrestore(&zc->queue_lock, flags);
+		return;
+	}
+	zc->running = true;
+	zc->last_done = 0;
+	spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+	/* Let the FIFO fill before the interface starts pulling */
+	dma_async_issue_pending(zc->chan);
+	i2s_enable_tx(zc->id);
+	zc->dma_data->triggered = 1;
+}
+
+static void zc_stop(struct safety_i2s_zc *zc)
+{
+	struct zc_period *period, *tmp;
+	unsigned long flags;
+	LIST_HEAD(pending);
+
+	spin_lock_irqsave(&zc->queue_lock, flags);
+	zc->running = false;
+	spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+	if (zc->dma_data->triggered) {
+		i2s_disable_tx(zc->id);
+		zc->dma_data->triggered = 0;
+	}
+
+	dmaengine_terminate_sync(zc->chan);
+
+	spin_lock_irqsave(&zc->queue_lock, flags);
+	list_splice_init(&zc->queued, &pending);
+	spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+	list_for_each_entry_safe(period, tmp, &pending, node) {
+		list_del(&period->node);
+		zc_free_period(period);
+	}
+}
+
+static int zc_open(struct snd_hwdep *hw, struct file *file)
+{
+	struct safety_i2s_zc *zc = hw->private_data;
+	struct dma_data *dma_data = zc->dma_data;
+	struct dma_slave_config slave_config;
+	unsigned long flags;
+	int ret;
+
+	/* The TX channel belongs to either the PCM or the zero-copy path */
+	if (atomic_cmpxchg(&dma_data->users, 0, 1))
+		return -EBUSY;
+
+	zc->chan = dma_request_slave_channel(zc->dev, dma_data->dma_chan_name);
+	if (!zc->chan) {
+		pr_alert("failed to allocate dma channel\n");
+		ret = -ENODEV;
+		goto release;
+	}
+
+	memset(&slave_config, 0, sizeof(slave_config));
+	slave_config.direction = DMA_MEM_TO_DEV;
+	slave_config.dst_addr = dma_data->addr;
+	slave_config.dst_addr_width = (dma_data->width == 16) ?
+					DMA_SLAVE_BUSWIDTH_2_BYTES :
+					DMA_SLAVE_BUSWIDTH_4_BYTES;
+	/* Same MC burst matching as the PCM path */
+	slave_config.dst_maxburst = 2;
+#if defined(NV_DMA_SLAVE_CONFIG_STRUCT_HAS_SLAVE_ID) /* Linux v5.17 */
+	slave_config.slave_id = dma_data->req_sel;
+#endif
+
+	ret = dmaengine_slave_config(zc->chan, &slave_config);
+	if (ret < 0) {
+		pr_alert("dma slave config failed, err = %d\n", ret);
+		goto free_chan;
+	}
+
+	spin_lock_irqsave(&zc->queue_lock, flags);
+	zc_reset_stats(zc);
+	zc->ev_head = 0;
+	zc->ev_count = 0;
+	spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+	return 0;
+
+free_chan:
+	dma_release_channel(zc->chan);
+	zc->chan = NULL;
+release:
+	atomic_set(&dma_data->users, 0);
+
+	return ret;
+}
+
+static int zc_release(struct snd_hwdep *hw, struct file *file)
+{
+	struct safety_i2s_zc *zc = hw->private_data;
+	unsigned int i;
+
+	mutex_lock(&zc->lock);
+
+	zc_stop(zc);
+
+	for (i = 0; i < SAFETY_AUDIO_ZC_MAX_MAPS; i++)
+		zc_unmap_buf(&zc->maps[i]);
+
+	dma_release_channel(zc->chan);
+	zc->chan = NULL;
+	atomic_set(&zc->dma_data->users, 0);
+
+	mutex_unlock(&zc->lock);
+
+	return 0;
+}
+
+static int zc_ioctl(struct snd_hwdep *hw, struct file *file,
+		    unsigned int cmd, unsigned long arg)
+{
+	struct safety_i2s_zc *zc = hw->private_data;
+	void __user *argp = (void __user *)arg;
+	struct safety_audio_zc_period period;
+	struct safety_audio_zc_stats stats;
+	struct safety_audio_zc_map map;
+	unsigned long flags;
+	u32 handle;
+	int ret = 0;
+
+	mutex_lock(&zc->lock);
+
+	switch (cmd) {
+	case SAFETY_AUDIO_ZC_MAP:
+		if (copy_from_user(&map, argp, sizeof(map))) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = zc_map_buf(zc, &map);
+		if (!ret && copy_to_user(argp, &map, sizeof(map))) {
+			zc_unmap_buf(&zc->maps[map.handle]);
+			ret = -EFAULT;
+		}
+		break;
+	case SAFETY_AUDIO_ZC_UNMAP:
+		if (get_user(handle, (u32 __user *)argp)) {
+			ret = -EFAULT;
+			break;
+		}
+		if (handle >= SAFETY_AUDIO_ZC_MAX_MAPS) {
+			ret = -EINVAL;
+			break;
+		}
+		/* queued periods point into the mapping */
+		if (!zc_idle(zc)) {
+			ret = -EBUSY;
+			break;
+		}
+		zc_unmap_buf(&zc->maps[handle]);
+		break;
+	case SAFETY_AUDIO_ZC_QUEUE:
+		if (copy_from_user(&period, argp, sizeof(period))) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = zc_queue(zc, &period);
+		break;
+	case SAFETY_AUDIO_ZC_START:
+		zc_start(zc);
+		break;
+	case SAFETY_AUDIO_ZC_STOP:
+		zc_stop(zc);
+		break;
+	case SAFETY_AUDIO_ZC_GET_STATS:
+		spin_lock_irqsave(&zc->queue_lock, flags);
+		stats = zc->stats;
+		spin_unlock_irqrestore(&zc->queue_lock, flags);
+		if (!stats.intervals) {
+			stats.jitter_min_ns = 0;
+			stats.jitter_max_ns = 0;
+		}
+		if (copy_to_user(argp, &stats, sizeof(stats)))
+			ret = -EFAULT;
+		break;
+	case SAFETY_AUDIO_ZC_RESET_STATS:
+		spin_lock_irqsave(&zc->queue_lock, flags);
+		zc_reset_stats(zc);
+		zc->last_done = 0;
+		spin_unlock_irqrestore(&zc->queue_lock, flags);
+		break;
+	default:
+		ret = -ENOTTY;
+		break;
+	}
+
+	mutex_unlock(&zc->lock);
+
+	return ret;
+}
+
+/* Never blocks, wait with poll() for completions */
+static long zc_read(struct snd_hwdep *hw, char __user *buf, long count,
+		    loff_t *offset)
+{
+	struct safety_i2s_zc *zc = hw->private_data;
+	struct safety_audio_zc_event ev;
+	unsigned long flags;
+	long done = 0;
+
+	if (count < (long)sizeof(ev))
+		return -EINVAL;
+
+	while (count - done >= (long)sizeof(ev)) {
+		spin_lock_irqsave(&zc->queue_lock, flags);
+		if (!zc->ev_count) {
+			spin_unlock_irqrestore(&zc->queue_lock, flags);
+			break;
+		}
+		ev = zc->events[zc->ev_head];
+		zc->ev_head = (zc->ev_head + 1) % ZC_EVENTS;
+		zc->ev_count--;
+		spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+		if (copy_to_user(buf + done, &ev, sizeof(ev)))
+			return done ? done : -EFAULT;
+
+		done += sizeof(ev);
+	}
+
+	return done ? done : -EAGAIN;
+}
+
+static __poll_t zc_poll(struct snd_hwdep *hw, struct file *file,
+			poll_table *wait)
+{
+	struct safety_i2s_zc *zc = hw->private_data;
+	unsigned long flags;
+	__poll_t mask = 0;
+
+	poll_wait(file, &zc->wait, wait);
+
+	spin_lock_irqsave(&zc->queue_lock, flags);
+	if (zc->ev_count)
+		mask |= EPOLLIN | EPOLLRDNORM;
+	spin_unlock_irqrestore(&zc->queue_lock, flags);
+
+	return mask;
+}
+
+static void zc_private_free(struct snd_hwdep *hw)
+{
+	struct safety_i2s_zc *zc = hw->private_data;
+
+	mutex_destroy(&zc->lock);
+	kfree(zc);
+}
+
+int safety_i2s_zc_new(struct snd_card *card, unsigned int id, int device)
+{
+	struct safety_i2s_zc *zc;
+	struct snd_hwdep *hw;
+	char name[16];
+	int ret;
+
+	zc = kzalloc(sizeof(*zc), GFP_KERNEL);
+	if (!zc)
+		return -ENOMEM;
+
+	snprintf(name, sizeof(name), I2S_DT_NODE "-zc",
+		 I2S_NODE_START_INDEX + id);
+
+	ret = snd_hwdep_new(card, name, device, &hw);
+	if (ret < 0) {
+		kfree(zc);
+		return ret;
+	}
+
+	zc->id = id;
+	zc->dev = card->dev;
+	zc->dma_data = &safety_i2s_get_priv()[id].playback_data;
+	mutex_init(&zc->lock);
+	spin_lock_init(&zc->queue_lock);
+	INIT_LIST_HEAD(&zc->queued);
+	init_waitqueue_head(&zc->wait);
+	zc_reset_stats(zc);
+
+	strscpy(hw->name, name, sizeof(hw->name));
+	hw->exclusive = 1;
+	hw->private_data = zc;
+	hw->private_free = zc_private_free;
+	hw->ops.open = zc_open;
+	hw->ops.release = zc_release;
+	hw->ops.ioctl = zc_ioctl;
+	hw->ops.ioctl_compat = zc_ioctl;
+	hw->ops.read = zc_read;
+	hw->ops.poll = zc_poll;
+
+	return 0;
+}
+
+MODULE_IMPORT_NS(DMA_BUF);
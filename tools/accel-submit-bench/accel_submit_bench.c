@@ -0,0 +1,711 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ */
+
+/*
+ * accel_submit_bench - measure the submit path of PVA and DLA with null
+ * tasks.
+ *
+ * Submits tasks that do no compute (PVA tasks on the no-op executable, DLA
+ * tasks with NVDLA_SUBMIT_FLAGS_BYPASS_EXEC) in batches at a controlled
+ * rate, and reports per task:
+ *
+ *   ioctl      wall time of the submit ioctl, divided over the batch
+ *   cycles     CPU cycles spent in the submit ioctl, divided over the batch
+ *   hw start   submit to the start-of-task timestamp of the engine
+ *   complete   submit to the postfence signalling in userspace
+ *
+ * The start-of-task timestamps are taken by the engine in the TSC time
+ * base, which CNTVCT_EL0 shares, so hw start is only reported on arm64.
+ *
+ * Build:
+ *	gcc -O2 -I include/uapi -I drivers/gpu/host1x-fence/include/uapi \
+ *		-o accel_submit_bench tools/accel-submit-bench/accel_submit_bench.c
+ *
+ * Example Usage:
+ *	accel_submit_bench -e pva -n 10000 -b 8 -r 2000
+ *	accel_submit_bench -e dla -d /dev/nvhost-ctrl-nvdla1 -n 1000
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <linux/perf_event.h>
+#include <linux/host1x-fence.h>
+#include <linux/nvdev_fence.h>
+#include <linux/nvhost_nvdla_ioctl.h>
+#include <linux/nvpva_ioctl.h>
+
+#define BENCH_HOST1X_FENCE_NODE	"/dev/host1x-fence"
+#define BENCH_DMA_HEAP_NODE	"/dev/dma_heap/system"
+#define BENCH_DLA_NODE		"/dev/nvhost-ctrl-nvdla0"
+
+/* one 64-bit start-of-task timestamp per task of a batch */
+#define BENCH_TS_BUF_SIZE	4096U
+#define BENCH_MAX_BATCH		(BENCH_TS_BUF_SIZE / sizeof(uint64_t))
+
+#define BENCH_FENCE_TIMEOUT_MS	5000
+#define BENCH_SUBMIT_TIMEOUT_US	1000000ULL
+
+/* share_id the timestamp buffer is pinned under on DLA */
+#define BENCH_DLA_TS_HANDLE	1U
+
+#define NSEC_PER_SEC		1000000000ULL
+
+struct bench {
+	const struct bench_engine *engine;
+	int fd;
+	int fence_fd;
+
+	int ts_fd;
+	uint64_t *ts;
+	uint32_t pin_id;
+
+	int cycles_fd;
+	uint64_t cntfrq;
+};
+
+struct bench_engine {
+	const char *name;
+	const char *node;
+	unsigned int max_batch;
+	int (*open)(struct bench *b);
+	int (*submit)(struct bench *b, unsigned int num, int *fences);
+	void (*close)(struct bench *b);
+	/* convert a start-of-task timestamp to ns of the TSC time base */
+	uint64_t (*ts_to_ns)(const struct bench *b, uint64_t ts);
+};
+
+struct bench_stat {
+	const char *name;
+	const char *unit;
+	uint64_t *v;
+	size_t n;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static uint64_t ticks_to_ns(uint64_t ticks, uint64_t freq)
+{
+	return (ticks / freq) * NSEC_PER_SEC +
+	       (ticks % freq) * NSEC_PER_SEC / freq;
+}
+
+#if defined(__aarch64__)
+static uint64_t read_cntvct(void)
+{
+	uint64_t v;
+
+	asm volatile("isb; mrs %0, cntvct_el0" : "=r" (v) : : "memory");
+
+	return v;
+}
+
+static uint64_t read_cntfrq(void)
+{
+	uint64_t v;
+
+	asm volatile("mrs %0, cntfrq_el0" : "=r" (v));
+
+	return v;
+}
+#else
+static uint64_t read_cntvct(void)
+{
+	return 0;
+}
+
+static uint64_t read_cntfrq(void)
+{
+	return 0;
+}
+#endif
+
+/*
+ * Count the CPU cycles of this thread, kernel included, so the ioctl cost
+ * is visible. Falls back to thread CPU time when the PMU is not available
+ * to us.
+ */
+static int cycles_open(void)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_hv = 1;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t read_cycles(const struct bench *b)
+{
+	struct timespec ts;
+	uint64_t v;
+
+	if (b->cycles_fd >= 0) {
+		if (read(b->cycles_fd, &v, sizeof(v)) == sizeof(v))
+			return v;
+		return 0;
+	}
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int ts_buf_alloc(struct bench *b)
+{
+	struct dma_heap_allocation_data data = {
+		.len = BENCH_TS_BUF_SIZE,
+		.fd_flags = O_RDWR | O_CLOEXEC,
+	};
+	void *va;
+	int heap;
+	int ret;
+
+	heap = open(BENCH_DMA_HEAP_NODE, O_RDWR | O_CLOEXEC);
+	if (heap < 0) {
+		perror("Failed to open " BENCH_DMA_HEAP_NODE);
+		return -errno;
+	}
+
+	ret = ioctl(heap, DMA_HEAP_IOCTL_ALLOC, &data);
+	close(heap);
+	if (ret < 0) {
+		perror("Failed to allocate timestamp buffer");
+		return -errno;
+	}
+
+	va = mmap(NULL, BENCH_TS_BUF_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+		  data.fd, 0);
+	if (va == MAP_FAILED) {
+		perror("Failed to map timestamp buffer");
+		close(data.fd);
+		return -errno;
+	}
+
+	b->ts_fd = data.fd;
+	b->ts = va;
+
+	return 0;
+}
+
+static void ts_buf_free(struct bench *b)
+{
+	if (b->ts)
+		munmap(b->ts, BENCH_TS_BUF_SIZE);
+	if (b->ts_fd >= 0)
+		close(b->ts_fd);
+}
+
+static void ts_buf_sync(const struct bench *b, uint64_t flags)
+{
+	struct dma_buf_sync sync = { .flags = flags };
+
+	(void)ioctl(b->ts_fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
+static int pva_open(struct bench *b)
+{
+	union nvpva_pin_args pin;
+
+	b->fence_fd = open(BENCH_HOST1X_FENCE_NODE, O_RDWR | O_CLOEXEC);
+	if (b->fence_fd < 0) {
+		perror("Failed to open " BENCH_HOST1X_FENCE_NODE);
+		return -errno;
+	}
+
+	memset(&pin, 0, sizeof(pin));
+	pin.in.pin.size = BENCH_TS_BUF_SIZE;
+	pin.in.pin.handle = b->ts_fd;
+	pin.in.pin.access = NVPVA_ACCESS_RW;
+	pin.in.pin.segment = NVPVA_SEGMENT_USER;
+	pin.in.pin.type = NVPVA_BUFFER_GEN;
+
+	if (ioctl(b->fd, NVPVA_IOCTL_PIN, &pin) < 0) {
+		perror("Failed to pin timestamp buffer");
+		return -errno;
+	}
+
+	b->pin_id = pin.out.pin_id;
+
+	return 0;
+}
+
+static int pva_submit(struct bench *b, unsigned int num, int *fences)
+{
+	struct nvpva_ioctl_task tasks[NVPVA_SUBMIT_MAX_TASKS];
+	struct nvpva_fence_action actions[NVPVA_SUBMIT_MAX_TASKS][2];
+	union nvpva_ioctl_submit_args args;
+	struct host1x_create_fence create;
+	unsigned int i;
+	int ret = 0;
+
+	memset(tasks, 0, num * sizeof(tasks[0]));
+	memset(actions, 0, num * sizeof(actions[0]));
+
+	for (i = 0; i < num; i++) {
+		actions[i][0].type = NVPVA_FENCE_SOT_R5;
+		actions[i][0].fence.type = NVPVA_FENCE_OBJ_SYNCPT;
+		actions[i][0].timestamp_buf.pin_id = b->pin_id;
+		actions[i][0].timestamp_buf.offset = i * sizeof(uint64_t);
+		actions[i][0].timestamp_buf.size = sizeof(uint64_t);
+		actions[i][1].type = NVPVA_FENCE_POST;
+		actions[i][1].fence.type = NVPVA_FENCE_OBJ_SYNCPT;
+
+		tasks[i].exe_id1 = NVPVA_NOOP_EXE_ID;
+		tasks[i].exe_id2 = NVPVA_NOOP_EXE_ID;
+		tasks[i].flags = NVPVA_AFFINITY_VPU_ANY;
+		tasks[i].user_fence_actions.addr = (uintptr_t)actions[i];
+		tasks[i].user_fence_actions.size = sizeof(actions[i]);
+	}
+
+	memset(&args, 0, sizeof(args));
+	args.in.submission_timeout_us = BENCH_SUBMIT_TIMEOUT_US;
+	args.in.tasks.addr = (uintptr_t)tasks;
+	args.in.tasks.size = num * sizeof(tasks[0]);
+
+	if (ioctl(b->fd, NVPVA_IOCTL_SUBMIT, &args) < 0)
+		return -errno;
+
+	for (i = 0; i < num; i++) {
+		memset(&create, 0, sizeof(create));
+		create.id = actions[i][1].fence.obj.syncpt.id;
+		create.threshold = actions[i][1].fence.obj.syncpt.value;
+
+		if (ioctl(b->fence_fd, HOST1X_IOCTL_CREATE_FENCE, &create) < 0) {
+			ret = -errno;
+			fences[i] = -1;
+			continue;
+		}
+		fences[i] = create.fence_fd;
+	}
+
+	return ret;
+}
+
+static void pva_close(struct bench *b)
+{
+	union nvpva_unpin_args unpin = { .in.pin_id = b->pin_id };
+
+	if (b->pin_id)
+		(void)ioctl(b->fd, NVPVA_IOCTL_UNPIN, &unpin);
+	if (b->fence_fd >= 0)
+		close(b->fence_fd);
+}
+
+/* the R5 timestamps tasks in TSC ticks */
+static uint64_t pva_ts_to_ns(const struct bench *b, uint64_t ts)
+{
+	return ticks_to_ns(ts, b->cntfrq);
+}
+
+static int dla_open(struct bench *b)
+{
+	struct nvdla_mem_share_handle handle = {
+		.share_id = BENCH_DLA_TS_HANDLE,
+		.access_flags = NVDLA_MEM_ACCESS_READ_WRITE,
+		.import_id = b->ts_fd,
+	};
+	struct nvdla_pin_unpin_args pin = {
+		.buffers = (uintptr_t)&handle,
+		.num_buffers = 1,
+	};
+
+	if (ioctl(b->fd, NVDLA_IOCTL_ALLOC_QUEUE) < 0) {
+		perror("Failed to allocate DLA queue");
+		return -errno;
+	}
+
+	if (ioctl(b->fd, NVDLA_IOCTL_PIN, &pin) < 0) {
+		perror("Failed to pin timestamp buffer");
+		return -errno;
+	}
+
+	b->pin_id = BENCH_DLA_TS_HANDLE;
+
+	return 0;
+}
+
+static int dla_submit(struct bench *b, unsigned int num, int *fences)
+{
+	struct nvdla_ioctl_submit_task tasks[MAX_NVDLA_TASKS_PER_SUBMIT];
+	struct nvdev_fence postfences[MAX_NVDLA_TASKS_PER_SUBMIT];
+	struct nvdla_mem_handle sof[MAX_NVDLA_TASKS_PER_SUBMIT];
+	struct nvdla_submit_args args;
+	unsigned int i;
+
+	memset(tasks, 0, num * sizeof(tasks[0]));
+	memset(postfences, 0, num * sizeof(postfences[0]));
+	memset(sof, 0, num * sizeof(sof[0]));
+
+	for (i = 0; i < num; i++) {
+		postfences[i].type = NVDEV_FENCE_TYPE_SYNC_FD;
+		postfences[i].action = NVDEV_FENCE_SIGNAL;
+
+		sof[i].handle = BENCH_DLA_TS_HANDLE;
+		sof[i].offset = i * sizeof(uint64_t);
+		sof[i].type = NVDLA_BUFFER_TYPE_MC;
+
+		tasks[i].num_postfences = 1;
+		tasks[i].postfences = (uintptr_t)&postfences[i];
+		tasks[i].num_sof_timestamps = 1;
+		tasks[i].sof_timestamps = (uintptr_t)&sof[i];
+	}
+
+	memset(&args, 0, sizeof(args));
+	args.tasks = (uintptr_t)tasks;
+	args.num_tasks = num;
+	args.flags = NVDLA_SUBMIT_FLAGS_BYPASS_EXEC;
+
+	if (ioctl(b->fd, NVDLA_IOCTL_SUBMIT, &args) < 0)
+		return -errno;
+
+	for (i = 0; i < num; i++)
+		fences[i] = (int)postfences[i].sync_fd;
+
+	return 0;
+}
+
+static void dla_close(struct bench *b)
+{
+	struct nvdla_mem_share_handle handle = {
+		.share_id = BENCH_DLA_TS_HANDLE,
+		.import_id = b->ts_fd,
+	};
+	struct nvdla_pin_unpin_args unpin = {
+		.buffers = (uintptr_t)&handle,
+		.num_buffers = 1,
+	};
+
+	if (b->pin_id)
+		(void)ioctl(b->fd, NVDLA_IOCTL_UNPIN, &unpin);
+	(void)ioctl(b->fd, NVDLA_IOCTL_RELEASE_QUEUE);
+}
+
+/* the DLA firmware timestamps tasks in ns of the TSC */
+static uint64_t dla_ts_to_ns(const struct bench *b, uint64_t ts)
+{
+	(void)b;
+
+	return ts;
+}
+
+static const struct bench_engine bench_engines[] = {
+	{
+		.name = "pva",
+		.node = NVPVA_DEVICE_NODE "0",
+		.max_batch = NVPVA_SUBMIT_MAX_TASKS,
+		.open = pva_open,
+		.submit = pva_submit,
+		.close = pva_close,
+		.ts_to_ns = pva_ts_to_ns,
+	},
+	{
+		.name = "dla",
+		.node = BENCH_DLA_NODE,
+		.max_batch = MAX_NVDLA_TASKS_PER_SUBMIT,
+		.open = dla_open,
+		.submit = dla_submit,
+		.close = dla_close,
+		.ts_to_ns = dla_ts_to_ns,
+	},
+};
+
+static int wait_fence(int fd, uint64_t *signalled)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	int ret;
+
+	ret = poll(&pfd, 1, BENCH_FENCE_TIMEOUT_MS);
+	*signalled = now_ns();
+	if (ret < 0)
+		return -errno;
+	if (ret == 0)
+		return -ETIMEDOUT;
+
+	return 0;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void print_stat(struct bench_stat *s)
+{
+	uint64_t sum = 0;
+	size_t i;
+
+	if (s->n == 0) {
+		fprintf(stdout, "%-10s %8s %10s %10s %10s %10s %10s\n",
+			s->name, s->unit, "n/a", "n/a", "n/a", "n/a", "n/a");
+		return;
+	}
+
+	qsort(s->v, s->n, sizeof(*s->v), cmp_u64);
+	for (i = 0; i < s->n; i++)
+		sum += s->v[i];
+
+	fprintf(stdout, "%-10s %8s %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+		" %10" PRIu64 " %10" PRIu64 "\n",
+		s->name, s->unit, s->v[0], sum / s->n, s->v[s->n / 2],
+		s->v[(s->n * 99) / 100], s->v[s->n - 1]);
+}
+
+static int run_bench(struct bench *b, unsigned int num_tasks,
+		     unsigned int batch, unsigned int rate)
+{
+	struct bench_stat stats[4] = {
+		{ .name = "ioctl", .unit = "ns" },
+		{ .name = "cycles", .unit = "cycles" },
+		{ .name = "hw start", .unit = "ns" },
+		{ .name = "complete", .unit = "ns" },
+	};
+	int fences[BENCH_MAX_BATCH];
+	uint64_t start, release, t0, t1, c0, c1, tsc0, done;
+	unsigned int submitted = 0;
+	unsigned int i, num;
+	int ret = 0;
+
+	for (i = 0; i < 4; i++) {
+		stats[i].v = calloc(num_tasks, sizeof(uint64_t));
+		if (!stats[i].v) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	if (b->cycles_fd < 0) {
+		stats[1].name = "cpu time";
+		stats[1].unit = "ns";
+	}
+
+	start = now_ns();
+
+	while (submitted < num_tasks) {
+		num = num_tasks - submitted < batch ?
+		      num_tasks - submitted : batch;
+
+		/* release each batch at the time of its first task */
+		if (rate) {
+			struct timespec ts;
+
+			release = start + (uint64_t)submitted * NSEC_PER_SEC /
+					  rate;
+			ts.tv_sec = release / NSEC_PER_SEC;
+			ts.tv_nsec = release % NSEC_PER_SEC;
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+					NULL);
+		}
+
+		ts_buf_sync(b, DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+		memset(b->ts, 0, num * sizeof(uint64_t));
+		ts_buf_sync(b, DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+
+		c0 = read_cycles(b);
+		tsc0 = read_cntvct();
+		t0 = now_ns();
+		ret = b->engine->submit(b, num, fences);
+		t1 = now_ns();
+		c1 = read_cycles(b);
+		if (ret < 0) {
+			fprintf(stderr, "Failed to submit tasks (%d)\n", ret);
+			goto out;
+		}
+
+		for (i = 0; i < num; i++) {
+			stats[0].v[stats[0].n++] = (t1 - t0) / num;
+			stats[1].v[stats[1].n++] = (c1 - c0) / num;
+		}
+
+		/* tasks of a queue complete in order */
+		for (i = 0; i < num; i++) {
+			if (fences[i] < 0)
+				continue;
+			ret = wait_fence(fences[i], &done);
+			close(fences[i]);
+			if (ret < 0) {
+				fprintf(stderr, "Failed to wait for task %u (%d)\n",
+					submitted + i, ret);
+				for (i++; i < num; i++)
+					if (fences[i] >= 0)
+						close(fences[i]);
+				goto out;
+			}
+			stats[3].v[stats[3].n++] = done - t0;
+		}
+
+		ts_buf_sync(b, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+		for (i = 0; i < num && b->cntfrq; i++) {
+			uint64_t hw = b->engine->ts_to_ns(b, b->ts[i]);
+			uint64_t sw = ticks_to_ns(tsc0, b->cntfrq);
+
+			/* no timestamp written, or clocks not comparable */
+			if (b->ts[i] == 0 || hw < sw)
+				continue;
+			stats[2].v[stats[2].n++] = hw - sw;
+		}
+		ts_buf_sync(b, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+
+		submitted += num;
+	}
+
+	done = now_ns() - start;
+
+	fprintf(stdout, "%s: %u tasks, batch %u, %" PRIu64 " tasks/s\n",
+		b->engine->name, num_tasks, batch,
+		done ? (uint64_t)(num_tasks * NSEC_PER_SEC / done) : 0);
+	fprintf(stdout, "%-10s %8s %10s %10s %10s %10s %10s\n",
+		"per task", "unit", "min", "avg", "p50", "p99", "max");
+	for (i = 0; i < 4; i++)
+		print_stat(&stats[i]);
+
+out:
+	for (i = 0; i < 4; i++)
+		free(stats[i].v);
+	return ret;
+}
+
+void print_usage(char *bin_name)
+{
+	fprintf(stderr, "Usage: %s [options]...\n"
+		"Measure the submit overhead of PVA or DLA with null tasks\n"
+		"  -e <pva|dla>  Engine to submit to\n"
+		" [-d <path>]    Device node (optional, first instance if not stated)\n"
+		" [-n <n>]       Submit <n> tasks in total (default 1000)\n"
+		" [-b <n>]       Submit <n> tasks per ioctl (default 1)\n"
+		" [-r <n>]       Submit <n> tasks per second (default as fast as possible)\n"
+		"  -h            This helptext\n"
+		"\n"
+		"Example:\n"
+		"%s -e pva -n 10000 -b 8 -r 2000\n"
+		"(means 10000 PVA tasks in batches of 8 at 2000 tasks/s)\n",
+		bin_name, bin_name
+	);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench b = {
+		.fd = -1,
+		.fence_fd = -1,
+		.ts_fd = -1,
+		.cycles_fd = -1,
+	};
+	const char *engine_name = NULL;
+	const char *node = NULL;
+	unsigned int num_tasks = 1000;
+	unsigned int batch = 1;
+	unsigned int rate = 0;
+	unsigned int i;
+	int ret;
+	int c;
+
+	while ((c = getopt(argc, argv, "e:d:n:b:r:h")) != -1) {
+		switch (c) {
+		case 'e':
+			engine_name = optarg;
+			break;
+		case 'd':
+			node = optarg;
+			break;
+		case 'n':
+			num_tasks = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			batch = strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			rate = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	for (i = 0; engine_name && i < sizeof(bench_engines) /
+	     sizeof(bench_engines[0]); i++)
+		if (!strcmp(engine_name, bench_engines[i].name))
+			b.engine = &bench_engines[i];
+
+	if (!b.engine || num_tasks == 0) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (batch == 0 || batch > b.engine->max_batch ||
+	    batch > BENCH_MAX_BATCH) {
+		fprintf(stderr, "Batch size must be 1..%u for %s\n",
+			b.engine->max_batch, b.engine->name);
+		return 1;
+	}
+
+	b.cntfrq = read_cntfrq();
+	if (!b.cntfrq)
+		fprintf(stdout, "No TSC access, not reporting hw start\n");
+
+	b.cycles_fd = cycles_open();
+	if (b.cycles_fd < 0)
+		fprintf(stdout, "No cycle counter, reporting CPU time\n");
+
+	if (!node)
+		node = b.engine->node;
+
+	b.fd = open(node, O_RDWR | O_CLOEXEC);
+	if (b.fd < 0) {
+		perror("Failed to open device");
+		ret = -errno;
+		goto out;
+	}
+
+	ret = ts_buf_alloc(&b);
+	if (ret < 0)
+		goto out;
+
+	ret = b.engine->open(&b);
+	if (ret < 0)
+		goto out_close;
+
+	ret = run_bench(&b, num_tasks, batch, rate);
+
+out_close:
+	b.engine->close(&b);
+out:
+	ts_buf_free(&b);
+	if (b.fd >= 0)
+		close(b.fd);
+	if (b.cycles_fd >= 0)
+		close(b.cycles_fd);
+	return ret < 0 ? 1 : 0;
+}
@@ -0,0 +1,743 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ */
+
+/*
+ * nvscic2c_bench - measure the stream-extensions object path of
+ * nvscic2c-pcie between two SoCs.
+ *
+ * Run as consumer on one SoC and as producer on the other, on the two ends
+ * of the same nvscic2c-pcie endpoint. The consumer maps and exports a target
+ * buffer and a syncpoint. The producer imports them and copies a local
+ * source buffer into the target buffer with submit-copy requests, each
+ * signalling a local syncpoint and the exported one. The export descriptors
+ * are passed over the endpoint memory itself.
+ *
+ * The producer reports:
+ *
+ *   map/export/import  setup cost of the objects
+ *   submit             wall time of the submit-copy ioctl
+ *   complete           submit to the local post-fence seen in userspace
+ *   cpu                CPU time of the process over the copy loop
+ *
+ * and the bandwidth over the copy loop. The consumer reports the bandwidth
+ * seen from the remote post-fences it receives.
+ *
+ * Build:
+ *	gcc -O2 -I include/uapi -o nvscic2c_bench \
+ *		tools/nvscic2c-bench/nvscic2c_bench.c
+ *
+ * Example Usage:
+ *	nvscic2c_bench -e /dev/nvscic2c_pcie_s0_c5_1 -r consumer -s 4M -n 1000
+ *	nvscic2c_bench -e /dev/nvscic2c_pcie_s0_c5_1 -r producer -s 4M -n 1000 -q 4
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <linux/dma-heap.h>
+#include <drm/tegra_drm.h>
+#include <misc/nvscic2c-pcie-ioctl.h>
+
+#define BENCH_DMA_HEAP_NODE	"/dev/dma_heap/system"
+#define BENCH_DRM_NODE		"/dev/dri/card0"
+
+#define BENCH_MSG_MAGIC		0x43324342U	/* "BC2C" */
+#define BENCH_MSG_EXPORT	1U
+#define BENCH_MSG_DONE		2U
+
+#define BENCH_TIMEOUT_MS	10000
+#define BENCH_MAX_DEPTH		64U
+
+#define NSEC_PER_SEC		1000000000ULL
+#define NSEC_PER_MSEC		1000000ULL
+
+/* written by one end in frame 0 of its peer memory, before a notify */
+struct bench_msg {
+	uint32_t magic;
+	uint32_t type;
+	uint64_t size;
+	uint64_t mem_desc;
+	uint64_t sync_desc;
+};
+
+struct bench {
+	int fd;
+	int drm_fd;
+	int heap_fd;
+
+	struct nvscic2c_pcie_endpoint_info info;
+	volatile struct bench_msg *peer_msg;
+	volatile struct bench_msg *self_msg;
+
+	uint64_t size;
+	unsigned int num;
+	unsigned int depth;
+
+	int buf_fd;
+	uint32_t syncpt_id;
+	int32_t mem_handle;
+	int32_t sync_handle;
+	int32_t import_mem_handle;
+	int32_t import_sync_handle;
+};
+
+struct bench_stat {
+	const char *name;
+	const char *unit;
+	uint64_t *v;
+	size_t n;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static uint64_t cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void print_stat(struct bench_stat *s)
+{
+	uint64_t sum = 0;
+	size_t i;
+
+	if (s->n == 0) {
+		fprintf(stdout, "%-10s %4s %10s %10s %10s %10s %10s %10s %10s\n",
+			s->name, s->unit, "n/a", "n/a", "n/a", "n/a", "n/a",
+			"n/a", "n/a");
+		return;
+	}
+
+	qsort(s->v, s->n, sizeof(*s->v), cmp_u64);
+	for (i = 0; i < s->n; i++)
+		sum += s->v[i];
+
+	fprintf(stdout, "%-10s %4s %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+		" %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+		s->name, s->unit, s->v[0], sum / s->n, s->v[s->n / 2],
+		s->v[(s->n * 90) / 100], s->v[(s->n * 99) / 100],
+		s->v[(s->n * 999) / 1000], s->v[s->n - 1]);
+}
+
+static void print_bw(const char *what, uint64_t bytes, uint64_t ns)
+{
+	fprintf(stdout, "%s: %" PRIu64 " bytes in %" PRIu64 " us, %.3f GB/s\n",
+		what, bytes, ns / 1000, ns ? (double)bytes / (double)ns : 0.0);
+}
+
+static int buf_alloc(struct bench *b)
+{
+	struct dma_heap_allocation_data data = {
+		.len = b->size,
+		.fd_flags = O_RDWR | O_CLOEXEC,
+	};
+
+	if (ioctl(b->heap_fd, DMA_HEAP_IOCTL_ALLOC, &data) < 0) {
+		perror("Failed to allocate buffer");
+		return -errno;
+	}
+
+	b->buf_fd = data.fd;
+
+	return 0;
+}
+
+static int syncpt_alloc(struct bench *b)
+{
+	struct drm_tegra_syncpoint_allocate alloc;
+
+	memset(&alloc, 0, sizeof(alloc));
+	if (ioctl(b->drm_fd, DRM_IOCTL_TEGRA_SYNCPOINT_ALLOCATE, &alloc) < 0) {
+		perror("Failed to allocate syncpoint");
+		return -errno;
+	}
+
+	b->syncpt_id = alloc.id;
+
+	return 0;
+}
+
+static void syncpt_free(struct bench *b)
+{
+	struct drm_tegra_syncpoint_free sp_free;
+
+	if (!b->syncpt_id)
+		return;
+
+	memset(&sp_free, 0, sizeof(sp_free));
+	sp_free.id = b->syncpt_id;
+	(void)ioctl(b->drm_fd, DRM_IOCTL_TEGRA_SYNCPOINT_FREE, &sp_free);
+}
+
+/* wait for the syncpoint to reach threshold, 0 reads the current value */
+static int syncpt_wait(struct bench *b, uint32_t threshold, uint32_t *value)
+{
+	struct drm_tegra_syncpoint_wait wait;
+
+	memset(&wait, 0, sizeof(wait));
+	wait.timeout_ns = now_ns() + BENCH_TIMEOUT_MS * NSEC_PER_MSEC;
+	wait.id = b->syncpt_id;
+	wait.threshold = threshold;
+	if (ioctl(b->drm_fd, DRM_IOCTL_TEGRA_SYNCPOINT_WAIT, &wait) < 0)
+		return -errno;
+
+	if (value)
+		*value = wait.value;
+
+	return 0;
+}
+
+static int obj_map(struct bench *b, int32_t type, int fd, uint32_t id,
+		   int32_t *handle)
+{
+	struct nvscic2c_pcie_map_obj_args args;
+
+	memset(&args, 0, sizeof(args));
+	args.obj_type = type;
+	args.in.fd = fd;
+	args.in.id = id;
+	if (ioctl(b->fd, NVSCIC2C_PCIE_IOCTL_MAP, &args) < 0) {
+		perror("Failed to map object");
+		return -errno;
+	}
+
+	*handle = args.out.handle;
+
+	return 0;
+}
+
+static void obj_free(struct bench *b, int32_t type, int32_t handle)
+{
+	struct nvscic2c_pcie_free_obj_args args;
+
+	if (!handle)
+		return;
+
+	memset(&args, 0, sizeof(args));
+	args.obj_type = type;
+	args.handle = handle;
+	(void)ioctl(b->fd, NVSCIC2C_PCIE_IOCTL_FREE, &args);
+}
+
+static int obj_export(struct bench *b, int32_t type, int32_t handle,
+		      uint64_t *desc)
+{
+	struct nvscic2c_pcie_export_obj_args args;
+
+	memset(&args, 0, sizeof(args));
+	args.obj_type = type;
+	args.in.handle = handle;
+	if (ioctl(b->fd, NVSCIC2C_PCIE_IOCTL_GET_AUTH_TOKEN, &args) < 0) {
+		perror("Failed to export object");
+		return -errno;
+	}
+
+	*desc = args.out.desc;
+
+	return 0;
+}
+
+/* the export reaches us over the comm-channel, retry until it registered */
+static int obj_import(struct bench *b, uint64_t desc, int32_t *handle)
+{
+	struct nvscic2c_pcie_import_obj_args args;
+	uint64_t timeout = now_ns() + BENCH_TIMEOUT_MS * NSEC_PER_MSEC;
+
+	do {
+		memset(&args, 0, sizeof(args));
+		args.obj_type = NVSCIC2C_PCIE_OBJ_TYPE_IMPORT;
+		args.in.desc = desc;
+		if (ioctl(b->fd, NVSCIC2C_PCIE_IOCTL_GET_HANDLE, &args) == 0) {
+			*handle = args.out.handle;
+			return 0;
+		}
+		if (errno != EAGAIN)
+			break;
+		usleep(100);
+	} while (now_ns() < timeout);
+
+	perror("Failed to import object");
+	return -errno;
+}
+
+static int msg_send(struct bench *b, const struct bench_msg *msg)
+{
+	b->peer_msg->size = msg->size;
+	b->peer_msg->mem_desc = msg->mem_desc;
+	b->peer_msg->sync_desc = msg->sync_desc;
+	b->peer_msg->type = msg->type;
+	b->peer_msg->magic = msg->magic;
+
+	if (ioctl(b->fd, NVSCIC2C_PCIE_IOCTL_NOTIFY_REMOTE) < 0) {
+		perror("Failed to notify peer");
+		return -errno;
+	}
+
+	return 0;
+}
+
+static int msg_recv(struct bench *b, uint32_t type, struct bench_msg *msg)
+{
+	struct pollfd pfd = { .fd = b->fd, .events = POLLIN };
+	uint64_t timeout = now_ns() + BENCH_TIMEOUT_MS * NSEC_PER_MSEC;
+	int ret;
+
+	while (b->self_msg->magic != BENCH_MSG_MAGIC ||
+	       b->self_msg->type != type) {
+		if (now_ns() >= timeout) {
+			fprintf(stderr, "Timed out waiting for the peer\n");
+			return -ETIMEDOUT;
+		}
+		ret = poll(&pfd, 1, BENCH_TIMEOUT_MS);
+		if (ret < 0) {
+			perror("Failed to poll endpoint");
+			return -errno;
+		}
+	}
+
+	msg->size = b->self_msg->size;
+	msg->mem_desc = b->self_msg->mem_desc;
+	msg->sync_desc = b->self_msg->sync_desc;
+	msg->type = type;
+	b->self_msg->magic = 0;
+
+	return 0;
+}
+
+static int run_consumer(struct bench *b)
+{
+	struct bench_msg msg = {
+		.magic = BENCH_MSG_MAGIC,
+		.type = BENCH_MSG_EXPORT,
+		.size = b->size,
+	};
+	uint64_t t0, t1, first, last;
+	uint32_t base;
+	int ret;
+
+	ret = buf_alloc(b);
+	if (ret < 0)
+		return ret;
+
+	ret = syncpt_alloc(b);
+	if (ret < 0)
+		return ret;
+
+	ret = syncpt_wait(b, 0, &base);
+	if (ret < 0)
+		return ret;
+
+	t0 = now_ns();
+	ret = obj_map(b, NVSCIC2C_PCIE_OBJ_TYPE_TARGET_MEM, b->buf_fd, 0,
+		      &b->mem_handle);
+	if (ret < 0)
+		return ret;
+	ret = obj_map(b, NVSCIC2C_PCIE_OBJ_TYPE_REMOTE_SYNC, b->drm_fd,
+		      b->syncpt_id, &b->sync_handle);
+	if (ret < 0)
+		return ret;
+	t1 = now_ns();
+	fprintf(stdout, "map: %" PRIu64 " us\n", (t1 - t0) / 1000);
+
+	ret = obj_export(b, NVSCIC2C_PCIE_OBJ_TYPE_TARGET_MEM, b->mem_handle,
+			 &msg.mem_desc);
+	if (ret < 0)
+		return ret;
+	ret = obj_export(b, NVSCIC2C_PCIE_OBJ_TYPE_REMOTE_SYNC, b->sync_handle,
+			 &msg.sync_desc);
+	if (ret < 0)
+		return ret;
+	fprintf(stdout, "export: %" PRIu64 " us\n", (now_ns() - t1) / 1000);
+
+	ret = msg_send(b, &msg);
+	if (ret < 0)
+		return ret;
+
+	/* one remote post-fence signal per copy */
+	ret = syncpt_wait(b, base + 1, NULL);
+	if (ret < 0) {
+		fprintf(stderr, "No copy received (%d)\n", ret);
+		return ret;
+	}
+	first = now_ns();
+
+	ret = syncpt_wait(b, base + b->num, NULL);
+	if (ret < 0) {
+		fprintf(stderr, "Copies stopped arriving (%d)\n", ret);
+		return ret;
+	}
+	last = now_ns();
+
+	if (b->num > 1)
+		print_bw("received", (uint64_t)(b->num - 1) * b->size,
+			 last - first);
+
+	/* keep the exported objects until the producer let go of them */
+	return msg_recv(b, BENCH_MSG_DONE, &msg);
+}
+
+static int submit_copy(struct bench *b, unsigned int i)
+{
+	struct nvscic2c_pcie_flush_range range = {
+		.src_handle = b->mem_handle,
+		.dst_handle = b->import_mem_handle,
+		.offset = 0,
+		.size = b->size,
+	};
+	int32_t local = b->sync_handle;
+	int32_t remote = b->import_sync_handle;
+	uint64_t value = i + 1;
+	struct nvscic2c_pcie_submit_copy_args args = {
+		.num_local_post_fences = 1,
+		.local_post_fences = (uintptr_t)&local,
+		.num_remote_post_fences = 1,
+		.remote_post_fences = (uintptr_t)&remote,
+		.num_flush_ranges = 1,
+		.flush_ranges = (uintptr_t)&range,
+		.remote_post_fence_values = (uintptr_t)&value,
+	};
+
+	/* a copy request is reclaimed just after its fences are signalled */
+	while (ioctl(b->fd, NVSCIC2C_PCIE_IOCTL_SUBMIT_COPY_REQUEST,
+		     &args) < 0) {
+		if (errno != EAGAIN)
+			return -errno;
+	}
+
+	return 0;
+}
+
+static int run_producer(struct bench *b)
+{
+	struct bench_stat stats[2] = {
+		{ .name = "submit", .unit = "ns" },
+		{ .name = "complete", .unit = "ns" },
+	};
+	struct nvscic2c_pcie_max_copy_args max = {
+		.max_copy_requests = b->depth,
+		.max_flush_ranges = 1,
+		.max_post_fences = 1,
+	};
+	struct bench_msg msg = {
+		.magic = BENCH_MSG_MAGIC,
+		.type = BENCH_MSG_DONE,
+	};
+	uint64_t *submit_ns = NULL;
+	uint64_t t0, t1, start, elapsed, cpu;
+	unsigned int i, done = 0;
+	uint32_t base;
+	int ret;
+
+	for (i = 0; i < 2; i++) {
+		stats[i].v = calloc(b->num, sizeof(uint64_t));
+		if (!stats[i].v) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+	submit_ns = calloc(b->num, sizeof(uint64_t));
+	if (!submit_ns) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = buf_alloc(b);
+	if (ret < 0)
+		goto out;
+
+	ret = syncpt_alloc(b);
+	if (ret < 0)
+		goto out;
+
+	ret = syncpt_wait(b, 0, &base);
+	if (ret < 0)
+		goto out;
+
+	if (ioctl(b->fd, NVSCIC2C_PCIE_IOCTL_MAX_COPY_REQUESTS, &max) < 0) {
+		perror("Failed to set maximum copy requests");
+		ret = -errno;
+		goto out;
+	}
+
+	t0 = now_ns();
+	ret = obj_map(b, NVSCIC2C_PCIE_OBJ_TYPE_SOURCE_MEM, b->buf_fd, 0,
+		      &b->mem_handle);
+	if (ret < 0)
+		goto out;
+	ret = obj_map(b, NVSCIC2C_PCIE_OBJ_TYPE_LOCAL_SYNC, b->drm_fd,
+		      b->syncpt_id, &b->sync_handle);
+	if (ret < 0)
+		goto out;
+	fprintf(stdout, "map: %" PRIu64 " us\n", (now_ns() - t0) / 1000);
+
+	ret = msg_recv(b, BENCH_MSG_EXPORT, &msg);
+	if (ret < 0)
+		goto out;
+	if (msg.size < b->size) {
+		fprintf(stderr, "Consumer buffer of %" PRIu64 " bytes is too small\n",
+			msg.size);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	t0 = now_ns();
+	ret = obj_import(b, msg.mem_desc, &b->import_mem_handle);
+	if (ret < 0)
+		goto out;
+	ret = obj_import(b, msg.sync_desc, &b->import_sync_handle);
+	if (ret < 0)
+		goto out;
+	fprintf(stdout, "import: %" PRIu64 " us\n", (now_ns() - t0) / 1000);
+
+	cpu = cpu_ns();
+	start = now_ns();
+	for (i = 0; i < b->num; i++) {
+		/* keep at most depth copies in flight, they complete in order */
+		for (; done + b->depth <= i; done++) {
+			ret = syncpt_wait(b, base + done + 1, NULL);
+			if (ret < 0)
+				goto out_wait;
+			stats[1].v[stats[1].n++] = now_ns() - submit_ns[done];
+		}
+
+		t0 = now_ns();
+		ret = submit_copy(b, i);
+		t1 = now_ns();
+		if (ret < 0) {
+			fprintf(stderr, "Failed to submit copy %u (%d)\n", i, ret);
+			goto out_wait;
+		}
+		submit_ns[i] = t0;
+		stats[0].v[stats[0].n++] = t1 - t0;
+	}
+	for (; done < b->num; done++) {
+		ret = syncpt_wait(b, base + done + 1, NULL);
+		if (ret < 0)
+			goto out_wait;
+		stats[1].v[stats[1].n++] = now_ns() - submit_ns[done];
+	}
+	elapsed = now_ns() - start;
+	cpu = cpu_ns() - cpu;
+
+	print_bw("sent", (uint64_t)b->num * b->size, elapsed);
+	fprintf(stdout, "cpu: %" PRIu64 " us, %" PRIu64 " ns/copy, %.1f%% of one core\n",
+		cpu / 1000, cpu / b->num,
+		elapsed ? 100.0 * (double)cpu / (double)elapsed : 0.0);
+	fprintf(stdout, "%-10s %4s %10s %10s %10s %10s %10s %10s %10s\n",
+		"per copy", "unit", "min", "avg", "p50", "p90", "p99", "p99.9",
+		"max");
+	for (i = 0; i < 2; i++)
+		print_stat(&stats[i]);
+
+out_wait:
+	if (ret < 0 && done < b->num)
+		fprintf(stderr, "Copy %u did not complete (%d)\n", done, ret);
+
+	obj_free(b, NVSCIC2C_PCIE_OBJ_TYPE_IMPORT, b->import_mem_handle);
+	obj_free(b, NVSCIC2C_PCIE_OBJ_TYPE_IMPORT, b->import_sync_handle);
+	b->import_mem_handle = 0;
+	b->import_sync_handle = 0;
+
+	msg.type = BENCH_MSG_DONE;
+	if (msg_send(b, &msg) < 0 && ret == 0)
+		ret = -EIO;
+out:
+	free(submit_ns);
+	for (i = 0; i < 2; i++)
+		free(stats[i].v);
+	return ret;
+}
+
+static uint64_t parse_size(const char *s)
+{
+	char *end;
+	uint64_t v = strtoull(s, &end, 0);
+
+	switch (*end) {
+	case 'G': case 'g':
+		v <<= 10;
+		/* fallthrough */
+	case 'M': case 'm':
+		v <<= 10;
+		/* fallthrough */
+	case 'K': case 'k':
+		v <<= 10;
+		break;
+	}
+
+	return v;
+}
+
+void print_usage(char *bin_name)
+{
+	fprintf(stderr, "Usage: %s [options]...\n"
+		"Measure the nvscic2c-pcie stream-extensions copy path\n"
+		"  -e <path>     nvscic2c-pcie endpoint device node\n"
+		"  -r <role>     producer or consumer, one on each SoC\n"
+		" [-s <size>]    Copy <size> bytes per request, K/M/G suffixes (default 1M)\n"
+		" [-n <n>]       Copy <n> requests in total (default 1000)\n"
+		" [-q <n>]       Keep <n> requests in flight, producer only (default 1, max %u)\n"
+		" [-g <path>]    Tegra DRM node for syncpoints (default " BENCH_DRM_NODE ")\n"
+		"  -h            This helptext\n"
+		"\n"
+		"Example:\n"
+		"%s -e /dev/nvscic2c_pcie_s0_c5_1 -r consumer -s 4M -n 1000\n"
+		"%s -e /dev/nvscic2c_pcie_s0_c5_1 -r producer -s 4M -n 1000 -q 4\n"
+		"(means 1000 copies of 4MB with up to 4 in flight)\n",
+		bin_name, BENCH_MAX_DEPTH, bin_name, bin_name
+	);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench b = {
+		.fd = -1,
+		.drm_fd = -1,
+		.heap_fd = -1,
+		.buf_fd = -1,
+		.size = 1U << 20,
+		.num = 1000,
+		.depth = 1,
+	};
+	const char *node = NULL;
+	const char *role = NULL;
+	const char *drm_node = BENCH_DRM_NODE;
+	bool producer;
+	void *peer = MAP_FAILED, *self = MAP_FAILED;
+	int ret;
+	int c;
+
+	while ((c = getopt(argc, argv, "e:r:s:n:q:g:h")) != -1) {
+		switch (c) {
+		case 'e':
+			node = optarg;
+			break;
+		case 'r':
+			role = optarg;
+			break;
+		case 's':
+			b.size = parse_size(optarg);
+			break;
+		case 'n':
+			b.num = strtoul(optarg, NULL, 10);
+			break;
+		case 'q':
+			b.depth = strtoul(optarg, NULL, 10);
+			break;
+		case 'g':
+			drm_node = optarg;
+			break;
+		case 'h':
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!node || !role || (strcmp(role, "producer") &&
+			       strcmp(role, "consumer")) ||
+	    b.size == 0 || b.num == 0 || b.depth == 0 ||
+	    b.depth > BENCH_MAX_DEPTH) {
+		print_usage(argv[0]);
+		return 1;
+	}
+	producer = !strcmp(role, "producer");
+
+	b.fd = open(node, O_RDWR | O_CLOEXEC);
+	if (b.fd < 0) {
+		perror("Failed to open endpoint");
+		ret = -errno;
+		goto out;
+	}
+
+	b.drm_fd = open(drm_node, O_RDWR | O_CLOEXEC);
+	if (b.drm_fd < 0) {
+		perror("Failed to open Tegra DRM");
+		ret = -errno;
+		goto out;
+	}
+
+	b.heap_fd = open(BENCH_DMA_HEAP_NODE, O_RDWR | O_CLOEXEC);
+	if (b.heap_fd < 0) {
+		perror("Failed to open " BENCH_DMA_HEAP_NODE);
+		ret = -errno;
+		goto out;
+	}
+
+	if (ioctl(b.fd, NVSCIC2C_PCIE_IOCTL_GET_INFO, &b.info) < 0) {
+		perror("Failed to get endpoint info");
+		ret = -errno;
+		goto out;
+	}
+
+	peer = mmap(NULL, b.info.peer.size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED, b.fd, b.info.peer.offset);
+	self = mmap(NULL, b.info.self.size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED, b.fd, b.info.self.offset);
+	if (peer == MAP_FAILED || self == MAP_FAILED) {
+		perror("Failed to map endpoint memory");
+		ret = -errno;
+		goto out;
+	}
+	b.peer_msg = peer;
+	b.self_msg = self;
+
+	if (producer)
+		ret = run_producer(&b);
+	else
+		ret = run_consumer(&b);
+
+	obj_free(&b, NVSCIC2C_PCIE_OBJ_TYPE_IMPORT, b.import_mem_handle);
+	obj_free(&b, NVSCIC2C_PCIE_OBJ_TYPE_IMPORT, b.import_sync_handle);
+	obj_free(&b, producer ? NVSCIC2C_PCIE_OBJ_TYPE_SOURCE_MEM :
+		 NVSCIC2C_PCIE_OBJ_TYPE_TARGET_MEM, b.mem_handle);
+	obj_free(&b, producer ? NVSCIC2C_PCIE_OBJ_TYPE_LOCAL_SYNC :
+		 NVSCIC2C_PCIE_OBJ_TYPE_REMOTE_SYNC, b.sync_handle);
+	syncpt_free(&b);
+out:
+	if (peer != MAP_FAILED)
+		munmap(peer, b.info.peer.size);
+	if (self != MAP_FAILED)
+		munmap(self, b.info.self.size);
+	if (b.buf_fd >= 0)
+		close(b.buf_fd);
+	if (b.heap_fd >= 0)
+		close(b.heap_fd);
+	if (b.drm_fd >= 0)
+		close(b.drm_fd);
+	if (b.fd >= 0)
+		close(b.fd);
+	return ret < 0 ? 1 : 0;
+}
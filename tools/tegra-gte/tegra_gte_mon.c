@@ -10,6 +10,10 @@
  *
  * Example Usage:
  *	tegra_gte_mon -d <device> -g <global gpio pin> -r -f
+ *
+ * High rate capture, reading up to 256 events per read() and printing only
+ * the rate and interval statistics once per second:
+ *	tegra_gte_mon -d <device> -g <global gpio pin> -r -b 256 -q
  */
 
 #include <unistd.h>
@@ -25,23 +29,103 @@
 #include <inttypes.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
+#include <time.h>
 #include <linux/tegra-gte-ioctl.h>
 
+#define DEFAULT_BATCH	64
+#define MAX_BATCH	4096
+
+/*
+ * Event statistics. Intervals are taken between consecutive hardware
+ * timestamps, so they show the signal as seen by GTE rather than the
+ * delivery to userspace.
+ */
+struct gte_stats {
+	uint64_t events;
+	uint64_t reads;
+	uint64_t last_ts;
+	uint64_t interval_min;
+	uint64_t interval_max;
+	uint64_t interval_sum;
+	uint64_t intervals;
+};
+
+static uint64_t monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void stats_reset(struct gte_stats *st)
+{
+	uint64_t last_ts = st->last_ts;
+
+	memset(st, 0, sizeof(*st));
+	st->interval_min = UINT64_MAX;
+	st->last_ts = last_ts;
+}
+
+static void stats_add(struct gte_stats *st, uint64_t ts)
+{
+	uint64_t interval;
+
+	if (st->last_ts && ts > st->last_ts) {
+		interval = ts - st->last_ts;
+		if (interval < st->interval_min)
+			st->interval_min = interval;
+		if (interval > st->interval_max)
+			st->interval_max = interval;
+		st->interval_sum += interval;
+		st->intervals++;
+	}
+	st->last_ts = ts;
+	st->events++;
+}
+
+static void stats_print(const struct gte_stats *st, uint64_t elapsed_ns)
+{
+	double secs = elapsed_ns / 1e9;
+
+	if (!st->events || secs <= 0)
+		return;
+
+	fprintf(stdout, "%" PRIu64 " events in %.3f s: %.1f ev/s, "
+		"%.1f ev/read", st->events, secs, st->events / secs,
+		(double)st->events / st->reads);
+	if (st->intervals)
+		fprintf(stdout, ", interval min/avg/max %" PRIu64 "/%" PRIu64
+			"/%" PRIu64 " ns", st->interval_min,
+			st->interval_sum / st->intervals, st->interval_max);
+	fprintf(stdout, "\n");
+}
+
 int monitor_device(const char *device_name,
 		   unsigned int gnum,
 		   unsigned int eventflags,
-		   unsigned int loops)
+		   unsigned int loops,
+		   unsigned int batch,
+		   bool quiet)
 {
 	struct tegra_gte_hts_event_req req = {0};
-	struct tegra_gte_hts_event_data event;
+	struct tegra_gte_hts_event_data *events;
+	struct gte_stats stats = {0}, total = {0};
+	uint64_t start_ns, period_ns, now;
 	char *chrdev_name;
+	unsigned int i = 0, n, j;
 	int fd;
 	int ret;
-	int i = 0;
+
+	events = calloc(batch, sizeof(*events));
+	if (!events)
+		return -ENOMEM;
 
 	ret = asprintf(&chrdev_name, "/dev/%s", device_name);
-	if (ret < 0)
+	if (ret < 0) {
+		free(events);
 		return -ENOMEM;
+	}
 
 	fd = open(chrdev_name, 0);
 	if (fd == -1) {
@@ -64,10 +148,15 @@ int monitor_device(const char *device_name,
 
 	fprintf(stdout, "Monitoring line %d on %s\n", gnum, device_name);
 
+	stats_reset(&stats);
+	stats_reset(&total);
+	start_ns = period_ns = monotonic_ns();
+
 	while (1) {
-		ret = read(req.fd, &event, sizeof(event));
+		/* take as many events as are queued, up to one batch */
+		ret = read(req.fd, events, batch * sizeof(*events));
 		if (ret == -1) {
-			if (errno == -EAGAIN) {
+			if (errno == EAGAIN) {
 				fprintf(stderr, "nothing available\n");
 				continue;
 			} else {
@@ -78,24 +167,47 @@ int monitor_device(const char *device_name,
 			}
 		}
 
-		if (ret != sizeof(event)) {
+		if (ret == 0 || ret % sizeof(*events)) {
 			fprintf(stderr, "Reading event failed\n");
 			ret = -EIO;
 			break;
 		}
 
-		fprintf(stdout, "HW timestamp GPIO EVENT %" PRIu64 "\n",
-			event.timestamp);
+		n = ret / sizeof(*events);
+		if (loops && n > loops - i)
+			n = loops - i;
 
-		i++;
-		if (i == loops)
+		for (j = 0; j < n; j++) {
+			if (!quiet)
+				fprintf(stdout, "HW timestamp GPIO EVENT %" PRIu64 "\n",
+					events[j].timestamp);
+			stats_add(&stats, events[j].timestamp);
+			stats_add(&total, events[j].timestamp);
+		}
+		stats.reads++;
+		total.reads++;
+		ret = 0;
+
+		now = monotonic_ns();
+		if (now - period_ns >= 1000000000ull) {
+			stats_print(&stats, now - period_ns);
+			stats_reset(&stats);
+			period_ns = now;
+		}
+
+		i += n;
+		if (loops && i >= loops)
 			break;
 	}
 
+	fprintf(stdout, "Total: ");
+	stats_print(&total, monotonic_ns() - start_ns);
+
 exit_close_error:
 	if (close(fd) == -1)
 		perror("Failed to close GPIO character device file");
 	free(chrdev_name);
+	free(events);
 	return ret;
 }
 
@@ -108,12 +220,14 @@ void print_usage(char *bin_name)
 		"  -r         Listen for rising edges\n"
 		"  -f         Listen for falling edges\n"
 		" [-c <n>]    Do <n> loops (optional, infinite loop if not stated)\n"
+		" [-b <n>]    Read up to <n> events per read() (default %d)\n"
+		" [-q]        Only print the per second rate and interval statistics\n"
 		"  -h         This helptext\n"
 		"\n"
 		"Example:\n"
 		"%s -d gtechip0 -g 257 -r -f\n"
 		"(means GPIO 257 rising and falling edge monitoring)\n",
-		bin_name, bin_name
+		bin_name, DEFAULT_BATCH, bin_name
 	);
 }
 
@@ -123,10 +237,22 @@ int main(int argc, char **argv)
 	unsigned int gnum = -1;
 	unsigned int loops = 0;
 	unsigned int eventflags = 0;
+	unsigned int batch = DEFAULT_BATCH;
+	bool quiet = false;
 	int c;
 
-	while ((c = getopt(argc, argv, "c:g:d:rfh")) != -1) {
+	while ((c = getopt(argc, argv, "b:c:g:d:rfqh")) != -1) {
 		switch (c) {
+		case 'b':
+			batch = strtoul(optarg, NULL, 10);
+			if (!batch || batch > MAX_BATCH) {
+				fprintf(stderr, "batch must be 1..%d\n", MAX_BATCH);
+				return 1;
+			}
+			break;
+		case 'q':
+			quiet = true;
+			break;
 		case 'c':
 			loops = strtoul(optarg, NULL, 10);
 			break;
@@ -158,5 +284,5 @@ int main(int argc, char **argv)
 		       "falling edges\n");
 		eventflags = TEGRA_GTE_EVENT_REQ_BOTH_EDGES;
 	}
-	return monitor_device(device_name, gnum, eventflags, loops);
+	return monitor_device(device_name, gnum, eventflags, loops, batch, quiet);
 }